@@ -110,11 +110,38 @@ INSERT INTO toast_bug SELECT repeat('a', 2200);
 -- Should not get false positive report of corruption:
 SELECT bt_index_check('toasty', true);
 
+--
+-- Test deduplicated indexes: posting lists built by CREATE INDEX and by
+-- inserts, posting list splits, and VACUUM removing some of their TIDs
+--
+CREATE TABLE dedup_test (id int, a int, b text);
+CREATE INDEX dedup_test_a_idx ON dedup_test (a);
+INSERT INTO dedup_test SELECT i, i % 10, 'key ' || (i % 3) FROM generate_series(1, 50000) i;
+CREATE INDEX dedup_test_b_idx ON dedup_test (b);
+CREATE UNIQUE INDEX dedup_test_id_idx ON dedup_test (id);
+SELECT bt_index_check('dedup_test_a_idx', true);
+SELECT bt_index_parent_check('dedup_test_b_idx', true, true);
+-- Remove some TIDs from every posting list, and all of one key
+DELETE FROM dedup_test WHERE id % 7 = 0 OR a = 3;
+VACUUM dedup_test;
+SELECT bt_index_check('dedup_test_a_idx', true);
+SELECT bt_index_parent_check('dedup_test_b_idx', true, true);
+-- New rows reuse the freed heap space, so that their TIDs fall inside
+-- existing posting lists
+INSERT INTO dedup_test SELECT i, i % 10, 'key ' || (i % 3) FROM generate_series(50001, 60000) i;
+-- Non-HOT updates leave duplicates in the unique index
+UPDATE dedup_test SET b = 'updated' WHERE id <= 1000;
+UPDATE dedup_test SET b = 'key 0' WHERE id <= 1000;
+SELECT bt_index_check('dedup_test_a_idx', true);
+SELECT bt_index_parent_check('dedup_test_b_idx', true, true);
+SELECT bt_index_parent_check('dedup_test_id_idx', true, true);
+
 -- cleanup
 DROP TABLE bttest_a;
 DROP TABLE bttest_b;
 DROP TABLE bttest_multi;
 DROP TABLE delete_test_table;
 DROP TABLE toast_bug;
+DROP TABLE dedup_test;
 DROP OWNED BY regress_bttest_role; -- permissions
 DROP ROLE regress_bttest_role;
@@ -29,10 +29,14 @@
 #include "foreign/foreign.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "port/atomics.h"
+#include "storage/fd.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/sampling.h"
@@ -95,6 +99,34 @@ typedef struct FileFdwPlanState
 	double		ntuples;		/* estimate of number of data rows */
 } FileFdwPlanState;
 
+/*
+ * A parallel scan divides the file into chunks of this many bytes, which the
+ * participating processes claim one at a time.  Each record belongs to the
+ * chunk its first byte is in.  Chunks should be large enough to make the
+ * cost of setting up COPY for each of them negligible.
+ */
+#define FILE_FDW_CHUNK_SIZE		(1024 * 1024)
+
+/*
+ * Shared state of a parallel scan, kept in dynamic shared memory.
+ */
+typedef struct FileFdwParallelScanState
+{
+	uint64		file_size;		/* size of the file when the scan started */
+	pg_atomic_uint64 next_chunk;	/* next chunk to hand out */
+} FileFdwParallelScanState;
+
+/*
+ * Reader feeding the records of one chunk to COPY, in a parallel scan.
+ */
+typedef struct FileFdwChunkReader
+{
+	FILE	   *file;			/* file being read, or NULL */
+	uint64		pos;			/* offset of the next byte to read */
+	uint64		end;			/* end of the chunk */
+	bool		done;			/* has the chunk's last record been read? */
+} FileFdwChunkReader;
+
 /*
  * FDW-specific information for ForeignScanState.fdw_state.
  */
@@ -105,8 +137,17 @@ typedef struct FileFdwExecutionState
 	List	   *options;		/* merged COPY options, excluding filename and
 								 * is_program */
 	CopyState	cstate;			/* COPY execution state */
+
+	/* for parallel scans */
+	bool		parallel;		/* are we reading chunks of the file? */
+	FileFdwParallelScanState *pstate;	/* shared state, or NULL */
+	List	   *chunk_options;	/* options for all chunks but the first */
+	FileFdwChunkReader reader;	/* reader for the current chunk */
 } FileFdwExecutionState;
 
+/* Chunk reader that file_chunk_read() is to read from */
+static FileFdwChunkReader *current_chunk_reader = NULL;
+
 /*
  * SQL functions
  */
@@ -139,6 +180,17 @@ static bool fileAnalyzeForeignTable(Relation relation,
 									BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 										  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+									   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void fileReInitializeDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 
 /*
  * Helper functions
@@ -160,6 +212,11 @@ static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 static int	file_acquire_sample_rows(Relation onerel, int elevel,
 									 HeapTuple *rows, int targrows,
 									 double *totalrows, double *totaldeadrows);
+static bool file_chunks_ok(FileFdwPlanState *fdw_private);
+static uint64 file_size_for_scan(const char *filename);
+static bool file_begin_next_chunk(ForeignScanState *node);
+static void file_end_chunk(FileFdwExecutionState *festate);
+static int	file_chunk_read(void *outbuf, int minread, int maxread);
 
 
 /*
@@ -181,6 +238,10 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = fileReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -577,6 +638,46 @@ fileGetForeignPaths(PlannerInfo *root,
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
 	 * that.
 	 */
+
+	/*
+	 * Consider a parallel scan, in which the workers read separate chunks of
+	 * the file.  As in cost_seqscan(), only the CPU cost is divided among
+	 * the workers.
+	 */
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL &&
+		file_chunks_ok(fdw_private))
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel,
+												   fdw_private->pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			ForeignPath *ppath;
+			Cost		disk_cost = seq_page_cost * fdw_private->pages;
+			double		parallel_divisor;
+
+			ppath = create_foreignscan_path(root, baserel,
+											NULL,	/* default pathtarget */
+											baserel->rows,
+											startup_cost,
+											total_cost,
+											NIL,	/* no pathkeys */
+											NULL,	/* no outer rel */
+											NULL,	/* no extra plan */
+											coptions);
+			ppath->path.parallel_aware = true;
+			ppath->path.parallel_workers = parallel_workers;
+
+			parallel_divisor = get_parallel_divisor(&ppath->path);
+			ppath->path.rows = clamp_row_est(baserel->rows / parallel_divisor);
+			ppath->path.total_cost = startup_cost + disk_cost +
+				(total_cost - startup_cost - disk_cost) / parallel_divisor;
+
+			add_partial_path(baserel, (Path *) ppath);
+		}
+	}
 }
 
 /*
@@ -671,30 +772,55 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 				   &filename, &is_program, &options);
 
 	/* Add any options from the plan (currently only convert_selectively) */
-	options = list_concat(options, plan->fdw_private);
+	options = list_concat(options, list_copy(plan->fdw_private));
 
 	/*
 	 * Create CopyState from FDW options.  We always acquire all columns, so
 	 * as to match the expected ScanTupleSlot signature.
+	 *
+	 * A parallel scan can't start until we know which chunk to read, and it
+	 * might yet turn out not to be parallel at all if the executor decides
+	 * to run the plan in a single process; so leave that to the first
+	 * fileIterateForeignScan call.
 	 */
-	cstate = BeginCopyFrom(NULL,
-						   node->ss.ss_currentRelation,
-						   filename,
-						   is_program,
-						   NULL,
-						   NIL,
-						   options);
+	if (!plan->scan.plan.parallel_aware)
+		cstate = BeginCopyFrom(NULL,
+							   node->ss.ss_currentRelation,
+							   filename,
+							   is_program,
+							   NULL,
+							   NIL,
+							   options);
+	else
+		cstate = NULL;
 
 	/*
 	 * Save state in node->fdw_state.  We must save enough information to call
 	 * BeginCopyFrom() again.
 	 */
-	festate = (FileFdwExecutionState *) palloc(sizeof(FileFdwExecutionState));
+	festate = (FileFdwExecutionState *) palloc0(sizeof(FileFdwExecutionState));
 	festate->filename = filename;
 	festate->is_program = is_program;
 	festate->options = options;
 	festate->cstate = cstate;
 
+	/*
+	 * Only the first chunk of the file starts with the header line, if any;
+	 * the others must be read without the header option.
+	 */
+	if (plan->scan.plan.parallel_aware)
+	{
+		ListCell   *lc;
+
+		foreach(lc, options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, "header") != 0)
+				festate->chunk_options = lappend(festate->chunk_options, def);
+		}
+	}
+
 	node->fdw_state = (void *) festate;
 }
 
@@ -711,34 +837,61 @@ fileIterateForeignScan(ForeignScanState *node)
 	bool		found;
 	ErrorContextCallback errcallback;
 
-	/* Set up callback to identify error line number. */
-	errcallback.callback = CopyFromErrorCallback;
-	errcallback.arg = (void *) festate->cstate;
-	errcallback.previous = error_context_stack;
-	error_context_stack = &errcallback;
+	for (;;)
+	{
+		/*
+		 * A parallel scan claims chunks of the file until there are none
+		 * left.  If no shared state was set up, the plan is being run by this
+		 * process alone, so just read the whole file.
+		 */
+		if (festate->cstate == NULL)
+		{
+			if (festate->pstate == NULL)
+				festate->cstate = BeginCopyFrom(NULL,
+												node->ss.ss_currentRelation,
+												festate->filename,
+												festate->is_program,
+												NULL,
+												NIL,
+												festate->options);
+			else if (!file_begin_next_chunk(node))
+				return ExecClearTuple(slot);
+		}
 
-	/*
-	 * The protocol for loading a virtual tuple into a slot is first
-	 * ExecClearTuple, then fill the values/isnull arrays, then
-	 * ExecStoreVirtualTuple.  If we don't find another row in the file, we
-	 * just skip the last step, leaving the slot empty as required.
-	 *
-	 * We can pass ExprContext = NULL because we read all columns from the
-	 * file, so no need to evaluate default expressions.
-	 *
-	 * We can also pass tupleOid = NULL because we don't allow oids for
-	 * foreign tables.
-	 */
-	ExecClearTuple(slot);
-	found = NextCopyFrom(festate->cstate, NULL,
-						 slot->tts_values, slot->tts_isnull);
-	if (found)
-		ExecStoreVirtualTuple(slot);
+		/* Set up callback to identify error line number. */
+		errcallback.callback = CopyFromErrorCallback;
+		errcallback.arg = (void *) festate->cstate;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
 
-	/* Remove error callback. */
-	error_context_stack = errcallback.previous;
+		/*
+		 * The protocol for loading a virtual tuple into a slot is first
+		 * ExecClearTuple, then fill the values/isnull arrays, then
+		 * ExecStoreVirtualTuple.  If we don't find another row in the file,
+		 * we just skip the last step, leaving the slot empty as required.
+		 *
+		 * We can pass ExprContext = NULL because we read all columns from the
+		 * file, so no need to evaluate default expressions.
+		 *
+		 * We can also pass tupleOid = NULL because we don't allow oids for
+		 * foreign tables.
+		 */
+		ExecClearTuple(slot);
+		current_chunk_reader = &festate->reader;
+		found = NextCopyFrom(festate->cstate, NULL,
+							 slot->tts_values, slot->tts_isnull);
+		if (found)
+			ExecStoreVirtualTuple(slot);
+
+		/* Remove error callback. */
+		error_context_stack = errcallback.previous;
+
+		if (found || !festate->parallel)
+			return slot;
 
-	return slot;
+		/* We're done with this chunk; go on to the next one */
+		file_end_chunk(festate);
+	}
 }
 
 /*
@@ -750,6 +903,17 @@ fileReScanForeignScan(ForeignScanState *node)
 {
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
+	/* A parallel-aware scan starts over lazily, as in the first scan */
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		if (festate->parallel)
+			file_end_chunk(festate);
+		else if (festate->cstate)
+			EndCopyFrom(festate->cstate);
+		festate->cstate = NULL;
+		return;
+	}
+
 	EndCopyFrom(festate->cstate);
 
 	festate->cstate = BeginCopyFrom(NULL,
@@ -771,7 +935,12 @@ fileEndForeignScan(ForeignScanState *node)
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
 	/* if festate is NULL, we are in EXPLAIN; nothing to do */
-	if (festate)
+	if (festate == NULL)
+		return;
+
+	if (festate->parallel)
+		file_end_chunk(festate);
+	else if (festate->cstate)
 		EndCopyFrom(festate->cstate);
 }
 
@@ -837,6 +1006,60 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Report the shared memory needed by a parallel scan
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelScanState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Set up the shared state of a parallel scan
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelScanState *pstate = (FileFdwParallelScanState *) coordinate;
+
+	pstate->file_size = file_size_for_scan(festate->filename);
+	pg_atomic_init_u64(&pstate->next_chunk, 0);
+	festate->pstate = pstate;
+}
+
+/*
+ * fileReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan for a rescan
+ */
+static void
+fileReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelScanState *pstate = (FileFdwParallelScanState *) coordinate;
+
+	pstate->file_size = file_size_for_scan(festate->filename);
+	pg_atomic_write_u64(&pstate->next_chunk, 0);
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pstate = (FileFdwParallelScanState *) coordinate;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1080,6 +1303,208 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 	*total_cost = *startup_cost + run_cost;
 }
 
+/*
+ * Can the file be read in chunks by a parallel scan?
+ *
+ * Chunk boundaries are found by looking for newlines, so we need a plain
+ * file in text format, where a newline always ends a record.  (In CSV
+ * format, quoted values can contain newlines.)
+ */
+static bool
+file_chunks_ok(FileFdwPlanState *fdw_private)
+{
+	ListCell   *lc;
+
+	if (fdw_private->is_program)
+		return false;
+
+	foreach(lc, fdw_private->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "format") == 0 &&
+			strcmp(defGetString(def), "text") != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get the size of the file for a parallel scan.
+ */
+static uint64
+file_size_for_scan(const char *filename)
+{
+	struct stat stat_buf;
+
+	if (stat(filename, &stat_buf) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m",
+						filename)));
+
+	return (uint64) stat_buf.st_size;
+}
+
+/*
+ * Claim the next chunk of the file for a parallel scan, and set up COPY to
+ * read its records.  Returns false if there are no chunks left.
+ */
+static bool
+file_begin_next_chunk(ForeignScanState *node)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwChunkReader *reader = &festate->reader;
+	uint64		chunk;
+	uint64		start;
+
+	Assert(festate->cstate == NULL && reader->file == NULL);
+
+	chunk = pg_atomic_fetch_add_u64(&festate->pstate->next_chunk, 1);
+	start = chunk * FILE_FDW_CHUNK_SIZE;
+
+	/* The first chunk is always read, in case the file is empty */
+	if (chunk > 0 && start >= festate->pstate->file_size)
+		return false;
+
+	reader->file = AllocateFile(festate->filename, PG_BINARY_R);
+	if (reader->file == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\" for reading: %m",
+						festate->filename)));
+	reader->end = start + FILE_FDW_CHUNK_SIZE;
+	reader->done = false;
+
+	/*
+	 * Unless this is the first chunk, a record that began in the previous
+	 * chunk may continue into this one.  It's read along with that chunk, so
+	 * skip to the first record that begins at or after the chunk's start,
+	 * which is the one after the first newline at or after start - 1.
+	 */
+	if (start > 0)
+	{
+		int			c;
+
+		if (fseeko(reader->file, (off_t) (start - 1), SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in file \"%s\": %m",
+							festate->filename)));
+		reader->pos = start - 1;
+		do
+		{
+			c = getc(reader->file);
+			if (c == EOF)
+			{
+				if (ferror(reader->file))
+					ereport(ERROR,
+							(errcode_for_file_access(),
+							 errmsg("could not read from file \"%s\": %m",
+									festate->filename)));
+				reader->done = true;
+				break;
+			}
+			reader->pos++;
+		} while (c != '\n');
+
+		if (reader->pos >= reader->end)
+			reader->done = true;
+	}
+	else
+		reader->pos = 0;
+
+	/* Only the first chunk contains the header line */
+	current_chunk_reader = reader;
+	festate->cstate = BeginCopyFrom(NULL,
+									node->ss.ss_currentRelation,
+									NULL,
+									false,
+									file_chunk_read,
+									NIL,
+									start == 0 ? festate->options :
+									festate->chunk_options);
+	festate->parallel = true;
+
+	return true;
+}
+
+/*
+ * Release the COPY state and file of the current chunk, if any.
+ */
+static void
+file_end_chunk(FileFdwExecutionState *festate)
+{
+	if (festate->cstate)
+		EndCopyFrom(festate->cstate);
+	festate->cstate = NULL;
+
+	if (festate->reader.file)
+		FreeFile(festate->reader.file);
+	festate->reader.file = NULL;
+}
+
+/*
+ * COPY data source callback reading the records of the current chunk.
+ *
+ * We return the bytes up to the end of the chunk, and then the rest of the
+ * record that's still incomplete at that point, if any.
+ */
+static int
+file_chunk_read(void *outbuf, int minread, int maxread)
+{
+	FileFdwChunkReader *reader = current_chunk_reader;
+	char	   *buf = (char *) outbuf;
+	int			nread = 0;
+
+	if (reader->done)
+		return 0;
+
+	if (reader->pos < reader->end)
+	{
+		nread = fread(buf, 1, Min((uint64) maxread, reader->end - reader->pos),
+					  reader->file);
+		if (ferror(reader->file))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from COPY file: %m")));
+		if (nread == 0)
+			reader->done = true;	/* EOF */
+		reader->pos += nread;
+
+		/* If the chunk ends with a newline, so does its last record */
+		if (reader->pos >= reader->end && nread > 0 && buf[nread - 1] == '\n')
+			reader->done = true;
+		return nread;
+	}
+
+	/* Past the end of the chunk, finish the current record */
+	while (nread < maxread)
+	{
+		int			c = getc(reader->file);
+
+		if (c == EOF)
+		{
+			if (ferror(reader->file))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read from COPY file: %m")));
+			reader->done = true;
+			break;
+		}
+		buf[nread++] = (char) c;
+		reader->pos++;
+		if (c == '\n')
+		{
+			reader->done = true;
+			break;
+		}
+	}
+
+	return nread;
+}
+
 /*
  * file_acquire_sample_rows -- acquire a random sample of rows from the table
  *
@@ -10,11 +10,19 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		master worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, autoprewarm uses a master worker that reads and
+ *		sorts the list of blocks to be prewarmed and then hands out ranges
+ *		of that list to per-database workers, running up to
+ *		pg_prewarm.autoprewarm_workers of them at a time.  Each of those
+ *		prefetches the blocks it is about to read, so that the I/O for a
+ *		range is overlapped with reading it into shared buffers.  The master
+ *		keeps running after the initial prewarm is complete to update the
+ *		dump file periodically.
+ *
+ *		On a standby, the master also watches the dump file for changes.  If
+ *		a newer file is put in place, e.g. by copying the primary's, the
+ *		blocks listed there are prewarmed, so that the standby's buffer cache
+ *		follows the primary's working set and is warm when it is promoted.
  *
  *	Copyright (c) 2016-2019, PostgreSQL Global Development Group
  *
@@ -26,15 +34,18 @@
 
 #include "postgres.h"
 
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "access/relation.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
+#include "postmaster/postmaster.h"
 #include "storage/buf_internals.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
@@ -54,6 +65,12 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
+/* Don't bother starting a per-database worker for fewer blocks than this. */
+#define AUTOPREWARM_MIN_WORKER_BLOCKS	1024
+
+/* How often a standby checks for a new dump file, in milliseconds. */
+#define AUTOPREWARM_STANDBY_CHECK_INTERVAL	10000L
+
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
 {
@@ -70,14 +87,21 @@ typedef struct AutoPrewarmSharedState
 	LWLock		lock;			/* mutual exclusion */
 	pid_t		bgworker_pid;	/* for main bgworker */
 	pid_t		pid_using_dumpfile; /* for autoprewarm or block dump */
+	time_t		dump_file_mtime;	/* mtime of dump file we last wrote or
+									 * read */
 
-	/* Following items are for communication with per-database worker */
+	/* Following items are for communication with per-database workers */
 	dsm_handle	block_info_handle;
+	int			prewarmed_blocks;
+} AutoPrewarmSharedState;
+
+/* Range of blocks to be prewarmed by one per-database worker. */
+typedef struct AutoPrewarmTask
+{
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
-} AutoPrewarmSharedState;
+} AutoPrewarmTask;
 
 void		_PG_init(void);
 void		autoprewarm_main(Datum main_arg);
@@ -89,7 +113,13 @@ PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 static void apw_load_buffers(void);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_master_worker(void);
-static void apw_start_database_worker(void);
+static void apw_start_database_worker(AutoPrewarmTask *task,
+									  BackgroundWorkerHandle **handles,
+									  int nworkers);
+static int	apw_wait_for_database_workers(BackgroundWorkerHandle **handles,
+										  int nworkers, int max_running);
+static void apw_remember_dump_file_mtime(void);
+static bool apw_dump_file_changed(void);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
@@ -106,6 +136,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static int	autoprewarm_workers;	/* max concurrent per-database workers */
 
 /*
  * Module load callback.
@@ -125,6 +156,18 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the maximum number of workers used to prewarm buffers concurrently.",
+							NULL,
+							&autoprewarm_workers,
+							1,
+							1, MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -207,6 +250,8 @@ autoprewarm_main(Datum main_arg)
 	/* Periodically dump buffers until terminated. */
 	while (!got_sigterm)
 	{
+		long		delay_in_ms = -1L;
+
 		/* In case of a SIGHUP, just reload the configuration. */
 		if (got_sighup)
 		{
@@ -214,17 +259,19 @@ autoprewarm_main(Datum main_arg)
 			ProcessConfigFile(PGC_SIGHUP);
 		}
 
-		if (autoprewarm_interval <= 0)
+		/*
+		 * On a standby, prewarm from the dump file whenever somebody else has
+		 * replaced it, typically with a copy of the primary's.  As after the
+		 * initial load, there's no point in dumping right afterwards.
+		 */
+		if (RecoveryInProgress() && apw_dump_file_changed())
 		{
-			/* We're only dumping at shutdown, so just wait forever. */
-			(void) WaitLatch(&MyProc->procLatch,
-							 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
-							 -1L,
-							 PG_WAIT_EXTENSION);
+			apw_load_buffers();
+			last_dump_time = GetCurrentTimestamp();
 		}
-		else
+
+		if (autoprewarm_interval > 0)
 		{
-			long		delay_in_ms = 0;
 			TimestampTz next_dump_time = 0;
 			long		secs = 0;
 			int			usecs = 0;
@@ -244,14 +291,23 @@ autoprewarm_main(Datum main_arg)
 				apw_dump_now(true, false);
 				continue;
 			}
-
-			/* Sleep until the next dump time. */
-			(void) WaitLatch(&MyProc->procLatch,
-							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-							 delay_in_ms,
-							 PG_WAIT_EXTENSION);
 		}
 
+		/*
+		 * Sleep until the next dump time, or forever if we're only dumping at
+		 * shutdown.  A standby wakes up periodically to look for a new dump
+		 * file, though.
+		 */
+		if (RecoveryInProgress() &&
+			(delay_in_ms < 0 || delay_in_ms > AUTOPREWARM_STANDBY_CHECK_INTERVAL))
+			delay_in_ms = AUTOPREWARM_STANDBY_CHECK_INTERVAL;
+
+		(void) WaitLatch(&MyProc->procLatch,
+						 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH |
+						 (delay_in_ms >= 0 ? WL_TIMEOUT : 0),
+						 delay_in_ms,
+						 PG_WAIT_EXTENSION);
+
 		/* Reset the latch, loop. */
 		ResetLatch(&MyProc->procLatch);
 	}
@@ -264,8 +320,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers to prewarm the buffers
+ * found there, up to pg_prewarm.autoprewarm_workers of them at a time.
  */
 static void
 apw_load_buffers(void)
@@ -275,6 +331,10 @@ apw_load_buffers(void)
 				i;
 	BlockInfoRecord *blkinfo;
 	dsm_segment *seg;
+	int			nworkers = autoprewarm_workers;
+	BackgroundWorkerHandle **handles;
+	int			start_idx;
+	struct stat st;
 
 	/*
 	 * Skip the prewarm if the dump file is in use; otherwise, prevent any
@@ -313,6 +373,14 @@ apw_load_buffers(void)
 						AUTOPREWARM_FILE)));
 	}
 
+	/* Remember which version of the file we're loading. */
+	if (fstat(fileno(file), &st) == 0)
+	{
+		LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+		apw_state->dump_file_mtime = st.st_mtime;
+		LWLockRelease(&apw_state->lock);
+	}
+
 	/* First line of the file is a record count. */
 	if (fscanf(file, "<<%d>>\n", &num_elements) != 1)
 		ereport(ERROR,
@@ -346,14 +414,19 @@ apw_load_buffers(void)
 
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
-	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
 	apw_state->prewarmed_blocks = 0;
 
+	handles = (BackgroundWorkerHandle **)
+		palloc0(sizeof(BackgroundWorkerHandle *) * nworkers);
+
 	/* Get the info position of the first block of the next database. */
-	while (apw_state->prewarm_start_idx < num_elements)
+	start_idx = 0;
+	while (start_idx < num_elements && !got_sigterm)
 	{
-		int			j = apw_state->prewarm_start_idx;
+		int			j = start_idx;
 		Oid			current_db = blkinfo[j].database;
+		int			chunk_size;
+		int			k;
 
 		/*
 		 * Advance the prewarm_stop_idx to the first BlockInfoRecord that does
@@ -384,26 +457,39 @@ apw_load_buffers(void)
 		if (current_db == InvalidOid)
 			break;
 
-		/* Configure stop point and database for next per-database worker. */
-		apw_state->prewarm_stop_idx = j;
-		apw_state->database = current_db;
-		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
-
-		/* If we've run out of free buffers, don't launch another worker. */
-		if (!have_free_buffer())
-			break;
+		Assert(start_idx < j);
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Split the blocks of this database into ranges for up to nworkers
+		 * per-database workers, and start a worker for each.  The ranges
+		 * needn't respect relation boundaries; each worker opens whatever
+		 * relations its range touches.
 		 */
-		apw_start_database_worker();
+		chunk_size = Max((j - start_idx + nworkers - 1) / nworkers,
+						 AUTOPREWARM_MIN_WORKER_BLOCKS);
+		for (k = start_idx; k < j && !got_sigterm; k += chunk_size)
+		{
+			AutoPrewarmTask task;
+
+			/* If we've run out of free buffers, don't launch another worker. */
+			if (!have_free_buffer())
+				break;
+
+			task.database = current_db;
+			task.prewarm_start_idx = k;
+			task.prewarm_stop_idx = Min(k + chunk_size, j);
+			apw_start_database_worker(&task, handles, nworkers);
+		}
+		if (k < j)
+			break;
 
 		/* Prepare for next database. */
-		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
+		start_idx = j;
 	}
 
-	/* Clean up. */
+	/* Wait for all per-database workers to finish, then clean up. */
+	(void) apw_wait_for_database_workers(handles, nworkers, 0);
+	pfree(handles);
 	dsm_detach(seg);
 	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
 	apw_state->block_info_handle = DSM_HANDLE_INVALID;
@@ -423,17 +509,23 @@ apw_load_buffers(void)
 void
 autoprewarm_database_main(Datum main_arg)
 {
+	AutoPrewarmTask task;
 	int			pos;
+	int			prefetch_pos;
 	BlockInfoRecord *block_info;
 	Relation	rel = NULL;
 	BlockNumber nblocks = 0;
 	BlockInfoRecord *old_blk = NULL;
 	dsm_segment *seg;
+	int			prewarmed_blocks = 0;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
 	pqsignal(SIGTERM, die);
 	BackgroundWorkerUnblockSignals();
 
+	/* Our range of blocks is passed in bgw_extra. */
+	memcpy(&task, MyBgworkerEntry->bgw_extra, sizeof(AutoPrewarmTask));
+
 	/* Connect to correct database and get block information. */
 	apw_init_shmem();
 	seg = dsm_attach(apw_state->block_info_handle);
@@ -441,15 +533,15 @@ autoprewarm_database_main(Datum main_arg)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("could not map dynamic shared memory segment")));
-	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
+	BackgroundWorkerInitializeConnectionByOid(task.database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
+	pos = prefetch_pos = task.prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (pos < task.prewarm_stop_idx && have_free_buffer())
 	{
 		BlockInfoRecord *blk = &block_info[pos++];
 		Buffer		buf;
@@ -527,12 +619,34 @@ autoprewarm_database_main(Datum main_arg)
 			continue;
 		}
 
+		/*
+		 * Keep up to target_prefetch_pages prefetch requests in flight for
+		 * the following blocks of this fork, so that the kernel reads them
+		 * while we're busy with the current one.
+		 */
+		if (prefetch_pos < pos)
+			prefetch_pos = pos;
+		while (prefetch_pos < task.prewarm_stop_idx &&
+			   prefetch_pos < pos + target_prefetch_pages)
+		{
+			BlockInfoRecord *next_blk = &block_info[prefetch_pos];
+
+			if (next_blk->database != blk->database ||
+				next_blk->tablespace != blk->tablespace ||
+				next_blk->filenode != blk->filenode ||
+				next_blk->forknum != blk->forknum)
+				break;
+			if (next_blk->blocknum < nblocks)
+				PrefetchBuffer(rel, next_blk->forknum, next_blk->blocknum);
+			prefetch_pos++;
+		}
+
 		/* Prewarm buffer. */
 		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
 								 NULL);
 		if (BufferIsValid(buf))
 		{
-			apw_state->prewarmed_blocks++;
+			prewarmed_blocks++;
 			ReleaseBuffer(buf);
 		}
 
@@ -541,6 +655,11 @@ autoprewarm_database_main(Datum main_arg)
 
 	dsm_detach(seg);
 
+	/* Report our progress to the master. */
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	apw_state->prewarmed_blocks += prewarmed_blocks;
+	LWLockRelease(&apw_state->lock);
+
 	/* Release lock on previous relation. */
 	if (rel)
 	{
@@ -685,6 +804,7 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	}
 
 	(void) durable_rename(transient_dump_file_path, AUTOPREWARM_FILE, ERROR);
+	apw_remember_dump_file_mtime();
 	apw_state->pid_using_dumpfile = InvalidPid;
 
 	ereport(DEBUG1,
@@ -763,6 +883,7 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		apw_state->dump_file_mtime = 0;
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -828,13 +949,23 @@ apw_start_master_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start autoprewarm per-database worker process for the given range of
+ * blocks.  If nworkers workers are already running, wait for one of them to
+ * exit first; handles[] tracks the running workers.
  */
 static void
-apw_start_database_worker(void)
+apw_start_database_worker(AutoPrewarmTask *task,
+						  BackgroundWorkerHandle **handles, int nworkers)
 {
 	BackgroundWorker worker;
 	BackgroundWorkerHandle *handle;
+	int			slot;
+
+	StaticAssertStmt(sizeof(AutoPrewarmTask) <= BGW_EXTRALEN,
+					 "AutoPrewarmTask must fit in bgw_extra");
+
+	slot = apw_wait_for_database_workers(handles, nworkers, nworkers - 1);
+	Assert(slot >= 0 && handles[slot] == NULL);
 
 	MemSet(&worker, 0, sizeof(BackgroundWorker));
 	worker.bgw_flags =
@@ -845,6 +976,7 @@ apw_start_database_worker(void)
 	strcpy(worker.bgw_function_name, "autoprewarm_database_main");
 	strcpy(worker.bgw_name, "autoprewarm worker");
 	strcpy(worker.bgw_type, "autoprewarm worker");
+	memcpy(worker.bgw_extra, task, sizeof(AutoPrewarmTask));
 
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
@@ -855,11 +987,89 @@ apw_start_database_worker(void)
 				 errmsg("registering dynamic bgworker autoprewarm failed"),
 				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
 
-	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
-	 * checks for that elsewhere.
-	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	handles[slot] = handle;
+}
+
+/*
+ * Wait until at most max_running of the per-database workers in handles[]
+ * are still running, and return the index of a free slot in handles[] (or -1
+ * if there is none).
+ *
+ * We set bgw_notify_pid when starting the workers, so the postmaster sets
+ * our latch whenever one of them exits; the timeout is just a safety net.
+ */
+static int
+apw_wait_for_database_workers(BackgroundWorkerHandle **handles,
+							  int nworkers, int max_running)
+{
+	for (;;)
+	{
+		int			running = 0;
+		int			free_slot = -1;
+		int			i;
+
+		for (i = 0; i < nworkers; i++)
+		{
+			pid_t		pid;
+
+			if (handles[i] != NULL &&
+				GetBackgroundWorkerPid(handles[i], &pid) == BGWH_STOPPED)
+			{
+				pfree(handles[i]);
+				handles[i] = NULL;
+			}
+
+			if (handles[i] != NULL)
+				running++;
+			else if (free_slot < 0)
+				free_slot = i;
+		}
+
+		if (running <= max_running)
+			return free_slot;
+
+		(void) WaitLatch(&MyProc->procLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L,
+						 PG_WAIT_EXTENSION);
+		ResetLatch(&MyProc->procLatch);
+	}
+}
+
+/*
+ * Record the modification time of the dump file we've just written, so that
+ * a standby doesn't mistake it for a new file to prewarm from.
+ */
+static void
+apw_remember_dump_file_mtime(void)
+{
+	struct stat st;
+
+	if (stat(AUTOPREWARM_FILE, &st) == 0)
+	{
+		LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+		apw_state->dump_file_mtime = st.st_mtime;
+		LWLockRelease(&apw_state->lock);
+	}
+}
+
+/*
+ * Has the dump file been replaced since we last wrote or read it?
+ */
+static bool
+apw_dump_file_changed(void)
+{
+	struct stat st;
+	bool		changed;
+
+	if (stat(AUTOPREWARM_FILE, &st) != 0)
+		return false;
+
+	LWLockAcquire(&apw_state->lock, LW_SHARED);
+	changed = (st.st_mtime != apw_state->dump_file_mtime);
+	LWLockRelease(&apw_state->lock);
+
+	return changed;
 }
 
 /* Compare member elements to check whether they are not equal. */
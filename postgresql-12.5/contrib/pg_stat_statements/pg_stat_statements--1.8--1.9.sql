@@ -0,0 +1,33 @@
+/* contrib/pg_stat_statements/pg_stat_statements--1.8--1.9.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_stat_statements UPDATE TO '1.9'" to load this file. \quit
+
+CREATE FUNCTION pg_stat_statements_plan_nodes(
+    OUT userid oid,
+    OUT dbid oid,
+    OUT queryid bigint,
+    OUT planid bigint,
+    OUT plan_node_id int4,
+    OUT parent_node_id int4,
+    OUT node_type text,
+    OUT relid oid,
+    OUT plan_rows float8,
+    OUT executions int8,
+    OUT loops int8,
+    OUT rows int8,
+    OUT total_time float8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pg_stat_statements_plan_nodes'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE VIEW pg_stat_statements_plan_nodes AS
+  SELECT n.userid, n.dbid, n.queryid, n.planid, n.plan_node_id,
+         n.parent_node_id, n.node_type, n.relid, n.plan_rows,
+         n.executions, n.loops, n.rows, n.total_time, s.query
+    FROM pg_stat_statements_plan_nodes() n
+         LEFT JOIN pg_stat_statements(true) s
+         ON s.userid = n.userid AND s.dbid = n.dbid AND s.queryid = n.queryid;
+
+GRANT SELECT ON pg_stat_statements_plan_nodes TO PUBLIC;
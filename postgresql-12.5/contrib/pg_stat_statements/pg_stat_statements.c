@@ -46,6 +46,22 @@
  * Rewriting the entire external query-text file, eg for garbage collection,
  * requires holding pgss->lock exclusively; this allows individual entries
  * in the file to be read or written while holding only shared lock.
+ * Garbage collection keeps that window short by writing the compacted copy
+ * to a separate file under shared lock, and only switching over to it under
+ * exclusive lock.
+ *
+ * To keep the shared lock and the entry spinlocks off the path of every
+ * execution, each backend accumulates its statistics in a local hashtable
+ * of pending counters and adds them to the shared hashtable in one go every
+ * pg_stat_statements.flush_interval, as well as at backend exit and before
+ * it reads or resets the shared statistics itself.
+ *
+ * When pg_stat_statements.track_plan_nodes is on, every plan node of a
+ * tracked statement is instrumented, and at the end of execution the rows,
+ * loops and time of each node are added to a second shared hashtable, keyed
+ * by statement and by a fingerprint of the plan's shape.  This shows which
+ * node of a statement got slower when its plan changed.  Those entries are
+ * protected by pgss->lock and a per-entry mutex in the same way.
  *
  *
  * Copyright (c) 2008-2019, PostgreSQL Global Development Group
@@ -79,6 +95,7 @@
 #include "utils/builtins.h"
 #include "utils/hashutils.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 
 PG_MODULE_MAGIC;
 
@@ -94,9 +111,10 @@ PG_MODULE_MAGIC;
  * strings, so placing the file on a faster filesystem is not compelling.
  */
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
+#define PGSS_TEXT_TMP_FILE	PGSS_TEXT_FILE ".tmp"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20171004;
+static const uint32 PGSS_FILE_HEADER = 0x20200330;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -111,6 +129,8 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 #define USAGE_DEALLOC_PERCENT	5	/* free this % of entries at once */
 
 #define JUMBLE_SIZE				1024	/* query serialization buffer size */
+#define PGSS_MAX_PENDING		1024	/* flush early beyond this many entries */
+#define PGSS_NODE_TYPE_LEN		32	/* max length of a plan node type name */
 
 /*
  * Extension version number, for supporting older extension versions' objects
@@ -120,7 +140,8 @@ typedef enum pgssVersion
 	PGSS_V1_0 = 0,
 	PGSS_V1_1,
 	PGSS_V1_2,
-	PGSS_V1_3
+	PGSS_V1_3,
+	PGSS_V1_8
 } pgssVersion;
 
 /*
@@ -163,6 +184,9 @@ typedef struct Counters
 	int64		temp_blks_written;	/* # of temp blocks written */
 	double		blk_read_time;	/* time spent reading, in msec */
 	double		blk_write_time; /* time spent writing, in msec */
+	int64		wal_records;	/* # of WAL records generated */
+	int64		wal_fpi;		/* # of WAL full page images generated */
+	uint64		wal_bytes;		/* total amount of WAL bytes generated */
 	double		usage;			/* usage factor */
 } Counters;
 
@@ -183,6 +207,67 @@ typedef struct pgssEntry
 	slock_t		mutex;			/* protects the counters only */
 } pgssEntry;
 
+/*
+ * Hashtable key for per-plan-node statistics.  planid is a fingerprint of
+ * the shape of the plan, so that the nodes of different plans chosen for
+ * the same statement are kept apart.
+ *
+ * This structure has padding at the end, so keys must be zeroed before use.
+ */
+typedef struct pgssPlanNodeKey
+{
+	Oid			userid;			/* user OID */
+	Oid			dbid;			/* database OID */
+	uint64		queryid;		/* query identifier */
+	uint64		planid;			/* plan fingerprint */
+	int32		plan_node_id;	/* ID of the node within the plan */
+} pgssPlanNodeKey;
+
+/*
+ * Statistics per plan node
+ */
+typedef struct pgssPlanNodeEntry
+{
+	pgssPlanNodeKey key;		/* hash key of entry - MUST BE FIRST */
+	int32		parent_node_id; /* plan_node_id of the parent, or -1 */
+	Oid			relid;			/* relation or index scanned, if any */
+	char		node_type[PGSS_NODE_TYPE_LEN];	/* as shown by EXPLAIN */
+	double		plan_rows;		/* latest planner estimate of rows per loop */
+	int64		executions;		/* # of executions that ran the node */
+	int64		loops;			/* # of times the node was started */
+	int64		rows;			/* total # of rows returned by the node */
+	double		total_time;		/* total time spent in the node, in msec */
+	slock_t		mutex;			/* protects the counters only */
+} pgssPlanNodeEntry;
+
+/*
+ * Statistics of one plan node from a single execution, gathered before they
+ * are added to the shared hashtable
+ */
+typedef struct pgssPlanNodeSample
+{
+	int32		plan_node_id;
+	int32		parent_node_id;
+	Oid			relid;
+	const char *node_type;
+	double		plan_rows;
+	double		loops;
+	double		rows;
+	double		total_time;		/* in msec */
+	bool		counted;		/* already added to the shared entry */
+} pgssPlanNodeSample;
+
+/*
+ * Working state for pgss_collect_plan_node
+ */
+typedef struct pgssPlanNodeWalk
+{
+	List	   *rtable;			/* range table of the plan */
+	pgssPlanNodeSample *samples;
+	int			nsamples;
+	int			maxsamples;
+} pgssPlanNodeWalk;
+
 /*
  * Global shared state
  */
@@ -195,8 +280,36 @@ typedef struct pgssSharedState
 	Size		extent;			/* current extent of query file */
 	int			n_writers;		/* number of active writers to query file */
 	int			gc_count;		/* query file garbage collection cycle count */
+	bool		gc_in_progress; /* is a backend compacting the query file? */
 } pgssSharedState;
 
+/*
+ * Statistics gathered by this backend that have not yet been added to the
+ * shared hashtable.  The query text is kept in case the flush has to create
+ * the shared entry.
+ */
+typedef struct pgssPendingEntry
+{
+	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
+	Counters	counters;		/* the statistics not yet flushed */
+	char	   *query;			/* query text, null-terminated */
+	int			query_len;		/* # of valid bytes in query string */
+	int			encoding;		/* query text encoding */
+	/* Used only during pgss_flush_pending: */
+	bool		stored;			/* query text was written to file */
+	Size		query_offset;	/* where it was written */
+	int			gc_count;		/* gc_count at the time */
+} pgssPendingEntry;
+
+/*
+ * Old and new location of a query text during garbage collection
+ */
+typedef struct pgssTextMove
+{
+	Size		old_offset;
+	Size		new_offset;
+} pgssTextMove;
+
 /*
  * Struct for tracking locations/lengths of constants during normalization
  */
@@ -248,6 +361,13 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 /* Links to shared memory state */
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
+static HTAB *pgss_plan_nodes = NULL;
+
+/* Pending statistics of this backend, and when they were last flushed */
+static MemoryContext pgss_pending_cxt = NULL;
+static HTAB *pgss_pending = NULL;
+static TimestampTz pgss_last_flush = 0;
+static bool pgss_exit_registered = false;
 
 /*---- GUC variables ----*/
 
@@ -270,6 +390,9 @@ static int	pgss_max;			/* max # statements to track */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_save;			/* whether to save stats across shutdown */
+static int	pgss_flush_interval;	/* ms between flushes of pending stats */
+static bool pgss_track_plan_nodes;	/* whether to collect per-node stats */
+static int	pgss_max_plan_nodes;	/* max # plan nodes to track */
 
 
 #define pgss_enabled() \
@@ -293,7 +416,9 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_reset);
 PG_FUNCTION_INFO_V1(pg_stat_statements_reset_1_7);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_8);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
+PG_FUNCTION_INFO_V1(pg_stat_statements_plan_nodes);
 
 static void pgss_shmem_startup(void);
 static void pgss_shmem_shutdown(int code, Datum arg);
@@ -313,7 +438,21 @@ static void pgss_store(const char *query, uint64 queryId,
 					   int query_location, int query_len,
 					   double total_time, uint64 rows,
 					   const BufferUsage *bufusage,
+					   const WalUsage *walusage,
 					   pgssJumbleState *jstate);
+static void pgss_count(Counters *c, double total_time, uint64 rows,
+					   const BufferUsage *bufusage, const WalUsage *walusage);
+static void pgss_merge_counters(volatile Counters *dst, const Counters *src);
+static void pgss_flush_pending(bool force);
+static void pgss_pending_shutdown(int code, Datum arg);
+static void pgss_store_plan_nodes(QueryDesc *queryDesc);
+static void pgss_collect_plan_node(PlanState *node, PlanState *parent,
+								   void *arg);
+static void pgss_count_plan_node(pgssPlanNodeEntry *entry,
+								 pgssPlanNodeSample *sample);
+static uint64 pgss_plan_fingerprint(PlannedStmt *stmt);
+static Oid	pgss_plan_node_relid(Plan *plan, List *rtable);
+static const char *pgss_plan_node_name(Plan *plan);
 static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
@@ -328,12 +467,15 @@ static char *qtext_fetch(Size query_offset, int query_len,
 						 char *buffer, Size buffer_size);
 static bool need_gc_qtexts(void);
 static void gc_qtexts(void);
+static void gc_qtexts_fail(void);
+static int	text_move_cmp(const void *lhs, const void *rhs);
 static void entry_reset(Oid userid, Oid dbid, uint64 queryid);
 static void AppendJumble(pgssJumbleState *jstate,
 						 const unsigned char *item, Size size);
 static void JumbleQuery(pgssJumbleState *jstate, Query *query);
 static void JumbleRangeTable(pgssJumbleState *jstate, List *rtable);
 static void JumbleExpr(pgssJumbleState *jstate, Node *node);
+static void JumblePlan(pgssJumbleState *jstate, Plan *plan, List *rtable);
 static void RecordConstLocation(pgssJumbleState *jstate, int location);
 static char *generate_normalized_query(pgssJumbleState *jstate, const char *query,
 									   int query_loc, int *query_len_p, int encoding);
@@ -409,6 +551,43 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("pg_stat_statements.flush_interval",
+							"Sets how often a session adds its statistics to the shared statistics.",
+							"Zero adds them after every statement.",
+							&pgss_flush_interval,
+							500,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pg_stat_statements.track_plan_nodes",
+							 "Selects whether pg_stat_statements collects statistics for each plan node.",
+							 NULL,
+							 &pgss_track_plan_nodes,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_stat_statements.max_plan_nodes",
+							"Sets the maximum number of plan nodes tracked by pg_stat_statements.",
+							NULL,
+							&pgss_max_plan_nodes,
+							10000,
+							100,
+							INT_MAX,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	EmitWarningsOnPlaceholders("pg_stat_statements");
 
 	/*
@@ -480,6 +659,7 @@ pgss_shmem_startup(void)
 	/* reset in case this is a restart within the postmaster */
 	pgss = NULL;
 	pgss_hash = NULL;
+	pgss_plan_nodes = NULL;
 
 	/*
 	 * Create or attach to the shared memory state, including hash table
@@ -500,6 +680,7 @@ pgss_shmem_startup(void)
 		pgss->extent = 0;
 		pgss->n_writers = 0;
 		pgss->gc_count = 0;
+		pgss->gc_in_progress = false;
 	}
 
 	memset(&info, 0, sizeof(info));
@@ -510,6 +691,14 @@ pgss_shmem_startup(void)
 							  &info,
 							  HASH_ELEM | HASH_BLOBS);
 
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(pgssPlanNodeKey);
+	info.entrysize = sizeof(pgssPlanNodeEntry);
+	pgss_plan_nodes = ShmemInitHash("pg_stat_statements plan node hash",
+									pgss_max_plan_nodes, pgss_max_plan_nodes,
+									&info,
+									HASH_ELEM | HASH_BLOBS);
+
 	LWLockRelease(AddinShmemInitLock);
 
 	/*
@@ -840,6 +1029,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 				   0,
 				   0,
 				   NULL,
+				   NULL,
 				   &jstate);
 }
 
@@ -849,6 +1039,15 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 static void
 pgss_ExecutorStart(QueryDesc *queryDesc, int eflags)
 {
+	/*
+	 * To collect per-node statistics, ask for every plan node to be
+	 * instrumented.  This has to happen before the plan state tree is built.
+	 */
+	if (pgss_track_plan_nodes && pgss_enabled() &&
+		queryDesc->plannedstmt->queryId != UINT64CONST(0) &&
+		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		queryDesc->instrument_options |= INSTRUMENT_TIMER | INSTRUMENT_ROWS;
+
 	if (prev_ExecutorStart)
 		prev_ExecutorStart(queryDesc, eflags);
 	else
@@ -947,7 +1146,12 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 				   queryDesc->totaltime->total * 1000.0,	/* convert to msec */
 				   queryDesc->estate->es_processed,
 				   &queryDesc->totaltime->bufusage,
+				   &queryDesc->totaltime->walusage,
 				   NULL);
+
+		if (pgss_track_plan_nodes && queryDesc->planstate->instrument &&
+			(queryDesc->instrument_options & INSTRUMENT_TIMER))
+			pgss_store_plan_nodes(queryDesc);
 	}
 
 	if (prev_ExecutorEnd)
@@ -991,8 +1195,11 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 		uint64		rows;
 		BufferUsage bufusage_start,
 					bufusage;
+		WalUsage	walusage_start,
+					walusage;
 
 		bufusage_start = pgBufferUsage;
+		walusage_start = pgWalUsage;
 		INSTR_TIME_SET_CURRENT(start);
 
 		nested_level++;
@@ -1051,6 +1258,10 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 		bufusage.blk_write_time = pgBufferUsage.blk_write_time;
 		INSTR_TIME_SUBTRACT(bufusage.blk_write_time, bufusage_start.blk_write_time);
 
+		/* calc differences of WAL counters. */
+		memset(&walusage, 0, sizeof(WalUsage));
+		WalUsageAccumDiff(&walusage, &pgWalUsage, &walusage_start);
+
 		pgss_store(queryString,
 				   0,			/* signal that it's a utility stmt */
 				   pstmt->stmt_location,
@@ -1058,6 +1269,7 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 				   INSTR_TIME_GET_MILLISEC(duration),
 				   rows,
 				   &bufusage,
+				   &walusage,
 				   NULL);
 	}
 	else
@@ -1093,18 +1305,20 @@ pgss_hash_string(const char *str, int len)
  *
  * If jstate is not NULL then we're trying to create an entry for which
  * we have no statistics as yet; we just want to record the normalized
- * query string.  total_time, rows, bufusage are ignored in this case.
+ * query string.  total_time, rows, bufusage and walusage are ignored in this
+ * case.
  */
 static void
 pgss_store(const char *query, uint64 queryId,
 		   int query_location, int query_len,
 		   double total_time, uint64 rows,
 		   const BufferUsage *bufusage,
+		   const WalUsage *walusage,
 		   pgssJumbleState *jstate)
 {
 	pgssHashKey key;
-	pgssEntry  *entry;
-	char	   *norm_query = NULL;
+	pgssPendingEntry *entry;
+	bool		found;
 	int			encoding = GetDatabaseEncoding();
 
 	Assert(query != NULL);
@@ -1166,218 +1380,747 @@ pgss_store(const char *query, uint64 queryId,
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
 
-	/* Lookup the hash table entry with shared lock. */
-	LWLockAcquire(pgss->lock, LW_SHARED);
+	/* Set up the pending hashtable on first use */
+	if (pgss_pending == NULL)
+	{
+		HASHCTL		info;
+
+		if (pgss_pending_cxt == NULL)
+			pgss_pending_cxt = AllocSetContextCreate(TopMemoryContext,
+													 "pg_stat_statements pending",
+													 ALLOCSET_DEFAULT_SIZES);
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(pgssHashKey);
+		info.entrysize = sizeof(pgssPendingEntry);
+		info.hcxt = pgss_pending_cxt;
+		pgss_pending = hash_create("pg_stat_statements pending", 256,
+								   &info,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
 
-	entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_FIND, NULL);
+	if (!pgss_exit_registered)
+	{
+		before_shmem_exit(pgss_pending_shutdown, (Datum) 0);
+		pgss_exit_registered = true;
+	}
 
-	/* Create new entry, if not present */
-	if (!entry)
+	entry = (pgssPendingEntry *) hash_search(pgss_pending, &key, HASH_ENTER,
+											 &found);
+	if (!found)
 	{
-		Size		query_offset;
-		int			gc_count;
-		bool		stored;
-		bool		do_gc;
+		MemoryContext oldcxt = MemoryContextSwitchTo(pgss_pending_cxt);
+
+		memset(&entry->counters, 0, sizeof(Counters));
 
 		/*
-		 * Create a new, normalized query string if caller asked.  We don't
-		 * need to hold the lock while doing this work.  (Note: in any case,
-		 * it's possible that someone else creates a duplicate hashtable entry
-		 * in the interval where we don't hold the lock below.  That case is
-		 * handled by entry_alloc.)
+		 * Keep a copy of the query text, normalized if caller asked, in case
+		 * the shared entry turns out not to exist when we flush.
 		 */
 		if (jstate)
+			entry->query = generate_normalized_query(jstate, query,
+													 query_location,
+													 &query_len,
+													 encoding);
+		else
 		{
-			LWLockRelease(pgss->lock);
-			norm_query = generate_normalized_query(jstate, query,
-												   query_location,
-												   &query_len,
-												   encoding);
-			LWLockAcquire(pgss->lock, LW_SHARED);
+			entry->query = palloc(query_len + 1);
+			memcpy(entry->query, query, query_len);
+			entry->query[query_len] = '\0';
 		}
+		entry->query_len = query_len;
+		entry->encoding = encoding;
 
-		/* Append new query text to file with only shared lock held */
-		stored = qtext_store(norm_query ? norm_query : query, query_len,
-							 &query_offset, &gc_count);
-
-		/*
-		 * Determine whether we need to garbage collect external query texts
-		 * while the shared lock is still held.  This micro-optimization
-		 * avoids taking the time to decide this while holding exclusive lock.
-		 */
-		do_gc = need_gc_qtexts();
+		MemoryContextSwitchTo(oldcxt);
+	}
 
-		/* Need exclusive lock to make a new hashtable entry - promote */
-		LWLockRelease(pgss->lock);
-		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+	/*
+	 * Increment the counts, except when jstate is not NULL; that call comes
+	 * from parse analysis, so it's no time to flush either.
+	 */
+	if (!jstate)
+	{
+		pgss_count(&entry->counters, total_time, rows, bufusage, walusage);
+		pgss_flush_pending(false);
+	}
+}
 
+/*
+ * Add one execution to a set of counters.
+ */
+static void
+pgss_count(Counters *c, double total_time, uint64 rows,
+		   const BufferUsage *bufusage, const WalUsage *walusage)
+{
+	c->calls += 1;
+	c->total_time += total_time;
+	if (c->calls == 1)
+	{
+		c->min_time = total_time;
+		c->max_time = total_time;
+		c->mean_time = total_time;
+	}
+	else
+	{
 		/*
-		 * A garbage collection may have occurred while we weren't holding the
-		 * lock.  In the unlikely event that this happens, the query text we
-		 * stored above will have been garbage collected, so write it again.
-		 * This should be infrequent enough that doing it while holding
-		 * exclusive lock isn't a performance problem.
+		 * Welford's method for accurately computing variance. See
+		 * <http://www.johndcook.com/blog/standard_deviation/>
 		 */
-		if (!stored || pgss->gc_count != gc_count)
-			stored = qtext_store(norm_query ? norm_query : query, query_len,
-								 &query_offset, NULL);
-
-		/* If we failed to write to the text file, give up */
-		if (!stored)
-			goto done;
+		double		old_mean = c->mean_time;
 
-		/* OK to create a new hashtable entry */
-		entry = entry_alloc(&key, query_offset, query_len, encoding,
-							jstate != NULL);
+		c->mean_time += (total_time - old_mean) / c->calls;
+		c->sum_var_time += (total_time - old_mean) * (total_time - c->mean_time);
 
-		/* If needed, perform garbage collection while exclusive lock held */
-		if (do_gc)
-			gc_qtexts();
+		/* calculate min and max time */
+		if (c->min_time > total_time)
+			c->min_time = total_time;
+		if (c->max_time < total_time)
+			c->max_time = total_time;
 	}
+	c->rows += rows;
+	c->shared_blks_hit += bufusage->shared_blks_hit;
+	c->shared_blks_read += bufusage->shared_blks_read;
+	c->shared_blks_dirtied += bufusage->shared_blks_dirtied;
+	c->shared_blks_written += bufusage->shared_blks_written;
+	c->local_blks_hit += bufusage->local_blks_hit;
+	c->local_blks_read += bufusage->local_blks_read;
+	c->local_blks_dirtied += bufusage->local_blks_dirtied;
+	c->local_blks_written += bufusage->local_blks_written;
+	c->temp_blks_read += bufusage->temp_blks_read;
+	c->temp_blks_written += bufusage->temp_blks_written;
+	c->blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
+	c->blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
+	c->usage += USAGE_EXEC(total_time);
+	c->wal_records += walusage->wal_records;
+	c->wal_fpi += walusage->wal_fpi;
+	c->wal_bytes += walusage->wal_bytes;
+}
 
-	/* Increment the counts, except when jstate is not NULL */
-	if (!jstate)
+/*
+ * Add pending counters into a shared entry's counters.
+ *
+ * Caller must hold the entry's mutex.
+ */
+static void
+pgss_merge_counters(volatile Counters *dst, const Counters *src)
+{
+	if (src->calls == 0)
+		return;
+
+	if (dst->calls == 0)
+	{
+		/* "Unstick" entry if it was previously sticky */
+		dst->usage = USAGE_INIT;
+		dst->min_time = src->min_time;
+		dst->max_time = src->max_time;
+		dst->mean_time = src->mean_time;
+		dst->sum_var_time = src->sum_var_time;
+	}
+	else
 	{
 		/*
-		 * Grab the spinlock while updating the counters (see comment about
-		 * locking rules at the head of the file)
+		 * Combine the two means and sums of variances, as in Chan et al's
+		 * parallel variant of Welford's method.
 		 */
-		volatile pgssEntry *e = (volatile pgssEntry *) entry;
+		double		n1 = dst->calls;
+		double		n2 = src->calls;
+		double		delta = src->mean_time - dst->mean_time;
+
+		dst->mean_time += delta * n2 / (n1 + n2);
+		dst->sum_var_time += src->sum_var_time +
+			delta * delta * n1 * n2 / (n1 + n2);
+
+		/* calculate min and max time */
+		if (dst->min_time > src->min_time)
+			dst->min_time = src->min_time;
+		if (dst->max_time < src->max_time)
+			dst->max_time = src->max_time;
+	}
+	dst->calls += src->calls;
+	dst->total_time += src->total_time;
+	dst->rows += src->rows;
+	dst->shared_blks_hit += src->shared_blks_hit;
+	dst->shared_blks_read += src->shared_blks_read;
+	dst->shared_blks_dirtied += src->shared_blks_dirtied;
+	dst->shared_blks_written += src->shared_blks_written;
+	dst->local_blks_hit += src->local_blks_hit;
+	dst->local_blks_read += src->local_blks_read;
+	dst->local_blks_dirtied += src->local_blks_dirtied;
+	dst->local_blks_written += src->local_blks_written;
+	dst->temp_blks_read += src->temp_blks_read;
+	dst->temp_blks_written += src->temp_blks_written;
+	dst->blk_read_time += src->blk_read_time;
+	dst->blk_write_time += src->blk_write_time;
+	dst->usage += src->usage;
+	dst->wal_records += src->wal_records;
+	dst->wal_fpi += src->wal_fpi;
+	dst->wal_bytes += src->wal_bytes;
+}
+
+/*
+ * Add this backend's pending statistics to the shared hashtable.
+ *
+ * Unless force is true, this does nothing until flush_interval has passed
+ * since the last flush or there are many pending entries.
+ *
+ * Existing entries are updated under shared lock.  Query texts for entries
+ * that don't exist yet are written out under shared lock too, and then the
+ * entries are created together under a single exclusive lock.
+ */
+static void
+pgss_flush_pending(bool force)
+{
+	HASH_SEQ_STATUS hash_seq;
+	pgssPendingEntry *pending;
+	pgssEntry  *entry;
+	List	   *missing = NIL;
+	ListCell   *lc;
+	bool		do_gc = false;
 
-		SpinLockAcquire(&e->mutex);
+	if (pgss_pending == NULL || !pgss || !pgss_hash)
+		return;
 
-		/* "Unstick" entry if it was previously sticky */
-		if (e->counters.calls == 0)
-			e->counters.usage = USAGE_INIT;
+	if (!force)
+	{
+		TimestampTz now = GetCurrentTimestamp();
 
-		e->counters.calls += 1;
-		e->counters.total_time += total_time;
-		if (e->counters.calls == 1)
+		if (hash_get_num_entries(pgss_pending) < PGSS_MAX_PENDING &&
+			!TimestampDifferenceExceeds(pgss_last_flush, now,
+										pgss_flush_interval))
+			return;
+		pgss_last_flush = now;
+	}
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_pending);
+	while ((pending = hash_seq_search(&hash_seq)) != NULL)
+	{
+		entry = (pgssEntry *) hash_search(pgss_hash, &pending->key,
+										  HASH_FIND, NULL);
+		if (entry)
 		{
-			e->counters.min_time = total_time;
-			e->counters.max_time = total_time;
-			e->counters.mean_time = total_time;
+			/*
+			 * Grab the spinlock while updating the counters (see comment
+			 * about locking rules at the head of the file)
+			 */
+			volatile pgssEntry *e = (volatile pgssEntry *) entry;
+
+			SpinLockAcquire(&e->mutex);
+			pgss_merge_counters(&e->counters, &pending->counters);
+			SpinLockRelease(&e->mutex);
 		}
 		else
 		{
+			MemoryContext oldcxt;
+
+			/* Append new query text to file with only shared lock held */
+			pending->stored = qtext_store(pending->query, pending->query_len,
+										  &pending->query_offset,
+										  &pending->gc_count);
+			oldcxt = MemoryContextSwitchTo(pgss_pending_cxt);
+			missing = lappend(missing, pending);
+			MemoryContextSwitchTo(oldcxt);
+		}
+	}
+
+	/*
+	 * Determine whether we need to garbage collect external query texts
+	 * while the shared lock is still held.
+	 */
+	if (missing != NIL)
+		do_gc = need_gc_qtexts();
+
+	LWLockRelease(pgss->lock);
+
+	if (missing != NIL)
+	{
+		/* Need exclusive lock to make new hashtable entries */
+		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+
+		foreach(lc, missing)
+		{
+			volatile pgssEntry *e;
+
+			pending = (pgssPendingEntry *) lfirst(lc);
+
+			/*
+			 * A garbage collection may have occurred while we weren't holding
+			 * the lock.  In the unlikely event that this happens, the query
+			 * text we stored above will have been garbage collected, so write
+			 * it again.  This should be infrequent enough that doing it while
+			 * holding exclusive lock isn't a performance problem.
+			 */
+			if (!pending->stored || pgss->gc_count != pending->gc_count)
+				pending->stored = qtext_store(pending->query,
+											  pending->query_len,
+											  &pending->query_offset, NULL);
+
+			/* If we failed to write to the text file, give up */
+			if (!pending->stored)
+				continue;
+
 			/*
-			 * Welford's method for accurately computing variance. See
-			 * <http://www.johndcook.com/blog/standard_deviation/>
+			 * OK to create a new hashtable entry; it's sticky if all we have
+			 * is the text from parse analysis.
 			 */
-			double		old_mean = e->counters.mean_time;
-
-			e->counters.mean_time +=
-				(total_time - old_mean) / e->counters.calls;
-			e->counters.sum_var_time +=
-				(total_time - old_mean) * (total_time - e->counters.mean_time);
-
-			/* calculate min and max time */
-			if (e->counters.min_time > total_time)
-				e->counters.min_time = total_time;
-			if (e->counters.max_time < total_time)
-				e->counters.max_time = total_time;
+			entry = entry_alloc(&pending->key, pending->query_offset,
+								pending->query_len, pending->encoding,
+								pending->counters.calls == 0);
+
+			e = (volatile pgssEntry *) entry;
+			SpinLockAcquire(&e->mutex);
+			pgss_merge_counters(&e->counters, &pending->counters);
+			SpinLockRelease(&e->mutex);
 		}
-		e->counters.rows += rows;
-		e->counters.shared_blks_hit += bufusage->shared_blks_hit;
-		e->counters.shared_blks_read += bufusage->shared_blks_read;
-		e->counters.shared_blks_dirtied += bufusage->shared_blks_dirtied;
-		e->counters.shared_blks_written += bufusage->shared_blks_written;
-		e->counters.local_blks_hit += bufusage->local_blks_hit;
-		e->counters.local_blks_read += bufusage->local_blks_read;
-		e->counters.local_blks_dirtied += bufusage->local_blks_dirtied;
-		e->counters.local_blks_written += bufusage->local_blks_written;
-		e->counters.temp_blks_read += bufusage->temp_blks_read;
-		e->counters.temp_blks_written += bufusage->temp_blks_written;
-		e->counters.blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
-		e->counters.blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
-		e->counters.usage += USAGE_EXEC(total_time);
-
-		SpinLockRelease(&e->mutex);
+
+		LWLockRelease(pgss->lock);
 	}
 
-done:
-	LWLockRelease(pgss->lock);
+	/* Forget what we've flushed, including the list */
+	MemoryContextReset(pgss_pending_cxt);
+	pgss_pending = NULL;
 
-	/* We postpone this clean-up until we're out of the lock */
-	if (norm_query)
-		pfree(norm_query);
+	if (do_gc)
+		gc_qtexts();
 }
 
 /*
- * Reset statement statistics corresponding to userid, dbid, and queryid.
+ * Flush pending statistics before this backend exits.
  */
-Datum
-pg_stat_statements_reset_1_7(PG_FUNCTION_ARGS)
+static void
+pgss_pending_shutdown(int code, Datum arg)
 {
-	Oid			userid;
-	Oid			dbid;
-	uint64		queryid;
-
-	userid = PG_GETARG_OID(0);
-	dbid = PG_GETARG_OID(1);
-	queryid = (uint64) PG_GETARG_INT64(2);
-
-	entry_reset(userid, dbid, queryid);
+	/* Don't try if we're exiting out of the middle of a flush */
+	if (pgss && LWLockHeldByMe(pgss->lock))
+		return;
 
-	PG_RETURN_VOID();
+	pgss_flush_pending(true);
 }
 
 /*
- * Reset statement statistics.
+ * Add the per-node statistics of a finished execution to the shared
+ * plan node hashtable.
  */
-Datum
-pg_stat_statements_reset(PG_FUNCTION_ARGS)
+static void
+pgss_store_plan_nodes(QueryDesc *queryDesc)
 {
-	entry_reset(0, 0, 0);
+	pgssPlanNodeWalk walk;
+	pgssPlanNodeKey key;
+	pgssPlanNodeEntry *entry;
+	bool		need_insert = false;
+	int			i;
 
-	PG_RETURN_VOID();
-}
+	/* Safety check... */
+	if (!pgss || !pgss_plan_nodes)
+		return;
 
-/* Number of output arguments (columns) for various API versions */
-#define PG_STAT_STATEMENTS_COLS_V1_0	14
-#define PG_STAT_STATEMENTS_COLS_V1_1	18
-#define PG_STAT_STATEMENTS_COLS_V1_2	19
-#define PG_STAT_STATEMENTS_COLS_V1_3	23
-#define PG_STAT_STATEMENTS_COLS			23	/* maximum of above */
+	walk.rtable = queryDesc->plannedstmt->rtable;
+	walk.nsamples = 0;
+	walk.maxsamples = 16;
+	walk.samples = (pgssPlanNodeSample *)
+		palloc(walk.maxsamples * sizeof(pgssPlanNodeSample));
+	ExecWalkInstrumentation(queryDesc->planstate, pgss_collect_plan_node,
+							&walk);
+	if (walk.nsamples == 0)
+		return;
+
+	memset(&key, 0, sizeof(key));
+	key.userid = GetUserId();
+	key.dbid = MyDatabaseId;
+	key.queryid = queryDesc->plannedstmt->queryId;
+	key.planid = pgss_plan_fingerprint(queryDesc->plannedstmt);
+
+	/* Usually all the entries exist already, and a shared lock suffices */
+	LWLockAcquire(pgss->lock, LW_SHARED);
+	for (i = 0; i < walk.nsamples; i++)
+	{
+		pgssPlanNodeSample *sample = &walk.samples[i];
+
+		key.plan_node_id = sample->plan_node_id;
+		entry = (pgssPlanNodeEntry *) hash_search(pgss_plan_nodes, &key,
+												  HASH_FIND, NULL);
+		if (entry)
+			pgss_count_plan_node(entry, sample);
+		else
+			need_insert = true;
+	}
+	LWLockRelease(pgss->lock);
+
+	if (!need_insert)
+		return;
+
+	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+	for (i = 0; i < walk.nsamples; i++)
+	{
+		pgssPlanNodeSample *sample = &walk.samples[i];
+		bool		found;
+
+		if (sample->counted)
+			continue;
+
+		/*
+		 * Once the hashtable is full, nodes of new plans are not tracked.
+		 * Entries are only removed by pg_stat_statements_reset().
+		 */
+		key.plan_node_id = sample->plan_node_id;
+		entry = (pgssPlanNodeEntry *) hash_search(pgss_plan_nodes, &key,
+												  HASH_FIND, NULL);
+		if (!entry)
+		{
+			if (hash_get_num_entries(pgss_plan_nodes) >= pgss_max_plan_nodes)
+				continue;
+			entry = (pgssPlanNodeEntry *) hash_search(pgss_plan_nodes, &key,
+													  HASH_ENTER_NULL, &found);
+			if (!entry)
+				continue;
+			Assert(!found);
+
+			entry->parent_node_id = sample->parent_node_id;
+			entry->relid = sample->relid;
+			strlcpy(entry->node_type, sample->node_type, PGSS_NODE_TYPE_LEN);
+			entry->plan_rows = 0;
+			entry->executions = 0;
+			entry->loops = 0;
+			entry->rows = 0;
+			entry->total_time = 0;
+			SpinLockInit(&entry->mutex);
+		}
+		pgss_count_plan_node(entry, sample);
+	}
+	LWLockRelease(pgss->lock);
+}
 
 /*
- * Retrieve statement statistics.
- *
- * The SQL API of this function has changed multiple times, and will likely
- * do so again in future.  To support the case where a newer version of this
- * loadable module is being used with an old SQL declaration of the function,
- * we continue to support the older API versions.  For 1.2 and later, the
- * expected API version is identified by embedding it in the C name of the
- * function.  Unfortunately we weren't bright enough to do that for 1.1.
+ * ExecWalkInstrumentation callback: remember the statistics of one node.
  */
-Datum
-pg_stat_statements_1_3(PG_FUNCTION_ARGS)
+static void
+pgss_collect_plan_node(PlanState *node, PlanState *parent, void *arg)
 {
-	bool		showtext = PG_GETARG_BOOL(0);
+	pgssPlanNodeWalk *walk = (pgssPlanNodeWalk *) arg;
+	Plan	   *plan = node->plan;
+	Instrumentation *instr = node->instrument;
+	pgssPlanNodeSample *sample;
 
-	pg_stat_statements_internal(fcinfo, PGSS_V1_3, showtext);
+	/* Nodes that weren't run during this execution are not counted */
+	if (instr->nloops <= 0)
+		return;
 
-	return (Datum) 0;
+	if (walk->nsamples >= walk->maxsamples)
+	{
+		walk->maxsamples *= 2;
+		walk->samples = (pgssPlanNodeSample *)
+			repalloc(walk->samples,
+					 walk->maxsamples * sizeof(pgssPlanNodeSample));
+	}
+
+	sample = &walk->samples[walk->nsamples++];
+	sample->plan_node_id = plan->plan_node_id;
+	sample->parent_node_id = parent ? parent->plan->plan_node_id : -1;
+	sample->relid = pgss_plan_node_relid(plan, walk->rtable);
+	sample->node_type = pgss_plan_node_name(plan);
+	sample->plan_rows = plan->plan_rows;
+	sample->loops = instr->nloops;
+	sample->rows = instr->ntuples;
+	sample->total_time = instr->total * 1000.0;	/* convert to msec */
+	sample->counted = false;
 }
 
-Datum
-pg_stat_statements_1_2(PG_FUNCTION_ARGS)
+/*
+ * Add one execution's statistics to a plan node entry.
+ * Caller must hold pgss->lock.
+ */
+static void
+pgss_count_plan_node(pgssPlanNodeEntry *entry, pgssPlanNodeSample *sample)
 {
-	bool		showtext = PG_GETARG_BOOL(0);
+	volatile pgssPlanNodeEntry *e = (volatile pgssPlanNodeEntry *) entry;
 
-	pg_stat_statements_internal(fcinfo, PGSS_V1_2, showtext);
+	SpinLockAcquire(&e->mutex);
+	e->plan_rows = sample->plan_rows;
+	e->executions += 1;
+	e->loops += (int64) sample->loops;
+	e->rows += (int64) sample->rows;
+	e->total_time += sample->total_time;
+	SpinLockRelease(&e->mutex);
 
-	return (Datum) 0;
+	sample->counted = true;
 }
 
 /*
- * Legacy entry point for pg_stat_statements() API versions 1.0 and 1.1.
- * This can be removed someday, perhaps.
+ * Compute a fingerprint of the shape of a plan: which nodes it has, the
+ * relations and indexes they scan, and their join and aggregation
+ * strategies.  Costs and row estimates are left out, so that a plan keeps
+ * its fingerprint when only the statistics it was based on change.
  */
-Datum
-pg_stat_statements(PG_FUNCTION_ARGS)
+static uint64
+pgss_plan_fingerprint(PlannedStmt *stmt)
 {
-	/* If it's really API 1.1, we'll figure that out below */
+	pgssJumbleState jstate;
+	ListCell   *lc;
+	uint64		planid;
+
+	jstate.jumble = (unsigned char *) palloc(JUMBLE_SIZE);
+	jstate.jumble_len = 0;
+	jstate.clocations_buf_size = 0;
+	jstate.clocations = NULL;
+	jstate.clocations_count = 0;
+	jstate.highest_extern_param_id = 0;
+
+	JumblePlan(&jstate, stmt->planTree, stmt->rtable);
+	foreach(lc, stmt->subplans)
+		JumblePlan(&jstate, (Plan *) lfirst(lc), stmt->rtable);
+
+	planid = DatumGetUInt64(hash_any_extended(jstate.jumble,
+											  jstate.jumble_len, 0));
+	pfree(jstate.jumble);
+
+	return planid;
+}
+
+/*
+ * Return the OID of the relation, or index for a bitmap index scan, that a
+ * plan node scans or modifies, or InvalidOid if none.
+ */
+static Oid
+pgss_plan_node_relid(Plan *plan, List *rtable)
+{
+	Index		rti;
+	RangeTblEntry *rte;
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_TidRangeScan:
+		case T_ForeignScan:
+		case T_CustomScan:
+			rti = ((Scan *) plan)->scanrelid;
+			break;
+		case T_ModifyTable:
+			rti = ((ModifyTable *) plan)->nominalRelation;
+			break;
+		case T_BitmapIndexScan:
+			return ((BitmapIndexScan *) plan)->indexid;
+		default:
+			return InvalidOid;
+	}
+
+	if (rti == 0)
+		return InvalidOid;
+	rte = rt_fetch(rti, rtable);
+	return rte->rtekind == RTE_RELATION ? rte->relid : InvalidOid;
+}
+
+/*
+ * Return the name EXPLAIN uses for a plan node, without the details it
+ * adds such as the join type.
+ */
+static const char *
+pgss_plan_node_name(Plan *plan)
+{
+	switch (nodeTag(plan))
+	{
+		case T_Result:
+			return "Result";
+		case T_ProjectSet:
+			return "ProjectSet";
+		case T_ModifyTable:
+			switch (((ModifyTable *) plan)->operation)
+			{
+				case CMD_INSERT:
+					return "Insert";
+				case CMD_UPDATE:
+					return "Update";
+				case CMD_DELETE:
+					return "Delete";
+				default:
+					return "ModifyTable";
+			}
+		case T_Append:
+			return "Append";
+		case T_MergeAppend:
+			return "Merge Append";
+		case T_RecursiveUnion:
+			return "Recursive Union";
+		case T_BitmapAnd:
+			return "BitmapAnd";
+		case T_BitmapOr:
+			return "BitmapOr";
+		case T_NestLoop:
+			return "Nested Loop";
+		case T_MergeJoin:
+			return "Merge Join";
+		case T_HashJoin:
+			return "Hash Join";
+		case T_SeqScan:
+			return "Seq Scan";
+		case T_SampleScan:
+			return "Sample Scan";
+		case T_Gather:
+			return "Gather";
+		case T_GatherMerge:
+			return "Gather Merge";
+		case T_Repartition:
+			return ((Repartition *) plan)->exchange ? "Exchange" : "Repartition";
+		case T_IndexScan:
+			return "Index Scan";
+		case T_IndexOnlyScan:
+			return "Index Only Scan";
+		case T_BitmapIndexScan:
+			return "Bitmap Index Scan";
+		case T_BitmapHeapScan:
+			return "Bitmap Heap Scan";
+		case T_TidScan:
+			return "Tid Scan";
+		case T_TidRangeScan:
+			return "Tid Range Scan";
+		case T_SubqueryScan:
+			return "Subquery Scan";
+		case T_FunctionScan:
+			return "Function Scan";
+		case T_TableFuncScan:
+			return "Table Function Scan";
+		case T_ValuesScan:
+			return "Values Scan";
+		case T_CteScan:
+			return "CTE Scan";
+		case T_NamedTuplestoreScan:
+			return "Named Tuplestore Scan";
+		case T_WorkTableScan:
+			return "WorkTable Scan";
+		case T_ForeignScan:
+			return "Foreign Scan";
+		case T_CustomScan:
+			return "Custom Scan";
+		case T_Material:
+			return "Materialize";
+		case T_ResultCache:
+			return "Result Cache";
+		case T_Sort:
+			return "Sort";
+		case T_IncrementalSort:
+			return "Incremental Sort";
+		case T_Group:
+			return "Group";
+		case T_Agg:
+			switch (((Agg *) plan)->aggstrategy)
+			{
+				case AGG_SORTED:
+					return "GroupAggregate";
+				case AGG_HASHED:
+					return "HashAggregate";
+				case AGG_MIXED:
+					return "MixedAggregate";
+				default:
+					return "Aggregate";
+			}
+		case T_WindowAgg:
+			return "WindowAgg";
+		case T_Unique:
+			return "Unique";
+		case T_SetOp:
+			return ((SetOp *) plan)->strategy == SETOP_HASHED ?
+				"HashSetOp" : "SetOp";
+		case T_LockRows:
+			return "LockRows";
+		case T_Limit:
+			return "Limit";
+		case T_Hash:
+			return "Hash";
+		default:
+			return "???";
+	}
+}
+
+/*
+ * Reset statement statistics corresponding to userid, dbid, and queryid.
+ */
+Datum
+pg_stat_statements_reset_1_7(PG_FUNCTION_ARGS)
+{
+	Oid			userid;
+	Oid			dbid;
+	uint64		queryid;
+
+	userid = PG_GETARG_OID(0);
+	dbid = PG_GETARG_OID(1);
+	queryid = (uint64) PG_GETARG_INT64(2);
+
+	entry_reset(userid, dbid, queryid);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Reset statement statistics.
+ */
+Datum
+pg_stat_statements_reset(PG_FUNCTION_ARGS)
+{
+	entry_reset(0, 0, 0);
+
+	PG_RETURN_VOID();
+}
+
+/* Number of output arguments (columns) for various API versions */
+#define PG_STAT_STATEMENTS_COLS_V1_0	14
+#define PG_STAT_STATEMENTS_COLS_V1_1	18
+#define PG_STAT_STATEMENTS_COLS_V1_2	19
+#define PG_STAT_STATEMENTS_COLS_V1_3	23
+#define PG_STAT_STATEMENTS_COLS_V1_8	26
+#define PG_STAT_STATEMENTS_COLS			26	/* maximum of above */
+
+/*
+ * Retrieve statement statistics.
+ *
+ * The SQL API of this function has changed multiple times, and will likely
+ * do so again in future.  To support the case where a newer version of this
+ * loadable module is being used with an old SQL declaration of the function,
+ * we continue to support the older API versions.  For 1.2 and later, the
+ * expected API version is identified by embedding it in the C name of the
+ * function.  Unfortunately we weren't bright enough to do that for 1.1.
+ */
+Datum
+pg_stat_statements_1_8(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_8, showtext);
+
+	return (Datum) 0;
+}
+
+Datum
+pg_stat_statements_1_3(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_3, showtext);
+
+	return (Datum) 0;
+}
+
+Datum
+pg_stat_statements_1_2(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_2, showtext);
+
+	return (Datum) 0;
+}
+
+/*
+ * Legacy entry point for pg_stat_statements() API versions 1.0 and 1.1.
+ * This can be removed someday, perhaps.
+ */
+Datum
+pg_stat_statements(PG_FUNCTION_ARGS)
+{
+	/* If it's really API 1.1, we'll figure that out below */
 	pg_stat_statements_internal(fcinfo, PGSS_V1_0, true);
 
 	return (Datum) 0;
@@ -1412,6 +2155,9 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
 
+	/* Make sure our own statistics are included */
+	pgss_flush_pending(true);
+
 	/* check to see if caller supports us returning a tuplestore */
 	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
 		ereport(ERROR,
@@ -1456,6 +2202,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_3)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_8:
+			if (api_version != PGSS_V1_8)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1652,11 +2402,29 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			values[i++] = Float8GetDatumFast(tmp.blk_read_time);
 			values[i++] = Float8GetDatumFast(tmp.blk_write_time);
 		}
+		if (api_version >= PGSS_V1_8)
+		{
+			char		buf[256];
+			Datum		wal_bytes;
+
+			values[i++] = Int64GetDatumFast(tmp.wal_records);
+			values[i++] = Int64GetDatumFast(tmp.wal_fpi);
+
+			snprintf(buf, sizeof buf, UINT64_FORMAT, tmp.wal_bytes);
+
+			/* Convert to numeric. */
+			wal_bytes = DirectFunctionCall3(numeric_in,
+											CStringGetDatum(buf),
+											ObjectIdGetDatum(0),
+											Int32GetDatum(-1));
+			values[i++] = wal_bytes;
+		}
 
 		Assert(i == (api_version == PGSS_V1_0 ? PG_STAT_STATEMENTS_COLS_V1_0 :
 					 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
 					 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
 					 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
+					 api_version == PGSS_V1_8 ? PG_STAT_STATEMENTS_COLS_V1_8 :
 					 -1 /* fail if you forget to update this assert */ ));
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
@@ -1671,6 +2439,127 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	tuplestore_donestoring(tupstore);
 }
 
+#define PG_STAT_STATEMENTS_PLAN_NODES_COLS	13
+
+/*
+ * Retrieve per-plan-node statistics.
+ */
+Datum
+pg_stat_statements_plan_nodes(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	Oid			userid = GetUserId();
+	bool		is_allowed_role;
+	HASH_SEQ_STATUS hash_seq;
+	pgssPlanNodeEntry *entry;
+
+	/* Superusers or members of pg_read_all_stats members are allowed */
+	is_allowed_role = is_member_of_role(userid, DEFAULT_ROLE_READ_ALL_STATS);
+
+	/* hash table must exist already */
+	if (!pgss || !pgss_plan_nodes)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Switch into long-lived context to construct returned data structures */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	if (tupdesc->natts != PG_STAT_STATEMENTS_PLAN_NODES_COLS)
+		elog(ERROR, "incorrect number of output arguments");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_plan_nodes);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[PG_STAT_STATEMENTS_PLAN_NODES_COLS];
+		bool		nulls[PG_STAT_STATEMENTS_PLAN_NODES_COLS];
+		int			i = 0;
+		double		plan_rows;
+		int64		executions;
+		int64		loops;
+		int64		rows;
+		double		total_time;
+
+		/* Unlike query texts, other users' plans are not shown at all */
+		if (!is_allowed_role && entry->key.userid != userid)
+			continue;
+
+		/* copy counters to a local variable to keep locking time short */
+		{
+			volatile pgssPlanNodeEntry *e = (volatile pgssPlanNodeEntry *) entry;
+
+			SpinLockAcquire(&e->mutex);
+			plan_rows = e->plan_rows;
+			executions = e->executions;
+			loops = e->loops;
+			rows = e->rows;
+			total_time = e->total_time;
+			SpinLockRelease(&e->mutex);
+		}
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		values[i++] = ObjectIdGetDatum(entry->key.userid);
+		values[i++] = ObjectIdGetDatum(entry->key.dbid);
+		values[i++] = Int64GetDatum((int64) entry->key.queryid);
+		values[i++] = Int64GetDatum((int64) entry->key.planid);
+		values[i++] = Int32GetDatum(entry->key.plan_node_id);
+		if (entry->parent_node_id >= 0)
+			values[i++] = Int32GetDatum(entry->parent_node_id);
+		else
+			nulls[i++] = true;
+		values[i++] = CStringGetTextDatum(entry->node_type);
+		if (OidIsValid(entry->relid))
+			values[i++] = ObjectIdGetDatum(entry->relid);
+		else
+			nulls[i++] = true;
+		values[i++] = Float8GetDatumFast(plan_rows);
+		values[i++] = Int64GetDatumFast(executions);
+		values[i++] = Int64GetDatumFast(loops);
+		values[i++] = Int64GetDatumFast(rows);
+		values[i++] = Float8GetDatumFast(total_time);
+
+		Assert(i == PG_STAT_STATEMENTS_PLAN_NODES_COLS);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(pgss->lock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 /*
  * Estimate shared memory space needed.
  */
@@ -1681,6 +2570,8 @@ pgss_memsize(void)
 
 	size = MAXALIGN(sizeof(pgssSharedState));
 	size = add_size(size, hash_estimate_size(pgss_max, sizeof(pgssEntry)));
+	size = add_size(size, hash_estimate_size(pgss_max_plan_nodes,
+											 sizeof(pgssPlanNodeEntry)));
 
 	return size;
 }
@@ -2071,7 +2962,14 @@ need_gc_qtexts(void)
  * becomes unreasonably large, with no other method of compaction likely to
  * occur in the foreseeable future.
  *
- * The caller must hold an exclusive lock on pgss->lock.
+ * The caller must not hold pgss->lock.  The live texts are copied to a new
+ * file while holding only shared lock, which keeps the hashtable from
+ * changing underneath us but doesn't stop other backends from updating
+ * counters or appending texts.  Then we take exclusive lock just long enough
+ * to repoint the entries, copy the texts of any entries that were created in
+ * the meantime, and rename the new file into place.  This needs disk space
+ * for both files for a while, but we no longer make every backend wait for
+ * the whole file to be read and rewritten.
  *
  * At the first sign of trouble we unlink the query text file to get a clean
  * slate (although existing statistics are retained), rather than risk
@@ -2080,21 +2978,46 @@ need_gc_qtexts(void)
 static void
 gc_qtexts(void)
 {
-	char	   *qbuffer;
+	char	   *qbuffer = NULL;
 	Size		qbuffer_size;
 	FILE	   *qfile = NULL;
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry  *entry;
+	pgssTextMove *moves = NULL;
+	int			nmoves = 0;
 	Size		extent;
 	int			nentries;
+	int			gc_count;
+	int			fd = -1;
+	bool		failed = false;
+
+	/* Only one backend needs to do this at a time */
+	{
+		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+		bool		busy;
+
+		SpinLockAcquire(&s->mutex);
+		busy = s->gc_in_progress;
+		s->gc_in_progress = true;
+		gc_count = s->gc_count;
+		SpinLockRelease(&s->mutex);
+
+		if (busy)
+			return;
+	}
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
 
 	/*
-	 * When called from pgss_store, some other session might have proceeded
-	 * with garbage collection in the no-lock-held interim of lock strength
-	 * escalation.  Check once more that this is actually necessary.
+	 * Some other session might have completed a garbage collection since our
+	 * caller decided one was needed.  Check once more that this is actually
+	 * necessary.
 	 */
 	if (!need_gc_qtexts())
-		return;
+	{
+		LWLockRelease(pgss->lock);
+		goto done;
+	}
 
 	/*
 	 * Load the old texts file.  If we fail (out of memory, for instance),
@@ -2104,30 +3027,24 @@ gc_qtexts(void)
 	 * risky and can easily lead to complete denial of service.
 	 */
 	qbuffer = qtext_load_file(&qbuffer_size);
-	if (qbuffer == NULL)
-		goto gc_fail;
-
-	/*
-	 * We overwrite the query texts file in place, so as to reduce the risk of
-	 * an out-of-disk-space failure.  Since the file is guaranteed not to get
-	 * larger, this should always work on traditional filesystems; though we
-	 * could still lose on copy-on-write filesystems.
-	 */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
-	if (qfile == NULL)
+	moves = (pgssTextMove *)
+		malloc(Max(hash_get_num_entries(pgss_hash), 1) * sizeof(pgssTextMove));
+	qfile = AllocateFile(PGSS_TEXT_TMP_FILE, PG_BINARY_W);
+	if (qbuffer == NULL || moves == NULL || qfile == NULL)
 	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		goto gc_fail;
+		if (qfile == NULL)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not write file \"%s\": %m",
+							PGSS_TEXT_TMP_FILE)));
+		failed = true;
 	}
 
 	extent = 0;
 	nentries = 0;
 
 	hash_seq_init(&hash_seq, pgss_hash);
-	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	while (!failed && (entry = hash_seq_search(&hash_seq)) != NULL)
 	{
 		int			query_len = entry->query_len;
 		char	   *qry = qtext_fetch(entry->query_offset,
@@ -2135,9 +3052,90 @@ gc_qtexts(void)
 									  qbuffer,
 									  qbuffer_size);
 
+		/* If that failed, we'll try again below */
 		if (qry == NULL)
+			continue;
+
+		if (fwrite(qry, 1, query_len + 1, qfile) != query_len + 1)
+		{
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not write file \"%s\": %m",
+							PGSS_TEXT_TMP_FILE)));
+			hash_seq_term(&hash_seq);
+			failed = true;
+			break;
+		}
+
+		moves[nmoves].old_offset = entry->query_offset;
+		moves[nmoves].new_offset = extent;
+		nmoves++;
+		extent += query_len + 1;
+		nentries++;
+	}
+
+	LWLockRelease(pgss->lock);
+
+	if (qbuffer)
+		free(qbuffer);
+	qbuffer = NULL;
+
+	if (!failed)
+		qsort(moves, nmoves, sizeof(pgssTextMove), text_move_cmp);
+
+	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+
+	/*
+	 * If the file was reset or compacted while we weren't holding the lock,
+	 * our copy is stale; just throw it away.
+	 */
+	if (pgss->gc_count != gc_count)
+	{
+		LWLockRelease(pgss->lock);
+		if (qfile)
+			FreeFile(qfile);
+		(void) unlink(PGSS_TEXT_TMP_FILE);
+		goto done;
+	}
+
+	if (failed)
+		goto gc_fail;
+
+	/*
+	 * Repoint every entry into the new file.  Entries whose texts we didn't
+	 * copy above were created since, or had texts we failed to fetch; read
+	 * those texts individually from the old file.
+	 */
+	hash_seq_init(&hash_seq, pgss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		pgssTextMove key;
+		pgssTextMove *move;
+		char	   *qry;
+		int			query_len = entry->query_len;
+
+		if (query_len < 0)
+			continue;
+
+		key.old_offset = entry->query_offset;
+		move = bsearch(&key, moves, nmoves, sizeof(pgssTextMove),
+					   text_move_cmp);
+		if (move)
+		{
+			entry->query_offset = move->new_offset;
+			continue;
+		}
+
+		if (fd < 0)
+			fd = OpenTransientFile(PGSS_TEXT_FILE, O_RDONLY | PG_BINARY);
+		qry = (fd < 0) ? NULL : malloc(query_len + 1);
+		if (qry == NULL ||
+			pg_pread(fd, qry, query_len + 1, entry->query_offset) != query_len + 1 ||
+			qry[query_len] != '\0')
 		{
 			/* Trouble ... drop the text */
+			if (qry)
+				free(qry);
 			entry->query_offset = 0;
 			entry->query_len = -1;
 			/* entry will not be counted in mean query length computation */
@@ -2149,35 +3147,41 @@ gc_qtexts(void)
 			ereport(LOG,
 					(errcode_for_file_access(),
 					 errmsg("could not write file \"%s\": %m",
-							PGSS_TEXT_FILE)));
+							PGSS_TEXT_TMP_FILE)));
+			free(qry);
 			hash_seq_term(&hash_seq);
 			goto gc_fail;
 		}
+		free(qry);
 
 		entry->query_offset = extent;
 		extent += query_len + 1;
 		nentries++;
 	}
 
-	/*
-	 * Truncate away any now-unused space.  If this fails for some odd reason,
-	 * we log it, but there's no need to fail.
-	 */
-	if (ftruncate(fileno(qfile), extent) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not truncate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
+	if (fd >= 0)
+		CloseTransientFile(fd);
+	fd = -1;
 
 	if (FreeFile(qfile))
 	{
 		ereport(LOG,
 				(errcode_for_file_access(),
 				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
+						PGSS_TEXT_TMP_FILE)));
 		qfile = NULL;
 		goto gc_fail;
 	}
+	qfile = NULL;
+
+	if (rename(PGSS_TEXT_TMP_FILE, PGSS_TEXT_FILE) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename file \"%s\" to \"%s\": %m",
+						PGSS_TEXT_TMP_FILE, PGSS_TEXT_FILE)));
+		goto gc_fail;
+	}
 
 	elog(DEBUG1, "pgss gc of queries file shrunk size from %zu to %zu",
 		 pgss->extent, extent);
@@ -2194,25 +3198,54 @@ gc_qtexts(void)
 	else
 		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
 
-	free(qbuffer);
-
 	/*
 	 * OK, count a garbage collection cycle.  (Note: even though we have
 	 * exclusive lock on pgss->lock, we must take pgss->mutex for this, since
 	 * other processes may examine gc_count while holding only the mutex.
-	 * Also, we have to advance the count *after* we've rewritten the file,
-	 * else other processes might not realize they read a stale file.)
+	 * Also, we have to advance the count *after* we've switched files, else
+	 * other processes might not realize they read a stale file.)
 	 */
 	record_gc_qtexts();
 
-	return;
+	LWLockRelease(pgss->lock);
+	goto done;
 
 gc_fail:
 	/* clean up resources */
+	if (fd >= 0)
+		CloseTransientFile(fd);
 	if (qfile)
 		FreeFile(qfile);
-	if (qbuffer)
-		free(qbuffer);
+	(void) unlink(PGSS_TEXT_TMP_FILE);
+
+	gc_qtexts_fail();
+
+	LWLockRelease(pgss->lock);
+
+done:
+	if (moves)
+		free(moves);
+
+	{
+		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+
+		SpinLockAcquire(&s->mutex);
+		s->gc_in_progress = false;
+		SpinLockRelease(&s->mutex);
+	}
+}
+
+/*
+ * Give up on the external query text file after a failed garbage collection.
+ *
+ * The caller must hold an exclusive lock on pgss->lock.
+ */
+static void
+gc_qtexts_fail(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	pgssEntry  *entry;
+	FILE	   *qfile;
 
 	/*
 	 * Since the contents of the external file are now uncertain, mark all
@@ -2258,6 +3291,23 @@ gc_fail:
 	record_gc_qtexts();
 }
 
+/*
+ * qsort/bsearch comparator for pgssTextMove, by old offset
+ */
+static int
+text_move_cmp(const void *lhs, const void *rhs)
+{
+	Size		l = ((const pgssTextMove *) lhs)->old_offset;
+	Size		r = ((const pgssTextMove *) rhs)->old_offset;
+
+	if (l < r)
+		return -1;
+	else if (l > r)
+		return +1;
+	else
+		return 0;
+}
+
 /*
  * Release entries corresponding to parameters passed.
  */
@@ -2266,6 +3316,7 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 {
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry  *entry;
+	pgssPlanNodeEntry *node;
 	FILE	   *qfile;
 	long		num_entries;
 	long		num_remove = 0;
@@ -2276,6 +3327,9 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
 
+	/* Flush first, so that our own pending statistics are reset too */
+	pgss_flush_pending(true);
+
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 	num_entries = hash_get_num_entries(pgss_hash);
 
@@ -2317,6 +3371,16 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 		}
 	}
 
+	/* Plan node statistics go along with those of their statements */
+	hash_seq_init(&hash_seq, pgss_plan_nodes);
+	while ((node = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if ((!userid || node->key.userid == userid) &&
+			(!dbid || node->key.dbid == dbid) &&
+			(!queryid || node->key.queryid == queryid))
+			hash_search(pgss_plan_nodes, &node->key, HASH_REMOVE, NULL);
+	}
+
 	/* All entries are removed? */
 	if (num_entries != num_remove)
 		goto release_lock;
@@ -2399,6 +3463,81 @@ AppendJumble(pgssJumbleState *jstate, const unsigned char *item, Size size)
 #define APP_JUMB_STRING(str) \
 	AppendJumble(jstate, (const unsigned char *) (str), strlen(str) + 1)
 
+/*
+ * JumblePlan: Serialize the shape of a plan tree for pgss_plan_fingerprint.
+ */
+static void
+JumblePlan(pgssJumbleState *jstate, Plan *plan, List *rtable)
+{
+	ListCell   *lc;
+	Oid			relid;
+
+	if (plan == NULL)
+		return;
+
+	/* Guard against stack overflow due to overly complex plans */
+	check_stack_depth();
+
+	APP_JUMB(plan->type);
+	APP_JUMB(plan->plan_node_id);
+	relid = pgss_plan_node_relid(plan, rtable);
+	APP_JUMB(relid);
+
+	switch (nodeTag(plan))
+	{
+		case T_IndexScan:
+			APP_JUMB(((IndexScan *) plan)->indexid);
+			break;
+		case T_IndexOnlyScan:
+			APP_JUMB(((IndexOnlyScan *) plan)->indexid);
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			APP_JUMB(((Join *) plan)->jointype);
+			break;
+		case T_Agg:
+			APP_JUMB(((Agg *) plan)->aggstrategy);
+			APP_JUMB(((Agg *) plan)->aggsplit);
+			break;
+		case T_SetOp:
+			APP_JUMB(((SetOp *) plan)->strategy);
+			break;
+		case T_ModifyTable:
+			foreach(lc, ((ModifyTable *) plan)->plans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_Append:
+			foreach(lc, ((Append *) plan)->appendplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_MergeAppend:
+			foreach(lc, ((MergeAppend *) plan)->mergeplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_BitmapAnd:
+			foreach(lc, ((BitmapAnd *) plan)->bitmapplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_BitmapOr:
+			foreach(lc, ((BitmapOr *) plan)->bitmapplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_SubqueryScan:
+			JumblePlan(jstate, ((SubqueryScan *) plan)->subplan, rtable);
+			break;
+		case T_CustomScan:
+			foreach(lc, ((CustomScan *) plan)->custom_plans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		default:
+			break;
+	}
+
+	JumblePlan(jstate, plan->lefttree, rtable);
+	JumblePlan(jstate, plan->righttree, rtable);
+}
+
 /*
  * JumbleQuery: Selectively serialize the query tree, appending significant
  * data to the "query jumble" while ignoring nonsignificant data.
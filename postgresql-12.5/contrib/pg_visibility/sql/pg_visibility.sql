@@ -72,6 +72,22 @@ select count(*) > 0 from pg_visibility_map_summary('test_partition');
 select * from pg_check_frozen('test_partition'); -- hopefully none
 select pg_truncate_visibility_map('test_partition');
 
+-- COPY FREEZE marks the pages it fills all-visible and all-frozen
+begin;
+create table copyfreeze (a int, b char(1500));
+copy copyfreeze from stdin freeze;
+1	a
+2	b
+3	c
+4	d
+5	e
+6	f
+7	g
+\.
+commit;
+select * from pg_visibility_map('copyfreeze');
+select * from pg_check_frozen('copyfreeze');
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -81,3 +97,4 @@ drop server dummy_server;
 drop foreign data wrapper dummy;
 drop materialized view matview_visibility_test;
 drop table regular_table;
+drop table copyfreeze;
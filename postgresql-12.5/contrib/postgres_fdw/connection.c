@@ -58,6 +58,7 @@ typedef struct ConnCacheEntry
 	bool		invalidated;	/* true if reconnect is pending */
 	uint32		server_hashvalue;	/* hash value of foreign server OID */
 	uint32		mapping_hashvalue;	/* hash value of user mapping OID */
+	PgFdwConnState state;		/* extra per-connection state */
 } ConnCacheEntry;
 
 /*
@@ -102,9 +103,13 @@ static bool pgfdw_get_cleanup_result(PGconn *conn, TimestampTz endtime,
  * will_prep_stmt must be true if caller intends to create any prepared
  * statements.  Since those don't go away automatically at transaction end
  * (not even on error), we need this flag to cue manual cleanup.
+ *
+ * If state is not NULL, *state receives the per-connection state associated
+ * with the PGconn.  Callers that pass NULL get a connection with no
+ * asynchronous FETCH pending on it.
  */
 PGconn *
-GetConnection(UserMapping *user, bool will_prep_stmt)
+GetConnection(UserMapping *user, bool will_prep_stmt, PgFdwConnState **state)
 {
 	bool		found;
 	ConnCacheEntry *entry;
@@ -190,6 +195,7 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 		entry->have_error = false;
 		entry->changing_xact_state = false;
 		entry->invalidated = false;
+		memset(&entry->state, 0, sizeof(entry->state));
 		entry->server_hashvalue =
 			GetSysCacheHashValue1(FOREIGNSERVEROID,
 								  ObjectIdGetDatum(server->serverid));
@@ -204,6 +210,16 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 			 entry->conn, server->servername, user->umid, user->userid);
 	}
 
+	/*
+	 * Collect the result of any asynchronous FETCH still in progress, if we
+	 * are about to issue commands on the connection ourselves or the caller
+	 * isn't prepared to deal with it.
+	 */
+	if (entry->state.pending_scan != NULL &&
+		(state == NULL ||
+		 entry->xact_depth < GetCurrentTransactionNestLevel()))
+		process_pending_request(&entry->state);
+
 	/*
 	 * Start a new transaction or subtransaction if needed.
 	 */
@@ -212,6 +228,9 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 	/* Remember if caller will prepare statements */
 	entry->have_prep_stmt |= will_prep_stmt;
 
+	if (state)
+		*state = &entry->state;
+
 	return entry->conn;
 }
 
@@ -674,6 +693,13 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 		if (entry->conn == NULL)
 			continue;
 
+		/*
+		 * Scans are gone by now, so forget any FETCH one of them left
+		 * pending; the abort processing below cancels it if necessary.
+		 */
+		entry->state.pending_scan = NULL;
+		entry->state.snapshot_imported = false;
+
 		/* If it has an open remote transaction, try to close it */
 		if (entry->xact_depth > 0)
 		{
@@ -902,6 +928,9 @@ pgfdw_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
 		{
 			bool		abort_cleanup_failure = false;
 
+			/* Any FETCH pending on the connection is cancelled below */
+			entry->state.pending_scan = NULL;
+
 			/* Remember that abort cleanup is in progress. */
 			entry->changing_xact_state = true;
 
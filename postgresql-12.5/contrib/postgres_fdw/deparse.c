@@ -118,6 +118,7 @@ typedef struct deparse_expr_cxt
 static bool foreign_expr_walker(Node *node,
 								foreign_glob_cxt *glob_cxt,
 								foreign_loc_cxt *outer_cxt);
+static bool partial_agg_ok(Aggref *agg);
 static char *deparse_type_name(Oid type_oid, int32 typemod);
 
 /*
@@ -701,8 +702,14 @@ foreign_expr_walker(Node *node,
 				if (!IS_UPPER_REL(glob_cxt->foreignrel))
 					return false;
 
-				/* Only non-split aggregates are pushable. */
-				if (agg->aggsplit != AGGSPLIT_SIMPLE)
+				/*
+				 * Only non-split aggregates are pushable, except that the
+				 * partial step of an aggregate whose result is its own
+				 * partial state can be computed by a plain remote call.
+				 */
+				if (agg->aggsplit != AGGSPLIT_SIMPLE &&
+					!(agg->aggsplit == AGGSPLIT_INITIAL_SERIAL &&
+					  partial_agg_ok(agg)))
 					return false;
 
 				/* As usual, it must be shippable. */
@@ -857,6 +864,42 @@ foreign_expr_walker(Node *node,
 	return true;
 }
 
+/*
+ * Check whether the partial step of an aggregate can be done remotely.
+ *
+ * The remote server has no way to return a bare transition state, but for
+ * an aggregate without a final function whose state type is also its result
+ * type (count, sum of integers, min, max and the like), the result of the
+ * ordinary aggregate call is exactly the partial state our Finalize step
+ * expects to combine.
+ */
+static bool
+partial_agg_ok(Aggref *agg)
+{
+	HeapTuple	aggtup;
+	Form_pg_aggregate aggform;
+	bool		result;
+
+	/* Such aggregates are never split, but be safe */
+	if (agg->aggdistinct || agg->aggorder)
+		return false;
+
+	aggtup = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(agg->aggfnoid));
+	if (!HeapTupleIsValid(aggtup))
+		elog(ERROR, "cache lookup failed for aggregate %u", agg->aggfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(aggtup);
+
+	result = (aggform->aggkind == AGGKIND_NORMAL &&
+			  !OidIsValid(aggform->aggfinalfn) &&
+			  OidIsValid(aggform->aggcombinefn) &&
+			  aggform->aggtranstype != INTERNALOID &&
+			  aggform->aggtranstype == get_func_rettype(agg->aggfnoid));
+
+	ReleaseSysCache(aggtup);
+
+	return result;
+}
+
 /*
  * Returns true if given expr is something we'd have to send the value of
  * to the foreign server.
@@ -1708,7 +1751,7 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 				 Index rtindex, Relation rel,
 				 List *targetAttrs, bool doNothing,
 				 List *withCheckOptionList, List *returningList,
-				 List **retrieved_attrs)
+				 List **retrieved_attrs, int *values_end_len)
 {
 	AttrNumber	pindex;
 	bool		first;
@@ -1751,6 +1794,7 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 	}
 	else
 		appendStringInfoString(buf, " DEFAULT VALUES");
+	*values_end_len = buf->len;
 
 	if (doNothing)
 		appendStringInfoString(buf, " ON CONFLICT DO NOTHING");
@@ -1760,6 +1804,54 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 						 withCheckOptionList, returningList, retrieved_attrs);
 }
 
+/*
+ * rebuild remote INSERT statement to insert num_rows rows at once
+ *
+ * orig_query is a statement built by deparseInsertSql, and values_end_len
+ * the length of its prefix ending with the VALUES list.  We repeat the
+ * VALUES list once per row, numbering the parameters consecutively, and
+ * keep whatever follows it (ON CONFLICT etc).
+ */
+void
+rebuildInsertSql(StringInfo buf, char *orig_query,
+				 int values_end_len, int num_cols,
+				 int num_rows)
+{
+	int			i,
+				j;
+	int			pindex;
+	bool		first;
+
+	/* Make sure the values_end_len is sensible */
+	Assert((values_end_len > 0) && (values_end_len <= strlen(orig_query)));
+
+	/* Copy up to the end of the first record from the original query */
+	appendBinaryStringInfo(buf, orig_query, values_end_len);
+
+	/* Add the records for the remaining rows */
+	pindex = num_cols + 1;
+	for (i = 0; i < num_rows - 1; i++)
+	{
+		appendStringInfoString(buf, ", (");
+
+		first = true;
+		for (j = 0; j < num_cols; j++)
+		{
+			if (!first)
+				appendStringInfoString(buf, ", ");
+			first = false;
+
+			appendStringInfo(buf, "$%d", pindex);
+			pindex++;
+		}
+
+		appendStringInfoChar(buf, ')');
+	}
+
+	/* Copy the rest of the original query */
+	appendStringInfoString(buf, orig_query + values_end_len);
+}
+
 /*
  * deparse remote UPDATE statement
  *
@@ -2055,6 +2147,27 @@ deparseAnalyzeSizeSql(StringInfo buf, Relation rel)
 	appendStringInfo(buf, "::pg_catalog.regclass) / %d", BLCKSZ);
 }
 
+/*
+ * Construct SELECT statement to acquire the kind of given relation and its
+ * size in blocks, for dividing a parallel scan of it.
+ *
+ * Unlike deparseAnalyzeSizeSql, we use the remote block size, since the
+ * result is used to compute remote ctids.
+ */
+void
+deparseParallelScanInfoSql(StringInfo buf, Relation rel)
+{
+	StringInfoData relname;
+
+	/* We'll need the remote relation name as a literal. */
+	initStringInfo(&relname);
+	deparseRelation(&relname, rel);
+
+	appendStringInfoString(buf, "SELECT c.relkind, pg_catalog.pg_relation_size(c.oid) / pg_catalog.current_setting('block_size')::integer FROM pg_catalog.pg_class c WHERE c.oid = ");
+	deparseStringLiteral(buf, relname.data);
+	appendStringInfoString(buf, "::pg_catalog.regclass");
+}
+
 /*
  * Construct SELECT statement to acquire sample rows of given relation.
  *
@@ -2959,8 +3072,12 @@ deparseAggref(Aggref *node, deparse_expr_cxt *context)
 	StringInfo	buf = context->buf;
 	bool		use_variadic;
 
-	/* Only basic, non-split aggregation accepted. */
-	Assert(node->aggsplit == AGGSPLIT_SIMPLE);
+	/*
+	 * Only basic, non-split aggregation accepted, plus partial aggregates
+	 * approved by partial_agg_ok(), which are sent as-is.
+	 */
+	Assert(node->aggsplit == AGGSPLIT_SIMPLE ||
+		   node->aggsplit == AGGSPLIT_INITIAL_SERIAL);
 
 	/* Check if need to print VARIADIC (cf. ruleutils.c) */
 	use_variadic = node->aggvariadic;
@@ -15,6 +15,7 @@
 #include "postgres_fdw.h"
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/pg_class.h"
@@ -35,6 +36,8 @@
 #include "optimizer/restrictinfo.h"
 #include "optimizer/tlist.h"
 #include "parser/parsetree.h"
+#include "port/atomics.h"
+#include "storage/latch.h"
 #include "utils/builtins.h"
 #include "utils/float.h"
 #include "utils/guc.h"
@@ -55,6 +58,9 @@ PG_MODULE_MAGIC;
 /* If no remote estimates, assume a sort costs 20% extra */
 #define DEFAULT_FDW_SORT_MULTIPLIER 1.2
 
+/* Smallest range of remote blocks handed out to a parallel scan participant */
+#define PARALLEL_SCAN_MIN_CHUNK_PAGES	128
+
 /*
  * Indexes of FDW-private information stored in fdw_private lists.
  *
@@ -70,6 +76,10 @@ enum FdwScanPrivateIndex
 	FdwScanPrivateRetrievedAttrs,
 	/* Integer representing the desired fetch_size */
 	FdwScanPrivateFetchSize,
+	/* Flag: may a LIMIT for the executor's tuple bound be appended? */
+	FdwScanPrivateBoundOk,
+	/* SELECT restricted to a range of ctids, for a parallel-aware scan */
+	FdwScanPrivateChunkSql,
 
 	/*
 	 * String describing join i.e. names of relations being joined and types
@@ -85,8 +95,10 @@ enum FdwScanPrivateIndex
  * 1) INSERT/UPDATE/DELETE statement text to be sent to the remote server
  * 2) Integer list of target attribute numbers for INSERT/UPDATE
  *	  (NIL for a DELETE)
- * 3) Boolean flag showing if the remote query has a RETURNING clause
- * 4) Integer list of attribute numbers retrieved by RETURNING, if any
+ * 3) Length till the end of VALUES clause for INSERT
+ *	  (-1 for a DELETE/UPDATE)
+ * 4) Boolean flag showing if the remote query has a RETURNING clause
+ * 5) Integer list of attribute numbers retrieved by RETURNING, if any
  */
 enum FdwModifyPrivateIndex
 {
@@ -94,6 +106,8 @@ enum FdwModifyPrivateIndex
 	FdwModifyPrivateUpdateSql,
 	/* Integer list of target attribute numbers for INSERT/UPDATE */
 	FdwModifyPrivateTargetAttnums,
+	/* Length till the end of VALUES clause (as an integer Value node) */
+	FdwModifyPrivateLen,
 	/* has-returning flag (as an integer Value node) */
 	FdwModifyPrivateHasReturning,
 	/* Integer list of attribute numbers retrieved by RETURNING */
@@ -121,6 +135,21 @@ enum FdwDirectModifyPrivateIndex
 	FdwDirectModifyPrivateSetProcessed
 };
 
+/*
+ * Shared state of a parallel-aware foreign scan, kept in dynamic shared
+ * memory.  The leader exports its remote snapshot so that all participants
+ * see the same rows, and the participants then claim ranges of the remote
+ * table's blocks one at a time.
+ */
+typedef struct PgFdwParallelScanState
+{
+	char		snapshot[64];	/* remote snapshot exported by the leader */
+	bool		chunked;		/* can the scan be divided by ctid range? */
+	BlockNumber chunk_pages;	/* # of remote blocks in each chunk */
+	uint64		nchunks;		/* # of chunks to be handed out */
+	pg_atomic_uint64 next_chunk;	/* next chunk to be claimed */
+} PgFdwParallelScanState;
+
 /*
  * Execution state of a foreign scan using postgres_fdw.
  */
@@ -137,6 +166,7 @@ typedef struct PgFdwScanState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	unsigned int cursor_number; /* quasi-unique ID for my cursor */
 	bool		cursor_exists;	/* have we created the cursor? */
 	int			numParams;		/* number of parameters passed to query */
@@ -158,6 +188,16 @@ typedef struct PgFdwScanState
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 
 	int			fetch_size;		/* number of tuples per fetch */
+
+	/* for pushing the executor's tuple bound to the remote query */
+	bool		bound_ok;		/* can a LIMIT be added to the query? */
+	int64		cursor_bound;	/* LIMIT used by the cursor, or -1 if none */
+
+	/* for parallel-aware scans */
+	char	   *chunk_query;	/* SELECT restricted to a ctid range */
+	PgFdwParallelScanState *pstate; /* shared state, or NULL if serial */
+	uint64		chunk;			/* chunk the cursor is scanning */
+	char		chunk_bounds[2][32];	/* its ctid bounds, as text */
 } PgFdwScanState;
 
 /*
@@ -170,11 +210,15 @@ typedef struct PgFdwModifyState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	char	   *p_name;			/* name of prepared statement, if created */
 
 	/* extracted fdw_private data */
 	char	   *query;			/* text of INSERT/UPDATE/DELETE command */
+	char	   *orig_query;		/* original text of INSERT command */
 	List	   *target_attrs;	/* list of target attribute numbers */
+	int			values_end;		/* length up to the end of VALUES */
+	int			batch_size;		/* value of FDW option "batch_size" */
 	bool		has_returning;	/* is there a RETURNING clause? */
 	List	   *retrieved_attrs;	/* attr numbers retrieved by RETURNING */
 
@@ -183,6 +227,10 @@ typedef struct PgFdwModifyState
 	int			p_nums;			/* number of parameters to transmit */
 	FmgrInfo   *p_flinfo;		/* output conversion functions for them */
 
+	/* batch operation stuff */
+	int			num_slots;		/* number of rows the prepared statement
+								 * inserts */
+
 	/* working memory context */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 
@@ -207,6 +255,7 @@ typedef struct PgFdwDirectModifyState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the update */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	int			numParams;		/* number of parameters passed to query */
 	FmgrInfo   *param_flinfo;	/* output conversion functions for them */
 	List	   *param_exprs;	/* executable expressions for param values */
@@ -325,6 +374,20 @@ static void postgresBeginForeignScan(ForeignScanState *node, int eflags);
 static TupleTableSlot *postgresIterateForeignScan(ForeignScanState *node);
 static void postgresReScanForeignScan(ForeignScanState *node);
 static void postgresEndForeignScan(ForeignScanState *node);
+static bool postgresIsForeignScanParallelSafe(PlannerInfo *root,
+											  RelOptInfo *rel,
+											  RangeTblEntry *rte);
+static Size postgresEstimateDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt);
+static void postgresInitializeDSMForeignScan(ForeignScanState *node,
+											 ParallelContext *pcxt,
+											 void *coordinate);
+static void postgresReInitializeDSMForeignScan(ForeignScanState *node,
+											   ParallelContext *pcxt,
+											   void *coordinate);
+static void postgresInitializeWorkerForeignScan(ForeignScanState *node,
+												shm_toc *toc,
+												void *coordinate);
 static void postgresAddForeignUpdateTargets(Query *parsetree,
 											RangeTblEntry *target_rte,
 											Relation target_relation);
@@ -341,6 +404,11 @@ static TupleTableSlot *postgresExecForeignInsert(EState *estate,
 												 ResultRelInfo *resultRelInfo,
 												 TupleTableSlot *slot,
 												 TupleTableSlot *planSlot);
+static TupleTableSlot **postgresExecForeignBatchInsert(EState *estate,
+														ResultRelInfo *resultRelInfo,
+														TupleTableSlot **slots,
+														int *numSlots);
+static int	postgresGetForeignModifyBatchSize(ResultRelInfo *resultRelInfo);
 static TupleTableSlot *postgresExecForeignUpdate(EState *estate,
 												 ResultRelInfo *resultRelInfo,
 												 TupleTableSlot *slot,
@@ -390,6 +458,11 @@ static void postgresGetForeignUpperPaths(PlannerInfo *root,
 										 RelOptInfo *input_rel,
 										 RelOptInfo *output_rel,
 										 void *extra);
+static bool postgresIsForeignPathAsyncCapable(ForeignPath *path);
+static void postgresForeignAsyncRequest(ForeignScanState *node);
+static bool postgresForeignAsyncReady(ForeignScanState *node);
+static bool postgresForeignAsyncConfigureWait(ForeignScanState *node,
+											  WaitEventSet *set);
 
 /*
  * Helper functions
@@ -418,7 +491,10 @@ static bool ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 									  EquivalenceClass *ec, EquivalenceMember *em,
 									  void *arg);
 static void create_cursor(ForeignScanState *node);
+static int64 get_tuple_bound(ForeignScanState *node);
+static bool claim_next_chunk(PgFdwScanState *fsstate);
 static void fetch_more_data(ForeignScanState *node);
+static void fetch_more_data_begin(ForeignScanState *node);
 static void close_cursor(PGconn *conn, unsigned int cursor_number);
 static PgFdwModifyState *create_foreign_modify(EState *estate,
 											   RangeTblEntry *rte,
@@ -427,6 +503,7 @@ static PgFdwModifyState *create_foreign_modify(EState *estate,
 											   Plan *subplan,
 											   char *query,
 											   List *target_attrs,
+											   int values_end,
 											   bool has_returning,
 											   List *retrieved_attrs);
 static TupleTableSlot *execute_foreign_modify(EState *estate,
@@ -434,7 +511,11 @@ static TupleTableSlot *execute_foreign_modify(EState *estate,
 											  CmdType operation,
 											  TupleTableSlot *slot,
 											  TupleTableSlot *planSlot);
+static void execute_foreign_batch_insert(PgFdwModifyState *fmstate,
+										 TupleTableSlot **slots,
+										 int numSlots);
 static void prepare_foreign_modify(PgFdwModifyState *fmstate);
+static void deallocate_foreign_modify(PgFdwModifyState *fmstate);
 static const char **convert_prep_stmt_params(PgFdwModifyState *fmstate,
 											 ItemPointer tupleid,
 											 TupleTableSlot *slot);
@@ -499,6 +580,8 @@ static void add_foreign_final_paths(PlannerInfo *root,
 									FinalPathExtraData *extra);
 static void apply_server_options(PgFdwRelationInfo *fpinfo);
 static void apply_table_options(PgFdwRelationInfo *fpinfo);
+static int	get_batch_size_option(Relation rel);
+static bool get_parallel_scan_option(Oid foreigntableid);
 static void merge_fdw_options(PgFdwRelationInfo *fpinfo,
 							  const PgFdwRelationInfo *fpinfo_o,
 							  const PgFdwRelationInfo *fpinfo_i);
@@ -527,6 +610,8 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	routine->PlanForeignModify = postgresPlanForeignModify;
 	routine->BeginForeignModify = postgresBeginForeignModify;
 	routine->ExecForeignInsert = postgresExecForeignInsert;
+	routine->ExecForeignBatchInsert = postgresExecForeignBatchInsert;
+	routine->GetForeignModifyBatchSize = postgresGetForeignModifyBatchSize;
 	routine->ExecForeignUpdate = postgresExecForeignUpdate;
 	routine->ExecForeignDelete = postgresExecForeignDelete;
 	routine->EndForeignModify = postgresEndForeignModify;
@@ -557,6 +642,19 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	/* Support functions for upper relation push-down */
 	routine->GetForeignUpperPaths = postgresGetForeignUpperPaths;
 
+	/* Support functions for parallel query */
+	routine->IsForeignScanParallelSafe = postgresIsForeignScanParallelSafe;
+	routine->EstimateDSMForeignScan = postgresEstimateDSMForeignScan;
+	routine->InitializeDSMForeignScan = postgresInitializeDSMForeignScan;
+	routine->ReInitializeDSMForeignScan = postgresReInitializeDSMForeignScan;
+	routine->InitializeWorkerForeignScan = postgresInitializeWorkerForeignScan;
+
+	/* Support functions for asynchronous execution */
+	routine->IsForeignPathAsyncCapable = postgresIsForeignPathAsyncCapable;
+	routine->ForeignAsyncRequest = postgresForeignAsyncRequest;
+	routine->ForeignAsyncReady = postgresForeignAsyncReady;
+	routine->ForeignAsyncConfigureWait = postgresForeignAsyncConfigureWait;
+
 	PG_RETURN_POINTER(routine);
 }
 
@@ -602,6 +700,7 @@ postgresGetForeignRelSize(PlannerInfo *root,
 	fpinfo->fdw_tuple_cost = DEFAULT_FDW_TUPLE_COST;
 	fpinfo->shippable_extensions = NIL;
 	fpinfo->fetch_size = 100;
+	fpinfo->async_capable = false;
 
 	apply_server_options(fpinfo);
 	apply_table_options(fpinfo);
@@ -1005,6 +1104,45 @@ postgresGetForeignPaths(PlannerInfo *root,
 	/* Add paths with pathkeys */
 	add_paths_with_pathkeys_for_rel(root, baserel, NULL);
 
+	/*
+	 * If the scan may be run in parallel workers, also add a partial path in
+	 * which the participants divide the remote table between them by ctid
+	 * range; see postgresInitializeDSMForeignScan.  Only the transfer and
+	 * processing of the rows is divided, while every worker pays for a
+	 * connection of its own.
+	 */
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL)
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel, baserel->pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			double		parallel_divisor;
+			Cost		run_cost = fpinfo->total_cost - fpinfo->startup_cost;
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   fpinfo->rows,
+										   fpinfo->startup_cost,
+										   fpinfo->total_cost,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel either */
+										   NULL,	/* no extra plan */
+										   NIL);	/* no fdw_private list */
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+
+			parallel_divisor = get_parallel_divisor(&path->path);
+			path->path.rows = clamp_row_est(fpinfo->rows / parallel_divisor);
+			path->path.startup_cost += fpinfo->fdw_startup_cost;
+			path->path.total_cost = path->path.startup_cost +
+				run_cost / parallel_divisor;
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
+
 	/*
 	 * If we're not using remote estimates, stop here.  We have no way to
 	 * estimate whether any join clauses would be worth sending across, so
@@ -1199,8 +1337,10 @@ postgresGetForeignPlan(PlannerInfo *root,
 	List	   *fdw_recheck_quals = NIL;
 	List	   *retrieved_attrs;
 	StringInfoData sql;
+	Value	   *chunk_sql = NULL;
 	bool		has_final_sort = false;
 	bool		has_limit = false;
+	bool		bound_ok;
 	ListCell   *lc;
 
 	/*
@@ -1368,13 +1508,46 @@ postgresGetForeignPlan(PlannerInfo *root,
 	/* Remember remote_exprs for possible use by postgresPlanDirectModify */
 	fpinfo->final_remote_exprs = remote_exprs;
 
+	/*
+	 * If the executor tells us that only so many rows will be needed, we can
+	 * add a LIMIT to the remote query; see create_cursor().  That's not
+	 * possible if the query already has a LIMIT or ends with a locking
+	 * clause, nor when local conditions might reject some of the rows.
+	 */
+	bound_ok = (!has_limit && local_exprs == NIL &&
+				root->parse->commandType == CMD_SELECT &&
+				root->rowMarks == NIL);
+
+	/*
+	 * A parallel-aware scan also needs a version of the query that fetches
+	 * just the rows in a range of ctids.  The bounds of the range are passed
+	 * as two more parameters after those in params_list.  Partial paths are
+	 * built only for unsorted, unparameterized base relation scans, and row
+	 * locking isn't parallel safe, so the query ends with its WHERE clause.
+	 */
+	if (best_path->path.parallel_aware)
+	{
+		StringInfoData buf;
+		int			nparams = list_length(params_list);
+
+		Assert(IS_SIMPLE_REL(foreignrel) && !has_final_sort && !has_limit);
+
+		initStringInfo(&buf);
+		appendStringInfo(&buf, "%s %s (ctid >= $%d::pg_catalog.tid) AND (ctid < $%d::pg_catalog.tid)",
+						 sql.data, remote_exprs != NIL ? "AND" : "WHERE",
+						 nparams + 1, nparams + 2);
+		chunk_sql = makeString(buf.data);
+	}
+
 	/*
 	 * Build the fdw_private list that will be available to the executor.
 	 * Items in the list must match order in enum FdwScanPrivateIndex.
 	 */
-	fdw_private = list_make3(makeString(sql.data),
+	fdw_private = list_make5(makeString(sql.data),
 							 retrieved_attrs,
-							 makeInteger(fpinfo->fetch_size));
+							 makeInteger(fpinfo->fetch_size),
+							 makeInteger(bound_ok),
+							 chunk_sql);
 	if (IS_JOIN_REL(foreignrel) || IS_UPPER_REL(foreignrel))
 		fdw_private = lappend(fdw_private,
 							  makeString(fpinfo->relation_name->data));
@@ -1446,7 +1619,7 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 	 * Get connection to the foreign server.  Connection manager will
 	 * establish new connection if necessary.
 	 */
-	fsstate->conn = GetConnection(user, false);
+	fsstate->conn = GetConnection(user, false, &fsstate->conn_state);
 
 	/* Assign a unique ID for my cursor */
 	fsstate->cursor_number = GetCursorNumber(fsstate->conn);
@@ -1459,6 +1632,12 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 												 FdwScanPrivateRetrievedAttrs);
 	fsstate->fetch_size = intVal(list_nth(fsplan->fdw_private,
 										  FdwScanPrivateFetchSize));
+	fsstate->bound_ok = intVal(list_nth(fsplan->fdw_private,
+										FdwScanPrivateBoundOk));
+	fsstate->cursor_bound = -1;
+	if (list_nth(fsplan->fdw_private, FdwScanPrivateChunkSql) != NULL)
+		fsstate->chunk_query = strVal(list_nth(fsplan->fdw_private,
+											   FdwScanPrivateChunkSql));
 
 	/* Create contexts for batches of tuples and per-tuple temp workspace. */
 	fsstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
@@ -1497,6 +1676,11 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 							 &fsstate->param_flinfo,
 							 &fsstate->param_exprs,
 							 &fsstate->param_values);
+
+	/* Leave room for the ctid bounds of a parallel-aware scan's chunks */
+	if (fsstate->chunk_query != NULL)
+		fsstate->param_values = (const char **)
+			palloc0((numParams + 2) * sizeof(char *));
 }
 
 /*
@@ -1512,22 +1696,37 @@ postgresIterateForeignScan(ForeignScanState *node)
 
 	/*
 	 * If this is the first call after Begin or ReScan, we need to create the
-	 * cursor on the remote side.
+	 * cursor on the remote side.  A parallel-aware scan must claim a chunk of
+	 * the table to work on first.
 	 */
 	if (!fsstate->cursor_exists)
+	{
+		if (fsstate->pstate != NULL && !claim_next_chunk(fsstate))
+			return ExecClearTuple(slot);
 		create_cursor(node);
+	}
 
 	/*
 	 * Get some more tuples, if we've run out.
 	 */
-	if (fsstate->next_tuple >= fsstate->num_tuples)
+	while (fsstate->next_tuple >= fsstate->num_tuples)
 	{
 		/* No point in another fetch if we already detected EOF, though. */
 		if (!fsstate->eof_reached)
 			fetch_more_data(node);
+		if (fsstate->next_tuple < fsstate->num_tuples)
+			break;
+
 		/* If we didn't get any tuples, must be end of data. */
-		if (fsstate->next_tuple >= fsstate->num_tuples)
+		if (fsstate->pstate == NULL)
 			return ExecClearTuple(slot);
+
+		/* ... or rather of this chunk; move on to the next one, if any */
+		close_cursor(fsstate->conn, fsstate->cursor_number);
+		fsstate->cursor_exists = false;
+		if (!claim_next_chunk(fsstate))
+			return ExecClearTuple(slot);
+		create_cursor(node);
 	}
 
 	/*
@@ -1555,14 +1754,27 @@ postgresReScanForeignScan(ForeignScanState *node)
 	if (!fsstate->cursor_exists)
 		return;
 
+	/*
+	 * If a FETCH is still pending on the connection, collect it first; we
+	 * need the connection, and the fetch counts below must be up to date.
+	 */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
 	/*
 	 * If any internal parameters affecting this node have changed, we'd
 	 * better destroy and recreate the cursor.  Otherwise, rewinding it should
 	 * be good enough.  If we've only fetched zero or one batch, we needn't
 	 * even rewind the cursor, just rescan what we have.
 	 */
-	if (node->ss.ps.chgParam != NULL)
+	if (node->ss.ps.chgParam != NULL ||
+		fsstate->pstate != NULL ||
+		fsstate->cursor_bound != get_tuple_bound(node))
 	{
+		/*
+		 * A changed tuple bound also calls for a new cursor, as does a
+		 * parallel-aware scan, which must claim its chunks afresh.
+		 */
 		fsstate->cursor_exists = false;
 		snprintf(sql, sizeof(sql), "CLOSE c%u",
 				 fsstate->cursor_number);
@@ -1609,6 +1821,10 @@ postgresEndForeignScan(ForeignScanState *node)
 	if (fsstate == NULL)
 		return;
 
+	/* Collect any FETCH still pending, so the connection can be reused */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
 	/* Close the cursor if open, to prevent accumulation of cursors */
 	if (fsstate->cursor_exists)
 		close_cursor(fsstate->conn, fsstate->cursor_number);
@@ -1620,6 +1836,174 @@ postgresEndForeignScan(ForeignScanState *node)
 	/* MemoryContexts will be deleted automatically. */
 }
 
+/*
+ * postgresIsForeignScanParallelSafe
+ *		Determine whether the foreign table may be scanned by parallel workers
+ *
+ * Each worker opens connections of its own, so we only allow this if the
+ * user has asked for it with the parallel_scan option.
+ */
+static bool
+postgresIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
+								  RangeTblEntry *rte)
+{
+	return get_parallel_scan_option(rte->relid);
+}
+
+/*
+ * postgresEstimateDSMForeignScan
+ *		Report the amount of shared memory a parallel-aware scan needs
+ */
+static Size
+postgresEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(PgFdwParallelScanState);
+}
+
+/*
+ * postgresInitializeDSMForeignScan
+ *		Set up the shared state of a parallel-aware scan
+ *
+ * We export the remote snapshot of our connection for the workers to import,
+ * and divide the remote table into ranges of blocks for the participants to
+ * claim.  That's possible only if the remote object is a table or
+ * materialized view and the remote server can scan a range of ctids
+ * efficiently; otherwise the whole table makes up a single chunk, scanned by
+ * whichever participant gets to it first.
+ */
+static void
+postgresInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+								 void *coordinate)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PgFdwParallelScanState *pstate = (PgFdwParallelScanState *) coordinate;
+	PGconn	   *conn = fsstate->conn;
+	PGresult   *volatile res = NULL;
+	char		relkind = '\0';
+	BlockNumber nblocks = 0;
+
+	Assert(fsstate->chunk_query != NULL);
+
+	/* First, collect any FETCH another scan has pending on the connection */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
+	/* PGresult must be released before leaving this function. */
+	PG_TRY();
+	{
+		const char *sql = "SELECT pg_catalog.pg_export_snapshot()";
+		StringInfoData buf;
+
+		res = pgfdw_exec_query(conn, sql);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pgfdw_report_error(ERROR, res, conn, false, sql);
+		if (PQntuples(res) != 1 || PQnfields(res) != 1 ||
+			strlen(PQgetvalue(res, 0, 0)) >= sizeof(pstate->snapshot))
+			elog(ERROR, "unexpected result from remote pg_export_snapshot()");
+		strlcpy(pstate->snapshot, PQgetvalue(res, 0, 0),
+				sizeof(pstate->snapshot));
+		PQclear(res);
+		res = NULL;
+
+		initStringInfo(&buf);
+		deparseParallelScanInfoSql(&buf, fsstate->rel);
+		res = pgfdw_exec_query(conn, buf.data);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pgfdw_report_error(ERROR, res, conn, false, buf.data);
+		if (PQntuples(res) != 1 || PQnfields(res) != 2)
+			elog(ERROR, "unexpected result from remote relation size query");
+		relkind = *PQgetvalue(res, 0, 0);
+		nblocks = strtoul(PQgetvalue(res, 0, 1), NULL, 10);
+		PQclear(res);
+		res = NULL;
+	}
+	PG_CATCH();
+	{
+		if (res)
+			PQclear(res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	/*
+	 * Aim for a few chunks per participant, so that the work evens out even
+	 * if some of them are slower, but don't make the chunks too small.  The
+	 * last chunk is open-ended, so it's fine if the table has grown since.
+	 */
+	pstate->chunked = ((relkind == RELKIND_RELATION ||
+						relkind == RELKIND_MATVIEW) &&
+					   PQserverVersion(conn) >= 140000);
+	if (pstate->chunked)
+	{
+		pstate->chunk_pages = Max(nblocks / (4 * (pcxt->nworkers + 1)),
+								  PARALLEL_SCAN_MIN_CHUNK_PAGES);
+		pstate->nchunks = Max((nblocks + pstate->chunk_pages - 1) /
+							  pstate->chunk_pages, 1);
+	}
+	else
+	{
+		pstate->chunk_pages = 0;
+		pstate->nchunks = 1;
+	}
+	pg_atomic_init_u64(&pstate->next_chunk, 0);
+
+	fsstate->pstate = pstate;
+}
+
+/*
+ * postgresReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel-aware scan before a rescan
+ */
+static void
+postgresReInitializeDSMForeignScan(ForeignScanState *node,
+								   ParallelContext *pcxt, void *coordinate)
+{
+	PgFdwParallelScanState *pstate = (PgFdwParallelScanState *) coordinate;
+
+	pg_atomic_write_u64(&pstate->next_chunk, 0);
+}
+
+/*
+ * postgresInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel-aware scan
+ *
+ * The worker's remote transaction adopts the snapshot exported by the
+ * leader, unless an earlier scan in this worker has already done so on the
+ * same connection.  That has to happen before anything else is run on the
+ * connection, but the scans don't start until all of them are initialized.
+ */
+static void
+postgresInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+									void *coordinate)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PgFdwParallelScanState *pstate = (PgFdwParallelScanState *) coordinate;
+
+	if (!fsstate->conn_state->snapshot_imported)
+	{
+		StringInfoData sql;
+		PGresult   *res;
+
+		initStringInfo(&sql);
+		appendStringInfoString(&sql, "SET TRANSACTION SNAPSHOT ");
+		deparseStringLiteral(&sql, pstate->snapshot);
+
+		/*
+		 * We don't use a PG_TRY block here, so be careful not to throw error
+		 * without releasing the PGresult.
+		 */
+		res = pgfdw_exec_query(fsstate->conn, sql.data);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pgfdw_report_error(ERROR, res, fsstate->conn, true, sql.data);
+		PQclear(res);
+
+		fsstate->conn_state->snapshot_imported = true;
+		pfree(sql.data);
+	}
+
+	fsstate->pstate = pstate;
+}
+
 /*
  * postgresAddForeignUpdateTargets
  *		Add resjunk column(s) needed for update/delete on a foreign table
@@ -1675,6 +2059,7 @@ postgresPlanForeignModify(PlannerInfo *root,
 	List	   *withCheckOptionList = NIL;
 	List	   *returningList = NIL;
 	List	   *retrieved_attrs = NIL;
+	int			values_end_len = -1;
 	bool		doNothing = false;
 
 	initStringInfo(&sql);
@@ -1763,7 +2148,7 @@ postgresPlanForeignModify(PlannerInfo *root,
 			deparseInsertSql(&sql, rte, resultRelation, rel,
 							 targetAttrs, doNothing,
 							 withCheckOptionList, returningList,
-							 &retrieved_attrs);
+							 &retrieved_attrs, &values_end_len);
 			break;
 		case CMD_UPDATE:
 			deparseUpdateSql(&sql, rte, resultRelation, rel,
@@ -1787,8 +2172,9 @@ postgresPlanForeignModify(PlannerInfo *root,
 	 * Build the fdw_private list that will be available to the executor.
 	 * Items in the list must match enum FdwModifyPrivateIndex, above.
 	 */
-	return list_make4(makeString(sql.data),
+	return list_make5(makeString(sql.data),
 					  targetAttrs,
+					  makeInteger(values_end_len),
 					  makeInteger((retrieved_attrs != NIL)),
 					  retrieved_attrs);
 }
@@ -1807,6 +2193,7 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 	PgFdwModifyState *fmstate;
 	char	   *query;
 	List	   *target_attrs;
+	int			values_end_len;
 	bool		has_returning;
 	List	   *retrieved_attrs;
 	RangeTblEntry *rte;
@@ -1823,6 +2210,8 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 							FdwModifyPrivateUpdateSql));
 	target_attrs = (List *) list_nth(fdw_private,
 									 FdwModifyPrivateTargetAttnums);
+	values_end_len = intVal(list_nth(fdw_private,
+									 FdwModifyPrivateLen));
 	has_returning = intVal(list_nth(fdw_private,
 									FdwModifyPrivateHasReturning));
 	retrieved_attrs = (List *) list_nth(fdw_private,
@@ -1840,6 +2229,7 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 									mtstate->mt_plans[subplan_index]->plan,
 									query,
 									target_attrs,
+									values_end_len,
 									has_returning,
 									retrieved_attrs);
 
@@ -1874,6 +2264,54 @@ postgresExecForeignInsert(EState *estate,
 	return rslot;
 }
 
+/*
+ * postgresExecForeignBatchInsert
+ *		Insert multiple rows into a foreign table
+ */
+static TupleTableSlot **
+postgresExecForeignBatchInsert(EState *estate,
+							   ResultRelInfo *resultRelInfo,
+							   TupleTableSlot **slots,
+							   int *numSlots)
+{
+	PgFdwModifyState *fmstate = (PgFdwModifyState *) resultRelInfo->ri_FdwState;
+
+	/* As in postgresExecForeignInsert, use the aux_fmstate if there is one */
+	if (fmstate->aux_fmstate)
+		fmstate = fmstate->aux_fmstate;
+
+	execute_foreign_batch_insert(fmstate, slots, *numSlots);
+
+	return slots;
+}
+
+/*
+ * postgresGetForeignModifyBatchSize
+ *		Determine the maximum number of rows that can be inserted in a batch
+ */
+static int
+postgresGetForeignModifyBatchSize(ResultRelInfo *resultRelInfo)
+{
+	PgFdwModifyState *fmstate = (PgFdwModifyState *) resultRelInfo->ri_FdwState;
+
+	/* If fmstate is NULL, we are in EXPLAIN; rows go one at a time */
+	if (fmstate == NULL)
+		return 1;
+
+	if (fmstate->aux_fmstate)
+		fmstate = fmstate->aux_fmstate;
+
+	/*
+	 * We can't batch rows we need a RETURNING result for, nor a DEFAULT
+	 * VALUES insert, which has no VALUES list to repeat.
+	 */
+	if (fmstate->has_returning || fmstate->target_attrs == NIL)
+		return 1;
+
+	/* libpq allows at most 65535 parameters per statement */
+	return Min(fmstate->batch_size, 65535 / fmstate->p_nums);
+}
+
 /*
  * postgresExecForeignUpdate
  *		Update one row in a foreign table
@@ -1939,6 +2377,7 @@ postgresBeginForeignInsert(ModifyTableState *mtstate,
 	StringInfoData sql;
 	List	   *targetAttrs = NIL;
 	List	   *retrieved_attrs = NIL;
+	int			values_end_len;
 	bool		doNothing = false;
 
 	/*
@@ -2012,7 +2451,7 @@ postgresBeginForeignInsert(ModifyTableState *mtstate,
 	deparseInsertSql(&sql, rte, resultRelation, rel, targetAttrs, doNothing,
 					 resultRelInfo->ri_WithCheckOptions,
 					 resultRelInfo->ri_returningList,
-					 &retrieved_attrs);
+					 &retrieved_attrs, &values_end_len);
 
 	/* Construct an execution state. */
 	fmstate = create_foreign_modify(mtstate->ps.state,
@@ -2022,6 +2461,7 @@ postgresBeginForeignInsert(ModifyTableState *mtstate,
 									NULL,
 									sql.data,
 									targetAttrs,
+									values_end_len,
 									retrieved_attrs != NIL,
 									retrieved_attrs);
 
@@ -2384,7 +2824,7 @@ postgresBeginDirectModify(ForeignScanState *node, int eflags)
 	 * Get connection to the foreign server.  Connection manager will
 	 * establish new connection if necessary.
 	 */
-	dmstate->conn = GetConnection(user, false);
+	dmstate->conn = GetConnection(user, false, &dmstate->conn_state);
 
 	/* Update the foreign-join-related fields. */
 	if (fsplan->scan.scanrelid == 0)
@@ -2684,7 +3124,7 @@ estimate_path_cost_size(PlannerInfo *root,
 								false, &retrieved_attrs, NULL);
 
 		/* Get the remote estimate */
-		conn = GetConnection(fpinfo->user, false);
+		conn = GetConnection(fpinfo->user, false, NULL);
 		get_remote_estimate(sql.data, conn, &rows, &width,
 							&startup_cost, &total_cost);
 		ReleaseConnection(conn);
@@ -3263,9 +3703,15 @@ create_cursor(ForeignScanState *node)
 	ExprContext *econtext = node->ss.ps.ps_ExprContext;
 	int			numParams = fsstate->numParams;
 	const char **values = fsstate->param_values;
+	const char *query = fsstate->query;
 	PGconn	   *conn = fsstate->conn;
 	StringInfoData buf;
 	PGresult   *res;
+	int64		bound = get_tuple_bound(node);
+
+	/* First, collect any FETCH another scan has pending on the connection */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
 
 	/*
 	 * Construct array of query parameter values in text format.  We do the
@@ -3286,10 +3732,35 @@ create_cursor(ForeignScanState *node)
 		MemoryContextSwitchTo(oldcontext);
 	}
 
+	/*
+	 * A parallel-aware scan fetches only the rows of the chunk it has
+	 * claimed, if the table could be divided at all.
+	 */
+	if (fsstate->pstate != NULL && fsstate->pstate->chunked)
+	{
+		PgFdwParallelScanState *pstate = fsstate->pstate;
+		BlockNumber start = fsstate->chunk * pstate->chunk_pages;
+		BlockNumber end = InvalidBlockNumber;
+
+		if (fsstate->chunk < pstate->nchunks - 1)
+			end = start + pstate->chunk_pages;
+		snprintf(fsstate->chunk_bounds[0], sizeof(fsstate->chunk_bounds[0]),
+				 "(%u,0)", start);
+		snprintf(fsstate->chunk_bounds[1], sizeof(fsstate->chunk_bounds[1]),
+				 "(%u,0)", end);
+		values[numParams++] = fsstate->chunk_bounds[0];
+		values[numParams++] = fsstate->chunk_bounds[1];
+		query = fsstate->chunk_query;
+	}
+
 	/* Construct the DECLARE CURSOR command */
 	initStringInfo(&buf);
 	appendStringInfo(&buf, "DECLARE c%u CURSOR FOR\n%s",
-					 fsstate->cursor_number, fsstate->query);
+					 fsstate->cursor_number, query);
+
+	/* Ask for no more rows than our parent will demand, if it told us */
+	if (bound >= 0)
+		appendStringInfo(&buf, " LIMIT " INT64_FORMAT, bound);
 
 	/*
 	 * Notice that we pass NULL for paramTypes, thus forcing the remote server
@@ -3310,11 +3781,12 @@ create_cursor(ForeignScanState *node)
 	 */
 	res = pgfdw_get_result(conn, buf.data);
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		pgfdw_report_error(ERROR, res, conn, true, fsstate->query);
+		pgfdw_report_error(ERROR, res, conn, true, query);
 	PQclear(res);
 
 	/* Mark the cursor as created, and show no tuples have been retrieved */
 	fsstate->cursor_exists = true;
+	fsstate->cursor_bound = bound;
 	fsstate->tuples = NULL;
 	fsstate->num_tuples = 0;
 	fsstate->next_tuple = 0;
@@ -3325,6 +3797,35 @@ create_cursor(ForeignScanState *node)
 	pfree(buf.data);
 }
 
+/*
+ * Get the tuple bound to apply to the node's remote query, or -1 if none.
+ */
+static int64
+get_tuple_bound(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	if (!fsstate->bound_ok || node->tuples_needed < 0)
+		return -1;
+	return node->tuples_needed;
+}
+
+/*
+ * Claim the next chunk of a parallel-aware scan for this participant.
+ * Returns false if there are none left.
+ */
+static bool
+claim_next_chunk(PgFdwScanState *fsstate)
+{
+	uint64		chunk;
+
+	chunk = pg_atomic_fetch_add_u64(&fsstate->pstate->next_chunk, 1);
+	if (chunk >= fsstate->pstate->nchunks)
+		return false;
+	fsstate->chunk = chunk;
+	return true;
+}
+
 /*
  * Fetch some more rows from the node's cursor.
  */
@@ -3335,6 +3836,11 @@ fetch_more_data(ForeignScanState *node)
 	PGresult   *volatile res = NULL;
 	MemoryContext oldcontext;
 
+	/* Collect any FETCH some other scan has pending on the connection */
+	if (fsstate->conn_state->pending_scan != NULL &&
+		fsstate->conn_state->pending_scan != node)
+		process_pending_request(fsstate->conn_state);
+
 	/*
 	 * We'll store the tuples in the batch_cxt.  First, flush the previous
 	 * batch.
@@ -3351,10 +3857,19 @@ fetch_more_data(ForeignScanState *node)
 		int			numrows;
 		int			i;
 
-		snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
-				 fsstate->fetch_size, fsstate->cursor_number);
+		if (fsstate->conn_state->pending_scan == node)
+		{
+			/* The FETCH was sent by fetch_more_data_begin; get its result */
+			fsstate->conn_state->pending_scan = NULL;
+			res = pgfdw_get_result(conn, fsstate->query);
+		}
+		else
+		{
+			snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
+					 fsstate->fetch_size, fsstate->cursor_number);
 
-		res = pgfdw_exec_query(conn, sql);
+			res = pgfdw_exec_query(conn, sql);
+		}
 		/* On error, report the original query, not the FETCH. */
 		if (PQresultStatus(res) != PGRES_TUPLES_OK)
 			pgfdw_report_error(ERROR, res, conn, false, fsstate->query);
@@ -3399,6 +3914,48 @@ fetch_more_data(ForeignScanState *node)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Send a FETCH for the node's cursor without waiting for its result, which
+ * the next fetch_more_data call collects.
+ */
+static void
+fetch_more_data_begin(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	char		sql[64];
+
+	Assert(fsstate->cursor_exists);
+	Assert(fsstate->conn_state->pending_scan == NULL);
+
+	snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
+			 fsstate->fetch_size, fsstate->cursor_number);
+
+	if (!PQsendQuery(fsstate->conn, sql))
+		pgfdw_report_error(ERROR, NULL, fsstate->conn, false, fsstate->query);
+
+	fsstate->conn_state->pending_scan = node;
+}
+
+/*
+ * Collect the result of the FETCH pending on a connection, if any, into the
+ * buffer of the scan that sent it, so that the connection can be used for
+ * something else.
+ *
+ * The scan must not have any unread tuples left, since fetching replaces its
+ * batch; fetch_more_data_begin is only ever called once they're used up.
+ */
+void
+process_pending_request(PgFdwConnState *conn_state)
+{
+	ForeignScanState *node = conn_state->pending_scan;
+
+	if (node == NULL)
+		return;
+
+	fetch_more_data(node);
+	Assert(conn_state->pending_scan == NULL);
+}
+
 /*
  * Force assorted GUC parameters to settings that ensure that we'll output
  * data values in a form that is unambiguous to the remote server.
@@ -3483,6 +4040,7 @@ create_foreign_modify(EState *estate,
 					  Plan *subplan,
 					  char *query,
 					  List *target_attrs,
+					  int values_end,
 					  bool has_returning,
 					  List *retrieved_attrs)
 {
@@ -3512,12 +4070,15 @@ create_foreign_modify(EState *estate,
 	user = GetUserMapping(userid, table->serverid);
 
 	/* Open connection; report that we'll create a prepared statement. */
-	fmstate->conn = GetConnection(user, true);
+	fmstate->conn = GetConnection(user, true, &fmstate->conn_state);
 	fmstate->p_name = NULL;		/* prepared statement not made yet */
 
 	/* Set up remote query information. */
 	fmstate->query = query;
+	if (operation == CMD_INSERT)
+		fmstate->orig_query = pstrdup(fmstate->query);
 	fmstate->target_attrs = target_attrs;
+	fmstate->values_end = values_end;
 	fmstate->has_returning = has_returning;
 	fmstate->retrieved_attrs = retrieved_attrs;
 
@@ -3569,6 +4130,12 @@ create_foreign_modify(EState *estate,
 
 	Assert(fmstate->p_nums <= n_params);
 
+	/* Set batch_size from foreign server/table options. */
+	if (operation == CMD_INSERT)
+		fmstate->batch_size = get_batch_size_option(rel);
+
+	fmstate->num_slots = 1;
+
 	/* Initialize auxiliary state */
 	fmstate->aux_fmstate = NULL;
 
@@ -3599,6 +4166,22 @@ execute_foreign_modify(EState *estate,
 		   operation == CMD_UPDATE ||
 		   operation == CMD_DELETE);
 
+	/* Collect any FETCH a scan has pending on the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
+	/*
+	 * If the existing query was deparsed and prepared for a batch of rows,
+	 * go back to the single-row statement.
+	 */
+	if (operation == CMD_INSERT && fmstate->num_slots != 1)
+	{
+		if (fmstate->p_name)
+			deallocate_foreign_modify(fmstate);
+		fmstate->query = fmstate->orig_query;
+		fmstate->num_slots = 1;
+	}
+
 	/* Set up the prepared statement on the remote server, if we didn't yet */
 	if (!fmstate->p_name)
 		prepare_foreign_modify(fmstate);
@@ -3667,6 +4250,84 @@ execute_foreign_modify(EState *estate,
 	return (n_rows > 0) ? slot : NULL;
 }
 
+/*
+ * execute_foreign_batch_insert
+ *		Insert numSlots rows with a single multi-row INSERT statement
+ *
+ * The statement for a given number of rows is prepared once and reused, so
+ * a long run of full batches costs one round trip per batch.
+ */
+static void
+execute_foreign_batch_insert(PgFdwModifyState *fmstate,
+							 TupleTableSlot **slots,
+							 int numSlots)
+{
+	const char **p_values;
+	PGresult   *res;
+	int			i;
+
+	Assert(numSlots > 0);
+	Assert(!fmstate->has_returning);
+
+	/* Collect any FETCH a scan has pending on the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
+	/* Rebuild and re-prepare the statement if the number of rows changed */
+	if (fmstate->num_slots != numSlots)
+	{
+		StringInfoData sql;
+
+		if (fmstate->p_name)
+			deallocate_foreign_modify(fmstate);
+
+		initStringInfo(&sql);
+		rebuildInsertSql(&sql, fmstate->orig_query, fmstate->values_end,
+						 fmstate->p_nums, numSlots);
+		fmstate->query = sql.data;
+		fmstate->num_slots = numSlots;
+	}
+
+	if (!fmstate->p_name)
+		prepare_foreign_modify(fmstate);
+
+	/* Convert the parameters of all the rows to text form */
+	p_values = (const char **)
+		MemoryContextAlloc(fmstate->temp_cxt,
+						   sizeof(char *) * fmstate->p_nums * numSlots);
+	for (i = 0; i < numSlots; i++)
+		memcpy(p_values + i * fmstate->p_nums,
+			   convert_prep_stmt_params(fmstate, NULL, slots[i]),
+			   sizeof(char *) * fmstate->p_nums);
+
+	/*
+	 * Execute the prepared statement.
+	 */
+	if (!PQsendQueryPrepared(fmstate->conn,
+							 fmstate->p_name,
+							 fmstate->p_nums * numSlots,
+							 p_values,
+							 NULL,
+							 NULL,
+							 0))
+		pgfdw_report_error(ERROR, NULL, fmstate->conn, false, fmstate->query);
+
+	/*
+	 * Get the result, and check for success.
+	 *
+	 * We don't use a PG_TRY block here, so be careful not to throw error
+	 * without releasing the PGresult.
+	 */
+	res = pgfdw_get_result(fmstate->conn, fmstate->query);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pgfdw_report_error(ERROR, res, fmstate->conn, true, fmstate->query);
+
+	/* And clean up */
+	PQclear(res);
+
+	MemoryContextReset(fmstate->temp_cxt);
+}
+
 /*
  * prepare_foreign_modify
  *		Establish a prepared statement for execution of INSERT/UPDATE/DELETE
@@ -3824,28 +4485,42 @@ finish_foreign_modify(PgFdwModifyState *fmstate)
 
 	/* If we created a prepared statement, destroy it */
 	if (fmstate->p_name)
-	{
-		char		sql[64];
-		PGresult   *res;
-
-		snprintf(sql, sizeof(sql), "DEALLOCATE %s", fmstate->p_name);
-
-		/*
-		 * We don't use a PG_TRY block here, so be careful not to throw error
-		 * without releasing the PGresult.
-		 */
-		res = pgfdw_exec_query(fmstate->conn, sql);
-		if (PQresultStatus(res) != PGRES_COMMAND_OK)
-			pgfdw_report_error(ERROR, res, fmstate->conn, true, sql);
-		PQclear(res);
-		fmstate->p_name = NULL;
-	}
+		deallocate_foreign_modify(fmstate);
 
 	/* Release remote connection */
 	ReleaseConnection(fmstate->conn);
 	fmstate->conn = NULL;
 }
 
+/*
+ * deallocate_foreign_modify
+ *		Destroy the prepared statement of a foreign insert/update/delete
+ */
+static void
+deallocate_foreign_modify(PgFdwModifyState *fmstate)
+{
+	char		sql[64];
+	PGresult   *res;
+
+	Assert(fmstate->p_name != NULL);
+
+	/* Collect any FETCH a scan has pending on the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
+	snprintf(sql, sizeof(sql), "DEALLOCATE %s", fmstate->p_name);
+
+	/*
+	 * We don't use a PG_TRY block here, so be careful not to throw error
+	 * without releasing the PGresult.
+	 */
+	res = pgfdw_exec_query(fmstate->conn, sql);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pgfdw_report_error(ERROR, res, fmstate->conn, true, sql);
+	PQclear(res);
+	fmstate->p_name = NULL;
+}
+
 /*
  * build_remote_returning
  *		Build a RETURNING targetlist of a remote query for performing an
@@ -3986,6 +4661,10 @@ execute_dml_stmt(ForeignScanState *node)
 	int			numParams = dmstate->numParams;
 	const char **values = dmstate->param_values;
 
+	/* Collect any FETCH a scan has pending on the connection */
+	if (dmstate->conn_state->pending_scan != NULL)
+		process_pending_request(dmstate->conn_state);
+
 	/*
 	 * Construct array of query parameter values in text format.
 	 */
@@ -4387,7 +5066,7 @@ postgresAnalyzeForeignTable(Relation relation,
 	 */
 	table = GetForeignTable(RelationGetRelid(relation));
 	user = GetUserMapping(relation->rd_rel->relowner, table->serverid);
-	conn = GetConnection(user, false);
+	conn = GetConnection(user, false, NULL);
 
 	/*
 	 * Construct command to get page count for relation.
@@ -4477,7 +5156,7 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 	table = GetForeignTable(RelationGetRelid(relation));
 	server = GetForeignServer(table->serverid);
 	user = GetUserMapping(relation->rd_rel->relowner, table->serverid);
-	conn = GetConnection(user, false);
+	conn = GetConnection(user, false, NULL);
 
 	/*
 	 * Construct cursor that retrieves whole rows from remote.
@@ -4700,7 +5379,7 @@ postgresImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
 	 */
 	server = GetForeignServer(serverOid);
 	mapping = GetUserMapping(GetUserId(), server->serverid);
-	conn = GetConnection(mapping, false);
+	conn = GetConnection(mapping, false, NULL);
 
 	/* Don't attempt to import collation if remote server hasn't got it */
 	if (PQserverVersion(conn) < 90100)
@@ -5292,6 +5971,8 @@ apply_server_options(PgFdwRelationInfo *fpinfo)
 				ExtractExtensionList(defGetString(def), false);
 		else if (strcmp(def->defname, "fetch_size") == 0)
 			fpinfo->fetch_size = strtol(defGetString(def), NULL, 10);
+		else if (strcmp(def->defname, "async_capable") == 0)
+			fpinfo->async_capable = defGetBoolean(def);
 	}
 }
 
@@ -5313,7 +5994,90 @@ apply_table_options(PgFdwRelationInfo *fpinfo)
 			fpinfo->use_remote_estimate = defGetBoolean(def);
 		else if (strcmp(def->defname, "fetch_size") == 0)
 			fpinfo->fetch_size = strtol(defGetString(def), NULL, 10);
+		else if (strcmp(def->defname, "async_capable") == 0)
+			fpinfo->async_capable = defGetBoolean(def);
+	}
+}
+
+/*
+ * Determine batch size for a given foreign table.  The option specified for
+ * a table has precedence.
+ */
+static int
+get_batch_size_option(Relation rel)
+{
+	Oid			foreigntableid = RelationGetRelid(rel);
+	ForeignTable *table;
+	ForeignServer *server;
+	List	   *options;
+	ListCell   *lc;
+
+	/* we use 1 by default, which means "no batching" */
+	int			batch_size = 1;
+
+	/*
+	 * Load options for table and server.  We append server options after
+	 * table options, because table options take precedence.
+	 */
+	table = GetForeignTable(foreigntableid);
+	server = GetForeignServer(table->serverid);
+
+	options = list_concat(list_copy(table->options),
+						  list_copy(server->options));
+
+	/* See if either table or server specifies batch_size. */
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "batch_size") == 0)
+		{
+			batch_size = strtol(defGetString(def), NULL, 10);
+			break;
+		}
 	}
+
+	return batch_size;
+}
+
+/*
+ * Determine whether the parallel_scan option allows scans of the given
+ * foreign table to be run by parallel workers.
+ */
+static bool
+get_parallel_scan_option(Oid foreigntableid)
+{
+	ForeignTable *table;
+	ForeignServer *server;
+	List	   *options;
+	ListCell   *lc;
+
+	/* parallel scans are off by default */
+	bool		parallel_scan = false;
+
+	/*
+	 * Load options for table and server.  We append server options after
+	 * table options, because table options take precedence.
+	 */
+	table = GetForeignTable(foreigntableid);
+	server = GetForeignServer(table->serverid);
+
+	options = list_concat(list_copy(table->options),
+						  list_copy(server->options));
+
+	/* See if either table or server specifies parallel_scan. */
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel_scan") == 0)
+		{
+			parallel_scan = defGetBoolean(def);
+			break;
+		}
+	}
+
+	return parallel_scan;
 }
 
 /*
@@ -5347,6 +6111,7 @@ merge_fdw_options(PgFdwRelationInfo *fpinfo,
 	fpinfo->shippable_extensions = fpinfo_o->shippable_extensions;
 	fpinfo->use_remote_estimate = fpinfo_o->use_remote_estimate;
 	fpinfo->fetch_size = fpinfo_o->fetch_size;
+	fpinfo->async_capable = fpinfo_o->async_capable;
 
 	/* Merge the table level options from either side of the join. */
 	if (fpinfo_i)
@@ -5368,6 +6133,13 @@ merge_fdw_options(PgFdwRelationInfo *fpinfo,
 		 * relation sizes.
 		 */
 		fpinfo->fetch_size = Max(fpinfo_o->fetch_size, fpinfo_i->fetch_size);
+
+		/*
+		 * Run the join asynchronously if either side was configured to; the
+		 * join is a single remote query either way.
+		 */
+		fpinfo->async_capable = fpinfo_o->async_capable ||
+			fpinfo_i->async_capable;
 	}
 }
 
@@ -5767,6 +6539,7 @@ postgresGetForeignUpperPaths(PlannerInfo *root, UpperRelationKind stage,
 
 	/* Ignore stages we don't support; and skip any duplicate calls. */
 	if ((stage != UPPERREL_GROUP_AGG &&
+		 stage != UPPERREL_PARTIAL_GROUP_AGG &&
 		 stage != UPPERREL_ORDERED &&
 		 stage != UPPERREL_FINAL) ||
 		output_rel->fdw_private)
@@ -5780,6 +6553,7 @@ postgresGetForeignUpperPaths(PlannerInfo *root, UpperRelationKind stage,
 	switch (stage)
 	{
 		case UPPERREL_GROUP_AGG:
+		case UPPERREL_PARTIAL_GROUP_AGG:
 			add_foreign_grouping_paths(root, input_rel, output_rel,
 									   (GroupPathExtraData *) extra);
 			break;
@@ -5801,7 +6575,8 @@ postgresGetForeignUpperPaths(PlannerInfo *root, UpperRelationKind stage,
  *		Add foreign path for grouping and/or aggregation.
  *
  * Given input_rel represents the underlying scan.  The paths are added to the
- * given grouped_rel.
+ * given grouped_rel, which may also be a partially grouped rel whose rows are
+ * combined by a local Finalize Aggregate, as in partitionwise aggregation.
  */
 static void
 add_foreign_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
@@ -5823,7 +6598,8 @@ add_foreign_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		return;
 
 	Assert(extra->patype == PARTITIONWISE_AGGREGATE_NONE ||
-		   extra->patype == PARTITIONWISE_AGGREGATE_FULL);
+		   extra->patype == PARTITIONWISE_AGGREGATE_FULL ||
+		   fpinfo->stage == UPPERREL_PARTIAL_GROUP_AGG);
 
 	/* save the input_rel as outerrel in fpinfo */
 	fpinfo->outerrel = input_rel;
@@ -5841,9 +6617,12 @@ add_foreign_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 	 * Assess if it is safe to push down aggregation and grouping.
 	 *
 	 * Use HAVING qual from extra. In case of child partition, it will have
-	 * translated Vars.
+	 * translated Vars.  It can only be checked once the partial results have
+	 * been combined, so ignore it when partially aggregating.
 	 */
-	if (!foreign_grouping_ok(root, grouped_rel, extra->havingQual))
+	if (!foreign_grouping_ok(root, grouped_rel,
+							 fpinfo->stage == UPPERREL_PARTIAL_GROUP_AGG ?
+							 NULL : extra->havingQual))
 		return;
 
 	/*
@@ -6249,6 +7028,89 @@ add_foreign_final_paths(PlannerInfo *root, RelOptInfo *input_rel,
 	add_path(final_rel, (Path *) final_path);
 }
 
+/*
+ * postgresIsForeignPathAsyncCapable
+ *		Check whether a given ForeignPath node can be run asynchronously.
+ */
+static bool
+postgresIsForeignPathAsyncCapable(ForeignPath *path)
+{
+	RelOptInfo *rel = ((Path *) path)->parent;
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) rel->fdw_private;
+
+	/* A parallel-aware scan claims its chunks as it goes */
+	if (path->path.parallel_aware)
+		return false;
+
+	return fpinfo->async_capable;
+}
+
+/*
+ * postgresForeignAsyncRequest
+ *		Create the cursor if needed, and send a FETCH for the next batch of
+ *		tuples if we're out of them, without waiting for the result.
+ */
+static void
+postgresForeignAsyncRequest(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	/* Creating the cursor is still a synchronous round trip */
+	if (!fsstate->cursor_exists)
+		create_cursor(node);
+
+	/* Nothing to do if a fetch is in flight or wouldn't be needed */
+	if (fsstate->conn_state->pending_scan == node ||
+		fsstate->next_tuple < fsstate->num_tuples ||
+		fsstate->eof_reached)
+		return;
+
+	/* Only one query at a time can run on the connection */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
+	fetch_more_data_begin(node);
+}
+
+/*
+ * postgresForeignAsyncReady
+ *		Report whether postgresIterateForeignScan can return without waiting
+ *		on the remote server.
+ */
+static bool
+postgresForeignAsyncReady(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	postgresForeignAsyncRequest(node);
+
+	/* Tuples are buffered, or we hit EOF */
+	if (fsstate->conn_state->pending_scan != node)
+		return true;
+
+	if (!PQconsumeInput(fsstate->conn))
+		pgfdw_report_error(ERROR, NULL, fsstate->conn, false, fsstate->query);
+
+	return !PQisBusy(fsstate->conn);
+}
+
+/*
+ * postgresForeignAsyncConfigureWait
+ *		Wait for the result of our pending FETCH to arrive, if any.
+ */
+static bool
+postgresForeignAsyncConfigureWait(ForeignScanState *node, WaitEventSet *set)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	if (fsstate->conn_state->pending_scan != node)
+		return false;
+
+	AddWaitEventToSet(set, WL_SOCKET_READABLE, PQsocket(fsstate->conn),
+					  NULL, NULL);
+	return true;
+}
+
 /*
  * Create a tuple from the specified row of the PGresult.
  *
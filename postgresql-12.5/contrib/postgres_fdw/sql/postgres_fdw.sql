@@ -2516,3 +2516,213 @@ SELECT b, avg(a), max(a), count(*) FROM pagg_tab GROUP BY b HAVING sum(a) < 700
 
 -- Clean-up
 RESET enable_partitionwise_aggregate;
+
+
+-- ===================================================================
+-- test asynchronous execution
+-- ===================================================================
+
+ALTER SERVER loopback OPTIONS (ADD async_capable 'true');
+ALTER SERVER loopback2 OPTIONS (ADD async_capable 'true');
+
+CREATE TABLE async_pt (a int, b int, c text) PARTITION BY RANGE (a);
+CREATE TABLE base_tbl1 (a int, b int, c text);
+CREATE TABLE base_tbl2 (a int, b int, c text);
+CREATE FOREIGN TABLE async_p1 PARTITION OF async_pt FOR VALUES FROM (1000) TO (2000)
+  SERVER loopback OPTIONS (table_name 'base_tbl1');
+CREATE FOREIGN TABLE async_p2 PARTITION OF async_pt FOR VALUES FROM (2000) TO (3000)
+  SERVER loopback2 OPTIONS (table_name 'base_tbl2');
+CREATE TABLE async_p3 PARTITION OF async_pt FOR VALUES FROM (3000) TO (4000);
+INSERT INTO async_p1 SELECT 1000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+INSERT INTO async_p2 SELECT 2000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+INSERT INTO async_p3 SELECT 3000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+ANALYZE async_pt;
+
+CREATE TABLE result_tbl (a int, b int, c text);
+
+-- the foreign partitions are scanned asynchronously, next to a local one
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM async_pt WHERE b % 200 = 0;
+EXPLAIN (VERBOSE, COSTS OFF)
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b % 200 = 0;
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b % 200 = 0;
+SELECT * FROM result_tbl ORDER BY a;
+SELECT count(*), sum(a), min(c), max(c) FROM async_pt;
+DELETE FROM result_tbl;
+
+-- the children are run one by one without enable_async_append
+SET enable_async_append TO false;
+EXPLAIN (VERBOSE, COSTS OFF)
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b % 200 = 0;
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b % 200 = 0;
+SELECT * FROM result_tbl ORDER BY a;
+RESET enable_async_append;
+
+-- Clean-up
+DROP TABLE async_pt;
+DROP TABLE base_tbl1;
+DROP TABLE base_tbl2;
+DROP TABLE result_tbl;
+ALTER SERVER loopback OPTIONS (DROP async_capable);
+ALTER SERVER loopback2 OPTIONS (DROP async_capable);
+
+
+-- ===================================================================
+-- test batch insert
+-- ===================================================================
+
+-- a statement trigger on the remote table records how many rows each
+-- INSERT sent by postgres_fdw carries
+CREATE TABLE batch_table (x int, y int);
+CREATE TABLE batch_stmts (id serial, n int);
+CREATE FUNCTION batch_stmt_trigfunc() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+    INSERT INTO batch_stmts (n) SELECT count(*) FROM new_rows;
+    RETURN NULL;
+END
+$$;
+CREATE TRIGGER batch_stmt_trig AFTER INSERT ON batch_table
+    REFERENCING NEW TABLE AS new_rows
+    FOR EACH STATEMENT EXECUTE PROCEDURE batch_stmt_trigfunc();
+CREATE FOREIGN TABLE ftable (x int, y int)
+    SERVER loopback OPTIONS (table_name 'batch_table', batch_size '10');
+
+EXPLAIN (VERBOSE, COSTS OFF)
+INSERT INTO ftable SELECT i, i * 10 FROM generate_series(1, 25) i;
+INSERT INTO ftable SELECT i, i * 10 FROM generate_series(1, 25) i;
+SELECT count(*), sum(x), sum(y) FROM ftable;
+SELECT n FROM batch_stmts ORDER BY id;
+TRUNCATE batch_stmts;
+
+-- rows are sent one at a time when RETURNING needs them back
+INSERT INTO ftable VALUES (26, 260), (27, 270) RETURNING *;
+SELECT n FROM batch_stmts ORDER BY id;
+TRUNCATE batch_stmts;
+
+-- COPY batches, too
+COPY ftable FROM stdin;
+28	280
+29	290
+30	300
+31	310
+32	320
+33	330
+34	340
+35	350
+36	360
+37	370
+38	380
+39	390
+\.
+
+SELECT n FROM batch_stmts ORDER BY id;
+TRUNCATE batch_stmts;
+
+-- a local AFTER ROW trigger needs each row inserted before the next
+CREATE FUNCTION batch_row_trigfunc() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+    RETURN NULL;
+END
+$$;
+CREATE TRIGGER batch_row_trig AFTER INSERT ON ftable
+    FOR EACH ROW EXECUTE PROCEDURE batch_row_trigfunc();
+INSERT INTO ftable SELECT i, i * 10 FROM generate_series(40, 42) i;
+SELECT n FROM batch_stmts ORDER BY id;
+TRUNCATE batch_stmts;
+DROP TRIGGER batch_row_trig ON ftable;
+
+-- batch_size can be set on the server, and the table's setting wins
+ALTER FOREIGN TABLE ftable OPTIONS (DROP batch_size);
+ALTER SERVER loopback OPTIONS (ADD batch_size '4');
+INSERT INTO ftable SELECT i, i * 10 FROM generate_series(43, 52) i;
+SELECT n FROM batch_stmts ORDER BY id;
+TRUNCATE batch_stmts;
+ALTER FOREIGN TABLE ftable OPTIONS (ADD batch_size '6');
+INSERT INTO ftable SELECT i, i * 10 FROM generate_series(53, 62) i;
+SELECT n FROM batch_stmts ORDER BY id;
+TRUNCATE batch_stmts;
+ALTER FOREIGN TABLE ftable OPTIONS (SET batch_size '0');
+ALTER SERVER loopback OPTIONS (DROP batch_size);
+
+-- tuple routing batches the rows of each foreign partition
+CREATE TABLE batch_pt (x int, y int) PARTITION BY RANGE (x);
+CREATE FOREIGN TABLE batch_pt_p1 PARTITION OF batch_pt FOR VALUES FROM (1000) TO (2000)
+    SERVER loopback OPTIONS (table_name 'batch_table', batch_size '3');
+CREATE TABLE batch_pt_p2 PARTITION OF batch_pt FOR VALUES FROM (2000) TO (3000);
+INSERT INTO batch_pt SELECT CASE WHEN i % 2 = 0 THEN 1000 ELSE 2000 END + i, i
+  FROM generate_series(1, 10) i;
+SELECT n FROM batch_stmts ORDER BY id;
+SELECT tableoid::regclass, * FROM batch_pt ORDER BY x;
+SELECT count(*), sum(x), sum(y) FROM batch_table;
+
+-- Clean-up
+DROP TABLE batch_pt;
+DROP FOREIGN TABLE ftable;
+DROP TABLE batch_table;
+DROP TABLE batch_stmts;
+DROP FUNCTION batch_stmt_trigfunc();
+DROP FUNCTION batch_row_trigfunc();
+
+
+-- ===================================================================
+-- test pushdown of partial aggregates and LIMIT to foreign partitions
+-- ===================================================================
+
+SET enable_partitionwise_aggregate TO true;
+
+-- count, integer sum, min and max compute their own partial states, so
+-- the partial aggregation is done remotely
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT b, count(*), sum(a), min(a), max(a) FROM pagg_tab GROUP BY b HAVING sum(a) < 700 ORDER BY 1;
+SELECT b, count(*), sum(a), min(a), max(a) FROM pagg_tab GROUP BY b HAVING sum(a) < 700 ORDER BY 1;
+
+-- but not avg, whose partial state is not its result
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT b, count(*), avg(a) FROM pagg_tab GROUP BY b HAVING avg(a) < 11 ORDER BY 1;
+SELECT b, count(*), avg(a) FROM pagg_tab GROUP BY b HAVING avg(a) < 11 ORDER BY 1;
+RESET enable_partitionwise_aggregate;
+
+-- A LIMIT above an Append of foreign partitions is passed on to each
+-- remote query when its cursor is opened, unless some conditions must be
+-- checked locally.  The remote views number the rows they produce from a
+-- sequence, which shows how many rows were computed.
+CREATE SEQUENCE plim_seq;
+CREATE TABLE plim_base (a int, b int);
+INSERT INTO plim_base SELECT i, i % 10 FROM generate_series(1, 200) i;
+CREATE VIEW plim_v1 AS SELECT a, b, nextval('plim_seq') AS n FROM plim_base WHERE a <= 100;
+CREATE VIEW plim_v2 AS SELECT a, b, nextval('plim_seq') AS n FROM plim_base WHERE a > 100;
+CREATE TABLE plim (a int, b int) PARTITION BY RANGE (a);
+CREATE FOREIGN TABLE plim_p1 PARTITION OF plim FOR VALUES FROM (1) TO (101)
+    SERVER loopback OPTIONS (table_name 'plim_v1');
+CREATE FOREIGN TABLE plim_p2 PARTITION OF plim FOR VALUES FROM (101) TO (201)
+    SERVER loopback OPTIONS (table_name 'plim_v2');
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT a, b FROM plim LIMIT 3;
+SELECT a, b FROM plim LIMIT 3;
+SELECT last_value FROM plim_seq;
+
+-- plim_ok() can't be sent to the remote server
+CREATE FUNCTION plim_ok(int) RETURNS bool LANGUAGE plpgsql IMMUTABLE AS $$
+BEGIN
+    RETURN true;
+END
+$$;
+ALTER SEQUENCE plim_seq RESTART;
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT a, b FROM plim WHERE plim_ok(b) LIMIT 3;
+SELECT a, b FROM plim WHERE plim_ok(b) LIMIT 3;
+SELECT last_value FROM plim_seq;
+
+-- the bound also applies below an ordering
+SELECT a, b FROM plim ORDER BY b, a LIMIT 3;
+SELECT a, b FROM plim ORDER BY b DESC, a DESC LIMIT 3;
+
+-- Clean-up
+DROP TABLE plim;
+DROP VIEW plim_v1;
+DROP VIEW plim_v2;
+DROP TABLE plim_base;
+DROP SEQUENCE plim_seq;
+DROP FUNCTION plim_ok(int);
@@ -19,25 +19,124 @@
 #include "access/brin_page.h"
 #include "access/brin_pageops.h"
 #include "access/brin_xlog.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
+#include "commands/progress.h"
+#include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "postmaster/autovacuum.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/freespace.h"
+#include "storage/sharedfileset.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BRIN_SHARED		UINT64CONST(0xB100000000000001)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB100000000000002)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB100000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB100000000000004)
+
+/*
+ * Number of heap blocks handed out to a parallel build participant at a
+ * time.  Each chunk is scanned separately, so it shouldn't be too small,
+ * but it is always rounded to a whole number of page ranges.
+ */
+#define BRIN_PARALLEL_CHUNK_BLOCKS		1024
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * The heap is divided into chunks of whole page ranges, which participants
+ * claim one at a time in block order.  Each participant summarizes the
+ * ranges of the chunks it claimed, and writes the resulting index tuples to
+ * its own temporary file in the shared fileset.  Since no two participants
+ * summarize the same range, and each file is in block order, the leader
+ * only has to merge the files to insert the tuples in the same order as a
+ * serial build would.
+ */
+typedef struct BrinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to open the relations
+	 * and know which blocks to scan.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	BlockNumber pagesPerRange;
+	BlockNumber nblocks;
+	BlockNumber chunkblocks;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can merge
+	 * their tuples.
+	 */
+	ConditionVariable workersdonecv;
+
+	/* Temporary files holding the participants' index tuples */
+	SharedFileSet fileset;
+
+	/* First heap block not yet claimed by any participant */
+	pg_atomic_uint64 nextblock;
+
+	/*
+	 * mutex protects all fields that follow.
+	 *
+	 * nparticipantsdone is number of worker processes finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+} BrinShared;
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct BrinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipants is the exact number of worker processes successfully
+	 * launched, plus the leader process, which always participates.
+	 */
+	int			nparticipants;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 */
+	BrinShared *brinshared;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+} BrinLeader;
+
+
 /*
  * We use a BrinBuildState during initial construction of a BRIN index.
  * The running state is kept in a BrinMemTuple.
@@ -52,8 +151,42 @@ typedef struct BrinBuildState
 	BrinRevmap *bs_rmAccess;
 	BrinDesc   *bs_bdesc;
 	BrinMemTuple *bs_dtuple;
+
+	/*
+	 * bs_leader is only present when a parallel index build is performed,
+	 * and only in the leader process.
+	 */
+	BrinLeader *bs_leader;
+
+	/*
+	 * In a participant of a parallel build, the tuples are written to this
+	 * file instead of being inserted into the index.
+	 */
+	BufFile    *bs_spoolfile;
 } BrinBuildState;
 
+/*
+ * Header of each index tuple written by a parallel build participant.  The
+ * tuple itself follows.
+ */
+typedef struct BrinSpoolTupleHeader
+{
+	BlockNumber heapBlk;
+	Size		size;
+} BrinSpoolTupleHeader;
+
+/*
+ * A participant's spool file being read back by the leader, along with its
+ * current tuple.
+ */
+typedef struct BrinSpoolFile
+{
+	BufFile    *file;
+	BlockNumber heapBlk;
+	Size		size;
+	BrinTuple  *tuple;
+} BrinSpoolFile;
+
 /*
  * Struct used as "opaque" during index scans
  */
@@ -76,6 +209,21 @@ static void union_tuples(BrinDesc *bdesc, BrinMemTuple *a,
 						 BrinTuple *b);
 static void brin_vacuum_scan(Relation idxrel, BufferAccessStrategy strategy);
 
+/* parallel index builds */
+static void _brin_begin_parallel(BrinBuildState *buildstate, Relation heap,
+								 Relation index, bool isconcurrent,
+								 int request);
+static void _brin_end_parallel(BrinLeader *brinleader);
+static double _brin_parallel_merge(BrinBuildState *state);
+static void _brin_leader_participate_as_worker(BrinBuildState *buildstate,
+											   Relation heap, Relation index);
+static void _brin_parallel_scan_and_build(BrinBuildState *state,
+										  BrinShared *brinshared,
+										  Relation heap, Relation index,
+										  int participant, bool progress);
+static bool _brin_read_spool_tuple(BrinSpoolFile *spool);
+static int	_brin_spool_cmp(Datum a, Datum b, void *arg);
+
 
 /*
  * BRIN handler function: return IndexAmRoutine with access method parameters
@@ -101,6 +249,8 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->ampredlocks = false;
 	amroutine->amcanparallel = false;
 	amroutine->amcaninclude = false;
+	amroutine->amcanwarm = false;
+	amroutine->amparallelvacuumoptions = VACUUM_OPTION_PARALLEL_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
 
 	amroutine->ambuild = brinbuild;
@@ -717,14 +867,31 @@ brinbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	state = initialize_brin_buildstate(index, revmap, pagesPerRange);
 
 	/*
-	 * Now scan the relation.  No syncscan allowed here because we want the
-	 * heap blocks in physical order.
+	 * Attempt to launch parallel worker scan when required
 	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   brinbuildCallback, (void *) state, NULL);
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_brin_begin_parallel(state, heap, index, indexInfo->ii_Concurrent,
+							 indexInfo->ii_ParallelWorkers);
 
-	/* process the final batch */
-	form_and_insert_tuple(state);
+	if (state->bs_leader)
+	{
+		/* insert the tuples summarized by all participants */
+		reltuples = _brin_parallel_merge(state);
+		_brin_end_parallel(state->bs_leader);
+	}
+	else
+	{
+		/*
+		 * Now scan the relation.  No syncscan allowed here because we want
+		 * the heap blocks in physical order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   brinbuildCallback, (void *) state,
+										   NULL);
+
+		/* process the final batch */
+		form_and_insert_tuple(state);
+	}
 
 	/* release resources */
 	idxtuples = state->bs_numtuples;
@@ -1126,6 +1293,8 @@ initialize_brin_buildstate(Relation idxRel, BrinRevmap *revmap,
 	state->bs_rmAccess = revmap;
 	state->bs_bdesc = brin_build_desc(idxRel);
 	state->bs_dtuple = brin_new_memtuple(state->bs_bdesc);
+	state->bs_leader = NULL;
+	state->bs_spoolfile = NULL;
 
 	brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
 
@@ -1403,6 +1572,9 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 /*
  * Given a deformed tuple in the build state, convert it into the on-disk
  * format and insert it into the index, making the revmap point to it.
+ *
+ * In a participant of a parallel build, the tuple is written to the
+ * participant's spool file instead, for the leader to insert.
  */
 static void
 form_and_insert_tuple(BrinBuildState *state)
@@ -1412,9 +1584,19 @@ form_and_insert_tuple(BrinBuildState *state)
 
 	tup = brin_form_tuple(state->bs_bdesc, state->bs_currRangeStart,
 						  state->bs_dtuple, &size);
-	brin_doinsert(state->bs_irel, state->bs_pagesPerRange, state->bs_rmAccess,
-				  &state->bs_currentInsertBuf, state->bs_currRangeStart,
-				  tup, size);
+	if (state->bs_spoolfile)
+	{
+		BrinSpoolTupleHeader hdr;
+
+		hdr.heapBlk = state->bs_currRangeStart;
+		hdr.size = size;
+		BufFileWrite(state->bs_spoolfile, (void *) &hdr, sizeof(hdr));
+		BufFileWrite(state->bs_spoolfile, (void *) tup, size);
+	}
+	else
+		brin_doinsert(state->bs_irel, state->bs_pagesPerRange,
+					  state->bs_rmAccess, &state->bs_currentInsertBuf,
+					  state->bs_currRangeStart, tup, size);
 	state->bs_numtuples++;
 
 	pfree(tup);
@@ -1498,3 +1680,489 @@ brin_vacuum_scan(Relation idxrel, BufferAccessStrategy strategy)
 	 */
 	FreeSpaceMapVacuum(idxrel);
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * bs_leader field, which is set here).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's BrinLeader, which caller must use to shut down parallel
+ * mode by passing it to _brin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_brin_begin_parallel(BrinBuildState *buildstate, Relation heap, Relation index,
+					 bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	BrinShared *brinshared;
+	BrinLeader *brinleader = (BrinLeader *) palloc0(sizeof(BrinLeader));
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+	BlockNumber pagesPerRange = buildstate->bs_pagesPerRange;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of brin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_brin_parallel_build_main",
+								 request);
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_BRIN_SHARED workspace.  Unlike
+	 * other index builds, we don't set up a parallel heap scan: each chunk of
+	 * page ranges is scanned on its own, with a snapshot chosen the same way
+	 * as in a serial build.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(BrinShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for BufferUsage -- PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgBufferUsage, so do
+	 * it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Same thing for WalUsage -- PARALLEL_KEY_WAL_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	brinshared = (BrinShared *) shm_toc_allocate(pcxt->toc, sizeof(BrinShared));
+	/* Initialize immutable state */
+	brinshared->heaprelid = RelationGetRelid(heap);
+	brinshared->indexrelid = RelationGetRelid(index);
+	brinshared->isconcurrent = isconcurrent;
+	brinshared->pagesPerRange = pagesPerRange;
+	brinshared->nblocks = RelationGetNumberOfBlocks(heap);
+	brinshared->chunkblocks =
+		Max(BRIN_PARALLEL_CHUNK_BLOCKS / pagesPerRange, 1) * pagesPerRange;
+	ConditionVariableInit(&brinshared->workersdonecv);
+	SharedFileSetInit(&brinshared->fileset, pcxt->seg);
+	pg_atomic_init_u64(&brinshared->nextblock, 0);
+	SpinLockInit(&brinshared->mutex);
+	/* Initialize mutable state */
+	brinshared->nparticipantsdone = 0;
+	brinshared->reltuples = 0.0;
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BRIN_SHARED, brinshared);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/* Allocate space for each worker's BufferUsage; no need to initialize */
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Same for WalUsage */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	brinleader->pcxt = pcxt;
+	brinleader->nparticipants = pcxt->nworkers_launched + 1;
+	brinleader->brinshared = brinshared;
+	brinleader->bufferusage = bufferusage;
+	brinleader->walusage = walusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_brin_end_parallel(brinleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->bs_leader = brinleader;
+
+	/* Join heap scan ourselves */
+	_brin_leader_participate_as_worker(buildstate, heap, index);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_brin_end_parallel(BrinLeader *brinleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(brinleader->pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (i = 0; i < brinleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&brinleader->bufferusage[i], &brinleader->walusage[i]);
+
+	DestroyParallelContext(brinleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Within leader, wait for all participants to finish, then insert the index
+ * tuples they wrote into the index, in block order.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_brin_parallel_merge(BrinBuildState *state)
+{
+	BrinLeader *brinleader = state->bs_leader;
+	BrinShared *brinshared = brinleader->brinshared;
+	BrinSpoolFile *spools;
+	binaryheap *heap;
+	double		reltuples;
+	int			nspools;
+	int			i;
+
+	for (;;)
+	{
+		SpinLockAcquire(&brinshared->mutex);
+		if (brinshared->nparticipantsdone == brinleader->nparticipants)
+		{
+			reltuples = brinshared->reltuples;
+			SpinLockRelease(&brinshared->mutex);
+			break;
+		}
+		SpinLockRelease(&brinshared->mutex);
+
+		ConditionVariableSleep(&brinshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	/*
+	 * Open the spool files of all participants: the launched workers are
+	 * numbered from 0, and the leader uses the number of requested workers.
+	 */
+	nspools = brinleader->nparticipants;
+	spools = (BrinSpoolFile *) palloc0(sizeof(BrinSpoolFile) * nspools);
+	heap = binaryheap_allocate(nspools, _brin_spool_cmp, spools);
+
+	for (i = 0; i < nspools; i++)
+	{
+		char		name[MAXPGPATH];
+		int			participant;
+
+		participant = (i < nspools - 1) ? i : brinleader->pcxt->nworkers;
+		snprintf(name, sizeof(name), "brin.%d", participant);
+		spools[i].file = BufFileOpenShared(&brinshared->fileset, name);
+		if (_brin_read_spool_tuple(&spools[i]))
+			binaryheap_add_unordered(heap, Int32GetDatum(i));
+	}
+	binaryheap_build(heap);
+
+	while (!binaryheap_empty(heap))
+	{
+		int			cur = DatumGetInt32(binaryheap_first(heap));
+		BrinSpoolFile *spool = &spools[cur];
+
+		/* there could be many ranges, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		brin_doinsert(state->bs_irel, state->bs_pagesPerRange,
+					  state->bs_rmAccess, &state->bs_currentInsertBuf,
+					  spool->heapBlk, spool->tuple, spool->size);
+		state->bs_numtuples++;
+
+		/* Advance this file, and drop it from the heap once exhausted */
+		if (_brin_read_spool_tuple(spool))
+			binaryheap_replace_first(heap, Int32GetDatum(cur));
+		else
+		{
+			(void) binaryheap_remove_first(heap);
+			BufFileClose(spool->file);
+			spool->file = NULL;
+		}
+	}
+
+	binaryheap_free(heap);
+	pfree(spools);
+
+	return reltuples;
+}
+
+/*
+ * Within leader, participate as a parallel worker.
+ */
+static void
+_brin_leader_participate_as_worker(BrinBuildState *buildstate, Relation heap,
+								   Relation index)
+{
+	BrinLeader *brinleader = buildstate->bs_leader;
+	BrinBuildState *leaderworker;
+
+	/* Allocate memory and initialize private build state */
+	leaderworker = initialize_brin_buildstate(index, NULL,
+											  buildstate->bs_pagesPerRange);
+
+	/* Perform work common to all participants */
+	_brin_parallel_scan_and_build(leaderworker, brinleader->brinshared,
+								  heap, index, brinleader->pcxt->nworkers,
+								  true);
+
+	terminate_brin_buildstate(leaderworker);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_brin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	BrinShared *brinshared;
+	BrinBuildState *buildstate;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up brin shared state */
+	brinshared = shm_toc_lookup(toc, PARALLEL_KEY_BRIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!brinshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(brinshared->heaprelid, heapLockmode);
+	indexRel = index_open(brinshared->indexrelid, indexLockmode);
+
+	/* Attach to the fileset our tuples go into */
+	SharedFileSetAttach(&brinshared->fileset, seg);
+
+	/* Initialize worker's own build state */
+	buildstate = initialize_brin_buildstate(indexRel, NULL,
+											brinshared->pagesPerRange);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Summarize the chunks of the heap we manage to claim */
+	_brin_parallel_scan_and_build(buildstate, brinshared, heapRel, indexRel,
+								  ParallelWorkerNumber, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	terminate_brin_buildstate(buildstate);
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build.
+ *
+ * Claims chunks of the heap until there are none left, and summarizes every
+ * page range in each of them, including ranges without any tuples.  The
+ * resulting index tuples are written to the participant's spool file.
+ *
+ * Each chunk is scanned on its own, so the snapshot is chosen just like in
+ * a serial build.  For CREATE INDEX CONCURRENTLY, that means a participant
+ * may use a somewhat newer MVCC snapshot than the leader; that's harmless,
+ * because validate_index() adds every heap tuple to a BRIN index anyway.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_brin_parallel_scan_and_build(BrinBuildState *state, BrinShared *brinshared,
+							  Relation heap, Relation index,
+							  int participant, bool progress)
+{
+	IndexInfo  *indexInfo;
+	double		reltuples = 0;
+	char		name[MAXPGPATH];
+
+	snprintf(name, sizeof(name), "brin.%d", participant);
+	state->bs_spoolfile = BufFileCreateShared(&brinshared->fileset, name);
+
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = brinshared->isconcurrent;
+
+	if (progress)
+		pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
+									 brinshared->nblocks);
+
+	for (;;)
+	{
+		uint64		start;
+		BlockNumber nblocks;
+
+		start = pg_atomic_fetch_add_u64(&brinshared->nextblock,
+										brinshared->chunkblocks);
+		if (start >= brinshared->nblocks)
+			break;
+		nblocks = Min(brinshared->chunkblocks, brinshared->nblocks - start);
+
+		/* all blocks before this chunk have been handed out by now */
+		if (progress)
+			pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE, start);
+
+		state->bs_currRangeStart = (BlockNumber) start;
+		brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
+
+		/*
+		 * brinbuildCallback emits every range up to the one containing the
+		 * last tuple of the chunk; emit the remaining ones ourselves.
+		 */
+		reltuples += table_index_build_range_scan(heap, index, indexInfo,
+												  false, false, false,
+												  (BlockNumber) start, nblocks,
+												  brinbuildCallback,
+												  (void *) state, NULL);
+		for (;;)
+		{
+			form_and_insert_tuple(state);
+			if ((uint64) state->bs_currRangeStart + state->bs_pagesPerRange >=
+				start + nblocks)
+				break;
+			state->bs_currRangeStart += state->bs_pagesPerRange;
+			brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
+		}
+	}
+
+	BufFileClose(state->bs_spoolfile);
+	state->bs_spoolfile = NULL;
+
+	/* Done.  Record ambuild statistics. */
+	SpinLockAcquire(&brinshared->mutex);
+	brinshared->nparticipantsdone++;
+	brinshared->reltuples += reltuples;
+	SpinLockRelease(&brinshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&brinshared->workersdonecv);
+}
+
+/*
+ * Read the next tuple of a spool file into *spool, replacing its current
+ * tuple.  Returns false at the end of the file.
+ */
+static bool
+_brin_read_spool_tuple(BrinSpoolFile *spool)
+{
+	BrinSpoolTupleHeader hdr;
+	size_t		nread;
+
+	if (spool->tuple)
+		pfree(spool->tuple);
+	spool->tuple = NULL;
+
+	nread = BufFileRead(spool->file, (void *) &hdr, sizeof(hdr));
+	if (nread == 0)				/* end of file */
+		return false;
+	if (nread != sizeof(hdr))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from BRIN build temporary file: read only %zu of %zu bytes",
+						nread, sizeof(hdr))));
+
+	spool->heapBlk = hdr.heapBlk;
+	spool->size = hdr.size;
+	spool->tuple = (BrinTuple *) palloc(hdr.size);
+	nread = BufFileRead(spool->file, (void *) spool->tuple, hdr.size);
+	if (nread != hdr.size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from BRIN build temporary file: read only %zu of %zu bytes",
+						nread, hdr.size)));
+
+	return true;
+}
+
+/*
+ * Comparator for the binary heap used to merge spool files.  binaryheap.c
+ * keeps the largest element on top, so invert the block number ordering.
+ */
+static int
+_brin_spool_cmp(Datum a, Datum b, void *arg)
+{
+	BrinSpoolFile *spools = (BrinSpoolFile *) arg;
+	BlockNumber blka = spools[DatumGetInt32(a)].heapBlk;
+	BlockNumber blkb = spools[DatumGetInt32(b)].heapBlk;
+
+	if (blka > blkb)
+		return -1;
+	else if (blka < blkb)
+		return 1;
+	return 0;
+}
@@ -0,0 +1,444 @@
+/*
+ * brin_bloom.c
+ *		Implementation of Bloom opclass for BRIN
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * A BRIN opclass summarizing page range into a bloom filter.
+ *
+ * Bloom filters allow efficient testing whether a given page range contains
+ * a particular value.  Therefore, if we summarize each page range into a
+ * bloom filter, we can easily and cheaply test whether it contains values
+ * we get later.
+ *
+ * The index only supports equality operators, similarly to hash indexes.
+ * Bloom indexes are however much smaller, and support only bitmap scans.
+ *
+ * Note: Don't confuse this with bloom indexes, implemented in a contrib
+ * module.  That extension implements an entirely new AM, building a bloom
+ * filter on multiple columns in a single row.  This opclass works with an
+ * existing AM (BRIN) and builds bloom filter on a column.
+ *
+ *
+ * sizing the bloom filter
+ * -----------------------
+ *
+ * Size of a bloom filter depends on the number of distinct values we will
+ * store in it, and the desired false positive rate.  The higher the number
+ * of distinct values and/or the lower the false positive rate, the larger
+ * the bloom filter.  On the other hand, we want to keep the index as small
+ * as possible - that's one of the basic advantages of BRIN indexes.
+ *
+ * We estimate the number of distinct values in a page range as a fraction
+ * of the maximum number of tuples that can fit into the range (see
+ * BLOOM_NDISTINCT_PER_RANGE), and aim for a false positive rate of
+ * BLOOM_FALSE_POSITIVE_RATE.  The resulting filter is capped so that it
+ * always fits on a BRIN page, which means the false positive rate for very
+ * large ranges may end up higher than requested.
+ *
+ * The filter is stored as a bytea value, and all the ranges of a given
+ * index use a filter of the same size, so filters can be merged by simply
+ * OR-ing the bitmaps.
+ *
+ *
+ * hashing
+ * -------
+ *
+ * We use the type's regular hash function (support procedure 11) to hash
+ * the value into a 32-bit value, and then derive the bloom filter hashes
+ * from it using double hashing, as proposed by Kirsch and Mitzenmacher in
+ * "Less Hashing, Same Performance: Building a Better Bloom Filter".
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_bloom.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin.h"
+#include "access/brin_internal.h"
+#include "access/brin_page.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "port/pg_bitutils.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/hashutils.h"
+#include "utils/rel.h"
+
+
+/* Bloom opclasses only support the equality strategy */
+#define BloomEqualStrategyNumber	1
+
+/* support procedure numbers */
+#define BLOOM_HASH_PROCNUM			11	/* hash function of the data type */
+
+/*
+ * Number of distinct values expected in a page range.  Negative values are
+ * interpreted as a fraction of the maximum number of tuples in the range
+ * (similarly to pg_statistic.stadistinct), which makes the estimate scale
+ * with pages_per_range.
+ */
+#define BLOOM_NDISTINCT_PER_RANGE	(-0.1)
+
+/* never size the filter for fewer distinct values than this */
+#define BLOOM_MIN_NDISTINCT_PER_RANGE	16
+
+/* desired false positive rate */
+#define BLOOM_FALSE_POSITIVE_RATE	0.01
+
+/* seeds used to derive the two independent hashes from the value hash */
+#define BLOOM_SEED_1	0x71d924af
+#define BLOOM_SEED_2	0xba48b314
+
+/*
+ * Maximum size of the bloom filter, so that a BRIN tuple containing it
+ * (and nothing else) still fits on a single index page.
+ */
+#define BloomMaxFilterSize \
+	MAXALIGN_DOWN(BLCKSZ - \
+				  (MAXALIGN(SizeOfPageHeaderData + \
+							sizeof(ItemIdData)) + \
+				   MAXALIGN(sizeof(BrinSpecialSpace)) + \
+				   SizeOfBrinTuple))
+
+/*
+ * Bloom filter, stored on-disk as a varlena.
+ *
+ * nbits is always a multiple of 8, so that the bitmap consists of whole
+ * bytes, and nbits_set tracks the number of bits set (useful for debugging
+ * and to detect saturated filters).
+ */
+typedef struct BloomFilter
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	uint32		nhashes;		/* number of hash functions */
+	uint32		nbits;			/* number of bits in the bitmap */
+	uint32		nbits_set;		/* number of bits set to 1 */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} BloomFilter;
+
+#define BloomFilterSize(nbits) \
+	(offsetof(BloomFilter, data) + (nbits) / 8)
+
+
+static BloomFilter *bloom_init(Relation index);
+static bool bloom_add_value(BloomFilter *filter, uint32 value);
+static bool bloom_contains_value(BloomFilter *filter, uint32 value);
+static uint32 bloom_hash_value(BrinDesc *bdesc, AttrNumber attno,
+							   Oid colloid, Datum value);
+
+
+/*
+ * Create a bloom filter sized for the page ranges of the given index.
+ *
+ * The optimal number of bits m for n distinct values and false positive
+ * rate p is
+ *
+ *		m = -n * ln(p) / (ln(2))^2
+ *
+ * and the optimal number of hash functions is
+ *
+ *		k = ln(2) * m / n
+ */
+static BloomFilter *
+bloom_init(Relation index)
+{
+	BloomFilter *filter;
+	double		ndistinct;
+	double		nbits;
+	int			nhashes;
+	Size		len;
+
+	ndistinct = BLOOM_NDISTINCT_PER_RANGE;
+	if (ndistinct < 0)
+		ndistinct = -ndistinct * MaxHeapTuplesPerPage *
+			BrinGetPagesPerRange(index);
+	ndistinct = Max(ndistinct, BLOOM_MIN_NDISTINCT_PER_RANGE);
+
+	nbits = ceil(-(ndistinct * log(BLOOM_FALSE_POSITIVE_RATE)) /
+				 pow(log(2.0), 2));
+
+	/* round to whole bytes, and don't exceed what fits on a page */
+	nbits = ((int) ceil(nbits / 8)) * 8;
+	nbits = Min(nbits, (BloomMaxFilterSize - offsetof(BloomFilter, data)) * 8);
+
+	nhashes = (int) rint(log(2.0) * nbits / ndistinct);
+	nhashes = Max(nhashes, 1);
+
+	len = BloomFilterSize((uint32) nbits);
+
+	filter = (BloomFilter *) palloc0(len);
+	SET_VARSIZE(filter, len);
+	filter->nhashes = nhashes;
+	filter->nbits = (uint32) nbits;
+
+	return filter;
+}
+
+/*
+ * Add a hashed value to the bloom filter.  Returns true if any bit of the
+ * filter changed.
+ */
+static bool
+bloom_add_value(BloomFilter *filter, uint32 value)
+{
+	uint64		h1,
+				h2;
+	uint32		i;
+	bool		updated = false;
+
+	h1 = DatumGetUInt64(hash_uint32_extended(value, BLOOM_SEED_1)) % filter->nbits;
+	h2 = DatumGetUInt64(hash_uint32_extended(value, BLOOM_SEED_2)) % filter->nbits;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		h = (h1 + i * h2) % filter->nbits;
+		uint32		byte = (h / 8);
+		uint32		bit = (h % 8);
+
+		if (!(filter->data[byte] & (0x01 << bit)))
+		{
+			filter->data[byte] |= (0x01 << bit);
+			filter->nbits_set++;
+			updated = true;
+		}
+	}
+
+	return updated;
+}
+
+/*
+ * Check if the bloom filter may contain the given hashed value.  False
+ * positives are possible, false negatives are not.
+ */
+static bool
+bloom_contains_value(BloomFilter *filter, uint32 value)
+{
+	uint64		h1,
+				h2;
+	uint32		i;
+
+	h1 = DatumGetUInt64(hash_uint32_extended(value, BLOOM_SEED_1)) % filter->nbits;
+	h2 = DatumGetUInt64(hash_uint32_extended(value, BLOOM_SEED_2)) % filter->nbits;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		h = (h1 + i * h2) % filter->nbits;
+		uint32		byte = (h / 8);
+		uint32		bit = (h % 8);
+
+		if (!(filter->data[byte] & (0x01 << bit)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Hash a value using the hash function of the indexed data type.
+ */
+static uint32
+bloom_hash_value(BrinDesc *bdesc, AttrNumber attno, Oid colloid, Datum value)
+{
+	FmgrInfo   *hashFn;
+
+	hashFn = index_getprocinfo(bdesc->bd_index, attno, BLOOM_HASH_PROCNUM);
+
+	return DatumGetUInt32(FunctionCall1Coll(hashFn, colloid, value));
+}
+
+Datum
+brin_bloom_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/*
+	 * We store the bloom filter as a single bytea value, regardless of the
+	 * indexed data type.
+	 */
+	result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)));
+	result->oi_nstored = 1;
+	result->oi_opaque = NULL;
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value is not already represented in the bloom filter,
+ * add it and return true.  Otherwise, return false and do not modify in this
+ * case.
+ */
+Datum
+brin_bloom_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	BloomFilter *filter;
+	uint32		hashValue;
+	bool		updated;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	/*
+	 * If this is the first non-null value, we need to initialize the bloom
+	 * filter.  Otherwise just extract the existing one.  The stored value may
+	 * have a short varlena header, in which case detoasting makes a copy;
+	 * either way, we store the (possibly new) pointer back below.
+	 */
+	if (column->bv_allnulls)
+		filter = bloom_init(bdesc->bd_index);
+	else
+		filter = (BloomFilter *) PG_DETOAST_DATUM(column->bv_values[0]);
+
+	hashValue = bloom_hash_value(bdesc, column->bv_attno, colloid, newval);
+
+	updated = bloom_add_value(filter, hashValue);
+
+	if (column->bv_allnulls)
+	{
+		column->bv_allnulls = false;
+		updated = true;
+	}
+
+	column->bv_values[0] = PointerGetDatum(filter);
+
+	PG_RETURN_BOOL(updated);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key is consistent with the index tuple's bloom
+ * filter.  Return true if so, false otherwise.
+ */
+Datum
+brin_bloom_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	BloomFilter *filter;
+	uint32		hashValue;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	if (key->sk_strategy != BloomEqualStrategyNumber)
+		elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+
+	filter = (BloomFilter *) PG_DETOAST_DATUM(column->bv_values[0]);
+
+	hashValue = bloom_hash_value(bdesc, key->sk_attno, colloid,
+								 key->sk_argument);
+
+	PG_RETURN_BOOL(bloom_contains_value(filter, hashValue));
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ *
+ * All the filters of an index have the same parameters, so the union is
+ * simply a bitwise OR of the bitmaps.
+ */
+Datum
+brin_bloom_union(PG_FUNCTION_ARGS)
+{
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	BloomFilter *filter_a;
+	BloomFilter *filter_b;
+	uint32		i;
+	uint32		nbytes;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	filter_b = (BloomFilter *) PG_DETOAST_DATUM(col_b->bv_values[0]);
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the filter from
+	 * B into A, and we're done.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(PointerGetDatum(filter_b), false, -1);
+		PG_RETURN_VOID();
+	}
+
+	/* make a private copy of A, so that we can modify it */
+	filter_a = (BloomFilter *) PG_DETOAST_DATUM_COPY(col_a->bv_values[0]);
+
+	if (filter_a->nbits != filter_b->nbits ||
+		filter_a->nhashes != filter_b->nhashes)
+		elog(ERROR, "cannot merge bloom filters with different parameters");
+
+	nbytes = filter_a->nbits / 8;
+
+	for (i = 0; i < nbytes; i++)
+		filter_a->data[i] |= filter_b->data[i];
+
+	filter_a->nbits_set = (uint32) pg_popcount(filter_a->data, nbytes);
+
+	col_a->bv_values[0] = PointerGetDatum(filter_a);
+
+	PG_RETURN_VOID();
+}
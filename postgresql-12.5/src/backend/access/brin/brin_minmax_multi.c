@@ -0,0 +1,879 @@
+/*
+ * brin_minmax_multi.c
+ *		Implementation of Multi Min/Max opclass for BRIN
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * Implements a variant of minmax opclass, where the summary is composed of
+ * multiple smaller intervals.  This allows us to handle outliers, which
+ * usually make the simple minmax opclass inefficient.
+ *
+ * Consider for example page range with simple minmax interval [1000,2000],
+ * and assume a new row gets inserted into the range with value 1000000.
+ * Due to that the interval gets [1000,1000000].  I.e. the minmax interval
+ * got 1000x wider and won't be useful to eliminate scan keys between 2001
+ * and 1000000.
+ *
+ * With multi-minmax opclass, we may have [1000,2000] interval initially,
+ * but after adding the new row we start tracking it as two interval:
+ *
+ *   [1000,2000] and [1000000,1000000]
+ *
+ * This allows us to still eliminate the page range when the scan keys hit
+ * the gap between 2000 and 1000000, making it useful in cases when the
+ * simple minmax opclass gets inefficient.
+ *
+ * The number of intervals tracked per page range is limited to
+ * MINMAX_MULTI_MAX_RANGES.  Once a new value would exceed that, we merge
+ * the closest intervals, using the "distance" support procedure (number 11)
+ * to decide which gaps between neighboring intervals are the smallest, and
+ * thus the least useful for eliminating page ranges.  We compact down to
+ * half the limit, so that the merging cost is amortized over many inserts.
+ *
+ * The intervals are kept sorted and non-overlapping, and are stored in a
+ * single bytea value (see SerializedRanges), regardless of the indexed
+ * data type.
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_minmax_multi.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/stratnum.h"
+#include "access/tupmacs.h"
+#include "catalog/pg_amop.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datum.h"
+#include "utils/float.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+
+
+/* support procedure numbers */
+#define MINMAX_MULTI_DISTANCE_PROCNUM	11	/* distance between two values */
+
+/* maximum number of intervals tracked for a single page range */
+#define MINMAX_MULTI_MAX_RANGES		32
+
+typedef struct MinmaxMultiOpaque
+{
+	Oid			cached_subtype;
+	FmgrInfo	strategy_procinfos[BTMaxStrategyNumber];
+} MinmaxMultiOpaque;
+
+/*
+ * In-memory representation of the summary: a sorted array of non-overlapping
+ * intervals, stored as 2 * nranges values [min0, max0, min1, max1, ...].
+ */
+typedef struct Ranges
+{
+	Oid			typid;			/* data type of the values */
+	int			nranges;		/* number of intervals */
+	int			maxranges;		/* allocated size of the values array */
+	Datum	   *values;
+} Ranges;
+
+/*
+ * On-disk representation of the summary.  The values are stored one after
+ * another without any alignment, so they need to be copied out before use.
+ */
+typedef struct SerializedRanges
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	Oid			typid;			/* data type of the values */
+	int32		nranges;		/* number of intervals */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} SerializedRanges;
+
+/* a gap between two neighboring intervals, used when compacting */
+typedef struct RangeGap
+{
+	int			index;			/* gap between ranges index and index + 1 */
+	double		distance;
+} RangeGap;
+
+/* context for sorting intervals by their minimum value */
+typedef struct RangesSortContext
+{
+	FmgrInfo   *cmpFn;			/* "less than" operator */
+	Oid			colloid;
+} RangesSortContext;
+
+static FmgrInfo *minmax_multi_get_strategy_procinfo(BrinDesc *bdesc,
+													uint16 attno, Oid subtype,
+													uint16 strategynum);
+static Ranges *ranges_allocate(Oid typid, int maxranges);
+static SerializedRanges *ranges_serialize(Ranges *ranges,
+										  Form_pg_attribute attr);
+static Ranges *ranges_deserialize(SerializedRanges *serialized,
+								  Form_pg_attribute attr);
+static void ranges_compact(BrinDesc *bdesc, Ranges *ranges,
+						   Form_pg_attribute attr, Oid colloid,
+						   int maxranges);
+static int	compare_gaps(const void *a, const void *b);
+static int	compare_ranges(const void *a, const void *b, void *arg);
+
+
+Datum
+brin_minmax_multi_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/*
+	 * opaque->strategy_procinfos is initialized lazily; here it is set to
+	 * all-uninitialized by palloc0 which sets fn_oid to InvalidOid.
+	 *
+	 * The summary is stored as a single bytea value, regardless of the
+	 * indexed data type.
+	 */
+
+	result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)) +
+					 sizeof(MinmaxMultiOpaque));
+	result->oi_nstored = 1;
+	result->oi_opaque = (MinmaxMultiOpaque *)
+		MAXALIGN((char *) result + SizeofBrinOpcInfo(1));
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value is not covered by any of the intervals stored in
+ * the existing tuple, add it as a new interval (merging the closest intervals
+ * if there are too many of them), update the index tuple and return true.
+ * Otherwise, return false and do not modify in this case.
+ */
+Datum
+brin_minmax_multi_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *cmpFn;
+	Ranges	   *ranges;
+	Form_pg_attribute attr;
+	AttrNumber	attno;
+	int			start,
+				end;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	attno = column->bv_attno;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	/*
+	 * If the recorded value is null, store the new value (which we know to be
+	 * not null) as a single-value interval, and we're done.
+	 */
+	if (column->bv_allnulls)
+	{
+		ranges = ranges_allocate(attr->atttypid, 1);
+		ranges->values[0] = datumCopy(newval, attr->attbyval, attr->attlen);
+		ranges->values[1] = ranges->values[0];
+		ranges->nranges = 1;
+
+		column->bv_values[0] = PointerGetDatum(ranges_serialize(ranges, attr));
+		column->bv_allnulls = false;
+		PG_RETURN_BOOL(true);
+	}
+
+	ranges = ranges_deserialize((SerializedRanges *)
+								PG_DETOAST_DATUM(column->bv_values[0]),
+								attr);
+
+	/*
+	 * Binary search for the first interval whose maximum is not less than
+	 * the new value.  If its minimum is not greater than the new value,
+	 * the value is already covered and there's nothing to do.
+	 */
+	cmpFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											   BTLessStrategyNumber);
+	start = 0;
+	end = ranges->nranges;
+	while (start < end)
+	{
+		int			mid = start + (end - start) / 2;
+
+		if (DatumGetBool(FunctionCall2Coll(cmpFn, colloid,
+										   ranges->values[2 * mid + 1],
+										   newval)))
+			start = mid + 1;
+		else
+			end = mid;
+	}
+
+	if (start < ranges->nranges &&
+		!DatumGetBool(FunctionCall2Coll(cmpFn, colloid,
+										newval, ranges->values[2 * start])))
+		PG_RETURN_BOOL(false);
+
+	/* insert the new value as a single-value interval at position start */
+	if (ranges->nranges == ranges->maxranges)
+	{
+		ranges->maxranges++;
+		ranges->values = repalloc(ranges->values,
+								  2 * ranges->maxranges * sizeof(Datum));
+	}
+	memmove(&ranges->values[2 * (start + 1)], &ranges->values[2 * start],
+			2 * (ranges->nranges - start) * sizeof(Datum));
+	ranges->values[2 * start] = datumCopy(newval, attr->attbyval,
+										  attr->attlen);
+	ranges->values[2 * start + 1] = ranges->values[2 * start];
+	ranges->nranges++;
+
+	/* if there are too many intervals, merge the closest ones */
+	if (ranges->nranges > MINMAX_MULTI_MAX_RANGES)
+		ranges_compact(bdesc, ranges, attr, colloid,
+					   MINMAX_MULTI_MAX_RANGES / 2);
+
+	column->bv_values[0] = PointerGetDatum(ranges_serialize(ranges, attr));
+
+	PG_RETURN_BOOL(true);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key is consistent with the index tuple's intervals.
+ * Return true if so, false otherwise.
+ */
+Datum
+brin_minmax_multi_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION(),
+				subtype;
+	AttrNumber	attno;
+	Datum		value;
+	Datum		matches;
+	FmgrInfo   *finfo;
+	Ranges	   *ranges;
+	int			i;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	attno = key->sk_attno;
+	subtype = key->sk_subtype;
+	value = key->sk_argument;
+
+	ranges = ranges_deserialize((SerializedRanges *)
+								PG_DETOAST_DATUM(column->bv_values[0]),
+								TupleDescAttr(bdesc->bd_tupdesc, attno - 1));
+
+	switch (key->sk_strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			/* only the overall minimum matters */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = FunctionCall2Coll(finfo, colloid, ranges->values[0],
+										value);
+			break;
+		case BTEqualStrategyNumber:
+
+			/*
+			 * In the equality case (WHERE col = someval), we want to return
+			 * the current page range if any of the intervals has minimum <=
+			 * scan key and maximum >= scan key.
+			 */
+			matches = BoolGetDatum(false);
+			for (i = 0; i < ranges->nranges; i++)
+			{
+				finfo = minmax_multi_get_strategy_procinfo(bdesc, attno,
+														   subtype,
+														   BTLessEqualStrategyNumber);
+				if (!DatumGetBool(FunctionCall2Coll(finfo, colloid,
+													ranges->values[2 * i],
+													value)))
+				{
+					/* intervals are sorted, so no later one can match */
+					break;
+				}
+
+				finfo = minmax_multi_get_strategy_procinfo(bdesc, attno,
+														   subtype,
+														   BTGreaterEqualStrategyNumber);
+				if (DatumGetBool(FunctionCall2Coll(finfo, colloid,
+												   ranges->values[2 * i + 1],
+												   value)))
+				{
+					matches = BoolGetDatum(true);
+					break;
+				}
+			}
+			break;
+		case BTGreaterEqualStrategyNumber:
+		case BTGreaterStrategyNumber:
+			/* only the overall maximum matters */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = FunctionCall2Coll(finfo, colloid,
+										ranges->values[2 * ranges->nranges - 1],
+										value);
+			break;
+		default:
+			/* shouldn't happen */
+			elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+			matches = 0;
+			break;
+	}
+
+	PG_RETURN_DATUM(matches);
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_minmax_multi_union(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	AttrNumber	attno;
+	Form_pg_attribute attr;
+	Ranges	   *ranges_a;
+	Ranges	   *ranges_b;
+	Ranges	   *result;
+	RangesSortContext cxt;
+	int			i;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	attno = col_a->bv_attno;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the values from
+	 * B into A, and we're done.  We cannot run the operators in this case,
+	 * because values in A might contain garbage.  Note we already established
+	 * that B contains values.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(col_b->bv_values[0], false, -1);
+		PG_RETURN_VOID();
+	}
+
+	ranges_a = ranges_deserialize((SerializedRanges *)
+								  PG_DETOAST_DATUM(col_a->bv_values[0]),
+								  attr);
+	ranges_b = ranges_deserialize((SerializedRanges *)
+								  PG_DETOAST_DATUM(col_b->bv_values[0]),
+								  attr);
+
+	/* concatenate the intervals and sort them by their minimum */
+	result = ranges_allocate(attr->atttypid,
+							 ranges_a->nranges + ranges_b->nranges);
+	memcpy(result->values, ranges_a->values,
+		   2 * ranges_a->nranges * sizeof(Datum));
+	memcpy(&result->values[2 * ranges_a->nranges], ranges_b->values,
+		   2 * ranges_b->nranges * sizeof(Datum));
+
+	cxt.cmpFn = minmax_multi_get_strategy_procinfo(bdesc, attno,
+												   attr->atttypid,
+												   BTLessStrategyNumber);
+	cxt.colloid = colloid;
+	qsort_arg(result->values, ranges_a->nranges + ranges_b->nranges,
+			  2 * sizeof(Datum), compare_ranges, &cxt);
+
+	/* merge overlapping intervals */
+	result->nranges = 1;
+	for (i = 1; i < ranges_a->nranges + ranges_b->nranges; i++)
+	{
+		Datum	   *last = &result->values[2 * (result->nranges - 1)];
+		Datum	   *next = &result->values[2 * i];
+
+		if (!DatumGetBool(FunctionCall2Coll(cxt.cmpFn, colloid,
+											last[1], next[0])))
+		{
+			/* overlapping (or adjacent), so extend the last interval */
+			if (DatumGetBool(FunctionCall2Coll(cxt.cmpFn, colloid,
+											   last[1], next[1])))
+				last[1] = next[1];
+		}
+		else
+		{
+			result->values[2 * result->nranges] = next[0];
+			result->values[2 * result->nranges + 1] = next[1];
+			result->nranges++;
+		}
+	}
+
+	if (result->nranges > MINMAX_MULTI_MAX_RANGES)
+		ranges_compact(bdesc, result, attr, colloid,
+					   MINMAX_MULTI_MAX_RANGES / 2);
+
+	col_a->bv_values[0] = PointerGetDatum(ranges_serialize(result, attr));
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Merge the closest neighboring intervals, until there are at most
+ * maxranges intervals left.
+ */
+static void
+ranges_compact(BrinDesc *bdesc, Ranges *ranges, Form_pg_attribute attr,
+			   Oid colloid, int maxranges)
+{
+	FmgrInfo   *distanceFn;
+	RangeGap   *gaps;
+	bool	   *merge;
+	int			ngaps = ranges->nranges - 1;
+	int			nmerge = ranges->nranges - maxranges;
+	int			i,
+				n;
+
+	if (nmerge <= 0)
+		return;
+
+	distanceFn = index_getprocinfo(bdesc->bd_index, attr->attnum,
+								   MINMAX_MULTI_DISTANCE_PROCNUM);
+
+	/* compute distances between all neighboring intervals */
+	gaps = palloc(ngaps * sizeof(RangeGap));
+	for (i = 0; i < ngaps; i++)
+	{
+		gaps[i].index = i;
+		gaps[i].distance =
+			DatumGetFloat8(FunctionCall2Coll(distanceFn, colloid,
+											 ranges->values[2 * i + 1],
+											 ranges->values[2 * i + 2]));
+	}
+
+	/* pick the smallest gaps, and remember which intervals to merge */
+	qsort(gaps, ngaps, sizeof(RangeGap), compare_gaps);
+
+	merge = palloc0(ngaps * sizeof(bool));
+	for (i = 0; i < nmerge; i++)
+		merge[gaps[i].index] = true;
+
+	/*
+	 * Merge interval i + 1 into interval i whenever the gap between them was
+	 * chosen.  The intervals are sorted and non-overlapping, so merging only
+	 * requires extending the maximum of the current interval.
+	 */
+	n = 0;
+	for (i = 1; i < ranges->nranges; i++)
+	{
+		if (merge[i - 1])
+			ranges->values[2 * n + 1] = ranges->values[2 * i + 1];
+		else
+		{
+			n++;
+			ranges->values[2 * n] = ranges->values[2 * i];
+			ranges->values[2 * n + 1] = ranges->values[2 * i + 1];
+		}
+	}
+	ranges->nranges = n + 1;
+
+	Assert(ranges->nranges == maxranges);
+
+	pfree(gaps);
+	pfree(merge);
+}
+
+static Ranges *
+ranges_allocate(Oid typid, int maxranges)
+{
+	Ranges	   *ranges = palloc(sizeof(Ranges));
+
+	ranges->typid = typid;
+	ranges->nranges = 0;
+	ranges->maxranges = maxranges;
+	ranges->values = palloc(2 * maxranges * sizeof(Datum));
+
+	return ranges;
+}
+
+/*
+ * Build the on-disk representation of the intervals.
+ */
+static SerializedRanges *
+ranges_serialize(Ranges *ranges, Form_pg_attribute attr)
+{
+	SerializedRanges *serialized;
+	Size		len;
+	char	   *ptr;
+	int			nvalues = 2 * ranges->nranges;
+	int			i;
+
+	/* compute the total length of the values */
+	len = offsetof(SerializedRanges, data);
+	if (attr->attlen > 0)
+		len += nvalues * attr->attlen;
+	else if (attr->attlen == -1)
+	{
+		for (i = 0; i < nvalues; i++)
+		{
+			ranges->values[i] = PointerGetDatum(PG_DETOAST_DATUM(ranges->values[i]));
+			len += VARSIZE(DatumGetPointer(ranges->values[i]));
+		}
+	}
+	else
+	{
+		Assert(attr->attlen == -2);
+		for (i = 0; i < nvalues; i++)
+			len += strlen(DatumGetCString(ranges->values[i])) + 1;
+	}
+
+	serialized = (SerializedRanges *) palloc0(len);
+	SET_VARSIZE(serialized, len);
+	serialized->typid = ranges->typid;
+	serialized->nranges = ranges->nranges;
+
+	ptr = serialized->data;
+	for (i = 0; i < nvalues; i++)
+	{
+		if (attr->attbyval)
+		{
+			Datum		tmp;
+
+			/* store_att_byval needs an aligned destination */
+			store_att_byval(&tmp, ranges->values[i], attr->attlen);
+			memcpy(ptr, &tmp, attr->attlen);
+			ptr += attr->attlen;
+		}
+		else if (attr->attlen > 0)
+		{
+			memcpy(ptr, DatumGetPointer(ranges->values[i]), attr->attlen);
+			ptr += attr->attlen;
+		}
+		else if (attr->attlen == -1)
+		{
+			Size		vlen = VARSIZE(DatumGetPointer(ranges->values[i]));
+
+			memcpy(ptr, DatumGetPointer(ranges->values[i]), vlen);
+			ptr += vlen;
+		}
+		else
+		{
+			Size		slen = strlen(DatumGetCString(ranges->values[i])) + 1;
+
+			memcpy(ptr, DatumGetPointer(ranges->values[i]), slen);
+			ptr += slen;
+		}
+	}
+
+	Assert(ptr == (char *) serialized + len);
+
+	return serialized;
+}
+
+/*
+ * Build the in-memory representation of the intervals.  The values are
+ * copied out of the serialized representation, so they are properly
+ * aligned and independent of it.
+ */
+static Ranges *
+ranges_deserialize(SerializedRanges *serialized, Form_pg_attribute attr)
+{
+	Ranges	   *ranges;
+	char	   *ptr;
+	int			nvalues = 2 * serialized->nranges;
+	int			i;
+
+	Assert(serialized->typid == attr->atttypid);
+
+	/* leave room for one more interval, added by the caller */
+	ranges = ranges_allocate(serialized->typid, serialized->nranges + 1);
+	ranges->nranges = serialized->nranges;
+
+	ptr = serialized->data;
+	for (i = 0; i < nvalues; i++)
+	{
+		if (attr->attbyval)
+		{
+			Datum		tmp = 0;
+
+			memcpy(&tmp, ptr, attr->attlen);
+			ranges->values[i] = fetch_att(&tmp, true, attr->attlen);
+			ptr += attr->attlen;
+		}
+		else if (attr->attlen > 0)
+		{
+			char	   *val = palloc(attr->attlen);
+
+			memcpy(val, ptr, attr->attlen);
+			ranges->values[i] = PointerGetDatum(val);
+			ptr += attr->attlen;
+		}
+		else if (attr->attlen == -1)
+		{
+			varattrib_4b hdr;
+			Size		vlen;
+			char	   *val;
+
+			/* the header may be unaligned, so copy it out first */
+			memcpy(&hdr, ptr, VARHDRSZ);
+			vlen = VARSIZE(&hdr);
+			val = palloc(vlen);
+			memcpy(val, ptr, vlen);
+			ranges->values[i] = PointerGetDatum(val);
+			ptr += vlen;
+		}
+		else
+		{
+			Size		slen = strlen(ptr) + 1;
+			char	   *val = palloc(slen);
+
+			memcpy(val, ptr, slen);
+			ranges->values[i] = PointerGetDatum(val);
+			ptr += slen;
+		}
+	}
+
+	Assert(ptr == (char *) serialized + VARSIZE(serialized));
+
+	return ranges;
+}
+
+/*
+ * qsort comparator for gaps, sorting them by distance (and then by position,
+ * to make the result deterministic).
+ */
+static int
+compare_gaps(const void *a, const void *b)
+{
+	const RangeGap *ga = (const RangeGap *) a;
+	const RangeGap *gb = (const RangeGap *) b;
+
+	if (ga->distance < gb->distance)
+		return -1;
+	else if (ga->distance > gb->distance)
+		return 1;
+
+	return ga->index - gb->index;
+}
+
+/*
+ * qsort_arg comparator for intervals, sorting them by minimum value.
+ */
+static int
+compare_ranges(const void *a, const void *b, void *arg)
+{
+	const Datum *ra = (const Datum *) a;
+	const Datum *rb = (const Datum *) b;
+	RangesSortContext *cxt = (RangesSortContext *) arg;
+
+	if (DatumGetBool(FunctionCall2Coll(cxt->cmpFn, cxt->colloid,
+									   ra[0], rb[0])))
+		return -1;
+	else if (DatumGetBool(FunctionCall2Coll(cxt->cmpFn, cxt->colloid,
+											rb[0], ra[0])))
+		return 1;
+
+	return 0;
+}
+
+/*
+ * Cache and return the procedure for the given strategy.
+ *
+ * Note: this function mirrors minmax_get_strategy_procinfo; see notes
+ * there.  If changes are made here, see that function too.
+ */
+static FmgrInfo *
+minmax_multi_get_strategy_procinfo(BrinDesc *bdesc, uint16 attno, Oid subtype,
+								   uint16 strategynum)
+{
+	MinmaxMultiOpaque *opaque;
+
+	Assert(strategynum >= 1 &&
+		   strategynum <= BTMaxStrategyNumber);
+
+	opaque = (MinmaxMultiOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+
+	/*
+	 * We cache the procedures for the previous subtype in the opaque struct,
+	 * to avoid repetitive syscache lookups.  If the subtype changed,
+	 * invalidate all the cached entries.
+	 */
+	if (opaque->cached_subtype != subtype)
+	{
+		uint16		i;
+
+		for (i = 1; i <= BTMaxStrategyNumber; i++)
+			opaque->strategy_procinfos[i - 1].fn_oid = InvalidOid;
+		opaque->cached_subtype = subtype;
+	}
+
+	if (opaque->strategy_procinfos[strategynum - 1].fn_oid == InvalidOid)
+	{
+		Form_pg_attribute attr;
+		HeapTuple	tuple;
+		Oid			opfamily,
+					oprid;
+		bool		isNull;
+
+		opfamily = bdesc->bd_index->rd_opfamily[attno - 1];
+		attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+		tuple = SearchSysCache4(AMOPSTRATEGY, ObjectIdGetDatum(opfamily),
+								ObjectIdGetDatum(attr->atttypid),
+								ObjectIdGetDatum(subtype),
+								Int16GetDatum(strategynum));
+
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 strategynum, attr->atttypid, subtype, opfamily);
+
+		oprid = DatumGetObjectId(SysCacheGetAttr(AMOPSTRATEGY, tuple,
+												 Anum_pg_amop_amopopr, &isNull));
+		ReleaseSysCache(tuple);
+		Assert(!isNull && RegProcedureIsValid(oprid));
+
+		fmgr_info_cxt(get_opcode(oprid),
+					  &opaque->strategy_procinfos[strategynum - 1],
+					  bdesc->bd_context);
+	}
+
+	return &opaque->strategy_procinfos[strategynum - 1];
+}
+
+/*
+ * Distance functions (support procedure 11), used to decide which intervals
+ * to merge.  They only need to be roughly proportional to the difference
+ * between the two values, and are always called with a <= b.
+ */
+static double
+minmax_multi_distance(double a, double b)
+{
+	double		delta = b - a;
+
+	/* never merge across NaN or infinite gaps, if we can avoid it */
+	if (isnan(delta))
+		return get_float8_infinity();
+
+	return delta;
+}
+
+Datum
+brin_minmax_multi_distance_int2(PG_FUNCTION_ARGS)
+{
+	int16		a = PG_GETARG_INT16(0);
+	int16		b = PG_GETARG_INT16(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance((double) a, (double) b));
+}
+
+Datum
+brin_minmax_multi_distance_int4(PG_FUNCTION_ARGS)
+{
+	int32		a = PG_GETARG_INT32(0);
+	int32		b = PG_GETARG_INT32(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance((double) a, (double) b));
+}
+
+Datum
+brin_minmax_multi_distance_int8(PG_FUNCTION_ARGS)
+{
+	int64		a = PG_GETARG_INT64(0);
+	int64		b = PG_GETARG_INT64(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance((double) a, (double) b));
+}
+
+Datum
+brin_minmax_multi_distance_float4(PG_FUNCTION_ARGS)
+{
+	float4		a = PG_GETARG_FLOAT4(0);
+	float4		b = PG_GETARG_FLOAT4(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance((double) a, (double) b));
+}
+
+Datum
+brin_minmax_multi_distance_float8(PG_FUNCTION_ARGS)
+{
+	float8		a = PG_GETARG_FLOAT8(0);
+	float8		b = PG_GETARG_FLOAT8(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance(a, b));
+}
+
+Datum
+brin_minmax_multi_distance_date(PG_FUNCTION_ARGS)
+{
+	DateADT		a = PG_GETARG_DATEADT(0);
+	DateADT		b = PG_GETARG_DATEADT(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance((double) a, (double) b));
+}
+
+/* also used for timestamptz, which has the same representation */
+Datum
+brin_minmax_multi_distance_timestamp(PG_FUNCTION_ARGS)
+{
+	Timestamp	a = PG_GETARG_TIMESTAMP(0);
+	Timestamp	b = PG_GETARG_TIMESTAMP(1);
+
+	PG_RETURN_FLOAT8(minmax_multi_distance((double) a, (double) b));
+}
@@ -203,7 +203,8 @@ brin_form_tuple(BrinDesc *brdesc, BlockNumber blkno, BrinMemTuple *tuple,
 				VARSIZE(DatumGetPointer(value)) > TOAST_INDEX_TARGET &&
 				(atttype->typstorage == 'x' || atttype->typstorage == 'm'))
 			{
-				Datum		cvalue = toast_compress_datum(value);
+				Datum		cvalue = toast_compress_datum(value,
+									      default_toast_compression);
 
 				if (DatumGetPointer(cvalue) != NULL)
 				{
@@ -0,0 +1,1600 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_handler.c
+ *	  column-oriented table access method code
+ *
+ * Columnar tables are append-only: rows can be inserted and read, but not
+ * updated, deleted or locked, and they cannot have indexes.  Rows are
+ * collected per relation in backend-local write buffers and written out as
+ * one stripe when a buffer fills up, when the inserting command changes,
+ * when the relation is scanned, or at commit.
+ *
+ * Sequential scans read only the columns the executor says it needs, and
+ * skip stripes whose min/max values show that they can't satisfy the
+ * simple restrictions passed along; see columnar_scan_set_hints().
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar.h"
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/nbtree.h"
+#include "access/relation.h"
+#include "access/relscan.h"
+#include "access/sysattr.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "commands/vacuum.h"
+#include "executor/tuptable.h"
+#include "nodes/execnodes.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+
+typedef struct ColumnarScanDescData
+{
+	TableScanDescData rs_base;	/* AM independent part of the descriptor */
+
+	BufferAccessStrategy strategy;	/* access strategy for reads */
+	ColumnarMetaPageData meta;	/* metapage as of the start of the scan */
+
+	/* what to read, see columnar_scan_set_hints */
+	bool	   *needed;			/* per column: is it needed? */
+	int			nkeys;			/* number of min/max keys */
+	ScanKey		keys;			/* keys to check against min/max */
+
+	/* values of columns added after a stripe was written */
+	Datum	   *missing_values;
+	bool	   *missing_isnull;
+
+	/* position in the stream */
+	uint64		next_stripe;	/* index of the next stripe to look at */
+	uint64		next_offset;	/* and its stream offset */
+	uint64		claimed_stripe; /* stripe assigned to us, parallel scans */
+	bool		claimed;		/* is claimed_stripe valid? */
+
+	/* current stripe */
+	ColumnarStripeHeader *stripe;	/* NULL if none loaded */
+	uint64		stripe_index;	/* its index */
+	uint32		cur_row;		/* next row to return */
+	Datum	  **values;			/* per column, NULL if not read */
+	bool	  **isnull;
+	MemoryContext stripe_cxt;	/* holds the stripe data */
+
+	/* state for ANALYZE */
+	uint64	   *stripe_offsets; /* offsets of all stripes, and stream_end */
+	uint64		analyze_start;	/* range of the stream in the block */
+	uint64		analyze_end;
+	uint64		analyze_stripe; /* stripe being sampled */
+	bool		analyze_rows_set;	/* is row_end set for it? */
+	uint32		analyze_row_end;
+} ColumnarScanDescData;
+
+typedef ColumnarScanDescData *ColumnarScanDesc;
+
+typedef struct ParallelColumnarScanDescData
+{
+	ParallelTableScanDescData base;
+	pg_atomic_uint64 next_stripe;	/* next stripe to hand out */
+} ParallelColumnarScanDescData;
+
+typedef ParallelColumnarScanDescData *ParallelColumnarScanDesc;
+
+/* result of columnar_stripe_status */
+typedef enum
+{
+	COLUMNAR_STRIPE_LIVE,		/* inserter committed, or is us */
+	COLUMNAR_STRIPE_DEAD,		/* inserter aborted */
+	COLUMNAR_STRIPE_IN_PROGRESS /* inserter still running */
+} ColumnarStripeStatus;
+
+/* write buffers of the current transaction, in TopTransactionContext */
+static ColumnarWriteBuffer *pending_writes = NULL;
+static bool columnar_callbacks_registered = false;
+
+static void columnar_not_supported(Relation rel, const char *what)
+			pg_attribute_noreturn();
+
+
+static void
+columnar_not_supported(Relation rel, const char *what)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar table \"%s\" does not support %s",
+					RelationGetRelationName(rel), what)));
+}
+
+static ColumnarStripeStatus
+columnar_stripe_status(ColumnarStripeHeader *hdr)
+{
+	TransactionId xmin = hdr->xmin;
+
+	if (!TransactionIdIsValid(xmin))
+		return COLUMNAR_STRIPE_DEAD;
+	if (TransactionIdEquals(xmin, FrozenTransactionId) ||
+		TransactionIdIsCurrentTransactionId(xmin))
+		return COLUMNAR_STRIPE_LIVE;
+	if (TransactionIdIsInProgress(xmin))
+		return COLUMNAR_STRIPE_IN_PROGRESS;
+	if (TransactionIdDidCommit(xmin))
+		return COLUMNAR_STRIPE_LIVE;
+	return COLUMNAR_STRIPE_DEAD;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Write buffer management
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_unlink_buffer(ColumnarWriteBuffer *wbuf)
+{
+	ColumnarWriteBuffer **prev;
+
+	for (prev = &pending_writes; *prev != NULL; prev = &(*prev)->next)
+	{
+		if (*prev == wbuf)
+		{
+			*prev = wbuf->next;
+			break;
+		}
+	}
+	MemoryContextDelete(wbuf->context);
+}
+
+/*
+ * Write out a pending buffer and forget about it.  If the write fails, the
+ * buffer stays in place, so nothing is lost if the error is caught.
+ */
+static void
+columnar_flush_buffer(Relation rel, ColumnarWriteBuffer *wbuf)
+{
+	columnar_write_stripe(rel, wbuf);
+	columnar_unlink_buffer(wbuf);
+}
+
+static void
+columnar_flush_all(void)
+{
+	while (pending_writes != NULL)
+	{
+		ColumnarWriteBuffer *wbuf = pending_writes;
+		Relation	rel;
+
+		/* the relation may have been dropped since */
+		rel = try_relation_open(wbuf->relid, NoLock);
+		if (rel != NULL && RelFileNodeEquals(rel->rd_node, wbuf->node))
+			columnar_write_stripe(rel, wbuf);
+		if (rel != NULL)
+			relation_close(rel, NoLock);
+		columnar_unlink_buffer(wbuf);
+	}
+}
+
+static void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PARALLEL_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			columnar_flush_all();
+			break;
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			/* the buffers went away with TopTransactionContext */
+			pending_writes = NULL;
+			break;
+	}
+}
+
+/*
+ * On subtransaction abort, throw away the rows it inserted.  That's only an
+ * optimization: if they were written out, the stripe's xmin would make them
+ * invisible anyway.
+ */
+static void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	if (event == SUBXACT_EVENT_ABORT_SUB)
+	{
+		TransactionId xid = GetCurrentTransactionIdIfAny();
+		ColumnarWriteBuffer *wbuf = pending_writes;
+
+		while (wbuf != NULL)
+		{
+			ColumnarWriteBuffer *next = wbuf->next;
+
+			if (TransactionIdIsValid(xid) && TransactionIdEquals(wbuf->xid, xid))
+				columnar_unlink_buffer(wbuf);
+			wbuf = next;
+		}
+	}
+}
+
+static ColumnarWriteBuffer *
+columnar_find_buffer(Oid relid)
+{
+	ColumnarWriteBuffer *wbuf;
+
+	for (wbuf = pending_writes; wbuf != NULL; wbuf = wbuf->next)
+	{
+		if (wbuf->relid == relid)
+			return wbuf;
+	}
+	return NULL;
+}
+
+/*
+ * Get the write buffer to add rows of "rel" inserted by command "cid" to.
+ * All rows of a stripe come from the same command of the same
+ * (sub)transaction, so we may have to write out the current buffer first.
+ */
+static ColumnarWriteBuffer *
+columnar_get_write_buffer(Relation rel, CommandId cid)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	ColumnarWriteBuffer *wbuf;
+
+	if (!columnar_callbacks_registered)
+	{
+		RegisterXactCallback(columnar_xact_callback, NULL);
+		RegisterSubXactCallback(columnar_subxact_callback, NULL);
+		columnar_callbacks_registered = true;
+	}
+
+	wbuf = columnar_find_buffer(RelationGetRelid(rel));
+	if (wbuf != NULL &&
+		(wbuf->cid != cid || !TransactionIdEquals(wbuf->xid, xid)))
+	{
+		columnar_flush_buffer(rel, wbuf);
+		wbuf = NULL;
+	}
+
+	if (wbuf == NULL)
+	{
+		wbuf = columnar_create_write_buffer(rel, xid, cid,
+											TopTransactionContext);
+		wbuf->next = pending_writes;
+		pending_writes = wbuf;
+	}
+
+	return wbuf;
+}
+
+/*
+ * Write out any rows of "rel" we have buffered, so that they can be seen.
+ */
+void
+columnar_flush_pending(Relation rel)
+{
+	ColumnarWriteBuffer *wbuf = columnar_find_buffer(RelationGetRelid(rel));
+
+	if (wbuf != NULL)
+		columnar_flush_buffer(rel, wbuf);
+}
+
+/*
+ * Throw away any rows of "rel" we have buffered, when its contents are
+ * about to be replaced.
+ */
+static void
+columnar_discard_pending(Relation rel)
+{
+	ColumnarWriteBuffer *wbuf = columnar_find_buffer(RelationGetRelid(rel));
+
+	if (wbuf != NULL)
+		columnar_unlink_buffer(wbuf);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static const TupleTableSlotOps *
+columnar_slot_callbacks(Relation relation)
+{
+	return &TTSOpsVirtual;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Table scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_release_stripe(ColumnarScanDesc scan)
+{
+	int			natts = RelationGetNumberOfAttributes(scan->rs_base.rs_rd);
+
+	MemoryContextReset(scan->stripe_cxt);
+	scan->stripe = NULL;
+	memset(scan->values, 0, sizeof(Datum *) * natts);
+	memset(scan->isnull, 0, sizeof(bool *) * natts);
+}
+
+static void
+columnar_initscan(ColumnarScanDesc scan)
+{
+	columnar_release_stripe(scan);
+	columnar_read_metapage(scan->rs_base.rs_rd, &scan->meta);
+	scan->next_stripe = 0;
+	scan->next_offset = 0;
+	scan->claimed = false;
+}
+
+static TableScanDesc
+columnar_beginscan(Relation relation, Snapshot snapshot,
+				   int nkeys, ScanKey key,
+				   ParallelTableScanDesc parallel_scan,
+				   uint32 flags)
+{
+	ColumnarScanDesc scan;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	int			natts = tupdesc->natts;
+	int			i;
+
+	if (nkeys > 0)
+		elog(ERROR, "scan keys are not supported for columnar tables");
+
+	/* rows we inserted ourselves must be visible to the scan */
+	columnar_flush_pending(relation);
+
+	/* see heap_beginscan */
+	RelationIncrementReferenceCount(relation);
+
+	scan = (ColumnarScanDesc) palloc0(sizeof(ColumnarScanDescData));
+	scan->rs_base.rs_rd = relation;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = 0;
+	scan->rs_base.rs_key = NULL;
+	scan->rs_base.rs_flags = flags;
+	scan->rs_base.rs_parallel = parallel_scan;
+
+	if ((flags & SO_ALLOW_STRAT) &&
+		RelationGetNumberOfBlocks(relation) > NBuffers / 4)
+		scan->strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	if (flags & SO_TYPE_SEQSCAN)
+	{
+		Assert(snapshot);
+		PredicateLockRelation(relation, snapshot);
+		pgstat_count_heap_scan(relation);
+	}
+
+	/* until told otherwise, read every column */
+	scan->needed = (bool *) palloc(sizeof(bool) * natts);
+	scan->missing_values = (Datum *) palloc(sizeof(Datum) * natts);
+	scan->missing_isnull = (bool *) palloc(sizeof(bool) * natts);
+	for (i = 0; i < natts; i++)
+	{
+		scan->needed[i] = !TupleDescAttr(tupdesc, i)->attisdropped;
+		scan->missing_values[i] = getmissingattr(tupdesc, i + 1,
+												 &scan->missing_isnull[i]);
+	}
+
+	scan->values = (Datum **) palloc0(sizeof(Datum *) * natts);
+	scan->isnull = (bool **) palloc0(sizeof(bool *) * natts);
+	scan->stripe_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "columnar stripe",
+											 ALLOCSET_DEFAULT_SIZES);
+
+	columnar_initscan(scan);
+
+	return (TableScanDesc) scan;
+}
+
+static void
+columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+				bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			scan->rs_base.rs_flags |= SO_ALLOW_STRAT;
+		else
+			scan->rs_base.rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	columnar_initscan(scan);
+}
+
+static void
+columnar_endscan(TableScanDesc sscan)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	MemoryContextDelete(scan->stripe_cxt);
+	if (scan->strategy != NULL)
+		FreeAccessStrategy(scan->strategy);
+
+	RelationDecrementReferenceCount(scan->rs_base.rs_rd);
+
+	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(scan->rs_base.rs_snapshot);
+
+	pfree(scan->needed);
+	pfree(scan->missing_values);
+	pfree(scan->missing_isnull);
+	pfree(scan->values);
+	pfree(scan->isnull);
+	if (scan->keys != NULL)
+		pfree(scan->keys);
+	if (scan->stripe_offsets != NULL)
+		pfree(scan->stripe_offsets);
+	pfree(scan);
+}
+
+/*
+ * Record which columns the scan has to return, and the keys that allow
+ * skipping whole stripes.
+ */
+static void
+columnar_scan_set_hints(TableScanDesc sscan, Bitmapset *attrs_used,
+						int nkeys, ScanKey keys)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	TupleDesc	tupdesc = RelationGetDescr(sscan->rs_rd);
+	bool		wholerow;
+	int			i;
+
+	wholerow = bms_is_member(0 - FirstLowInvalidHeapAttributeNumber,
+							 attrs_used);
+	for (i = 0; i < tupdesc->natts; i++)
+		scan->needed[i] = !TupleDescAttr(tupdesc, i)->attisdropped &&
+			(wholerow ||
+			 bms_is_member(i + 1 - FirstLowInvalidHeapAttributeNumber,
+						   attrs_used));
+
+	if (scan->keys != NULL)
+		pfree(scan->keys);
+	scan->keys = NULL;
+	scan->nkeys = nkeys;
+	if (nkeys > 0)
+	{
+		scan->keys = (ScanKey) palloc(sizeof(ScanKeyData) * nkeys);
+		memcpy(scan->keys, keys, sizeof(ScanKeyData) * nkeys);
+	}
+}
+
+/*
+ * Can the stripe contain rows satisfying the scan keys?
+ */
+static bool
+columnar_stripe_matches_keys(ColumnarScanDesc scan, ColumnarStripeHeader *hdr)
+{
+	TupleDesc	tupdesc = RelationGetDescr(scan->rs_base.rs_rd);
+	int			i;
+
+	for (i = 0; i < scan->nkeys; i++)
+	{
+		ScanKey		key = &scan->keys[i];
+		int			attno = key->sk_attno;
+		Datum		min;
+		Datum		max;
+		int32		mincmp;
+		int32		maxcmp;
+
+		if (attno > hdr->natts)
+			continue;
+
+		/* btree operators are strict, so nulls never match */
+		if (ColumnarStripeChunks(hdr)[attno - 1].nnulls == hdr->nrows)
+			return false;
+
+		if (!columnar_chunk_get_minmax(hdr, attno,
+									   TupleDescAttr(tupdesc, attno - 1),
+									   &min, &max))
+			continue;
+
+		mincmp = DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												 key->sk_collation,
+												 min, key->sk_argument));
+		maxcmp = DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												 key->sk_collation,
+												 max, key->sk_argument));
+		switch (key->sk_strategy)
+		{
+			case BTLessStrategyNumber:
+				if (mincmp >= 0)
+					return false;
+				break;
+			case BTLessEqualStrategyNumber:
+				if (mincmp > 0)
+					return false;
+				break;
+			case BTEqualStrategyNumber:
+				if (mincmp > 0 || maxcmp < 0)
+					return false;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				if (maxcmp < 0)
+					return false;
+				break;
+			case BTGreaterStrategyNumber:
+				if (maxcmp <= 0)
+					return false;
+				break;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Read the needed columns of a stripe.  "hdr" must have been allocated in
+ * the scan's stripe context.
+ */
+static void
+columnar_load_stripe(ColumnarScanDesc scan, uint64 index, uint64 offset,
+					 ColumnarStripeHeader *hdr)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(scan->stripe_cxt);
+
+	for (i = 0; i < tupdesc->natts && i < hdr->natts; i++)
+	{
+		if (!scan->needed[i])
+			continue;
+
+		scan->values[i] = (Datum *) palloc(sizeof(Datum) * hdr->nrows);
+		scan->isnull[i] = (bool *) palloc(sizeof(bool) * hdr->nrows);
+		columnar_read_chunk(rel, offset, hdr, i + 1, TupleDescAttr(tupdesc, i),
+							scan->values[i], scan->isnull[i], scan->strategy);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	scan->stripe = hdr;
+	scan->stripe_index = index;
+	scan->cur_row = 0;
+}
+
+/*
+ * Advance to the next stripe visible to the scan's snapshot and matching its
+ * keys, and load it.  Returns false at the end of the stream.
+ */
+static bool
+columnar_next_stripe(ColumnarScanDesc scan)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	ParallelColumnarScanDesc pscan =
+	(ParallelColumnarScanDesc) scan->rs_base.rs_parallel;
+
+	columnar_release_stripe(scan);
+
+	for (;;)
+	{
+		ColumnarStripeHeader *hdr;
+		MemoryContext oldcontext;
+		uint64		index;
+		uint64		offset;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* in a parallel scan, stripes are handed out one at a time */
+		if (pscan != NULL && !scan->claimed)
+		{
+			scan->claimed_stripe = pg_atomic_fetch_add_u64(&pscan->next_stripe, 1);
+			scan->claimed = true;
+		}
+
+		if (scan->next_stripe >= scan->meta.nstripes)
+			return false;
+
+		index = scan->next_stripe++;
+		offset = scan->next_offset;
+
+		oldcontext = MemoryContextSwitchTo(scan->stripe_cxt);
+		hdr = columnar_read_stripe_header(rel, offset, scan->strategy);
+		MemoryContextSwitchTo(oldcontext);
+		scan->next_offset += hdr->length;
+
+		if (pscan != NULL)
+		{
+			if (index < scan->claimed_stripe)
+			{
+				MemoryContextReset(scan->stripe_cxt);
+				continue;
+			}
+			scan->claimed = false;
+		}
+
+		if (!columnar_stripe_is_visible(hdr, scan->rs_base.rs_snapshot) ||
+			!columnar_stripe_matches_keys(scan, hdr))
+		{
+			MemoryContextReset(scan->stripe_cxt);
+			continue;
+		}
+
+		columnar_load_stripe(scan, index, offset, hdr);
+		return true;
+	}
+}
+
+/*
+ * Fetch the values of the next row of the current stripe.
+ */
+static void
+columnar_next_row(ColumnarScanDesc scan, Datum *values, bool *isnull)
+{
+	ColumnarStripeHeader *hdr = scan->stripe;
+	uint32		row = scan->cur_row++;
+	int			natts = RelationGetNumberOfAttributes(scan->rs_base.rs_rd);
+	int			i;
+
+	Assert(row < hdr->nrows);
+
+	for (i = 0; i < natts; i++)
+	{
+		if (i >= hdr->natts)
+		{
+			values[i] = scan->missing_values[i];
+			isnull[i] = scan->missing_isnull[i];
+		}
+		else if (scan->values[i] != NULL)
+		{
+			values[i] = scan->values[i][row];
+			isnull[i] = scan->isnull[i][row];
+		}
+		else
+		{
+			values[i] = (Datum) 0;
+			isnull[i] = true;
+		}
+	}
+}
+
+static void
+columnar_store_next_row(ColumnarScanDesc scan, TupleTableSlot *slot)
+{
+	uint64		rownum = scan->stripe->first_row + scan->cur_row;
+
+	ExecClearTuple(slot);
+	columnar_next_row(scan, slot->tts_values, slot->tts_isnull);
+	ExecStoreVirtualTuple(slot);
+	ColumnarRowNumberToTid(rownum, &slot->tts_tid);
+}
+
+static void
+columnar_check_direction(ColumnarScanDesc scan, ScanDirection direction)
+{
+	if (ScanDirectionIsBackward(direction))
+		columnar_not_supported(scan->rs_base.rs_rd, "backward scans");
+}
+
+static bool
+columnar_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	columnar_check_direction(scan, direction);
+
+	for (;;)
+	{
+		if (scan->stripe != NULL && scan->cur_row < scan->stripe->nrows)
+		{
+			columnar_store_next_row(scan, slot);
+			pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+			return true;
+		}
+
+		/* the slot may point into the stripe we're about to release */
+		ExecClearTuple(slot);
+		if (!columnar_next_stripe(scan))
+			return false;
+	}
+}
+
+static int
+columnar_getnextslots(TableScanDesc sscan, ScanDirection direction,
+					  TupleTableSlot **slots, int nslots)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	int			n = 0;
+
+	columnar_check_direction(scan, direction);
+
+	while (n < nslots)
+	{
+		int			i;
+
+		if (scan->stripe != NULL && scan->cur_row < scan->stripe->nrows)
+		{
+			columnar_store_next_row(scan, slots[n++]);
+			pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+			continue;
+		}
+
+		/* the slots filled so far must outlive the current stripe */
+		for (i = 0; i < n; i++)
+			ExecMaterializeSlot(slots[i]);
+		if (!columnar_next_stripe(scan))
+			break;
+	}
+
+	return n;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Parallel aware callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static Size
+columnar_parallelscan_estimate(Relation rel)
+{
+	return sizeof(ParallelColumnarScanDescData);
+}
+
+static Size
+columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ParallelColumnarScanDesc cpscan = (ParallelColumnarScanDesc) pscan;
+
+	cpscan->base.phs_relid = RelationGetRelid(rel);
+	cpscan->base.phs_syncscan = false;
+	pg_atomic_init_u64(&cpscan->next_stripe, 0);
+
+	return sizeof(ParallelColumnarScanDescData);
+}
+
+static void
+columnar_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ParallelColumnarScanDesc cpscan = (ParallelColumnarScanDesc) pscan;
+
+	pg_atomic_write_u64(&cpscan->next_stripe, 0);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static IndexFetchTableData *
+columnar_index_fetch_begin(Relation rel)
+{
+	columnar_not_supported(rel, "indexes");
+}
+
+static void
+columnar_index_fetch_reset(IndexFetchTableData *scan)
+{
+}
+
+static void
+columnar_index_fetch_end(IndexFetchTableData *scan)
+{
+}
+
+static bool
+columnar_index_fetch_tuple(struct IndexFetchTableData *scan,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot,
+						   bool *call_again, bool *all_dead)
+{
+	columnar_not_supported(scan->rel, "indexes");
+}
+
+
+/* ------------------------------------------------------------------------
+ * Callbacks for non-modifying operations on individual tuples for
+ * columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Find the stripe holding row number "rownum", by walking the stream.  This
+ * is slow, but fetching rows by TID is not what columnar tables are for.
+ */
+static ColumnarStripeHeader *
+columnar_find_row(Relation rel, uint64 rownum, uint64 *offset)
+{
+	ColumnarMetaPageData meta;
+	uint64		off = 0;
+	uint64		i;
+
+	columnar_read_metapage(rel, &meta);
+	for (i = 0; i < meta.nstripes; i++)
+	{
+		ColumnarStripeHeader *hdr;
+
+		CHECK_FOR_INTERRUPTS();
+
+		hdr = columnar_read_stripe_header(rel, off, NULL);
+		if (rownum >= hdr->first_row && rownum < hdr->first_row + hdr->nrows)
+		{
+			*offset = off;
+			return hdr;
+		}
+		off += hdr->length;
+		pfree(hdr);
+	}
+
+	return NULL;
+}
+
+static bool
+columnar_fetch_row_version(Relation relation,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	uint64		rownum = ColumnarTidToRowNumber(tid);
+	ColumnarStripeHeader *hdr;
+	MemoryContext tmpcontext;
+	MemoryContext oldcontext;
+	uint64		offset;
+	uint32		row;
+	int			i;
+
+	/* the row may still be in our write buffer */
+	columnar_flush_pending(relation);
+
+	tmpcontext = AllocSetContextCreate(CurrentMemoryContext,
+									   "columnar fetch",
+									   ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(tmpcontext);
+
+	hdr = columnar_find_row(relation, rownum, &offset);
+	if (hdr == NULL || !columnar_stripe_is_visible(hdr, snapshot))
+	{
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextDelete(tmpcontext);
+		return false;
+	}
+	row = rownum - hdr->first_row;
+
+	ExecClearTuple(slot);
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		if (i >= hdr->natts)
+			slot->tts_values[i] = getmissingattr(tupdesc, i + 1,
+												 &slot->tts_isnull[i]);
+		else if (attr->attisdropped)
+			slot->tts_isnull[i] = true;
+		else
+		{
+			Datum	   *values = palloc(sizeof(Datum) * hdr->nrows);
+			bool	   *isnull = palloc(sizeof(bool) * hdr->nrows);
+
+			columnar_read_chunk(relation, offset, hdr, i + 1, attr,
+								values, isnull, NULL);
+			slot->tts_values[i] = values[row];
+			slot->tts_isnull[i] = isnull[row];
+		}
+	}
+	ExecStoreVirtualTuple(slot);
+	ExecMaterializeSlot(slot);
+	slot->tts_tableOid = RelationGetRelid(relation);
+	slot->tts_tid = *tid;
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(tmpcontext);
+
+	return true;
+}
+
+static bool
+columnar_tuple_tid_valid(TableScanDesc sscan, ItemPointer tid)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	return ItemPointerIsValid(tid) &&
+		ColumnarTidToRowNumber(tid) < scan->meta.next_row;
+}
+
+static void
+columnar_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	/* rows are never updated, so every row is its latest version */
+}
+
+static bool
+columnar_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								  Snapshot snapshot)
+{
+	ColumnarStripeHeader *hdr;
+	uint64		offset;
+	bool		result;
+
+	hdr = columnar_find_row(rel, ColumnarTidToRowNumber(&slot->tts_tid),
+							&offset);
+	if (hdr == NULL)
+		return false;
+	result = columnar_stripe_is_visible(hdr, snapshot);
+	pfree(hdr);
+
+	return result;
+}
+
+static TransactionId
+columnar_compute_xid_horizon_for_tuples(Relation rel,
+										ItemPointerData *tids,
+										int nitems)
+{
+	columnar_not_supported(rel, "indexes");
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples for columnar AM.
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+columnar_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	ColumnarWriteBuffer *wbuf;
+
+	/* see heap_insert */
+	CheckForSerializableConflictIn(relation, NULL, InvalidBuffer);
+
+	wbuf = columnar_get_write_buffer(relation, cid);
+
+	slot_getallattrs(slot);
+	slot->tts_tableOid = RelationGetRelid(relation);
+	ColumnarRowNumberToTid(wbuf->first_row + wbuf->nrows, &slot->tts_tid);
+
+	if (columnar_buffer_add_row(wbuf, slot->tts_values, slot->tts_isnull))
+		columnar_flush_buffer(relation, wbuf);
+
+	pgstat_count_heap_insert(relation, 1);
+}
+
+static void
+columnar_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	int			i;
+
+	for (i = 0; i < ntuples; i++)
+		columnar_tuple_insert(relation, slots[i], cid, options, bistate);
+}
+
+static void
+columnar_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	columnar_not_supported(relation, "INSERT ... ON CONFLICT");
+}
+
+static void
+columnar_tuple_complete_speculative(Relation relation, TupleTableSlot *slot,
+									uint32 spekToken, bool succeeded)
+{
+	columnar_not_supported(relation, "INSERT ... ON CONFLICT");
+}
+
+static TM_Result
+columnar_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, bool changingPart)
+{
+	columnar_not_supported(relation, "DELETE");
+}
+
+static TM_Result
+columnar_tuple_update(Relation relation, ItemPointer otid,
+					  TupleTableSlot *slot, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck,
+					  bool wait, TM_FailureData *tmfd,
+					  LockTupleMode *lockmode, TM_IndexUpdate *index_update)
+{
+	columnar_not_supported(relation, "UPDATE");
+}
+
+static TM_Result
+columnar_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+					TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+					LockWaitPolicy wait_policy, uint8 flags,
+					TM_FailureData *tmfd)
+{
+	columnar_not_supported(relation, "row locking");
+}
+
+static void
+columnar_finish_bulk_insert(Relation relation, int options)
+{
+	columnar_flush_pending(relation);
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks for columnar AM.
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_relation_set_new_filenode(Relation rel,
+								   const RelFileNode *newrnode,
+								   char persistence,
+								   TransactionId *freezeXid,
+								   MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/* whatever we had buffered belongs to the old contents */
+	columnar_discard_pending(rel);
+
+	/* see heapam_relation_set_new_filenode */
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrnode, persistence);
+
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+			   rel->rd_rel->relkind == RELKIND_MATVIEW);
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrnode, INIT_FORKNUM);
+		smgrimmedsync(srel, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+columnar_relation_nontransactional_truncate(Relation rel)
+{
+	columnar_discard_pending(rel);
+	RelationTruncate(rel, 0);
+}
+
+static void
+columnar_relation_copy_data(Relation rel, const RelFileNode *newrnode)
+{
+	SMgrRelation dstrel;
+
+	columnar_flush_pending(rel);
+
+	/* see heapam_relation_copy_data */
+	dstrel = smgropen(*newrnode, rel->rd_backend);
+	RelationOpenSmgr(rel);
+
+	FlushRelationBuffers(rel);
+
+	RelationCreateStorage(*newrnode, rel->rd_rel->relpersistence);
+
+	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(rel->rd_smgr, forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+
+			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrnode, forkNum);
+			RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+/*
+ * VACUUM FULL and CLUSTER: rewrite the rows of live stripes, leaving out
+ * those inserted by aborted transactions.  Rows visible to everyone are
+ * packed into full stripes marked frozen; other stripes keep their xmin.
+ */
+static void
+columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
+								   Relation OldIndex, bool use_sort,
+								   TransactionId OldestXmin,
+								   TransactionId *xid_cutoff,
+								   MultiXactId *multi_cutoff,
+								   double *num_tuples,
+								   double *tups_vacuumed,
+								   double *tups_recently_dead)
+{
+	ColumnarScanDesc scan;
+	ColumnarWriteBuffer *frozen = NULL;
+	int			natts = RelationGetNumberOfAttributes(OldHeap);
+	Datum	   *values;
+	bool	   *isnull;
+
+	if (OldIndex != NULL)
+		columnar_not_supported(OldHeap, "indexes");
+
+	*num_tuples = 0;
+	*tups_vacuumed = 0;
+	*tups_recently_dead = 0;
+
+	values = (Datum *) palloc(sizeof(Datum) * natts);
+	isnull = (bool *) palloc(sizeof(bool) * natts);
+
+	scan = (ColumnarScanDesc) table_beginscan(OldHeap, SnapshotAny, 0, NULL);
+
+	while (columnar_next_stripe(scan))
+	{
+		ColumnarStripeHeader *hdr = scan->stripe;
+		ColumnarStripeStatus status = columnar_stripe_status(hdr);
+		ColumnarWriteBuffer *wbuf;
+		bool		freeze;
+
+		if (status == COLUMNAR_STRIPE_DEAD)
+		{
+			*tups_vacuumed += hdr->nrows;
+			continue;
+		}
+
+		freeze = status == COLUMNAR_STRIPE_LIVE &&
+			(TransactionIdEquals(hdr->xmin, FrozenTransactionId) ||
+			 (!TransactionIdIsCurrentTransactionId(hdr->xmin) &&
+			  TransactionIdPrecedes(hdr->xmin, OldestXmin)));
+
+		if (freeze && frozen == NULL)
+			frozen = columnar_create_write_buffer(NewHeap, FrozenTransactionId,
+												  FirstCommandId,
+												  CurrentMemoryContext);
+		wbuf = freeze ? frozen :
+			columnar_create_write_buffer(NewHeap, hdr->xmin, hdr->cid,
+										 CurrentMemoryContext);
+
+		while (scan->cur_row < hdr->nrows)
+		{
+			columnar_next_row(scan, values, isnull);
+			*num_tuples += 1;
+
+			if (columnar_buffer_add_row(wbuf, values, isnull))
+			{
+				TransactionId xid = wbuf->xid;
+				CommandId	cid = wbuf->cid;
+
+				columnar_write_stripe(NewHeap, wbuf);
+				MemoryContextDelete(wbuf->context);
+				wbuf = columnar_create_write_buffer(NewHeap, xid, cid,
+													CurrentMemoryContext);
+				if (freeze)
+					frozen = wbuf;
+			}
+		}
+
+		if (!freeze)
+		{
+			columnar_write_stripe(NewHeap, wbuf);
+			MemoryContextDelete(wbuf->context);
+		}
+	}
+
+	if (frozen != NULL)
+	{
+		columnar_write_stripe(NewHeap, frozen);
+		MemoryContextDelete(frozen->context);
+	}
+
+	table_endscan((TableScanDesc) scan);
+	pfree(values);
+	pfree(isnull);
+}
+
+/*
+ * VACUUM has no space to reclaim, rows are never deleted.  What it does is
+ * freeze the stripes of committed transactions that everyone can see, and
+ * mark those of aborted transactions dead, so that their xids don't need
+ * to be looked up anymore and relfrozenxid can advance.
+ */
+static void
+columnar_relation_vacuum(Relation onerel, struct VacuumParams *params,
+						 BufferAccessStrategy bstrategy)
+{
+	ColumnarMetaPageData meta;
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	TransactionId xidFullScanLimit;
+	MultiXactId MultiXactCutoff;
+	MultiXactId mxactFullScanLimit;
+	uint64		offset = 0;
+	uint64		i;
+	double		live_rows = 0;
+	double		dead_rows = 0;
+	uint64		nfrozen = 0;
+
+	vacuum_set_xid_limits(onerel,
+						  params->freeze_min_age,
+						  params->freeze_table_age,
+						  params->multixact_freeze_min_age,
+						  params->multixact_freeze_table_age,
+						  &OldestXmin, &FreezeLimit, &xidFullScanLimit,
+						  &MultiXactCutoff, &mxactFullScanLimit);
+
+	/* every stripe written from here on will have a newer xmin */
+	columnar_read_metapage(onerel, &meta);
+
+	for (i = 0; i < meta.nstripes; i++)
+	{
+		ColumnarStripeHeader *hdr;
+		TransactionId xmin;
+
+		vacuum_delay_point();
+
+		hdr = columnar_read_stripe_header(onerel, offset, bstrategy);
+		xmin = hdr->xmin;
+
+		if (TransactionIdIsNormal(xmin) &&
+			TransactionIdPrecedes(xmin, OldestXmin))
+		{
+			if (TransactionIdDidCommit(xmin))
+				xmin = FrozenTransactionId;
+			else
+				xmin = InvalidTransactionId;
+			columnar_set_stripe_xmin(onerel, offset, xmin);
+			nfrozen++;
+		}
+
+		if (TransactionIdIsValid(xmin))
+			live_rows += hdr->nrows;
+		else
+			dead_rows += hdr->nrows;
+
+		offset += hdr->length;
+		pfree(hdr);
+	}
+
+	vac_update_relstats(onerel,
+						RelationGetNumberOfBlocks(onerel),
+						live_rows,
+						0,
+						false,
+						OldestXmin,
+						InvalidMultiXactId,
+						false);
+
+	pgstat_report_vacuum(RelationGetRelid(onerel),
+						 onerel->rd_rel->relisshared,
+						 live_rows, dead_rows);
+
+	ereport((params->options & VACOPT_VERBOSE) ? INFO : DEBUG2,
+			(errmsg("\"%s\": found %.0f live and %.0f dead rows in " UINT64_FORMAT " stripes, marked " UINT64_FORMAT " stripes",
+					RelationGetRelationName(onerel),
+					live_rows, dead_rows, meta.nstripes, nfrozen)));
+}
+
+/*
+ * ANALYZE samples blocks; we map each block to the rows of the stripes
+ * whose data it holds, in proportion to the block's share of the stripe.
+ */
+static bool
+columnar_scan_analyze_next_block(TableScanDesc sscan, BlockNumber blockno,
+								 BufferAccessStrategy bstrategy)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	uint64		lo;
+	uint64		hi;
+
+	if (scan->stripe_offsets == NULL)
+	{
+		uint64		offset = 0;
+		uint64		i;
+
+		scan->stripe_offsets = (uint64 *)
+			palloc(sizeof(uint64) * (scan->meta.nstripes + 1));
+		for (i = 0; i < scan->meta.nstripes; i++)
+		{
+			ColumnarStripeHeader *hdr;
+
+			hdr = columnar_read_stripe_header(sscan->rs_rd, offset, bstrategy);
+			scan->stripe_offsets[i] = offset;
+			offset += hdr->length;
+			pfree(hdr);
+		}
+		scan->stripe_offsets[scan->meta.nstripes] = offset;
+	}
+
+	if (blockno == COLUMNAR_METAPAGE_BLKNO)
+	{
+		scan->analyze_start = scan->analyze_end = 0;
+		scan->analyze_stripe = scan->meta.nstripes;
+		return true;
+	}
+
+	scan->analyze_start = (uint64) (blockno - 1) * COLUMNAR_PAGE_DATA;
+	scan->analyze_end = scan->analyze_start + COLUMNAR_PAGE_DATA;
+
+	/* find the stripe holding the start of the block */
+	lo = 0;
+	hi = scan->meta.nstripes;
+	while (lo < hi)
+	{
+		uint64		mid = lo + (hi - lo) / 2;
+
+		if (scan->stripe_offsets[mid + 1] <= scan->analyze_start)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	scan->analyze_stripe = lo;
+	scan->analyze_rows_set = false;
+
+	return true;
+}
+
+static bool
+columnar_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	while (scan->analyze_stripe < scan->meta.nstripes &&
+		   scan->stripe_offsets[scan->analyze_stripe] < scan->analyze_end)
+	{
+		uint64		index = scan->analyze_stripe;
+
+		if (!scan->analyze_rows_set)
+		{
+			uint64		start = scan->stripe_offsets[index];
+			uint64		len = scan->stripe_offsets[index + 1] - start;
+			uint64		from = Max(scan->analyze_start, start) - start;
+			uint64		to = Min(scan->analyze_end, start + len) - start;
+			ColumnarStripeHeader *hdr;
+			ColumnarStripeStatus status;
+			MemoryContext oldcontext;
+			uint32		first_row;
+
+			if (scan->stripe == NULL || scan->stripe_index != index)
+			{
+				columnar_release_stripe(scan);
+				oldcontext = MemoryContextSwitchTo(scan->stripe_cxt);
+				hdr = columnar_read_stripe_header(sscan->rs_rd, start,
+												  scan->strategy);
+				MemoryContextSwitchTo(oldcontext);
+
+				status = columnar_stripe_status(hdr);
+				if (status != COLUMNAR_STRIPE_LIVE)
+				{
+					if (status == COLUMNAR_STRIPE_DEAD)
+						*deadrows += (double) hdr->nrows * (to - from) / len;
+					MemoryContextReset(scan->stripe_cxt);
+					scan->analyze_stripe++;
+					continue;
+				}
+				columnar_load_stripe(scan, index, start, hdr);
+			}
+
+			first_row = scan->stripe->nrows * from / len;
+			scan->analyze_row_end = scan->stripe->nrows * to / len;
+			scan->cur_row = first_row;
+			scan->analyze_rows_set = true;
+		}
+
+		if (scan->cur_row < scan->analyze_row_end)
+		{
+			columnar_store_next_row(scan, slot);
+			*liverows += 1;
+			return true;
+		}
+
+		scan->analyze_stripe++;
+		scan->analyze_rows_set = false;
+	}
+
+	ExecClearTuple(slot);
+	return false;
+}
+
+static double
+columnar_index_build_range_scan(Relation tableRelation,
+								Relation indexRelation,
+								IndexInfo *indexInfo,
+								bool allow_sync,
+								bool anyvisible,
+								bool progress,
+								BlockNumber start_blockno,
+								BlockNumber numblocks,
+								IndexBuildCallback callback,
+								void *callback_state,
+								TableScanDesc scan)
+{
+	columnar_not_supported(tableRelation, "indexes");
+}
+
+static void
+columnar_index_validate_scan(Relation tableRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 ValidateIndexState *state)
+{
+	columnar_not_supported(tableRelation, "indexes");
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static uint64
+columnar_relation_size(Relation rel, ForkNumber forkNumber)
+{
+	uint64		nblocks = 0;
+
+	/* Open it at the smgr level if not already done */
+	RelationOpenSmgr(rel);
+
+	/* InvalidForkNumber indicates returning the size for all forks */
+	if (forkNumber == InvalidForkNumber)
+	{
+		for (int i = 0; i < MAX_FORKNUM; i++)
+			nblocks += smgrnblocks(rel->rd_smgr, i);
+	}
+	else
+		nblocks = smgrnblocks(rel->rd_smgr, forkNumber);
+
+	return nblocks * BLCKSZ;
+}
+
+/*
+ * Values are always stored inline, so there's never a TOAST table.
+ */
+static bool
+columnar_relation_needs_toast_table(Relation rel)
+{
+	return false;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Planner related callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
+						   BlockNumber *pages, double *tuples,
+						   double *allvisfrac)
+{
+	ColumnarMetaPageData meta;
+
+	columnar_read_metapage(rel, &meta);
+
+	*pages = RelationGetNumberOfBlocks(rel);
+	*tuples = (double) meta.nrows;
+	*allvisfrac = 0;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Executor related callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_scan_sample_next_block(TableScanDesc scan,
+								SampleScanState *scanstate)
+{
+	columnar_not_supported(scan->rs_rd, "TABLESAMPLE");
+}
+
+static bool
+columnar_scan_sample_next_tuple(TableScanDesc scan,
+								SampleScanState *scanstate,
+								TupleTableSlot *slot)
+{
+	columnar_not_supported(scan->rs_rd, "TABLESAMPLE");
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the columnar table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine columnar_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = columnar_slot_callbacks,
+
+	.scan_begin = columnar_beginscan,
+	.scan_end = columnar_endscan,
+	.scan_rescan = columnar_rescan,
+	.scan_getnextslot = columnar_getnextslot,
+	.scan_getnextslots = columnar_getnextslots,
+	.scan_set_hints = columnar_scan_set_hints,
+
+	.parallelscan_estimate = columnar_parallelscan_estimate,
+	.parallelscan_initialize = columnar_parallelscan_initialize,
+	.parallelscan_reinitialize = columnar_parallelscan_reinitialize,
+
+	.index_fetch_begin = columnar_index_fetch_begin,
+	.index_fetch_reset = columnar_index_fetch_reset,
+	.index_fetch_end = columnar_index_fetch_end,
+	.index_fetch_tuple = columnar_index_fetch_tuple,
+
+	.tuple_insert = columnar_tuple_insert,
+	.tuple_insert_speculative = columnar_tuple_insert_speculative,
+	.tuple_complete_speculative = columnar_tuple_complete_speculative,
+	.multi_insert = columnar_multi_insert,
+	.tuple_delete = columnar_tuple_delete,
+	.tuple_update = columnar_tuple_update,
+	.tuple_lock = columnar_tuple_lock,
+	.finish_bulk_insert = columnar_finish_bulk_insert,
+
+	.tuple_fetch_row_version = columnar_fetch_row_version,
+	.tuple_get_latest_tid = columnar_get_latest_tid,
+	.tuple_tid_valid = columnar_tuple_tid_valid,
+	.tuple_satisfies_snapshot = columnar_tuple_satisfies_snapshot,
+	.compute_xid_horizon_for_tuples = columnar_compute_xid_horizon_for_tuples,
+
+	.relation_set_new_filenode = columnar_relation_set_new_filenode,
+	.relation_nontransactional_truncate = columnar_relation_nontransactional_truncate,
+	.relation_copy_data = columnar_relation_copy_data,
+	.relation_copy_for_cluster = columnar_relation_copy_for_cluster,
+	.relation_vacuum = columnar_relation_vacuum,
+	.scan_analyze_next_block = columnar_scan_analyze_next_block,
+	.scan_analyze_next_tuple = columnar_scan_analyze_next_tuple,
+	.index_build_range_scan = columnar_index_build_range_scan,
+	.index_validate_scan = columnar_index_validate_scan,
+
+	.relation_size = columnar_relation_size,
+	.relation_needs_toast_table = columnar_relation_needs_toast_table,
+
+	.relation_estimate_size = columnar_estimate_rel_size,
+
+	.scan_sample_next_block = columnar_scan_sample_next_block,
+	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
+};
+
+
+Datum
+columnar_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&columnar_methods);
+}
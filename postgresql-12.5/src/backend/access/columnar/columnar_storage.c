@@ -0,0 +1,848 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *	  On-disk layout of the columnar table access method.
+ *
+ * See access/columnar.h for a description of the format.  All page
+ * modifications are WAL-logged as generic records, one page at a time.
+ * Writers append under the relation extension lock and update the metapage
+ * last, so that a crash in the middle of writing a stripe leaves nothing
+ * but garbage past the end of the stream, which the next writer overwrites.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_storage.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+#include "access/columnar.h"
+#include "access/generic_xlog.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "common/pg_lzcompress.h"
+#include "miscadmin.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/typcache.h"
+
+
+/* min/max values longer than this are not kept */
+#define COLUMNAR_MAX_MINMAX_SIZE	256
+
+/* a stripe is written out once it has this much data, whatever its rows */
+#define COLUMNAR_STRIPE_FLUSH_SIZE	(256 * 1024 * 1024)
+
+/* GUC parameters */
+int			columnar_stripe_row_limit = 150000;
+int			columnar_compression = COLUMNAR_COMPRESSION_PGLZ;
+
+#define ColumnarPageGetMeta(page) \
+	((ColumnarMetaPageData *) PageGetContents(page))
+
+
+/*
+ * Write "len" bytes at stream offset "offset", extending the relation as
+ * needed.  The caller must hold the relation extension lock.
+ */
+static void
+columnar_write_bytes(Relation rel, uint64 offset, const char *data, Size len)
+{
+	BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+
+	while (len > 0)
+	{
+		BlockNumber blkno = 1 + offset / COLUMNAR_PAGE_DATA;
+		Size		pageoff = offset % COLUMNAR_PAGE_DATA;
+		Size		n = Min(len, COLUMNAR_PAGE_DATA - pageoff);
+		GenericXLogState *state;
+		Buffer		buf;
+		Page		page;
+		PageHeader	phdr;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (blkno < nblocks)
+			buf = ReadBuffer(rel, blkno);
+		else if (blkno == nblocks)
+		{
+			buf = ReadBuffer(rel, P_NEW);
+			nblocks++;
+		}
+		else
+			elog(ERROR, "columnar table \"%s\" ends before block %u",
+				 RelationGetRelationName(rel), blkno);
+		Assert(BufferGetBlockNumber(buf) == blkno);
+
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf,
+										 PageIsNew(BufferGetPage(buf)) ?
+										 GENERIC_XLOG_FULL_IMAGE : 0);
+		if (PageIsNew(page))
+			PageInit(page, BLCKSZ, 0);
+
+		memcpy((char *) page + SizeOfPageHeaderData + pageoff, data, n);
+		phdr = (PageHeader) page;
+		phdr->pd_lower = Max(phdr->pd_lower, SizeOfPageHeaderData + pageoff + n);
+
+		GenericXLogFinish(state);
+		UnlockReleaseBuffer(buf);
+
+		offset += n;
+		data += n;
+		len -= n;
+	}
+}
+
+/*
+ * Read "len" bytes at stream offset "offset".
+ */
+static void
+columnar_read_bytes(Relation rel, uint64 offset, char *dest, Size len,
+					BufferAccessStrategy strategy)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = 1 + offset / COLUMNAR_PAGE_DATA;
+		Size		pageoff = offset % COLUMNAR_PAGE_DATA;
+		Size		n = Min(len, COLUMNAR_PAGE_DATA - pageoff);
+		Buffer		buf;
+		Page		page;
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 strategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+
+		if (PageIsNew(page) ||
+			((PageHeader) page)->pd_lower < SizeOfPageHeaderData + pageoff + n)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("columnar table \"%s\" has missing data in block %u",
+							RelationGetRelationName(rel), blkno)));
+
+		memcpy(dest, (char *) page + SizeOfPageHeaderData + pageoff, n);
+		UnlockReleaseBuffer(buf);
+
+		offset += n;
+		dest += n;
+		len -= n;
+	}
+}
+
+static void
+columnar_check_metapage(Relation rel, ColumnarMetaPageData *meta)
+{
+	if (meta->magic != COLUMNAR_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("relation \"%s\" is not a columnar table",
+						RelationGetRelationName(rel))));
+	if (meta->version != COLUMNAR_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar table \"%s\" has version %u, but only version %u is supported",
+						RelationGetRelationName(rel),
+						meta->version, COLUMNAR_VERSION)));
+}
+
+/*
+ * Fetch a copy of the metapage contents.  A table that has never been
+ * written to has no metapage; report it as empty.
+ */
+void
+columnar_read_metapage(Relation rel, ColumnarMetaPageData *meta)
+{
+	Buffer		buf;
+	Page		page;
+
+	memset(meta, 0, sizeof(ColumnarMetaPageData));
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+		return;
+
+	buf = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buf);
+	if (!PageIsNew(page))
+	{
+		memcpy(meta, ColumnarPageGetMeta(page), sizeof(ColumnarMetaPageData));
+		columnar_check_metapage(rel, meta);
+	}
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Lock the metapage for update, creating it if necessary, and return a
+ * copy of its contents in *meta.  The caller must hold the relation
+ * extension lock, which is what keeps writers from getting in each other's
+ * way; the buffer lock only protects readers from a partial update.
+ */
+static Buffer
+columnar_lock_metapage(Relation rel, ColumnarMetaPageData *meta)
+{
+	Buffer		buf;
+	Page		page;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+		buf = ReadBuffer(rel, P_NEW);
+	else
+		buf = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	Assert(BufferGetBlockNumber(buf) == COLUMNAR_METAPAGE_BLKNO);
+
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buf);
+	if (PageIsNew(page))
+	{
+		memset(meta, 0, sizeof(ColumnarMetaPageData));
+		meta->magic = COLUMNAR_MAGIC;
+		meta->version = COLUMNAR_VERSION;
+	}
+	else
+	{
+		memcpy(meta, ColumnarPageGetMeta(page), sizeof(ColumnarMetaPageData));
+		columnar_check_metapage(rel, meta);
+	}
+
+	return buf;
+}
+
+/*
+ * Write back the metapage locked by columnar_lock_metapage, and release it.
+ */
+static void
+columnar_write_metapage(Relation rel, Buffer buf, ColumnarMetaPageData *meta)
+{
+	GenericXLogState *state;
+	Page		page;
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf,
+									 PageIsNew(BufferGetPage(buf)) ?
+									 GENERIC_XLOG_FULL_IMAGE : 0);
+	if (PageIsNew(page))
+		PageInit(page, BLCKSZ, 0);
+
+	memcpy(ColumnarPageGetMeta(page), meta, sizeof(ColumnarMetaPageData));
+	((PageHeader) page)->pd_lower =
+		((char *) ColumnarPageGetMeta(page) + sizeof(ColumnarMetaPageData)) -
+		(char *) page;
+
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Reserve row numbers for "nrows" rows, and return the first one.
+ *
+ * Row numbers are handed out when a write buffer is started rather than
+ * when its stripe is written, so that inserted rows get their TID right
+ * away.  Numbers reserved but not used are simply skipped.
+ */
+uint64
+columnar_reserve_rows(Relation rel, uint32 nrows)
+{
+	ColumnarMetaPageData meta;
+	Buffer		buf;
+	uint64		first_row;
+
+	LockRelationForExtension(rel, ExclusiveLock);
+	buf = columnar_lock_metapage(rel, &meta);
+
+	first_row = meta.next_row;
+	if (first_row + nrows >= (uint64) MaxBlockNumber * MaxHeapTuplesPerPage)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("columnar table \"%s\" has run out of row numbers",
+						RelationGetRelationName(rel)),
+				 errhint("Rewrite the table with VACUUM FULL.")));
+	meta.next_row += nrows;
+
+	columnar_write_metapage(rel, buf, &meta);
+	UnlockRelationForExtension(rel, ExclusiveLock);
+
+	return first_row;
+}
+
+/*
+ * Start collecting rows for a new stripe of "rel".
+ */
+ColumnarWriteBuffer *
+columnar_create_write_buffer(Relation rel, TransactionId xid, CommandId cid,
+							 MemoryContext parent)
+{
+	ColumnarWriteBuffer *wbuf;
+	MemoryContext context;
+	MemoryContext oldcontext;
+	int			i;
+
+	context = AllocSetContextCreate(parent,
+									"columnar write buffer",
+									ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(context);
+
+	wbuf = (ColumnarWriteBuffer *) palloc0(sizeof(ColumnarWriteBuffer));
+	wbuf->relid = RelationGetRelid(rel);
+	wbuf->node = rel->rd_node;
+	wbuf->xid = xid;
+	wbuf->cid = cid;
+	wbuf->maxrows = columnar_stripe_row_limit;
+	wbuf->first_row = columnar_reserve_rows(rel, wbuf->maxrows);
+	wbuf->tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	wbuf->context = context;
+
+	wbuf->cols = (ColumnarColumnBuffer *)
+		palloc0(sizeof(ColumnarColumnBuffer) * wbuf->tupdesc->natts);
+	for (i = 0; i < wbuf->tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(wbuf->tupdesc, i);
+		ColumnarColumnBuffer *col = &wbuf->cols[i];
+
+		initStringInfo(&col->data);
+		col->nullbits = (bits8 *) palloc0(BITMAPLEN(wbuf->maxrows));
+
+		if (!attr->attisdropped)
+		{
+			TypeCacheEntry *typentry;
+
+			typentry = lookup_type_cache(attr->atttypid,
+										 TYPECACHE_CMP_PROC_FINFO);
+			if (OidIsValid(typentry->cmp_proc_finfo.fn_oid))
+				col->cmp = &typentry->cmp_proc_finfo;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return wbuf;
+}
+
+/*
+ * Keep track of the smallest and largest values of a column.  Values too
+ * large to be worth keeping make us give up on the column for this stripe.
+ */
+static void
+columnar_update_minmax(ColumnarColumnBuffer *col, Form_pg_attribute attr,
+					   Datum value)
+{
+	if (!attr->attbyval &&
+		att_addlength_datum(0, attr->attlen, value) > COLUMNAR_MAX_MINMAX_SIZE)
+	{
+		col->cmp = NULL;
+		col->has_minmax = false;
+		return;
+	}
+
+	if (!col->has_minmax)
+	{
+		col->min = datumCopy(value, attr->attbyval, attr->attlen);
+		col->max = datumCopy(value, attr->attbyval, attr->attlen);
+		col->has_minmax = true;
+		return;
+	}
+
+	if (DatumGetInt32(FunctionCall2Coll(col->cmp, attr->attcollation,
+										value, col->min)) < 0)
+	{
+		if (!attr->attbyval)
+			pfree(DatumGetPointer(col->min));
+		col->min = datumCopy(value, attr->attbyval, attr->attlen);
+	}
+	else if (DatumGetInt32(FunctionCall2Coll(col->cmp, attr->attcollation,
+											 value, col->max)) > 0)
+	{
+		if (!attr->attbyval)
+			pfree(DatumGetPointer(col->max));
+		col->max = datumCopy(value, attr->attbyval, attr->attlen);
+	}
+}
+
+/*
+ * Append a value to a column's data, aligned as it would be in a tuple.
+ */
+static void
+columnar_append_value(StringInfo buf, Form_pg_attribute attr, Datum value)
+{
+	Size		len = att_addlength_datum(0, attr->attlen, value);
+	int			off = att_align_nominal(buf->len, attr->attalign);
+
+	enlargeStringInfo(buf, off - buf->len + len);
+	memset(buf->data + buf->len, 0, off - buf->len);
+	if (attr->attbyval)
+		store_att_byval(buf->data + off, value, attr->attlen);
+	else
+		memcpy(buf->data + off, DatumGetPointer(value), len);
+	buf->len = off + len;
+}
+
+static void
+columnar_append_zeros(StringInfo buf, Size len)
+{
+	enlargeStringInfo(buf, len);
+	memset(buf->data + buf->len, 0, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+}
+
+static void
+columnar_append_align(StringInfo buf)
+{
+	columnar_append_zeros(buf, MAXALIGN(buf->len) - buf->len);
+}
+
+/*
+ * Add a row to a write buffer.  Returns true if the buffer is full and has
+ * to be written out before any more rows are added.
+ */
+bool
+columnar_buffer_add_row(ColumnarWriteBuffer *wbuf, Datum *values, bool *isnull)
+{
+	TupleDesc	tupdesc = wbuf->tupdesc;
+	uint32		row = wbuf->nrows;
+	MemoryContext oldcontext;
+	int			i;
+
+	Assert(row < wbuf->maxrows);
+
+	oldcontext = MemoryContextSwitchTo(wbuf->context);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+		ColumnarColumnBuffer *col = &wbuf->cols[i];
+		Datum		value;
+
+		if (isnull[i] || attr->attisdropped)
+		{
+			col->nnulls++;
+			continue;
+		}
+		col->nullbits[row >> 3] |= (1 << (row & 0x07));
+
+		/* varlenas are always stored plain, with a 4-byte header */
+		value = values[i];
+		if (attr->attlen == -1)
+			value = PointerGetDatum(PG_DETOAST_DATUM(value));
+
+		wbuf->datasize -= col->data.len;
+		columnar_append_value(&col->data, attr, value);
+		wbuf->datasize += col->data.len;
+		if (col->cmp != NULL)
+			columnar_update_minmax(col, attr, value);
+
+		if (value != values[i])
+			pfree(DatumGetPointer(value));
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	wbuf->nrows++;
+
+	return wbuf->nrows >= wbuf->maxrows ||
+		wbuf->datasize >= COLUMNAR_STRIPE_FLUSH_SIZE;
+}
+
+/*
+ * Store a min/max value in the stripe header area, or fetch it back.
+ */
+static void
+columnar_append_datum(StringInfo buf, Form_pg_attribute attr, Datum value)
+{
+	if (attr->attbyval)
+		appendBinaryStringInfo(buf, (char *) &value, sizeof(Datum));
+	else
+		appendBinaryStringInfo(buf, DatumGetPointer(value),
+							   att_addlength_datum(0, attr->attlen, value));
+	columnar_append_align(buf);
+}
+
+static Datum
+columnar_fetch_datum(char *ptr, Form_pg_attribute attr, Size *len)
+{
+	Datum		value;
+
+	if (attr->attbyval)
+	{
+		memcpy(&value, ptr, sizeof(Datum));
+		*len = sizeof(Datum);
+	}
+	else
+	{
+		value = PointerGetDatum(ptr);
+		*len = att_addlength_pointer(0, attr->attlen, ptr);
+	}
+	return value;
+}
+
+/*
+ * Compress a chunk with the method selected by columnar_compression.
+ * Returns the data to store, which is "raw" itself if compression didn't
+ * help.
+ */
+static char *
+columnar_compress(char *raw, uint32 rawlen, uint32 *storedlen, uint8 *method)
+{
+	char	   *dest;
+	int32		len;
+
+#ifdef USE_LZ4
+	if (columnar_compression == COLUMNAR_COMPRESSION_LZ4)
+	{
+		int			maxlen = LZ4_compressBound(rawlen);
+
+		dest = palloc(maxlen);
+		len = LZ4_compress_default(raw, dest, rawlen, maxlen);
+		if (len > 0 && len < rawlen)
+		{
+			*storedlen = len;
+			*method = COLUMNAR_COMPRESSION_LZ4;
+			return dest;
+		}
+		pfree(dest);
+	}
+#endif
+
+	if (columnar_compression == COLUMNAR_COMPRESSION_PGLZ)
+	{
+		dest = palloc(PGLZ_MAX_OUTPUT(rawlen));
+		len = pglz_compress(raw, rawlen, dest, PGLZ_strategy_default);
+		if (len >= 0 && len < rawlen)
+		{
+			*storedlen = len;
+			*method = COLUMNAR_COMPRESSION_PGLZ;
+			return dest;
+		}
+		pfree(dest);
+	}
+
+	*storedlen = rawlen;
+	*method = COLUMNAR_COMPRESSION_NONE;
+	return raw;
+}
+
+/*
+ * Write the rows collected in "wbuf" as a new stripe at the end of the
+ * stream.  Does nothing if there are none.
+ */
+void
+columnar_write_stripe(Relation rel, ColumnarWriteBuffer *wbuf)
+{
+	TupleDesc	tupdesc = wbuf->tupdesc;
+	int			natts = tupdesc->natts;
+	ColumnarStripeHeader hdr;
+	ColumnarChunkInfo *chunks;
+	ColumnarMetaPageData meta;
+	StringInfoData stripe;
+	MemoryContext oldcontext;
+	Buffer		metabuf;
+	uint64		offset;
+	uint32		hdrlen;
+	int			i;
+
+	if (wbuf->nrows == 0)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(wbuf->context);
+
+	chunks = (ColumnarChunkInfo *) palloc0(sizeof(ColumnarChunkInfo) * natts);
+
+	/* leave room for the header and chunk infos, filled in at the end */
+	initStringInfo(&stripe);
+	columnar_append_zeros(&stripe, MAXALIGN(sizeof(ColumnarStripeHeader)) +
+						  sizeof(ColumnarChunkInfo) * natts);
+	columnar_append_align(&stripe);
+
+	/* min/max values */
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+		ColumnarColumnBuffer *col = &wbuf->cols[i];
+
+		if (!col->has_minmax)
+			continue;
+		chunks[i].flags |= COLUMNAR_CHUNK_HAS_MINMAX;
+		chunks[i].minmax_off = stripe.len;
+		columnar_append_datum(&stripe, attr, col->min);
+		columnar_append_datum(&stripe, attr, col->max);
+	}
+	hdrlen = stripe.len;
+
+	/* and the column chunks */
+	for (i = 0; i < natts; i++)
+	{
+		ColumnarColumnBuffer *col = &wbuf->cols[i];
+		Size		nulllen = 0;
+		char	   *raw;
+		char	   *stored;
+		uint32		rawlen;
+
+		if (col->nnulls > 0)
+		{
+			nulllen = MAXALIGN(BITMAPLEN(wbuf->nrows));
+			chunks[i].flags |= COLUMNAR_CHUNK_HAS_NULLS;
+		}
+		rawlen = nulllen + col->data.len;
+		raw = palloc0(rawlen);
+		if (nulllen > 0)
+			memcpy(raw, col->nullbits, BITMAPLEN(wbuf->nrows));
+		memcpy(raw + nulllen, col->data.data, col->data.len);
+
+		stored = columnar_compress(raw, rawlen, &chunks[i].storedlen,
+								   &chunks[i].compression);
+
+		chunks[i].offset = stripe.len;
+		chunks[i].rawlen = rawlen;
+		chunks[i].nnulls = col->nnulls;
+		appendBinaryStringInfo(&stripe, stored, chunks[i].storedlen);
+		columnar_append_align(&stripe);
+
+		if (stored != raw)
+			pfree(stored);
+		pfree(raw);
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.xmin = wbuf->xid;
+	hdr.cid = wbuf->cid;
+	hdr.magic = COLUMNAR_MAGIC;
+	hdr.natts = natts;
+	hdr.first_row = wbuf->first_row;
+	hdr.nrows = wbuf->nrows;
+	hdr.hdrlen = hdrlen;
+	hdr.length = stripe.len;
+	memcpy(stripe.data, &hdr, sizeof(hdr));
+	memcpy(ColumnarStripeChunks(stripe.data), chunks,
+		   sizeof(ColumnarChunkInfo) * natts);
+
+	/*
+	 * Append it.  We don't keep the metapage locked while writing the data,
+	 * so as not to hold up readers; the extension lock keeps other writers
+	 * out.
+	 */
+	LockRelationForExtension(rel, ExclusiveLock);
+	metabuf = columnar_lock_metapage(rel, &meta);
+	offset = meta.stream_end;
+	LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+	columnar_write_bytes(rel, offset, stripe.data, stripe.len);
+
+	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+	meta.nstripes++;
+	meta.stream_end = offset + stripe.len;
+	meta.nrows += wbuf->nrows;
+	columnar_write_metapage(rel, metabuf, &meta);
+	UnlockRelationForExtension(rel, ExclusiveLock);
+
+	pfree(stripe.data);
+	pfree(chunks);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Read the header of the stripe at stream offset "offset", including the
+ * chunk infos and min/max values.  The result is palloc'd.
+ */
+ColumnarStripeHeader *
+columnar_read_stripe_header(Relation rel, uint64 offset,
+							BufferAccessStrategy strategy)
+{
+	ColumnarStripeHeader fixed;
+	char	   *result;
+
+	columnar_read_bytes(rel, offset, (char *) &fixed, sizeof(fixed), strategy);
+	if (fixed.magic != COLUMNAR_MAGIC ||
+		fixed.hdrlen < MAXALIGN(sizeof(ColumnarStripeHeader)) +
+		sizeof(ColumnarChunkInfo) * fixed.natts ||
+		fixed.length < fixed.hdrlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid stripe header at offset " UINT64_FORMAT " in columnar table \"%s\"",
+						offset, RelationGetRelationName(rel))));
+
+	result = palloc(fixed.hdrlen);
+	columnar_read_bytes(rel, offset, result, fixed.hdrlen, strategy);
+
+	return (ColumnarStripeHeader *) result;
+}
+
+/*
+ * Get the smallest and largest values of column "attno" in a stripe.
+ * Returns false if they're unknown.  Pass-by-reference results point into
+ * the header.
+ */
+bool
+columnar_chunk_get_minmax(ColumnarStripeHeader *hdr, int attno,
+						  Form_pg_attribute attr, Datum *min, Datum *max)
+{
+	ColumnarChunkInfo *chunk = &ColumnarStripeChunks(hdr)[attno - 1];
+	char	   *ptr;
+	Size		len;
+
+	Assert(attno > 0 && attno <= hdr->natts);
+
+	if ((chunk->flags & COLUMNAR_CHUNK_HAS_MINMAX) == 0)
+		return false;
+
+	ptr = (char *) hdr + chunk->minmax_off;
+	*min = columnar_fetch_datum(ptr, attr, &len);
+	ptr += MAXALIGN(len);
+	*max = columnar_fetch_datum(ptr, attr, &len);
+
+	return true;
+}
+
+/*
+ * Read column "attno" of the stripe at stream offset "offset", whose header
+ * is "hdr", into values/isnull, which must have room for hdr->nrows
+ * entries.  Pass-by-reference values point into memory allocated in the
+ * current memory context.
+ */
+void
+columnar_read_chunk(Relation rel, uint64 offset, ColumnarStripeHeader *hdr,
+					int attno, Form_pg_attribute attr,
+					Datum *values, bool *isnull,
+					BufferAccessStrategy strategy)
+{
+	ColumnarChunkInfo *chunk = &ColumnarStripeChunks(hdr)[attno - 1];
+	bits8	   *nullbits = NULL;
+	char	   *stored;
+	char	   *raw;
+	char	   *data;
+	Size		datalen;
+	Size		off = 0;
+	uint32		i;
+
+	Assert(attno > 0 && attno <= hdr->natts);
+
+	stored = palloc(chunk->storedlen);
+	columnar_read_bytes(rel, offset + chunk->offset, stored, chunk->storedlen,
+						strategy);
+
+	switch (chunk->compression)
+	{
+		case COLUMNAR_COMPRESSION_NONE:
+			raw = stored;
+			break;
+		case COLUMNAR_COMPRESSION_PGLZ:
+			raw = palloc(chunk->rawlen);
+			if (pglz_decompress(stored, chunk->storedlen, raw,
+								chunk->rawlen, true) != chunk->rawlen)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg_internal("compressed columnar data is corrupt")));
+			pfree(stored);
+			break;
+		case COLUMNAR_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			raw = palloc(chunk->rawlen);
+			if (LZ4_decompress_safe(stored, raw, chunk->storedlen,
+									chunk->rawlen) != chunk->rawlen)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg_internal("compressed columnar data is corrupt")));
+			pfree(stored);
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("columnar table \"%s\" contains data compressed with lz4",
+							RelationGetRelationName(rel)),
+					 errdetail("This build does not support lz4 compression.")));
+#endif
+			break;
+		default:
+			elog(ERROR, "invalid compression method %u in columnar table \"%s\"",
+				 chunk->compression, RelationGetRelationName(rel));
+			raw = NULL;			/* keep compiler quiet */
+	}
+
+	data = raw;
+	if (chunk->flags & COLUMNAR_CHUNK_HAS_NULLS)
+	{
+		nullbits = (bits8 *) raw;
+		data += MAXALIGN(BITMAPLEN(hdr->nrows));
+	}
+	datalen = chunk->rawlen - (data - raw);
+
+	for (i = 0; i < hdr->nrows; i++)
+	{
+		if (nullbits && att_isnull(i, nullbits))
+		{
+			values[i] = (Datum) 0;
+			isnull[i] = true;
+			continue;
+		}
+
+		off = att_align_nominal(off, attr->attalign);
+		if (off >= datalen)
+			break;
+		values[i] = fetchatt(attr, data + off);
+		isnull[i] = false;
+		off = att_addlength_pointer(off, attr->attlen, data + off);
+	}
+
+	if (i < hdr->nrows || off != datalen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid data for column %d at offset " UINT64_FORMAT " in columnar table \"%s\"",
+						attno, offset, RelationGetRelationName(rel))));
+}
+
+/*
+ * Overwrite the xmin of the stripe at stream offset "offset", for VACUUM.
+ */
+void
+columnar_set_stripe_xmin(Relation rel, uint64 offset, TransactionId xmin)
+{
+	/*
+	 * Stripes start at MAXALIGN'd offsets and xmin comes first, so it can't
+	 * straddle a page boundary; the update is atomic for readers.
+	 */
+	StaticAssertStmt(offsetof(ColumnarStripeHeader, xmin) == 0,
+					 "xmin must be the first field of ColumnarStripeHeader");
+	columnar_write_bytes(rel, offset, (char *) &xmin, sizeof(TransactionId));
+}
+
+/*
+ * Is a stripe visible to "snapshot"?  All rows of a stripe are inserted by
+ * the same command and never deleted, so this is all there is to MVCC for
+ * columnar tables.
+ */
+bool
+columnar_stripe_is_visible(ColumnarStripeHeader *hdr, Snapshot snapshot)
+{
+	TransactionId xmin = hdr->xmin;
+
+	if (!TransactionIdIsValid(xmin))
+		return false;			/* inserter aborted, see VACUUM */
+	if (snapshot->snapshot_type == SNAPSHOT_ANY)
+		return true;
+	if (TransactionIdEquals(xmin, FrozenTransactionId))
+		return true;
+
+	if (TransactionIdIsCurrentTransactionId(xmin))
+		return !IsMVCCSnapshot(snapshot) || hdr->cid < snapshot->curcid;
+
+	if (IsMVCCSnapshot(snapshot))
+	{
+		if (XidInMVCCSnapshot(xmin, snapshot))
+			return false;
+	}
+	else if (TransactionIdIsInProgress(xmin))
+		return false;
+
+	return TransactionIdDidCommit(xmin);
+}
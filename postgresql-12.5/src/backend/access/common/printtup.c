@@ -19,6 +19,8 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "tcop/pquery.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
@@ -430,8 +432,31 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 		{
 			/* Text output */
 			char	   *outputstr;
-
-			outputstr = OutputFunctionCall(&thisState->finfo, attr);
+			char		numbuf[MAXINT8LEN + 1];
+
+			/*
+			 * Integers are common enough in result sets to be worth
+			 * formatting inline rather than through their output functions,
+			 * which would also palloc a result string.
+			 */
+			switch (thisState->typoutput)
+			{
+				case F_INT2OUT:
+					pg_itoa(DatumGetInt16(attr), numbuf);
+					outputstr = numbuf;
+					break;
+				case F_INT4OUT:
+					pg_ltoa(DatumGetInt32(attr), numbuf);
+					outputstr = numbuf;
+					break;
+				case F_INT8OUT:
+					pg_lltoa(DatumGetInt64(attr), numbuf);
+					outputstr = numbuf;
+					break;
+				default:
+					outputstr = OutputFunctionCall(&thisState->finfo, attr);
+					break;
+			}
 			pq_sendcountedtext(buf, outputstr, strlen(outputstr), false);
 		}
 		else
@@ -439,6 +464,10 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 			/* Binary output */
 			bytea	   *outputbytes;
 
+			/* Common fixed-width types needn't go through typsend */
+			if (pq_sendfixedbinary(buf, thisState->typsend, attr))
+				continue;
+
 			outputbytes = SendFunctionCall(&thisState->finfo, attr);
 			pq_sendint32(buf, VARSIZE(outputbytes) - VARHDRSZ);
 			pq_sendbytes(buf, VARDATA(outputbytes),
@@ -226,6 +226,8 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	bool		requestCleanup = false;
+	BlockNumber prevPendingPages = 0;
 	int			cleanupSize;
 	bool		needWal;
 
@@ -259,6 +261,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	{
 		LockBuffer(metabuffer, GIN_EXCLUSIVE);
 		metadata = GinPageGetMeta(metapage);
+		prevPendingPages = metadata->nPendingPages;
 
 		if (metadata->head == InvalidBlockNumber ||
 			collector->sumsize + collector->ntuples * sizeof(ItemIdData) > metadata->tailFreeSize)
@@ -292,6 +295,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 		 */
 		LockBuffer(metabuffer, GIN_EXCLUSIVE);
 		metadata = GinPageGetMeta(metapage);
+		prevPendingPages = metadata->nPendingPages;
 
 		if (metadata->head == InvalidBlockNumber)
 		{
@@ -444,15 +448,50 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 * gin_pending_list_limit.
 	 *
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
+	 *
+	 * If the index has autocleanup enabled, hand the work off to autovacuum
+	 * instead, so that the inserting backend doesn't pay for the merge.  We
+	 * request it only when the list first crosses the limit, to avoid
+	 * flooding the work item queue; if the list keeps growing to twice the
+	 * limit anyway, the request was evidently lost or autovacuum can't keep
+	 * up, so fall back to cleaning it ourselves.
 	 */
 	cleanupSize = GinGetPendingListCleanupSize(index);
 	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
-		needCleanup = true;
+	{
+		if (GinGetAutoCleanup(index) && AutoVacuumingActive())
+		{
+			if (prevPendingPages * GIN_PAGE_FREESIZE <= cleanupSize * 1024L)
+				requestCleanup = true;
+			else if (metadata->nPendingPages * GIN_PAGE_FREESIZE >
+					 cleanupSize * 2048L)
+				needCleanup = true;
+		}
+		else
+			needCleanup = true;
+	}
 
 	UnlockReleaseBuffer(metabuffer);
 
 	END_CRIT_SECTION();
 
+	if (requestCleanup)
+	{
+		bool		recorded;
+
+		recorded = AutoVacuumRequestWork(AVW_GINCleanPendingList,
+										 RelationGetRelid(index),
+										 InvalidBlockNumber);
+		if (!recorded)
+		{
+			ereport(LOG,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("request for GIN pending list cleanup for index \"%s\" was not recorded",
+							RelationGetRelationName(index))));
+			needCleanup = true;
+		}
+	}
+
 	/*
 	 * Since it could contend with concurrent cleanup process we cleanup
 	 * pending list not forcibly.
@@ -16,18 +16,140 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "access/tableam.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/buffile.h"
+#include "storage/condition_variable.h"
+#include "storage/sharedfileset.h"
 #include "storage/smgr.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_GIN_NRUNS			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000005)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * Each participant scans part of the heap with its own build accumulator.
+ * Whenever the accumulator fills up, its entries are written out in key
+ * order as a "run" in a temporary file that belongs to the shared fileset.
+ * Once all participants are done, the leader merges the runs and inserts
+ * the resulting entries into the index, just like a serial build does.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to open the relations
+	 * and size their accumulators.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scanparticipants;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can merge
+	 * their runs.
+	 */
+	ConditionVariable workersdonecv;
+
+	/* Temporary files holding the participants' runs */
+	SharedFileSet fileset;
+
+	/*
+	 * mutex protects all fields that follow.
+	 *
+	 * These fields contain status information of interest to GIN index
+	 * builds that must work just the same when an index is built in parallel.
+	 */
+	slock_t		mutex;
+
+	/*
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at end of parallel scan.
+	 *
+	 * nparticipantsdone is number of worker processes finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of entries extracted from them.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during build.
+	 */
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GinShared;
+
+/*
+ * Return pointer to a GinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GinShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipants is the exact number of worker processes successfully
+	 * launched, plus the leader process, which always participates.
+	 */
+	int			nparticipants;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 *
+	 * nruns is indexed by participant number: ParallelWorkerNumber for
+	 * workers, and the number of requested workers for the leader.
+	 */
+	GinShared  *ginshared;
+	int		   *nruns;
+	Snapshot	snapshot;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+} GinLeader;
+
 typedef struct
 {
 	GinState	ginstate;
@@ -36,8 +158,72 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+
+	/*
+	 * ginleader is only present when a parallel index build is performed,
+	 * and only in the leader process.
+	 */
+	GinLeader  *ginleader;
+
+	/*
+	 * Fields used by a participant of a parallel build to write its runs.
+	 */
+	SharedFileSet *fileset;
+	int			participant;
+	int			nruns;
+	Size		maxmem;
 } GinBuildState;
 
+/*
+ * Header of each entry written to a run.  The key's bytes (if any) and the
+ * item pointers follow.
+ */
+typedef struct GinRunEntryHeader
+{
+	OffsetNumber attnum;
+	GinNullCategory category;
+	uint32		nitems;
+	Size		keylen;
+} GinRunEntryHeader;
+
+/*
+ * A run being read back by the leader, along with its current entry.
+ */
+typedef struct GinBuildRun
+{
+	BufFile    *file;
+	OffsetNumber attnum;
+	GinNullCategory category;
+	Datum		key;
+	bool		keyalloced;
+	ItemPointerData *items;
+	uint32		nitems;
+} GinBuildRun;
+
+typedef struct GinMergeState
+{
+	GinState   *ginstate;
+	GinBuildRun *runs;
+} GinMergeState;
+
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+								Relation index, bool isconcurrent,
+								int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static Size _gin_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _gin_parallel_merge(GinBuildState *buildstate,
+								  IndexInfo *indexInfo);
+static void _gin_leader_participate_as_worker(GinBuildState *buildstate,
+											  Relation heap, Relation index);
+static void _gin_parallel_scan_and_build(GinBuildState *buildstate,
+										 Relation heap, Relation index,
+										 GinShared *ginshared, int *nruns,
+										 int participant, int workmem,
+										 bool progress);
+static void _gin_write_run(GinBuildState *buildstate);
+static bool _gin_read_run_entry(GinState *ginstate, GinBuildRun *run);
+static int	_gin_run_cmp(Datum a, Datum b, void *arg);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -313,6 +499,32 @@ ginBuildCallback(Relation index, HeapTuple htup, Datum *values,
 	MemoryContextSwitchTo(oldCtx);
 }
 
+/*
+ * Per-tuple callback for table_index_build_scan, used by the participants
+ * of a parallel build.  Instead of inserting into the index when the
+ * accumulator fills up, dump its contents to a new run.
+ */
+static void
+_gin_parallel_build_callback(Relation index, HeapTuple htup, Datum *values,
+							 bool *isnull, bool tupleIsAlive, void *state)
+{
+	GinBuildState *buildstate = (GinBuildState *) state;
+	MemoryContext oldCtx;
+	int			i;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	for (i = 0; i < buildstate->ginstate.origTupdesc->natts; i++)
+		ginHeapTupleBulkInsert(buildstate, (OffsetNumber) (i + 1),
+							   values[i], isnull[i],
+							   &htup->t_self);
+
+	if (buildstate->accum.allocatedMemory >= buildstate->maxmem)
+		_gin_write_run(buildstate);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
 IndexBuildResult *
 ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 {
@@ -335,6 +547,8 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	initGinState(&buildstate.ginstate, index);
 	buildstate.indtuples = 0;
 	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.ginleader = NULL;
+	buildstate.fileset = NULL;
 
 	/* initialize the meta page */
 	MetaBuffer = GinNewBuffer(index);
@@ -375,26 +589,45 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
-
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index,
+							indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
+
+	if (buildstate.ginleader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		/*
+		 * Wait for the participants to finish scanning the heap, then merge
+		 * their runs into the index.  The run files go away along with the
+		 * parallel context, so this has to happen before it's shut down.
+		 */
+		reltuples = _gin_parallel_merge(&buildstate, indexInfo);
+		_gin_end_parallel(buildstate.ginleader);
+	}
+	else
+	{
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback,
+										   (void *) &buildstate, NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginBeginBAScan(&buildstate.accum);
+		while ((list = ginGetBAEntry(&buildstate.accum,
+									 &attnum, &key, &category, &nlist)) != NULL)
+		{
+			/* there could be many entries, so be willing to abort here */
+			CHECK_FOR_INTERRUPTS();
+			ginEntryInsert(&buildstate.ginstate, attnum, key, category,
+						   list, nlist, &buildstate.buildStats);
+		}
+		MemoryContextSwitchTo(oldCtx);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -535,3 +768,756 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * ginleader field, which is set here).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	Snapshot	snapshot;
+	Size		estginshared;
+	GinShared  *ginshared;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	int		   *nruns;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and the
+	 * per-participant run counts in PARALLEL_KEY_GIN_NRUNS
+	 */
+	estginshared = _gin_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(int), request + 1));
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for BufferUsage -- PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgBufferUsage, so do
+	 * it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Same thing for WalUsage -- PARALLEL_KEY_WAL_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->scanparticipants = request + 1;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SharedFileSetInit(&ginshared->fileset, pcxt->seg);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinShared(ginshared),
+								  snapshot);
+
+	/* Participants that never get to run must be seen as having no runs */
+	nruns = (int *) shm_toc_allocate(pcxt->toc,
+									 mul_size(sizeof(int), request + 1));
+	memset(nruns, 0, sizeof(int) * (request + 1));
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_NRUNS, nruns);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/* Allocate space for each worker's BufferUsage; no need to initialize */
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Same for WalUsage */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipants = pcxt->nworkers_launched + 1;
+	ginleader->ginshared = ginshared;
+	ginleader->nruns = nruns;
+	ginleader->snapshot = snapshot;
+	ginleader->bufferusage = bufferusage;
+	ginleader->walusage = walusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->ginleader = ginleader;
+
+	/* Join heap scan ourselves */
+	_gin_leader_participate_as_worker(buildstate, heap, index);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i], &ginleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(GinShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan, then merge the runs written by
+ * all participants and insert the merged entries into the index.
+ *
+ * The runs are merged with a binary heap ordered the same way as the build
+ * accumulator orders its entries, so entries arrive in the same order as in
+ * a serial build.  Item pointer lists for the same key are combined before
+ * insertion, since the participants scanned interleaved block ranges.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_merge(GinBuildState *buildstate, IndexInfo *indexInfo)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	GinShared  *ginshared = ginleader->ginshared;
+	GinState   *ginstate = &buildstate->ginstate;
+	GinMergeState mergestate;
+	GinBuildRun *runs;
+	binaryheap *heap;
+	MemoryContext readCtx;
+	MemoryContext pendingCtx;
+	MemoryContext oldCtx;
+	double		reltuples;
+	int			totalruns;
+	int			nrun;
+	int			participant;
+	Size		maxpending;
+	bool		havepending = false;
+	OffsetNumber pattnum = InvalidOffsetNumber;
+	Datum		pkey = (Datum) 0;
+	GinNullCategory pcategory = GIN_CAT_NORM_KEY;
+	ItemPointerData *plist = NULL;
+	uint32		npending = 0;
+
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == ginleader->nparticipants)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			indexInfo->ii_BrokenHotChain = ginshared->brokenhotchain;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	readCtx = AllocSetContextCreate(CurrentMemoryContext,
+									"Gin build run context",
+									ALLOCSET_DEFAULT_SIZES);
+	pendingCtx = AllocSetContextCreate(CurrentMemoryContext,
+									   "Gin build pending entry context",
+									   ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * Open all runs.  Participant numbers run from 0 to the number of
+	 * requested workers, the last one being the leader's.
+	 */
+	totalruns = 0;
+	for (participant = 0; participant <= ginleader->pcxt->nworkers;
+		 participant++)
+		totalruns += ginleader->nruns[participant];
+
+	runs = (GinBuildRun *)
+		MemoryContextAllocZero(readCtx, sizeof(GinBuildRun) * Max(totalruns, 1));
+	mergestate.ginstate = ginstate;
+	mergestate.runs = runs;
+	heap = binaryheap_allocate(Max(totalruns, 1), _gin_run_cmp, &mergestate);
+
+	oldCtx = MemoryContextSwitchTo(readCtx);
+	nrun = 0;
+	for (participant = 0; participant <= ginleader->pcxt->nworkers;
+		 participant++)
+	{
+		int			i;
+
+		for (i = 0; i < ginleader->nruns[participant]; i++)
+		{
+			char		name[MAXPGPATH];
+
+			snprintf(name, sizeof(name), "gin.%d.%d", participant, i);
+			runs[nrun].file = BufFileOpenShared(&ginshared->fileset, name);
+			if (_gin_read_run_entry(ginstate, &runs[nrun]))
+				binaryheap_add_unordered(heap, Int32GetDatum(nrun));
+			nrun++;
+		}
+	}
+	MemoryContextSwitchTo(oldCtx);
+	binaryheap_build(heap);
+
+	/*
+	 * Flush an entry's item pointers early once they take up a good share of
+	 * maintenance_work_mem.  ginEntryInsert() copes with being called more
+	 * than once for the same key.
+	 */
+	maxpending = Min((Size) maintenance_work_mem * 1024L, MaxAllocSize) /
+		(2 * sizeof(ItemPointerData));
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+	while (!binaryheap_empty(heap))
+	{
+		int			i = DatumGetInt32(binaryheap_first(heap));
+		GinBuildRun *run = &runs[i];
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		if (havepending &&
+			ginCompareAttEntries(ginstate, pattnum, pkey, pcategory,
+								 run->attnum, run->key, run->category) == 0)
+		{
+			/* Same key as the pending entry, so combine the lists */
+			MemoryContextSwitchTo(pendingCtx);
+			if (npending == 0)
+			{
+				plist = palloc(sizeof(ItemPointerData) * run->nitems);
+				memcpy(plist, run->items,
+					   sizeof(ItemPointerData) * run->nitems);
+				npending = run->nitems;
+			}
+			else
+			{
+				ItemPointerData *merged;
+				int			nmerged;
+
+				merged = ginMergeItemPointers(plist, npending,
+											  run->items, run->nitems,
+											  &nmerged);
+				pfree(plist);
+				plist = merged;
+				npending = nmerged;
+			}
+			MemoryContextSwitchTo(buildstate->tmpCtx);
+		}
+		else
+		{
+			/* New key, so insert the pending entry and start over */
+			if (havepending && npending > 0)
+			{
+				ginEntryInsert(ginstate, pattnum, pkey, pcategory,
+							   plist, npending, &buildstate->buildStats);
+				MemoryContextReset(buildstate->tmpCtx);
+			}
+			MemoryContextReset(pendingCtx);
+
+			MemoryContextSwitchTo(pendingCtx);
+			pattnum = run->attnum;
+			pcategory = run->category;
+			if (pcategory == GIN_CAT_NORM_KEY)
+			{
+				Form_pg_attribute attr = TupleDescAttr(ginstate->origTupdesc,
+													   pattnum - 1);
+
+				pkey = datumCopy(run->key, attr->attbyval, attr->attlen);
+			}
+			else
+				pkey = (Datum) 0;
+			plist = palloc(sizeof(ItemPointerData) * run->nitems);
+			memcpy(plist, run->items, sizeof(ItemPointerData) * run->nitems);
+			npending = run->nitems;
+			havepending = true;
+			MemoryContextSwitchTo(buildstate->tmpCtx);
+		}
+
+		if (npending >= maxpending)
+		{
+			ginEntryInsert(ginstate, pattnum, pkey, pcategory,
+						   plist, npending, &buildstate->buildStats);
+			MemoryContextReset(buildstate->tmpCtx);
+			pfree(plist);
+			plist = NULL;
+			npending = 0;
+		}
+
+		/* Advance this run, and drop it from the heap once exhausted */
+		MemoryContextSwitchTo(readCtx);
+		if (_gin_read_run_entry(ginstate, run))
+			binaryheap_replace_first(heap, Int32GetDatum(i));
+		else
+		{
+			(void) binaryheap_remove_first(heap);
+			BufFileClose(run->file);
+			run->file = NULL;
+		}
+		MemoryContextSwitchTo(buildstate->tmpCtx);
+	}
+
+	if (havepending && npending > 0)
+		ginEntryInsert(ginstate, pattnum, pkey, pcategory,
+					   plist, npending, &buildstate->buildStats);
+	MemoryContextSwitchTo(oldCtx);
+
+	binaryheap_free(heap);
+	MemoryContextDelete(pendingCtx);
+	MemoryContextDelete(readCtx);
+
+	return reltuples;
+}
+
+/*
+ * Within leader, participate as a parallel worker.
+ */
+static void
+_gin_leader_participate_as_worker(GinBuildState *buildstate, Relation heap,
+								  Relation index)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	GinBuildState *leaderworker;
+	int			workmem;
+
+	/* Allocate memory and initialize private build state */
+	leaderworker = (GinBuildState *) palloc0(sizeof(GinBuildState));
+	initGinState(&leaderworker->ginstate, index);
+
+	/*
+	 * Might as well use reliable figure when doling out maintenance_work_mem
+	 * (when requested number of workers were not launched, this will be
+	 * somewhat higher than it is for other workers).
+	 */
+	workmem = maintenance_work_mem / ginleader->nparticipants;
+
+	/* Perform work common to all participants */
+	_gin_parallel_scan_and_build(leaderworker, heap, index,
+								 ginleader->ginshared, ginleader->nruns,
+								 ginleader->pcxt->nworkers, workmem, true);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	GinBuildState buildstate;
+	int		   *nruns;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+	int			workmem;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+	nruns = shm_toc_lookup(toc, PARALLEL_KEY_GIN_NRUNS, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Attach to the fileset our runs go into */
+	SharedFileSetAttach(&ginshared->fileset, seg);
+
+	/* Initialize worker's own build state */
+	memset(&buildstate, 0, sizeof(GinBuildState));
+	initGinState(&buildstate.ginstate, indexRel);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Scan our share of the heap, writing runs as we go */
+	workmem = maintenance_work_mem / ginshared->scanparticipants;
+	_gin_parallel_scan_and_build(&buildstate, heapRel, indexRel, ginshared,
+								 nruns, ParallelWorkerNumber, workmem, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build.
+ *
+ * Scans the participant's share of the heap, writing the accumulated
+ * entries out as a new run whenever they take up more than workmem KBs, and
+ * once more at the end.  The number of runs written is reported in the
+ * participant's slot of nruns.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_gin_parallel_scan_and_build(GinBuildState *buildstate, Relation heap,
+							 Relation index, GinShared *ginshared,
+							 int *nruns, int participant, int workmem,
+							 bool progress)
+{
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	buildstate->indtuples = 0;
+	buildstate->fileset = &ginshared->fileset;
+	buildstate->participant = participant;
+	buildstate->nruns = 0;
+	buildstate->maxmem = (Size) workmem * 1024L;
+
+	buildstate->tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate->funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+												"Gin build temporary context for user-defined function",
+												ALLOCSET_DEFAULT_SIZES);
+
+	buildstate->accum.ginstate = &buildstate->ginstate;
+	ginInitBA(&buildstate->accum);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   _gin_parallel_build_callback,
+									   (void *) buildstate, scan);
+
+	/* Dump whatever is left in the accumulator */
+	_gin_write_run(buildstate);
+
+	nruns[participant] = buildstate->nruns;
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate->indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+
+	MemoryContextDelete(buildstate->funcCtx);
+	MemoryContextDelete(buildstate->tmpCtx);
+}
+
+/*
+ * Write the contents of a participant's build accumulator out as a new run,
+ * and reset the accumulator.  Nothing is written if it's empty.
+ *
+ * Each entry is a GinRunEntryHeader followed by the key's bytes and the
+ * entry's item pointers.  Entries come out of the accumulator in
+ * ginCompareAttEntries() order, with sorted item pointer lists.
+ */
+static void
+_gin_write_run(GinBuildState *buildstate)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	BufFile    *file = NULL;
+	MemoryContext oldCtx;
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		GinRunEntryHeader hdr;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		if (file == NULL)
+		{
+			char		name[MAXPGPATH];
+
+			snprintf(name, sizeof(name), "gin.%d.%d",
+					 buildstate->participant, buildstate->nruns);
+			file = BufFileCreateShared(buildstate->fileset, name);
+		}
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.attnum = attnum;
+		hdr.category = category;
+		hdr.nitems = nlist;
+		if (category != GIN_CAT_NORM_KEY)
+			hdr.keylen = 0;
+		else
+		{
+			Form_pg_attribute attr = TupleDescAttr(ginstate->origTupdesc,
+												   attnum - 1);
+
+			if (attr->attbyval)
+				hdr.keylen = sizeof(Datum);
+			else
+				hdr.keylen = datumGetSize(key, false, attr->attlen);
+		}
+
+		BufFileWrite(file, (void *) &hdr, sizeof(hdr));
+		if (hdr.keylen > 0)
+		{
+			if (TupleDescAttr(ginstate->origTupdesc, attnum - 1)->attbyval)
+				BufFileWrite(file, (void *) &key, sizeof(Datum));
+			else
+				BufFileWrite(file, DatumGetPointer(key), hdr.keylen);
+		}
+		BufFileWrite(file, (void *) list, sizeof(ItemPointerData) * nlist);
+	}
+
+	if (file != NULL)
+	{
+		BufFileClose(file);
+		buildstate->nruns++;
+	}
+
+	MemoryContextReset(buildstate->tmpCtx);
+	ginInitBA(&buildstate->accum);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Read the next entry of a run into *run, replacing its current entry.
+ * Returns false at the end of the run.
+ *
+ * The entry is allocated in the caller's memory context.
+ */
+static bool
+_gin_read_run_entry(GinState *ginstate, GinBuildRun *run)
+{
+	GinRunEntryHeader hdr;
+	size_t		nread;
+	size_t		itemslen;
+
+	if (run->keyalloced)
+		pfree(DatumGetPointer(run->key));
+	if (run->items)
+		pfree(run->items);
+	run->key = (Datum) 0;
+	run->keyalloced = false;
+	run->items = NULL;
+	run->nitems = 0;
+
+	nread = BufFileRead(run->file, (void *) &hdr, sizeof(hdr));
+	if (nread == 0)				/* end of file */
+		return false;
+	if (nread != sizeof(hdr))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN build temporary file: read only %zu of %zu bytes",
+						nread, sizeof(hdr))));
+
+	run->attnum = hdr.attnum;
+	run->category = hdr.category;
+	run->nitems = hdr.nitems;
+
+	if (hdr.keylen > 0)
+	{
+		if (TupleDescAttr(ginstate->origTupdesc, hdr.attnum - 1)->attbyval)
+		{
+			Assert(hdr.keylen == sizeof(Datum));
+			nread = BufFileRead(run->file, (void *) &run->key, sizeof(Datum));
+		}
+		else
+		{
+			char	   *keydata = palloc(hdr.keylen);
+
+			nread = BufFileRead(run->file, keydata, hdr.keylen);
+			run->key = PointerGetDatum(keydata);
+			run->keyalloced = true;
+		}
+		if (nread != hdr.keylen)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from GIN build temporary file: read only %zu of %zu bytes",
+							nread, hdr.keylen)));
+	}
+
+	itemslen = sizeof(ItemPointerData) * hdr.nitems;
+	run->items = (ItemPointerData *) palloc(itemslen);
+	nread = BufFileRead(run->file, (void *) run->items, itemslen);
+	if (nread != itemslen)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN build temporary file: read only %zu of %zu bytes",
+						nread, itemslen)));
+
+	return true;
+}
+
+/*
+ * Comparator for the binary heap used to merge runs.  binaryheap.c keeps
+ * the largest element on top, so invert the entry ordering.
+ */
+static int
+_gin_run_cmp(Datum a, Datum b, void *arg)
+{
+	GinMergeState *mergestate = (GinMergeState *) arg;
+	GinBuildRun *ra = &mergestate->runs[DatumGetInt32(a)];
+	GinBuildRun *rb = &mergestate->runs[DatumGetInt32(b)];
+
+	return -ginCompareAttEntries(mergestate->ginstate,
+								 ra->attnum, ra->key, ra->category,
+								 rb->attnum, rb->key, rb->category);
+}
@@ -361,25 +361,32 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 		opaque->rightlink != InvalidBlockNumber /* sanity check */ )
 	{
 		/* There was a page split, follow right link to add pages */
-		GISTSearchItem *item;
 
 		/* This can't happen when starting at the root */
 		Assert(myDistances != NULL);
 
-		oldcxt = MemoryContextSwitchTo(so->queueCxt);
+		/* In a parallel scan, any participant may visit the sibling */
+		if (scan->parallel_scan == NULL ||
+			!gistParallelPush(scan, opaque->rightlink,
+							  pageItem->data.parentlsn))
+		{
+			GISTSearchItem *item;
 
-		/* Create new GISTSearchItem for the right sibling index page */
-		item = palloc(SizeOfGISTSearchItem(scan->numberOfOrderBys));
-		item->blkno = opaque->rightlink;
-		item->data.parentlsn = pageItem->data.parentlsn;
+			oldcxt = MemoryContextSwitchTo(so->queueCxt);
 
-		/* Insert it into the queue using same distances as for this page */
-		memcpy(item->distances, myDistances,
-			   sizeof(item->distances[0]) * scan->numberOfOrderBys);
+			/* Create new GISTSearchItem for the right sibling index page */
+			item = palloc(SizeOfGISTSearchItem(scan->numberOfOrderBys));
+			item->blkno = opaque->rightlink;
+			item->data.parentlsn = pageItem->data.parentlsn;
 
-		pairingheap_add(so->queue, &item->phNode);
+			/* Insert it into the queue using same distances as for this page */
+			memcpy(item->distances, myDistances,
+				   sizeof(item->distances[0]) * scan->numberOfOrderBys);
 
-		MemoryContextSwitchTo(oldcxt);
+			pairingheap_add(so->queue, &item->phNode);
+
+			MemoryContextSwitchTo(oldcxt);
+		}
 	}
 
 	/*
@@ -393,6 +400,8 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 	if (GistPageIsDeleted(page))
 	{
 		UnlockReleaseBuffer(buffer);
+		if (so->parallelBusy)
+			gistParallelPageDone(scan);
 		return;
 	}
 
@@ -476,6 +485,15 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 			}
 			so->nPageData++;
 		}
+		else if (scan->parallel_scan != NULL && !GistPageIsLeaf(page) &&
+				 gistParallelPush(scan, ItemPointerGetBlockNumber(&it->t_tid),
+								  BufferGetLSNAtomic(buffer)))
+		{
+			/*
+			 * Parallel scan, and the lower index page has been handed over to
+			 * the shared stack for whichever participant gets to it first.
+			 */
+		}
 		else
 		{
 			/*
@@ -529,22 +547,34 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 	}
 
 	UnlockReleaseBuffer(buffer);
+
+	/* all downlinks found on the page are queued, let others finish */
+	if (so->parallelBusy)
+		gistParallelPageDone(scan);
 }
 
 /*
  * Extract next item (in order) from search queue
  *
+ * In a parallel scan, pages are taken from the shared stack once our private
+ * queue is exhausted.
+ *
  * Returns a GISTSearchItem or NULL.  Caller must pfree item when done with it.
  */
 static GISTSearchItem *
-getNextGISTSearchItem(GISTScanOpaque so)
+getNextGISTSearchItem(IndexScanDesc scan)
 {
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
 	GISTSearchItem *item;
 
 	if (!pairingheap_is_empty(so->queue))
 	{
 		item = (GISTSearchItem *) pairingheap_remove_first(so->queue);
 	}
+	else if (scan->parallel_scan != NULL)
+	{
+		item = gistParallelNext(scan);
+	}
 	else
 	{
 		/* Done when both heaps are empty */
@@ -573,7 +603,7 @@ getNextNearest(IndexScanDesc scan)
 
 	do
 	{
-		GISTSearchItem *item = getNextGISTSearchItem(so);
+		GISTSearchItem *item = getNextGISTSearchItem(scan);
 
 		if (!item)
 			break;
@@ -634,13 +664,23 @@ gistgettuple(IndexScanDesc scan, ScanDirection dir)
 		if (so->pageDataCxt)
 			MemoryContextReset(so->pageDataCxt);
 
-		fakeItem.blkno = GIST_ROOT_BLKNO;
-		memset(&fakeItem.data.parentlsn, 0, sizeof(GistNSN));
-		gistScanPage(scan, &fakeItem, NULL, NULL, NULL);
+		/*
+		 * In a parallel scan, the root page is waiting on the shared stack
+		 * for whichever participant gets there first.
+		 */
+		if (scan->parallel_scan == NULL)
+		{
+			fakeItem.blkno = GIST_ROOT_BLKNO;
+			memset(&fakeItem.data.parentlsn, 0, sizeof(GistNSN));
+			gistScanPage(scan, &fakeItem, NULL, NULL, NULL);
+		}
 	}
 
 	if (scan->numberOfOrderBys > 0)
 	{
+		/* Ordered scans are never parallel, see build_index_paths() */
+		Assert(scan->parallel_scan == NULL);
+
 		/* Must fetch tuples in strict distance order */
 		return getNextNearest(scan);
 	}
@@ -714,7 +754,7 @@ gistgettuple(IndexScanDesc scan, ScanDirection dir)
 				if ((so->curBlkno != InvalidBlockNumber) && (so->numKilled > 0))
 					gistkillitems(scan);
 
-				item = getNextGISTSearchItem(so);
+				item = getNextGISTSearchItem(scan);
 
 				if (!item)
 					return false;
@@ -769,7 +809,7 @@ gistgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	 */
 	for (;;)
 	{
-		GISTSearchItem *item = getNextGISTSearchItem(so);
+		GISTSearchItem *item = getNextGISTSearchItem(scan);
 
 		if (!item)
 			break;
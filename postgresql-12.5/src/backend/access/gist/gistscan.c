@@ -17,11 +17,47 @@
 #include "access/gist_private.h"
 #include "access/gistscan.h"
 #include "access/relscan.h"
+#include "pgstat.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
 #include "utils/float.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
+/*
+ * Maximum number of index pages the shared queue of a parallel scan can
+ * hold.  Participants keep any pages that don't fit in their private queue.
+ */
+#define GIST_PARALLEL_QUEUE_SIZE	1024
+
+typedef struct GISTParallelScanItem
+{
+	BlockNumber blkno;			/* index page to visit */
+	GistNSN		parentlsn;		/* LSN of its parent when the downlink was
+								 * seen */
+} GISTParallelScanItem;
+
+/*
+ * GISTParallelScanDescData contains GiST specific shared information required
+ * for parallel scan.  Participants take index pages from a shared stack and
+ * push the matching downlinks they find back onto it, so that the tree is
+ * traversed by all participants at once.  The scan is complete once the stack
+ * is empty and nobody is in the middle of scanning a page, which could still
+ * yield more downlinks.
+ */
+typedef struct GISTParallelScanDescData
+{
+	slock_t		gps_mutex;		/* protects the fields below */
+	int			gps_nitems;		/* number of pages in gps_items */
+	int			gps_nbusy;		/* participants scanning a page taken from
+								 * the stack */
+	ConditionVariable gps_cv;	/* used to wait for more pages */
+	GISTParallelScanItem gps_items[GIST_PARALLEL_QUEUE_SIZE];
+} GISTParallelScanDescData;
+
+typedef struct GISTParallelScanDescData *GISTParallelScanDesc;
+
 
 /*
  * Pairing heap comparison function for the GISTSearchItem queue
@@ -110,6 +146,7 @@ gistbeginscan(Relation r, int nkeys, int norderbys)
 	so->numKilled = 0;
 	so->curBlkno = InvalidBlockNumber;
 	so->curPageLSN = InvalidXLogRecPtr;
+	so->parallelBusy = false;
 
 	scan->opaque = so;
 
@@ -343,6 +380,8 @@ gistrescan(IndexScanDesc scan, ScanKey key, int nkeys,
 
 	/* any previous xs_hitup will have been pfree'd in context resets above */
 	scan->xs_hitup = NULL;
+
+	so->parallelBusy = false;
 }
 
 void
@@ -356,3 +395,178 @@ gistendscan(IndexScanDesc scan)
 	 */
 	freeGISTstate(so->giststate);
 }
+
+/*
+ * gistestimateparallelscan -- estimate storage for GISTParallelScanDescData
+ */
+Size
+gistestimateparallelscan(void)
+{
+	return sizeof(GISTParallelScanDescData);
+}
+
+/*
+ * gistinitparallelscan -- initialize GISTParallelScanDesc for parallel GiST
+ * scan
+ *
+ * The root page is put on the shared stack right away, so whichever
+ * participant gets there first starts the scan.
+ */
+void
+gistinitparallelscan(void *target)
+{
+	GISTParallelScanDesc gist_target = (GISTParallelScanDesc) target;
+
+	SpinLockInit(&gist_target->gps_mutex);
+	gist_target->gps_items[0].blkno = GIST_ROOT_BLKNO;
+	gist_target->gps_items[0].parentlsn = InvalidXLogRecPtr;
+	gist_target->gps_nitems = 1;
+	gist_target->gps_nbusy = 0;
+	ConditionVariableInit(&gist_target->gps_cv);
+}
+
+/*
+ *	gistparallelrescan() -- reset parallel scan
+ */
+void
+gistparallelrescan(IndexScanDesc scan)
+{
+	GISTParallelScanDesc gistscan;
+	ParallelIndexScanDesc parallel_scan = scan->parallel_scan;
+
+	Assert(parallel_scan);
+
+	gistscan = (GISTParallelScanDesc) OffsetToPointer((void *) parallel_scan,
+													  parallel_scan->ps_offset);
+
+	/*
+	 * No other participant can be running at this point, but take the
+	 * spinlock anyway for consistency.
+	 */
+	SpinLockAcquire(&gistscan->gps_mutex);
+	gistscan->gps_items[0].blkno = GIST_ROOT_BLKNO;
+	gistscan->gps_items[0].parentlsn = InvalidXLogRecPtr;
+	gistscan->gps_nitems = 1;
+	gistscan->gps_nbusy = 0;
+	SpinLockRelease(&gistscan->gps_mutex);
+}
+
+/*
+ * gistParallelPush() -- Hand an index page over to the other participants
+ *
+ * Returns false if the shared stack is full, in which case the caller must
+ * visit the page itself.
+ */
+bool
+gistParallelPush(IndexScanDesc scan, BlockNumber blkno, GistNSN parentlsn)
+{
+	ParallelIndexScanDesc parallel_scan = scan->parallel_scan;
+	GISTParallelScanDesc gistscan;
+	bool		pushed = false;
+
+	gistscan = (GISTParallelScanDesc) OffsetToPointer((void *) parallel_scan,
+													  parallel_scan->ps_offset);
+
+	SpinLockAcquire(&gistscan->gps_mutex);
+	if (gistscan->gps_nitems < GIST_PARALLEL_QUEUE_SIZE)
+	{
+		gistscan->gps_items[gistscan->gps_nitems].blkno = blkno;
+		gistscan->gps_items[gistscan->gps_nitems].parentlsn = parentlsn;
+		gistscan->gps_nitems++;
+		pushed = true;
+	}
+	SpinLockRelease(&gistscan->gps_mutex);
+
+	if (pushed)
+		ConditionVariableSignal(&gistscan->gps_cv);
+
+	return pushed;
+}
+
+/*
+ * gistParallelNext() -- Take the next index page off the shared stack
+ *
+ * If the stack is empty but some other participant is still scanning a page,
+ * wait for it, as it may push more.  Returns NULL once the whole index has
+ * been scanned.  Otherwise the returned item is allocated in the queue
+ * context, like the ones in the private queue, and the caller must call
+ * gistParallelPageDone() once it has scanned the page.
+ */
+GISTSearchItem *
+gistParallelNext(IndexScanDesc scan)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	ParallelIndexScanDesc parallel_scan = scan->parallel_scan;
+	GISTParallelScanDesc gistscan;
+	GISTSearchItem *item = NULL;
+	bool		found = false;
+
+	Assert(!so->parallelBusy);
+
+	gistscan = (GISTParallelScanDesc) OffsetToPointer((void *) parallel_scan,
+													  parallel_scan->ps_offset);
+
+	for (;;)
+	{
+		bool		done = false;
+		GISTParallelScanItem sitem;
+
+		SpinLockAcquire(&gistscan->gps_mutex);
+		if (gistscan->gps_nitems > 0)
+		{
+			gistscan->gps_nitems--;
+			sitem = gistscan->gps_items[gistscan->gps_nitems];
+			gistscan->gps_nbusy++;
+			found = true;
+		}
+		else if (gistscan->gps_nbusy == 0)
+			done = true;
+		SpinLockRelease(&gistscan->gps_mutex);
+
+		if (found)
+		{
+			item = MemoryContextAlloc(so->queueCxt,
+									  SizeOfGISTSearchItem(scan->numberOfOrderBys));
+			item->blkno = sitem.blkno;
+			item->data.parentlsn = sitem.parentlsn;
+			so->parallelBusy = true;
+			break;
+		}
+		if (done)
+			break;
+
+		ConditionVariableSleep(&gistscan->gps_cv, WAIT_EVENT_GIST_PAGE);
+	}
+	ConditionVariableCancelSleep();
+
+	return item;
+}
+
+/*
+ * gistParallelPageDone() -- Report that we have finished scanning the page
+ * returned by gistParallelNext(), and pushed all its downlinks.
+ */
+void
+gistParallelPageDone(IndexScanDesc scan)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	ParallelIndexScanDesc parallel_scan = scan->parallel_scan;
+	GISTParallelScanDesc gistscan;
+	bool		finished;
+
+	Assert(so->parallelBusy);
+
+	gistscan = (GISTParallelScanDesc) OffsetToPointer((void *) parallel_scan,
+													  parallel_scan->ps_offset);
+
+	SpinLockAcquire(&gistscan->gps_mutex);
+	gistscan->gps_nbusy--;
+	finished = (gistscan->gps_nbusy == 0 && gistscan->gps_nitems == 0);
+	SpinLockRelease(&gistscan->gps_mutex);
+
+	so->parallelBusy = false;
+
+	/* wake up anyone waiting for more pages, so they can finish too */
+	if (finished)
+		ConditionVariableBroadcast(&gistscan->gps_cv);
+}
@@ -29,6 +29,7 @@
 #include "access/hash.h"
 #include "catalog/pg_collation.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/hashutils.h"
 #include "utils/pg_locale.h"
 
@@ -386,3 +387,77 @@ hashvarlenaextended(PG_FUNCTION_ARGS)
 
 	return result;
 }
+
+/*
+ * hash_builtin_datum -- evaluate a common hash support function directly
+ *
+ * If fn_oid is the standard hash function of one of the common fixed-width
+ * types, or hashtext under a deterministic built-in collation, compute into
+ * *hash the value that function would return for "value" and return true.
+ * Otherwise return false; the caller must then call the function through
+ * fmgr as usual.  The results are identical either way, so callers may mix
+ * the two paths freely (for instance on the two sides of a hash join).
+ *
+ * This exists so that executor nodes hashing many tuples per second can skip
+ * building a FunctionCallInfo for every column of every tuple.
+ */
+bool
+hash_builtin_datum(Oid fn_oid, Oid collation, Datum value, uint32 *hash)
+{
+	switch (fn_oid)
+	{
+		case F_HASHCHAR:
+			*hash = DatumGetUInt32(hash_uint32((int32) DatumGetChar(value)));
+			return true;
+
+		case F_HASHINT2:
+			*hash = DatumGetUInt32(hash_uint32((int32) DatumGetInt16(value)));
+			return true;
+
+		case F_HASHINT4:
+			*hash = DatumGetUInt32(hash_uint32(DatumGetInt32(value)));
+			return true;
+
+		case F_HASHOID:
+		case F_HASHENUM:
+			*hash = DatumGetUInt32(hash_uint32((uint32) DatumGetObjectId(value)));
+			return true;
+
+		case F_HASHINT8:
+		case F_TIMESTAMP_HASH:
+		case F_TIME_HASH:
+			{
+				/* keep this in sync with hashint8() */
+				int64		val = DatumGetInt64(value);
+				uint32		lohalf = (uint32) val;
+				uint32		hihalf = (uint32) (val >> 32);
+
+				lohalf ^= (val >= 0) ? hihalf : ~hihalf;
+				*hash = DatumGetUInt32(hash_uint32(lohalf));
+				return true;
+			}
+
+		case F_HASHTEXT:
+			{
+				text	   *key;
+
+				/*
+				 * The database default and C collations are always
+				 * deterministic, so hashtext() hashes the raw bytes.
+				 */
+				if (collation != DEFAULT_COLLATION_OID &&
+					collation != C_COLLATION_OID)
+					return false;
+
+				key = DatumGetTextPP(value);
+				*hash = DatumGetUInt32(hash_any((unsigned char *) VARDATA_ANY(key),
+												VARSIZE_ANY_EXHDR(key)));
+				if ((Pointer) key != DatumGetPointer(value))
+					pfree(key);
+				return true;
+			}
+
+		default:
+			return false;
+	}
+}
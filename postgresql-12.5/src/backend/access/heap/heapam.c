@@ -32,6 +32,8 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/bufmask.h"
 #include "access/genam.h"
 #include "access/heapam.h"
@@ -63,6 +65,7 @@
 #include "storage/spin.h"
 #include "storage/standby.h"
 #include "utils/datum.h"
+#include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/relcache.h"
@@ -76,9 +79,6 @@ static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
 								  Buffer newbuf, HeapTuple oldtup,
 								  HeapTuple newtup, HeapTuple old_key_tup,
 								  bool all_visible_cleared, bool new_all_visible_cleared);
-static Bitmapset *HeapDetermineModifiedColumns(Relation relation,
-											   Bitmapset *interesting_cols,
-											   HeapTuple oldtup, HeapTuple newtup);
 static bool heap_acquire_tuplock(Relation relation, ItemPointer tid,
 								 LockTupleMode mode, LockWaitPolicy wait_policy,
 								 bool *have_tuple_lock);
@@ -241,6 +241,11 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	 *
 	 * Note that table_block_parallelscan_initialize has a very similar test;
 	 * if you change this, consider changing that one, too.
+	 *
+	 * Temporary tables are compared against temp_buffers instead, and never
+	 * use synchronized scanning since no other backend can see them.  The
+	 * strategy keeps a large temp table scan from flushing the rest of the
+	 * local buffer pool, and turns on read-ahead below.
 	 */
 	if (!RelationUsesLocalBuffers(scan->rs_base.rs_rd) &&
 		scan->rs_nblocks > NBuffers / 4)
@@ -248,6 +253,12 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 		allow_strat = (scan->rs_base.rs_flags & SO_ALLOW_STRAT) != 0;
 		allow_sync = (scan->rs_base.rs_flags & SO_ALLOW_SYNC) != 0;
 	}
+	else if (RelationUsesLocalBuffers(scan->rs_base.rs_rd) &&
+			 scan->rs_nblocks > num_temp_buffers / 4)
+	{
+		allow_strat = (scan->rs_base.rs_flags & SO_ALLOW_STRAT) != 0;
+		allow_sync = false;
+	}
 	else
 		allow_strat = allow_sync = false;
 
@@ -264,6 +275,34 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 		scan->rs_strategy = NULL;
 	}
 
+	/*
+	 * A sequential scan that is big enough to use a bulk-read strategy is
+	 * likely to miss in shared buffers on most pages, so prefetch ahead of
+	 * it to keep several reads in flight.  The distance is derived from the
+	 * tablespace's effective_io_concurrency, as for bitmap heap scans.
+	 * Parallel scans hand out blocks one at a time across workers, so we
+	 * can't tell which ones this backend will read next.
+	 */
+	scan->rs_prefetch_maximum = 0;
+	scan->rs_prefetch_target = 0;
+	scan->rs_prefetch_ahead = 0;
+#ifdef USE_PREFETCH
+	if (scan->rs_strategy != NULL &&
+		scan->rs_base.rs_parallel == NULL &&
+		(scan->rs_base.rs_flags & SO_TYPE_SEQSCAN))
+	{
+		Relation	rel = scan->rs_base.rs_rd;
+		double		maximum;
+
+		/* looking up the tablespace of a catalog could recurse */
+		if (IsCatalogRelation(rel))
+			scan->rs_prefetch_maximum = target_prefetch_pages;
+		else if (ComputeIoConcurrency(get_tablespace_io_concurrency(rel->rd_rel->reltablespace),
+									  &maximum))
+			scan->rs_prefetch_maximum = rint(maximum);
+	}
+#endif
+
 	if (scan->rs_base.rs_parallel != NULL)
 	{
 		/* For parallel scan, believe whatever ParallelTableScanDesc says. */
@@ -341,6 +380,69 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 	scan->rs_numblocks = numBlks;
 }
 
+#ifdef USE_PREFETCH
+/*
+ * heap_prefetch_ahead - subroutine for heapgetpage()
+ *
+ * Issue prefetches for the pages following "page" in a forward sequential
+ * scan.  Like a bitmap heap scan, we start with a small distance and double
+ * it on each page until we reach rs_prefetch_maximum, so that a scan that
+ * stops early (say, under a LIMIT) doesn't waste much I/O.  If the scan
+ * doesn't move forward one page at a time, we stop prefetching until it
+ * does again.
+ */
+static void
+heap_prefetch_ahead(HeapScanDesc scan, BlockNumber page)
+{
+	BlockNumber remaining;
+
+	if (!BlockNumberIsValid(scan->rs_cblock))
+	{
+		/* Start of the scan; only a forward scan starts at rs_startblock */
+		scan->rs_prefetch_ahead = 0;
+		if (page != scan->rs_startblock)
+		{
+			scan->rs_prefetch_target = 0;
+			return;
+		}
+		scan->rs_prefetch_target = 1;
+	}
+	else if (page == (scan->rs_cblock + 1) % scan->rs_nblocks)
+	{
+		/* We've consumed one of the pages prefetched before, if any */
+		if (scan->rs_prefetch_ahead > 0)
+			scan->rs_prefetch_ahead--;
+		if (scan->rs_prefetch_target == 0)
+			scan->rs_prefetch_target = 1;
+		else if (scan->rs_prefetch_target < scan->rs_prefetch_maximum)
+			scan->rs_prefetch_target = Min(scan->rs_prefetch_target * 2,
+										   scan->rs_prefetch_maximum);
+	}
+	else
+	{
+		scan->rs_prefetch_ahead = 0;
+		scan->rs_prefetch_target = 0;
+		return;
+	}
+
+	/* Don't prefetch past the end of the scan */
+	remaining = (scan->rs_startblock + scan->rs_nblocks - page - 1) %
+		scan->rs_nblocks;
+	if (scan->rs_numblocks != InvalidBlockNumber)
+		remaining = Min(remaining, scan->rs_numblocks - 1);
+
+	while (scan->rs_prefetch_ahead < scan->rs_prefetch_target &&
+		   scan->rs_prefetch_ahead < remaining)
+	{
+		BlockNumber prefetch_page;
+
+		prefetch_page = (page + scan->rs_prefetch_ahead + 1) % scan->rs_nblocks;
+		PrefetchBuffer(scan->rs_base.rs_rd, MAIN_FORKNUM, prefetch_page);
+		scan->rs_prefetch_ahead++;
+	}
+}
+#endif							/* USE_PREFETCH */
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -377,6 +479,12 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	 */
 	CHECK_FOR_INTERRUPTS();
 
+#ifdef USE_PREFETCH
+	/* get the following pages on their way in before we wait for this one */
+	if (scan->rs_prefetch_maximum > 0)
+		heap_prefetch_ahead(scan, page);
+#endif
+
 	/* read page using selected strategy */
 	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
 									   RBM_NORMAL, scan->rs_strategy);
@@ -583,7 +691,10 @@ heapgettup(HeapScanDesc scan,
 			 */
 			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
 			/* start from last page of the scan */
-			if (scan->rs_startblock > 0)
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				page = (scan->rs_startblock + scan->rs_numblocks - 1) %
+					scan->rs_nblocks;
+			else if (scan->rs_startblock > 0)
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
@@ -894,7 +1005,10 @@ heapgettup_pagemode(HeapScanDesc scan,
 			 */
 			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
 			/* start from last page of the scan */
-			if (scan->rs_startblock > 0)
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				page = (scan->rs_startblock + scan->rs_numblocks - 1) %
+					scan->rs_nblocks;
+			else if (scan->rs_startblock > 0)
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
@@ -1174,9 +1288,10 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	 * pages covering the predicate. But in that case we still have to lock
 	 * any matching heap tuples. For sample scan we could optimize the locking
 	 * to be at least page-level granularity, but we'd need to add per-tuple
-	 * locking for that.
+	 * locking for that.  The same goes for TID range scans.
 	 */
-	if (scan->rs_base.rs_flags & (SO_TYPE_SEQSCAN | SO_TYPE_SAMPLESCAN))
+	if (scan->rs_base.rs_flags &
+		(SO_TYPE_SEQSCAN | SO_TYPE_SAMPLESCAN | SO_TYPE_TIDRANGESCAN))
 	{
 		/*
 		 * Ensure a missing snapshot is noticed reliably, even if the
@@ -1379,6 +1494,151 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 	return true;
 }
 
+/*
+ *	heap_getnextslots	- retrieve up to nslots next tuples of a scan
+ *
+ * This is the batched equivalent of heap_getnextslot().  Since rs_ctup is
+ * overwritten by every step of the scan, each slot gets its own copy of the
+ * tuple header (in the slot's tupdata), while the tuple body stays in the
+ * buffer, which each slot pins separately.  The slots must therefore be
+ * BufferHeapTupleTableSlots.
+ *
+ * Returns the number of tuples stored; less than nslots means the scan is
+ * exhausted.
+ */
+int
+heap_getnextslots(TableScanDesc sscan, ScanDirection direction,
+				  TupleTableSlot **slots, int nslots)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	int			ntuples = 0;
+
+	while (ntuples < nslots)
+	{
+		TupleTableSlot *slot = slots[ntuples];
+		BufferHeapTupleTableSlot *bslot = (BufferHeapTupleTableSlot *) slot;
+
+		Assert(TTS_IS_BUFFERTUPLE(slot));
+
+		if (sscan->rs_flags & SO_ALLOW_PAGEMODE)
+			heapgettup_pagemode(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+		else
+			heapgettup(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+
+		if (scan->rs_ctup.t_data == NULL)
+			break;
+
+		pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+
+		bslot->base.tupdata = scan->rs_ctup;
+		ExecStoreBufferHeapTuple(&bslot->base.tupdata, slot, scan->rs_cbuf);
+		ntuples++;
+	}
+
+	return ntuples;
+}
+
+/*
+ *	heap_set_tidrange	- restrict a TID range scan to mintid..maxtid
+ *
+ * We limit the scan to the blocks that can hold TIDs in the range, and
+ * heap_getnextslot_tidrange filters out the tuples on the first and last
+ * block that lie outside it.
+ */
+void
+heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
+				  ItemPointer maxtid)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	ItemPointerData lowestItem;
+	ItemPointerData highestItem;
+
+	/*
+	 * With no pages, there's nothing to scan and hence nothing outside the
+	 * range either.
+	 */
+	if (scan->rs_nblocks == 0)
+		return;
+
+	/* clamp the range to the TIDs that can exist in the relation */
+	ItemPointerSet(&lowestItem, 0, FirstOffsetNumber);
+	ItemPointerSet(&highestItem, scan->rs_nblocks - 1, MaxOffsetNumber);
+
+	if (ItemPointerCompare(mintid, &lowestItem) > 0)
+		ItemPointerCopy(mintid, &lowestItem);
+	if (ItemPointerCompare(maxtid, &highestItem) < 0)
+		ItemPointerCopy(maxtid, &highestItem);
+
+	if (ItemPointerCompare(&lowestItem, &highestItem) > 0)
+	{
+		/* empty range, scan no blocks at all */
+		heap_setscanlimits(sscan, 0, 0);
+		return;
+	}
+
+	heap_setscanlimits(sscan, ItemPointerGetBlockNumberNoCheck(&lowestItem),
+					   ItemPointerGetBlockNumberNoCheck(&highestItem) -
+					   ItemPointerGetBlockNumberNoCheck(&lowestItem) + 1);
+
+	ItemPointerCopy(&lowestItem, &sscan->rs_mintid);
+	ItemPointerCopy(&highestItem, &sscan->rs_maxtid);
+}
+
+/*
+ *	heap_getnextslot_tidrange	- retrieve next tuple in a TID range scan
+ */
+bool
+heap_getnextslot_tidrange(TableScanDesc sscan, ScanDirection direction,
+						  TupleTableSlot *slot)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	ItemPointer mintid = &sscan->rs_mintid;
+	ItemPointer maxtid = &sscan->rs_maxtid;
+
+	/* Note: no locking manipulations needed */
+	for (;;)
+	{
+		if (sscan->rs_flags & SO_ALLOW_PAGEMODE)
+			heapgettup_pagemode(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+		else
+			heapgettup(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+
+		if (scan->rs_ctup.t_data == NULL)
+		{
+			ExecClearTuple(slot);
+			return false;
+		}
+
+		/*
+		 * Only the first and last block of the range can hold tuples outside
+		 * it.  TIDs come in order, so once we've passed the end of the range
+		 * in the direction of the scan, there's nothing more to return.
+		 */
+		if (ItemPointerCompare(&scan->rs_ctup.t_self, mintid) < 0)
+		{
+			ExecClearTuple(slot);
+			if (ScanDirectionIsBackward(direction))
+				return false;
+			continue;
+		}
+
+		if (ItemPointerCompare(&scan->rs_ctup.t_self, maxtid) > 0)
+		{
+			ExecClearTuple(slot);
+			if (ScanDirectionIsForward(direction))
+				return false;
+			continue;
+		}
+
+		break;
+	}
+
+	pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+
+	ExecStoreBufferHeapTuple(&scan->rs_ctup, slot, scan->rs_cbuf);
+	return true;
+}
+
 /*
  *	heap_fetch		- retrieve tuple with given tid
  *
@@ -1621,6 +1881,25 @@ heap_hot_search_buffer(ItemPointer tid, Relation relation, Buffer buffer,
 					*all_dead = false;
 				return true;
 			}
+
+			/*
+			 * A row updated in place keeps its earlier versions on an undo
+			 * chain rather than a HOT chain; look there too.
+			 */
+			if (HeapTupleHeaderHasUndo(heapTuple->t_data) &&
+				!HeapTupleIsHeapOnly(heapTuple))
+			{
+				HeapTupleData undoTuple;
+				ItemPointerData undoTid = heapTuple->t_self;
+
+				if (heap_undo_search_buffer(&undoTid, relation, buffer,
+											snapshot, &undoTuple, all_dead))
+				{
+					*heapTuple = undoTuple;
+					*tid = undoTid;
+					return true;
+				}
+			}
 		}
 		skip = false;
 
@@ -1655,6 +1934,133 @@ heap_hot_search_buffer(ItemPointer tid, Relation relation, Buffer buffer,
 	return false;
 }
 
+/*
+ *	heap_undo_next	- follow the undo link of an in-place updated tuple
+ *
+ * tuple is the version of a row at offset owner of page, or one of its
+ * saved versions.  Returns the offset of the next older saved version, or
+ * InvalidOffsetNumber if there is none.  The caller must hold at least a
+ * share lock on the buffer.
+ */
+OffsetNumber
+heap_undo_next(Page page, OffsetNumber owner, HeapTupleHeader tuple)
+{
+	OffsetNumber offnum;
+	ItemId		lp;
+	HeapTupleHeader htup;
+
+	if (!HeapTupleHeaderHasUndo(tuple))
+		return InvalidOffsetNumber;
+
+	offnum = HeapTupleHeaderGetUndo(tuple);
+	if (offnum < FirstOffsetNumber || offnum > PageGetMaxOffsetNumber(page))
+		return InvalidOffsetNumber;
+
+	lp = PageGetItemId(page, offnum);
+	if (!ItemIdIsNormal(lp))
+		return InvalidOffsetNumber;
+
+	/*
+	 * The item might have been pruned and reused since the link was made.
+	 * Saved versions are heap-only and remember which row they belong to.
+	 */
+	htup = (HeapTupleHeader) PageGetItem(page, lp);
+	if (!HeapTupleHeaderIsHeapOnly(htup) ||
+		!HeapTupleHeaderHasUndo(htup) ||
+		HeapTupleHeaderGetUndoOwner(htup) != owner)
+		return InvalidOffsetNumber;
+
+	return offnum;
+}
+
+/*
+ *	heap_undo_search_buffer	- search undo chain for tuple satisfying snapshot
+ *
+ * Like heap_hot_search_buffer, but *tid is the TID of the current version of
+ * a row updated in place, and we search the saved versions of it, newest
+ * first.  *tid itself is not considered.  If the update was rolled back, the
+ * saved version is the live one, and can have been HOT-updated since; so we
+ * follow HOT chains starting at saved versions, too.
+ *
+ * The undo chain can loop through reused items, so we give up after visiting
+ * as many items as a page can hold.  Each version found that way still
+ * belongs to the row, and MVCC snapshots can't see more than one of them.
+ */
+bool
+heap_undo_search_buffer(ItemPointer tid, Relation relation, Buffer buffer,
+						Snapshot snapshot, HeapTuple heapTuple,
+						bool *all_dead)
+{
+	Page		dp = (Page) BufferGetPage(buffer);
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber owner = ItemPointerGetOffsetNumber(tid);
+	OffsetNumber offnum;
+	ItemId		lp;
+	int			nvisited = 0;
+
+	lp = PageGetItemId(dp, owner);
+	if (!ItemIdIsNormal(lp))
+		return false;
+	offnum = heap_undo_next(dp, owner, (HeapTupleHeader) PageGetItem(dp, lp));
+
+	while (OffsetNumberIsValid(offnum) && nvisited++ < MaxHeapTuplesPerPage)
+	{
+		HeapTupleHeader saved;
+		OffsetNumber hotoffnum = offnum;
+		TransactionId prev_xmax = InvalidTransactionId;
+
+		lp = PageGetItemId(dp, offnum);
+		saved = (HeapTupleHeader) PageGetItem(dp, lp);
+
+		for (;;)
+		{
+			bool		valid;
+
+			lp = PageGetItemId(dp, hotoffnum);
+			if (!ItemIdIsNormal(lp))
+				break;
+
+			heapTuple->t_data = (HeapTupleHeader) PageGetItem(dp, lp);
+			heapTuple->t_len = ItemIdGetLength(lp);
+			heapTuple->t_tableOid = RelationGetRelid(relation);
+			ItemPointerSet(&heapTuple->t_self, blkno, hotoffnum);
+
+			if (TransactionIdIsValid(prev_xmax) &&
+				!TransactionIdEquals(prev_xmax,
+									 HeapTupleHeaderGetXmin(heapTuple->t_data)))
+				break;
+
+			valid = HeapTupleSatisfiesVisibility(heapTuple, snapshot, buffer);
+			CheckForSerializableConflictOut(valid, relation, heapTuple,
+											buffer, snapshot);
+			if (valid)
+			{
+				ItemPointerSetOffsetNumber(tid, hotoffnum);
+				PredicateLockTuple(relation, heapTuple, snapshot);
+				if (all_dead)
+					*all_dead = false;
+				return true;
+			}
+
+			if (all_dead && *all_dead &&
+				!HeapTupleIsSurelyDead(heapTuple, RecentGlobalXmin))
+				*all_dead = false;
+
+			if (!HeapTupleIsHotUpdated(heapTuple))
+				break;
+			hotoffnum = ItemPointerGetOffsetNumber(&heapTuple->t_data->t_ctid);
+			if (hotoffnum < FirstOffsetNumber ||
+				hotoffnum > PageGetMaxOffsetNumber(dp))
+				break;
+			prev_xmax = HeapTupleHeaderGetUpdateXid(heapTuple->t_data);
+		}
+
+		offnum = heap_undo_next(dp, owner, saved);
+	}
+
+	return false;
+}
+
 /*
  *	heap_get_latest_tid -  get the latest tid of a specified tuple
  *
@@ -2051,19 +2457,22 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 {
 	/*
 	 * Parallel operations are required to be strictly read-only in a parallel
-	 * worker.  Parallel inserts are not safe even in the leader in the
-	 * general case, because group locking means that heavyweight locks for
-	 * relation extension or GIN page locks will not conflict between members
-	 * of a lock group, but we don't prohibit that case here because there are
-	 * useful special cases that we can safely allow, such as CREATE TABLE AS.
-	 */
-	if (IsParallelWorker())
+	 * worker, except for workers of operations that are specifically prepared
+	 * for inserting, such as parallel COPY FROM.  Relation extension and page
+	 * locks conflict even between members of a lock group, so concurrent
+	 * inserts by the leader and its workers are safe as such; what a worker
+	 * can't do is report back things like a newly used command ID, so the
+	 * operation has to arrange for all that in advance.
+	 */
+	if (IsParallelWorker() && !ParallelWorkerMayInsert)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
 
 	tup->t_data->t_infomask &= ~(HEAP_XACT_MASK);
 	tup->t_data->t_infomask2 &= ~(HEAP2_XACT_MASK);
+	if (!(options & HEAP_INSERT_UNDO))
+		tup->t_data->t_infomask2 &= ~HEAP_HAS_UNDO;
 	tup->t_data->t_infomask |= HEAP_XMAX_INVALID;
 	HeapTupleHeaderSetXmin(tup->t_data, xid);
 	if (options & HEAP_INSERT_FROZEN)
@@ -2167,6 +2576,8 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		Buffer		buffer;
 		Buffer		vmbuffer = InvalidBuffer;
 		bool		all_visible_cleared = false;
+		bool		all_frozen_set = false;
+		bool		keep_all_frozen = false;
 		int			nthispage;
 
 		CHECK_FOR_INTERRUPTS();
@@ -2180,6 +2591,35 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 										   &vmbuffer, NULL);
 		page = BufferGetPage(buffer);
 
+		/*
+		 * COPY FREEZE only inserts into a relation created or truncated by
+		 * our own transaction, so nobody else can put tuples on its pages. If
+		 * we start from an empty page, every tuple on it will be frozen, and
+		 * we can mark it all-visible and all-frozen right away; index-only
+		 * scans then work as soon as the load commits, without waiting for
+		 * VACUUM.  Likewise, there's no need to clear those bits when adding
+		 * more frozen tuples to a page we marked earlier.  Pinning the
+		 * visibility map page while holding the buffer lock may do I/O, but
+		 * no other backend is going to wait for this buffer.
+		 *
+		 * We rely on WAL to keep the visibility map consistent with the heap,
+		 * so don't bother when the inserts themselves aren't WAL-logged.
+		 */
+		if ((options & HEAP_INSERT_FROZEN) && needwal)
+		{
+			BlockNumber blkno = BufferGetBlockNumber(buffer);
+
+			if (PageGetMaxOffsetNumber(page) == 0)
+			{
+				all_frozen_set = true;
+				visibilitymap_pin(relation, blkno, &vmbuffer);
+			}
+			else if (PageIsAllVisible(page) &&
+					 (visibilitymap_get_status(relation, blkno, &vmbuffer) &
+					  VISIBILITYMAP_ALL_FROZEN) != 0)
+				keep_all_frozen = true;
+		}
+
 		/* NO EREPORT(ERROR) from here till changes are logged */
 		START_CRIT_SECTION();
 
@@ -2205,7 +2645,9 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 				log_heap_new_cid(relation, heaptup);
 		}
 
-		if (PageIsAllVisible(page))
+		if (all_frozen_set)
+			PageSetAllVisible(page);
+		else if (PageIsAllVisible(page) && !keep_all_frozen)
 		{
 			all_visible_cleared = true;
 			PageClearAllVisible(page);
@@ -2256,6 +2698,8 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 			tupledata = scratchptr;
 
 			xlrec->flags = all_visible_cleared ? XLH_INSERT_ALL_VISIBLE_CLEARED : 0;
+			if (all_frozen_set)
+				xlrec->flags |= XLH_INSERT_ALL_FROZEN_SET;
 			xlrec->ntuples = nthispage;
 
 			/*
@@ -2329,6 +2773,18 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 
 		END_CRIT_SECTION();
 
+		/*
+		 * Now set the visibility map bits for a page we filled with frozen
+		 * tuples.  This is WAL-logged separately, after the insert record.
+		 * There's no conflict horizon, since no transaction could ever have
+		 * seen these tuples as not visible.
+		 */
+		if (all_frozen_set)
+			visibilitymap_set(relation, BufferGetBlockNumber(buffer), buffer,
+							  InvalidXLogRecPtr, vmbuffer,
+							  InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+
 		UnlockReleaseBuffer(buffer);
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
@@ -2882,7 +3338,15 @@ simple_heap_delete(Relation relation, ItemPointer tid)
  *	heap_update - replace a tuple
  *
  * See table_tuple_update() for an explanation of the parameters, except that
- * this routine directly takes a tuple rather than a slot.
+ * this routine directly takes a tuple rather than a slot, and that
+ * index_update may be NULL, if the caller can only deal with HOT and cold
+ * updates; it then has to check the new tuple's HEAP_ONLY_TUPLE flag.
+ *
+ * If some indexed columns changed, but only columns of indexes that can
+ * take it, and the new tuple fits on the same page, we do a WARM update: the
+ * new tuple is heap-only as in a HOT update, but the caller makes new
+ * entries, pointing to the root of the HOT chain, in the indexes whose
+ * columns changed.  See README.HOT.
  *
  * In the failure cases, the routine fills *tmfd with the tuple's t_ctid,
  * t_xmax (resolving a possible MultiXact, if necessary), and t_cmax (the last
@@ -2892,13 +3356,15 @@ simple_heap_delete(Relation relation, ItemPointer tid)
 TM_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
-			TM_FailureData *tmfd, LockTupleMode *lockmode)
+			TM_FailureData *tmfd, LockTupleMode *lockmode,
+			TM_IndexUpdate *index_update)
 {
 	TM_Result	result;
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
+	Bitmapset  *nowarm_attrs = NULL;
 	Bitmapset  *interesting_attrs;
 	Bitmapset  *modified_attrs;
 	ItemId		lp;
@@ -2919,6 +3385,8 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		have_tuple_lock = false;
 	bool		iscombo;
 	bool		use_hot_update = false;
+	bool		use_warm_update = false;
+	OffsetNumber warm_root = InvalidOffsetNumber;
 	bool		hot_attrs_checked = false;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
@@ -2965,6 +3433,18 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
 
+	/*
+	 * WARM updates need a caller that can make the index entries, and are
+	 * never done on catalogs, whose index scans don't recheck keys.
+	 */
+	if (index_update != NULL)
+	{
+		index_update->which = TU_None;
+		index_update->changed_attrs = NULL;
+		if (!IsCatalogRelation(relation))
+			nowarm_attrs = RelationGetIndexAttrBitmap(relation,
+													  INDEX_ATTR_BITMAP_NOWARM);
+	}
 
 	block = ItemPointerGetBlockNumber(otid);
 	buffer = ReadBuffer(relation, block);
@@ -3288,6 +3768,7 @@ l2:
 		bms_free(hot_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
+		bms_free(nowarm_attrs);
 		bms_free(modified_attrs);
 		bms_free(interesting_attrs);
 		return result;
@@ -3598,6 +4079,32 @@ l2:
 		 */
 		if (hot_attrs_checked && !bms_overlap(modified_attrs, hot_attrs))
 			use_hot_update = true;
+
+		/*
+		 * Failing that, a WARM update, if the changed columns are only used
+		 * in indexes that can take one.  Only one WARM update is allowed per
+		 * HOT chain: a second one could bring back an earlier key, and then
+		 * two entries with the same key would lead to the chain.  Tuples
+		 * carrying HEAP_WARM_TUPLE belong to such a chain.
+		 */
+		else if (hot_attrs_checked && index_update != NULL &&
+				 !IsCatalogRelation(relation) &&
+				 !HeapTupleIsWarm(&oldtup) &&
+				 !bms_overlap(modified_attrs, nowarm_attrs))
+		{
+			if (HeapTupleIsHeapOnly(&oldtup))
+			{
+				OffsetNumber root_offsets[MaxHeapTuplesPerPage];
+
+				heap_get_root_tuples(page, root_offsets);
+				warm_root = root_offsets[ItemPointerGetOffsetNumber(&oldtup.t_self) - 1];
+			}
+			else
+				warm_root = ItemPointerGetOffsetNumber(&oldtup.t_self);
+
+			if (OffsetNumberIsValid(warm_root))
+				use_hot_update = use_warm_update = true;
+		}
 	}
 	else
 	{
@@ -3640,6 +4147,23 @@ l2:
 		HeapTupleSetHeapOnly(heaptup);
 		/* Mark the caller's copy too, in case different from heaptup */
 		HeapTupleSetHeapOnly(newtup);
+		/* only versions saved by in-place updates may be both, though */
+		heaptup->t_data->t_infomask2 &= ~HEAP_HAS_UNDO;
+		newtup->t_data->t_infomask2 &= ~HEAP_HAS_UNDO;
+
+		/*
+		 * If index keys changed, here or earlier in the chain, mark both
+		 * versions as members of a WARM chain, and the page as holding one.
+		 * The old version needs the mark as well, in case the new one is
+		 * removed after an abort: the index entries made for it stay.
+		 */
+		if (use_warm_update || HeapTupleIsWarm(&oldtup))
+		{
+			HeapTupleSetWarm(&oldtup);
+			HeapTupleSetWarm(heaptup);
+			HeapTupleSetWarm(newtup);
+			PageSetHasWarm(page);
+		}
 	}
 	else
 	{
@@ -3745,6 +4269,26 @@ l2:
 
 	pgstat_count_heap_update(relation, use_hot_update);
 
+	/* Tell the caller which index entries to make */
+	if (index_update != NULL)
+	{
+		if (use_warm_update)
+		{
+			index_update->which = TU_Changed;
+			ItemPointerSet(&index_update->tid,
+						   BufferGetBlockNumber(buffer), warm_root);
+			index_update->changed_attrs = bms_intersect(modified_attrs,
+														hot_attrs);
+		}
+		else if (use_hot_update)
+			index_update->which = TU_None;
+		else
+		{
+			index_update->which = TU_All;
+			index_update->tid = heaptup->t_self;
+		}
+	}
+
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
 	 * back to the caller's image, too.
@@ -3761,6 +4305,7 @@ l2:
 	bms_free(hot_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
+	bms_free(nowarm_attrs);
 	bms_free(modified_attrs);
 	bms_free(interesting_attrs);
 
@@ -3850,10 +4395,10 @@ heap_tuple_attr_equals(TupleDesc tupdesc, int attrnum,
  * Given an updated tuple, determine (and return into the output bitmapset),
  * from those listed as interesting, the set of columns that changed.
  *
- * The input bitmapset is destructively modified; that is OK since this is
- * invoked at most once in heap_update.
+ * The input bitmapset is destructively modified; that is OK since callers
+ * (heap_update and the inplace table AM) use it only once.
  */
-static Bitmapset *
+Bitmapset *
 HeapDetermineModifiedColumns(Relation relation, Bitmapset *interesting_cols,
 							 HeapTuple oldtup, HeapTuple newtup)
 {
@@ -3891,7 +4436,7 @@ simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &tmfd, &lockmode);
+						 &tmfd, &lockmode, NULL);
 	switch (result)
 	{
 		case TM_SelfModified:
@@ -8342,6 +8887,10 @@ heap_xlog_multi_insert(XLogReaderState *record)
 		if (xlrec->flags & XLH_INSERT_ALL_VISIBLE_CLEARED)
 			PageClearAllVisible(page);
 
+		/* the visibility map bits are set by the XLOG_HEAP2_VISIBLE record */
+		if (xlrec->flags & XLH_INSERT_ALL_FROZEN_SET)
+			PageSetAllVisible(page);
+
 		MarkBufferDirty(buffer);
 	}
 	if (BufferIsValid(buffer))
@@ -8602,6 +9151,14 @@ heap_xlog_update(XLogReaderState *record, bool hot_update)
 		if (offnum == InvalidOffsetNumber)
 			elog(PANIC, "failed to add tuple");
 
+		/* A WARM chain member; mark its predecessor and the page too */
+		if (xlhdr.t_infomask2 & HEAP_WARM_TUPLE)
+		{
+			Assert(hot_update && oldtup.t_data != NULL);
+			HeapTupleHeaderSetWarm(oldtup.t_data);
+			PageSetHasWarm(page);
+		}
+
 		if (xlrec->flags & XLH_UPDATE_NEW_ALL_VISIBLE_CLEARED)
 			PageClearAllVisible(page);
 
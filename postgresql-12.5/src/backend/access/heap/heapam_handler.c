@@ -87,6 +87,7 @@ heapam_index_fetch_begin(Relation rel)
 
 	hscan->xs_base.rel = rel;
 	hscan->xs_cbuf = InvalidBuffer;
+	hscan->xs_prune_requested = InvalidBlockNumber;
 
 	return &hscan->xs_base;
 }
@@ -123,6 +124,7 @@ heapam_index_fetch_tuple(struct IndexFetchTableData *scan,
 	IndexFetchHeapData *hscan = (IndexFetchHeapData *) scan;
 	BufferHeapTupleTableSlot *bslot = (BufferHeapTupleTableSlot *) slot;
 	bool		got_heap_tuple;
+	bool		want_prune = false;
 
 	Assert(TTS_IS_BUFFERTUPLE(slot));
 
@@ -153,8 +155,28 @@ heapam_index_fetch_tuple(struct IndexFetchTableData *scan,
 											all_dead,
 											!*call_again);
 	bslot->base.tupdata.t_self = *tid;
+
+	/* On a page with WARM chains, the index keys may not match the tuple */
+	scan->recheck_keys = PageHasWarm(BufferGetPage(hscan->xs_cbuf)) != 0;
+
+	/*
+	 * If the whole chain is dead and the page is still waiting to be pruned,
+	 * heap_page_prune_opt() found it had too much free space to bother.  Have
+	 * autovacuum prune it, so the dead tuples don't linger until VACUUM.
+	 */
+	if (!got_heap_tuple && all_dead && *all_dead &&
+		PageIsPrunable(BufferGetPage(hscan->xs_cbuf), RecentGlobalXmin) &&
+		hscan->xs_prune_requested != ItemPointerGetBlockNumber(tid))
+		want_prune = true;
 	LockBuffer(hscan->xs_cbuf, BUFFER_LOCK_UNLOCK);
 
+	if (want_prune)
+	{
+		hscan->xs_prune_requested = ItemPointerGetBlockNumber(tid);
+		heap_page_prune_request(hscan->xs_base.rel,
+								hscan->xs_prune_requested);
+	}
+
 	if (got_heap_tuple)
 	{
 		/*
@@ -319,7 +341,7 @@ static TM_Result
 heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 					CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 					bool wait, TM_FailureData *tmfd,
-					LockTupleMode *lockmode, bool *update_indexes)
+					LockTupleMode *lockmode, TM_IndexUpdate *index_update)
 {
 	bool		shouldFree = true;
 	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
@@ -329,20 +351,14 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	slot->tts_tableOid = RelationGetRelid(relation);
 	tuple->t_tableOid = slot->tts_tableOid;
 
+	/* the tuple might come from a table of the inplace access method */
+	tuple->t_data->t_infomask2 &= ~HEAP_HAS_UNDO;
+
+	/* heap_update also decides which index entries the tuple needs */
 	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
-						 tmfd, lockmode);
+						 tmfd, lockmode, index_update);
 	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
 
-	/*
-	 * Decide whether new index entries are needed for the tuple
-	 *
-	 * Note: heap_update returns the tid (location) of the new tuple in the
-	 * t_self field.
-	 *
-	 * If it's a HOT update, we mustn't insert new index entries.
-	 */
-	*update_indexes = result == TM_Ok && !HeapTupleIsHeapOnly(tuple);
-
 	if (shouldFree)
 		pfree(tuple);
 
@@ -1416,12 +1432,14 @@ heapam_index_build_range_scan(Relation heapRelation,
 					 * However, if it was HOT-updated then we must only index
 					 * the live tuple at the end of the HOT-chain.  Since this
 					 * breaks semantics for pre-existing snapshots, mark the
-					 * index as unusable for them.
+					 * index as unusable for them.  The same goes for the
+					 * versions saved by in-place updates.
 					 *
 					 * We don't count recently-dead tuples in reltuples, even
 					 * if we index them; see heapam_scan_analyze_next_tuple().
 					 */
-					if (HeapTupleIsHotUpdated(heapTuple))
+					if (HeapTupleIsHotUpdated(heapTuple) ||
+						HeapTupleHeaderIsSavedVersion(heapTuple->t_data))
 					{
 						indexIt = false;
 						/* mark the index as unsafe for old snapshots */
@@ -1535,7 +1553,8 @@ heapam_index_build_range_scan(Relation heapRelation,
 						 * deleting transaction to finish and check again.
 						 */
 						if (checking_uniqueness ||
-							HeapTupleIsHotUpdated(heapTuple))
+							HeapTupleIsHotUpdated(heapTuple) ||
+							HeapTupleHeaderIsSavedVersion(heapTuple->t_data))
 						{
 							/*
 							 * Must drop the lock on the buffer before we wait
@@ -1563,7 +1582,8 @@ heapam_index_build_range_scan(Relation heapRelation,
 						 */
 						reltuples += 1;
 					}
-					else if (HeapTupleIsHotUpdated(heapTuple))
+					else if (HeapTupleIsHotUpdated(heapTuple) ||
+							 HeapTupleHeaderIsSavedVersion(heapTuple->t_data))
 					{
 						/*
 						 * It's a HOT-updated tuple deleted by our own xact.
@@ -2242,6 +2262,13 @@ heapam_scan_bitmap_next_block(TableScanDesc scan,
 	 */
 	LockBuffer(buffer, BUFFER_LOCK_SHARE);
 
+	/*
+	 * HOT chains with changed index keys can be reached through entries for
+	 * either key, so the tuples must be checked against the quals.
+	 */
+	if (PageHasWarm(BufferGetPage(buffer)))
+		tbmres->recheck = true;
+
 	/*
 	 * We need two separate strategies for lossy and non-lossy cases.
 	 */
@@ -2561,6 +2588,18 @@ reform_and_rewrite_tuple(HeapTuple tuple,
 
 	copiedTuple = heap_form_tuple(newTupDesc, values, isnull);
 
+	/* keep the layout of tables of the inplace access method */
+	if (HeapTupleHeaderHasUndo(tuple->t_data))
+	{
+		HeapTuple	formatted = heap_inplace_format_tuple(copiedTuple);
+
+		if (formatted != copiedTuple)
+		{
+			heap_freetuple(copiedTuple);
+			copiedTuple = formatted;
+		}
+	}
+
 	/* The heap rewrite module does the rest */
 	rewrite_heap_tuple(rwstate, tuple, copiedTuple);
 
@@ -2629,6 +2668,9 @@ static const TableAmRoutine heapam_methods = {
 	.scan_end = heap_endscan,
 	.scan_rescan = heap_rescan,
 	.scan_getnextslot = heap_getnextslot,
+	.scan_getnextslots = heap_getnextslots,
+	.scan_set_tidrange = heap_set_tidrange,
+	.scan_getnextslot_tidrange = heap_getnextslot_tidrange,
 
 	.parallelscan_estimate = table_block_parallelscan_estimate,
 	.parallelscan_initialize = table_block_parallelscan_initialize,
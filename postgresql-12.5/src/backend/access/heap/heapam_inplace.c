@@ -0,0 +1,804 @@
+/*-------------------------------------------------------------------------
+ *
+ * heapam_inplace.c
+ *	  heap table access method variant that updates rows in place
+ *
+ * Tables of the "inplace" access method use the heap's storage format and
+ * almost all of its code.  The difference is in UPDATE: where possible, the
+ * new version of a row takes over the row's line pointer, and the old
+ * version moves to a new line pointer on the same page, from where it is
+ * reachable through the new version's undo link.  The row's TID thus stays
+ * the same, so no index entries are made, and the current version is found
+ * first, without walking a HOT chain.  The old version keeps its storage;
+ * only its header changes, as it would in a regular update, so readers that
+ * hold a pointer to it keep seeing the same data.
+ *
+ * Saved versions are heap-only tuples, and are removed by pruning once no
+ * snapshot can see them, just like the members of a HOT chain.  No separate
+ * undo log is kept: the page's free space is the undo space.  If the
+ * updating transaction aborts, readers step over the new version to the
+ * saved one, and pruning eventually redirects the line pointer to it.
+ *
+ * To carry the undo links, all tuples are stored with two extra offset
+ * numbers in the header (see HeapTupleHeaderGetUndo).  Rows whose tuples
+ * need toasting are stored like heap rows, and are updated like them.  An
+ * update falls back to a regular heap update when
+ *
+ * - a column used by an index changes, or an index is not valid yet,
+ * - the table has AFTER UPDATE row triggers, or is logically logged,
+ * - the page hasn't room for the new version, or
+ * - the row is not the root of its chain, e.g. after a HOT update.
+ *
+ * Because the version at a TID can now change, a TID that a caller got from
+ * a scan may point to a newer version than the one the caller's snapshot
+ * saw.  Updates, deletes and locks first look for the version the snapshot
+ * sees, so that they report a concurrent update as the heap would; and scans
+ * that remember visible line pointers check them again before returning a
+ * tuple.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/heap/heapam_inplace.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/tableam.h"
+#include "access/tuptoaster.h"
+#include "access/visibilitymap.h"
+#include "access/xact.h"
+#include "access/xloginsert.h"
+#include "catalog/catalog.h"
+#include "catalog/pg_index.h"
+#include "executor/tuptable.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/predicate.h"
+#include "utils/builtins.h"
+#include "utils/combocid.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+
+
+static TableAmRoutine inplaceam_methods;
+static const TableAmRoutine *heapam_methods;
+
+
+/* ------------------------------------------------------------------------
+ * Tuple layout
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Return a copy of tuple laid out with room for undo links, or the tuple
+ * itself, with HEAP_HAS_UNDO cleared, if it's to be toasted and so can't be
+ * updated in place anyway.
+ */
+HeapTuple
+heap_inplace_format_tuple(HeapTuple tuple)
+{
+	HeapTupleHeader td = tuple->t_data;
+	HeapTuple	result;
+	Size		hdrlen;
+	Size		hoff;
+	Size		len;
+
+	hdrlen = offsetof(HeapTupleHeaderData, t_bits);
+	if (HeapTupleHasNulls(tuple))
+		hdrlen += BITMAPLEN(HeapTupleHeaderGetNatts(td));
+	hoff = MAXALIGN(hdrlen + 2 * sizeof(OffsetNumber));
+	len = hoff + tuple->t_len - td->t_hoff;
+
+	if (HeapTupleHasExternal(tuple) || len > TOAST_TUPLE_THRESHOLD)
+	{
+		td->t_infomask2 &= ~HEAP_HAS_UNDO;
+		return tuple;
+	}
+
+	result = (HeapTuple) palloc0(HEAPTUPLESIZE + len);
+	result->t_len = len;
+	result->t_self = tuple->t_self;
+	result->t_tableOid = tuple->t_tableOid;
+	result->t_data = (HeapTupleHeader) ((char *) result + HEAPTUPLESIZE);
+
+	memcpy(result->t_data, td, hdrlen);
+	result->t_data->t_hoff = hoff;
+	result->t_data->t_infomask2 |= HEAP_HAS_UNDO;
+	HeapTupleHeaderSetUndo(result->t_data, InvalidOffsetNumber,
+						   InvalidOffsetNumber);
+	memcpy((char *) result->t_data + hoff, (char *) td + td->t_hoff,
+		   tuple->t_len - td->t_hoff);
+
+	return result;
+}
+
+/*
+ * Copy the visibility information heap_insert or an in-place update set in
+ * the stored tuple back to the caller's tuple, whose layout may differ.
+ */
+static void
+inplace_copy_header(HeapTuple dst, HeapTuple src)
+{
+	if (dst == src)
+		return;
+
+	memcpy(&dst->t_data->t_choice, &src->t_data->t_choice,
+		   sizeof(dst->t_data->t_choice));
+	dst->t_data->t_ctid = src->t_data->t_ctid;
+	dst->t_data->t_infomask = src->t_data->t_infomask;
+	dst->t_self = src->t_self;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Finding the version a snapshot sees
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Is the tuple locked by the current transaction?
+ */
+static bool
+inplace_locked_by_me(HeapTupleHeader tuple)
+{
+	TransactionId xmax = HeapTupleHeaderGetRawXmax(tuple);
+
+	if ((tuple->t_infomask & HEAP_XMAX_INVALID) ||
+		!HEAP_XMAX_IS_LOCKED_ONLY(tuple->t_infomask))
+		return false;
+
+	if (tuple->t_infomask & HEAP_XMAX_IS_MULTI)
+	{
+		MultiXactMember *members;
+		int			nmembers;
+		int			i;
+		bool		result = false;
+
+		nmembers = GetMultiXactIdMembers(xmax, &members, false, true);
+		for (i = 0; i < nmembers; i++)
+		{
+			if (TransactionIdIsCurrentTransactionId(members[i].xid))
+				result = true;
+		}
+		if (nmembers > 0)
+			pfree(members);
+		return result;
+	}
+
+	return TransactionIdIsCurrentTransactionId(xmax);
+}
+
+/*
+ * If the row at *tid has been updated in place since snapshot was taken,
+ * point *tid at the saved version the snapshot sees and return true.
+ *
+ * A version the current transaction has locked is taken to be the one the
+ * caller means: that's how EvalPlanQual goes on to update the latest version
+ * of a row.
+ */
+static bool
+inplace_find_seen_version(Relation relation, ItemPointer tid,
+						  Snapshot snapshot)
+{
+	Buffer		buffer;
+	Page		page;
+	ItemId		lp;
+	HeapTupleData tuple;
+	bool		found = false;
+
+	if (snapshot == InvalidSnapshot || !IsMVCCSnapshot(snapshot))
+		return false;
+
+	buffer = ReadBuffer(relation, ItemPointerGetBlockNumber(tid));
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+
+	if (ItemPointerGetOffsetNumber(tid) <= PageGetMaxOffsetNumber(page))
+	{
+		lp = PageGetItemId(page, ItemPointerGetOffsetNumber(tid));
+		if (ItemIdIsNormal(lp))
+		{
+			tuple.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+			tuple.t_len = ItemIdGetLength(lp);
+			tuple.t_tableOid = RelationGetRelid(relation);
+			tuple.t_self = *tid;
+
+			if (HeapTupleHeaderHasUndo(tuple.t_data) &&
+				!HeapTupleHeaderIsHeapOnly(tuple.t_data) &&
+				!HeapTupleSatisfiesVisibility(&tuple, snapshot, buffer) &&
+				!inplace_locked_by_me(tuple.t_data))
+			{
+				HeapTupleData undoTuple;
+				ItemPointerData undoTid = *tid;
+
+				if (heap_undo_search_buffer(&undoTid, relation, buffer,
+											snapshot, &undoTuple, NULL))
+				{
+					*tid = undoTid;
+					found = true;
+				}
+			}
+		}
+	}
+
+	UnlockReleaseBuffer(buffer);
+
+	return found;
+}
+
+/*
+ * Check again that the tuple a scan stored in slot is visible.  The scan
+ * looked at visibility before, but read the line pointer later, without a
+ * lock; an in-place update in between gives it the new version.
+ */
+static void
+inplace_recheck_slot(Relation relation, TupleTableSlot *slot,
+					 Snapshot snapshot)
+{
+	BufferHeapTupleTableSlot *bslot = (BufferHeapTupleTableSlot *) slot;
+	HeapTuple	tuple = bslot->base.tuple;
+	Buffer		buffer = bslot->buffer;
+	HeapTupleData undoTuple;
+	ItemPointerData tid;
+
+	Assert(TTS_IS_BUFFERTUPLE(slot));
+
+	if (!BufferIsValid(buffer) ||
+		!HeapTupleHeaderHasUndo(tuple->t_data) ||
+		HeapTupleHeaderIsHeapOnly(tuple->t_data) ||
+		!IsMVCCSnapshot(snapshot))
+		return;
+
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	if (!HeapTupleSatisfiesVisibility(tuple, snapshot, buffer))
+	{
+		tid = tuple->t_self;
+		if (heap_undo_search_buffer(&tid, relation, buffer, snapshot,
+									&undoTuple, NULL))
+		{
+			bslot->base.tupdata = undoTuple;
+			bslot->base.tuple = &bslot->base.tupdata;
+			bslot->base.off = 0;
+			slot->tts_nvalid = 0;
+			slot->tts_tid = tid;
+		}
+	}
+	LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Scan callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+inplace_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					TupleTableSlot *slot)
+{
+	if (!heapam_methods->scan_getnextslot(sscan, direction, slot))
+		return false;
+
+	inplace_recheck_slot(sscan->rs_rd, slot, sscan->rs_snapshot);
+	return true;
+}
+
+static int
+inplace_getnextslots(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot **slots, int nslots)
+{
+	int			n;
+	int			i;
+
+	n = heapam_methods->scan_getnextslots(sscan, direction, slots, nslots);
+	for (i = 0; i < n; i++)
+		inplace_recheck_slot(sscan->rs_rd, slots[i], sscan->rs_snapshot);
+
+	return n;
+}
+
+static bool
+inplace_getnextslot_tidrange(TableScanDesc sscan, ScanDirection direction,
+							 TupleTableSlot *slot)
+{
+	if (!heapam_methods->scan_getnextslot_tidrange(sscan, direction, slot))
+		return false;
+
+	inplace_recheck_slot(sscan->rs_rd, slot, sscan->rs_snapshot);
+	return true;
+}
+
+static bool
+inplace_scan_bitmap_next_tuple(TableScanDesc scan,
+							   struct TBMIterateResult *tbmres,
+							   TupleTableSlot *slot)
+{
+	if (!heapam_methods->scan_bitmap_next_tuple(scan, tbmres, slot))
+		return false;
+
+	inplace_recheck_slot(scan->rs_rd, slot, scan->rs_snapshot);
+	return true;
+}
+
+static bool
+inplace_scan_sample_next_tuple(TableScanDesc scan,
+							   struct SampleScanState *scanstate,
+							   TupleTableSlot *slot)
+{
+	if (!heapam_methods->scan_sample_next_tuple(scan, scanstate, slot))
+		return false;
+
+	inplace_recheck_slot(scan->rs_rd, slot, scan->rs_snapshot);
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Inserting rows
+ * ------------------------------------------------------------------------
+ */
+
+static void
+inplace_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					 int options, BulkInsertState bistate)
+{
+	bool		shouldFree = true;
+	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
+	HeapTuple	stored;
+
+	/* Update the tuple with table oid */
+	slot->tts_tableOid = RelationGetRelid(relation);
+	tuple->t_tableOid = slot->tts_tableOid;
+
+	stored = heap_inplace_format_tuple(tuple);
+
+	/* Perform the insertion, and copy the resulting ItemPointer */
+	heap_insert(relation, stored, cid, options | HEAP_INSERT_UNDO, bistate);
+	inplace_copy_header(tuple, stored);
+	ItemPointerCopy(&stored->t_self, &slot->tts_tid);
+
+	if (stored != tuple)
+		heap_freetuple(stored);
+	if (shouldFree)
+		pfree(tuple);
+}
+
+static void
+inplace_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								 CommandId cid, int options,
+								 BulkInsertState bistate, uint32 specToken)
+{
+	bool		shouldFree = true;
+	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
+	HeapTuple	stored;
+
+	/* Update the tuple with table oid */
+	slot->tts_tableOid = RelationGetRelid(relation);
+	tuple->t_tableOid = slot->tts_tableOid;
+
+	stored = heap_inplace_format_tuple(tuple);
+	HeapTupleHeaderSetSpeculativeToken(stored->t_data, specToken);
+	options |= HEAP_INSERT_SPECULATIVE | HEAP_INSERT_UNDO;
+
+	/* Perform the insertion, and copy the resulting ItemPointer */
+	heap_insert(relation, stored, cid, options, bistate);
+	inplace_copy_header(tuple, stored);
+	ItemPointerCopy(&stored->t_self, &slot->tts_tid);
+
+	if (stored != tuple)
+		heap_freetuple(stored);
+	if (shouldFree)
+		pfree(tuple);
+}
+
+static void
+inplace_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					 CommandId cid, int options, BulkInsertState bistate)
+{
+	int			i;
+
+	/*
+	 * heap_multi_insert takes the tuples from the slots, so put the
+	 * reformatted ones there.  Slots of other kinds would just form the
+	 * tuples afresh; such rows are stored like heap rows.
+	 */
+	for (i = 0; i < ntuples; i++)
+	{
+		TupleTableSlot *slot = slots[i];
+		HeapTuple	tuple;
+		HeapTuple	stored;
+
+		if (!TTS_IS_HEAPTUPLE(slot) && !TTS_IS_BUFFERTUPLE(slot))
+			continue;
+
+		tuple = ExecFetchSlotHeapTuple(slot, true, NULL);
+		stored = heap_inplace_format_tuple(tuple);
+		if (stored != tuple)
+			ExecForceStoreHeapTuple(stored, slot, true);
+	}
+
+	heap_multi_insert(relation, slots, ntuples, cid,
+					  options | HEAP_INSERT_UNDO, bistate);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Modifying rows
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Are all indexes of the relation valid?  Index builds that run alongside
+ * updates read tuples without holding a buffer lock, and so does their
+ * validation; those only cope with the heap's HOT chains.
+ */
+static bool
+inplace_indexes_valid(Relation relation)
+{
+	List	   *indexoidlist = RelationGetIndexList(relation);
+	ListCell   *l;
+	bool		result = true;
+
+	foreach(l, indexoidlist)
+	{
+		Oid			indexoid = lfirst_oid(l);
+		HeapTuple	indexTuple;
+		Form_pg_index indexForm;
+
+		indexTuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexoid));
+		if (!HeapTupleIsValid(indexTuple))
+			elog(ERROR, "cache lookup failed for index %u", indexoid);
+		indexForm = (Form_pg_index) GETSTRUCT(indexTuple);
+		result = indexForm->indisvalid && indexForm->indisready;
+		ReleaseSysCache(indexTuple);
+
+		if (!result)
+			break;
+	}
+
+	list_free(indexoidlist);
+
+	return result;
+}
+
+/*
+ * Try to update the row at otid in place.  Returns false, without having
+ * changed anything, if that's not possible; the caller then does a regular
+ * heap update.
+ */
+static bool
+inplace_update(Relation relation, ItemPointer otid, HeapTuple newtup,
+			   CommandId cid, Snapshot crosscheck)
+{
+	BlockNumber block = ItemPointerGetBlockNumber(otid);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(otid);
+	TransactionId xid;
+	Bitmapset  *indexattrs;
+	HeapTuple	heaptup;
+	Buffer		buffer;
+	Buffer		vmbuffer = InvalidBuffer;
+	Page		page;
+	ItemId		lp;
+	HeapTupleData oldtup;
+	TM_Result	result;
+	OffsetNumber prevundo;
+	OffsetNumber undooffnum;
+	CommandId	cmax;
+	bool		iscombo;
+	GenericXLogState *state;
+	ItemIdData	itemid;
+	HeapTupleHeader htup;
+	bool		done = false;
+
+	if (crosscheck != InvalidSnapshot ||
+		IsInParallelMode() ||
+		IsCatalogRelation(relation) ||
+		RelationIsLogicallyLogged(relation) ||
+		(relation->trigdesc && relation->trigdesc->trig_update_after_row) ||
+		!inplace_indexes_valid(relation))
+		return false;
+
+	heaptup = heap_inplace_format_tuple(newtup);
+	if (heaptup == newtup)
+		return false;
+
+	/* like heap_update, fetch what we need before locking the buffer */
+	indexattrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_ALL);
+	xid = GetCurrentTransactionId();
+
+	buffer = ReadBuffer(relation, block);
+	page = BufferGetPage(buffer);
+	if (PageIsAllVisible(page))
+		visibilitymap_pin(relation, block, &vmbuffer);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	/* the page may have become all-visible while we weren't looking */
+	if (PageIsAllVisible(page) && !BufferIsValid(vmbuffer))
+		goto out;
+
+	if (offnum > PageGetMaxOffsetNumber(page))
+		goto out;
+	lp = PageGetItemId(page, offnum);
+	if (!ItemIdIsNormal(lp))
+		goto out;
+
+	oldtup.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+	oldtup.t_len = ItemIdGetLength(lp);
+	oldtup.t_tableOid = RelationGetRelid(relation);
+	oldtup.t_self = *otid;
+
+	if (!HeapTupleHeaderHasUndo(oldtup.t_data) ||
+		HeapTupleHeaderIsHeapOnly(oldtup.t_data) ||
+		HeapTupleHeaderIsHotUpdated(oldtup.t_data) ||
+		HeapTupleHeaderIsWarm(oldtup.t_data) ||
+		HeapTupleHeaderIsSpeculative(oldtup.t_data))
+		goto out;
+
+	/* leave waiting, and reporting concurrent updates, to heap_update */
+	result = HeapTupleSatisfiesUpdate(&oldtup, cid, buffer);
+	if (result == TM_BeingModified)
+	{
+		if (!inplace_locked_by_me(oldtup.t_data) ||
+			(oldtup.t_data->t_infomask & HEAP_XMAX_IS_MULTI))
+			goto out;
+	}
+	else if (result != TM_Ok)
+		goto out;
+
+	if (!bms_is_empty(HeapDetermineModifiedColumns(relation, indexattrs,
+												   &oldtup, heaptup)))
+		goto out;
+
+	if (PageGetHeapFreeSpace(page) < MAXALIGN(heaptup->t_len))
+		goto out;
+
+	/* We're about to do the actual update -- check for conflict first */
+	CheckForSerializableConflictIn(relation, &oldtup, buffer);
+
+	prevundo = heap_undo_next(page, offnum, oldtup.t_data);
+	cmax = cid;
+	HeapTupleHeaderAdjustCmax(oldtup.t_data, &cmax, &iscombo);
+
+	/* set up the new version; it takes over the row's line pointer */
+	htup = heaptup->t_data;
+	htup->t_infomask &= ~(HEAP_XACT_MASK);
+	htup->t_infomask2 &= ~(HEAP2_XACT_MASK);
+	htup->t_infomask |= HEAP_UPDATED | HEAP_XMAX_INVALID;
+	HeapTupleHeaderSetXmin(htup, xid);
+	HeapTupleHeaderSetCmin(htup, cid);
+	HeapTupleHeaderSetXmax(htup, 0);	/* for cleanliness */
+	htup->t_ctid = *otid;
+	heaptup->t_tableOid = RelationGetRelid(relation);
+	heaptup->t_self = *otid;
+
+	/*
+	 * Clear the visibility map bit first, and log the map page as it is now,
+	 * as the generic WAL record below can't clear it at replay.  Crashing in
+	 * between leaves the bit clear and the page flag set, which is fine.
+	 */
+	if (PageIsAllVisible(page) &&
+		visibilitymap_clear(relation, block, vmbuffer,
+							VISIBILITYMAP_VALID_BITS) &&
+		RelationNeedsWAL(relation))
+	{
+		LockBuffer(vmbuffer, BUFFER_LOCK_EXCLUSIVE);
+		START_CRIT_SECTION();
+		log_newpage_buffer(vmbuffer, false);
+		END_CRIT_SECTION();
+		LockBuffer(vmbuffer, BUFFER_LOCK_UNLOCK);
+	}
+
+	state = GenericXLogStart(relation);
+	page = GenericXLogRegisterBuffer(state, buffer, 0);
+
+	undooffnum = PageAddItem(page, (Item) htup, heaptup->t_len,
+							 InvalidOffsetNumber, false, true);
+	if (undooffnum == InvalidOffsetNumber)
+	{
+		GenericXLogAbort(state);
+		elog(ERROR, "failed to add tuple to page");
+	}
+
+	/* swap line pointers: the old version moves to the new one */
+	itemid = *PageGetItemId(page, offnum);
+	*PageGetItemId(page, offnum) = *PageGetItemId(page, undooffnum);
+	*PageGetItemId(page, undooffnum) = itemid;
+
+	htup = (HeapTupleHeader) PageGetItem(page, PageGetItemId(page, offnum));
+	HeapTupleHeaderSetUndo(htup, InvalidOffsetNumber, undooffnum);
+
+	/* turn the old version into a saved one, updated by us */
+	htup = (HeapTupleHeader) PageGetItem(page, PageGetItemId(page, undooffnum));
+	htup->t_infomask &= ~(HEAP_XMAX_BITS | HEAP_MOVED);
+	htup->t_infomask2 &= ~(HEAP_HOT_UPDATED | HEAP_KEYS_UPDATED);
+	HeapTupleHeaderSetHeapOnly(htup);
+	HeapTupleHeaderSetXmax(htup, xid);
+	HeapTupleHeaderSetCmax(htup, cmax, iscombo);
+	htup->t_ctid = *otid;
+	HeapTupleHeaderSetUndo(htup, offnum, prevundo);
+
+	/* the previous saved version now leads to this one */
+	if (OffsetNumberIsValid(prevundo))
+	{
+		htup = (HeapTupleHeader) PageGetItem(page,
+											 PageGetItemId(page, prevundo));
+		if (ItemPointerEquals(&htup->t_ctid, otid))
+			ItemPointerSet(&htup->t_ctid, block, undooffnum);
+	}
+
+	PageSetPrunable(page, xid);
+	PageClearAllVisible(page);
+
+	GenericXLogFinish(state);
+	done = true;
+
+	/* copy the stored header back to the caller */
+	inplace_copy_header(newtup, heaptup);
+	pgstat_count_heap_update(relation, true);
+
+out:
+	UnlockReleaseBuffer(buffer);
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+	heap_freetuple(heaptup);
+	bms_free(indexattrs);
+
+	return done;
+}
+
+static TM_Result
+inplace_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					 Snapshot snapshot, Snapshot crosscheck, bool wait,
+					 TM_FailureData *tmfd, bool changingPart)
+{
+	ItemPointerData seentid = *tid;
+
+	inplace_find_seen_version(relation, &seentid, snapshot);
+
+	return heapam_methods->tuple_delete(relation, &seentid, cid, snapshot,
+										crosscheck, wait, tmfd, changingPart);
+}
+
+static TM_Result
+inplace_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
+					 CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+					 bool wait, TM_FailureData *tmfd,
+					 LockTupleMode *lockmode, TM_IndexUpdate *index_update)
+{
+	ItemPointerData seentid = *otid;
+	bool		shouldFree = true;
+	HeapTuple	tuple;
+
+	/* an update of a saved version fails like that of an old heap tuple */
+	if (inplace_find_seen_version(relation, &seentid, snapshot))
+		return heapam_methods->tuple_update(relation, &seentid, slot, cid,
+											snapshot, crosscheck, wait, tmfd,
+											lockmode, index_update);
+
+	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
+	slot->tts_tableOid = RelationGetRelid(relation);
+	tuple->t_tableOid = slot->tts_tableOid;
+
+	if (inplace_update(relation, otid, tuple, cid, crosscheck))
+	{
+		ItemPointerCopy(otid, &slot->tts_tid);
+		if (shouldFree)
+			pfree(tuple);
+
+		*lockmode = LockTupleNoKeyExclusive;
+		index_update->which = TU_None;
+		index_update->tid = *otid;
+		index_update->changed_attrs = NULL;
+		return TM_Ok;
+	}
+
+	if (shouldFree)
+		pfree(tuple);
+
+	/* a regular update; keep the layout if the row doesn't need toasting */
+	if (TTS_IS_HEAPTUPLE(slot) || TTS_IS_BUFFERTUPLE(slot))
+	{
+		HeapTuple	stored;
+
+		tuple = ExecFetchSlotHeapTuple(slot, true, NULL);
+		stored = heap_inplace_format_tuple(tuple);
+		if (stored != tuple)
+			ExecForceStoreHeapTuple(stored, slot, true);
+	}
+
+	return heapam_methods->tuple_update(relation, otid, slot, cid, snapshot,
+										crosscheck, wait, tmfd, lockmode,
+										index_update);
+}
+
+static TM_Result
+inplace_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+				   TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+				   LockWaitPolicy wait_policy, uint8 flags,
+				   TM_FailureData *tmfd)
+{
+	/*
+	 * Lock the version the snapshot saw, so that heap_lock_tuple reports
+	 * that it has been updated, when the caller cares.  INSERT ... ON
+	 * CONFLICT in READ COMMITTED mode locks the latest version regardless.
+	 */
+	if ((flags & TUPLE_LOCK_FLAG_FIND_LAST_VERSION) ||
+		IsolationUsesXactSnapshot())
+		inplace_find_seen_version(relation, tid, snapshot);
+
+	return heapam_methods->tuple_lock(relation, tid, snapshot, slot, cid,
+									  mode, wait_policy, flags, tmfd);
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static void
+inplace_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
+								  Relation OldIndex, bool use_sort,
+								  TransactionId OldestXmin,
+								  TransactionId *xid_cutoff,
+								  MultiXactId *multi_cutoff,
+								  double *num_tuples,
+								  double *tups_vacuumed,
+								  double *tups_recently_dead)
+{
+	/*
+	 * An index scan with SnapshotAny walks HOT chains only, and would miss
+	 * saved versions; scan and sort instead.
+	 */
+	heapam_methods->relation_copy_for_cluster(OldHeap, NewHeap, OldIndex,
+											  OldIndex != NULL,
+											  OldestXmin, xid_cutoff,
+											  multi_cutoff, num_tuples,
+											  tups_vacuumed,
+											  tups_recently_dead);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the inplace table access method.
+ * ------------------------------------------------------------------------
+ */
+
+Datum
+inplace_tableam_handler(PG_FUNCTION_ARGS)
+{
+	if (heapam_methods == NULL)
+	{
+		heapam_methods = GetHeapamTableAmRoutine();
+
+		inplaceam_methods = *heapam_methods;
+		inplaceam_methods.scan_getnextslot = inplace_getnextslot;
+		inplaceam_methods.scan_getnextslots = inplace_getnextslots;
+		inplaceam_methods.scan_getnextslot_tidrange =
+			inplace_getnextslot_tidrange;
+		inplaceam_methods.tuple_insert = inplace_tuple_insert;
+		inplaceam_methods.tuple_insert_speculative =
+			inplace_tuple_insert_speculative;
+		inplaceam_methods.multi_insert = inplace_multi_insert;
+		inplaceam_methods.tuple_delete = inplace_tuple_delete;
+		inplaceam_methods.tuple_update = inplace_tuple_update;
+		inplaceam_methods.tuple_lock = inplace_tuple_lock;
+		inplaceam_methods.relation_copy_for_cluster =
+			inplace_relation_copy_for_cluster;
+		inplaceam_methods.scan_bitmap_next_tuple =
+			inplace_scan_bitmap_next_tuple;
+		inplaceam_methods.scan_sample_next_tuple =
+			inplace_scan_sample_next_tuple;
+	}
+
+	PG_RETURN_POINTER(&inplaceam_methods);
+}
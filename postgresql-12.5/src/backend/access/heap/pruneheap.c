@@ -20,9 +20,13 @@
 #include "access/htup_details.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/pg_am.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "storage/procarray.h"
 #include "utils/snapmgr.h"
 #include "utils/rel.h"
 
@@ -52,6 +56,13 @@ static void heap_prune_record_redirect(PruneState *prstate,
 									   OffsetNumber offnum, OffsetNumber rdoffnum);
 static void heap_prune_record_dead(PruneState *prstate, OffsetNumber offnum);
 static void heap_prune_record_unused(PruneState *prstate, OffsetNumber offnum);
+static OffsetNumber heap_prune_undo_target(Relation relation, Buffer buffer,
+										   OffsetNumber rootoffnum,
+										   TransactionId OldestXmin,
+										   PruneState *prstate);
+static void heap_get_undo_roots(Page page, OffsetNumber root,
+								HeapTupleHeader htup,
+								OffsetNumber *root_offsets);
 
 
 /*
@@ -159,6 +170,84 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 	}
 }
 
+/*
+ * Ask autovacuum to prune a page on which an index scan found dead tuples.
+ *
+ * heap_page_prune_opt() only prunes pages that are nearly full, so a page
+ * that is reached only through index scans can keep its dead tuples, and
+ * grow long HOT chains, until the next VACUUM.  Index scans call this when
+ * a whole HOT chain turned out to be dead on a page that still carries a
+ * prune hint; the request is queued as an autovacuum work item, which
+ * heap_page_prune_block() carries out.  Requests are lossy: if the work
+ * item queue is full, the page is simply left for VACUUM.
+ */
+void
+heap_page_prune_request(Relation relation, BlockNumber blkno)
+{
+	if (RecoveryInProgress() || !AutoVacuumingActive())
+		return;
+
+	(void) AutoVacuumRequestWork(AVW_HeapPrunePage,
+								 RelationGetRelid(relation), blkno);
+}
+
+/*
+ * Prune one page of a relation, on behalf of heap_page_prune_request().
+ *
+ * Unlike heap_page_prune_opt(), this prunes regardless of the page's free
+ * space, and records the space it frees in the FSM.  We still don't wait for
+ * the cleanup lock; if the page is busy, the next scan will ask again.
+ */
+void
+heap_page_prune_block(Oid relid, BlockNumber blkno)
+{
+	Relation	relation;
+	Buffer		buffer;
+	Page		page;
+	TransactionId OldestXmin;
+
+	/* The relation may have been dropped, or truncated, since the request */
+	relation = try_relation_open(relid, AccessShareLock);
+	if (relation == NULL)
+		return;
+
+	if ((relation->rd_rel->relam != HEAP_TABLE_AM_OID &&
+		 relation->rd_rel->relam != INPLACE_TABLE_AM_OID) ||
+		blkno >= RelationGetNumberOfBlocks(relation))
+	{
+		relation_close(relation, AccessShareLock);
+		return;
+	}
+
+	OldestXmin =
+		TransactionIdLimitedForOldSnapshots(GetOldestXmin(relation,
+														  PROCARRAY_FLAGS_VACUUM),
+											relation);
+
+	buffer = ReadBufferExtended(relation, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								NULL);
+	page = BufferGetPage(buffer);
+
+	if (PageIsPrunable(page, OldestXmin) &&
+		ConditionalLockBufferForCleanup(buffer))
+	{
+		TransactionId ignore = InvalidTransactionId;
+
+		if (heap_page_prune(relation, buffer, OldestXmin, true, &ignore) > 0)
+		{
+			Size		freespace = PageGetHeapFreeSpace(page);
+
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+			RecordPageWithFreeSpace(relation, blkno, freespace);
+		}
+		else
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+	}
+
+	ReleaseBuffer(buffer);
+	relation_close(relation, AccessShareLock);
+}
+
 
 /*
  * Prune and repair fragmentation in the specified page.
@@ -595,9 +684,23 @@ heap_prune_chain(Relation relation, Buffer buffer, OffsetNumber rootoffnum,
 		 * If the DEAD tuple is at the end of the chain, the entire chain is
 		 * dead and the root line pointer can be marked dead.  Otherwise just
 		 * redirect the root to the correct chain member.
+		 *
+		 * A row whose in-place update was rolled back lives on in the saved
+		 * version on its undo chain, so redirect the root there instead.
 		 */
 		if (i >= nchain)
-			heap_prune_record_dead(prstate, rootoffnum);
+		{
+			OffsetNumber undooffnum = InvalidOffsetNumber;
+
+			if (ItemIdIsNormal(rootlp))
+				undooffnum = heap_prune_undo_target(relation, buffer,
+													rootoffnum, OldestXmin,
+													prstate);
+			if (OffsetNumberIsValid(undooffnum))
+				heap_prune_record_redirect(prstate, rootoffnum, undooffnum);
+			else
+				heap_prune_record_dead(prstate, rootoffnum);
+		}
 		else
 			heap_prune_record_redirect(prstate, rootoffnum, chainitems[i]);
 	}
@@ -616,6 +719,55 @@ heap_prune_chain(Relation relation, Buffer buffer, OffsetNumber rootoffnum,
 	return ndeleted;
 }
 
+/*
+ * Find the newest version on the undo chain of the DEAD tuple at rootoffnum
+ * that is not DEAD itself, or return InvalidOffsetNumber.
+ */
+static OffsetNumber
+heap_prune_undo_target(Relation relation, Buffer buffer,
+					   OffsetNumber rootoffnum, TransactionId OldestXmin,
+					   PruneState *prstate)
+{
+	Page		dp = (Page) BufferGetPage(buffer);
+	HeapTupleHeader htup;
+	OffsetNumber offnum;
+	int			nvisited = 0;
+
+	htup = (HeapTupleHeader) PageGetItem(dp, PageGetItemId(dp, rootoffnum));
+	offnum = heap_undo_next(dp, rootoffnum, htup);
+
+	while (OffsetNumberIsValid(offnum) && nvisited++ < MaxHeapTuplesPerPage)
+	{
+		ItemId		lp = PageGetItemId(dp, offnum);
+		HeapTupleData tup;
+
+		htup = (HeapTupleHeader) PageGetItem(dp, lp);
+
+		/* already pruned in this pass; its link is still good, though */
+		if (!prstate->marked[offnum])
+		{
+			tup.t_data = htup;
+			tup.t_len = ItemIdGetLength(lp);
+			tup.t_tableOid = RelationGetRelid(relation);
+			ItemPointerSet(&(tup.t_self), BufferGetBlockNumber(buffer), offnum);
+
+			/*
+			 * A DEAD version that was HOT-updated after the rollback still
+			 * leads to the live one; the next pruning pass will shorten
+			 * the chain.
+			 */
+			if (HeapTupleHeaderIsHotUpdated(htup) ||
+				HeapTupleSatisfiesVacuum(&tup, OldestXmin, buffer) !=
+				HEAPTUPLE_DEAD)
+				return offnum;
+		}
+
+		offnum = heap_undo_next(dp, rootoffnum, htup);
+	}
+
+	return InvalidOffsetNumber;
+}
+
 /* Record lowest soon-prunable XID */
 static void
 heap_prune_record_prunable(PruneState *prstate, TransactionId xid)
@@ -723,6 +875,29 @@ heap_page_prune_execute(Buffer buffer,
 	 * whether it has free pointers.
 	 */
 	PageRepairFragmentation(page);
+
+	/*
+	 * If we removed the last members of WARM chains, the index entries that
+	 * led to them can no longer reach any tuple, so the page need not be
+	 * treated specially anymore.  This is deterministic, so redo does the
+	 * same.
+	 */
+	if (PageHasWarm(page))
+	{
+		OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+		OffsetNumber off;
+
+		for (off = FirstOffsetNumber; off <= maxoff; off = OffsetNumberNext(off))
+		{
+			ItemId		lp = PageGetItemId(page, off);
+
+			if (ItemIdIsNormal(lp) &&
+				HeapTupleHeaderIsWarm((HeapTupleHeader) PageGetItem(page, lp)))
+				break;
+		}
+		if (off > maxoff)
+			PageClearHasWarm(page);
+	}
 }
 
 
@@ -779,6 +954,7 @@ heap_get_root_tuples(Page page, OffsetNumber *root_offsets)
 			 * Remember it in the mapping.
 			 */
 			root_offsets[offnum - 1] = offnum;
+			heap_get_undo_roots(page, offnum, htup, root_offsets);
 
 			/* If it's not the start of a HOT-chain, we're done with it */
 			if (!HeapTupleHeaderIsHotUpdated(htup))
@@ -821,6 +997,7 @@ heap_get_root_tuples(Page page, OffsetNumber *root_offsets)
 
 			/* Remember the root line pointer for this item */
 			root_offsets[nextoffnum - 1] = offnum;
+			heap_get_undo_roots(page, offnum, htup, root_offsets);
 
 			/* Advance to next chain member, if any */
 			if (!HeapTupleHeaderIsHotUpdated(htup))
@@ -834,3 +1011,48 @@ heap_get_root_tuples(Page page, OffsetNumber *root_offsets)
 		}
 	}
 }
+
+/*
+ * Map the saved versions on the undo chain of htup, a member of the chain
+ * rooted at root, to that root, along with the HOT chains that continue from
+ * them (see heap_undo_search_buffer).
+ */
+static void
+heap_get_undo_roots(Page page, OffsetNumber root, HeapTupleHeader htup,
+					OffsetNumber *root_offsets)
+{
+	OffsetNumber offnum = heap_undo_next(page, root, htup);
+	int			nvisited = 0;
+
+	while (OffsetNumberIsValid(offnum) && nvisited++ < MaxHeapTuplesPerPage)
+	{
+		HeapTupleHeader saved;
+		HeapTupleHeader member;
+		OffsetNumber nextoffnum;
+
+		saved = (HeapTupleHeader) PageGetItem(page,
+											  PageGetItemId(page, offnum));
+		root_offsets[offnum - 1] = root;
+
+		member = saved;
+		while (HeapTupleHeaderIsHotUpdated(member))
+		{
+			TransactionId priorXmax = HeapTupleHeaderGetUpdateXid(member);
+			ItemId		lp;
+
+			nextoffnum = ItemPointerGetOffsetNumber(&member->t_ctid);
+			if (nextoffnum < FirstOffsetNumber ||
+				nextoffnum > PageGetMaxOffsetNumber(page))
+				break;
+			lp = PageGetItemId(page, nextoffnum);
+			if (!ItemIdIsNormal(lp))
+				break;
+			member = (HeapTupleHeader) PageGetItem(page, lp);
+			if (!TransactionIdEquals(priorXmax, HeapTupleHeaderGetXmin(member)))
+				break;
+			root_offsets[nextoffnum - 1] = root;
+		}
+
+		offnum = heap_undo_next(page, root, saved);
+	}
+}
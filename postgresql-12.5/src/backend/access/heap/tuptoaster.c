@@ -29,6 +29,9 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
 
 #include "access/genam.h"
 #include "access/heapam.h"
@@ -37,6 +40,8 @@
 #include "catalog/catalog.h"
 #include "common/pg_lzcompress.h"
 #include "miscadmin.h"
+#include "storage/proc.h"
+#include "utils/attoptcache.h"
 #include "utils/expandeddatum.h"
 #include "utils/fmgroids.h"
 #include "utils/rel.h"
@@ -52,7 +57,7 @@
 typedef struct toast_compress_header
 {
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
-	int32		rawsize;
+	uint32		tcinfo;			/* raw size and compression method */
 } toast_compress_header;
 
 /*
@@ -60,11 +65,66 @@ typedef struct toast_compress_header
  * toast entries.
  */
 #define TOAST_COMPRESS_HDRSZ		((int32) sizeof(toast_compress_header))
-#define TOAST_COMPRESS_RAWSIZE(ptr) (((toast_compress_header *) (ptr))->rawsize)
+#define TOAST_COMPRESS_RAWSIZE(ptr) \
+	((int32) (((toast_compress_header *) (ptr))->tcinfo & VARLENA_RAWSIZE_MASK))
+#define TOAST_COMPRESS_METHOD(ptr) \
+	(((toast_compress_header *) (ptr))->tcinfo >> VARLENA_RAWSIZE_BITS)
 #define TOAST_COMPRESS_RAWDATA(ptr) \
 	(((char *) (ptr)) + TOAST_COMPRESS_HDRSZ)
-#define TOAST_COMPRESS_SET_RAWSIZE(ptr, len) \
-	(((toast_compress_header *) (ptr))->rawsize = (len))
+#define TOAST_COMPRESS_SET_SIZE_AND_METHOD(ptr, len, cmethod) \
+	(((toast_compress_header *) (ptr))->tcinfo = \
+	 (len) | ((uint32) (cmethod) << VARLENA_RAWSIZE_BITS))
+
+/* GUC variable */
+int			default_toast_compression = TOAST_PGLZ_COMPRESSION_ID;
+
+/*
+ * A value stored out of line is often detoasted several times for the same
+ * row: when a column appears both in the WHERE clause and in the target
+ * list, or is passed to several functions, each reference fetches the toast
+ * chunks and decompresses them again.  To avoid that, heap_tuple_untoast_attr
+ * keeps the last few values it expanded, keyed by toast pointer, and hands
+ * out copies of them.  Callers own what they get and may pfree it as usual;
+ * a memcpy is much cheaper than a toast fetch and decompression.
+ *
+ * Most values are only expanded once, so a value is not copied into the
+ * cache until its toast pointer comes around a second time; the first
+ * expansion only remembers the pointer.  That keeps the cost for the
+ * single-reference case to a few comparisons.
+ *
+ * The cache is allocated in the memory context that is current when a value
+ * is added, which during query execution is normally the per-tuple context,
+ * and is forgotten when that context is reset or deleted.  It is also only
+ * used within one transaction, so that a toast OID that gets reused cannot
+ * produce a stale hit.  Values larger than work_mem are not kept.
+ */
+#define DETOAST_CACHE_SIZE	4
+
+typedef struct DetoastCacheKey
+{
+	Oid			toastrelid;
+	Oid			valueid;
+} DetoastCacheKey;
+
+typedef struct DetoastCacheEntry
+{
+	Oid			toastrelid;
+	Oid			valueid;
+	struct varlena *value;		/* NULL if entry is unused */
+} DetoastCacheEntry;
+
+typedef struct DetoastCache
+{
+	MemoryContext cxt;			/* context holding the cache and its values */
+	LocalTransactionId lxid;	/* transaction the cache is valid in */
+	MemoryContextCallback cb;	/* forgets the cache when cxt is reset */
+	int			next;			/* entry to replace next */
+	int			nextseen;		/* seen[] slot to replace next */
+	DetoastCacheEntry entries[DETOAST_CACHE_SIZE];
+	DetoastCacheKey seen[DETOAST_CACHE_SIZE];	/* recently expanded values */
+} DetoastCache;
+
+static DetoastCache *detoast_cache = NULL;
 
 static void toast_delete_datum(Relation rel, Datum value, bool is_speculative);
 static Datum toast_save_datum(Relation rel, Datum value,
@@ -76,6 +136,10 @@ static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 											   int32 sliceoffset, int32 length);
 static struct varlena *toast_decompress_datum(struct varlena *attr);
 static struct varlena *toast_decompress_datum_slice(struct varlena *attr, int32 slicelength);
+static int	toast_column_compression(Relation rel, int attnum);
+static struct varlena *detoast_cache_lookup(struct varlena *attr);
+static void detoast_cache_insert(struct varlena *attr, struct varlena *value);
+static void detoast_cache_free(DetoastCache *cache);
 static int	toast_open_indexes(Relation toastrel,
 							   LOCKMODE lock,
 							   Relation **toastidxs,
@@ -173,10 +237,17 @@ heap_tuple_untoast_attr(struct varlena *attr)
 {
 	if (VARATT_IS_EXTERNAL_ONDISK(attr))
 	{
+		struct varlena *toast_ptr = attr;
+
+		/* maybe we expanded the same value a moment ago */
+		attr = detoast_cache_lookup(toast_ptr);
+		if (attr != NULL)
+			return attr;
+
 		/*
 		 * This is an externally stored datum --- fetch it back from there
 		 */
-		attr = toast_fetch_datum(attr);
+		attr = toast_fetch_datum(toast_ptr);
 		/* If it's compressed, decompress it */
 		if (VARATT_IS_COMPRESSED(attr))
 		{
@@ -185,6 +256,8 @@ heap_tuple_untoast_attr(struct varlena *attr)
 			attr = toast_decompress_datum(tmp);
 			pfree(tmp);
 		}
+
+		detoast_cache_insert(toast_ptr, attr);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -457,6 +530,48 @@ toast_datum_size(Datum value)
 	return result;
 }
 
+/* ----------
+ * toast_datum_compression
+ *
+ *	Return the ToastCompressionId a varlena datum was compressed with, or
+ *	-1 if it isn't compressed
+ * ----------
+ */
+int
+toast_datum_compression(Datum value)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(value);
+	int			result = -1;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+		/* the method is only recorded in the compressed data itself */
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+		{
+			struct varlena *tmp = toast_fetch_datum(attr);
+
+			result = TOAST_COMPRESS_METHOD(tmp);
+			pfree(tmp);
+		}
+	}
+	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
+	{
+		struct varatt_indirect toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+		return toast_datum_compression(PointerGetDatum(toast_pointer.pointer));
+	}
+	else if (VARATT_IS_COMPRESSED(attr))
+		result = TOAST_COMPRESS_METHOD(attr);
+
+	return result;
+}
+
 
 /* ----------
  * toast_delete -
@@ -775,7 +890,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		if (TupleDescAttr(tupleDesc, i)->attstorage == 'x')
 		{
 			old_value = toast_values[i];
-			new_value = toast_compress_datum(old_value);
+			new_value = toast_compress_datum(old_value,
+							 toast_column_compression(rel, i + 1));
 
 			if (DatumGetPointer(new_value) != NULL)
 			{
@@ -916,7 +1032,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		 */
 		i = biggest_attno;
 		old_value = toast_values[i];
-		new_value = toast_compress_datum(old_value);
+		new_value = toast_compress_datum(old_value,
+						 toast_column_compression(rel, i + 1));
 
 		if (DatumGetPointer(new_value) != NULL)
 		{
@@ -1348,7 +1465,8 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
 /* ----------
  * toast_compress_datum -
  *
- *	Create a compressed version of a varlena datum
+ *	Create a compressed version of a varlena datum, using the given
+ *	compression method
  *
  *	If we fail (ie, compressed result is actually bigger than original)
  *	then return NULL.  We must not use compressed data if it'd expand
@@ -1359,7 +1477,7 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
  * ----------
  */
 Datum
-toast_compress_datum(Datum value)
+toast_compress_datum(Datum value, int cmethod)
 {
 	struct varlena *tmp;
 	int32		valsize = VARSIZE_ANY_EXHDR(DatumGetPointer(value));
@@ -1370,12 +1488,36 @@ toast_compress_datum(Datum value)
 
 	/*
 	 * No point in wasting a palloc cycle if value size is out of the allowed
-	 * range for compression
+	 * range for compression.  We use pglz's limits for every method, so that
+	 * the choice of method doesn't change which values get compressed.
 	 */
 	if (valsize < PGLZ_strategy_default->min_input_size ||
 		valsize > PGLZ_strategy_default->max_input_size)
 		return PointerGetDatum(NULL);
 
+#ifdef USE_LZ4
+	if (cmethod == TOAST_LZ4_COMPRESSION_ID)
+	{
+		int			maxlen = LZ4_compressBound(valsize);
+
+		tmp = (struct varlena *) palloc(maxlen + TOAST_COMPRESS_HDRSZ);
+		len = LZ4_compress_default(VARDATA_ANY(DatumGetPointer(value)),
+								   TOAST_COMPRESS_RAWDATA(tmp),
+								   valsize, maxlen);
+		/* LZ4 returns 0 on failure; see below about the size check */
+		if (len > 0 &&
+			len + TOAST_COMPRESS_HDRSZ < valsize - 2)
+		{
+			TOAST_COMPRESS_SET_SIZE_AND_METHOD(tmp, valsize, cmethod);
+			SET_VARSIZE_COMPRESSED(tmp, len + TOAST_COMPRESS_HDRSZ);
+			return PointerGetDatum(tmp);
+		}
+		pfree(tmp);
+		return PointerGetDatum(NULL);
+	}
+#endif
+
+	/* anything else, including lz4 in a build without it, uses pglz */
 	tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
 									TOAST_COMPRESS_HDRSZ);
 
@@ -1396,7 +1538,8 @@ toast_compress_datum(Datum value)
 	if (len >= 0 &&
 		len + TOAST_COMPRESS_HDRSZ < valsize - 2)
 	{
-		TOAST_COMPRESS_SET_RAWSIZE(tmp, valsize);
+		TOAST_COMPRESS_SET_SIZE_AND_METHOD(tmp, valsize,
+										   TOAST_PGLZ_COMPRESSION_ID);
 		SET_VARSIZE_COMPRESSED(tmp, len + TOAST_COMPRESS_HDRSZ);
 		/* successful compression */
 		return PointerGetDatum(tmp);
@@ -1409,6 +1552,218 @@ toast_compress_datum(Datum value)
 	}
 }
 
+/* ----------
+ * detoast_cache_reset -
+ * detoast_cache_lookup -
+ * detoast_cache_insert -
+ * detoast_cache_free -
+ *
+ *	Maintain the cache of recently detoasted values described at the top
+ *	of this file
+ * ----------
+ */
+static void
+detoast_cache_reset(void *arg)
+{
+	if (detoast_cache == (DetoastCache *) arg)
+		detoast_cache = NULL;
+}
+
+static struct varlena *
+detoast_cache_lookup(struct varlena *attr)
+{
+	struct varatt_external toast_pointer;
+	int			i;
+
+	if (detoast_cache == NULL || MyProc == NULL ||
+		detoast_cache->lxid != MyProc->lxid)
+		return NULL;
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	for (i = 0; i < DETOAST_CACHE_SIZE; i++)
+	{
+		DetoastCacheEntry *entry = &detoast_cache->entries[i];
+
+		if (entry->value != NULL &&
+			entry->valueid == toast_pointer.va_valueid &&
+			entry->toastrelid == toast_pointer.va_toastrelid)
+		{
+			struct varlena *result;
+
+			result = (struct varlena *) palloc(VARSIZE(entry->value));
+			memcpy(result, entry->value, VARSIZE(entry->value));
+			return result;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+detoast_cache_insert(struct varlena *attr, struct varlena *value)
+{
+	struct varatt_external toast_pointer;
+	DetoastCacheEntry *entry;
+	DetoastCacheKey *key;
+	int			i;
+
+	if (MyProc == NULL || VARSIZE(value) > (Size) work_mem * 1024L)
+		return;
+
+	/* start a new cache if the old one belongs elsewhere */
+	if (detoast_cache == NULL ||
+		detoast_cache->cxt != CurrentMemoryContext ||
+		detoast_cache->lxid != MyProc->lxid)
+	{
+		DetoastCache *cache;
+
+		/*
+		 * The old cache's context can't have been reset, since its callback
+		 * would have forgotten the cache, so release the old values now
+		 * rather than leaving them until then.  The cache struct itself has
+		 * to stay, because its callback is still registered.
+		 */
+		if (detoast_cache != NULL)
+			detoast_cache_free(detoast_cache);
+
+		cache = (DetoastCache *) palloc0(sizeof(DetoastCache));
+		cache->cxt = CurrentMemoryContext;
+		cache->lxid = MyProc->lxid;
+		cache->cb.func = detoast_cache_reset;
+		cache->cb.arg = cache;
+		MemoryContextRegisterResetCallback(CurrentMemoryContext, &cache->cb);
+		detoast_cache = cache;
+	}
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	/* only keep the value if it has been expanded before */
+	for (i = 0; i < DETOAST_CACHE_SIZE; i++)
+	{
+		key = &detoast_cache->seen[i];
+		if (key->valueid == toast_pointer.va_valueid &&
+			key->toastrelid == toast_pointer.va_toastrelid)
+			break;
+	}
+	if (i >= DETOAST_CACHE_SIZE)
+	{
+		key = &detoast_cache->seen[detoast_cache->nextseen++];
+		detoast_cache->nextseen %= DETOAST_CACHE_SIZE;
+		key->toastrelid = toast_pointer.va_toastrelid;
+		key->valueid = toast_pointer.va_valueid;
+		return;
+	}
+
+	entry = &detoast_cache->entries[detoast_cache->next];
+	detoast_cache->next = (detoast_cache->next + 1) % DETOAST_CACHE_SIZE;
+	if (entry->value != NULL)
+		pfree(entry->value);
+
+	entry->toastrelid = toast_pointer.va_toastrelid;
+	entry->valueid = toast_pointer.va_valueid;
+	entry->value = (struct varlena *) palloc(VARSIZE(value));
+	memcpy(entry->value, value, VARSIZE(value));
+}
+
+static void
+detoast_cache_free(DetoastCache *cache)
+{
+	int			i;
+
+	for (i = 0; i < DETOAST_CACHE_SIZE; i++)
+	{
+		if (cache->entries[i].value != NULL)
+			pfree(cache->entries[i].value);
+		cache->entries[i].value = NULL;
+	}
+}
+
+/* ----------
+ * toast_column_compression -
+ *
+ *	Get the compression method for an attribute of a table: its
+ *	"compression" attribute option if set, else default_toast_compression
+ * ----------
+ */
+static int
+toast_column_compression(Relation rel, int attnum)
+{
+	AttributeOpts *aopt;
+	int			cmethod = default_toast_compression;
+
+	/* the attribute option cache isn't usable while bootstrapping */
+	if (IsBootstrapProcessingMode())
+		return cmethod;
+
+	aopt = get_attribute_options(RelationGetRelid(rel), attnum);
+	if (aopt != NULL)
+	{
+		if (aopt->compression_offset != 0)
+			cmethod = toast_compression_method_from_name((char *) aopt +
+														 aopt->compression_offset);
+		pfree(aopt);
+	}
+
+	return cmethod;
+}
+
+/* ----------
+ * toast_compression_method_name -
+ * toast_compression_method_from_name -
+ *
+ *	Map between compression method IDs and their names
+ * ----------
+ */
+const char *
+toast_compression_method_name(int cmethod)
+{
+	switch (cmethod)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return "pglz";
+		case TOAST_LZ4_COMPRESSION_ID:
+			return "lz4";
+	}
+	return NULL;
+}
+
+int
+toast_compression_method_from_name(const char *name)
+{
+	if (pg_strcasecmp(name, "pglz") == 0)
+		return TOAST_PGLZ_COMPRESSION_ID;
+	if (pg_strcasecmp(name, "lz4") == 0)
+		return TOAST_LZ4_COMPRESSION_ID;
+	return -1;
+}
+
+/*
+ * Validator for the "compression" attribute option.  Allows "pglz", and
+ * "lz4" if the server was built with it.
+ */
+void
+toast_validate_compression_option(const char *value)
+{
+	int			cmethod = -1;
+
+	if (value != NULL)
+		cmethod = toast_compression_method_from_name(value);
+
+	if (cmethod < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for \"compression\" option"),
+				 errdetail("Valid values are \"pglz\" and \"lz4\".")));
+#ifndef USE_LZ4
+	if (cmethod == TOAST_LZ4_COMPRESSION_ID)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression method lz4 not supported"),
+				 errdetail("This functionality requires the server to be built with lz4 support.")));
+#endif
+}
+
 
 /* ----------
  * toast_get_valid_index
@@ -2267,6 +2622,7 @@ static struct varlena *
 toast_decompress_datum(struct varlena *attr)
 {
 	struct varlena *result;
+	int32		rawsize;
 
 	Assert(VARATT_IS_COMPRESSED(attr));
 
@@ -2274,10 +2630,37 @@ toast_decompress_datum(struct varlena *attr)
 		palloc(TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
 	SET_VARSIZE(result, TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
 
-	if (pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-						VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
-						VARDATA(result),
-						TOAST_COMPRESS_RAWSIZE(attr), true) < 0)
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
+									  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+									  VARDATA(result),
+									  TOAST_COMPRESS_RAWSIZE(attr), true);
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			rawsize = LZ4_decompress_safe(TOAST_COMPRESS_RAWDATA(attr),
+										  VARDATA(result),
+										  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+										  TOAST_COMPRESS_RAWSIZE(attr));
+			/* an intact value decompresses to exactly its raw size */
+			if (rawsize != TOAST_COMPRESS_RAWSIZE(attr))
+				rawsize = -1;
+			break;
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method lz4 not supported"),
+					 errdetail("This functionality requires the server to be built with lz4 support.")));
+#endif
+		default:
+			elog(ERROR, "invalid compression method id %u",
+				 TOAST_COMPRESS_METHOD(attr));
+			rawsize = -1;		/* keep compiler quiet */
+	}
+
+	if (rawsize < 0)
 		elog(ERROR, "compressed data is corrupted");
 
 	return result;
@@ -2301,10 +2684,34 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 
 	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
 
-	rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-							  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
-							  VARDATA(result),
-							  slicelength, false);
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
+									  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+									  VARDATA(result),
+									  slicelength, false);
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			rawsize = LZ4_decompress_safe_partial(TOAST_COMPRESS_RAWDATA(attr),
+												  VARDATA(result),
+												  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+												  slicelength,
+												  slicelength);
+			break;
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method lz4 not supported"),
+					 errdetail("This functionality requires the server to be built with lz4 support.")));
+#endif
+		default:
+			elog(ERROR, "invalid compression method id %u",
+				 TOAST_COMPRESS_METHOD(attr));
+			rawsize = -1;		/* keep compiler quiet */
+	}
+
 	if (rawsize < 0)
 		elog(ERROR, "compressed data is corrupted");
 
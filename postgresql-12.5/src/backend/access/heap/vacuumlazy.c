@@ -4,23 +4,41 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
- * TIDs.  We want to ensure we can vacuum even the very largest relations with
- * finite memory space usage.  To do that, we set upper bounds on the number of
- * tuples we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs.
+ * We want to ensure we can vacuum even the very largest relations with
+ * finite memory space usage.  To do that, we set upper bounds on the amount
+ * of TIDs we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a dead tuple store of that size, with an upper limit
+ * that depends on table size (this limit ensures we don't allocate a huge
+ * area uselessly for vacuuming small tables).  If the store threatens to
+ * overflow, we suspend the heap scan phase and perform a pass of index
+ * cleanup and page compaction, then resume the heap scan with an empty store.
+ * The store keeps the dead offsets of each heap page as a bitmap, or as a
+ * short array when only a few tuples on the page are dead, so it typically
+ * needs a small fraction of the 6 bytes per TID a plain array would; see
+ * LVDeadTuples.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the TID store, just enough to hold the dead tuples of one page.
+ *
+ * Lazy vacuum supports parallel processing of indexes with parallel worker
+ * processes.  For each index vacuum or cleanup pass, we enter parallel mode,
+ * copy the dead tuple TIDs into a dynamic shared memory segment, and launch
+ * workers that pick indexes one at a time and process them with the same
+ * code as the serial case.  The leader handles the indexes whose AM doesn't
+ * support running that phase in a worker, then helps with the rest.  Index
+ * statistics are carried across passes through the DSM segment, and are used
+ * to update pg_class once all passes are done and we've left parallel mode.
+ *
+ * The heap scan can also be done in parallel, in rounds: the processes take
+ * chunks of blocks and collect dead tuple TIDs in stores of their own, which
+ * the leader merges after each round.  Pages that can't be processed in
+ * parallel mode are left to the leader; see lazy_parallel_scan_heap().
  *
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
@@ -36,25 +54,33 @@
 
 #include <math.h>
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
 #include "commands/progress.h"
 #include "commands/vacuum.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -92,11 +118,71 @@
 	((BlockNumber) (((uint64) 8 * 1024 * 1024 * 1024) / BLCKSZ))
 
 /*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
+ * Dead tuple storage.
+ *
+ * Dead tuple TIDs are stored per heap block.  Each block with dead tuples
+ * has an LVDeadBlock entry, and its offset numbers are kept in the data area
+ * either as a sorted array of OffsetNumbers or as a bitmap indexed by offset
+ * number, whichever is smaller; the array is only used while few of the line
+ * pointers on the page are dead.  Since lazy_scan_heap() visits blocks in
+ * order, entries are appended in block number order.
+ *
+ * To find the entry for a block quickly, a directory maps each range of
+ * (1 << dir_shift) blocks to its first entry, so that a lookup only needs to
+ * binary search the entries within one range.  dir_shift is chosen so that
+ * the directory takes a small part of the memory budget.
+ *
+ * Everything lives in one chunk of memory without internal pointers, so that
+ * it can be copied into a DSM segment for parallel index vacuuming.  The
+ * directory comes first in area[], then the data area growing upward, and
+ * the entries growing downward from the end of area[].
+ */
+typedef struct LVDeadBlock
+{
+	BlockNumber blkno;
+	uint32		start;			/* position in data area, plus the flag
+								 * below */
+} LVDeadBlock;
+
+#define DEADBLOCK_BITMAP		0x80000000	/* offsets are stored as bitmap */
+
+typedef struct LVDeadTuples
+{
+	int64		num_tuples;		/* # of TIDs stored */
+	int			nblocks;		/* # of LVDeadBlock entries */
+	int			dir_shift;		/* log2 of # of heap blocks per directory
+								 * slot */
+	uint32		ndir;			/* # of directory slots */
+	uint32		ndir_used;		/* # of directory slots filled in */
+	uint32		data_size;		/* # of bytes used in the data area */
+	uint32		area_size;		/* total size of area[] */
+	char		area[FLEXIBLE_ARRAY_MEMBER];
+} LVDeadTuples;
+
+#define DeadTuplesDir(dt)	((uint32 *) (dt)->area)
+#define DeadTuplesData(dt)	((dt)->area + (dt)->ndir * sizeof(uint32))
+#define DeadTuplesBlock(dt, i) \
+	(((LVDeadBlock *) ((dt)->area + (dt)->area_size)) - ((i) + 1))
+#define DeadTuplesFreeSpace(dt) \
+	((dt)->area_size - (dt)->ndir * sizeof(uint32) - (dt)->data_size - \
+	 (dt)->nblocks * sizeof(LVDeadBlock))
+#define DeadTuplesUsedSpace(dt) \
+	((dt)->data_size + (dt)->nblocks * sizeof(LVDeadBlock))
+
+/*
+ * Most space one heap page's dead tuples can take: an entry, an alignment
+ * byte, and a bitmap covering all possible offsets (an offset array is never
+ * allowed to grow larger than the bitmap would be).
+ */
+#define DEADBLOCK_MAX_SIZE \
+	(sizeof(LVDeadBlock) + 1 + MaxHeapTuplesPerPage / BITS_PER_BYTE + 1)
+
+/*
+ * Minimum number of heap blocks per directory slot, and the share of the
+ * memory budget the directory may take otherwise.
  */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
+#define DEADTUPLES_MIN_DIR_SHIFT	8
+#define DEADTUPLES_DIR_FRACTION		32
 
 /*
  * Before we consider skipping a page that's marked as clean in
@@ -110,6 +196,141 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * DSM keys for parallel vacuum.  Unlike other parallel execution code, since
+ * we don't need to worry about DSM keys conflicting with plan_node_id we can
+ * use small integers.  The query text, buffer usage and WAL usage keys are
+ * used by both the parallel index vacuum and the parallel heap scan.
+ */
+#define PARALLEL_VACUUM_KEY_SHARED			1
+#define PARALLEL_VACUUM_KEY_DEAD_TUPLES		2
+#define PARALLEL_VACUUM_KEY_QUERY_TEXT		3
+#define PARALLEL_VACUUM_KEY_BUFFER_USAGE	4
+#define PARALLEL_VACUUM_KEY_HEAP_SHARED		5
+#define PARALLEL_VACUUM_KEY_HEAP_DEAD_TUPLES	6
+#define PARALLEL_VACUUM_KEY_WAL_USAGE		7
+
+/*
+ * Number of heap blocks a process takes at a time in a parallel heap scan,
+ * and the number of pages a process may leave to the leader because they
+ * can't be processed in parallel mode.
+ */
+#define PARALLEL_VACUUM_HEAP_CHUNK		SKIP_PAGES_THRESHOLD
+#define PARALLEL_VACUUM_MAX_DEFERRED	64
+
+/*
+ * Tuple and page counts gathered while scanning the heap.
+ */
+typedef struct LVScanCounts
+{
+	BlockNumber empty_pages;
+	BlockNumber vacuumed_pages;
+	double		num_tuples;		/* total number of nonremovable tuples */
+	double		live_tuples;	/* live tuples (reltuples estimate) */
+	double		tups_vacuumed;	/* tuples cleaned up by vacuum */
+	double		nkeep;			/* dead-but-not-removable tuples */
+	double		nunused;		/* unused line pointers */
+} LVScanCounts;
+
+/*
+ * Per-index state for parallel index vacuum, kept in the DSM segment.
+ */
+typedef struct LVSharedIndStats
+{
+	bool		parallel;		/* process this index in the parallel loop? */
+	bool		updated;		/* is 'stats' valid? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndStats;
+
+/*
+ * Shared information among the leader and the parallel vacuum workers.
+ */
+typedef struct LVShared
+{
+	/* Target heap relation and the message level to use */
+	Oid			relid;
+	int			elevel;
+
+	/*
+	 * Whether this is an index cleanup pass rather than a bulk-deletion
+	 * pass, and the heap tuple count to pass down to the index AM.
+	 */
+	bool		for_cleanup;
+	double		reltuples;
+	bool		estimated_count;
+
+	/* maintenance_work_mem to be used by each worker, in kB */
+	int			maintenance_work_mem_worker;
+
+	/*
+	 * Shared vacuum cost balance, and the number of processes currently
+	 * doing index vacuuming; see compute_parallel_delay().
+	 */
+	pg_atomic_uint32 cost_balance;
+	pg_atomic_uint32 active_nworkers;
+
+	/* Next index to be processed in the parallel loop */
+	pg_atomic_uint32 idx;
+
+	int			nindexes;
+	LVSharedIndStats indstats[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/*
+ * Results of one process in a parallel heap scan.
+ */
+typedef struct LVHeapScanResult
+{
+	LVScanCounts counts;
+	BlockNumber scanned_pages;
+	BlockNumber tupcount_pages;
+	BlockNumber pinskipped_pages;
+	BlockNumber frozenskipped_pages;
+	BlockNumber nonempty_pages;
+	TransactionId latestRemovedXid;
+
+	/* Pages left for the leader to process after the round */
+	BlockNumber leftover_start;
+	BlockNumber leftover_end;
+	int			ndeferred;
+	BlockNumber deferred[PARALLEL_VACUUM_MAX_DEFERRED];
+} LVHeapScanResult;
+
+/*
+ * Shared information among the leader and the workers of a parallel heap
+ * scan.
+ */
+typedef struct LVHeapShared
+{
+	/* Target heap relation and the message level to use */
+	Oid			relid;
+	int			elevel;
+
+	/* The leader's parameters and cutoffs for this vacuum */
+	VacuumParams params;
+	bool		aggressive;
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	MultiXactId MultiXactCutoff;
+
+	BlockNumber nblocks;
+	bool		useindex;
+	int			nindexes;
+
+	/* Shared vacuum cost balance; see compute_parallel_delay() */
+	pg_atomic_uint32 cost_balance;
+	pg_atomic_uint32 active_nworkers;
+
+	/* Next heap block to be handed out */
+	pg_atomic_uint64 nallocated;
+
+	/* Size of each process's dead tuple store */
+	Size		store_size;
+
+	int			nprocs;
+	LVHeapScanResult results[FLEXIBLE_ARRAY_MEMBER];
+} LVHeapShared;
+
 typedef struct LVRelStats
 {
 	/* useindex = true means two-pass strategy; false means one-pass */
@@ -122,20 +343,21 @@ typedef struct LVRelStats
 	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
 	BlockNumber tupcount_pages; /* pages whose tuples we counted */
 	double		old_live_tuples;	/* previous value of pg_class.reltuples */
+	TransactionId relfrozenxid; /* previous value of pg_class.relfrozenxid */
+	MultiXactId relminmxid;		/* previous value of pg_class.relminmxid */
 	double		new_rel_tuples; /* new estimated total # of tuples */
 	double		new_live_tuples;	/* new estimated total # of live tuples */
 	double		new_dead_tuples;	/* new estimated total # of dead tuples */
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete */
+	LVDeadTuples *dead_tuples;
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* requested parallel index vacuum degree, as in VacuumParams.nworkers */
+	int			nworkers;
 } LVRelStats;
 
 
@@ -153,26 +375,99 @@ static BufferAccessStrategy vac_strategy;
 static void lazy_scan_heap(Relation onerel, VacuumParams *params,
 						   LVRelStats *vacrelstats, Relation *Irel, int nindexes,
 						   bool aggressive);
+static void lazy_serial_scan_heap(Relation onerel, VacuumParams *params,
+								  LVRelStats *vacrelstats, Relation *Irel,
+								  IndexBulkDeleteResult **indstats,
+								  int nindexes, bool aggressive,
+								  LVScanCounts *counts,
+								  BlockNumber *next_fsm_block_to_vacuum);
+static void lazy_vacuum_indexes_and_heap(Relation onerel,
+										 LVRelStats *vacrelstats,
+										 Relation *Irel,
+										 IndexBulkDeleteResult **indstats,
+										 int nindexes);
+static bool lazy_scan_page(Relation onerel, VacuumParams *params,
+						   LVRelStats *vacrelstats, int nindexes,
+						   bool aggressive, BlockNumber blkno,
+						   bool all_visible_according_to_vm, Buffer *vmbuffer,
+						   xl_heap_freeze_tuple *frozen, LVScanCounts *counts,
+						   BlockNumber *next_fsm_block_to_vacuum);
+static bool lazy_page_needs_new_multi(Page page);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
+#ifdef USE_PREFETCH
+static int	lazy_prefetch_distance(void);
+static BlockNumber lazy_prefetch_heap(Relation onerel, VacuumParams *params,
+									  bool aggressive, BlockNumber blkno,
+									  BlockNumber prefetch_blkno,
+									  BlockNumber stop_blkno, Buffer *vmbuffer);
+#endif
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup);
 static void lazy_vacuum_index(Relation indrel,
 							  IndexBulkDeleteResult **stats,
 							  LVRelStats *vacrelstats);
 static void lazy_cleanup_index(Relation indrel,
-							   IndexBulkDeleteResult *stats,
-							   LVRelStats *vacrelstats);
+							   IndexBulkDeleteResult **stats,
+							   double reltuples, bool estimated_count);
+static void lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
+									IndexBulkDeleteResult **stats,
+									LVRelStats *vacrelstats, int nindexes);
+static void lazy_cleanup_all_indexes(Relation onerel, Relation *Irel,
+									 IndexBulkDeleteResult **stats,
+									 LVRelStats *vacrelstats, int nindexes);
+static bool lazy_parallel_vacuum_indexes(Relation onerel, Relation *Irel,
+										 IndexBulkDeleteResult **stats,
+										 LVRelStats *vacrelstats, int nindexes,
+										 bool for_cleanup);
+static int	compute_parallel_vacuum_workers(Relation *Irel, int nindexes,
+											LVRelStats *vacrelstats,
+											bool for_cleanup,
+											bool *can_parallel);
+static void parallel_vacuum_indexes(Relation *Irel, LVShared *lvshared,
+									LVRelStats *vacrelstats);
+static int	compute_parallel_heap_workers(BlockNumber nblocks,
+										  LVRelStats *vacrelstats);
+static void lazy_parallel_scan_heap(Relation onerel, VacuumParams *params,
+									LVRelStats *vacrelstats, Relation *Irel,
+									IndexBulkDeleteResult **indstats,
+									int nindexes, bool aggressive,
+									int nworkers, LVScanCounts *counts);
+static void lazy_parallel_scan_heap_blocks(Relation onerel,
+										   LVHeapShared *shared, int procno,
+										   LVDeadTuples *dt);
+static void update_index_statistics(Relation *Irel,
+									IndexBulkDeleteResult **stats,
+									int nindexes);
 static int	lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-							 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+							 int blkindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
 static bool should_attempt_truncation(VacuumParams *params,
 									  LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 											LVRelStats *vacrelstats);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
+static Size lazy_dead_tuples_budget(LVRelStats *vacrelstats,
+									BlockNumber relblocks);
+static Size lazy_dead_tuples_layout(Size space, BlockNumber relblocks,
+									int *dir_shift, uint32 *ndir);
+static Size lazy_dead_tuples_size(Size space, BlockNumber relblocks);
+static void lazy_init_dead_tuples(LVDeadTuples *dt, Size space,
+								  BlockNumber relblocks);
+static LVDeadTuples *lazy_alloc_dead_tuples(Size space,
+											BlockNumber relblocks);
+static int	lazy_max_dead_tuples(Size space);
+static Size lazy_dead_tuples_copy_size(LVDeadTuples *dt);
+static void lazy_copy_dead_tuples(LVDeadTuples *dst, LVDeadTuples *src);
+static LVDeadTuples *lazy_merge_dead_tuples(LVDeadTuples **srcs, int nsrcs,
+											BlockNumber relblocks);
+static void lazy_reset_dead_tuples(LVDeadTuples *dt);
 static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
 								   ItemPointer itemptr);
+static void lazy_add_dead_tuple(LVDeadTuples *dt, BlockNumber blkno,
+								OffsetNumber offnum);
+static int	lazy_get_dead_offsets(LVDeadTuples *dt, int blkindex,
+								  OffsetNumber *offsets);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
+static int	vac_cmp_blockno(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 
@@ -208,14 +503,20 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	double		new_live_tuples;
 	TransactionId new_frozen_xid;
 	MultiXactId new_min_multi;
+	TransactionId relfrozenxid = onerel->rd_rel->relfrozenxid;
+	MultiXactId relminmxid = onerel->rd_rel->relminmxid;
 
 	Assert(params != NULL);
 	Assert(params->index_cleanup != VACOPT_TERNARY_DEFAULT);
 	Assert(params->truncate != VACOPT_TERNARY_DEFAULT);
 
+	/* a global temporary table's horizons are kept by this session */
+	if (RELATION_IS_GLOBAL_TEMP(onerel))
+		GetGlobalTempStorageHorizons(onerel, &relfrozenxid, &relminmxid);
+
 	/* not every AM requires these to be valid, but heap does */
-	Assert(TransactionIdIsNormal(onerel->rd_rel->relfrozenxid));
-	Assert(MultiXactIdIsValid(onerel->rd_rel->relminmxid));
+	Assert(TransactionIdIsNormal(relfrozenxid));
+	Assert(MultiXactIdIsValid(relminmxid));
 
 	/* measure elapsed time iff autovacuum logging requires it */
 	if (IsAutoVacuumWorkerProcess() && params->log_min_duration >= 0)
@@ -248,9 +549,9 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	 * table's minimum MultiXactId is older than or equal to the requested
 	 * mxid full-table scan limit; or if DISABLE_PAGE_SKIPPING was specified.
 	 */
-	aggressive = TransactionIdPrecedesOrEquals(onerel->rd_rel->relfrozenxid,
+	aggressive = TransactionIdPrecedesOrEquals(relfrozenxid,
 											   xidFullScanLimit);
-	aggressive |= MultiXactIdPrecedesOrEquals(onerel->rd_rel->relminmxid,
+	aggressive |= MultiXactIdPrecedesOrEquals(relminmxid,
 											  mxactFullScanLimit);
 	if (params->options & VACOPT_DISABLE_PAGE_SKIPPING)
 		aggressive = true;
@@ -259,6 +560,8 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 
 	vacrelstats->old_rel_pages = onerel->rd_rel->relpages;
 	vacrelstats->old_live_tuples = onerel->rd_rel->reltuples;
+	vacrelstats->relfrozenxid = relfrozenxid;
+	vacrelstats->relminmxid = relminmxid;
 	vacrelstats->num_index_scans = 0;
 	vacrelstats->pages_removed = 0;
 	vacrelstats->lock_waiter_detected = false;
@@ -268,6 +571,25 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	vacrelstats->useindex = (nindexes > 0 &&
 							 params->index_cleanup == VACOPT_TERNARY_ENABLED);
 
+	/*
+	 * Decide whether the heap and the indexes may be processed in parallel.
+	 * Parallel workers can't access the leader's local buffers, so this is
+	 * not possible for temporary tables.
+	 */
+	vacrelstats->nworkers = -1;
+	if (params->nworkers >= 0)
+	{
+		if (RelationUsesLocalBuffers(onerel))
+		{
+			if (params->nworkers > 0)
+				ereport(WARNING,
+						(errmsg("disabling parallel option of vacuum on \"%s\" --- cannot vacuum temporary tables in parallel",
+								RelationGetRelationName(onerel))));
+		}
+		else
+			vacrelstats->nworkers = params->nworkers;
+	}
+
 	/* Do the vacuuming */
 	lazy_scan_heap(onerel, params, vacrelstats, Irel, nindexes, aggressive);
 
@@ -336,6 +658,14 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	new_frozen_xid = scanned_all_unfrozen ? FreezeLimit : InvalidTransactionId;
 	new_min_multi = scanned_all_unfrozen ? MultiXactCutoff : InvalidMultiXactId;
 
+	/* pg_class doesn't hold a global temporary table's horizons */
+	if (RELATION_IS_GLOBAL_TEMP(onerel))
+	{
+		SetGlobalTempStorageHorizons(onerel, new_frozen_xid, new_min_multi);
+		new_frozen_xid = InvalidTransactionId;
+		new_min_multi = InvalidMultiXactId;
+	}
+
 	vac_update_relstats(onerel,
 						new_rel_pages,
 						new_live_tuples,
@@ -475,32 +805,21 @@ vacuum_log_cleanup_info(Relation rel, LVRelStats *vacrelstats)
  *		If there are no indexes then we can reclaim line pointers on the fly;
  *		dead line pointers need only be retained until all index pointers that
  *		reference them have been killed.
+ *
+ *		The pages are scanned by lazy_serial_scan_heap, or by
+ *		lazy_parallel_scan_heap if parallel workers are to be used.
  */
 static void
 lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			   Relation *Irel, int nindexes, bool aggressive)
 {
-	BlockNumber nblocks,
-				blkno;
-	HeapTupleData tuple;
+	BlockNumber nblocks;
 	char	   *relname;
-	TransactionId relfrozenxid = onerel->rd_rel->relfrozenxid;
-	TransactionId relminmxid = onerel->rd_rel->relminmxid;
-	BlockNumber empty_pages,
-				vacuumed_pages,
-				next_fsm_block_to_vacuum;
-	double		num_tuples,		/* total number of nonremovable tuples */
-				live_tuples,	/* live tuples (reltuples estimate) */
-				tups_vacuumed,	/* tuples cleaned up by vacuum */
-				nkeep,			/* dead-but-not-removable tuples */
-				nunused;		/* unused line pointers */
+	BlockNumber next_fsm_block_to_vacuum;
+	LVScanCounts counts;
 	IndexBulkDeleteResult **indstats;
-	int			i;
+	int			nworkers;
 	PGRUsage	ru0;
-	Buffer		vmbuffer = InvalidBuffer;
-	BlockNumber next_unskippable_block;
-	bool		skipping_blocks;
-	xl_heap_freeze_tuple *frozen;
 	StringInfoData buf;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
@@ -523,9 +842,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 						get_namespace_name(RelationGetNamespace(onerel)),
 						relname)));
 
-	empty_pages = vacuumed_pages = 0;
 	next_fsm_block_to_vacuum = (BlockNumber) 0;
-	num_tuples = live_tuples = tups_vacuumed = nkeep = nunused = 0;
+	MemSet(&counts, 0, sizeof(LVScanCounts));
 
 	indstats = (IndexBulkDeleteResult **)
 		palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
@@ -537,15 +855,170 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
-	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+	/*
+	 * A parallel scan collects the dead tuple TIDs in per-process stores, and
+	 * merges them into vacrelstats->dead_tuples after each round, so it only
+	 * needs an empty store to start with.
+	 */
+	nworkers = compute_parallel_heap_workers(nblocks, vacrelstats);
+	if (nworkers > 0)
+		vacrelstats->dead_tuples = lazy_alloc_dead_tuples(0, nblocks);
+	else
+		lazy_space_alloc(vacrelstats, nblocks);
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = vacrelstats->max_dead_tuples;
+	initprog_val[2] =
+		lazy_max_dead_tuples(lazy_dead_tuples_budget(vacrelstats, nblocks));
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
+	if (nworkers > 0)
+		lazy_parallel_scan_heap(onerel, params, vacrelstats, Irel, indstats,
+								nindexes, aggressive, nworkers, &counts);
+	else
+		lazy_serial_scan_heap(onerel, params, vacrelstats, Irel, indstats,
+							  nindexes, aggressive, &counts,
+							  &next_fsm_block_to_vacuum);
+
+	/* report that everything is scanned and vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, nblocks);
+
+	/* save stats for use later */
+	vacrelstats->tuples_deleted = counts.tups_vacuumed;
+	vacrelstats->new_dead_tuples = counts.nkeep;
+
+	/* now we can compute the new value for pg_class.reltuples */
+	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
+														  nblocks,
+														  vacrelstats->tupcount_pages,
+														  counts.live_tuples);
+
+	/* also compute total number of surviving heap entries */
+	vacrelstats->new_rel_tuples =
+		vacrelstats->new_live_tuples + vacrelstats->new_dead_tuples;
+
+	/* If any tuples need to be deleted, perform final vacuum cycle */
+	/* XXX put a threshold on min number of tuples here? */
+	if (vacrelstats->dead_tuples->num_tuples > 0)
+	{
+		const int	hvp_index[] = {
+			PROGRESS_VACUUM_PHASE,
+			PROGRESS_VACUUM_NUM_INDEX_VACUUMS
+		};
+		int64		hvp_val[2];
+
+		/* Log cleanup info before we touch indexes */
+		vacuum_log_cleanup_info(onerel, vacrelstats);
+
+		/* Report that we are now vacuuming indexes */
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
+
+		/* Remove index entries */
+		lazy_vacuum_all_indexes(onerel, Irel, indstats,
+								vacrelstats, nindexes);
+
+		/* Report that we are now vacuuming the heap */
+		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
+		hvp_val[1] = vacrelstats->num_index_scans + 1;
+		pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
+
+		/* Remove tuples from heap */
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
+		lazy_vacuum_heap(onerel, vacrelstats);
+		vacrelstats->num_index_scans++;
+	}
+
+	/*
+	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
+	 * not there were indexes.
+	 */
+	if (nblocks > next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, nblocks);
+
+	/* report all blocks vacuumed; and that we're cleaning up */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, nblocks);
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
+
+	/* Do post-vacuum cleanup and statistics update for each index */
+	if (vacrelstats->useindex)
+	{
+		lazy_cleanup_all_indexes(onerel, Irel, indstats,
+								 vacrelstats, nindexes);
+		update_index_statistics(Irel, indstats, nindexes);
+	}
+
+	/* If no indexes, make log report that lazy_vacuum_heap would've made */
+	if (counts.vacuumed_pages)
+		ereport(elevel,
+				(errmsg("\"%s\": removed %.0f row versions in %u pages",
+						RelationGetRelationName(onerel),
+						counts.tups_vacuumed, counts.vacuumed_pages)));
+
+	/*
+	 * This is pretty messy, but we split it up so that we can skip emitting
+	 * individual parts of the message when not applicable.
+	 */
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
+					 counts.nkeep, OldestXmin);
+	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
+					 counts.nunused);
+	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
+									"Skipped %u pages due to buffer pins, ",
+									vacrelstats->pinskipped_pages),
+					 vacrelstats->pinskipped_pages);
+	appendStringInfo(&buf, ngettext("%u frozen page.\n",
+									"%u frozen pages.\n",
+									vacrelstats->frozenskipped_pages),
+					 vacrelstats->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
+									"%u pages are entirely empty.\n",
+									counts.empty_pages),
+					 counts.empty_pages);
+	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+
+	ereport(elevel,
+			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
+					RelationGetRelationName(onerel),
+					counts.tups_vacuumed, counts.num_tuples,
+					vacrelstats->scanned_pages, nblocks),
+			 errdetail_internal("%s", buf.data)));
+	pfree(buf.data);
+}
+
+/*
+ *	lazy_serial_scan_heap() -- scan the heap in the leader process only
+ *
+ *		Visits the pages in order, doing index and heap vacuuming passes
+ *		whenever the dead tuple store fills up.  *next_fsm_block_to_vacuum
+ *		is set to where the Free Space Map remains to be vacuumed.
+ */
+static void
+lazy_serial_scan_heap(Relation onerel, VacuumParams *params,
+					  LVRelStats *vacrelstats, Relation *Irel,
+					  IndexBulkDeleteResult **indstats, int nindexes,
+					  bool aggressive, LVScanCounts *counts,
+					  BlockNumber *next_fsm_block_to_vacuum)
+{
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	BlockNumber blkno;
+	Buffer		vmbuffer = InvalidBuffer;
+	BlockNumber next_unskippable_block;
+	bool		skipping_blocks;
+#ifdef USE_PREFETCH
+	int			prefetch_distance = lazy_prefetch_distance();
+	BlockNumber prefetch_blkno = 0;
+	Buffer		prefetch_vmbuffer = InvalidBuffer;
+#endif
+	xl_heap_freeze_tuple *frozen;
+
+	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+
 	/*
 	 * Except when aggressive is set, we want to skip pages that are
 	 * all-visible according to the visibility map, but only when we can skip
@@ -621,20 +1094,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 	for (blkno = 0; blkno < nblocks; blkno++)
 	{
-		Buffer		buf;
-		Page		page;
-		OffsetNumber offnum,
-					maxoff;
-		bool		tupgone,
-					hastup;
-		int			prev_dead_count;
-		int			nfrozen;
-		Size		freespace;
 		bool		all_visible_according_to_vm = false;
-		bool		all_visible;
-		bool		all_frozen = true;	/* provided all_visible is also true */
-		bool		has_dead_tuples;
-		TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
 		/* see note above about forcing scanning of last page */
 #define FORCE_CHECK_PAGE() \
@@ -721,15 +1181,9 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (DeadTuplesFreeSpace(vacrelstats->dead_tuples) < DEADBLOCK_MAX_SIZE &&
+			vacrelstats->dead_tuples->num_tuples > 0)
 		{
-			const int	hvp_index[] = {
-				PROGRESS_VACUUM_PHASE,
-				PROGRESS_VACUUM_NUM_INDEX_VACUUMS
-			};
-			int64		hvp_val[2];
-
 			/*
 			 * Before beginning index vacuuming, we release any pin we may
 			 * hold on the visibility map page.  This isn't necessary for
@@ -741,759 +1195,824 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 				ReleaseBuffer(vmbuffer);
 				vmbuffer = InvalidBuffer;
 			}
+#ifdef USE_PREFETCH
+			if (BufferIsValid(prefetch_vmbuffer))
+			{
+				ReleaseBuffer(prefetch_vmbuffer);
+				prefetch_vmbuffer = InvalidBuffer;
+			}
+#endif
 
-			/* Log cleanup info before we touch indexes */
-			vacuum_log_cleanup_info(onerel, vacrelstats);
-
-			/* Report that we are now vacuuming indexes */
-			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
-
-			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
-
-			/*
-			 * Report that we are now vacuuming the heap.  We also increase
-			 * the number of index scans here; note that by using
-			 * pgstat_progress_update_multi_param we can update both
-			 * parameters atomically.
-			 */
-			hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
-			hvp_val[1] = vacrelstats->num_index_scans + 1;
-			pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
-
-			/* Remove tuples from heap */
-			lazy_vacuum_heap(onerel, vacrelstats);
-
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			vacrelstats->num_dead_tuples = 0;
-			vacrelstats->num_index_scans++;
+			lazy_vacuum_indexes_and_heap(onerel, vacrelstats, Irel, indstats,
+										 nindexes);
 
 			/*
 			 * Vacuum the Free Space Map to make newly-freed space visible on
 			 * upper-level FSM pages.  Note we have not yet processed blkno.
 			 */
-			FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
-			next_fsm_block_to_vacuum = blkno;
+			FreeSpaceMapVacuumRange(onerel, *next_fsm_block_to_vacuum, blkno);
+			*next_fsm_block_to_vacuum = blkno;
 
 			/* Report that we are once again scanning the heap */
 			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
 										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
 		}
 
+#ifdef USE_PREFETCH
+
 		/*
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_unskippable_block is covered by a different
-		 * VM page than the current block or (b) we released our pin and did a
-		 * cycle of index vacuuming.
-		 *
+		 * Keep the pages we'll need over the next prefetch_distance blocks
+		 * on their way in.  OS readahead might do this for us, but not once
+		 * we start skipping pages, and not on all storage.
 		 */
-		visibilitymap_pin(onerel, blkno, &vmbuffer);
+		if (prefetch_distance > 0)
+			prefetch_blkno = lazy_prefetch_heap(onerel, params, aggressive,
+												blkno, prefetch_blkno,
+												Min(nblocks,
+													blkno + 1 + prefetch_distance),
+												&prefetch_vmbuffer);
+#endif
+
+
+		lazy_scan_page(onerel, params, vacrelstats, nindexes, aggressive,
+					   blkno, all_visible_according_to_vm, &vmbuffer, frozen,
+					   counts, next_fsm_block_to_vacuum);
+	}
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
+	pfree(frozen);
 
-		/* We need buffer cleanup lock so that we can prune HOT chains. */
-		if (!ConditionalLockBufferForCleanup(buf))
-		{
-			/*
-			 * If we're not performing an aggressive scan to guard against XID
-			 * wraparound, and we don't want to forcibly check the page, then
-			 * it's OK to skip vacuuming pages we get a lock conflict on. They
-			 * will be dealt with in some future vacuum.
-			 */
-			if (!aggressive && !FORCE_CHECK_PAGE())
-			{
-				ReleaseBuffer(buf);
-				vacrelstats->pinskipped_pages++;
-				continue;
-			}
+	/*
+	 * Release any remaining pin on visibility map page.
+	 */
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
+#ifdef USE_PREFETCH
+	if (BufferIsValid(prefetch_vmbuffer))
+	{
+		ReleaseBuffer(prefetch_vmbuffer);
+		prefetch_vmbuffer = InvalidBuffer;
+	}
+#endif
+}
 
-			/*
-			 * Read the page with share lock to see if any xids on it need to
-			 * be frozen.  If not we just skip the page, after updating our
-			 * scan statistics.  If there are some, we wait for cleanup lock.
-			 *
-			 * We could defer the lock request further by remembering the page
-			 * and coming back to it later, or we could even register
-			 * ourselves for multiple buffers and then service whichever one
-			 * is received first.  For now, this seems good enough.
-			 *
-			 * If we get here with aggressive false, then we're just forcibly
-			 * checking the page, and so we don't want to insist on getting
-			 * the lock; we only need to know if the page contains tuples, so
-			 * that we can update nonempty_pages correctly.  It's convenient
-			 * to use lazy_check_needs_freeze() for both situations, though.
-			 */
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-			if (!lazy_check_needs_freeze(buf, &hastup))
-			{
-				UnlockReleaseBuffer(buf);
-				vacrelstats->scanned_pages++;
-				vacrelstats->pinskipped_pages++;
-				if (hastup)
-					vacrelstats->nonempty_pages = blkno + 1;
-				continue;
-			}
-			if (!aggressive)
-			{
-				/*
-				 * Here, we must not advance scanned_pages; that would amount
-				 * to claiming that the page contains no freezable tuples.
-				 */
-				UnlockReleaseBuffer(buf);
-				vacrelstats->pinskipped_pages++;
-				if (hastup)
-					vacrelstats->nonempty_pages = blkno + 1;
-				continue;
-			}
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			LockBufferForCleanup(buf);
-			/* drop through to normal processing */
-		}
+/*
+ *	lazy_vacuum_indexes_and_heap() -- do one index and heap vacuuming pass
+ *
+ *		Removes the index entries pointing to the dead tuples collected so
+ *		far, then the dead tuples themselves, and empties the store.
+ */
+static void
+lazy_vacuum_indexes_and_heap(Relation onerel, LVRelStats *vacrelstats,
+							 Relation *Irel, IndexBulkDeleteResult **indstats,
+							 int nindexes)
+{
+	const int	hvp_index[] = {
+		PROGRESS_VACUUM_PHASE,
+		PROGRESS_VACUUM_NUM_INDEX_VACUUMS
+	};
+	int64		hvp_val[2];
 
-		vacrelstats->scanned_pages++;
-		vacrelstats->tupcount_pages++;
+	/* Log cleanup info before we touch indexes */
+	vacuum_log_cleanup_info(onerel, vacrelstats);
 
-		page = BufferGetPage(buf);
+	/* Report that we are now vacuuming indexes */
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
-		if (PageIsNew(page))
-		{
-			bool		still_new;
+	/* Remove index entries */
+	lazy_vacuum_all_indexes(onerel, Irel, indstats, vacrelstats, nindexes);
 
-			/*
-			 * All-zeroes pages can be left over if either a backend extends
-			 * the relation by a single page, but crashes before the newly
-			 * initialized page has been written out, or when bulk-extending
-			 * the relation (which creates a number of empty pages at the tail
-			 * end of the relation, but enters them into the FSM).
-			 *
-			 * Make sure these pages are in the FSM, to ensure they can be
-			 * reused. Do that by testing if there's any space recorded for
-			 * the page. If not, enter it.
-			 *
-			 * Note we do not enter the page into the visibilitymap. That has
-			 * the downside that we repeatedly visit this page in subsequent
-			 * vacuums, but otherwise we'll never not discover the space on a
-			 * promoted standby. The harm of repeated checking ought to
-			 * normally not be too bad - the space usually should be used at
-			 * some point, otherwise there wouldn't be any regular vacuums.
-			 */
+	/*
+	 * Report that we are now vacuuming the heap.  We also increase the
+	 * number of index scans here; note that by using
+	 * pgstat_progress_update_multi_param we can update both parameters
+	 * atomically.
+	 */
+	hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
+	hvp_val[1] = vacrelstats->num_index_scans + 1;
+	pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
 
-			/*
-			 * Perform checking of FSM after releasing lock, the fsm is
-			 * approximate, after all.
-			 */
-			still_new = PageIsNew(page);
-			UnlockReleaseBuffer(buf);
+	/* Remove tuples from heap */
+	lazy_vacuum_heap(onerel, vacrelstats);
 
-			if (still_new)
-			{
-				empty_pages++;
+	/*
+	 * Forget the now-vacuumed tuples, and press on, but be careful not to
+	 * reset latestRemovedXid since we want that value to be valid.
+	 */
+	lazy_reset_dead_tuples(vacrelstats->dead_tuples);
+	vacrelstats->num_index_scans++;
+}
 
-				if (GetRecordedFreeSpace(onerel, blkno) == 0)
-				{
-					Size		freespace;
+/*
+ *	lazy_scan_page() -- process one heap page for lazy_scan_heap
+ *
+ *		Prunes the page, collects the TIDs of its dead tuples, freezes tuples
+ *		and updates the visibility map and free space map as needed.  The
+ *		tuple counts go into *counts, and the page counts into vacrelstats.
+ *		*vmbuffer is the caller's visibility map buffer pin, and frozen is
+ *		workspace for MaxHeapTuplesPerPage freeze plans.  If
+ *		next_fsm_block_to_vacuum isn't NULL, the Free Space Map is vacuumed
+ *		every so often when there are no indexes.
+ *
+ *		Returns false, having done nothing, if the page was left alone
+ *		because we are in parallel mode and freezing it would need a new
+ *		MultiXactId.
+ */
+static bool
+lazy_scan_page(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
+			   int nindexes, bool aggressive, BlockNumber blkno,
+			   bool all_visible_according_to_vm, Buffer *vmbuffer,
+			   xl_heap_freeze_tuple *frozen, LVScanCounts *counts,
+			   BlockNumber *next_fsm_block_to_vacuum)
+{
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	char	   *relname = RelationGetRelationName(onerel);
+	TransactionId relfrozenxid = vacrelstats->relfrozenxid;
+	MultiXactId relminmxid = vacrelstats->relminmxid;
+	HeapTupleData tuple;
+	Buffer		buf;
+	Page		page;
+	OffsetNumber offnum,
+				maxoff;
+	bool		tupgone,
+				hastup;
+	int64		prev_dead_count;
+	int			nfrozen;
+	int			i;
+	Size		freespace;
+	bool		all_visible;
+	bool		all_frozen = true;	/* provided all_visible is also true */
+	bool		has_dead_tuples;
+	TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
-					freespace = BufferGetPageSize(buf) - SizeOfPageHeaderData;
-					RecordPageWithFreeSpace(onerel, blkno, freespace);
-				}
-			}
-			continue;
-		}
+	/*
+	 * Pin the visibility map page in case we need to mark the page
+	 * all-visible.  In most cases this will be very cheap, because we'll
+	 * already have the correct page pinned anyway.  However, it's
+	 * possible that (a) next_unskippable_block is covered by a different
+	 * VM page than the current block or (b) we released our pin and did a
+	 * cycle of index vacuuming.
+	 *
+	 */
+	visibilitymap_pin(onerel, blkno, vmbuffer);
+
+	buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
+							 RBM_NORMAL, vac_strategy);
 
-		if (PageIsEmpty(page))
+	/* We need buffer cleanup lock so that we can prune HOT chains. */
+	if (!ConditionalLockBufferForCleanup(buf))
+	{
+		/*
+		 * If we're not performing an aggressive scan to guard against XID
+		 * wraparound, and we don't want to forcibly check the page, then
+		 * it's OK to skip vacuuming pages we get a lock conflict on. They
+		 * will be dealt with in some future vacuum.
+		 */
+		if (!aggressive && !FORCE_CHECK_PAGE())
 		{
-			empty_pages++;
-			freespace = PageGetHeapFreeSpace(page);
+			ReleaseBuffer(buf);
+			vacrelstats->pinskipped_pages++;
+			return true;
+		}
 
+		/*
+		 * Read the page with share lock to see if any xids on it need to
+		 * be frozen.  If not we just skip the page, after updating our
+		 * scan statistics.  If there are some, we wait for cleanup lock.
+		 *
+		 * We could defer the lock request further by remembering the page
+		 * and coming back to it later, or we could even register
+		 * ourselves for multiple buffers and then service whichever one
+		 * is received first.  For now, this seems good enough.
+		 *
+		 * If we get here with aggressive false, then we're just forcibly
+		 * checking the page, and so we don't want to insist on getting
+		 * the lock; we only need to know if the page contains tuples, so
+		 * that we can update nonempty_pages correctly.  It's convenient
+		 * to use lazy_check_needs_freeze() for both situations, though.
+		 */
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		if (!lazy_check_needs_freeze(buf, &hastup))
+		{
+			UnlockReleaseBuffer(buf);
+			vacrelstats->scanned_pages++;
+			vacrelstats->pinskipped_pages++;
+			if (hastup)
+				vacrelstats->nonempty_pages = blkno + 1;
+			return true;
+		}
+		if (!aggressive)
+		{
 			/*
-			 * Empty pages are always all-visible and all-frozen (note that
-			 * the same is currently not true for new pages, see above).
+			 * Here, we must not advance scanned_pages; that would amount
+			 * to claiming that the page contains no freezable tuples.
 			 */
-			if (!PageIsAllVisible(page))
-			{
-				START_CRIT_SECTION();
+			UnlockReleaseBuffer(buf);
+			vacrelstats->pinskipped_pages++;
+			if (hastup)
+				vacrelstats->nonempty_pages = blkno + 1;
+			return true;
+		}
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBufferForCleanup(buf);
+		/* drop through to normal processing */
+	}
 
-				/* mark buffer dirty before writing a WAL record */
-				MarkBufferDirty(buf);
+	/*
+	 * In parallel mode, leave pages whose freezing would need a new
+	 * MultiXactId to the leader.
+	 */
+	if (IsInParallelMode() && lazy_page_needs_new_multi(BufferGetPage(buf)))
+	{
+		UnlockReleaseBuffer(buf);
+		return false;
+	}
 
-				/*
-				 * It's possible that another backend has extended the heap,
-				 * initialized the page, and then failed to WAL-log the page
-				 * due to an ERROR.  Since heap extension is not WAL-logged,
-				 * recovery might try to replay our record setting the page
-				 * all-visible and find that the page isn't initialized, which
-				 * will cause a PANIC.  To prevent that, check whether the
-				 * page has been previously WAL-logged, and if not, do that
-				 * now.
-				 */
-				if (RelationNeedsWAL(onerel) &&
-					PageGetLSN(page) == InvalidXLogRecPtr)
-					log_newpage_buffer(buf, true);
-
-				PageSetAllVisible(page);
-				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId,
-								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
-				END_CRIT_SECTION();
-			}
+	vacrelstats->scanned_pages++;
+	vacrelstats->tupcount_pages++;
 
-			UnlockReleaseBuffer(buf);
-			RecordPageWithFreeSpace(onerel, blkno, freespace);
-			continue;
-		}
+	page = BufferGetPage(buf);
+
+	if (PageIsNew(page))
+	{
+		bool		still_new;
 
 		/*
-		 * Prune all HOT-update chains in this page.
+		 * All-zeroes pages can be left over if either a backend extends
+		 * the relation by a single page, but crashes before the newly
+		 * initialized page has been written out, or when bulk-extending
+		 * the relation (which creates a number of empty pages at the tail
+		 * end of the relation, but enters them into the FSM).
+		 *
+		 * Make sure these pages are in the FSM, to ensure they can be
+		 * reused. Do that by testing if there's any space recorded for
+		 * the page. If not, enter it.
 		 *
-		 * We count tuples removed by the pruning step as removed by VACUUM.
+		 * Note we do not enter the page into the visibilitymap. That has
+		 * the downside that we repeatedly visit this page in subsequent
+		 * vacuums, but otherwise we'll never not discover the space on a
+		 * promoted standby. The harm of repeated checking ought to
+		 * normally not be too bad - the space usually should be used at
+		 * some point, otherwise there wouldn't be any regular vacuums.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
-										 &vacrelstats->latestRemovedXid);
 
 		/*
-		 * Now scan the page to collect vacuumable items and check for tuples
-		 * requiring freezing.
+		 * Perform checking of FSM after releasing lock, the fsm is
+		 * approximate, after all.
 		 */
-		all_visible = true;
-		has_dead_tuples = false;
-		nfrozen = 0;
-		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
-		maxoff = PageGetMaxOffsetNumber(page);
+		still_new = PageIsNew(page);
+		UnlockReleaseBuffer(buf);
 
-		/*
-		 * Note: If you change anything in the loop below, also look at
-		 * heap_page_is_all_visible to see if that needs to be changed.
-		 */
-		for (offnum = FirstOffsetNumber;
-			 offnum <= maxoff;
-			 offnum = OffsetNumberNext(offnum))
+		if (still_new)
 		{
-			ItemId		itemid;
-
-			itemid = PageGetItemId(page, offnum);
-
-			/* Unused items require no processing, but we count 'em */
-			if (!ItemIdIsUsed(itemid))
-			{
-				nunused += 1;
-				continue;
-			}
-
-			/* Redirect items mustn't be touched */
-			if (ItemIdIsRedirected(itemid))
-			{
-				hastup = true;	/* this page won't be truncatable */
-				continue;
-			}
-
-			ItemPointerSet(&(tuple.t_self), blkno, offnum);
-
-			/*
-			 * DEAD line pointers are to be vacuumed normally; but we don't
-			 * count them in tups_vacuumed, else we'd be double-counting (at
-			 * least in the common case where heap_page_prune() just freed up
-			 * a non-HOT tuple).
-			 */
-			if (ItemIdIsDead(itemid))
-			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
-				all_visible = false;
-				continue;
-			}
-
-			Assert(ItemIdIsNormal(itemid));
+			counts->empty_pages++;
 
-			tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
-			tuple.t_len = ItemIdGetLength(itemid);
-			tuple.t_tableOid = RelationGetRelid(onerel);
-
-			tupgone = false;
-
-			/*
-			 * The criteria for counting a tuple as live in this block need to
-			 * match what analyze.c's acquire_sample_rows() does, otherwise
-			 * VACUUM and ANALYZE may produce wildly different reltuples
-			 * values, e.g. when there are many recently-dead tuples.
-			 *
-			 * The logic here is a bit simpler than acquire_sample_rows(), as
-			 * VACUUM can't run inside a transaction block, which makes some
-			 * cases impossible (e.g. in-progress insert from the same
-			 * transaction).
-			 */
-			switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
+			if (GetRecordedFreeSpace(onerel, blkno) == 0)
 			{
-				case HEAPTUPLE_DEAD:
-
-					/*
-					 * Ordinarily, DEAD tuples would have been removed by
-					 * heap_page_prune(), but it's possible that the tuple
-					 * state changed since heap_page_prune() looked.  In
-					 * particular an INSERT_IN_PROGRESS tuple could have
-					 * changed to DEAD if the inserter aborted.  So this
-					 * cannot be considered an error condition.
-					 *
-					 * If the tuple is HOT-updated then it must only be
-					 * removed by a prune operation; so we keep it just as if
-					 * it were RECENTLY_DEAD.  Also, if it's a heap-only
-					 * tuple, we choose to keep it, because it'll be a lot
-					 * cheaper to get rid of it in the next pruning pass than
-					 * to treat it like an indexed tuple. Finally, if index
-					 * cleanup is disabled, the second heap pass will not
-					 * execute, and the tuple will not get removed, so we must
-					 * treat it like any other dead tuple that we choose to
-					 * keep.
-					 *
-					 * If this were to happen for a tuple that actually needed
-					 * to be deleted, we'd be in trouble, because it'd
-					 * possibly leave a tuple below the relation's xmin
-					 * horizon alive.  heap_prepare_freeze_tuple() is prepared
-					 * to detect that case and abort the transaction,
-					 * preventing corruption.
-					 */
-					if (HeapTupleIsHotUpdated(&tuple) ||
-						HeapTupleIsHeapOnly(&tuple) ||
-						params->index_cleanup == VACOPT_TERNARY_DISABLED)
-						nkeep += 1;
-					else
-						tupgone = true; /* we can delete the tuple */
-					all_visible = false;
-					break;
-				case HEAPTUPLE_LIVE:
-
-					/*
-					 * Count it as live.  Not only is this natural, but it's
-					 * also what acquire_sample_rows() does.
-					 */
-					live_tuples += 1;
-
-					/*
-					 * Is the tuple definitely visible to all transactions?
-					 *
-					 * NB: Like with per-tuple hint bits, we can't set the
-					 * PD_ALL_VISIBLE flag if the inserter committed
-					 * asynchronously. See SetHintBits for more info. Check
-					 * that the tuple is hinted xmin-committed because of
-					 * that.
-					 */
-					if (all_visible)
-					{
-						TransactionId xmin;
-
-						if (!HeapTupleHeaderXminCommitted(tuple.t_data))
-						{
-							all_visible = false;
-							break;
-						}
-
-						/*
-						 * The inserter definitely committed. But is it old
-						 * enough that everyone sees it as committed?
-						 */
-						xmin = HeapTupleHeaderGetXmin(tuple.t_data);
-						if (!TransactionIdPrecedes(xmin, OldestXmin))
-						{
-							all_visible = false;
-							break;
-						}
-
-						/* Track newest xmin on page. */
-						if (TransactionIdFollows(xmin, visibility_cutoff_xid))
-							visibility_cutoff_xid = xmin;
-					}
-					break;
-				case HEAPTUPLE_RECENTLY_DEAD:
-
-					/*
-					 * If tuple is recently deleted then we must not remove it
-					 * from relation.
-					 */
-					nkeep += 1;
-					all_visible = false;
-					break;
-				case HEAPTUPLE_INSERT_IN_PROGRESS:
-
-					/*
-					 * This is an expected case during concurrent vacuum.
-					 *
-					 * We do not count these rows as live, because we expect
-					 * the inserting transaction to update the counters at
-					 * commit, and we assume that will happen only after we
-					 * report our results.  This assumption is a bit shaky,
-					 * but it is what acquire_sample_rows() does, so be
-					 * consistent.
-					 */
-					all_visible = false;
-					break;
-				case HEAPTUPLE_DELETE_IN_PROGRESS:
-					/* This is an expected case during concurrent vacuum */
-					all_visible = false;
-
-					/*
-					 * Count such rows as live.  As above, we assume the
-					 * deleting transaction will commit and update the
-					 * counters after we report.
-					 */
-					live_tuples += 1;
-					break;
-				default:
-					elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
-					break;
-			}
+				Size		freespace;
 
-			if (tupgone)
-			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
-				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
-													   &vacrelstats->latestRemovedXid);
-				tups_vacuumed += 1;
-				has_dead_tuples = true;
+				freespace = BufferGetPageSize(buf) - SizeOfPageHeaderData;
+				RecordPageWithFreeSpace(onerel, blkno, freespace);
 			}
-			else
-			{
-				bool		tuple_totally_frozen;
-
-				num_tuples += 1;
-				hastup = true;
+		}
+		return true;
+	}
 
-				/*
-				 * Each non-removable tuple must be checked to see if it needs
-				 * freezing.  Note we already have exclusive buffer lock.
-				 */
-				if (heap_prepare_freeze_tuple(tuple.t_data,
-											  relfrozenxid, relminmxid,
-											  FreezeLimit, MultiXactCutoff,
-											  &frozen[nfrozen],
-											  &tuple_totally_frozen))
-					frozen[nfrozen++].offset = offnum;
-
-				if (!tuple_totally_frozen)
-					all_frozen = false;
-			}
-		}						/* scan along page */
+	if (PageIsEmpty(page))
+	{
+		counts->empty_pages++;
+		freespace = PageGetHeapFreeSpace(page);
 
 		/*
-		 * If we froze any tuples, mark the buffer dirty, and write a WAL
-		 * record recording the changes.  We must log the changes to be
-		 * crash-safe against future truncation of CLOG.
+		 * Empty pages are always all-visible and all-frozen (note that
+		 * the same is currently not true for new pages, see above).
 		 */
-		if (nfrozen > 0)
+		if (!PageIsAllVisible(page))
 		{
 			START_CRIT_SECTION();
 
+			/* mark buffer dirty before writing a WAL record */
 			MarkBufferDirty(buf);
 
-			/* execute collected freezes */
-			for (i = 0; i < nfrozen; i++)
-			{
-				ItemId		itemid;
-				HeapTupleHeader htup;
-
-				itemid = PageGetItemId(page, frozen[i].offset);
-				htup = (HeapTupleHeader) PageGetItem(page, itemid);
-
-				heap_execute_freeze_tuple(htup, &frozen[i]);
-			}
-
-			/* Now WAL-log freezing if necessary */
-			if (RelationNeedsWAL(onerel))
-			{
-				XLogRecPtr	recptr;
-
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
-										 frozen, nfrozen);
-				PageSetLSN(page, recptr);
-			}
-
-			END_CRIT_SECTION();
-		}
-
-		/*
-		 * If there are no indexes we can vacuum the page right now instead of
-		 * doing a second scan. Also we don't do that but forget dead tuples
-		 * when index cleanup is disabled.
-		 */
-		if (!vacrelstats->useindex && vacrelstats->num_dead_tuples > 0)
-		{
-			if (nindexes == 0)
-			{
-				/* Remove tuples from heap if the table has no index */
-				lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
-				vacuumed_pages++;
-				has_dead_tuples = false;
-			}
-			else
-			{
-				/*
-				 * Here, we have indexes but index cleanup is disabled.
-				 * Instead of vacuuming the dead tuples on the heap, we just
-				 * forget them.
-				 *
-				 * Note that vacrelstats->dead_tuples could have tuples which
-				 * became dead after HOT-pruning but are not marked dead yet.
-				 * We do not process them because it's a very rare condition,
-				 * and the next vacuum will process them anyway.
-				 */
-				Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
-			}
-
 			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
+			 * It's possible that another backend has extended the heap,
+			 * initialized the page, and then failed to WAL-log the page
+			 * due to an ERROR.  Since heap extension is not WAL-logged,
+			 * recovery might try to replay our record setting the page
+			 * all-visible and find that the page isn't initialized, which
+			 * will cause a PANIC.  To prevent that, check whether the
+			 * page has been previously WAL-logged, and if not, do that
+			 * now.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			if (RelationNeedsWAL(onerel) &&
+				PageGetLSN(page) == InvalidXLogRecPtr)
+				log_newpage_buffer(buf, true);
 
-			/*
-			 * Periodically do incremental FSM vacuuming to make newly-freed
-			 * space visible on upper FSM pages.  Note: although we've cleaned
-			 * the current block, we haven't yet updated its FSM entry (that
-			 * happens further down), so passing end == blkno is correct.
-			 */
-			if (blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
-			{
-				FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum,
-										blkno);
-				next_fsm_block_to_vacuum = blkno;
-			}
+			PageSetAllVisible(page);
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  *vmbuffer, InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+			END_CRIT_SECTION();
 		}
 
-		freespace = PageGetHeapFreeSpace(page);
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(onerel, blkno, freespace);
+		return true;
+	}
 
-		/* mark page all-visible, if appropriate */
-		if (all_visible && !all_visible_according_to_vm)
-		{
-			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+	/*
+	 * Prune all HOT-update chains in this page.
+	 *
+	 * We count tuples removed by the pruning step as removed by VACUUM.
+	 */
+	counts->tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
+											 &vacrelstats->latestRemovedXid);
+
+	/*
+	 * Now scan the page to collect vacuumable items and check for tuples
+	 * requiring freezing.
+	 *
+	 * A page holding WARM chains is never all-visible: an index-only scan
+	 * could return the stale key of an index entry leading to such a chain.
+	 */
+	all_visible = !PageHasWarm(page);
+	has_dead_tuples = false;
+	nfrozen = 0;
+	hastup = false;
+	prev_dead_count = vacrelstats->dead_tuples->num_tuples;
+	maxoff = PageGetMaxOffsetNumber(page);
 
-			if (all_frozen)
-				flags |= VISIBILITYMAP_ALL_FROZEN;
+	/*
+	 * Note: If you change anything in the loop below, also look at
+	 * heap_page_is_all_visible to see if that needs to be changed.
+	 */
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid;
 
-			/*
-			 * It should never be the case that the visibility map page is set
-			 * while the page-level bit is clear, but the reverse is allowed
-			 * (if checksums are not enabled).  Regardless, set the both bits
-			 * so that we get back in sync.
-			 *
-			 * NB: If the heap page is all-visible but the VM bit is not set,
-			 * we don't need to dirty the heap page.  However, if checksums
-			 * are enabled, we do need to make sure that the heap page is
-			 * dirtied before passing it to visibilitymap_set(), because it
-			 * may be logged.  Given that this situation should only happen in
-			 * rare cases after a crash, it is not worth optimizing.
-			 */
-			PageSetAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid, flags);
-		}
+		itemid = PageGetItemId(page, offnum);
 
-		/*
-		 * As of PostgreSQL 9.2, the visibility map bit should never be set if
-		 * the page-level bit is clear.  However, it's possible that the bit
-		 * got cleared after we checked it and before we took the buffer
-		 * content lock, so we must recheck before jumping to the conclusion
-		 * that something bad has happened.
-		 */
-		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
+		/* Unused items require no processing, but we count 'em */
+		if (!ItemIdIsUsed(itemid))
 		{
-			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
-				 relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
+			counts->nunused += 1;
+			continue;
 		}
 
-		/*
-		 * It's possible for the value returned by GetOldestXmin() to move
-		 * backwards, so it's not wrong for us to see tuples that appear to
-		 * not be visible to everyone yet, while PD_ALL_VISIBLE is already
-		 * set. The real safe xmin value never moves backwards, but
-		 * GetOldestXmin() is conservative and sometimes returns a value
-		 * that's unnecessarily small, so if we see that contradiction it just
-		 * means that the tuples that we think are not visible to everyone yet
-		 * actually are, and the PD_ALL_VISIBLE flag is correct.
-		 *
-		 * There should never be dead tuples on a page with PD_ALL_VISIBLE
-		 * set, however.
-		 */
-		else if (PageIsAllVisible(page) && has_dead_tuples)
+		/* Redirect items mustn't be touched */
+		if (ItemIdIsRedirected(itemid))
 		{
-			elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
-				 relname, blkno);
-			PageClearAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
+			hastup = true;	/* this page won't be truncatable */
+			continue;
 		}
 
+		ItemPointerSet(&(tuple.t_self), blkno, offnum);
+
 		/*
-		 * If the all-visible page is turned out to be all-frozen but not
-		 * marked, we should so mark it.  Note that all_frozen is only valid
-		 * if all_visible is true, so we must check both.
+		 * DEAD line pointers are to be vacuumed normally; but we don't
+		 * count them in tups_vacuumed, else we'd be double-counting (at
+		 * least in the common case where heap_page_prune() just freed up
+		 * a non-HOT tuple).
 		 */
-		else if (all_visible_according_to_vm && all_visible && all_frozen &&
-				 !VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+		if (ItemIdIsDead(itemid))
 		{
-			/*
-			 * We can pass InvalidTransactionId as the cutoff XID here,
-			 * because setting the all-frozen bit doesn't cause recovery
-			 * conflicts.
-			 */
-			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, InvalidTransactionId,
-							  VISIBILITYMAP_ALL_FROZEN);
+			lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+			all_visible = false;
+			continue;
 		}
 
-		UnlockReleaseBuffer(buf);
+		Assert(ItemIdIsNormal(itemid));
 
-		/* Remember the location of the last page with nonremovable tuples */
-		if (hastup)
-			vacrelstats->nonempty_pages = blkno + 1;
+		tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+		tuple.t_len = ItemIdGetLength(itemid);
+		tuple.t_tableOid = RelationGetRelid(onerel);
+
+		tupgone = false;
 
 		/*
-		 * If we remembered any tuples for deletion, then the page will be
-		 * visited again by lazy_vacuum_heap, which will compute and record
-		 * its post-compaction free space.  If not, then we're done with this
-		 * page, so remember its free space as-is.  (This path will always be
-		 * taken if there are no indexes.)
+		 * The criteria for counting a tuple as live in this block need to
+		 * match what analyze.c's acquire_sample_rows() does, otherwise
+		 * VACUUM and ANALYZE may produce wildly different reltuples
+		 * values, e.g. when there are many recently-dead tuples.
+		 *
+		 * The logic here is a bit simpler than acquire_sample_rows(), as
+		 * VACUUM can't run inside a transaction block, which makes some
+		 * cases impossible (e.g. in-progress insert from the same
+		 * transaction).
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
-			RecordPageWithFreeSpace(onerel, blkno, freespace);
-	}
+		switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
+		{
+			case HEAPTUPLE_DEAD:
 
-	/* report that everything is scanned and vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+				/*
+				 * Ordinarily, DEAD tuples would have been removed by
+				 * heap_page_prune(), but it's possible that the tuple
+				 * state changed since heap_page_prune() looked.  In
+				 * particular an INSERT_IN_PROGRESS tuple could have
+				 * changed to DEAD if the inserter aborted.  So this
+				 * cannot be considered an error condition.
+				 *
+				 * If the tuple is HOT-updated then it must only be
+				 * removed by a prune operation; so we keep it just as if
+				 * it were RECENTLY_DEAD.  Also, if it's a heap-only
+				 * tuple, we choose to keep it, because it'll be a lot
+				 * cheaper to get rid of it in the next pruning pass than
+				 * to treat it like an indexed tuple.  The same goes for a
+				 * tuple whose in-place update was rolled back, as pruning
+				 * redirects it to the row's saved version. Finally, if index
+				 * cleanup is disabled, the second heap pass will not
+				 * execute, and the tuple will not get removed, so we must
+				 * treat it like any other dead tuple that we choose to
+				 * keep.
+				 *
+				 * If this were to happen for a tuple that actually needed
+				 * to be deleted, we'd be in trouble, because it'd
+				 * possibly leave a tuple below the relation's xmin
+				 * horizon alive.  heap_prepare_freeze_tuple() is prepared
+				 * to detect that case and abort the transaction,
+				 * preventing corruption.
+				 */
+				if (HeapTupleIsHotUpdated(&tuple) ||
+					HeapTupleIsHeapOnly(&tuple) ||
+					OffsetNumberIsValid(heap_undo_next(page, offnum,
+													   tuple.t_data)) ||
+					params->index_cleanup == VACOPT_TERNARY_DISABLED)
+					counts->nkeep += 1;
+				else
+					tupgone = true; /* we can delete the tuple */
+				all_visible = false;
+				break;
+			case HEAPTUPLE_LIVE:
 
-	pfree(frozen);
+				/*
+				 * Count it as live.  Not only is this natural, but it's
+				 * also what acquire_sample_rows() does.
+				 */
+				counts->live_tuples += 1;
 
-	/* save stats for use later */
-	vacrelstats->tuples_deleted = tups_vacuumed;
-	vacrelstats->new_dead_tuples = nkeep;
+				/*
+				 * Is the tuple definitely visible to all transactions?
+				 *
+				 * NB: Like with per-tuple hint bits, we can't set the
+				 * PD_ALL_VISIBLE flag if the inserter committed
+				 * asynchronously. See SetHintBits for more info. Check
+				 * that the tuple is hinted xmin-committed because of
+				 * that.
+				 */
+				if (all_visible)
+				{
+					TransactionId xmin;
 
-	/* now we can compute the new value for pg_class.reltuples */
-	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
-														  nblocks,
-														  vacrelstats->tupcount_pages,
-														  live_tuples);
+					if (!HeapTupleHeaderXminCommitted(tuple.t_data))
+					{
+						all_visible = false;
+						break;
+					}
 
-	/* also compute total number of surviving heap entries */
-	vacrelstats->new_rel_tuples =
-		vacrelstats->new_live_tuples + vacrelstats->new_dead_tuples;
+					/*
+					 * The inserter definitely committed. But is it old
+					 * enough that everyone sees it as committed?
+					 */
+					xmin = HeapTupleHeaderGetXmin(tuple.t_data);
+					if (!TransactionIdPrecedes(xmin, OldestXmin))
+					{
+						all_visible = false;
+						break;
+					}
+
+					/* Track newest xmin on page. */
+					if (TransactionIdFollows(xmin, visibility_cutoff_xid))
+						visibility_cutoff_xid = xmin;
+				}
+				break;
+			case HEAPTUPLE_RECENTLY_DEAD:
+
+				/*
+				 * If tuple is recently deleted then we must not remove it
+				 * from relation.
+				 */
+				counts->nkeep += 1;
+				all_visible = false;
+				break;
+			case HEAPTUPLE_INSERT_IN_PROGRESS:
+
+				/*
+				 * This is an expected case during concurrent vacuum.
+				 *
+				 * We do not count these rows as live, because we expect
+				 * the inserting transaction to update the counters at
+				 * commit, and we assume that will happen only after we
+				 * report our results.  This assumption is a bit shaky,
+				 * but it is what acquire_sample_rows() does, so be
+				 * consistent.
+				 */
+				all_visible = false;
+				break;
+			case HEAPTUPLE_DELETE_IN_PROGRESS:
+				/* This is an expected case during concurrent vacuum */
+				all_visible = false;
+
+				/*
+				 * Count such rows as live.  As above, we assume the
+				 * deleting transaction will commit and update the
+				 * counters after we report.
+				 */
+				counts->live_tuples += 1;
+				break;
+			default:
+				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+				break;
+		}
+
+		if (tupgone)
+		{
+			lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+			HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
+												   &vacrelstats->latestRemovedXid);
+			counts->tups_vacuumed += 1;
+			has_dead_tuples = true;
+		}
+		else
+		{
+			bool		tuple_totally_frozen;
+
+			counts->num_tuples += 1;
+			hastup = true;
+
+			/*
+			 * Each non-removable tuple must be checked to see if it needs
+			 * freezing.  Note we already have exclusive buffer lock.
+			 */
+			if (heap_prepare_freeze_tuple(tuple.t_data,
+										  relfrozenxid, relminmxid,
+										  FreezeLimit, MultiXactCutoff,
+										  &frozen[nfrozen],
+										  &tuple_totally_frozen))
+				frozen[nfrozen++].offset = offnum;
+
+			if (!tuple_totally_frozen)
+				all_frozen = false;
+		}
+	}						/* scan along page */
 
 	/*
-	 * Release any remaining pin on visibility map page.
+	 * If we froze any tuples, mark the buffer dirty, and write a WAL
+	 * record recording the changes.  We must log the changes to be
+	 * crash-safe against future truncation of CLOG.
 	 */
-	if (BufferIsValid(vmbuffer))
+	if (nfrozen > 0)
 	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
+		START_CRIT_SECTION();
+
+		MarkBufferDirty(buf);
+
+		/* execute collected freezes */
+		for (i = 0; i < nfrozen; i++)
+		{
+			ItemId		itemid;
+			HeapTupleHeader htup;
+
+			itemid = PageGetItemId(page, frozen[i].offset);
+			htup = (HeapTupleHeader) PageGetItem(page, itemid);
+
+			heap_execute_freeze_tuple(htup, &frozen[i]);
+		}
+
+		/* Now WAL-log freezing if necessary */
+		if (RelationNeedsWAL(onerel))
+		{
+			XLogRecPtr	recptr;
+
+			recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+									 frozen, nfrozen);
+			PageSetLSN(page, recptr);
+		}
+
+		END_CRIT_SECTION();
 	}
 
-	/* If any tuples need to be deleted, perform final vacuum cycle */
-	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	/*
+	 * If there are no indexes we can vacuum the page right now instead of
+	 * doing a second scan. Also we don't do that but forget dead tuples
+	 * when index cleanup is disabled.
+	 */
+	if (!vacrelstats->useindex && vacrelstats->dead_tuples->num_tuples > 0)
 	{
-		const int	hvp_index[] = {
-			PROGRESS_VACUUM_PHASE,
-			PROGRESS_VACUUM_NUM_INDEX_VACUUMS
-		};
-		int64		hvp_val[2];
+		if (nindexes == 0)
+		{
+			/* Remove tuples from heap if the table has no index */
+			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, vmbuffer);
+			counts->vacuumed_pages++;
+			has_dead_tuples = false;
+		}
+		else
+		{
+			/*
+			 * Here, we have indexes but index cleanup is disabled.
+			 * Instead of vacuuming the dead tuples on the heap, we just
+			 * forget them.
+			 *
+			 * Note that vacrelstats->dead_tuples could have tuples which
+			 * became dead after HOT-pruning but are not marked dead yet.
+			 * We do not process them because it's a very rare condition,
+			 * and the next vacuum will process them anyway.
+			 */
+			Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
+		}
 
-		/* Log cleanup info before we touch indexes */
-		vacuum_log_cleanup_info(onerel, vacrelstats);
+		/*
+		 * Forget the now-vacuumed tuples, and press on, but be careful
+		 * not to reset latestRemovedXid since we want that value to be
+		 * valid.
+		 */
+		lazy_reset_dead_tuples(vacrelstats->dead_tuples);
 
-		/* Report that we are now vacuuming indexes */
-		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
+		/*
+		 * Periodically do incremental FSM vacuuming to make newly-freed
+		 * space visible on upper FSM pages.  Note: although we've cleaned
+		 * the current block, we haven't yet updated its FSM entry (that
+		 * happens further down), so passing end == blkno is correct.
+		 */
+		if (next_fsm_block_to_vacuum != NULL &&
+			blkno - *next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
+		{
+			FreeSpaceMapVacuumRange(onerel, *next_fsm_block_to_vacuum,
+									blkno);
+			*next_fsm_block_to_vacuum = blkno;
+		}
+	}
 
-		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+	freespace = PageGetHeapFreeSpace(page);
 
-		/* Report that we are now vacuuming the heap */
-		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
-		hvp_val[1] = vacrelstats->num_index_scans + 1;
-		pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
+	/* mark page all-visible, if appropriate */
+	if (all_visible && !all_visible_according_to_vm)
+	{
+		uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
 
-		/* Remove tuples from heap */
-		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-									 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
-		lazy_vacuum_heap(onerel, vacrelstats);
-		vacrelstats->num_index_scans++;
+		if (all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
+
+		/*
+		 * It should never be the case that the visibility map page is set
+		 * while the page-level bit is clear, but the reverse is allowed
+		 * (if checksums are not enabled).  Regardless, set the both bits
+		 * so that we get back in sync.
+		 *
+		 * NB: If the heap page is all-visible but the VM bit is not set,
+		 * we don't need to dirty the heap page.  However, if checksums
+		 * are enabled, we do need to make sure that the heap page is
+		 * dirtied before passing it to visibilitymap_set(), because it
+		 * may be logged.  Given that this situation should only happen in
+		 * rare cases after a crash, it is not worth optimizing.
+		 */
+		PageSetAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, visibility_cutoff_xid, flags);
 	}
 
 	/*
-	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
-	 * not there were indexes.
+	 * As of PostgreSQL 9.2, the visibility map bit should never be set if
+	 * the page-level bit is clear.  However, it's possible that the bit
+	 * got cleared after we checked it and before we took the buffer
+	 * content lock, so we must recheck before jumping to the conclusion
+	 * that something bad has happened.
 	 */
-	if (blkno > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
+	else if (all_visible_according_to_vm && !PageIsAllVisible(page)
+			 && VM_ALL_VISIBLE(onerel, blkno, vmbuffer))
+	{
+		elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
+			 relname, blkno);
+		visibilitymap_clear(onerel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
 
-	/* report all blocks vacuumed; and that we're cleaning up */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
-	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
+	/*
+	 * It's possible for the value returned by GetOldestXmin() to move
+	 * backwards, so it's not wrong for us to see tuples that appear to
+	 * not be visible to everyone yet, while PD_ALL_VISIBLE is already
+	 * set. The real safe xmin value never moves backwards, but
+	 * GetOldestXmin() is conservative and sometimes returns a value
+	 * that's unnecessarily small, so if we see that contradiction it just
+	 * means that the tuples that we think are not visible to everyone yet
+	 * actually are, and the PD_ALL_VISIBLE flag is correct.
+	 *
+	 * There should never be dead tuples on a page with PD_ALL_VISIBLE
+	 * set, however.
+	 */
+	else if (PageIsAllVisible(page) && has_dead_tuples)
+	{
+		elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
+			 relname, blkno);
+		PageClearAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_clear(onerel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
 
-	/* Do post-vacuum cleanup and statistics update for each index */
-	if (vacrelstats->useindex)
+	/*
+	 * If the all-visible page is turned out to be all-frozen but not
+	 * marked, we should so mark it.  Note that all_frozen is only valid
+	 * if all_visible is true, so we must check both.
+	 */
+	else if (all_visible_according_to_vm && all_visible && all_frozen &&
+			 !VM_ALL_FROZEN(onerel, blkno, vmbuffer))
 	{
-		for (i = 0; i < nindexes; i++)
-			lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
+		/*
+		 * We can pass InvalidTransactionId as the cutoff XID here,
+		 * because setting the all-frozen bit doesn't cause recovery
+		 * conflicts.
+		 */
+		visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, InvalidTransactionId,
+						  VISIBILITYMAP_ALL_FROZEN);
 	}
 
-	/* If no indexes, make log report that lazy_vacuum_heap would've made */
-	if (vacuumed_pages)
-		ereport(elevel,
-				(errmsg("\"%s\": removed %.0f row versions in %u pages",
-						RelationGetRelationName(onerel),
-						tups_vacuumed, vacuumed_pages)));
+	UnlockReleaseBuffer(buf);
+
+	/* Remember the location of the last page with nonremovable tuples */
+	if (hastup)
+		vacrelstats->nonempty_pages = blkno + 1;
 
 	/*
-	 * This is pretty messy, but we split it up so that we can skip emitting
-	 * individual parts of the message when not applicable.
+	 * If we remembered any tuples for deletion, then the page will be
+	 * visited again by lazy_vacuum_heap, which will compute and record
+	 * its post-compaction free space.  If not, then we're done with this
+	 * page, so remember its free space as-is.  (This path will always be
+	 * taken if there are no indexes.)
 	 */
-	initStringInfo(&buf);
-	appendStringInfo(&buf,
-					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
-					 nkeep, OldestXmin);
-	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
-					 nunused);
-	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
-									"Skipped %u pages due to buffer pins, ",
-									vacrelstats->pinskipped_pages),
-					 vacrelstats->pinskipped_pages);
-	appendStringInfo(&buf, ngettext("%u frozen page.\n",
-									"%u frozen pages.\n",
-									vacrelstats->frozenskipped_pages),
-					 vacrelstats->frozenskipped_pages);
-	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
-									"%u pages are entirely empty.\n",
-									empty_pages),
-					 empty_pages);
-	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+	if (vacrelstats->dead_tuples->num_tuples == prev_dead_count)
+		RecordPageWithFreeSpace(onerel, blkno, freespace);
 
-	ereport(elevel,
-			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
-					RelationGetRelationName(onerel),
-					tups_vacuumed, num_tuples,
-					vacrelstats->scanned_pages, nblocks),
-			 errdetail_internal("%s", buf.data)));
-	pfree(buf.data);
+	return true;
 }
 
+/*
+ * lazy_page_needs_new_multi - would freezing the page create a MultiXactId?
+ *
+ * Freezing a tuple whose xmax is a MultiXactId with members older than
+ * FreezeLimit replaces it with a new MultiXactId if some of the lockers are
+ * still running; see FreezeMultiXactId().  New MultiXactIds can't be created
+ * in parallel mode.  The answer errs on the side of true, since the caller
+ * holds a cleanup lock on the page but pruning hasn't happened yet.
+ */
+static bool
+lazy_page_needs_new_multi(Page page)
+{
+	OffsetNumber offnum,
+				maxoff;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleHeader tuple;
+		MultiXactId multi;
+		MultiXactMember *members;
+		int			nmembers;
+		bool		need_replace = false;
+		bool		has_lockers = false;
+		int			i;
+
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		tuple = (HeapTupleHeader) PageGetItem(page, itemid);
+		if ((tuple->t_infomask & HEAP_XMAX_IS_MULTI) == 0 ||
+			HEAP_LOCKED_UPGRADED(tuple->t_infomask))
+			continue;
+
+		multi = HeapTupleHeaderGetRawXmax(tuple);
+		if (!MultiXactIdIsValid(multi) ||
+			MultiXactIdPrecedes(multi, MultiXactCutoff))
+			continue;
+
+		nmembers = GetMultiXactIdMembers(multi, &members, false,
+										 HEAP_XMAX_IS_LOCKED_ONLY(tuple->t_infomask));
+		for (i = 0; i < nmembers; i++)
+		{
+			if (TransactionIdPrecedes(members[i].xid, FreezeLimit))
+				need_replace = true;
+			if (!ISUPDATE_from_mxstatus(members[i].status) &&
+				TransactionIdIsInProgress(members[i].xid))
+				has_lockers = true;
+		}
+		if (nmembers > 0)
+			pfree(members);
+
+		if (need_replace && has_lockers)
+			return true;
+	}
+
+	return false;
+}
 
 /*
  *	lazy_vacuum_heap() -- second pass over the heap
@@ -1509,16 +2028,22 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+	int			blkindex;
+	int			tupcount;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
+#ifdef USE_PREFETCH
+	int			prefetch_distance = lazy_prefetch_distance();
+	int			prefetch_index = 0;
+#endif
 
 	pg_rusage_init(&ru0);
 	npages = 0;
+	tupcount = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	for (blkindex = 0; blkindex < dt->nblocks; blkindex++)
 	{
 		BlockNumber tblk;
 		Buffer		buf;
@@ -1527,17 +2052,34 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
+		tblk = DeadTuplesBlock(dt, blkindex)->blkno;
+
+#ifdef USE_PREFETCH
+
+		/*
+		 * Keep the next prefetch_distance pages with dead tuples on their way
+		 * in.
+		 */
+		if (prefetch_index <= blkindex)
+			prefetch_index = blkindex + 1;
+		while (prefetch_index < dt->nblocks &&
+			   prefetch_index <= blkindex + prefetch_distance)
+		{
+			PrefetchBuffer(onerel, MAIN_FORKNUM,
+						   DeadTuplesBlock(dt, prefetch_index)->blkno);
+			prefetch_index++;
+		}
+#endif
+
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		tupcount += lazy_vacuum_page(onerel, tblk, buf, blkindex, vacrelstats,
+									 &vmbuffer);
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1557,47 +2099,98 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	ereport(elevel,
 			(errmsg("\"%s\": removed %d row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					tupcount, npages),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 }
 
+#ifdef USE_PREFETCH
+/*
+ *	lazy_prefetch_distance() -- how many pages ahead VACUUM should prefetch
+ */
+static int
+lazy_prefetch_distance(void)
+{
+	double		distance;
+
+	if (!ComputeIoConcurrency(maintenance_io_concurrency, &distance))
+		return 0;
+	return (int) rint(distance);
+}
+
+/*
+ *	lazy_prefetch_heap() -- prefetch heap pages lazy_scan_heap will read soon
+ *
+ * Prefetch the pages from prefetch_blkno up to, but not including,
+ * stop_blkno, skipping those we'll probably skip reading according to the
+ * visibility map.  Pages up to blkno have already been dealt with.  Returns
+ * the block number to continue from on the next call.
+ *
+ * The visibility map test is only a guess (lazy_scan_heap reads short runs
+ * of skippable pages anyway), so we use our own VM buffer pin for it, to
+ * avoid disturbing the caller's.
+ */
+static BlockNumber
+lazy_prefetch_heap(Relation onerel, VacuumParams *params, bool aggressive,
+				   BlockNumber blkno, BlockNumber prefetch_blkno,
+				   BlockNumber stop_blkno, Buffer *vmbuffer)
+{
+	if (prefetch_blkno <= blkno)
+		prefetch_blkno = blkno + 1;
+
+	for (; prefetch_blkno < stop_blkno; prefetch_blkno++)
+	{
+		if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+		{
+			uint8		vmstatus;
+
+			vmstatus = visibilitymap_get_status(onerel, prefetch_blkno,
+												vmbuffer);
+			if (aggressive ? (vmstatus & VISIBILITYMAP_ALL_FROZEN) != 0 :
+				(vmstatus & VISIBILITYMAP_ALL_VISIBLE) != 0)
+				continue;
+		}
+
+		PrefetchBuffer(onerel, MAIN_FORKNUM, prefetch_blkno);
+	}
+
+	return prefetch_blkno;
+}
+#endif							/* USE_PREFETCH */
+
 /*
  *	lazy_vacuum_page() -- free dead tuples on a page
  *					 and repair its fragmentation.
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * blkindex is the index of the page's entry in vacrelstats->dead_tuples.
+ * The return value is the number of dead tuples freed.
  */
 static int
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 int blkindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
+	int			uncnt;
+	int			i;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
 
+	Assert(DeadTuplesBlock(vacrelstats->dead_tuples, blkindex)->blkno == blkno);
+
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
+	uncnt = lazy_get_dead_offsets(vacrelstats->dead_tuples, blkindex, unused);
+
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < uncnt; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, unused[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1659,7 +2252,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 							  *vmbuffer, visibility_cutoff_xid, flags);
 	}
 
-	return tupindex;
+	return uncnt;
 }
 
 /*
@@ -1745,72 +2338,1140 @@ lazy_vacuum_index(Relation indrel,
 	*stats = index_bulk_delete(&ivinfo, *stats,
 							   lazy_tid_reaped, (void *) vacrelstats);
 
-	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
-					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
-			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+	ereport(elevel,
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
+					RelationGetRelationName(indrel),
+					(double) vacrelstats->dead_tuples->num_tuples),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+}
+
+/*
+ *	lazy_cleanup_index() -- do post-vacuum cleanup for one index relation.
+ *
+ *		reltuples is the number of heap tuples to report to the index AM,
+ *		and estimated_count says whether that is only an estimate.  The
+ *		pg_class update is left to update_index_statistics(), since that
+ *		can't be done in a parallel worker.
+ */
+static void
+lazy_cleanup_index(Relation indrel,
+				   IndexBulkDeleteResult **stats,
+				   double reltuples, bool estimated_count)
+{
+	IndexVacuumInfo ivinfo;
+	PGRUsage	ru0;
+
+	pg_rusage_init(&ru0);
+
+	ivinfo.index = indrel;
+	ivinfo.analyze_only = false;
+	ivinfo.report_progress = false;
+	ivinfo.estimated_count = estimated_count;
+	ivinfo.message_level = elevel;
+	ivinfo.num_heap_tuples = reltuples;
+	ivinfo.strategy = vac_strategy;
+
+	*stats = index_vacuum_cleanup(&ivinfo, *stats);
+
+	if (!(*stats))
+		return;
+
+	ereport(elevel,
+			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
+					RelationGetRelationName(indrel),
+					(*stats)->num_index_tuples,
+					(*stats)->num_pages),
+			 errdetail("%.0f index row versions were removed.\n"
+					   "%u index pages have been deleted, %u are currently reusable.\n"
+					   "%s.",
+					   (*stats)->tuples_removed,
+					   (*stats)->pages_deleted, (*stats)->pages_free,
+					   pg_rusage_show(&ru0))));
+}
+
+/*
+ *	update_index_statistics() -- update pg_class for all indexes
+ *
+ *		Statistics are only updated if the index says the count is accurate.
+ *		This also releases the IndexBulkDeleteResults.
+ */
+static void
+update_index_statistics(Relation *Irel, IndexBulkDeleteResult **stats,
+						int nindexes)
+{
+	int			i;
+
+	Assert(!IsInParallelMode());
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (stats[i] == NULL)
+			continue;
+
+		if (!stats[i]->estimated_count)
+			vac_update_relstats(Irel[i],
+								stats[i]->num_pages,
+								stats[i]->num_index_tuples,
+								0,
+								false,
+								InvalidTransactionId,
+								InvalidMultiXactId,
+								false);
+		pfree(stats[i]);
+		stats[i] = NULL;
+	}
+}
+
+/*
+ *	lazy_vacuum_all_indexes() -- vacuum all indexes of the relation.
+ *
+ *		Uses parallel workers where possible, and falls back to vacuuming the
+ *		indexes one by one otherwise.
+ */
+static void
+lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
+						IndexBulkDeleteResult **stats,
+						LVRelStats *vacrelstats, int nindexes)
+{
+	int			i;
+
+	if (lazy_parallel_vacuum_indexes(onerel, Irel, stats, vacrelstats,
+									 nindexes, false))
+		return;
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &stats[i], vacrelstats);
+}
+
+/*
+ *	lazy_cleanup_all_indexes() -- do post-vacuum cleanup for all indexes.
+ */
+static void
+lazy_cleanup_all_indexes(Relation onerel, Relation *Irel,
+						 IndexBulkDeleteResult **stats,
+						 LVRelStats *vacrelstats, int nindexes)
+{
+	int			i;
+
+	if (lazy_parallel_vacuum_indexes(onerel, Irel, stats, vacrelstats,
+									 nindexes, true))
+		return;
+
+	/*
+	 * Now we can provide a better estimate of total number of surviving
+	 * tuples (we assume indexes are more interested in that than in the
+	 * number of nominally live tuples).
+	 */
+	for (i = 0; i < nindexes; i++)
+		lazy_cleanup_index(Irel[i], &stats[i],
+						   vacrelstats->new_rel_tuples,
+						   vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+}
+
+/*
+ * compute_parallel_vacuum_workers - decide how many workers to use for one
+ * index vacuum or cleanup pass
+ *
+ * Sets can_parallel[i] for each index that a worker may process in this pass.
+ * An index qualifies if its AM supports the phase and it's at least
+ * min_parallel_index_scan_size; smaller indexes aren't worth a worker.  The
+ * leader process takes one of the indexes itself, so we need one worker less
+ * than there are qualifying indexes.  The result is further limited by the
+ * PARALLEL option, if given, and by max_parallel_maintenance_workers.
+ */
+static int
+compute_parallel_vacuum_workers(Relation *Irel, int nindexes,
+								LVRelStats *vacrelstats, bool for_cleanup,
+								bool *can_parallel)
+{
+	int			nindexes_parallel = 0;
+	int			parallel_workers;
+	int			i;
+
+	/* Workers can't be launched from a standalone backend */
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		uint8		vacoptions = Irel[i]->rd_indam->amparallelvacuumoptions;
+
+		if (!for_cleanup)
+		{
+			if ((vacoptions & VACUUM_OPTION_PARALLEL_BULKDEL) == 0)
+				continue;
+		}
+		else if ((vacoptions & VACUUM_OPTION_PARALLEL_CLEANUP) == 0)
+		{
+			/* Conditional cleanup is cheap once bulk deletion has run */
+			if ((vacoptions & VACUUM_OPTION_PARALLEL_COND_CLEANUP) == 0 ||
+				vacrelstats->num_index_scans > 0)
+				continue;
+		}
+
+		if (RelationGetNumberOfBlocks(Irel[i]) <
+			(BlockNumber) min_parallel_index_scan_size)
+			continue;
+
+		can_parallel[i] = true;
+		nindexes_parallel++;
+	}
+
+	/* The leader process takes one index */
+	nindexes_parallel--;
+	if (nindexes_parallel <= 0)
+		return 0;
+
+	if (vacrelstats->nworkers > 0)
+		parallel_workers = Min(vacrelstats->nworkers, nindexes_parallel);
+	else
+		parallel_workers = nindexes_parallel;
+
+	return Min(parallel_workers, max_parallel_maintenance_workers);
+}
+
+/*
+ * lazy_parallel_vacuum_indexes - vacuum or clean up indexes in parallel
+ *
+ * Returns false, having done nothing, if parallel vacuum is disabled or no
+ * workers would be used for this pass; the caller then processes the indexes
+ * serially.
+ *
+ * The parallel context lives only for the duration of one pass, so that the
+ * heap scan itself doesn't run in parallel mode.  Index statistics of the
+ * indexes processed in the parallel loop travel through the DSM segment and
+ * are copied back into stats[] at the end.
+ */
+static bool
+lazy_parallel_vacuum_indexes(Relation onerel, Relation *Irel,
+							 IndexBulkDeleteResult **stats,
+							 LVRelStats *vacrelstats, int nindexes,
+							 bool for_cleanup)
+{
+	ParallelContext *pcxt;
+	LVShared   *lvshared;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	bool	   *can_parallel;
+	Size		est_shared;
+	Size		est_deadtuples = 0;
+	int			querylen = 0;
+	int			nworkers;
+	int			i;
+
+	if (vacrelstats->nworkers < 0)
+		return false;
+
+	can_parallel = (bool *) palloc0(sizeof(bool) * nindexes);
+	nworkers = compute_parallel_vacuum_workers(Irel, nindexes, vacrelstats,
+											   for_cleanup, can_parallel);
+	if (nworkers <= 0)
+	{
+		pfree(can_parallel);
+		return false;
+	}
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
+								 nworkers);
+
+	/* Estimate size for shared information -- PARALLEL_VACUUM_KEY_SHARED */
+	est_shared = add_size(offsetof(LVShared, indstats),
+						  mul_size(sizeof(LVSharedIndStats), nindexes));
+	shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate size for dead tuples -- PARALLEL_VACUUM_KEY_DEAD_TUPLES */
+	if (!for_cleanup)
+	{
+		est_deadtuples = lazy_dead_tuples_copy_size(vacrelstats->dead_tuples);
+		shm_toc_estimate_chunk(&pcxt->estimator, est_deadtuples);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	/* Estimate space for BufferUsage -- PARALLEL_VACUUM_KEY_BUFFER_USAGE */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Same for WalUsage -- PARALLEL_VACUUM_KEY_WAL_USAGE */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_VACUUM_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	InitializeParallelDSM(pcxt);
+
+	/* Store shared information */
+	lvshared = (LVShared *) shm_toc_allocate(pcxt->toc, est_shared);
+	MemSet(lvshared, 0, est_shared);
+	lvshared->relid = RelationGetRelid(onerel);
+	lvshared->elevel = elevel;
+	lvshared->for_cleanup = for_cleanup;
+	if (for_cleanup)
+	{
+		lvshared->reltuples = vacrelstats->new_rel_tuples;
+		lvshared->estimated_count =
+			(vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+	}
+	else
+	{
+		lvshared->reltuples = vacrelstats->old_live_tuples;
+		lvshared->estimated_count = true;
+	}
+	lvshared->maintenance_work_mem_worker =
+		Max(maintenance_work_mem / pcxt->nworkers, 1024);
+	pg_atomic_init_u32(&(lvshared->cost_balance), 0);
+	pg_atomic_init_u32(&(lvshared->active_nworkers), 0);
+	pg_atomic_init_u32(&(lvshared->idx), 0);
+	lvshared->nindexes = nindexes;
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *indstats = &(lvshared->indstats[i]);
+
+		indstats->parallel = can_parallel[i];
+		if (can_parallel[i] && stats[i] != NULL)
+		{
+			memcpy(&indstats->stats, stats[i], sizeof(IndexBulkDeleteResult));
+			indstats->updated = true;
+		}
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, lvshared);
+
+	/* Store the dead tuples */
+	if (!for_cleanup)
+	{
+		LVDeadTuples *dead_tuples;
+
+		dead_tuples = (LVDeadTuples *) shm_toc_allocate(pcxt->toc,
+														est_deadtuples);
+		lazy_copy_dead_tuples(dead_tuples, vacrelstats->dead_tuples);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES,
+					   dead_tuples);
+	}
+
+	/* Allocate space for each worker's BufferUsage; no need to initialize */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage),
+											 pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, buffer_usage);
+
+	/* Same for WalUsage */
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_QUERY_TEXT,
+					   sharedquery);
+	}
+
+	/*
+	 * Hand our cost balance over to the shared one, so that the delay
+	 * computed by vacuum_delay_point() covers all processes.
+	 */
+	if (VacuumCostActive)
+	{
+		pg_atomic_write_u32(&(lvshared->cost_balance), VacuumCostBalance);
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &(lvshared->cost_balance);
+		VacuumActiveNWorkers = &(lvshared->active_nworkers);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	if (for_cleanup)
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for index cleanup (planned: %d)",
+								 "launched %d parallel vacuum workers for index cleanup (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, nworkers)));
+	else
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for index vacuuming (planned: %d)",
+								 "launched %d parallel vacuum workers for index vacuuming (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, nworkers)));
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/*
+	 * Process the indexes that can't be processed by workers in this pass,
+	 * then join the workers.
+	 */
+	for (i = 0; i < nindexes; i++)
+	{
+		if (can_parallel[i])
+			continue;
+
+		if (for_cleanup)
+			lazy_cleanup_index(Irel[i], &stats[i], lvshared->reltuples,
+							   lvshared->estimated_count);
+		else
+			lazy_vacuum_index(Irel[i], &stats[i], vacrelstats);
+	}
+
+	parallel_vacuum_indexes(Irel, lvshared, vacrelstats);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/* Wait for all vacuum workers to finish */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	/* Take back the cost balance accumulated by everyone */
+	if (VacuumSharedCostBalance)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+
+	/* Copy the statistics of the parallel-processed indexes back */
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *indstats = &(lvshared->indstats[i]);
+
+		if (!can_parallel[i])
+			continue;
+
+		if (indstats->updated)
+		{
+			if (stats[i] == NULL)
+				stats[i] = (IndexBulkDeleteResult *)
+					palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(stats[i], &indstats->stats, sizeof(IndexBulkDeleteResult));
+		}
+		else if (stats[i] != NULL)
+		{
+			pfree(stats[i]);
+			stats[i] = NULL;
+		}
+	}
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	pfree(can_parallel);
+
+	return true;
+}
+
+/*
+ * parallel_vacuum_indexes - process indexes in the parallel loop
+ *
+ * Both the leader and the workers run this, grabbing the next index to
+ * process until all of them are done.  The results are stored in the DSM
+ * segment.
+ */
+static void
+parallel_vacuum_indexes(Relation *Irel, LVShared *lvshared,
+						LVRelStats *vacrelstats)
+{
+	for (;;)
+	{
+		int			idx;
+		LVSharedIndStats *indstats;
+		IndexBulkDeleteResult *stats;
+
+		idx = (int) pg_atomic_fetch_add_u32(&(lvshared->idx), 1);
+		if (idx >= lvshared->nindexes)
+			break;
+
+		indstats = &(lvshared->indstats[idx]);
+		if (!indstats->parallel)
+			continue;
+
+		stats = indstats->updated ? &indstats->stats : NULL;
+
+		if (lvshared->for_cleanup)
+			lazy_cleanup_index(Irel[idx], &stats, lvshared->reltuples,
+							   lvshared->estimated_count);
+		else
+			lazy_vacuum_index(Irel[idx], &stats, vacrelstats);
+
+		/*
+		 * The index AM may have returned a result in local memory; copy it
+		 * into the DSM segment.
+		 */
+		if (stats != NULL && stats != &indstats->stats)
+		{
+			memcpy(&indstats->stats, stats, sizeof(IndexBulkDeleteResult));
+			pfree(stats);
+		}
+		indstats->updated = (stats != NULL);
+	}
+}
+
+/*
+ * Perform work within a launched parallel process.
+ *
+ * Since parallel vacuum workers only process indexes, we don't need to
+ * compute any heap-related state beyond the dead tuple array.
+ */
+void
+parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
+{
+	Relation	onerel;
+	Relation   *indrels;
+	int			nindexes;
+	LVShared   *lvshared;
+	LVRelStats	vacrelstats;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	char	   *sharedquery;
+
+	lvshared = (LVShared *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_SHARED,
+										   false);
+	elevel = lvshared->elevel;
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/*
+	 * Open table.  The lock mode is the same as the leader process.  It's
+	 * okay because the lock mode does not conflict among the parallel
+	 * workers.
+	 */
+	onerel = table_open(lvshared->relid, ShareUpdateExclusiveLock);
+
+	/*
+	 * Open all indexes.  indrels are sorted in order by OID, which should be
+	 * matched to the leader's one.
+	 */
+	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &indrels);
+	Assert(nindexes == lvshared->nindexes);
+
+	/* Set up the part of LVRelStats that lazy_vacuum_index() looks at */
+	MemSet(&vacrelstats, 0, sizeof(LVRelStats));
+	vacrelstats.old_live_tuples = lvshared->reltuples;
+	if (!lvshared->for_cleanup)
+		vacrelstats.dead_tuples = (LVDeadTuples *)
+			shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES, false);
+
+	/* Set cost-based vacuum delay */
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	VacuumCostBalanceLocal = 0;
+	VacuumSharedCostBalance = &(lvshared->cost_balance);
+	VacuumActiveNWorkers = &(lvshared->active_nworkers);
+
+	if (lvshared->maintenance_work_mem_worker > 0)
+		maintenance_work_mem = lvshared->maintenance_work_mem_worker;
+
+	/* Set up vacuum access strategy */
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	if (VacuumCostActive)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/* Process indexes to perform vacuum/cleanup */
+	parallel_vacuum_indexes(indrels, lvshared, &vacrelstats);
+
+	if (VacuumCostActive)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/* Report buffer and WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	vac_close_indexes(nindexes, indrels, RowExclusiveLock);
+	table_close(onerel, ShareUpdateExclusiveLock);
+	FreeAccessStrategy(vac_strategy);
+}
+
+/*
+ * compute_parallel_heap_workers - decide how many workers to use for the
+ * heap scan
+ *
+ * As for a parallel sequential scan, tables smaller than
+ * min_parallel_table_scan_size are scanned serially, and the number of
+ * workers otherwise grows with the logarithm of the table size.  The PARALLEL
+ * option, if given, overrides that.  The result is limited by
+ * max_parallel_maintenance_workers.
+ */
+static int
+compute_parallel_heap_workers(BlockNumber nblocks, LVRelStats *vacrelstats)
+{
+	int			parallel_workers;
+
+	/* Workers can't be launched from a standalone backend */
+	if (vacrelstats->nworkers < 0 || !IsUnderPostmaster ||
+		max_parallel_maintenance_workers == 0)
+		return 0;
+
+	if (nblocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	if (vacrelstats->nworkers > 0)
+		parallel_workers = vacrelstats->nworkers;
+	else
+	{
+		uint64		threshold = Max(min_parallel_table_scan_size, 1);
+
+		parallel_workers = 1;
+		while ((uint64) nblocks >= threshold * 3)
+		{
+			parallel_workers++;
+			threshold *= 3;
+		}
+	}
+
+	return Min(parallel_workers, max_parallel_maintenance_workers);
+}
+
+/*
+ * lazy_parallel_scan_heap - scan the heap with parallel workers
+ *
+ * The scan proceeds in rounds.  In each round we enter parallel mode, and the
+ * leader and the workers take chunks of PARALLEL_VACUUM_HEAP_CHUNK blocks at
+ * a time and process them with lazy_scan_page(), each collecting dead tuple
+ * TIDs in its own store in the DSM segment.  A process stops when its store
+ * is full, and leaves the rest of its chunk to the leader.  Pages whose
+ * freezing would need a new MultiXactId, which can't be created in parallel
+ * mode, are left to the leader as well.
+ *
+ * After each round, the leader merges the stores into vacrelstats->dead_tuples,
+ * leaves parallel mode and processes the left-over pages itself.  If the
+ * store is more than half full and there are pages left to scan, it does an
+ * index and heap vacuuming pass before starting the next round.  As with
+ * parallel index vacuum, the parallel context lives only for one round.
+ *
+ * Since the chunk size equals SKIP_PAGES_THRESHOLD, a chunk is skipped if the
+ * visibility map allows skipping all of its pages.
+ */
+static void
+lazy_parallel_scan_heap(Relation onerel, VacuumParams *params,
+						LVRelStats *vacrelstats, Relation *Irel,
+						IndexBulkDeleteResult **indstats, int nindexes,
+						bool aggressive, int nworkers, LVScanCounts *counts)
+{
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	BlockNumber next_block = 0;
+	Size		budget = lazy_dead_tuples_budget(vacrelstats, nblocks);
+	Buffer		vmbuffer = InvalidBuffer;
+	xl_heap_freeze_tuple *frozen;
+
+	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+
+	while (next_block < nblocks)
+	{
+		ParallelContext *pcxt;
+		LVHeapShared *shared;
+		BufferUsage *buffer_usage;
+		WalUsage   *wal_usage;
+		char	   *stores;
+		LVDeadTuples **srcs;
+		LVDeadTuples *dt = vacrelstats->dead_tuples;
+		BlockNumber *leftover;
+		int			nleftover = 0;
+		Size		est_shared;
+		Size		space;
+		Size		store_size;
+		int			querylen = 0;
+		int			nprocs;
+		int			i;
+
+		EnterParallelMode();
+		pcxt = CreateParallelContext("postgres", "parallel_vacuum_heap_main",
+									 nworkers);
+		nprocs = pcxt->nworkers + 1;
+
+		/* Divide the free part of the memory budget among the processes */
+		space = budget - Min(budget, DeadTuplesUsedSpace(dt));
+		store_size = MAXALIGN(lazy_dead_tuples_size(space / nprocs, nblocks));
+
+		/* Estimate size for shared information -- KEY_HEAP_SHARED */
+		est_shared = add_size(offsetof(LVHeapShared, results),
+							  mul_size(sizeof(LVHeapScanResult), nprocs));
+		shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+		/* Estimate size for the dead tuple stores -- KEY_HEAP_DEAD_TUPLES */
+		shm_toc_estimate_chunk(&pcxt->estimator, mul_size(store_size, nprocs));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+		/* Estimate space for BufferUsage -- PARALLEL_VACUUM_KEY_BUFFER_USAGE */
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+		/* Same for WalUsage -- PARALLEL_VACUUM_KEY_WAL_USAGE */
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   mul_size(sizeof(WalUsage), pcxt->nworkers));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+		/* Finally, estimate PARALLEL_VACUUM_KEY_QUERY_TEXT space */
+		if (debug_query_string)
+		{
+			querylen = strlen(debug_query_string);
+			shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+			shm_toc_estimate_keys(&pcxt->estimator, 1);
+		}
+
+		InitializeParallelDSM(pcxt);
+
+		/* Store shared information */
+		shared = (LVHeapShared *) shm_toc_allocate(pcxt->toc, est_shared);
+		MemSet(shared, 0, est_shared);
+		shared->relid = RelationGetRelid(onerel);
+		shared->elevel = elevel;
+		shared->params = *params;
+		shared->aggressive = aggressive;
+		shared->OldestXmin = OldestXmin;
+		shared->FreezeLimit = FreezeLimit;
+		shared->MultiXactCutoff = MultiXactCutoff;
+		shared->nblocks = nblocks;
+		shared->useindex = vacrelstats->useindex;
+		shared->nindexes = nindexes;
+		pg_atomic_init_u32(&(shared->cost_balance), 0);
+		pg_atomic_init_u32(&(shared->active_nworkers), 0);
+		pg_atomic_init_u64(&(shared->nallocated), next_block);
+		shared->store_size = store_size;
+		shared->nprocs = nprocs;
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_HEAP_SHARED, shared);
+
+		/* Set up an empty dead tuple store for each process */
+		stores = shm_toc_allocate(pcxt->toc, mul_size(store_size, nprocs));
+		for (i = 0; i < nprocs; i++)
+			lazy_init_dead_tuples((LVDeadTuples *) (stores + i * store_size),
+								  space / nprocs, nblocks);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_HEAP_DEAD_TUPLES, stores);
+
+		/* Allocate space for each worker's BufferUsage; no need to initialize */
+		buffer_usage = shm_toc_allocate(pcxt->toc,
+										mul_size(sizeof(BufferUsage),
+												 pcxt->nworkers));
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE,
+					   buffer_usage);
+
+		/* Same for WalUsage */
+		wal_usage = shm_toc_allocate(pcxt->toc,
+									 mul_size(sizeof(WalUsage), pcxt->nworkers));
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_WAL_USAGE, wal_usage);
+
+		/* Store query string for workers */
+		if (debug_query_string)
+		{
+			char	   *sharedquery;
+
+			sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+			memcpy(sharedquery, debug_query_string, querylen + 1);
+			shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_QUERY_TEXT,
+						   sharedquery);
+		}
+
+		/* Share our cost balance, as for parallel index vacuum */
+		if (VacuumCostActive)
+		{
+			pg_atomic_write_u32(&(shared->cost_balance), VacuumCostBalance);
+			VacuumCostBalance = 0;
+			VacuumCostBalanceLocal = 0;
+			VacuumSharedCostBalance = &(shared->cost_balance);
+			VacuumActiveNWorkers = &(shared->active_nworkers);
+		}
+
+		LaunchParallelWorkers(pcxt);
+
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for heap scanning (planned: %d)",
+								 "launched %d parallel vacuum workers for heap scanning (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, nworkers)));
+
+		if (VacuumActiveNWorkers)
+			pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+		/* Join the scan */
+		lazy_parallel_scan_heap_blocks(onerel, shared, 0,
+									   (LVDeadTuples *) stores);
+
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+		/* Wait for all vacuum workers to finish */
+		WaitForParallelWorkersToFinish(pcxt);
+
+		/*
+		 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+		 * to finish, or we might get incomplete data.)
+		 */
+		for (i = 0; i < pcxt->nworkers_launched; i++)
+			InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+		/* Take back the cost balance accumulated by everyone */
+		if (VacuumSharedCostBalance)
+		{
+			VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+			VacuumCostBalanceLocal = 0;
+			VacuumSharedCostBalance = NULL;
+			VacuumActiveNWorkers = NULL;
+		}
+
+		/* Add up the results, and collect the pages left over */
+		leftover = (BlockNumber *)
+			palloc(sizeof(BlockNumber) * nprocs *
+				   (PARALLEL_VACUUM_HEAP_CHUNK + PARALLEL_VACUUM_MAX_DEFERRED));
+		for (i = 0; i < nprocs; i++)
+		{
+			LVHeapScanResult *result = &(shared->results[i]);
+			BlockNumber blkno;
+			int			j;
+
+			counts->empty_pages += result->counts.empty_pages;
+			counts->vacuumed_pages += result->counts.vacuumed_pages;
+			counts->num_tuples += result->counts.num_tuples;
+			counts->live_tuples += result->counts.live_tuples;
+			counts->tups_vacuumed += result->counts.tups_vacuumed;
+			counts->nkeep += result->counts.nkeep;
+			counts->nunused += result->counts.nunused;
+			vacrelstats->scanned_pages += result->scanned_pages;
+			vacrelstats->tupcount_pages += result->tupcount_pages;
+			vacrelstats->pinskipped_pages += result->pinskipped_pages;
+			vacrelstats->frozenskipped_pages += result->frozenskipped_pages;
+			vacrelstats->nonempty_pages = Max(vacrelstats->nonempty_pages,
+											  result->nonempty_pages);
+			if (TransactionIdFollows(result->latestRemovedXid,
+									 vacrelstats->latestRemovedXid))
+				vacrelstats->latestRemovedXid = result->latestRemovedXid;
+
+			for (j = 0; j < result->ndeferred; j++)
+				leftover[nleftover++] = result->deferred[j];
+			for (blkno = result->leftover_start; blkno < result->leftover_end;
+				 blkno++)
+				leftover[nleftover++] = blkno;
+		}
+
+		/* Merge the TIDs collected in this round into our store */
+		srcs = (LVDeadTuples **) palloc(sizeof(LVDeadTuples *) * (nprocs + 1));
+		srcs[0] = dt;
+		for (i = 0; i < nprocs; i++)
+			srcs[i + 1] = (LVDeadTuples *) (stores + i * store_size);
+		vacrelstats->dead_tuples = lazy_merge_dead_tuples(srcs, nprocs + 1,
+														  nblocks);
+		pfree(srcs);
+		pfree(dt);
+
+		next_block = Min(pg_atomic_read_u64(&(shared->nallocated)), nblocks);
+
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+
+		/*
+		 * Process the left-over pages.  Their TIDs go into a store of their
+		 * own, since they may precede TIDs we already have.
+		 */
+		if (nleftover > 0)
+		{
+			LVDeadTuples *merged[2];
+
+			qsort(leftover, nleftover, sizeof(BlockNumber), vac_cmp_blockno);
+
+			merged[0] = vacrelstats->dead_tuples;
+			merged[1] = lazy_alloc_dead_tuples((Size) nleftover *
+											   DEADBLOCK_MAX_SIZE, nblocks);
+			vacrelstats->dead_tuples = merged[1];
+
+			for (i = 0; i < nleftover; i++)
+			{
+				BlockNumber blkno = leftover[i];
+
+				vacuum_delay_point();
+
+				(void) lazy_scan_page(onerel, params, vacrelstats, nindexes,
+									  aggressive, blkno,
+									  VM_ALL_VISIBLE(onerel, blkno, &vmbuffer),
+									  &vmbuffer, frozen, counts, NULL);
+			}
+
+			vacrelstats->dead_tuples = lazy_merge_dead_tuples(merged, 2,
+															  nblocks);
+			pfree(merged[0]);
+			pfree(merged[1]);
+		}
+		pfree(leftover);
+
+		dt = vacrelstats->dead_tuples;
+		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+									 dt->num_tuples);
+		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+									 next_block);
+
+		/*
+		 * Do a cycle of vacuuming if the store has used up half of the
+		 * memory budget, which would leave the next round with little room.
+		 */
+		if (next_block < nblocks && dt->num_tuples > 0 &&
+			DeadTuplesUsedSpace(dt) > budget / 2)
+		{
+			if (BufferIsValid(vmbuffer))
+			{
+				ReleaseBuffer(vmbuffer);
+				vmbuffer = InvalidBuffer;
+			}
+
+			lazy_vacuum_indexes_and_heap(onerel, vacrelstats, Irel, indstats,
+										 nindexes);
+
+			/* Report that we are once again scanning the heap */
+			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+		}
+	}
+
+	pfree(frozen);
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
 }
 
 /*
- *	lazy_cleanup_index() -- do post-vacuum cleanup for one index relation.
+ * lazy_parallel_scan_heap_blocks - scan heap blocks in the parallel loop
+ *
+ * Both the leader and the workers run this, taking chunks of blocks until
+ * there are none left or they have to stop; see lazy_parallel_scan_heap().
+ * procno is 0 in the leader, and the worker number plus one in workers.  Dead
+ * tuple TIDs are collected in dt, and the statistics and the pages left over
+ * are reported in shared->results[procno].
  */
 static void
-lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
-				   LVRelStats *vacrelstats)
+lazy_parallel_scan_heap_blocks(Relation onerel, LVHeapShared *shared,
+							   int procno, LVDeadTuples *dt)
 {
-	IndexVacuumInfo ivinfo;
-	PGRUsage	ru0;
+	LVHeapScanResult *result = &(shared->results[procno]);
+	VacuumParams *params = &(shared->params);
+	bool		aggressive = shared->aggressive;
+	BlockNumber nblocks = shared->nblocks;
+	LVRelStats	relstats;
+	LVRelStats *vacrelstats = &relstats;
+	Buffer		vmbuffer = InvalidBuffer;
+	xl_heap_freeze_tuple *frozen;
+	bool		done = false;
+#ifdef USE_PREFETCH
+	int			prefetch_distance = lazy_prefetch_distance();
+#endif
+
+	/* Set up the part of LVRelStats that lazy_scan_page() looks at */
+	MemSet(&relstats, 0, sizeof(LVRelStats));
+	relstats.useindex = shared->useindex;
+	relstats.rel_pages = nblocks;
+	relstats.relfrozenxid = onerel->rd_rel->relfrozenxid;
+	relstats.relminmxid = onerel->rd_rel->relminmxid;
+	relstats.latestRemovedXid = InvalidTransactionId;
+	relstats.dead_tuples = dt;
 
-	pg_rusage_init(&ru0);
+	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
-	ivinfo.index = indrel;
-	ivinfo.analyze_only = false;
-	ivinfo.report_progress = false;
-	ivinfo.estimated_count = (vacrelstats->tupcount_pages < vacrelstats->rel_pages);
-	ivinfo.message_level = elevel;
+	while (!done)
+	{
+		BlockNumber chunk_start;
+		BlockNumber chunk_end;
+		BlockNumber blkno;
+
+		chunk_start = (BlockNumber)
+			Min(pg_atomic_fetch_add_u64(&(shared->nallocated),
+										PARALLEL_VACUUM_HEAP_CHUNK),
+				(uint64) nblocks);
+		if (chunk_start >= nblocks)
+			break;
+		chunk_end = Min(nblocks, chunk_start + PARALLEL_VACUUM_HEAP_CHUNK);
 
-	/*
-	 * Now we can provide a better estimate of total number of surviving
-	 * tuples (we assume indexes are more interested in that than in the
-	 * number of nominally live tuples).
-	 */
-	ivinfo.num_heap_tuples = vacrelstats->new_rel_tuples;
-	ivinfo.strategy = vac_strategy;
+		if (procno == 0)
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 chunk_start);
 
-	stats = index_vacuum_cleanup(&ivinfo, stats);
+		/*
+		 * Skip the whole chunk if the visibility map allows skipping all of
+		 * its pages, counting those known to be all-frozen; see the comments
+		 * in lazy_serial_scan_heap().
+		 */
+		if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+		{
+			BlockNumber nfrozen = 0;
 
-	if (!stats)
-		return;
+			for (blkno = chunk_start; blkno < chunk_end; blkno++)
+			{
+				uint8		vmstatus;
 
-	/*
-	 * Now update statistics in pg_class, but only if the index says the count
-	 * is accurate.
-	 */
-	if (!stats->estimated_count)
-		vac_update_relstats(indrel,
-							stats->num_pages,
-							stats->num_index_tuples,
-							0,
-							false,
-							InvalidTransactionId,
-							InvalidMultiXactId,
-							false);
+				vmstatus = visibilitymap_get_status(onerel, blkno, &vmbuffer);
+				if ((vmstatus & (aggressive ? VISIBILITYMAP_ALL_FROZEN :
+								 VISIBILITYMAP_ALL_VISIBLE)) == 0 ||
+					FORCE_CHECK_PAGE())
+					break;
+				if (vmstatus & VISIBILITYMAP_ALL_FROZEN)
+					nfrozen++;
+			}
 
-	ereport(elevel,
-			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
-					RelationGetRelationName(indrel),
-					stats->num_index_tuples,
-					stats->num_pages),
-			 errdetail("%.0f index row versions were removed.\n"
-					   "%u index pages have been deleted, %u are currently reusable.\n"
-					   "%s.",
-					   stats->tuples_removed,
-					   stats->pages_deleted, stats->pages_free,
-					   pg_rusage_show(&ru0))));
+			if (blkno == chunk_end)
+			{
+				result->frozenskipped_pages += nfrozen;
+				continue;
+			}
+		}
+
+#ifdef USE_PREFETCH
+
+		/*
+		 * We read all pages of the chunk, but the chunks a process gets are
+		 * not adjacent, so prefetch them rather than relying on OS
+		 * readahead.
+		 */
+		if (prefetch_distance > 0)
+		{
+			for (blkno = chunk_start;
+				 blkno < Min(chunk_end, chunk_start + prefetch_distance);
+				 blkno++)
+				PrefetchBuffer(onerel, MAIN_FORKNUM, blkno);
+		}
+#endif
+
+		for (blkno = chunk_start; blkno < chunk_end; blkno++)
+		{
+			vacuum_delay_point();
+
+#ifdef USE_PREFETCH
+			if (prefetch_distance > 0 && blkno + prefetch_distance < chunk_end)
+				PrefetchBuffer(onerel, MAIN_FORKNUM, blkno + prefetch_distance);
+#endif
+
+			/* If the store is full, leave the rest of the chunk to the leader */
+			if (DeadTuplesFreeSpace(dt) < DEADBLOCK_MAX_SIZE &&
+				dt->num_tuples > 0)
+			{
+				result->leftover_start = blkno;
+				result->leftover_end = chunk_end;
+				done = true;
+				break;
+			}
+
+			if (!lazy_scan_page(onerel, params, vacrelstats, shared->nindexes,
+								aggressive, blkno,
+								VM_ALL_VISIBLE(onerel, blkno, &vmbuffer),
+								&vmbuffer, frozen, &(result->counts), NULL))
+			{
+				result->deferred[result->ndeferred++] = blkno;
+				if (result->ndeferred >= PARALLEL_VACUUM_MAX_DEFERRED)
+				{
+					result->leftover_start = blkno + 1;
+					result->leftover_end = chunk_end;
+					done = true;
+					break;
+				}
+			}
+		}
+	}
+
+	result->scanned_pages = relstats.scanned_pages;
+	result->tupcount_pages = relstats.tupcount_pages;
+	result->pinskipped_pages = relstats.pinskipped_pages;
+	result->nonempty_pages = relstats.nonempty_pages;
+	result->latestRemovedXid = relstats.latestRemovedXid;
+
+	pfree(frozen);
 
-	pfree(stats);
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+}
+
+/*
+ * Perform work within a launched parallel process for the heap scan.
+ */
+void
+parallel_vacuum_heap_main(dsm_segment *seg, shm_toc *toc)
+{
+	Relation	onerel;
+	LVHeapShared *shared;
+	char	   *stores;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	char	   *sharedquery;
+	int			procno = ParallelWorkerNumber + 1;
+
+	shared = (LVHeapShared *) shm_toc_lookup(toc,
+											 PARALLEL_VACUUM_KEY_HEAP_SHARED,
+											 false);
+	elevel = shared->elevel;
+	OldestXmin = shared->OldestXmin;
+	FreezeLimit = shared->FreezeLimit;
+	MultiXactCutoff = shared->MultiXactCutoff;
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Open table, with the same lock mode as the leader process */
+	onerel = table_open(shared->relid, ShareUpdateExclusiveLock);
+
+	stores = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_HEAP_DEAD_TUPLES, false);
+
+	/* Set cost-based vacuum delay */
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	VacuumCostBalanceLocal = 0;
+	VacuumSharedCostBalance = &(shared->cost_balance);
+	VacuumActiveNWorkers = &(shared->active_nworkers);
+
+	/* Set up vacuum access strategy */
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	if (VacuumCostActive)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	lazy_parallel_scan_heap_blocks(onerel, shared, procno,
+								   (LVDeadTuples *) (stores +
+													 procno * shared->store_size));
+
+	if (VacuumCostActive)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/* Report buffer and WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	table_close(onerel, ShareUpdateExclusiveLock);
+	FreeAccessStrategy(vac_strategy);
 }
 
 /*
@@ -2126,105 +3787,481 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
-	long		maxtuples;
+	vacrelstats->dead_tuples =
+		lazy_alloc_dead_tuples(lazy_dead_tuples_budget(vacrelstats, relblocks),
+							   relblocks);
+}
+
+/*
+ * lazy_dead_tuples_budget - space to use for dead tuple TIDs
+ *
+ * Returns the space for the entries and data of the store, leaving room for
+ * the directory within the memory budget.
+ */
+static Size
+lazy_dead_tuples_budget(LVRelStats *vacrelstats, BlockNumber relblocks)
+{
+	Size		space;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
-	if (vacrelstats->useindex)
-	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+	if (!vacrelstats->useindex)
+		return 0;
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+	space = (Size) vac_work_mem * 1024;
+	space -= space / DEADTUPLES_DIR_FRACTION;
 
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
-	}
-	else
+	/* No point in room for more than every page full of dead tuples */
+	if ((double) relblocks * DEADBLOCK_MAX_SIZE < (double) space)
+		space = (Size) relblocks * DEADBLOCK_MAX_SIZE;
+
+	return space;
+}
+
+/*
+ * lazy_dead_tuples_layout - decide the directory and total size of a store
+ *
+ * space is the room wanted for entries and data; the directory comes on top
+ * of that.  Returns the size of area[].
+ */
+static Size
+lazy_dead_tuples_layout(Size space, BlockNumber relblocks,
+						int *dir_shift, uint32 *ndir)
+{
+	/* stay sane if small maintenance_work_mem */
+	space = Max(space, DEADBLOCK_MAX_SIZE);
+
+	/* Positions in the data area must leave room for DEADBLOCK_BITMAP */
+	space = Min(space, (Size) DEADBLOCK_BITMAP - 1);
+
+	/*
+	 * Use the smallest directory granularity that keeps the directory to a
+	 * small fraction of the space.
+	 */
+	*dir_shift = DEADTUPLES_MIN_DIR_SHIFT;
+	while (*dir_shift < 31 &&
+		   ((Size) (relblocks >> *dir_shift) + 1) * sizeof(uint32) >
+		   space / DEADTUPLES_DIR_FRACTION)
+		(*dir_shift)++;
+	*ndir = (relblocks >> *dir_shift) + 1;
+
+	return TYPEALIGN(sizeof(LVDeadBlock), space + *ndir * sizeof(uint32));
+}
+
+/*
+ * lazy_dead_tuples_size - memory needed for a store with the given space
+ */
+static Size
+lazy_dead_tuples_size(Size space, BlockNumber relblocks)
+{
+	int			dir_shift;
+	uint32		ndir;
+
+	return offsetof(LVDeadTuples, area) +
+		lazy_dead_tuples_layout(space, relblocks, &dir_shift, &ndir);
+}
+
+/*
+ * lazy_init_dead_tuples - set up an empty store in caller-provided memory
+ *
+ * dt must point to lazy_dead_tuples_size(space, relblocks) bytes.
+ */
+static void
+lazy_init_dead_tuples(LVDeadTuples *dt, Size space, BlockNumber relblocks)
+{
+	dt->area_size = (uint32) lazy_dead_tuples_layout(space, relblocks,
+													 &dt->dir_shift,
+													 &dt->ndir);
+	lazy_reset_dead_tuples(dt);
+}
+
+/*
+ * lazy_alloc_dead_tuples - allocate an empty store
+ */
+static LVDeadTuples *
+lazy_alloc_dead_tuples(Size space, BlockNumber relblocks)
+{
+	LVDeadTuples *dt;
+
+	dt = (LVDeadTuples *) palloc_extended(lazy_dead_tuples_size(space,
+																relblocks),
+										  MCXT_ALLOC_HUGE);
+	lazy_init_dead_tuples(dt, space, relblocks);
+
+	return dt;
+}
+
+/*
+ * lazy_max_dead_tuples - number of dead tuples that surely fit in space
+ *
+ * That is the number for the worst case of one dead tuple per page; many
+ * more fit when dead tuples are clustered on fewer pages.
+ */
+static int
+lazy_max_dead_tuples(Size space)
+{
+	space = Max(space, DEADBLOCK_MAX_SIZE);
+
+	return (int) Min(space / (sizeof(LVDeadBlock) + 1 + sizeof(OffsetNumber)),
+					 (Size) INT_MAX);
+}
+
+/*
+ * lazy_reset_dead_tuples - forget all dead tuples in the store
+ */
+static void
+lazy_reset_dead_tuples(LVDeadTuples *dt)
+{
+	dt->num_tuples = 0;
+	dt->nblocks = 0;
+	dt->ndir_used = 0;
+	dt->data_size = 0;
+}
+
+/*
+ * lazy_dead_tuples_copy_size - space needed by lazy_copy_dead_tuples
+ */
+static Size
+lazy_dead_tuples_copy_size(LVDeadTuples *dt)
+{
+	Size		size;
+
+	size = dt->ndir * sizeof(uint32) + dt->data_size;
+	size = TYPEALIGN(sizeof(LVDeadBlock), size);
+	size += dt->nblocks * sizeof(LVDeadBlock);
+
+	return offsetof(LVDeadTuples, area) + size;
+}
+
+/*
+ * lazy_copy_dead_tuples - copy the store, leaving out the free space
+ *
+ * The copy is only good for lookups; no more tuples can be added to it.
+ */
+static void
+lazy_copy_dead_tuples(LVDeadTuples *dst, LVDeadTuples *src)
+{
+	Size		entries_size = src->nblocks * sizeof(LVDeadBlock);
+
+	memcpy(dst, src, offsetof(LVDeadTuples, area));
+	dst->area_size = lazy_dead_tuples_copy_size(src) -
+		offsetof(LVDeadTuples, area);
+
+	memcpy(dst->area, src->area, src->ndir * sizeof(uint32) + src->data_size);
+	memcpy(dst->area + dst->area_size - entries_size,
+		   src->area + src->area_size - entries_size,
+		   entries_size);
+}
+
+/*
+ * lazy_merge_dead_tuples - combine several stores into a new one
+ *
+ * The sources must not have blocks in common.  The result has just enough
+ * room for their TIDs.
+ */
+static LVDeadTuples *
+lazy_merge_dead_tuples(LVDeadTuples **srcs, int nsrcs, BlockNumber relblocks)
+{
+	LVDeadTuples *dt;
+	int		   *pos;
+	Size		space = DEADBLOCK_MAX_SIZE;
+	int			i;
+
+	for (i = 0; i < nsrcs; i++)
+		space += srcs[i]->data_size +
+			(Size) srcs[i]->nblocks * (sizeof(LVDeadBlock) + 1);
+	dt = lazy_alloc_dead_tuples(space, relblocks);
+
+	pos = (int *) palloc0(sizeof(int) * nsrcs);
+	for (;;)
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		OffsetNumber offsets[MaxHeapTuplesPerPage];
+		BlockNumber blkno = InvalidBlockNumber;
+		int			src = -1;
+		int			noffsets;
+
+		/* Take the lowest block of any source next */
+		for (i = 0; i < nsrcs; i++)
+		{
+			if (pos[i] < srcs[i]->nblocks &&
+				(src < 0 || DeadTuplesBlock(srcs[i], pos[i])->blkno < blkno))
+			{
+				src = i;
+				blkno = DeadTuplesBlock(srcs[i], pos[i])->blkno;
+			}
+		}
+		if (src < 0)
+			break;
+
+		noffsets = lazy_get_dead_offsets(srcs[src], pos[src], offsets);
+		for (i = 0; i < noffsets; i++)
+			lazy_add_dead_tuple(dt, blkno, offsets[i]);
+		pos[src]++;
 	}
+	pfree(pos);
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	return dt;
 }
 
 /*
  * lazy_record_dead_tuple - remember one deletable tuple
+ *
+ * Tuples must be recorded in TID order.
  */
 static void
 lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr)
 {
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+
+	lazy_add_dead_tuple(dt, ItemPointerGetBlockNumber(itemptr),
+						ItemPointerGetOffsetNumber(itemptr));
+
 	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
+	 * During a parallel heap scan, each process only sees its own part of
+	 * the TIDs; the leader reports the total once they are merged.
 	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
-	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
+	if (!IsInParallelMode())
 		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 vacrelstats->num_dead_tuples);
+									 dt->num_tuples);
+}
+
+/*
+ * lazy_add_dead_tuple - add one TID to a store
+ *
+ * TIDs must be added in TID order.
+ */
+static void
+lazy_add_dead_tuple(LVDeadTuples *dt, BlockNumber blkno, OffsetNumber offnum)
+{
+	char	   *data = DeadTuplesData(dt);
+	LVDeadBlock *block;
+	uint32		start;
+	uint32		len;
+	uint32		bitmap_len;
+
+	Assert(offnum >= FirstOffsetNumber && offnum <= MaxHeapTuplesPerPage);
+
+	if (dt->nblocks == 0 || DeadTuplesBlock(dt, dt->nblocks - 1)->blkno != blkno)
+	{
+		uint32		dirslot = blkno >> dt->dir_shift;
+
+		Assert(dt->nblocks == 0 ||
+			   DeadTuplesBlock(dt, dt->nblocks - 1)->blkno < blkno);
+
+		/*
+		 * The store shouldn't overflow under normal behavior, but perhaps it
+		 * could if we are given a really small maintenance_work_mem. In that
+		 * case, just forget the last few tuples (we'll get 'em next time).
+		 * Blocks past the directory are treated likewise; the relation may
+		 * have been extended since we sized it.
+		 */
+		if (DeadTuplesFreeSpace(dt) < DEADBLOCK_MAX_SIZE || dirslot >= dt->ndir)
+			return;
+
+		/* Point the directory slots up to this block's at the new entry */
+		while (dt->ndir_used <= dirslot)
+			DeadTuplesDir(dt)[dt->ndir_used++] = dt->nblocks;
+
+		/* Keep offset arrays aligned */
+		if (dt->data_size % sizeof(OffsetNumber) != 0)
+			data[dt->data_size++] = 0;
+
+		block = DeadTuplesBlock(dt, dt->nblocks);
+		block->blkno = blkno;
+		block->start = dt->data_size;
+		dt->nblocks++;
+	}
+
+	block = DeadTuplesBlock(dt, dt->nblocks - 1);
+	start = block->start & ~DEADBLOCK_BITMAP;
+	len = dt->data_size - start;
+	bitmap_len = offnum / BITS_PER_BYTE + 1;
+
+	if (block->start & DEADBLOCK_BITMAP)
+	{
+		/* Extend the bitmap as needed, and set the bit */
+		if (bitmap_len > len)
+		{
+			memset(data + start + len, 0, bitmap_len - len);
+			dt->data_size = start + bitmap_len;
+		}
+		data[start + offnum / BITS_PER_BYTE] |= 1 << (offnum % BITS_PER_BYTE);
+	}
+	else if (len + sizeof(OffsetNumber) <= bitmap_len)
+	{
+		/* Append to the offset array */
+		((OffsetNumber *) (data + start))[len / sizeof(OffsetNumber)] = offnum;
+		dt->data_size += sizeof(OffsetNumber);
+	}
+	else
+	{
+		/* A bitmap is smaller from now on, so convert the array to one */
+		OffsetNumber offsets[MaxHeapTuplesPerPage];
+		int			noffsets = len / sizeof(OffsetNumber);
+		int			i;
+
+		memcpy(offsets, data + start, len);
+		memset(data + start, 0, bitmap_len);
+		for (i = 0; i < noffsets; i++)
+			data[start + offsets[i] / BITS_PER_BYTE] |=
+				1 << (offsets[i] % BITS_PER_BYTE);
+		data[start + offnum / BITS_PER_BYTE] |= 1 << (offnum % BITS_PER_BYTE);
+		dt->data_size = start + bitmap_len;
+		block->start |= DEADBLOCK_BITMAP;
+	}
+
+	dt->num_tuples++;
+}
+
+/*
+ * lazy_dead_block_data - locate the data of one entry of the store
+ *
+ * Returns the data and sets *len to its length.  *isbitmap says how the
+ * offsets are stored.  For an offset array, the length may include a
+ * trailing alignment byte.
+ */
+static inline char *
+lazy_dead_block_data(LVDeadTuples *dt, int blkindex, uint32 *len,
+					 bool *isbitmap)
+{
+	LVDeadBlock *block = DeadTuplesBlock(dt, blkindex);
+	uint32		start = block->start & ~DEADBLOCK_BITMAP;
+	uint32		end;
+
+	if (blkindex + 1 < dt->nblocks)
+		end = DeadTuplesBlock(dt, blkindex + 1)->start & ~DEADBLOCK_BITMAP;
+	else
+		end = dt->data_size;
+
+	*len = end - start;
+	*isbitmap = (block->start & DEADBLOCK_BITMAP) != 0;
+
+	return DeadTuplesData(dt) + start;
+}
+
+/*
+ * lazy_get_dead_offsets - get the dead offsets of one entry of the store
+ *
+ * offsets must have room for MaxHeapTuplesPerPage entries.  Returns the
+ * number of offsets, which are returned in ascending order.
+ */
+static int
+lazy_get_dead_offsets(LVDeadTuples *dt, int blkindex, OffsetNumber *offsets)
+{
+	char	   *data;
+	uint32		len;
+	bool		isbitmap;
+	int			n = 0;
+
+	data = lazy_dead_block_data(dt, blkindex, &len, &isbitmap);
+
+	if (isbitmap)
+	{
+		uint32		i;
+
+		for (i = 0; i < len; i++)
+		{
+			uint8		bits = (uint8) data[i];
+
+			while (bits != 0)
+			{
+				int			bit = pg_rightmost_one_pos32(bits);
+
+				offsets[n++] = i * BITS_PER_BYTE + bit;
+				bits &= bits - 1;
+			}
+		}
+	}
+	else
+	{
+		n = len / sizeof(OffsetNumber);
+		memcpy(offsets, data, n * sizeof(OffsetNumber));
 	}
+
+	return n;
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+	uint32		dirslot = blkno >> dt->dir_shift;
+	int			lo,
+				hi;
+
+	if (dirslot >= dt->ndir_used)
+		return false;
+
+	/* Binary search the entries of the blocks in this directory slot */
+	lo = DeadTuplesDir(dt)[dirslot];
+	if (dirslot + 1 < dt->ndir_used)
+		hi = DeadTuplesDir(dt)[dirslot + 1];
+	else
+		hi = dt->nblocks;
+
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+		BlockNumber midblk = DeadTuplesBlock(dt, mid)->blkno;
+
+		if (midblk < blkno)
+			lo = mid + 1;
+		else if (midblk > blkno)
+			hi = mid;
+		else
+		{
+			char	   *data;
+			uint32		len;
+			bool		isbitmap;
+
+			data = lazy_dead_block_data(dt, mid, &len, &isbitmap);
+			if (isbitmap)
+				return offnum / BITS_PER_BYTE < len &&
+					(data[offnum / BITS_PER_BYTE] &
+					 (1 << (offnum % BITS_PER_BYTE))) != 0;
+			else
+			{
+				OffsetNumber *offsets = (OffsetNumber *) data;
+				int			noffsets = len / sizeof(OffsetNumber);
+				int			i;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+				/* The array is short, so a linear search will do */
+				for (i = 0; i < noffsets && offsets[i] <= offnum; i++)
+				{
+					if (offsets[i] == offnum)
+						return true;
+				}
+				return false;
+			}
+		}
+	}
 
-	return (res != NULL);
+	return false;
 }
 
 /*
- * Comparator routines for use with qsort() and bsearch().
+ * Comparator routine for use with qsort() on BlockNumbers.
  */
 static int
-vac_cmp_itemptr(const void *left, const void *right)
+vac_cmp_blockno(const void *left, const void *right)
 {
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
-
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	BlockNumber lblk = *(const BlockNumber *) left;
+	BlockNumber rblk = *(const BlockNumber *) right;
 
 	if (lblk < rblk)
 		return -1;
 	if (lblk > rblk)
 		return 1;
-
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
-
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
-
 	return 0;
 }
 
@@ -2243,7 +4280,7 @@ heap_page_is_all_visible(Relation rel, Buffer buf,
 	BlockNumber blockno = BufferGetBlockNumber(buf);
 	OffsetNumber offnum,
 				maxoff;
-	bool		all_visible = true;
+	bool		all_visible = !PageHasWarm(page);	/* see lazy_scan_heap */
 
 	*visibility_cutoff_xid = InvalidTransactionId;
 	*all_frozen = true;
@@ -49,12 +49,14 @@
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xlog.h"
+#include "catalog/catalog.h"
 #include "catalog/index.h"
 #include "catalog/pg_type.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
 #include "utils/snapmgr.h"
 
 
@@ -101,6 +103,7 @@ do { \
 static IndexScanDesc index_beginscan_internal(Relation indexRelation,
 											  int nkeys, int norderbys, Snapshot snapshot,
 											  ParallelIndexScanDesc pscan, bool temp_snap);
+static bool index_fetch_matches_keys(IndexScanDesc scan, TupleTableSlot *slot);
 
 
 /* ----------------------------------------------------------------
@@ -213,6 +216,11 @@ index_beginscan(Relation heapRelation,
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heapRelation);
 
+	/* we may need the index tuples to recheck WARM chains */
+	if (indexRelation->rd_indam->amcanwarm &&
+		!IsCatalogRelation(heapRelation))
+		scan->xs_want_itup = true;
+
 	return scan;
 }
 
@@ -495,6 +503,10 @@ index_beginscan_parallel(Relation heaprel, Relation indexrel, int nkeys,
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heaprel);
 
+	/* we may need the index tuples to recheck WARM chains */
+	if (indexrel->rd_indam->amcanwarm && !IsCatalogRelation(heaprel))
+		scan->xs_want_itup = true;
+
 	return scan;
 }
 
@@ -575,6 +587,15 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	if (found)
 		pgstat_count_heap_fetch(scan->indexRelation);
 
+	/*
+	 * If the tuple is in a WARM chain, we might have reached it through the
+	 * entry for another version's key.  Then it's not ours to return; the
+	 * entry for its own key returns it.
+	 */
+	if (found && scan->xs_heapfetch->recheck_keys &&
+		!index_fetch_matches_keys(scan, slot))
+		found = false;
+
 	/*
 	 * If we scanned a whole HOT chain and found only dead tuples, tell index
 	 * AM to kill its entry for that TID (this will take effect in the next
@@ -588,6 +609,50 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	return found;
 }
 
+/*
+ * index_fetch_matches_keys - does a fetched tuple match its index entry?
+ *
+ * Only indexes on plain columns, stored as the column's own type, can take
+ * WARM updates, and those must return the index tuple (see amcanwarm).  For
+ * any other index, all members of a chain match its entry.
+ */
+static bool
+index_fetch_matches_keys(IndexScanDesc scan, TupleTableSlot *slot)
+{
+	Relation	indexRelation = scan->indexRelation;
+	int			natts = IndexRelationGetNumberOfAttributes(indexRelation);
+	int			i;
+
+	if (scan->xs_itup == NULL)
+		return true;
+
+	for (i = 0; i < natts; i++)
+	{
+		AttrNumber	attnum = indexRelation->rd_index->indkey.values[i];
+		Form_pg_attribute att = TupleDescAttr(scan->xs_itupdesc, i);
+		Datum		indexval;
+		Datum		heapval;
+		bool		indexnull;
+		bool		heapnull;
+
+		if (attnum <= 0 ||
+			att->atttypid !=
+			TupleDescAttr(slot->tts_tupleDescriptor, attnum - 1)->atttypid)
+			return true;
+
+		indexval = index_getattr(scan->xs_itup, i + 1, scan->xs_itupdesc,
+								 &indexnull);
+		heapval = slot_getattr(slot, attnum, &heapnull);
+		if (indexnull != heapnull)
+			return false;
+		if (!indexnull &&
+			!datum_image_eq(indexval, heapval, att->attbyval, att->attlen))
+			return false;
+	}
+
+	return true;
+}
+
 /* ----------------
  *		index_getnext_slot - get the next tuple from a scan
  *
@@ -20,6 +20,10 @@
 #include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
+#include "catalog/catalog.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
 #include "commands/progress.h"
 #include "miscadmin.h"
 #include "utils/array.h"
@@ -46,6 +50,7 @@ static int	_bt_compare_array_elements(const void *a, const void *b, void *arg);
 static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 									 ScanKey leftarg, ScanKey rightarg,
 									 bool *result);
+static void _bt_skip_build_key(IndexScanDesc scan, ScanKey skey);
 static bool _bt_fix_scankey_strategy(ScanKey skey, int16 *indoption);
 static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
@@ -106,7 +111,14 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 	 */
 	key = palloc(offsetof(BTScanInsertData, scankeys) +
 				 sizeof(ScanKeyData) * indnkeyatts);
-	key->heapkeyspace = itup == NULL || _bt_heapkeyspace(rel);
+	if (itup)
+		_bt_metaversion(rel, &key->heapkeyspace, &key->allequalimage);
+	else
+	{
+		/* Utility statement callers can set these fields themselves */
+		key->heapkeyspace = true;
+		key->allequalimage = false;
+	}
 	key->anynullkeys = false;	/* initial assumption */
 	key->nextkey = false;
 	key->pivotsearch = false;
@@ -655,6 +667,224 @@ _bt_restore_array_keys(IndexScanDesc scan)
 	}
 }
 
+/*
+ * _bt_preprocess_skip() -- Decide whether a scan can be run as a skip scan
+ *
+ * This is called during btrescan, after the array keys have been set up.
+ * A skip scan is possible if there are no keys on the first index column
+ * but there is at least one key on the second column.  We don't try it for
+ * scans with array keys (which have their own way of running a series of
+ * primitive scans) nor for parallel scans.  If the scan qualifies, set
+ * skipState to BT_SKIP_INIT; _bt_first will then find the first prefix.
+ */
+void
+_bt_preprocess_skip(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	bool		found_second = false;
+	MemoryContext oldContext;
+	int			i;
+
+	so->skipState = BT_SKIP_NONE;
+	so->markSkipState = BT_SKIP_NONE;
+
+	if (scan->numberOfKeys < 1 ||
+		IndexRelationGetNumberOfKeyAttributes(rel) < 2 ||
+		scan->parallel_scan != NULL ||
+		so->numArrayKeys != 0)
+		return;
+
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		if (cur->sk_attno == 1)
+			return;
+		if (cur->sk_attno == 2)
+			found_second = true;
+	}
+	if (!found_second)
+		return;
+
+	/*
+	 * Set up the workspace on first use.  It's the same size on a rescan, so
+	 * we can just keep it after that.
+	 */
+	if (so->skipContext == NULL)
+	{
+		so->skipContext = AllocSetContextCreate(CurrentMemoryContext,
+												"BTree skip scan context",
+												ALLOCSET_SMALL_SIZES);
+		oldContext = MemoryContextSwitchTo(so->skipContext);
+		so->skipKeyData = (ScanKey)
+			palloc((scan->numberOfKeys + 1) * sizeof(ScanKeyData));
+		so->skipInsKey = _bt_mkscankey(rel, NULL);
+		_bt_metaversion(rel, &so->skipInsKey->heapkeyspace,
+						&so->skipInsKey->allequalimage);
+		so->skipInsKey->keysz = 1;
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	_bt_skip_set_prefix(scan, (Datum) 0, true);
+	so->skipLastBlock = InvalidBlockNumber;
+	so->skipSameBlock = 0;
+	so->skipState = BT_SKIP_INIT;
+}
+
+/*
+ * _bt_skip_set_prefix() -- Remember a new first-column value for a skip scan
+ *
+ * The value is copied into the scan's skip context, so it can come straight
+ * from an index page.  The caller must redo _bt_preprocess_keys before the
+ * new prefix is used to scan.
+ */
+void
+_bt_skip_set_prefix(IndexScanDesc scan, Datum prefix, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	MemoryContext oldContext;
+
+	if (!attr->attbyval && !so->skipPrefixNull)
+		pfree(DatumGetPointer(so->skipPrefix));
+
+	if (isnull)
+		so->skipPrefix = (Datum) 0;
+	else
+	{
+		oldContext = MemoryContextSwitchTo(so->skipContext);
+		so->skipPrefix = datumCopy(prefix, attr->attbyval, attr->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	so->skipPrefixNull = isnull;
+}
+
+/*
+ * _bt_mark_skip() -- Handle skip scan state during btmarkpos
+ */
+void
+_bt_mark_skip(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	MemoryContext oldContext;
+
+	if (!attr->attbyval && !so->markSkipPrefixNull)
+		pfree(DatumGetPointer(so->markSkipPrefix));
+
+	so->markSkipState = so->skipState;
+	so->markSkipDir = so->skipDir;
+	so->markSkipPrefixNull = so->skipPrefixNull;
+	if (so->skipPrefixNull)
+		so->markSkipPrefix = (Datum) 0;
+	else
+	{
+		oldContext = MemoryContextSwitchTo(so->skipContext);
+		so->markSkipPrefix = datumCopy(so->skipPrefix,
+									   attr->attbyval, attr->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+}
+
+/*
+ * _bt_restore_skip() -- Handle skip scan state during btrestrpos
+ *
+ * As for array keys, if the restored state differs from the current one we
+ * must redo _bt_preprocess_keys.
+ */
+void
+_bt_restore_skip(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+
+	if (so->skipState == so->markSkipState &&
+		so->skipDir == so->markSkipDir &&
+		so->skipPrefixNull == so->markSkipPrefixNull &&
+		(so->skipPrefixNull ||
+		 datumIsEqual(so->skipPrefix, so->markSkipPrefix,
+					  attr->attbyval, attr->attlen)))
+		return;
+
+	so->skipState = so->markSkipState;
+	so->skipDir = so->markSkipDir;
+	_bt_skip_set_prefix(scan, so->markSkipPrefix, so->markSkipPrefixNull);
+
+	if (so->skipState == BT_SKIP_ACTIVE || so->skipState == BT_SKIP_FALLBACK)
+	{
+		_bt_preprocess_keys(scan);
+		Assert(so->qual_ok);
+	}
+}
+
+/*
+ * _bt_skip_build_key() -- Build the first-column key for a skip scan
+ *
+ * In BT_SKIP_ACTIVE state this is "= prefix" (or "IS NULL"); in
+ * BT_SKIP_FALLBACK state it is ">= prefix" in terms of the direction of the
+ * fallback scan, so the plain scan covers the rest of the index from the
+ * start of the current prefix onwards.  The key is built in the same form
+ * as the caller's scan keys, so _bt_preprocess_keys can treat it like any
+ * other.
+ */
+static void
+_bt_skip_build_key(IndexScanDesc scan, ScanKey skey)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Oid			opfamily = rel->rd_opfamily[0];
+	Oid			opcintype = rel->rd_opcintype[0];
+	StrategyNumber strat;
+	Oid			cmp_op;
+	MemoryContext oldContext;
+
+	if (so->skipPrefixNull)
+	{
+		/* We never fall back to a plain scan at a NULL prefix */
+		Assert(so->skipState == BT_SKIP_ACTIVE);
+		ScanKeyEntryInitialize(skey,
+							   SK_ISNULL | SK_SEARCHNULL,
+							   1,
+							   InvalidStrategy,
+							   InvalidOid,
+							   InvalidOid,
+							   InvalidOid,
+							   (Datum) 0);
+		return;
+	}
+
+	if (so->skipState == BT_SKIP_ACTIVE)
+		strat = BTEqualStrategyNumber;
+	else
+	{
+		bool		forward = ScanDirectionIsForward(so->skipDir);
+
+		/* _bt_fix_scankey_strategy will commute this again for DESC */
+		if (rel->rd_indoption[0] & INDOPTION_DESC)
+			forward = !forward;
+		strat = forward ? BTGreaterEqualStrategyNumber :
+			BTLessEqualStrategyNumber;
+	}
+
+	cmp_op = get_opfamily_member(opfamily, opcintype, opcintype, strat);
+	if (!OidIsValid(cmp_op))
+		elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+			 strat, opcintype, opcintype, opfamily);
+
+	/* The FmgrInfo has to live as long as the scan keys do */
+	oldContext = MemoryContextSwitchTo(so->skipContext);
+	ScanKeyEntryInitialize(skey,
+						   0,
+						   1,
+						   strat,
+						   InvalidOid,
+						   rel->rd_indcollation[0],
+						   get_opcode(cmp_op),
+						   so->skipPrefix);
+	MemoryContextSwitchTo(oldContext);
+}
+
 
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
@@ -662,7 +892,8 @@ _bt_restore_array_keys(IndexScanDesc scan)
  * The given search-type keys (in scan->keyData[] or so->arrayKeyData[])
  * are copied to so->keyData[] with possible transformation.
  * scan->numberOfKeys is the number of input keys, so->numberOfKeys gets
- * the number of output keys (possibly less, never greater).
+ * the number of output keys (possibly less, never greater, except that a
+ * skip scan adds one key of its own; see _bt_preprocess_skip).
  *
  * The output keys are marked with additional sk_flag bits beyond the
  * system-standard bits supplied by the caller.  The DESC and NULLS_FIRST
@@ -772,6 +1003,20 @@ _bt_preprocess_keys(IndexScanDesc scan)
 	else
 		inkeys = scan->keyData;
 
+	/*
+	 * During a skip scan, add the key that restricts the first index column
+	 * to the current prefix.  It goes first since keys must be in attribute
+	 * order, and makes keys on the following columns required in the usual
+	 * way.
+	 */
+	if (so->skipState == BT_SKIP_ACTIVE || so->skipState == BT_SKIP_FALLBACK)
+	{
+		_bt_skip_build_key(scan, &so->skipKeyData[0]);
+		memcpy(&so->skipKeyData[1], inkeys, numberOfKeys * sizeof(ScanKeyData));
+		inkeys = so->skipKeyData;
+		numberOfKeys++;
+	}
+
 	outkeys = so->keyData;
 	cur = &inkeys[0];
 	/* we check that input keys are correctly ordered */
@@ -1786,16 +2031,61 @@ _bt_killitems(IndexScanDesc scan)
 		{
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
+			bool		killtuple = false;
+
+			if (BTreeTupleIsPosting(ituple))
+			{
+				int			pi = i + 1;
+				int			nposting = BTreeTupleGetNPosting(ituple);
+				int			j;
+
+				/*
+				 * A posting list tuple can only be marked dead once every one
+				 * of its heap TIDs is known dead.  We rely on the convention
+				 * that the heap TIDs of a posting list tuple appear in
+				 * ascending order in the scanpos items array (even during
+				 * backwards scans), so that consecutive killed items can be
+				 * matched against consecutive posting list entries.  Failing
+				 * to match just means that we don't kill the tuple, which is
+				 * always safe.
+				 *
+				 * Note that the page may have been modified in almost any way
+				 * since we first read it (when the pin was dropped), so it's
+				 * possible that this posting list tuple wasn't a posting list
+				 * tuple when we first encountered its heap TIDs.
+				 */
+				for (j = 0; j < nposting; j++)
+				{
+					ItemPointer item = BTreeTupleGetPostingN(ituple, j);
+
+					if (!ItemPointerEquals(item, &kitem->heapTid))
+						break;	/* out of posting list loop */
+
+					/*
+					 * Read ahead to later kitems.  Not advancing kitem when
+					 * there are none left makes the next posting list TID
+					 * fail to match, unless this was the final one.
+					 */
+					if (pi < numKilled)
+						kitem = &so->currPos.items[so->killedItems[pi++]];
+				}
+
+				if (j == nposting)
+					killtuple = true;
+			}
+			else if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+				killtuple = true;
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (killtuple)
 			{
 				/*
-				 * Found the item.  Mark it as dead, if it isn't already.
-				 * Since this happens while holding a buffer lock possibly in
-				 * shared mode, it's possible that multiple processes attempt
-				 * to do this simultaneously, leading to multiple full-page
-				 * images being sent to WAL (if wal_log_hints or data checksums
-				 * are enabled), which is undesirable.
+				 * Found the item (or all of the posting list's items).  Mark
+				 * it as dead, if it isn't already.  Since this happens while
+				 * holding a buffer lock possibly in shared mode, it's
+				 * possible that multiple processes attempt to do this
+				 * simultaneously, leading to multiple full-page images being
+				 * sent to WAL (if wal_log_hints or data checksums are
+				 * enabled), which is undesirable.
 				 */
 				if (!ItemIdIsDead(iid))
 				{
@@ -2131,13 +2421,15 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	int16		nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	int			keepnatts;
 	IndexTuple	pivot;
+	IndexTuple	tidpivot;
 	ItemPointer pivotheaptid;
 	Size		newsize;
 
 	/*
-	 * We should only ever truncate leaf index tuples.  It's never okay to
-	 * truncate a second time.
+	 * We should only ever truncate non-pivot tuples from leaf pages.  It's
+	 * never okay to truncate a second time.
 	 */
+	Assert(!BTreeTupleIsPivot(lastleft) && !BTreeTupleIsPivot(firstright));
 	Assert(BTreeTupleGetNAtts(lastleft, rel) == natts);
 	Assert(BTreeTupleGetNAtts(firstright, rel) == natts);
 
@@ -2149,67 +2441,62 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	keepnatts = nkeyatts + 1;
 #endif
 
-	if (keepnatts <= natts)
-	{
-		IndexTuple	tidpivot;
-
-		pivot = index_truncate_tuple(itupdesc, firstright,
-									 Min(keepnatts, nkeyatts));
+	pivot = index_truncate_tuple(itupdesc, firstright,
+								 Min(keepnatts, nkeyatts));
 
-		/*
-		 * If there is a distinguishing key attribute within new pivot tuple,
-		 * there is no need to add an explicit heap TID attribute
-		 */
-		if (keepnatts <= nkeyatts)
-		{
-			BTreeTupleSetNAtts(pivot, keepnatts);
-			return pivot;
-		}
-
-		/*
-		 * Only truncation of non-key attributes was possible, since key
-		 * attributes are all equal.  It's necessary to add a heap TID
-		 * attribute to the new pivot tuple.
-		 */
-		Assert(natts != nkeyatts);
-		newsize = IndexTupleSize(pivot) + MAXALIGN(sizeof(ItemPointerData));
-		tidpivot = palloc0(newsize);
-		memcpy(tidpivot, pivot, IndexTupleSize(pivot));
-		/* cannot leak memory here */
-		pfree(pivot);
-		pivot = tidpivot;
-	}
-	else
+	if (BTreeTupleIsPosting(pivot))
 	{
 		/*
-		 * No truncation was possible, since key attributes are all equal.
-		 * It's necessary to add a heap TID attribute to the new pivot tuple.
-		 *
-		 * This path is only taken when rel is not an INCLUDE index.  It
-		 * avoids a second palloc0() by avoiding the index_truncate_tuple()
-		 * call completely.
+		 * index_truncate_tuple() just returns a straight copy of firstright
+		 * when it has no attributes to truncate.  When that happens, we may
+		 * need to truncate away a posting list here instead.
 		 */
+		Assert(keepnatts == nkeyatts || keepnatts == nkeyatts + 1);
 		Assert(natts == nkeyatts);
-		newsize = IndexTupleSize(firstright) + MAXALIGN(sizeof(ItemPointerData));
-		pivot = palloc0(newsize);
-		memcpy(pivot, firstright, IndexTupleSize(firstright));
+		pivot->t_info &= ~INDEX_SIZE_MASK;
+		pivot->t_info |= MAXALIGN(BTreeTupleGetPostingOffset(firstright));
+	}
+
+	/*
+	 * If there is a distinguishing key attribute within pivot tuple, we're
+	 * done
+	 */
+	if (keepnatts <= nkeyatts)
+	{
+		/* Clear posting list status bits, if any, as well */
+		BTreeTupleSetNAtts(pivot, keepnatts);
+		return pivot;
 	}
 
 	/*
-	 * We have to use heap TID as a unique-ifier in the new pivot tuple, since
-	 * no non-TID key attribute in the right item readily distinguishes the
-	 * right side of the split from the left side.  Use enlarged space that
-	 * holds a copy of first right tuple; place a heap TID value within the
-	 * extra space that remains at the end.
+	 * We have to store a heap TID in the new pivot tuple, since no non-TID
+	 * key attribute value in firstright distinguishes the right side of the
+	 * split from the left side.  nbtree conceptualizes this case as an
+	 * inability to truncate away any key attributes, since heap TID is
+	 * treated as just another key attribute (despite lacking a pg_attribute
+	 * entry).
 	 *
-	 * nbtree conceptualizes this case as an inability to truncate away any
-	 * key attribute.  We must use an alternative representation of heap TID
-	 * within pivots because heap TID is only treated as an attribute within
-	 * nbtree (e.g., there is no pg_attribute entry).
+	 * Use enlarged space that holds a copy of pivot.  We need the extra space
+	 * to store a heap TID at the end (using the special pivot tuple
+	 * representation).  Note that the original pivot already has firstright's
+	 * possible posting list/non-key attribute values removed at this point.
 	 */
 	Assert(itup_key->heapkeyspace);
-	pivot->t_info &= ~INDEX_SIZE_MASK;
-	pivot->t_info |= newsize;
+	newsize = MAXALIGN(IndexTupleSize(pivot)) + MAXALIGN(sizeof(ItemPointerData));
+	tidpivot = palloc0(newsize);
+	memcpy(tidpivot, pivot, MAXALIGN(IndexTupleSize(pivot)));
+	/* cannot leak memory here */
+	pfree(pivot);
+
+	/*
+	 * Store all of firstright's key attribute values plus a tiebreaker heap
+	 * TID value in enlarged pivot tuple
+	 */
+	tidpivot->t_info &= ~INDEX_SIZE_MASK;
+	tidpivot->t_info |= newsize;
+	BTreeTupleSetNAtts(tidpivot, nkeyatts);
+	BTreeTupleSetAltHeapTID(tidpivot);
+	pivotheaptid = BTreeTupleGetHeapTID(tidpivot);
 
 	/*
 	 * Lehman & Yao use lastleft as the leaf high key in all cases, but don't
@@ -2218,9 +2505,7 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	 * TID.  (This is also the closest value to negative infinity that's
 	 * legally usable.)
 	 */
-	pivotheaptid = (ItemPointer) ((char *) pivot + newsize -
-								  sizeof(ItemPointerData));
-	ItemPointerCopy(&lastleft->t_tid, pivotheaptid);
+	ItemPointerCopy(BTreeTupleGetMaxHeapTID(lastleft), pivotheaptid);
 
 	/*
 	 * Lehman and Yao require that the downlink to the right page, which is to
@@ -2231,9 +2516,12 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	 * tiebreaker.
 	 */
 #ifndef DEBUG_NO_TRUNCATE
-	Assert(ItemPointerCompare(&lastleft->t_tid, &firstright->t_tid) < 0);
-	Assert(ItemPointerCompare(pivotheaptid, &lastleft->t_tid) >= 0);
-	Assert(ItemPointerCompare(pivotheaptid, &firstright->t_tid) < 0);
+	Assert(ItemPointerCompare(BTreeTupleGetMaxHeapTID(lastleft),
+							  BTreeTupleGetHeapTID(firstright)) < 0);
+	Assert(ItemPointerCompare(pivotheaptid,
+							  BTreeTupleGetHeapTID(lastleft)) >= 0);
+	Assert(ItemPointerCompare(pivotheaptid,
+							  BTreeTupleGetHeapTID(firstright)) < 0);
 #else
 
 	/*
@@ -2246,7 +2534,7 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	 * attribute values along with lastleft's heap TID value when lastleft's
 	 * TID happens to be greater than firstright's TID.
 	 */
-	ItemPointerCopy(&firstright->t_tid, pivotheaptid);
+	ItemPointerCopy(BTreeTupleGetHeapTID(firstright), pivotheaptid);
 
 	/*
 	 * Pivot heap TID should never be fully equal to firstright.  Note that
@@ -2255,13 +2543,11 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	 */
 	ItemPointerSetOffsetNumber(pivotheaptid,
 							   OffsetNumberPrev(ItemPointerGetOffsetNumber(pivotheaptid)));
-	Assert(ItemPointerCompare(pivotheaptid, &firstright->t_tid) < 0);
+	Assert(ItemPointerCompare(pivotheaptid,
+							  BTreeTupleGetHeapTID(firstright)) < 0);
 #endif
 
-	BTreeTupleSetNAtts(pivot, nkeyatts);
-	BTreeTupleSetAltHeapTID(pivot);
-
-	return pivot;
+	return tidpivot;
 }
 
 /*
@@ -2336,15 +2622,16 @@ _bt_keep_natts(Relation rel, IndexTuple lastleft, IndexTuple firstright,
  * The approach taken here usually provides the same answer as _bt_keep_natts
  * will (for the same pair of tuples from a heapkeyspace index), since the
  * majority of btree opclasses can never indicate that two datums are equal
- * unless they're bitwise equal (once detoasted).  Similarly, result may
- * differ from the _bt_keep_natts result when either tuple has TOASTed datums,
- * though this is barely possible in practice.
+ * unless they're bitwise equal after detoasting.  When an index only has
+ * "equal image" columns, routine is guaranteed to give the same result as
+ * _bt_keep_natts would.
  *
- * These issues must be acceptable to callers, typically because they're only
- * concerned about making suffix truncation as effective as possible without
- * leaving excessive amounts of free space on either side of page split.
  * Callers can rely on the fact that attributes considered equal here are
- * definitely also equal according to _bt_keep_natts.
+ * definitely also equal according to _bt_keep_natts, even when the index uses
+ * an opclass or collation that is not "allequalimage"/deduplication-safe.
+ * This weaker guarantee is good enough for nbtsplitloc.c caller, since false
+ * negatives generally only have the effect of making leaf page splits use a
+ * more balanced split point.
  */
 int
 _bt_keep_natts_fast(Relation rel, IndexTuple lastleft, IndexTuple firstright)
@@ -2370,7 +2657,7 @@ _bt_keep_natts_fast(Relation rel, IndexTuple lastleft, IndexTuple firstright)
 			break;
 
 		if (!isNull1 &&
-			!datumIsEqual(datum1, datum2, att->attbyval, att->attlen))
+			!datum_image_eq(datum1, datum2, att->attbyval, att->attlen))
 			break;
 
 		keepnatts++;
@@ -2427,17 +2714,21 @@ _bt_check_natts(Relation rel, bool heapkeyspace, Page page, OffsetNumber offnum)
 		if (offnum >= P_FIRSTDATAKEY(opaque))
 		{
 			/*
-			 * Non-pivot tuples currently never use alternative heap TID
-			 * representation -- even those within heapkeyspace indexes
+			 * Non-pivot tuple should never be explicitly marked as a pivot
+			 * tuple.  Only posting list tuples use the alternative
+			 * representation on the leaf level, and only in heapkeyspace
+			 * indexes.
 			 */
-			if ((itup->t_info & INDEX_ALT_TID_MASK) != 0)
+			if (BTreeTupleIsPivot(itup))
+				return false;
+			if (BTreeTupleIsPosting(itup) && !heapkeyspace)
 				return false;
 
 			/*
 			 * Leaf tuples that are not the page high key (non-pivot tuples)
 			 * should never be truncated.  (Note that tupnatts must have been
-			 * inferred, rather than coming from an explicit on-disk
-			 * representation.)
+			 * inferred, even with a posting list tuple, because only pivot
+			 * tuples store tupnatts directly.)
 			 */
 			return tupnatts == natts;
 		}
@@ -2512,7 +2803,7 @@ _bt_check_natts(Relation rel, bool heapkeyspace, Page page, OffsetNumber offnum)
 	 * heapkeyspace index pivot tuples, regardless of whether or not there are
 	 * non-key attributes.
 	 */
-	if ((itup->t_info & INDEX_ALT_TID_MASK) == 0)
+	if (!BTreeTupleIsPivot(itup))
 		return false;
 
 	/*
@@ -2590,3 +2881,110 @@ _bt_check_third_page(Relation rel, Relation heap, bool needheaptidspace,
 					 "or use full text indexing."),
 			 errtableconstraint(heap, RelationGetRelationName(rel))));
 }
+
+/*
+ * Are all attributes in rel "equality is image equality" attributes?
+ *
+ * Deduplication is only safe when any two datums that their opclass
+ * considers equal are also bitwise identical (after accounting for TOAST
+ * compression), since a posting list tuple only stores one representative
+ * key value for all of its heap TIDs.  There is no opclass support function
+ * that could vouch for this, so we rely on a list of built-in types whose
+ * default btree operator class is known to have the property.  Types such as
+ * numeric (display scale), float (-0 and +0) and bpchar/name (padding) are
+ * deliberately left out.  Collatable types must also use a deterministic
+ * collation, since nondeterministic collations treat distinct strings as
+ * equal.
+ *
+ * Returns true when it's safe to apply deduplication to rel, else false.
+ * Caller stashes the result in the metapage, so this only needs to be called
+ * when an index is built.
+ */
+bool
+_bt_allequalimage(Relation rel, bool debugmessage)
+{
+	bool		allequalimage = true;
+
+	/* INCLUDE indexes don't support deduplication */
+	if (IndexRelationGetNumberOfAttributes(rel) !=
+		IndexRelationGetNumberOfKeyAttributes(rel))
+		return false;
+
+	/*
+	 * There is no special reason why deduplication cannot work with system
+	 * relations (i.e. with system catalog indexes and TOAST indexes).  We
+	 * deem deduplication unsafe for these indexes all the same, since the
+	 * alternative is to force users to always use deduplication, without
+	 * being able to opt out.  (ALTER INDEX is not supported with system
+	 * indexes, so users would have no way to set the deduplicate_items
+	 * storage parameter to 'off'.)
+	 */
+	if (IsSystemRelation(rel))
+		return false;
+
+	for (int i = 0; i < IndexRelationGetNumberOfKeyAttributes(rel); i++)
+	{
+		Oid			opfamily = rel->rd_opfamily[i];
+		Oid			opcintype = rel->rd_opcintype[i];
+		Oid			collation = rel->rd_indcollation[i];
+		Oid			defopclass;
+
+		switch (opcintype)
+		{
+			case BOOLOID:
+			case CHAROID:
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case OIDOID:
+			case TEXTOID:
+			case BYTEAOID:
+			case DATEOID:
+			case TIMEOID:
+			case TIMETZOID:
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+			case UUIDOID:
+			case CASHOID:
+			case MACADDROID:
+			case MACADDR8OID:
+			case INETOID:
+			case LSNOID:
+				break;
+			default:
+				allequalimage = false;
+				break;
+		}
+
+		if (!allequalimage)
+			break;
+
+		/* Non-default opclasses may have their own idea of equality */
+		defopclass = GetDefaultOpClass(opcintype, BTREE_AM_OID);
+		if (!OidIsValid(defopclass) ||
+			get_opclass_family(defopclass) != opfamily)
+		{
+			allequalimage = false;
+			break;
+		}
+
+		if (OidIsValid(collation) &&
+			!get_collation_isdeterministic(collation))
+		{
+			allequalimage = false;
+			break;
+		}
+	}
+
+	if (debugmessage)
+	{
+		if (allequalimage)
+			elog(DEBUG1, "index \"%s\" can safely use deduplication",
+				 RelationGetRelationName(rel));
+		else
+			elog(DEBUG1, "index \"%s\" cannot use deduplication",
+				 RelationGetRelationName(rel));
+	}
+
+	return allequalimage;
+}
@@ -52,6 +52,8 @@ GetTableAmRoutine(Oid amhandler)
 	Assert(routine->scan_end != NULL);
 	Assert(routine->scan_rescan != NULL);
 	Assert(routine->scan_getnextslot != NULL);
+	Assert((routine->scan_set_tidrange == NULL) ==
+		   (routine->scan_getnextslot_tidrange == NULL));
 
 	Assert(routine->parallelscan_estimate != NULL);
 	Assert(routine->parallelscan_initialize != NULL);
@@ -14,6 +14,9 @@
 
 #include "postgres.h"
 
+#include "access/brin_internal.h"
+#include "access/gin_private.h"
+#include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/session.h"
@@ -23,6 +26,8 @@
 #include "catalog/index.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
+#include "commands/copy.h"
+#include "commands/vacuum.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -115,6 +120,9 @@ volatile bool ParallelMessagePending = false;
 /* Are we initializing a parallel worker? */
 bool		InitializingParallelWorker = false;
 
+/* May this parallel worker insert tuples?  See heap_prepare_insert. */
+bool		ParallelWorkerMayInsert = false;
+
 /* Pointer to our fixed parallel state. */
 static FixedParallelState *MyFixedParallelState;
 
@@ -140,6 +148,24 @@ static const struct
 	},
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
+	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
+	{
+		"_brin_parallel_build_main", _brin_parallel_build_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
+	},
+	{
+		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"parallel_vacuum_heap_main", parallel_vacuum_heap_main
+	},
+	{
+		"parallel_analyze_main", parallel_analyze_main
 	}
 };
 
@@ -0,0 +1,592 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallelredo.c
+ *		Replay of WAL records by background redo workers.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/parallelredo.c
+ *
+ * When max_parallel_redo_workers is set, the startup process hands some WAL
+ * records to a set of redo workers instead of replaying them itself.  A
+ * record is eligible only if every block it references belongs to a single
+ * relation, and it is of a kind whose redo routine touches nothing but the
+ * buffers of that relation: heap inserts, updates, deletes and locks, and
+ * btree insertions and page splits.  Eligible records are routed to a
+ * worker chosen by hashing the relation's RelFileNode, so that all changes
+ * to one relation are still replayed in WAL order by one process.
+ *
+ * Every other record acts as a barrier: before replaying it, the startup
+ * process waits for all the workers to finish replaying everything they
+ * have been given.  That covers records with several relations, records
+ * without block references (including commits, so that a hot standby query
+ * never sees a transaction as committed before its changes), and records
+ * whose replay may conflict with hot standby queries, which are handled by
+ * the startup process as before.
+ *
+ * Workers are started only once the standby has reached a consistent
+ * state, so that references to invalid pages are reported exactly as they
+ * are by the startup process.  Each worker has a shm_mq in the main shared
+ * memory segment, through which the startup process sends raw records; the
+ * worker decodes and replays them, and publishes the end LSN of the last
+ * record it has replayed.
+ *
+ * Redo workers don't take part in shared invalidation, so the startup
+ * process tells them to close all their SMgrRelations whenever it sends an
+ * smgr invalidation (for dropped or truncated relation files) by bumping a
+ * generation counter that travels with each record.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/parallelredo.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogrecord.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/memutils.h"
+
+/* Size of each worker's message queue. */
+#define PARALLEL_REDO_QUEUE_SIZE	(256 * 1024)
+
+/* GUCs */
+int			max_parallel_redo_workers = 0;
+
+typedef struct ParallelRedoWorkerSlot
+{
+	pg_atomic_uint64 applied;	/* end of last record replayed */
+	pg_atomic_uint64 wait_lsn;	/* wake the startup process on reaching
+								 * this, if valid */
+} ParallelRedoWorkerSlot;
+
+typedef struct ParallelRedoCtlData
+{
+	PGPROC	   *startup_proc;	/* process waiting for us */
+	ParallelRedoWorkerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedoCtlData;
+
+/* Header preceding each record sent to a worker. */
+typedef struct ParallelRedoMessage
+{
+	XLogRecPtr	ReadRecPtr;		/* start of record */
+	XLogRecPtr	EndRecPtr;		/* end+1 of record */
+	uint64		smgr_generation;	/* see ParallelRedoNoteSmgrInvalidation */
+} ParallelRedoMessage;
+
+static ParallelRedoCtlData *ParallelRedoCtl = NULL;
+
+/* Startup process state */
+static bool parallel_redo_started = false;
+static bool parallel_redo_failed = false;
+static shm_mq_handle **parallel_redo_queues;
+static BackgroundWorkerHandle **parallel_redo_handles;
+static XLogRecPtr *parallel_redo_last_sent;
+static uint64 smgr_generation = 0;
+
+static bool ParallelRedoStart(void);
+static void ParallelRedoWaitForWorker(int worker);
+static void ParallelRedoStartupExit(int code, Datum arg);
+static int	ParallelRedoRecordBlock(XLogReaderState *record);
+static void ParallelRedoWorkerExit(int code, Datum arg);
+static void parallel_redo_error_callback(void *arg);
+
+#define ParallelRedoQueue(i) \
+	((shm_mq *) ((char *) ParallelRedoCtl + \
+				 MAXALIGN(offsetof(ParallelRedoCtlData, slots) + \
+						  sizeof(ParallelRedoWorkerSlot) * \
+						  max_parallel_redo_workers) + \
+				 (Size) (i) * PARALLEL_REDO_QUEUE_SIZE))
+
+/*
+ * Report shared-memory space needed by ParallelRedoShmemInit
+ */
+Size
+ParallelRedoShmemSize(void)
+{
+	Size		size;
+
+	if (max_parallel_redo_workers == 0)
+		return 0;
+
+	size = MAXALIGN(add_size(offsetof(ParallelRedoCtlData, slots),
+							 mul_size(sizeof(ParallelRedoWorkerSlot),
+									  max_parallel_redo_workers)));
+	size = add_size(size, mul_size(PARALLEL_REDO_QUEUE_SIZE,
+								   max_parallel_redo_workers));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize shared memory for parallel redo
+ */
+void
+ParallelRedoShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	if (max_parallel_redo_workers == 0)
+		return;
+
+	ParallelRedoCtl = (ParallelRedoCtlData *)
+		ShmemInitStruct("Parallel Redo Data", ParallelRedoShmemSize(), &found);
+
+	if (!found)
+	{
+		ParallelRedoCtl->startup_proc = NULL;
+		for (i = 0; i < max_parallel_redo_workers; i++)
+		{
+			pg_atomic_init_u64(&ParallelRedoCtl->slots[i].applied,
+							   InvalidXLogRecPtr);
+			pg_atomic_init_u64(&ParallelRedoCtl->slots[i].wait_lsn,
+							   InvalidXLogRecPtr);
+		}
+	}
+}
+
+/*
+ * Launch the redo workers.  Returns false, after logging why, if that
+ * wasn't possible; the caller should then replay everything itself.
+ */
+static bool
+ParallelRedoStart(void)
+{
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	parallel_redo_queues = palloc0(sizeof(shm_mq_handle *) *
+								   max_parallel_redo_workers);
+	parallel_redo_handles = palloc0(sizeof(BackgroundWorkerHandle *) *
+									max_parallel_redo_workers);
+	parallel_redo_last_sent = palloc0(sizeof(XLogRecPtr) *
+									  max_parallel_redo_workers);
+	MemoryContextSwitchTo(oldcontext);
+
+	ParallelRedoCtl->startup_proc = MyProc;
+	on_shmem_exit(ParallelRedoStartupExit, (Datum) 0);
+
+	for (i = 0; i < max_parallel_redo_workers; i++)
+	{
+		BackgroundWorker worker;
+		shm_mq	   *mq;
+
+		memset(&worker, 0, sizeof(worker));
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+		sprintf(worker.bgw_library_name, "postgres");
+		sprintf(worker.bgw_function_name, "ParallelRedoWorkerMain");
+		snprintf(worker.bgw_name, BGW_MAXLEN, "parallel redo worker %d", i);
+		snprintf(worker.bgw_type, BGW_MAXLEN, "parallel redo worker");
+		worker.bgw_main_arg = Int32GetDatum(i);
+		worker.bgw_notify_pid = MyProcPid;
+
+		mq = shm_mq_create(ParallelRedoQueue(i), PARALLEL_REDO_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &parallel_redo_handles[i]))
+		{
+			MemoryContextSwitchTo(oldcontext);
+			ereport(LOG,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("could not start parallel redo workers, replaying WAL serially"),
+					 errhint("You might need to increase max_worker_processes.")));
+			ParallelRedoStartupExit(0, (Datum) 0);
+			return false;
+		}
+		parallel_redo_queues[i] = shm_mq_attach(mq, NULL,
+												parallel_redo_handles[i]);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	ereport(LOG,
+			(errmsg("started %d parallel redo workers",
+					max_parallel_redo_workers)));
+
+	return true;
+}
+
+/*
+ * Try to hand the current record to a redo worker.  Returns false if the
+ * record is not eligible, in which case the caller must call
+ * ParallelRedoSync() and then replay it itself.
+ */
+bool
+ParallelRedoDispatch(XLogReaderState *record)
+{
+	ParallelRedoMessage msg;
+	shm_mq_iovec iov[2];
+	RelFileNode *rnode;
+	shm_mq_result res;
+	int			block_id;
+	int			worker;
+
+	if (max_parallel_redo_workers == 0 || parallel_redo_failed)
+		return false;
+
+	/* Wait for a consistent state, see file header comment. */
+	if (!parallel_redo_started)
+	{
+		if (!reachedConsistency)
+			return false;
+		if (!ParallelRedoStart())
+		{
+			parallel_redo_failed = true;
+			return false;
+		}
+		parallel_redo_started = true;
+	}
+
+	block_id = ParallelRedoRecordBlock(record);
+	if (block_id < 0)
+		return false;
+
+	rnode = &record->blocks[block_id].rnode;
+	worker = (rnode->relNode ^ rnode->dbNode ^ rnode->spcNode) %
+		max_parallel_redo_workers;
+
+	msg.ReadRecPtr = record->ReadRecPtr;
+	msg.EndRecPtr = record->EndRecPtr;
+	msg.smgr_generation = smgr_generation;
+	iov[0].data = (char *) &msg;
+	iov[0].len = sizeof(msg);
+	iov[1].data = (char *) record->decoded_record;
+	iov[1].len = record->decoded_record->xl_tot_len;
+
+	res = shm_mq_sendv(parallel_redo_queues[worker], iov, 2, false, true);
+	if (res != SHM_MQ_SUCCESS)
+		ereport(FATAL,
+				(errmsg("parallel redo worker %d exited unexpectedly", worker)));
+
+	parallel_redo_last_sent[worker] = record->EndRecPtr;
+
+	return true;
+}
+
+/*
+ * Wait until the redo workers have replayed all the records dispatched to
+ * them so far.
+ */
+void
+ParallelRedoSync(void)
+{
+	int			i;
+
+	if (!parallel_redo_started)
+		return;
+
+	for (i = 0; i < max_parallel_redo_workers; i++)
+	{
+		if (pg_atomic_read_u64(&ParallelRedoCtl->slots[i].applied) <
+			parallel_redo_last_sent[i])
+			ParallelRedoWaitForWorker(i);
+	}
+}
+
+static void
+ParallelRedoWaitForWorker(int worker)
+{
+	ParallelRedoWorkerSlot *slot = &ParallelRedoCtl->slots[worker];
+	XLogRecPtr	target = parallel_redo_last_sent[worker];
+
+	pg_atomic_write_u64(&slot->wait_lsn, target);
+	pg_memory_barrier();
+
+	for (;;)
+	{
+		pid_t		pid;
+
+		if (pg_atomic_read_u64(&slot->applied) >= target)
+			break;
+
+		if (GetBackgroundWorkerPid(parallel_redo_handles[worker], &pid) ==
+			BGWH_STOPPED)
+			ereport(FATAL,
+					(errmsg("parallel redo worker %d exited unexpectedly",
+							worker)));
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 100L, WAIT_EVENT_PARALLEL_REDO_SYNC);
+		ResetLatch(MyLatch);
+
+		HandleStartupProcInterrupts();
+	}
+
+	pg_atomic_write_u64(&slot->wait_lsn, InvalidXLogRecPtr);
+}
+
+/*
+ * Wait for the redo workers to finish, and make them exit.  Called by the
+ * startup process at the end of redo.
+ */
+void
+ParallelRedoShutdown(void)
+{
+	if (!parallel_redo_started)
+		return;
+
+	ParallelRedoSync();
+	ParallelRedoStartupExit(0, (Datum) 0);
+	parallel_redo_started = false;
+}
+
+/*
+ * Detach from the workers' queues; that makes them exit once they have
+ * replayed whatever is left in them.
+ */
+static void
+ParallelRedoStartupExit(int code, Datum arg)
+{
+	int			i;
+
+	for (i = 0; i < max_parallel_redo_workers; i++)
+	{
+		if (parallel_redo_queues[i] != NULL)
+		{
+			shm_mq_detach(parallel_redo_queues[i]);
+			parallel_redo_queues[i] = NULL;
+		}
+	}
+}
+
+/*
+ * Note that SMgrRelations for some relation files must be closed, because
+ * the files have been unlinked or truncated.  Since the workers don't read
+ * the shared invalidation queue, they check this with every record.  Only
+ * the startup process's counter matters.
+ */
+void
+ParallelRedoNoteSmgrInvalidation(void)
+{
+	smgr_generation++;
+}
+
+/*
+ * Can this record be replayed by a redo worker?  If so, return the ID of a
+ * block reference identifying the one relation it touches, else -1.
+ */
+static int
+ParallelRedoRecordBlock(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	int			block_id;
+	int			first = -1;
+
+	/* The consistency check is done by the startup process. */
+	if ((XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) != 0)
+		return -1;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_HEAP_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_UPDATE:
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+				case XLOG_HEAP_INPLACE:
+					break;
+				default:
+					return -1;
+			}
+			break;
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+				case XLOG_HEAP2_LOCK_UPDATED:
+					break;
+				default:
+					/* pruning, freezing etc. may conflict with queries */
+					return -1;
+			}
+			break;
+		case RM_BTREE_ID:
+			switch (info)
+			{
+				case XLOG_BTREE_INSERT_LEAF:
+				case XLOG_BTREE_INSERT_UPPER:
+				case XLOG_BTREE_INSERT_META:
+				case XLOG_BTREE_INSERT_POST:
+				case XLOG_BTREE_SPLIT_L:
+				case XLOG_BTREE_SPLIT_R:
+				case XLOG_BTREE_NEWROOT:
+				case XLOG_BTREE_DEDUP:
+					break;
+				default:
+					return -1;
+			}
+			break;
+		default:
+			return -1;
+	}
+
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		if (!record->blocks[block_id].in_use)
+			continue;
+		if (first < 0)
+			first = block_id;
+		else if (!RelFileNodeEquals(record->blocks[first].rnode,
+									record->blocks[block_id].rnode))
+			return -1;
+	}
+
+	return first;
+}
+
+/*
+ * Main entry point for a redo worker.
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	int			worker = DatumGetInt32(main_arg);
+	ParallelRedoWorkerSlot *slot = &ParallelRedoCtl->slots[worker];
+	XLogReaderState *reader;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	MemoryContext redo_context;
+	uint64		my_smgr_generation = 0;
+
+	/*
+	 * Like the startup process, we must not stop in the middle of replaying
+	 * a record, so ignore SIGTERM.  We exit once the startup process
+	 * detaches from our queue, which it does when it exits.
+	 */
+	pqsignal(SIGTERM, SIG_IGN);
+	BackgroundWorkerUnblockSignals();
+
+	mq = ParallelRedoQueue(worker);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, NULL, NULL);
+	on_shmem_exit(ParallelRedoWorkerExit, PointerGetDatum(mqh));
+
+	/* We only start once the startup process has reached consistency. */
+	InRecovery = true;
+	reachedConsistency = true;
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL, NULL);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "parallel redo",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		ParallelRedoMessage *msg;
+		XLogRecord *record;
+		ErrorContextCallback errcallback;
+		MemoryContext oldcontext;
+		char	   *errormsg;
+		Size		nbytes;
+		void	   *data;
+		XLogRecPtr	wait_lsn;
+
+		if (shm_mq_receive(mqh, &nbytes, &data, false) != SHM_MQ_SUCCESS)
+			break;
+
+		if (nbytes < sizeof(ParallelRedoMessage) + SizeOfXLogRecord)
+			elog(ERROR, "invalid parallel redo message of size %zu", nbytes);
+		msg = (ParallelRedoMessage *) data;
+		record = (XLogRecord *) ((char *) data + sizeof(ParallelRedoMessage));
+
+		/* Close relation files that the startup process has invalidated. */
+		if (msg->smgr_generation != my_smgr_generation)
+		{
+			smgrcloseall();
+			my_smgr_generation = msg->smgr_generation;
+		}
+
+		reader->ReadRecPtr = msg->ReadRecPtr;
+		reader->EndRecPtr = msg->EndRecPtr;
+		if (!DecodeXLogRecord(reader, record, &errormsg))
+			elog(ERROR, "could not decode WAL record at %X/%X: %s",
+				 (uint32) (msg->ReadRecPtr >> 32), (uint32) msg->ReadRecPtr,
+				 errormsg);
+
+		/* Setup error traceback support for ereport() */
+		errcallback.callback = parallel_redo_error_callback;
+		errcallback.arg = (void *) reader;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		RmgrTable[record->xl_rmid].rm_redo(reader);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+
+		/* Let the startup process know, if it's waiting for us. */
+		pg_atomic_write_u64(&slot->applied, msg->EndRecPtr);
+		pg_memory_barrier();
+		wait_lsn = pg_atomic_read_u64(&slot->wait_lsn);
+		if (!XLogRecPtrIsInvalid(wait_lsn) && wait_lsn <= msg->EndRecPtr)
+			SetLatch(&ParallelRedoCtl->startup_proc->procLatch);
+	}
+
+	proc_exit(0);
+}
+
+static void
+ParallelRedoWorkerExit(int code, Datum arg)
+{
+	shm_mq_detach((shm_mq_handle *) DatumGetPointer(arg));
+}
+
+/*
+ * Error context callback for errors occurring during redo in a worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+	StringInfoData buf;
+	const char *id;
+
+	initStringInfo(&buf);
+	id = RmgrTable[XLogRecGetRmid(record)].rm_identify(XLogRecGetInfo(record));
+	if (id == NULL)
+		appendStringInfo(&buf, "UNKNOWN (%X): ",
+						 XLogRecGetInfo(record) & ~XLR_INFO_MASK);
+	else
+		appendStringInfo(&buf, "%s: ", id);
+	RmgrTable[XLogRecGetRmid(record)].rm_desc(&buf, record);
+
+	errcontext("WAL redo at %X/%X in parallel redo worker for %s",
+			   (uint32) (record->ReadRecPtr >> 32),
+			   (uint32) record->ReadRecPtr,
+			   buf.data);
+
+	pfree(buf.data);
+}
@@ -38,9 +38,12 @@
  *
  *		* On PREPARE TRANSACTION backend writes state data only to the WAL and
  *		  stores pointer to the start of the WAL record in
- *		  gxact->prepare_start_lsn.
- *		* If COMMIT occurs before checkpoint then backend reads data from WAL
- *		  using prepare_start_lsn.
+ *		  gxact->prepare_start_lsn.  If the state data is small enough, it
+ *		  also keeps a copy of it in the gxact's slot of shared memory.
+ *		* If the copy exists, COMMIT uses it, whether or not a checkpoint
+ *		  has happened in between.
+ *		* Otherwise, if COMMIT occurs before checkpoint then backend reads
+ *		  data from WAL using prepare_start_lsn.
  *		* On checkpoint state data copied to files in pg_twophase directory and
  *		  fsynced
  *		* If COMMIT happens after checkpoint then backend reads state data from
@@ -105,6 +108,7 @@
 #include "storage/sinvaladt.h"
 #include "storage/smgr.h"
 #include "utils/builtins.h"
+#include "utils/hashutils.h"
 #include "utils/memutils.h"
 #include "utils/timestamp.h"
 
@@ -170,9 +174,22 @@ typedef struct GlobalTransactionData
 	bool		valid;			/* true if PGPROC entry is in proc array */
 	bool		ondisk;			/* true if prepare state file is on disk */
 	bool		inredo;			/* true if entry was added via xlog_redo */
+
+	/*
+	 * Copy of the state data, if it fit in TWOPHASE_CACHED_STATE_SIZE bytes;
+	 * state_len is 0 if there's no copy.  This saves reading the data back
+	 * from WAL or the state file when finishing the transaction.
+	 */
+	char	   *state_data;
+	uint32		state_len;
+
+	uint32		gid_hash;		/* hash of gid, to speed up lookups */
 	char		gid[GIDSIZE];	/* The GID assigned to the prepared xact */
 }			GlobalTransactionData;
 
+/* Space for a copy of each gxact's state data in shared memory */
+#define TWOPHASE_CACHED_STATE_SIZE	4096
+
 /*
  * Two Phase Commit shared state.  Access to this struct is protected
  * by TwoPhaseStateLock.
@@ -219,6 +236,7 @@ static void RecordTransactionAbortPrepared(TransactionId xid,
 static void ProcessRecords(char *bufptr, TransactionId xid,
 						   const TwoPhaseCallback callbacks[]);
 static void RemoveGXact(GlobalTransaction gxact);
+static inline uint32 GXactGidHash(const char *gid);
 
 static void XlogReadTwoPhaseData(XLogRecPtr lsn, char **buf, int *len);
 static char *ProcessTwoPhaseBuffer(TransactionId xid,
@@ -230,6 +248,17 @@ static void MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid,
 static void RemoveTwoPhaseFile(TransactionId xid, bool giveWarning);
 static void RecreateTwoPhaseFile(TransactionId xid, void *content, int len);
 
+/*
+ * Hash a GID.  The gxact array is searched by GID while holding
+ * TwoPhaseStateLock exclusively, so with many prepared transactions it's
+ * worth comparing hashes before comparing the strings.
+ */
+static inline uint32
+GXactGidHash(const char *gid)
+{
+	return DatumGetUInt32(hash_any((const unsigned char *) gid, strlen(gid)));
+}
+
 /*
  * Initialization of shared memory
  */
@@ -245,6 +274,9 @@ TwoPhaseShmemSize(void)
 	size = MAXALIGN(size);
 	size = add_size(size, mul_size(max_prepared_xacts,
 								   sizeof(GlobalTransactionData)));
+	size = MAXALIGN(size);
+	size = add_size(size, mul_size(max_prepared_xacts,
+								   TWOPHASE_CACHED_STATE_SIZE));
 
 	return size;
 }
@@ -260,6 +292,7 @@ TwoPhaseShmemInit(void)
 	if (!IsUnderPostmaster)
 	{
 		GlobalTransaction gxacts;
+		char	   *state_data;
 		int			i;
 
 		Assert(!found);
@@ -273,6 +306,8 @@ TwoPhaseShmemInit(void)
 			((char *) TwoPhaseState +
 			 MAXALIGN(offsetof(TwoPhaseStateData, prepXacts) +
 					  sizeof(GlobalTransaction) * max_prepared_xacts));
+		state_data = (char *) gxacts +
+			MAXALIGN(sizeof(GlobalTransactionData) * max_prepared_xacts);
 		for (i = 0; i < max_prepared_xacts; i++)
 		{
 			/* insert into linked list */
@@ -295,6 +330,9 @@ TwoPhaseShmemInit(void)
 			 * technique.
 			 */
 			gxacts[i].dummyBackendId = MaxBackends + 1 + i;
+
+			gxacts[i].state_data = state_data + i * TWOPHASE_CACHED_STATE_SIZE;
+			gxacts[i].state_len = 0;
 		}
 	}
 	else
@@ -374,6 +412,7 @@ MarkAsPreparing(TransactionId xid, const char *gid,
 				TimestampTz prepared_at, Oid owner, Oid databaseid)
 {
 	GlobalTransaction gxact;
+	uint32		gid_hash;
 	int			i;
 
 	if (strlen(gid) >= GIDSIZE)
@@ -396,13 +435,15 @@ MarkAsPreparing(TransactionId xid, const char *gid,
 		twophaseExitRegistered = true;
 	}
 
+	gid_hash = GXactGidHash(gid);
+
 	LWLockAcquire(TwoPhaseStateLock, LW_EXCLUSIVE);
 
 	/* Check for conflicting GID */
 	for (i = 0; i < TwoPhaseState->numPrepXacts; i++)
 	{
 		gxact = TwoPhaseState->prepXacts[i];
-		if (strcmp(gxact->gid, gid) == 0)
+		if (gxact->gid_hash == gid_hash && strcmp(gxact->gid, gid) == 0)
 		{
 			ereport(ERROR,
 					(errcode(ERRCODE_DUPLICATE_OBJECT),
@@ -490,6 +531,8 @@ MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid, const char *gid,
 	gxact->locking_backend = MyBackendId;
 	gxact->valid = false;
 	gxact->inredo = false;
+	gxact->state_len = 0;
+	gxact->gid_hash = GXactGidHash(gid);
 	strcpy(gxact->gid, gid);
 
 	/*
@@ -514,10 +557,10 @@ GXactLoadSubxactData(GlobalTransaction gxact, int nsubxacts,
 	PGXACT	   *pgxact = &ProcGlobal->allPgXact[gxact->pgprocno];
 
 	/* We need no extra lock since the GXACT isn't valid yet */
-	if (nsubxacts > PGPROC_MAX_CACHED_SUBXIDS)
+	if (nsubxacts > max_cached_subxids)
 	{
 		pgxact->overflowed = true;
-		nsubxacts = PGPROC_MAX_CACHED_SUBXIDS;
+		nsubxacts = max_cached_subxids;
 	}
 	if (nsubxacts > 0)
 	{
@@ -558,6 +601,7 @@ MarkAsPrepared(GlobalTransaction gxact, bool lock_held)
 static GlobalTransaction
 LockGXact(const char *gid, Oid user)
 {
+	uint32		gid_hash = GXactGidHash(gid);
 	int			i;
 
 	/* on first call, register the exit hook */
@@ -577,7 +621,7 @@ LockGXact(const char *gid, Oid user)
 		/* Ignore not-yet-valid GIDs */
 		if (!gxact->valid)
 			continue;
-		if (strcmp(gxact->gid, gid) != 0)
+		if (gxact->gid_hash != gid_hash || strcmp(gxact->gid, gid) != 0)
 			continue;
 
 		/* Found it, but has someone else got it locked? */
@@ -1129,6 +1173,23 @@ EndPrepare(GlobalTransaction gxact)
 	 */
 	XLogEnsureRecordSpace(0, records.num_chunks);
 
+	/*
+	 * If the state data is small enough, also keep a copy of it in shared
+	 * memory, so that finishing the transaction needn't read it back.  Nobody
+	 * else looks at the gxact until MarkAsPrepared makes it valid.
+	 */
+	if (records.total_len <= TWOPHASE_CACHED_STATE_SIZE)
+	{
+		char	   *dest = gxact->state_data;
+
+		for (record = records.head; record != NULL; record = record->next)
+		{
+			memcpy(dest, record->data, record->len);
+			dest += record->len;
+		}
+		gxact->state_len = records.total_len;
+	}
+
 	START_CRIT_SECTION();
 
 	MyPgXact->delayChkpt = true;
@@ -1479,11 +1540,17 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	xid = pgxact->xid;
 
 	/*
-	 * Read and validate 2PC state data. State data will typically be stored
-	 * in WAL files if the LSN is after the last checkpoint record, or moved
-	 * to disk if for some reason they have lived for a long time.
+	 * Read and validate 2PC state data. Unless EndPrepare kept a copy in
+	 * shared memory, state data will typically be stored in WAL files if the
+	 * LSN is after the last checkpoint record, or moved to disk if for some
+	 * reason they have lived for a long time.
 	 */
-	if (gxact->ondisk)
+	if (gxact->state_len > 0)
+	{
+		buf = palloc(gxact->state_len);
+		memcpy(buf, gxact->state_data, gxact->state_len);
+	}
+	else if (gxact->ondisk)
 		buf = ReadTwoPhaseFile(xid, false);
 	else
 		XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, NULL);
@@ -1571,7 +1638,7 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	 * after we send the SI messages. See AtEOXact_Inval()
 	 */
 	if (hdr->initfileinval)
-		RelationCacheInitFilePreInvalidate();
+		RelationCacheInitFilePreInvalidate(true, true);
 	SendSharedInvalidMessages(invalmsgs, hdr->ninvalmsgs);
 	if (hdr->initfileinval)
 		RelationCacheInitFilePostInvalidate();
@@ -1790,12 +1857,18 @@ CheckPointTwoPhase(XLogRecPtr redo_horizon)
 			char	   *buf;
 			int			len;
 
-			XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, &len);
-			RecreateTwoPhaseFile(gxact->xid, buf, len);
+			if (gxact->state_len > 0)
+				RecreateTwoPhaseFile(gxact->xid, gxact->state_data,
+									 gxact->state_len);
+			else
+			{
+				XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, &len);
+				RecreateTwoPhaseFile(gxact->xid, buf, len);
+				pfree(buf);
+			}
 			gxact->ondisk = true;
 			gxact->prepare_start_lsn = InvalidXLogRecPtr;
 			gxact->prepare_end_lsn = InvalidXLogRecPtr;
-			pfree(buf);
 			serialized_xacts++;
 		}
 	}
@@ -2432,6 +2505,8 @@ PrepareRedoAdd(char *buf, XLogRecPtr start_lsn,
 	gxact->valid = false;
 	gxact->ondisk = XLogRecPtrIsInvalid(start_lsn);
 	gxact->inredo = true;		/* yes, added in redo */
+	gxact->state_len = 0;
+	gxact->gid_hash = GXactGidHash(gid);
 	strcpy(gxact->gid, gid);
 
 	/* And insert it into the active array */
@@ -224,7 +224,7 @@ GetNewTransactionId(bool isSubXact)
 	{
 		int			nxids = MyPgXact->nxids;
 
-		if (nxids < PGPROC_MAX_CACHED_SUBXIDS)
+		if (nxids < max_cached_subxids)
 		{
 			MyProc->subxids.xids[nxids] = xid;
 			pg_write_barrier();
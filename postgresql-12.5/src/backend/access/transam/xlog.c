@@ -25,6 +25,7 @@
 #include "access/clog.h"
 #include "access/commit_ts.h"
 #include "access/multixact.h"
+#include "access/parallelredo.h"
 #include "access/rewriteheap.h"
 #include "access/subtrans.h"
 #include "access/timeline.h"
@@ -34,12 +35,14 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "access/xloginsert.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
 #include "catalog/pg_control.h"
 #include "catalog/pg_database.h"
 #include "commands/tablespace.h"
+#include "executor/instrument.h"
 #include "common/controldata_utils.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -92,8 +95,9 @@ int			XLogArchiveMode = ARCHIVE_MODE_OFF;
 char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
+bool		atomicPageWrites = false;
 bool		wal_log_hints = false;
-bool		wal_compression = false;
+int			wal_compression = WAL_COMPRESSION_NONE;
 char	   *wal_consistency_checking_string = NULL;
 bool	   *wal_consistency_checking = NULL;
 bool		wal_init_zero = true;
@@ -112,11 +116,11 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Number of WAL insertion locks to use (wal_insert_locks). A higher value
+ * allows more insertions to happen concurrently, but adds some CPU overhead
+ * to flushing the WAL, which needs to iterate all the locks.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			XLOGinsertLocks = -1;
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -935,6 +939,7 @@ static void ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos,
 static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 							  XLogRecPtr *PrevPtr);
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
+static void XLogGroupFlush(XLogRecPtr upto);
 static char *GetXLogBuffer(XLogRecPtr ptr);
 static XLogRecPtr XLogBytePosToRecPtr(uint64 bytepos);
 static XLogRecPtr XLogBytePosToEndRecPtr(uint64 bytepos);
@@ -975,7 +980,8 @@ static void WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt);
 XLogRecPtr
 XLogInsertRecord(XLogRecData *rdata,
 				 XLogRecPtr fpw_lsn,
-				 uint8 flags)
+				 uint8 flags,
+				 int num_fpi)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	pg_crc32c	rdata_crc;
@@ -1012,8 +1018,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * To keep track of which insertions are still in-progress, each concurrent
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
-	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * has progressed. There is a fixed number of insertion locks, set by
+	 * wal_insert_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1230,6 +1236,14 @@ XLogInsertRecord(XLogRecData *rdata,
 	ProcLastRecPtr = StartPos;
 	XactLastRecEnd = EndPos;
 
+	/* Report WAL traffic to the instrumentation. */
+	if (inserted)
+	{
+		pgWalUsage.wal_bytes += rechdr->xl_tot_len;
+		pgWalUsage.wal_records++;
+		pgWalUsage.wal_fpi += num_fpi;
+	}
+
 	return EndPos;
 }
 
@@ -1635,7 +1649,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % XLOGinsertLocks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1653,7 +1667,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % XLOGinsertLocks;
 	}
 }
 
@@ -1671,7 +1685,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < XLOGinsertLocks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1697,7 +1711,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < XLOGinsertLocks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1725,8 +1739,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[XLOGinsertLocks - 1].l.lock,
+						&WALInsertLocks[XLOGinsertLocks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1793,7 +1807,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < XLOGinsertLocks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -1954,6 +1968,63 @@ GetXLogBuffer(XLogRecPtr ptr)
 	return cachedPos + ptr % XLOG_BLCKSZ;
 }
 
+/*
+ * Try to copy 'count' bytes of WAL starting at 'startptr' on timeline 'tli'
+ * from the WAL buffers into 'buf', to spare the caller reading them back
+ * from the WAL files.
+ *
+ * Returns the number of bytes copied, which is a prefix of the requested
+ * range: we stop at the first page that is no longer (or not yet) in the
+ * buffers, and the caller must read the rest from the files.  The caller is
+ * responsible for requesting only WAL that has already been flushed.
+ *
+ * No locks are taken.  A buffer can be recycled for a newer page while we're
+ * copying it, so we check xlblocks both before and after the copy, and
+ * AdvanceXLInsertBuffer() invalidates xlblocks before it starts to
+ * re-initialize a buffer.
+ */
+Size
+XLogReadFromBuffers(char *buf, XLogRecPtr startptr, Size count, TimeLineID tli)
+{
+	XLogRecPtr	ptr = startptr;
+	Size		nread = 0;
+
+	/* The buffers only hold WAL of the current timeline, outside recovery. */
+	if (RecoveryInProgress() || tli != XLogCtl->ThisTimeLineID)
+		return 0;
+
+	while (nread < count)
+	{
+		int			idx = XLogRecPtrToBufIdx(ptr);
+		XLogRecPtr	expectedEndPtr = ptr + (XLOG_BLCKSZ - ptr % XLOG_BLCKSZ);
+		XLogRecPtr	endptr;
+		Size		nbytes;
+
+		endptr = *((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]);
+		if (endptr != expectedEndPtr)
+			break;
+
+		/* Make sure we see the page contents as of the xlblocks check. */
+		pg_read_barrier();
+
+		nbytes = Min(count - nread, (Size) (expectedEndPtr - ptr));
+		memcpy(buf + nread,
+			   XLogCtl->pages + idx * (Size) XLOG_BLCKSZ + ptr % XLOG_BLCKSZ,
+			   nbytes);
+
+		/* If the buffer was recycled meanwhile, what we copied is garbage. */
+		pg_read_barrier();
+		endptr = *((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]);
+		if (endptr != expectedEndPtr)
+			break;
+
+		nread += nbytes;
+		ptr += nbytes;
+	}
+
+	return nread;
+}
+
 /*
  * Converts a "usable byte position" to XLogRecPtr. A usable byte position
  * is the position starting from the beginning of WAL, excluding all WAL
@@ -2181,6 +2252,14 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 
 		NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
 
+		/*
+		 * Mark the buffer as invalid before we start to overwrite it, so that
+		 * XLogReadFromBuffers() can't mistake a half-initialized page for the
+		 * old contents.
+		 */
+		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = InvalidXLogRecPtr;
+		pg_write_barrier();
+
 		/*
 		 * Be sure to re-zero the buffer so that bytes beyond what we've
 		 * written will look like zeroes and not valid XLOG records...
@@ -2792,6 +2871,168 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	LWLockRelease(ControlFileLock);
 }
 
+/*
+ * Get WAL up to 'upto' flushed, either by flushing it ourselves or by having
+ * another backend do it for us.
+ *
+ * Backends needing a flush push themselves onto a list of waiters.  The one
+ * that finds the list empty becomes the group leader: it acquires
+ * WALWriteLock, takes over everyone who has joined the list by then, flushes
+ * up to the furthest position any of them asked for, and wakes them up.
+ * Backends arriving while the leader holds the lock form the next group, so
+ * a flush in progress keeps gathering waiters for the next one, and nobody
+ * but the leaders ever contends for WALWriteLock.  This follows the pattern
+ * of ProcArrayGroupClearXid().
+ *
+ * The caller must already have waited for insertions up to 'upto' to finish,
+ * since that is unsafe while holding WALWriteLock.
+ */
+static void
+XLogGroupFlush(XLogRecPtr upto)
+{
+	PROC_HDR   *procglobal = ProcGlobal;
+	PGPROC	   *proc = MyProc;
+	uint32		nextidx;
+	uint32		wakeidx;
+	XLogRecPtr	target = upto;
+
+	/* We should definitely have a PGPROC to wait with */
+	Assert(proc != NULL);
+
+	proc->walFlushGroupMember = true;
+	proc->walFlushGroupLsn = upto;
+
+	/* Add ourselves to the list of processes needing a WAL flush. */
+	nextidx = pg_atomic_read_u32(&procglobal->walFlushGroupFirst);
+	while (true)
+	{
+		pg_atomic_write_u32(&proc->walFlushGroupNext, nextidx);
+
+		if (pg_atomic_compare_exchange_u32(&procglobal->walFlushGroupFirst,
+										   &nextidx,
+										   (uint32) proc->pgprocno))
+			break;
+	}
+
+	/*
+	 * If the list was not empty, the leader will flush our WAL.  It is
+	 * impossible to have followers without a leader because the first
+	 * process that has added itself to the list will always have nextidx as
+	 * INVALID_PGPROCNO.
+	 */
+	if (nextidx != INVALID_PGPROCNO)
+	{
+		int			extraWaits = 0;
+
+		/* Sleep until the leader has flushed our WAL. */
+		pgstat_report_wait_start(WAIT_EVENT_WAL_GROUP_FLUSH);
+		for (;;)
+		{
+			/* acts as a read barrier */
+			PGSemaphoreLock(proc->sem);
+			if (!proc->walFlushGroupMember)
+				break;
+			extraWaits++;
+		}
+		pgstat_report_wait_end();
+
+		Assert(pg_atomic_read_u32(&proc->walFlushGroupNext) == INVALID_PGPROCNO);
+
+		/* Fix semaphore count for any absorbed wakeups */
+		while (extraWaits-- > 0)
+			PGSemaphoreUnlock(proc->sem);
+		return;
+	}
+
+	/* We are the leader.  Acquire the lock on behalf of everyone. */
+	LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+
+	/*
+	 * Now that we've got the lock, clear the list of processes waiting for a
+	 * flush, saving a pointer to the head of the list.  Trying to pop
+	 * elements one at a time could lead to an ABA problem.
+	 */
+	nextidx = pg_atomic_exchange_u32(&procglobal->walFlushGroupFirst,
+									 INVALID_PGPROCNO);
+
+	/* Remember head of list so we can perform wakeups after dropping lock. */
+	wakeidx = nextidx;
+
+	/* Find the furthest position anyone in the group needs flushed. */
+	while (nextidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &procglobal->allProcs[nextidx];
+
+		if (member->walFlushGroupLsn > target)
+			target = member->walFlushGroupLsn;
+
+		nextidx = pg_atomic_read_u32(&member->walFlushGroupNext);
+	}
+
+	/* The previous leader may have flushed far enough already */
+	LogwrtResult = XLogCtl->LogwrtResult;
+	if (target > LogwrtResult.Flush)
+	{
+		XLogwrtRqst WriteRqst;
+
+		/*
+		 * Sleep before flush! By adding a delay here, we may give further
+		 * backends the opportunity to join the backlog of group commit
+		 * followers; this can significantly improve transaction throughput,
+		 * at the risk of increasing transaction latency.
+		 *
+		 * We do not sleep if enableFsync is not turned on, nor if there are
+		 * fewer than CommitSiblings other backends with active transactions.
+		 */
+		if (CommitDelay > 0 && enableFsync &&
+			MinimumActiveBackends(CommitSiblings))
+		{
+			pg_usleep(CommitDelay);
+
+			/*
+			 * Re-check how far we can now flush the WAL. It's generally not
+			 * safe to call WaitXLogInsertionsToFinish while holding
+			 * WALWriteLock, because an in-progress insertion might need to
+			 * also grab WALWriteLock to make progress. But we know that all
+			 * the insertions up to target have already finished, because
+			 * every group member waited for them before joining.  We're
+			 * only calling it again to allow target to be moved further
+			 * forward, not to actually wait for anyone.
+			 */
+			target = WaitXLogInsertionsToFinish(target);
+		}
+
+		/* try to write/flush later additions to XLOG as well */
+		WriteRqst.Write = target;
+		WriteRqst.Flush = target;
+
+		XLogWrite(WriteRqst, false);
+	}
+
+	LWLockRelease(WALWriteLock);
+
+	/*
+	 * Now that we've released the lock, go back and wake everybody up.  We
+	 * don't do this under the lock so as to keep lock hold times to a
+	 * minimum.
+	 */
+	while (wakeidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &procglobal->allProcs[wakeidx];
+
+		wakeidx = pg_atomic_read_u32(&member->walFlushGroupNext);
+		pg_atomic_write_u32(&member->walFlushGroupNext, INVALID_PGPROCNO);
+
+		/* ensure all previous writes are visible before follower continues. */
+		pg_write_barrier();
+
+		member->walFlushGroupMember = false;
+
+		if (member != MyProc)
+			PGSemaphoreUnlock(member->sem);
+	}
+}
+
 /*
  * Ensure that all XLOG data through the given position is flushed to disk.
  *
@@ -2802,7 +3043,6 @@ void
 XLogFlush(XLogRecPtr record)
 {
 	XLogRecPtr	WriteRqstPtr;
-	XLogwrtRqst WriteRqst;
 
 	/*
 	 * During REDO, we are reading not writing WAL.  Therefore, instead of
@@ -2842,25 +3082,18 @@ XLogFlush(XLogRecPtr record)
 	/* initialize to given target; may increase below */
 	WriteRqstPtr = record;
 
-	/*
-	 * Now wait until we get the write lock, or someone else does the flush
-	 * for us.
-	 */
-	for (;;)
+	/* read LogwrtResult and update local state */
+	SpinLockAcquire(&XLogCtl->info_lck);
+	if (WriteRqstPtr < XLogCtl->LogwrtRqst.Write)
+		WriteRqstPtr = XLogCtl->LogwrtRqst.Write;
+	LogwrtResult = XLogCtl->LogwrtResult;
+	SpinLockRelease(&XLogCtl->info_lck);
+
+	/* unless done already, get it flushed */
+	if (record > LogwrtResult.Flush)
 	{
 		XLogRecPtr	insertpos;
 
-		/* read LogwrtResult and update local state */
-		SpinLockAcquire(&XLogCtl->info_lck);
-		if (WriteRqstPtr < XLogCtl->LogwrtRqst.Write)
-			WriteRqstPtr = XLogCtl->LogwrtRqst.Write;
-		LogwrtResult = XLogCtl->LogwrtResult;
-		SpinLockRelease(&XLogCtl->info_lck);
-
-		/* done already? */
-		if (record <= LogwrtResult.Flush)
-			break;
-
 		/*
 		 * Before actually performing the write, wait for all in-flight
 		 * insertions to the pages we're about to write to finish.
@@ -2868,66 +3101,15 @@ XLogFlush(XLogRecPtr record)
 		insertpos = WaitXLogInsertionsToFinish(WriteRqstPtr);
 
 		/*
-		 * Try to get the write lock. If we can't get it immediately, wait
-		 * until it's released, and recheck if we still need to do the flush
-		 * or if the backend that held the lock did it for us already. This
-		 * helps to maintain a good rate of group committing when the system
-		 * is bottlenecked by the speed of fsyncing.
+		 * Join the group of backends waiting for a flush; the first one to
+		 * get there flushes the WAL for all of them.
 		 */
-		if (!LWLockAcquireOrWait(WALWriteLock, LW_EXCLUSIVE))
-		{
-			/*
-			 * The lock is now free, but we didn't acquire it yet. Before we
-			 * do, loop back to check if someone else flushed the record for
-			 * us already.
-			 */
-			continue;
-		}
+		XLogGroupFlush(insertpos);
 
-		/* Got the lock; recheck whether request is satisfied */
+		/* read the result of whoever did the flush */
+		SpinLockAcquire(&XLogCtl->info_lck);
 		LogwrtResult = XLogCtl->LogwrtResult;
-		if (record <= LogwrtResult.Flush)
-		{
-			LWLockRelease(WALWriteLock);
-			break;
-		}
-
-		/*
-		 * Sleep before flush! By adding a delay here, we may give further
-		 * backends the opportunity to join the backlog of group commit
-		 * followers; this can significantly improve transaction throughput,
-		 * at the risk of increasing transaction latency.
-		 *
-		 * We do not sleep if enableFsync is not turned on, nor if there are
-		 * fewer than CommitSiblings other backends with active transactions.
-		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
-		{
-			pg_usleep(CommitDelay);
-
-			/*
-			 * Re-check how far we can now flush the WAL. It's generally not
-			 * safe to call WaitXLogInsertionsToFinish while holding
-			 * WALWriteLock, because an in-progress insertion might need to
-			 * also grab WALWriteLock to make progress. But we know that all
-			 * the insertions up to insertpos have already finished, because
-			 * that's what the earlier WaitXLogInsertionsToFinish() returned.
-			 * We're only calling it again to allow insertpos to be moved
-			 * further forward, not to actually wait for anyone.
-			 */
-			insertpos = WaitXLogInsertionsToFinish(insertpos);
-		}
-
-		/* try to write/flush later additions to XLOG as well */
-		WriteRqst.Write = insertpos;
-		WriteRqst.Flush = insertpos;
-
-		XLogWrite(WriteRqst, false);
-
-		LWLockRelease(WALWriteLock);
-		/* done */
-		break;
+		SpinLockRelease(&XLogCtl->info_lck);
 	}
 
 	END_CRIT_SECTION();
@@ -4910,6 +5092,59 @@ XLOGChooseNumBuffers(void)
 	return xbuffers;
 }
 
+/*
+ * Auto-tune the number of WAL insertion locks.
+ *
+ * We want roughly one lock per CPU, so that concurrent inserters rarely have
+ * to queue for one, but no fewer than the 8 we historically used, and not so
+ * many that WaitXLogInsertionsToFinish() gets expensive.
+ */
+static int
+XLOGChooseNumInsertLocks(void)
+{
+	int			nlocks = 8;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	{
+		long		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		if (ncpus > nlocks)
+			nlocks = (int) Min(ncpus, 128);
+	}
+#endif
+
+	return nlocks;
+}
+
+/*
+ * GUC check_hook for wal_insert_locks
+ */
+bool
+check_wal_insert_locks(int *newval, void **extra, GucSource source)
+{
+	/*
+	 * -1 indicates a request for auto-tune.
+	 */
+	if (*newval == -1)
+	{
+		/*
+		 * If we haven't yet changed the boot_val default of -1, just let it
+		 * be.  We'll fix it when XLOGShmemSize is called.
+		 */
+		if (XLOGinsertLocks == -1)
+			return true;
+
+		/* Otherwise, substitute the auto-tune value */
+		*newval = XLOGChooseNumInsertLocks();
+	}
+
+	/* 0 is not a sensible request; treat it as asking for the minimum */
+	if (*newval < 1)
+		*newval = 1;
+
+	return true;
+}
+
 /*
  * GUC check_hook for wal_buffers
  */
@@ -4988,11 +5223,22 @@ XLOGShmemSize(void)
 	}
 	Assert(XLOGbuffers > 0);
 
+	/* Likewise for wal_insert_locks */
+	if (XLOGinsertLocks == -1)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", XLOGChooseNumInsertLocks());
+		SetConfigOption("wal_insert_locks", buf, PGC_POSTMASTER,
+						PGC_S_OVERRIDE);
+	}
+	Assert(XLOGinsertLocks > 0);
+
 	/* XLogCtl */
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), XLOGinsertLocks + 1));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -5084,10 +5330,10 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * XLOGinsertLocks;
 
 	LWLockRegisterTranche(LWTRANCHE_WAL_INSERT, "wal_insert");
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < XLOGinsertLocks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -6253,6 +6499,7 @@ StartupXLOG(void)
 	bool		backupFromStandby = false;
 	DBState		dbstate_at_startup;
 	XLogReaderState *xlogreader;
+	XLogPrefetcher *prefetcher;
 	XLogPageReadPrivate private;
 	bool		fast_promoted = false;
 	struct stat st;
@@ -6403,6 +6650,9 @@ StartupXLOG(void)
 				 errdetail("Failed while allocating a WAL reading processor.")));
 	xlogreader->system_identifier = ControlFile->system_identifier;
 
+	/* Set up a second reader to prefetch blocks ahead of replay */
+	prefetcher = XLogPrefetcherAllocate(ControlFile->system_identifier);
+
 	/*
 	 * Allocate two page buffers dedicated to WAL consistency checks.  We do
 	 * it this way, rather than just making static arrays, for two reasons:
@@ -7078,6 +7328,8 @@ StartupXLOG(void)
 		{
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
+			XLogRecPtr	dispatchedEndRecPtr = InvalidXLogRecPtr;
+			TimeLineID	dispatchedTLI = 0;
 
 			InRedo = true;
 
@@ -7091,6 +7343,7 @@ StartupXLOG(void)
 			do
 			{
 				bool		switchedTLI = false;
+				bool		dispatched;
 
 #ifdef WAL_DEBUG
 				if (XLOG_DEBUG ||
@@ -7156,6 +7409,11 @@ StartupXLOG(void)
 						recoveryPausesHere();
 				}
 
+				/* Start reading blocks that replay will need soon */
+				if (recovery_prefetch)
+					XLogPrefetcherReadAhead(prefetcher, ReadRecPtr,
+											ThisTimeLineID);
+
 				/* Setup error traceback support for ereport() */
 				errcallback.callback = rm_redo_error_callback;
 				errcallback.arg = (void *) xlogreader;
@@ -7228,29 +7486,50 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
-				/* Now apply the WAL record itself */
-				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
-
 				/*
-				 * After redo, check whether the backup pages associated with
-				 * the WAL record are consistent with the existing pages. This
-				 * check is done only if consistency check is enabled for this
-				 * record.
+				 * Hand the record to a parallel redo worker if possible.
+				 * Otherwise wait for the workers to catch up, and apply the
+				 * WAL record itself.
 				 */
-				if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
-					checkXLogConsistency(xlogreader);
+				if (ParallelRedoDispatch(xlogreader))
+					dispatched = true;
+				else
+				{
+					ParallelRedoSync();
+					dispatched = false;
+
+					RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+
+					/*
+					 * After redo, check whether the backup pages associated
+					 * with the WAL record are consistent with the existing
+					 * pages. This check is done only if consistency check is
+					 * enabled for this record.
+					 */
+					if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
+						checkXLogConsistency(xlogreader);
+				}
 
 				/* Pop the error context stack */
 				error_context_stack = errcallback.previous;
 
 				/*
 				 * Update lastReplayedEndRecPtr after this record has been
-				 * successfully replayed.
+				 * successfully replayed.  A dispatched record isn't replayed
+				 * until the workers are next synchronized.
 				 */
-				SpinLockAcquire(&XLogCtl->info_lck);
-				XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
-				XLogCtl->lastReplayedTLI = ThisTimeLineID;
-				SpinLockRelease(&XLogCtl->info_lck);
+				if (!dispatched)
+				{
+					SpinLockAcquire(&XLogCtl->info_lck);
+					XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
+					XLogCtl->lastReplayedTLI = ThisTimeLineID;
+					SpinLockRelease(&XLogCtl->info_lck);
+				}
+				else
+				{
+					dispatchedEndRecPtr = EndRecPtr;
+					dispatchedTLI = ThisTimeLineID;
+				}
 
 				/*
 				 * If rm_redo called XLogRequestWalReceiverReply, then we wake
@@ -7302,6 +7581,16 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			/* Wait for any records still being replayed by redo workers */
+			ParallelRedoShutdown();
+			if (dispatchedEndRecPtr > XLogCtl->lastReplayedEndRecPtr)
+			{
+				SpinLockAcquire(&XLogCtl->info_lck);
+				XLogCtl->lastReplayedEndRecPtr = dispatchedEndRecPtr;
+				XLogCtl->lastReplayedTLI = dispatchedTLI;
+				SpinLockRelease(&XLogCtl->info_lck);
+			}
+
 			if (reachedStopPoint)
 			{
 				if (!reachedConsistency)
@@ -7798,6 +8087,7 @@ StartupXLOG(void)
 		close(readFile);
 		readFile = -1;
 	}
+	XLogPrefetcherFree(prefetcher);
 	XLogReaderFree(xlogreader);
 
 	/*
@@ -8336,7 +8626,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < XLOGinsertLocks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -9570,6 +9860,32 @@ UpdateFullPageWrites(void)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	bool		recoveryInProgress;
+	bool		fpw = fullPageWrites;
+	static bool warned_not_atomic = false;
+
+	/*
+	 * With atomic_page_writes, pages can't be torn if the storage says it
+	 * writes whole pages atomically, so full-page images aren't needed.
+	 * Check again every time, since tablespaces may have been added.
+	 */
+	if (fpw && atomicPageWrites)
+	{
+		if (DataDirectoryWritesAtomic())
+		{
+			fpw = false;
+			warned_not_atomic = false;
+		}
+		else if (!warned_not_atomic)
+		{
+			ereport(WARNING,
+					(errmsg("full-page writes remain enabled because atomic writes of %d bytes could not be verified for all tablespaces",
+							BLCKSZ),
+					 errhint("Atomic write support is detected through statx(), which requires Linux 6.11 or later and supporting storage.")));
+			warned_not_atomic = true;
+		}
+	}
+	else
+		warned_not_atomic = false;
 
 	/*
 	 * Do nothing if full_page_writes has not been changed.
@@ -9578,7 +9894,7 @@ UpdateFullPageWrites(void)
 	 * because we assume that there is no concurrently running process which
 	 * can update it.
 	 */
-	if (fullPageWrites == Insert->fullPageWrites)
+	if (fpw == Insert->fullPageWrites)
 		return;
 
 	/*
@@ -9597,7 +9913,7 @@ UpdateFullPageWrites(void)
 	 * setting it to false, first write the WAL record and then set the global
 	 * flag.
 	 */
-	if (fullPageWrites)
+	if (fpw)
 	{
 		WALInsertLockAcquireExclusive();
 		Insert->fullPageWrites = true;
@@ -9611,12 +9927,12 @@ UpdateFullPageWrites(void)
 	if (XLogStandbyInfoActive() && !recoveryInProgress)
 	{
 		XLogBeginInsert();
-		XLogRegisterData((char *) (&fullPageWrites), sizeof(bool));
+		XLogRegisterData((char *) (&fpw), sizeof(bool));
 
 		XLogInsert(RM_XLOG_ID, XLOG_FPW_CHANGE);
 	}
 
-	if (!fullPageWrites)
+	if (!fpw)
 	{
 		WALInsertLockAcquireExclusive();
 		Insert->fullPageWrites = false;
@@ -10090,10 +10406,18 @@ static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
+	int			io_direct_flag = 0;
+
+	/*
+	 * With io_direct = wal, always bypass the kernel cache, whatever the sync
+	 * method.  Walreceiver is excluded for the reasons given below.
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
+		io_direct_flag = PG_O_DIRECT;
 
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return io_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10109,7 +10433,7 @@ get_sync_bit(int method)
 	 * after its written. Also, walreceiver performs unaligned writes, which
 	 * don't work with O_DIRECT, so it is required for correctness too.
 	 */
-	if (!XLogIsNeeded() && !AmWalReceiverProcess())
+	if ((!XLogIsNeeded() && !AmWalReceiverProcess()) || io_direct_flag)
 		o_direct_flag = PG_O_DIRECT;
 
 	switch (method)
@@ -10123,7 +10447,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return io_direct_flag;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
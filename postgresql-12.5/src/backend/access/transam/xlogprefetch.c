@@ -0,0 +1,466 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ * The goal of this module is to read future WAL records and issue
+ * PrefetchSharedBuffer() calls for referenced blocks, so that we avoid I/O
+ * stalls in the main recovery loop.
+ *
+ * The prefetcher runs in the startup process, using a second
+ * XLogReaderState that decodes records ahead of the one that is being
+ * replayed.  It only reads WAL that is already present in pg_wal; it never
+ * waits for WAL to arrive, restores files from the archive, or reports
+ * errors about the WAL it reads.  If it can't read or decode a record, it
+ * simply gives up until replay has caught up with the point of failure, and
+ * then starts again from the replay position.  Since prefetching is only a
+ * hint, nothing it does can affect the correctness of replay.
+ *
+ * We don't prefetch blocks that will be restored from a full page image or
+ * initialized from scratch by redo, blocks that are beyond the current end
+ * of their relation, or blocks that are already in shared buffers.  The
+ * number of prefetches that may be in flight (that is, issued for records
+ * that replay has not reached yet) is limited by maintenance_io_concurrency,
+ * and we don't read further ahead than XLOGPREFETCHER_MAX_DISTANCE bytes of
+ * WAL.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "access/xlogrecord.h"
+#include "pgstat.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/smgr.h"
+
+/*
+ * How far ahead of replay, in bytes of WAL, we're prepared to read.  This
+ * bounds the amount of work we do for WAL that is full of records without
+ * interesting block references.
+ */
+#define XLOGPREFETCHER_MAX_DISTANCE		(256 * 1024)
+
+/* Number of recently prefetched blocks remembered, to skip duplicates. */
+#define XLOGPREFETCHER_RECENT_BLOCKS	8
+
+/* GUCs */
+bool		recovery_prefetch = false;
+
+typedef struct XLogPrefetcherBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetcherBlock;
+
+struct XLogPrefetcher
+{
+	/* Reader used to look ahead, or NULL if we need to (re)start. */
+	XLogReaderState *reader;
+	uint64		system_identifier;
+
+	/* WAL segment file currently open for the reader, if any. */
+	int			readFile;
+	XLogSegNo	readSegNo;
+	TimeLineID	tli;
+
+	/* Don't restart before replay reaches this point after a failure. */
+	XLogRecPtr	retry_after;
+
+	/* Position within the most recently decoded record. */
+	bool		have_record;
+	int			next_block_id;
+
+	/*
+	 * Ring of LSNs of records for which we issued prefetches that replay
+	 * hasn't reached yet.  It has room for MAX_IO_CONCURRENCY + 1 entries.
+	 */
+	XLogRecPtr *inflight;
+	int			inflight_head;
+	int			inflight_tail;
+
+	/* Maximum number of prefetches in flight, from maintenance_io_concurrency */
+	int			io_concurrency;
+	int			max_inflight;
+
+	/* Recently prefetched blocks. */
+	XLogPrefetcherBlock recent[XLOGPREFETCHER_RECENT_BLOCKS];
+	int			next_recent;
+
+	/* Statistics, reported at the end of recovery. */
+	uint64		prefetch;
+	uint64		skip_hit;
+	uint64		skip_new;
+	uint64		skip_fpw;
+	uint64		skip_seq;
+};
+
+static int	XLogPrefetcherPageRead(XLogReaderState *reader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf,
+								   TimeLineID *pageTLI);
+static void XLogPrefetcherReset(XLogPrefetcher *prefetcher,
+								XLogRecPtr retry_after);
+static bool XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherCheckConcurrency(XLogPrefetcher *prefetcher);
+
+#define XLogPrefetcherInflight(p) \
+	(((p)->inflight_head - (p)->inflight_tail + MAX_IO_CONCURRENCY + 1) % \
+	 (MAX_IO_CONCURRENCY + 1))
+
+/*
+ * Create a prefetcher.  The system identifier is used to validate the WAL
+ * pages it reads, as for the main recovery reader.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(uint64 system_identifier)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->system_identifier = system_identifier;
+	prefetcher->readFile = -1;
+	prefetcher->retry_after = InvalidXLogRecPtr;
+	prefetcher->inflight = palloc(sizeof(XLogRecPtr) * (MAX_IO_CONCURRENCY + 1));
+	prefetcher->io_concurrency = -1;
+	XLogPrefetcherCheckConcurrency(prefetcher);
+
+	return prefetcher;
+}
+
+/*
+ * Destroy a prefetcher, and report what it did.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	ereport(DEBUG1,
+			(errmsg("recovery prefetcher issued " UINT64_FORMAT " prefetches, skipped " UINT64_FORMAT " cached, " UINT64_FORMAT " new, " UINT64_FORMAT " full page image and " UINT64_FORMAT " repeated blocks",
+					prefetcher->prefetch, prefetcher->skip_hit,
+					prefetcher->skip_new, prefetcher->skip_fpw,
+					prefetcher->skip_seq)));
+
+	XLogPrefetcherReset(prefetcher, InvalidXLogRecPtr);
+	pfree(prefetcher->inflight);
+	pfree(prefetcher);
+}
+
+/*
+ * Throw away the reader and forget about in-flight prefetches.  If
+ * retry_after is valid, don't restart until replay has reached it.
+ */
+static void
+XLogPrefetcherReset(XLogPrefetcher *prefetcher, XLogRecPtr retry_after)
+{
+	if (prefetcher->reader)
+	{
+		XLogReaderFree(prefetcher->reader);
+		prefetcher->reader = NULL;
+	}
+	if (prefetcher->readFile >= 0)
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+	prefetcher->retry_after = retry_after;
+	prefetcher->have_record = false;
+	prefetcher->inflight_head = prefetcher->inflight_tail = 0;
+}
+
+/*
+ * Recompute our queue depth if maintenance_io_concurrency has changed.
+ */
+static void
+XLogPrefetcherCheckConcurrency(XLogPrefetcher *prefetcher)
+{
+	double		target = 0;
+
+	if (prefetcher->io_concurrency == maintenance_io_concurrency)
+		return;
+
+	prefetcher->io_concurrency = maintenance_io_concurrency;
+	if (!ComputeIoConcurrency(maintenance_io_concurrency, &target))
+		target = 0;
+	prefetcher->max_inflight = Min((int) rint(target), MAX_IO_CONCURRENCY);
+}
+
+/*
+ * Called by the startup process before replaying the record at replayPtr.
+ * Reads ahead in the WAL, issuing prefetches for blocks that replay will
+ * need soon.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogRecPtr replayPtr,
+						TimeLineID replayTLI)
+{
+	XLogPrefetcherCheckConcurrency(prefetcher);
+	if (prefetcher->max_inflight <= 0)
+		return;
+
+	/* Forget about prefetches for records that replay has reached. */
+	while (prefetcher->inflight_tail != prefetcher->inflight_head &&
+		   prefetcher->inflight[prefetcher->inflight_tail] <= replayPtr)
+		prefetcher->inflight_tail =
+			(prefetcher->inflight_tail + 1) % (MAX_IO_CONCURRENCY + 1);
+
+	/*
+	 * Start over if replay switched timelines, or if replay has overtaken
+	 * us.
+	 */
+	if (prefetcher->reader != NULL &&
+		(replayTLI != prefetcher->tli ||
+		 prefetcher->reader->EndRecPtr < replayPtr))
+		XLogPrefetcherReset(prefetcher, InvalidXLogRecPtr);
+
+	if (prefetcher->reader == NULL)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		/* After a failure, wait for replay to get past the trouble spot. */
+		if (!XLogRecPtrIsInvalid(prefetcher->retry_after) &&
+			replayPtr < prefetcher->retry_after)
+			return;
+
+		prefetcher->reader = XLogReaderAllocate(wal_segment_size,
+												&XLogPrefetcherPageRead,
+												prefetcher);
+		if (prefetcher->reader == NULL)
+		{
+			XLogPrefetcherReset(prefetcher, replayPtr + 1);
+			return;
+		}
+		prefetcher->reader->system_identifier = prefetcher->system_identifier;
+		prefetcher->tli = replayTLI;
+		prefetcher->retry_after = InvalidXLogRecPtr;
+
+		/*
+		 * Begin by reading the record that is about to be replayed.  If we
+		 * can't even read that one (because it was restored from the
+		 * archive, say), try again once replay reaches the next segment.
+		 */
+		record = XLogReadRecord(prefetcher->reader, replayPtr, &errormsg);
+		if (record == NULL)
+		{
+			XLogSegNo	segno;
+			XLogRecPtr	next;
+
+			XLByteToSeg(replayPtr, segno, wal_segment_size);
+			XLogSegNoOffsetToRecPtr(segno + 1, 0, wal_segment_size, next);
+			XLogPrefetcherReset(prefetcher, next);
+			return;
+		}
+		prefetcher->have_record = true;
+		prefetcher->next_block_id = 0;
+	}
+
+	for (;;)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		/* Finish dealing with the current record, if any. */
+		if (prefetcher->have_record)
+		{
+			if (!XLogPrefetcherScanBlocks(prefetcher))
+				return;			/* queue full */
+			prefetcher->have_record = false;
+		}
+
+		/* Don't get too far ahead of replay. */
+		if (prefetcher->reader->EndRecPtr - replayPtr >
+			XLOGPREFETCHER_MAX_DISTANCE)
+			return;
+
+		record = XLogReadRecord(prefetcher->reader, InvalidXLogRecPtr,
+								&errormsg);
+		if (record == NULL)
+		{
+			/*
+			 * We've reached the end of the WAL that's available to us, or
+			 * something we can't decode.  Give up until replay gets there.
+			 */
+			XLogPrefetcherReset(prefetcher, prefetcher->reader->EndRecPtr);
+			return;
+		}
+		prefetcher->have_record = true;
+		prefetcher->next_block_id = 0;
+	}
+}
+
+/*
+ * Issue prefetches for the block references of the record most recently
+ * decoded by our reader, starting at next_block_id.  Returns false if the
+ * queue filled up before we got through them all.
+ */
+static bool
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+
+	for (; prefetcher->next_block_id <= reader->max_block_id;
+		 prefetcher->next_block_id++)
+	{
+		DecodedBkpBlock *block = &reader->blocks[prefetcher->next_block_id];
+		SMgrRelation reln;
+		BlockNumber nblocks;
+		int			i;
+		bool		seen;
+
+		if (!block->in_use)
+			continue;
+
+		/* Redo will restore or initialize these blocks without reading. */
+		if (block->has_image && block->apply_image)
+		{
+			prefetcher->skip_fpw++;
+			continue;
+		}
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			prefetcher->skip_new++;
+			continue;
+		}
+
+		/* Skip blocks we've prefetched very recently. */
+		seen = false;
+		for (i = 0; i < XLOGPREFETCHER_RECENT_BLOCKS; i++)
+		{
+			XLogPrefetcherBlock *recent = &prefetcher->recent[i];
+
+			if (recent->blkno == block->blkno &&
+				recent->forknum == block->forknum &&
+				RelFileNodeEquals(recent->rnode, block->rnode))
+			{
+				seen = true;
+				break;
+			}
+		}
+		if (seen)
+		{
+			prefetcher->skip_seq++;
+			continue;
+		}
+
+		/* Don't start any more I/O if the queue is full. */
+		if (XLogPrefetcherInflight(prefetcher) >= prefetcher->max_inflight)
+			return false;
+
+		/*
+		 * Blocks beyond the current end of the relation, including those of
+		 * relations that haven't been created yet, will be extended by redo.
+		 * Prefer the size cache, to avoid a system call per block.
+		 */
+		reln = smgropen(block->rnode, InvalidBackendId);
+		nblocks = smgrnblocks_cached(reln, block->forknum);
+		if (nblocks == InvalidBlockNumber)
+		{
+			if (!smgrexists(reln, block->forknum))
+			{
+				prefetcher->skip_new++;
+				continue;
+			}
+			nblocks = smgrnblocks(reln, block->forknum);
+		}
+		if (block->blkno >= nblocks)
+		{
+			prefetcher->skip_new++;
+			continue;
+		}
+
+		if (!PrefetchSharedBuffer(reln, block->forknum, block->blkno))
+		{
+			prefetcher->skip_hit++;
+			continue;
+		}
+
+		/* Remember it, so we don't prefetch it again. */
+		prefetcher->recent[prefetcher->next_recent].rnode = block->rnode;
+		prefetcher->recent[prefetcher->next_recent].forknum = block->forknum;
+		prefetcher->recent[prefetcher->next_recent].blkno = block->blkno;
+		prefetcher->next_recent =
+			(prefetcher->next_recent + 1) % XLOGPREFETCHER_RECENT_BLOCKS;
+
+		/* It's in flight until replay reaches this record. */
+		prefetcher->inflight[prefetcher->inflight_head] = reader->ReadRecPtr;
+		prefetcher->inflight_head =
+			(prefetcher->inflight_head + 1) % (MAX_IO_CONCURRENCY + 1);
+		prefetcher->prefetch++;
+	}
+
+	return true;
+}
+
+/*
+ * Page read callback for the prefetcher's reader.  Reads only WAL that is
+ * already in pg_wal (and has been written by the WAL receiver, when
+ * streaming), and never waits.  Returns -1 if the page isn't available.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogRecPtr	receivedUpto;
+	int			readLen = XLOG_BLCKSZ;
+	uint32		targetPageOff;
+	int			r;
+
+	/* Don't read anything that the WAL receiver hasn't written yet. */
+	receivedUpto = GetWalRcvWriteRecPtr(NULL, NULL);
+	if (!XLogRecPtrIsInvalid(receivedUpto))
+	{
+		if (targetPagePtr + reqLen > receivedUpto)
+			return -1;
+		if (targetPagePtr + readLen > receivedUpto)
+			readLen = receivedUpto - targetPagePtr;
+	}
+
+	/* Switch segment files if necessary. */
+	if (prefetcher->readFile >= 0 &&
+		!XLByteInSeg(targetPagePtr, prefetcher->readSegNo, wal_segment_size))
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+	if (prefetcher->readFile < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLByteToSeg(targetPagePtr, prefetcher->readSegNo, wal_segment_size);
+		XLogFilePath(path, prefetcher->tli, prefetcher->readSegNo,
+					 wal_segment_size);
+		prefetcher->readFile = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (prefetcher->readFile < 0)
+			return -1;
+	}
+
+	targetPageOff = XLogSegmentOffset(targetPagePtr, wal_segment_size);
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	r = pg_pread(prefetcher->readFile, readBuf, XLOG_BLCKSZ,
+				 (off_t) targetPageOff);
+	pgstat_report_wait_end();
+	if (r < readLen)
+		return -1;
+
+	*pageTLI = prefetcher->tli;
+	return readLen;
+}
@@ -19,6 +19,7 @@
 
 #include <unistd.h>
 
+#include "access/parallelredo.h"
 #include "access/timeline.h"
 #include "access/xlog.h"
 #include "access/xlog_internal.h"
@@ -623,6 +624,7 @@ XLogDropDatabase(Oid dbid)
 	 * purpose. XXX: Or should we rather leave the smgr entries dangling?
 	 */
 	smgrcloseall();
+	ParallelRedoNoteSmgrInvalidation();
 
 	forget_invalid_pages_db(dbid);
 }
@@ -915,6 +917,7 @@ read_local_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr,
 	XLogRecPtr	read_upto,
 				loc;
 	int			count;
+	Size		nbuffered;
 
 	loc = targetPagePtr + reqLen;
 
@@ -1018,12 +1021,26 @@ read_local_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr,
 	}
 
 	/*
-	 * Even though we just determined how much of the page can be validly read
-	 * as 'count', read the whole page anyway. It's guaranteed to be
-	 * zero-padded up to the page boundary if it's incomplete.
+	 * Copy what we can from the WAL buffers first; recent WAL is usually
+	 * still there.
 	 */
-	XLogRead(cur_page, state->wal_segment_size, *pageTLI, targetPagePtr,
-			 XLOG_BLCKSZ);
+	nbuffered = XLogReadFromBuffers(cur_page, targetPagePtr, count, *pageTLI);
+	if (nbuffered == count)
+	{
+		/* zero-pad like an incomplete page read from a file would be */
+		memset(cur_page + count, 0, XLOG_BLCKSZ - count);
+	}
+	else
+	{
+		/*
+		 * Even though we just determined how much of the page can be validly
+		 * read as 'count', read the whole rest of the page anyway. It's
+		 * guaranteed to be zero-padded up to the page boundary if it's
+		 * incomplete.
+		 */
+		XLogRead(cur_page + nbuffered, state->wal_segment_size, *pageTLI,
+				 targetPagePtr + nbuffered, XLOG_BLCKSZ - nbuffered);
+	}
 
 	/* number of valid bytes in the buffer */
 	return count;
@@ -1265,6 +1265,16 @@ heap_create_with_catalog(const char *relname,
 
 	Assert(relid == RelationGetRelid(new_rel_desc));
 
+	/*
+	 * Each session's contents of a global temporary table have their own
+	 * horizons, tracked locally; see RelationInitGlobalTempStorage().
+	 */
+	if (relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+	{
+		relfrozenxid = InvalidTransactionId;
+		relminmxid = InvalidMultiXactId;
+	}
+
 	new_rel_desc->rd_rel->relrewrite = relrewrite;
 
 	/*
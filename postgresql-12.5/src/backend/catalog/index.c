@@ -2856,12 +2856,14 @@ index_build(Relation heapRelation,
 
 	/*
 	 * Determine worker process details for parallel CREATE INDEX.  Currently,
-	 * only btree has support for parallel builds.
+	 * only btree, gin and brin have support for parallel builds.
 	 *
 	 * Note that planner considers parallel safety for us.
 	 */
 	if (parallel && IsNormalProcessingMode() &&
-		indexRelation->rd_rel->relam == BTREE_AM_OID)
+		(indexRelation->rd_rel->relam == BTREE_AM_OID ||
+		 indexRelation->rd_rel->relam == GIN_AM_OID ||
+		 indexRelation->rd_rel->relam == BRIN_AM_OID))
 		indexInfo->ii_ParallelWorkers =
 			plan_create_index_workers(RelationGetRelid(heapRelation),
 									  RelationGetRelid(indexRelation));
@@ -3543,8 +3545,14 @@ reindex_index(Oid indexId, bool skip_constraint_checks, char persistence,
 	/* Suppress use of the target index while rebuilding it */
 	SetReindexProcessing(heapId, indexId);
 
-	/* Create a new physical relation for the index */
-	RelationSetNewRelfilenode(iRel, persistence);
+	/*
+	 * Create a new physical relation for the index.  Other sessions share a
+	 * global temporary index's relfilenode, so just empty our storage.
+	 */
+	if (RELATION_IS_GLOBAL_TEMP(iRel))
+		RelationTruncate(iRel, 0);
+	else
+		RelationSetNewRelfilenode(iRel, persistence);
 
 	/* Initialize the index and rebuild */
 	/* Note: we do not need to re-establish pkey setting */
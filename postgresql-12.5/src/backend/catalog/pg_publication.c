@@ -145,20 +145,110 @@ pg_relation_is_publishable(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Translate a publication column list into an array of attribute numbers,
+ * sorted in ascending order.  Returns the number of columns.
+ *
+ * Every column must exist in the relation, may not be a system or generated
+ * column, and may only be listed once.
+ */
+static int
+publication_translate_columns(Relation targetrel, List *columns,
+							  AttrNumber **attrs)
+{
+	AttrNumber *attarray;
+	Bitmapset  *set = NULL;
+	ListCell   *lc;
+	int			n = 0;
+	int			i;
+
+	attarray = palloc(sizeof(AttrNumber) * list_length(columns));
+
+	foreach(lc, columns)
+	{
+		char	   *colname = strVal(lfirst(lc));
+		AttrNumber	attnum = get_attnum(RelationGetRelid(targetrel), colname);
+
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" of relation \"%s\" does not exist",
+							colname, RelationGetRelationName(targetrel))));
+
+		if (!AttrNumberIsForUserDefinedAttr(attnum))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use system column \"%s\" in publication column list",
+							colname)));
+
+		if (TupleDescAttr(RelationGetDescr(targetrel), attnum - 1)->attgenerated)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use generated column \"%s\" in publication column list",
+							colname)));
+
+		if (bms_is_member(attnum, set))
+			ereport(ERROR,
+					(errcode(ERRCODE_DUPLICATE_OBJECT),
+					 errmsg("duplicate column \"%s\" in publication column list",
+							colname)));
+
+		set = bms_add_member(set, attnum);
+	}
+
+	/* Emit the attnums in order, as the walsender expects */
+	i = -1;
+	while ((i = bms_next_member(set, i)) >= 0)
+		attarray[n++] = (AttrNumber) i;
+
+	bms_free(set);
+
+	*attrs = attarray;
+	return n;
+}
+
+/*
+ * Add the attribute numbers stored in a pg_publication_rel.prattrs value to
+ * the given bitmapset, allocating it in mcxt.
+ */
+Bitmapset *
+pub_collist_to_bitmapset(Bitmapset *columns, Datum pubcols, MemoryContext mcxt)
+{
+	ArrayType  *arr = DatumGetArrayTypeP(pubcols);
+	int16	   *elems;
+	int			nelems;
+	int			i;
+	MemoryContext oldcxt;
+
+	nelems = ARR_DIMS(arr)[0];
+	elems = (int16 *) ARR_DATA_PTR(arr);
+
+	oldcxt = MemoryContextSwitchTo(mcxt);
+	for (i = 0; i < nelems; i++)
+		columns = bms_add_member(columns, elems[i]);
+	MemoryContextSwitchTo(oldcxt);
+
+	return columns;
+}
+
 /*
  * Insert new publication / relation mapping.
  */
 ObjectAddress
-publication_add_relation(Oid pubid, Relation targetrel,
+publication_add_relation(Oid pubid, PublicationRelInfo *pri,
 						 bool if_not_exists)
 {
 	Relation	rel;
+	Relation	targetrel = pri->relation;
 	HeapTuple	tup;
 	Datum		values[Natts_pg_publication_rel];
 	bool		nulls[Natts_pg_publication_rel];
 	Oid			relid = RelationGetRelid(targetrel);
 	Oid			prrelid;
 	Publication *pub = GetPublication(pubid);
+	AttrNumber *attrs = NULL;
+	int			natts = 0;
+	int			i;
 	ObjectAddress myself,
 				referenced;
 
@@ -185,6 +275,9 @@ publication_add_relation(Oid pubid, Relation targetrel,
 
 	check_publication_add_relation(targetrel);
 
+	if (pri->columns != NIL)
+		natts = publication_translate_columns(targetrel, pri->columns, &attrs);
+
 	/* Form a tuple. */
 	memset(values, 0, sizeof(values));
 	memset(nulls, false, sizeof(nulls));
@@ -197,6 +290,18 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	values[Anum_pg_publication_rel_prrelid - 1] =
 		ObjectIdGetDatum(relid);
 
+	if (pri->whereClause != NULL)
+		values[Anum_pg_publication_rel_prqual - 1] =
+			CStringGetTextDatum(nodeToString(pri->whereClause));
+	else
+		nulls[Anum_pg_publication_rel_prqual - 1] = true;
+
+	if (attrs != NULL)
+		values[Anum_pg_publication_rel_prattrs - 1] =
+			PointerGetDatum(buildint2vector(attrs, natts));
+	else
+		nulls[Anum_pg_publication_rel_prattrs - 1] = true;
+
 	tup = heap_form_tuple(RelationGetDescr(rel), values, nulls);
 
 	/* Insert tuple into catalog. */
@@ -213,6 +318,22 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	ObjectAddressSet(referenced, RelationRelationId, relid);
 	recordDependencyOn(&myself, &referenced, DEPENDENCY_AUTO);
 
+	/*
+	 * Add dependencies on the objects mentioned in the row filter, and on
+	 * the individual columns of the column list, so that those can't be
+	 * dropped or altered underneath us.
+	 */
+	if (pri->whereClause != NULL)
+		recordDependencyOnSingleRelExpr(&myself, pri->whereClause, relid,
+										DEPENDENCY_NORMAL, DEPENDENCY_NORMAL,
+										false);
+
+	for (i = 0; i < natts; i++)
+	{
+		ObjectAddressSubSet(referenced, RelationRelationId, relid, attrs[i]);
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
 	/* Close the table. */
 	table_close(rel, RowExclusiveLock);
 
@@ -21,17 +21,25 @@
 
 #include "miscadmin.h"
 
+#include "access/amapi.h"
+#include "access/multixact.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/visibilitymap.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "access/xlogutils.h"
+#include "catalog/index.h"
 #include "catalog/storage.h"
 #include "catalog/storage_xlog.h"
 #include "storage/freespace.h"
+#include "storage/ipc.h"
 #include "storage/smgr.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 
 /*
  * We keep a list of all relations (represented as RelFileNode values)
@@ -64,6 +72,30 @@ typedef struct PendingRelDelete
 
 static PendingRelDelete *pendingDeletes = NULL; /* head of linked list */
 
+/*
+ * Global temporary relations have a single catalog entry, but each session
+ * that touches one gets its own storage, named with the session's backend ID
+ * like a local temporary relation and kept in local buffers.  That storage is
+ * created lazily the first time the relation is opened, and lives until the
+ * relation is dropped or the session ends; it is not subject to transaction
+ * rollback.  We track the storage this session owns in a backend-local hash
+ * table, along with the XID and MultiXactId horizons of its contents, which
+ * would otherwise be kept in pg_class and hence shared among all sessions.
+ */
+typedef struct GlobalTempStorageEnt
+{
+	RelFileNode rnode;			/* hash key */
+	TransactionId frozenxid;	/* all XIDs in our storage are >= this */
+	MultiXactId minmulti;		/* all multixacts in our storage are >= this */
+} GlobalTempStorageEnt;
+
+static HTAB *globalTempStorage = NULL;
+
+static void RememberGlobalTempStorage(RelFileNode rnode);
+static void ForgetGlobalTempStorage(RelFileNode rnode);
+static void BuildGlobalTempIndex(Relation indexRel);
+static void AtProcExit_GlobalTempStorage(int code, Datum arg);
+
 /*
  * RelationCreateStorage
  *		Create physical storage for a relation.
@@ -86,6 +118,7 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 	switch (relpersistence)
 	{
 		case RELPERSISTENCE_TEMP:
+		case RELPERSISTENCE_GLOBAL_TEMP:
 			backend = BackendIdForTempRelations();
 			needs_wal = false;
 			break;
@@ -108,6 +141,9 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 	if (needs_wal)
 		log_smgrcreate(&srel->smgr_rnode.node, MAIN_FORKNUM);
 
+	if (relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		RememberGlobalTempStorage(rnode);
+
 	/* Add the relation to the list of stuff to delete at abort */
 	pending = (PendingRelDelete *)
 		MemoryContextAlloc(TopMemoryContext, sizeof(PendingRelDelete));
@@ -385,6 +421,225 @@ RelationCopyStorage(SMgrRelation src, SMgrRelation dst,
 		smgrimmedsync(dst, forkNum);
 }
 
+/*
+ * RelationInitGlobalTempStorage
+ *		Make sure this session has storage for a global temporary relation.
+ *
+ * Called whenever a global temporary relation is opened.  If this is the
+ * first use of the relation in this session, its storage is created empty;
+ * an index is then built from this session's contents of its table, which
+ * are opened (and so initialized) first if need be.
+ */
+void
+RelationInitGlobalTempStorage(Relation rel)
+{
+	Assert(RELATION_IS_GLOBAL_TEMP(rel));
+
+	/*
+	 * Parallel workers use the leader's backend ID for temporary relations,
+	 * but the storage is the leader's to manage.  Workers can't read local
+	 * buffers anyway, so they never reach the contents.
+	 */
+	if (IsParallelWorker())
+		return;
+
+	if (!RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
+		return;
+
+	if (globalTempStorage != NULL &&
+		hash_search(globalTempStorage, &rel->rd_node, HASH_FIND, NULL) != NULL)
+		return;
+
+	/*
+	 * Any file already present was left behind by an earlier session that
+	 * used our backend ID and didn't get to clean up; throw it away.
+	 */
+	RelationOpenSmgr(rel);
+	if (smgrexists(rel->rd_smgr, MAIN_FORKNUM))
+		smgrdounlinkall(&rel->rd_smgr, 1, false);
+	smgrcreate(rel->rd_smgr, MAIN_FORKNUM, false);
+
+	RememberGlobalTempStorage(rel->rd_node);
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+	{
+		PG_TRY();
+		{
+			BuildGlobalTempIndex(rel);
+		}
+		PG_CATCH();
+		{
+			/* start over next time */
+			ForgetGlobalTempStorage(rel->rd_node);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+	}
+}
+
+/*
+ * Fill a newly created global temporary index from its table's contents.
+ *
+ * This is a bare-bones version of index_build(): the other sessions share
+ * the index's pg_class row, so we must not update its statistics.
+ */
+static void
+BuildGlobalTempIndex(Relation indexRel)
+{
+	Relation	heapRel;
+	IndexInfo  *indexInfo;
+	bool		pushed_snapshot = false;
+
+	heapRel = table_open(IndexGetRelation(RelationGetRelid(indexRel), false),
+						 AccessShareLock);
+	indexInfo = BuildIndexInfo(indexRel);
+
+	/* index expressions and predicates may need a snapshot */
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pushed_snapshot = true;
+	}
+
+	(void) indexRel->rd_indam->ambuild(heapRel, indexRel, indexInfo);
+
+	if (pushed_snapshot)
+		PopActiveSnapshot();
+
+	table_close(heapRel, NoLock);
+}
+
+/*
+ * ResetGlobalTempStorage
+ *		Discard this session's contents of all global temporary relations.
+ *
+ * The storage is recreated empty the next time each relation is opened.
+ */
+void
+ResetGlobalTempStorage(void)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorageEnt *ent;
+
+	if (globalTempStorage == NULL)
+		return;
+
+	hash_seq_init(&status, globalTempStorage);
+	while ((ent = (GlobalTempStorageEnt *) hash_seq_search(&status)) != NULL)
+	{
+		SMgrRelation srel = smgropen(ent->rnode, BackendIdForTempRelations());
+
+		smgrdounlinkall(&srel, 1, false);
+		smgrclose(srel);
+
+		hash_search(globalTempStorage, &ent->rnode, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * GetGlobalTempStorageHorizons
+ *		Report the horizons of this session's contents of a global temporary
+ *		table, which take the place of pg_class.relfrozenxid and relminmxid.
+ */
+void
+GetGlobalTempStorageHorizons(Relation rel, TransactionId *frozenxid,
+							 MultiXactId *minmulti)
+{
+	GlobalTempStorageEnt *ent = NULL;
+
+	Assert(RELATION_IS_GLOBAL_TEMP(rel));
+
+	if (globalTempStorage != NULL)
+		ent = (GlobalTempStorageEnt *) hash_search(globalTempStorage,
+												   &rel->rd_node,
+												   HASH_FIND, NULL);
+	if (ent == NULL)
+		elog(ERROR, "no storage for global temporary relation \"%s\"",
+			 RelationGetRelationName(rel));
+
+	*frozenxid = ent->frozenxid;
+	*minmulti = ent->minmulti;
+}
+
+/*
+ * SetGlobalTempStorageHorizons
+ *		Advance the horizons of this session's contents of a global temporary
+ *		table, as vac_update_relstats() does for other tables.
+ *
+ * Invalid values mean "don't change".
+ */
+void
+SetGlobalTempStorageHorizons(Relation rel, TransactionId frozenxid,
+							 MultiXactId minmulti)
+{
+	GlobalTempStorageEnt *ent = NULL;
+
+	Assert(RELATION_IS_GLOBAL_TEMP(rel));
+
+	if (globalTempStorage != NULL)
+		ent = (GlobalTempStorageEnt *) hash_search(globalTempStorage,
+												   &rel->rd_node,
+												   HASH_FIND, NULL);
+	if (ent == NULL)
+		return;
+
+	if (TransactionIdIsNormal(frozenxid) &&
+		TransactionIdPrecedes(ent->frozenxid, frozenxid))
+		ent->frozenxid = frozenxid;
+	if (MultiXactIdIsValid(minmulti) &&
+		MultiXactIdPrecedes(ent->minmulti, minmulti))
+		ent->minmulti = minmulti;
+}
+
+/*
+ * Start tracking newly created global temporary storage.  Its contents can
+ * only come from transactions that are yet to start, just as for a new
+ * relation in heapam_relation_set_new_filenode().
+ */
+static void
+RememberGlobalTempStorage(RelFileNode rnode)
+{
+	GlobalTempStorageEnt *ent;
+
+	if (globalTempStorage == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(RelFileNode);
+		ctl.entrysize = sizeof(GlobalTempStorageEnt);
+		ctl.hcxt = TopMemoryContext;
+		globalTempStorage = hash_create("Global temporary storage", 64, &ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		before_shmem_exit(AtProcExit_GlobalTempStorage, 0);
+	}
+
+	ent = (GlobalTempStorageEnt *) hash_search(globalTempStorage, &rnode,
+											   HASH_ENTER, NULL);
+	ent->frozenxid = RecentXmin;
+	ent->minmulti = GetOldestMultiXactId();
+}
+
+/*
+ * Stop tracking global temporary storage that has been removed.
+ */
+static void
+ForgetGlobalTempStorage(RelFileNode rnode)
+{
+	if (globalTempStorage != NULL)
+		hash_search(globalTempStorage, &rnode, HASH_REMOVE, NULL);
+}
+
+/*
+ * Remove this session's global temporary storage at backend exit.
+ */
+static void
+AtProcExit_GlobalTempStorage(int code, Datum arg)
+{
+	ResetGlobalTempStorage();
+}
+
 /*
  *	smgrDoPendingDeletes() -- Take care of relation deletes at end of xact.
  *
@@ -431,6 +686,10 @@ smgrDoPendingDeletes(bool isCommit)
 
 				srel = smgropen(pending->relnode, pending->backend);
 
+				/* this might be a global temporary relation's storage */
+				if (pending->backend != InvalidBackendId)
+					ForgetGlobalTempStorage(pending->relnode);
+
 				/* allocate the initial array, or extend it, if needed */
 				if (maxrels == 0)
 				{
@@ -547,6 +547,13 @@ CREATE VIEW pg_config AS
 REVOKE ALL on pg_config FROM PUBLIC;
 REVOKE EXECUTE ON FUNCTION pg_config() FROM PUBLIC;
 
+CREATE VIEW pg_backend_memory_contexts AS
+    SELECT * FROM pg_get_backend_memory_contexts();
+
+REVOKE ALL ON pg_backend_memory_contexts FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_log_backend_memory_contexts(integer) FROM PUBLIC;
+
 -- Statistics views
 
 CREATE VIEW pg_stat_all_tables AS
@@ -566,6 +573,7 @@ CREATE VIEW pg_stat_all_tables AS
             pg_stat_get_live_tuples(C.oid) AS n_live_tup,
             pg_stat_get_dead_tuples(C.oid) AS n_dead_tup,
             pg_stat_get_mod_since_analyze(C.oid) AS n_mod_since_analyze,
+            pg_stat_get_ins_since_vacuum(C.oid) AS n_ins_since_vacuum,
             pg_stat_get_last_vacuum_time(C.oid) as last_vacuum,
             pg_stat_get_last_autovacuum_time(C.oid) as last_autovacuum,
             pg_stat_get_last_analyze_time(C.oid) as last_analyze,
@@ -776,7 +784,10 @@ CREATE VIEW pg_stat_replication AS
             W.replay_lag,
             W.sync_priority,
             W.sync_state,
-            W.reply_time
+            W.reply_time,
+            W.spill_txns,
+            W.spill_count,
+            W.spill_bytes
     FROM pg_stat_get_activity(NULL) AS S
         JOIN pg_stat_get_wal_senders() AS W ON (S.pid = W.pid)
         LEFT JOIN pg_authid AS U ON (S.usesysid = U.oid);
@@ -787,6 +798,7 @@ CREATE VIEW pg_stat_wal_receiver AS
             s.status,
             s.receive_start_lsn,
             s.receive_start_tli,
+            s.written_lsn,
             s.received_lsn,
             s.received_tli,
             s.last_msg_send_time,
@@ -932,6 +944,52 @@ CREATE VIEW pg_stat_archiver AS
         s.stats_reset
     FROM pg_stat_get_archiver() s;
 
+CREATE VIEW pg_stat_lwlocks AS
+    SELECT
+        s.tranche,
+        s.shared_acquires,
+        s.exclusive_acquires,
+        s.blocks,
+        s.spin_delays,
+        s.wait_time,
+        s.wait_histogram
+    FROM pg_stat_get_lwlocks() s;
+
+CREATE VIEW pg_stat_wait_sampling AS
+    SELECT
+        s.backend_type,
+        s.wait_event_type,
+        s.wait_event,
+        s.queryid,
+        s.samples
+    FROM pg_stat_get_wait_sampling_profile() s;
+
+CREATE VIEW pg_stat_wait_sampling_history AS
+    SELECT
+        s.sample_time,
+        s.pid,
+        s.backend_type,
+        s.wait_event_type,
+        s.wait_event,
+        s.queryid
+    FROM pg_stat_get_wait_sampling_history() s;
+
+CREATE VIEW pg_stat_catalog_caches AS
+    SELECT
+        s.cache_type,
+        s.cache_id,
+        s.relid::regclass AS catalog,
+        s.indexrelid::regclass AS index,
+        s.entries,
+        s.negative_entries,
+        s.lists,
+        s.memory_bytes,
+        s.searches,
+        s.hits,
+        s.negative_hits,
+        s.evictions
+    FROM pg_stat_get_catalog_caches() s;
+
 CREATE VIEW pg_stat_bgwriter AS
     SELECT
         pg_stat_get_bgwriter_timed_checkpoints() AS checkpoints_timed,
@@ -1058,7 +1116,8 @@ REVOKE ALL ON pg_replication_origin_status FROM public;
 
 -- All columns of pg_subscription except subconninfo are readable.
 REVOKE ALL ON pg_subscription FROM public;
-GRANT SELECT (subdbid, subname, subowner, subenabled, subslotname, subpublications)
+GRANT SELECT (subdbid, subname, subowner, subenabled, subbinary,
+              subslotname, subpublications)
     ON pg_subscription TO public;
 
 
@@ -1312,6 +1371,7 @@ REVOKE EXECUTE ON FUNCTION pg_stat_reset() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
+REVOKE EXECUTE ON FUNCTION pg_stat_reset_wait_sampling() FROM public;
 
 REVOKE EXECUTE ON FUNCTION lo_import(text) FROM public;
 REVOKE EXECUTE ON FUNCTION lo_import(text, oid) FROM public;
@@ -1319,6 +1379,8 @@ REVOKE EXECUTE ON FUNCTION lo_export(oid, text) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_ls_logdir() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_waldir() FROM public;
+REVOKE EXECUTE ON FUNCTION pg_available_wal_summaries() FROM public;
+REVOKE EXECUTE ON FUNCTION pg_wal_summary_contents(pg_lsn, pg_lsn) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_archive_statusdir() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_tmpdir() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_tmpdir(oid) FROM public;
@@ -18,6 +18,7 @@
 
 #include "access/genam.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -38,9 +39,11 @@
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/paths.h"
 #include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
@@ -51,6 +54,8 @@
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/attoptcache.h"
 #include "utils/builtins.h"
@@ -61,6 +66,7 @@
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
 #include "utils/sampling.h"
+#include "utils/snapmgr.h"
 #include "utils/sortsupport.h"
 #include "utils/syscache.h"
 #include "utils/timestamp.h"
@@ -76,12 +82,70 @@ typedef struct AnlIndexData
 } AnlIndexData;
 
 
+/*
+ * Number of sample blocks a process takes at a time when the sample rows are
+ * collected in parallel.
+ */
+#define PARALLEL_ANALYZE_CHUNK				32
+
+/* Size of the queue each parallel worker sends its sample rows on */
+#define PARALLEL_ANALYZE_QUEUE_SIZE			65536
+
+/* DSM keys for parallel sample collection */
+#define PARALLEL_ANALYZE_KEY_SHARED			1
+#define PARALLEL_ANALYZE_KEY_BLOCKS			2
+#define PARALLEL_ANALYZE_KEY_QUEUES			3
+#define PARALLEL_ANALYZE_KEY_BUFFER_USAGE	4
+#define PARALLEL_ANALYZE_KEY_QUERY_TEXT		5
+#define PARALLEL_ANALYZE_KEY_WAL_USAGE		6
+
+/* Result of collecting a sample from some of the sample blocks */
+typedef struct AnlSampleResult
+{
+	int			numrows;		/* # rows in the sample */
+	double		samplerows;		/* # rows the sample was drawn from */
+	double		liverows;		/* # live rows seen */
+	double		deadrows;		/* # dead rows seen */
+} AnlSampleResult;
+
+/* A sample collected by one process, as seen by the leader */
+typedef struct AnlSample
+{
+	HeapTuple  *rows;
+	int			numrows;
+	double		samplerows;
+} AnlSample;
+
+/*
+ * Shared information for parallel sample collection, stored in the DSM
+ * segment.  The sample blocks are stored separately.
+ */
+typedef struct AnlParallelShared
+{
+	Oid			relid;
+	TransactionId OldestXmin;
+	int			targrows;
+	int			nblocks;		/* # of sample blocks */
+	long		randseed;		/* seed of the processes' random sequences */
+
+	/* Shared cost balance and # of active workers, as for parallel vacuum */
+	pg_atomic_uint32 cost_balance;
+	pg_atomic_uint32 active_nworkers;
+
+	/* # of sample blocks handed out so far */
+	pg_atomic_uint32 nallocated;
+
+	AnlSampleResult results[FLEXIBLE_ARRAY_MEMBER];	/* one per worker */
+} AnlParallelShared;
+
+
 /* Default statistics target (GUC parameter) */
 int			default_statistics_target = 100;
 
 /* A few variables that don't seem worth passing around as parameters */
 static MemoryContext anl_context = NULL;
 static BufferAccessStrategy vac_strategy;
+static int	anl_nworkers;
 
 
 static void do_analyze_rel(Relation onerel,
@@ -97,6 +161,20 @@ static VacAttrStats *examine_attribute(Relation onerel, int attnum,
 static int	acquire_sample_rows(Relation onerel, int elevel,
 								HeapTuple *rows, int targrows,
 								double *totalrows, double *totaldeadrows);
+static void sample_blocks(Relation onerel, BlockNumber *blocks, int nblocks,
+						  pg_atomic_uint32 *nallocated, int chunksize,
+						  TransactionId OldestXmin, long randseed,
+						  HeapTuple *rows, int targrows,
+						  AnlSampleResult *result);
+static int	compute_parallel_analyze_workers(Relation onerel, int nblocks);
+static int	acquire_sample_rows_parallel(Relation onerel, int elevel,
+										 BlockNumber *blocks, int nblocks,
+										 TransactionId OldestXmin,
+										 HeapTuple *rows, int targrows,
+										 int nworkers,
+										 double *liverows, double *deadrows);
+static int	merge_sample_rows(HeapTuple *rows, int targrows,
+							  AnlSample *samples, int nsamples);
 static int	compare_rows(const void *a, const void *b);
 static int	acquire_inherited_sample_rows(Relation onerel, int elevel,
 										  HeapTuple *rows, int targrows,
@@ -132,6 +210,7 @@ analyze_rel(Oid relid, RangeVar *relation,
 
 	/* Set up static variables */
 	vac_strategy = bstrategy;
+	anl_nworkers = params->nworkers;
 
 	/*
 	 * Check for user-requested abort.
@@ -989,10 +1068,10 @@ examine_attribute(Relation onerel, int attnum, Node *index_expr)
  * to targrows random blocks (or all blocks, if there aren't so many).
  * Stage two scans these blocks and uses the Vitter algorithm to create
  * a random sample of targrows rows (or less, if there are less in the
- * sample of blocks).  The two stages are executed simultaneously: each
- * block is processed as soon as stage one returns its number and while
- * the rows are read stage two controls which ones are to be inserted
- * into the sample.
+ * sample of blocks).  Stage one is done before stage two begins, so that
+ * the blocks can be prefetched, and divided among parallel workers when
+ * there are many of them.  Each worker then keeps its own sample of the
+ * rows it reads, and the samples are combined at the end.
  *
  * Although every row has an equal chance of ending up in the final
  * sample, this sampling method is not perfect: not every possible
@@ -1011,17 +1090,15 @@ acquire_sample_rows(Relation onerel, int elevel,
 					HeapTuple *rows, int targrows,
 					double *totalrows, double *totaldeadrows)
 {
-	int			numrows = 0;	/* # rows now in reservoir */
-	double		samplerows = 0; /* total # rows collected */
+	int			numrows;
 	double		liverows = 0;	/* # live rows seen */
 	double		deadrows = 0;	/* # dead rows seen */
-	double		rowstoskip = -1;	/* -1 means not set yet */
 	BlockNumber totalblocks;
 	TransactionId OldestXmin;
 	BlockSamplerData bs;
-	ReservoirStateData rstate;
-	TupleTableSlot *slot;
-	TableScanDesc scan;
+	BlockNumber *blocks;
+	int			nblocks = 0;
+	int			nworkers;
 
 	Assert(targrows > 0);
 
@@ -1030,115 +1107,688 @@ acquire_sample_rows(Relation onerel, int elevel,
 	/* Need a cutoff xmin for HeapTupleSatisfiesVacuum */
 	OldestXmin = GetOldestXmin(onerel, PROCARRAY_FLAGS_VACUUM);
 
-	/* Prepare for sampling block numbers */
+	/*
+	 * Select the sample blocks up front.  There are at most targrows of them,
+	 * so this doesn't take much memory, and it lets us prefetch them and
+	 * hand them out to parallel workers.
+	 */
 	BlockSampler_Init(&bs, totalblocks, targrows, random());
+	blocks = (BlockNumber *) palloc(sizeof(BlockNumber) *
+									Max(Min(totalblocks, targrows), 1));
+	while (BlockSampler_HasMore(&bs))
+		blocks[nblocks++] = BlockSampler_Next(&bs);
+
+	nworkers = compute_parallel_analyze_workers(onerel, nblocks);
+	if (nworkers > 0)
+		numrows = acquire_sample_rows_parallel(onerel, elevel, blocks, nblocks,
+											   OldestXmin, rows, targrows,
+											   nworkers, &liverows, &deadrows);
+	else
+	{
+		AnlSampleResult result;
+		pg_atomic_uint32 nallocated;
+
+		pg_atomic_init_u32(&nallocated, 0);
+		sample_blocks(onerel, blocks, nblocks, &nallocated, Max(nblocks, 1),
+					  OldestXmin, random(), rows, targrows, &result);
+		numrows = result.numrows;
+		liverows = result.liverows;
+		deadrows = result.deadrows;
+
+		/*
+		 * If we didn't find as many tuples as we wanted then we're done. No
+		 * sort is needed, since they're already in order.
+		 *
+		 * Otherwise we need to sort the collected tuples by position
+		 * (itempointer). It's not worth worrying about corner cases where the
+		 * tuples are already sorted.
+		 */
+		if (numrows == targrows)
+			qsort((void *) rows, numrows, sizeof(HeapTuple), compare_rows);
+	}
+
+	pfree(blocks);
+
+	/*
+	 * Estimate total numbers of live and dead rows in relation, extrapolating
+	 * on the assumption that the average tuple density in pages we didn't
+	 * scan is the same as in the pages we did scan.  Since what we scanned is
+	 * a random sample of the pages in the relation, this should be a good
+	 * assumption.
+	 */
+	if (nblocks > 0)
+	{
+		*totalrows = floor((liverows / nblocks) * totalblocks + 0.5);
+		*totaldeadrows = floor((deadrows / nblocks) * totalblocks + 0.5);
+	}
+	else
+	{
+		*totalrows = 0.0;
+		*totaldeadrows = 0.0;
+	}
+
+	/*
+	 * Emit some interesting relation info
+	 */
+	ereport(elevel,
+			(errmsg("\"%s\": scanned %d of %u pages, "
+					"containing %.0f live rows and %.0f dead rows; "
+					"%d rows in sample, %.0f estimated total rows",
+					RelationGetRelationName(onerel),
+					nblocks, totalblocks,
+					liverows, deadrows,
+					numrows, *totalrows)));
+
+	return numrows;
+}
+
+/*
+ * sample_blocks -- collect a sample of the rows in some of the sample blocks
+ *
+ * blocks[] holds the nblocks sample blocks.  We repeatedly take the next
+ * chunksize of them not yet taken by another process, as counted by
+ * *nallocated, and read them, and use the Vitter algorithm to keep a random
+ * sample of up to targrows of the rows found in them in rows[].  randseed
+ * seeds the random choices.  The sample size and row counts are returned in
+ * *result.
+ */
+static void
+sample_blocks(Relation onerel, BlockNumber *blocks, int nblocks,
+			  pg_atomic_uint32 *nallocated, int chunksize,
+			  TransactionId OldestXmin, long randseed,
+			  HeapTuple *rows, int targrows, AnlSampleResult *result)
+{
+	int			numrows = 0;	/* # rows now in reservoir */
+	double		samplerows = 0; /* total # rows collected */
+	double		liverows = 0;	/* # live rows seen */
+	double		deadrows = 0;	/* # dead rows seen */
+	double		rowstoskip = -1;	/* -1 means not set yet */
+	ReservoirStateData rstate;
+	TupleTableSlot *slot;
+	TableScanDesc scan;
+#ifdef USE_PREFETCH
+	double		prefetch_target;
+	int			prefetch_distance = 0;
+
+	if (ComputeIoConcurrency(maintenance_io_concurrency, &prefetch_target))
+		prefetch_distance = (int) rint(prefetch_target);
+#endif
+
 	/* Prepare for sampling rows */
 	reservoir_init_selection_state(&rstate, targrows);
+	sampler_random_init_state(randseed, rstate.randstate);
 
 	scan = table_beginscan_analyze(onerel);
 	slot = table_slot_create(onerel, NULL);
 
-	/* Outer loop over blocks to sample */
-	while (BlockSampler_HasMore(&bs))
+	for (;;)
 	{
-		BlockNumber targblock = BlockSampler_Next(&bs);
+		int			start;
+		int			end;
+		int			i;
 
-		vacuum_delay_point();
+		start = (int) Min(pg_atomic_fetch_add_u32(nallocated, chunksize),
+						  (uint32) nblocks);
+		if (start >= nblocks)
+			break;
+		end = Min(nblocks, start + chunksize);
 
-		if (!table_scan_analyze_next_block(scan, targblock, vac_strategy))
-			continue;
+#ifdef USE_PREFETCH
 
-		while (table_scan_analyze_next_tuple(scan, OldestXmin, &liverows, &deadrows, slot))
+		/*
+		 * The sample blocks are scattered all over the table, so OS readahead
+		 * is of no help.  Prefetch them instead, keeping prefetch_distance
+		 * blocks ahead of the block we read.
+		 */
+		for (i = start; i < end && i < start + prefetch_distance; i++)
+			PrefetchBuffer(onerel, MAIN_FORKNUM, blocks[i]);
+#endif
+
+		/* Loop over the blocks of the chunk */
+		for (i = start; i < end; i++)
 		{
-			/*
-			 * The first targrows sample rows are simply copied into the
-			 * reservoir. Then we start replacing tuples in the sample until
-			 * we reach the end of the relation.  This algorithm is from Jeff
-			 * Vitter's paper (see full citation in utils/misc/sampling.c). It
-			 * works by repeatedly computing the number of tuples to skip
-			 * before selecting a tuple, which replaces a randomly chosen
-			 * element of the reservoir (current set of tuples).  At all times
-			 * the reservoir is a true random sample of the tuples we've
-			 * passed over so far, so when we fall off the end of the relation
-			 * we're done.
-			 */
-			if (numrows < targrows)
-				rows[numrows++] = ExecCopySlotHeapTuple(slot);
-			else
+#ifdef USE_PREFETCH
+			if (prefetch_distance > 0 && i + prefetch_distance < end)
+				PrefetchBuffer(onerel, MAIN_FORKNUM,
+							   blocks[i + prefetch_distance]);
+#endif
+
+			vacuum_delay_point();
+
+			if (!table_scan_analyze_next_block(scan, blocks[i], vac_strategy))
+				continue;
+
+			while (table_scan_analyze_next_tuple(scan, OldestXmin, &liverows, &deadrows, slot))
 			{
 				/*
-				 * t in Vitter's paper is the number of records already
-				 * processed.  If we need to compute a new S value, we must
-				 * use the not-yet-incremented value of samplerows as t.
+				 * The first targrows sample rows are simply copied into the
+				 * reservoir. Then we start replacing tuples in the sample
+				 * until we reach the end of the blocks.  This algorithm is
+				 * from Jeff Vitter's paper (see full citation in
+				 * utils/misc/sampling.c). It works by repeatedly computing
+				 * the number of tuples to skip before selecting a tuple,
+				 * which replaces a randomly chosen element of the reservoir
+				 * (current set of tuples).  At all times the reservoir is a
+				 * true random sample of the tuples we've passed over so far,
+				 * so when we run out of blocks we're done.
 				 */
-				if (rowstoskip < 0)
-					rowstoskip = reservoir_get_next_S(&rstate, samplerows, targrows);
-
-				if (rowstoskip <= 0)
+				if (numrows < targrows)
+					rows[numrows++] = ExecCopySlotHeapTuple(slot);
+				else
 				{
 					/*
-					 * Found a suitable tuple, so save it, replacing one old
-					 * tuple at random
+					 * t in Vitter's paper is the number of records already
+					 * processed.  If we need to compute a new S value, we
+					 * must use the not-yet-incremented value of samplerows as
+					 * t.
 					 */
-					int			k = (int) (targrows * sampler_random_fract(rstate.randstate));
+					if (rowstoskip < 0)
+						rowstoskip = reservoir_get_next_S(&rstate, samplerows, targrows);
+
+					if (rowstoskip <= 0)
+					{
+						/*
+						 * Found a suitable tuple, so save it, replacing one
+						 * old tuple at random
+						 */
+						int			k = (int) (targrows * sampler_random_fract(rstate.randstate));
+
+						Assert(k >= 0 && k < targrows);
+						heap_freetuple(rows[k]);
+						rows[k] = ExecCopySlotHeapTuple(slot);
+					}
 
-					Assert(k >= 0 && k < targrows);
-					heap_freetuple(rows[k]);
-					rows[k] = ExecCopySlotHeapTuple(slot);
+					rowstoskip -= 1;
 				}
 
-				rowstoskip -= 1;
+				samplerows += 1;
 			}
-
-			samplerows += 1;
 		}
 	}
 
 	ExecDropSingleTupleTableSlot(slot);
 	table_endscan(scan);
 
+	result->numrows = numrows;
+	result->samplerows = samplerows;
+	result->liverows = liverows;
+	result->deadrows = deadrows;
+}
+
+/*
+ * compute_parallel_analyze_workers -- decide how many workers to use for
+ * collecting the sample rows
+ *
+ * This follows the heap scan of parallel vacuum, except that it is the
+ * number of sample blocks, not the size of the table, that is compared
+ * with min_parallel_table_scan_size.
+ */
+static int
+compute_parallel_analyze_workers(Relation onerel, int nblocks)
+{
+	int			parallel_workers;
+
+	/* Workers can't be launched from a standalone backend */
+	if (anl_nworkers < 0 || !IsUnderPostmaster ||
+		max_parallel_maintenance_workers == 0)
+		return 0;
+
 	/*
-	 * If we didn't find as many tuples as we wanted then we're done. No sort
-	 * is needed, since they're already in order.
-	 *
-	 * Otherwise we need to sort the collected tuples by position
-	 * (itempointer). It's not worth worrying about corner cases where the
-	 * tuples are already sorted.
+	 * Workers can't read temporary tables, and we need an active snapshot to
+	 * enter parallel mode.
 	 */
-	if (numrows == targrows)
-		qsort((void *) rows, numrows, sizeof(HeapTuple), compare_rows);
+	if (RelationUsesLocalBuffers(onerel) || IsInParallelMode() ||
+		!ActiveSnapshotSet())
+		return 0;
+
+	if (nblocks < min_parallel_table_scan_size)
+		return 0;
+
+	if (anl_nworkers > 0)
+		parallel_workers = anl_nworkers;
+	else
+	{
+		int64		threshold = Max(min_parallel_table_scan_size, 1);
+
+		parallel_workers = 1;
+		while ((int64) nblocks >= threshold * 3)
+		{
+			parallel_workers++;
+			threshold *= 3;
+		}
+	}
+
+	return Min(parallel_workers, max_parallel_maintenance_workers);
+}
+
+/*
+ * acquire_sample_rows_parallel -- collect the sample rows with the help of
+ * parallel workers
+ *
+ * The leader and the workers take chunks of PARALLEL_ANALYZE_CHUNK sample
+ * blocks at a time, each keeping its own random sample of up to targrows of
+ * the rows it finds.  The workers send their samples back to the leader
+ * through a shm_mq when they're done, and the leader combines the samples
+ * into rows[] with merge_sample_rows().  The result is sorted by physical
+ * position like that of the serial code.  The numbers of live and dead rows
+ * seen are returned in *liverows and *deadrows.
+ */
+static int
+acquire_sample_rows_parallel(Relation onerel, int elevel,
+							 BlockNumber *blocks, int nblocks,
+							 TransactionId OldestXmin,
+							 HeapTuple *rows, int targrows, int nworkers,
+							 double *liverows, double *deadrows)
+{
+	ParallelContext *pcxt;
+	AnlParallelShared *shared;
+	BlockNumber *sharedblocks;
+	char	   *queuespace = NULL;
+	shm_mq_handle **queues = NULL;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	AnlSample  *samples;
+	AnlSampleResult result;
+	Size		est_shared;
+	int			querylen = 0;
+	int			nsamples;
+	int			numrows;
+	int			i;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_analyze_main",
+								 nworkers);
+
+	/* Estimate size for shared information -- PARALLEL_ANALYZE_KEY_SHARED */
+	est_shared = add_size(offsetof(AnlParallelShared, results),
+						  mul_size(sizeof(AnlSampleResult), pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate size for the sample blocks -- PARALLEL_ANALYZE_KEY_BLOCKS */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BlockNumber), nblocks));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate size for the sample row queues -- PARALLEL_ANALYZE_KEY_QUEUES */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_ANALYZE_QUEUE_SIZE,
+									pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for BufferUsage -- PARALLEL_ANALYZE_KEY_BUFFER_USAGE */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Same for WalUsage -- PARALLEL_ANALYZE_KEY_WAL_USAGE */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_ANALYZE_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	InitializeParallelDSM(pcxt);
+
+	/* Store shared information */
+	shared = (AnlParallelShared *) shm_toc_allocate(pcxt->toc, est_shared);
+	MemSet(shared, 0, est_shared);
+	shared->relid = RelationGetRelid(onerel);
+	shared->OldestXmin = OldestXmin;
+	shared->targrows = targrows;
+	shared->nblocks = nblocks;
+	shared->randseed = random();
+	pg_atomic_init_u32(&(shared->cost_balance), 0);
+	pg_atomic_init_u32(&(shared->active_nworkers), 0);
+	pg_atomic_init_u32(&(shared->nallocated), 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_SHARED, shared);
+
+	sharedblocks = (BlockNumber *)
+		shm_toc_allocate(pcxt->toc, mul_size(sizeof(BlockNumber), nblocks));
+	memcpy(sharedblocks, blocks, sizeof(BlockNumber) * nblocks);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_BLOCKS, sharedblocks);
+
+	/* Set up a queue for each worker to send its sample rows back on */
+	if (pcxt->nworkers > 0)
+	{
+		queuespace = shm_toc_allocate(pcxt->toc,
+									  mul_size(PARALLEL_ANALYZE_QUEUE_SIZE,
+											   pcxt->nworkers));
+		queues = (shm_mq_handle **)
+			palloc(sizeof(shm_mq_handle *) * pcxt->nworkers);
+		for (i = 0; i < pcxt->nworkers; i++)
+		{
+			shm_mq	   *mq;
+
+			mq = shm_mq_create(queuespace +
+							   ((Size) i) * PARALLEL_ANALYZE_QUEUE_SIZE,
+							   (Size) PARALLEL_ANALYZE_QUEUE_SIZE);
+			shm_mq_set_receiver(mq, MyProc);
+			queues[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+		}
+		shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUEUES, queuespace);
+	}
+
+	/* Allocate space for each worker's BufferUsage; no need to initialize */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage),
+											 pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_BUFFER_USAGE, buffer_usage);
+
+	/* Same for WalUsage */
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT,
+					   sharedquery);
+	}
+
+	/* Share our cost balance, as for parallel vacuum */
+	if (VacuumCostActive)
+	{
+		pg_atomic_write_u32(&(shared->cost_balance), VacuumCostBalance);
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &(shared->cost_balance);
+		VacuumActiveNWorkers = &(shared->active_nworkers);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	ereport(elevel,
+			(errmsg(ngettext("launched %d parallel analyze worker for sampling \"%s\" (planned: %d)",
+							 "launched %d parallel analyze workers for sampling \"%s\" (planned: %d)",
+							 pcxt->nworkers_launched),
+					pcxt->nworkers_launched, RelationGetRelationName(onerel),
+					nworkers)));
+
+	/* Let the queues notice if a worker dies before attaching */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		shm_mq_set_handle(queues[i], pcxt->worker[i].bgwhandle);
+
+	/* Take our share of the blocks */
+	nsamples = pcxt->nworkers_launched + 1;
+	samples = (AnlSample *) palloc(sizeof(AnlSample) * nsamples);
+	samples[0].rows = (HeapTuple *) palloc(sizeof(HeapTuple) * targrows);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	sample_blocks(onerel, sharedblocks, nblocks, &(shared->nallocated),
+				  PARALLEL_ANALYZE_CHUNK, OldestXmin, shared->randseed,
+				  samples[0].rows, targrows, &result);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	samples[0].numrows = result.numrows;
+	samples[0].samplerows = result.samplerows;
+	*liverows = result.liverows;
+	*deadrows = result.deadrows;
+
+	/* Receive the workers' samples */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+	{
+		AnlSample  *sample = &samples[i + 1];
+
+		sample->rows = (HeapTuple *) palloc(sizeof(HeapTuple) * targrows);
+		sample->numrows = 0;
+
+		for (;;)
+		{
+			shm_mq_result res;
+			Size		nbytes;
+			void	   *data;
+			HeapTuple	tuple;
+			Size		len;
+
+			res = shm_mq_receive(queues[i], &nbytes, &data, false);
+			if (res == SHM_MQ_DETACHED)
+				break;
+			Assert(res == SHM_MQ_SUCCESS);
+
+			if (nbytes < sizeof(ItemPointerData) ||
+				sample->numrows >= targrows)
+				elog(ERROR, "invalid sample row received from parallel analyze worker");
+
+			/* Each message is the TID followed by the tuple data */
+			len = nbytes - sizeof(ItemPointerData);
+			tuple = (HeapTuple) palloc(HEAPTUPLESIZE + len);
+			tuple->t_len = len;
+			memcpy(&tuple->t_self, data, sizeof(ItemPointerData));
+			tuple->t_tableOid = RelationGetRelid(onerel);
+			tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+			memcpy(tuple->t_data, (char *) data + sizeof(ItemPointerData), len);
+
+			sample->rows[sample->numrows++] = tuple;
+		}
+	}
+
+	/* Wait for all workers to finish */
+	WaitForParallelWorkersToFinish(pcxt);
 
 	/*
-	 * Estimate total numbers of live and dead rows in relation, extrapolating
-	 * on the assumption that the average tuple density in pages we didn't
-	 * scan is the same as in the pages we did scan.  Since what we scanned is
-	 * a random sample of the pages in the relation, this should be a good
-	 * assumption.
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
 	 */
-	if (bs.m > 0)
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	/* Take back the cost balance accumulated by everyone */
+	if (VacuumSharedCostBalance)
 	{
-		*totalrows = floor((liverows / bs.m) * totalblocks + 0.5);
-		*totaldeadrows = floor((deadrows / bs.m) * totalblocks + 0.5);
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
 	}
-	else
+
+	/* Add up the workers' counts */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
 	{
-		*totalrows = 0.0;
-		*totaldeadrows = 0.0;
+		AnlSampleResult *wresult = &(shared->results[i]);
+
+		if (samples[i + 1].numrows != wresult->numrows)
+			elog(ERROR, "parallel analyze worker sent %d sample rows, expected %d",
+				 samples[i + 1].numrows, wresult->numrows);
+		samples[i + 1].samplerows = wresult->samplerows;
+		*liverows += wresult->liverows;
+		*deadrows += wresult->deadrows;
 	}
 
+	for (i = 0; i < pcxt->nworkers; i++)
+		shm_mq_detach(queues[i]);
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	numrows = merge_sample_rows(rows, targrows, samples, nsamples);
+
+	for (i = 0; i < nsamples; i++)
+		pfree(samples[i].rows);
+	pfree(samples);
+
+	/* The samples interleave, so we must always sort */
+	qsort((void *) rows, numrows, sizeof(HeapTuple), compare_rows);
+
+	return numrows;
+}
+
+/*
+ * merge_sample_rows -- combine the samples collected by the participants of
+ * a parallel sample collection
+ *
+ * Each samples[i] is a random sample of numrows of the samplerows rows one
+ * process passed over, so that numrows = Min(samplerows, targrows).  We draw
+ * up to targrows rows from their union without replacement: each draw first
+ * picks a process, with probability proportional to the number of its rows
+ * not drawn yet, and then a random row of that process's sample.  Since no
+ * process is picked more often than it has rows in its sample, the result is
+ * a random sample of all the rows passed over, just as if one process had
+ * read all the blocks.  The rows not chosen are freed.
+ */
+static int
+merge_sample_rows(HeapTuple *rows, int targrows,
+				  AnlSample *samples, int nsamples)
+{
+	SamplerRandomState randstate;
+	double		remaining = 0;
+	int			numrows = 0;
+	int			i;
+
+	for (i = 0; i < nsamples; i++)
+		remaining += samples[i].samplerows;
+
+	sampler_random_init_state(random(), randstate);
+
+	while (numrows < targrows && remaining > 0)
+	{
+		double		r = remaining * sampler_random_fract(randstate);
+		AnlSample  *sample = NULL;
+		int			k;
+
+		for (i = 0; i < nsamples; i++)
+		{
+			if (samples[i].numrows == 0)
+				continue;
+			sample = &samples[i];
+			if (r < samples[i].samplerows)
+				break;
+			r -= samples[i].samplerows;
+		}
+		if (sample == NULL)
+			break;
+
+		k = (int) (sample->numrows * sampler_random_fract(randstate));
+		Assert(k >= 0 && k < sample->numrows);
+		rows[numrows++] = sample->rows[k];
+		sample->rows[k] = sample->rows[--sample->numrows];
+		sample->samplerows -= 1;
+		remaining -= 1;
+	}
+
+	/* Free the rows we didn't take */
+	for (i = 0; i < nsamples; i++)
+	{
+		int			j;
+
+		for (j = 0; j < samples[i].numrows; j++)
+			heap_freetuple(samples[i].rows[j]);
+	}
+
+	return numrows;
+}
+
+/*
+ * Perform work within a launched parallel process for ANALYZE: collect a
+ * sample of the rows in the sample blocks we get, and send it to the leader.
+ */
+void
+parallel_analyze_main(dsm_segment *seg, shm_toc *toc)
+{
+	Relation	onerel;
+	AnlParallelShared *shared;
+	BlockNumber *blocks;
+	char	   *queuespace;
+	shm_mq_handle *mqh;
+	shm_mq	   *mq;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	char	   *sharedquery;
+	AnlSampleResult *result;
+	HeapTuple  *rows;
+	int			i;
+
+	shared = (AnlParallelShared *) shm_toc_lookup(toc,
+												  PARALLEL_ANALYZE_KEY_SHARED,
+												  false);
+	blocks = (BlockNumber *) shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_BLOCKS,
+											false);
+	result = &(shared->results[ParallelWorkerNumber]);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Attach to our queue as its sender */
+	queuespace = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ((Size) ParallelWorkerNumber) * PARALLEL_ANALYZE_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
 	/*
-	 * Emit some interesting relation info
+	 * The leader holds a stronger lock on the table, so just make sure it
+	 * doesn't go away under us.
 	 */
-	ereport(elevel,
-			(errmsg("\"%s\": scanned %d of %u pages, "
-					"containing %.0f live rows and %.0f dead rows; "
-					"%d rows in sample, %.0f estimated total rows",
-					RelationGetRelationName(onerel),
-					bs.m, totalblocks,
-					liverows, deadrows,
-					numrows, *totalrows)));
+	onerel = table_open(shared->relid, AccessShareLock);
+
+	/* Set cost-based vacuum delay */
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	VacuumCostBalanceLocal = 0;
+	VacuumSharedCostBalance = &(shared->cost_balance);
+	VacuumActiveNWorkers = &(shared->active_nworkers);
+
+	/* Set up vacuum access strategy */
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	if (VacuumCostActive)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/* Give each process its own random sequence */
+	rows = (HeapTuple *) palloc(sizeof(HeapTuple) * shared->targrows);
+	sample_blocks(onerel, blocks, shared->nblocks, &(shared->nallocated),
+				  PARALLEL_ANALYZE_CHUNK, shared->OldestXmin,
+				  shared->randseed + ParallelWorkerNumber + 1,
+				  rows, shared->targrows, result);
+
+	if (VacuumCostActive)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	/* Send the sample to the leader */
+	for (i = 0; i < result->numrows; i++)
+	{
+		shm_mq_iovec iov[2];
 
-	return numrows;
+		iov[0].data = (char *) &(rows[i]->t_self);
+		iov[0].len = sizeof(ItemPointerData);
+		iov[1].data = (char *) rows[i]->t_data;
+		iov[1].len = rows[i]->t_len;
+		if (shm_mq_sendv(mqh, iov, 2, false, false) != SHM_MQ_SUCCESS)
+			break;
+	}
+	shm_mq_detach(mqh);
+
+	/* Report buffer and WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_BUFFER_USAGE,
+								  false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	table_close(onerel, AccessShareLock);
+	FreeAccessStrategy(vac_strategy);
 }
 
 /*
@@ -392,6 +392,15 @@ cluster_rel(Oid tableOid, Oid indexOid, int options)
 					 errmsg("cannot vacuum temporary tables of other sessions")));
 	}
 
+	/*
+	 * A global temporary table's storage is shared by name among all the
+	 * sessions using it, so we can't swap in a new relfilenode.
+	 */
+	if (RELATION_IS_GLOBAL_TEMP(OldHeap))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot cluster global temporary tables")));
+
 	/*
 	 * Also check for active uses of the relation in the current transaction,
 	 * including open scans and pending AFTER trigger events.
@@ -1557,6 +1566,10 @@ get_tables_to_cluster(MemoryContext cluster_context)
 		if (!pg_class_ownercheck(index->indrelid, GetUserId()))
 			continue;
 
+		/* global temporary tables can't be clustered, see cluster_rel */
+		if (get_rel_persistence(index->indrelid) == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		/*
 		 * We have to build the list in a different memory context so it will
 		 * survive the cross-transaction processing
@@ -18,20 +18,24 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/dependency.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
 #include "commands/trigger.h"
 #include "executor/execPartition.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "executor/nodeModifyTable.h"
 #include "executor/tuptable.h"
 #include "foreign/fdwapi.h"
@@ -41,15 +45,22 @@
 #include "miscadmin.h"
 #include "optimizer/optimizer.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_relation.h"
+#include "pgstat.h"
 #include "port/pg_bswap.h"
+#include "port/simd.h"
+#include "postmaster/bgworker_internals.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/condition_variable.h"
 #include "storage/fd.h"
+#include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/partcache.h"
@@ -154,6 +165,7 @@ typedef struct CopyStateData
 	List	   *convert_select; /* list of column names (can be NIL) */
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
+	int			nworkers;		/* PARALLEL workers requested, or 0 */
 
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
@@ -224,6 +236,15 @@ typedef struct CopyStateData
 	char	   *raw_buf;
 	int			raw_buf_index;	/* next byte to process */
 	int			raw_buf_len;	/* total # of bytes stored */
+
+	/*
+	 * In a parallel COPY FROM worker, lines come from the leader via pcshared
+	 * rather than from raw_buf; see ParallelCopyGetLine.
+	 */
+	struct ParallelCopyShared *pcshared;
+	uint64		pc_seq;			/* sequence number of current chunk */
+	int			pc_offset;		/* next byte to read in current chunk */
+	int			pc_nlines;		/* lines left to read in current chunk */
 } CopyStateData;
 
 /* DestReceiver for COPY (query) TO */
@@ -262,6 +283,7 @@ typedef struct CopyMultiInsertBuffer
 	ResultRelInfo *resultRelInfo;	/* ResultRelInfo for 'relid' */
 	BulkInsertState bistate;	/* BulkInsertState for this rel */
 	int			nused;			/* number of 'slots' containing tuples */
+	uint64		lastused;		/* value of useCounter when last switched to */
 	uint64		linenos[MAX_BUFFERED_TUPLES];	/* Line # of tuple in copy
 												 * stream */
 } CopyMultiInsertBuffer;
@@ -276,12 +298,79 @@ typedef struct CopyMultiInsertInfo
 	List	   *multiInsertBuffers; /* List of tracked CopyMultiInsertBuffers */
 	int			bufferedTuples; /* number of tuples buffered over all buffers */
 	int			bufferedBytes;	/* number of bytes from all buffered tuples */
+	uint64		useCounter;		/* bumped whenever we switch buffers */
 	CopyState	cstate;			/* Copy state for this CopyMultiInsertInfo */
 	EState	   *estate;			/* Executor state used for COPY */
 	CommandId	mycid;			/* Command Id used for COPY */
 	int			ti_options;		/* table insert options */
 } CopyMultiInsertInfo;
 
+/*
+ * Parallel COPY FROM.
+ *
+ * The leader reads the input and splits it into lines with CopyReadLine, as
+ * a serial COPY would, and appends the lines to chunks in a ring buffer in
+ * dynamic shared memory.  Each worker claims a whole chunk at a time, and
+ * parses and inserts its lines by running an ordinary CopyFrom whose lines
+ * come from the chunk instead of the input.
+ *
+ * Within a chunk, each line is stored as its length (a uint32, possibly
+ * unaligned) followed by its bytes, already converted to the server encoding.
+ * A line that doesn't fit in a single chunk is spread over 'nchunks'
+ * consecutive chunks; the worker that claims the first of them reads the
+ * others as well.
+ */
+#define PARALLEL_KEY_COPY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_COPY_INFO			UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xC000000000000004)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xC000000000000005)
+
+#define PARALLEL_COPY_CHUNK_SIZE		(64 * 1024)
+#define PARALLEL_COPY_CHUNKS_PER_WORKER	4
+
+typedef struct ParallelCopyChunk
+{
+	uint64		first_lineno;	/* line number of the first line */
+	int			nlines;			/* number of lines starting in this chunk */
+	int			used;			/* bytes of data[] in use */
+	int			nchunks;		/* chunks spanned by the data, 0 for the
+								 * continuation of a long line */
+	bool		filled;			/* published by the leader, not yet released
+								 * by the worker; protected by mutex */
+	char		data[PARALLEL_COPY_CHUNK_SIZE];
+} ParallelCopyChunk;
+
+typedef struct ParallelCopyShared
+{
+	/* Immutable state */
+	Oid			relid;			/* target relation */
+	int			nchunks;		/* size of the chunks[] ring */
+
+	/* Mutable state, protected by mutex */
+	slock_t		mutex;
+	uint64		nfilled;		/* chunks published by the leader so far */
+	uint64		nclaimed;		/* chunks claimed by workers so far */
+	bool		eof;			/* leader has published all chunks */
+	uint64		processed;		/* tuples processed by workers */
+
+	ConditionVariable data_cv;	/* signaled when a chunk is published */
+	ConditionVariable space_cv; /* signaled when a chunk is released */
+
+	ParallelCopyChunk chunks[FLEXIBLE_ARRAY_MEMBER];
+} ParallelCopyShared;
+
+#define ParallelCopyGetChunk(pcshared, seq) \
+	(&(pcshared)->chunks[(seq) % (pcshared)->nchunks])
+
+/* Leader's state while distributing lines */
+typedef struct ParallelCopyLeader
+{
+	ParallelCopyShared *pcshared;
+	ParallelCopyChunk *chunk;	/* chunk being filled, or NULL */
+	uint64		seq;			/* sequence number of the next chunk */
+} ParallelCopyLeader;
+
 
 /*
  * These macros centralize code used to process line_buf and raw_buf buffers.
@@ -372,6 +461,7 @@ static Datum CopyReadBinaryAttribute(CopyState cstate,
 									 int column_no, FmgrInfo *flinfo,
 									 Oid typioparam, int32 typmod,
 									 bool *isnull);
+static char *CopyOutputValue(FmgrInfo *flinfo, Datum value, char *numbuf);
 static void CopyAttributeOutText(CopyState cstate, char *string);
 static void CopyAttributeOutCSV(CopyState cstate, char *string,
 								bool use_quote, bool single_attr);
@@ -394,6 +484,20 @@ static bool CopyGetInt32(CopyState cstate, int32 *val);
 static void CopySendInt16(CopyState cstate, int16 val);
 static bool CopyGetInt16(CopyState cstate, int16 *val);
 
+static uint64 ParallelCopyFrom(CopyState cstate, List *attnamelist,
+							   List *options);
+static bool CopyFromParallelSafe(CopyState cstate);
+static bool copy_parallel_unsafe_walker(Node *node, void *context);
+static void ParallelCopyPutLine(ParallelCopyLeader *pcleader,
+								const char *line, int len, uint64 lineno);
+static ParallelCopyChunk *ParallelCopyNextFreeChunk(ParallelCopyLeader *pcleader);
+static void ParallelCopyPublishChunk(ParallelCopyShared *pcshared,
+									 ParallelCopyChunk *chunk);
+static void ParallelCopyReleaseChunk(ParallelCopyShared *pcshared,
+									 ParallelCopyChunk *chunk);
+static bool ParallelCopyGetLine(CopyState cstate);
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
+
 
 /*
  * Send copy start/stop messages for frontend copies.  These have changed
@@ -1069,7 +1173,11 @@ DoCopy(ParseState *pstate, const CopyStmt *stmt,
 		cstate = BeginCopyFrom(pstate, rel, stmt->filename, stmt->is_program,
 							   NULL, stmt->attlist, stmt->options);
 		cstate->whereClause = whereClause;
-		*processed = CopyFrom(cstate);	/* copy from file to database */
+		if (cstate->nworkers > 0)
+			*processed = ParallelCopyFrom(cstate, stmt->attlist,
+										  stmt->options);
+		else
+			*processed = CopyFrom(cstate);	/* copy from file to database */
 		EndCopyFrom(cstate);
 	}
 	else
@@ -1114,6 +1222,7 @@ ProcessCopyOptions(ParseState *pstate,
 				   List *options)
 {
 	bool		format_specified = false;
+	bool		parallel_specified = false;
 	ListCell   *option;
 
 	/* Support external use for option sanity checking */
@@ -1291,6 +1400,23 @@ ProcessCopyOptions(ParseState *pstate,
 								defel->defname),
 						 parser_errposition(pstate, defel->location)));
 		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (parallel_specified)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			parallel_specified = true;
+			cstate->nworkers = defGetInt32(defel);
+			if (cstate->nworkers < 0 ||
+				cstate->nworkers > MAX_PARALLEL_WORKER_LIMIT)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("argument to option \"%s\" must be between %d and %d",
+								defel->defname, 0, MAX_PARALLEL_WORKER_LIMIT),
+						 parser_errposition(pstate, defel->location)));
+		}
 		else
 			ereport(ERROR,
 					(errcode(ERRCODE_SYNTAX_ERROR),
@@ -1429,6 +1555,16 @@ ProcessCopyOptions(ParseState *pstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("COPY force null only available using COPY FROM")));
 
+	/* Check parallel */
+	if (cstate->nworkers > 0 && !is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY parallel only available using COPY FROM")));
+	if (cstate->nworkers > 0 && cstate->binary)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("cannot specify PARALLEL in BINARY mode")));
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(cstate->null_print, cstate->delim[0]) != NULL)
 		ereport(ERROR,
@@ -2203,8 +2339,10 @@ CopyOneRowTo(CopyState cstate, TupleTableSlot *slot)
 		{
 			if (!cstate->binary)
 			{
-				string = OutputFunctionCall(&out_functions[attnum - 1],
-											value);
+				char		numbuf[MAXINT8LEN + 1];
+
+				string = CopyOutputValue(&out_functions[attnum - 1], value,
+										 numbuf);
 				if (cstate->csv_mode)
 					CopyAttributeOutCSV(cstate, string,
 										cstate->force_quote_flags[attnum - 1],
@@ -2216,6 +2354,12 @@ CopyOneRowTo(CopyState cstate, TupleTableSlot *slot)
 			{
 				bytea	   *outputbytes;
 
+				/* Common fixed-width types can go straight into fe_msgbuf */
+				if (pq_sendfixedbinary(cstate->fe_msgbuf,
+									   out_functions[attnum - 1].fn_oid,
+									   value))
+					continue;
+
 				outputbytes = SendFunctionCall(&out_functions[attnum - 1],
 											   value);
 				CopySendInt32(cstate, VARSIZE(outputbytes) - VARHDRSZ);
@@ -2230,6 +2374,37 @@ CopyOneRowTo(CopyState cstate, TupleTableSlot *slot)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Convert one non-null column value to text for COPY TO.
+ *
+ * For the commonest built-in output functions we produce the same string
+ * inline, saving a trip through fmgr per value.  Integers are formatted
+ * into the caller's numbuf, which must hold at least MAXINT8LEN + 1
+ * bytes; anything else is palloc'd in the current (per-row) context.
+ */
+static char *
+CopyOutputValue(FmgrInfo *flinfo, Datum value, char *numbuf)
+{
+	switch (flinfo->fn_oid)
+	{
+		case F_INT2OUT:
+			pg_itoa(DatumGetInt16(value), numbuf);
+			return numbuf;
+		case F_INT4OUT:
+			pg_ltoa(DatumGetInt32(value), numbuf);
+			return numbuf;
+		case F_INT8OUT:
+			pg_lltoa(DatumGetInt64(value), numbuf);
+			return numbuf;
+		case F_TEXTOUT:
+		case F_VARCHAROUT:
+		case F_BPCHAROUT:
+			return TextDatumGetCString(value);
+		default:
+			return OutputFunctionCall(flinfo, value);
+	}
+}
+
 
 /*
  * error context callback for COPY FROM
@@ -2356,6 +2531,7 @@ CopyMultiInsertBufferInit(ResultRelInfo *rri)
 	buffer->resultRelInfo = rri;
 	buffer->bistate = GetBulkInsertState();
 	buffer->nused = 0;
+	buffer->lastused = 0;
 
 	return buffer;
 }
@@ -2391,6 +2567,7 @@ CopyMultiInsertInfoInit(CopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 	miinfo->multiInsertBuffers = NIL;
 	miinfo->bufferedTuples = 0;
 	miinfo->bufferedBytes = 0;
+	miinfo->useCounter = 0;
 	miinfo->cstate = cstate;
 	miinfo->estate = estate;
 	miinfo->mycid = mycid;
@@ -2541,11 +2718,39 @@ CopyMultiInsertBufferCleanup(CopyMultiInsertInfo *miinfo,
 	pfree(buffer);
 }
 
+/*
+ * Mark the buffer for 'rri' as the most recently used one.  Buffers that
+ * haven't been used for the longest time are the first to go when
+ * CopyMultiInsertInfoFlush trims the list.
+ */
+static inline void
+CopyMultiInsertInfoTouchBuffer(CopyMultiInsertInfo *miinfo,
+							   ResultRelInfo *rri)
+{
+	rri->ri_CopyMultiInsertBuffer->lastused = ++miinfo->useCounter;
+}
+
+/*
+ * list_qsort comparator to order buffers from least to most recently used.
+ */
+static int
+CopyMultiInsertBufferCmpLastUsed(const void *a, const void *b)
+{
+	CopyMultiInsertBuffer *ba = (CopyMultiInsertBuffer *) lfirst(*(ListCell **) a);
+	CopyMultiInsertBuffer *bb = (CopyMultiInsertBuffer *) lfirst(*(ListCell **) b);
+
+	if (ba->lastused < bb->lastused)
+		return -1;
+	if (ba->lastused > bb->lastused)
+		return 1;
+	return 0;
+}
+
 /*
  * Write out all stored tuples in all buffers out to the tables.
  *
  * Once flushed we also trim the tracked buffers list down to size by removing
- * the buffers created earliest first.
+ * the least recently used buffers first.
  *
  * Callers should pass 'curr_rri' is the ResultRelInfo that's currently being
  * used.  When cleaning up old buffers we'll never remove the one for
@@ -2568,10 +2773,20 @@ CopyMultiInsertInfoFlush(CopyMultiInsertInfo *miinfo, ResultRelInfo *curr_rri)
 
 	/*
 	 * Trim the list of tracked buffers down if it exceeds the limit.  Here we
-	 * remove buffers starting with the ones we created first.  It seems more
-	 * likely that these older ones are less likely to be needed than ones
-	 * that were just created.
+	 * remove the buffers that have gone unused the longest, so that the
+	 * partitions currently receiving rows keep their buffers (and their
+	 * BulkInsertState's pinned target page) across flushes.
 	 */
+	if (list_length(miinfo->multiInsertBuffers) > MAX_PARTITION_BUFFERS)
+	{
+		List	   *sorted;
+
+		sorted = list_qsort(miinfo->multiInsertBuffers,
+							CopyMultiInsertBufferCmpLastUsed);
+		list_free(miinfo->multiInsertBuffers);
+		miinfo->multiInsertBuffers = sorted;
+	}
+
 	while (list_length(miinfo->multiInsertBuffers) > MAX_PARTITION_BUFFERS)
 	{
 		CopyMultiInsertBuffer *buffer;
@@ -2669,7 +2884,7 @@ CopyFrom(CopyState cstate)
 
 	PartitionTupleRouting *proute = NULL;
 	ErrorContextCallback errcallback;
-	CommandId	mycid = GetCurrentCommandId(true);
+	CommandId	mycid;
 	int			ti_options = 0; /* start with default options for insert */
 	BulkInsertState bistate = NULL;
 	CopyInsertMethod insertMethod;
@@ -2681,6 +2896,12 @@ CopyFrom(CopyState cstate)
 
 	Assert(cstate->rel);
 
+	/*
+	 * A parallel COPY worker can't mark the command ID as used, but the
+	 * leader has already done so on its behalf.
+	 */
+	mycid = GetCurrentCommandId(!IsParallelWorker());
+
 	/*
 	 * The target must be a plain, foreign, or partitioned relation, or have
 	 * an INSTEAD OF INSERT row trigger.  (Currently, such triggers are only
@@ -3100,6 +3321,8 @@ CopyFrom(CopyState cstate)
 					if (resultRelInfo->ri_CopyMultiInsertBuffer == NULL)
 						CopyMultiInsertInfoSetupBuffer(&multiInsertInfo,
 													   resultRelInfo);
+					CopyMultiInsertInfoTouchBuffer(&multiInsertInfo,
+												   resultRelInfo);
 				}
 				else if (insertMethod == CIM_MULTI_CONDITIONAL &&
 						 !CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
@@ -3274,6 +3497,19 @@ CopyFrom(CopyState cstate)
 					/* OK, store the tuple */
 					if (resultRelInfo->ri_FdwRoutine != NULL)
 					{
+						/* Buffer the row if the FDW can insert in batches */
+						if (resultRelInfo->ri_BatchSize == 0)
+							resultRelInfo->ri_BatchSize =
+								ExecGetForeignBatchSize(resultRelInfo,
+														cstate->transition_capture == NULL);
+						if (resultRelInfo->ri_BatchSize > 1)
+						{
+							ExecForeignBatchInsertAdd(estate, resultRelInfo,
+													  myslot);
+							processed++;
+							continue;
+						}
+
 						myslot = resultRelInfo->ri_FdwRoutine->ExecForeignInsert(estate,
 																				 resultRelInfo,
 																				 myslot,
@@ -3321,6 +3557,7 @@ CopyFrom(CopyState cstate)
 	}
 
 	/* Flush any remaining buffered tuples */
+	ExecPendingInserts(estate);
 	if (insertMethod != CIM_SINGLE)
 	{
 		if (!CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
@@ -3374,6 +3611,623 @@ CopyFrom(CopyState cstate)
 	return processed;
 }
 
+/*
+ * Copy FROM file to relation using parallel workers, if possible.
+ *
+ * We fall back to a plain CopyFrom if the COPY can't be done in parallel
+ * safely or no workers can be launched.
+ */
+static uint64
+ParallelCopyFrom(CopyState cstate, List *attnamelist, List *options)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *pcshared;
+	ParallelCopyLeader pcleader;
+	ErrorContextCallback errcallback;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+	Size		estshared;
+	char	   *info;
+	char	   *sharedinfo;
+	int			infolen;
+	int			querylen;
+	int			nchunks;
+	uint64		processed;
+	bool		done;
+	int			i;
+
+	if (!CopyFromParallelSafe(cstate))
+		return CopyFrom(cstate);
+
+	/*
+	 * Workers can neither assign a transaction ID nor mark the command ID as
+	 * used, so take care of both before entering parallel mode.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain",
+								 cstate->nworkers);
+
+	/* Estimate space for the shared state and the chunk ring */
+	nchunks = cstate->nworkers * PARALLEL_COPY_CHUNKS_PER_WORKER;
+	estshared = add_size(offsetof(ParallelCopyShared, chunks),
+						 mul_size(nchunks, sizeof(ParallelCopyChunk)));
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+
+	/* Workers need the column list, options and WHERE clause */
+	info = nodeToString(list_make3(attnamelist, options, cstate->whereClause));
+	infolen = strlen(info) + 1;
+	shm_toc_estimate_chunk(&pcxt->estimator, infolen);
+
+	/*
+	 * Space for each worker's BufferUsage and WalUsage, as in a parallel
+	 * index build
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 4);
+
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial COPY) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return CopyFrom(cstate);
+	}
+
+	pcshared = (ParallelCopyShared *) shm_toc_allocate(pcxt->toc, estshared);
+	pcshared->relid = RelationGetRelid(cstate->rel);
+	pcshared->nchunks = nchunks;
+	SpinLockInit(&pcshared->mutex);
+	pcshared->nfilled = 0;
+	pcshared->nclaimed = 0;
+	pcshared->eof = false;
+	pcshared->processed = 0;
+	ConditionVariableInit(&pcshared->data_cv);
+	ConditionVariableInit(&pcshared->space_cv);
+	for (i = 0; i < nchunks; i++)
+		pcshared->chunks[i].filled = false;
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_SHARED, pcshared);
+
+	sharedinfo = (char *) shm_toc_allocate(pcxt->toc, infolen);
+	memcpy(sharedinfo, info, infolen);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_INFO, sharedinfo);
+
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, back out (do serial COPY) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		WaitForParallelWorkersToFinish(pcxt);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return CopyFrom(cstate);
+	}
+
+	/*
+	 * Make sure that the failure-to-start case will not leave us waiting
+	 * forever for buffer space.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	/* Set up callback to identify error line number */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	pcleader.pcshared = pcshared;
+	pcleader.chunk = NULL;
+	pcleader.seq = 0;
+
+	/*
+	 * Read the input line by line and hand the lines out, following the same
+	 * rules as NextCopyFromRawFields.
+	 */
+	done = false;
+	if (cstate->header_line)
+	{
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate);
+	}
+	while (!done)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate);
+		if (done && cstate->line_buf.len == 0)
+			break;
+
+		ParallelCopyPutLine(&pcleader, cstate->line_buf.data,
+							cstate->line_buf.len, cstate->cur_lineno);
+	}
+
+	/* Publish the last chunk, and tell the workers that's all */
+	if (pcleader.chunk != NULL)
+		ParallelCopyPublishChunk(pcshared, pcleader.chunk);
+	SpinLockAcquire(&pcshared->mutex);
+	pcshared->eof = true;
+	SpinLockRelease(&pcshared->mutex);
+	ConditionVariableBroadcast(&pcshared->data_cv);
+
+	error_context_stack = errcallback.previous;
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&bufferusage[i], &walusage[i]);
+
+	processed = pcshared->processed;
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return processed;
+}
+
+/*
+ * Can the COPY described by cstate be done by parallel workers?
+ *
+ * Workers run everything but reading the input: input functions, defaults,
+ * constraints, index insertion and the WHERE clause.  All of that must be
+ * parallel safe, and must not need state that only the leader has, such as
+ * triggers, sequences, or the relation-created-in-this-transaction
+ * information behind FREEZE.
+ */
+static bool
+CopyFromParallelSafe(CopyState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	TupleConstr *constr = tupDesc->constr;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	int			attnum;
+	int			i;
+	bool		safe = true;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		RelationUsesLocalBuffers(rel) ||
+		rel->trigdesc != NULL ||
+		cstate->freeze ||
+		IsolationIsSerializable())
+		return false;
+
+	if (constr && constr->has_generated_stored)
+		return false;
+
+	if (copy_parallel_unsafe_walker(cstate->whereClause, NULL))
+		return false;
+
+	for (attnum = 1; attnum <= tupDesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (att->attisdropped)
+			continue;
+
+		if (list_member_int(cstate->attnumlist, attnum))
+		{
+			Oid			typid = att->atttypid;
+			Oid			elemtype;
+			Oid			in_func_oid;
+			Oid			typioparam;
+
+			/* Domain input functions check the domain's constraints */
+			while (OidIsValid(elemtype = get_element_type(typid)))
+				typid = elemtype;
+			if (get_typtype(typid) == TYPTYPE_DOMAIN)
+				return false;
+
+			getTypeInputInfo(att->atttypid, &in_func_oid, &typioparam);
+			if (func_parallel(in_func_oid) != PROPARALLEL_SAFE)
+				return false;
+		}
+		else if (copy_parallel_unsafe_walker(build_column_default(rel, attnum),
+											 NULL))
+			return false;
+	}
+
+	if (constr)
+	{
+		for (i = 0; i < constr->num_check; i++)
+		{
+			if (copy_parallel_unsafe_walker(stringToNode(constr->check[i].ccbin),
+											NULL))
+				return false;
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+
+		if (copy_parallel_unsafe_walker((Node *) RelationGetIndexExpressions(indexRel),
+										NULL) ||
+			copy_parallel_unsafe_walker((Node *) RelationGetIndexPredicate(indexRel),
+										NULL))
+			safe = false;
+		index_close(indexRel, NoLock);
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return safe;
+}
+
+static bool
+copy_parallel_unsafe_checker(Oid func_id, void *context)
+{
+	return func_parallel(func_id) != PROPARALLEL_SAFE;
+}
+
+/*
+ * Does the expression contain anything a parallel COPY worker can't run?
+ */
+static bool
+copy_parallel_unsafe_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, copy_parallel_unsafe_checker, context))
+		return true;
+
+	/* Sequences, domain constraints and subqueries stay in the leader */
+	if (IsA(node, NextValueExpr) ||
+		IsA(node, CoerceToDomain) ||
+		IsA(node, SubLink) ||
+		IsA(node, SubPlan) ||
+		IsA(node, Param))
+		return true;
+
+	return expression_tree_walker(node, copy_parallel_unsafe_walker, context);
+}
+
+/*
+ * Append one input line to the chunk being filled, publishing chunks to the
+ * workers as they fill up.
+ */
+static void
+ParallelCopyPutLine(ParallelCopyLeader *pcleader, const char *line, int len,
+					uint64 lineno)
+{
+	ParallelCopyShared *pcshared = pcleader->pcshared;
+	ParallelCopyChunk *chunk = pcleader->chunk;
+	uint32		linelen = (uint32) len;
+	Size		needed = sizeof(uint32) + len;
+	int			nchunks;
+	int			i;
+
+	/* Easy case: the line fits in the current chunk */
+	if (chunk != NULL && chunk->used + needed <= PARALLEL_COPY_CHUNK_SIZE)
+	{
+		memcpy(chunk->data + chunk->used, &linelen, sizeof(uint32));
+		memcpy(chunk->data + chunk->used + sizeof(uint32), line, len);
+		chunk->used += needed;
+		chunk->nlines++;
+		return;
+	}
+
+	if (chunk != NULL)
+		ParallelCopyPublishChunk(pcshared, chunk);
+
+	/* Start a new chunk with this line */
+	nchunks = (needed + PARALLEL_COPY_CHUNK_SIZE - 1) / PARALLEL_COPY_CHUNK_SIZE;
+	chunk = ParallelCopyNextFreeChunk(pcleader);
+	chunk->first_lineno = lineno;
+	chunk->nlines = 1;
+	chunk->nchunks = nchunks;
+	memcpy(chunk->data, &linelen, sizeof(uint32));
+
+	if (nchunks == 1)
+	{
+		memcpy(chunk->data + sizeof(uint32), line, len);
+		chunk->used = needed;
+		pcleader->chunk = chunk;
+		return;
+	}
+
+	/*
+	 * The line is too long for one chunk.  Spread it over as many as needed,
+	 * publishing each as soon as it's full so that the worker can start
+	 * consuming them; the ring may well be smaller than the line.
+	 */
+	chunk->used = PARALLEL_COPY_CHUNK_SIZE;
+	memcpy(chunk->data + sizeof(uint32), line,
+		   PARALLEL_COPY_CHUNK_SIZE - sizeof(uint32));
+	line += PARALLEL_COPY_CHUNK_SIZE - sizeof(uint32);
+	len -= PARALLEL_COPY_CHUNK_SIZE - sizeof(uint32);
+	ParallelCopyPublishChunk(pcshared, chunk);
+
+	for (i = 1; i < nchunks; i++)
+	{
+		int			n = Min(len, PARALLEL_COPY_CHUNK_SIZE);
+
+		chunk = ParallelCopyNextFreeChunk(pcleader);
+		chunk->first_lineno = lineno;
+		chunk->nlines = 0;
+		chunk->nchunks = 0;
+		chunk->used = n;
+		memcpy(chunk->data, line, n);
+		line += n;
+		len -= n;
+		ParallelCopyPublishChunk(pcshared, chunk);
+	}
+	Assert(len == 0);
+
+	pcleader->chunk = NULL;
+}
+
+/*
+ * Wait for the next chunk in the ring to be released by the worker that
+ * last used it, and return it.
+ */
+static ParallelCopyChunk *
+ParallelCopyNextFreeChunk(ParallelCopyLeader *pcleader)
+{
+	ParallelCopyShared *pcshared = pcleader->pcshared;
+	ParallelCopyChunk *chunk = ParallelCopyGetChunk(pcshared, pcleader->seq);
+
+	for (;;)
+	{
+		bool		filled;
+
+		SpinLockAcquire(&pcshared->mutex);
+		filled = chunk->filled;
+		SpinLockRelease(&pcshared->mutex);
+
+		if (!filled)
+			break;
+
+		ConditionVariableSleep(&pcshared->space_cv,
+							   WAIT_EVENT_PARALLEL_COPY_SPACE);
+	}
+	ConditionVariableCancelSleep();
+
+	pcleader->seq++;
+	return chunk;
+}
+
+/*
+ * Make a filled chunk available to the workers.
+ */
+static void
+ParallelCopyPublishChunk(ParallelCopyShared *pcshared,
+						 ParallelCopyChunk *chunk)
+{
+	SpinLockAcquire(&pcshared->mutex);
+	chunk->filled = true;
+	pcshared->nfilled++;
+	SpinLockRelease(&pcshared->mutex);
+
+	ConditionVariableBroadcast(&pcshared->data_cv);
+}
+
+/*
+ * Give a chunk whose data a worker has consumed back to the leader.
+ */
+static void
+ParallelCopyReleaseChunk(ParallelCopyShared *pcshared,
+						 ParallelCopyChunk *chunk)
+{
+	SpinLockAcquire(&pcshared->mutex);
+	chunk->filled = false;
+	SpinLockRelease(&pcshared->mutex);
+
+	ConditionVariableBroadcast(&pcshared->space_cv);
+}
+
+/*
+ * Read the next line in a parallel COPY worker into line_buf, and set
+ * cur_lineno to its line number.  Returns false if there are no more lines.
+ */
+static bool
+ParallelCopyGetLine(CopyState cstate)
+{
+	ParallelCopyShared *pcshared = cstate->pcshared;
+	ParallelCopyChunk *chunk;
+	uint32		linelen;
+	int			n;
+
+	resetStringInfo(&cstate->line_buf);
+	cstate->line_buf_valid = false;
+
+	/* Claim a new chunk if we've used up the current one */
+	if (cstate->pc_nlines == 0)
+	{
+		for (;;)
+		{
+			bool		found = false;
+			bool		eof;
+
+			SpinLockAcquire(&pcshared->mutex);
+			if (pcshared->nclaimed < pcshared->nfilled)
+			{
+				cstate->pc_seq = pcshared->nclaimed;
+				chunk = ParallelCopyGetChunk(pcshared, cstate->pc_seq);
+				pcshared->nclaimed += chunk->nchunks;
+				found = true;
+			}
+			eof = pcshared->eof;
+			SpinLockRelease(&pcshared->mutex);
+
+			if (found)
+				break;
+			if (eof)
+			{
+				ConditionVariableCancelSleep();
+				return false;
+			}
+
+			ConditionVariableSleep(&pcshared->data_cv,
+								   WAIT_EVENT_PARALLEL_COPY_DATA);
+		}
+		ConditionVariableCancelSleep();
+
+		cstate->pc_offset = 0;
+		cstate->pc_nlines = chunk->nlines;
+		cstate->cur_lineno = chunk->first_lineno - 1;
+	}
+
+	chunk = ParallelCopyGetChunk(pcshared, cstate->pc_seq);
+
+	memcpy(&linelen, chunk->data + cstate->pc_offset, sizeof(uint32));
+	cstate->pc_offset += sizeof(uint32);
+	n = Min(linelen, chunk->used - cstate->pc_offset);
+	appendBinaryStringInfo(&cstate->line_buf, chunk->data + cstate->pc_offset, n);
+	cstate->pc_offset += n;
+	linelen -= n;
+	cstate->pc_nlines--;
+	cstate->cur_lineno++;
+
+	if (cstate->pc_nlines == 0)
+		ParallelCopyReleaseChunk(pcshared, chunk);
+
+	/* Collect the rest of a long line from the chunks that follow */
+	while (linelen > 0)
+	{
+		uint64		seq = ++cstate->pc_seq;
+
+		for (;;)
+		{
+			bool		published;
+
+			SpinLockAcquire(&pcshared->mutex);
+			published = seq < pcshared->nfilled;
+			SpinLockRelease(&pcshared->mutex);
+
+			if (published)
+				break;
+
+			ConditionVariableSleep(&pcshared->data_cv,
+								   WAIT_EVENT_PARALLEL_COPY_DATA);
+		}
+		ConditionVariableCancelSleep();
+
+		chunk = ParallelCopyGetChunk(pcshared, seq);
+		Assert(chunk->nchunks == 0 && chunk->used <= linelen);
+		appendBinaryStringInfo(&cstate->line_buf, chunk->data, chunk->used);
+		linelen -= chunk->used;
+		ParallelCopyReleaseChunk(pcshared, chunk);
+	}
+
+	/* The leader has already converted the line to the server encoding */
+	cstate->line_buf_converted = true;
+	cstate->line_buf_valid = true;
+
+	return true;
+}
+
+/*
+ * Data source callback for parallel COPY workers, which never read input.
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	elog(ERROR, "parallel COPY worker cannot read input data");
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Main entry point for parallel COPY FROM workers.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *pcshared;
+	BufferUsage *bufferusage;
+	WalUsage   *walusage;
+	ParseState *pstate;
+	RangeTblEntry *rte;
+	CopyState	cstate;
+	Relation	rel;
+	List	   *info;
+	char	   *sharedquery;
+	uint64		processed;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	pcshared = shm_toc_lookup(toc, PARALLEL_KEY_COPY_SHARED, false);
+	info = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_KEY_COPY_INFO,
+												false));
+
+	/* The leader holds the same lock; group locking lets us share it */
+	rel = table_open(pcshared->relid, RowExclusiveLock);
+
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = debug_query_string;
+	rte = addRangeTableEntryForRelation(pstate, rel, RowExclusiveLock,
+										NULL, false, false);
+	rte->requiredPerms = ACL_INSERT;
+
+	/* Prepare to track buffer usage during the load */
+	InstrStartParallelQuery();
+
+	cstate = BeginCopyFrom(pstate, rel, NULL, false, ParallelCopyNoData,
+						   (List *) linitial(info), (List *) lsecond(info));
+	cstate->whereClause = (Node *) lthird(info);
+	cstate->pcshared = pcshared;
+
+	ParallelWorkerMayInsert = true;
+	processed = CopyFrom(cstate);
+	ParallelWorkerMayInsert = false;
+
+	EndCopyFrom(cstate);
+
+	SpinLockAcquire(&pcshared->mutex);
+	pcshared->processed += processed;
+	SpinLockRelease(&pcshared->mutex);
+
+	/* Report buffer and WAL usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	table_close(rel, NoLock);
+	free_parsestate(pstate);
+}
+
 /*
  * Setup to read tuples from a file for COPY FROM.
  *
@@ -3642,26 +4496,38 @@ NextCopyFromRawFields(CopyState cstate, char ***fields, int *nfields)
 	/* only available for text or csv input */
 	Assert(!cstate->binary);
 
-	/* on input just throw the header line away */
-	if (cstate->cur_lineno == 0 && cstate->header_line)
+	/*
+	 * In a parallel COPY worker, the leader has already read the line (and
+	 * skipped the header).
+	 */
+	if (cstate->pcshared != NULL)
 	{
-		cstate->cur_lineno++;
-		if (CopyReadLine(cstate))
-			return false;		/* done */
+		if (!ParallelCopyGetLine(cstate))
+			return false;
 	}
+	else
+	{
+		/* on input just throw the header line away */
+		if (cstate->cur_lineno == 0 && cstate->header_line)
+		{
+			cstate->cur_lineno++;
+			if (CopyReadLine(cstate))
+				return false;	/* done */
+		}
 
-	cstate->cur_lineno++;
+		cstate->cur_lineno++;
 
-	/* Actually read the line into memory here */
-	done = CopyReadLine(cstate);
+		/* Actually read the line into memory here */
+		done = CopyReadLine(cstate);
 
-	/*
-	 * EOF at start of line means we're done.  If we see EOF after some
-	 * characters, we act as though it was newline followed by EOF, ie,
-	 * process the line and then exit loop on next iteration.
-	 */
-	if (done && cstate->line_buf.len == 0)
-		return false;
+		/*
+		 * EOF at start of line means we're done.  If we see EOF after some
+		 * characters, we act as though it was newline followed by EOF, ie,
+		 * process the line and then exit loop on next iteration.
+		 */
+		if (done && cstate->line_buf.len == 0)
+			return false;
+	}
 
 	/* Parse the line into de-escaped field values */
 	if (cstate->csv_mode)
@@ -3996,6 +4862,15 @@ CopyReadLineText(CopyState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+#ifndef USE_NO_SIMD
+	Vector8		nl_vec = vector8_broadcast('\n');
+	Vector8		cr_vec = vector8_broadcast('\r');
+	Vector8		bs_vec = vector8_broadcast('\\');
+	Vector8		quote_vec = vector8_broadcast('\0');
+	Vector8		escape_vec = vector8_broadcast('\0');
+	int			simd_resume_ptr = 0;
+#endif
+
 	if (cstate->csv_mode)
 	{
 		quotec = cstate->quote[0];
@@ -4003,6 +4878,11 @@ CopyReadLineText(CopyState cstate)
 		/* ignore special escape processing if it's the same as quotec */
 		if (quotec == escapec)
 			escapec = '\0';
+
+#ifndef USE_NO_SIMD
+		quote_vec = vector8_broadcast(quotec);
+		escape_vec = vector8_broadcast(escapec ? escapec : quotec);
+#endif
 	}
 
 	mblen_str[1] = '\0';
@@ -4059,6 +4939,9 @@ CopyReadLineText(CopyState cstate)
 				hit_eof = true;
 			raw_buf_ptr = 0;
 			copy_buf_len = cstate->raw_buf_len;
+#ifndef USE_NO_SIMD
+			simd_resume_ptr = 0;
+#endif
 
 			/*
 			 * If we are completely out of data, break out of the loop,
@@ -4072,6 +4955,45 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+#ifndef USE_NO_SIMD
+
+		/*
+		 * Skip over runs of bytes that can neither end the line nor change
+		 * the CSV quoting state, a vector at a time.  As soon as a vector
+		 * contains a newline, carriage return, backslash, quote or escape
+		 * character (or, for encodings that embed ASCII, a byte with the
+		 * high bit set), we fall back to the byte-at-a-time code below for
+		 * that vector.  We always leave at least one byte for it to fetch.
+		 */
+		while (raw_buf_ptr >= simd_resume_ptr &&
+			   raw_buf_ptr + (int) sizeof(Vector8) < copy_buf_len)
+		{
+			Vector8		chunk = vector8_load(copy_raw_buf + raw_buf_ptr);
+			Vector8		match;
+
+			match = vector8_or(vector8_eq(chunk, nl_vec),
+							   vector8_eq(chunk, cr_vec));
+			match = vector8_or(match, vector8_eq(chunk, bs_vec));
+			if (cstate->csv_mode)
+			{
+				match = vector8_or(match, vector8_eq(chunk, quote_vec));
+				match = vector8_or(match, vector8_eq(chunk, escape_vec));
+			}
+			if (cstate->encoding_embeds_ascii)
+				match = vector8_or(match, chunk);
+
+			if (vector8_is_highbit_set(match))
+			{
+				simd_resume_ptr = raw_buf_ptr + sizeof(Vector8);
+				break;
+			}
+
+			raw_buf_ptr += sizeof(Vector8);
+			first_char_in_line = false;
+			last_was_esc = false;
+		}
+#endif
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -4378,6 +5300,11 @@ CopyReadAttributesText(CopyState cstate)
 	char	   *output_ptr;
 	char	   *cur_ptr;
 	char	   *line_end_ptr;
+#ifndef USE_NO_SIMD
+	Vector8		delim_vec = vector8_broadcast(delimc);
+	Vector8		bs_vec = vector8_broadcast('\\');
+	char	   *simd_resume_ptr;
+#endif
 
 	/*
 	 * We need a special case for zero-column tables: check that the input
@@ -4408,6 +5335,9 @@ CopyReadAttributesText(CopyState cstate)
 	/* set pointer variables for loop */
 	cur_ptr = cstate->line_buf.data;
 	line_end_ptr = cstate->line_buf.data + cstate->line_buf.len;
+#ifndef USE_NO_SIMD
+	simd_resume_ptr = cur_ptr;
+#endif
 
 	/* Outer loop iterates over fields */
 	fieldno = 0;
@@ -4446,6 +5376,31 @@ CopyReadAttributesText(CopyState cstate)
 		{
 			char		c;
 
+#ifndef USE_NO_SIMD
+
+			/*
+			 * Copy runs of bytes containing neither the delimiter nor a
+			 * backslash straight to the output, a vector at a time.  Since
+			 * the output is never longer than the input consumed so far, this
+			 * can't overrun attribute_buf.
+			 */
+			while (cur_ptr >= simd_resume_ptr &&
+				   line_end_ptr - cur_ptr >= (int) sizeof(Vector8))
+			{
+				Vector8		chunk = vector8_load(cur_ptr);
+
+				if (vector8_is_highbit_set(vector8_or(vector8_eq(chunk, delim_vec),
+													  vector8_eq(chunk, bs_vec))))
+				{
+					simd_resume_ptr = cur_ptr + sizeof(Vector8);
+					break;
+				}
+				vector8_store(output_ptr, chunk);
+				cur_ptr += sizeof(Vector8);
+				output_ptr += sizeof(Vector8);
+			}
+#endif
+
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
 				break;
@@ -4803,9 +5758,14 @@ CopyReadBinaryAttribute(CopyState cstate,
 	cstate->attribute_buf.len = fld_size;
 	cstate->attribute_buf.data[fld_size] = '\0';
 
-	/* Call the column type's binary input converter */
-	result = ReceiveFunctionCall(flinfo, &cstate->attribute_buf,
-								 typioparam, typmod);
+	/*
+	 * Call the column type's binary input converter, unless it's one of the
+	 * built-in fixed-width types we can convert inline.
+	 */
+	if (!pq_getmsgfixedbinary(&cstate->attribute_buf, flinfo->fn_oid,
+							  &result))
+		result = ReceiveFunctionCall(flinfo, &cstate->attribute_buf,
+									 typioparam, typmod);
 
 	/* Trouble if it didn't eat the whole buffer */
 	if (cstate->attribute_buf.cursor != cstate->attribute_buf.len)
@@ -27,6 +27,7 @@
 #include "access/heapam.h"
 #include "access/reloptions.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
@@ -62,8 +63,25 @@ typedef struct
 	CommandId	output_cid;		/* cmin to insert in output tuples */
 	int			ti_options;		/* table_tuple_insert performance options */
 	BulkInsertState bistate;	/* bulk insert state */
+	/* Gather node whose workers may insert into rel directly, if any: */
+	GatherState *gatherstate;
 } DR_intorel;
 
+/*
+ * DestReceiver used by parallel workers inserting directly into a table
+ * created by CREATE TABLE AS in the leader.
+ */
+typedef struct
+{
+	DestReceiver pub;			/* publicly-known function pointers */
+	Oid			relid;			/* OID of relation to write to */
+	CommandId	output_cid;		/* cmin to insert in output tuples */
+	int			ti_options;		/* table_tuple_insert performance options */
+	/* These fields are filled by intorel_parallel_startup: */
+	Relation	rel;			/* relation to write to */
+	BulkInsertState bistate;	/* bulk insert state */
+} DR_intorel_parallel;
+
 /* utility functions for CTAS definition creation */
 static ObjectAddress create_ctas_internal(List *attrList, IntoClause *into);
 static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
@@ -73,6 +91,10 @@ static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinf
 static bool intorel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void intorel_shutdown(DestReceiver *self);
 static void intorel_destroy(DestReceiver *self);
+static void intorel_parallel_startup(DestReceiver *self, int operation,
+									 TupleDesc typeinfo);
+static bool intorel_parallel_receive(TupleTableSlot *slot, DestReceiver *self);
+static void intorel_parallel_shutdown(DestReceiver *self);
 
 
 /*
@@ -350,6 +372,18 @@ ExecCreateTableAs(CreateTableAsStmt *stmt, const char *queryString,
 		/* call ExecutorStart to prepare the plan for execution */
 		ExecutorStart(queryDesc, GetIntoRelEFlags(into));
 
+		/*
+		 * If the top plan node is a Gather that just passes through what its
+		 * workers produce, the workers can insert their tuples into the new
+		 * table themselves, instead of sending them all through the leader.
+		 * intorel_startup makes the final decision, once the table exists.
+		 */
+		if (IsA(queryDesc->planstate, GatherState) &&
+			queryDesc->planstate->ps_ProjInfo == NULL &&
+			queryDesc->estate->es_junkFilter == NULL)
+			((DR_intorel *) dest)->gatherstate =
+				(GatherState *) queryDesc->planstate;
+
 		/* run the plan to completion */
 		ExecutorRun(queryDesc, ForwardScanDirection, 0L, true);
 
@@ -564,6 +598,23 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 
 	/* Not using WAL requires smgr_targblock be initially invalid */
 	Assert(RelationGetTargetBlock(intoRelationDesc) == InvalidBlockNumber);
+
+	/*
+	 * Let the workers of a parallel plan insert directly, unless the table
+	 * lives in our local buffers, where they can't reach it.  The new table
+	 * has no indexes or triggers, and we've already assigned the XID and
+	 * marked the command ID as used, so there's nothing left that the
+	 * workers couldn't do themselves.
+	 */
+	if (myState->gatherstate != NULL &&
+		!RelationUsesLocalBuffers(intoRelationDesc))
+	{
+		GatherState *gatherstate = myState->gatherstate;
+
+		gatherstate->into_relid = RelationGetRelid(intoRelationDesc);
+		gatherstate->into_cid = myState->output_cid;
+		gatherstate->into_options = myState->ti_options;
+	}
 }
 
 /*
@@ -619,3 +670,81 @@ intorel_destroy(DestReceiver *self)
 {
 	pfree(self);
 }
+
+/*
+ * CreateParallelIntoRelDestReceiver -- create a DestReceiver for a parallel
+ * worker inserting into a table created by CREATE TABLE AS in the leader
+ */
+DestReceiver *
+CreateParallelIntoRelDestReceiver(Oid relid, CommandId output_cid,
+								  int ti_options)
+{
+	DR_intorel_parallel *self;
+
+	self = (DR_intorel_parallel *) palloc0(sizeof(DR_intorel_parallel));
+
+	self->pub.receiveSlot = intorel_parallel_receive;
+	self->pub.rStartup = intorel_parallel_startup;
+	self->pub.rShutdown = intorel_parallel_shutdown;
+	self->pub.rDestroy = intorel_destroy;
+	self->pub.mydest = DestIntoRel;
+	self->relid = relid;
+	self->output_cid = output_cid;
+	self->ti_options = ti_options;
+
+	return (DestReceiver *) self;
+}
+
+/*
+ * intorel_parallel_startup --- executor startup in a parallel worker
+ */
+static void
+intorel_parallel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	DR_intorel_parallel *myState = (DR_intorel_parallel *) self;
+
+	Assert(IsParallelWorker());
+
+	/* The leader holds AccessExclusiveLock; group locking lets us in */
+	myState->rel = table_open(myState->relid, RowExclusiveLock);
+	myState->bistate = GetBulkInsertState();
+
+	ParallelWorkerMayInsert = true;
+}
+
+/*
+ * intorel_parallel_receive --- receive one tuple in a parallel worker
+ */
+static bool
+intorel_parallel_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	DR_intorel_parallel *myState = (DR_intorel_parallel *) self;
+
+	table_tuple_insert(myState->rel,
+					   slot,
+					   myState->output_cid,
+					   myState->ti_options,
+					   myState->bistate);
+
+	return true;
+}
+
+/*
+ * intorel_parallel_shutdown --- executor end in a parallel worker
+ */
+static void
+intorel_parallel_shutdown(DestReceiver *self)
+{
+	DR_intorel_parallel *myState = (DR_intorel_parallel *) self;
+
+	ParallelWorkerMayInsert = false;
+
+	FreeBulkInsertState(myState->bistate);
+
+	/*
+	 * No table_finish_bulk_insert() here: the leader does that once all the
+	 * workers are done, and it covers what we've inserted too.
+	 */
+	table_close(myState->rel, NoLock);
+	myState->rel = NULL;
+}
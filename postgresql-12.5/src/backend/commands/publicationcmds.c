@@ -28,6 +28,7 @@
 #include "catalog/objectaccess.h"
 #include "catalog/objectaddress.h"
 #include "catalog/pg_inherits.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_publication.h"
 #include "catalog/pg_publication_rel.h"
@@ -37,6 +38,12 @@
 #include "commands/event_trigger.h"
 #include "commands/publicationcmds.h"
 
+#include "nodes/nodeFuncs.h"
+
+#include "parser/parse_clause.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_relation.h"
+
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/catcache.h"
@@ -52,6 +59,7 @@
 
 static List *OpenTableList(List *tables);
 static void CloseTableList(List *rels);
+static bool PublicationRelMatches(Oid pubid, PublicationRelInfo *pri);
 static void PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 								 AlterPublicationStmt *stmt);
 static void PublicationDropTables(Oid pubid, List *rels, bool missing_ok);
@@ -344,6 +352,21 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 
 	Assert(list_length(stmt->tables) > 0);
 
+	if (stmt->tableAction == DEFELEM_DROP)
+	{
+		ListCell   *lc;
+
+		foreach(lc, stmt->tables)
+		{
+			PublicationTable *pt = castNode(PublicationTable, lfirst(lc));
+
+			if (pt->whereClause != NULL || pt->columns != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("cannot use a WHERE clause or column list when dropping a table from a publication")));
+		}
+	}
+
 	rels = OpenTableList(stmt->tables);
 
 	if (stmt->tableAction == DEFELEM_ADD)
@@ -356,7 +379,11 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 		List	   *delrels = NIL;
 		ListCell   *oldlc;
 
-		/* Calculate which relations to drop. */
+		/*
+		 * Calculate which relations to drop.  A relation that stays in the
+		 * publication but with a different row filter or column list is
+		 * dropped too, and re-added below.
+		 */
 		foreach(oldlc, oldrelids)
 		{
 			Oid			oldrelid = lfirst_oid(oldlc);
@@ -365,9 +392,10 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 
 			foreach(newlc, rels)
 			{
-				Relation	newrel = (Relation) lfirst(newlc);
+				PublicationRelInfo *newpri = (PublicationRelInfo *) lfirst(newlc);
 
-				if (RelationGetRelid(newrel) == oldrelid)
+				if (RelationGetRelid(newpri->relation) == oldrelid &&
+					PublicationRelMatches(pubid, newpri))
 				{
 					found = true;
 					break;
@@ -376,10 +404,11 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 
 			if (!found)
 			{
-				Relation	oldrel = table_open(oldrelid,
-												ShareUpdateExclusiveLock);
+				PublicationRelInfo *oldpri = palloc0(sizeof(PublicationRelInfo));
 
-				delrels = lappend(delrels, oldrel);
+				oldpri->relation = table_open(oldrelid,
+											  ShareUpdateExclusiveLock);
+				delrels = lappend(delrels, oldpri);
 			}
 		}
 
@@ -492,9 +521,195 @@ RemovePublicationRelById(Oid proid)
 	table_close(rel, RowExclusiveLock);
 }
 
+/* check_functions_in_node callback for publication row filters */
+static bool
+pub_where_function_checker(Oid func_id, void *context)
+{
+	return func_id >= FirstNormalObjectId ||
+		func_volatile(func_id) != PROVOLATILE_IMMUTABLE;
+}
+
+/*
+ * Check that a publication row filter only uses constructs that can be
+ * evaluated safely by the walsender: plain columns of the table, constants,
+ * and immutable built-in functions, operators, types and collations.
+ * Anything else could run arbitrary user code or look at catalogs that
+ * don't match the historic snapshot used for decoding.
+ */
+static bool
+check_publication_where_walker(Node *node, Relation rel)
+{
+	char	   *errdetail_msg = NULL;
+
+	if (node == NULL)
+		return false;
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			if (((Var *) node)->varattno <= 0)
+				errdetail_msg = _("System columns are not allowed.");
+			break;
+		case T_OpExpr:
+		case T_DistinctExpr:
+		case T_NullIfExpr:
+			if (((OpExpr *) node)->opno >= FirstNormalObjectId)
+				errdetail_msg = _("User-defined operators are not allowed.");
+			break;
+		case T_ScalarArrayOpExpr:
+			if (((ScalarArrayOpExpr *) node)->opno >= FirstNormalObjectId)
+				errdetail_msg = _("User-defined operators are not allowed.");
+			break;
+		case T_Const:
+		case T_FuncExpr:
+		case T_BoolExpr:
+		case T_RelabelType:
+		case T_CollateExpr:
+		case T_CaseExpr:
+		case T_CaseTestExpr:
+		case T_ArrayExpr:
+		case T_RowExpr:
+		case T_CoalesceExpr:
+		case T_MinMaxExpr:
+		case T_XmlExpr:
+		case T_NullTest:
+		case T_BooleanTest:
+		case T_List:
+			break;
+		default:
+			errdetail_msg = _("Only columns, constants, built-in operators, built-in data types, built-in collations, and immutable built-in functions are allowed.");
+			break;
+	}
+
+	if (errdetail_msg == NULL && !IsA(node, List))
+	{
+		Oid			exprcoll = exprCollation(node);
+
+		if (exprType(node) >= FirstNormalObjectId)
+			errdetail_msg = _("User-defined types are not allowed.");
+		else if (check_functions_in_node(node, pub_where_function_checker,
+										 NULL))
+			errdetail_msg = _("User-defined or built-in mutable functions are not allowed.");
+		else if (OidIsValid(exprcoll) && exprcoll >= FirstNormalObjectId)
+			errdetail_msg = _("User-defined collations are not allowed.");
+	}
+
+	if (errdetail_msg != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("invalid publication WHERE expression for relation \"%s\"",
+						RelationGetRelationName(rel)),
+				 errdetail_internal("%s", errdetail_msg)));
+
+	return expression_tree_walker(node, check_publication_where_walker,
+								  (void *) rel);
+}
+
+/*
+ * Transform a raw publication row filter against the given relation and
+ * check that it only contains allowed constructs.
+ */
+static Node *
+TransformPubWhereClause(Relation rel, Node *whereClause)
+{
+	ParseState *pstate = make_parsestate(NULL);
+	RangeTblEntry *rte;
+	Node	   *expr;
+
+	rte = addRangeTableEntryForRelation(pstate, rel, AccessShareLock,
+										NULL, false, false);
+	addRTEtoQuery(pstate, rte, false, true, true);
+
+	expr = transformWhereClause(pstate, copyObject(whereClause),
+								EXPR_KIND_PUBLICATION_WHERE,
+								"PUBLICATION WHERE");
+
+	/* Fix up collation information */
+	assign_expr_collations(pstate, expr);
+
+	check_publication_where_walker(expr, rel);
+
+	free_parsestate(pstate);
+
+	return expr;
+}
+
+/*
+ * Build the PublicationRelInfo for a relation opened by OpenTableList,
+ * transforming the row filter against that particular relation (children
+ * may have different attribute numbers than their parent).
+ */
+static PublicationRelInfo *
+MakePublicationRelInfo(Relation rel, PublicationTable *pt)
+{
+	PublicationRelInfo *pri = palloc0(sizeof(PublicationRelInfo));
+
+	pri->relation = rel;
+	pri->columns = pt->columns;
+	if (pt->whereClause != NULL)
+		pri->whereClause = TransformPubWhereClause(rel, pt->whereClause);
+
+	return pri;
+}
+
+/*
+ * Does the existing publication / relation mapping for pri->relation have
+ * the same row filter and column list as pri?
+ */
+static bool
+PublicationRelMatches(Oid pubid, PublicationRelInfo *pri)
+{
+	Oid			relid = RelationGetRelid(pri->relation);
+	HeapTuple	tup;
+	Datum		datum;
+	bool		isnull;
+	bool		result = true;
+
+	tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
+						  ObjectIdGetDatum(pubid));
+	if (!HeapTupleIsValid(tup))
+		return false;
+
+	datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+							Anum_pg_publication_rel_prqual, &isnull);
+	if (isnull != (pri->whereClause == NULL))
+		result = false;
+	else if (!isnull &&
+			 strcmp(TextDatumGetCString(datum),
+					nodeToString(pri->whereClause)) != 0)
+		result = false;
+
+	if (result)
+	{
+		datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+								Anum_pg_publication_rel_prattrs, &isnull);
+		if (isnull != (pri->columns == NIL))
+			result = false;
+		else if (!isnull)
+		{
+			Bitmapset  *oldcols;
+			Bitmapset  *newcols = NULL;
+			ListCell   *lc;
+
+			oldcols = pub_collist_to_bitmapset(NULL, datum,
+											   CurrentMemoryContext);
+			foreach(lc, pri->columns)
+				newcols = bms_add_member(newcols,
+										 get_attnum(relid, strVal(lfirst(lc))));
+
+			result = bms_equal(oldcols, newcols);
+		}
+	}
+
+	ReleaseSysCache(tup);
+
+	return result;
+}
+
 /*
- * Open relations specified by a RangeVar list.
- * The returned tables are locked in ShareUpdateExclusiveLock mode.
+ * Open relations specified by a PublicationTable list.
+ * The returned tables are locked in ShareUpdateExclusiveLock mode, and
+ * returned as a list of PublicationRelInfo.
  */
 static List *
 OpenTableList(List *tables)
@@ -508,7 +723,8 @@ OpenTableList(List *tables)
 	 */
 	foreach(lc, tables)
 	{
-		RangeVar   *rv = castNode(RangeVar, lfirst(lc));
+		PublicationTable *pt = castNode(PublicationTable, lfirst(lc));
+		RangeVar   *rv = pt->relation;
 		bool		recurse = rv->inh;
 		Relation	rel;
 		Oid			myrelid;
@@ -532,7 +748,7 @@ OpenTableList(List *tables)
 			continue;
 		}
 
-		rels = lappend(rels, rel);
+		rels = lappend(rels, MakePublicationRelInfo(rel, pt));
 		relids = lappend_oid(relids, myrelid);
 
 		/* Add children of this rel, if requested */
@@ -560,7 +776,7 @@ OpenTableList(List *tables)
 
 				/* find_all_inheritors already got lock */
 				rel = table_open(childrelid, NoLock);
-				rels = lappend(rels, rel);
+				rels = lappend(rels, MakePublicationRelInfo(rel, pt));
 				relids = lappend_oid(relids, childrelid);
 			}
 		}
@@ -581,9 +797,9 @@ CloseTableList(List *rels)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
 
-		table_close(rel, NoLock);
+		table_close(pri->relation, NoLock);
 	}
 }
 
@@ -600,7 +816,8 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		ObjectAddress obj;
 
 		/* Must be owner of the table or superuser. */
@@ -608,7 +825,7 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 			aclcheck_error(ACLCHECK_NOT_OWNER, get_relkind_objtype(rel->rd_rel->relkind),
 						   RelationGetRelationName(rel));
 
-		obj = publication_add_relation(pubid, rel, if_not_exists);
+		obj = publication_add_relation(pubid, pri, if_not_exists);
 		if (stmt)
 		{
 			EventTriggerCollectSimpleCommand(obj, InvalidObjectAddress,
@@ -632,7 +849,8 @@ PublicationDropTables(Oid pubid, List *rels, bool missing_ok)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		Oid			relid = RelationGetRelid(rel);
 
 		prid = GetSysCacheOid2(PUBLICATIONRELMAP, Anum_pg_publication_rel_oid,
@@ -39,7 +39,9 @@
 #include "parser/parse_type.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -94,6 +96,55 @@ static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
  */
 static SeqTableData *last_used_seq = NULL;
 
+/*
+ * Sequences that have no per-session cache (CACHE 1, the default) share
+ * ranges of values through shared memory instead.  When nextval() has to go
+ * to the sequence's buffer, it reserves shared_sequence_cache values at once,
+ * returns the first one and publishes the rest here; other backends then
+ * take values from the entry without pinning or locking the buffer and
+ * without WAL-logging anything.  Only the reservation itself updates the
+ * page and writes WAL, so the page always shows the end of the range and a
+ * crash or restart skips whatever was still unused.
+ *
+ * Entries are keyed by database and sequence OID, and remember the
+ * relfilenode they were reserved from, so that a rewrite by ALTER SEQUENCE
+ * that is later rolled back is harmless.  They are installed and removed
+ * only while holding the exclusive lock on the sequence's buffer (or a lock
+ * on the sequence that excludes nextval()), so that setval() and friends
+ * cannot race with a reservation.  Values are handed out under the entry's
+ * spinlock with only a shared lock on the hash partition.
+ *
+ * Temporary sequences are backend-local and are not cached.  When the table
+ * is full we simply go to the buffer every time.
+ */
+typedef struct SeqCacheKey
+{
+	Oid			dbid;
+	Oid			relid;
+} SeqCacheKey;
+
+typedef struct SeqCacheEnt
+{
+	SeqCacheKey key;			/* hash key; must be first */
+	Oid			filenode;		/* relfilenode the range was reserved from */
+	slock_t		mutex;			/* protects the fields below */
+	int64		next;			/* next value to hand out */
+	int64		remaining;		/* number of values left in the range */
+	int64		increment;		/* copy of sequence's increment field */
+} SeqCacheEnt;
+
+#define SEQ_CACHE_ENTRIES	1024
+#define NUM_SEQ_CACHE_PARTITIONS	16
+
+#define SeqCachePartitionLock(hashcode) \
+	(&SeqCacheLocks[(hashcode) % NUM_SEQ_CACHE_PARTITIONS].lock)
+
+static HTAB *SeqCache = NULL;
+static LWLockPadded *SeqCacheLocks = NULL;
+
+/* GUC parameter */
+int			shared_sequence_cache = 1;
+
 static void fill_seq_with_data(Relation rel, HeapTuple tuple);
 static Relation lock_and_open_sequence(SeqTable seq);
 static void create_seq_hashtable(void);
@@ -108,6 +159,10 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 						List **owned_by);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static bool seqcache_fetch(Relation seqrel, int64 *result);
+static void seqcache_install(Relation seqrel, int64 next, int64 remaining,
+							 int64 increment);
+static void seqcache_forget(Oid relid);
 
 
 /*
@@ -138,6 +193,10 @@ DefineSequence(ParseState *pstate, CreateSeqStmt *seq)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("unlogged sequences are not supported")));
+	if (seq->sequence->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("global temporary sequences are not supported")));
 
 	/*
 	 * If if_not_exists was given and a relation with the same name already
@@ -333,6 +392,9 @@ ResetSequence(Oid seq_relid)
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
 
+	/* Likewise for the shared cache */
+	seqcache_forget(seq_relid);
+
 	relation_close(seq_rel, NoLock);
 }
 
@@ -478,6 +540,12 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
 
+	/*
+	 * Likewise for the shared cache, since the new parameters might not
+	 * allow the values in it.  Our lock keeps nextval() from refilling it.
+	 */
+	seqcache_forget(relid);
+
 	/* If needed, rewrite the sequence relation itself */
 	if (need_seq_rewrite)
 	{
@@ -538,6 +606,8 @@ DeleteSequenceTuple(Oid relid)
 
 	ReleaseSysCache(tuple);
 	table_close(rel, RowExclusiveLock);
+
+	seqcache_forget(relid);
 }
 
 /*
@@ -598,6 +668,7 @@ nextval_internal(Oid relid, bool check_permissions)
 				rescnt = 0;
 	bool		cycle;
 	bool		logit = false;
+	bool		shared;
 
 	/* open and lock sequence */
 	init_sequence(relid, &elm, &seqrel);
@@ -631,6 +702,16 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	if (seqcache_fetch(seqrel, &result))	/* shared range not used up */
+	{
+		elm->last = result;
+		elm->cached = result;
+		elm->last_valid = true;
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return result;
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -642,10 +723,36 @@ nextval_internal(Oid relid, bool check_permissions)
 	cycle = pgsform->seqcycle;
 	ReleaseSysCache(pgstuple);
 
+	/*
+	 * Without a per-session cache, reserve a range of values for the shared
+	 * cache instead.
+	 */
+	shared = (cache == 1 && shared_sequence_cache > 1 && SeqCache != NULL &&
+			  seqrel->rd_rel->relpersistence != RELPERSISTENCE_TEMP);
+
 	/* lock page' buffer and read tuple */
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
 
+	/*
+	 * Somebody else may have refilled the shared cache while we waited for
+	 * the buffer lock.  If so, use that range rather than reserving another.
+	 */
+	if (shared)
+	{
+		if (seqcache_fetch(seqrel, &result))
+		{
+			UnlockReleaseBuffer(buf);
+			elm->last = result;
+			elm->cached = result;
+			elm->last_valid = true;
+			relation_close(seqrel, NoLock);
+			last_used_seq = elm;
+			return result;
+		}
+		cache = shared_sequence_cache;
+	}
+
 	elm->increment = incby;
 	last = next = result = seq->last_value;
 	fetch = cache;
@@ -751,9 +858,9 @@ nextval_internal(Oid relid, bool check_permissions)
 	log -= fetch;				/* adjust for any unfetched numbers */
 	Assert(log >= 0);
 
-	/* save info in local cache */
+	/* save info in local cache, unless the rest goes to the shared one */
 	elm->last = result;			/* last returned number */
-	elm->cached = last;			/* last fetched number */
+	elm->cached = shared ? result : last;	/* last fetched number */
 	elm->last_valid = true;
 
 	last_used_seq = elm;
@@ -819,6 +926,14 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	END_CRIT_SECTION();
 
+	/*
+	 * Publish the rest of the range while we still hold the buffer lock.  The
+	 * fetch loop stops at MAXVALUE/MINVALUE rather than cycling once it has a
+	 * result, so the range is an arithmetic progression.
+	 */
+	if (shared && rescnt > 1)
+		seqcache_install(seqrel, result + incby, rescnt - 1, incby);
+
 	UnlockReleaseBuffer(buf);
 
 	relation_close(seqrel, NoLock);
@@ -974,6 +1089,7 @@ do_setval(Oid relid, int64 next, bool iscalled)
 
 	/* In any case, forget any future cached numbers */
 	elm->cached = elm->last;
+	seqcache_forget(relid);
 
 	/* check the comment above nextval_internal()'s equivalent call. */
 	if (RelationNeedsWAL(seqrel))
@@ -1944,6 +2060,190 @@ ResetSequenceCaches(void)
 	last_used_seq = NULL;
 }
 
+/*
+ * SequenceCacheShmemSize -- estimate space for the shared sequence cache
+ */
+Size
+SequenceCacheShmemSize(void)
+{
+	Size		size;
+
+	size = hash_estimate_size(SEQ_CACHE_ENTRIES, sizeof(SeqCacheEnt));
+	size = add_size(size, mul_size(NUM_SEQ_CACHE_PARTITIONS,
+								   sizeof(LWLockPadded)));
+	return size;
+}
+
+/*
+ * SequenceCacheShmemInit -- initialize the shared sequence cache
+ */
+void
+SequenceCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			i;
+
+	SeqCacheLocks = (LWLockPadded *)
+		ShmemInitStruct("Sequence Cache Locks",
+						NUM_SEQ_CACHE_PARTITIONS * sizeof(LWLockPadded),
+						&found);
+
+	if (!found)
+	{
+		for (i = 0; i < NUM_SEQ_CACHE_PARTITIONS; i++)
+			LWLockInitialize(&SeqCacheLocks[i].lock,
+							 LWTRANCHE_SEQUENCE_CACHE);
+	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SeqCacheKey);
+	info.entrysize = sizeof(SeqCacheEnt);
+	info.num_partitions = NUM_SEQ_CACHE_PARTITIONS;
+
+	SeqCache = ShmemInitHash("Sequence Cache",
+							 SEQ_CACHE_ENTRIES,
+							 SEQ_CACHE_ENTRIES,
+							 &info,
+							 HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+							 HASH_FIXED_SIZE);
+}
+
+/*
+ * seqcache_fetch -- take the next value of a shared range, if there is one
+ */
+static bool
+seqcache_fetch(Relation seqrel, int64 *result)
+{
+	SeqCacheKey key;
+	SeqCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	bool		found = false;
+
+	if (SeqCache == NULL ||
+		seqrel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		return false;
+
+	key.dbid = MyDatabaseId;
+	key.relid = RelationGetRelid(seqrel);
+	hashcode = get_hash_value(SeqCache, &key);
+	partitionLock = SeqCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SeqCacheEnt *) hash_search_with_hash_value(SeqCache, &key,
+														hashcode, HASH_FIND,
+														NULL);
+	if (entry != NULL && entry->filenode == seqrel->rd_node.relNode)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (entry->remaining > 0)
+		{
+			*result = entry->next;
+			/* don't step past the end; it might overflow */
+			if (--entry->remaining > 0)
+				entry->next += entry->increment;
+			found = true;
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(partitionLock);
+
+	return found;
+}
+
+/*
+ * seqcache_install -- publish a freshly reserved range of values
+ *
+ * Caller must hold the exclusive lock on the sequence's buffer.
+ */
+static void
+seqcache_install(Relation seqrel, int64 next, int64 remaining,
+				 int64 increment)
+{
+	SeqCacheKey key;
+	SeqCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	bool		found;
+
+	key.dbid = MyDatabaseId;
+	key.relid = RelationGetRelid(seqrel);
+	hashcode = get_hash_value(SeqCache, &key);
+	partitionLock = SeqCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SeqCacheEnt *) hash_search_with_hash_value(SeqCache, &key,
+														hashcode,
+														HASH_ENTER_NULL,
+														&found);
+	if (entry != NULL)
+	{
+		if (!found)
+			SpinLockInit(&entry->mutex);
+		/* the exclusive partition lock keeps fetchers out */
+		entry->filenode = seqrel->rd_node.relNode;
+		entry->next = next;
+		entry->remaining = remaining;
+		entry->increment = increment;
+	}
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * seqcache_forget -- discard any shared range of the given sequence
+ *
+ * Caller must hold either the exclusive lock on the sequence's buffer or a
+ * lock on the sequence that conflicts with nextval().
+ */
+static void
+seqcache_forget(Oid relid)
+{
+	SeqCacheKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	if (SeqCache == NULL)
+		return;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+	hashcode = get_hash_value(SeqCache, &key);
+	partitionLock = SeqCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	hash_search_with_hash_value(SeqCache, &key, hashcode, HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * SequenceCacheForgetDatabase -- discard the shared ranges of a database
+ */
+void
+SequenceCacheForgetDatabase(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SeqCacheEnt *entry;
+	int			i;
+
+	if (SeqCache == NULL)
+		return;
+
+	/* lock all partitions, in order to avoid deadlock */
+	for (i = 0; i < NUM_SEQ_CACHE_PARTITIONS; i++)
+		LWLockAcquire(&SeqCacheLocks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SeqCache);
+	while ((entry = (SeqCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid == dbid)
+			hash_search(SeqCache, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	for (i = NUM_SEQ_CACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&SeqCacheLocks[i].lock);
+}
+
 /*
  * Mask a Sequence page before performing consistency checks on it.
  */
@@ -3576,6 +3576,14 @@ typedef SetConstraintStateData *SetConstraintState;
  * tuple(s).  This permits storing tuples once regardless of the number of
  * row-level triggers on a foreign table.
  *
+ * A one-ctid row event can also stand for a run of rows: ate_nextra counts
+ * the tuples immediately following ate_ctid1 on the same page that the
+ * trigger is to be fired for as well, in order.  Bulk inserts and deletes
+ * touch tuples in physical order, so a table with a single AFTER ROW trigger
+ * (typically a foreign key) needs one event per page rather than per row.
+ * Only the most recently queued event of a query level is ever extended, so
+ * this never changes the order in which triggers fire.
+ *
  * Note that we need triggers on foreign tables to be fired in exactly the
  * order they were queued, so that the tuples come out of the tuplestore in
  * the right order.  To ensure that, we forbid deferrable (constraint)
@@ -3633,6 +3641,8 @@ typedef struct AfterTriggerEventDataOneCtid
 {
 	TriggerFlags ate_flags;		/* status bits and offset to shared data */
 	ItemPointerData ate_ctid1;	/* inserted, deleted, or old updated tuple */
+	uint16		ate_nextra;		/* # of following tuples in run (fits in
+								 * what would otherwise be padding) */
 }			AfterTriggerEventDataOneCtid;
 
 /* AfterTriggerEventData, minus ate_ctid1 and ate_ctid2 */
@@ -3733,6 +3743,9 @@ typedef struct AfterTriggerEventList
  * This is okay because tuplestores don't really care what's in the tuples
  * they store; but it's possible that someday it'd break.)
  *
+ * last_event is the event most recently added to events, which the next
+ * one may be merged into (see afterTriggerExtendRun), or NULL.
+ *
  * tables is a List of AfterTriggersTableData structs for target tables
  * of the current query (see below).
  *
@@ -3796,6 +3809,7 @@ typedef struct AfterTriggersData
 struct AfterTriggersQueryData
 {
 	AfterTriggerEventList events;	/* events pending from this query */
+	AfterTriggerEvent last_event;	/* last event added to list, or NULL */
 	Tuplestorestate *fdw_tuplestore;	/* foreign tuples for said events */
 	List	   *tables;			/* list of AfterTriggersTableData, see below */
 };
@@ -3827,6 +3841,7 @@ static AfterTriggersData afterTriggers;
 
 static void AfterTriggerExecute(EState *estate,
 								AfterTriggerEvent event,
+								ItemPointer ctid1,
 								ResultRelInfo *relInfo,
 								TriggerDesc *trigdesc,
 								FmgrInfo *finfo,
@@ -3927,10 +3942,10 @@ afterTriggerCheckState(AfterTriggerShared evtshared)
  * afterTriggerAddEvent()
  *
  *	Add a new trigger event to the specified queue.
- *	The passed-in event data is copied.
+ *	The passed-in event data is copied.  Returns the new list entry.
  * ----------
  */
-static void
+static AfterTriggerEvent
 afterTriggerAddEvent(AfterTriggerEventList *events,
 					 AfterTriggerEvent event, AfterTriggerShared evtshared)
 {
@@ -4038,6 +4053,58 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 
 	chunk->freeptr += eventsize;
 	events->tailfree = chunk->freeptr;
+
+	return newevent;
+}
+
+/* ----------
+ * afterTriggerExtendRun()
+ *
+ *	Try to account for a new row-level event by extending the query level's
+ *	most recently added event to cover one more row, instead of adding it to
+ *	the list.  That works when both are one-ctid events of the same trigger
+ *	not yet marked for firing, and the new tuple directly follows the last
+ *	tuple of the run on the same page.
+ *
+ *	Returns true if the event was merged into the existing run.
+ * ----------
+ */
+static bool
+afterTriggerExtendRun(AfterTriggersQueryData *qs,
+					  AfterTriggerEvent event, AfterTriggerShared evtshared)
+{
+	AfterTriggerEventDataOneCtid *last;
+	AfterTriggerShared lastshared;
+
+	if (qs->last_event == NULL ||
+		(event->ate_flags & AFTER_TRIGGER_TUP_BITS) != AFTER_TRIGGER_1CTID ||
+		!(evtshared->ats_event & TRIGGER_EVENT_ROW) ||
+		!ItemPointerIsValid(&event->ate_ctid1))
+		return false;
+
+	last = (AfterTriggerEventDataOneCtid *) qs->last_event;
+	if ((last->ate_flags & (AFTER_TRIGGER_TUP_BITS |
+							AFTER_TRIGGER_DONE |
+							AFTER_TRIGGER_IN_PROGRESS)) != AFTER_TRIGGER_1CTID ||
+		last->ate_nextra == PG_UINT16_MAX)
+		return false;
+
+	lastshared = GetTriggerSharedData(qs->last_event);
+	if (lastshared->ats_tgoid != evtshared->ats_tgoid ||
+		lastshared->ats_relid != evtshared->ats_relid ||
+		lastshared->ats_event != evtshared->ats_event ||
+		lastshared->ats_table != evtshared->ats_table ||
+		lastshared->ats_firing_id != 0)
+		return false;
+
+	if (ItemPointerGetBlockNumber(&last->ate_ctid1) !=
+		ItemPointerGetBlockNumber(&event->ate_ctid1) ||
+		ItemPointerGetOffsetNumber(&last->ate_ctid1) + last->ate_nextra + 1 !=
+		ItemPointerGetOffsetNumber(&event->ate_ctid1))
+		return false;
+
+	last->ate_nextra++;
+	return true;
 }
 
 /* ----------
@@ -4151,6 +4218,8 @@ afterTriggerDeleteHeadEventChunk(AfterTriggersQueryData *qs)
  *	the end of a query, we can even piggyback on the executor's state.)
  *
  *	event: event currently being fired.
+ *	ctid1: tuple to fire it for, if the event has a ctid; normally that's
+ *		the event's ate_ctid1, but for a run of rows it's each in turn.
  *	rel: open relation for event.
  *	trigdesc: working copy of rel's trigger info.
  *	finfo: array of fmgr lookup cache entries (one per trigger in trigdesc).
@@ -4164,6 +4233,7 @@ afterTriggerDeleteHeadEventChunk(AfterTriggersQueryData *qs)
 static void
 AfterTriggerExecute(EState *estate,
 					AfterTriggerEvent event,
+					ItemPointer ctid1,
 					ResultRelInfo *relInfo,
 					TriggerDesc *trigdesc,
 					FmgrInfo *finfo, Instrumentation *instr,
@@ -4254,11 +4324,11 @@ AfterTriggerExecute(EState *estate,
 			break;
 
 		default:
-			if (ItemPointerIsValid(&(event->ate_ctid1)))
+			if (ItemPointerIsValid(ctid1))
 			{
 				LocTriggerData.tg_trigslot = ExecGetTriggerOldSlot(estate, relInfo);
 
-				if (!table_tuple_fetch_row_version(rel, &(event->ate_ctid1),
+				if (!table_tuple_fetch_row_version(rel, ctid1,
 												   SnapshotAny,
 												   LocTriggerData.tg_trigslot))
 					elog(ERROR, "failed to fetch tuple1 for AFTER trigger");
@@ -4537,12 +4607,32 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 				}
 
 				/*
-				 * Fire it.  Note that the AFTER_TRIGGER_IN_PROGRESS flag is
-				 * still set, so recursive examinations of the event list
-				 * won't try to re-fire it.
+				 * Fire it, once for each row if it's a run.  Note that the
+				 * AFTER_TRIGGER_IN_PROGRESS flag is still set, so recursive
+				 * examinations of the event list won't try to re-fire it.
 				 */
-				AfterTriggerExecute(estate, event, rInfo, trigdesc, finfo, instr,
-									per_tuple_context, slot1, slot2);
+				if ((event->ate_flags & AFTER_TRIGGER_TUP_BITS) ==
+					AFTER_TRIGGER_1CTID)
+				{
+					ItemPointerData ctid1 = event->ate_ctid1;
+					int			nextra;
+
+					nextra = ((AfterTriggerEventDataOneCtid *) event)->ate_nextra;
+					for (;;)
+					{
+						AfterTriggerExecute(estate, event, &ctid1,
+											rInfo, trigdesc, finfo, instr,
+											per_tuple_context, slot1, slot2);
+						if (nextra-- == 0)
+							break;
+						ItemPointerSetOffsetNumber(&ctid1,
+												   OffsetNumberNext(ItemPointerGetOffsetNumber(&ctid1)));
+					}
+				}
+				else
+					AfterTriggerExecute(estate, event, &event->ate_ctid1,
+										rInfo, trigdesc, finfo, instr,
+										per_tuple_context, slot1, slot2);
 
 				/*
 				 * Mark the event as done.
@@ -4904,6 +4994,7 @@ AfterTriggerFreeQuery(AfterTriggersQueryData *qs)
 	ListCell   *lc;
 
 	/* Drop the trigger events */
+	qs->last_event = NULL;
 	afterTriggerFreeEventList(&qs->events);
 
 	/* Drop FDW tuplestore if any */
@@ -5240,6 +5331,7 @@ AfterTriggerEnlargeQueryState(void)
 		qs->events.head = NULL;
 		qs->events.tail = NULL;
 		qs->events.tailfree = NULL;
+		qs->last_event = NULL;
 		qs->fdw_tuplestore = NULL;
 		qs->tables = NIL;
 
@@ -5721,6 +5813,7 @@ AfterTriggerSaveEvent(EState *estate, ResultRelInfo *relinfo,
 	TriggerDesc *trigdesc = relinfo->ri_TrigDesc;
 	AfterTriggerEventData new_event;
 	AfterTriggerSharedData new_shared;
+	AfterTriggersQueryData *qs;
 	char		relkind = rel->rd_rel->relkind;
 	int			tgtype_event;
 	int			tgtype_level;
@@ -5924,8 +6017,13 @@ AfterTriggerSaveEvent(EState *estate, ResultRelInfo *relinfo,
 	}
 
 	if (!(relkind == RELKIND_FOREIGN_TABLE && row_trigger))
+	{
 		new_event.ate_flags = (row_trigger && event == TRIGGER_EVENT_UPDATE) ?
 			AFTER_TRIGGER_2CTID : AFTER_TRIGGER_1CTID;
+		/* a one-ctid event starts out as a run of just the one row */
+		if (new_event.ate_flags == AFTER_TRIGGER_1CTID)
+			((AfterTriggerEventDataOneCtid *) &new_event)->ate_nextra = 0;
+	}
 	/* else, we'll initialize ate_flags for each trigger */
 
 	tgtype_level = (row_trigger ? TRIGGER_TYPE_ROW : TRIGGER_TYPE_STATEMENT);
@@ -6020,8 +6118,10 @@ AfterTriggerSaveEvent(EState *estate, ResultRelInfo *relinfo,
 		else
 			new_shared.ats_table = NULL;
 
-		afterTriggerAddEvent(&afterTriggers.query_stack[afterTriggers.query_depth].events,
-							 &new_event, &new_shared);
+		qs = &afterTriggers.query_stack[afterTriggers.query_depth];
+		if (!afterTriggerExtendRun(qs, &new_event, &new_shared))
+			qs->last_event = afterTriggerAddEvent(&qs->events,
+												  &new_event, &new_shared);
 	}
 
 	/*
@@ -42,6 +42,7 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "pgstat.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
@@ -55,6 +56,45 @@ typedef struct LastAttnumInfo
 	AttrNumber	last_scan;
 } LastAttnumInfo;
 
+/*
+ * Built-in comparison functions that ExecInitFunc replaces with the inline
+ * EEOP_FUNCEXPR_INT4CMP / EEOP_FUNCEXPR_INT8CMP steps.  Matching is done on
+ * the C function, so all SQL-level functions sharing an implementation are
+ * covered.
+ */
+static const struct
+{
+	PGFunction	fn_addr;
+	ExprEvalOp	opcode;
+	RowCompareType cmptype;
+}			inline_int_cmp_funcs[] =
+{
+	{int4lt, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_LT},
+	{int4le, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_LE},
+	{int4eq, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_EQ},
+	{int4ge, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_GE},
+	{int4gt, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_GT},
+	{int4ne, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_NE},
+	{date_lt, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_LT},
+	{date_le, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_LE},
+	{date_eq, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_EQ},
+	{date_ge, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_GE},
+	{date_gt, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_GT},
+	{date_ne, EEOP_FUNCEXPR_INT4CMP, ROWCOMPARE_NE},
+	{int8lt, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_LT},
+	{int8le, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_LE},
+	{int8eq, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_EQ},
+	{int8ge, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_GE},
+	{int8gt, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_GT},
+	{int8ne, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_NE},
+	{timestamp_lt, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_LT},
+	{timestamp_le, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_LE},
+	{timestamp_eq, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_EQ},
+	{timestamp_ge, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_GE},
+	{timestamp_gt, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_GT},
+	{timestamp_ne, EEOP_FUNCEXPR_INT8CMP, ROWCOMPARE_NE}
+};
+
 static void ExecReadyExpr(ExprState *state);
 static void ExecInitExprRec(Expr *node, ExprState *state,
 							Datum *resv, bool *resnull);
@@ -72,6 +112,8 @@ static void ExecInitSubscriptingRef(ExprEvalStep *scratch,
 									ExprState *state,
 									Datum *resv, bool *resnull);
 static bool isAssignmentIndirectionExpr(Expr *expr);
+static bool ExecScalarArrayOpUseHash(Expr *arrayarg, Oid opno,
+									 Oid *hashfuncid);
 static void ExecInitCoerceToDomain(ExprEvalStep *scratch, CoerceToDomain *ctest,
 								   ExprState *state,
 								   Datum *resv, bool *resnull);
@@ -950,6 +992,7 @@ ExecInitExprRec(Expr *node, ExprState *state,
 				FmgrInfo   *finfo;
 				FunctionCallInfo fcinfo;
 				AclResult	aclresult;
+				Oid			hashfuncid;
 
 				Assert(list_length(opexpr->args) == 2);
 				scalararg = (Expr *) linitial(opexpr->args);
@@ -984,6 +1027,37 @@ ExecInitExprRec(Expr *node, ExprState *state,
 				 */
 				ExecInitExprRec(arrayarg, state, resv, resnull);
 
+				/*
+				 * If the array is a constant with enough elements, and the
+				 * operator is an equality operator with a hash function,
+				 * "scalar = ANY (array)" can be evaluated by probing a hash
+				 * table of the array elements, instead of comparing against
+				 * each of them in turn.
+				 */
+				if (opexpr->useOr && finfo->fn_strict &&
+					ExecScalarArrayOpUseHash(arrayarg, opexpr->opno,
+											 &hashfuncid))
+				{
+					FmgrInfo   *hash_finfo;
+					FunctionCallInfo hash_fcinfo;
+
+					hash_finfo = palloc0(sizeof(FmgrInfo));
+					hash_fcinfo = palloc0(SizeForFunctionCallInfo(1));
+					fmgr_info(hashfuncid, hash_finfo);
+					fmgr_info_set_expr((Node *) node, hash_finfo);
+					InitFunctionCallInfoData(*hash_fcinfo, hash_finfo, 1,
+											 opexpr->inputcollid, NULL, NULL);
+
+					scratch.opcode = EEOP_HASHED_SCALARARRAYOP;
+					scratch.d.hashedscalararrayop.elements_tab = NULL;
+					scratch.d.hashedscalararrayop.finfo = finfo;
+					scratch.d.hashedscalararrayop.fcinfo_data = fcinfo;
+					scratch.d.hashedscalararrayop.fn_addr = finfo->fn_addr;
+					scratch.d.hashedscalararrayop.hash_fcinfo_data = hash_fcinfo;
+					ExprEvalPushStep(state, &scratch);
+					break;
+				}
+
 				/* And perform the operation */
 				scratch.opcode = EEOP_SCALARARRAYOP;
 				scratch.d.scalararrayop.element_type = InvalidOid;
@@ -2236,6 +2310,23 @@ ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args, Oid funcid,
 			scratch->opcode = EEOP_FUNCEXPR_STRICT;
 		else
 			scratch->opcode = EEOP_FUNCEXPR;
+
+		/* evaluate simple integer comparisons inline, if possible */
+		if (nargs == 2)
+		{
+			int			i;
+
+			for (i = 0; i < lengthof(inline_int_cmp_funcs); i++)
+			{
+				if (inline_int_cmp_funcs[i].fn_addr == flinfo->fn_addr)
+				{
+					Assert(flinfo->fn_strict);
+					scratch->opcode = inline_int_cmp_funcs[i].opcode;
+					scratch->d.func.cmptype = inline_int_cmp_funcs[i].cmptype;
+					break;
+				}
+			}
+		}
 	}
 	else
 	{
@@ -2758,6 +2849,40 @@ isAssignmentIndirectionExpr(Expr *expr)
 	return false;
 }
 
+/*
+ * Decide whether a ScalarArrayOpExpr with "ANY" semantics should be evaluated
+ * using a hash table of the array elements.  That's worthwhile if the array
+ * is a constant with at least MIN_ARRAY_SIZE_FOR_HASHED_SAOP elements, and
+ * the operator is hashable, with the same hash function for both inputs.
+ * If so, return true and set *hashfuncid.
+ */
+static bool
+ExecScalarArrayOpUseHash(Expr *arrayarg, Oid opno, Oid *hashfuncid)
+{
+	Const	   *arrayconst;
+	ArrayType  *arr;
+	Oid			lefthashfunc;
+	Oid			righthashfunc;
+
+	if (!IsA(arrayarg, Const))
+		return false;
+	arrayconst = (Const *) arrayarg;
+	if (arrayconst->constisnull)
+		return false;
+
+	arr = DatumGetArrayTypeP(arrayconst->constvalue);
+	if (ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr)) <
+		MIN_ARRAY_SIZE_FOR_HASHED_SAOP)
+		return false;
+
+	if (!get_op_hash_functions(opno, &lefthashfunc, &righthashfunc) ||
+		lefthashfunc != righthashfunc)
+		return false;
+
+	*hashfuncid = lefthashfunc;
+	return true;
+}
+
 /*
  * Prepare evaluation of a CoerceToDomain expression.
  */
@@ -3455,3 +3580,105 @@ ExecBuildGroupingEqual(TupleDesc ldesc, TupleDesc rdesc,
 
 	return state;
 }
+
+/*
+ * Build an ExprState that computes a hash value of the key columns of the
+ * expression context's inner tuple.  Starting from init_value, the hash is
+ * rotated left by one bit for each column and the column's hash is XORed
+ * in, NULLs hashing to 0, which is how TupleHashTableHash() combines them.
+ * The result is returned as a uint32 Datum; it is up to the caller to
+ * finalize it.
+ *
+ * Unlike calling the hash functions from a loop, this allows the hashing to
+ * be JIT compiled along with the rest of the query.
+ *
+ * desc: tuple descriptor of the to-be-hashed tuples
+ * ops: slot type of the to-be-hashed tuples, or NULL if not known
+ * hashfunctions: array of FmgrInfos of the hash functions to use
+ * collations: array of collations to call the hash functions with
+ * numCols: the number of attributes to be hashed
+ * keyColIdx: array of attribute column numbers
+ * parent: parent executor node
+ * init_value: initial hash value
+ */
+ExprState *
+ExecBuildHash32FromAttrs(TupleDesc desc, const TupleTableSlotOps *ops,
+						 FmgrInfo *hashfunctions, Oid *collations,
+						 int numCols, AttrNumber *keyColIdx,
+						 PlanState *parent, uint32 init_value)
+{
+	ExprState  *state = makeNode(ExprState);
+	ExprEvalStep scratch = {0};
+	int			natt;
+	int			maxatt = -1;
+
+	state->expr = NULL;
+	state->flags = 0;
+	state->parent = parent;
+
+	/* compute max needed attribute */
+	for (natt = 0; natt < numCols; natt++)
+	{
+		int			attno = keyColIdx[natt];
+
+		if (attno > maxatt)
+			maxatt = attno;
+	}
+
+	/* push deform step */
+	if (maxatt > 0)
+	{
+		scratch.opcode = EEOP_INNER_FETCHSOME;
+		scratch.d.fetch.last_var = maxatt;
+		scratch.d.fetch.fixed = false;
+		scratch.d.fetch.known_desc = desc;
+		scratch.d.fetch.kind = ops;
+		ExecComputeSlotInfo(state, &scratch);
+		ExprEvalPushStep(state, &scratch);
+	}
+
+	scratch.opcode = EEOP_HASHDATUM_SET_INITVAL;
+	scratch.d.hashdatum_initvalue.init_value = UInt32GetDatum(init_value);
+	scratch.resvalue = &state->resvalue;
+	scratch.resnull = &state->resnull;
+	ExprEvalPushStep(state, &scratch);
+
+	for (natt = 0; natt < numCols; natt++)
+	{
+		int			attno = keyColIdx[natt];
+		Form_pg_attribute att = TupleDescAttr(desc, attno - 1);
+		FmgrInfo   *finfo = &hashfunctions[natt];
+		FunctionCallInfo fcinfo;
+
+		fcinfo = palloc0(SizeForFunctionCallInfo(1));
+		InitFunctionCallInfoData(*fcinfo, finfo, 1,
+								 collations[natt], NULL, NULL);
+
+		/* fetch the column into the hash function's argument */
+		scratch.opcode = EEOP_INNER_VAR;
+		scratch.d.var.attnum = attno - 1;
+		scratch.d.var.vartype = att->atttypid;
+		scratch.resvalue = &fcinfo->args[0].value;
+		scratch.resnull = &fcinfo->args[0].isnull;
+		ExprEvalPushStep(state, &scratch);
+
+		/* and combine its hash into the result */
+		scratch.opcode = EEOP_HASHDATUM_NEXT32;
+		scratch.d.func.finfo = finfo;
+		scratch.d.func.fcinfo_data = fcinfo;
+		scratch.d.func.fn_addr = finfo->fn_addr;
+		scratch.d.func.nargs = 1;
+		scratch.resvalue = &state->resvalue;
+		scratch.resnull = &state->resnull;
+		ExprEvalPushStep(state, &scratch);
+	}
+
+	scratch.resvalue = NULL;
+	scratch.resnull = NULL;
+	scratch.opcode = EEOP_DONE;
+	ExprEvalPushStep(state, &scratch);
+
+	ExecReadyExpr(state);
+
+	return state;
+}
@@ -138,6 +138,47 @@ static ExprEvalOpLookup reverse_dispatch_table[EEOP_LAST];
 	} while (0)
 
 
+/*
+ * Hash table used by EEOP_HASHED_SCALARARRAYOP to look up the scalar among
+ * the elements of a constant array.
+ */
+typedef struct ScalarArrayOpExprHashEntry
+{
+	Datum		key;
+	uint32		status;			/* hash status */
+	uint32		hash;			/* hash value (cached) */
+} ScalarArrayOpExprHashEntry;
+
+#define SH_PREFIX saophash
+#define SH_ELEMENT_TYPE ScalarArrayOpExprHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
+static bool saop_hash_element_match(struct saophash_hash *tb, Datum key1,
+									Datum key2);
+static uint32 saop_element_hash(struct saophash_hash *tb, Datum key);
+
+typedef struct ScalarArrayOpExprHashTable
+{
+	saophash_hash *hashtab;		/* underlying hash table */
+	struct ExprEvalStep *op;	/* the step using this table */
+	bool		has_nulls;		/* did the array contain NULLs? */
+} ScalarArrayOpExprHashTable;
+
+#define SH_PREFIX saophash
+#define SH_ELEMENT_TYPE ScalarArrayOpExprHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) saop_element_hash(tb, key)
+#define SH_EQUAL(tb, a, b) saop_hash_element_match(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
 static Datum ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull);
 static void ExecInitInterpreter(void);
 
@@ -161,6 +202,33 @@ static Datum ExecJustAssignScanVar(ExprState *state, ExprContext *econtext, bool
 static Datum ExecJustApplyFuncToCase(ExprState *state, ExprContext *econtext, bool *isnull);
 
 
+/*
+ * Evaluate the comparison selected by cmptype for EEOP_FUNCEXPR_INT[48]CMP.
+ * int4 arguments are simply widened, which preserves their ordering.
+ */
+static pg_attribute_always_inline bool
+ExecCompareInts(RowCompareType cmptype, int64 arg1, int64 arg2)
+{
+	switch (cmptype)
+	{
+		case ROWCOMPARE_LT:
+			return arg1 < arg2;
+		case ROWCOMPARE_LE:
+			return arg1 <= arg2;
+		case ROWCOMPARE_EQ:
+			return arg1 == arg2;
+		case ROWCOMPARE_GE:
+			return arg1 >= arg2;
+		case ROWCOMPARE_GT:
+			return arg1 > arg2;
+		case ROWCOMPARE_NE:
+			return arg1 != arg2;
+	}
+
+	pg_unreachable();
+	return false;
+}
+
 /*
  * Prepare ExprState for interpreted execution.
  */
@@ -329,6 +397,8 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_FUNCEXPR_STRICT,
 		&&CASE_EEOP_FUNCEXPR_FUSAGE,
 		&&CASE_EEOP_FUNCEXPR_STRICT_FUSAGE,
+		&&CASE_EEOP_FUNCEXPR_INT4CMP,
+		&&CASE_EEOP_FUNCEXPR_INT8CMP,
 		&&CASE_EEOP_BOOL_AND_STEP_FIRST,
 		&&CASE_EEOP_BOOL_AND_STEP,
 		&&CASE_EEOP_BOOL_AND_STEP_LAST,
@@ -358,6 +428,8 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_DISTINCT,
 		&&CASE_EEOP_NOT_DISTINCT,
 		&&CASE_EEOP_NULLIF,
+		&&CASE_EEOP_HASHDATUM_SET_INITVAL,
+		&&CASE_EEOP_HASHDATUM_NEXT32,
 		&&CASE_EEOP_SQLVALUEFUNCTION,
 		&&CASE_EEOP_CURRENTOFEXPR,
 		&&CASE_EEOP_NEXTVALUEEXPR,
@@ -379,6 +451,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_DOMAIN_CHECK,
 		&&CASE_EEOP_CONVERT_ROWTYPE,
 		&&CASE_EEOP_SCALARARRAYOP,
+		&&CASE_EEOP_HASHED_SCALARARRAYOP,
 		&&CASE_EEOP_XMLEXPR,
 		&&CASE_EEOP_AGGREF,
 		&&CASE_EEOP_GROUPING_FUNC,
@@ -670,6 +743,44 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_FUNCEXPR_INT4CMP)
+		{
+			NullableDatum *args = op->d.func.fcinfo_data->args;
+
+			/* strict function, so check for NULL args */
+			if (args[0].isnull || args[1].isnull)
+				*op->resnull = true;
+			else
+			{
+				*op->resvalue =
+					BoolGetDatum(ExecCompareInts(op->d.func.cmptype,
+												 DatumGetInt32(args[0].value),
+												 DatumGetInt32(args[1].value)));
+				*op->resnull = false;
+			}
+
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR_INT8CMP)
+		{
+			NullableDatum *args = op->d.func.fcinfo_data->args;
+
+			/* strict function, so check for NULL args */
+			if (args[0].isnull || args[1].isnull)
+				*op->resnull = true;
+			else
+			{
+				*op->resvalue =
+					BoolGetDatum(ExecCompareInts(op->d.func.cmptype,
+												 DatumGetInt64(args[0].value),
+												 DatumGetInt64(args[1].value)));
+				*op->resnull = false;
+			}
+
+			EEO_NEXT();
+		}
+
 		/*
 		 * If any of its clauses is FALSE, an AND's result is FALSE regardless
 		 * of the states of the rest of the clauses, so we can stop evaluating
@@ -1197,6 +1308,39 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_HASHDATUM_SET_INITVAL)
+		{
+			*op->resvalue = op->d.hashdatum_initvalue.init_value;
+			*op->resnull = false;
+
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_HASHDATUM_NEXT32)
+		{
+			/*
+			 * The argument is already evaluated into fcinfo->args[0], the
+			 * hash so far is in *op->resvalue.
+			 */
+			FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+			uint32		hashkey = DatumGetUInt32(*op->resvalue);
+
+			/* rotate hashkey left 1 bit at each step */
+			hashkey = (hashkey << 1) | (hashkey >> 31);
+
+			/* treat nulls as having hash key 0 */
+			if (!fcinfo->args[0].isnull)
+			{
+				fcinfo->isnull = false;
+				hashkey ^= DatumGetUInt32(op->d.func.fn_addr(fcinfo));
+			}
+
+			*op->resvalue = UInt32GetDatum(hashkey);
+			*op->resnull = false;
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_SQLVALUEFUNCTION)
 		{
 			/*
@@ -1415,6 +1559,14 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_HASHED_SCALARARRAYOP)
+		{
+			/* too complex for an inline implementation */
+			ExecEvalHashedScalarArrayOp(state, op, econtext);
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_DOMAIN_NOTNULL)
 		{
 			/* too complex for an inline implementation */
@@ -3500,6 +3652,164 @@ ExecEvalScalarArrayOp(ExprState *state, ExprEvalStep *op)
 	*op->resnull = resultnull;
 }
 
+/*
+ * Hash function for elements of a ScalarArrayOpExprHashTable.
+ */
+static uint32
+saop_element_hash(struct saophash_hash *tb, Datum key)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	(ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->op->d.hashedscalararrayop.hash_fcinfo_data;
+	Datum		hash;
+
+	fcinfo->args[0].value = key;
+	fcinfo->args[0].isnull = false;
+
+	hash = FunctionCallInvoke(fcinfo);
+
+	return DatumGetUInt32(hash);
+}
+
+/*
+ * Equality function for elements of a ScalarArrayOpExprHashTable, using the
+ * ScalarArrayOpExpr's own operator.
+ */
+static bool
+saop_hash_element_match(struct saophash_hash *tb, Datum key1, Datum key2)
+{
+	Datum		result;
+	ScalarArrayOpExprHashTable *elements_tab =
+	(ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->op->d.hashedscalararrayop.fcinfo_data;
+
+	fcinfo->args[0].value = key1;
+	fcinfo->args[0].isnull = false;
+	fcinfo->args[1].value = key2;
+	fcinfo->args[1].isnull = false;
+
+	result = elements_tab->op->d.hashedscalararrayop.fn_addr(fcinfo);
+
+	return DatumGetBool(result);
+}
+
+/*
+ * Evaluate "scalar op ANY (const array)" using a hash table of the array's
+ * elements.
+ *
+ * The hash table is built on the first call and kept for the lifetime of
+ * the expression, which is fine since the array is a Const.  Source array
+ * is in our result area, scalar arg is already evaluated into
+ * fcinfo->args[0].  The operator is known to be strict, and the array to be
+ * non-empty.
+ */
+void
+ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op,
+							ExprContext *econtext)
+{
+	ScalarArrayOpExprHashTable *elements_tab = op->d.hashedscalararrayop.elements_tab;
+	FunctionCallInfo fcinfo = op->d.hashedscalararrayop.fcinfo_data;
+	Datum		scalar = fcinfo->args[0].value;
+	bool		scalar_isnull = fcinfo->args[0].isnull;
+	bool		hashfound;
+
+	/* If the array is NULL then we return NULL, as EEOP_SCALARARRAYOP does */
+	if (*op->resnull)
+		return;
+
+	/* A NULL scalar can't match anything, and the operator is strict */
+	if (scalar_isnull)
+	{
+		*op->resnull = true;
+		return;
+	}
+
+	/* Build the hash table on first evaluation */
+	if (elements_tab == NULL)
+	{
+		MemoryContext oldcontext;
+		ArrayType  *arr;
+		int			nitems;
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		char	   *s;
+		bits8	   *bitmap;
+		int			bitmask;
+		int			i;
+
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
+
+		arr = DatumGetArrayTypeP(*op->resvalue);
+		nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(arr), &typlen, &typbyval, &typalign);
+
+		elements_tab = (ScalarArrayOpExprHashTable *)
+			palloc(sizeof(ScalarArrayOpExprHashTable));
+		op->d.hashedscalararrayop.elements_tab = elements_tab;
+		elements_tab->op = op;
+		elements_tab->has_nulls = false;
+		elements_tab->hashtab = saophash_create(CurrentMemoryContext, nitems,
+												elements_tab);
+
+		s = (char *) ARR_DATA_PTR(arr);
+		bitmap = ARR_NULLBITMAP(arr);
+		bitmask = 1;
+		for (i = 0; i < nitems; i++)
+		{
+			/* NULL elements can't match, but they do affect the result */
+			if (bitmap && (*bitmap & bitmask) == 0)
+				elements_tab->has_nulls = true;
+			else
+			{
+				Datum		element;
+
+				element = fetch_att(s, typbyval, typlen);
+				s = att_addlength_pointer(s, typlen, s);
+				s = (char *) att_align_nominal(s, typalign);
+
+				saophash_insert(elements_tab->hashtab, element, &hashfound);
+			}
+
+			/* advance bitmap pointer if any */
+			if (bitmap)
+			{
+				bitmask <<= 1;
+				if (bitmask == 0x100)
+				{
+					bitmap++;
+					bitmask = 1;
+				}
+			}
+		}
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	hashfound = (saophash_lookup(elements_tab->hashtab, scalar) != NULL);
+
+	/*
+	 * Without a match, the result is NULL if the array contained NULLs, as
+	 * the operator would have returned NULL for those, else false.
+	 */
+	if (hashfound)
+	{
+		*op->resvalue = BoolGetDatum(true);
+		*op->resnull = false;
+	}
+	else if (elements_tab->has_nulls)
+	{
+		*op->resvalue = (Datum) 0;
+		*op->resnull = true;
+	}
+	else
+	{
+		*op->resvalue = BoolGetDatum(false);
+		*op->resnull = false;
+	}
+}
+
 /*
  * Evaluate a NOT NULL domain constraint.
  */
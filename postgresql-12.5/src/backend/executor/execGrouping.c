@@ -229,10 +229,21 @@ BuildTupleHashTableExt(PlanState *parent,
 													keyColIdx, eqfuncoids, collations,
 													allow_jit ? parent : NULL);
 
+	/* and an expression hashing input tuples, see TupleHashTableHash() */
+	hashtable->tab_hash_expr = ExecBuildHash32FromAttrs(inputDesc,
+														NULL,
+														hashfunctions,
+														collations,
+														numCols,
+														keyColIdx,
+														allow_jit ? parent : NULL,
+														hashtable->hash_iv);
+
 	/*
 	 * While not pretty, it's ok to not shut down this context, but instead
 	 * rely on the containing memory context being reset, as
-	 * ExecBuildGroupingEqual() only builds a very simple expression calling
+	 * ExecBuildGroupingEqual() and ExecBuildHash32FromAttrs() only build
+	 * very simple expressions calling
 	 * functions (i.e. nothing that'd employ RegisterExprContextCallback()).
 	 */
 	hashtable->exprcontext = CreateStandaloneExprContext();
@@ -408,6 +419,24 @@ TupleHashTableHash(struct tuplehash_hash *tb, const MinimalTuple tuple)
 		/* Process the current input tuple for the table */
 		slot = hashtable->inputslot;
 		hashfunctions = hashtable->in_hash_funcs;
+
+		/*
+		 * Unless the caller supplied cross-type hash functions, use the
+		 * precompiled hash expression, which can be JIT compiled.  It
+		 * combines the column hashes the same way as the loop below.
+		 */
+		if (hashfunctions == hashtable->tab_hash_funcs)
+		{
+			ExprContext *econtext = hashtable->exprcontext;
+			bool		isnull;
+
+			econtext->ecxt_innertuple = slot;
+			hashkey = DatumGetUInt32(ExecEvalExpr(hashtable->tab_hash_expr,
+												  econtext, &isnull));
+			Assert(!isnull);
+
+			return murmurhash32(hashkey);
+		}
 	}
 	else
 	{
@@ -437,9 +466,12 @@ TupleHashTableHash(struct tuplehash_hash *tb, const MinimalTuple tuple)
 		{
 			uint32		hkey;
 
-			hkey = DatumGetUInt32(FunctionCall1Coll(&hashfunctions[i],
-													hashtable->tab_collations[i],
-													attr));
+			if (!hash_builtin_datum(hashfunctions[i].fn_oid,
+									hashtable->tab_collations[i],
+									attr, &hkey))
+				hkey = DatumGetUInt32(FunctionCall1Coll(&hashfunctions[i],
+														hashtable->tab_collations[i],
+														attr));
 			hashkey ^= hkey;
 		}
 	}
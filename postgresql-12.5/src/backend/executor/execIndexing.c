@@ -136,6 +136,12 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 									 Datum *existing_values, bool *existing_isnull,
 									 Datum *new_values);
+static List *insert_index_tuples(TupleTableSlot *slot, ItemPointer tupleid,
+								 Bitmapset *changed_attrs, EState *estate,
+								 bool noDupErr, bool *specConflict,
+								 List *arbiterIndexes);
+static bool index_columns_changed(IndexInfo *indexInfo,
+								  Bitmapset *changed_attrs);
 
 /* ----------------------------------------------------------------
  *		ExecOpenIndices
@@ -266,7 +272,7 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *
  *		CAUTION: this must not be called for a HOT update.
  *		We can't defend against that here for lack of info.
- *		Should we change the API to make it safer?
+ *		Updates should use ExecUpdateIndexTuples instead.
  * ----------------------------------------------------------------
  */
 List *
@@ -276,7 +282,55 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 					  bool *specConflict,
 					  List *arbiterIndexes)
 {
-	ItemPointer tupleid = &slot->tts_tid;
+	return insert_index_tuples(slot, &slot->tts_tid, NULL, estate,
+							   noDupErr, specConflict, arbiterIndexes);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecUpdateIndexTuples
+ *
+ *		Make the index entries that table_tuple_update() reported
+ *		an updated tuple to need: none for a HOT update, entries in
+ *		all indexes for a cold one, and for a WARM update, entries
+ *		pointing to the root of the HOT chain, in the indexes whose
+ *		columns changed.  Returns the same list as
+ *		ExecInsertIndexTuples.
+ * ----------------------------------------------------------------
+ */
+List *
+ExecUpdateIndexTuples(TupleTableSlot *slot,
+					  EState *estate,
+					  TM_IndexUpdate *index_update)
+{
+	switch (index_update->which)
+	{
+		case TU_None:
+			break;
+		case TU_All:
+			return insert_index_tuples(slot, &slot->tts_tid, NULL, estate,
+									   false, NULL, NIL);
+		case TU_Changed:
+			return insert_index_tuples(slot, &index_update->tid,
+									   index_update->changed_attrs, estate,
+									   false, NULL, NIL);
+	}
+	return NIL;
+}
+
+/*
+ * Workhorse for ExecInsertIndexTuples and ExecUpdateIndexTuples: insert
+ * entries pointing to tupleid, into all indexes or, if changed_attrs isn't
+ * NULL, those using changed columns.
+ */
+static List *
+insert_index_tuples(TupleTableSlot *slot,
+					ItemPointer tupleid,
+					Bitmapset *changed_attrs,
+					EState *estate,
+					bool noDupErr,
+					bool *specConflict,
+					List *arbiterIndexes)
+{
 	List	   *result = NIL;
 	ResultRelInfo *resultRelInfo;
 	int			i;
@@ -331,6 +385,11 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/* In a WARM update, skip indexes whose entries still lead to it */
+		if (changed_attrs != NULL &&
+			!index_columns_changed(indexInfo, changed_attrs))
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -461,6 +520,29 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 	return result;
 }
 
+/*
+ * Does the index store any of changed_attrs?
+ *
+ * Columns used only in expressions or predicates don't count: heap_update
+ * doesn't do WARM updates changing those.
+ */
+static bool
+index_columns_changed(IndexInfo *indexInfo, Bitmapset *changed_attrs)
+{
+	int			i;
+
+	for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+	{
+		AttrNumber	attnum = indexInfo->ii_IndexAttrNumbers[i];
+
+		if (attnum != 0 &&
+			bms_is_member(attnum - FirstLowInvalidHeapAttributeNumber,
+						  changed_attrs))
+			return true;
+	}
+	return false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
@@ -54,6 +54,7 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "parser/parsetree.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "tcop/utility.h"
@@ -142,6 +143,12 @@ static void EvalPlanQualStart(EPQState *epqstate, Plan *planTree);
 void
 ExecutorStart(QueryDesc *queryDesc, int eflags)
 {
+	/*
+	 * Report the query ID so that it's visible to wait-event sampling.  A
+	 * plugin that computes query IDs must have done so by now.
+	 */
+	pgstat_report_query_id(queryDesc->plannedstmt->queryId, false);
+
 	if (ExecutorStart_hook)
 		(*ExecutorStart_hook) (queryDesc, eflags);
 	else
@@ -929,7 +936,12 @@ InitPlan(QueryDesc *queryDesc, int eflags)
 			/* get relation's OID (will produce InvalidOid if subquery) */
 			relid = exec_rt_fetch(rc->rti, estate)->relid;
 
-			/* open relation, if we need to access it for this mark type */
+			/*
+			 * Open relation, if we need to access it for this mark type.
+			 * Inheritance children are left to ExecRowMarkGetRelation, which
+			 * opens them the first time a row from them has to be marked;
+			 * with partition pruning most of them never are.
+			 */
 			switch (rc->markType)
 			{
 				case ROW_MARK_EXCLUSIVE:
@@ -937,7 +949,10 @@ InitPlan(QueryDesc *queryDesc, int eflags)
 				case ROW_MARK_SHARE:
 				case ROW_MARK_KEYSHARE:
 				case ROW_MARK_REFERENCE:
-					relation = ExecGetRangeTableRelation(estate, rc->rti);
+					if (rc->rti != rc->prti)
+						relation = NULL;
+					else
+						relation = ExecGetRangeTableRelation(estate, rc->rti);
 					break;
 				case ROW_MARK_COPY:
 					/* no physical table access is required */
@@ -2353,6 +2368,27 @@ ExecFindRowMark(EState *estate, Index rti, bool missing_ok)
 	return NULL;
 }
 
+/*
+ * ExecRowMarkGetRelation -- get the relation of an ExecRowMark
+ *
+ * Child rowmarks are built without opening their relation (see InitPlan);
+ * open and validate it here on first use.  Returns NULL for ROW_MARK_COPY
+ * rowmarks, which need no physical access.
+ */
+Relation
+ExecRowMarkGetRelation(EState *estate, ExecRowMark *erm)
+{
+	if (erm->relation == NULL && erm->markType != ROW_MARK_COPY)
+	{
+		Relation	relation = ExecGetRangeTableRelation(estate, erm->rti);
+
+		CheckValidRowMarkRel(relation, erm->markType);
+		erm->relation = relation;
+	}
+
+	return erm->relation;
+}
+
 /*
  * ExecBuildAuxRowMark -- create an ExecAuxRowMark struct
  *
@@ -2605,6 +2641,7 @@ EvalPlanQualFetchRowMark(EPQState *epqstate, Index rti, TupleTableSlot *slot)
 
 	if (erm->markType == ROW_MARK_REFERENCE)
 	{
+		(void) ExecRowMarkGetRelation(epqstate->parentestate, erm);
 		Assert(erm->relation != NULL);
 
 		/* fetch the tuple's ctid */
@@ -133,6 +133,18 @@ struct PartitionTupleRouting
  *		routing it through this table). A NULL value is stored if no tuple
  *		conversion is required.
  *
+ * last_found_datum_index
+ *		Index into the partition bound's datums array of the bound that the
+ *		most recently routed tuple matched (for RANGE partitioning, the
+ *		greatest lower bound, which may be -1), or -1 if none.
+ *
+ * last_found_count
+ *		Number of consecutive tuples that have matched
+ *		last_found_datum_index.  Once this reaches
+ *		PARTITION_CACHED_FIND_THRESHOLD, get_partition_for_tuple first checks
+ *		whether the next tuple matches the same bound before falling back to
+ *		a binary search.
+ *
  * indexes
  *		Array of partdesc->nparts elements.  For leaf partitions the index
  *		corresponds to the partition's ResultRelInfo in the encapsulating
@@ -150,9 +162,19 @@ typedef struct PartitionDispatchData
 	PartitionDesc partdesc;
 	TupleTableSlot *tupslot;
 	AttrNumber *tupmap;
+	int			last_found_datum_index;
+	int			last_found_count;
 	int			indexes[FLEXIBLE_ARRAY_MEMBER];
 }			PartitionDispatchData;
 
+/*
+ * Number of consecutive tuples that must be routed through the same bound
+ * before get_partition_for_tuple starts trying that bound first.  Until then
+ * a mismatch costs nothing extra, so inputs whose rows are scattered over
+ * the partitions don't pay for the cache check.
+ */
+#define PARTITION_CACHED_FIND_THRESHOLD	16
+
 /* struct to hold result relations coming from UPDATE subplans */
 typedef struct SubplanResultRelHashElem
 {
@@ -198,6 +220,14 @@ static void find_matching_subplans_recurse(PartitionPruningData *prunedata,
 										   PartitionedRelPruningData *pprune,
 										   bool initial_prune,
 										   Bitmapset **validsubplans);
+static void find_initially_pruned_relids(Plan *plan, PlannedStmt *plannedstmt,
+										 PlanState *parent,
+										 Bitmapset **prunedrelids);
+static void prune_subplans_for_locking(List *subplans,
+									   PartitionPruneInfo *pruneinfo,
+									   PlannedStmt *plannedstmt,
+									   PlanState *parent,
+									   Bitmapset **prunedrelids);
 
 
 /*
@@ -1085,6 +1115,8 @@ ExecInitPartitionDispatchInfo(EState *estate,
 	pd->key = RelationGetPartitionKey(rel);
 	pd->keystate = NIL;
 	pd->partdesc = partdesc;
+	pd->last_found_datum_index = -1;
+	pd->last_found_count = 0;
 	if (parent_pd != NULL)
 	{
 		TupleDesc	tupdesc = RelationGetDescr(rel);
@@ -1306,14 +1338,22 @@ FormPartitionKeyDatum(PartitionDispatch pd,
  *		Finds partition of relation which accepts the partition key specified
  *		in values and isnull
  *
+ * Bulk loads often route long runs of consecutive tuples to the same
+ * partition, for instance when loading time-ordered data into a table
+ * partitioned by time.  For LIST and RANGE partitioning we therefore
+ * remember which bound the previous tuple matched, and once enough tuples in
+ * a row have matched it, check that bound before doing a binary search over
+ * all of them.  HASH partitioning is cheap enough not to need this.
+ *
  * Return value is index of the partition (>= 0 and < partdesc->nparts) if one
  * found or -1 if none found.
  */
 static int
 get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 {
-	int			bound_offset;
+	int			bound_offset = -1;
 	int			part_index = -1;
+	bool		searched = false;
 	PartitionKey key = pd->key;
 	PartitionDesc partdesc = pd->partdesc;
 	PartitionBoundInfo boundinfo = partdesc->boundinfo;
@@ -1334,7 +1374,8 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 
 				part_index = boundinfo->indexes[rowHash % greatest_modulus];
 			}
-			break;
+			/* Nothing to cache */
+			return part_index >= 0 ? part_index : boundinfo->default_index;
 
 		case PARTITION_STRATEGY_LIST:
 			if (isnull[0])
@@ -1346,12 +1387,29 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 			{
 				bool		equal = false;
 
+				/* Try the bound the last few tuples matched */
+				if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+				{
+					int			last = pd->last_found_datum_index;
+					int32		cmpval;
+
+					cmpval = DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[0],
+															 key->partcollation[0],
+															 boundinfo->datums[last][0],
+															 values[0]));
+					if (cmpval == 0)
+						return boundinfo->indexes[last];
+				}
+
 				bound_offset = partition_list_bsearch(key->partsupfunc,
 													  key->partcollation,
 													  boundinfo,
 													  values[0], &equal);
 				if (bound_offset >= 0 && equal)
+				{
 					part_index = boundinfo->indexes[bound_offset];
+					searched = true;
+				}
 			}
 			break;
 
@@ -1374,23 +1432,54 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					}
 				}
 
-				if (!range_partkey_has_null)
-				{
-					bound_offset = partition_range_datum_bsearch(key->partsupfunc,
-																 key->partcollation,
-																 boundinfo,
-																 key->partnatts,
-																 values,
-																 &equal);
+				if (range_partkey_has_null)
+					break;
 
-					/*
-					 * The bound at bound_offset is less than or equal to the
-					 * tuple value, so the bound at offset+1 is the upper
-					 * bound of the partition we're looking for, if there
-					 * actually exists one.
-					 */
-					part_index = boundinfo->indexes[bound_offset + 1];
+				/*
+				 * Try the range the last few tuples fell into: the tuple
+				 * belongs there if it's >= the lower bound and < the next
+				 * bound.  -1 stands for the range below the first bound.
+				 */
+				if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+				{
+					int			last = pd->last_found_datum_index;
+
+					if ((last < 0 ||
+						 partition_rbound_datum_cmp(key->partsupfunc,
+													key->partcollation,
+													boundinfo->datums[last],
+													boundinfo->kind[last],
+													values,
+													key->partnatts) <= 0) &&
+						(last + 1 >= boundinfo->ndatums ||
+						 partition_rbound_datum_cmp(key->partsupfunc,
+													key->partcollation,
+													boundinfo->datums[last + 1],
+													boundinfo->kind[last + 1],
+													values,
+													key->partnatts) > 0))
+					{
+						part_index = boundinfo->indexes[last + 1];
+						return part_index >= 0 ? part_index :
+							boundinfo->default_index;
+					}
 				}
+
+				bound_offset = partition_range_datum_bsearch(key->partsupfunc,
+															 key->partcollation,
+															 boundinfo,
+															 key->partnatts,
+															 values,
+															 &equal);
+
+				/*
+				 * The bound at bound_offset is less than or equal to the
+				 * tuple value, so the bound at offset+1 is the upper bound of
+				 * the partition we're looking for, if there actually exists
+				 * one.
+				 */
+				part_index = boundinfo->indexes[bound_offset + 1];
+				searched = true;
 			}
 			break;
 
@@ -1399,6 +1488,22 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 				 (int) key->strategy);
 	}
 
+	/*
+	 * Remember the bound we matched, if we had to search for it.  Tuples
+	 * with NULL keys or with no matching LIST bound don't affect the cache.
+	 */
+	if (searched)
+	{
+		if (bound_offset == pd->last_found_datum_index &&
+			pd->last_found_count > 0)
+			pd->last_found_count++;
+		else
+		{
+			pd->last_found_datum_index = bound_offset;
+			pd->last_found_count = 1;
+		}
+	}
+
 	/*
 	 * part_index < 0 means we failed to find a partition of this parent. Use
 	 * the default partition, if there is one.
@@ -2208,3 +2313,215 @@ find_matching_subplans_recurse(PartitionPruningData *prunedata,
 		}
 	}
 }
+
+/*
+ * ExecGetInitiallyPrunedRelids
+ *		Determine which of plannedstmt->prunableRelids will not be scanned
+ *		because initial partition pruning removes the subplans scanning them.
+ *
+ * This lets AcquireExecutorLocks() avoid locking partitions that a cached
+ * generic plan won't touch.  The caller must already hold the locks on all
+ * other relations in the range table, in particular the partitioned tables
+ * whose pruning steps we evaluate here.  Only initial pruning steps are
+ * evaluated, using the given external parameter values, so the result is the
+ * same one that ExecInitAppend and ExecInitMergeAppend will arrive at.
+ *
+ * The result is allocated in the caller's memory context.
+ */
+Bitmapset *
+ExecGetInitiallyPrunedRelids(PlannedStmt *plannedstmt, ParamListInfo params)
+{
+	EState	   *estate;
+	PlanState  *parent;
+	MemoryContext oldcontext;
+	Bitmapset  *prunedrelids = NULL;
+	ListCell   *lc;
+	Index		i;
+
+	if (bms_is_empty(plannedstmt->prunableRelids))
+		return NULL;
+
+	estate = CreateExecutorState();
+	estate->es_param_list_info = params;
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	ExecInitRangeTable(estate, plannedstmt->rtable);
+
+	/*
+	 * The pruning steps' expressions are initialized against a dummy parent
+	 * node; all they need from it is an ExprContext.
+	 */
+	parent = makeNode(PlanState);
+	parent->state = estate;
+	ExecAssignExprContext(estate, parent);
+
+	find_initially_pruned_relids(plannedstmt->planTree, plannedstmt, parent,
+								 &prunedrelids);
+	foreach(lc, plannedstmt->subplans)
+		find_initially_pruned_relids((Plan *) lfirst(lc), plannedstmt, parent,
+									 &prunedrelids);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Copy the result out before getting rid of the executor state */
+	prunedrelids = bms_copy(prunedrelids);
+
+	for (i = 0; i < estate->es_range_table_size; i++)
+	{
+		if (estate->es_relations[i])
+			table_close(estate->es_relations[i], NoLock);
+	}
+	FreeExecutorState(estate);
+
+	return prunedrelids;
+}
+
+/*
+ * find_initially_pruned_relids
+ *		Recursive guts of ExecGetInitiallyPrunedRelids.
+ */
+static void
+find_initially_pruned_relids(Plan *plan, PlannedStmt *plannedstmt,
+							 PlanState *parent, Bitmapset **prunedrelids)
+{
+	List	   *children = NIL;
+	ListCell   *lc;
+
+	if (plan == NULL)
+		return;
+
+	check_stack_depth();
+
+	switch (nodeTag(plan))
+	{
+		case T_Append:
+			{
+				Append	   *aplan = (Append *) plan;
+
+				prune_subplans_for_locking(aplan->appendplans,
+										   aplan->part_prune_info,
+										   plannedstmt, parent, prunedrelids);
+				children = aplan->appendplans;
+			}
+			break;
+		case T_MergeAppend:
+			{
+				MergeAppend *mplan = (MergeAppend *) plan;
+
+				prune_subplans_for_locking(mplan->mergeplans,
+										   mplan->part_prune_info,
+										   plannedstmt, parent, prunedrelids);
+				children = mplan->mergeplans;
+			}
+			break;
+		case T_ModifyTable:
+			children = ((ModifyTable *) plan)->plans;
+			break;
+		case T_SubqueryScan:
+			children = list_make1(((SubqueryScan *) plan)->subplan);
+			break;
+		case T_CustomScan:
+			children = ((CustomScan *) plan)->custom_plans;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		default:
+			break;
+	}
+
+	foreach(lc, children)
+		find_initially_pruned_relids((Plan *) lfirst(lc), plannedstmt, parent,
+									 prunedrelids);
+
+	find_initially_pruned_relids(plan->lefttree, plannedstmt, parent,
+								 prunedrelids);
+	find_initially_pruned_relids(plan->righttree, plannedstmt, parent,
+								 prunedrelids);
+}
+
+/*
+ * prune_subplans_for_locking
+ *		Perform initial pruning for one Append or MergeAppend and add the
+ *		prunable relations scanned by the removed subplans to *prunedrelids.
+ */
+static void
+prune_subplans_for_locking(List *subplans, PartitionPruneInfo *pruneinfo,
+						   PlannedStmt *plannedstmt, PlanState *parent,
+						   Bitmapset **prunedrelids)
+{
+	PartitionPruneState *prunestate;
+	Bitmapset  *validsubplans;
+	bool		has_initial_steps = false;
+	ListCell   *lc;
+	int			i;
+
+	if (pruneinfo == NULL || subplans == NIL)
+		return;
+
+	/* Don't bother setting up pruning unless there are initial steps */
+	foreach(lc, pruneinfo->prune_infos)
+	{
+		List	   *partrelpruneinfos = lfirst_node(List, lc);
+		ListCell   *lc2;
+
+		foreach(lc2, partrelpruneinfos)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst_node(PartitionedRelPruneInfo, lc2);
+
+			if (pinfo->initial_pruning_steps != NIL)
+				has_initial_steps = true;
+		}
+	}
+	if (!has_initial_steps)
+		return;
+
+	prunestate = ExecCreatePartitionPruneState(parent, pruneinfo);
+	if (!prunestate->do_initial_prune)
+		return;
+	validsubplans = ExecFindInitialMatchingSubPlans(prunestate,
+													list_length(subplans));
+
+	/*
+	 * ExecInitAppend and ExecInitMergeAppend still initialize the first
+	 * subplan when everything was pruned, so it must be locked.
+	 */
+	if (bms_is_empty(validsubplans))
+		validsubplans = bms_make_singleton(0);
+
+	i = 0;
+	foreach(lc, subplans)
+	{
+		Plan	   *subplan = (Plan *) lfirst(lc);
+
+		if (!bms_is_member(i, validsubplans))
+		{
+			switch (nodeTag(subplan))
+			{
+				case T_SeqScan:
+				case T_SampleScan:
+				case T_IndexScan:
+				case T_IndexOnlyScan:
+				case T_BitmapHeapScan:
+				case T_TidScan:
+				case T_TidRangeScan:
+					{
+						Index		scanrelid = ((Scan *) subplan)->scanrelid;
+
+						if (bms_is_member(scanrelid,
+										  plannedstmt->prunableRelids))
+							*prunedrelids = bms_add_member(*prunedrelids,
+														   scanrelid);
+					}
+					break;
+				default:
+					break;
+			}
+		}
+		i++;
+	}
+}
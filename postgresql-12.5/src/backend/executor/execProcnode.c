@@ -88,6 +88,7 @@
 #include "executor/nodeGroup.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "executor/nodeIncrementalSort.h"
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeLimit.h"
@@ -100,7 +101,9 @@
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
 #include "executor/nodeRecursiveunion.h"
+#include "executor/nodeRepartition.h"
 #include "executor/nodeResult.h"
+#include "executor/nodeResultCache.h"
 #include "executor/nodeSamplescan.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSetOp.h"
@@ -108,6 +111,7 @@
 #include "executor/nodeSubplan.h"
 #include "executor/nodeSubqueryscan.h"
 #include "executor/nodeTableFuncscan.h"
+#include "executor/nodeTidrangescan.h"
 #include "executor/nodeTidscan.h"
 #include "executor/nodeUnique.h"
 #include "executor/nodeValuesscan.h"
@@ -117,8 +121,20 @@
 #include "miscadmin.h"
 
 
+/* GUC parameter: max tuples per batch for batch-capable nodes, 0 disables */
+int			executor_batch_size = 0;
+
+/* State for ExecWalkInstrumentation */
+typedef struct ExecInstrumentationContext
+{
+	ExecInstrumentationCallback callback;
+	void	   *arg;
+	PlanState  *parent;			/* nearest ancestor of the current node */
+} ExecInstrumentationContext;
+
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
 static TupleTableSlot *ExecProcNodeInstr(PlanState *node);
+static bool ExecWalkInstrumentationNode(PlanState *node, void *context);
 
 
 /* ------------------------------------------------------------------------
@@ -238,6 +254,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 												   estate, eflags);
 			break;
 
+		case T_TidRangeScan:
+			result = (PlanState *) ExecInitTidRangeScan((TidRangeScan *) node,
+														estate, eflags);
+			break;
+
 		case T_SubqueryScan:
 			result = (PlanState *) ExecInitSubqueryScan((SubqueryScan *) node,
 														estate, eflags);
@@ -309,11 +330,21 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 													estate, eflags);
 			break;
 
+		case T_ResultCache:
+			result = (PlanState *) ExecInitResultCache((ResultCache *) node,
+													   estate, eflags);
+			break;
+
 		case T_Sort:
 			result = (PlanState *) ExecInitSort((Sort *) node,
 												estate, eflags);
 			break;
 
+		case T_IncrementalSort:
+			result = (PlanState *) ExecInitIncrementalSort((IncrementalSort *) node,
+														   estate, eflags);
+			break;
+
 		case T_Group:
 			result = (PlanState *) ExecInitGroup((Group *) node,
 												 estate, eflags);
@@ -344,6 +375,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 													   estate, eflags);
 			break;
 
+		case T_Repartition:
+			result = (PlanState *) ExecInitRepartition((Repartition *) node,
+													   estate, eflags);
+			break;
+
 		case T_Hash:
 			result = (PlanState *) ExecInitHash((Hash *) node,
 												estate, eflags);
@@ -612,6 +648,10 @@ ExecEndNode(PlanState *node)
 			ExecEndGatherMerge((GatherMergeState *) node);
 			break;
 
+		case T_RepartitionState:
+			ExecEndRepartition((RepartitionState *) node);
+			break;
+
 		case T_IndexScanState:
 			ExecEndIndexScan((IndexScanState *) node);
 			break;
@@ -632,6 +672,10 @@ ExecEndNode(PlanState *node)
 			ExecEndTidScan((TidScanState *) node);
 			break;
 
+		case T_TidRangeScanState:
+			ExecEndTidRangeScan((TidRangeScanState *) node);
+			break;
+
 		case T_SubqueryScanState:
 			ExecEndSubqueryScan((SubqueryScanState *) node);
 			break;
@@ -690,10 +734,18 @@ ExecEndNode(PlanState *node)
 			ExecEndMaterial((MaterialState *) node);
 			break;
 
+		case T_ResultCacheState:
+			ExecEndResultCache((ResultCacheState *) node);
+			break;
+
 		case T_SortState:
 			ExecEndSort((SortState *) node);
 			break;
 
+		case T_IncrementalSortState:
+			ExecEndIncrementalSort((IncrementalSortState *) node);
+			break;
+
 		case T_GroupState:
 			ExecEndGroup((GroupState *) node);
 			break;
@@ -792,6 +844,53 @@ ExecShutdownNode(PlanState *node)
 	return false;
 }
 
+/*
+ * ExecWalkInstrumentation
+ *
+ * Visit every instrumented node of a plan state tree whose execution has
+ * finished, after ending the current loop of its instrumentation so that
+ * the counters are complete.  The callback receives each node together with
+ * its parent (NULL for the top node), in the same order as EXPLAIN shows
+ * them.  This lets modules such as pg_stat_statements collect per-node
+ * statistics without duplicating EXPLAIN ANALYZE's tree walk.
+ */
+void
+ExecWalkInstrumentation(PlanState *node, ExecInstrumentationCallback callback,
+						void *arg)
+{
+	ExecInstrumentationContext context;
+
+	context.callback = callback;
+	context.arg = arg;
+	context.parent = NULL;
+
+	(void) ExecWalkInstrumentationNode(node, &context);
+}
+
+static bool
+ExecWalkInstrumentationNode(PlanState *node, void *context)
+{
+	ExecInstrumentationContext *cxt = (ExecInstrumentationContext *) context;
+	PlanState  *save_parent = cxt->parent;
+
+	if (node == NULL)
+		return false;
+
+	check_stack_depth();
+
+	if (node->instrument)
+	{
+		InstrEndLoop(node->instrument);
+		cxt->callback(node, cxt->parent, cxt->arg);
+	}
+
+	cxt->parent = node;
+	planstate_tree_walker(node, ExecWalkInstrumentationNode, cxt);
+	cxt->parent = save_parent;
+
+	return false;
+}
+
 /*
  * ExecSetTupleBound
  *
@@ -840,6 +939,25 @@ ExecSetTupleBound(int64 tuples_needed, PlanState *child_node)
 			sortState->bound = tuples_needed;
 		}
 	}
+	else if (IsA(child_node, IncrementalSortState))
+	{
+		/*
+		 * Likewise for an IncrementalSort node, which can then also stop
+		 * reading its input early.
+		 */
+		IncrementalSortState *sortState = (IncrementalSortState *) child_node;
+
+		if (tuples_needed < 0)
+		{
+			/* make sure flag gets reset if needed upon rescan */
+			sortState->bounded = false;
+		}
+		else
+		{
+			sortState->bounded = true;
+			sortState->bound = tuples_needed;
+		}
+	}
 	else if (IsA(child_node, AppendState))
 	{
 		/*
@@ -891,6 +1009,19 @@ ExecSetTupleBound(int64 tuples_needed, PlanState *child_node)
 		if (subqueryState->ss.ps.qual == NULL)
 			ExecSetTupleBound(tuples_needed, subqueryState->subplan);
 	}
+	else if (IsA(child_node, ForeignScanState))
+	{
+		/*
+		 * A ForeignScan without a local qual can pass the bound on to the
+		 * FDW, which may then ask the remote side for only that many rows.
+		 * As with Sort, the FDW is responsible for reacting properly to
+		 * changes to this parameter.
+		 */
+		ForeignScanState *fsState = (ForeignScanState *) child_node;
+
+		if (fsState->ss.ps.qual == NULL)
+			fsState->tuples_needed = tuples_needed;
+	}
 	else if (IsA(child_node, GatherState))
 	{
 		/*
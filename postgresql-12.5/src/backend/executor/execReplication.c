@@ -481,7 +481,7 @@ ExecSimpleRelationUpdate(EState *estate, EPQState *epqstate,
 	if (!skip_tuple)
 	{
 		List	   *recheckIndexes = NIL;
-		bool		update_indexes;
+		TM_IndexUpdate index_update;
 
 		/* Compute stored generated columns */
 		if (rel->rd_att->constr &&
@@ -495,11 +495,11 @@ ExecSimpleRelationUpdate(EState *estate, EPQState *epqstate,
 			ExecPartitionCheck(resultRelInfo, slot, estate, true);
 
 		simple_table_tuple_update(rel, tid, slot, estate->es_snapshot,
-								  &update_indexes);
+								  &index_update);
 
-		if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
-			recheckIndexes = ExecInsertIndexTuples(slot, estate, false, NULL,
-												   NIL);
+		if (resultRelInfo->ri_NumIndices > 0)
+			recheckIndexes = ExecUpdateIndexTuples(slot, estate, &index_update);
+		bms_free(index_update.changed_attrs);
 
 		/* AFTER ROW UPDATE Triggers */
 		ExecARUpdateTriggers(estate, resultRelInfo,
@@ -559,17 +559,47 @@ CheckCmdReplicaIdentity(Relation rel, CmdType cmd)
 	if (cmd != CMD_UPDATE && cmd != CMD_DELETE)
 		return;
 
-	/* If relation has replica identity we are always good. */
+	pubactions = GetRelationPublicationActions(rel);
+
+	/*
+	 * If relation has replica identity we are good, as long as the row
+	 * filters and column lists of its publications are compatible with it.
+	 */
 	if (rel->rd_rel->relreplident == REPLICA_IDENTITY_FULL ||
 		OidIsValid(RelationGetReplicaIndex(rel)))
+	{
+		if (cmd == CMD_UPDATE && !pubactions->rf_valid_for_update)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot update table \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Column used in the publication WHERE expression is not part of the replica identity.")));
+		else if (cmd == CMD_UPDATE && !pubactions->cols_valid_for_update)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot update table \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Column list used by the publication does not cover the replica identity.")));
+		else if (cmd == CMD_DELETE && !pubactions->rf_valid_for_delete)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot delete from table \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Column used in the publication WHERE expression is not part of the replica identity.")));
+		else if (cmd == CMD_DELETE && !pubactions->cols_valid_for_delete)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot delete from table \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Column list used by the publication does not cover the replica identity.")));
 		return;
+	}
 
 	/*
 	 * This is either UPDATE OR DELETE and there is no replica identity.
 	 *
 	 * Check if the table publishes UPDATES or DELETES.
 	 */
-	pubactions = GetRelationPublicationActions(rel);
 	if (cmd == CMD_UPDATE && pubactions->pubupdate)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -80,6 +80,9 @@ ExecInitTableFunctionResult(Expr *expr,
 
 		init_sexpr(func->funcid, func->inputcollid, expr, state, parent,
 				   econtext->ecxt_per_query_memory, func->funcretset, false);
+
+		/* ExecStreamTableFunctionResult needs to know this for each row */
+		state->funcReturnsTuple = type_is_rowtype(func->funcresulttype);
 	}
 	else
 	{
@@ -425,6 +428,241 @@ no_function_result:
 }
 
 
+/*
+ *		ExecStreamTableFunctionResult
+ *
+ * Evaluate a set-returning table function one row at a time, storing the
+ * next row of its result in slot, whose descriptor must be expectedDesc.
+ * Returns ExprMultipleResult if a row was stored and more may follow,
+ * ExprSingleResult if the stored row is the last one, and ExprEndResult, with
+ * the slot cleared, if there are no more rows.  The caller must not call
+ * again after the last row, except to start over after a rescan of the
+ * expression context.
+ *
+ * Unlike ExecMakeTableFunctionResult, this doesn't collect the result in a
+ * tuplestore unless the function itself chooses materialize mode, so rows
+ * can be returned as soon as the function produces them.  Since we don't
+ * ask for materialize mode, SQL functions are run lazily, too.  The stored
+ * row lives in the per-tuple memory of econtext.  argContext is used to
+ * evaluate the arguments in and must not be shared with other functions
+ * being streamed at the same time.
+ *
+ * This is used by nodeFunctionscan.c, for functions returning set.
+ */
+ExprDoneCond
+ExecStreamTableFunctionResult(SetExprState *setexpr,
+							  ExprContext *econtext,
+							  MemoryContext argContext,
+							  TupleDesc expectedDesc,
+							  TupleTableSlot *slot)
+{
+	FunctionCallInfo fcinfo = setexpr->fcinfo;
+	PgStat_FunctionCallUsage fcusage;
+	ReturnSetInfo rsinfo;
+	MemoryContext oldContext;
+	Datum		result;
+
+	Assert(setexpr->funcReturnsSet && !setexpr->elidedFuncState);
+
+restart:
+
+	ExecClearTuple(slot);
+
+	/*
+	 * If the function returned its result in a tuplestore, continue reading
+	 * rows from it until it's empty.
+	 */
+	if (setexpr->funcResultStore)
+	{
+		if (tuplestore_gettupleslot(setexpr->funcResultStore, true, false,
+									slot))
+			return ExprMultipleResult;
+
+		tuplestore_end(setexpr->funcResultStore);
+		setexpr->funcResultStore = NULL;
+		return ExprEndResult;
+	}
+
+	/*
+	 * Evaluate the arguments, unless we're continuing a ValuePerCall
+	 * function's result, in which case they are still valid from the first
+	 * call.
+	 */
+	if (!setexpr->setArgsValid)
+	{
+		int			i;
+
+		MemoryContextReset(argContext);
+		oldContext = MemoryContextSwitchTo(argContext);
+		ExecEvalFuncArgs(fcinfo, setexpr->args, econtext);
+		MemoryContextSwitchTo(oldContext);
+
+		/* forget the row type seen in a previous evaluation */
+		if (setexpr->funcResultDesc)
+		{
+			FreeTupleDesc(setexpr->funcResultDesc);
+			setexpr->funcResultDesc = NULL;
+		}
+
+		/* for a strict SRF, result for NULL is an empty set */
+		if (setexpr->func.fn_strict)
+		{
+			for (i = 0; i < fcinfo->nargs; i++)
+			{
+				if (fcinfo->args[i].isnull)
+					return ExprEndResult;
+			}
+		}
+	}
+	else
+	{
+		/* Reset flag (we may set it again below) */
+		setexpr->setArgsValid = false;
+	}
+
+	/* Prepare a resultinfo node for communication. */
+	fcinfo->resultinfo = (Node *) &rsinfo;
+	rsinfo.type = T_ReturnSetInfo;
+	rsinfo.econtext = econtext;
+	rsinfo.expectedDesc = expectedDesc;
+	rsinfo.allowedModes = (int) (SFRM_ValuePerCall | SFRM_Materialize);
+	/* note we do not set SFRM_Materialize_Random or _Preferred */
+	rsinfo.returnMode = SFRM_ValuePerCall;
+	/* isDone is filled below */
+	rsinfo.setResult = NULL;
+	rsinfo.setDesc = NULL;
+
+	/* Call the function in the short-lived context */
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	pgstat_init_function_usage(fcinfo, &fcusage);
+
+	fcinfo->isnull = false;
+	rsinfo.isDone = ExprSingleResult;
+	result = FunctionCallInvoke(fcinfo);
+
+	pgstat_end_function_usage(&fcusage,
+							  rsinfo.isDone != ExprMultipleResult);
+
+	MemoryContextSwitchTo(oldContext);
+
+	/* Which protocol does function want to use? */
+	if (rsinfo.returnMode == SFRM_Materialize)
+	{
+		/* check we're on the same page as the function author */
+		if (rsinfo.isDone != ExprSingleResult)
+			ereport(ERROR,
+					(errcode(ERRCODE_E_R_I_E_SRF_PROTOCOL_VIOLATED),
+					 errmsg("table-function protocol for materialize mode was not followed")));
+
+		/* if setResult was left null, treat it as empty set */
+		if (rsinfo.setResult == NULL)
+			return ExprEndResult;
+
+		/*
+		 * If function provided a tupdesc, cross-check it, and free it if it
+		 * is dynamically allocated, as in ExecMakeTableFunctionResult.
+		 */
+		if (rsinfo.setDesc)
+		{
+			tupledesc_match(expectedDesc, rsinfo.setDesc);
+			if (rsinfo.setDesc->tdrefcount == -1)
+				FreeTupleDesc(rsinfo.setDesc);
+		}
+
+		setexpr->funcResultStore = rsinfo.setResult;
+		tuplestore_rescan(setexpr->funcResultStore);
+
+		/* Register cleanup callback if we didn't already */
+		if (!setexpr->shutdown_reg)
+		{
+			RegisterExprContextCallback(econtext,
+										ShutdownSetExpr,
+										PointerGetDatum(setexpr));
+			setexpr->shutdown_reg = true;
+		}
+
+		/* loop back to top to start returning from tuplestore */
+		goto restart;
+	}
+	else if (rsinfo.returnMode != SFRM_ValuePerCall)
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_SRF_PROTOCOL_VIOLATED),
+				 errmsg("unrecognized table-function returnMode: %d",
+						(int) rsinfo.returnMode)));
+
+	if (rsinfo.isDone == ExprEndResult)
+		return ExprEndResult;
+
+	/* Save the current argument values to re-use on the next call */
+	if (rsinfo.isDone == ExprMultipleResult)
+	{
+		setexpr->setArgsValid = true;
+		/* Register cleanup callback if we didn't already */
+		if (!setexpr->shutdown_reg)
+		{
+			RegisterExprContextCallback(econtext,
+										ShutdownSetExpr,
+										PointerGetDatum(setexpr));
+			setexpr->shutdown_reg = true;
+		}
+	}
+
+	/*
+	 * Store the row in the slot, deforming a composite result according to
+	 * expectedDesc, just as reading it back from a tuplestore would.
+	 */
+	if (!setexpr->funcReturnsTuple)
+	{
+		/* Scalar-type case: just store the function result */
+		slot->tts_values[0] = result;
+		slot->tts_isnull[0] = fcinfo->isnull;
+	}
+	else if (fcinfo->isnull)
+	{
+		/* NULL result from a tuple-returning function; make all-nulls row */
+		memset(slot->tts_isnull, true, expectedDesc->natts * sizeof(bool));
+	}
+	else
+	{
+		HeapTupleHeader td = DatumGetHeapTupleHeader(result);
+		HeapTupleData tmptup;
+
+		if (setexpr->funcResultDesc == NULL)
+		{
+			/*
+			 * This is the first non-NULL result from the function.  Check
+			 * that its row type is what the query expects, and remember it
+			 * in funcResultDesc, which table functions don't otherwise use,
+			 * to check the later rows against.
+			 */
+			oldContext = MemoryContextSwitchTo(setexpr->func.fn_mcxt);
+			setexpr->funcResultDesc =
+				lookup_rowtype_tupdesc_copy(HeapTupleHeaderGetTypeId(td),
+											HeapTupleHeaderGetTypMod(td));
+			MemoryContextSwitchTo(oldContext);
+			tupledesc_match(expectedDesc, setexpr->funcResultDesc);
+		}
+		else if (HeapTupleHeaderGetTypeId(td) != setexpr->funcResultDesc->tdtypeid ||
+				 HeapTupleHeaderGetTypMod(td) != setexpr->funcResultDesc->tdtypmod)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("rows returned by function are not all of the same row type")));
+
+		tmptup.t_len = HeapTupleHeaderGetDatumLength(td);
+		ItemPointerSetInvalid(&(tmptup.t_self));
+		tmptup.t_tableOid = InvalidOid;
+		tmptup.t_data = td;
+		heap_deform_tuple(&tmptup, expectedDesc,
+						  slot->tts_values, slot->tts_isnull);
+	}
+
+	ExecStoreVirtualTuple(slot);
+
+	return rsinfo.isDone;
+}
+
+
 /*
  * Prepare targetlist SRF function call for execution.
  *
@@ -73,6 +73,9 @@ static TupleDesc ExecTypeFromTLInternal(List *targetList,
 										bool skipjunk);
 static pg_attribute_always_inline void slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 															  int natts);
+static SlotNullOffsets *slot_null_offsets(TupleTableSlot *slot);
+static int	slot_null_offsets_usable(SlotNullOffsets *nulloffs, bits8 *bp,
+									 int natts);
 static inline void tts_buffer_heap_store_tuple(TupleTableSlot *slot,
 											   HeapTuple tuple,
 											   Buffer buffer,
@@ -888,6 +891,14 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
  *		re-computing information about previously extracted attributes.
  *		slot->tts_nvalid is the number of attributes already extracted.
  *
+ * attcacheoff can't be used past the first null.  For tuples with nulls, we
+ * instead keep the offsets of the leading fixed-width attributes in the
+ * slot's tts_nulloffs, along with the null bitmap they were computed for;
+ * the next tuple with the same nulls in those attributes can take its
+ * offsets from there.  Rows of a table tend to have the same columns null,
+ * so this usually covers as much of the tuple as attcacheoff would without
+ * nulls.
+ *
  * This is marked as always inline, so the different offp for different types
  * of slots gets optimized away.
  */
@@ -905,6 +916,9 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 	uint32		off;			/* offset in tuple data */
 	bits8	   *bp = tup->t_bits;	/* ptr to null bitmap in tuple */
 	bool		slow;			/* can we use/set attcacheoff? */
+	SlotNullOffsets *nulloffs = NULL;
+	int			nusable = 0;	/* take offsets below this from nulloffs */
+	bool		record = false; /* add offsets to nulloffs? */
 
 	/* We can only fetch as many attributes as the tuple has. */
 	natts = Min(HeapTupleHeaderGetNatts(tuple->t_data), natts);
@@ -927,6 +941,25 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 		slow = TTS_SLOW(slot);
 	}
 
+	/*
+	 * See how much of the cached offsets applies to this tuple.  If they are
+	 * for other nulls, start over, unless we're resuming midway through the
+	 * tuple and so can't record the offsets before this point.
+	 */
+	if (hasnulls && attnum < natts)
+	{
+		nulloffs = slot_null_offsets(slot);
+		nusable = slot_null_offsets_usable(nulloffs, bp, natts);
+		if (nusable < Min(nulloffs->ncached, natts) && attnum == 0)
+		{
+			nulloffs->ncached = 0;
+			nulloffs->complete = false;
+			nusable = 0;
+		}
+		record = (nusable == nulloffs->ncached && !nulloffs->complete &&
+				  attnum <= nusable);
+	}
+
 	tp = (char *) tup + tup->t_hoff;
 
 	for (; attnum < natts; attnum++)
@@ -938,12 +971,19 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 			values[attnum] = (Datum) 0;
 			isnull[attnum] = true;
 			slow = true;		/* can't use attcacheoff anymore */
+			if (record && attnum == nulloffs->ncached)
+			{
+				nulloffs->bits[attnum >> 3] &= ~(1 << (attnum & 0x07));
+				nulloffs->ncached++;
+			}
 			continue;
 		}
 
 		isnull[attnum] = false;
 
-		if (!slow && thisatt->attcacheoff >= 0)
+		if (attnum < nusable)
+			off = nulloffs->offsets[attnum];
+		else if (!slow && thisatt->attcacheoff >= 0)
 			off = thisatt->attcacheoff;
 		else if (thisatt->attlen == -1)
 		{
@@ -972,6 +1012,21 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 				thisatt->attcacheoff = off;
 		}
 
+		if (record && attnum == nulloffs->ncached)
+		{
+			if (thisatt->attlen > 0)
+			{
+				nulloffs->bits[attnum >> 3] |= 1 << (attnum & 0x07);
+				nulloffs->offsets[attnum] = off;
+				nulloffs->ncached++;
+			}
+			else
+			{
+				nulloffs->complete = true;
+				record = false;
+			}
+		}
+
 		values[attnum] = fetchatt(thisatt, tp + off);
 
 		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
@@ -991,6 +1046,55 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 		slot->tts_flags &= ~TTS_FLAG_SLOW;
 }
 
+/*
+ * Get the slot's cache of attribute offsets for tuples with nulls, creating
+ * it if needed.
+ */
+static SlotNullOffsets *
+slot_null_offsets(TupleTableSlot *slot)
+{
+	SlotNullOffsets *nulloffs = slot->tts_nulloffs;
+
+	if (unlikely(nulloffs == NULL))
+	{
+		int			natts = slot->tts_tupleDescriptor->natts;
+		Size		sz;
+
+		sz = MAXALIGN(offsetof(SlotNullOffsets, offsets) +
+					  natts * sizeof(uint32));
+		nulloffs = MemoryContextAlloc(slot->tts_mcxt,
+									  sz + BITMAPLEN(natts));
+		nulloffs->ncached = 0;
+		nulloffs->complete = false;
+		nulloffs->bits = (bits8 *) ((char *) nulloffs + sz);
+		slot->tts_nulloffs = nulloffs;
+	}
+
+	return nulloffs;
+}
+
+/*
+ * Return how many leading attributes, up to natts, of a tuple with null
+ * bitmap bp can take their offsets from nulloffs.  That's all the cached
+ * ones, if the tuple's nulls match those the offsets were computed for, else
+ * none.
+ */
+static int
+slot_null_offsets_usable(SlotNullOffsets *nulloffs, bits8 *bp, int natts)
+{
+	int			n = Min(nulloffs->ncached, natts);
+	int			nbytes = n >> 3;
+	int			nbits = n & 0x07;
+
+	if (memcmp(nulloffs->bits, bp, nbytes) != 0)
+		return 0;
+	if (nbits != 0 &&
+		((nulloffs->bits[nbytes] ^ bp[nbytes]) & ((1 << nbits) - 1)) != 0)
+		return 0;
+
+	return n;
+}
+
 
 const TupleTableSlotOps TTSOpsVirtual = {
 	.base_slot_size = sizeof(VirtualTupleTableSlot),
@@ -1186,6 +1290,8 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 				if (slot->tts_isnull)
 					pfree(slot->tts_isnull);
 			}
+			if (slot->tts_nulloffs)
+				pfree(slot->tts_nulloffs);
 			pfree(slot);
 		}
 	}
@@ -1236,6 +1342,8 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 		if (slot->tts_isnull)
 			pfree(slot->tts_isnull);
 	}
+	if (slot->tts_nulloffs)
+		pfree(slot->tts_nulloffs);
 	pfree(slot);
 }
 
@@ -1276,6 +1384,13 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
 
+	/* Cached attribute offsets are for the old descriptor, too */
+	if (slot->tts_nulloffs)
+	{
+		pfree(slot->tts_nulloffs);
+		slot->tts_nulloffs = NULL;
+	}
+
 	/*
 	 * Install the new descriptor; if it's refcounted, bump its refcount.
 	 */
@@ -64,6 +64,7 @@
 
 
 static bool tlist_matches_tupdesc(PlanState *ps, List *tlist, Index varno, TupleDesc tupdesc);
+static ExprContext *CreateExprContextInternal(EState *estate, bool bump);
 static void ShutdownExprContext(ExprContext *econtext, bool isCommit);
 
 
@@ -155,6 +156,8 @@ CreateExecutorState(void)
 
 	estate->es_auxmodifytables = NIL;
 
+	estate->es_insert_pending_result_relations = NIL;
+
 	estate->es_per_tuple_exprcontext = NULL;
 
 	estate->es_sourceText = NULL;
@@ -243,6 +246,20 @@ FreeExecutorState(EState *estate)
  */
 ExprContext *
 CreateExprContext(EState *estate)
+{
+	return CreateExprContextInternal(estate, false);
+}
+
+/*
+ * CreateExprContextInternal
+ *
+ * Workhorse for CreateExprContext and ExecAssignExprContext.  If "bump" is
+ * true, the per-tuple memory is a bump context, which is cheaper to allocate
+ * from but never reuses pfree'd space until it is reset; that is only
+ * appropriate when the context really is reset for each tuple.
+ */
+static ExprContext *
+CreateExprContextInternal(EState *estate, bool bump)
 {
 	ExprContext *econtext;
 	MemoryContext oldcontext;
@@ -262,10 +279,16 @@ CreateExprContext(EState *estate)
 	/*
 	 * Create working memory for expression evaluation in this context.
 	 */
-	econtext->ecxt_per_tuple_memory =
-		AllocSetContextCreate(estate->es_query_cxt,
+	if (bump)
+		econtext->ecxt_per_tuple_memory =
+			BumpContextCreate(estate->es_query_cxt,
 							  "ExprContext",
 							  ALLOCSET_DEFAULT_SIZES);
+	else
+		econtext->ecxt_per_tuple_memory =
+			AllocSetContextCreate(estate->es_query_cxt,
+								  "ExprContext",
+								  ALLOCSET_DEFAULT_SIZES);
 
 	econtext->ecxt_param_exec_vals = estate->es_param_exec_vals;
 	econtext->ecxt_param_list_info = estate->es_param_list_info;
@@ -439,12 +462,16 @@ MakePerTupleExprContext(EState *estate)
  *		to do this for nodes which use ExecQual or ExecProject
  *		because those routines require an econtext. Other nodes that
  *		don't have to evaluate expressions don't need to do this.
+ *
+ *		Plan nodes reset their per-tuple memory for every tuple, so it
+ *		is a bump context.  Nodes that need an ExprContext whose memory
+ *		outlives a single tuple should use CreateExprContext instead.
  * ----------------
  */
 void
 ExecAssignExprContext(EState *estate, PlanState *planstate)
 {
-	planstate->ps_ExprContext = CreateExprContext(estate);
+	planstate->ps_ExprContext = CreateExprContextInternal(estate, true);
 }
 
 /* ----------------
@@ -778,7 +805,29 @@ ExecGetRangeTableRelation(EState *estate, Index rti)
 
 		Assert(rte->rtekind == RTE_RELATION);
 
-		if (!IsParallelWorker())
+		if (IsParallelWorker())
+		{
+			/*
+			 * If we are a parallel worker, we need to obtain our own local
+			 * lock on the relation.  This ensures sane behavior in case the
+			 * parent process exits before we do.
+			 */
+			rel = table_open(rte->relid, rte->rellockmode);
+		}
+		else if (estate->es_plannedstmt != NULL &&
+				 bms_is_member(rti, estate->es_plannedstmt->prunableRelids))
+		{
+			/*
+			 * AcquireExecutorLocks() doesn't lock relations that it expects
+			 * initial partition pruning to remove from the plan.  We should
+			 * only get here for one of those if pruning kept it after all
+			 * (for example, as the one subplan an Append initializes when
+			 * everything is pruned), so make sure we hold the lock.  This is
+			 * cheap if we already do.
+			 */
+			rel = table_open(rte->relid, rte->rellockmode);
+		}
+		else
 		{
 			/*
 			 * In a normal query, we should already have the appropriate lock,
@@ -791,15 +840,6 @@ ExecGetRangeTableRelation(EState *estate, Index rti)
 			Assert(rte->rellockmode == AccessShareLock ||
 				   CheckRelationLockedByMe(rel, rte->rellockmode, false));
 		}
-		else
-		{
-			/*
-			 * If we are a parallel worker, we need to obtain our own local
-			 * lock on the relation.  This ensures sane behavior in case the
-			 * parent process exits before we do.
-			 */
-			rel = table_open(rte->relid, rte->rellockmode);
-		}
 
 		estate->es_relations[rti - 1] = rel;
 	}
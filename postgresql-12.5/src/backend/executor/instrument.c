@@ -14,16 +14,138 @@
 #include "postgres.h"
 
 #include <unistd.h>
+#ifdef HAVE__GET_CPUID
+#include <cpuid.h>
+#endif
 
 #include "executor/instrument.h"
 
 BufferUsage pgBufferUsage;
 static BufferUsage save_pgBufferUsage;
+WalUsage	pgWalUsage;
+static WalUsage save_pgWalUsage;
+
+/*
+ * Whether node timing reads the CPU cycle counter instead of the clock, and
+ * if so the length of a cycle in nanoseconds, as a 32.32 fixed-point number.
+ */
+bool		instr_use_cycles = false;
+static uint64 instr_ns_per_cycle;
 
 static void BufferUsageAdd(BufferUsage *dst, const BufferUsage *add);
 static void BufferUsageAccumDiff(BufferUsage *dst,
 								 const BufferUsage *add, const BufferUsage *sub);
+static void WalUsageAdd(WalUsage *dst, WalUsage *add);
+
+static inline bool InstrStartTimer(Instrumentation *instr);
+static inline bool InstrStopTimer(Instrumentation *instr);
+
+
+/*
+ * Decide whether node timing can use the cycle counter, and calibrate it.
+ *
+ * The counter qualifies only if the CPU promises it ticks at a constant
+ * rate regardless of frequency scaling and sleep states ("invariant TSC").
+ * We then measure its rate against the regular clock.  This is called in
+ * the postmaster, so that backends inherit the result instead of each
+ * spending time on calibration; in EXEC_BACKEND builds backends just use
+ * the clock.
+ */
+void
+InstrInitCycleCounter(void)
+{
+#ifdef PG_INSTR_CYCLES
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+	instr_time	start,
+				now;
+	uint64		startcycles,
+				cycles;
+	double		elapsed,
+				hz;
+
+	instr_use_cycles = false;
+
+	if (__get_cpuid_max(0x80000000, NULL) < 0x80000007 ||
+		!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+		(edx & (1 << 8)) == 0)
+		return;
+
+	/* Spin for about 10ms, then compare the two clocks */
+	INSTR_TIME_SET_CURRENT(start);
+	startcycles = pg_read_cycles();
+	do
+	{
+		INSTR_TIME_SET_CURRENT(now);
+		cycles = pg_read_cycles() - startcycles;
+		INSTR_TIME_SUBTRACT(now, start);
+		elapsed = INSTR_TIME_GET_DOUBLE(now);
+	} while (elapsed < 0.01);
+
+	/* Distrust anything outside 100MHz .. 100GHz */
+	hz = cycles / elapsed;
+	if (hz < 1e8 || hz > 1e11)
+		return;
+
+	instr_ns_per_cycle = (uint64) (1e9 / hz * 4294967296.0);
+	instr_use_cycles = true;
+#endif
+}
+
+/*
+ * Start timing a node; returns false if the timer was already running.
+ */
+static inline bool
+InstrStartTimer(Instrumentation *instr)
+{
+#ifdef PG_INSTR_CYCLES
+	if (instr_use_cycles)
+	{
+		if (instr->startcycles != 0)
+			return false;
+		instr->startcycles = pg_read_cycles();
+		return true;
+	}
+#endif
+	return INSTR_TIME_SET_CURRENT_LAZY(instr->starttime);
+}
+
+/*
+ * Stop timing a node and add the elapsed time to its counter; returns false
+ * if the timer was not running.
+ */
+static inline bool
+InstrStopTimer(Instrumentation *instr)
+{
+	instr_time	endtime;
+
+#ifdef PG_INSTR_CYCLES
+	if (instr_use_cycles)
+	{
+		uint64		cycles;
+		uint64		ns;
+
+		if (instr->startcycles == 0)
+			return false;
+		cycles = pg_read_cycles() - instr->startcycles;
+		ns = (cycles >> 32) * instr_ns_per_cycle +
+			(((cycles & 0xFFFFFFFF) * instr_ns_per_cycle) >> 32);
+		INSTR_TIME_ADD_NANOSEC(instr->counter, ns);
+		instr->startcycles = 0;
+		return true;
+	}
+#endif
+	if (INSTR_TIME_IS_ZERO(instr->starttime))
+		return false;
+
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
 
+	INSTR_TIME_SET_ZERO(instr->starttime);
+	return true;
+}
 
 /* Allocate new instrumentation structure(s) */
 Instrumentation *
@@ -33,15 +155,17 @@ InstrAlloc(int n, int instrument_options)
 
 	/* initialize all fields to zeroes, then modify as needed */
 	instr = palloc0(n * sizeof(Instrumentation));
-	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER))
+	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER | INSTRUMENT_WAL))
 	{
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
+		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
 		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 		int			i;
 
 		for (i = 0; i < n; i++)
 		{
 			instr[i].need_bufusage = need_buffers;
+			instr[i].need_walusage = need_wal;
 			instr[i].need_timer = need_timer;
 		}
 	}
@@ -55,6 +179,7 @@ InstrInit(Instrumentation *instr, int instrument_options)
 {
 	memset(instr, 0, sizeof(Instrumentation));
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
+	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
 	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 }
 
@@ -62,41 +187,37 @@ InstrInit(Instrumentation *instr, int instrument_options)
 void
 InstrStartNode(Instrumentation *instr)
 {
-	if (instr->need_timer &&
-		!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
+	if (instr->need_timer && !InstrStartTimer(instr))
 		elog(ERROR, "InstrStartNode called twice in a row");
 
 	/* save buffer usage totals at node entry, if needed */
 	if (instr->need_bufusage)
 		instr->bufusage_start = pgBufferUsage;
+
+	if (instr->need_walusage)
+		instr->walusage_start = pgWalUsage;
 }
 
 /* Exit from a plan node */
 void
 InstrStopNode(Instrumentation *instr, double nTuples)
 {
-	instr_time	endtime;
-
 	/* count the returned tuples */
 	instr->tuplecount += nTuples;
 
 	/* let's update the time only if the timer was requested */
-	if (instr->need_timer)
-	{
-		if (INSTR_TIME_IS_ZERO(instr->starttime))
-			elog(ERROR, "InstrStopNode called without start");
-
-		INSTR_TIME_SET_CURRENT(endtime);
-		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
-
-		INSTR_TIME_SET_ZERO(instr->starttime);
-	}
+	if (instr->need_timer && !InstrStopTimer(instr))
+		elog(ERROR, "InstrStopNode called without start");
 
 	/* Add delta of buffer usage since entry to node's totals */
 	if (instr->need_bufusage)
 		BufferUsageAccumDiff(&instr->bufusage,
 							 &pgBufferUsage, &instr->bufusage_start);
 
+	if (instr->need_walusage)
+		WalUsageAccumDiff(&instr->walusage,
+						  &pgWalUsage, &instr->walusage_start);
+
 	/* Is this the first tuple of this cycle? */
 	if (!instr->running)
 	{
@@ -115,7 +236,7 @@ InstrEndLoop(Instrumentation *instr)
 	if (!instr->running)
 		return;
 
-	if (!INSTR_TIME_IS_ZERO(instr->starttime))
+	if (!INSTR_TIME_IS_ZERO(instr->starttime) || instr->startcycles != 0)
 		elog(ERROR, "InstrEndLoop called on running node");
 
 	/* Accumulate per-cycle statistics into totals */
@@ -129,6 +250,7 @@ InstrEndLoop(Instrumentation *instr)
 	/* Reset for next cycle (if any) */
 	instr->running = false;
 	INSTR_TIME_SET_ZERO(instr->starttime);
+	instr->startcycles = 0;
 	INSTR_TIME_SET_ZERO(instr->counter);
 	instr->firsttuple = 0;
 	instr->tuplecount = 0;
@@ -160,6 +282,9 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	/* Add delta of buffer usage since entry to node's totals */
 	if (dst->need_bufusage)
 		BufferUsageAdd(&dst->bufusage, &add->bufusage);
+
+	if (dst->need_walusage)
+		WalUsageAdd(&dst->walusage, &add->walusage);
 }
 
 /* note current values during parallel executor startup */
@@ -167,21 +292,25 @@ void
 InstrStartParallelQuery(void)
 {
 	save_pgBufferUsage = pgBufferUsage;
+	save_pgWalUsage = pgWalUsage;
 }
 
 /* report usage after parallel executor shutdown */
 void
-InstrEndParallelQuery(BufferUsage *result)
+InstrEndParallelQuery(BufferUsage *bufusage, WalUsage *walusage)
 {
-	memset(result, 0, sizeof(BufferUsage));
-	BufferUsageAccumDiff(result, &pgBufferUsage, &save_pgBufferUsage);
+	memset(bufusage, 0, sizeof(BufferUsage));
+	BufferUsageAccumDiff(bufusage, &pgBufferUsage, &save_pgBufferUsage);
+	memset(walusage, 0, sizeof(WalUsage));
+	WalUsageAccumDiff(walusage, &pgWalUsage, &save_pgWalUsage);
 }
 
 /* accumulate work done by workers in leader's stats */
 void
-InstrAccumParallelQuery(BufferUsage *result)
+InstrAccumParallelQuery(BufferUsage *bufusage, WalUsage *walusage)
 {
-	BufferUsageAdd(&pgBufferUsage, result);
+	BufferUsageAdd(&pgBufferUsage, bufusage);
+	WalUsageAdd(&pgWalUsage, walusage);
 }
 
 /* dst += add */
@@ -223,3 +352,20 @@ BufferUsageAccumDiff(BufferUsage *dst,
 	INSTR_TIME_ACCUM_DIFF(dst->blk_write_time,
 						  add->blk_write_time, sub->blk_write_time);
 }
+
+/* helper functions for WAL usage accumulation */
+static void
+WalUsageAdd(WalUsage *dst, WalUsage *add)
+{
+	dst->wal_bytes += add->wal_bytes;
+	dst->wal_records += add->wal_records;
+	dst->wal_fpi += add->wal_fpi;
+}
+
+void
+WalUsageAccumDiff(WalUsage *dst, const WalUsage *add, const WalUsage *sub)
+{
+	dst->wal_bytes += add->wal_bytes - sub->wal_bytes;
+	dst->wal_records += add->wal_records - sub->wal_records;
+	dst->wal_fpi += add->wal_fpi - sub->wal_fpi;
+}
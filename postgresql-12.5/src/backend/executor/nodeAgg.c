@@ -194,6 +194,22 @@
  *	  transition values.  hashcontext is the single context created to support
  *	  all hash tables.
  *
+ *	  Spilling To Disk
+ *
+ *	  When performing hash aggregation, if the hash table memory exceeds the
+ *	  limit (work_mem), we enter "spill mode".  In spill mode, we advance the
+ *	  transition states only for groups already in the hash table.  For
+ *	  tuples that would need to create a new hash table entry, we instead
+ *	  spill the tuple to disk, into one of several partition files chosen by
+ *	  the high bits of the grouping key's hash value.  Once the input is
+ *	  exhausted, we emit the groups in the hash table, then empty it and
+ *	  process the spilled partitions one at a time as batches, treating each
+ *	  one as new input.  A batch may itself exceed the memory limit, in which
+ *	  case its overflow is partitioned again using the next hash bits.  This
+ *	  is only done for plain hashed aggregation with a single hash table;
+ *	  grouping sets are never spilled.  If all hash bits have been used up,
+ *	  the table is simply allowed to grow past the limit.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -230,14 +246,50 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/dynahash.h"
+#include "utils/hashutils.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
 #include "utils/datum.h"
 
+/*
+ * Bounds for the number of partitions created each time the hash table
+ * overflows.
+ */
+#define HASHAGG_MIN_PARTITIONS		4
+#define HASHAGG_MAX_PARTITIONS		256
+
+/*
+ * Partitions being written while the hash table is in spill mode.  Each
+ * partition receives the tuples whose hash value has the partition number in
+ * the bits selected by "mask" and "shift".
+ */
+typedef struct HashAggSpill
+{
+	int			npartitions;	/* number of partitions */
+	int			partition_bits; /* log2(npartitions) */
+	BufFile   **partitions;		/* spill file for each partition, or NULL */
+	int64	   *ntuples;		/* number of tuples in each partition */
+	uint32		mask;			/* mask to find partition from hash value */
+	int			shift;			/* after masking, shift by this amount */
+} HashAggSpill;
+
+/*
+ * A spilled partition that is waiting to be re-aggregated.  used_bits is the
+ * number of high hash bits that all tuples in the batch have in common.
+ */
+typedef struct HashAggBatch
+{
+	int			used_bits;		/* number of hash bits already used */
+	BufFile    *input_file;		/* tuples spilled to this batch */
+	int64		input_tuples;	/* number of tuples in the file */
+} HashAggBatch;
+
 
 static void select_current_set(AggState *aggstate, int setno, bool is_hash);
 static void initialize_phase(AggState *aggstate, int newphase);
@@ -274,7 +326,15 @@ static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
 static TupleHashEntryData *lookup_hash_entry(AggState *aggstate);
-static void lookup_hash_entries(AggState *aggstate);
+static bool lookup_hash_entries(AggState *aggstate);
+static Size hash_agg_mem_used(AggState *aggstate);
+static void hash_agg_check_limits(AggState *aggstate);
+static uint32 hashagg_spill_hash(AggStatePerHash perhash);
+static void hashagg_spill_tuple(AggState *aggstate, TupleTableSlot *slot);
+static void hashagg_spill_finish(AggState *aggstate);
+static MinimalTuple hashagg_batch_read(HashAggBatch *batch);
+static void hashagg_refill_hash_table(AggState *aggstate);
+static void hashagg_reset_spill_state(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
@@ -402,6 +462,20 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->input_batched)
+	{
+		/* hand out the current batch, and fetch another when it runs out */
+		if (aggstate->input_batch_next >= aggstate->input_batch_ntuples)
+		{
+			aggstate->input_batch_ntuples =
+				ExecProcNodeBatch(outerPlanState(aggstate),
+								  &aggstate->input_batch);
+			aggstate->input_batch_next = 0;
+			if (aggstate->input_batch_ntuples == 0)
+				return NULL;
+		}
+		slot = aggstate->input_batch[aggstate->input_batch_next++];
+	}
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -1451,6 +1525,9 @@ hash_agg_entry_size(int numAggs)
  * set (which the caller must have selected - note that initialize_aggregate
  * depends on this).
  *
+ * In spill mode, no new entries are created; NULL is returned if the group
+ * is not already present, and the caller must spill the tuple instead.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static TupleHashEntryData *
@@ -1476,6 +1553,10 @@ lookup_hash_entry(AggState *aggstate)
 	}
 	ExecStoreVirtualTuple(hashslot);
 
+	/* in spill mode, only look for groups already in the table */
+	if (aggstate->hash_spill_mode)
+		return LookupTupleHashEntry(perhash->hashtable, hashslot, NULL);
+
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
 
@@ -1500,6 +1581,12 @@ lookup_hash_entry(AggState *aggstate)
 
 			initialize_aggregate(aggstate, pertrans, pergroupstate);
 		}
+
+		if (aggstate->hash_can_spill)
+		{
+			aggstate->hash_ngroups_current++;
+			hash_agg_check_limits(aggstate);
+		}
 	}
 
 	return entry;
@@ -1509,9 +1596,13 @@ lookup_hash_entry(AggState *aggstate)
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
  *
+ * Returns false if the tuple's group is not in the hash table and the table
+ * is in spill mode; the caller must then spill the tuple rather than advance
+ * the aggregates.
+ *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  */
-static void
+static bool
 lookup_hash_entries(AggState *aggstate)
 {
 	int			numHashes = aggstate->num_hashes;
@@ -1520,9 +1611,354 @@ lookup_hash_entries(AggState *aggstate)
 
 	for (setno = 0; setno < numHashes; setno++)
 	{
+		TupleHashEntryData *entry;
+
 		select_current_set(aggstate, setno, true);
-		pergroup[setno] = lookup_hash_entry(aggstate)->additional;
+		entry = lookup_hash_entry(aggstate);
+		if (entry == NULL)
+			return false;
+		pergroup[setno] = entry->additional;
+	}
+
+	return true;
+}
+
+/*
+ * Estimate the memory consumed by the hash table: its bucket array, plus the
+ * memory allocated for the representative tuples and transition states of
+ * all groups.
+ */
+static Size
+hash_agg_mem_used(AggState *aggstate)
+{
+	TupleHashTable hashtable = aggstate->perhash[0].hashtable;
+
+	return MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+									 true) +
+		hashtable->hashtab->size * sizeof(TupleHashEntryData);
+}
+
+/*
+ * Enter spill mode if the hash table has outgrown the memory limit.
+ *
+ * The number of partitions is chosen so that each of them can be expected to
+ * fit in memory when it is read back, based on the average size of the groups
+ * created so far and the number of groups the input is estimated to contain.
+ */
+static void
+hash_agg_check_limits(AggState *aggstate)
+{
+	MemoryContext oldcontext;
+	HashAggSpill *spill;
+	Size		mem_used;
+	double		group_size;
+	double		est_groups;
+	double		npartitions;
+	int			partition_bits;
+	int			max_partitions;
+
+	Assert(aggstate->hash_can_spill && !aggstate->hash_spill_mode);
+
+	mem_used = hash_agg_mem_used(aggstate);
+	if (mem_used <= aggstate->hash_mem_limit)
+		return;
+
+	/* all hash bits used up; nothing to do but keep growing the table */
+	if (aggstate->hash_used_bits >= 32)
+		return;
+
+	/*
+	 * Estimate how many groups are yet to come, assuming at least as many as
+	 * we've already seen.  For the initial pass the estimate is the
+	 * planner's; for a batch, it's the number of tuples in it.
+	 */
+	group_size = (double) mem_used / aggstate->hash_ngroups_current;
+	est_groups = Max(aggstate->hash_ngroups_estimate,
+					 aggstate->hash_ngroups_current * 2);
+	npartitions = 1.5 * (est_groups - aggstate->hash_ngroups_current) *
+		group_size / aggstate->hash_mem_limit;
+
+	/* each open partition file needs a buffer of its own */
+	max_partitions = (aggstate->hash_mem_limit / 4) / BLCKSZ;
+	max_partitions = Min(max_partitions, HASHAGG_MAX_PARTITIONS);
+	max_partitions = Max(max_partitions, HASHAGG_MIN_PARTITIONS);
+
+	npartitions = Max(npartitions, HASHAGG_MIN_PARTITIONS);
+	npartitions = Min(npartitions, max_partitions);
+	partition_bits = my_log2((long) npartitions);
+
+	if (aggstate->hash_used_bits + partition_bits > 32)
+		partition_bits = 32 - aggstate->hash_used_bits;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	spill = palloc(sizeof(HashAggSpill));
+	spill->npartitions = 1 << partition_bits;
+	spill->partition_bits = partition_bits;
+	spill->partitions = palloc0(sizeof(BufFile *) * spill->npartitions);
+	spill->ntuples = palloc0(sizeof(int64) * spill->npartitions);
+	spill->shift = 32 - aggstate->hash_used_bits - partition_bits;
+	spill->mask = (uint32) (spill->npartitions - 1) << spill->shift;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	aggstate->hash_spill = spill;
+	aggstate->hash_spill_mode = true;
+}
+
+/*
+ * Compute the hash value used to assign a spilled tuple to a partition, from
+ * the grouping columns present in perhash->hashslot.  This is computed the
+ * same way as the hash table's own hash values.
+ */
+static uint32
+hashagg_spill_hash(AggStatePerHash perhash)
+{
+	TupleTableSlot *hashslot = perhash->hashslot;
+	uint32		hashkey = 0;
+	int			i;
+
+	for (i = 0; i < perhash->numCols; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		/* treat nulls as having hash key 0 */
+		if (!hashslot->tts_isnull[i])
+		{
+			uint32		hkey;
+
+			if (!hash_builtin_datum(perhash->hashfunctions[i].fn_oid,
+									perhash->aggnode->grpCollations[i],
+									hashslot->tts_values[i], &hkey))
+				hkey = DatumGetUInt32(FunctionCall1Coll(&perhash->hashfunctions[i],
+														perhash->aggnode->grpCollations[i],
+														hashslot->tts_values[i]));
+			hashkey ^= hkey;
+		}
+	}
+
+	return murmurhash32(hashkey);
+}
+
+/*
+ * Write the input tuple in slot to the spill partition its group belongs to.
+ * lookup_hash_entry() must already have filled the hashslot for it.
+ */
+static void
+hashagg_spill_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	MemoryContext oldcontext;
+	MinimalTuple tuple;
+	bool		shouldFree;
+	uint32		hash;
+	int			partition;
+	size_t		written;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+	hash = hashagg_spill_hash(&aggstate->perhash[0]);
+	MemoryContextSwitchTo(oldcontext);
+
+	partition = (hash & spill->mask) >> spill->shift;
+
+	if (spill->partitions[partition] == NULL)
+	{
+		oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+		spill->partitions[partition] = BufFileCreateCompressTemp(false);
+		MemoryContextSwitchTo(oldcontext);
 	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+	written = BufFileWrite(spill->partitions[partition],
+						   (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	spill->ntuples[partition]++;
+	aggstate->hash_disk_used += tuple->t_len;
+
+	if (shouldFree)
+		pfree(tuple);
+}
+
+/*
+ * Turn the partitions written during the current pass into batches to be
+ * processed later, and leave spill mode.
+ */
+static void
+hashagg_spill_finish(AggState *aggstate)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (spill == NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	for (i = 0; i < spill->npartitions; i++)
+	{
+		HashAggBatch *batch;
+
+		if (spill->partitions[i] == NULL)
+			continue;
+
+		batch = palloc(sizeof(HashAggBatch));
+		batch->used_bits = aggstate->hash_used_bits + spill->partition_bits;
+		batch->input_file = spill->partitions[i];
+		batch->input_tuples = spill->ntuples[i];
+
+		aggstate->hash_batches = lappend(aggstate->hash_batches, batch);
+		aggstate->hash_batches_used++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	pfree(spill->partitions);
+	pfree(spill->ntuples);
+	pfree(spill);
+	aggstate->hash_spill = NULL;
+	aggstate->hash_spill_mode = false;
+}
+
+/*
+ * Read the next tuple from a batch's file, or NULL at end of file.  The tuple
+ * is palloc'd in the current memory context.
+ */
+static MinimalTuple
+hashagg_batch_read(HashAggBatch *batch)
+{
+	MinimalTuple tuple;
+	uint32		t_len;
+	size_t		nread;
+
+	nread = BufFileRead(batch->input_file, (void *) &t_len, sizeof(uint32));
+	if (nread == 0)
+		return NULL;
+	if (nread != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+
+	tuple = (MinimalTuple) palloc(t_len);
+	tuple->t_len = t_len;
+	nread = BufFileRead(batch->input_file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						t_len - sizeof(uint32));
+	if (nread != t_len - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+
+	return tuple;
+}
+
+/*
+ * Empty the hash table and rebuild it from the next spilled batch.  Groups
+ * that don't fit are spilled again, into new batches that use further bits
+ * of the hash value.
+ */
+static void
+hashagg_refill_hash_table(AggState *aggstate)
+{
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleTableSlot *slot = aggstate->hash_spill_slot;
+	HashAggBatch *batch;
+	MinimalTuple tuple;
+
+	Assert(aggstate->hash_batches != NIL);
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+
+	/*
+	 * All groups in the table have been emitted, so release their state
+	 * (running any shutdown callbacks) and start over with an empty table.
+	 */
+	ReScanExprContext(aggstate->hashcontext);
+	build_hash_table(aggstate);
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_ngroups_estimate = batch->input_tuples;
+	aggstate->hash_used_bits = batch->used_bits;
+
+	select_current_set(aggstate, 0, true);
+
+	if (BufFileSeek(batch->input_file, 0, 0L, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+	while ((tuple = hashagg_batch_read(batch)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		ExecStoreMinimalTuple(tuple, slot, true);
+
+		/* set up for lookup_hash_entries and advance_aggregates */
+		tmpcontext->ecxt_outertuple = slot;
+
+		if (lookup_hash_entries(aggstate))
+			advance_aggregates(aggstate);
+		else
+			hashagg_spill_tuple(aggstate, slot);
+
+		ResetExprContext(aggstate->tmpcontext);
+	}
+
+	ExecClearTuple(slot);
+	BufFileClose(batch->input_file);
+	pfree(batch);
+
+	hashagg_spill_finish(aggstate);
+
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
+						   &aggstate->perhash[0].hashiter);
+}
+
+/*
+ * Close and forget all spill files, both partially written and pending.
+ */
+static void
+hashagg_reset_spill_state(AggState *aggstate)
+{
+	HashAggSpill *spill = aggstate->hash_spill;
+	ListCell   *lc;
+
+	if (spill != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < spill->npartitions; i++)
+		{
+			if (spill->partitions[i] != NULL)
+				BufFileClose(spill->partitions[i]);
+		}
+		pfree(spill->partitions);
+		pfree(spill->ntuples);
+		pfree(spill);
+		aggstate->hash_spill = NULL;
+	}
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+
+		BufFileClose(batch->input_file);
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_ngroups_estimate = ((Agg *) aggstate->ss.ps.plan)->numGroups;
+	aggstate->hash_used_bits = 0;
 }
 
 /*
@@ -1933,11 +2369,14 @@ agg_fill_hash_table(AggState *aggstate)
 		/* set up for lookup_hash_entries and advance_aggregates */
 		tmpcontext->ecxt_outertuple = outerslot;
 
-		/* Find or build hashtable entries */
-		lookup_hash_entries(aggstate);
-
-		/* Advance the aggregates (or combine functions) */
-		advance_aggregates(aggstate);
+		/*
+		 * Find or build hashtable entries, and advance the aggregates (or
+		 * combine functions); if the group doesn't fit, spill the tuple.
+		 */
+		if (lookup_hash_entries(aggstate))
+			advance_aggregates(aggstate);
+		else
+			hashagg_spill_tuple(aggstate, outerslot);
 
 		/*
 		 * Reset per-input-tuple context after each tuple, but note that the
@@ -1946,6 +2385,9 @@ agg_fill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
+	/* queue up whatever was spilled, to be processed after this table */
+	hashagg_spill_finish(aggstate);
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the first hash table */
 	select_current_set(aggstate, 0, true);
@@ -2015,6 +2457,15 @@ agg_retrieve_hash_table(AggState *aggstate)
 
 				continue;
 			}
+			else if (aggstate->hash_batches != NIL)
+			{
+				/* Rebuild the table from the next spilled batch */
+				hashagg_refill_hash_table(aggstate);
+
+				perhash = &aggstate->perhash[aggstate->current_set];
+
+				continue;
+			}
 			else
 			{
 				/* No more hashtables, so done */
@@ -2184,7 +2635,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	 * memory context of the per-grouping-set ExprContexts (aggcontexts)
 	 * replaces the standalone memory context formerly used to hold transition
 	 * values.  We cheat a little by using ExecAssignExprContext() to build
-	 * all of them.
+	 * the per-tuple ones.  aggcontexts and hashcontext live across many
+	 * input tuples, and transition functions pfree superseded values in
+	 * them, so those use CreateExprContext(), whose memory is an AllocSet.
 	 *
 	 * NOTE: the details of what is stored in aggcontexts and what is stored
 	 * in the regular per-query memory context are driven by a simple
@@ -2196,14 +2649,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 	for (i = 0; i < numGroupingSets; ++i)
 	{
-		ExecAssignExprContext(estate, &aggstate->ss.ps);
-		aggstate->aggcontexts[i] = aggstate->ss.ps.ps_ExprContext;
+		aggstate->aggcontexts[i] = CreateExprContext(estate);
 	}
 
 	if (use_hashing)
 	{
-		ExecAssignExprContext(estate, &aggstate->ss.ps);
-		aggstate->hashcontext = aggstate->ss.ps.ps_ExprContext;
+		aggstate->hashcontext = CreateExprContext(estate);
 	}
 
 	ExecAssignExprContext(estate, &aggstate->ss.ps);
@@ -2219,6 +2670,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
 
+	/*
+	 * If the outer plan can hand us its tuples a batch at a time, ask it to.
+	 */
+	aggstate->input_batched =
+		(outerPlanState(aggstate)->ExecProcNodeBatch != NULL);
+
 	/*
 	 * initialize source tuple type.
 	 */
@@ -2259,6 +2716,24 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 			aggstate->ss.ps.outeropsfixed = false;
 	}
 
+	/*
+	 * Plain hashed aggregation can spill input tuples to disk, and later
+	 * aggregate them from a slot of its own.  As above, the expressions then
+	 * can't rely on the slot type of the outer plan.
+	 */
+	if (node->aggstrategy == AGG_HASHED && numHashes == 1)
+	{
+		aggstate->hash_can_spill = true;
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		aggstate->hash_ngroups_estimate = node->numGroups;
+		aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate, scanDesc,
+														   &TTSOpsMinimalTuple);
+
+		if (aggstate->ss.ps.outeropsfixed &&
+			aggstate->ss.ps.outerops != &TTSOpsMinimalTuple)
+			aggstate->ss.ps.outeropsfixed = false;
+	}
+
 	/*
 	 * Initialize result type, slot and projection.
 	 */
@@ -3406,6 +3881,9 @@ ExecEndAgg(AggState *node)
 	if (node->hashcontext)
 		ReScanExprContext(node->hashcontext);
 
+	/* Close any spill files */
+	hashagg_reset_spill_state(node);
+
 	/*
 	 * We don't actually free any ExprContexts here (see comment in
 	 * ExecFreeExprContext), just unlinking the output one from the plan node
@@ -3432,6 +3910,10 @@ ExecReScanAgg(AggState *node)
 
 	node->agg_done = false;
 
+	/* forget any remaining batched input */
+	node->input_batch_ntuples = 0;
+	node->input_batch_next = 0;
+
 	if (node->aggstrategy == AGG_HASHED)
 	{
 		/*
@@ -3447,9 +3929,11 @@ ExecReScanAgg(AggState *node)
 		 * If we do have the hash table, and the subplan does not have any
 		 * parameter changes, and none of our own parameter changes affect
 		 * input expressions of the aggregated functions, then we can just
-		 * rescan the existing hash table; no need to build it again.
+		 * rescan the existing hash table; no need to build it again.  That
+		 * doesn't work if any groups were spilled, since the table then only
+		 * holds the last batch.
 		 */
-		if (outerPlan->chgParam == NULL &&
+		if (outerPlan->chgParam == NULL && node->hash_batches_used == 0 &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -3507,6 +3991,8 @@ ExecReScanAgg(AggState *node)
 	if (node->aggstrategy == AGG_HASHED || node->aggstrategy == AGG_MIXED)
 	{
 		ReScanExprContext(node->hashcontext);
+		/* Discard any spilled tuples */
+		hashagg_reset_spill_state(node);
 		/* Rebuild an empty hash table */
 		build_hash_table(node);
 		node->table_filled = false;
@@ -36,6 +36,12 @@
  *			  nil	nil		 ...    ...    ...
  *								 subplans
  *
+ *		Subplans that are async-capable foreign scans are not run in
+ *		that sequence.  Instead, all of them are asked to start fetching
+ *		up front, and once the synchronous subplans are done, tuples are
+ *		returned from whichever async subplan has some ready, waiting on
+ *		their sockets when none has.
+ *
  *		Append nodes are currently used for unions, and to support
  *		inheritance queries, where several relations need to be scanned.
  *		For example, in our standard person/student/employee/student-emp
@@ -60,7 +66,11 @@
 #include "executor/execdebug.h"
 #include "executor/execPartition.h"
 #include "executor/nodeAppend.h"
+#include "executor/nodeForeignscan.h"
+#include "foreign/fdwapi.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/latch.h"
 
 /* Shared state for parallel-aware Append. */
 struct ParallelAppendState
@@ -85,6 +95,9 @@ static bool choose_next_subplan_locally(AppendState *node);
 static bool choose_next_subplan_for_leader(AppendState *node);
 static bool choose_next_subplan_for_worker(AppendState *node);
 static void mark_invalid_subplans_as_finished(AppendState *node);
+static void ExecAppendAsyncBegin(AppendState *node);
+static TupleTableSlot *ExecAppendAsyncNext(AppendState *node);
+static void ExecAppendAsyncWait(AppendState *node);
 
 /* ----------------------------------------------------------------
  *		ExecInitAppend
@@ -235,6 +248,40 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	appendstate->appendplans = appendplanstates;
 	appendstate->as_nplans = nplans;
 
+	/*
+	 * Find the subplans that can be run asynchronously.  We don't bother
+	 * during EvalPlanQual rechecks, nor when there's nothing to scan.
+	 */
+	appendstate->as_asyncplans = NULL;
+	appendstate->as_nasyncplans = 0;
+	if (estate->es_epq_active == NULL &&
+		appendstate->as_whichplan != NO_MATCHING_SUBPLANS)
+	{
+		for (i = 0; i < nplans; i++)
+		{
+			PlanState  *subnode = appendplanstates[i];
+			FdwRoutine *fdwroutine;
+
+			if (!subnode->plan->async_capable ||
+				!IsA(subnode, ForeignScanState))
+				continue;
+
+			fdwroutine = ((ForeignScanState *) subnode)->fdwroutine;
+			if (fdwroutine->ForeignAsyncRequest == NULL ||
+				fdwroutine->ForeignAsyncReady == NULL ||
+				fdwroutine->ForeignAsyncConfigureWait == NULL)
+				continue;
+
+			appendstate->as_asyncplans =
+				bms_add_member(appendstate->as_asyncplans, i);
+			appendstate->as_nasyncplans++;
+		}
+	}
+	appendstate->as_asyncremain = NULL;
+	appendstate->as_lastasync = -1;
+	appendstate->as_begun = false;
+	appendstate->as_syncdone = false;
+
 	/*
 	 * Miscellaneous initialization
 	 */
@@ -258,7 +305,11 @@ ExecAppend(PlanState *pstate)
 {
 	AppendState *node = castNode(AppendState, pstate);
 
-	if (node->as_whichplan < 0)
+	/* Get the async subplans going before doing anything else */
+	if (node->as_nasyncplans > 0 && !node->as_begun)
+		ExecAppendAsyncBegin(node);
+
+	if (node->as_whichplan < 0 && !node->as_syncdone)
 	{
 		/*
 		 * If no subplan has been chosen, we must choose one before
@@ -266,7 +317,7 @@ ExecAppend(PlanState *pstate)
 		 */
 		if (node->as_whichplan == INVALID_SUBPLAN_INDEX &&
 			!node->choose_next_subplan(node))
-			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+			node->as_syncdone = true;
 
 		/* Nothing to do if there are no matching subplans */
 		else if (node->as_whichplan == NO_MATCHING_SUBPLANS)
@@ -280,6 +331,21 @@ ExecAppend(PlanState *pstate)
 
 		CHECK_FOR_INTERRUPTS();
 
+		/*
+		 * Once the synchronous subplans are exhausted, hand out tuples from
+		 * the async ones as they become ready.
+		 */
+		if (node->as_syncdone)
+		{
+			if (bms_is_empty(node->as_asyncremain))
+				return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+			result = ExecAppendAsyncNext(node);
+			if (!TupIsNull(result))
+				return result;
+			continue;
+		}
+
 		/*
 		 * figure out which subplan we are currently processing
 		 */
@@ -301,9 +367,9 @@ ExecAppend(PlanState *pstate)
 			return result;
 		}
 
-		/* choose new subplan; if none, we're done */
+		/* choose new subplan; if none, move on to the async ones */
 		if (!node->choose_next_subplan(node))
-			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+			node->as_syncdone = true;
 	}
 }
 
@@ -374,6 +440,13 @@ ExecReScanAppend(AppendState *node)
 
 	/* Let choose_next_subplan_* function handle setting the first subplan */
 	node->as_whichplan = INVALID_SUBPLAN_INDEX;
+
+	/* Async subplans will be restarted by the next ExecAppend call */
+	bms_free(node->as_asyncremain);
+	node->as_asyncremain = NULL;
+	node->as_lastasync = -1;
+	node->as_begun = false;
+	node->as_syncdone = false;
 }
 
 /* ----------------------------------------------------------------
@@ -486,10 +559,15 @@ choose_next_subplan_locally(AppendState *node)
 	/* Ensure whichplan is within the expected range */
 	Assert(whichplan >= -1 && whichplan <= node->as_nplans);
 
-	if (ScanDirectionIsForward(node->ps.state->es_direction))
-		nextplan = bms_next_member(node->as_valid_subplans, whichplan);
-	else
-		nextplan = bms_prev_member(node->as_valid_subplans, whichplan);
+	/* Skip over async subplans; ExecAppendAsyncNext deals with those */
+	nextplan = whichplan;
+	do
+	{
+		if (ScanDirectionIsForward(node->ps.state->es_direction))
+			nextplan = bms_next_member(node->as_valid_subplans, nextplan);
+		else
+			nextplan = bms_prev_member(node->as_valid_subplans, nextplan);
+	} while (nextplan >= 0 && bms_is_member(nextplan, node->as_asyncplans));
 
 	if (nextplan < 0)
 		return false;
@@ -734,3 +812,156 @@ mark_invalid_subplans_as_finished(AppendState *node)
 			node->as_pstate->pa_finished[i] = true;
 	}
 }
+
+/* ----------------------------------------------------------------
+ *		ExecAppendAsyncBegin
+ *
+ *		Asks each valid async subplan to start fetching, so that
+ *		the remote work overlaps with the synchronous subplans and
+ *		with each other.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecAppendAsyncBegin(AppendState *node)
+{
+	int			i;
+
+	node->as_begun = true;
+
+	/*
+	 * Parallel-aware Appends hand out subplans through shared state, which
+	 * knows nothing about async subplans; just run everything synchronously.
+	 * The planner doesn't generate this combination anyway.
+	 */
+	if (node->as_pstate != NULL)
+	{
+		bms_free(node->as_asyncplans);
+		node->as_asyncplans = NULL;
+		node->as_nasyncplans = 0;
+		return;
+	}
+
+	/* If we've yet to determine the valid subplans then do so now. */
+	if (node->as_valid_subplans == NULL)
+		node->as_valid_subplans =
+			ExecFindMatchingSubPlans(node->as_prune_state);
+
+	node->as_asyncremain = bms_intersect(node->as_asyncplans,
+										 node->as_valid_subplans);
+	node->as_lastasync = -1;
+
+	i = -1;
+	while ((i = bms_next_member(node->as_asyncremain, i)) >= 0)
+		ExecAsyncForeignScanRequest((ForeignScanState *) node->appendplans[i]);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAppendAsyncNext
+ *
+ *		Returns the next tuple from an async subplan, waiting if none
+ *		of them has one ready.  Returns NULL once an async subplan has
+ *		been exhausted, so the caller can recheck what's left.
+ *
+ *		We keep draining the subplan we last returned from while it
+ *		stays ready, and otherwise poll the others round-robin.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecAppendAsyncNext(AppendState *node)
+{
+	for (;;)
+	{
+		int			start = node->as_lastasync;
+		int			i;
+		bool		wrapped = false;
+
+		if (start < 0 || !bms_is_member(start, node->as_asyncremain))
+			start = bms_next_member(node->as_asyncremain, -1);
+
+		i = start;
+		while (i >= 0)
+		{
+			ForeignScanState *subnode = (ForeignScanState *) node->appendplans[i];
+
+			if (ExecAsyncForeignScanReady(subnode))
+			{
+				TupleTableSlot *result = ExecProcNode((PlanState *) subnode);
+
+				if (!TupIsNull(result))
+				{
+					node->as_lastasync = i;
+					return result;
+				}
+
+				/* This one's done */
+				node->as_asyncremain = bms_del_member(node->as_asyncremain, i);
+				return NULL;
+			}
+
+			i = bms_next_member(node->as_asyncremain, i);
+			if (i < 0 && !wrapped)
+			{
+				i = bms_next_member(node->as_asyncremain, -1);
+				wrapped = true;
+			}
+			if (wrapped && i >= start)
+				break;
+		}
+
+		ExecAppendAsyncWait(node);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAppendAsyncWait
+ *
+ *		Sleeps until one of the remaining async subplans may have
+ *		become ready, or our latch is set.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecAppendAsyncWait(AppendState *node)
+{
+	int			nevents = bms_num_members(node->as_asyncremain) + 2;
+	WaitEventSet *set;
+	WaitEvent  *occurred;
+	bool		any = false;
+	int			noccurred;
+	int			i;
+
+	set = CreateWaitEventSet(CurrentMemoryContext, nevents);
+	if (IsUnderPostmaster)
+		AddWaitEventToSet(set, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+						  NULL, NULL);
+	AddWaitEventToSet(set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+
+	i = -1;
+	while ((i = bms_next_member(node->as_asyncremain, i)) >= 0)
+	{
+		if (ExecAsyncForeignScanConfigureWait((ForeignScanState *) node->appendplans[i],
+											  set))
+			any = true;
+	}
+
+	/* Nobody is waiting on anything; just poll the subplans again */
+	if (!any)
+	{
+		FreeWaitEventSet(set);
+		return;
+	}
+
+	occurred = (WaitEvent *) palloc(nevents * sizeof(WaitEvent));
+	noccurred = WaitEventSetWait(set, -1, occurred, nevents,
+								 WAIT_EVENT_APPEND_READY);
+	FreeWaitEventSet(set);
+
+	for (i = 0; i < noccurred; i++)
+	{
+		if (occurred[i].events & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+		}
+	}
+	pfree(occurred);
+}
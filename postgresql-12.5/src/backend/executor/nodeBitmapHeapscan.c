@@ -37,6 +37,7 @@
 
 #include <math.h>
 
+#include "access/htup_details.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
 #include "access/transam.h"
@@ -61,6 +62,14 @@ static inline void BitmapAdjustPrefetchTarget(BitmapHeapScanState *node);
 static inline void BitmapPrefetch(BitmapHeapScanState *node,
 								  TableScanDesc scan);
 static bool BitmapShouldInitializeSharedState(ParallelBitmapHeapState *pstate);
+static PlanState **BitmapGetParallelChildren(BitmapHeapScanState *node,
+											 int *nchildren);
+static void BitmapBuildChildren(BitmapHeapScanState *node,
+								ParallelBitmapHeapState *pstate);
+static TIDBitmap *BitmapMergeChildren(BitmapHeapScanState *node,
+									  ParallelBitmapHeapState *pstate);
+static void BitmapAddSharedBitmap(TIDBitmap *tbm, dsa_area *dsa,
+								  dsa_pointer dp);
 
 
 /* ----------------------------------------------------------------
@@ -131,6 +140,13 @@ BitmapHeapNext(BitmapHeapScanState *node)
 		}
 		else
 		{
+			/*
+			 * If the bitmap comes from a BitmapAnd or BitmapOr, every
+			 * participant first helps to build its inputs.
+			 */
+			if (pstate->nchildren > 0)
+				BitmapBuildChildren(node, pstate);
+
 			/*
 			 * The leader will immediately come out of the function, but
 			 * others will be blocked until leader populates the TBM and wakes
@@ -138,9 +154,14 @@ BitmapHeapNext(BitmapHeapScanState *node)
 			 */
 			if (BitmapShouldInitializeSharedState(pstate))
 			{
-				tbm = (TIDBitmap *) MultiExecProcNode(outerPlanState(node));
-				if (!tbm || !IsA(tbm, TIDBitmap))
-					elog(ERROR, "unrecognized result from subplan");
+				if (pstate->nchildren > 0)
+					tbm = BitmapMergeChildren(node, pstate);
+				else
+				{
+					tbm = (TIDBitmap *) MultiExecProcNode(outerPlanState(node));
+					if (!tbm || !IsA(tbm, TIDBitmap))
+						elog(ERROR, "unrecognized result from subplan");
+				}
 
 				node->tbm = tbm;
 
@@ -858,6 +879,184 @@ BitmapShouldInitializeSharedState(ParallelBitmapHeapState *pstate)
 	return (state == BM_INITIAL);
 }
 
+/*----------------
+ *		BitmapGetParallelChildren
+ *
+ *		If the bitmap is produced by a BitmapAnd or BitmapOr, return its
+ *		inputs, which a parallel scan builds in all participants at once.
+ *		Otherwise return NULL.
+ * ---------------
+ */
+static PlanState **
+BitmapGetParallelChildren(BitmapHeapScanState *node, int *nchildren)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	if (IsA(outerPlan, BitmapAndState))
+	{
+		*nchildren = ((BitmapAndState *) outerPlan)->nplans;
+		return ((BitmapAndState *) outerPlan)->bitmapplans;
+	}
+	if (IsA(outerPlan, BitmapOrState))
+	{
+		*nchildren = ((BitmapOrState *) outerPlan)->nplans;
+		return ((BitmapOrState *) outerPlan)->bitmapplans;
+	}
+
+	*nchildren = 0;
+	return NULL;
+}
+
+/*----------------
+ *		BitmapBuildChildren
+ *
+ *		Claim inputs of the BitmapAnd or BitmapOr one at a time, and build
+ *		them into shared bitmaps, until there are none left.  The planner has
+ *		marked each of the inputs as shared.
+ * ---------------
+ */
+static void
+BitmapBuildChildren(BitmapHeapScanState *node,
+					ParallelBitmapHeapState *pstate)
+{
+	dsa_area   *dsa = node->ss.ps.state->es_query_dsa;
+	dsa_pointer *child_bitmaps = dsa_get_address(dsa, pstate->child_bitmaps);
+	PlanState **children;
+	int			nchildren;
+
+	children = BitmapGetParallelChildren(node, &nchildren);
+	Assert(nchildren == pstate->nchildren);
+
+	for (;;)
+	{
+		TIDBitmap  *tbm;
+		int			child;
+
+		SpinLockAcquire(&pstate->mutex);
+		child = pstate->next_child;
+		if (child < pstate->nchildren)
+			pstate->next_child++;
+		SpinLockRelease(&pstate->mutex);
+
+		if (child >= nchildren)
+			break;
+
+		tbm = (TIDBitmap *) MultiExecProcNode(children[child]);
+		if (!tbm || !IsA(tbm, TIDBitmap))
+			elog(ERROR, "unrecognized result from subplan");
+
+		/*
+		 * Publish the bitmap as shared iteration state.  That keeps its page
+		 * table in the DSA after we free our local descriptor.
+		 */
+		child_bitmaps[child] = tbm_prepare_shared_iterate(tbm);
+		tbm_free(tbm);
+
+		SpinLockAcquire(&pstate->mutex);
+		pstate->nchildren_done++;
+		SpinLockRelease(&pstate->mutex);
+		ConditionVariableBroadcast(&pstate->cv);
+	}
+}
+
+/*----------------
+ *		BitmapMergeChildren
+ *
+ *		Wait until all inputs of the BitmapAnd or BitmapOr have been built,
+ *		then combine them into the bitmap for the scan, as ExecBitmapAnd or
+ *		ExecBitmapOr would have.  The inputs' shared state is released.
+ * ---------------
+ */
+static TIDBitmap *
+BitmapMergeChildren(BitmapHeapScanState *node,
+					ParallelBitmapHeapState *pstate)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+	dsa_area   *dsa = node->ss.ps.state->es_query_dsa;
+	dsa_pointer *child_bitmaps = dsa_get_address(dsa, pstate->child_bitmaps);
+	bool		isand = IsA(outerPlan, BitmapAndState);
+	TIDBitmap  *result;
+	int			i;
+
+	for (;;)
+	{
+		bool		done;
+
+		SpinLockAcquire(&pstate->mutex);
+		done = (pstate->nchildren_done == pstate->nchildren);
+		SpinLockRelease(&pstate->mutex);
+
+		if (done)
+			break;
+
+		ConditionVariableSleep(&pstate->cv, WAIT_EVENT_PARALLEL_BITMAP_SCAN);
+	}
+	ConditionVariableCancelSleep();
+
+	/* must provide our own instrumentation support */
+	if (outerPlan->instrument)
+		InstrStartNode(outerPlan->instrument);
+
+	result = tbm_create(work_mem * 1024L, dsa);
+
+	for (i = 0; i < pstate->nchildren; i++)
+	{
+		if (!isand || i == 0)
+			BitmapAddSharedBitmap(result, dsa, child_bitmaps[i]);
+		else if (!tbm_is_empty(result))
+		{
+			TIDBitmap  *subresult = tbm_create(work_mem * 1024L, NULL);
+
+			BitmapAddSharedBitmap(subresult, dsa, child_bitmaps[i]);
+			tbm_intersect(result, subresult);
+			tbm_free(subresult);
+		}
+
+		tbm_free_shared_area(dsa, child_bitmaps[i]);
+		child_bitmaps[i] = InvalidDsaPointer;
+	}
+
+	/* must provide our own instrumentation support */
+	if (outerPlan->instrument)
+		InstrStopNode(outerPlan->instrument, 0 /* XXX */ );
+
+	return result;
+}
+
+/*----------------
+ *		BitmapAddSharedBitmap
+ *
+ *		Add all the pages of a shared bitmap to tbm, keeping lossy pages
+ *		lossy and recheck flags as they are.
+ * ---------------
+ */
+static void
+BitmapAddSharedBitmap(TIDBitmap *tbm, dsa_area *dsa, dsa_pointer dp)
+{
+	TBMSharedIterator *iterator;
+	TBMIterateResult *tbmres;
+	ItemPointerData tids[MaxHeapTuplesPerPage];
+
+	iterator = tbm_attach_shared_iterate(dsa, dp);
+	while ((tbmres = tbm_shared_iterate(iterator)) != NULL)
+	{
+		int			i;
+
+		if (tbmres->ntuples < 0)
+		{
+			tbm_add_page(tbm, tbmres->blockno);
+			continue;
+		}
+
+		for (i = 0; i < tbmres->ntuples; i++)
+			ItemPointerSet(&tids[i], tbmres->blockno, tbmres->offsets[i]);
+		tbm_add_tuples(tbm, tids, tbmres->ntuples, tbmres->recheck);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+	tbm_end_shared_iterate(iterator);
+}
+
 /* ----------------------------------------------------------------
  *		ExecBitmapHeapEstimate
  *
@@ -909,6 +1108,24 @@ ExecBitmapHeapInitializeDSM(BitmapHeapScanState *node,
 	pstate->state = BM_INITIAL;
 
 	ConditionVariableInit(&pstate->cv);
+
+	/* Set up slots for the inputs of a BitmapAnd or BitmapOr, if any */
+	(void) BitmapGetParallelChildren(node, &pstate->nchildren);
+	pstate->next_child = 0;
+	pstate->nchildren_done = 0;
+	pstate->child_bitmaps = InvalidDsaPointer;
+	if (pstate->nchildren > 0)
+	{
+		dsa_pointer *child_bitmaps;
+		int			i;
+
+		pstate->child_bitmaps =
+			dsa_allocate(dsa, pstate->nchildren * sizeof(dsa_pointer));
+		child_bitmaps = dsa_get_address(dsa, pstate->child_bitmaps);
+		for (i = 0; i < pstate->nchildren; i++)
+			child_bitmaps[i] = InvalidDsaPointer;
+	}
+
 	SerializeSnapshot(estate->es_snapshot, pstate->phs_snapshot_data);
 
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
@@ -942,6 +1159,22 @@ ExecBitmapHeapReInitializeDSM(BitmapHeapScanState *node,
 
 	pstate->tbmiterator = InvalidDsaPointer;
 	pstate->prefetch_iterator = InvalidDsaPointer;
+
+	if (pstate->nchildren > 0)
+	{
+		dsa_pointer *child_bitmaps = dsa_get_address(dsa,
+													 pstate->child_bitmaps);
+		int			i;
+
+		for (i = 0; i < pstate->nchildren; i++)
+		{
+			if (DsaPointerIsValid(child_bitmaps[i]))
+				tbm_free_shared_area(dsa, child_bitmaps[i]);
+			child_bitmaps[i] = InvalidDsaPointer;
+		}
+		pstate->next_child = 0;
+		pstate->nchildren_done = 0;
+	}
 }
 
 /* ----------------------------------------------------------------
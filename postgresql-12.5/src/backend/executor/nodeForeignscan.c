@@ -141,6 +141,7 @@ ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
 	scanstate->ss.ps.ExecProcNode = ExecForeignScan;
+	scanstate->tuples_needed = -1;
 
 	/*
 	 * Miscellaneous initialization
@@ -384,3 +385,59 @@ ExecShutdownForeignScan(ForeignScanState *node)
 	if (fdwroutine->ShutdownForeignScan)
 		fdwroutine->ShutdownForeignScan(node);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncForeignScanRequest
+ *
+ *		Asks the FDW to start fetching tuples without waiting for
+ *		them, for an async-capable scan under an Append.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAsyncForeignScanRequest(ForeignScanState *node)
+{
+	FdwRoutine *fdwroutine = node->fdwroutine;
+
+	/* Apply any pending rescan first, as ExecProcNode would */
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	Assert(fdwroutine->ForeignAsyncRequest != NULL);
+	fdwroutine->ForeignAsyncRequest(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncForeignScanReady
+ *
+ *		Returns true if fetching the next tuple from the scan will
+ *		not block.  The FDW may start another fetch here.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecAsyncForeignScanReady(ForeignScanState *node)
+{
+	FdwRoutine *fdwroutine = node->fdwroutine;
+
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	Assert(fdwroutine->ForeignAsyncReady != NULL);
+	return fdwroutine->ForeignAsyncReady(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncForeignScanConfigureWait
+ *
+ *		Adds the events the scan is waiting for to the set.  Returns
+ *		false if it did not add any.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecAsyncForeignScanConfigureWait(ForeignScanState *node,
+								  struct WaitEventSet *set)
+{
+	FdwRoutine *fdwroutine = node->fdwroutine;
+
+	Assert(fdwroutine->ForeignAsyncConfigureWait != NULL);
+	return fdwroutine->ForeignAsyncConfigureWait(node, set);
+}
@@ -41,15 +41,46 @@ typedef struct FunctionScanPerFuncState
 	Tuplestorestate *tstore;	/* holds the function result set */
 	int64		rowcount;		/* # of rows in result set, -1 if not known */
 	TupleTableSlot *func_slot;	/* function result slot (or NULL) */
+	bool		streaming;		/* fetch rows from the function directly? */
+	bool		done;			/* streaming function returned its last row */
+	MemoryContext argcontext;	/* streaming function's arguments live here */
 } FunctionScanPerFuncState;
 
 static TupleTableSlot *FunctionNext(FunctionScanState *node);
+static void FunctionStreamNext(FunctionScanState *node,
+							   FunctionScanPerFuncState *fs,
+							   TupleTableSlot *slot);
 
 
 /* ----------------------------------------------------------------
  *						Scan Support
  * ----------------------------------------------------------------
  */
+/*
+ * Fetch the next row of a streaming function into slot, or clear the slot if
+ * the function's result is exhausted.
+ */
+static void
+FunctionStreamNext(FunctionScanState *node, FunctionScanPerFuncState *fs,
+				   TupleTableSlot *slot)
+{
+	ExprDoneCond isDone;
+
+	if (fs->done)
+	{
+		ExecClearTuple(slot);
+		return;
+	}
+
+	isDone = ExecStreamTableFunctionResult(fs->setexpr,
+										   node->ss.ps.ps_ExprContext,
+										   fs->argcontext,
+										   fs->tupdesc,
+										   slot);
+	if (isDone != ExprMultipleResult)
+		fs->done = true;
+}
+
 /* ----------------------------------------------------------------
  *		FunctionNext
  *
@@ -84,6 +115,13 @@ FunctionNext(FunctionScanState *node)
 		 */
 		Tuplestorestate *tstore = node->funcstates[0].tstore;
 
+		if (node->funcstates[0].streaming)
+		{
+			Assert(ScanDirectionIsForward(direction));
+			FunctionStreamNext(node, &node->funcstates[0], scanslot);
+			return scanslot;
+		}
+
 		/*
 		 * If first time through, read all tuples from function and put them
 		 * in a tuplestore. Subsequent calls just fetch tuples from
@@ -144,11 +182,20 @@ FunctionNext(FunctionScanState *node)
 		int			i;
 
 		/*
-		 * If first time through, read all tuples from function and put them
-		 * in a tuplestore. Subsequent calls just fetch tuples from
-		 * tuplestore.
+		 * A streaming function is read directly, forwards only.
 		 */
-		if (fs->tstore == NULL)
+		if (fs->streaming)
+		{
+			Assert(ScanDirectionIsForward(direction));
+			FunctionStreamNext(node, fs, fs->func_slot);
+		}
+
+		/*
+		 * Otherwise, if first time through, read all tuples from function
+		 * and put them in a tuplestore. Subsequent calls just fetch tuples
+		 * from tuplestore.
+		 */
+		else if (fs->tstore == NULL)
 		{
 			fs->tstore =
 				ExecMakeTableFunctionResult(fs->setexpr,
@@ -172,13 +219,16 @@ FunctionNext(FunctionScanState *node)
 		 * read position was out of bounds, don't try the read. This allows
 		 * backward scan to work when there are mixed row counts present.
 		 */
-		if (fs->rowcount != -1 && fs->rowcount < oldpos)
-			ExecClearTuple(fs->func_slot);
-		else
-			(void) tuplestore_gettupleslot(fs->tstore,
-										   ScanDirectionIsForward(direction),
-										   false,
-										   fs->func_slot);
+		if (!fs->streaming)
+		{
+			if (fs->rowcount != -1 && fs->rowcount < oldpos)
+				ExecClearTuple(fs->func_slot);
+			else
+				(void) tuplestore_gettupleslot(fs->tstore,
+											   ScanDirectionIsForward(direction),
+											   false,
+											   fs->func_slot);
+		}
 
 		if (TupIsNull(fs->func_slot))
 		{
@@ -361,6 +411,25 @@ ExecInitFunctionScan(FunctionScan *node, EState *estate, int eflags)
 		fs->tstore = NULL;
 		fs->rowcount = -1;
 
+		/*
+		 * If the scan never has to be rewound or run backwards, a function
+		 * returning set can be read a row at a time instead, so that rows are
+		 * returned as soon as the function produces them and the function is
+		 * not run to completion if the caller stops early.  A rescan then
+		 * simply calls the function again.  Each streaming function needs
+		 * its own context for its arguments, since they must stay valid
+		 * while the other functions are called.
+		 */
+		fs->streaming = fs->setexpr->funcReturnsSet &&
+			(eflags & (EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD)) == 0;
+		fs->done = false;
+		if (fs->streaming)
+			fs->argcontext = AllocSetContextCreate(CurrentMemoryContext,
+												   "Table function arguments",
+												   ALLOCSET_DEFAULT_SIZES);
+		else
+			fs->argcontext = NULL;
+
 		/*
 		 * Now determine if the function returns a simple or composite type,
 		 * and build an appropriate tupdesc.  Note that in the composite case,
@@ -545,6 +614,9 @@ ExecEndFunctionScan(FunctionScanState *node)
 		if (fs->func_slot)
 			ExecClearTuple(fs->func_slot);
 
+		if (fs->argcontext)
+			MemoryContextDelete(fs->argcontext);
+
 		if (fs->tstore != NULL)
 		{
 			tuplestore_end(node->funcstates[i].tstore);
@@ -608,6 +680,13 @@ ExecReScanFunctionScan(FunctionScanState *node)
 		}
 	}
 
+	/*
+	 * Streaming functions are simply called again; any that were still in
+	 * progress were shut down by the rescan of the expression context.
+	 */
+	for (i = 0; i < node->nfuncs; i++)
+		node->funcstates[i].done = false;
+
 	/* Reset ordinality counter */
 	node->ordinal = 0;
 
@@ -168,11 +168,18 @@ ExecGather(PlanState *pstate)
 
 			/* Initialize, or re-initialize, shared state needed by workers. */
 			if (!node->pei)
+			{
 				node->pei = ExecInitParallelPlan(node->ps.lefttree,
 												 estate,
 												 gather->initParam,
 												 gather->num_workers,
 												 node->tuples_needed);
+				if (OidIsValid(node->into_relid))
+					ExecParallelSetInsertTarget(node->pei,
+												node->into_relid,
+												node->into_cid,
+												node->into_options);
+			}
 			else
 				ExecParallelReinitialize(node->ps.lefttree,
 										 node->pei,
@@ -186,6 +193,7 @@ ExecGather(PlanState *pstate)
 			LaunchParallelWorkers(pcxt);
 			/* We save # workers launched for the benefit of EXPLAIN */
 			node->nworkers_launched = pcxt->nworkers_launched;
+			ExecParallelWorkersLaunched(node->pei);
 
 			/* Set up tuple queue readers to read the results. */
 			if (pcxt->nworkers_launched > 0)
@@ -39,12 +39,14 @@
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
 #include "utils/dynahash.h"
+#include "utils/hashutils.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
+static void ExecHashCheckHeavyHitter(HashJoinTable hashtable, uint32 hashvalue);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable);
@@ -55,6 +57,7 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 									uint32 hashvalue,
 									int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
+static inline void ExecHashBloomAdd(HashJoinTable hashtable, uint32 hashvalue);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
@@ -174,6 +177,9 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloomFilter != NULL)
+				ExecHashBloomAdd(hashtable, hashvalue);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -189,6 +195,8 @@ MultiExecPrivateHash(HashState *node)
 			}
 			hashtable->totalTuples += 1;
 		}
+		else
+			hashtable->innerHasNull = true;
 	}
 
 	/* resize the hash table if needed (NTUP_PER_BUCKET exceeded) */
@@ -487,6 +495,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->log2_nbuckets_optimal = log2_nbuckets;
 	hashtable->buckets.unshared = NULL;
 	hashtable->keepNulls = keepNulls;
+	hashtable->innerHasNull = false;
 	hashtable->skewEnabled = false;
 	hashtable->skewBucket = NULL;
 	hashtable->skewBucketLen = 0;
@@ -497,12 +506,15 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->nbatch_original = nbatch;
 	hashtable->nbatch_outstart = nbatch;
 	hashtable->growEnabled = true;
+	hashtable->heavyValid = false;
+	hashtable->heavyHashValue = 0;
 	hashtable->totalTuples = 0;
 	hashtable->partialTuples = 0;
 	hashtable->skewTuples = 0;
 	hashtable->innerBatchFile = NULL;
 	hashtable->outerBatchFile = NULL;
 	hashtable->spaceUsed = 0;
+	hashtable->spaceUsedHeavy = 0;
 	hashtable->spacePeak = 0;
 	hashtable->spaceAllowed = space_allowed;
 	hashtable->spaceUsedSkew = 0;
@@ -510,6 +522,8 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
 	hashtable->current_chunk = NULL;
+	hashtable->bloomFilter = NULL;
+	hashtable->bloomMask = 0;
 	hashtable->parallel_state = state->parallel_state;
 	hashtable->area = state->ps.state->es_query_dsa;
 	hashtable->batches = NULL;
@@ -894,6 +908,9 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	long		ninmemory;
 	long		nfreed;
 	HashMemoryChunk oldchunks;
+	uint32		candidate = 0;
+	long		votes = 0;
+	bool		hadHeavy;
 
 	/* do nothing if we've decided to shut off growth */
 	if (!hashtable->growEnabled)
@@ -1002,6 +1019,17 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				/* and add it back to the appropriate bucket */
 				copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
 				hashtable->buckets.unshared[bucketno] = copyTuple;
+
+				/* track the majority hash value of the kept tuples, if any */
+				if (votes == 0)
+				{
+					candidate = hashTuple->hashvalue;
+					votes = 1;
+				}
+				else if (hashTuple->hashvalue == candidate)
+					votes++;
+				else
+					votes--;
 			}
 			else
 			{
@@ -1032,15 +1060,27 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 		   hashtable, nfreed, ninmemory, hashtable->spaceUsed);
 #endif
 
+	/*
+	 * If the split freed much less than the half we'd expect, or the current
+	 * batch already had a heavy hitter, check whether a single hash value
+	 * dominates what's left.
+	 */
+	hadHeavy = hashtable->heavyValid;
+	hashtable->heavyValid = false;
+	hashtable->spaceUsedHeavy = 0;
+	if (votes > 0 && (nfreed < ninmemory / 4 || hadHeavy))
+		ExecHashCheckHeavyHitter(hashtable, candidate);
+
 	/*
 	 * If we dumped out either all or none of the tuples in the table, disable
 	 * further expansion of nbatch.  This situation implies that we have
 	 * enough tuples of identical hashvalues to overflow spaceAllowed.
 	 * Increasing nbatch will not fix it since there's no way to subdivide the
 	 * group any more finely. We have to just gut it out and hope the server
-	 * has enough RAM.
+	 * has enough RAM.  If we did find a heavy hitter, though, it's no longer
+	 * counted against spaceAllowed, and the other tuples may still split.
 	 */
-	if (nfreed == 0 || nfreed == ninmemory)
+	if ((nfreed == 0 || nfreed == ninmemory) && !hashtable->heavyValid)
 	{
 		hashtable->growEnabled = false;
 #ifdef HJDEBUG
@@ -1050,6 +1090,53 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * ExecHashCheckHeavyHitter
+ *		see whether the given hash value dominates the in-memory tuples
+ *
+ * If the tuples with this hash value take up most of the space used, and
+ * more than half of spaceAllowed by themselves, further batch increases
+ * could never bring us under spaceAllowed: they would only keep doubling
+ * nbatch while shedding ever fewer other tuples.  Remember the value as the
+ * batch's heavy hitter instead, so that its tuples stay in memory and later
+ * increases are driven only by the remaining tuples.
+ */
+static void
+ExecHashCheckHeavyHitter(HashJoinTable hashtable, uint32 hashvalue)
+{
+	HashMemoryChunk chunk;
+	Size		heavySize = 0;
+
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
+	{
+		size_t		idx = 0;
+
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (HASH_CHUNK_DATA(chunk) + idx);
+			MinimalTuple tuple = HJTUPLE_MINTUPLE(hashTuple);
+			int			hashTupleSize = (HJTUPLE_OVERHEAD + tuple->t_len);
+
+			if (hashTuple->hashvalue == hashvalue)
+				heavySize += hashTupleSize;
+
+			idx += MAXALIGN(hashTupleSize);
+		}
+	}
+
+	if (heavySize > hashtable->spaceUsed / 2 &&
+		heavySize > hashtable->spaceAllowed / 2)
+	{
+		hashtable->heavyValid = true;
+		hashtable->heavyHashValue = hashvalue;
+		hashtable->spaceUsedHeavy = heavySize;
+#ifdef HJDEBUG
+		printf("Hashjoin %p: hash value %u is a heavy hitter using %zu bytes\n",
+			   hashtable, hashvalue, heavySize);
+#endif
+	}
+}
+
 /*
  * ExecParallelHashIncreaseNumBatches
  *		Every participant attached to grow_batches_barrier must run this
@@ -1652,11 +1739,17 @@ ExecHashTableInsert(HashJoinTable hashtable,
 			}
 		}
 
-		/* Account for space used, and back off if we've used too much */
+		/*
+		 * Account for space used, and back off if we've used too much.  The
+		 * tuples of a heavy hitter don't count toward the limit; see
+		 * ExecHashCheckHeavyHitter.
+		 */
 		hashtable->spaceUsed += hashTupleSize;
+		if (hashtable->heavyValid && hashvalue == hashtable->heavyHashValue)
+			hashtable->spaceUsedHeavy += hashTupleSize;
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
-		if (hashtable->spaceUsed +
+		if (hashtable->spaceUsed - hashtable->spaceUsedHeavy +
 			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
 			> hashtable->spaceAllowed)
 			ExecHashIncreaseNumBatches(hashtable);
@@ -1710,6 +1803,7 @@ retry:
 		/* Store the hash value in the HashJoinTuple header. */
 		hashTuple->hashvalue = hashvalue;
 		memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
 		ExecParallelHashPushTuple(&hashtable->buckets.shared[bucketno],
@@ -1857,7 +1951,10 @@ ExecHashGetHashValue(HashJoinTable hashtable,
 			/* Compute the hash function */
 			uint32		hkey;
 
-			hkey = DatumGetUInt32(FunctionCall1Coll(&hashfunctions[i], hashtable->collations[i], keyval));
+			if (!hash_builtin_datum(hashfunctions[i].fn_oid,
+									hashtable->collations[i],
+									keyval, &hkey))
+				hkey = DatumGetUInt32(FunctionCall1Coll(&hashfunctions[i], hashtable->collations[i], keyval));
 			hashkey ^= hkey;
 		}
 
@@ -1919,6 +2016,101 @@ ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 	}
 }
 
+/*
+ * ExecHashBloomCreate
+ *		set up a Bloom filter over the hash values of the inner tuples
+ *
+ * Must be called after ExecHashTableCreate and before the hash table is
+ * built.  ntuples is the expected number of inner tuples.  We aim for 8 bits
+ * per tuple and probe 2 bits per hash value, which gives a false positive
+ * rate of about 5%; the bitmap is capped at 1/16 of the hash table's memory
+ * budget.  Only private hash tables are supported, since each participant in
+ * a Parallel Hash sees only part of the inner relation.
+ */
+void
+ExecHashBloomCreate(HashJoinTable hashtable, double ntuples)
+{
+	Size		maxbytes;
+	double		nbits;
+	int			log2_nbits;
+
+	Assert(hashtable->parallel_state == NULL);
+	Assert(hashtable->bloomFilter == NULL);
+
+	maxbytes = Max(hashtable->spaceAllowed / 16, BLCKSZ);
+	nbits = Min(Max(ntuples, 1.0) * 8.0, (double) maxbytes * BITS_PER_BYTE);
+	nbits = Min(nbits, (double) PG_UINT32_MAX);
+
+	/* round down to a power of two, but use at least 1024 bits */
+	log2_nbits = my_log2((long) nbits);
+	if (((double) (1L << log2_nbits)) > nbits)
+		log2_nbits--;
+	log2_nbits = Max(log2_nbits, 10);
+
+	hashtable->bloomMask = (uint32) ((((uint64) 1) << log2_nbits) - 1);
+	hashtable->bloomFilter = (uint64 *)
+		MemoryContextAllocZero(hashtable->hashCxt,
+							   (((Size) hashtable->bloomMask) + 1) / BITS_PER_BYTE);
+}
+
+/*
+ * ExecHashBloomAdd
+ *		add an inner tuple's hash value to the Bloom filter
+ */
+static inline void
+ExecHashBloomAdd(HashJoinTable hashtable, uint32 hashvalue)
+{
+	uint32		bit1 = hashvalue & hashtable->bloomMask;
+	uint32		bit2 = murmurhash32(hashvalue) & hashtable->bloomMask;
+
+	hashtable->bloomFilter[bit1 / 64] |= UINT64CONST(1) << (bit1 % 64);
+	hashtable->bloomFilter[bit2 / 64] |= UINT64CONST(1) << (bit2 % 64);
+}
+
+/*
+ * ExecHashBloomFinish
+ *		decide whether the Bloom filter is worth using, once it's built
+ *
+ * If the inner relation turned out much larger than estimated, the filter
+ * may be so full that it rejects few tuples; in that case, get rid of it.
+ */
+void
+ExecHashBloomFinish(HashJoinTable hashtable)
+{
+	uint64		nset;
+
+	if (hashtable->bloomFilter == NULL)
+		return;
+
+	nset = pg_popcount((const char *) hashtable->bloomFilter,
+					   (((Size) hashtable->bloomMask) + 1) / BITS_PER_BYTE);
+
+	/* with half the bits set, about a quarter of all values pass anyway */
+	if (nset > (((uint64) hashtable->bloomMask) + 1) / 2)
+	{
+		pfree(hashtable->bloomFilter);
+		hashtable->bloomFilter = NULL;
+		hashtable->bloomMask = 0;
+	}
+}
+
+/*
+ * ExecHashBloomMayMatch
+ *		check an outer tuple's hash value against the Bloom filter
+ *
+ * Returns false if no inner tuple can have this hash value, true if one
+ * might.  There must be a filter.
+ */
+bool
+ExecHashBloomMayMatch(HashJoinTable hashtable, uint32 hashvalue)
+{
+	uint32		bit1 = hashvalue & hashtable->bloomMask;
+	uint32		bit2 = murmurhash32(hashvalue) & hashtable->bloomMask;
+
+	return (hashtable->bloomFilter[bit1 / 64] & (UINT64CONST(1) << (bit1 % 64))) != 0 &&
+		(hashtable->bloomFilter[bit2 / 64] & (UINT64CONST(1) << (bit2 % 64))) != 0;
+}
+
 /*
  * ExecScanHashBucket
  *		scan a hash bucket for matches to the current outer tuple
@@ -2057,6 +2249,69 @@ ExecPrepHashTableForUnmatched(HashJoinState *hjstate)
 	hjstate->hj_CurTuple = NULL;
 }
 
+/*
+ * Decide if this process is allowed to run the unmatched scan.  If so, the
+ * batch barrier is advanced to PHJ_BATCH_SCANNING and true is returned.
+ * Otherwise the batch is detached and false is returned.
+ */
+bool
+ExecParallelPrepHashTableForUnmatched(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	ParallelHashJoinBatch *batch = hashtable->batches[curbatch].shared;
+
+	Assert(BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_PROBING);
+
+	/*
+	 * It would not be deadlock-free to wait on the batch barrier, because it
+	 * is in PHJ_BATCH_PROBING phase, and thus processes attached to it have
+	 * already emitted tuples.  Therefore, we'll hold a wait-free election:
+	 * only one process can continue to the next phase, and all others detach
+	 * from this batch.  They can still do any work on other batches, if there
+	 * are any.
+	 */
+	if (!BarrierArriveAndDetachExceptLast(&batch->batch_barrier))
+	{
+		/* This process considers the batch to be done. */
+		hashtable->batches[curbatch].done = true;
+
+		/* Make sure any temporary files are closed. */
+		sts_end_parallel_scan(hashtable->batches[curbatch].inner_tuples);
+		sts_end_parallel_scan(hashtable->batches[curbatch].outer_tuples);
+
+		/*
+		 * Track largest batch we've seen, which would normally happen in
+		 * ExecHashTableDetachBatch().
+		 */
+		hashtable->spacePeak =
+			Max(hashtable->spacePeak,
+				batch->size + sizeof(dsa_pointer_atomic) * hashtable->nbuckets);
+		hashtable->curbatch = -1;
+		return false;
+	}
+
+	/* Now we are alone with this batch. */
+	Assert(BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_SCANNING);
+	Assert(BarrierParticipants(&batch->batch_barrier) == 1);
+
+	/*
+	 * Has another process decided to give up early and command all processes
+	 * to skip the unmatched scan?
+	 */
+	if (batch->skip_unmatched)
+	{
+		hashtable->batches[curbatch].done = true;
+		ExecHashTableDetachBatch(hashtable);
+		return false;
+	}
+
+	/* Now prepare the process local state, just as for non-parallel join. */
+	ExecPrepHashTableForUnmatched(hjstate);
+
+	return true;
+}
+
 /*
  * ExecScanHashTableForUnmatched
  *		scan the hash table for unmatched inner tuples
@@ -2131,6 +2386,74 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 	return false;
 }
 
+/*
+ * ExecParallelScanHashTableForUnmatched
+ *		scan the shared hash table for unmatched inner tuples, in a
+ *		parallel right/full join
+ *
+ * Only the participant elected by ExecParallelPrepHashTableForUnmatched()
+ * calls this, so it has the current batch's hash table to itself.  Same
+ * conventions as ExecScanHashTableForUnmatched(), except that there are no
+ * skew buckets.
+ */
+bool
+ExecParallelScanHashTableForUnmatched(HashJoinState *hjstate,
+									  ExprContext *econtext)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	HashJoinTuple hashTuple = hjstate->hj_CurTuple;
+
+	for (;;)
+	{
+		/*
+		 * hj_CurTuple is the address of the tuple last returned from the
+		 * current bucket, or NULL if it's time to start scanning a new
+		 * bucket.
+		 */
+		if (hashTuple != NULL)
+			hashTuple = ExecParallelHashNextTuple(hashtable, hashTuple);
+		else if (hjstate->hj_CurBucketNo < hashtable->nbuckets)
+			hashTuple = ExecParallelHashFirstTuple(hashtable,
+												   hjstate->hj_CurBucketNo++);
+		else
+			break;				/* finished all buckets */
+
+		while (hashTuple != NULL)
+		{
+			if (!HeapTupleHeaderHasMatch(HJTUPLE_MINTUPLE(hashTuple)))
+			{
+				TupleTableSlot *inntuple;
+
+				/* insert hashtable's tuple into exec slot */
+				inntuple = ExecStoreMinimalTuple(HJTUPLE_MINTUPLE(hashTuple),
+												 hjstate->hj_HashTupleSlot,
+												 false);	/* do not pfree */
+				econtext->ecxt_innertuple = inntuple;
+
+				/*
+				 * Reset temp memory each time; although this function doesn't
+				 * do any qual eval, the caller will, so let's keep it
+				 * parallel to ExecScanHashBucket.
+				 */
+				ResetExprContext(econtext);
+
+				hjstate->hj_CurTuple = hashTuple;
+				return true;
+			}
+
+			hashTuple = ExecParallelHashNextTuple(hashtable, hashTuple);
+		}
+
+		/* allow this loop to be cancellable */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/*
+	 * no more unmatched tuples
+	 */
+	return false;
+}
+
 /*
  * ExecHashTableReset
  *
@@ -2154,6 +2477,8 @@ ExecHashTableReset(HashJoinTable hashtable)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
 
 	hashtable->spaceUsed = 0;
+	hashtable->spaceUsedHeavy = 0;
+	hashtable->heavyValid = false;
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -2445,7 +2770,8 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 		ExecHashRemoveNextSkewBucket(hashtable);
 
 	/* Check we are not over the total spaceAllowed, either */
-	if (hashtable->spaceUsed > hashtable->spaceAllowed)
+	if (hashtable->spaceUsed - hashtable->spaceUsedHeavy >
+		hashtable->spaceAllowed)
 		ExecHashIncreaseNumBatches(hashtable);
 
 	if (shouldFree)
@@ -3094,13 +3420,42 @@ ExecHashTableDetachBatch(HashJoinTable hashtable)
 	{
 		int			curbatch = hashtable->curbatch;
 		ParallelHashJoinBatch *batch = hashtable->batches[curbatch].shared;
+		bool		attached = true;
 
 		/* Make sure any temporary files are closed. */
 		sts_end_parallel_scan(hashtable->batches[curbatch].inner_tuples);
 		sts_end_parallel_scan(hashtable->batches[curbatch].outer_tuples);
 
-		/* Detach from the batch we were last working on. */
-		if (BarrierArriveAndDetach(&batch->batch_barrier))
+		/*
+		 * If we're abandoning the PHJ_BATCH_PROBING phase early without
+		 * having reached the end of it, it means the plan doesn't want any
+		 * more tuples, and it is happy to abandon any tuples buffered in this
+		 * process's subplans.  For correctness, we can't allow any process to
+		 * execute the PHJ_BATCH_SCANNING phase, because we will never have
+		 * the complete set of match bits.  Therefore we skip emitting
+		 * unmatched tuples in all backends (if this is a full/right join), as
+		 * if those tuples were all due to be emitted by this process and it
+		 * has abandoned them too.
+		 */
+		if (BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_PROBING &&
+			!hashtable->batches[curbatch].outer_eof)
+		{
+			/*
+			 * This flag may be written to by multiple backends during
+			 * PHJ_BATCH_PROBING phase, but will only be read in
+			 * PHJ_BATCH_SCANNING phase so requires no extra locking.
+			 */
+			batch->skip_unmatched = true;
+		}
+
+		/*
+		 * Even if we aren't doing a full/right outer join, we'll step through
+		 * the PHJ_BATCH_SCANNING phase just to maintain the invariant that
+		 * freeing happens in PHJ_BATCH_DONE, but that'll be wait-free.
+		 */
+		if (BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_PROBING)
+			attached = BarrierArriveAndDetachExceptLast(&batch->batch_barrier);
+		if (attached && BarrierArriveAndDetach(&batch->batch_barrier))
 		{
 			/*
 			 * Technically we shouldn't access the barrier because we're no
@@ -82,6 +82,7 @@
  *  PHJ_BATCH_ALLOCATING     -- one allocates buckets
  *  PHJ_BATCH_LOADING        -- all load the hash table from disk
  *  PHJ_BATCH_PROBING        -- all probe
+ *  PHJ_BATCH_SCANNING       -- one scans for unmatched inner tuples
  *  PHJ_BATCH_DONE           -- end
  *
  * Batch 0 is a special case, because it starts out in phase
@@ -101,6 +102,17 @@
  * tuples while in PHJ_BATCH_PROBING phase, but that's OK because we use
  * BarrierArriveAndDetach() to advance it to PHJ_BATCH_DONE without waiting.
  *
+ * For right and full joins, the unmatched inner tuples of a batch can only
+ * be emitted once everyone has finished probing it, and waiting for that
+ * would break the rule above.  Instead, participants that finish probing
+ * hold a wait-free election with BarrierArriveAndDetachExceptLast(): all but
+ * the last detach, and the last one advances the barrier to
+ * PHJ_BATCH_SCANNING and scans the whole hash table for unmatched tuples on
+ * its own.  Participants that don't reach the end of the probe phase (for
+ * example because of a LIMIT) can't know that all match bits are set, so
+ * they cancel the scan for everyone by setting skip_unmatched; that's OK
+ * since the plan doesn't want any more tuples anyway.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -128,6 +140,12 @@
 #define HJ_FILL_INNER_TUPLES	5
 #define HJ_NEED_NEW_BATCH		6
 
+/*
+ * How many outer tuples to check against the Bloom filter before deciding
+ * whether it rejects enough of them to be worth its cost.
+ */
+#define HJ_BLOOM_CHECK_INTERVAL	4096
+
 /* Returns true if doing null-fill on outer relation */
 #define HJ_FILL_OUTER(hjstate)	((hjstate)->hj_NullInnerTupleSlot != NULL)
 /* Returns true if doing null-fill on inner relation */
@@ -282,6 +300,18 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+				/*
+				 * If our outer side is a scan that can apply a Bloom filter
+				 * for us, have one built along with the hash table.
+				 */
+				if (node->hj_UseBloomFilter)
+				{
+					ExecHashBloomCreate(hashtable,
+										outerPlan(hashNode->ps.plan)->plan_rows);
+					node->hj_BloomChecked = 0;
+					node->hj_BloomRemoved = 0;
+				}
+
 				/*
 				 * Execute the Hash node, to build the hash table.  If using
 				 * Parallel Hash, then we'll try to help hashing unless we
@@ -289,6 +319,7 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				 */
 				hashNode->hashtable = hashtable;
 				(void) MultiExecProcNode((PlanState *) hashNode);
+				ExecHashBloomFinish(hashtable);
 
 				/*
 				 * If the inner relation is completely empty, and we're not
@@ -344,6 +375,14 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 
 			case HJ_NEED_NEW_OUTER:
 
+				/*
+				 * In a NOT IN anti join, a NULL inner key means that no outer
+				 * row can qualify.  This is checked here rather than after
+				 * the build so that rescans reusing the table also honor it.
+				 */
+				if (node->hj_NullAware && hashtable->innerHasNull)
+					return NULL;
+
 				/*
 				 * We don't have an outer tuple, try to get the next one
 				 */
@@ -361,8 +400,22 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					if (HJ_FILL_INNER(node))
 					{
 						/* set up to scan for unmatched inner tuples */
-						ExecPrepHashTableForUnmatched(node);
-						node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+						if (parallel)
+						{
+							/*
+							 * Only one process is allowed to handle each
+							 * batch's unmatched tuples in a parallel join.
+							 */
+							if (ExecParallelPrepHashTableForUnmatched(node))
+								node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+							else
+								node->hj_JoinState = HJ_NEED_NEW_BATCH;
+						}
+						else
+						{
+							ExecPrepHashTableForUnmatched(node);
+							node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+						}
 					}
 					else
 						node->hj_JoinState = HJ_NEED_NEW_BATCH;
@@ -455,22 +508,14 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				{
 					node->hj_MatchedOuter = true;
 
-					if (parallel)
-					{
-						/*
-						 * Full/right outer joins are currently not supported
-						 * for parallel joins, so we don't need to set the
-						 * match bit.  Experiments show that it's worth
-						 * avoiding the shared memory traffic on large
-						 * systems.
-						 */
-						Assert(!HJ_FILL_INNER(node));
-					}
-					else
+					if (!parallel || HJ_FILL_INNER(node))
 					{
 						/*
 						 * This is really only needed if HJ_FILL_INNER(node),
-						 * but we'll avoid the branch and just set it always.
+						 * but we'll avoid the branch and just set it always
+						 * in the non-parallel case.  In a parallel join,
+						 * experiments show that it's worth avoiding the
+						 * shared memory traffic on large systems.
 						 */
 						HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
 					}
@@ -531,7 +576,8 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				 * so any unmatched inner tuples in the hashtable have to be
 				 * emitted before we continue to the next batch.
 				 */
-				if (!ExecScanHashTableForUnmatched(node, econtext))
+				if (!(parallel ? ExecParallelScanHashTableForUnmatched(node, econtext)
+					  : ExecScanHashTableForUnmatched(node, econtext)))
 				{
 					/* no more unmatched tuples */
 					node->hj_JoinState = HJ_NEED_NEW_BATCH;
@@ -751,10 +797,78 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_JoinState = HJ_BUILD_HASHTABLE;
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
+	hjstate->hj_NullAware = node->nullaware;
+
+	/*
+	 * If the outer side is a plain SeqScan, it can drop tuples which can't
+	 * have a join partner before returning them to us, using a Bloom filter
+	 * over the inner hash values.  That's only allowed when unmatched outer
+	 * tuples are not emitted, and not with Parallel Hash, where each
+	 * participant would see only part of the inner relation.
+	 */
+	hjstate->hj_UseBloomFilter = false;
+	hjstate->hj_BloomChecked = 0;
+	hjstate->hj_BloomRemoved = 0;
+	if (!HJ_FILL_OUTER(hjstate) &&
+		!node->join.plan.parallel_aware &&
+		IsA(outerPlanState(hjstate), SeqScanState))
+	{
+		SeqScanState *scanstate = (SeqScanState *) outerPlanState(hjstate);
+
+		scanstate->bloom_source = hjstate;
+		hjstate->hj_UseBloomFilter = true;
+	}
 
 	return hjstate;
 }
 
+/*
+ * ExecHashJoinBloomFilter
+ *		Check whether a tuple about to be returned by our outer SeqScan might
+ *		have a join partner, according to the hash table's Bloom filter.
+ *
+ * Returns false if the tuple certainly has no match and can be dropped.
+ * econtext is the scan's expression context, which we use to compute the
+ * tuple's hash value.  Until the hash table is built, and if the filter has
+ * turned out not to be selective, every tuple passes.
+ */
+bool
+ExecHashJoinBloomFilter(HashJoinState *hjstate, ExprContext *econtext,
+						TupleTableSlot *slot)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	uint32		hashvalue;
+	bool		maymatch;
+
+	if (hashtable == NULL || hashtable->bloomFilter == NULL ||
+		hashtable->curbatch != 0)
+		return true;
+
+	econtext->ecxt_outertuple = slot;
+	maymatch = ExecHashGetHashValue(hashtable, econtext,
+									hjstate->hj_OuterHashKeys,
+									true, false, &hashvalue) &&
+		ExecHashBloomMayMatch(hashtable, hashvalue);
+
+	hjstate->hj_BloomChecked++;
+	if (!maymatch)
+		hjstate->hj_BloomRemoved++;
+
+	/*
+	 * Computing the hash value twice for the tuples that pass isn't free, so
+	 * stop filtering if we're not rejecting at least 1 in 8 of them.
+	 */
+	if (hjstate->hj_BloomChecked == HJ_BLOOM_CHECK_INTERVAL &&
+		hjstate->hj_BloomRemoved < HJ_BLOOM_CHECK_INTERVAL / 8)
+	{
+		pfree(hashtable->bloomFilter);
+		hashtable->bloomFilter = NULL;
+		hashtable->bloomMask = 0;
+	}
+
+	return maymatch;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
@@ -836,7 +950,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			if (ExecHashGetHashValue(hashtable, econtext,
 									 hjstate->hj_OuterHashKeys,
 									 true,	/* outer tuple */
-									 HJ_FILL_OUTER(hjstate),
+									 HJ_FILL_OUTER(hjstate) &&
+									 !(hjstate->hj_NullAware &&
+									   hashtable->totalTuples > 0),
 									 hashvalue))
 			{
 				/* remember outer relation is not empty for possible rescan */
@@ -934,6 +1050,8 @@ ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 	}
 
 	/* End of this batch */
+	hashtable->batches[curbatch].outer_eof = true;
+
 	return NULL;
 }
 
@@ -1173,14 +1291,28 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 					 * hash table stays alive until everyone's finished
 					 * probing it, but no participant is allowed to wait at
 					 * this barrier again (or else a deadlock could occur).
-					 * All attached participants must eventually call
-					 * BarrierArriveAndDetach() so that the final phase
-					 * PHJ_BATCH_DONE can be reached.
+					 * All attached participants must eventually detach from
+					 * the barrier, and one of them must advance it, so that
+					 * the final phase PHJ_BATCH_DONE can be reached.
 					 */
 					ExecParallelHashTableSetCurrentBatch(hashtable, batchno);
 					sts_begin_parallel_scan(hashtable->batches[batchno].outer_tuples);
 					return true;
 
+				case PHJ_BATCH_SCANNING:
+
+					/*
+					 * Another participant is already scanning this batch for
+					 * unmatched inner tuples, and only one may do so.  Detach
+					 * and go around again; we use ExecHashTableDetachBatch()
+					 * because we might be the last to detach, and then we're
+					 * responsible for freeing memory.
+					 */
+					ExecParallelHashTableSetCurrentBatch(hashtable, batchno);
+					hashtable->batches[batchno].done = true;
+					ExecHashTableDetachBatch(hashtable);
+					break;
+
 				case PHJ_BATCH_DONE:
 
 					/*
@@ -1223,7 +1355,7 @@ ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 	if (file == NULL)
 	{
 		/* First write to this batch file, so open it. */
-		file = BufFileCreateTemp(false);
+		file = BufFileCreateCompressTemp(false);
 		*fileptr = file;
 	}
 
@@ -0,0 +1,427 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ * DESCRIPTION
+ *
+ *	Incremental sort is used when the input is already sorted by a prefix of
+ *	the requested sort keys.  Say the input is sorted by (a) and we need
+ *	(a, b): then only the runs of tuples with equal values of "a" need to be
+ *	sorted by "b", and each run can be returned as soon as it has been
+ *	sorted.  That saves memory and comparisons, and lets a LIMIT above us
+ *	stop reading the input early instead of waiting for all of it to be
+ *	sorted.
+ *
+ *	Sorting every run on its own would be expensive when runs are short, so
+ *	the input is read in batches of at least INCREMENTAL_SORT_MIN_BATCH_SIZE
+ *	tuples, each extended to the end of the run of its last tuple, and each
+ *	batch is sorted by all the sort keys.  Since a batch only ever contains complete
+ *	runs, concatenating the sorted batches gives correctly sorted output.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/tuplesort.h"
+
+/*
+ * Look up the equality functions of the presorted keys, used to find where
+ * a run of tuples with equal presorted keys ends.
+ */
+static void
+preparePresortedKeys(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	int			i;
+
+	node->presorted_keys =
+		(PresortedKeyData *) palloc(plannode->nPresortedCols *
+									sizeof(PresortedKeyData));
+
+	for (i = 0; i < plannode->nPresortedCols; i++)
+	{
+		Oid			equalityOp;
+		PresortedKeyData *key = &node->presorted_keys[i];
+
+		key->attno = plannode->sort.sortColIdx[i];
+
+		equalityOp = get_equality_op_for_ordering_op(plannode->sort.sortOperators[i],
+													 NULL);
+		if (!OidIsValid(equalityOp))
+			elog(ERROR, "missing equality operator for ordering operator %u",
+				 plannode->sort.sortOperators[i]);
+
+		fmgr_info_cxt(get_opcode(equalityOp), &key->flinfo,
+					  CurrentMemoryContext);
+
+		key->fcinfo = palloc0(SizeForFunctionCallInfo(2));
+		InitFunctionCallInfoData(*key->fcinfo, &key->flinfo, 2,
+								 plannode->sort.collations[i], NULL, NULL);
+		key->fcinfo->args[0].isnull = false;
+		key->fcinfo->args[1].isnull = false;
+	}
+}
+
+/*
+ * Do the two tuples have equal presorted keys?
+ *
+ * The input is sorted by the presorted keys, so the last of them is the
+ * one most likely to differ; check the keys in reverse order.
+ */
+static bool
+isCurrentGroup(IncrementalSortState *node, TupleTableSlot *pivot,
+			   TupleTableSlot *tuple)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	MemoryContext oldcontext;
+	bool		result = true;
+	int			i;
+
+	ResetExprContext(econtext);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = plannode->nPresortedCols - 1; i >= 0; i--)
+	{
+		PresortedKeyData *key = &node->presorted_keys[i];
+		Datum		datumA,
+					datumB;
+		bool		isnullA,
+					isnullB;
+
+		datumA = slot_getattr(pivot, key->attno, &isnullA);
+		datumB = slot_getattr(tuple, key->attno, &isnullB);
+
+		/* Special case for NULL-vs-NULL, else use standard comparison */
+		if (isnullA || isnullB)
+		{
+			if (isnullA == isnullB)
+				continue;
+			result = false;
+			break;
+		}
+
+		key->fcinfo->args[0].value = datumA;
+		key->fcinfo->args[1].value = datumB;
+
+		/* just for paranoia's sake, we reset isnull each time */
+		key->fcinfo->isnull = false;
+
+		if (!DatumGetBool(FunctionCallInvoke(key->fcinfo)) ||
+			key->fcinfo->isnull)
+		{
+			result = false;
+			break;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return result;
+}
+
+/*
+ * Read the next batch of tuples from the outer plan and sort it.
+ *
+ * The batch holds at least INCREMENTAL_SORT_MIN_BATCH_SIZE tuples (fewer if
+ * we're bounded and need fewer), and then all the following tuples with the
+ * same presorted keys as the last of those.  The first tuple that doesn't
+ * belong to the batch is kept in transfer_tuple for the next one.
+ */
+static void
+incremental_sort_next_batch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	Tuplesortstate *tuplesortstate;
+	int64		minBatchSize = INCREMENTAL_SORT_MIN_BATCH_SIZE;
+	int64		nTuples = 0;
+
+	if (node->presorted_keys == NULL)
+		preparePresortedKeys(node);
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  NULL, false);
+	if (node->bounded)
+	{
+		int64		remaining = node->bound - node->bound_Done;
+
+		/*
+		 * Only the first "remaining" tuples of this batch can be needed, and
+		 * we need not read more than that many to complete the batch.
+		 */
+		tuplesort_set_bound(tuplesortstate, remaining);
+		minBatchSize = Min(minBatchSize, remaining);
+	}
+	node->tuplesortstate = (void *) tuplesortstate;
+
+	/* Start with the tuple left over from the previous batch, if any */
+	if (!TupIsNull(node->transfer_tuple))
+	{
+		tuplesort_puttupleslot(tuplesortstate, node->transfer_tuple);
+		if (++nTuples == minBatchSize)
+			ExecCopySlot(node->group_pivot, node->transfer_tuple);
+		ExecClearTuple(node->transfer_tuple);
+	}
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->outerNodeDone = true;
+			break;
+		}
+
+		/*
+		 * Once we have enough tuples, stop at the end of the current run.
+		 * The input is sorted by the presorted keys, so every tuple after
+		 * the pivot either belongs to its run or starts a new one.
+		 */
+		if (nTuples >= minBatchSize &&
+			!isCurrentGroup(node, node->group_pivot, slot))
+		{
+			ExecCopySlot(node->transfer_tuple, slot);
+			break;
+		}
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+		if (++nTuples == minBatchSize)
+			ExecCopySlot(node->group_pivot, slot);
+	}
+
+	ExecClearTuple(node->group_pivot);
+
+	SO1_printf("ExecIncrementalSort: sorting batch of " INT64_FORMAT " tuples\n",
+			   nTuples);
+
+	tuplesort_performsort(tuplesortstate);
+
+	if (node->ss.ps.instrument != NULL)
+	{
+		TuplesortInstrumentation sinstrument;
+
+		tuplesort_get_stats(tuplesortstate, &sinstrument);
+
+		/* A batch that spilled to disk trumps any in-memory one */
+		if (node->stats.batchCount++ == 0 ||
+			(sinstrument.spaceType == node->stats.maxSpaceType &&
+			 sinstrument.spaceUsed > node->stats.maxSpaceUsed) ||
+			(sinstrument.spaceType == SORT_SPACE_TYPE_DISK &&
+			 node->stats.maxSpaceType != SORT_SPACE_TYPE_DISK))
+		{
+			node->stats.maxSpaceUsed = sinstrument.spaceUsed;
+			node->stats.maxSpaceType = sinstrument.spaceType;
+			node->stats.sortMethod = sinstrument.sortMethod;
+		}
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Returns the next tuple of the current sorted batch, reading and
+ *		sorting the next batch from the outer plan when it runs out.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (;;)
+	{
+		if (node->tuplesortstate != NULL)
+		{
+			/*
+			 * Note that we only rely on slot tuple remaining valid until the
+			 * next fetch from the tuplesort.
+			 */
+			if (tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+									   true, false, slot, NULL))
+			{
+				node->bound_Done++;
+				return slot;
+			}
+
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+			node->tuplesortstate = NULL;
+		}
+
+		if (node->outerNodeDone ||
+			(node->bounded && node->bound_Done >= node->bound))
+			break;
+
+		incremental_sort_next_batch(node);
+	}
+
+	return ExecClearTuple(slot);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	TupleDesc	tupDesc;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing incremental sort node");
+
+	/*
+	 * Incremental sort can't be used with backward scans or mark/restore,
+	 * as it only ever keeps the current batch.  The planner knows that.
+	 */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+	incrsortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	incrsortstate->bounded = false;
+	incrsortstate->bound_Done = 0;
+	incrsortstate->outerNodeDone = false;
+	incrsortstate->presorted_keys = NULL;
+	incrsortstate->tuplesortstate = NULL;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an ExprContext only as a place to run the equality functions
+	 * of the presorted keys in.
+	 */
+	ExecAssignExprContext(estate, &incrsortstate->ss.ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate,
+												 eflags);
+
+	/*
+	 * Initialize scan slot and type.
+	 */
+	ExecCreateScanSlotFromOuterPlan(estate, &incrsortstate->ss, &TTSOpsVirtual);
+
+	/*
+	 * Initialize return slot and type. No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(&incrsortstate->ss.ps, &TTSOpsMinimalTuple);
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/* Slots for the batch boundary checks */
+	tupDesc = ExecGetResultType(outerPlanState(incrsortstate));
+	incrsortstate->group_pivot =
+		MakeSingleTupleTableSlot(tupDesc, &TTSOpsMinimalTuple);
+	incrsortstate->transfer_tuple =
+		MakeSingleTupleTableSlot(tupDesc, &TTSOpsMinimalTuple);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "incremental sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down incremental sort node");
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecDropSingleTupleTableSlot(node->group_pivot);
+	ExecDropSingleTupleTableSlot(node->transfer_tuple);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "incremental sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * We only ever keep the current batch, so we always have to re-read the
+	 * subplan.  That also takes care of changes of the bound.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	if (node->tuplesortstate != NULL)
+	{
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+	}
+
+	node->outerNodeDone = false;
+	node->bound_Done = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
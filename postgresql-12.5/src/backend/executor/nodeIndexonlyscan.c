@@ -351,6 +351,22 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 	}
 	node->ioss_RuntimeKeysReady = true;
 
+	/*
+	 * If ExecIndexOnlyScanSeek left us with a scan that has an extra key, get
+	 * rid of it; IndexOnlyNext will begin a fresh one.
+	 */
+	if (node->ioss_ScanDesc &&
+		node->ioss_ScanDesc->numberOfKeys != node->ioss_NumScanKeys)
+	{
+		if (node->ioss_VMBuffer != InvalidBuffer)
+		{
+			ReleaseBuffer(node->ioss_VMBuffer);
+			node->ioss_VMBuffer = InvalidBuffer;
+		}
+		index_endscan(node->ioss_ScanDesc);
+		node->ioss_ScanDesc = NULL;
+	}
+
 	/* reset index scan */
 	if (node->ioss_ScanDesc)
 		index_rescan(node->ioss_ScanDesc,
@@ -478,6 +494,45 @@ ExecIndexOnlyRestrPos(IndexOnlyScanState *node)
 	index_restrpos(node->ioss_ScanDesc);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecIndexOnlyScanSeek
+ *
+ *		Restart the scan at the first tuple that satisfies seekkey as well
+ *		as the scan's own quals.  See ExecIndexScanSeek.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIndexOnlyScanSeek(IndexOnlyScanState *node, ScanKey seekkey)
+{
+	EState	   *estate = node->ss.ps.state;
+	int			nkeys = node->ioss_NumScanKeys + 1;
+
+	Assert(node->ioss_ScanDesc != NULL);
+	Assert(node->ioss_NumOrderByKeys == 0);
+
+	if (node->ioss_SeekKeys == NULL)
+		node->ioss_SeekKeys = (ScanKey)
+			MemoryContextAlloc(estate->es_query_cxt,
+							   nkeys * sizeof(ScanKeyData));
+
+	if (node->ioss_ScanDesc->numberOfKeys != nkeys)
+	{
+		index_endscan(node->ioss_ScanDesc);
+		node->ioss_ScanDesc = index_beginscan(node->ss.ss_currentRelation,
+											  node->ioss_RelationDesc,
+											  estate->es_snapshot,
+											  nkeys, 0);
+		node->ioss_ScanDesc->xs_want_itup = true;
+	}
+
+	/* index AMs expect the keys in order by column, so put this one first */
+	node->ioss_SeekKeys[0] = *seekkey;
+	memcpy(&node->ioss_SeekKeys[1], node->ioss_ScanKeys,
+		   node->ioss_NumScanKeys * sizeof(ScanKeyData));
+
+	index_rescan(node->ioss_ScanDesc, node->ioss_SeekKeys, nkeys, NULL, 0);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitIndexOnlyScan
  *
@@ -578,6 +578,17 @@ ExecReScanIndexScan(IndexScanState *node)
 			reorderqueue_pop(node);
 	}
 
+	/*
+	 * If ExecIndexScanSeek left us with a scan that has an extra key, get
+	 * rid of it; IndexNext will begin a fresh one.
+	 */
+	if (node->iss_ScanDesc &&
+		node->iss_ScanDesc->numberOfKeys != node->iss_NumScanKeys)
+	{
+		index_endscan(node->iss_ScanDesc);
+		node->iss_ScanDesc = NULL;
+	}
+
 	/* reset index scan */
 	if (node->iss_ScanDesc)
 		index_rescan(node->iss_ScanDesc,
@@ -885,6 +896,50 @@ ExecIndexRestrPos(IndexScanState *node)
 	index_restrpos(node->iss_ScanDesc);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecIndexScanSeek
+ *
+ *		Restart the scan at the first tuple that satisfies seekkey as well
+ *		as the scan's own quals.  Merge join uses this to jump over a long
+ *		run of inner tuples that can't match; the key is therefore on the
+ *		leading index column and only moves forward.  Any mark is lost.
+ *		The extra key stays in effect until the next rescan.
+ *
+ *		The index AM wants to know the number of keys when the scan begins,
+ *		so the first seek has to begin a new scan with room for one more.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIndexScanSeek(IndexScanState *node, ScanKey seekkey)
+{
+	EState	   *estate = node->ss.ps.state;
+	int			nkeys = node->iss_NumScanKeys + 1;
+
+	Assert(node->iss_ScanDesc != NULL);
+	Assert(node->iss_NumOrderByKeys == 0);
+
+	if (node->iss_SeekKeys == NULL)
+		node->iss_SeekKeys = (ScanKey)
+			MemoryContextAlloc(estate->es_query_cxt,
+							   nkeys * sizeof(ScanKeyData));
+
+	if (node->iss_ScanDesc->numberOfKeys != nkeys)
+	{
+		index_endscan(node->iss_ScanDesc);
+		node->iss_ScanDesc = index_beginscan(node->ss.ss_currentRelation,
+											 node->iss_RelationDesc,
+											 estate->es_snapshot,
+											 nkeys, 0);
+	}
+
+	/* index AMs expect the keys in order by column, so put this one first */
+	node->iss_SeekKeys[0] = *seekkey;
+	memcpy(&node->iss_SeekKeys[1], node->iss_ScanKeys,
+		   node->iss_NumScanKeys * sizeof(ScanKeyData));
+
+	index_rescan(node->iss_ScanDesc, node->iss_SeekKeys, nkeys, NULL, 0);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitIndexScan
  *
@@ -81,10 +81,6 @@ lnext:
 		TM_Result	test;
 		TupleTableSlot *markSlot;
 
-		/* clear any leftover test tuple for this rel */
-		markSlot = EvalPlanQualSlot(&node->lr_epqstate, erm->relation, erm->rti);
-		ExecClearTuple(markSlot);
-
 		/* if child rel, must check whether it produced this row */
 		if (erm->rti != erm->prti)
 		{
@@ -104,12 +100,21 @@ lnext:
 				/* this child is inactive right now */
 				erm->ermActive = false;
 				ItemPointerSetInvalid(&(erm->curCtid));
-				ExecClearTuple(markSlot);
+				/* a child never opened can't have a leftover test tuple */
+				if (erm->relation != NULL)
+					ExecClearTuple(EvalPlanQualSlot(&node->lr_epqstate,
+													erm->relation, erm->rti));
 				continue;
 			}
 		}
 		erm->ermActive = true;
 
+		/* clear any leftover test tuple for this rel */
+		markSlot = EvalPlanQualSlot(&node->lr_epqstate,
+									ExecRowMarkGetRelation(estate, erm),
+									erm->rti);
+		ExecClearTuple(markSlot);
+
 		/* fetch the tuple's ctid */
 		datum = ExecGetJunkAttribute(slot,
 									 aerm->ctidAttNo,
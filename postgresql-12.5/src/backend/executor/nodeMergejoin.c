@@ -94,10 +94,16 @@
 
 #include "access/nbtree.h"
 #include "executor/execdebug.h"
+#include "executor/nodeIndexonlyscan.h"
+#include "executor/nodeIndexscan.h"
 #include "executor/nodeMergejoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/parsetree.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 
 
 /*
@@ -115,6 +121,12 @@
 #define EXEC_MJ_ENDOUTER				10
 #define EXEC_MJ_ENDINNER				11
 
+/*
+ * Re-seek the inner index scan once this many consecutive inner tuples have
+ * been skipped for being less than the current outer tuple.
+ */
+#define MJ_SEEK_THRESHOLD				16
+
 /*
  * Runtime data for each mergejoin clause
  */
@@ -152,6 +164,10 @@ typedef enum
 #define MarkInnerTuple(innerTupleSlot, mergestate) \
 	ExecCopySlot((mergestate)->mj_MarkedTupleSlot, (innerTupleSlot))
 
+static void MJInitInnerSeek(MergeJoinState *mergestate, MergeJoin *node,
+							int eflags);
+static void MJSeekInner(MergeJoinState *mergestate);
+
 
 /*
  * MJExamineQuals
@@ -1190,12 +1206,29 @@ ExecMergeJoin(PlanState *pstate)
 					MarkInnerTuple(node->mj_InnerTupleSlot, node);
 
 					node->mj_JoinState = EXEC_MJ_JOINTUPLES;
+					node->mj_InnerSkipped = 0;
 				}
 				else if (compareResult < 0)
+				{
 					node->mj_JoinState = EXEC_MJ_SKIPOUTER_ADVANCE;
+					node->mj_InnerSkipped = 0;
+				}
 				else
+				{
 					/* compareResult > 0 */
 					node->mj_JoinState = EXEC_MJ_SKIPINNER_ADVANCE;
+
+					/*
+					 * If the inner side keeps falling short of the outer,
+					 * reposition its index scan at the outer key instead of
+					 * reading through the gap.  No mark can be needed at
+					 * this point: the next match will set a new one.
+					 */
+					if (node->mj_InnerSeekKey != NULL &&
+						++node->mj_InnerSkipped >= MJ_SEEK_THRESHOLD &&
+						node->js.ps.state->es_epq_active == NULL)
+						MJSeekInner(node);
+				}
 				break;
 
 				/*
@@ -1428,6 +1461,146 @@ ExecMergeJoin(PlanState *pstate)
 	}
 }
 
+/*
+ * MJInitInnerSeek
+ *
+ * Decide whether the inner side can be repositioned by MJSeekInner, and if
+ * so build the scan key for it.  That requires the inner child to be a
+ * plain forward btree index scan (or index-only scan) whose leading column
+ * is the inner side of the first merge clause, sorted the same way, and an
+ * operator in the clause's opfamily comparing that column to the outer
+ * side.  We also mustn't skip inner tuples when the unmatched ones have to
+ * be emitted.
+ */
+static void
+MJInitInnerSeek(MergeJoinState *mergestate, MergeJoin *node, int eflags)
+{
+	PlanState  *innerstate = innerPlanState(mergestate);
+	Plan	   *innerplan = innerstate->plan;
+	Relation	index;
+	OpExpr	   *clause;
+	Expr	   *innerexpr;
+	TargetEntry *tle;
+	Var		   *var;
+	Oid			outertype;
+	Oid			opno;
+	ScanKey		key;
+
+	mergestate->mj_InnerSeekKey = NULL;
+
+	if (mergestate->mj_FillInner || mergestate->mj_NumClauses == 0 ||
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) || innerplan->parallel_aware ||
+		node->mergeStrategies[0] != BTLessStrategyNumber)
+		return;
+
+	if (IsA(innerstate, IndexScanState))
+	{
+		IndexScan  *plan = (IndexScan *) innerplan;
+
+		if (!ScanDirectionIsForward(plan->indexorderdir) ||
+			plan->indexorderby != NIL)
+			return;
+		index = ((IndexScanState *) innerstate)->iss_RelationDesc;
+	}
+	else if (IsA(innerstate, IndexOnlyScanState))
+	{
+		IndexOnlyScan *plan = (IndexOnlyScan *) innerplan;
+
+		if (!ScanDirectionIsForward(plan->indexorderdir) ||
+			plan->indexorderby != NIL)
+			return;
+		index = ((IndexOnlyScanState *) innerstate)->ioss_RelationDesc;
+	}
+	else
+		return;
+
+	/* Find the index column the inner side of the first clause refers to */
+	clause = linitial_node(OpExpr, node->mergeclauses);
+	innerexpr = (Expr *) lsecond(clause->args);
+	while (IsA(innerexpr, RelabelType))
+		innerexpr = ((RelabelType *) innerexpr)->arg;
+	if (!IsA(innerexpr, Var) || ((Var *) innerexpr)->varno != INNER_VAR)
+		return;
+	tle = get_tle_by_resno(innerplan->targetlist,
+						   ((Var *) innerexpr)->varattno);
+	if (tle == NULL || !IsA(tle->expr, Var))
+		return;
+	var = (Var *) tle->expr;
+
+	if (IsA(innerstate, IndexScanState))
+	{
+		if (var->varno != ((Scan *) innerplan)->scanrelid ||
+			var->varattno <= 0 ||
+			var->varattno != index->rd_index->indkey.values[0])
+			return;
+	}
+	else if (var->varno != INDEX_VAR || var->varattno != 1)
+		return;
+
+	/* The index must be sorted the way the merge join expects */
+	if (index->rd_opfamily[0] != node->mergeFamilies[0] ||
+		index->rd_indcollation[0] != node->mergeCollations[0] ||
+		(index->rd_indoption[0] & INDOPTION_DESC) != 0)
+		return;
+
+	outertype = exprType((Node *) linitial(clause->args));
+	opno = get_opfamily_member(node->mergeFamilies[0],
+							   index->rd_opcintype[0], outertype,
+							   BTGreaterEqualStrategyNumber);
+	if (!OidIsValid(opno))
+		return;
+
+	key = (ScanKey) palloc(sizeof(ScanKeyData));
+	ScanKeyEntryInitialize(key,
+						   0,
+						   1,
+						   BTGreaterEqualStrategyNumber,
+						   outertype,
+						   node->mergeCollations[0],
+						   get_opcode(opno),
+						   (Datum) 0);
+	get_typlenbyval(outertype,
+					&mergestate->mj_SeekTypLen, &mergestate->mj_SeekTypByVal);
+	mergestate->mj_InnerSeekKey = key;
+}
+
+/*
+ * MJSeekInner
+ *
+ * Restart the inner index scan at the first entry whose leading column is
+ * >= the current outer tuple's first merge key, skipping all the inner
+ * tuples in between.  The index AM holds on to the key's argument for the
+ * rest of the scan, so we keep our own copy of it.
+ */
+static void
+MJSeekInner(MergeJoinState *mergestate)
+{
+	ScanKey		key = mergestate->mj_InnerSeekKey;
+	MergeJoinClause clause = &mergestate->mj_Clauses[0];
+	PlanState  *innerstate = innerPlanState(mergestate);
+	MemoryContext oldcxt;
+
+	Assert(!clause->lisnull);
+
+	if (!mergestate->mj_SeekTypByVal &&
+		DatumGetPointer(key->sk_argument) != NULL)
+		pfree(DatumGetPointer(key->sk_argument));
+
+	oldcxt = MemoryContextSwitchTo(mergestate->js.ps.state->es_query_cxt);
+	key->sk_argument = datumCopy(clause->ldatum,
+								 mergestate->mj_SeekTypByVal,
+								 mergestate->mj_SeekTypLen);
+	MemoryContextSwitchTo(oldcxt);
+
+	if (IsA(innerstate, IndexScanState))
+		ExecIndexScanSeek((IndexScanState *) innerstate, key);
+	else
+		ExecIndexOnlyScanSeek((IndexOnlyScanState *) innerstate, key);
+
+	mergestate->mj_InnerSkipped = 0;
+	mergestate->mj_InnerSeeks++;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitMergeJoin
  * ----------------------------------------------------------------
@@ -1611,6 +1784,10 @@ ExecInitMergeJoin(MergeJoin *node, EState *estate, int eflags)
 	mergestate->mj_MatchedInner = false;
 	mergestate->mj_OuterTupleSlot = NULL;
 	mergestate->mj_InnerTupleSlot = NULL;
+	mergestate->mj_InnerSkipped = 0;
+	mergestate->mj_InnerSeeks = 0;
+
+	MJInitInnerSeek(mergestate, node, eflags);
 
 	/*
 	 * initialization successful
@@ -1665,6 +1842,7 @@ ExecReScanMergeJoin(MergeJoinState *node)
 	node->mj_MatchedInner = false;
 	node->mj_OuterTupleSlot = NULL;
 	node->mj_InnerTupleSlot = NULL;
+	node->mj_InnerSkipped = 0;
 
 	/*
 	 * if chgParam of subnodes is not null then plans will be re-scanned by
@@ -58,6 +58,24 @@
 #include "utils/rel.h"
 
 
+/*
+ * When the rows of a plain INSERT need no per-row processing once they have
+ * been stored, we buffer them and store them with table_multi_insert(), the
+ * way COPY FROM does.  The buffer is flushed when it holds this many tuples,
+ * or this many bytes of tuple data.
+ */
+#define MAX_BUFFERED_TUPLES		1000
+#define MAX_BUFFERED_BYTES		65535
+
+typedef struct ModifyTableMultiInsert
+{
+	ResultRelInfo *resultRelInfo;	/* target relation */
+	BulkInsertState bistate;	/* BulkInsertState for the target */
+	int			nused;			/* number of 'slots' containing tuples */
+	Size		nbytes;			/* data size of the buffered tuples */
+	TupleTableSlot *slots[MAX_BUFFERED_TUPLES];	/* buffered tuples */
+} ModifyTableMultiInsert;
+
 static bool ExecOnConflictUpdate(ModifyTableState *mtstate,
 								 ResultRelInfo *resultRelInfo,
 								 ItemPointer conflictTid,
@@ -75,6 +93,13 @@ static ResultRelInfo *getTargetResultRelInfo(ModifyTableState *node);
 static void ExecSetupChildParentMapForSubplan(ModifyTableState *mtstate);
 static TupleConversionMap *tupconv_map_for_subplan(ModifyTableState *node,
 												   int whichplan);
+static bool ExecMultiInsertUsable(ModifyTableState *mtstate,
+								  ModifyTable *node);
+static void ExecMultiInsertBufferTuple(ModifyTableState *mtstate,
+									   EState *estate,
+									   TupleTableSlot *slot);
+static void ExecMultiInsertFlush(ModifyTableState *mtstate, EState *estate);
+static void ExecBatchInsert(EState *estate, ResultRelInfo *resultRelInfo);
 
 /*
  * Verify that the tuples to be produced by INSERT or UPDATE match the
@@ -360,6 +385,7 @@ ExecInsert(ModifyTableState *mtstate,
 	TransitionCaptureState *ar_insert_trig_tcs;
 	ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
 	OnConflictAction onconflict = node->onConflictAction;
+	bool		buffered = false;
 
 	ExecMaterializeSlot(slot);
 
@@ -401,6 +427,24 @@ ExecInsert(ModifyTableState *mtstate,
 			resultRelationDesc->rd_att->constr->has_generated_stored)
 			ExecComputeStoredGenerated(estate, slot);
 
+		/*
+		 * If the FDW can insert rows in batches, just buffer the row; the
+		 * batch is sent when it's full, or at the end of the statement.
+		 */
+		if (resultRelInfo->ri_BatchSize == 0)
+			resultRelInfo->ri_BatchSize =
+				ExecGetForeignBatchSize(resultRelInfo,
+										mtstate->operation == CMD_INSERT &&
+										onconflict == ONCONFLICT_NONE &&
+										mtstate->mt_transition_capture == NULL);
+		if (resultRelInfo->ri_BatchSize > 1)
+		{
+			ExecForeignBatchInsertAdd(estate, resultRelInfo, slot);
+			if (canSetTag)
+				(estate->es_processed)++;
+			return NULL;
+		}
+
 		/*
 		 * insert into foreign table: let the FDW do it
 		 */
@@ -587,6 +631,16 @@ ExecInsert(ModifyTableState *mtstate,
 
 			/* Since there was no insertion conflict, we're done */
 		}
+		else if (mtstate->mt_multi_insert != NULL)
+		{
+			/*
+			 * Buffer the tuple.  It, and its index entries, will be inserted
+			 * when the buffer is flushed.  There is nothing else to do for
+			 * it; see ExecMultiInsertUsable.
+			 */
+			ExecMultiInsertBufferTuple(mtstate, estate, slot);
+			buffered = true;
+		}
 		else
 		{
 			/* insert the tuple normally */
@@ -604,9 +658,13 @@ ExecInsert(ModifyTableState *mtstate,
 	if (canSetTag)
 	{
 		(estate->es_processed)++;
-		setLastTid(&slot->tts_tid);
+		if (!buffered)
+			setLastTid(&slot->tts_tid);
 	}
 
+	if (buffered)
+		return NULL;
+
 	/*
 	 * If this insert is the result of a partition key update that moved the
 	 * tuple to a new partition, put this row into the transition NEW TABLE,
@@ -1119,7 +1177,7 @@ ExecUpdate(ModifyTableState *mtstate,
 	{
 		LockTupleMode lockmode;
 		bool		partition_constraint_failed;
-		bool		update_indexes;
+		TM_IndexUpdate index_update;
 
 		/*
 		 * Constraints might reference the tableoid column, so (re-)initialize
@@ -1320,7 +1378,7 @@ lreplace:;
 									estate->es_snapshot,
 									estate->es_crosscheck_snapshot,
 									true /* wait for commit */ ,
-									&tmfd, &lockmode, &update_indexes);
+									&tmfd, &lockmode, &index_update);
 
 		switch (result)
 		{
@@ -1450,8 +1508,9 @@ lreplace:;
 		}
 
 		/* insert index entries for tuple if necessary */
-		if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
-			recheckIndexes = ExecInsertIndexTuples(slot, estate, false, NULL, NIL);
+		if (resultRelInfo->ri_NumIndices > 0)
+			recheckIndexes = ExecUpdateIndexTuples(slot, estate, &index_update);
+		bms_free(index_update.changed_attrs);
 	}
 
 	if (canSetTag)
@@ -2251,6 +2310,11 @@ ExecModifyTable(PlanState *pstate)
 		}
 	}
 
+	/* Store any rows still buffered by a batched INSERT */
+	if (node->mt_multi_insert)
+		ExecMultiInsertFlush(node, estate);
+	ExecPendingInserts(estate);
+
 	/* Restore es_result_relation_info before exiting */
 	estate->es_result_relation_info = saved_resultRelInfo;
 
@@ -2264,6 +2328,271 @@ ExecModifyTable(PlanState *pstate)
 	return NULL;
 }
 
+/*
+ * ExecMultiInsertUsable
+ *		Can the rows of this ModifyTable be inserted in batches?
+ *
+ * The planner has already checked that this is a plain INSERT without ON
+ * CONFLICT or RETURNING, and that no volatile function could observe the
+ * target table's contents while we buffer rows.  Here we make sure nothing
+ * needs to be done for a row after it is stored, other than making its
+ * index entries: no row triggers (which also covers foreign keys and
+ * deferrable unique constraints), no transition tables and no view WITH
+ * CHECK OPTIONs.  We only handle a plain table target; rows routed to
+ * partitions, and foreign tables, are inserted one at a time.
+ */
+static bool
+ExecMultiInsertUsable(ModifyTableState *mtstate, ModifyTable *node)
+{
+	ResultRelInfo *resultRelInfo = mtstate->resultRelInfo;
+	TriggerDesc *trigdesc = resultRelInfo->ri_TrigDesc;
+	ListCell   *lc;
+
+	if (!node->multiInsertSafe || mtstate->operation != CMD_INSERT)
+		return false;
+
+	Assert(node->onConflictAction == ONCONFLICT_NONE);
+	Assert(resultRelInfo->ri_projectReturning == NULL);
+
+	/*
+	 * Don't bother for an INSERT that's expected to produce just one row,
+	 * such as INSERT ... VALUES with a single row.
+	 */
+	if (mtstate->mt_nplans != 1 ||
+		mtstate->mt_plans[0]->plan->plan_rows < 2 ||
+		mtstate->mt_partition_tuple_routing != NULL ||
+		resultRelInfo->ri_RelationDesc->rd_rel->relkind != RELKIND_RELATION ||
+		resultRelInfo->ri_FdwRoutine != NULL)
+		return false;
+
+	if (trigdesc != NULL &&
+		(trigdesc->trig_insert_before_row ||
+		 trigdesc->trig_insert_after_row ||
+		 trigdesc->trig_insert_instead_row ||
+		 trigdesc->trig_insert_new_table))
+		return false;
+
+	if (mtstate->mt_transition_capture != NULL)
+		return false;
+
+	/* RLS checks are made before the row is buffered, so they're fine */
+	foreach(lc, resultRelInfo->ri_WithCheckOptions)
+	{
+		WithCheckOption *wco = (WithCheckOption *) lfirst(lc);
+
+		if (wco->kind == WCO_VIEW_CHECK)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * ExecMultiInsertBufferTuple
+ *		Add a tuple to the batched INSERT buffer, flushing it if it's full.
+ */
+static void
+ExecMultiInsertBufferTuple(ModifyTableState *mtstate, EState *estate,
+						   TupleTableSlot *slot)
+{
+	ModifyTableMultiInsert *mi = mtstate->mt_multi_insert;
+	TupleTableSlot *batchslot;
+
+	Assert(estate->es_result_relation_info == mi->resultRelInfo);
+	Assert(mi->nused < MAX_BUFFERED_TUPLES);
+
+	/* The slots are created on first use and reused after each flush */
+	if (mi->slots[mi->nused] == NULL)
+		mi->slots[mi->nused] =
+			table_slot_create(mi->resultRelInfo->ri_RelationDesc,
+							  &estate->es_tupleTable);
+	batchslot = mi->slots[mi->nused++];
+	ExecCopySlot(batchslot, slot);
+
+	slot_getallattrs(slot);
+	mi->nbytes += heap_compute_data_size(slot->tts_tupleDescriptor,
+										 slot->tts_values,
+										 slot->tts_isnull);
+
+	if (mi->nused >= MAX_BUFFERED_TUPLES || mi->nbytes >= MAX_BUFFERED_BYTES)
+		ExecMultiInsertFlush(mtstate, estate);
+}
+
+/*
+ * ExecMultiInsertFlush
+ *		Insert the buffered tuples of a batched INSERT, and their index
+ *		entries.
+ */
+static void
+ExecMultiInsertFlush(ModifyTableState *mtstate, EState *estate)
+{
+	ModifyTableMultiInsert *mi = mtstate->mt_multi_insert;
+	ResultRelInfo *resultRelInfo = mi->resultRelInfo;
+	ResultRelInfo *saved_resultRelInfo = estate->es_result_relation_info;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (mi->nused == 0)
+		return;
+
+	estate->es_result_relation_info = resultRelInfo;
+
+	/*
+	 * table_multi_insert may leak memory, so switch to short-lived memory
+	 * context before calling it.
+	 */
+	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	table_multi_insert(resultRelInfo->ri_RelationDesc,
+					   mi->slots,
+					   mi->nused,
+					   estate->es_output_cid,
+					   0,
+					   mi->bistate);
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < mi->nused; i++)
+	{
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			List	   *recheckIndexes;
+
+			recheckIndexes = ExecInsertIndexTuples(mi->slots[i], estate,
+												   false, NULL, NIL);
+			/* deferrable constraints would have required a row trigger */
+			Assert(recheckIndexes == NIL);
+			list_free(recheckIndexes);
+		}
+	}
+
+	if (mtstate->canSetTag)
+		setLastTid(&mi->slots[mi->nused - 1]->tts_tid);
+
+	for (i = 0; i < mi->nused; i++)
+		ExecClearTuple(mi->slots[i]);
+
+	mi->nused = 0;
+	mi->nbytes = 0;
+
+	estate->es_result_relation_info = saved_resultRelInfo;
+}
+
+/*
+ * ExecGetForeignBatchSize
+ *		How many rows to send to a foreign table in one batched INSERT?
+ *
+ * batch_ok is false if the caller needs each row inserted as it comes, as
+ * for ON CONFLICT or when capturing transition tables.  As with local
+ * tables, we only batch rows that need nothing done after they're stored:
+ * no AFTER ROW triggers, RETURNING or WITH CHECK OPTIONs.  A result of 1
+ * means rows are inserted one at a time.
+ */
+int
+ExecGetForeignBatchSize(ResultRelInfo *resultRelInfo, bool batch_ok)
+{
+	FdwRoutine *fdwroutine = resultRelInfo->ri_FdwRoutine;
+	TriggerDesc *trigdesc = resultRelInfo->ri_TrigDesc;
+
+	if (!batch_ok ||
+		fdwroutine->ExecForeignBatchInsert == NULL ||
+		fdwroutine->GetForeignModifyBatchSize == NULL)
+		return 1;
+
+	if (resultRelInfo->ri_projectReturning != NULL ||
+		resultRelInfo->ri_WithCheckOptions != NIL ||
+		(trigdesc != NULL && trigdesc->trig_insert_after_row))
+		return 1;
+
+	return Max(fdwroutine->GetForeignModifyBatchSize(resultRelInfo), 1);
+}
+
+/*
+ * ExecForeignBatchInsertAdd
+ *		Buffer a row for a batched foreign-table INSERT, sending the batch
+ *		to the FDW if it's full.
+ */
+void
+ExecForeignBatchInsertAdd(EState *estate, ResultRelInfo *resultRelInfo,
+						  TupleTableSlot *slot)
+{
+	MemoryContext oldcontext;
+	TupleTableSlot *batchslot;
+
+	Assert(resultRelInfo->ri_BatchSize > 1);
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/* The slots are created on first use and reused after each batch */
+	if (resultRelInfo->ri_Slots == NULL)
+		resultRelInfo->ri_Slots = (TupleTableSlot **)
+			palloc0(sizeof(TupleTableSlot *) * resultRelInfo->ri_BatchSize);
+
+	if (resultRelInfo->ri_NumSlots == 0)
+		estate->es_insert_pending_result_relations =
+			lappend(estate->es_insert_pending_result_relations,
+					resultRelInfo);
+
+	if (resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots] == NULL)
+		resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots] =
+			table_slot_create(resultRelInfo->ri_RelationDesc,
+							  &estate->es_tupleTable);
+	batchslot = resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots++];
+	ExecCopySlot(batchslot, slot);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (resultRelInfo->ri_NumSlots >= resultRelInfo->ri_BatchSize)
+	{
+		ExecBatchInsert(estate, resultRelInfo);
+		estate->es_insert_pending_result_relations =
+			list_delete_ptr(estate->es_insert_pending_result_relations,
+							resultRelInfo);
+	}
+}
+
+/*
+ * ExecPendingInserts
+ *		Send the rows still buffered for batched foreign-table INSERTs.
+ */
+void
+ExecPendingInserts(EState *estate)
+{
+	ListCell   *lc;
+
+	foreach(lc, estate->es_insert_pending_result_relations)
+		ExecBatchInsert(estate, (ResultRelInfo *) lfirst(lc));
+
+	list_free(estate->es_insert_pending_result_relations);
+	estate->es_insert_pending_result_relations = NIL;
+}
+
+/*
+ * ExecBatchInsert
+ *		Have the FDW insert the rows buffered for a foreign table.
+ */
+static void
+ExecBatchInsert(EState *estate, ResultRelInfo *resultRelInfo)
+{
+	ResultRelInfo *saved_resultRelInfo = estate->es_result_relation_info;
+	int			numSlots = resultRelInfo->ri_NumSlots;
+	int			i;
+
+	if (numSlots == 0)
+		return;
+
+	estate->es_result_relation_info = resultRelInfo;
+
+	(void) resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
+																resultRelInfo,
+																resultRelInfo->ri_Slots,
+																&numSlots);
+
+	for (i = 0; i < resultRelInfo->ri_NumSlots; i++)
+		ExecClearTuple(resultRelInfo->ri_Slots[i]);
+	resultRelInfo->ri_NumSlots = 0;
+
+	estate->es_result_relation_info = saved_resultRelInfo;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitModifyTable
  * ----------------------------------------------------------------
@@ -2724,6 +3053,20 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		}
 	}
 
+	/*
+	 * Buffer the rows and insert them in batches, if we can.
+	 */
+	if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY) &&
+		ExecMultiInsertUsable(mtstate, node))
+	{
+		ModifyTableMultiInsert *mi;
+
+		mi = (ModifyTableMultiInsert *) palloc0(sizeof(ModifyTableMultiInsert));
+		mi->resultRelInfo = mtstate->resultRelInfo;
+		mi->bistate = GetBulkInsertState();
+		mtstate->mt_multi_insert = mi;
+	}
+
 	/*
 	 * Lastly, if this is not the primary (canSetTag) ModifyTable node, add it
 	 * to estate->es_auxmodifytables so that it will be run to completion by
@@ -2767,6 +3110,19 @@ ExecEndModifyTable(ModifyTableState *node)
 														   resultRelInfo);
 	}
 
+	/*
+	 * Release the bulk-insert state of a batched INSERT.  The buffered slots
+	 * are in the executor's tuple table and get cleaned up with it.
+	 */
+	if (node->mt_multi_insert)
+	{
+		ModifyTableMultiInsert *mi = node->mt_multi_insert;
+
+		Assert(mi->nused == 0);
+		FreeBulkInsertState(mi->bistate);
+		table_finish_bulk_insert(mi->resultRelInfo->ri_RelationDesc, 0);
+	}
+
 	/*
 	 * Close all the partitioned tables, leaf partitions, and their indices
 	 * and release the slot used for tuple routing, if set.
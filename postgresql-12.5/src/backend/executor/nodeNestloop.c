@@ -17,16 +17,60 @@
  *		ExecNestLoop	 - process a nestloop join of two plans
  *		ExecInitNestLoop - initialize the join
  *		ExecEndNestLoop  - shut down the join
+ *
+ *	 ADAPTIVE INNER HASHING
+ *		A nestloop whose inner side is not parameterized by the outer side
+ *		rescans the whole inner relation for every outer row.  That is cheap
+ *		if the planner was right about there being only a few outer rows,
+ *		and disastrous if it was wrong.  When adaptive_nestloop_factor is set
+ *		and the outer side produces that many times more rows than estimated,
+ *		we load the inner relation once into a hash table keyed on the
+ *		hashable equality clauses of the join qual, and from then on fetch
+ *		the "inner scan" for each outer row from the matching hash entry.
+ *		Everything else, including the full join qual test and outer/semi/
+ *		anti join handling, stays exactly as in the plain nestloop, so the
+ *		switch can happen at any outer row without buffering anything.  If
+ *		the inner relation doesn't fit in work_mem we give up and keep
+ *		rescanning.
  */
 
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "executor/executor.h"
 #include "executor/nodeNestloop.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
 
+/* GUC parameter */
+double		adaptive_nestloop_factor = 0.0;
+
+/* inner tuples stored in a hash entry, chained through entry->additional */
+typedef struct NestLoopHashTuple
+{
+	struct NestLoopHashTuple *next;
+	MinimalTuple tuple;
+} NestLoopHashTuple;
+
+/* values returned by nestloop_expr_sides */
+#define NL_SIDE_OUTER	0x01
+#define NL_SIDE_INNER	0x02
+#define NL_SIDE_OTHER	0x04
+
+static bool nestloop_expr_sides_walker(Node *node, int *sides);
+static bool nestloop_key_has_nulls(TupleTableSlot *slot);
+static void ExecNestLoopInitHash(NestLoopState *nlstate, NestLoop *node);
+static bool ExecNestLoopBuildHash(NestLoopState *node);
+static void ExecNestLoopHashProbe(NestLoopState *node);
+static TupleTableSlot *ExecNestLoopHashNext(NestLoopState *node);
+
+
 /* ----------------------------------------------------------------
  *		ExecNestLoop(node)
  *
@@ -122,6 +166,22 @@ ExecNestLoop(PlanState *pstate)
 			node->nl_NeedNewOuter = false;
 			node->nl_MatchedOuter = false;
 
+			/*
+			 * If the outer side is running far past its estimate, try to
+			 * switch to a hashed inner side.
+			 */
+			if (node->nl_SwitchRows > 0 && !node->nl_Hashed)
+			{
+				node->nl_NumOuter += 1;
+				if (node->nl_NumOuter > node->nl_SwitchRows &&
+					ExecNestLoopBuildHash(node))
+				{
+					node->nl_Hashed = true;
+					if (node->nl_SwitchedAfter == 0)
+						node->nl_SwitchedAfter = node->nl_NumOuter;
+				}
+			}
+
 			/*
 			 * fetch the values of any outer Vars that must be passed to the
 			 * inner scan, and store them in the appropriate PARAM_EXEC slots.
@@ -146,10 +206,19 @@ ExecNestLoop(PlanState *pstate)
 			}
 
 			/*
-			 * now rescan the inner plan
+			 * now rescan the inner plan, or look up the outer tuple in the
+			 * hashed one (in which case there are no nestParams)
 			 */
-			ENL1_printf("rescanning inner plan");
-			ExecReScan(innerPlan);
+			if (node->nl_Hashed)
+			{
+				ENL1_printf("probing hashed inner plan");
+				ExecNestLoopHashProbe(node);
+			}
+			else
+			{
+				ENL1_printf("rescanning inner plan");
+				ExecReScan(innerPlan);
+			}
 		}
 
 		/*
@@ -157,7 +226,10 @@ ExecNestLoop(PlanState *pstate)
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (node->nl_Hashed)
+			innerTupleSlot = ExecNestLoopHashNext(node);
+		else
+			innerTupleSlot = ExecProcNode(innerPlan);
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -340,6 +412,14 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 				 (int) node->join.jointype);
 	}
 
+	/*
+	 * prepare for switching to a hashed inner side, if enabled; that's only
+	 * possible when the inner side doesn't depend on the outer tuple
+	 */
+	if (adaptive_nestloop_factor > 0 && node->nestParams == NIL &&
+		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		ExecNestLoopInitHash(nlstate, node);
+
 	/*
 	 * finally, wipe the current outer tuple clean.
 	 */
@@ -373,6 +453,8 @@ ExecEndNestLoop(NestLoopState *node)
 	 * clean out the tuple table
 	 */
 	ExecClearTuple(node->js.ps.ps_ResultTupleSlot);
+	if (node->nl_HashInnerSlot)
+		ExecClearTuple(node->nl_HashInnerSlot);
 
 	/*
 	 * close down subplans
@@ -404,8 +486,349 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * innerPlan is re-scanned for each new outer tuple and MUST NOT be
 	 * re-scanned from here or you'll get troubles from inner index scans when
 	 * outer Vars are used as run-time keys...
+	 *
+	 * A hashed inner side stays valid unless the inner plan depends on a
+	 * parameter that has changed.
 	 */
+	if (node->nl_Hashed && innerPlanState(node)->chgParam != NULL)
+	{
+		node->nl_Hashed = false;
+		MemoryContextReset(node->nl_HashTableCxt);
+		ResetTupleHashTable(node->nl_HashTable);
+	}
+	node->nl_NumOuter = 0;
+	node->nl_HashNext = NULL;
 
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 }
+
+/*
+ * nestloop_expr_sides_walker
+ *		Collect NL_SIDE_* flags for the Vars in an expression.
+ */
+static bool
+nestloop_expr_sides_walker(Node *node, int *sides)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == OUTER_VAR)
+			*sides |= NL_SIDE_OUTER;
+		else if (var->varno == INNER_VAR)
+			*sides |= NL_SIDE_INNER;
+		else
+			*sides |= NL_SIDE_OTHER;
+		return false;
+	}
+	return expression_tree_walker(node, nestloop_expr_sides_walker,
+								  (void *) sides);
+}
+
+/*
+ * nestloop_key_has_nulls
+ *		Does a projected hash key contain any nulls?
+ *
+ * Hashable operators are strict, so such keys can never match.
+ */
+static bool
+nestloop_key_has_nulls(TupleTableSlot *slot)
+{
+	int			ncols = slot->tts_tupleDescriptor->natts;
+	int			i;
+
+	slot_getallattrs(slot);
+	for (i = 0; i < ncols; i++)
+	{
+		if (slot->tts_isnull[i])
+			return true;
+	}
+	return false;
+}
+
+/*
+ * ExecNestLoopInitHash
+ *		Prepare to hash the inner side on the join qual's hashable
+ *		"outer expression = inner expression" clauses, if there are any.
+ *
+ * The clauses stay in the join qual, which is still checked for each pair
+ * of tuples; the hash table merely replaces the inner rescan.
+ */
+static void
+ExecNestLoopInitHash(NestLoopState *nlstate, NestLoop *node)
+{
+	EState	   *estate = nlstate->js.ps.state;
+	int			maxkeys = list_length(node->join.joinqual);
+	int			nkeys = 0;
+	Oid		   *cross_eq_funcoids;
+	List	   *outertlist = NIL;
+	List	   *innertlist = NIL;
+	TupleDesc	outerdesc;
+	TupleTableSlot *slot;
+	ListCell   *lc;
+
+	if (maxkeys == 0)
+		return;
+
+	nlstate->nl_HashKeyColIdx = (AttrNumber *) palloc(maxkeys * sizeof(AttrNumber));
+	nlstate->nl_HashEqFuncOids = (Oid *) palloc(maxkeys * sizeof(Oid));
+	nlstate->nl_HashCollations = (Oid *) palloc(maxkeys * sizeof(Oid));
+	nlstate->nl_InnerHashFuncs = (FmgrInfo *) palloc(maxkeys * sizeof(FmgrInfo));
+	nlstate->nl_OuterHashFuncs = (FmgrInfo *) palloc(maxkeys * sizeof(FmgrInfo));
+	cross_eq_funcoids = (Oid *) palloc(maxkeys * sizeof(Oid));
+
+	foreach(lc, node->join.joinqual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Expr	   *outerexpr;
+		Expr	   *innerexpr;
+		Oid			lhs_eq_oper;
+		Oid			rhs_eq_oper;
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+		int			lsides = 0;
+		int			rsides = 0;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			continue;
+		if (!op_hashjoinable(opexpr->opno,
+							 exprType((Node *) linitial(opexpr->args))) ||
+			contain_volatile_functions((Node *) opexpr) ||
+			contain_subplans((Node *) opexpr))
+			continue;
+		if (!get_op_hash_functions(opexpr->opno, &left_hashfn, &right_hashfn) ||
+			!get_compatible_hash_operators(opexpr->opno,
+										   &lhs_eq_oper, &rhs_eq_oper))
+			continue;
+
+		(void) nestloop_expr_sides_walker((Node *) linitial(opexpr->args),
+										  &lsides);
+		(void) nestloop_expr_sides_walker((Node *) lsecond(opexpr->args),
+										  &rsides);
+
+		if (lsides == NL_SIDE_OUTER && rsides == NL_SIDE_INNER)
+		{
+			outerexpr = (Expr *) linitial(opexpr->args);
+			innerexpr = (Expr *) lsecond(opexpr->args);
+			cross_eq_funcoids[nkeys] = opexpr->opfuncid;
+			fmgr_info(left_hashfn, &nlstate->nl_OuterHashFuncs[nkeys]);
+			fmgr_info(right_hashfn, &nlstate->nl_InnerHashFuncs[nkeys]);
+			nlstate->nl_HashEqFuncOids[nkeys] = get_opcode(rhs_eq_oper);
+		}
+		else if (lsides == NL_SIDE_INNER && rsides == NL_SIDE_OUTER)
+		{
+			Oid			commutator = get_commutator(opexpr->opno);
+
+			if (!OidIsValid(commutator))
+				continue;
+			outerexpr = (Expr *) lsecond(opexpr->args);
+			innerexpr = (Expr *) linitial(opexpr->args);
+			cross_eq_funcoids[nkeys] = get_opcode(commutator);
+			fmgr_info(right_hashfn, &nlstate->nl_OuterHashFuncs[nkeys]);
+			fmgr_info(left_hashfn, &nlstate->nl_InnerHashFuncs[nkeys]);
+			nlstate->nl_HashEqFuncOids[nkeys] = get_opcode(lhs_eq_oper);
+		}
+		else
+			continue;
+
+		nlstate->nl_HashCollations[nkeys] = opexpr->inputcollid;
+		/* key columns are just 1..n */
+		nlstate->nl_HashKeyColIdx[nkeys] = nkeys + 1;
+
+		outertlist = lappend(outertlist,
+							 makeTargetEntry(outerexpr, nkeys + 1, NULL, false));
+		innertlist = lappend(innertlist,
+							 makeTargetEntry(innerexpr, nkeys + 1, NULL, false));
+		nkeys++;
+	}
+
+	if (nkeys == 0)
+		return;
+
+	nlstate->nl_NumHashKeys = nkeys;
+
+	/*
+	 * Outer keys are computed in the node's own expression context, where
+	 * the current outer tuple is; inner keys in a separate one while loading
+	 * the hash table.
+	 */
+	outerdesc = ExecTypeFromTL(outertlist);
+	slot = ExecInitExtraTupleSlot(estate, outerdesc, &TTSOpsVirtual);
+	nlstate->nl_OuterKeyProj = ExecBuildProjectionInfo(outertlist,
+													   nlstate->js.ps.ps_ExprContext,
+													   slot,
+													   &nlstate->js.ps,
+													   NULL);
+
+	nlstate->nl_InnerKeyContext = CreateExprContext(estate);
+	nlstate->nl_InnerKeyDesc = ExecTypeFromTL(innertlist);
+	slot = ExecInitExtraTupleSlot(estate, nlstate->nl_InnerKeyDesc,
+								  &TTSOpsVirtual);
+	nlstate->nl_InnerKeyProj = ExecBuildProjectionInfo(innertlist,
+													   nlstate->nl_InnerKeyContext,
+													   slot,
+													   &nlstate->js.ps,
+													   NULL);
+
+	nlstate->nl_HashCurEqComp = ExecBuildGroupingEqual(outerdesc,
+													   nlstate->nl_InnerKeyDesc,
+													   &TTSOpsVirtual,
+													   &TTSOpsMinimalTuple,
+													   nkeys,
+													   nlstate->nl_HashKeyColIdx,
+													   cross_eq_funcoids,
+													   nlstate->nl_HashCollations,
+													   &nlstate->js.ps);
+
+	nlstate->nl_HashInnerSlot =
+		ExecInitExtraTupleSlot(estate,
+							   ExecGetResultType(innerPlanState(nlstate)),
+							   &TTSOpsMinimalTuple);
+
+	nlstate->nl_HashTableCxt =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "NestLoop HashTable Context",
+							  ALLOCSET_DEFAULT_SIZES);
+	nlstate->nl_HashTempCxt =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "NestLoop HashTable Temp Context",
+							  ALLOCSET_SMALL_SIZES);
+
+	nlstate->nl_SwitchRows = adaptive_nestloop_factor *
+		Max(outerPlan(node)->plan_rows, 1.0);
+}
+
+/*
+ * ExecNestLoopBuildHash
+ *		Load the whole inner relation into the hash table.
+ *
+ * Returns false, leaving the nestloop to go on rescanning the inner plan,
+ * if the inner relation doesn't fit in work_mem.
+ */
+static bool
+ExecNestLoopBuildHash(NestLoopState *node)
+{
+	PlanState  *innerPlan = innerPlanState(node);
+	ExprContext *keycontext = node->nl_InnerKeyContext;
+	Size		limit = (Size) work_mem * 1024;
+	double		ntuples = 0;
+	long		nbuckets;
+
+	MemoryContextReset(node->nl_HashTableCxt);
+
+	nbuckets = (long) Min(innerPlan->plan->plan_rows, (double) LONG_MAX);
+	if (nbuckets < 1)
+		nbuckets = 1;
+
+	if (node->nl_HashTable)
+		ResetTupleHashTable(node->nl_HashTable);
+	else
+		node->nl_HashTable = BuildTupleHashTableExt(&node->js.ps,
+													node->nl_InnerKeyDesc,
+													node->nl_NumHashKeys,
+													node->nl_HashKeyColIdx,
+													node->nl_HashEqFuncOids,
+													node->nl_InnerHashFuncs,
+													node->nl_HashCollations,
+													nbuckets,
+													0,
+													node->js.ps.state->es_query_cxt,
+													node->nl_HashTableCxt,
+													node->nl_HashTempCxt,
+													false);
+
+	ExecReScan(innerPlan);
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(innerPlan);
+		TupleTableSlot *keyslot;
+
+		if (TupIsNull(slot))
+			break;
+
+		keycontext->ecxt_innertuple = slot;
+		keyslot = ExecProject(node->nl_InnerKeyProj);
+
+		if (!nestloop_key_has_nulls(keyslot))
+		{
+			TupleHashEntry entry;
+			NestLoopHashTuple *tup;
+			MemoryContext oldcontext;
+			bool		isnew;
+
+			entry = LookupTupleHashEntry(node->nl_HashTable, keyslot, &isnew);
+
+			oldcontext = MemoryContextSwitchTo(node->nl_HashTableCxt);
+			tup = (NestLoopHashTuple *) palloc(sizeof(NestLoopHashTuple));
+			tup->tuple = ExecCopySlotMinimalTuple(slot);
+			tup->next = (NestLoopHashTuple *) entry->additional;
+			entry->additional = tup;
+			MemoryContextSwitchTo(oldcontext);
+
+			ntuples += 1;
+		}
+
+		ResetExprContext(keycontext);
+
+		if (MemoryContextMemAllocated(node->nl_HashTableCxt, true) > limit)
+		{
+			/* too big; give up for good and keep rescanning */
+			MemoryContextReset(node->nl_HashTableCxt);
+			ResetTupleHashTable(node->nl_HashTable);
+			node->nl_SwitchRows = 0;
+			node->nl_HashAbandoned = true;
+			return false;
+		}
+	}
+
+	node->nl_HashedInnerRows = ntuples;
+	node->nl_HashSpacePeak =
+		Max(node->nl_HashSpacePeak,
+			MemoryContextMemAllocated(node->nl_HashTableCxt, true));
+
+	return true;
+}
+
+/*
+ * ExecNestLoopHashProbe
+ *		Find the hashed inner tuples matching the current outer tuple.
+ */
+static void
+ExecNestLoopHashProbe(NestLoopState *node)
+{
+	TupleTableSlot *keyslot;
+	TupleHashEntry entry;
+
+	node->nl_HashNext = NULL;
+
+	keyslot = ExecProject(node->nl_OuterKeyProj);
+	if (nestloop_key_has_nulls(keyslot))
+		return;
+
+	entry = FindTupleHashEntry(node->nl_HashTable, keyslot,
+							   node->nl_HashCurEqComp,
+							   node->nl_OuterHashFuncs);
+	if (entry)
+		node->nl_HashNext = (NestLoopHashTuple *) entry->additional;
+}
+
+/*
+ * ExecNestLoopHashNext
+ *		Return the next hashed inner tuple for the current outer tuple, or
+ *		an empty slot if there are no more.
+ */
+static TupleTableSlot *
+ExecNestLoopHashNext(NestLoopState *node)
+{
+	NestLoopHashTuple *tup = node->nl_HashNext;
+
+	if (tup == NULL)
+		return ExecClearTuple(node->nl_HashInnerSlot);
+
+	node->nl_HashNext = tup->next;
+	return ExecStoreMinimalTuple(tup->tuple, node->nl_HashInnerSlot, false);
+}
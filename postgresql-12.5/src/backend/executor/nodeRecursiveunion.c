@@ -6,6 +6,21 @@
  * To implement UNION (without ALL), we need a hashtable that stores tuples
  * already seen.  The hash key is computed from the grouping columns.
  *
+ * Since the table must remember every tuple ever returned, it can grow
+ * without bound on large recursions.  When it exceeds work_mem, all the
+ * tuples in it are moved to per-partition "seen" files, chosen by the high
+ * bits of the hash value, and the table is emptied.  From then on, tuples
+ * from the subplans are not checked right away but appended to "pending"
+ * files of their partitions.  When the current subplan is exhausted, the
+ * partitions are processed one at a time: the partition's seen tuples are
+ * loaded into the hash table, and its pending tuples are checked against
+ * them; those that are new are added to the seen file and returned.  Thus
+ * each generation of the recursion still returns exactly the tuples not
+ * seen before, at the cost of rereading the seen tuples of the partitions
+ * that received pending tuples once per generation.  The number of
+ * partitions is fixed when spilling starts; a partition that doesn't fit in
+ * work_mem by itself is simply allowed to grow past the limit.
+ *
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,8 +36,31 @@
 #include "executor/execdebug.h"
 #include "executor/nodeRecursiveunion.h"
 #include "miscadmin.h"
+#include "storage/buffile.h"
+#include "utils/dynahash.h"
+#include "utils/hashutils.h"
 #include "utils/memutils.h"
 
+/*
+ * Bounds for the number of partitions created when the hash table spills.
+ */
+#define RECURSIVEUNION_MIN_PARTITIONS	4
+#define RECURSIVEUNION_MAX_PARTITIONS	256
+
+
+static uint32 recursive_union_spill_hash(RecursiveUnionState *rustate,
+										 TupleTableSlot *slot);
+static void recursive_union_spill_write(RecursiveUnionState *rustate,
+										BufFile **file, bool compress,
+										TupleTableSlot *slot);
+static MinimalTuple recursive_union_spill_read(BufFile *file);
+static void recursive_union_spill(RecursiveUnionState *rustate);
+static bool recursive_union_lookup(RecursiveUnionState *rustate,
+								   TupleTableSlot *slot);
+static bool recursive_union_load_partition(RecursiveUnionState *rustate,
+										   int partition);
+static TupleTableSlot *recursive_union_next_pending(RecursiveUnionState *rustate);
+static void recursive_union_reset_spill(RecursiveUnionState *rustate);
 
 
 /*
@@ -52,6 +90,356 @@ build_hash_table(RecursiveUnionState *rustate)
 												false);
 }
 
+/*
+ * Compute the hash value used to assign a tuple to a spill partition.  This
+ * is computed the same way as the hash table's own hash values.
+ */
+static uint32
+recursive_union_spill_hash(RecursiveUnionState *rustate, TupleTableSlot *slot)
+{
+	RecursiveUnion *node = (RecursiveUnion *) rustate->ps.plan;
+	MemoryContext oldcontext;
+	uint32		hashkey = 0;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(rustate->tempContext);
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		Datum		attr;
+		bool		isnull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		/* treat nulls as having hash key 0 */
+		attr = slot_getattr(slot, node->dupColIdx[i], &isnull);
+		if (!isnull)
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&rustate->hashfunctions[i],
+													node->dupCollations[i],
+													attr));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(rustate->tempContext);
+
+	return murmurhash32(hashkey);
+}
+
+/*
+ * Append the tuple in slot to *file, creating the file if it doesn't exist
+ * yet.  Files that are only ever written, rewound and read once may be
+ * compressed.
+ */
+static void
+recursive_union_spill_write(RecursiveUnionState *rustate, BufFile **file,
+							bool compress, TupleTableSlot *slot)
+{
+	MinimalTuple tuple;
+	bool		shouldFree;
+	size_t		written;
+
+	if (*file == NULL)
+	{
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(rustate->ps.state->es_query_cxt);
+		*file = compress ? BufFileCreateCompressTemp(false) :
+			BufFileCreateTemp(false);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+	written = BufFileWrite(*file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to recursive union temporary file: %m")));
+
+	rustate->spill_disk_used += tuple->t_len;
+
+	if (shouldFree)
+		pfree(tuple);
+}
+
+/*
+ * Read the next tuple from a spill file, or NULL at end of file.  The tuple
+ * is palloc'd in the current memory context.
+ */
+static MinimalTuple
+recursive_union_spill_read(BufFile *file)
+{
+	MinimalTuple tuple;
+	uint32		t_len;
+	size_t		nread;
+
+	nread = BufFileRead(file, (void *) &t_len, sizeof(uint32));
+	if (nread == 0)
+		return NULL;
+	if (nread != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from recursive union temporary file: %m")));
+
+	tuple = (MinimalTuple) palloc(t_len);
+	tuple->t_len = t_len;
+	nread = BufFileRead(file, (void *) ((char *) tuple + sizeof(uint32)),
+						t_len - sizeof(uint32));
+	if (nread != t_len - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from recursive union temporary file: %m")));
+
+	return tuple;
+}
+
+/*
+ * Spill the hash table if it has outgrown the memory limit: write all the
+ * tuples in it to the seen files of their partitions, and empty it.
+ *
+ * The number of partitions is chosen so that each of them can be expected to
+ * fit in memory, based on the average size of the tuples seen so far.  As
+ * the partitioning can't be changed later, be generous in estimating how many
+ * more tuples are yet to come.
+ */
+static void
+recursive_union_spill(RecursiveUnionState *rustate)
+{
+	RecursiveUnion *node = (RecursiveUnion *) rustate->ps.plan;
+	TupleHashTable hashtable = rustate->hashtable;
+	TupleTableSlot *slot = rustate->spill_slot;
+	MemoryContext oldcontext;
+	TupleHashIterator hashiter;
+	TupleHashEntry entry;
+	Size		mem_used;
+	double		tuple_size;
+	double		est_groups;
+	double		npartitions;
+	int			partition_bits;
+	int			max_partitions;
+
+	Assert(rustate->spill_npartitions == 0);
+
+	mem_used = MemoryContextMemAllocated(rustate->tableContext, true) +
+		hashtable->hashtab->size * sizeof(TupleHashEntryData);
+	if (mem_used <= rustate->hash_mem_limit)
+		return;
+
+	tuple_size = (double) mem_used / rustate->hash_ngroups;
+	est_groups = Max(node->numGroups, rustate->hash_ngroups * 4);
+	npartitions = 1.5 * est_groups * tuple_size / rustate->hash_mem_limit;
+
+	/* each partition may have two files open, each needing a buffer */
+	max_partitions = (rustate->hash_mem_limit / 8) / BLCKSZ;
+	max_partitions = Min(max_partitions, RECURSIVEUNION_MAX_PARTITIONS);
+	max_partitions = Max(max_partitions, RECURSIVEUNION_MIN_PARTITIONS);
+
+	npartitions = Max(npartitions, RECURSIVEUNION_MIN_PARTITIONS);
+	npartitions = Min(npartitions, max_partitions);
+	partition_bits = my_log2((long) npartitions);
+
+	oldcontext = MemoryContextSwitchTo(rustate->ps.state->es_query_cxt);
+	rustate->spill_npartitions = 1 << partition_bits;
+	rustate->spill_shift = 32 - partition_bits;
+	rustate->spill_seen = palloc0(sizeof(BufFile *) * rustate->spill_npartitions);
+	rustate->spill_pending = palloc0(sizeof(BufFile *) * rustate->spill_npartitions);
+	MemoryContextSwitchTo(oldcontext);
+
+	InitTupleHashIterator(hashtable, &hashiter);
+	while ((entry = ScanTupleHashTable(hashtable, &hashiter)) != NULL)
+	{
+		int			partition;
+
+		ExecStoreMinimalTuple(entry->firstTuple, slot, false);
+		partition = recursive_union_spill_hash(rustate, slot) >>
+			rustate->spill_shift;
+		recursive_union_spill_write(rustate, &rustate->spill_seen[partition],
+									false, slot);
+	}
+	TermTupleHashIterator(&hashiter);
+	ExecClearTuple(slot);
+
+	MemoryContextResetAndDeleteChildren(rustate->tableContext);
+	ResetTupleHashTable(hashtable);
+	rustate->hash_ngroups = 0;
+}
+
+/*
+ * Check whether the tuple in slot has been seen before, adding it to the
+ * hash table if not.  Returns true if the tuple is new.
+ *
+ * Once the table has spilled, the check is deferred instead: the tuple is
+ * appended to the pending file of its partition, to be checked by
+ * recursive_union_next_pending() once the subplan is exhausted, and false is
+ * returned.
+ */
+static bool
+recursive_union_lookup(RecursiveUnionState *rustate, TupleTableSlot *slot)
+{
+	bool		isnew;
+
+	if (rustate->spill_npartitions > 0)
+	{
+		int			partition;
+
+		partition = recursive_union_spill_hash(rustate, slot) >>
+			rustate->spill_shift;
+		recursive_union_spill_write(rustate,
+									&rustate->spill_pending[partition],
+									true, slot);
+		return false;
+	}
+
+	/* Find or build hashtable entry for this tuple's group */
+	LookupTupleHashEntry(rustate->hashtable, slot, &isnew);
+	/* Must reset temp context after each hashtable lookup */
+	MemoryContextReset(rustate->tempContext);
+
+	if (isnew)
+	{
+		rustate->hash_ngroups++;
+		recursive_union_spill(rustate);
+	}
+
+	return isnew;
+}
+
+/*
+ * Start checking the pending tuples of the first partition at or after
+ * "partition" that has any, by loading the tuples already seen in that
+ * partition into the emptied hash table.  Returns false, with spill_current
+ * set to -1, if no partition has pending tuples.
+ */
+static bool
+recursive_union_load_partition(RecursiveUnionState *rustate, int partition)
+{
+	TupleTableSlot *slot = rustate->spill_slot;
+	BufFile    *file;
+	MinimalTuple tuple;
+	bool		isnew;
+
+	while (partition < rustate->spill_npartitions &&
+		   rustate->spill_pending[partition] == NULL)
+		partition++;
+
+	if (partition >= rustate->spill_npartitions)
+	{
+		rustate->spill_current = -1;
+		return false;
+	}
+
+	rustate->spill_current = partition;
+
+	MemoryContextResetAndDeleteChildren(rustate->tableContext);
+	ResetTupleHashTable(rustate->hashtable);
+
+	file = rustate->spill_seen[partition];
+	if (file != NULL)
+	{
+		if (BufFileSeek(file, 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind recursive union temporary file: %m")));
+
+		/*
+		 * Having read the file to its end leaves it positioned there, ready
+		 * for new tuples to be appended.
+		 */
+		while ((tuple = recursive_union_spill_read(file)) != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			ExecStoreMinimalTuple(tuple, slot, true);
+			LookupTupleHashEntry(rustate->hashtable, slot, &isnew);
+			MemoryContextReset(rustate->tempContext);
+		}
+	}
+
+	if (BufFileSeek(rustate->spill_pending[partition], 0, 0L, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind recursive union temporary file: %m")));
+
+	return true;
+}
+
+/*
+ * Return the next pending tuple that has not been seen before, adding it to
+ * the seen tuples of its partition, or NULL once all pending tuples have been
+ * checked.  recursive_union_load_partition() must have been called first.
+ */
+static TupleTableSlot *
+recursive_union_next_pending(RecursiveUnionState *rustate)
+{
+	TupleTableSlot *slot = rustate->spill_slot;
+
+	while (rustate->spill_current >= 0)
+	{
+		int			partition = rustate->spill_current;
+		MinimalTuple tuple;
+		bool		isnew;
+
+		CHECK_FOR_INTERRUPTS();
+
+		tuple = recursive_union_spill_read(rustate->spill_pending[partition]);
+		if (tuple == NULL)
+		{
+			/* done with this partition's pending tuples */
+			BufFileClose(rustate->spill_pending[partition]);
+			rustate->spill_pending[partition] = NULL;
+			recursive_union_load_partition(rustate, partition + 1);
+			continue;
+		}
+
+		ExecStoreMinimalTuple(tuple, slot, true);
+		LookupTupleHashEntry(rustate->hashtable, slot, &isnew);
+		MemoryContextReset(rustate->tempContext);
+		if (!isnew)
+			continue;
+
+		recursive_union_spill_write(rustate, &rustate->spill_seen[partition],
+									false, slot);
+		return slot;
+	}
+
+	ExecClearTuple(slot);
+	return NULL;
+}
+
+/*
+ * Close all spill files, and go back to checking tuples in memory.
+ */
+static void
+recursive_union_reset_spill(RecursiveUnionState *rustate)
+{
+	int			i;
+
+	for (i = 0; i < rustate->spill_npartitions; i++)
+	{
+		if (rustate->spill_seen[i] != NULL)
+			BufFileClose(rustate->spill_seen[i]);
+		if (rustate->spill_pending[i] != NULL)
+			BufFileClose(rustate->spill_pending[i]);
+	}
+	if (rustate->spill_npartitions > 0)
+	{
+		pfree(rustate->spill_seen);
+		pfree(rustate->spill_pending);
+		rustate->spill_seen = NULL;
+		rustate->spill_pending = NULL;
+	}
+
+	rustate->spill_npartitions = 0;
+	rustate->spill_current = -1;
+	rustate->hash_ngroups = 0;
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecRecursiveUnion(node)
@@ -79,7 +467,6 @@ ExecRecursiveUnion(PlanState *pstate)
 	PlanState  *innerPlan = innerPlanState(node);
 	RecursiveUnion *plan = (RecursiveUnion *) node->ps.plan;
 	TupleTableSlot *slot;
-	bool		isnew;
 
 	CHECK_FOR_INTERRUPTS();
 
@@ -88,19 +475,26 @@ ExecRecursiveUnion(PlanState *pstate)
 	{
 		for (;;)
 		{
-			slot = ExecProcNode(outerPlan);
-			if (TupIsNull(slot))
-				break;
-			if (plan->numCols > 0)
+			if (node->spill_current >= 0)
+			{
+				/* Checking tuples whose duplicate check was deferred */
+				slot = recursive_union_next_pending(node);
+			}
+			else
 			{
-				/* Find or build hashtable entry for this tuple's group */
-				LookupTupleHashEntry(node->hashtable, slot, &isnew);
-				/* Must reset temp context after each hashtable lookup */
-				MemoryContextReset(node->tempContext);
-				/* Ignore tuple if already seen */
-				if (!isnew)
+				slot = ExecProcNode(outerPlan);
+				if (!TupIsNull(slot))
+				{
+					/* Ignore tuple if already seen, or deferred */
+					if (plan->numCols > 0 && !recursive_union_lookup(node, slot))
+						continue;
+				}
+				else if (recursive_union_load_partition(node, 0))
 					continue;
 			}
+			if (TupIsNull(slot))
+				break;
+
 			/* Each non-duplicate tuple goes to the working table ... */
 			tuplestore_puttupleslot(node->working_table, slot);
 			/* ... and to the caller */
@@ -112,22 +506,41 @@ ExecRecursiveUnion(PlanState *pstate)
 	/* 2. Execute recursive term */
 	for (;;)
 	{
-		slot = ExecProcNode(innerPlan);
+		if (node->spill_current >= 0)
+		{
+			/* Checking tuples whose duplicate check was deferred */
+			slot = recursive_union_next_pending(node);
+		}
+		else
+		{
+			slot = ExecProcNode(innerPlan);
+			if (!TupIsNull(slot))
+			{
+				/* Ignore tuple if already seen, or deferred */
+				if (plan->numCols > 0 && !recursive_union_lookup(node, slot))
+					continue;
+			}
+			else if (recursive_union_load_partition(node, 0))
+				continue;
+		}
+
 		if (TupIsNull(slot))
 		{
+			Tuplestorestate *old_working_table = node->working_table;
+
 			/* Done if there's nothing in the intermediate table */
 			if (node->intermediate_empty)
 				break;
 
-			/* done with old working table ... */
-			tuplestore_end(node->working_table);
-
-			/* intermediate table becomes working table */
+			/*
+			 * The intermediate table becomes the working table, and the old
+			 * working table is emptied to serve as the next intermediate
+			 * table.  Swapping them keeps the memory the tuplestores have
+			 * already allocated, rather than building new ones each time.
+			 */
 			node->working_table = node->intermediate_table;
-
-			/* create new empty intermediate table */
-			node->intermediate_table = tuplestore_begin_heap(false, false,
-															 work_mem);
+			node->intermediate_table = old_working_table;
+			tuplestore_clear(node->intermediate_table);
 			node->intermediate_empty = true;
 
 			/* reset the recursive term */
@@ -138,17 +551,6 @@ ExecRecursiveUnion(PlanState *pstate)
 			continue;
 		}
 
-		if (plan->numCols > 0)
-		{
-			/* Find or build hashtable entry for this tuple's group */
-			LookupTupleHashEntry(node->hashtable, slot, &isnew);
-			/* Must reset temp context after each hashtable lookup */
-			MemoryContextReset(node->tempContext);
-			/* Ignore tuple if already seen */
-			if (!isnew)
-				continue;
-		}
-
 		/* Else, tuple is good; stash it in intermediate table ... */
 		node->intermediate_empty = false;
 		tuplestore_puttupleslot(node->intermediate_table, slot);
@@ -185,6 +587,15 @@ ExecInitRecursiveUnion(RecursiveUnion *node, EState *estate, int eflags)
 	rustate->hashtable = NULL;
 	rustate->tempContext = NULL;
 	rustate->tableContext = NULL;
+	rustate->hash_mem_limit = work_mem * 1024L;
+	rustate->hash_ngroups = 0;
+	rustate->spill_npartitions = 0;
+	rustate->spill_shift = 0;
+	rustate->spill_seen = NULL;
+	rustate->spill_pending = NULL;
+	rustate->spill_current = -1;
+	rustate->spill_slot = NULL;
+	rustate->spill_disk_used = 0;
 
 	/* initialize processing state */
 	rustate->recursing = false;
@@ -248,7 +659,7 @@ ExecInitRecursiveUnion(RecursiveUnion *node, EState *estate, int eflags)
 
 	/*
 	 * If hashing, precompute fmgr lookup data for inner loop, and create the
-	 * hash table.
+	 * hash table, along with a slot for tuples read back from spill files.
 	 */
 	if (node->numCols > 0)
 	{
@@ -257,6 +668,10 @@ ExecInitRecursiveUnion(RecursiveUnion *node, EState *estate, int eflags)
 							  &rustate->eqfuncoids,
 							  &rustate->hashfunctions);
 		build_hash_table(rustate);
+		rustate->spill_slot =
+			ExecInitExtraTupleSlot(estate,
+								   ExecGetResultType(outerPlanState(rustate)),
+								   &TTSOpsMinimalTuple);
 	}
 
 	return rustate;
@@ -271,9 +686,10 @@ ExecInitRecursiveUnion(RecursiveUnion *node, EState *estate, int eflags)
 void
 ExecEndRecursiveUnion(RecursiveUnionState *node)
 {
-	/* Release tuplestores */
+	/* Release tuplestores and spill files */
 	tuplestore_end(node->working_table);
 	tuplestore_end(node->intermediate_table);
+	recursive_union_reset_spill(node);
 
 	/* free subsidiary stuff including hashtable */
 	if (node->tempContext)
@@ -315,7 +731,8 @@ ExecReScanRecursiveUnion(RecursiveUnionState *node)
 	if (outerPlan->chgParam == NULL)
 		ExecReScan(outerPlan);
 
-	/* Release any hashtable storage */
+	/* Release any hashtable storage and spill files */
+	recursive_union_reset_spill(node);
 	if (node->tableContext)
 		MemoryContextResetAndDeleteChildren(node->tableContext);
 
@@ -0,0 +1,865 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeRepartition.c
+ *	  Routines to split the rows of a subplan among parallel participants.
+ *
+ * A Repartition node runs its whole subplan, which is not parallel-aware,
+ * in every participant of a parallel query, but each participant returns
+ * only the rows whose hash key falls into one of the "slots" it has claimed.
+ * All rows with equal keys land in the same slot, so the nodes above a
+ * Repartition (such as a WindowAgg partitioned by the hash key) see every
+ * row of each key group they see at all, and can run independently in
+ * each participant.
+ *
+ * Slots are claimed one at a time from a counter in shared memory.  After
+ * finishing a slot, the participant rescans the subplan and claims the next
+ * one, until none are left.  That way each slot is processed exactly once
+ * however many workers were actually launched, at the price of one pass
+ * over the subplan per slot; the planner uses as many slots as it expects
+ * participants.
+ *
+ * Outside of a parallel query there is just one participant, which returns
+ * all the rows in a single pass.
+ *
+ * In exchange mode, the subplan is partial: each worker gets its own share
+ * of the rows from it.  A worker returns the rows whose hash key belongs to
+ * it, and sends the others to their owners through a shared memory queue
+ * for each (sender, receiver) pair; once its share is exhausted, it returns
+ * the rows the other workers sent it until they have all finished.  Every
+ * row is produced only once.  The participants are the workers actually
+ * launched, which the leader announces in shared memory after launching
+ * them; the leader itself doesn't take part, since it must stay free to
+ * drain the Gather above, except when no workers could be launched at all,
+ * in which case it returns all the rows itself.
+ *
+ * A worker must never block on a full queue while others are blocked on
+ * it, or they would wait for each other forever.  So we send without
+ * waiting, and while a queue is full we keep reading our own incoming
+ * queues, saving the rows in a tuplestore to be returned later.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeRepartition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecRepartition			- return the rows of the claimed slots
+ *		ExecRepartitionExchange - return the rows belonging to us
+ *		ExecInitRepartition		- initialize node and subnodes
+ *		ExecEndRepartition		- shutdown node and subnodes
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "executor/executor.h"
+#include "executor/nodeRepartition.h"
+#include "executor/tqueue.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/condition_variable.h"
+#include "storage/shm_mq.h"
+#include "utils/hashutils.h"
+#include "utils/lsyscache.h"
+
+/* Size of each queue between two workers in exchange mode */
+#define REPARTITION_QUEUE_SIZE		16384
+
+/* nparticipants value until the leader has launched the workers */
+#define REPARTITION_NOT_LAUNCHED	PG_UINT32_MAX
+
+/*
+ * Shared state for a parallel Repartition
+ *
+ * In exchange mode, it is followed by a queue for each (sender, receiver)
+ * pair of planned workers; see REPARTITION_QUEUE.
+ */
+struct ParallelRepartitionState
+{
+	pg_atomic_uint32 next_slot; /* next slot to be claimed */
+	int			nworkers;		/* number of planned workers */
+	pg_atomic_uint32 nparticipants; /* number of workers launched */
+	ConditionVariable launched_cv;	/* signaled when that's known */
+};
+
+#define REPARTITION_QUEUE(pstate, sender, receiver) \
+	((shm_mq *) ((char *) (pstate) + \
+				 MAXALIGN(sizeof(ParallelRepartitionState)) + \
+				 ((sender) * (pstate)->nworkers + (receiver)) * \
+				 (Size) REPARTITION_QUEUE_SIZE))
+
+static bool repartition_next_slot(RepartitionState *node);
+static uint32 repartition_hash(RepartitionState *node, TupleTableSlot *slot);
+static void exchange_start(RepartitionState *node);
+static bool exchange_send_pending(RepartitionState *node);
+static bool exchange_absorb(RepartitionState *node);
+static TupleTableSlot *exchange_receive(RepartitionState *node, bool nowait);
+static void exchange_remove_reader(RepartitionState *node, int reader);
+static void exchange_detach(RepartitionState *node);
+static Size repartition_shared_size(Repartition *plan, int nworkers);
+static void repartition_init_shared(RepartitionState *node,
+									ParallelRepartitionState *pstate);
+
+
+/* ----------------------------------------------------------------
+ *		ExecRepartition
+ *
+ *		Return the next row of the subplan that belongs to the slot we are
+ *		working on, moving on to the next unclaimed slot when the subplan
+ *		is exhausted.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecRepartition(PlanState *pstate)
+{
+	RepartitionState *node = castNode(RepartitionState, pstate);
+	Repartition *plan = (Repartition *) node->ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *slot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (;;)
+	{
+		if (node->cur_slot < 0 && !repartition_next_slot(node))
+			return NULL;
+
+		slot = ExecProcNode(outerNode);
+		if (TupIsNull(slot))
+		{
+			/* done with this slot */
+			node->cur_slot = -1;
+			node->need_rescan = true;
+			continue;
+		}
+
+		/* if we're all alone, every row is ours */
+		if (node->pstate == NULL)
+			return slot;
+
+		if (repartition_hash(node, slot) % plan->nslots == node->cur_slot)
+			return slot;
+
+		InstrCountFiltered1(node, 1);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionExchange
+ *
+ *		Return the next row belonging to this participant, taking it from
+ *		our share of the subplan's rows or from the other participants.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecRepartitionExchange(PlanState *pstate)
+{
+	RepartitionState *node = castNode(RepartitionState, pstate);
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *slot;
+
+	if (!node->exchange_started)
+		exchange_start(node);
+
+	/* The leader has nothing to do if there are workers */
+	if (node->participant < 0)
+		return NULL;
+
+	for (;;)
+	{
+		HeapTuple	tuple;
+		bool		should_free;
+		shm_mq_result result;
+		int			dest;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* First return the rows we took in while waiting for a queue */
+		if (node->buffer != NULL)
+		{
+			if (tuplestore_gettupleslot(node->buffer, true, false,
+										node->buffer_slot))
+				return node->buffer_slot;
+			tuplestore_clear(node->buffer);
+		}
+
+		/* Then finish sending the row that didn't fit, if any */
+		if (node->pending_tuple != NULL && !exchange_send_pending(node))
+		{
+			/* Still no room; take in what others sent us, or wait */
+			if (!exchange_absorb(node))
+			{
+				(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
+								 0, WAIT_EVENT_REPARTITION_EXCHANGE);
+				ResetLatch(MyLatch);
+			}
+			continue;
+		}
+
+		if (node->child_done)
+		{
+			/* Our share is done; wait for the rest of our rows */
+			return exchange_receive(node, false);
+		}
+
+		/* Return a row another participant sent us, if one is ready */
+		if (node->nreaders > 0)
+		{
+			slot = exchange_receive(node, true);
+			if (slot != NULL)
+				return slot;
+		}
+
+		slot = ExecProcNode(outerNode);
+		if (TupIsNull(slot))
+		{
+			/* Tell the others we won't send them any more */
+			node->child_done = true;
+			exchange_detach(node);
+			continue;
+		}
+
+		if (node->nparticipants == 1)
+			return slot;
+		dest = repartition_hash(node, slot) % node->nparticipants;
+		if (dest == node->participant)
+			return slot;
+
+		/*
+		 * Send the row to its owner.  If the queue is full, we must retry
+		 * with the same data later, so keep a copy.  If the owner has gone
+		 * away, it doesn't want any more rows.
+		 */
+		if (node->outqueues[dest] == NULL)
+			continue;
+		tuple = ExecFetchSlotHeapTuple(slot, true, &should_free);
+		result = shm_mq_send(node->outqueues[dest], tuple->t_len,
+							 tuple->t_data, true, false);
+		if (result == SHM_MQ_WOULD_BLOCK)
+		{
+			node->pending_tuple = should_free ? tuple : heap_copytuple(tuple);
+			node->pending_dest = dest;
+			continue;
+		}
+		if (should_free)
+			heap_freetuple(tuple);
+		if (result == SHM_MQ_DETACHED)
+		{
+			shm_mq_detach(node->outqueues[dest]);
+			node->outqueues[dest] = NULL;
+		}
+		else if (result != SHM_MQ_SUCCESS)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not send tuple to shared-memory queue")));
+	}
+}
+
+/*
+ * exchange_start
+ *
+ * Find out which participant we are, and attach to our queues.  Workers
+ * wait until the leader has announced how many of them were launched.
+ */
+static void
+exchange_start(RepartitionState *node)
+{
+	ParallelRepartitionState *pstate = node->pstate;
+	uint32		nlaunched;
+	int			i;
+
+	node->exchange_started = true;
+
+	/* Not in a parallel query: we have all the rows */
+	if (pstate == NULL)
+	{
+		node->participant = 0;
+		node->nparticipants = 1;
+		return;
+	}
+
+	if (!IsParallelWorker())
+	{
+		/* Gather has announced it before running the plan locally */
+		nlaunched = pg_atomic_read_u32(&pstate->nparticipants);
+		Assert(nlaunched != REPARTITION_NOT_LAUNCHED);
+		node->participant = (nlaunched == 0) ? 0 : -1;
+		node->nparticipants = 1;
+		return;
+	}
+
+	for (;;)
+	{
+		nlaunched = pg_atomic_read_u32(&pstate->nparticipants);
+		if (nlaunched != REPARTITION_NOT_LAUNCHED)
+			break;
+		ConditionVariableSleep(&pstate->launched_cv,
+							   WAIT_EVENT_REPARTITION_LAUNCH);
+	}
+	ConditionVariableCancelSleep();
+
+	Assert(ParallelWorkerNumber < (int) nlaunched);
+	node->participant = ParallelWorkerNumber;
+	node->nparticipants = (int) nlaunched;
+
+	node->outqueues = (shm_mq_handle **)
+		palloc0(node->nparticipants * sizeof(shm_mq_handle *));
+	node->inqueues = (shm_mq_handle **)
+		palloc(node->nparticipants * sizeof(shm_mq_handle *));
+	node->readers = (TupleQueueReader **)
+		palloc(node->nparticipants * sizeof(TupleQueueReader *));
+	node->nreaders = 0;
+	node->nextreader = 0;
+
+	for (i = 0; i < node->nparticipants; i++)
+	{
+		shm_mq	   *mq;
+
+		if (i == node->participant)
+			continue;
+
+		mq = REPARTITION_QUEUE(pstate, node->participant, i);
+		shm_mq_set_sender(mq, MyProc);
+		node->outqueues[i] = shm_mq_attach(mq, node->seg, NULL);
+
+		mq = REPARTITION_QUEUE(pstate, i, node->participant);
+		shm_mq_set_receiver(mq, MyProc);
+		node->inqueues[node->nreaders] = shm_mq_attach(mq, node->seg, NULL);
+		node->readers[node->nreaders] =
+			CreateTupleQueueReader(node->inqueues[node->nreaders]);
+		node->nreaders++;
+	}
+}
+
+/*
+ * exchange_send_pending
+ *
+ * Try again to send the row that didn't fit into its queue.  Returns false
+ * if there's still no room.
+ */
+static bool
+exchange_send_pending(RepartitionState *node)
+{
+	shm_mq_handle *mqh = node->outqueues[node->pending_dest];
+	shm_mq_result result;
+
+	if (mqh != NULL)
+	{
+		result = shm_mq_send(mqh, node->pending_tuple->t_len,
+							 node->pending_tuple->t_data, true, false);
+		if (result == SHM_MQ_WOULD_BLOCK)
+			return false;
+		if (result == SHM_MQ_DETACHED)
+		{
+			shm_mq_detach(mqh);
+			node->outqueues[node->pending_dest] = NULL;
+		}
+		else if (result != SHM_MQ_SUCCESS)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not send tuple to shared-memory queue")));
+	}
+
+	heap_freetuple(node->pending_tuple);
+	node->pending_tuple = NULL;
+	return true;
+}
+
+/*
+ * exchange_absorb
+ *
+ * Move all the rows that are ready in our incoming queues into our buffer,
+ * so that whoever is waiting to send to us can go on.  Returns true if we
+ * got any.
+ */
+static bool
+exchange_absorb(RepartitionState *node)
+{
+	bool		found = false;
+	int			i = 0;
+
+	while (i < node->nreaders)
+	{
+		HeapTuple	tup;
+		bool		readerdone;
+
+		tup = TupleQueueReaderNext(node->readers[i], true, &readerdone);
+		if (readerdone)
+		{
+			exchange_remove_reader(node, i);
+			continue;
+		}
+		if (tup == NULL)
+		{
+			i++;
+			continue;
+		}
+
+		if (node->buffer == NULL)
+		{
+			MemoryContext oldcontext;
+
+			oldcontext = MemoryContextSwitchTo(node->ps.state->es_query_cxt);
+			node->buffer = tuplestore_begin_heap(false, false, work_mem);
+			MemoryContextSwitchTo(oldcontext);
+		}
+		tuplestore_puttuple(node->buffer, tup);
+		heap_freetuple(tup);
+		found = true;
+	}
+
+	return found;
+}
+
+/*
+ * exchange_receive
+ *
+ * Return a row from one of our incoming queues.  Returns NULL if all the
+ * other participants are done, or if nowait is true and no row is ready.
+ */
+static TupleTableSlot *
+exchange_receive(RepartitionState *node, bool nowait)
+{
+	int			nvisited = 0;
+
+	for (;;)
+	{
+		HeapTuple	tup;
+		bool		readerdone;
+
+		if (node->nreaders == 0)
+			return NULL;
+
+		tup = TupleQueueReaderNext(node->readers[node->nextreader], true,
+								   &readerdone);
+		if (readerdone)
+		{
+			exchange_remove_reader(node, node->nextreader);
+			continue;
+		}
+		if (tup != NULL)
+			return ExecStoreHeapTuple(tup, node->recv_slot, true);
+
+		/* Nothing there; try the next queue */
+		if (++node->nextreader >= node->nreaders)
+			node->nextreader = 0;
+		if (++nvisited < node->nreaders)
+			continue;
+
+		/* Nothing ready anywhere */
+		if (nowait)
+			return NULL;
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+						 WAIT_EVENT_REPARTITION_EXCHANGE);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+		nvisited = 0;
+	}
+}
+
+/*
+ * exchange_remove_reader
+ *
+ * Forget an incoming queue whose sender has finished.
+ */
+static void
+exchange_remove_reader(RepartitionState *node, int reader)
+{
+	DestroyTupleQueueReader(node->readers[reader]);
+	shm_mq_detach(node->inqueues[reader]);
+
+	node->nreaders--;
+	memmove(&node->readers[reader], &node->readers[reader + 1],
+			(node->nreaders - reader) * sizeof(TupleQueueReader *));
+	memmove(&node->inqueues[reader], &node->inqueues[reader + 1],
+			(node->nreaders - reader) * sizeof(shm_mq_handle *));
+	if (node->nextreader >= node->nreaders)
+		node->nextreader = 0;
+}
+
+/*
+ * exchange_detach
+ *
+ * Detach from our outgoing queues, which tells their receivers that we
+ * are done sending.
+ */
+static void
+exchange_detach(RepartitionState *node)
+{
+	int			i;
+
+	if (node->outqueues == NULL)
+		return;
+
+	for (i = 0; i < node->nparticipants; i++)
+	{
+		if (node->outqueues[i] != NULL)
+		{
+			shm_mq_detach(node->outqueues[i]);
+			node->outqueues[i] = NULL;
+		}
+	}
+}
+
+/*
+ * repartition_next_slot
+ *
+ * Claim the next slot to process, rescanning the subplan if we have already
+ * been through it.  Returns false if there are no more slots.
+ */
+static bool
+repartition_next_slot(RepartitionState *node)
+{
+	Repartition *plan = (Repartition *) node->ps.plan;
+	uint32		claimed;
+
+	if (node->finished)
+		return false;
+
+	if (node->pstate == NULL)
+	{
+		/* a single pass does it */
+		if (node->need_rescan)
+		{
+			node->finished = true;
+			return false;
+		}
+		claimed = 0;
+	}
+	else
+	{
+		claimed = pg_atomic_fetch_add_u32(&node->pstate->next_slot, 1);
+		if (claimed >= plan->nslots)
+		{
+			node->finished = true;
+			return false;
+		}
+	}
+
+	if (node->need_rescan)
+	{
+		ExecReScan(outerPlanState(node));
+		node->need_rescan = false;
+	}
+
+	node->cur_slot = (int) claimed;
+	return true;
+}
+
+/*
+ * repartition_hash
+ *
+ * Compute the hash value of a row's key columns, combining the columns in
+ * the same way as ExecHashGetHashValue does.
+ */
+static uint32
+repartition_hash(RepartitionState *node, TupleTableSlot *slot)
+{
+	Repartition *plan = (Repartition *) node->ps.plan;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	int			i;
+
+	/* hash functions might leak memory, so reset per tuple */
+	ResetExprContext(econtext);
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < plan->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, plan->hashColIdx[i], &isNull);
+
+		/* treat nulls as having hash key 0 */
+		if (!isNull)
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&node->hashfunctions[i],
+													plan->hashCollations[i],
+													attr));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	/* mix the bits, since we only look at the low ones */
+	return murmurhash32(hashkey);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitRepartition
+ * ----------------------------------------------------------------
+ */
+RepartitionState *
+ExecInitRepartition(Repartition *node, EState *estate, int eflags)
+{
+	RepartitionState *rpstate;
+	int			i;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	rpstate = makeNode(RepartitionState);
+	rpstate->ps.plan = (Plan *) node;
+	rpstate->ps.state = estate;
+	if (node->exchange)
+		rpstate->ps.ExecProcNode = ExecRepartitionExchange;
+	else
+		rpstate->ps.ExecProcNode = ExecRepartition;
+
+	rpstate->cur_slot = -1;
+	rpstate->need_rescan = false;
+	rpstate->finished = false;
+	rpstate->pstate = NULL;
+	rpstate->participant = -1;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We don't evaluate expressions, but need a per-tuple memory context to
+	 * call the hash functions in.
+	 */
+	ExecAssignExprContext(estate, &rpstate->ps);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * The subplan is run again for each slot we claim, except in exchange
+	 * mode.
+	 */
+	if (!node->exchange)
+		eflags |= EXEC_FLAG_REWIND;
+	outerPlanState(rpstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize result type.  We return the subplan's slots, and don't
+	 * project.  In exchange mode, we also return rows received from other
+	 * participants, in slots of our own.
+	 */
+	ExecInitResultTypeTL(&rpstate->ps);
+	rpstate->ps.resultopsset = true;
+	rpstate->ps.resultops = ExecGetResultSlotOps(outerPlanState(rpstate),
+												 &rpstate->ps.resultopsfixed);
+	rpstate->ps.ps_ProjInfo = NULL;
+	if (node->exchange)
+	{
+		rpstate->ps.resultopsfixed = false;
+		rpstate->recv_slot =
+			ExecInitExtraTupleSlot(estate,
+								   ExecGetResultType(outerPlanState(rpstate)),
+								   &TTSOpsHeapTuple);
+		rpstate->buffer_slot =
+			ExecInitExtraTupleSlot(estate,
+								   ExecGetResultType(outerPlanState(rpstate)),
+								   &TTSOpsMinimalTuple);
+	}
+
+	/*
+	 * Look up the hash functions of the key columns.
+	 */
+	rpstate->hashfunctions = (FmgrInfo *) palloc(node->numCols * sizeof(FmgrInfo));
+	for (i = 0; i < node->numCols; i++)
+	{
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		if (!get_op_hash_functions(node->hashOperators[i],
+								   &left_hashfn, &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 node->hashOperators[i]);
+		fmgr_info(left_hashfn, &rpstate->hashfunctions[i]);
+	}
+
+	return rpstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndRepartition
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndRepartition(RepartitionState *node)
+{
+	/* let the other participants know we won't send or read any more */
+	exchange_detach(node);
+	while (node->nreaders > 0)
+		exchange_remove_reader(node, 0);
+	if (node->buffer != NULL)
+		tuplestore_end(node->buffer);
+
+	ExecFreeExprContext(&node->ps);
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanRepartition
+ *
+ *		In a parallel query, the slot counter is reset separately by
+ *		ExecRepartitionReInitializeDSM.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanRepartition(RepartitionState *node)
+{
+	/*
+	 * A worker can't rescan an exchange, since it can't take back what it
+	 * sent; the planner never asks it to.  The leader only ever runs it
+	 * alone or not at all.
+	 */
+	if (node->exchange_started && node->nparticipants > 1)
+		elog(ERROR, "cannot rescan an exchange between parallel workers");
+	node->exchange_started = false;
+	node->participant = -1;
+	node->child_done = false;
+	if (node->buffer != NULL)
+		tuplestore_clear(node->buffer);
+
+	node->cur_slot = -1;
+	node->need_rescan = false;
+	node->finished = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (node->ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ps.lefttree);
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Repartition Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionEstimate
+ *
+ *		Estimate space required to propagate the slot counter, and for
+ *		the queues in exchange mode.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionEstimate(RepartitionState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   repartition_shared_size((Repartition *) node->ps.plan,
+												   pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/*
+ * In exchange mode, we allocate a queue for every ordered pair of planned
+ * workers, including the useless ones from a worker to itself, to keep the
+ * addressing simple.
+ */
+static Size
+repartition_shared_size(Repartition *plan, int nworkers)
+{
+	Size		size = MAXALIGN(sizeof(ParallelRepartitionState));
+
+	if (plan->exchange)
+		size = add_size(size,
+						mul_size(mul_size(nworkers, nworkers),
+								 REPARTITION_QUEUE_SIZE));
+	return size;
+}
+
+/*
+ * Create the queues between the workers afresh.
+ */
+static void
+repartition_init_shared(RepartitionState *node, ParallelRepartitionState *pstate)
+{
+	int			i;
+
+	pg_atomic_write_u32(&pstate->next_slot, 0);
+	pg_atomic_write_u32(&pstate->nparticipants, REPARTITION_NOT_LAUNCHED);
+
+	if (!((Repartition *) node->ps.plan)->exchange)
+		return;
+
+	for (i = 0; i < pstate->nworkers * pstate->nworkers; i++)
+		(void) shm_mq_create(REPARTITION_QUEUE(pstate, i / pstate->nworkers,
+											   i % pstate->nworkers),
+							 REPARTITION_QUEUE_SIZE);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionInitializeDSM
+ *
+ *		Set up the shared slot counter.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionInitializeDSM(RepartitionState *node, ParallelContext *pcxt)
+{
+	ParallelRepartitionState *pstate;
+
+	pstate = shm_toc_allocate(pcxt->toc,
+							  repartition_shared_size((Repartition *) node->ps.plan,
+													  pcxt->nworkers));
+	pg_atomic_init_u32(&pstate->next_slot, 0);
+	pstate->nworkers = pcxt->nworkers;
+	pg_atomic_init_u32(&pstate->nparticipants, REPARTITION_NOT_LAUNCHED);
+	ConditionVariableInit(&pstate->launched_cv);
+	repartition_init_shared(node, pstate);
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, pstate);
+
+	node->pstate = pstate;
+	node->seg = pcxt->seg;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionReInitializeDSM
+ *
+ *		Reset the shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionReInitializeDSM(RepartitionState *node, ParallelContext *pcxt)
+{
+	repartition_init_shared(node, node->pstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionWorkersLaunched
+ *
+ *		Tell the workers how many of them there are.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionWorkersLaunched(RepartitionState *node, ParallelContext *pcxt)
+{
+	pg_atomic_write_u32(&node->pstate->nparticipants, pcxt->nworkers_launched);
+	ConditionVariableBroadcast(&node->pstate->launched_cv);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionInitializeWorker
+ *
+ *		Find the slot counter in the TOC.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionInitializeWorker(RepartitionState *node,
+								ParallelWorkerContext *pwcxt)
+{
+	node->pstate = shm_toc_lookup(pwcxt->toc, node->ps.plan->plan_node_id,
+								  false);
+	node->seg = pwcxt->seg;
+}
@@ -16,6 +16,7 @@
  * INTERFACE ROUTINES
  *		ExecSeqScan				sequentially scans a relation.
  *		ExecSeqNext				retrieve next tuple in sequential order.
+ *		ExecSeqScanBatch		retrieve next batch of qualifying tuples.
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
@@ -27,13 +28,22 @@
  */
 #include "postgres.h"
 
+#include "access/nbtree.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
 #include "executor/execdebug.h"
+#include "executor/nodeHashjoin.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/typcache.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static int	ExecSeqScanBatch(PlanState *pstate, TupleTableSlot ***slots);
+static void SeqScanBuildHints(SeqScanState *node);
+static void SeqScanBeginScan(SeqScanState *node, ParallelTableScanDesc pscan);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -68,10 +78,8 @@ SeqNext(SeqScanState *node)
 		 * We reach here if the scan is not parallel, or if we're serially
 		 * executing a scan that was planned to be parallel.
 		 */
-		scandesc = table_beginscan(node->ss.ss_currentRelation,
-								   estate->es_snapshot,
-								   0, NULL);
-		node->ss.ss_currentScanDesc = scandesc;
+		SeqScanBeginScan(node, NULL);
+		scandesc = node->ss.ss_currentScanDesc;
 	}
 
 	/*
@@ -102,16 +110,246 @@ SeqRecheck(SeqScanState *node, TupleTableSlot *slot)
  *		tuple.
  *		We call the ExecScan() routine and pass it the appropriate
  *		access method functions.
+ *
+ *		If we're the outer side of a hash join, tuples that its Bloom
+ *		filter shows can't have a join partner are skipped here, saving
+ *		the join the trouble of probing the hash table for them.
  * ----------------------------------------------------------------
  */
 static TupleTableSlot *
 ExecSeqScan(PlanState *pstate)
 {
 	SeqScanState *node = castNode(SeqScanState, pstate);
+	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		slot = ExecScan(&node->ss,
+						(ExecScanAccessMtd) SeqNext,
+						(ExecScanRecheckMtd) SeqRecheck);
+
+		if (node->bloom_source == NULL || TupIsNull(slot) ||
+			ExecHashJoinBloomFilter(node->bloom_source,
+									node->ss.ps.ps_ExprContext, slot))
+			return slot;
+
+		InstrCountFiltered2(node, 1);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Batched variant of ExecSeqScan: fetches up to batch_size
+ *		tuples from the table AM at once, evaluates the qual on each of
+ *		them and returns the qualifying ones at the front of the node's
+ *		batch slot array.
+ *
+ *		This is only used when the node has no projection to do and
+ *		isn't part of an EvalPlanQual recheck, so that the scan tuples
+ *		can be handed to the parent as is.
+ * ----------------------------------------------------------------
+ */
+static int
+ExecSeqScanBatch(PlanState *pstate, TupleTableSlot ***slots)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+	EState	   *estate = node->ss.ps.state;
+	ExprState  *qual = node->ss.ps.qual;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TableScanDesc scandesc;
+	TupleTableSlot **batch;
+	int			ntuples;
+	int			nvalid;
+
+	Assert(node->ss.ps.ps_ProjInfo == NULL);
+	Assert(estate->es_epq_active == NULL);
+
+	*slots = NULL;
+	if (node->batch_done)
+		return 0;
+
+	if (node->batch_slots == NULL)
+	{
+		Relation	rel = node->ss.ss_currentRelation;
+		MemoryContext oldcontext;
+		int			i;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		node->batch_slots = (TupleTableSlot **)
+			palloc(sizeof(TupleTableSlot *) * node->batch_size);
+		for (i = 0; i < node->batch_size; i++)
+			node->batch_slots[i] =
+				ExecAllocTableSlot(&estate->es_tupleTable,
+								   RelationGetDescr(rel),
+								   table_slot_callbacks(rel));
+		MemoryContextSwitchTo(oldcontext);
+	}
+	batch = node->batch_slots;
+
+	/* as in SeqNext, start a non-parallel scan on first use */
+	scandesc = node->ss.ss_currentScanDesc;
+	if (scandesc == NULL)
+	{
+		SeqScanBeginScan(node, NULL);
+		scandesc = node->ss.ss_currentScanDesc;
+	}
+
+	do
+	{
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		ntuples = table_scan_getnextslots(scandesc, estate->es_direction,
+										  batch, node->batch_size);
+
+		/*
+		 * A short batch means the scan is exhausted; remember that, as
+		 * asking the AM for more would restart the scan.
+		 */
+		if (ntuples < node->batch_size)
+			node->batch_done = true;
 
-	return ExecScan(&node->ss,
-					(ExecScanAccessMtd) SeqNext,
-					(ExecScanRecheckMtd) SeqRecheck);
+		if (qual == NULL)
+			return ntuples;
+
+		/*
+		 * Check the qual for each tuple, moving the qualifying ones to the
+		 * front of the array.  We swap rather than overwrite slot pointers,
+		 * so the array keeps owning every slot.
+		 */
+		nvalid = 0;
+		for (i = 0; i < ntuples; i++)
+		{
+			TupleTableSlot *slot = batch[i];
+
+			ResetExprContext(econtext);
+			econtext->ecxt_scantuple = slot;
+
+			if (ExecQual(qual, econtext))
+			{
+				if (i != nvalid)
+				{
+					batch[i] = batch[nvalid];
+					batch[nvalid] = slot;
+				}
+				nvalid++;
+			}
+			else
+				InstrCountFiltered1(node, 1);
+		}
+	} while (nvalid == 0 && !node->batch_done);
+
+	*slots = batch;
+	return nvalid;
+}
+
+/*
+ * SeqScanBuildHints -- work out what to tell the table AM about the scan
+ *
+ * The columns needed are those referenced by the targetlist and the qual.
+ * Qual clauses of the form "column op constant", op being a btree operator
+ * of the column type's default opclass, are passed as keys too; the AM may
+ * use them to skip data, but we evaluate the whole qual regardless.
+ */
+static void
+SeqScanBuildHints(SeqScanState *node)
+{
+	SeqScan    *plan = (SeqScan *) node->ss.ps.plan;
+	Index		scanrelid = plan->scanrelid;
+	TupleDesc	tupdesc = RelationGetDescr(node->ss.ss_currentRelation);
+	ListCell   *lc;
+
+	pull_varattnos((Node *) plan->plan.targetlist, scanrelid,
+				   &node->hint_attrs);
+	pull_varattnos((Node *) plan->plan.qual, scanrelid, &node->hint_attrs);
+
+	node->hint_nkeys = 0;
+	node->hint_keys = (ScanKey)
+		palloc(sizeof(ScanKeyData) * Max(list_length(plan->plan.qual), 1));
+
+	foreach(lc, plan->plan.qual)
+	{
+		OpExpr	   *op = (OpExpr *) lfirst(lc);
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+		Form_pg_attribute attr;
+		TypeCacheEntry *typentry;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+		leftop = linitial(op->args);
+		rightop = lsecond(op->args);
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+		}
+		else if (IsA(leftop, Const) && IsA(rightop, Var))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+		}
+		else
+			continue;
+
+		if (var->varno != scanrelid || var->varlevelsup != 0 ||
+			var->varattno <= 0 || con->constisnull)
+			continue;
+
+		attr = TupleDescAttr(tupdesc, var->varattno - 1);
+		typentry = lookup_type_cache(attr->atttypid,
+									 TYPECACHE_BTREE_OPFAMILY |
+									 TYPECACHE_CMP_PROC);
+		if (!OidIsValid(typentry->btree_opf) ||
+			!OidIsValid(typentry->cmp_proc) ||
+			!op_in_opfamily(op->opno, typentry->btree_opf))
+			continue;
+		get_op_opfamily_properties(op->opno, typentry->btree_opf, false,
+								   &strategy, &lefttype, &righttype);
+		if (lefttype != attr->atttypid || righttype != attr->atttypid ||
+			op->inputcollid != attr->attcollation)
+			continue;
+		if ((Node *) var == rightop)
+			strategy = BTCommuteStrategyNumber(strategy);
+
+		ScanKeyEntryInitialize(&node->hint_keys[node->hint_nkeys++],
+							   0,
+							   var->varattno,
+							   strategy,
+							   InvalidOid,
+							   attr->attcollation,
+							   typentry->cmp_proc,
+							   con->constvalue);
+	}
+}
+
+/*
+ * SeqScanBeginScan -- start the table scan, serial or parallel
+ */
+static void
+SeqScanBeginScan(SeqScanState *node, ParallelTableScanDesc pscan)
+{
+	Relation	rel = node->ss.ss_currentRelation;
+	TableScanDesc scandesc;
+
+	if (pscan != NULL)
+		scandesc = table_beginscan_parallel(rel, pscan);
+	else
+		scandesc = table_beginscan(rel, node->ss.ps.state->es_snapshot,
+								   0, NULL);
+
+	if (node->use_hints)
+		table_scan_set_hints(scandesc, node->hint_attrs,
+							 node->hint_nkeys, node->hint_keys);
+
+	node->ss.ss_currentScanDesc = scandesc;
 }
 
 
@@ -171,6 +409,27 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
 
+	/*
+	 * Offer batched retrieval to the parent node if enabled.  We can only do
+	 * that if the scan tuples can be returned as is, and the table AM knows
+	 * how to fill several slots at once.
+	 */
+	if (executor_batch_size > 0 &&
+		scanstate->ss.ps.ps_ProjInfo == NULL &&
+		estate->es_epq_active == NULL &&
+		scanstate->ss.ss_currentRelation->rd_tableam->scan_getnextslots != NULL)
+	{
+		scanstate->batch_size = executor_batch_size;
+		scanstate->ss.ps.ExecProcNodeBatch = ExecSeqScanBatch;
+	}
+
+	/* If the table AM wants to know what we're going to use, work it out */
+	if (scanstate->ss.ss_currentRelation->rd_tableam->scan_set_hints != NULL)
+	{
+		SeqScanBuildHints(scanstate);
+		scanstate->use_hints = true;
+	}
+
 	return scanstate;
 }
 
@@ -201,6 +460,13 @@ ExecEndSeqScan(SeqScanState *node)
 	if (node->ss.ps.ps_ResultTupleSlot)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	if (node->batch_slots != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < node->batch_size; i++)
+			ExecClearTuple(node->batch_slots[i]);
+	}
 
 	/*
 	 * close heap scan
@@ -231,6 +497,8 @@ ExecReScanSeqScan(SeqScanState *node)
 		table_rescan(scan,		/* scan desc */
 					 NULL);		/* new scan keys */
 
+	node->batch_done = false;
+
 	ExecScanReScan((ScanState *) node);
 }
 
@@ -276,8 +544,7 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 								  pscan,
 								  estate->es_snapshot);
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
-	node->ss.ss_currentScanDesc =
-		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqScanBeginScan(node, pscan);
 }
 
 /* ----------------------------------------------------------------
@@ -294,6 +561,7 @@ ExecSeqScanReInitializeDSM(SeqScanState *node,
 
 	pscan = node->ss.ss_currentScanDesc->rs_parallel;
 	table_parallelscan_reinitialize(node->ss.ss_currentRelation, pscan);
+	node->batch_done = false;
 }
 
 /* ----------------------------------------------------------------
@@ -309,6 +577,5 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	ParallelTableScanDesc pscan;
 
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
-	node->ss.ss_currentScanDesc =
-		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqScanBeginScan(node, pscan);
 }
@@ -153,6 +153,21 @@ typedef struct WindowStatePerAggData
 
 	int64		transValueCount;	/* number of currently-aggregated rows */
 
+	/*
+	 * For a min/max-like aggregate (one with a sort operator) in a frame
+	 * whose head moves, we keep a queue of candidate input values instead of
+	 * a transition value: the positions and values of the rows in the frame
+	 * that are not beaten by a later row, best first.  The queue lives in
+	 * aggcontext, which is private in this case.
+	 */
+	bool		use_extremum;	/* use the queue? */
+	FmgrInfo	sortopfn;		/* the aggregate's sort operator */
+	int64	   *queuePos;		/* row positions of queued values */
+	Datum	   *queueValues;	/* queued values */
+	int			queueHead;		/* index of the best queued value */
+	int			queueTail;		/* index after the last queued value */
+	int			queueSize;		/* allocated length of the arrays */
+
 	/* Data local to eval_windowaggregates() */
 	bool		restart;		/* need to restart this agg in this cycle? */
 } WindowStatePerAggData;
@@ -160,6 +175,9 @@ typedef struct WindowStatePerAggData
 static void initialize_windowaggregate(WindowAggState *winstate,
 									   WindowStatePerFunc perfuncstate,
 									   WindowStatePerAgg peraggstate);
+static void advance_extremum(WindowAggState *winstate,
+							 WindowStatePerFunc perfuncstate,
+							 WindowStatePerAgg peraggstate);
 static void advance_windowaggregate(WindowAggState *winstate,
 									WindowStatePerFunc perfuncstate,
 									WindowStatePerAgg peraggstate);
@@ -230,6 +248,121 @@ initialize_windowaggregate(WindowAggState *winstate,
 	peraggstate->transValueCount = 0;
 	peraggstate->resultValue = (Datum) 0;
 	peraggstate->resultValueIsNull = true;
+
+	/* the queue went away with the private aggcontext */
+	peraggstate->queuePos = NULL;
+	peraggstate->queueValues = NULL;
+	peraggstate->queueHead = 0;
+	peraggstate->queueTail = 0;
+	peraggstate->queueSize = 0;
+}
+
+/*
+ * advance_extremum
+ * add the current row to a min/max-like aggregate's queue of candidates
+ *
+ * This stands in for advance_windowaggregate when peraggstate->use_extremum
+ * is set.  Every queued value that doesn't sort strictly before the new one
+ * can never be the result again, since the new row stays in the frame at
+ * least as long as they do, so we drop those before appending the new value.
+ * The queue therefore stays sorted by the aggregate's sort operator, and
+ * each row is added and removed at most once.
+ */
+static void
+advance_extremum(WindowAggState *winstate,
+				 WindowStatePerFunc perfuncstate,
+				 WindowStatePerAgg peraggstate)
+{
+	WindowFuncExprState *wfuncstate = perfuncstate->wfuncstate;
+	ExprContext *econtext = winstate->tmpcontext;
+	ExprState  *filter = wfuncstate->aggfilter;
+	MemoryContext oldContext;
+	Datum		value;
+	bool		isnull;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	/* Skip anything FILTERed out */
+	if (filter)
+	{
+		Datum		res = ExecEvalExpr(filter, econtext, &isnull);
+
+		if (isnull || !DatumGetBool(res))
+		{
+			MemoryContextSwitchTo(oldContext);
+			return;
+		}
+	}
+
+	/* the transition function is strict, so nulls are ignored */
+	value = ExecEvalExpr((ExprState *) linitial(wfuncstate->args), econtext,
+						 &isnull);
+	if (isnull)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return;
+	}
+
+	/* drop the candidates the new value beats or ties with */
+	while (peraggstate->queueTail > peraggstate->queueHead)
+	{
+		Datum		last = peraggstate->queueValues[peraggstate->queueTail - 1];
+
+		if (DatumGetBool(FunctionCall2Coll(&peraggstate->sortopfn,
+										   perfuncstate->winCollation,
+										   last, value)))
+			break;
+		if (!peraggstate->inputtypeByVal)
+			pfree(DatumGetPointer(last));
+		peraggstate->queueTail--;
+	}
+
+	MemoryContextSwitchTo(peraggstate->aggcontext);
+
+	/* make room, first by sliding the queue down, else by enlarging it */
+	if (peraggstate->queueTail >= peraggstate->queueSize)
+	{
+		int			nqueued = peraggstate->queueTail - peraggstate->queueHead;
+
+		if (peraggstate->queueHead > peraggstate->queueSize / 2)
+		{
+			memmove(peraggstate->queuePos,
+					peraggstate->queuePos + peraggstate->queueHead,
+					nqueued * sizeof(int64));
+			memmove(peraggstate->queueValues,
+					peraggstate->queueValues + peraggstate->queueHead,
+					nqueued * sizeof(Datum));
+			peraggstate->queueHead = 0;
+			peraggstate->queueTail = nqueued;
+		}
+		else if (peraggstate->queueSize == 0)
+		{
+			peraggstate->queueSize = 64;
+			peraggstate->queuePos = (int64 *)
+				palloc(peraggstate->queueSize * sizeof(int64));
+			peraggstate->queueValues = (Datum *)
+				palloc(peraggstate->queueSize * sizeof(Datum));
+		}
+		else
+		{
+			peraggstate->queueSize *= 2;
+			peraggstate->queuePos = (int64 *)
+				repalloc(peraggstate->queuePos,
+						 peraggstate->queueSize * sizeof(int64));
+			peraggstate->queueValues = (Datum *)
+				repalloc(peraggstate->queueValues,
+						 peraggstate->queueSize * sizeof(Datum));
+		}
+	}
+
+	peraggstate->queuePos[peraggstate->queueTail] = winstate->aggregatedupto;
+	peraggstate->queueValues[peraggstate->queueTail] =
+		datumCopy(value,
+				  peraggstate->inputtypeByVal,
+				  peraggstate->inputtypeLen);
+	peraggstate->queueTail++;
+
+	MemoryContextSwitchTo(oldContext);
 }
 
 /*
@@ -251,6 +384,12 @@ advance_windowaggregate(WindowAggState *winstate,
 	ExprContext *econtext = winstate->tmpcontext;
 	ExprState  *filter = wfuncstate->aggfilter;
 
+	if (peraggstate->use_extremum)
+	{
+		advance_extremum(winstate, perfuncstate, peraggstate);
+		return;
+	}
+
 	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 
 	/* Skip anything FILTERed out */
@@ -406,7 +545,7 @@ advance_windowaggregate(WindowAggState *winstate,
  *
  * This is very much like advance_windowaggregate, except that we will call
  * the inverse transition function (which caller must have checked is
- * available).
+ * available), or for a min/max-like aggregate drop the row from its queue.
  *
  * Returns true if we successfully removed the current row from this
  * aggregate, false if not (in the latter case, caller is responsible
@@ -427,6 +566,22 @@ advance_windowaggregate_base(WindowAggState *winstate,
 	ExprContext *econtext = winstate->tmpcontext;
 	ExprState  *filter = wfuncstate->aggfilter;
 
+	/*
+	 * The rows leaving the frame are the oldest, so a queued row can only be
+	 * at the head.  No need to evaluate anything.
+	 */
+	if (peraggstate->use_extremum)
+	{
+		if (peraggstate->queueTail > peraggstate->queueHead &&
+			peraggstate->queuePos[peraggstate->queueHead] == winstate->aggregatedbase)
+		{
+			if (!peraggstate->inputtypeByVal)
+				pfree(DatumGetPointer(peraggstate->queueValues[peraggstate->queueHead]));
+			peraggstate->queueHead++;
+		}
+		return true;
+	}
+
 	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 
 	/* Skip anything FILTERed out */
@@ -586,8 +741,22 @@ finalize_windowaggregate(WindowAggState *winstate,
 
 	/*
 	 * Apply the agg's finalfn if one is provided, else return transValue.
+	 * A min/max-like aggregate returns the best value in its queue.
 	 */
-	if (OidIsValid(peraggstate->finalfn_oid))
+	if (peraggstate->use_extremum)
+	{
+		if (peraggstate->queueTail > peraggstate->queueHead)
+		{
+			*result = peraggstate->queueValues[peraggstate->queueHead];
+			*isnull = false;
+		}
+		else
+		{
+			*result = (Datum) 0;
+			*isnull = true;
+		}
+	}
+	else if (OidIsValid(peraggstate->finalfn_oid))
 	{
 		LOCAL_FCINFO(fcinfo, FUNC_MAX_ARGS);
 		int			numFinalArgs = peraggstate->numFinalArgs;
@@ -652,7 +821,8 @@ finalize_windowaggregate(WindowAggState *winstate,
  *
  * This differs from nodeAgg.c in two ways.  First, if the window's frame
  * start position moves, we use the inverse transition function (if it exists)
- * to remove rows from the transition value.  And second, we expect to be
+ * to remove rows from the transition value, or for min/max-like aggregates
+ * from their queue of candidate values.  And second, we expect to be
  * able to call aggregate final functions repeatedly after aggregating more
  * data onto the same transition value.  This is not a behavior required by
  * nodeAgg.c.
@@ -706,7 +876,10 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * unable to remove the tuple from aggregation.  If this happens, or if
 	 * the aggregate doesn't have an inverse transition function at all, we
 	 * must perform the aggregation all over again for all tuples within the
-	 * new frame boundaries.
+	 * new frame boundaries.  Aggregates with a sort operator, such as min and
+	 * max, don't need an inverse: we keep the rows that could still become
+	 * the result in a queue (see advance_extremum), and removing a row is
+	 * just a matter of dropping it from the queue's head if it's there.
 	 *
 	 * If there's any exclusion clause, then we may have to aggregate over a
 	 * non-contiguous set of rows, so we punt and recalculate for every row.
@@ -784,7 +957,8 @@ eval_windowaggregates(WindowAggState *winstate)
 		peraggstate = &winstate->peragg[i];
 		if (winstate->currentpos == 0 ||
 			(winstate->aggregatedbase != winstate->frameheadpos &&
-			 !OidIsValid(peraggstate->invtransfn_oid)) ||
+			 !OidIsValid(peraggstate->invtransfn_oid) &&
+			 !peraggstate->use_extremum) ||
 			(winstate->frameOptions & FRAMEOPTION_EXCLUSION) ||
 			winstate->aggregatedupto <= winstate->frameheadpos)
 		{
@@ -2806,6 +2980,35 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 					&peraggstate->transtypeLen,
 					&peraggstate->transtypeByVal);
 
+	/*
+	 * An aggregate with a sort operator returns the first of its non-null
+	 * inputs in that operator's order, which we can track over a moving
+	 * frame with a queue of candidates even though it has no inverse
+	 * transition function.  Insist that it really is the plain kind, like
+	 * min and max: one argument, a strict transition function, and the
+	 * input value as result.  Again there's no point unless the frame head
+	 * moves, nor if an exclusion clause makes us restart for every row;
+	 * and we avoid volatile arguments for the reason given above.
+	 */
+	peraggstate->use_extremum = false;
+	if (!use_ma_code &&
+		OidIsValid(aggform->aggsortop) &&
+		numArguments == 1 &&
+		!OidIsValid(finalfn_oid) &&
+		peraggstate->transfn.fn_strict &&
+		inputTypes[0] == aggtranstype &&
+		aggtranstype == wfunc->wintype &&
+		!(winstate->frameOptions & (FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+									FRAMEOPTION_EXCLUSION)) &&
+		!contain_volatile_functions((Node *) wfunc))
+	{
+		peraggstate->use_extremum = true;
+		fmgr_info(get_opcode(aggform->aggsortop), &peraggstate->sortopfn);
+		get_typlenbyval(inputTypes[0],
+						&peraggstate->inputtypeLen,
+						&peraggstate->inputtypeByVal);
+	}
+
 	/*
 	 * initval is potentially null, so don't try to access it as a struct
 	 * field. Must do it the hard way with SysCacheGetAttr.
@@ -2862,9 +3065,10 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 * since we'd miss any indirectly referenced data.  We could, in theory,
 	 * make the memory allocation rules for moving aggregates different than
 	 * they have historically been for plain aggregates, but that seems grotty
-	 * and likely to lead to memory leaks.
+	 * and likely to lead to memory leaks.  Aggregates keeping a queue of
+	 * candidates need their own context for the same reasons.
 	 */
-	if (OidIsValid(invtransfn_oid))
+	if (OidIsValid(invtransfn_oid) || peraggstate->use_extremum)
 		peraggstate->aggcontext =
 			AllocSetContextCreate(CurrentMemoryContext,
 								  "WindowAgg Per Aggregate",
@@ -60,7 +60,8 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 
 	/* Send the tuple itself. */
 	tuple = ExecFetchSlotHeapTuple(slot, true, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple->t_data, false);
+	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple->t_data, false,
+						 false);
 
 	if (should_free)
 		heap_freetuple(tuple);
@@ -27,6 +27,9 @@
 #include "executor/tuptable.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "utils/hashutils.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 
 
 /*
@@ -770,3 +773,180 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 
 	return v_deform_fn;
 }
+
+
+/*
+ * Cache of deform functions, kept for the life of the backend.
+ *
+ * Unlike the code generated for expressions, which has the addresses of the
+ * ExprState's steps baked in, a deform function depends only on the
+ * properties of the tuple descriptor's columns, the slot type and the
+ * number of columns to deform.  Repeated queries over the same relations
+ * thus keep asking for identical functions, and we emit each of them once
+ * into a context of its own that is never released, and hand out its
+ * address afterwards.
+ *
+ * Entries are never removed: expression code compiled earlier may still be
+ * running and call them.  Once jit_deform_cache_size entries exist, further
+ * deform functions are compiled into the requesting context as before.
+ */
+typedef struct DeformCacheKey
+{
+	const TupleTableSlotOps *ops;
+	int			natts;			/* number of columns to deform */
+	int			desc_natts;		/* number of columns in the descriptor */
+	bool		optimize;		/* compiled with PGJIT_OPT3? */
+	uint32		attrs_hash;		/* hash of attrs[] below */
+} DeformCacheKey;
+
+/* The column properties slot_compile_deform() looks at */
+typedef struct DeformCacheAttr
+{
+	int16		attlen;
+	char		attalign;
+	bool		attbyval;
+	bool		attnotnull;
+	bool		atthasmissing;
+	bool		attisdropped;
+} DeformCacheAttr;
+
+typedef struct DeformCacheEntry
+{
+	DeformCacheKey key;			/* hash key - must be first */
+	DeformCacheAttr *attrs;		/* desc_natts entries */
+	void	   *fn;				/* emitted deform function */
+} DeformCacheEntry;
+
+static HTAB *deform_cache = NULL;
+static MemoryContext deform_cache_cxt = NULL;
+static LLVMJitContext *deform_cache_jit_context = NULL;
+
+/*
+ * Return a reference, usable in the module of context, to a deform function
+ * emitted by an earlier request with the same parameters, emitting it first
+ * if necessary.
+ *
+ * Returns NULL if the cache is disabled or full; the caller then has to use
+ * slot_compile_deform() itself.
+ */
+LLVMValueRef
+slot_get_cached_deform(LLVMJitContext *context, TupleDesc desc,
+					   const TupleTableSlotOps *ops, int natts)
+{
+	DeformCacheKey key;
+	DeformCacheAttr *attrs;
+	DeformCacheEntry *entry;
+	Size		attrs_size;
+	LLVMTypeRef param_types[1];
+	LLVMTypeRef deform_sig;
+	bool		found;
+	int			attnum;
+
+	if (jit_deform_cache_size <= 0)
+		return NULL;
+
+	/* same restrictions as slot_compile_deform() */
+	if (ops != &TTSOpsHeapTuple && ops != &TTSOpsBufferHeapTuple &&
+		ops != &TTSOpsMinimalTuple)
+		return NULL;
+
+	if (deform_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		deform_cache_cxt = AllocSetContextCreate(TopMemoryContext,
+												 "JIT deform cache",
+												 ALLOCSET_SMALL_SIZES);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(DeformCacheKey);
+		ctl.entrysize = sizeof(DeformCacheEntry);
+		ctl.hcxt = deform_cache_cxt;
+		deform_cache = hash_create("JIT deform cache", 64, &ctl,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	/* zeroed, as padding bytes are hashed and compared too */
+	attrs_size = sizeof(DeformCacheAttr) * desc->natts;
+	attrs = palloc0(attrs_size);
+	for (attnum = 0; attnum < desc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, attnum);
+
+		attrs[attnum].attlen = att->attlen;
+		attrs[attnum].attalign = att->attalign;
+		attrs[attnum].attbyval = att->attbyval;
+		attrs[attnum].attnotnull = ATTNOTNULL(att);
+		attrs[attnum].atthasmissing = att->atthasmissing;
+		attrs[attnum].attisdropped = att->attisdropped;
+	}
+
+	/* zero the padding, the key is hashed and compared as a blob */
+	memset(&key, 0, sizeof(key));
+	key.ops = ops;
+	key.natts = natts;
+	key.desc_natts = desc->natts;
+	key.optimize = (context->base.flags & PGJIT_OPT3) != 0;
+	key.attrs_hash = DatumGetUInt32(hash_any((unsigned char *) attrs,
+											 attrs_size));
+
+	entry = (DeformCacheEntry *) hash_search(deform_cache, &key,
+											 HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		/* a hash collision on attrs can't be cached, compile normally */
+		if (memcmp(entry->attrs, attrs, attrs_size) != 0)
+			entry = NULL;
+	}
+	else if (hash_get_num_entries(deform_cache) < jit_deform_cache_size)
+	{
+		LLVMJitContext *cache_context;
+		LLVMValueRef v_deform_fn;
+		char	   *funcname;
+		void	   *fn;
+
+		if (deform_cache_jit_context == NULL)
+			deform_cache_jit_context =
+				MemoryContextAllocZero(TopMemoryContext,
+									   sizeof(LLVMJitContext));
+		cache_context = deform_cache_jit_context;
+
+		/* throw away a module left behind by an error */
+		if (cache_context->module)
+		{
+			LLVMDisposeModule(cache_context->module);
+			cache_context->module = NULL;
+		}
+
+		cache_context->base.flags = PGJIT_PERFORM | PGJIT_DEFORM |
+			(key.optimize ? PGJIT_OPT3 : 0);
+
+		v_deform_fn = slot_compile_deform(cache_context, desc, ops, natts);
+		Assert(v_deform_fn != NULL);
+
+		/* make the function visible outside its module */
+		LLVMSetLinkage(v_deform_fn, LLVMExternalLinkage);
+		funcname = pstrdup(LLVMGetValueName(v_deform_fn));
+
+		fn = llvm_get_function(cache_context, funcname);
+		pfree(funcname);
+
+		entry = (DeformCacheEntry *) hash_search(deform_cache, &key,
+												 HASH_ENTER, &found);
+		Assert(!found);
+		entry->attrs = MemoryContextAlloc(deform_cache_cxt, attrs_size);
+		memcpy(entry->attrs, attrs, attrs_size);
+		entry->fn = fn;
+	}
+
+	pfree(attrs);
+
+	if (entry == NULL)
+		return NULL;
+
+	param_types[0] = l_ptr(StructTupleTableSlot);
+	deform_sig = LLVMFunctionType(LLVMVoidType(), param_types,
+								  lengthof(param_types), 0);
+
+	return l_ptr_const(entry->fn, l_ptr(deform_sig));
+}
@@ -51,6 +51,13 @@ typedef struct CompiledExprState
 {
 	LLVMJitContext *context;
 	const char *funcname;
+
+	/* has CheckExprStillValid() been done? */
+	bool		checked;
+
+	/* interpreter evalfunc, used for the first calls_left evaluations */
+	ExprStateEvalFunc interp_func;
+	int			calls_left;
 } CompiledExprState;
 
 
@@ -317,14 +324,20 @@ llvm_compile_expr(ExprState *state)
 					 * If the tupledesc of the to-be-deformed tuple is known,
 					 * and JITing of deforming is enabled, build deform
 					 * function specific to tupledesc and the exact number of
-					 * to-be-extracted attributes.
+					 * to-be-extracted attributes.  Prefer one emitted by an
+					 * earlier query, if the cache has it.
 					 */
 					if (tts_ops && desc && (context->base.flags & PGJIT_DEFORM))
 					{
 						l_jit_deform =
-							slot_compile_deform(context, desc,
-												tts_ops,
-												op->d.fetch.last_var);
+							slot_get_cached_deform(context, desc,
+												   tts_ops,
+												   op->d.fetch.last_var);
+						if (!l_jit_deform)
+							l_jit_deform =
+								slot_compile_deform(context, desc,
+													tts_ops,
+													op->d.fetch.last_var);
 					}
 
 					if (l_jit_deform)
@@ -563,6 +576,13 @@ llvm_compile_expr(ExprState *state)
 					break;
 				}
 
+				/*
+				 * The inline integer comparisons are just calls to the
+				 * comparison function for JIT purposes, LLVM can inline
+				 * those on its own.
+				 */
+			case EEOP_FUNCEXPR_INT4CMP:
+			case EEOP_FUNCEXPR_INT8CMP:
 			case EEOP_FUNCEXPR_STRICT:
 				{
 					FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
@@ -1566,6 +1586,80 @@ llvm_compile_expr(ExprState *state)
 					break;
 				}
 
+			case EEOP_HASHDATUM_SET_INITVAL:
+				{
+					LLVMValueRef v_initvalue;
+
+					v_initvalue =
+						l_sizet_const(op->d.hashdatum_initvalue.init_value);
+
+					LLVMBuildStore(b, v_initvalue, v_resvaluep);
+					LLVMBuildStore(b, l_sbool_const(0), v_resnullp);
+					LLVMBuildBr(b, opblocks[i + 1]);
+					break;
+				}
+
+			case EEOP_HASHDATUM_NEXT32:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+					LLVMValueRef v_fcinfo;
+					LLVMValueRef v_argisnull;
+					LLVMValueRef v_prevhash;
+					LLVMValueRef v_rotated;
+					LLVMValueRef v_hash;
+					LLVMValueRef v_retval;
+					LLVMBasicBlockRef b_argisnull;
+					LLVMBasicBlockRef b_argnotnull;
+
+					b_argisnull =
+						l_bb_before_v(opblocks[i + 1], "op.%d.argisnull", i);
+					b_argnotnull =
+						l_bb_before_v(opblocks[i + 1], "op.%d.argnotnull", i);
+
+					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+
+					/* rotate the hash so far left by 1 bit */
+					v_prevhash = LLVMBuildLoad(b, v_resvaluep, "");
+					v_prevhash = LLVMBuildTrunc(b, v_prevhash,
+												LLVMInt32Type(), "");
+					v_rotated =
+						LLVMBuildOr(b,
+									LLVMBuildShl(b, v_prevhash,
+												 l_int32_const(1), ""),
+									LLVMBuildLShr(b, v_prevhash,
+												  l_int32_const(31), ""),
+									"rotated");
+
+					LLVMBuildStore(b, l_sbool_const(0), v_resnullp);
+
+					v_argisnull = l_funcnull(b, v_fcinfo, 0);
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntEQ, v_argisnull,
+												  l_sbool_const(1), ""),
+									b_argisnull,
+									b_argnotnull);
+
+					/* NULLs hash to 0, the rotated hash is the result */
+					LLVMPositionBuilderAtEnd(b, b_argisnull);
+					LLVMBuildStore(b,
+								   LLVMBuildZExt(b, v_rotated, TypeSizeT, ""),
+								   v_resvaluep);
+					LLVMBuildBr(b, opblocks[i + 1]);
+
+					/* otherwise XOR in the argument's hash */
+					LLVMPositionBuilderAtEnd(b, b_argnotnull);
+					v_retval = BuildV1Call(context, b, mod, fcinfo, NULL);
+					v_hash = LLVMBuildXor(b, v_rotated,
+										  LLVMBuildTrunc(b, v_retval,
+														 LLVMInt32Type(), ""),
+										  "");
+					LLVMBuildStore(b,
+								   LLVMBuildZExt(b, v_hash, TypeSizeT, ""),
+								   v_resvaluep);
+					LLVMBuildBr(b, opblocks[i + 1]);
+					break;
+				}
+
 			case EEOP_SQLVALUEFUNCTION:
 				build_EvalXFunc(b, mod, "ExecEvalSQLValueFunction",
 								v_state, v_econtext, op);
@@ -1876,6 +1970,12 @@ llvm_compile_expr(ExprState *state)
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
+			case EEOP_HASHED_SCALARARRAYOP:
+				build_EvalXFunc(b, mod, "ExecEvalHashedScalarArrayOp",
+								v_state, v_econtext, op);
+				LLVMBuildBr(b, opblocks[i + 1]);
+				break;
+
 			case EEOP_XMLEXPR:
 				build_EvalXFunc(b, mod, "ExecEvalXmlExpr",
 								v_state, v_econtext, op);
@@ -2444,6 +2544,11 @@ llvm_compile_expr(ExprState *state)
 	 * expression is actually evaluated. That allows to emit a lot of
 	 * functions together, avoiding a lot of repeated llvm and memory
 	 * remapping overhead.
+	 *
+	 * With jit_warmup_evaluations set, postpone that further: the expression
+	 * is interpreted until it has been evaluated that many times, so that
+	 * optimizing and emitting the code doesn't delay the first rows, and
+	 * doesn't happen at all for queries that finish early.
 	 */
 	{
 
@@ -2452,6 +2557,15 @@ llvm_compile_expr(ExprState *state)
 		cstate->context = context;
 		cstate->funcname = funcname;
 
+		if (jit_warmup_evaluations > 0)
+		{
+			/* the steps are unchanged, so they can be interpreted as well */
+			ExecReadyInterpretedExpr(state);
+			Assert(state->evalfunc == ExecInterpExprStillValid);
+			cstate->interp_func = (ExprStateEvalFunc) state->evalfunc_private;
+			cstate->calls_left = jit_warmup_evaluations;
+		}
+
 		state->evalfunc = ExecRunCompiledExpr;
 		state->evalfunc_private = cstate;
 	}
@@ -2468,10 +2582,11 @@ llvm_compile_expr(ExprState *state)
 /*
  * Run compiled expression.
  *
- * This will only be called the first time a JITed expression is called. We
- * first make sure the expression is still up2date, and then get a pointer to
- * the emitted function. The latter can be the first thing that triggers
- * optimizing and emitting all the generated functions.
+ * This will only be called until the JITed expression has been switched to.
+ * We first make sure the expression is still up2date, and then either
+ * interpret it, while still warming up, or get a pointer to the emitted
+ * function. The latter can be the first thing that triggers optimizing and
+ * emitting all the generated functions.
  */
 static Datum
 ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
@@ -2479,7 +2594,17 @@ ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
 	CompiledExprState *cstate = state->evalfunc_private;
 	ExprStateEvalFunc func;
 
-	CheckExprStillValid(state, econtext);
+	if (!cstate->checked)
+	{
+		CheckExprStillValid(state, econtext);
+		cstate->checked = true;
+	}
+
+	if (cstate->calls_left > 0)
+	{
+		cstate->calls_left--;
+		return cstate->interp_func(state, econtext, isNull);
+	}
 
 	llvm_enter_fatal_on_oom();
 	func = (ExprStateEvalFunc) llvm_get_function(cstate->context,
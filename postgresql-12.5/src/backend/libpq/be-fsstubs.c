@@ -53,8 +53,11 @@
 
 /* define this to enable debug logging */
 /* #define FSDB 1 */
-/* chunk size for lo_import/lo_export transfers */
-#define BUFSIZE			8192
+/*
+ * chunk size for lo_import/lo_export transfers; large enough for each
+ * inv_read/inv_write call to cover many pg_largeobject pages at once
+ */
+#define BUFSIZE			(LOBLKSIZE * 32)
 
 /*
  * LO "FD"s are indexes into the cookies array.
@@ -414,7 +417,7 @@ lo_import_internal(text *filename, Oid lobjOid)
 	int			fd;
 	int			nbytes,
 				tmp PG_USED_FOR_ASSERTS_ONLY;
-	char		buf[BUFSIZE];
+	char	   *buf;
 	char		fnamebuf[MAXPGPATH];
 	LargeObjectDesc *lobj;
 	Oid			oid;
@@ -442,11 +445,13 @@ lo_import_internal(text *filename, Oid lobjOid)
 	 */
 	lobj = inv_open(oid, INV_WRITE, fscxt);
 
+	buf = palloc(BUFSIZE);
 	while ((nbytes = read(fd, buf, BUFSIZE)) > 0)
 	{
 		tmp = inv_write(lobj, buf, nbytes);
 		Assert(tmp == nbytes);
 	}
+	pfree(buf);
 
 	if (nbytes < 0)
 		ereport(ERROR,
@@ -477,7 +482,7 @@ be_lo_export(PG_FUNCTION_ARGS)
 	int			fd;
 	int			nbytes,
 				tmp;
-	char		buf[BUFSIZE];
+	char	   *buf;
 	char		fnamebuf[MAXPGPATH];
 	LargeObjectDesc *lobj;
 	mode_t		oumask;
@@ -519,6 +524,7 @@ be_lo_export(PG_FUNCTION_ARGS)
 	/*
 	 * read in from the inversion file and write to the filesystem
 	 */
+	buf = palloc(BUFSIZE);
 	while ((nbytes = inv_read(lobj, buf, BUFSIZE)) > 0)
 	{
 		tmp = write(fd, buf, nbytes);
@@ -528,6 +534,7 @@ be_lo_export(PG_FUNCTION_ARGS)
 					 errmsg("could not write server file \"%s\": %m",
 							fnamebuf)));
 	}
+	pfree(buf);
 
 	if (CloseTransientFile(fd))
 		ereport(ERROR,
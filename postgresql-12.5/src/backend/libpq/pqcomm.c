@@ -89,7 +89,9 @@
 #endif
 
 #include "common/ip.h"
+#include "common/zpq_stream.h"
 #include "libpq/libpq.h"
+#include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "port/pg_bswap.h"
 #include "storage/ipc.h"
@@ -120,6 +122,7 @@
  */
 int			Unix_socket_permissions;
 char	   *Unix_socket_group;
+bool		network_compression = true;
 
 /* Where the Unix socket files are (list of palloc'd strings) */
 static List *sock_paths = NIL;
@@ -135,14 +138,20 @@ static List *sock_paths = NIL;
 #define PQ_RECV_BUFFER_SIZE 8192
 
 static char *PqSendBuffer;
-static int	PqSendBufferSize;	/* Size send buffer */
-static int	PqSendPointer;		/* Next index to store a byte in PqSendBuffer */
-static int	PqSendStart;		/* Next index to send a byte in PqSendBuffer */
+static size_t PqSendBufferSize;	/* Size send buffer */
+static size_t PqSendPointer;	/* Next index to store a byte in PqSendBuffer */
+static size_t PqSendStart;		/* Next index to send a byte in PqSendBuffer */
 
 static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+/*
+ * Protocol compression state.  When PqStream is set, the buffers above hold
+ * uncompressed data and all socket traffic passes through the stream.
+ */
+static ZpqStream *PqStream = NULL;
+
 /*
  * Message status
  */
@@ -163,7 +172,12 @@ static void socket_putmessage_noblock(char msgtype, const char *s, size_t len);
 static void socket_startcopyout(void);
 static void socket_endcopyout(bool errorAbort);
 static int	internal_putbytes(const char *s, size_t len);
-static int	internal_flush(void);
+static inline int internal_flush(void);
+static int	internal_flush_buffer(const char *buf, size_t *start,
+								  size_t *end);
+static ssize_t internal_read(void *ptr, size_t len);
+static ssize_t zpq_secure_read(void *arg, void *ptr, size_t len);
+static ssize_t zpq_secure_write(void *arg, const void *ptr, size_t len);
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(char *unixSocketDir, char *unixSocketPath);
@@ -961,9 +975,11 @@ pq_recvbuf(void)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		r = internal_read(PqRecvBuffer + PqRecvLength,
+						  PQ_RECV_BUFFER_SIZE - PqRecvLength);
 
+		if (r == ZPQ_STREAM_ERROR)
+			return EOF;			/* already reported */
 		if (r < 0)
 		{
 			if (errno == EINTR)
@@ -1053,8 +1069,27 @@ pq_getbyte_if_available(unsigned char *c)
 	/* Put the socket into non-blocking mode */
 	socket_set_nonblocking(true);
 
-	r = secure_read(MyProcPort, c, 1);
-	if (r < 0)
+	if (PqStream)
+	{
+		/*
+		 * Fill the whole buffer, so that no decompressed data is left behind
+		 * inside the stream where a wait on the socket wouldn't notice it.
+		 */
+		PqRecvPointer = PqRecvLength = 0;
+		r = internal_read(PqRecvBuffer, PQ_RECV_BUFFER_SIZE);
+		if (r > 0)
+		{
+			PqRecvLength = r;
+			*c = PqRecvBuffer[PqRecvPointer++];
+			r = 1;
+		}
+	}
+	else
+		r = secure_read(MyProcPort, c, 1);
+
+	if (r == ZPQ_STREAM_ERROR)
+		r = EOF;				/* already reported */
+	else if (r < 0)
 	{
 		/*
 		 * Ok if no data available without blocking or interrupted (though
@@ -1380,6 +1415,24 @@ internal_putbytes(const char *s, size_t len)
 			if (internal_flush())
 				return EOF;
 		}
+
+		/*
+		 * If the buffer is empty and the remaining data would fill it at
+		 * least once over, hand it straight to the socket rather than
+		 * copying it through the buffer piecemeal.
+		 */
+		if (len >= PqSendBufferSize && PqSendStart == PqSendPointer)
+		{
+			size_t		start = 0;
+			size_t		end = len;
+
+			socket_set_nonblocking(false);
+			if (internal_flush_buffer(s, &start, &end))
+				return EOF;
+			/* in blocking mode, everything has been sent */
+			break;
+		}
+
 		amount = PqSendBufferSize - PqSendPointer;
 		if (amount > len)
 			amount = len;
@@ -1419,19 +1472,57 @@ socket_flush(void)
  * and the socket is in non-blocking mode), or EOF if trouble.
  * --------------------------------
  */
-static int
+static inline int
 internal_flush(void)
+{
+	return internal_flush_buffer(PqSendBuffer, &PqSendStart, &PqSendPointer);
+}
+
+/* --------------------------------
+ *		internal_flush_buffer - flush the given buffer content
+ *
+ * Sends buf[*start .. *end), advancing *start past whatever was sent; both
+ * are reset to zero once everything has gone out (or on error).  Returns
+ * the same as internal_flush().
+ * --------------------------------
+ */
+static int
+internal_flush_buffer(const char *buf, size_t *start, size_t *end)
 {
 	static int	last_reported_send_errno = 0;
 
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	const char *bufptr = buf + *start;
+	const char *bufend = buf + *end;
 
-	while (bufptr < bufend)
+	while (bufptr < bufend || (PqStream && zpq_buffered_tx(PqStream)))
 	{
 		int			r;
 
-		r = secure_write(MyProcPort, bufptr, bufend - bufptr);
+		/*
+		 * With compression, zpq_write may accept data it could not yet pass
+		 * on to the socket, so we loop until the stream is drained too.  A
+		 * zero return then just means there was nothing left to consume.
+		 */
+		if (PqStream)
+		{
+			r = zpq_write(PqStream, bufptr, bufend - bufptr);
+			if (r == ZPQ_STREAM_ERROR)
+			{
+				ereport(COMMERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("could not compress data to client: %s",
+								zpq_error(PqStream))));
+				*start = *end = 0;
+				ClientConnectionLost = 1;
+				InterruptPending = 1;
+				return EOF;
+			}
+			if (r == 0 && bufptr == bufend)
+				continue;
+		}
+		else
+			r = secure_write(MyProcPort, unconstify(char *, bufptr),
+							 bufend - bufptr);
 
 		if (r <= 0)
 		{
@@ -1471,7 +1562,7 @@ internal_flush(void)
 			 * flag that'll cause the next CHECK_FOR_INTERRUPTS to terminate
 			 * the connection.
 			 */
-			PqSendStart = PqSendPointer = 0;
+			*start = *end = 0;
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1479,10 +1570,10 @@ internal_flush(void)
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
 		bufptr += r;
-		PqSendStart += r;
+		*start += r;
 	}
 
-	PqSendStart = PqSendPointer = 0;
+	*start = *end = 0;
 	return 0;
 }
 
@@ -1498,7 +1589,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!socket_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1521,7 +1612,123 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
-	return (PqSendStart < PqSendPointer);
+	return (PqSendStart < PqSendPointer ||
+			(PqStream && zpq_buffered_tx(PqStream)));
+}
+
+/* --------------------------------
+ *		internal_read - read from the client, decompressing if required
+ *
+ * Returns the same as secure_read(), or ZPQ_STREAM_ERROR (after logging
+ * the problem) if the client sent data we cannot decompress.
+ * --------------------------------
+ */
+static ssize_t
+internal_read(void *ptr, size_t len)
+{
+	ssize_t		r;
+
+	if (!PqStream)
+		return secure_read(MyProcPort, ptr, len);
+
+	r = zpq_read(PqStream, ptr, len);
+
+	if (r == ZPQ_STREAM_ERROR)
+	{
+		/*
+		 * Careful: an ereport() that tries to write to the client would cause
+		 * recursion to here.  This message must go *only* to the postmaster
+		 * log.
+		 */
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("could not decompress data from client: %s",
+						zpq_error(PqStream))));
+	}
+	return r;
+}
+
+static ssize_t
+zpq_secure_read(void *arg, void *ptr, size_t len)
+{
+	return secure_read((Port *) arg, ptr, len);
+}
+
+static ssize_t
+zpq_secure_write(void *arg, const void *ptr, size_t len)
+{
+	return secure_write((Port *) arg, unconstify(void *, ptr), len);
+}
+
+/* --------------------------------
+ *		pq_choose_compression - pick a compression algorithm for the client
+ *
+ * requested is the value of the _pq_.compression startup option, a comma
+ * separated list of algorithms in the client's order of preference.  Returns
+ * the first one we support, or NULL if compression should not be used.
+ * --------------------------------
+ */
+const char *
+pq_choose_compression(const char *requested)
+{
+	char	   *list;
+	char	   *tok;
+
+	if (!network_compression)
+		return NULL;
+
+	list = pstrdup(requested);
+	for (tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ","))
+	{
+		while (*tok == ' ')
+			tok++;
+		if (zpq_algorithm_supported(tok))
+		{
+			tok = pstrdup(tok);
+			pfree(list);
+			return tok;
+		}
+	}
+	pfree(list);
+	return NULL;
+}
+
+/* --------------------------------
+ *		pq_enable_compression - acknowledge and switch on compression
+ *
+ * Sends the CompressionAck message, uncompressed, and then routes all further
+ * traffic in both directions through a compression stream.  The client
+ * switches over as soon as it sees the acknowledgement, and sends nothing
+ * between its startup packet and that point, so anything still sitting in
+ * the receive buffer is already compressed.
+ *
+ * returns 0 if OK, EOF if trouble
+ * --------------------------------
+ */
+int
+pq_enable_compression(const char *algorithm)
+{
+	StringInfoData buf;
+
+	Assert(PqStream == NULL);
+
+	pq_beginmessage(&buf, 'z');
+	pq_sendstring(&buf, algorithm);
+	pq_endmessage(&buf);
+	if (pq_flush())
+		return EOF;
+
+	PqStream = zpq_create(algorithm,
+						  zpq_secure_write, zpq_secure_read, MyProcPort,
+						  PqRecvBuffer + PqRecvPointer,
+						  PqRecvLength - PqRecvPointer);
+	if (PqStream == NULL)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("could not initialize protocol compression")));
+	PqRecvPointer = PqRecvLength = 0;
+
+	return 0;
 }
 
 /* --------------------------------
@@ -1594,7 +1801,7 @@ static void
 socket_putmessage_noblock(char msgtype, const char *s, size_t len)
 {
 	int			res PG_USED_FOR_ASSERTS_ONLY;
-	int			required;
+	size_t		required;
 
 	/*
 	 * Ensure we have enough space in the output buffer for the message header
@@ -37,6 +37,8 @@
  *		pq_sendint64	- append a binary 8-byte int to a StringInfo buffer
  *		pq_sendfloat4	- append a float4 to a StringInfo buffer
  *		pq_sendfloat8	- append a float8 to a StringInfo buffer
+ *		pq_sendfixedbinary - append a counted binary value of a built-in
+ *						  fixed-width type
  *		pq_sendbytes	- append raw data to a StringInfo buffer
  *		pq_sendcountedtext - append a counted text string (with character set conversion)
  *		pq_sendtext		- append a text string (with conversion)
@@ -61,6 +63,7 @@
  *		pq_getmsgint64	- get a binary 8-byte int from a message buffer
  *		pq_getmsgfloat4 - get a float4 from a message buffer
  *		pq_getmsgfloat8 - get a float8 from a message buffer
+ *		pq_getmsgfixedbinary - get a binary value of a built-in fixed-width type
  *		pq_getmsgbytes	- get raw data from a message buffer
  *		pq_copymsgbytes - copy raw data from a message buffer
  *		pq_getmsgtext	- get a counted text string (with conversion)
@@ -77,6 +80,7 @@
 #include "libpq/pqformat.h"
 #include "mb/pg_wchar.h"
 #include "port/pg_bswap.h"
+#include "utils/fmgroids.h"
 
 
 /* --------------------------------
@@ -287,6 +291,64 @@ pq_sendfloat8(StringInfo buf, float8 f)
 	pq_sendint64(buf, swap.i);
 }
 
+/* --------------------------------
+ *		pq_sendfixedbinary - append a counted binary value of a built-in
+ *						  fixed-width type
+ *
+ * If typsend is the send function of one of the built-in fixed-width types
+ * handled here, append an int32 length word followed by exactly the bytes
+ * that function would have produced, as needed for a binary DataRow column
+ * or COPY BINARY field, and return true.  Otherwise return false without
+ * touching buf, and the caller must call the send function itself.  This
+ * avoids a function call and a palloc'd bytea per value for common types.
+ * --------------------------------
+ */
+bool
+pq_sendfixedbinary(StringInfo buf, Oid typsend, Datum value)
+{
+	switch (typsend)
+	{
+		case F_BOOLSEND:
+			pq_sendint32(buf, 1);
+			pq_sendbyte(buf, DatumGetBool(value) ? 1 : 0);
+			return true;
+		case F_CHARSEND:
+			pq_sendint32(buf, 1);
+			pq_sendbyte(buf, DatumGetChar(value));
+			return true;
+		case F_INT2SEND:
+			pq_sendint32(buf, sizeof(int16));
+			pq_sendint16(buf, DatumGetInt16(value));
+			return true;
+		case F_INT4SEND:
+		case F_DATE_SEND:
+			pq_sendint32(buf, sizeof(int32));
+			pq_sendint32(buf, DatumGetInt32(value));
+			return true;
+		case F_OIDSEND:
+			pq_sendint32(buf, sizeof(Oid));
+			pq_sendint32(buf, DatumGetObjectId(value));
+			return true;
+		case F_INT8SEND:
+		case F_TIME_SEND:
+		case F_TIMESTAMP_SEND:
+		case F_TIMESTAMPTZ_SEND:
+			pq_sendint32(buf, sizeof(int64));
+			pq_sendint64(buf, DatumGetInt64(value));
+			return true;
+		case F_FLOAT4SEND:
+			pq_sendint32(buf, sizeof(float4));
+			pq_sendfloat4(buf, DatumGetFloat4(value));
+			return true;
+		case F_FLOAT8SEND:
+			pq_sendint32(buf, sizeof(float8));
+			pq_sendfloat8(buf, DatumGetFloat8(value));
+			return true;
+		default:
+			return false;
+	}
+}
+
 /* --------------------------------
  *		pq_endmessage	- send the completed message to the frontend
  *
@@ -629,6 +691,70 @@ pq_getmsgrawstring(StringInfo msg)
 	return str;
 }
 
+/* --------------------------------
+ *		pq_getmsgfixedbinary - get a binary value of a built-in fixed-width type
+ *
+ * This is the input counterpart of pq_sendfixedbinary.  If typreceive is the
+ * receive function of one of the types handled here, and the unread part of
+ * msg is exactly as long as that type's binary representation, consume it,
+ * store the value in *result and return true.  Otherwise return false without
+ * consuming anything; the caller should then call the receive function, which
+ * will report any formatting problem.  Types whose receive functions check
+ * the value or apply a typmod are deliberately not handled here.
+ * --------------------------------
+ */
+bool
+pq_getmsgfixedbinary(StringInfo msg, Oid typreceive, Datum *result)
+{
+	int			remaining = msg->len - msg->cursor;
+
+	switch (typreceive)
+	{
+		case F_BOOLRECV:
+			if (remaining != 1)
+				return false;
+			*result = BoolGetDatum(pq_getmsgbyte(msg) != 0);
+			return true;
+		case F_CHARRECV:
+			if (remaining != 1)
+				return false;
+			*result = CharGetDatum(pq_getmsgbyte(msg));
+			return true;
+		case F_INT2RECV:
+			if (remaining != sizeof(int16))
+				return false;
+			*result = Int16GetDatum((int16) pq_getmsgint(msg, sizeof(int16)));
+			return true;
+		case F_INT4RECV:
+			if (remaining != sizeof(int32))
+				return false;
+			*result = Int32GetDatum((int32) pq_getmsgint(msg, sizeof(int32)));
+			return true;
+		case F_OIDRECV:
+			if (remaining != sizeof(Oid))
+				return false;
+			*result = ObjectIdGetDatum((Oid) pq_getmsgint(msg, sizeof(Oid)));
+			return true;
+		case F_INT8RECV:
+			if (remaining != sizeof(int64))
+				return false;
+			*result = Int64GetDatum(pq_getmsgint64(msg));
+			return true;
+		case F_FLOAT4RECV:
+			if (remaining != sizeof(float4))
+				return false;
+			*result = Float4GetDatum(pq_getmsgfloat4(msg));
+			return true;
+		case F_FLOAT8RECV:
+			if (remaining != sizeof(float8))
+				return false;
+			*result = Float8GetDatum(pq_getmsgfloat8(msg));
+			return true;
+		default:
+			return false;
+	}
+}
+
 /* --------------------------------
  *		pq_getmsgend	- verify message fully consumed
  * --------------------------------
@@ -95,6 +95,16 @@ clauselist_selectivity(PlannerInfo *root,
 											 jointype, sjinfo, rel,
 											 &estimatedclauses);
 	}
+	else if (rel == NULL && varRelid == 0 && sjinfo != NULL &&
+			 list_length(clauses) > 1)
+	{
+		/*
+		 * Join clauses.  Groups of equijoin clauses between two relations
+		 * may be covered by ndistinct statistics on both sides.
+		 */
+		s1 *= statext_join_clauselist_selectivity(root, clauses, jointype,
+												  sjinfo, &estimatedclauses);
+	}
 
 	/*
 	 * Apply normal selectivity estimates for the remaining clauses, passing
@@ -0,0 +1,469 @@
+/*-------------------------------------------------------------------------
+ *
+ * dphyp.c
+ *	  Join order search driven by the query's join graph.
+ *
+ * standard_join_search() builds joins level by level, and at every level
+ * tries to join each relation with every other relation that it might be
+ * joined to.  With many relations most of those attempts are rejected only
+ * after some work, and the number of attempts grows very quickly.  Here we
+ * instead enumerate exactly the pairs (S1, S2) of disjoint, connected sets
+ * of relations that are connected to each other ("csg-cmp pairs"), in an
+ * order that guarantees that the plans for S1 and S2 are complete before
+ * the pair is considered.  This is the enumeration scheme of Moerkotte and
+ * Neumann's DPccp/DPhyp algorithms; for the usual chain, cycle and
+ * snowflake-shaped queries the number of pairs is far smaller than what
+ * the level-by-level search visits, so that queries with a few dozen
+ * relations can still be planned exhaustively.
+ *
+ * The graph has one node per jointree item handed to us by
+ * make_rel_from_joinlist().  Two nodes are adjacent if there is a join
+ * clause between them, or if a join-order restriction (outer join, semijoin,
+ * LATERAL reference or PlaceHolderVar) says they should be joined.  Join
+ * clauses and special joins that mention more than two relations are
+ * hyperedges; we connect every pair of relations they mention, the same
+ * way have_relevant_joinclause() treats them, and leave it to
+ * make_join_rel() (that is, join_is_legal()) to reject the splits that such
+ * an edge doesn't actually allow.
+ *
+ * If the graph is not connected, if it has too many nodes, or if it has
+ * more csg-cmp pairs than dphyp_limit allows, we return NULL and let the
+ * caller use one of the other join search strategies.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/path/dphyp.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "optimizer/joininfo.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "port/pg_bitutils.h"
+#include "utils/hsearch.h"
+
+
+/* Maximum number of jointree items we can handle; one bit per item */
+#define DPHYP_MAX_RELS	64
+
+typedef uint64 NodeSet;
+
+#define NODESET_SINGLETON(i)	(((NodeSet) 1) << (i))
+/* all nodes with index <= i */
+#define NODESET_UPTO(i) \
+	((i) >= DPHYP_MAX_RELS - 1 ? ~((NodeSet) 0) : NODESET_SINGLETON((i) + 1) - 1)
+#define NODESET_LOWEST(s)		pg_rightmost_one_pos64(s)
+
+/* Hash table entry mapping a set of nodes to its RelOptInfo */
+typedef struct DPHypEntry
+{
+	NodeSet		nodes;			/* hash key --- must be first */
+	RelOptInfo *rel;			/* NULL if no legal join exists */
+	bool		finalized;		/* set_cheapest() done? */
+} DPHypEntry;
+
+typedef struct DPHypContext
+{
+	PlannerInfo *root;
+	int			nnodes;
+	NodeSet		allnodes;		/* set of all nodes */
+	NodeSet	   *neighbors;		/* adjacency, indexed by node */
+	bool		counting;		/* only count csg-cmp pairs? */
+	int			npairs;			/* pairs counted so far */
+	HTAB	   *rels;			/* NodeSet -> DPHypEntry */
+} DPHypContext;
+
+static NodeSet dphyp_neighborhood(DPHypContext *ctx, NodeSet s, NodeSet x);
+static bool dphyp_graph_is_connected(DPHypContext *ctx);
+static bool dphyp_enumerate(DPHypContext *ctx);
+static bool dphyp_enumerate_csg_rec(DPHypContext *ctx, NodeSet s, NodeSet x);
+static bool dphyp_emit_csg(DPHypContext *ctx, NodeSet s1);
+static bool dphyp_enumerate_cmp_rec(DPHypContext *ctx, NodeSet s1,
+									NodeSet s2, NodeSet x);
+static bool dphyp_emit_csg_cmp(DPHypContext *ctx, NodeSet s1, NodeSet s2);
+static RelOptInfo *dphyp_get_rel(DPHypContext *ctx, NodeSet nodes);
+static void dphyp_finalize_rel(DPHypContext *ctx, DPHypEntry *entry);
+
+
+/*
+ * dphyp_join_search
+ *	  Find the best way to join 'initial_rels' by enumerating the connected
+ *	  subgraphs of their join graph.
+ *
+ * Arguments and result are as for standard_join_search(), except that NULL
+ * is returned if this method isn't applicable to the problem; in that case
+ * root->join_rel_list and root->join_rel_hash are left as we found them.
+ */
+RelOptInfo *
+dphyp_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	DPHypContext ctx;
+	HASHCTL		hash_ctl;
+	ListCell   *lc;
+	DPHypEntry *entry;
+	RelOptInfo *result;
+	int			savelength;
+	struct HTAB *savehash;
+	int			i;
+
+	Assert(levels_needed == list_length(initial_rels));
+	Assert(root->join_rel_level == NULL);
+
+	if (levels_needed > DPHYP_MAX_RELS)
+		return NULL;
+
+	ctx.root = root;
+	ctx.nnodes = levels_needed;
+	ctx.allnodes = NODESET_UPTO(levels_needed - 1);
+	ctx.neighbors = (NodeSet *) palloc0(levels_needed * sizeof(NodeSet));
+	ctx.counting = true;
+	ctx.npairs = 0;
+	ctx.rels = NULL;
+
+	/* Build the join graph */
+	i = 0;
+	foreach(lc, initial_rels)
+	{
+		RelOptInfo *rel1 = (RelOptInfo *) lfirst(lc);
+		ListCell   *lc2;
+		int			j = i + 1;
+
+		for_each_cell(lc2, lnext(lc))
+		{
+			RelOptInfo *rel2 = (RelOptInfo *) lfirst(lc2);
+
+			if (have_relevant_joinclause(root, rel1, rel2) ||
+				have_join_order_restriction(root, rel1, rel2))
+			{
+				ctx.neighbors[i] |= NODESET_SINGLETON(j);
+				ctx.neighbors[j] |= NODESET_SINGLETON(i);
+			}
+			j++;
+		}
+		i++;
+	}
+
+	/*
+	 * A disconnected graph needs clauseless joins, which the other search
+	 * strategies know how to pick; and there's no point in planning at all
+	 * if the problem is too big.  Find that out before building anything.
+	 */
+	if (!dphyp_graph_is_connected(&ctx) || !dphyp_enumerate(&ctx))
+	{
+		pfree(ctx.neighbors);
+		return NULL;
+	}
+
+	/*
+	 * OK, do it for real.  As in geqo_eval(), remember the state of the join
+	 * rel list and hash so that we can back out if we fail to find a plan;
+	 * but unlike GEQO, we keep whatever we built if we succeed.
+	 */
+	savelength = list_length(root->join_rel_list);
+	savehash = root->join_rel_hash;
+	root->join_rel_hash = NULL;
+
+	MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(NodeSet);
+	hash_ctl.entrysize = sizeof(DPHypEntry);
+	hash_ctl.hcxt = CurrentMemoryContext;
+	ctx.rels = hash_create("DPhyp join rels", Min(2 * ctx.npairs, 8192),
+						   &hash_ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	ctx.counting = false;
+
+	i = 0;
+	foreach(lc, initial_rels)
+	{
+		NodeSet		node = NODESET_SINGLETON(i);
+
+		entry = (DPHypEntry *) hash_search(ctx.rels, &node, HASH_ENTER, NULL);
+		entry->rel = (RelOptInfo *) lfirst(lc);
+		entry->finalized = true;	/* done by set_base_rel_pathlists etc */
+		i++;
+	}
+
+	(void) dphyp_enumerate(&ctx);
+
+	entry = (DPHypEntry *) hash_search(ctx.rels, &ctx.allnodes, HASH_FIND,
+									   NULL);
+	if (entry == NULL || entry->rel == NULL)
+	{
+		/*
+		 * Join-order restrictions can make every split of some connected set
+		 * illegal, so that we never got to join everything.  Forget what we
+		 * built and let the level-by-level search deal with it.
+		 */
+		root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+		root->join_rel_hash = savehash;
+		hash_destroy(ctx.rels);
+		pfree(ctx.neighbors);
+		return NULL;
+	}
+
+	dphyp_finalize_rel(&ctx, entry);
+	result = entry->rel;
+
+	hash_destroy(ctx.rels);
+	pfree(ctx.neighbors);
+
+	return result;
+}
+
+/*
+ * dphyp_neighborhood
+ *	  Nodes adjacent to some member of s, excluding s itself and nodes in x.
+ */
+static NodeSet
+dphyp_neighborhood(DPHypContext *ctx, NodeSet s, NodeSet x)
+{
+	NodeSet		result = 0;
+	NodeSet		rest = s;
+
+	while (rest != 0)
+	{
+		int			i = NODESET_LOWEST(rest);
+
+		result |= ctx->neighbors[i];
+		rest &= rest - 1;
+	}
+
+	return result & ~(s | x);
+}
+
+/*
+ * dphyp_graph_is_connected
+ *	  Is every node reachable from node 0?
+ */
+static bool
+dphyp_graph_is_connected(DPHypContext *ctx)
+{
+	NodeSet		reached = NODESET_SINGLETON(0);
+	NodeSet		frontier = reached;
+
+	while (frontier != 0)
+	{
+		frontier = dphyp_neighborhood(ctx, frontier, reached);
+		reached |= frontier;
+	}
+
+	return reached == ctx->allnodes;
+}
+
+/*
+ * dphyp_enumerate
+ *	  Emit every csg-cmp pair of the graph, in an order suitable for dynamic
+ *	  programming.
+ *
+ * Returns false if we are only counting pairs and gave up because there are
+ * more than dphyp_limit of them.
+ */
+static bool
+dphyp_enumerate(DPHypContext *ctx)
+{
+	int			i;
+
+	for (i = ctx->nnodes - 1; i >= 0; i--)
+	{
+		NodeSet		node = NODESET_SINGLETON(i);
+
+		if (!dphyp_emit_csg(ctx, node))
+			return false;
+		if (!dphyp_enumerate_csg_rec(ctx, node, NODESET_UPTO(i)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * dphyp_enumerate_csg_rec
+ *	  Emit all connected sets that grow the connected set s by nodes not
+ *	  in x, and recurse to grow them further.
+ */
+static bool
+dphyp_enumerate_csg_rec(DPHypContext *ctx, NodeSet s, NodeSet x)
+{
+	NodeSet		n = dphyp_neighborhood(ctx, s, x);
+	NodeSet		sub;
+
+	if (n == 0)
+		return true;
+
+	/* Visit the nonempty subsets of n, in increasing numeric order */
+	for (sub = n & (~n + 1); sub != 0; sub = (sub - n) & n)
+	{
+		if (!dphyp_emit_csg(ctx, s | sub))
+			return false;
+	}
+	for (sub = n & (~n + 1); sub != 0; sub = (sub - n) & n)
+	{
+		if (!dphyp_enumerate_csg_rec(ctx, s | sub, x | n))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * dphyp_emit_csg
+ *	  Find all connected complements of the connected set s1 and emit them.
+ *
+ * We only consider complements whose nodes all come after the first node of
+ * s1, so that each pair is emitted just once.
+ */
+static bool
+dphyp_emit_csg(DPHypContext *ctx, NodeSet s1)
+{
+	NodeSet		x = s1 | NODESET_UPTO(NODESET_LOWEST(s1));
+	NodeSet		n = dphyp_neighborhood(ctx, s1, x);
+	int			i;
+
+	for (i = ctx->nnodes - 1; i >= 0; i--)
+	{
+		NodeSet		s2 = NODESET_SINGLETON(i);
+
+		if (!(n & s2))
+			continue;
+		if (!dphyp_emit_csg_cmp(ctx, s1, s2))
+			return false;
+		if (!dphyp_enumerate_cmp_rec(ctx, s1, s2,
+									 x | (NODESET_UPTO(i) & n)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * dphyp_enumerate_cmp_rec
+ *	  Grow the complement s2 of s1 by nodes not in x, emitting each result.
+ */
+static bool
+dphyp_enumerate_cmp_rec(DPHypContext *ctx, NodeSet s1, NodeSet s2, NodeSet x)
+{
+	NodeSet		n = dphyp_neighborhood(ctx, s2, x);
+	NodeSet		sub;
+
+	if (n == 0)
+		return true;
+
+	for (sub = n & (~n + 1); sub != 0; sub = (sub - n) & n)
+	{
+		if (!dphyp_emit_csg_cmp(ctx, s1, s2 | sub))
+			return false;
+	}
+	x |= n;
+	for (sub = n & (~n + 1); sub != 0; sub = (sub - n) & n)
+	{
+		if (!dphyp_enumerate_cmp_rec(ctx, s1, s2 | sub, x))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * dphyp_emit_csg_cmp
+ *	  Consider joining the sets s1 and s2.
+ */
+static bool
+dphyp_emit_csg_cmp(DPHypContext *ctx, NodeSet s1, NodeSet s2)
+{
+	RelOptInfo *rel1;
+	RelOptInfo *rel2;
+	RelOptInfo *joinrel;
+	NodeSet		nodes = s1 | s2;
+	DPHypEntry *entry;
+	bool		found;
+
+	if (ctx->counting)
+	{
+		CHECK_FOR_INTERRUPTS();
+		return ++ctx->npairs <= dphyp_limit;
+	}
+
+	rel1 = dphyp_get_rel(ctx, s1);
+	rel2 = dphyp_get_rel(ctx, s2);
+	if (rel1 == NULL || rel2 == NULL)
+		return true;
+
+	joinrel = make_join_rel(ctx->root, rel1, rel2);
+
+	entry = (DPHypEntry *) hash_search(ctx->rels, &nodes, HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->rel = NULL;
+		entry->finalized = false;
+	}
+	if (joinrel != NULL)
+	{
+		Assert(entry->rel == NULL || entry->rel == joinrel);
+		entry->rel = joinrel;
+
+		/*
+		 * The enumeration order should make this impossible, but if we did
+		 * add paths to a rel that has already been used as a join input,
+		 * make sure set_cheapest() is run on it again.
+		 */
+		entry->finalized = false;
+	}
+
+	return true;
+}
+
+/*
+ * dphyp_get_rel
+ *	  Get the completed RelOptInfo for a set of nodes, or NULL if there's no
+ *	  legal way to join them.
+ */
+static RelOptInfo *
+dphyp_get_rel(DPHypContext *ctx, NodeSet nodes)
+{
+	DPHypEntry *entry;
+
+	entry = (DPHypEntry *) hash_search(ctx->rels, &nodes, HASH_FIND, NULL);
+	if (entry == NULL || entry->rel == NULL)
+		return NULL;
+
+	if (!entry->finalized)
+		dphyp_finalize_rel(ctx, entry);
+
+	return entry->rel;
+}
+
+/*
+ * dphyp_finalize_rel
+ *	  Do what standard_join_search() does once all the ways of making a join
+ *	  rel have been considered.
+ */
+static void
+dphyp_finalize_rel(DPHypContext *ctx, DPHypEntry *entry)
+{
+	RelOptInfo *rel = entry->rel;
+
+	/* Create paths for partitionwise joins. */
+	generate_partitionwise_join_paths(ctx->root, rel);
+
+	/*
+	 * Except for the topmost scan/join rel, consider gathering partial
+	 * paths.  We'll do the same for the topmost scan/join rel once we know
+	 * the final targetlist (see grouping_planner).
+	 */
+	if (entry->nodes != ctx->allnodes)
+		generate_gather_paths(ctx->root, rel, false);
+
+	/* Find and save the cheapest paths for this rel */
+	set_cheapest(rel);
+
+#ifdef OPTIMIZER_DEBUG
+	debug_print_rel(ctx->root, rel);
+#endif
+
+	entry->finalized = true;
+}
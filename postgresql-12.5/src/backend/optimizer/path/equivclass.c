@@ -29,9 +29,31 @@
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 
 
+/*
+ * Once an EC's ec_derives list grows past this many entries, we build a
+ * hashtable over it so that create_join_clause() needn't search it linearly.
+ */
+#define EC_DERIVES_HASH_THRESHOLD	32
+
+/* Hash key and entry for EquivalenceClass.ec_derives_hash */
+typedef struct EcDerivesKey
+{
+	EquivalenceMember *leftem;
+	EquivalenceMember *rightem;
+	EquivalenceClass *parent_ec;
+	Oid			opno;
+} EcDerivesKey;
+
+typedef struct EcDerivesEntry
+{
+	EcDerivesKey key;			/* hash key --- MUST BE FIRST */
+	RestrictInfo *rinfo;
+} EcDerivesEntry;
+
 static EquivalenceMember *add_eq_member(EquivalenceClass *ec,
 										Expr *expr, Relids relids, Relids nullable_relids,
 										bool is_child, Oid datatype);
@@ -64,6 +86,14 @@ static bool reconsider_outer_join_clause(PlannerInfo *root,
 										 bool outer_on_left);
 static bool reconsider_full_join_clause(PlannerInfo *root,
 										RestrictInfo *rinfo);
+static void build_ec_derives_hash(EquivalenceClass *ec, MemoryContext cxt);
+static void ec_derives_hash_insert(EquivalenceClass *ec, RestrictInfo *rinfo);
+static void append_eclass_array_entry(PlannerInfo *root,
+									  EquivalenceClass *ec);
+static Bitmapset *get_eclass_indexes_for_relids(PlannerInfo *root,
+												Relids relids);
+static Bitmapset *get_common_eclass_indexes(PlannerInfo *root, Relids relids1,
+											Relids relids2);
 
 
 /*
@@ -252,6 +282,9 @@ process_equivalence(PlannerInfo *root,
 	 * an item in more than one existing nonvolatile EC.  So it's okay to stop
 	 * at the first match.
 	 */
+	/* We should not see any new ECs being merged once merging is done */
+	Assert(!root->ec_merging_done);
+
 	ec1 = ec2 = NULL;
 	em1 = em2 = NULL;
 	foreach(lc1, root->eq_classes)
@@ -356,6 +389,8 @@ process_equivalence(PlannerInfo *root,
 		 */
 		ec1->ec_members = list_concat(ec1->ec_members, ec2->ec_members);
 		ec1->ec_sources = list_concat(ec1->ec_sources, ec2->ec_sources);
+		/* no derived clauses can have been hashed before merging is done */
+		Assert(ec1->ec_derives_hash == NULL && ec2->ec_derives_hash == NULL);
 		ec1->ec_derives = list_concat(ec1->ec_derives, ec2->ec_derives);
 		ec1->ec_relids = bms_join(ec1->ec_relids, ec2->ec_relids);
 		ec1->ec_has_const |= ec2->ec_has_const;
@@ -431,6 +466,7 @@ process_equivalence(PlannerInfo *root,
 		ec->ec_members = NIL;
 		ec->ec_sources = list_make1(restrictinfo);
 		ec->ec_derives = NIL;
+		ec->ec_derives_hash = NULL;
 		ec->ec_relids = NULL;
 		ec->ec_has_const = false;
 		ec->ec_has_volatile = false;
@@ -692,6 +728,7 @@ get_eclass_for_sort_expr(PlannerInfo *root,
 	newec->ec_members = NIL;
 	newec->ec_sources = NIL;
 	newec->ec_derives = NIL;
+	newec->ec_derives_hash = NULL;
 	newec->ec_relids = NULL;
 	newec->ec_has_const = false;
 	newec->ec_has_volatile = contain_volatile_functions((Node *) expr);
@@ -734,6 +771,29 @@ get_eclass_for_sort_expr(PlannerInfo *root,
 
 	root->eq_classes = lappend(root->eq_classes, newec);
 
+	/*
+	 * If EC merging is already complete, we have to mop up by adding the new
+	 * EC to the eq_class_array and to the eclass_indexes of the relation(s)
+	 * mentioned in it.
+	 */
+	if (root->ec_merging_done)
+	{
+		int			ec_index = list_length(root->eq_classes) - 1;
+		int			i = -1;
+
+		append_eclass_array_entry(root, newec);
+		Assert(root->eq_class_array[ec_index] == newec);
+
+		while ((i = bms_next_member(newec->ec_relids, i)) > 0)
+		{
+			RelOptInfo *rel = root->simple_rel_array[i];
+
+			Assert(rel != NULL);
+			rel->eclass_indexes = bms_add_member(rel->eclass_indexes,
+												 ec_index);
+		}
+	}
+
 	MemoryContextSwitchTo(oldcontext);
 
 	return newec;
@@ -791,9 +851,50 @@ get_eclass_for_sort_expr(PlannerInfo *root,
 void
 generate_base_implied_equalities(PlannerInfo *root)
 {
+	int			ec_index;
 	ListCell   *lc;
 	Index		rti;
 
+	/*
+	 * At this point, we're done absorbing knowledge of equivalences in the
+	 * query, so no further EC merging should happen, and ECs remaining in the
+	 * eq_classes list can be considered canonical.  (But note that it's still
+	 * possible for new single-member ECs to be added through
+	 * get_eclass_for_sort_expr().)
+	 */
+	root->ec_merging_done = true;
+
+	/*
+	 * Now that the set of ECs is stable, build the eq_class_array and mark
+	 * each base rel cited in an EC (these should all exist by now) with the
+	 * array indexes of all the ECs mentioning it.  This lets later searches
+	 * for the ECs relevant to a given rel or join visit only those ECs,
+	 * rather than every EC in the query.  We do this in a separate pass
+	 * because generating the implied equalities below could add new ECs.
+	 */
+	root->eq_class_array_size = Max(list_length(root->eq_classes) * 2, 16);
+	root->eq_class_array = (EquivalenceClass **)
+		palloc(root->eq_class_array_size * sizeof(EquivalenceClass *));
+
+	ec_index = 0;
+	foreach(lc, root->eq_classes)
+	{
+		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc);
+		int			i = -1;
+
+		root->eq_class_array[ec_index] = ec;
+
+		while ((i = bms_next_member(ec->ec_relids, i)) > 0)
+		{
+			RelOptInfo *rel = root->simple_rel_array[i];
+
+			Assert(rel != NULL);
+			rel->eclass_indexes = bms_add_member(rel->eclass_indexes,
+												 ec_index);
+		}
+		ec_index++;
+	}
+
 	foreach(lc, root->eq_classes)
 	{
 		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc);
@@ -1064,11 +1165,41 @@ generate_join_implied_equalities(PlannerInfo *root,
 								 Relids outer_relids,
 								 RelOptInfo *inner_rel)
 {
-	return generate_join_implied_equalities_for_ecs(root,
-													root->eq_classes,
-													join_relids,
-													outer_relids,
-													inner_rel);
+	List	   *result;
+	List	   *eclasses = NIL;
+	Relids		nominal_inner_relids;
+	Bitmapset  *matching_ecs;
+	int			i;
+
+	/*
+	 * Only ECs mentioning both sides of the join can produce join clauses,
+	 * so use the per-rel eclass_indexes to pick those out rather than
+	 * passing down the whole eq_classes list.  As in
+	 * generate_join_implied_equalities_for_ecs, ECs are marked with the
+	 * topmost parent's relid if the inner rel is a child.
+	 */
+	if (IS_OTHER_REL(inner_rel))
+		nominal_inner_relids = inner_rel->top_parent_relids;
+	else
+		nominal_inner_relids = inner_rel->relids;
+
+	matching_ecs = get_common_eclass_indexes(root, nominal_inner_relids,
+											 outer_relids);
+
+	i = -1;
+	while ((i = bms_next_member(matching_ecs, i)) >= 0)
+		eclasses = lappend(eclasses, root->eq_class_array[i]);
+
+	result = generate_join_implied_equalities_for_ecs(root,
+													  eclasses,
+													  join_relids,
+													  outer_relids,
+													  inner_rel);
+
+	list_free(eclasses);
+	bms_free(matching_ecs);
+
+	return result;
 }
 
 /*
@@ -1433,14 +1564,35 @@ create_join_clause(PlannerInfo *root,
 			return rinfo;
 	}
 
-	foreach(lc, ec->ec_derives)
+	if (ec->ec_derives_hash)
 	{
-		rinfo = (RestrictInfo *) lfirst(lc);
-		if (rinfo->left_em == leftem &&
-			rinfo->right_em == rightem &&
-			rinfo->parent_ec == parent_ec &&
-			opno == ((OpExpr *) rinfo->clause)->opno)
-			return rinfo;
+		EcDerivesKey key;
+		EcDerivesEntry *hentry;
+
+		/* zero the padding bytes, since the key is hashed as a blob */
+		MemSet(&key, 0, sizeof(key));
+		key.leftem = leftem;
+		key.rightem = rightem;
+		key.parent_ec = parent_ec;
+		key.opno = opno;
+		hentry = (EcDerivesEntry *) hash_search(ec->ec_derives_hash,
+												&key,
+												HASH_FIND,
+												NULL);
+		if (hentry)
+			return hentry->rinfo;
+	}
+	else
+	{
+		foreach(lc, ec->ec_derives)
+		{
+			rinfo = (RestrictInfo *) lfirst(lc);
+			if (rinfo->left_em == leftem &&
+				rinfo->right_em == rightem &&
+				rinfo->parent_ec == parent_ec &&
+				opno == ((OpExpr *) rinfo->clause)->opno)
+				return rinfo;
+		}
 	}
 
 	/*
@@ -1474,6 +1626,10 @@ create_join_clause(PlannerInfo *root,
 	rinfo->right_em = rightem;
 	/* and save it for possible re-use */
 	ec->ec_derives = lappend(ec->ec_derives, rinfo);
+	if (ec->ec_derives_hash)
+		ec_derives_hash_insert(ec, rinfo);
+	else if (list_length(ec->ec_derives) > EC_DERIVES_HASH_THRESHOLD)
+		build_ec_derives_hash(ec, root->planner_cxt);
 
 	MemoryContextSwitchTo(oldcontext);
 
@@ -2027,12 +2183,23 @@ match_eclasses_to_foreign_key_col(PlannerInfo *root,
 	Index		var2varno = fkinfo->ref_relid;
 	AttrNumber	var2attno = fkinfo->confkey[colno];
 	Oid			eqop = fkinfo->conpfeqop[colno];
+	RelOptInfo *rel1 = root->simple_rel_array[var1varno];
+	RelOptInfo *rel2 = root->simple_rel_array[var2varno];
 	List	   *opfamilies = NIL;	/* compute only if needed */
-	ListCell   *lc1;
-
-	foreach(lc1, root->eq_classes)
+	Bitmapset  *matching_ecs;
+	int			i;
+
+	/* Consider only eclasses mentioning both relations */
+	Assert(root->ec_merging_done);
+	Assert(IS_SIMPLE_REL(rel1));
+	Assert(IS_SIMPLE_REL(rel2));
+	matching_ecs = bms_intersect(rel1->eclass_indexes,
+								 rel2->eclass_indexes);
+
+	i = -1;
+	while ((i = bms_next_member(matching_ecs, i)) >= 0)
 	{
-		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc1);
+		EquivalenceClass *ec = root->eq_class_array[i];
 		bool		item1member = false;
 		bool		item2member = false;
 		ListCell   *lc2;
@@ -2117,13 +2284,21 @@ add_child_rel_equivalences(PlannerInfo *root,
 {
 	Relids		top_parent_relids = child_rel->top_parent_relids;
 	Relids		child_relids = child_rel->relids;
-	ListCell   *lc1;
+	Bitmapset  *matching_ecs;
+	int			i;
 
 	Assert(IS_SIMPLE_REL(parent_rel));
 
-	foreach(lc1, root->eq_classes)
+	/*
+	 * We need only look at the ECs mentioning the topmost parent rel, which
+	 * are exactly those listed in its eclass_indexes.
+	 */
+	matching_ecs = get_eclass_indexes_for_relids(root, top_parent_relids);
+
+	i = -1;
+	while ((i = bms_next_member(matching_ecs, i)) >= 0)
 	{
-		EquivalenceClass *cur_ec = (EquivalenceClass *) lfirst(lc1);
+		EquivalenceClass *cur_ec = root->eq_class_array[i];
 		ListCell   *lc2;
 
 		/*
@@ -2211,6 +2386,10 @@ add_child_rel_equivalences(PlannerInfo *root,
 				(void) add_eq_member(cur_ec, child_expr,
 									 new_relids, new_nullable_relids,
 									 true, cur_em->em_datatype);
+
+				/* Record this EC index for the child rel */
+				child_rel->eclass_indexes =
+					bms_add_member(child_rel->eclass_indexes, i);
 			}
 		}
 	}
@@ -2234,8 +2413,9 @@ add_child_join_rel_equivalences(PlannerInfo *root,
 {
 	Relids		top_parent_relids = child_joinrel->top_parent_relids;
 	Relids		child_relids = child_joinrel->relids;
+	Bitmapset  *matching_ecs;
 	MemoryContext oldcontext;
-	ListCell   *lc1;
+	int			i;
 
 	Assert(IS_JOIN_REL(child_joinrel) && IS_JOIN_REL(parent_joinrel));
 
@@ -2249,9 +2429,13 @@ add_child_join_rel_equivalences(PlannerInfo *root,
 	 */
 	oldcontext = MemoryContextSwitchTo(root->planner_cxt);
 
-	foreach(lc1, root->eq_classes)
+	/* We need consider only ECs that mention the parent joinrel */
+	matching_ecs = get_eclass_indexes_for_relids(root, top_parent_relids);
+
+	i = -1;
+	while ((i = bms_next_member(matching_ecs, i)) >= 0)
 	{
-		EquivalenceClass *cur_ec = (EquivalenceClass *) lfirst(lc1);
+		EquivalenceClass *cur_ec = root->eq_class_array[i];
 		ListCell   *lc2;
 
 		/*
@@ -2383,7 +2567,7 @@ generate_implied_equalities_for_column(PlannerInfo *root,
 	List	   *result = NIL;
 	bool		is_child_rel = (rel->reloptkind == RELOPT_OTHER_MEMBER_REL);
 	Relids		parent_relids;
-	ListCell   *lc1;
+	int			i;
 
 	/* Indexes are available only on base or "other" member relations. */
 	Assert(IS_SIMPLE_REL(rel));
@@ -2394,9 +2578,17 @@ generate_implied_equalities_for_column(PlannerInfo *root,
 	else
 		parent_relids = NULL;	/* not used, but keep compiler quiet */
 
-	foreach(lc1, root->eq_classes)
+	/*
+	 * The rel's eclass_indexes lists every EC with a member mentioning it;
+	 * for a child rel, those are the ECs it was given child members in by
+	 * add_child_rel_equivalences.  No other EC can match the target column.
+	 */
+	Assert(root->ec_merging_done);
+
+	i = -1;
+	while ((i = bms_next_member(rel->eclass_indexes, i)) >= 0)
 	{
-		EquivalenceClass *cur_ec = (EquivalenceClass *) lfirst(lc1);
+		EquivalenceClass *cur_ec = root->eq_class_array[i];
 		EquivalenceMember *cur_em;
 		ListCell   *lc2;
 
@@ -2508,11 +2700,18 @@ bool
 have_relevant_eclass_joinclause(PlannerInfo *root,
 								RelOptInfo *rel1, RelOptInfo *rel2)
 {
-	ListCell   *lc1;
+	Bitmapset  *matching_ecs;
+	bool		result = false;
+	int			i;
 
-	foreach(lc1, root->eq_classes)
+	/* Examine only eclasses mentioning both rel1 and rel2 */
+	matching_ecs = get_common_eclass_indexes(root, rel1->relids,
+											 rel2->relids);
+
+	i = -1;
+	while ((i = bms_next_member(matching_ecs, i)) >= 0)
 	{
-		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc1);
+		EquivalenceClass *ec = root->eq_class_array[i];
 
 		/*
 		 * Won't generate joinclauses if single-member (this test covers the
@@ -2543,10 +2742,15 @@ have_relevant_eclass_joinclause(PlannerInfo *root,
 		 */
 		if (bms_overlap(rel1->relids, ec->ec_relids) &&
 			bms_overlap(rel2->relids, ec->ec_relids))
-			return true;
+		{
+			result = true;
+			break;
+		}
 	}
 
-	return false;
+	bms_free(matching_ecs);
+
+	return result;
 }
 
 
@@ -2561,11 +2765,17 @@ have_relevant_eclass_joinclause(PlannerInfo *root,
 bool
 has_relevant_eclass_joinclause(PlannerInfo *root, RelOptInfo *rel1)
 {
-	ListCell   *lc1;
+	Bitmapset  *matching_ecs;
+	bool		result = false;
+	int			i;
 
-	foreach(lc1, root->eq_classes)
+	/* Examine only eclasses mentioning rel1 */
+	matching_ecs = get_eclass_indexes_for_relids(root, rel1->relids);
+
+	i = -1;
+	while ((i = bms_next_member(matching_ecs, i)) >= 0)
 	{
-		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc1);
+		EquivalenceClass *ec = root->eq_class_array[i];
 
 		/*
 		 * Won't generate joinclauses if single-member (this test covers the
@@ -2580,10 +2790,15 @@ has_relevant_eclass_joinclause(PlannerInfo *root, RelOptInfo *rel1)
 		 */
 		if (bms_overlap(rel1->relids, ec->ec_relids) &&
 			!bms_is_subset(ec->ec_relids, rel1->relids))
-			return true;
+		{
+			result = true;
+			break;
+		}
 	}
 
-	return false;
+	bms_free(matching_ecs);
+
+	return result;
 }
 
 
@@ -2712,3 +2927,140 @@ is_redundant_with_indexclauses(RestrictInfo *rinfo, List *indexclauses)
 
 	return false;
 }
+
+
+/*
+ * append_eclass_array_entry
+ *	  Add an EC to the end of root->eq_class_array, enlarging it if needed.
+ *
+ * The caller must already have appended the EC to root->eq_classes, and is
+ * responsible for being in a suitably long-lived memory context.
+ */
+static void
+append_eclass_array_entry(PlannerInfo *root, EquivalenceClass *ec)
+{
+	int			ec_index = list_length(root->eq_classes) - 1;
+
+	Assert(root->ec_merging_done);
+
+	if (ec_index >= root->eq_class_array_size)
+	{
+		root->eq_class_array_size *= 2;
+		root->eq_class_array = (EquivalenceClass **)
+			repalloc(root->eq_class_array,
+					 root->eq_class_array_size * sizeof(EquivalenceClass *));
+	}
+	root->eq_class_array[ec_index] = ec;
+}
+
+/*
+ * get_eclass_indexes_for_relids
+ *		Build and return a Bitmapset containing the indexes into root's
+ *		eq_class_array for all eclasses that mention any of these relids
+ */
+static Bitmapset *
+get_eclass_indexes_for_relids(PlannerInfo *root, Relids relids)
+{
+	Bitmapset  *ec_indexes = NULL;
+	int			i = -1;
+
+	/* Should be OK to rely on eclass_indexes */
+	Assert(root->ec_merging_done);
+
+	while ((i = bms_next_member(relids, i)) > 0)
+	{
+		RelOptInfo *rel = root->simple_rel_array[i];
+
+		Assert(rel != NULL);
+		ec_indexes = bms_add_members(ec_indexes, rel->eclass_indexes);
+	}
+	return ec_indexes;
+}
+
+/*
+ * get_common_eclass_indexes
+ *		Build and return a Bitmapset containing the indexes into root's
+ *		eq_class_array for all eclasses that mention rels in both relids1
+ *		and relids2
+ */
+static Bitmapset *
+get_common_eclass_indexes(PlannerInfo *root, Relids relids1, Relids relids2)
+{
+	/* Calculate the eclass_indexes for relids1 */
+	Bitmapset  *rel1ecs = get_eclass_indexes_for_relids(root, relids1);
+	Bitmapset  *rel2ecs;
+	int			relid;
+
+	/*
+	 * We can get away with just using the relation's eclass_indexes directly
+	 * when relids2 is a singleton set.
+	 */
+	if (bms_get_singleton_member(relids2, &relid))
+		return bms_int_members(rel1ecs,
+							   root->simple_rel_array[relid]->eclass_indexes);
+
+	/* Calculate the eclass_indexes for relids2 */
+	rel2ecs = get_eclass_indexes_for_relids(root, relids2);
+
+	/* Get the indexes of the eclasses common to both relids1 and relids2 */
+	rel1ecs = bms_int_members(rel1ecs, rel2ecs);
+	bms_free(rel2ecs);
+
+	return rel1ecs;
+}
+
+/*
+ * build_ec_derives_hash
+ *	  Construct the auxiliary hash table for an EC's derived clauses.
+ *
+ * The hashtable must live as long as the EC does, so it's created in the
+ * given (planner) context even during GEQO.
+ */
+static void
+build_ec_derives_hash(EquivalenceClass *ec, MemoryContext cxt)
+{
+	HASHCTL		hash_ctl;
+	ListCell   *lc;
+
+	Assert(ec->ec_derives_hash == NULL);
+
+	MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(EcDerivesKey);
+	hash_ctl.entrysize = sizeof(EcDerivesEntry);
+	hash_ctl.hcxt = cxt;
+	ec->ec_derives_hash = hash_create("EcDerivesHashTable",
+									  64L,
+									  &hash_ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	/* Insert all the already-existing derived clauses */
+	foreach(lc, ec->ec_derives)
+		ec_derives_hash_insert(ec, (RestrictInfo *) lfirst(lc));
+}
+
+/*
+ * ec_derives_hash_insert
+ *	  Add a derived clause to its EC's ec_derives_hash.
+ *
+ * If an equivalent entry is already present we keep it, so that lookups
+ * return the same clause a search of the ec_derives list would.
+ */
+static void
+ec_derives_hash_insert(EquivalenceClass *ec, RestrictInfo *rinfo)
+{
+	EcDerivesKey key;
+	EcDerivesEntry *hentry;
+	bool		found;
+
+	MemSet(&key, 0, sizeof(key));
+	key.leftem = rinfo->left_em;
+	key.rightem = rinfo->right_em;
+	key.parent_ec = rinfo->parent_ec;
+	key.opno = ((OpExpr *) rinfo->clause)->opno;
+	hentry = (EcDerivesEntry *) hash_search(ec->ec_derives_hash,
+											&key,
+											HASH_ENTER,
+											&found);
+	if (!found)
+		hentry->rinfo = rinfo;
+}
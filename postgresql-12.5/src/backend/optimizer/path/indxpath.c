@@ -1042,11 +1042,14 @@ build_index_paths(PlannerInfo *root, RelOptInfo *rel,
 
 		/*
 		 * If appropriate, consider parallel index scan.  We don't allow
-		 * parallel index scan for bitmap index scans.
+		 * parallel index scan for bitmap index scans.  Nor for scans
+		 * ordered by an ordering operator: the participants divide the
+		 * index pages among themselves as they go, so none of them could
+		 * return its rows in distance order.
 		 */
 		if (index->amcanparallel &&
 			rel->consider_parallel && outer_relids == NULL &&
-			scantype != ST_BITMAPSCAN)
+			scantype != ST_BITMAPSCAN && orderbyclauses == NIL)
 		{
 			ipath = create_index_path(root, index,
 									  index_clauses,
@@ -18,10 +18,15 @@
 
 #include "executor/executor.h"
 #include "foreign/fdwapi.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
+#include "optimizer/restrictinfo.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
 
 /* Hook for plugins to get control in add_paths_to_joinrel() */
 set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
@@ -39,6 +44,10 @@ set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
 #define PATH_PARAM_BY_REL(path, rel)	\
 	(PATH_PARAM_BY_REL_SELF(path, rel) || PATH_PARAM_BY_PARENT(path, rel))
 
+static Path *get_resultcache_path(PlannerInfo *root, RelOptInfo *innerrel,
+								  RelOptInfo *outerrel, Path *inner_path,
+								  Path *outer_path, JoinType jointype,
+								  JoinPathExtraData *extra);
 static void try_partial_mergejoin_path(PlannerInfo *root,
 									   RelOptInfo *joinrel,
 									   Path *outer_path,
@@ -866,6 +875,149 @@ clause_sides_match_join(RestrictInfo *rinfo, RelOptInfo *outerrel,
 	return false;				/* no good for these input relations */
 }
 
+/*
+ * paraminfo_get_equal_hashops
+ *		Determine if the clauses in param_info can be used as cache keys for
+ *		a ResultCache node, i.e. each one has the form
+ *		"outerrel_expr op innerrel_expr" and the outer expression's type can
+ *		be hashed and compared for equality.
+ *
+ * When this returns true, *param_exprs is set to the outer expressions and
+ * *operators to the equality operators to compare them with.
+ */
+static bool
+paraminfo_get_equal_hashops(ParamPathInfo *param_info, RelOptInfo *outerrel,
+							RelOptInfo *innerrel, List **param_exprs,
+							List **operators)
+{
+	ListCell   *lc;
+
+	*param_exprs = NIL;
+	*operators = NIL;
+
+	foreach(lc, param_info->ppi_clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		OpExpr	   *opexpr;
+		Node	   *expr;
+		TypeCacheEntry *typentry;
+
+		if (!is_opclause(rinfo->clause) ||
+			list_length(((OpExpr *) rinfo->clause)->args) != 2 ||
+			!clause_sides_match_join(rinfo, outerrel, innerrel))
+			return false;
+
+		opexpr = (OpExpr *) rinfo->clause;
+
+		if (rinfo->outer_is_left)
+			expr = (Node *) linitial(opexpr->args);
+		else
+			expr = (Node *) lsecond(opexpr->args);
+
+		if (contain_volatile_functions(expr))
+			return false;
+
+		/* the caching needs a hashable equality operator for the type */
+		typentry = lookup_type_cache(exprType(expr),
+									 TYPECACHE_HASH_PROC | TYPECACHE_EQ_OPR);
+		if (!OidIsValid(typentry->hash_proc) ||
+			!OidIsValid(typentry->eq_opr) ||
+			!op_hashjoinable(typentry->eq_opr, exprType(expr)))
+			return false;
+
+		*operators = lappend_oid(*operators, typentry->eq_opr);
+		*param_exprs = lappend(*param_exprs, expr);
+	}
+
+	return *param_exprs != NIL;
+}
+
+/*
+ * get_resultcache_path
+ *		If possible, make and return a Result Cache path atop of 'inner_path'.
+ *		Otherwise return NULL.
+ */
+static Path *
+get_resultcache_path(PlannerInfo *root, RelOptInfo *innerrel,
+					 RelOptInfo *outerrel, Path *inner_path,
+					 Path *outer_path, JoinType jointype,
+					 JoinPathExtraData *extra)
+{
+	List	   *param_exprs;
+	List	   *hash_operators;
+	bool		singlerow = false;
+	ListCell   *lc;
+
+	/* Obviously not if it's disabled */
+	if (!enable_resultcache)
+		return NULL;
+
+	/*
+	 * We can safely not bother with all this unless we expect to perform
+	 * more than one inner scan.  The first scan is always going to be a
+	 * cache miss.  This would likely fail later anyway based on costs, so
+	 * this is really just to save some wasted effort.
+	 */
+	if (outer_path->parent->rows < 2)
+		return NULL;
+
+	/*
+	 * We can only have a result cache when the inner side is a base relation
+	 * parameterized by the outer relation alone, so that the parameterized
+	 * path clauses fully determine the result of each inner scan.  Lateral
+	 * references would be parameters we don't use as cache keys.
+	 */
+	if (inner_path->param_info == NULL ||
+		inner_path->param_info->ppi_clauses == NIL ||
+		innerrel->reloptkind != RELOPT_BASEREL ||
+		!bms_is_empty(innerrel->lateral_relids) ||
+		!bms_is_subset(PATH_REQ_OUTER(inner_path), outerrel->relids))
+		return NULL;
+
+	/*
+	 * A nested loop that stops after the first match for each outer tuple
+	 * won't read most inner scans to completion, leaving the cache entries
+	 * incomplete.  If all the join clauses are enforced by the inner path
+	 * itself, the first tuple it returns is the match; in that case we can
+	 * mark each entry complete once it holds a single tuple.  Otherwise the
+	 * cache would only rarely be usable.
+	 */
+	if (extra->inner_unique || jointype == JOIN_SEMI || jointype == JOIN_ANTI)
+	{
+		foreach(lc, extra->restrictlist)
+		{
+			if (!list_member_ptr(inner_path->param_info->ppi_clauses,
+								 lfirst(lc)))
+				return NULL;
+		}
+		singlerow = true;
+	}
+
+	/*
+	 * Caching would give wrong answers if the inner side produced different
+	 * results for the same parameter values.
+	 */
+	if (contain_volatile_functions((Node *) innerrel->baserestrictinfo) ||
+		contain_volatile_functions((Node *) innerrel->reltarget->exprs) ||
+		contain_volatile_functions((Node *) inner_path->param_info->ppi_clauses))
+		return NULL;
+
+	/* Check if we have hash ops for each parameter to the path */
+	if (paraminfo_get_equal_hashops(inner_path->param_info, outerrel,
+									innerrel, &param_exprs, &hash_operators))
+	{
+		return (Path *) create_resultcache_path(root,
+												innerrel,
+												inner_path,
+												param_exprs,
+												hash_operators,
+												singlerow,
+												outer_path->rows);
+	}
+
+	return NULL;
+}
+
 /*
  * sort_inner_and_outer
  *	  Create mergejoin join paths by explicitly sorting both the outer and
@@ -1471,6 +1623,7 @@ match_unsorted_outer(PlannerInfo *root,
 			foreach(lc2, innerrel->cheapest_parameterized_paths)
 			{
 				Path	   *innerpath = (Path *) lfirst(lc2);
+				Path	   *rcpath;
 
 				try_nestloop_path(root,
 								  joinrel,
@@ -1479,6 +1632,22 @@ match_unsorted_outer(PlannerInfo *root,
 								  merge_pathkeys,
 								  jointype,
 								  extra);
+
+				/*
+				 * Try generating a result cache path and see if that makes
+				 * the nested loop any cheaper.
+				 */
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_nestloop_path(root,
+									  joinrel,
+									  outerpath,
+									  rcpath,
+									  merge_pathkeys,
+									  jointype,
+									  extra);
 			}
 
 			/* Also consider materialized form of the cheapest inner path */
@@ -1634,6 +1803,7 @@ consider_parallel_nestloop(PlannerInfo *root,
 		foreach(lc2, innerrel->cheapest_parameterized_paths)
 		{
 			Path	   *innerpath = (Path *) lfirst(lc2);
+			Path	   *rcpath;
 
 			/* Can't join to an inner path that is not parallel-safe */
 			if (!innerpath->parallel_safe)
@@ -1658,6 +1828,17 @@ consider_parallel_nestloop(PlannerInfo *root,
 
 			try_partial_nestloop_path(root, joinrel, outerpath, innerpath,
 									  pathkeys, jointype, extra);
+
+			/*
+			 * Try generating a result cache path and see if that makes the
+			 * nested loop any cheaper.
+			 */
+			rcpath = get_resultcache_path(root, innerrel, outerrel,
+										  innerpath, outerpath, jointype,
+										  extra);
+			if (rcpath != NULL)
+				try_partial_nestloop_path(root, joinrel, outerpath, rcpath,
+										  pathkeys, jointype, extra);
 		}
 	}
 }
@@ -1683,6 +1864,7 @@ hash_inner_and_outer(PlannerInfo *root,
 {
 	JoinType	save_jointype = jointype;
 	bool		isouterjoin = IS_OUTER_JOIN(jointype);
+	bool		nullaware = false;
 	List	   *hashclauses;
 	ListCell   *l;
 
@@ -1715,6 +1897,21 @@ hash_inner_and_outer(PlannerInfo *root,
 		if (!clause_sides_match_join(restrictinfo, outerrel, innerrel))
 			continue;			/* no good for these input relations */
 
+		/*
+		 * A null-aware "(outer op inner) IS NOT FALSE" test, made from a NOT
+		 * IN sublink, can only be hashed by an anti join that has no other
+		 * join clauses: the executor then emits nothing once the inner side
+		 * is seen to contain a NULL key, and drops NULL outer keys unless
+		 * the inner side is empty.
+		 */
+		if (get_nullaware_opclause(restrictinfo->clause) != NULL)
+		{
+			if (jointype != JOIN_ANTI ||
+				list_length(extra->restrictlist) != 1)
+				continue;
+			nullaware = true;
+		}
+
 		hashclauses = lappend(hashclauses, restrictinfo);
 	}
 
@@ -1843,18 +2040,11 @@ hash_inner_and_outer(PlannerInfo *root,
 		 * If the joinrel is parallel-safe, we may be able to consider a
 		 * partial hash join.  However, we can't handle JOIN_UNIQUE_OUTER,
 		 * because the outer path will be partial, and therefore we won't be
-		 * able to properly guarantee uniqueness.  Similarly, we can't handle
-		 * JOIN_FULL and JOIN_RIGHT, because they can produce false null
-		 * extended rows.  Also, the resulting path must not be parameterized.
-		 * We would be able to support JOIN_FULL and JOIN_RIGHT for Parallel
-		 * Hash, since in that case we're back to a single hash table with a
-		 * single set of match bits for each batch, but that will require
-		 * figuring out a deadlock-free way to wait for the probe to finish.
+		 * able to properly guarantee uniqueness.  Also, the resulting path
+		 * must not be parameterized.
 		 */
 		if (joinrel->consider_parallel &&
 			save_jointype != JOIN_UNIQUE_OUTER &&
-			save_jointype != JOIN_FULL &&
-			save_jointype != JOIN_RIGHT &&
 			outerrel->partial_pathlist != NIL &&
 			bms_is_empty(joinrel->lateral_relids))
 		{
@@ -1868,10 +2058,17 @@ hash_inner_and_outer(PlannerInfo *root,
 			/*
 			 * Can we use a partial inner plan too, so that we can build a
 			 * shared hash table in parallel?  We can't handle
-			 * JOIN_UNIQUE_INNER because we can't guarantee uniqueness.
+			 * JOIN_UNIQUE_INNER because we can't guarantee uniqueness, nor a
+			 * null-aware anti join because it would need to know whether any
+			 * participant saw a NULL inner key.  This
+			 * is also the only way to do JOIN_FULL and JOIN_RIGHT in
+			 * parallel: there's then a single hash table with a single set of
+			 * match bits for each batch, and one participant emits the
+			 * unmatched inner tuples once the probing is done.
 			 */
 			if (innerrel->partial_pathlist != NIL &&
 				save_jointype != JOIN_UNIQUE_INNER &&
+				!nullaware &&
 				enable_parallel_hash)
 			{
 				cheapest_partial_inner =
@@ -1888,9 +2085,13 @@ hash_inner_and_outer(PlannerInfo *root,
 			 * total inner path will also be parallel-safe, but if not, we'll
 			 * have to search for the cheapest safe, unparameterized inner
 			 * path.  If doing JOIN_UNIQUE_INNER, we can't use any alternative
-			 * inner path.
+			 * inner path.  If full or right join, we can't use parallelism
+			 * (building the hash table in each backend) because no one
+			 * process has all the match bits.
 			 */
-			if (cheapest_total_inner->parallel_safe)
+			if (save_jointype == JOIN_FULL || save_jointype == JOIN_RIGHT)
+				cheapest_safe_inner = NULL;
+			else if (cheapest_total_inner->parallel_safe)
 				cheapest_safe_inner = cheapest_total_inner;
 			else if (save_jointype != JOIN_UNIQUE_INNER)
 				cheapest_safe_inner =
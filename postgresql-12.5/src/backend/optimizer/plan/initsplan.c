@@ -2614,6 +2614,8 @@ check_mergejoinable(RestrictInfo *restrictinfo)
  *	  Currently, we support hashjoin for binary opclauses where
  *	  the operator is a hashjoinable operator.  The arguments can be
  *	  anything --- as long as there are no volatile functions in them.
+ *	  "(a op b) IS NOT FALSE" tests made from NOT IN sublinks are accepted
+ *	  too, but only a null-aware hash anti join can use them.
  */
 static void
 check_hashjoinable(RestrictInfo *restrictinfo)
@@ -2624,6 +2626,8 @@ check_hashjoinable(RestrictInfo *restrictinfo)
 
 	if (restrictinfo->pseudoconstant)
 		return;
+	if (get_nullaware_opclause(clause) != NULL)
+		clause = get_nullaware_opclause(clause);
 	if (!is_opclause(clause))
 		return;
 	if (list_length(((OpExpr *) clause)->args) != 2)
@@ -57,6 +57,7 @@
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "parser/parse_agg.h"
+#include "parser/parse_oper.h"
 #include "partitioning/partdesc.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/dsm_impl.h"
@@ -184,13 +185,30 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
-static void create_one_window_path(PlannerInfo *root,
-								   RelOptInfo *window_rel,
-								   Path *path,
-								   PathTarget *input_target,
-								   PathTarget *output_target,
-								   WindowFuncLists *wflists,
-								   List *activeWindows);
+static Path *create_one_window_path(PlannerInfo *root,
+									RelOptInfo *window_rel,
+									Path *path,
+									PathTarget *input_target,
+									PathTarget *output_target,
+									WindowFuncLists *wflists,
+									List *activeWindows);
+static void create_parallel_window_paths(PlannerInfo *root,
+										 RelOptInfo *input_rel,
+										 RelOptInfo *window_rel,
+										 PathTarget *input_target,
+										 PathTarget *output_target,
+										 WindowFuncLists *wflists,
+										 List *activeWindows);
+static void add_parallel_window_path(PlannerInfo *root,
+									 RelOptInfo *window_rel,
+									 Path *input_path,
+									 int parallel_workers,
+									 double total_rows,
+									 List *hashClauses,
+									 PathTarget *input_target,
+									 PathTarget *output_target,
+									 WindowFuncLists *wflists,
+									 List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
@@ -231,6 +249,19 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root,
 							const AggClauseCosts *agg_costs);
+static void create_eager_agg_paths(PlannerInfo *root, RelOptInfo *input_rel,
+								   RelOptInfo *grouped_rel, double dNumGroups,
+								   GroupPathExtraData *extra);
+static void create_eager_agg_paths_for_rel(PlannerInfo *root,
+										   RelOptInfo *input_rel,
+										   RelOptInfo *grouped_rel,
+										   RelOptInfo *agg_rel,
+										   RelOptInfo *other_rel,
+										   PathTarget *join_target,
+										   List *aggrefs, List *upper_vars,
+										   const AggClauseCosts *agg_final_costs,
+										   double dNumGroups,
+										   GroupPathExtraData *extra);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
 										   RelOptInfo *rel,
 										   List *scanjoin_targets,
@@ -286,9 +317,16 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	RelOptInfo *final_rel;
 	Path	   *best_path;
 	Plan	   *top_plan;
+	AttStatsSlotCache *stats_cache;
 	ListCell   *lp,
 			   *lr;
 
+	/*
+	 * Estimating the same clauses for many paths keeps looking up the same
+	 * statistics; keep what we've deconstructed until we're done.
+	 */
+	stats_cache = begin_attstatsslot_cache();
+
 	/*
 	 * Set up global state for this planner invocation.  This data is needed
 	 * across all levels of sub-Query that might exist in the given command,
@@ -305,6 +343,7 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	glob->finalrowmarks = NIL;
 	glob->resultRelations = NIL;
 	glob->rootResultRelations = NIL;
+	glob->prunableRelids = NULL;
 	glob->relationOids = NIL;
 	glob->invalItems = NIL;
 	glob->paramExecTypes = NIL;
@@ -506,6 +545,24 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 		lfirst(lp) = set_plan_references(subroot, subplan);
 	}
 
+	/*
+	 * Relations that are opened by executor startup regardless of pruning,
+	 * result relations and relations with row marks, must always be locked.
+	 */
+	if (glob->prunableRelids != NULL)
+	{
+		foreach(lp, glob->resultRelations)
+			glob->prunableRelids = bms_del_member(glob->prunableRelids,
+												  lfirst_int(lp));
+		foreach(lp, glob->finalrowmarks)
+		{
+			PlanRowMark *rc = lfirst_node(PlanRowMark, lp);
+
+			glob->prunableRelids = bms_del_member(glob->prunableRelids,
+												  rc->rti);
+		}
+	}
+
 	/* build the PlannedStmt result */
 	result = makeNode(PlannedStmt);
 
@@ -521,6 +578,7 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	result->rtable = glob->finalrtable;
 	result->resultRelations = glob->resultRelations;
 	result->rootResultRelations = glob->rootResultRelations;
+	result->prunableRelids = glob->prunableRelids;
 	result->subplans = glob->subplans;
 	result->rewindPlanIDs = glob->rewindPlanIDs;
 	result->rowMarks = glob->finalrowmarks;
@@ -560,6 +618,8 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	if (glob->partition_directory != NULL)
 		DestroyPartitionDirectory(glob->partition_directory);
 
+	end_attstatsslot_cache(stats_cache);
+
 	return result;
 }
 
@@ -618,6 +678,9 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	root->cte_plan_ids = NIL;
 	root->multiexpr_params = NIL;
 	root->eq_classes = NIL;
+	root->ec_merging_done = false;
+	root->eq_class_array = NULL;
+	root->eq_class_array_size = 0;
 	root->append_rel_list = NIL;
 	root->rowMarks = NIL;
 	memset(root->upper_rels, 0, sizeof(root->upper_rels));
@@ -635,6 +698,18 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	root->non_recursive_path = NULL;
 	root->partColsUpdated = false;
 
+	/*
+	 * Decide whether the executor may buffer the rows of a plain INSERT and
+	 * store them in batches.  That's not safe if a volatile function might
+	 * look at the target table and expect to see the rows inserted so far
+	 * (nextval() is harmless, though).  We must check this before sublinks
+	 * are turned into SubPlans, since we couldn't look inside those later.
+	 */
+	root->multiInsertSafe = (parse->commandType == CMD_INSERT &&
+							 parse->onConflict == NULL &&
+							 parse->returningList == NIL &&
+							 !contain_volatile_functions_not_nextval((Node *) parse));
+
 	/*
 	 * If there is a WITH list, process each WITH query and either convert it
 	 * to RTE_SUBQUERY RTE(s) or build an initplan SubPlan structure for it.
@@ -4150,6 +4225,9 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 							  partially_grouped_rel, agg_costs, gd,
 							  dNumGroups, extra);
 
+	/* Consider aggregating partially below the join, too */
+	create_eager_agg_paths(root, input_rel, grouped_rel, dNumGroups, extra);
+
 	/* Give a helpful error if we failed to find any implementation */
 	if (grouped_rel->pathlist == NIL)
 		ereport(ERROR,
@@ -4584,15 +4662,30 @@ create_window_paths(PlannerInfo *root,
 
 		if (path == input_rel->cheapest_total_path ||
 			pathkeys_contained_in(root->window_pathkeys, path->pathkeys))
-			create_one_window_path(root,
-								   window_rel,
-								   path,
-								   input_target,
-								   output_target,
-								   wflists,
-								   activeWindows);
+			add_path(window_rel,
+					 create_one_window_path(root,
+											window_rel,
+											path,
+											input_target,
+											output_target,
+											wflists,
+											activeWindows));
 	}
 
+	/*
+	 * If the windows are partitioned, consider splitting the rows among
+	 * parallel workers by the partitioning columns.
+	 */
+	if (window_rel->consider_parallel && enable_parallel_window &&
+		max_parallel_workers_per_gather > 0)
+		create_parallel_window_paths(root,
+									 input_rel,
+									 window_rel,
+									 input_target,
+									 output_target,
+									 wflists,
+									 activeWindows);
+
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
 	 * let it consider adding ForeignPaths.
@@ -4616,16 +4709,16 @@ create_window_paths(PlannerInfo *root,
 
 /*
  * Stack window-function implementation steps atop the given Path, and
- * add the result to window_rel.
+ * return the topmost one.
  *
- * window_rel: upperrel to contain result
+ * window_rel: upperrel the result belongs to
  * path: input Path to use (must return input_target)
  * input_target: result of make_window_input_target
  * output_target: what the topmost WindowAggPath should return
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
  */
-static void
+static Path *
 create_one_window_path(PlannerInfo *root,
 					   RelOptInfo *window_rel,
 					   Path *path,
@@ -4705,7 +4798,146 @@ create_one_window_path(PlannerInfo *root,
 								  wc);
 	}
 
-	add_path(window_rel, path);
+	return path;
+}
+
+/*
+ * create_parallel_window_paths
+ *
+ * Consider evaluating the window functions in parallel workers.  We have no
+ * partial input that is already divided by the partitioning columns, so we
+ * put a Repartition node atop an input path.  Over the cheapest partial
+ * path, it exchanges rows between the workers so that each gets the rows
+ * whose partitioning columns hash to it.  Over the cheapest non-partial
+ * path, it runs that path in each participant and keeps only the rows whose
+ * partitioning columns hash to that participant's share; that pays off
+ * only when the window functions are expensive compared to producing the
+ * input again in each participant.  Either way, every window partition is
+ * then seen in full by exactly one participant, and the usual Sort/WindowAgg
+ * steps can run unchanged above it.
+ *
+ * This needs columns that all of the windows are partitioned by, and that
+ * can be hashed.
+ */
+static void
+create_parallel_window_paths(PlannerInfo *root,
+							 RelOptInfo *input_rel,
+							 RelOptInfo *window_rel,
+							 PathTarget *input_target,
+							 PathTarget *output_target,
+							 WindowFuncLists *wflists,
+							 List *activeWindows)
+{
+	Path	   *cheapest_path = input_rel->cheapest_total_path;
+	List	   *hashClauses = NIL;
+	ListCell   *lc;
+
+	/*
+	 * Collect the partitioning columns common to all windows.  Clauses of
+	 * different windows referring to the same column with the same equality
+	 * operator split the rows the same way.
+	 */
+	foreach(lc, activeWindows)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+		List	   *common = NIL;
+		ListCell   *lc2;
+
+		foreach(lc2, wc->partitionClause)
+		{
+			SortGroupClause *sgc = lfirst_node(SortGroupClause, lc2);
+			ListCell   *lc3;
+
+			if (!sgc->hashable)
+				continue;
+
+			if (lc == list_head(activeWindows))
+			{
+				common = lappend(common, sgc);
+				continue;
+			}
+
+			foreach(lc3, hashClauses)
+			{
+				SortGroupClause *prev = lfirst_node(SortGroupClause, lc3);
+
+				if (prev->tleSortGroupRef == sgc->tleSortGroupRef &&
+					prev->eqop == sgc->eqop)
+				{
+					common = lappend(common, prev);
+					break;
+				}
+			}
+		}
+
+		hashClauses = common;
+		if (hashClauses == NIL)
+			return;
+	}
+
+	if (input_rel->partial_pathlist != NIL)
+	{
+		Path	   *partial_path = linitial(input_rel->partial_pathlist);
+
+		add_parallel_window_path(root, window_rel, partial_path,
+								 partial_path->parallel_workers,
+								 partial_path->rows * partial_path->parallel_workers,
+								 hashClauses, input_target, output_target,
+								 wflists, activeWindows);
+	}
+
+	if (cheapest_path->parallel_safe && cheapest_path->param_info == NULL)
+		add_parallel_window_path(root, window_rel, cheapest_path,
+								 max_parallel_workers_per_gather,
+								 cheapest_path->rows,
+								 hashClauses, input_target, output_target,
+								 wflists, activeWindows);
+}
+
+/*
+ * add_parallel_window_path
+ *
+ * Build window-function steps atop a Repartition of the given input path,
+ * and add the result to window_rel as a partial path, and under a Gather
+ * (and if sorted, a Gather Merge) as complete paths.
+ *
+ * total_rows is the number of rows the input path produces in all.
+ */
+static void
+add_parallel_window_path(PlannerInfo *root,
+						 RelOptInfo *window_rel,
+						 Path *input_path,
+						 int parallel_workers,
+						 double total_rows,
+						 List *hashClauses,
+						 PathTarget *input_target,
+						 PathTarget *output_target,
+						 WindowFuncLists *wflists,
+						 List *activeWindows)
+{
+	Path	   *path;
+
+	path = (Path *) create_repartition_path(root, window_rel, input_path,
+											hashClauses, parallel_workers);
+	path = create_one_window_path(root,
+								  window_rel,
+								  path,
+								  input_target,
+								  output_target,
+								  wflists,
+								  activeWindows);
+	add_partial_path(window_rel, path);
+
+	add_path(window_rel, (Path *)
+			 create_gather_path(root, window_rel, path, output_target,
+								NULL, &total_rows));
+
+	/* keep the window ordering if anything above might want it */
+	if (path->pathkeys != NIL)
+		add_path(window_rel, (Path *)
+				 create_gather_merge_path(root, window_rel, path,
+										  output_target, path->pathkeys,
+										  NULL, &total_rows));
 }
 
 /*
@@ -4962,11 +5194,14 @@ create_ordered_paths(PlannerInfo *root,
 
 	foreach(lc, input_rel->pathlist)
 	{
-		Path	   *path = (Path *) lfirst(lc);
+		Path	   *input_path = (Path *) lfirst(lc);
+		Path	   *path = input_path;
 		bool		is_sorted;
+		int			presorted_keys;
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												path->pathkeys,
+												&presorted_keys);
 		if (path == cheapest_input_path || is_sorted)
 		{
 			if (!is_sorted)
@@ -4986,6 +5221,28 @@ create_ordered_paths(PlannerInfo *root,
 
 			add_path(ordered_rel, path);
 		}
+
+		/*
+		 * If the path is sorted by a prefix of the required ordering, an
+		 * incremental sort only has to sort the groups of tuples with equal
+		 * prefix keys, and can stop early under a LIMIT.  Try that too.
+		 */
+		if (enable_incremental_sort && !is_sorted && presorted_keys > 0)
+		{
+			path = (Path *) create_incremental_sort_path(root,
+														 ordered_rel,
+														 input_path,
+														 root->sort_pathkeys,
+														 presorted_keys,
+														 limit_tuples);
+
+			/* Add projection step if needed */
+			if (path->pathtarget != target)
+				path = apply_projection_to_path(root, ordered_rel,
+												path, target);
+
+			add_path(ordered_rel, path);
+		}
 	}
 
 	/*
@@ -5013,7 +5270,7 @@ create_ordered_paths(PlannerInfo *root,
 								   cheapest_partial_path->pathkeys))
 		{
 			Path	   *path;
-			double		total_groups;
+			double		total_rows;
 
 			path = (Path *) create_sort_path(root,
 											 ordered_rel,
@@ -5021,14 +5278,14 @@ create_ordered_paths(PlannerInfo *root,
 											 root->sort_pathkeys,
 											 limit_tuples);
 
-			total_groups = cheapest_partial_path->rows *
+			total_rows = cheapest_partial_path->rows *
 				cheapest_partial_path->parallel_workers;
 			path = (Path *)
 				create_gather_merge_path(root, ordered_rel,
 										 path,
 										 path->pathtarget,
 										 root->sort_pathkeys, NULL,
-										 &total_groups);
+										 &total_rows);
 
 			/* Add projection step if needed */
 			if (path->pathtarget != target)
@@ -6229,7 +6486,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be a btree, gin or
+ * brin index).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6306,7 +6564,7 @@ plan_create_index_workers(Oid tableOid, Oid indexOid)
 	 * Furthermore, any index predicate or index expressions must be parallel
 	 * safe.
 	 */
-	if (heap->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+	if (RelationUsesLocalBuffers(heap) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexExpressions(index)) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexPredicate(index)))
 	{
@@ -6523,34 +6781,41 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 
 			/*
 			 * Provided that the estimated size of the hashtable does not
-			 * exceed work_mem, we'll generate a HashAgg Path, although if we
-			 * were unable to sort above, then we'd better generate a Path, so
-			 * that we at least have one.
+			 * exceed work_mem, or enable_hashagg_disk allows it to spill,
+			 * we'll generate a HashAgg Path, although if we were unable to
+			 * sort above, then we'd better generate a Path, so that we at
+			 * least have one.
 			 */
 			if (hashaggtablesize < work_mem * 1024L ||
+				enable_hashagg_disk ||
 				grouped_rel->pathlist == NIL)
 			{
+				Path	   *aggpath;
+
 				/*
 				 * We just need an Agg over the cheapest-total input path,
 				 * since input order won't matter.
 				 */
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root, grouped_rel,
-										 cheapest_path,
-										 grouped_rel->reltarget,
-										 AGG_HASHED,
-										 AGGSPLIT_SIMPLE,
-										 parse->groupClause,
-										 havingQual,
-										 agg_costs,
-										 dNumGroups));
+				aggpath = (Path *)
+					create_agg_path(root, grouped_rel,
+									cheapest_path,
+									grouped_rel->reltarget,
+									AGG_HASHED,
+									AGGSPLIT_SIMPLE,
+									parse->groupClause,
+									havingQual,
+									agg_costs,
+									dNumGroups);
+				cost_hashagg_spill(aggpath, cheapest_path, hashaggtablesize);
+				add_path(grouped_rel, aggpath);
 			}
 		}
 
 		/*
 		 * Generate a Finalize HashAgg Path atop of the cheapest partially
 		 * grouped path, assuming there is one. Once again, we'll only do this
-		 * if it looks as though the hash table won't exceed work_mem.
+		 * if it looks as though the hash table won't exceed work_mem, unless
+		 * enable_hashagg_disk allows it.
 		 */
 		if (partially_grouped_rel && partially_grouped_rel->pathlist)
 		{
@@ -6560,18 +6825,24 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 														  agg_final_costs,
 														  dNumGroups);
 
-			if (hashaggtablesize < work_mem * 1024L)
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root,
-										 grouped_rel,
-										 path,
-										 grouped_rel->reltarget,
-										 AGG_HASHED,
-										 AGGSPLIT_FINAL_DESERIAL,
-										 parse->groupClause,
-										 havingQual,
-										 agg_final_costs,
-										 dNumGroups));
+			if (hashaggtablesize < work_mem * 1024L || enable_hashagg_disk)
+			{
+				Path	   *aggpath;
+
+				aggpath = (Path *)
+					create_agg_path(root,
+									grouped_rel,
+									path,
+									grouped_rel->reltarget,
+									AGG_HASHED,
+									AGGSPLIT_FINAL_DESERIAL,
+									parse->groupClause,
+									havingQual,
+									agg_final_costs,
+									dNumGroups);
+				cost_hashagg_spill(aggpath, path, hashaggtablesize);
+				add_path(grouped_rel, aggpath);
+			}
 		}
 	}
 
@@ -6827,22 +7098,27 @@ create_partial_grouping_paths(PlannerInfo *root,
 
 		/*
 		 * Tentatively produce a partial HashAgg Path, depending on if it
-		 * looks as if the hash table will fit in work_mem.
+		 * looks as if the hash table will fit in work_mem or
+		 * enable_hashagg_disk allows it to spill.
 		 */
-		if (hashaggtablesize < work_mem * 1024L &&
+		if ((hashaggtablesize < work_mem * 1024L || enable_hashagg_disk) &&
 			cheapest_total_path != NULL)
 		{
-			add_path(partially_grouped_rel, (Path *)
-					 create_agg_path(root,
-									 partially_grouped_rel,
-									 cheapest_total_path,
-									 partially_grouped_rel->reltarget,
-									 AGG_HASHED,
-									 AGGSPLIT_INITIAL_SERIAL,
-									 parse->groupClause,
-									 NIL,
-									 agg_partial_costs,
-									 dNumPartialGroups));
+			Path	   *aggpath;
+
+			aggpath = (Path *)
+				create_agg_path(root,
+								partially_grouped_rel,
+								cheapest_total_path,
+								partially_grouped_rel->reltarget,
+								AGG_HASHED,
+								AGGSPLIT_INITIAL_SERIAL,
+								parse->groupClause,
+								NIL,
+								agg_partial_costs,
+								dNumPartialGroups);
+			cost_hashagg_spill(aggpath, cheapest_total_path, hashaggtablesize);
+			add_path(partially_grouped_rel, aggpath);
 		}
 	}
 
@@ -6856,20 +7132,25 @@ create_partial_grouping_paths(PlannerInfo *root,
 									   dNumPartialPartialGroups);
 
 		/* Do the same for partial paths. */
-		if (hashaggtablesize < work_mem * 1024L &&
+		if ((hashaggtablesize < work_mem * 1024L || enable_hashagg_disk) &&
 			cheapest_partial_path != NULL)
 		{
-			add_partial_path(partially_grouped_rel, (Path *)
-							 create_agg_path(root,
-											 partially_grouped_rel,
-											 cheapest_partial_path,
-											 partially_grouped_rel->reltarget,
-											 AGG_HASHED,
-											 AGGSPLIT_INITIAL_SERIAL,
-											 parse->groupClause,
-											 NIL,
-											 agg_partial_costs,
-											 dNumPartialPartialGroups));
+			Path	   *aggpath;
+
+			aggpath = (Path *)
+				create_agg_path(root,
+								partially_grouped_rel,
+								cheapest_partial_path,
+								partially_grouped_rel->reltarget,
+								AGG_HASHED,
+								AGGSPLIT_INITIAL_SERIAL,
+								parse->groupClause,
+								NIL,
+								agg_partial_costs,
+								dNumPartialPartialGroups);
+			cost_hashagg_spill(aggpath, cheapest_partial_path,
+							   hashaggtablesize);
+			add_partial_path(partially_grouped_rel, aggpath);
 		}
 	}
 
@@ -6918,9 +7199,9 @@ gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel)
 							   cheapest_partial_path->pathkeys))
 	{
 		Path	   *path;
-		double		total_groups;
+		double		total_rows;
 
-		total_groups =
+		total_rows =
 			cheapest_partial_path->rows * cheapest_partial_path->parallel_workers;
 		path = (Path *) create_sort_path(root, rel, cheapest_partial_path,
 										 root->group_pathkeys,
@@ -6932,12 +7213,430 @@ gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel)
 									 rel->reltarget,
 									 root->group_pathkeys,
 									 NULL,
-									 &total_groups);
+									 &total_rows);
 
 		add_path(rel, path);
 	}
 }
 
+/*
+ * create_eager_agg_paths
+ *
+ * Consider "eager aggregation": partially aggregate one input of a two-way
+ * inner join below the join, grouping it by the columns it is joined on,
+ * and finalize the aggregation above the join.  When many rows of the
+ * aggregated input join to each row of the other one, as with a fact table
+ * joined to a dimension table, this shrinks the join input dramatically.
+ *
+ * This is only valid if every aggregate refers to the aggregated input
+ * alone, and that input's Vars are needed above the join only as equijoin
+ * keys or as plain GROUP BY columns.  All the rows folded into one partial
+ * group then join to exactly the same rows of the other input, so combining
+ * the partial state once per joined row gives the same result as
+ * aggregating the joined rows.  The paths are added to grouped_rel and
+ * compete on cost with the ordinary ones.
+ */
+static void
+create_eager_agg_paths(PlannerInfo *root, RelOptInfo *input_rel,
+					   RelOptInfo *grouped_rel, double dNumGroups,
+					   GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	PathTarget *join_target;
+	AggClauseCosts agg_final_costs;
+	List	   *aggrefs = NIL;
+	List	   *upper_vars = NIL;
+	Relids		agg_relids = NULL;
+	RelOptInfo *rel1;
+	RelOptInfo *rel2;
+	int			relid;
+	ListCell   *lc;
+
+	/* We only handle two-way inner joins of base relations */
+	if (!enable_eager_aggregate ||
+		!parse->hasAggs ||
+		parse->groupClause == NIL ||
+		parse->groupingSets ||
+		(extra->flags & GROUPING_CAN_PARTIAL_AGG) == 0 ||
+		input_rel->reloptkind != RELOPT_JOINREL ||
+		bms_num_members(input_rel->relids) != 2 ||
+		root->join_info_list != NIL ||
+		root->placeholder_list != NIL)
+		return;
+
+	relid = bms_next_member(input_rel->relids, -1);
+	rel1 = find_base_rel(root, relid);
+	rel2 = find_base_rel(root, bms_next_member(input_rel->relids, relid));
+	if (!bms_is_empty(rel1->lateral_relids) ||
+		!bms_is_empty(rel2->lateral_relids))
+		return;
+
+	/*
+	 * The join has to supply what the finalizing aggregation needs: the
+	 * grouping expressions, the Vars used in the rest of the target list and
+	 * in HAVING, and the partial aggregates.
+	 */
+	join_target = make_partial_grouping_target(root, grouped_rel->reltarget,
+											   extra->havingQual);
+
+	foreach(lc, join_target->exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		if (IsA(expr, Aggref))
+		{
+			aggrefs = lappend(aggrefs, expr);
+			agg_relids = bms_add_members(agg_relids, pull_varnos(expr));
+		}
+	}
+	foreach(lc, pull_var_clause((Node *) join_target->exprs,
+								PVC_INCLUDE_AGGREGATES))
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		if (IsA(expr, Var))
+			upper_vars = lappend(upper_vars, expr);
+	}
+
+	MemSet(&agg_final_costs, 0, sizeof(AggClauseCosts));
+	get_agg_clause_costs(root, (Node *) grouped_rel->reltarget->exprs,
+						 AGGSPLIT_FINAL_DESERIAL, &agg_final_costs);
+	get_agg_clause_costs(root, extra->havingQual,
+						 AGGSPLIT_FINAL_DESERIAL, &agg_final_costs);
+
+	/*
+	 * Try aggregating whichever side the aggregates refer to.  If they don't
+	 * refer to either (say, only count(*)), either side will do.
+	 */
+	if (bms_is_subset(agg_relids, rel1->relids))
+		create_eager_agg_paths_for_rel(root, input_rel, grouped_rel,
+									   rel1, rel2, join_target, aggrefs,
+									   upper_vars, &agg_final_costs,
+									   dNumGroups, extra);
+	if (bms_is_subset(agg_relids, rel2->relids))
+		create_eager_agg_paths_for_rel(root, input_rel, grouped_rel,
+									   rel2, rel1, join_target, aggrefs,
+									   upper_vars, &agg_final_costs,
+									   dNumGroups, extra);
+}
+
+/*
+ * create_eager_agg_paths_for_rel
+ *
+ * Workhorse for create_eager_agg_paths: build the paths that partially
+ * aggregate agg_rel below its join to other_rel.
+ */
+static void
+create_eager_agg_paths_for_rel(PlannerInfo *root, RelOptInfo *input_rel,
+							   RelOptInfo *grouped_rel,
+							   RelOptInfo *agg_rel, RelOptInfo *other_rel,
+							   PathTarget *join_target, List *aggrefs,
+							   List *upper_vars,
+							   const AggClauseCosts *agg_final_costs,
+							   double dNumGroups, GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	List	   *restrictlist;
+	List	   *keys = NIL;
+	List	   *key_eqops = NIL;
+	List	   *groupClause = NIL;
+	PathTarget *input_target;
+	PathTarget *partial_target;
+	AggClauseCosts agg_partial_costs;
+	RelOptInfo *partial_rel;
+	RelOptInfo *join_rel;
+	Path	   *partial_path;
+	SpecialJoinInfo sjinfo;
+	JoinPathExtraData jextra;
+	double		numPartialGroups;
+	Index		maxref;
+	int			i;
+	ListCell   *lc;
+	ListCell   *lc2;
+
+	/*
+	 * Collect the clauses joining the two relations.  Each must be a
+	 * hashable equality with a plain Var of agg_rel on one side; those Vars
+	 * become partial grouping keys, grouped by an equality operator that
+	 * agrees with the join operator.
+	 */
+	restrictlist = generate_join_implied_equalities(root, input_rel->relids,
+													other_rel->relids,
+													agg_rel);
+	foreach(lc, agg_rel->joininfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (bms_is_subset(rinfo->required_relids, input_rel->relids))
+			restrictlist = lappend(restrictlist, rinfo);
+	}
+	if (restrictlist == NIL)
+		return;
+
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		Node	   *keyexpr;
+		Oid			sortop;
+		Oid			eqop;
+		bool		hashable;
+		bool		found;
+		ListCell   *lc3;
+
+		if (!rinfo->can_join ||
+			!OidIsValid(rinfo->hashjoinoperator) ||
+			rinfo->mergeopfamilies == NIL)
+			return;
+
+		if (bms_is_subset(rinfo->left_relids, agg_rel->relids) &&
+			bms_is_subset(rinfo->right_relids, other_rel->relids))
+			keyexpr = get_leftop(rinfo->clause);
+		else if (bms_is_subset(rinfo->left_relids, other_rel->relids) &&
+				 bms_is_subset(rinfo->right_relids, agg_rel->relids))
+			keyexpr = get_rightop(rinfo->clause);
+		else
+			return;
+
+		if (!IsA(keyexpr, Var))
+			return;
+
+		get_sort_group_operators(exprType(keyexpr), false, true, false,
+								 &sortop, &eqop, NULL, &hashable);
+		if (!hashable)
+			return;
+
+		found = false;
+		foreach(lc3, rinfo->mergeopfamilies)
+		{
+			if (op_in_opfamily(eqop, lfirst_oid(lc3)))
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return;
+
+		if (!list_member(keys, keyexpr))
+		{
+			keys = lappend(keys, keyexpr);
+			key_eqops = lappend_oid(key_eqops, eqop);
+		}
+	}
+
+	/*
+	 * agg_rel's Vars used above the join must be grouped on as they are, and
+	 * with the same operator, by the final aggregation.
+	 */
+	foreach(lc, upper_vars)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		SortGroupClause *match = NULL;
+
+		if (!bms_is_member(var->varno, agg_rel->relids))
+			continue;
+
+		foreach(lc2, parse->groupClause)
+		{
+			SortGroupClause *sgc = (SortGroupClause *) lfirst(lc2);
+
+			if (equal(get_sortgroupclause_expr(sgc, parse->targetList), var))
+			{
+				match = sgc;
+				break;
+			}
+		}
+		if (match == NULL || !match->hashable)
+			return;
+
+		i = 0;
+		foreach(lc2, keys)
+		{
+			if (equal(lfirst(lc2), var))
+				break;
+			i++;
+		}
+		if (lc2 == NULL)
+		{
+			keys = lappend(keys, var);
+			key_eqops = lappend_oid(key_eqops, match->eqop);
+		}
+		else if (list_nth_oid(key_eqops, i) != match->eqop)
+			return;
+	}
+
+	/* It's not worth it unless the partial aggregation reduces the rows */
+	numPartialGroups = estimate_num_groups(root, keys, agg_rel->rows, NULL);
+	if (numPartialGroups >= agg_rel->rows)
+		return;
+
+	/* Number the partial grouping keys after the query's own sortgrouprefs */
+	maxref = 0;
+	foreach(lc, parse->targetList)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		maxref = Max(maxref, tle->ressortgroupref);
+	}
+
+	/*
+	 * Label the keys in agg_rel's output, and build the target and grouping
+	 * clause of the partial aggregation.
+	 */
+	input_target = copy_pathtarget(agg_rel->reltarget);
+	input_target->sortgrouprefs = (Index *)
+		palloc0(list_length(input_target->exprs) * sizeof(Index));
+	partial_target = create_empty_pathtarget();
+
+	forboth(lc, keys, lc2, key_eqops)
+	{
+		Expr	   *key = (Expr *) lfirst(lc);
+		SortGroupClause *sgc = makeNode(SortGroupClause);
+		ListCell   *lc3;
+
+		sgc->tleSortGroupRef = ++maxref;
+		sgc->eqop = lfirst_oid(lc2);
+		sgc->sortop = InvalidOid;
+		sgc->nulls_first = false;
+		sgc->hashable = true;
+		groupClause = lappend(groupClause, sgc);
+
+		i = 0;
+		foreach(lc3, input_target->exprs)
+		{
+			if (equal(lfirst(lc3), key))
+				break;
+			i++;
+		}
+		if (lc3 == NULL)
+			return;				/* shouldn't happen */
+		input_target->sortgrouprefs[i] = sgc->tleSortGroupRef;
+
+		add_column_to_pathtarget(partial_target, key, sgc->tleSortGroupRef);
+	}
+	foreach(lc, aggrefs)
+		add_column_to_pathtarget(partial_target, (Expr *) lfirst(lc), 0);
+	set_pathtarget_cost_width(root, partial_target);
+
+	MemSet(&agg_partial_costs, 0, sizeof(AggClauseCosts));
+	get_agg_clause_costs(root, (Node *) aggrefs, AGGSPLIT_INITIAL_SERIAL,
+						 &agg_partial_costs);
+
+	/*
+	 * The partially aggregated input and the join above it get relations of
+	 * their own, so that their paths can carry the right targets and row
+	 * estimates.  They are not registered anywhere.
+	 */
+	partial_rel = makeNode(RelOptInfo);
+	partial_rel->reloptkind = RELOPT_UPPER_REL;
+	partial_rel->relids = bms_copy(agg_rel->relids);
+	partial_rel->reltarget = partial_target;
+	partial_rel->rows = numPartialGroups;
+
+	join_rel = makeNode(RelOptInfo);
+	join_rel->reloptkind = RELOPT_UPPER_REL;
+	join_rel->relids = bms_copy(input_rel->relids);
+	join_rel->reltarget = join_target;
+	join_rel->rows = clamp_row_est(input_rel->rows * numPartialGroups /
+								   agg_rel->rows);
+
+	partial_path = (Path *) create_projection_path(root, agg_rel,
+												   agg_rel->cheapest_total_path,
+												   input_target);
+	partial_path = (Path *) create_agg_path(root, partial_rel, partial_path,
+											partial_target,
+											AGG_HASHED,
+											AGGSPLIT_INITIAL_SERIAL,
+											groupClause,
+											NIL,
+											&agg_partial_costs,
+											numPartialGroups);
+
+	/* Join it to the other relation, hashing either side */
+	sjinfo.type = T_SpecialJoinInfo;
+	sjinfo.min_lefthand = agg_rel->relids;
+	sjinfo.min_righthand = other_rel->relids;
+	sjinfo.syn_lefthand = agg_rel->relids;
+	sjinfo.syn_righthand = other_rel->relids;
+	sjinfo.jointype = JOIN_INNER;
+	/* we don't bother trying to make the remaining fields valid */
+	sjinfo.lhs_strict = false;
+	sjinfo.delay_upper_joins = false;
+	sjinfo.semi_can_btree = false;
+	sjinfo.semi_can_hash = false;
+	sjinfo.semi_operators = NIL;
+	sjinfo.semi_rhs_exprs = NIL;
+
+	MemSet(&jextra, 0, sizeof(JoinPathExtraData));
+	jextra.restrictlist = restrictlist;
+	jextra.sjinfo = &sjinfo;
+
+	for (i = 0; i < 2; i++)
+	{
+		Path	   *outer_path;
+		Path	   *inner_path;
+		Path	   *join_path;
+		JoinCostWorkspace workspace;
+
+		if (i == 0)
+		{
+			outer_path = partial_path;
+			inner_path = other_rel->cheapest_total_path;
+		}
+		else
+		{
+			outer_path = other_rel->cheapest_total_path;
+			inner_path = partial_path;
+		}
+
+		foreach(lc, restrictlist)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+			rinfo->outer_is_left = bms_is_subset(rinfo->left_relids,
+												 outer_path->parent->relids);
+		}
+
+		initial_cost_hashjoin(root, &workspace, JOIN_INNER, restrictlist,
+							  outer_path, inner_path, &jextra, false);
+		join_path = (Path *) create_hashjoin_path(root, join_rel, JOIN_INNER,
+												  &workspace, &jextra,
+												  outer_path, inner_path,
+												  false,
+												  restrictlist,
+												  NULL,
+												  restrictlist);
+
+		/* Finalize the aggregation above the join */
+		if ((extra->flags & GROUPING_CAN_USE_HASH) != 0)
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel, join_path,
+									 grouped_rel->reltarget,
+									 AGG_HASHED,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 parse->groupClause,
+									 (List *) extra->havingQual,
+									 agg_final_costs,
+									 dNumGroups));
+		if ((extra->flags & GROUPING_CAN_USE_SORT) != 0)
+		{
+			Path	   *path;
+
+			path = (Path *) create_sort_path(root, grouped_rel, join_path,
+											 root->group_pathkeys, -1.0);
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel, path,
+									 grouped_rel->reltarget,
+									 AGG_SORTED,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 parse->groupClause,
+									 (List *) extra->havingQual,
+									 agg_final_costs,
+									 dNumGroups));
+		}
+	}
+}
+
 /*
  * can_partial_agg
  *
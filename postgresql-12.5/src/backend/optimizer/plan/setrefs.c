@@ -107,6 +107,7 @@ static Plan *set_append_references(PlannerInfo *root,
 static Plan *set_mergeappend_references(PlannerInfo *root,
 										MergeAppend *mplan,
 										int rtoffset);
+static void record_prunable_relids(PlannerInfo *root, List *subplans);
 static void set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static Node *fix_scan_expr(PlannerInfo *root, Node *node, int rtoffset);
 static Node *fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context);
@@ -548,6 +549,19 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 					fix_scan_list(root, splan->tidquals, rtoffset);
 			}
 			break;
+		case T_TidRangeScan:
+			{
+				TidRangeScan *splan = (TidRangeScan *) plan;
+
+				splan->scan.scanrelid += rtoffset;
+				splan->scan.plan.targetlist =
+					fix_scan_list(root, splan->scan.plan.targetlist, rtoffset);
+				splan->scan.plan.qual =
+					fix_scan_list(root, splan->scan.plan.qual, rtoffset);
+				splan->tidrangequals =
+					fix_scan_list(root, splan->tidrangequals, rtoffset);
+			}
+			break;
 		case T_SubqueryScan:
 			/* Needs special treatment, see comments below */
 			return set_subqueryscan_references(root,
@@ -652,8 +666,10 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
+		case T_Repartition:
 
 			/*
 			 * These plan types don't actually bother to evaluate their
@@ -670,6 +686,22 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			 */
 			Assert(plan->qual == NIL);
 			break;
+		case T_ResultCache:
+			{
+				ResultCache *rcplan = (ResultCache *) plan;
+
+				/*
+				 * ResultCache does not evaluate its targetlist.  It just
+				 * uses the same targetlist from its outer subnode.
+				 */
+				set_dummy_tlist_references(plan, rtoffset);
+
+				Assert(plan->qual == NIL);
+
+				rcplan->param_exprs = fix_scan_list(root, rcplan->param_exprs,
+													rtoffset);
+			}
+			break;
 		case T_LockRows:
 			{
 				LockRows   *splan = (LockRows *) plan;
@@ -1340,6 +1372,8 @@ set_append_references(PlannerInfo *root,
 
 	if (aplan->part_prune_info)
 	{
+		bool		initial_pruning = false;
+
 		foreach(l, aplan->part_prune_info->prune_infos)
 		{
 			List	   *prune_infos = lfirst(l);
@@ -1350,8 +1384,13 @@ set_append_references(PlannerInfo *root,
 				PartitionedRelPruneInfo *pinfo = lfirst(l2);
 
 				pinfo->rtindex += rtoffset;
+				if (pinfo->initial_pruning_steps != NIL)
+					initial_pruning = true;
 			}
 		}
+
+		if (initial_pruning)
+			record_prunable_relids(root, aplan->appendplans);
 	}
 
 	/* We don't need to recurse to lefttree or righttree ... */
@@ -1402,6 +1441,8 @@ set_mergeappend_references(PlannerInfo *root,
 
 	if (mplan->part_prune_info)
 	{
+		bool		initial_pruning = false;
+
 		foreach(l, mplan->part_prune_info->prune_infos)
 		{
 			List	   *prune_infos = lfirst(l);
@@ -1412,8 +1453,13 @@ set_mergeappend_references(PlannerInfo *root,
 				PartitionedRelPruneInfo *pinfo = lfirst(l2);
 
 				pinfo->rtindex += rtoffset;
+				if (pinfo->initial_pruning_steps != NIL)
+					initial_pruning = true;
 			}
 		}
+
+		if (initial_pruning)
+			record_prunable_relids(root, mplan->mergeplans);
 	}
 
 	/* We don't need to recurse to lefttree or righttree ... */
@@ -1423,6 +1469,43 @@ set_mergeappend_references(PlannerInfo *root,
 	return (Plan *) mplan;
 }
 
+/*
+ * record_prunable_relids
+ *		Remember the relations scanned directly by the subplans of an Append
+ *		or MergeAppend that does initial partition pruning.
+ *
+ * If initial pruning removes such a subplan, the executor never opens its
+ * relation, so AcquireExecutorLocks() needn't lock it.  We consider only
+ * plain relation scans; anything more complicated is always locked.
+ */
+static void
+record_prunable_relids(PlannerInfo *root, List *subplans)
+{
+	ListCell   *l;
+
+	foreach(l, subplans)
+	{
+		Plan	   *plan = (Plan *) lfirst(l);
+
+		switch (nodeTag(plan))
+		{
+			case T_SeqScan:
+			case T_SampleScan:
+			case T_IndexScan:
+			case T_IndexOnlyScan:
+			case T_BitmapHeapScan:
+			case T_TidScan:
+			case T_TidRangeScan:
+				root->glob->prunableRelids =
+					bms_add_member(root->glob->prunableRelids,
+								   ((Scan *) plan)->scanrelid);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
 /*
  * set_hash_references
  *	   Do set_plan_references processing on a Hash node
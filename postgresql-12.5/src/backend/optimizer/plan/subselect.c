@@ -1222,6 +1222,14 @@ inline_cte_walker(Node *node, inline_cte_walker_context *context)
  * is present in an outer join's ON qual.)  The conversion must fail if
  * the converted qual would reference any but these parent-query relids.
  *
+ * If under_not is true, the caller actually found NOT (ANY SubLink), that is
+ * a NOT IN, so we want to form an anti join.  NOT IN is false rather than
+ * true when the comparison yields NULL, so the join qual becomes
+ * "(a op b) IS NOT FALSE", which a hash join can evaluate by treating NULL
+ * keys specially (see hash_inner_and_outer).  We only do this when the
+ * comparison is a single hashjoinable operator; for multi-column NOT IN a
+ * hashed SubPlan is generally as good as anything we could do here.
+ *
  * On success, the returned JoinExpr has larg = NULL and rarg = the jointree
  * item representing the pulled-up subquery.  The caller must set larg to
  * represent the relation(s) on the lefthand side of the new join, and insert
@@ -1243,7 +1251,7 @@ inline_cte_walker(Node *node, inline_cte_walker_context *context)
  */
 JoinExpr *
 convert_ANY_sublink_to_join(PlannerInfo *root, SubLink *sublink,
-							Relids available_rels)
+							bool under_not, Relids available_rels)
 {
 	JoinExpr   *result;
 	Query	   *parse = root->parse;
@@ -1286,6 +1294,22 @@ convert_ANY_sublink_to_join(PlannerInfo *root, SubLink *sublink,
 	if (contain_volatile_functions(sublink->testexpr))
 		return NULL;
 
+	/*
+	 * For NOT IN, insist on a single hashjoinable comparison; otherwise the
+	 * anti join could only run as a nestloop, which is no better than the
+	 * SubPlan we'd get anyway.
+	 */
+	if (under_not)
+	{
+		OpExpr	   *opexpr = (OpExpr *) sublink->testexpr;
+
+		if (!is_opclause(opexpr) ||
+			list_length(opexpr->args) != 2 ||
+			!op_hashjoinable(opexpr->opno,
+							 exprType((Node *) linitial(opexpr->args))))
+			return NULL;
+	}
+
 	/* Create a dummy ParseState for addRangeTableEntryForSubquery */
 	pstate = make_parsestate(NULL);
 
@@ -1323,11 +1347,21 @@ convert_ANY_sublink_to_join(PlannerInfo *root, SubLink *sublink,
 	 */
 	quals = convert_testexpr(root, sublink->testexpr, subquery_vars);
 
+	if (under_not)
+	{
+		BooleanTest *btest = makeNode(BooleanTest);
+
+		btest->arg = (Expr *) quals;
+		btest->booltesttype = IS_NOT_FALSE;
+		btest->location = -1;
+		quals = (Node *) btest;
+	}
+
 	/*
 	 * And finally, build the JoinExpr node.
 	 */
 	result = makeNode(JoinExpr);
-	result->jointype = JOIN_SEMI;
+	result->jointype = under_not ? JOIN_ANTI : JOIN_SEMI;
 	result->isNatural = false;
 	result->larg = NULL;		/* caller must fill this in */
 	result->rarg = (Node *) rtr;
@@ -2334,6 +2368,12 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			context.paramids = bms_add_members(context.paramids, scan_params);
 			break;
 
+		case T_TidRangeScan:
+			finalize_primnode((Node *) ((TidRangeScan *) plan)->tidrangequals,
+							  &context);
+			context.paramids = bms_add_members(context.paramids, scan_params);
+			break;
+
 		case T_SubqueryScan:
 			{
 				SubqueryScan *sscan = (SubqueryScan *) plan;
@@ -2621,6 +2661,11 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 							  &context);
 			break;
 
+		case T_ResultCache:
+			finalize_primnode((Node *) ((ResultCache *) plan)->param_exprs,
+							  &context);
+			break;
+
 		case T_Limit:
 			finalize_primnode(((Limit *) plan)->limitOffset,
 							  &context);
@@ -2719,9 +2764,11 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_Group:
+		case T_Repartition:
 			/* no node-type-specific fields need fixing */
 			break;
 
@@ -65,6 +65,9 @@ static Node *pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
 static Node *pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 										   Node **jtlink1, Relids available_rels1,
 										   Node **jtlink2, Relids available_rels2);
+static JoinExpr *convert_negated_sublink_to_join(PlannerInfo *root,
+												 SubLink *sublink,
+												 Relids available_rels);
 static Node *pull_up_subqueries_recurse(PlannerInfo *root, Node *jtnode,
 										JoinExpr *lowest_outer_join,
 										JoinExpr *lowest_nulling_outer_join,
@@ -359,6 +362,22 @@ pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
 	return jtnode;
 }
 
+/*
+ * Try to convert NOT EXISTS or NOT IN to an anti join
+ */
+static JoinExpr *
+convert_negated_sublink_to_join(PlannerInfo *root, SubLink *sublink,
+								Relids available_rels)
+{
+	if (sublink->subLinkType == EXISTS_SUBLINK)
+		return convert_EXISTS_sublink_to_join(root, sublink, true,
+											  available_rels);
+	if (sublink->subLinkType == ANY_SUBLINK)
+		return convert_ANY_sublink_to_join(root, sublink, true,
+										   available_rels);
+	return NULL;
+}
+
 /*
  * Recurse through top-level qual nodes for pull_up_sublinks()
  *
@@ -390,7 +409,7 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 		/* Is it a convertible ANY or EXISTS clause? */
 		if (sublink->subLinkType == ANY_SUBLINK)
 		{
-			if ((j = convert_ANY_sublink_to_join(root, sublink,
+			if ((j = convert_ANY_sublink_to_join(root, sublink, false,
 												 available_rels1)) != NULL)
 			{
 				/* Yes; insert the new join node into the join tree */
@@ -416,7 +435,7 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 				return NULL;
 			}
 			if (available_rels2 != NULL &&
-				(j = convert_ANY_sublink_to_join(root, sublink,
+				(j = convert_ANY_sublink_to_join(root, sublink, false,
 												 available_rels2)) != NULL)
 			{
 				/* Yes; insert the new join node into the join tree */
@@ -501,17 +520,18 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 	}
 	if (is_notclause(node))
 	{
-		/* If the immediate argument of NOT is EXISTS, try to convert */
+		/* If the immediate argument of NOT is EXISTS or IN, try to convert */
 		SubLink    *sublink = (SubLink *) get_notclausearg((Expr *) node);
 		JoinExpr   *j;
 		Relids		child_rels;
 
 		if (sublink && IsA(sublink, SubLink))
 		{
-			if (sublink->subLinkType == EXISTS_SUBLINK)
+			if (sublink->subLinkType == EXISTS_SUBLINK ||
+				sublink->subLinkType == ANY_SUBLINK)
 			{
-				if ((j = convert_EXISTS_sublink_to_join(root, sublink, true,
-														available_rels1)) != NULL)
+				if ((j = convert_negated_sublink_to_join(root, sublink,
+														 available_rels1)) != NULL)
 				{
 					/* Yes; insert the new join node into the join tree */
 					j->larg = *jtlink1;
@@ -536,8 +556,8 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 					return NULL;
 				}
 				if (available_rels2 != NULL &&
-					(j = convert_EXISTS_sublink_to_join(root, sublink, true,
-														available_rels2)) != NULL)
+					(j = convert_negated_sublink_to_join(root, sublink,
+														 available_rels2)) != NULL)
 				{
 					/* Yes; insert the new join node into the join tree */
 					j->larg = *jtlink2;
@@ -888,6 +908,9 @@ pull_up_simple_subquery(PlannerInfo *root, Node *jtnode, RangeTblEntry *rte,
 	subroot->cte_plan_ids = NIL;
 	subroot->multiexpr_params = NIL;
 	subroot->eq_classes = NIL;
+	subroot->ec_merging_done = false;
+	subroot->eq_class_array = NULL;
+	subroot->eq_class_array_size = 0;
 	subroot->append_rel_list = NIL;
 	subroot->rowMarks = NIL;
 	memset(subroot->upper_rels, 0, sizeof(subroot->upper_rels));
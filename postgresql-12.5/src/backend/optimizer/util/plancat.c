@@ -95,6 +95,7 @@ static void set_baserel_partition_key_exprs(Relation relation,
  *	pages		number of pages
  *	tuples		number of tuples
  *	rel_parallel_workers user-defined number of parallel workers
+ *	proj_pushdown	if the table AM can skip reading unreferenced columns
  *
  * Also, add information about the relation's foreign keys to root->fkey_list.
  *
@@ -151,6 +152,14 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 	/* Retrieve the parallel_workers reloption, or -1 if not set. */
 	rel->rel_parallel_workers = RelationGetParallelWorkers(relation, -1);
 
+	/* Can the table AM be told which columns a scan needs? */
+	rel->proj_pushdown = (relation->rd_tableam != NULL &&
+						  relation->rd_tableam->scan_set_hints != NULL);
+
+	/* Can it scan a range of TIDs? */
+	rel->tidrange_scan = (relation->rd_tableam != NULL &&
+						  relation->rd_tableam->scan_set_tidrange != NULL);
+
 	/*
 	 * Make list of indexes.  Ignore indexes on system catalogs if told to.
 	 * Don't bother with indexes for an inheritance parent, either.
@@ -110,6 +110,7 @@ make_restrictinfo_internal(Expr *clause,
 						   Relids nullable_relids)
 {
 	RestrictInfo *restrictinfo = makeNode(RestrictInfo);
+	Expr	   *opclause;
 
 	restrictinfo->clause = clause;
 	restrictinfo->orclause = orclause;
@@ -133,12 +134,17 @@ make_restrictinfo_internal(Expr *clause,
 
 	/*
 	 * If it's a binary opclause, set up left/right relids info. In any case
-	 * set up the total clause relids info.
+	 * set up the total clause relids info.  A null-aware "IS NOT FALSE" test
+	 * is treated like the opclause it wraps, so that it can drive a hash
+	 * anti join.
 	 */
-	if (is_opclause(clause) && list_length(((OpExpr *) clause)->args) == 2)
+	opclause = get_nullaware_opclause(clause);
+	if (opclause == NULL)
+		opclause = clause;
+	if (is_opclause(opclause) && list_length(((OpExpr *) opclause)->args) == 2)
 	{
-		restrictinfo->left_relids = pull_varnos(get_leftop(clause));
-		restrictinfo->right_relids = pull_varnos(get_rightop(clause));
+		restrictinfo->left_relids = pull_varnos(get_leftop(opclause));
+		restrictinfo->right_relids = pull_varnos(get_rightop(opclause));
 
 		restrictinfo->clause_relids = bms_union(restrictinfo->left_relids,
 												restrictinfo->right_relids);
@@ -352,6 +358,27 @@ commute_restrictinfo(RestrictInfo *rinfo, Oid comm_op)
 	return result;
 }
 
+/*
+ * get_nullaware_opclause
+ *
+ * If the clause is a "(a op b) IS NOT FALSE" test over a binary opclause,
+ * as generated when converting NOT IN sublinks to anti joins, return the
+ * wrapped opclause.  Otherwise return NULL.
+ */
+Expr *
+get_nullaware_opclause(Expr *clause)
+{
+	BooleanTest *btest = (BooleanTest *) clause;
+
+	if (clause == NULL || !IsA(clause, BooleanTest) ||
+		btest->booltesttype != IS_NOT_FALSE)
+		return NULL;
+	if (!is_opclause(btest->arg) ||
+		list_length(((OpExpr *) btest->arg)->args) != 2)
+		return NULL;
+	return btest->arg;
+}
+
 /*
  * restriction_is_or_clause
  *
@@ -47,17 +47,40 @@ typedef struct PartitionDirectoryEntry
 	PartitionDesc pd;
 } PartitionDirectoryEntry;
 
+static void RelationBuildPartitionDesc(Relation rel);
+
+
+/*
+ * RelationGetPartitionDesc -- get partition descriptor, if relation is partitioned
+ *
+ * The descriptor is built on first use, since doing so takes a scan of
+ * pg_inherits and a lookup of every partition's bound.
+ *
+ * Note: we arrange for partition descriptors to not get freed until the
+ * relcache entry's refcount goes to zero (see hacks in RelationClose,
+ * RelationClearRelation, and RelationBuildPartitionDesc).  Therefore, even
+ * though we hand back a direct pointer into the relcache entry, it's safe
+ * for callers to continue to use that pointer as long as (a) they hold the
+ * relation open, and (b) they hold a relation lock strong enough to ensure
+ * that the data doesn't become stale.
+ */
+PartitionDesc
+RelationGetPartitionDesc(Relation rel)
+{
+	if (rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
+		return NULL;
+
+	if (unlikely(rel->rd_partdesc == NULL))
+		RelationBuildPartitionDesc(rel);
+
+	return rel->rd_partdesc;
+}
+
 /*
  * RelationBuildPartitionDesc
  *		Form rel's partition descriptor, and store in relcache entry
- *
- * Note: the descriptor won't be flushed from the cache by
- * RelationClearRelation() unless it's changed because of
- * addition or removal of a partition.  Hence, code holding a lock
- * that's sufficient to prevent that can assume that rd_partdesc
- * won't change underneath it.
  */
-void
+static void
 RelationBuildPartitionDesc(Relation rel)
 {
 	PartitionDesc partdesc;
@@ -70,6 +93,7 @@ RelationBuildPartitionDesc(Relation rel)
 				nparts;
 	PartitionKey key = RelationGetPartitionKey(rel);
 	MemoryContext oldcxt;
+	MemoryContext old_pdcxt;
 	int		   *mapping;
 
 	/*
@@ -176,8 +200,6 @@ RelationBuildPartitionDesc(Relation rel)
 		++i;
 	}
 
-	/* Assert we aren't about to leak any old data structure */
-	Assert(rel->rd_pdcxt == NULL);
 	Assert(rel->rd_partdesc == NULL);
 
 	/*
@@ -188,12 +210,21 @@ RelationBuildPartitionDesc(Relation rel)
 	 * the entry is rebuilt or destroyed.  However, we don't assign to
 	 * rd_partdesc until the cached data structure is fully complete and
 	 * valid, so that no other code might try to use it.
+	 *
+	 * But first, a kluge: if there's an old rd_pdcxt, it contains an old
+	 * partition descriptor that may still be referenced somewhere.  Preserve
+	 * it, while not leaking it, by reattaching it as a child context of the
+	 * new rd_pdcxt.  Eventually it will get dropped by either RelationClose
+	 * or RelationClearRelation.
 	 */
+	old_pdcxt = rel->rd_pdcxt;
 	rel->rd_pdcxt = AllocSetContextCreate(CacheMemoryContext,
 										  "partition descriptor",
 										  ALLOCSET_SMALL_SIZES);
 	MemoryContextCopyAndSetIdentifier(rel->rd_pdcxt,
 									  RelationGetRelationName(rel));
+	if (old_pdcxt != NULL)
+		MemoryContextSetParent(old_pdcxt, rel->rd_pdcxt);
 
 	partdesc = (PartitionDescData *)
 		MemoryContextAllocZero(rel->rd_pdcxt, sizeof(PartitionDescData));
@@ -0,0 +1,280 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.c
+ *	  Minimal NUMA support for placing shared memory and processes.
+ *
+ * We talk to the kernel directly rather than through libnuma, since all we
+ * need is a memory policy for a few large ranges and a CPU mask per node.
+ * Node topology is read from sysfs.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/port/pg_numa.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "port/pg_numa.h"
+#include "storage/pg_shmem.h"
+
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+#define USE_LINUX_NUMA
+#endif
+
+#ifdef USE_LINUX_NUMA
+
+/* Memory policy modes, from linux/mempolicy.h; these are kernel ABI */
+#define PG_MPOL_PREFERRED	1
+#define PG_MPOL_INTERLEAVE	3
+
+/* Largest node number we are prepared to handle */
+#define PG_NUMA_MAX_NODES	1024
+
+#define NODEMASK_WORDS	(PG_NUMA_MAX_NODES / (8 * sizeof(unsigned long)))
+
+static int	numa_nodes = 0;
+
+/*
+ * Parse a sysfs list such as "0-3,8-11", calling set_bit for each member.
+ * Returns the highest member plus one, or -1 if the list can't be read.
+ */
+static int
+read_sysfs_list(const char *path, void (*set_bit) (int bit, void *arg),
+				void *arg)
+{
+	FILE	   *file;
+	char		buf[4096];
+	char	   *p;
+	int			result = 0;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+	if (fgets(buf, sizeof(buf), file) == NULL)
+	{
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+
+	p = buf;
+	while (*p != '\0' && *p != '\n')
+	{
+		char	   *end;
+		long		first;
+		long		last;
+
+		first = strtol(p, &end, 10);
+		if (end == p || first < 0)
+			return -1;
+		last = first;
+		p = end;
+		if (*p == '-')
+		{
+			p++;
+			last = strtol(p, &end, 10);
+			if (end == p || last < first)
+				return -1;
+			p = end;
+		}
+		for (; first <= last; first++)
+		{
+			if (set_bit)
+				set_bit((int) first, arg);
+		}
+		result = Max(result, (int) last + 1);
+		if (*p == ',')
+			p++;
+	}
+	return result;
+}
+
+static void
+cpu_set_bit(int bit, void *arg)
+{
+	if (bit < CPU_SETSIZE)
+		CPU_SET(bit, (cpu_set_t *) arg);
+}
+
+/*
+ * Memory policies apply to whole pages, so the range is shrunk to the page
+ * boundaries inside it.  When huge pages may be in use, those are the
+ * boundaries that count; aligning to them is also valid for normal pages.
+ */
+static Size
+numa_page_size(void)
+{
+	static Size page_size = 0;
+
+	if (page_size == 0)
+	{
+		page_size = (Size) sysconf(_SC_PAGESIZE);
+
+		if (huge_pages != HUGE_PAGES_OFF)
+		{
+			FILE	   *file = fopen("/proc/meminfo", "r");
+			char		buf[128];
+			unsigned int sz;
+			char		ch;
+
+			if (file != NULL)
+			{
+				while (fgets(buf, sizeof(buf), file))
+				{
+					if (sscanf(buf, "Hugepagesize: %u %c", &sz, &ch) == 2 &&
+						ch == 'k')
+					{
+						page_size = Max(page_size, (Size) sz * 1024);
+						break;
+					}
+				}
+				fclose(file);
+			}
+		}
+	}
+	return page_size;
+}
+
+static bool
+numa_set_policy(void *addr, Size len, int mode, unsigned long *nodemask)
+{
+	Size		page_size = numa_page_size();
+	uintptr_t	start = TYPEALIGN(page_size, (uintptr_t) addr);
+	uintptr_t	end = TYPEALIGN_DOWN(page_size, (uintptr_t) addr + len);
+
+	/* nothing to do if the range doesn't cover a whole page */
+	if (end <= start)
+		return true;
+
+	return syscall(SYS_mbind, (void *) start, (unsigned long) (end - start),
+				   mode, nodemask, (unsigned long) PG_NUMA_MAX_NODES + 1,
+				   0) == 0;
+}
+
+#endif							/* USE_LINUX_NUMA */
+
+/*
+ * pg_numa_num_nodes -- number of NUMA nodes, 1 if unknown
+ */
+int
+pg_numa_num_nodes(void)
+{
+#ifdef USE_LINUX_NUMA
+	if (numa_nodes == 0)
+	{
+		numa_nodes = read_sysfs_list("/sys/devices/system/node/online",
+									 NULL, NULL);
+		numa_nodes = Min(Max(numa_nodes, 1), PG_NUMA_MAX_NODES);
+	}
+	return numa_nodes;
+#else
+	return 1;
+#endif
+}
+
+/*
+ * pg_numa_current_node -- node of the CPU we are running on
+ */
+int
+pg_numa_current_node(void)
+{
+#ifdef USE_LINUX_NUMA
+	unsigned int cpu;
+	unsigned int node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return (int) node;
+#endif
+	return 0;
+}
+
+/*
+ * pg_numa_interleave_memory -- spread pages of a range over nodes
+ *
+ * Pages not yet touched are allocated round-robin on nodes 0..nnodes-1.
+ * Returns false, with errno set, on failure.
+ */
+bool
+pg_numa_interleave_memory(void *addr, Size len, int nnodes)
+{
+#ifdef USE_LINUX_NUMA
+	unsigned long nodemask[NODEMASK_WORDS];
+	int			i;
+
+	memset(nodemask, 0, sizeof(nodemask));
+	for (i = 0; i < nnodes && i < PG_NUMA_MAX_NODES; i++)
+		nodemask[i / (8 * sizeof(unsigned long))] |=
+			1UL << (i % (8 * sizeof(unsigned long)));
+	return numa_set_policy(addr, len, PG_MPOL_INTERLEAVE, nodemask);
+#else
+	return true;
+#endif
+}
+
+/*
+ * pg_numa_bind_memory -- prefer the given node for pages of a range
+ *
+ * We use a preferred rather than a strict binding, so that running out of
+ * memory on one node falls back to the others instead of failing.
+ */
+bool
+pg_numa_bind_memory(void *addr, Size len, int node)
+{
+#ifdef USE_LINUX_NUMA
+	unsigned long nodemask[NODEMASK_WORDS];
+
+	if (node < 0 || node >= PG_NUMA_MAX_NODES)
+		return true;
+	memset(nodemask, 0, sizeof(nodemask));
+	nodemask[node / (8 * sizeof(unsigned long))] |=
+		1UL << (node % (8 * sizeof(unsigned long)));
+	return numa_set_policy(addr, len, PG_MPOL_PREFERRED, nodemask);
+#else
+	return true;
+#endif
+}
+
+/*
+ * pg_numa_bind_process -- run this process on the CPUs of the given node
+ *
+ * Private memory allocated afterwards is preferably taken from that node,
+ * too.  Returns false, with errno set, on failure.
+ */
+bool
+pg_numa_bind_process(int node)
+{
+#ifdef USE_LINUX_NUMA
+	char		path[MAXPGPATH];
+	cpu_set_t	cpus;
+	unsigned long nodemask[NODEMASK_WORDS];
+
+	if (node < 0 || node >= PG_NUMA_MAX_NODES)
+		return false;
+
+	CPU_ZERO(&cpus);
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+			 node);
+	if (read_sysfs_list(path, cpu_set_bit, &cpus) <= 0)
+		return false;
+	if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+		return false;
+
+	memset(nodemask, 0, sizeof(nodemask));
+	nodemask[node / (8 * sizeof(unsigned long))] |=
+		1UL << (node % (8 * sizeof(unsigned long)));
+	return syscall(SYS_set_mempolicy, PG_MPOL_PREFERRED, nodemask,
+				   (unsigned long) PG_NUMA_MAX_NODES + 1) == 0;
+#else
+	errno = ENOSYS;
+	return false;
+#endif
+}
@@ -16,11 +16,14 @@
 
 #include "libpq/pqsignal.h"
 #include "access/parallel.h"
+#include "access/parallelredo.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/waitsampler.h"
+#include "postmaster/walsummarizer.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalworker.h"
 #include "storage/dsm.h"
@@ -129,6 +132,21 @@ static const struct
 	},
 	{
 		"ApplyWorkerMain", ApplyWorkerMain
+	},
+	{
+		"ParallelApplyWorkerMain", ParallelApplyWorkerMain
+	},
+	{
+		"TableSyncChunkWorkerMain", TableSyncChunkWorkerMain
+	},
+	{
+		"ParallelRedoWorkerMain", ParallelRedoWorkerMain
+	},
+	{
+		"WalSummarizerMain", WalSummarizerMain
+	},
+	{
+		"WaitSamplerMain", WaitSamplerMain
 	}
 };
 
@@ -58,6 +58,7 @@
 #include "storage/smgr.h"
 #include "storage/spin.h"
 #include "utils/guc.h"
+#include "utils/hashutils.h"
 #include "utils/memutils.h"
 #include "utils/resowner.h"
 
@@ -100,10 +101,15 @@
  * because the checkpointer failed to absorb their request.
  *
  * The requests array holds fsync requests sent by backends and not yet
- * absorbed by the checkpointer.
+ * absorbed by the checkpointer.  It is followed in shared memory by a small
+ * open-addressing hash index over the SYNC_REQUEST entries in the array,
+ * which lets ForwardSyncRequest drop a request that is already queued
+ * instead of filling the array with duplicates.  An index entry counts as
+ * valid only if its generation matches index_generation, so the whole index
+ * can be emptied just by advancing that counter.
  *
  * Unlike the checkpoint fields, num_backend_writes, num_backend_fsync, and
- * the requests fields are protected by CheckpointerCommLock.
+ * the requests and index fields are protected by CheckpointerCommLock.
  *----------
  */
 typedef struct
@@ -112,6 +118,12 @@ typedef struct
 	FileTag		ftag;			/* file identifier */
 } CheckpointerRequest;
 
+typedef struct
+{
+	uint32		generation;		/* valid if equal to index_generation */
+	int			slot;			/* position of request in requests[] */
+} CheckpointerRequestIndexEntry;
+
 typedef struct
 {
 	pid_t		checkpointer_pid;	/* PID (0 if not started) */
@@ -132,20 +144,34 @@ typedef struct
 
 	int			num_requests;	/* current # of requests */
 	int			max_requests;	/* allocated array size */
+	uint32		index_mask;		/* # of index entries, minus one */
+	uint32		index_generation;	/* current index generation */
 	CheckpointerRequest requests[FLEXIBLE_ARRAY_MEMBER];
 } CheckpointerShmemStruct;
 
 static CheckpointerShmemStruct *CheckpointerShmem;
 
+/* The request index lives right after the requests array */
+#define CheckpointerRequestIndex() \
+	((CheckpointerRequestIndexEntry *) \
+	 &CheckpointerShmem->requests[CheckpointerShmem->max_requests])
+
+/* give up on indexing a request after this many probes */
+#define REQUEST_INDEX_MAX_PROBES	16
+
 /* interval for calling AbsorbSyncRequests in CheckpointWriteDelay */
 #define WRITES_PER_ABSORB		1000
 
+/* max fsyncs per CheckpointWriteDelay nap; see checkpoint_spread_sync */
+#define SYNCS_PER_NAP			4
+
 /*
  * GUC parameters
  */
 int			CheckPointTimeout = 300;
 int			CheckPointWarning = 30;
 double		CheckPointCompletionTarget = 0.5;
+bool		CheckPointSpreadSync = true;
 
 /*
  * Flags set by interrupt handlers for later service in the main loop.
@@ -172,6 +198,10 @@ static void CheckArchiveTimeout(void);
 static bool IsCheckpointOnSchedule(double progress);
 static bool ImmediateCheckpointRequested(void);
 static bool CompactCheckpointerRequestQueue(void);
+static CheckpointerRequestIndexEntry *CheckpointerRequestIndexLookup(const CheckpointerRequest *request,
+																	 bool *found);
+static void CheckpointerRequestIndexInsert(int slot);
+static void ResetCheckpointerRequestIndex(void);
 static void UpdateSharedMemoryConfig(void);
 
 /* Signal handlers */
@@ -687,6 +717,13 @@ CheckpointWriteDelay(int flags, double progress)
 		AbsorbSyncRequests();
 		absorb_counter = WRITES_PER_ABSORB;
 
+		/*
+		 * Since we're ahead of schedule, fsync a few files that BufferSync
+		 * seems to be done with, so that fewer are left for the end.
+		 */
+		if (CheckPointSpreadSync)
+			ProcessIncrementalSyncRequests(SYNCS_PER_NAP);
+
 		CheckArchiveTimeout();
 
 		/*
@@ -882,6 +919,41 @@ ReqShutdownHandler(SIGNAL_ARGS)
  * --------------------------------
  */
 
+/*
+ * Number of entries in the requests[] array.
+ *
+ * This is arbitrarily set to twice NBuffers.  With many relations (or many
+ * segments) being written at once, NBuffers proved too small: once the
+ * queue fills, every backend write turns into a backend fsync.  It is
+ * capped at MAX_CHECKPOINT_REQUESTS, so that AbsorbSyncRequests can still
+ * copy out a full queue with a single palloc.
+ */
+#define MAX_CHECKPOINT_REQUESTS \
+	((int) (MaxAllocSize / sizeof(CheckpointerRequest)))
+
+static int
+CheckpointerMaxRequests(void)
+{
+	return Min(NBuffers, MAX_CHECKPOINT_REQUESTS / 2) * 2;
+}
+
+/*
+ * Number of entries in the request index: the smallest power of 2 that is
+ * at least twice the size of the requests[] array, so that the index stays
+ * at most half full.
+ */
+static uint32
+CheckpointerIndexSize(void)
+{
+	uint64		nentries = 1;
+
+	while (nentries < (uint64) CheckpointerMaxRequests() * 2 &&
+		   nentries < ((uint64) 1 << 31))
+		nentries <<= 1;
+
+	return (uint32) nentries;
+}
+
 /*
  * CheckpointerShmemSize
  *		Compute space needed for checkpointer-related shared memory
@@ -891,12 +963,11 @@ CheckpointerShmemSize(void)
 {
 	Size		size;
 
-	/*
-	 * Currently, the size of the requests[] array is arbitrarily set equal to
-	 * NBuffers.  This may prove too large or small ...
-	 */
 	size = offsetof(CheckpointerShmemStruct, requests);
-	size = add_size(size, mul_size(NBuffers, sizeof(CheckpointerRequest)));
+	size = add_size(size, mul_size(CheckpointerMaxRequests(),
+								   sizeof(CheckpointerRequest)));
+	size = add_size(size, mul_size(CheckpointerIndexSize(),
+								   sizeof(CheckpointerRequestIndexEntry)));
 
 	return size;
 }
@@ -921,11 +992,15 @@ CheckpointerShmemInit(void)
 		/*
 		 * First time through, so initialize.  Note that we zero the whole
 		 * requests array; this is so that CompactCheckpointerRequestQueue can
-		 * assume that any pad bytes in the request structs are zeroes.
+		 * assume that any pad bytes in the request structs are zeroes.  This
+		 * also marks every index entry as belonging to generation 0, which is
+		 * never the current generation.
 		 */
 		MemSet(CheckpointerShmem, 0, size);
 		SpinLockInit(&CheckpointerShmem->ckpt_lck);
-		CheckpointerShmem->max_requests = NBuffers;
+		CheckpointerShmem->max_requests = CheckpointerMaxRequests();
+		CheckpointerShmem->index_mask = CheckpointerIndexSize() - 1;
+		CheckpointerShmem->index_generation = 1;
 		ConditionVariableInit(&CheckpointerShmem->start_cv);
 		ConditionVariableInit(&CheckpointerShmem->done_cv);
 	}
@@ -1093,20 +1168,24 @@ RequestCheckpoint(int flags)
  * is dirty and must be fsync'd before next checkpoint.  We also use this
  * opportunity to count such writes for statistical purposes.
  *
- * To avoid holding the lock for longer than necessary, we normally write
- * to the requests[] queue without checking for duplicates.  The checkpointer
- * will have to eliminate dups internally anyway.  However, if we discover
- * that the queue is full, we make a pass over the entire queue to compact
- * it.  This is somewhat expensive, but the alternative is for the backend
- * to perform its own fsync, which is far more expensive in practice.  It
- * is theoretically possible a backend fsync might still be necessary, if
- * the queue is full and contains no duplicate entries.  In that case, we
- * let the backend know by returning false.
+ * A SYNC_REQUEST that is already in the queue is dropped, using the request
+ * index; that check is cheap, and with many backends writing to the same
+ * files it keeps the queue from filling up with duplicates.  Other request
+ * types are always queued, and reset the index, since a sync request that
+ * follows a forget or filter request must not be merged into one that
+ * precedes it.  If we discover that the queue is full anyway, we make a
+ * pass over the entire queue to compact it.  This is somewhat expensive,
+ * but the alternative is for the backend to perform its own fsync, which
+ * is far more expensive in practice.  It is theoretically possible a
+ * backend fsync might still be necessary, if the queue is full and
+ * contains no duplicate entries.  In that case, we let the backend know
+ * by returning false.
  */
 bool
 ForwardSyncRequest(const FileTag *ftag, SyncRequestType type)
 {
 	CheckpointerRequest *request;
+	CheckpointerRequest newrequest;
 	bool		too_full;
 
 	if (!IsUnderPostmaster)
@@ -1121,6 +1200,24 @@ ForwardSyncRequest(const FileTag *ftag, SyncRequestType type)
 	if (!AmBackgroundWriterProcess())
 		CheckpointerShmem->num_backend_writes++;
 
+	/* Build the request, zeroing any pad bytes; see CheckpointerShmemInit */
+	MemSet(&newrequest, 0, sizeof(newrequest));
+	newrequest.type = type;
+	newrequest.ftag = *ftag;
+
+	/* If an identical sync request is already queued, we're done */
+	if (type == SYNC_REQUEST && CheckpointerShmem->checkpointer_pid != 0)
+	{
+		bool		found;
+
+		(void) CheckpointerRequestIndexLookup(&newrequest, &found);
+		if (found)
+		{
+			LWLockRelease(CheckpointerCommLock);
+			return true;
+		}
+	}
+
 	/*
 	 * If the checkpointer isn't running or the request queue is full, the
 	 * backend will have to perform its own fsync request.  But before forcing
@@ -1142,8 +1239,12 @@ ForwardSyncRequest(const FileTag *ftag, SyncRequestType type)
 
 	/* OK, insert request */
 	request = &CheckpointerShmem->requests[CheckpointerShmem->num_requests++];
-	request->ftag = *ftag;
-	request->type = type;
+	*request = newrequest;
+
+	if (type == SYNC_REQUEST)
+		CheckpointerRequestIndexInsert(CheckpointerShmem->num_requests - 1);
+	else
+		ResetCheckpointerRequestIndex();
 
 	/* If queue is more than half full, nudge the checkpointer to empty it */
 	too_full = (CheckpointerShmem->num_requests >=
@@ -1158,6 +1259,88 @@ ForwardSyncRequest(const FileTag *ftag, SyncRequestType type)
 	return true;
 }
 
+/*
+ * CheckpointerRequestIndexLookup
+ *		Search the request index for an identical queued request.
+ *
+ * Sets *found and returns the matching index entry if there is one.
+ * Otherwise returns the free entry where the request belongs, or NULL if
+ * none turned up within REQUEST_INDEX_MAX_PROBES probes; the index is only
+ * an optimization, so such a request simply doesn't get deduplicated.
+ *
+ * Entries are never removed individually, only by a reset of the whole
+ * index, so the first free entry ends the probe sequence.
+ */
+static CheckpointerRequestIndexEntry *
+CheckpointerRequestIndexLookup(const CheckpointerRequest *request,
+							   bool *found)
+{
+	CheckpointerRequestIndexEntry *index = CheckpointerRequestIndex();
+	uint32		generation = CheckpointerShmem->index_generation;
+	uint32		mask = CheckpointerShmem->index_mask;
+	uint32		bucket;
+	int			i;
+
+	Assert(LWLockHeldByMe(CheckpointerCommLock));
+
+	*found = false;
+	bucket = DatumGetUInt32(hash_any((const unsigned char *) request,
+									 sizeof(CheckpointerRequest)));
+	for (i = 0; i < REQUEST_INDEX_MAX_PROBES; i++)
+	{
+		CheckpointerRequestIndexEntry *entry = &index[(bucket + i) & mask];
+
+		if (entry->generation != generation)
+			return entry;
+		if (memcmp(&CheckpointerShmem->requests[entry->slot], request,
+				   sizeof(CheckpointerRequest)) == 0)
+		{
+			*found = true;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * CheckpointerRequestIndexInsert
+ *		Add the request in the given slot of requests[] to the index.
+ */
+static void
+CheckpointerRequestIndexInsert(int slot)
+{
+	CheckpointerRequestIndexEntry *entry;
+	bool		found;
+
+	entry = CheckpointerRequestIndexLookup(&CheckpointerShmem->requests[slot],
+										   &found);
+	if (entry != NULL && !found)
+	{
+		entry->generation = CheckpointerShmem->index_generation;
+		entry->slot = slot;
+	}
+}
+
+/*
+ * ResetCheckpointerRequestIndex
+ *		Empty the request index.
+ */
+static void
+ResetCheckpointerRequestIndex(void)
+{
+	Assert(LWLockHeldByMe(CheckpointerCommLock));
+
+	/* On wraparound, really clear the entries so old ones can't match */
+	if (++CheckpointerShmem->index_generation == 0)
+	{
+		MemSet(CheckpointerRequestIndex(), 0,
+			   ((Size) CheckpointerShmem->index_mask + 1) *
+			   sizeof(CheckpointerRequestIndexEntry));
+		CheckpointerShmem->index_generation = 1;
+	}
+}
+
 /*
  * CompactCheckpointerRequestQueue
  *		Remove duplicates from the request queue to avoid backend fsyncs.
@@ -1171,8 +1354,10 @@ ForwardSyncRequest(const FileTag *ftag, SyncRequestType type)
  * gets very expensive and can slow down the whole system.
  *
  * Trying to do this every time the queue is full could lose if there
- * aren't any removable entries.  But that should be vanishingly rare in
- * practice: there's one queue entry per shared buffer.
+ * aren't any removable entries.  Since ForwardSyncRequest already drops
+ * most duplicates, that is the likely outcome here; but a full queue should
+ * itself be vanishingly rare in practice: there are two queue entries per
+ * shared buffer.
  */
 static bool
 CompactCheckpointerRequestQueue(void)
@@ -1267,6 +1452,19 @@ CompactCheckpointerRequestQueue(void)
 					CheckpointerShmem->num_requests, preserve_count)));
 	CheckpointerShmem->num_requests = preserve_count;
 
+	/*
+	 * Entries have moved, so rebuild the request index.  Only the sync
+	 * requests after the last request of any other type may be indexed.
+	 */
+	ResetCheckpointerRequestIndex();
+	for (n = preserve_count; n > 0; n--)
+	{
+		if (CheckpointerShmem->requests[n - 1].type != SYNC_REQUEST)
+			break;
+	}
+	for (; n < preserve_count; n++)
+		CheckpointerRequestIndexInsert(n);
+
 	/* Cleanup. */
 	pfree(skip_slot);
 	return true;
@@ -1320,6 +1518,7 @@ AbsorbSyncRequests(void)
 	START_CRIT_SECTION();
 
 	CheckpointerShmem->num_requests = 0;
+	ResetCheckpointerRequestIndex();
 
 	LWLockRelease(CheckpointerCommLock);
 
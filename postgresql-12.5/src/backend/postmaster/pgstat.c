@@ -117,6 +117,8 @@
  */
 #define NumBackendStatSlots (MaxBackends + NUM_AUXPROCTYPES)
 
+#define UINT32_ACCESS_ONCE(var)		 ((uint32)(*((volatile uint32 *)&(var))))
+
 
 /* ----------
  * GUC parameters
@@ -2952,6 +2954,7 @@ pgstat_bestart(void)
 		}
 	}
 
+	lbeentry.st_procno = MyProc ? MyProc->pgprocno : -1;
 	lbeentry.st_proc_start_timestamp = MyStartTimestamp;
 	lbeentry.st_activity_start_timestamp = 0;
 	lbeentry.st_state_start_timestamp = 0;
@@ -3018,6 +3021,7 @@ pgstat_bestart(void)
 	lbeentry.st_state = STATE_UNDEFINED;
 	lbeentry.st_progress_command = PROGRESS_COMMAND_INVALID;
 	lbeentry.st_progress_command_target = InvalidOid;
+	lbeentry.st_query_id = UINT64CONST(0);
 
 	/*
 	 * we don't zero st_progress_param here to save cycles; nobody should
@@ -3148,6 +3152,7 @@ pgstat_report_activity(BackendState state, const char *cmd_str)
 			beentry->st_activity_start_timestamp = 0;
 			/* st_xact_start_timestamp and wait_event_info are also disabled */
 			beentry->st_xact_start_timestamp = 0;
+			beentry->st_query_id = UINT64CONST(0);
 			proc->wait_event_info = 0;
 			PGSTAT_END_WRITE_ACTIVITY(beentry);
 		}
@@ -3178,6 +3183,9 @@ pgstat_report_activity(BackendState state, const char *cmd_str)
 	beentry->st_state = state;
 	beentry->st_state_start_timestamp = current_timestamp;
 
+	/* The next statement to start executing will report its own query ID */
+	beentry->st_query_id = UINT64CONST(0);
+
 	if (cmd_str != NULL)
 	{
 		memcpy((char *) beentry->st_activity_raw, cmd_str, len);
@@ -3339,6 +3347,92 @@ pgstat_report_xact_timestamp(TimestampTz tstamp)
 	PGSTAT_END_WRITE_ACTIVITY(beentry);
 }
 
+/* ----------
+ * pgstat_report_query_id() -
+ *
+ *	Called from ExecutorStart to report the query ID of the statement being
+ *	executed.  Unless force is true, an already reported ID is left alone, so
+ *	that statements run by a function don't hide the top-level query; it is
+ *	cleared again by pgstat_report_activity().
+ * ----------
+ */
+void
+pgstat_report_query_id(uint64 queryId, bool force)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
+
+	if (!pgstat_track_activities || !beentry)
+		return;
+
+	if (beentry->st_query_id != UINT64CONST(0) && !force)
+		return;
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(beentry);
+
+	beentry->st_query_id = queryId;
+
+	PGSTAT_END_WRITE_ACTIVITY(beentry);
+}
+
+/* ----------
+ * pgstat_sample_wait_events() -
+ *
+ *	Record what every other live process is currently waiting on, without
+ *	copying the whole status array as pgstat_read_current_status() does.
+ *	Client backends that are idle waiting for a command are skipped, since
+ *	their ClientRead waits would otherwise swamp any profile built from the
+ *	samples.  Returns the number of entries filled in.
+ * ----------
+ */
+int
+pgstat_sample_wait_events(PgBackendWaitSample *samples, int max_samples)
+{
+	volatile PgBackendStatus *beentry = BackendStatusArray;
+	int			nsamples = 0;
+	int			i;
+
+	for (i = 0; i < NumBackendStatSlots && nsamples < max_samples;
+		 i++, beentry++)
+	{
+		PgBackendWaitSample *sample = &samples[nsamples];
+		BackendState state;
+		int			procno;
+
+		for (;;)
+		{
+			int			before_changecount;
+			int			after_changecount;
+
+			pgstat_begin_read_activity(beentry, before_changecount);
+
+			sample->pid = beentry->st_procpid;
+			sample->backendType = beentry->st_backendType;
+			sample->queryId = beentry->st_query_id;
+			procno = beentry->st_procno;
+			state = beentry->st_state;
+
+			pgstat_end_read_activity(beentry, after_changecount);
+
+			if (pgstat_read_activity_complete(before_changecount,
+											  after_changecount))
+				break;
+
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		if (sample->pid <= 0 || sample->pid == MyProcPid || procno < 0)
+			continue;
+		if (sample->backendType == B_BACKEND && state == STATE_IDLE)
+			continue;
+
+		sample->wait_event_info =
+			UINT32_ACCESS_ONCE(ProcGlobal->allProcs[procno].wait_event_info);
+		nsamples++;
+	}
+
+	return nsamples;
+}
+
 /* ----------
  * pgstat_read_current_status() -
  *
@@ -3670,12 +3764,18 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_SYSLOGGER_MAIN:
 			event_name = "SysLoggerMain";
 			break;
+		case WAIT_EVENT_WAIT_SAMPLER_MAIN:
+			event_name = "WaitSamplerMain";
+			break;
 		case WAIT_EVENT_WAL_RECEIVER_MAIN:
 			event_name = "WalReceiverMain";
 			break;
 		case WAIT_EVENT_WAL_SENDER_MAIN:
 			event_name = "WalSenderMain";
 			break;
+		case WAIT_EVENT_WAL_SUMMARIZER_MAIN:
+			event_name = "WalSummarizerMain";
+			break;
 		case WAIT_EVENT_WAL_WRITER_MAIN:
 			event_name = "WalWriterMain";
 			break;
@@ -3744,6 +3844,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 
 	switch (w)
 	{
+		case WAIT_EVENT_APPEND_READY:
+			event_name = "AppendReady";
+			break;
 		case WAIT_EVENT_BGWORKER_SHUTDOWN:
 			event_name = "BgWorkerShutdown";
 			break;
@@ -3765,6 +3868,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_EXECUTE_GATHER:
 			event_name = "ExecuteGather";
 			break;
+		case WAIT_EVENT_GIST_PAGE:
+			event_name = "GistPage";
+			break;
 		case WAIT_EVENT_HASH_BATCH_ALLOCATING:
 			event_name = "Hash/Batch/Allocating";
 			break;
@@ -3810,6 +3916,12 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_HASH_GROW_BUCKETS_REINSERTING:
 			event_name = "Hash/GrowBuckets/Reinserting";
 			break;
+		case WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE:
+			event_name = "LogicalParallelApplyStateChange";
+			break;
+		case WAIT_EVENT_LOGICAL_SYNC_CHUNKS:
+			event_name = "LogicalSyncChunks";
+			break;
 		case WAIT_EVENT_LOGICAL_SYNC_DATA:
 			event_name = "LogicalSyncData";
 			break;
@@ -3831,18 +3943,33 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_BITMAP_SCAN:
 			event_name = "ParallelBitmapScan";
 			break;
+		case WAIT_EVENT_PARALLEL_COPY_DATA:
+			event_name = "ParallelCopyData";
+			break;
+		case WAIT_EVENT_PARALLEL_COPY_SPACE:
+			event_name = "ParallelCopySpace";
+			break;
 		case WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN:
 			event_name = "ParallelCreateIndexScan";
 			break;
 		case WAIT_EVENT_PARALLEL_FINISH:
 			event_name = "ParallelFinish";
 			break;
+		case WAIT_EVENT_PARALLEL_REDO_SYNC:
+			event_name = "ParallelRedoSync";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
 		case WAIT_EVENT_PROMOTE:
 			event_name = "Promote";
 			break;
+		case WAIT_EVENT_REPARTITION_EXCHANGE:
+			event_name = "RepartitionExchange";
+			break;
+		case WAIT_EVENT_REPARTITION_LAUNCH:
+			event_name = "RepartitionLaunch";
+			break;
 		case WAIT_EVENT_REPLICATION_ORIGIN_DROP:
 			event_name = "ReplicationOriginDrop";
 			break;
@@ -3855,6 +3982,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_SYNC_REP:
 			event_name = "SyncRep";
 			break;
+		case WAIT_EVENT_WAL_GROUP_FLUSH:
+			event_name = "WALGroupFlush";
+			break;
 			/* no default case, so that compiler will warn */
 	}
 
@@ -3902,6 +4032,9 @@ pgstat_get_wait_io(WaitEventIO w)
 
 	switch (w)
 	{
+		case WAIT_EVENT_BUFFILE_PREFETCH:
+			event_name = "BufFilePrefetch";
+			break;
 		case WAIT_EVENT_BUFFILE_READ:
 			event_name = "BufFileRead";
 			break;
@@ -4821,6 +4954,7 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 		result->n_live_tuples = 0;
 		result->n_dead_tuples = 0;
 		result->changes_since_analyze = 0;
+		result->inserts_since_vacuum = 0;
 		result->blocks_fetched = 0;
 		result->blocks_hit = 0;
 		result->vacuum_timestamp = 0;
@@ -5951,6 +6085,7 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
 			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
 			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
+			tabentry->inserts_since_vacuum = tabmsg->t_counts.t_tuples_inserted;
 			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
 
@@ -5984,6 +6119,7 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
 			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
 			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
+			tabentry->inserts_since_vacuum += tabmsg->t_counts.t_tuples_inserted;
 			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
 		}
@@ -6218,6 +6354,12 @@ pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 	tabentry->n_live_tuples = msg->m_live_tuples;
 	tabentry->n_dead_tuples = msg->m_dead_tuples;
 
+	/*
+	 * Like changes_since_analyze after an ANALYZE, this forgets any rows
+	 * inserted while the VACUUM was running.
+	 */
+	tabentry->inserts_since_vacuum = 0;
+
 	if (msg->m_autovacuum)
 	{
 		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
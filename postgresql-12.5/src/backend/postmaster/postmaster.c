@@ -77,10 +77,6 @@
 #include <netdb.h>
 #include <limits.h>
 
-#ifdef HAVE_SYS_SELECT_H
-#include <sys/select.h>
-#endif
-
 #ifdef USE_BONJOUR
 #include <dns_sd.h>
 #endif
@@ -100,6 +96,7 @@
 #include "common/file_perm.h"
 #include "common/ip.h"
 #include "common/string.h"
+#include "executor/instrument.h"
 #include "lib/ilist.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -115,10 +112,13 @@
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
+#include "postmaster/waitsampler.h"
+#include "postmaster/walsummarizer.h"
 #include "replication/logicallauncher.h"
 #include "replication/walsender.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
+#include "storage/latch.h"
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
@@ -178,6 +178,8 @@ typedef struct bkend
 	int			bkend_type;
 	bool		dead_end;		/* is it going to send an error and quit? */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	bool		pooled;			/* idle pre-forked backend awaiting a client? */
+	pgsocket	pool_sock;		/* our end of its handoff socket, if pooled */
 	dlist_node	elem;			/* list link in BackendList */
 } Backend;
 
@@ -211,10 +213,23 @@ char	   *ListenAddresses;
  */
 int			ReservedBackends;
 
+/*
+ * PreforkBackends is the number of idle backend processes the postmaster
+ * tries to keep forked ahead of demand.  Each one holds a child slot and
+ * waits on a socketpair for the postmaster to hand it a freshly accepted
+ * client socket, so a new connection doesn't have to pay for fork().
+ * NumPooledBackends counts the ones currently waiting.
+ */
+int			PreforkBackends = 0;
+static int	NumPooledBackends = 0;
+
 /* The socket(s) we're listening to. */
 #define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
 
+/* Wait set used by ServerLoop: our latch plus the listen sockets */
+static WaitEventSet *pm_wait_set = NULL;
+
 /*
  * Set by the -o option
  */
@@ -416,10 +431,18 @@ static void BackendRun(Port *port) pg_attribute_noreturn();
 static void ExitPostmaster(int status) pg_attribute_noreturn();
 static int	ServerLoop(void);
 static int	BackendStartup(Port *port);
+#ifndef EXEC_BACKEND
+static void MaybeStartPooledBackends(void);
+static bool StartPooledBackend(void);
+static bool HandOffToPooledBackend(Port *port);
+static void PooledBackendMain(pgsocket sock) pg_attribute_noreturn();
+#endif
+static void ForgetPooledBackend(Backend *bp);
+static void TerminatePooledBackends(void);
 static int	ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done);
 static void SendNegotiateProtocolVersion(List *unrecognized_protocol_options);
 static void processCancelRequest(Port *port, void *pkt);
-static int	initMasks(fd_set *rmask);
+static void ConfigurePostmasterWaitSet(void);
 static void report_fork_failure_to_client(Port *port, int errnum);
 static CAC_state canAcceptConnections(int backend_type);
 static bool RandomCancelKey(int32 *cancel_key);
@@ -509,6 +532,7 @@ typedef struct
 	int			NamedLWLockTrancheRequests;
 	NamedLWLockTranche *NamedLWLockTrancheArray;
 	LWLockPadded *MainLWLockArray;
+	LWLockTrancheStats *LWLockStatsArray;
 	slock_t    *ProcStructLock;
 	PROC_HDR   *ProcGlobal;
 	PGPROC	   *AuxiliaryProcs;
@@ -523,6 +547,7 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -629,10 +654,10 @@ PostmasterMain(int argc, char *argv[])
 	 *
 	 * 2. We do not set the SA_RESTART flag.  This is because signals will be
 	 * blocked at all times except when ServerLoop is waiting for something to
-	 * happen, and during that window, we want signals to exit the select(2)
-	 * wait so that ServerLoop can respond if anything interesting happened.
-	 * On some platforms, signals marked SA_RESTART would not cause the
-	 * select() wait to end.
+	 * happen, and during that window, we want signals to interrupt the wait
+	 * so that ServerLoop can respond if anything interesting happened.  The
+	 * handlers also set our latch, since WaitEventSetWait() would otherwise
+	 * just resume waiting after an interrupted system call.
 	 *
 	 * Child processes will generally want SA_RESTART, so pqsignal() sets that
 	 * flag.  We expect children to set up their own handlers before
@@ -648,6 +673,12 @@ PostmasterMain(int argc, char *argv[])
 	pqinitmask();
 	PG_SETMASK(&BlockSig);
 
+	/*
+	 * The signal handlers set our latch to wake up ServerLoop, so it has to
+	 * exist before they are installed.
+	 */
+	InitProcessLocalLatch();
+
 	pqsignal_pm(SIGHUP, SIGHUP_handler);	/* reread config file and have
 											 * children do same */
 	pqsignal_pm(SIGINT, pmdie); /* send SIGTERM and shut down */
@@ -1003,6 +1034,12 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/* Likewise for the WAL summarizer. */
+	WalSummarizerRegister();
+
+	/* And for the wait sampler. */
+	WaitSamplerRegister();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -1209,6 +1246,12 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	set_stack_base();
 
+	/*
+	 * Calibrate the cycle counter used for EXPLAIN ANALYZE timing, so that
+	 * backends inherit the result.
+	 */
+	InstrInitCycleCounter();
+
 	/*
 	 * Initialize pipe (or process handle on Windows) that allows children to
 	 * wake up from sleep on postmaster death.
@@ -1640,45 +1683,43 @@ DetermineSleepTime(struct timeval *timeout)
 static int
 ServerLoop(void)
 {
-	fd_set		readmask;
-	int			nSockets;
 	time_t		last_lockfile_recheck_time,
 				last_touch_time;
+	WaitEvent	events[MAXLISTEN];
+	int			nevents;
 
 	last_lockfile_recheck_time = last_touch_time = time(NULL);
 
-	nSockets = initMasks(&readmask);
+	ConfigurePostmasterWaitSet();
 
 	for (;;)
 	{
-		fd_set		rmask;
-		int			selres;
 		time_t		now;
+		int			i;
 
 		/*
-		 * Wait for a connection request to arrive.
+		 * Wait for a connection request to arrive, or for a signal handler to
+		 * set our latch.
 		 *
 		 * We block all signals except while sleeping. That makes it safe for
 		 * signal handlers, which again block all signals while executing, to
 		 * do nontrivial work.
 		 *
 		 * If we are in PM_WAIT_DEAD_END state, then we don't want to accept
-		 * any new connections, so we don't call select(), and just sleep.
+		 * any new connections, so we don't wait on the sockets, and just
+		 * sleep.
 		 */
-		memcpy((char *) &rmask, (char *) &readmask, sizeof(fd_set));
-
 		if (pmState == PM_WAIT_DEAD_END)
 		{
 			PG_SETMASK(&UnBlockSig);
 
 			pg_usleep(100000L); /* 100 msec seems reasonable */
-			selres = 0;
+			nevents = 0;
 
 			PG_SETMASK(&BlockSig);
 		}
 		else
 		{
-			/* must set timeout each time; some OSes change it! */
 			struct timeval timeout;
 
 			/* Needs to run with blocked signals! */
@@ -1686,51 +1727,39 @@ ServerLoop(void)
 
 			PG_SETMASK(&UnBlockSig);
 
-			selres = select(nSockets, &rmask, NULL, NULL, &timeout);
+			nevents = WaitEventSetWait(pm_wait_set,
+									   timeout.tv_sec * 1000L +
+									   timeout.tv_usec / 1000,
+									   events, lengthof(events), 0);
 
 			PG_SETMASK(&BlockSig);
 		}
 
-		/* Now check the select() result */
-		if (selres < 0)
-		{
-			if (errno != EINTR && errno != EWOULDBLOCK)
-			{
-				ereport(LOG,
-						(errcode_for_socket_access(),
-						 errmsg("select() failed in postmaster: %m")));
-				return STATUS_ERROR;
-			}
-		}
-
 		/*
 		 * New connection pending on any of our sockets? If so, fork a child
-		 * process to deal with it.
+		 * process to deal with it.  All sockets reported ready are served in
+		 * this pass, which matters when connections arrive in bursts.
 		 */
-		if (selres > 0)
+		for (i = 0; i < nevents; i++)
 		{
-			int			i;
+			if (events[i].events & WL_LATCH_SET)
+				ResetLatch(MyLatch);
 
-			for (i = 0; i < MAXLISTEN; i++)
+			if (events[i].events & WL_SOCKET_READABLE)
 			{
-				if (ListenSocket[i] == PGINVALID_SOCKET)
-					break;
-				if (FD_ISSET(ListenSocket[i], &rmask))
+				Port	   *port;
+
+				port = ConnCreate(events[i].fd);
+				if (port)
 				{
-					Port	   *port;
+					BackendStartup(port);
 
-					port = ConnCreate(ListenSocket[i]);
-					if (port)
-					{
-						BackendStartup(port);
-
-						/*
-						 * We no longer need the open socket or port structure
-						 * in this process
-						 */
-						StreamClose(port->sock);
-						ConnFree(port);
-					}
+					/*
+					 * We no longer need the open socket or port structure in
+					 * this process
+					 */
+					StreamClose(port->sock);
+					ConnFree(port);
 				}
 			}
 		}
@@ -1801,6 +1830,12 @@ ServerLoop(void)
 		if (StartWorkerNeeded || HaveCrashedWorker)
 			maybe_start_bgworkers();
 
+#ifndef EXEC_BACKEND
+		/* Top up the pool of pre-forked backends, if one is configured */
+		if (NumPooledBackends < PreforkBackends)
+			MaybeStartPooledBackends();
+#endif
+
 #ifdef HAVE_PTHREAD_IS_THREADED_NP
 
 		/*
@@ -1874,30 +1909,30 @@ ServerLoop(void)
 }
 
 /*
- * Initialise the masks for select() for the ports we are listening on.
- * Return the number of sockets to listen on.
+ * Build the wait event set for ServerLoop: our latch, which the signal
+ * handlers set, and the ports we are listening on.  Using a WaitEventSet
+ * rather than select() lets us use epoll where available, whose cost does
+ * not grow with the number of file descriptors the postmaster has open.
  */
-static int
-initMasks(fd_set *rmask)
+static void
+ConfigurePostmasterWaitSet(void)
 {
-	int			maxsock = -1;
 	int			i;
 
-	FD_ZERO(rmask);
+	if (pm_wait_set)
+		FreeWaitEventSet(pm_wait_set);
+
+	pm_wait_set = CreateWaitEventSet(PostmasterContext, MAXLISTEN + 1);
+	AddWaitEventToSet(pm_wait_set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch,
+					  NULL);
 
 	for (i = 0; i < MAXLISTEN; i++)
 	{
-		int			fd = ListenSocket[i];
-
-		if (fd == PGINVALID_SOCKET)
+		if (ListenSocket[i] == PGINVALID_SOCKET)
 			break;
-		FD_SET(fd, rmask);
-
-		if (fd > maxsock)
-			maxsock = fd;
+		AddWaitEventToSet(pm_wait_set, WL_SOCKET_READABLE, ListenSocket[i],
+						  NULL, NULL);
 	}
-
-	return maxsock + 1;
 }
 
 
@@ -2105,6 +2140,7 @@ retry1:
 	{
 		int32		offset = sizeof(ProtocolVersion);
 		List	   *unrecognized_protocol_options = NIL;
+		const char *compression = NULL;
 
 		/*
 		 * Scan packet body for name/option pairs.  We can assume any string
@@ -2154,12 +2190,20 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "_pq_.compression") == 0)
+			{
+				/*
+				 * The client offers to compress the protocol stream.  An
+				 * offer we can't or won't accept is simply not acknowledged,
+				 * and the connection proceeds uncompressed.
+				 */
+				compression = pq_choose_compression(valptr);
+			}
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
 				 * Any option beginning with _pq_. is reserved for use as a
-				 * protocol-level option, but at present no such options are
-				 * defined.
+				 * protocol-level option; we don't know this one.
 				 */
 				unrecognized_protocol_options =
 					lappend(unrecognized_protocol_options, pstrdup(nameptr));
@@ -2208,6 +2252,13 @@ retry1:
 		if (PG_PROTOCOL_MINOR(proto) > PG_PROTOCOL_MINOR(PG_PROTOCOL_LATEST) ||
 			unrecognized_protocol_options != NIL)
 			SendNegotiateProtocolVersion(unrecognized_protocol_options);
+
+		/*
+		 * Switch on compression before anything else is sent, so that the
+		 * client knows exactly where the compressed stream begins.
+		 */
+		if (compression && pq_enable_compression(compression))
+			return STATUS_ERROR;
 	}
 	else
 	{
@@ -2570,6 +2621,16 @@ ClosePostmasterPorts(bool am_syslogger)
 	postmaster_alive_fds[POSTMASTER_FD_OWN] = -1;
 #endif
 
+	/*
+	 * Release the postmaster's wait set.  This just closes our copy of the
+	 * epoll descriptor, if any, and doesn't affect the postmaster's.
+	 */
+	if (pm_wait_set)
+	{
+		FreeWaitEventSet(pm_wait_set);
+		pm_wait_set = NULL;
+	}
+
 	/* Close the listen sockets */
 	for (i = 0; i < MAXLISTEN; i++)
 	{
@@ -2580,6 +2641,20 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+	/* Close our ends of any pre-forked backends' handoff sockets */
+	if (NumPooledBackends > 0)
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &BackendList)
+		{
+			Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+			if (bp->pooled)
+				closesocket(bp->pool_sock);
+		}
+	}
+
 	/* If using syslogger, close the read side of the pipe */
 	if (!am_syslogger)
 	{
@@ -2678,6 +2753,13 @@ SIGHUP_handler(SIGNAL_ARGS)
 				(errmsg("received SIGHUP, reloading configuration files")));
 		ProcessConfigFile(PGC_SIGHUP);
 		SignalChildren(SIGHUP);
+
+		/*
+		 * Idle pre-forked backends carry the configuration, HBA and SSL state
+		 * of the moment they were forked; retire them so that the pool gets
+		 * refilled with processes that have seen the reload.
+		 */
+		TerminatePooledBackends();
 		if (StartupPID != 0)
 			signal_child(StartupPID, SIGHUP);
 		if (BgWriterPID != 0)
@@ -2730,6 +2812,9 @@ SIGHUP_handler(SIGNAL_ARGS)
 #endif
 	}
 
+	/* Wake up ServerLoop */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -2797,6 +2882,9 @@ pmdie(SIGNAL_ARGS)
 				pmState = PM_STOP_BACKENDS;
 			}
 
+			/* Idle pre-forked backends would otherwise wait forever */
+			TerminatePooledBackends();
+
 			/*
 			 * Now wait for online backup mode to end and backends to exit. If
 			 * that is already the case, PostmasterStateMachine will take the
@@ -2881,6 +2969,9 @@ pmdie(SIGNAL_ARGS)
 			break;
 	}
 
+	/* Wake up ServerLoop */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -3207,6 +3298,9 @@ reaper(SIGNAL_ARGS)
 	PostmasterStateMachine();
 
 	/* Done with signal handler */
+	/* Wake up ServerLoop */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -3393,6 +3487,7 @@ CleanupBackend(int pid,
 				 */
 				BackgroundWorkerStopNotifications(bp->pid);
 			}
+			ForgetPooledBackend(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			break;
@@ -3496,6 +3591,7 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 				ShmemBackendArrayRemove(bp);
 #endif
 			}
+			ForgetPooledBackend(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			/* Keep looping so we can signal remaining backends */
@@ -4111,6 +4207,19 @@ BackendStartup(Port *port)
 	Backend    *bn;				/* for backend cleanup */
 	pid_t		pid;
 
+#ifndef EXEC_BACKEND
+
+	/*
+	 * If a pre-forked backend is waiting, just pass it the connection.  We
+	 * only do that for connections that would be accepted normally; all the
+	 * special cases go through the regular fork path below.
+	 */
+	if (NumPooledBackends > 0 &&
+		canAcceptConnections(BACKEND_TYPE_NORMAL) == CAC_OK &&
+		HandOffToPooledBackend(port))
+		return STATUS_OK;
+#endif
+
 	/*
 	 * Create backend data structure.  Better before the fork() so we can
 	 * handle failure cleanly.
@@ -4156,6 +4265,9 @@ BackendStartup(Port *port)
 	/* Hasn't asked to be notified about any bgworkers yet */
 	bn->bgworker_notify = false;
 
+	bn->pooled = false;
+	bn->pool_sock = PGINVALID_SOCKET;
+
 #ifdef EXEC_BACKEND
 	pid = backend_forkexec(port);
 #else							/* !EXEC_BACKEND */
@@ -4214,6 +4326,328 @@ BackendStartup(Port *port)
 	return STATUS_OK;
 }
 
+#ifndef EXEC_BACKEND
+
+/*
+ * MaybeStartPooledBackends -- fork idle backends until the pool is full
+ *
+ * We only keep a pool while ordinary connections are being accepted, so that
+ * pre-forked children never stand in the way of a shutdown or crash restart.
+ */
+static void
+MaybeStartPooledBackends(void)
+{
+	while (NumPooledBackends < PreforkBackends &&
+		   canAcceptConnections(BACKEND_TYPE_NORMAL) == CAC_OK)
+	{
+		if (!StartPooledBackend())
+			break;
+	}
+}
+
+/*
+ * StartPooledBackend -- fork one idle backend for the pool
+ *
+ * The child gets everything a regular backend would get from BackendStartup
+ * (cancel key, child slot, detaching from the postmaster), and then blocks
+ * in PooledBackendMain until we pass it a client socket.
+ *
+ * returns: false if the fork or its setup failed, true otherwise.
+ */
+static bool
+StartPooledBackend(void)
+{
+	Backend    *bn;
+	pgsocket	socks[2];
+	pid_t		pid;
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+
+	if (!RandomCancelKey(&MyCancelKey))
+	{
+		free(bn);
+		ereport(LOG,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not generate random cancel key")));
+		return false;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) < 0)
+	{
+		free(bn);
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for pre-forked backend: %m")));
+		return false;
+	}
+
+	bn->cancel_key = MyCancelKey;
+	bn->dead_end = false;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+	bn->bgworker_notify = false;
+
+	pid = fork_process();
+	if (pid == 0)				/* child */
+	{
+		free(bn);
+
+		/* Detangle from postmaster */
+		InitPostmasterChild();
+
+		/* Close the postmaster's sockets, including the other pool members' */
+		ClosePostmasterPorts(false);
+		closesocket(socks[0]);
+
+		PooledBackendMain(socks[1]);
+	}
+
+	closesocket(socks[1]);
+
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		closesocket(socks[0]);
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		free(bn);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork pre-forked backend process: %m")));
+		return false;
+	}
+
+	ereport(DEBUG2,
+			(errmsg_internal("forked new pooled backend, pid=%d",
+							 (int) pid)));
+
+	bn->pid = pid;
+	bn->bkend_type = BACKEND_TYPE_NORMAL;	/* Can change later to WALSND */
+	bn->pooled = true;
+	bn->pool_sock = socks[0];
+	dlist_push_head(&BackendList, &bn->elem);
+	NumPooledBackends++;
+
+	return true;
+}
+
+/*
+ * HandOffToPooledBackend -- pass a new client connection to an idle child
+ *
+ * The Port is copied over verbatim, the same way save_backend_variables()
+ * does for EXEC_BACKEND, and the client socket travels as SCM_RIGHTS
+ * ancillary data.  Whatever the outcome, the child leaves the pool: if the
+ * send failed it sees EOF on its handoff socket and exits.
+ *
+ * returns: true if some pooled backend took over the connection.
+ */
+static bool
+HandOffToPooledBackend(Port *port)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+		struct msghdr msg;
+		struct iovec iov;
+		struct cmsghdr *cmsg;
+		union
+		{
+			struct cmsghdr align;
+			char		buf[CMSG_SPACE(sizeof(pgsocket))];
+		}			cmsgbuf;
+		ssize_t		rc;
+
+		if (!bp->pooled)
+			continue;
+
+		port->canAcceptConnections = CAC_OK;
+
+		iov.iov_base = port;
+		iov.iov_len = sizeof(Port);
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgbuf.buf;
+		msg.msg_controllen = sizeof(cmsgbuf.buf);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(pgsocket));
+		memcpy(CMSG_DATA(cmsg), &port->sock, sizeof(pgsocket));
+
+		do
+		{
+			rc = sendmsg(bp->pool_sock, &msg, 0);
+		} while (rc < 0 && errno == EINTR);
+
+		ForgetPooledBackend(bp);
+
+		if (rc == sizeof(Port))
+		{
+			ereport(DEBUG2,
+					(errmsg_internal("passed connection to pooled backend, pid=%d socket=%d",
+									 (int) bp->pid, (int) port->sock)));
+			return true;
+		}
+
+		if (rc < 0)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not pass connection to pre-forked backend process %d: %m",
+							(int) bp->pid)));
+	}
+
+	return false;
+}
+
+/*
+ * PooledBackendMain -- wait in a pre-forked backend for a client connection
+ *
+ * Until the postmaster passes us a connection, SIGTERM and SIGQUIT behave as
+ * they do while collecting a startup packet, and EOF on the handoff socket
+ * (the postmaster retired us, or died) means exit quietly.  Once we have a
+ * socket, carry on exactly as a freshly forked backend would.
+ */
+static void
+PooledBackendMain(pgsocket sock)
+{
+	Port	   *port;
+	pgsocket	client_sock;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr align;
+		char		buf[CMSG_SPACE(sizeof(pgsocket))];
+	}			cmsgbuf;
+	ssize_t		rc;
+
+	if (!(port = (Port *) calloc(1, sizeof(Port))))
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		proc_exit(1);
+	}
+
+	pqsignal(SIGTERM, process_startup_packet_die);
+	pqsignal(SIGQUIT, process_startup_packet_quickdie);
+	PG_SETMASK(&StartupBlockSig);
+
+	iov.iov_base = port;
+	iov.iov_len = sizeof(Port);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do
+	{
+		rc = recvmsg(sock, &msg, MSG_WAITALL);
+	} while (rc < 0 && errno == EINTR);
+
+	PG_SETMASK(&BlockSig);
+
+	if (rc == 0)
+		proc_exit(0);
+	if (rc < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not receive connection from postmaster: %m")));
+		proc_exit(1);
+	}
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (rc != sizeof(Port) || cmsg == NULL ||
+		cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+		cmsg->cmsg_len != CMSG_LEN(sizeof(pgsocket)))
+	{
+		ereport(LOG,
+				(errmsg("invalid connection handoff message from postmaster")));
+		proc_exit(1);
+	}
+	memcpy(&client_sock, CMSG_DATA(cmsg), sizeof(pgsocket));
+
+	closesocket(sock);
+
+	/*
+	 * The postmaster's pointers mean nothing here; rebuild what ConnCreate
+	 * would have allocated.
+	 */
+	port->sock = client_sock;
+	port->gss = NULL;
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	port->gss = (pg_gssinfo *) calloc(1, sizeof(pg_gssinfo));
+	if (!port->gss)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		proc_exit(1);
+	}
+#endif
+
+	/* Session start time is now, not when we were forked */
+	MyStartTimestamp = GetCurrentTimestamp();
+	MyStartTime = timestamptz_to_time_t(MyStartTimestamp);
+
+	/* Perform additional initialization and collect startup packet */
+	BackendInitialize(port);
+
+	/* And run the backend */
+	BackendRun(port);
+}
+#endif							/* !EXEC_BACKEND */
+
+/*
+ * ForgetPooledBackend -- take a backend out of the pre-forked pool
+ *
+ * Closing our end of the handoff socket is enough to make an idle child exit
+ * if it never got a connection.
+ */
+static void
+ForgetPooledBackend(Backend *bp)
+{
+	if (!bp->pooled)
+		return;
+
+	closesocket(bp->pool_sock);
+	bp->pool_sock = PGINVALID_SOCKET;
+	bp->pooled = false;
+	NumPooledBackends--;
+}
+
+/*
+ * TerminatePooledBackends -- retire all idle pre-forked backends
+ */
+static void
+TerminatePooledBackends(void)
+{
+	dlist_iter	iter;
+
+	if (NumPooledBackends == 0)
+		return;
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+		ForgetPooledBackend(bp);
+	}
+}
+
 /*
  * Try to report backend fork() failure to client before we close the
  * connection.  Since we do not care to risk blocking the postmaster on
@@ -5309,6 +5743,9 @@ sigusr1_handler(SIGNAL_ARGS)
 		signal_child(StartupPID, SIGUSR2);
 	}
 
+	/* Wake up ServerLoop */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -5589,6 +6026,8 @@ StartAutovacuumWorker(void)
 			bn->dead_end = false;
 			bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
 			bn->bgworker_notify = false;
+			bn->pooled = false;
+			bn->pool_sock = PGINVALID_SOCKET;
 
 			bn->pid = StartAutoVacWorker();
 			if (bn->pid > 0)
@@ -5981,6 +6420,8 @@ assign_backendlist_entry(RegisteredBgWorker *rw)
 	bn->bkend_type = BACKEND_TYPE_BGWORKER;
 	bn->dead_end = false;
 	bn->bgworker_notify = false;
+	bn->pooled = false;
+	bn->pool_sock = PGINVALID_SOCKET;
 
 	rw->rw_backend = bn;
 	rw->rw_child_slot = bn->child_slot;
@@ -6197,6 +6638,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->NamedLWLockTrancheRequests = NamedLWLockTrancheRequests;
 	param->NamedLWLockTrancheArray = NamedLWLockTrancheArray;
 	param->MainLWLockArray = MainLWLockArray;
+	param->LWLockStatsArray = LWLockStatsArray;
 	param->ProcStructLock = ProcStructLock;
 	param->ProcGlobal = ProcGlobal;
 	param->AuxiliaryProcs = AuxiliaryProcs;
@@ -6215,6 +6657,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6433,6 +6876,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	NamedLWLockTrancheRequests = param->NamedLWLockTrancheRequests;
 	NamedLWLockTrancheArray = param->NamedLWLockTrancheArray;
 	MainLWLockArray = param->MainLWLockArray;
+	LWLockStatsArray = param->LWLockStatsArray;
 	ProcStructLock = param->ProcStructLock;
 	ProcGlobal = param->ProcGlobal;
 	AuxiliaryProcs = param->AuxiliaryProcs;
@@ -6450,6 +6894,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -0,0 +1,508 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitsampler.c
+ *
+ * The wait sampler is a background worker that wakes up wait_sampling_rate
+ * times a second and records what every other process is waiting on.  Each
+ * sample of a process notes its backend type, wait event and the query ID
+ * of the statement it is running.  The samples go into a ring buffer of the
+ * last wait_sampling_history_size samples, and are also counted in a
+ * profile keyed by (backend type, wait event, query ID).  Both live in
+ * shared memory and are shown by the pg_stat_wait_sampling_history and
+ * pg_stat_wait_sampling views.
+ *
+ * Sampling only reads the shared backend status array and each process's
+ * wait_event_info, so the sampled processes do no extra work at all.  A
+ * sample with no wait event means the process was running on a CPU, or
+ * waiting for one.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/waitsampler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/waitsampler.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+/* GUC options */
+bool		wait_sampling = false;
+int			wait_sampling_rate = 100;	/* samples per second */
+int			wait_sampling_history_size = 10000;
+
+/*
+ * Maximum number of distinct (backend type, wait event, query ID) entries
+ * in the profile.  Once it is full, new combinations are counted without
+ * their query ID; there are few enough backend types and wait events that
+ * those always fit.
+ */
+#define WAIT_PROFILE_SIZE		4096
+
+typedef struct WaitProfileKey
+{
+	BackendType backendType;
+	uint32		wait_event_info;
+	uint64		queryId;
+} WaitProfileKey;
+
+typedef struct WaitProfileEntry
+{
+	WaitProfileKey key;			/* hash key; must be first */
+	int64		count;
+} WaitProfileEntry;
+
+typedef struct WaitHistoryItem
+{
+	TimestampTz sample_time;
+	PgBackendWaitSample sample;
+} WaitHistoryItem;
+
+/*
+ * Shared state, protected by WaitSamplerLock.  history is a ring buffer of
+ * wait_sampling_history_size items; history_next counts every item ever
+ * added, so the newest item is at (history_next - 1) % size.
+ */
+typedef struct WaitSamplerShmemStruct
+{
+	uint64		history_next;
+	WaitHistoryItem history[FLEXIBLE_ARRAY_MEMBER];
+} WaitSamplerShmemStruct;
+
+static WaitSamplerShmemStruct *WaitSamplerShmem = NULL;
+static HTAB *wait_profile = NULL;
+
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void WaitSamplerSigHup(SIGNAL_ARGS);
+static void RecordWaitSamples(PgBackendWaitSample *samples, int nsamples,
+							  TimestampTz now);
+static void CountWaitSample(const PgBackendWaitSample *sample);
+static Tuplestorestate *wait_sampling_tuplestore(FunctionCallInfo fcinfo,
+												 TupleDesc *tupdesc);
+static void wait_event_datums(uint32 wait_event_info, Datum *values,
+							  bool *nulls);
+
+/*
+ * Report shared-memory space needed by WaitSamplerShmemInit.
+ */
+Size
+WaitSamplerShmemSize(void)
+{
+	Size		size;
+
+	if (!wait_sampling)
+		return 0;
+
+	size = offsetof(WaitSamplerShmemStruct, history);
+	size = add_size(size, mul_size(wait_sampling_history_size,
+								   sizeof(WaitHistoryItem)));
+	size = add_size(size, hash_estimate_size(WAIT_PROFILE_SIZE,
+											 sizeof(WaitProfileEntry)));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the sample history and profile.
+ */
+void
+WaitSamplerShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (!wait_sampling)
+		return;
+
+	WaitSamplerShmem = (WaitSamplerShmemStruct *)
+		ShmemInitStruct("Wait Sampler Data",
+						add_size(offsetof(WaitSamplerShmemStruct, history),
+								 mul_size(wait_sampling_history_size,
+										  sizeof(WaitHistoryItem))),
+						&found);
+	if (!found)
+		WaitSamplerShmem->history_next = 0;
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(WaitProfileKey);
+	info.entrysize = sizeof(WaitProfileEntry);
+	wait_profile = ShmemInitHash("Wait Sampler Profile",
+								 WAIT_PROFILE_SIZE, WAIT_PROFILE_SIZE,
+								 &info,
+								 HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * Register the wait sampler, if enabled.  Like the logical replication
+ * launcher, this must happen before InitializeMaxBackends().
+ */
+void
+WaitSamplerRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (!wait_sampling)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	bgw.bgw_start_time = BgWorkerStart_PostmasterStart;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "WaitSamplerMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "wait sampler");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "wait sampler");
+	bgw.bgw_restart_time = 10;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+/*
+ * Main entry point for the wait sampler.
+ */
+void
+WaitSamplerMain(Datum main_arg)
+{
+	PgBackendWaitSample *samples;
+	int			max_samples = MaxBackends + NUM_AUXPROCTYPES;
+	TimestampTz next_sample;
+
+	pqsignal(SIGHUP, WaitSamplerSigHup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	samples = (PgBackendWaitSample *)
+		palloc(max_samples * sizeof(PgBackendWaitSample));
+
+	next_sample = GetCurrentTimestamp();
+
+	for (;;)
+	{
+		TimestampTz now;
+		long		secs;
+		int			usecs;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		now = GetCurrentTimestamp();
+		if (now >= next_sample)
+		{
+			int			nsamples;
+
+			nsamples = pgstat_sample_wait_events(samples, max_samples);
+			RecordWaitSamples(samples, nsamples, now);
+
+			/*
+			 * Keep to a fixed schedule, so that the time spent sampling
+			 * doesn't lower the rate; but if we've fallen behind, don't try
+			 * to catch up with a burst of samples.
+			 */
+			next_sample += USECS_PER_SEC / wait_sampling_rate;
+			if (next_sample <= now)
+				next_sample = now + USECS_PER_SEC / wait_sampling_rate;
+		}
+
+		TimestampDifference(now, next_sample, &secs, &usecs);
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+					   secs * 1000 + (usecs + 999) / 1000,
+					   WAIT_EVENT_WAIT_SAMPLER_MAIN);
+		if (rc & WL_LATCH_SET)
+			ResetLatch(MyLatch);
+	}
+}
+
+/* SIGHUP: set flag to re-read config file at next convenient time */
+static void
+WaitSamplerSigHup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Add one round of samples, all taken at "now", to the history and profile.
+ */
+static void
+RecordWaitSamples(PgBackendWaitSample *samples, int nsamples,
+				  TimestampTz now)
+{
+	int			i;
+
+	LWLockAcquire(WaitSamplerLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < nsamples; i++)
+	{
+		if (wait_sampling_history_size > 0)
+		{
+			WaitHistoryItem *item;
+
+			item = &WaitSamplerShmem->history[WaitSamplerShmem->history_next %
+											  wait_sampling_history_size];
+			item->sample_time = now;
+			item->sample = samples[i];
+			WaitSamplerShmem->history_next++;
+		}
+
+		CountWaitSample(&samples[i]);
+	}
+
+	LWLockRelease(WaitSamplerLock);
+}
+
+/*
+ * Count one sample in the profile.  Caller must hold WaitSamplerLock
+ * exclusively.
+ */
+static void
+CountWaitSample(const PgBackendWaitSample *sample)
+{
+	WaitProfileKey key;
+	WaitProfileEntry *entry;
+
+	memset(&key, 0, sizeof(key));
+	key.backendType = sample->backendType;
+	key.wait_event_info = sample->wait_event_info;
+	key.queryId = sample->queryId;
+
+	entry = (WaitProfileEntry *) hash_search(wait_profile, &key,
+											 HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		bool		found;
+
+		/* Fold the query ID away once the profile is full */
+		if (hash_get_num_entries(wait_profile) >= WAIT_PROFILE_SIZE)
+			key.queryId = UINT64CONST(0);
+
+		entry = (WaitProfileEntry *) hash_search(wait_profile, &key,
+												 HASH_ENTER_NULL, &found);
+		if (entry == NULL)
+			return;
+		if (!found)
+			entry->count = 0;
+	}
+
+	entry->count++;
+}
+
+/*
+ * Set up a materialize-mode tuplestore as the result of an SRF.
+ */
+static Tuplestorestate *
+wait_sampling_tuplestore(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+/*
+ * Fill in the wait_event_type and wait_event columns of a result row.  Both
+ * are NULL if the process wasn't waiting.
+ */
+static void
+wait_event_datums(uint32 wait_event_info, Datum *values, bool *nulls)
+{
+	const char *wait_event_type = pgstat_get_wait_event_type(wait_event_info);
+	const char *wait_event = pgstat_get_wait_event(wait_event_info);
+
+	if (wait_event_type)
+		values[0] = CStringGetTextDatum(wait_event_type);
+	else
+		nulls[0] = true;
+	if (wait_event)
+		values[1] = CStringGetTextDatum(wait_event);
+	else
+		nulls[1] = true;
+}
+
+/*
+ * pg_stat_get_wait_sampling_history
+ *		Show the samples in the history ring buffer, oldest first.
+ */
+Datum
+pg_stat_get_wait_sampling_history(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAIT_SAMPLING_HISTORY_COLS	6
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	WaitHistoryItem *items;
+	uint64		first;
+	uint64		next;
+	int			nitems;
+	int			i;
+
+	tupstore = wait_sampling_tuplestore(fcinfo, &tupdesc);
+
+	if (WaitSamplerShmem == NULL || wait_sampling_history_size == 0)
+		return (Datum) 0;
+
+	/* Copy the history out, so as not to hold the lock while we output it */
+	items = (WaitHistoryItem *)
+		palloc(wait_sampling_history_size * sizeof(WaitHistoryItem));
+
+	LWLockAcquire(WaitSamplerLock, LW_SHARED);
+	next = WaitSamplerShmem->history_next;
+	first = (next > wait_sampling_history_size) ?
+		next - wait_sampling_history_size : 0;
+	nitems = (int) (next - first);
+	for (i = 0; i < nitems; i++)
+		items[i] = WaitSamplerShmem->history[(first + i) %
+											 wait_sampling_history_size];
+	LWLockRelease(WaitSamplerLock);
+
+	for (i = 0; i < nitems; i++)
+	{
+		WaitHistoryItem *item = &items[i];
+		Datum		values[PG_STAT_GET_WAIT_SAMPLING_HISTORY_COLS];
+		bool		nulls[PG_STAT_GET_WAIT_SAMPLING_HISTORY_COLS];
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = TimestampTzGetDatum(item->sample_time);
+		values[1] = Int32GetDatum(item->sample.pid);
+		values[2] = CStringGetTextDatum(pgstat_get_backend_desc(item->sample.backendType));
+		wait_event_datums(item->sample.wait_event_info, &values[3], &nulls[3]);
+		if (item->sample.queryId != UINT64CONST(0))
+			values[5] = Int64GetDatum((int64) item->sample.queryId);
+		else
+			nulls[5] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_stat_get_wait_sampling_profile
+ *		Show the number of samples counted for each combination of backend
+ *		type, wait event and query ID.
+ */
+Datum
+pg_stat_get_wait_sampling_profile(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAIT_SAMPLING_PROFILE_COLS	5
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	WaitProfileEntry *entries;
+	WaitProfileEntry *entry;
+	HASH_SEQ_STATUS hash_seq;
+	int			nentries = 0;
+	int			i;
+
+	tupstore = wait_sampling_tuplestore(fcinfo, &tupdesc);
+
+	if (WaitSamplerShmem == NULL)
+		return (Datum) 0;
+
+	LWLockAcquire(WaitSamplerLock, LW_SHARED);
+	entries = (WaitProfileEntry *)
+		palloc(Max(hash_get_num_entries(wait_profile), 1) *
+			   sizeof(WaitProfileEntry));
+	hash_seq_init(&hash_seq, wait_profile);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		entries[nentries++] = *entry;
+	LWLockRelease(WaitSamplerLock);
+
+	for (i = 0; i < nentries; i++)
+	{
+		Datum		values[PG_STAT_GET_WAIT_SAMPLING_PROFILE_COLS];
+		bool		nulls[PG_STAT_GET_WAIT_SAMPLING_PROFILE_COLS];
+
+		entry = &entries[i];
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(pgstat_get_backend_desc(entry->key.backendType));
+		wait_event_datums(entry->key.wait_event_info, &values[1], &nulls[1]);
+		if (entry->key.queryId != UINT64CONST(0))
+			values[3] = Int64GetDatum((int64) entry->key.queryId);
+		else
+			nulls[3] = true;
+		values[4] = Int64GetDatum(entry->count);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_stat_reset_wait_sampling
+ *		Discard the sample history and profile.
+ */
+Datum
+pg_stat_reset_wait_sampling(PG_FUNCTION_ARGS)
+{
+	WaitProfileEntry *entry;
+	HASH_SEQ_STATUS hash_seq;
+
+	if (WaitSamplerShmem == NULL)
+		PG_RETURN_VOID();
+
+	LWLockAcquire(WaitSamplerLock, LW_EXCLUSIVE);
+	WaitSamplerShmem->history_next = 0;
+	hash_seq_init(&hash_seq, wait_profile);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(wait_profile, &entry->key, HASH_REMOVE, NULL);
+	LWLockRelease(WaitSamplerLock);
+
+	PG_RETURN_VOID();
+}
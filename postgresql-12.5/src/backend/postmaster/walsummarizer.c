@@ -0,0 +1,914 @@
+/*-------------------------------------------------------------------------
+ *
+ * walsummarizer.c
+ *
+ * The WAL summarizer is a background worker that reads the WAL as it is
+ * flushed and records which relation blocks each stretch of WAL modifies.
+ * Whenever it reaches a checkpoint record it writes the set of blocks
+ * changed since the previous one to a compact bitmap file in
+ * pg_wal/summaries.  Tools that need to know what changed between two
+ * points in the WAL, such as an incremental base backup or pg_rewind, can
+ * then read the summaries instead of decoding the WAL themselves.
+ *
+ * The summarizer starts where the newest existing summary ends, or at the
+ * current redo pointer if there is none, or if the WAL it would need has
+ * already been removed.  In the latter case the summaries have a gap, which
+ * consumers detect by the summary LSN ranges not being contiguous.
+ *
+ * Only blocks referenced by WAL records are tracked.  Free space map
+ * changes are not WAL-logged, so consumers should copy non-main forks in
+ * full; the summaries still record when such a fork was truncated.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/walsummarizer.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/rmgr.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_control.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_crc32c.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/walsummarizer.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/pg_lsn.h"
+#include "utils/timestamp.h"
+
+/* GUC options */
+bool		summarize_wal = false;
+int			wal_summary_keep_time = 14400;	/* minutes */
+
+/* How long to sleep when we've caught up with the flushed WAL */
+#define WAL_SUMMARIZER_NAPTIME		1000	/* ms */
+
+/* How often to look for summaries older than wal_summary_keep_time */
+#define WAL_SUMMARY_CLEANUP_INTERVAL	60000	/* ms */
+
+/* Length of a summary file name, without the ".summary" suffix */
+#define WAL_SUMMARY_NAME_LEN	32
+
+/* Blocks modified in one relation fork since the last summary */
+typedef struct BlockRefKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} BlockRefKey;
+
+typedef struct BlockRefEntry
+{
+	BlockRefKey key;			/* hash key; must be first */
+	BlockNumber limit_block;
+	uint32		bitmap_bytes;
+	uint8	   *bitmap;
+} BlockRefEntry;
+
+static HTAB *block_refs = NULL;
+static MemoryContext summary_context = NULL;
+
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void WalSummarizerSigHup(SIGNAL_ARGS);
+static void ResetBlockRefs(void);
+static BlockRefEntry *GetBlockRef(const RelFileNode *rnode, ForkNumber forknum);
+static void MarkBlockModified(const RelFileNode *rnode, ForkNumber forknum,
+							  BlockNumber blkno);
+static void SetLimitBlock(const RelFileNode *rnode, ForkNumber forknum,
+						  BlockNumber limit_block);
+static bool SummarizeRecord(XLogReaderState *reader);
+static int	block_ref_cmp(const void *a, const void *b);
+static void WriteWalSummary(XLogRecPtr start_lsn, XLogRecPtr end_lsn);
+static void RemoveOldWalSummaries(void);
+static bool IsWalSummaryFileName(const char *name, WalSummaryFile *ws);
+static bool WalHasBeenRemoved(XLogRecPtr lsn);
+
+/*
+ * Register the WAL summarizer, if enabled.  Like the logical replication
+ * launcher, this must happen before InitializeMaxBackends().
+ */
+void
+WalSummarizerRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (!summarize_wal)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "WalSummarizerMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "WAL summarizer");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "WAL summarizer");
+	bgw.bgw_restart_time = 10;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+/*
+ * Main entry point for the WAL summarizer.
+ */
+void
+WalSummarizerMain(Datum main_arg)
+{
+	XLogReaderState *reader;
+	XLogRecPtr	summary_start = InvalidXLogRecPtr;
+	XLogRecPtr	read_from;
+	TimestampTz last_cleanup = 0;
+	List	   *summaries;
+	ListCell   *lc;
+
+	pqsignal(SIGHUP, WalSummarizerSigHup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* This sets up ThisTimeLineID, which read_local_xlog_page relies on. */
+	(void) RecoveryInProgress();
+
+	if (MakePGDirectory(WALSUMMARY_DIR) < 0 && errno != EEXIST)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create directory \"%s\": %m",
+						WALSUMMARY_DIR)));
+
+	summary_context = AllocSetContextCreate(TopMemoryContext,
+											"WAL summary",
+											ALLOCSET_DEFAULT_SIZES);
+	ResetBlockRefs();
+
+	/* Continue where the newest summary left off, if we can. */
+	summaries = GetWalSummaries(InvalidXLogRecPtr, InvalidXLogRecPtr);
+	foreach(lc, summaries)
+	{
+		WalSummaryFile *ws = (WalSummaryFile *) lfirst(lc);
+
+		if (ws->end_lsn > summary_start)
+			summary_start = ws->end_lsn;
+	}
+	list_free_deep(summaries);
+
+	if (!XLogRecPtrIsInvalid(summary_start) && WalHasBeenRemoved(summary_start))
+	{
+		ereport(LOG,
+				(errmsg("WAL summarization cannot continue at %X/%X because the WAL has been removed",
+						(uint32) (summary_start >> 32), (uint32) summary_start)));
+		summary_start = InvalidXLogRecPtr;
+	}
+	if (XLogRecPtrIsInvalid(summary_start))
+		summary_start = GetRedoRecPtr();
+
+	ereport(DEBUG1,
+			(errmsg("WAL summarizer starting at %X/%X",
+					(uint32) (summary_start >> 32), (uint32) summary_start)));
+
+	reader = XLogReaderAllocate(wal_segment_size, read_local_xlog_page, NULL);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	read_from = summary_start;
+
+	for (;;)
+	{
+		XLogRecord *record;
+		XLogRecPtr	next;
+		TimestampTz now;
+		char	   *errormsg;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		now = GetCurrentTimestamp();
+		if (wal_summary_keep_time > 0 &&
+			TimestampDifferenceExceeds(last_cleanup, now,
+									   WAL_SUMMARY_CLEANUP_INTERVAL))
+		{
+			RemoveOldWalSummaries();
+			last_cleanup = now;
+		}
+
+		/*
+		 * Sleep if we've consumed all the flushed WAL.  read_local_xlog_page
+		 * would wait too, but it polls far too eagerly for a process that is
+		 * idle most of the time.
+		 */
+		next = XLogRecPtrIsInvalid(read_from) ? reader->EndRecPtr : read_from;
+		if (next >= GetFlushRecPtr())
+		{
+			int			rc;
+
+			rc = WaitLatch(MyLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						   WAL_SUMMARIZER_NAPTIME,
+						   WAIT_EVENT_WAL_SUMMARIZER_MAIN);
+			if (rc & WL_LATCH_SET)
+				ResetLatch(MyLatch);
+			continue;
+		}
+
+		record = XLogReadRecord(reader, read_from, &errormsg);
+		read_from = InvalidXLogRecPtr;
+		if (record == NULL)
+		{
+			if (errormsg)
+				ereport(ERROR,
+						(errmsg("could not read WAL at %X/%X: %s",
+								(uint32) (next >> 32), (uint32) next,
+								errormsg)));
+			else
+				ereport(ERROR,
+						(errmsg("could not read WAL at %X/%X",
+								(uint32) (next >> 32), (uint32) next)));
+		}
+
+		if (SummarizeRecord(reader))
+		{
+			WriteWalSummary(summary_start, reader->EndRecPtr);
+			summary_start = reader->EndRecPtr;
+			ResetBlockRefs();
+		}
+	}
+}
+
+/* SIGHUP: set flag to re-read config file at next convenient time */
+static void
+WalSummarizerSigHup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Forget all the blocks collected for the current summary.
+ */
+static void
+ResetBlockRefs(void)
+{
+	HASHCTL		ctl;
+
+	MemoryContextReset(summary_context);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(BlockRefKey);
+	ctl.entrysize = sizeof(BlockRefEntry);
+	ctl.hcxt = summary_context;
+	block_refs = hash_create("WAL summary block references", 1024, &ctl,
+							 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+static BlockRefEntry *
+GetBlockRef(const RelFileNode *rnode, ForkNumber forknum)
+{
+	BlockRefKey key;
+	BlockRefEntry *entry;
+	bool		found;
+
+	memset(&key, 0, sizeof(key));
+	key.rnode = *rnode;
+	key.forknum = forknum;
+
+	entry = (BlockRefEntry *) hash_search(block_refs, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->limit_block = InvalidBlockNumber;
+		entry->bitmap_bytes = 0;
+		entry->bitmap = NULL;
+	}
+	return entry;
+}
+
+static void
+MarkBlockModified(const RelFileNode *rnode, ForkNumber forknum,
+				  BlockNumber blkno)
+{
+	BlockRefEntry *entry = GetBlockRef(rnode, forknum);
+	uint32		byteno = blkno / BITS_PER_BYTE;
+
+	if (byteno >= entry->bitmap_bytes)
+	{
+		uint32		newsize = Max(entry->bitmap_bytes * 2, 64);
+
+		newsize = Max(newsize, byteno + 1);
+		if (entry->bitmap == NULL)
+			entry->bitmap = MemoryContextAllocZero(summary_context, newsize);
+		else
+		{
+			entry->bitmap = repalloc(entry->bitmap, newsize);
+			memset(entry->bitmap + entry->bitmap_bytes, 0,
+				   newsize - entry->bitmap_bytes);
+		}
+		entry->bitmap_bytes = newsize;
+	}
+
+	entry->bitmap[byteno] |= 1 << (blkno % BITS_PER_BYTE);
+}
+
+/*
+ * Record that a relation fork was created or truncated to limit_block
+ * blocks.  Modifications of blocks beyond the new end are no longer
+ * interesting.
+ */
+static void
+SetLimitBlock(const RelFileNode *rnode, ForkNumber forknum,
+			  BlockNumber limit_block)
+{
+	BlockRefEntry *entry = GetBlockRef(rnode, forknum);
+	uint32		byteno = limit_block / BITS_PER_BYTE;
+
+	if (limit_block < entry->limit_block)
+		entry->limit_block = limit_block;
+
+	if (byteno < entry->bitmap_bytes)
+	{
+		entry->bitmap[byteno] &= (1 << (limit_block % BITS_PER_BYTE)) - 1;
+		memset(entry->bitmap + byteno + 1, 0,
+			   entry->bitmap_bytes - byteno - 1);
+	}
+}
+
+/*
+ * Add the blocks touched by one WAL record to the current summary.  Returns
+ * true if the record is a checkpoint, so the summary should be written out.
+ */
+static bool
+SummarizeRecord(XLogReaderState *reader)
+{
+	RmgrId		rmid = XLogRecGetRmid(reader);
+	uint8		info = XLogRecGetInfo(reader) & ~XLR_INFO_MASK;
+	int			block_id;
+
+	if (rmid == RM_SMGR_ID)
+	{
+		if (info == XLOG_SMGR_CREATE)
+		{
+			xl_smgr_create *xlrec = (xl_smgr_create *) XLogRecGetData(reader);
+
+			SetLimitBlock(&xlrec->rnode, xlrec->forkNum, 0);
+		}
+		else if (info == XLOG_SMGR_TRUNCATE)
+		{
+			xl_smgr_truncate *xlrec = (xl_smgr_truncate *) XLogRecGetData(reader);
+
+			/*
+			 * The new length of the FSM and VM forks isn't in the record, so
+			 * just say they were truncated away entirely.
+			 */
+			if ((xlrec->flags & SMGR_TRUNCATE_HEAP) != 0)
+				SetLimitBlock(&xlrec->rnode, MAIN_FORKNUM, xlrec->blkno);
+			if ((xlrec->flags & SMGR_TRUNCATE_FSM) != 0)
+				SetLimitBlock(&xlrec->rnode, FSM_FORKNUM, 0);
+			if ((xlrec->flags & SMGR_TRUNCATE_VM) != 0)
+				SetLimitBlock(&xlrec->rnode, VISIBILITYMAP_FORKNUM, 0);
+		}
+	}
+	else if (rmid == RM_DBASE_ID)
+	{
+		RelFileNode rnode;
+
+		/* CREATE DATABASE copies files without WAL-logging their blocks */
+		if (info == XLOG_DBASE_CREATE)
+		{
+			xl_dbase_create_rec *xlrec =
+			(xl_dbase_create_rec *) XLogRecGetData(reader);
+
+			rnode.spcNode = xlrec->tablespace_id;
+			rnode.dbNode = xlrec->db_id;
+			rnode.relNode = InvalidOid;
+			SetLimitBlock(&rnode, MAIN_FORKNUM, 0);
+		}
+		else if (info == XLOG_DBASE_DROP)
+		{
+			xl_dbase_drop_rec *xlrec = (xl_dbase_drop_rec *) XLogRecGetData(reader);
+
+			rnode.spcNode = xlrec->tablespace_id;
+			rnode.dbNode = xlrec->db_id;
+			rnode.relNode = InvalidOid;
+			SetLimitBlock(&rnode, MAIN_FORKNUM, 0);
+		}
+	}
+
+	for (block_id = 0; block_id <= reader->max_block_id; block_id++)
+	{
+		RelFileNode rnode;
+		ForkNumber	forknum;
+		BlockNumber blkno;
+
+		if (!XLogRecGetBlockTag(reader, block_id, &rnode, &forknum, &blkno))
+			continue;
+		MarkBlockModified(&rnode, forknum, blkno);
+	}
+
+	return rmid == RM_XLOG_ID &&
+		(info == XLOG_CHECKPOINT_SHUTDOWN || info == XLOG_CHECKPOINT_ONLINE);
+}
+
+static int
+block_ref_cmp(const void *a, const void *b)
+{
+	const BlockRefEntry *ea = *(BlockRefEntry *const *) a;
+	const BlockRefEntry *eb = *(BlockRefEntry *const *) b;
+
+	if (ea->key.rnode.spcNode != eb->key.rnode.spcNode)
+		return ea->key.rnode.spcNode < eb->key.rnode.spcNode ? -1 : 1;
+	if (ea->key.rnode.dbNode != eb->key.rnode.dbNode)
+		return ea->key.rnode.dbNode < eb->key.rnode.dbNode ? -1 : 1;
+	if (ea->key.rnode.relNode != eb->key.rnode.relNode)
+		return ea->key.rnode.relNode < eb->key.rnode.relNode ? -1 : 1;
+	if (ea->key.forknum != eb->key.forknum)
+		return ea->key.forknum < eb->key.forknum ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Write the current summary to disk, covering WAL from start_lsn up to
+ * end_lsn.
+ */
+static void
+WriteWalSummary(XLogRecPtr start_lsn, XLogRecPtr end_lsn)
+{
+	StringInfoData buf;
+	WalSummaryFileHeader header;
+	BlockRefEntry **entries;
+	BlockRefEntry *entry;
+	HASH_SEQ_STATUS status;
+	pg_crc32c	crc;
+	char		temppath[MAXPGPATH];
+	char		path[MAXPGPATH];
+	int			nentries = 0;
+	int			fd;
+	int			i;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(summary_context);
+
+	entries = palloc(sizeof(BlockRefEntry *) * Max(hash_get_num_entries(block_refs), 1));
+	hash_seq_init(&status, block_refs);
+	while ((entry = (BlockRefEntry *) hash_seq_search(&status)) != NULL)
+		entries[nentries++] = entry;
+	qsort(entries, nentries, sizeof(BlockRefEntry *), block_ref_cmp);
+
+	memset(&header, 0, sizeof(header));
+	header.magic = WALSUMMARY_MAGIC;
+	header.nentries = nentries;
+	header.start_lsn = start_lsn;
+	header.end_lsn = end_lsn;
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, (char *) &header, sizeof(header));
+	for (i = 0; i < nentries; i++)
+	{
+		WalSummaryEntry out;
+		uint32		nbytes = entries[i]->bitmap_bytes;
+
+		/* Don't store the unused tail of the bitmap */
+		while (nbytes > 0 && entries[i]->bitmap[nbytes - 1] == 0)
+			nbytes--;
+
+		memset(&out, 0, sizeof(out));
+		out.rnode = entries[i]->key.rnode;
+		out.forknum = entries[i]->key.forknum;
+		out.limit_block = entries[i]->limit_block;
+		out.bitmap_bytes = nbytes;
+		appendBinaryStringInfo(&buf, (char *) &out, sizeof(out));
+		if (nbytes > 0)
+			appendBinaryStringInfo(&buf, (char *) entries[i]->bitmap, nbytes);
+	}
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, buf.data, buf.len);
+	FIN_CRC32C(crc);
+	appendBinaryStringInfo(&buf, (char *) &crc, sizeof(crc));
+
+	snprintf(temppath, MAXPGPATH, WALSUMMARY_DIR "/summary.tmp");
+	snprintf(path, MAXPGPATH, WALSUMMARY_DIR "/%08X%08X%08X%08X.summary",
+			 (uint32) (start_lsn >> 32), (uint32) start_lsn,
+			 (uint32) (end_lsn >> 32), (uint32) end_lsn);
+
+	fd = OpenTransientFile(temppath, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", temppath)));
+
+	errno = 0;
+	if (write(fd, buf.data, buf.len) != buf.len)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write file \"%s\": %m", temppath)));
+	}
+
+	if (pg_fsync(fd) != 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", temppath)));
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", temppath)));
+
+	(void) durable_rename(temppath, path, ERROR);
+
+	ereport(DEBUG1,
+			(errmsg("wrote WAL summary for %X/%X to %X/%X covering %d relation forks",
+					(uint32) (start_lsn >> 32), (uint32) start_lsn,
+					(uint32) (end_lsn >> 32), (uint32) end_lsn, nentries)));
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Remove summary files last modified more than wal_summary_keep_time ago.
+ */
+static void
+RemoveOldWalSummaries(void)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	time_t		cutoff = time(NULL) - (time_t) wal_summary_keep_time * 60;
+
+	dir = AllocateDir(WALSUMMARY_DIR);
+	while ((de = ReadDir(dir, WALSUMMARY_DIR)) != NULL)
+	{
+		char		path[MAXPGPATH];
+		struct stat st;
+		WalSummaryFile ws;
+
+		if (!IsWalSummaryFileName(de->d_name, &ws))
+			continue;
+
+		snprintf(path, MAXPGPATH, WALSUMMARY_DIR "/%s", de->d_name);
+		if (stat(path, &st) != 0)
+		{
+			if (errno != ENOENT)
+				ereport(LOG,
+						(errcode_for_file_access(),
+						 errmsg("could not stat file \"%s\": %m", path)));
+			continue;
+		}
+		if (st.st_mtime >= cutoff)
+			continue;
+
+		ereport(DEBUG2,
+				(errmsg("removing WAL summary file \"%s\"", path)));
+		if (unlink(path) != 0 && errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+	}
+	FreeDir(dir);
+}
+
+/*
+ * Does the file name look like a summary file?  If so, extract its range.
+ */
+static bool
+IsWalSummaryFileName(const char *name, WalSummaryFile *ws)
+{
+	uint32		start_hi,
+				start_lo,
+				end_hi,
+				end_lo;
+
+	if (strlen(name) != WAL_SUMMARY_NAME_LEN + strlen(".summary") ||
+		strspn(name, "0123456789ABCDEF") != WAL_SUMMARY_NAME_LEN ||
+		strcmp(name + WAL_SUMMARY_NAME_LEN, ".summary") != 0)
+		return false;
+
+	if (sscanf(name, "%08X%08X%08X%08X",
+			   &start_hi, &start_lo, &end_hi, &end_lo) != 4)
+		return false;
+
+	ws->start_lsn = ((uint64) start_hi) << 32 | start_lo;
+	ws->end_lsn = ((uint64) end_hi) << 32 | end_lo;
+	return true;
+}
+
+/*
+ * Has the WAL segment containing lsn already been removed or recycled?
+ */
+static bool
+WalHasBeenRemoved(XLogRecPtr lsn)
+{
+	XLogSegNo	segno;
+
+	XLByteToSeg(lsn, segno, wal_segment_size);
+	return segno <= XLogGetLastRemovedSegno();
+}
+
+/*
+ * Return a list of WalSummaryFile for the summaries on disk that overlap
+ * [start_lsn, end_lsn).  Either bound may be InvalidXLogRecPtr, meaning
+ * unbounded.
+ */
+List *
+GetWalSummaries(XLogRecPtr start_lsn, XLogRecPtr end_lsn)
+{
+	List	   *result = NIL;
+	DIR		   *dir;
+	struct dirent *de;
+
+	dir = AllocateDir(WALSUMMARY_DIR);
+	if (dir == NULL && errno == ENOENT)
+		return NIL;
+	while ((de = ReadDir(dir, WALSUMMARY_DIR)) != NULL)
+	{
+		WalSummaryFile ws;
+		WalSummaryFile *wsp;
+
+		if (!IsWalSummaryFileName(de->d_name, &ws))
+			continue;
+		if (!XLogRecPtrIsInvalid(start_lsn) && ws.end_lsn <= start_lsn)
+			continue;
+		if (!XLogRecPtrIsInvalid(end_lsn) && ws.start_lsn >= end_lsn)
+			continue;
+
+		wsp = palloc(sizeof(WalSummaryFile));
+		*wsp = ws;
+		result = lappend(result, wsp);
+	}
+	FreeDir(dir);
+
+	return result;
+}
+
+/*
+ * Read a summary file into memory and verify it, returning a reader for
+ * WalSummaryNextEntry.
+ */
+WalSummaryReader *
+WalSummaryOpen(const WalSummaryFile *ws)
+{
+	WalSummaryReader *reader;
+	WalSummaryFileHeader header;
+	char		path[MAXPGPATH];
+	struct stat st;
+	pg_crc32c	crc;
+	pg_crc32c	filecrc;
+	int			fd;
+	int			r;
+
+	snprintf(path, MAXPGPATH, WALSUMMARY_DIR "/%08X%08X%08X%08X.summary",
+			 (uint32) (ws->start_lsn >> 32), (uint32) ws->start_lsn,
+			 (uint32) (ws->end_lsn >> 32), (uint32) ws->end_lsn);
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+	if (fstat(fd, &st) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+
+	reader = palloc(sizeof(WalSummaryReader));
+	reader->len = st.st_size;
+	reader->data = palloc(reader->len);
+
+	r = read(fd, reader->data, reader->len);
+	if (r != reader->len)
+	{
+		if (r < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("could not read file \"%s\": read %d of %zu",
+							path, r, reader->len)));
+	}
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", path)));
+
+	if (reader->len < sizeof(WalSummaryFileHeader) + sizeof(pg_crc32c))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("WAL summary file \"%s\" is too short", path)));
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, reader->data, reader->len - sizeof(pg_crc32c));
+	FIN_CRC32C(crc);
+	memcpy(&filecrc, reader->data + reader->len - sizeof(pg_crc32c),
+		   sizeof(pg_crc32c));
+	memcpy(&header, reader->data, sizeof(header));
+	if (!EQ_CRC32C(crc, filecrc) || header.magic != WALSUMMARY_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("WAL summary file \"%s\" is corrupt", path)));
+
+	reader->len -= sizeof(pg_crc32c);
+	reader->pos = sizeof(WalSummaryFileHeader);
+	reader->remaining = header.nentries;
+	return reader;
+}
+
+/*
+ * Return the next entry of a summary, and its bitmap, which points into the
+ * reader's buffer.  Returns false when there are no more entries.
+ */
+bool
+WalSummaryNextEntry(WalSummaryReader *reader, WalSummaryEntry *entry,
+					const uint8 **bitmap)
+{
+	if (reader->remaining == 0)
+		return false;
+
+	if (reader->len - reader->pos < sizeof(WalSummaryEntry))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("WAL summary file is truncated")));
+	memcpy(entry, reader->data + reader->pos, sizeof(WalSummaryEntry));
+	reader->pos += sizeof(WalSummaryEntry);
+
+	if (reader->len - reader->pos < entry->bitmap_bytes)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("WAL summary file is truncated")));
+	*bitmap = (const uint8 *) reader->data + reader->pos;
+	reader->pos += entry->bitmap_bytes;
+
+	reader->remaining--;
+	return true;
+}
+
+/*
+ * Set up a materialized SRF result for the functions below.
+ */
+static Tuplestorestate *
+wal_summary_tuplestore(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+/*
+ * pg_available_wal_summaries
+ *		List the WAL summary files on disk.
+ */
+Datum
+pg_available_wal_summaries(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	List	   *summaries;
+	ListCell   *lc;
+
+	tupstore = wal_summary_tuplestore(fcinfo, &tupdesc);
+
+	summaries = GetWalSummaries(InvalidXLogRecPtr, InvalidXLogRecPtr);
+	foreach(lc, summaries)
+	{
+		WalSummaryFile *ws = (WalSummaryFile *) lfirst(lc);
+		Datum		values[2];
+		bool		nulls[2];
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = LSNGetDatum(ws->start_lsn);
+		values[1] = LSNGetDatum(ws->end_lsn);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_wal_summary_contents
+ *		Show the blocks recorded in one WAL summary file.
+ *
+ * Each modified block is one row.  A relation fork's limit block, if it has
+ * one, is shown as an extra row with is_limit_block set.
+ */
+Datum
+pg_wal_summary_contents(PG_FUNCTION_ARGS)
+{
+#define PG_WAL_SUMMARY_CONTENTS_COLS	6
+	XLogRecPtr	start_lsn = PG_GETARG_LSN(0);
+	XLogRecPtr	end_lsn = PG_GETARG_LSN(1);
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	WalSummaryFile ws;
+	WalSummaryReader *reader;
+	WalSummaryEntry entry;
+	const uint8 *bitmap;
+	Datum		values[PG_WAL_SUMMARY_CONTENTS_COLS];
+	bool		nulls[PG_WAL_SUMMARY_CONTENTS_COLS];
+
+	tupstore = wal_summary_tuplestore(fcinfo, &tupdesc);
+
+	ws.start_lsn = start_lsn;
+	ws.end_lsn = end_lsn;
+	reader = WalSummaryOpen(&ws);
+
+	memset(nulls, 0, sizeof(nulls));
+	while (WalSummaryNextEntry(reader, &entry, &bitmap))
+	{
+		uint32		byteno;
+
+		values[0] = ObjectIdGetDatum(entry.rnode.relNode);
+		values[1] = ObjectIdGetDatum(entry.rnode.spcNode);
+		values[2] = ObjectIdGetDatum(entry.rnode.dbNode);
+		values[3] = Int16GetDatum(entry.forknum);
+
+		if (BlockNumberIsValid(entry.limit_block))
+		{
+			values[4] = Int64GetDatum((int64) entry.limit_block);
+			values[5] = BoolGetDatum(true);
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+
+		values[5] = BoolGetDatum(false);
+		for (byteno = 0; byteno < entry.bitmap_bytes; byteno++)
+		{
+			int			bit;
+
+			if (bitmap[byteno] == 0)
+				continue;
+			for (bit = 0; bit < BITS_PER_BYTE; bit++)
+			{
+				if ((bitmap[byteno] & (1 << bit)) == 0)
+					continue;
+				values[4] = Int64GetDatum((int64) byteno * BITS_PER_BYTE + bit);
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -38,10 +38,27 @@
 #include "storage/ipc.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/timestamp.h"
 
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+
+/* Server-side compression of the tar streams */
+typedef enum
+{
+	BACKUP_COMPRESSION_NONE,
+	BACKUP_COMPRESSION_LZ4,
+	BACKUP_COMPRESSION_ZSTD
+} BackupCompression;
 
 typedef struct
 {
@@ -52,6 +69,8 @@ typedef struct
 	bool		includewal;
 	uint32		maxrate;
 	bool		sendtblspcmapfile;
+	BackupCompression compression;
+	int			compression_level;
 } basebackup_options;
 
 
@@ -72,6 +91,9 @@ static void SendXlogRecPtrResult(XLogRecPtr ptr, TimeLineID tli);
 static int	compareWalFileNames(const void *a, const void *b);
 static void throttle(size_t increment);
 static bool is_checksummed_file(const char *fullpath, const char *filename);
+static void BeginCopyStream(void);
+static int	SendCopyData(const char *data, size_t len);
+static void EndCopyStream(void);
 
 /* Was the backup currently in-progress initiated in recovery mode? */
 static bool backup_started_in_recovery = false;
@@ -119,6 +141,28 @@ static XLogRecPtr startptr;
 /* Total number of checksum failures during base backup. */
 static int64 total_checksum_failures;
 
+/*
+ * Compression applied to each tar stream, and its state.  When compressing,
+ * the tar end-of-archive blocks are included in the stream, since the client
+ * can't append them to compressed data.
+ */
+static BackupCompression stream_compression = BACKUP_COMPRESSION_NONE;
+static int	stream_compression_level = 0;
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static char *compress_buf = NULL;
+static size_t compress_buf_size = 0;
+#endif
+
+#ifdef USE_LZ4
+static LZ4F_cctx *lz4_cctx = NULL;
+static LZ4F_preferences_t lz4_prefs;
+#endif
+
+#ifdef USE_ZSTD
+static ZSTD_CCtx *zstd_cctx = NULL;
+#endif
+
 /* Do not verify checksums. */
 static bool noverify_checksums = false;
 
@@ -256,6 +300,9 @@ perform_base_backup(basebackup_options *opt)
 
 	total_checksum_failures = 0;
 
+	stream_compression = opt->compression;
+	stream_compression_level = opt->compression_level;
+
 	startptr = do_pg_start_backup(opt->label, opt->fastcheckpoint, &starttli,
 								  labelfile, &tablespaces,
 								  tblspc_map_file,
@@ -323,13 +370,8 @@ perform_base_backup(basebackup_options *opt)
 		foreach(lc, tablespaces)
 		{
 			tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
-			StringInfoData buf;
 
-			/* Send CopyOutResponse message */
-			pq_beginmessage(&buf, 'H');
-			pq_sendbyte(&buf, 0);	/* overall format */
-			pq_sendint16(&buf, 0);	/* natts */
-			pq_endmessage(&buf);
+			BeginCopyStream();
 
 			if (ti->path == NULL)
 			{
@@ -372,7 +414,7 @@ perform_base_backup(basebackup_options *opt)
 				Assert(lnext(lc) == NULL);
 			}
 			else
-				pq_putemptymessage('c');	/* CopyDone */
+				EndCopyStream();
 		}
 
 		endptr = do_pg_stop_backup(labelfile->data, !opt->nowait, &endtli);
@@ -553,7 +595,7 @@ perform_base_backup(basebackup_options *opt)
 			{
 				CheckXLogRemoved(segno, tli);
 				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
+				if (SendCopyData(buf, cnt))
 					ereport(ERROR,
 							(errmsg("base backup could not send data, aborting backup")));
 
@@ -616,7 +658,7 @@ perform_base_backup(basebackup_options *opt)
 		}
 
 		/* Send CopyDone message for the last tar file */
-		pq_putemptymessage('c');
+		EndCopyStream();
 	}
 	SendXlogRecPtrResult(endptr, endtli);
 
@@ -666,6 +708,8 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_maxrate = false;
 	bool		o_tablespace_map = false;
 	bool		o_noverify_checksums = false;
+	bool		o_compression = false;
+	bool		o_compression_level = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	foreach(lopt, options)
@@ -754,12 +798,90 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 			noverify_checksums = true;
 			o_noverify_checksums = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *method = strVal(defel->arg);
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+
+			if (strcmp(method, "none") == 0)
+				opt->compression = BACKUP_COMPRESSION_NONE;
+			else if (strcmp(method, "lz4") == 0)
+			{
+#ifndef USE_LZ4
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("LZ4 compression is not supported by this build")));
+#endif
+				opt->compression = BACKUP_COMPRESSION_LZ4;
+			}
+			else if (strcmp(method, "zstd") == 0)
+			{
+#ifndef USE_ZSTD
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("Zstandard compression is not supported by this build")));
+#endif
+				opt->compression = BACKUP_COMPRESSION_ZSTD;
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("unrecognized compression method \"%s\"",
+								method)));
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_level") == 0)
+		{
+			if (o_compression_level)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->compression_level = intVal(defel->arg);
+			o_compression_level = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
 	}
 	if (opt->label == NULL)
 		opt->label = "base backup";
+
+	/* Check the compression level against the method's range */
+	if (o_compression_level)
+	{
+		int			maxlevel = 0;
+		int			minlevel = 0;
+
+		if (opt->compression == BACKUP_COMPRESSION_LZ4)
+			maxlevel = 12;
+		else if (opt->compression == BACKUP_COMPRESSION_ZSTD)
+		{
+			minlevel = 1;
+#ifdef USE_ZSTD
+			maxlevel = ZSTD_maxCLevel();
+#endif
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("COMPRESSION_LEVEL requires COMPRESSION")));
+
+		if (opt->compression_level < minlevel ||
+			opt->compression_level > maxlevel)
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("%d is outside the valid range for parameter \"%s\" (%d .. %d)",
+							opt->compression_level, "COMPRESSION_LEVEL",
+							minlevel, maxlevel)));
+	}
+#ifdef USE_ZSTD
+	else if (opt->compression == BACKUP_COMPRESSION_ZSTD)
+		opt->compression_level = ZSTD_CLEVEL_DEFAULT;
+#endif
 }
 
 
@@ -961,7 +1083,7 @@ sendFileWithContent(const char *filename, const char *content)
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
 	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	SendCopyData(content, len);
 
 	/* Pad to 512 byte boundary, per tar format requirements */
 	pad = ((len + 511) & ~511) - len;
@@ -970,7 +1092,7 @@ sendFileWithContent(const char *filename, const char *content)
 		char		buf[512];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		SendCopyData(buf, pad);
 	}
 }
 
@@ -1575,7 +1697,7 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 		}
 
 		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
+		if (SendCopyData(buf, cnt))
 			ereport(ERROR,
 					(errmsg("base backup could not send data, aborting backup")));
 
@@ -1602,7 +1724,7 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			SendCopyData(buf, cnt);
 			len += cnt;
 			throttle(cnt);
 		}
@@ -1616,7 +1738,7 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		SendCopyData(buf, pad);
 	}
 
 	FreeFile(fp);
@@ -1670,7 +1792,7 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		SendCopyData(h, sizeof(h));
 	}
 
 	return sizeof(h);
@@ -1695,6 +1817,227 @@ _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *statbuf,
 	return _tarWriteHeader(pathbuf + basepathlen + 1, NULL, statbuf, sizeonly);
 }
 
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Make sure compress_buf can hold at least size bytes.
+ */
+static void
+EnsureCompressBuffer(size_t size)
+{
+	if (compress_buf_size < size)
+	{
+		if (compress_buf)
+			pfree(compress_buf);
+		compress_buf = MemoryContextAlloc(TopMemoryContext, size);
+		compress_buf_size = size;
+	}
+}
+#endif
+
+/*
+ * BeginCopyStream - start sending one tar stream
+ *
+ * Sends the CopyOutResponse message, and starts a new compressed frame if
+ * server-side compression was requested.
+ */
+static void
+BeginCopyStream(void)
+{
+	StringInfoData buf;
+
+	/* Send CopyOutResponse message */
+	pq_beginmessage(&buf, 'H');
+	pq_sendbyte(&buf, 0);		/* overall format */
+	pq_sendint16(&buf, 0);		/* natts */
+	pq_endmessage(&buf);
+
+	switch (stream_compression)
+	{
+		case BACKUP_COMPRESSION_NONE:
+			break;
+
+		case BACKUP_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		n;
+
+				if (lz4_cctx == NULL &&
+					LZ4F_isError(LZ4F_createCompressionContext(&lz4_cctx,
+															   LZ4F_VERSION)))
+					ereport(ERROR,
+							(errcode(ERRCODE_OUT_OF_MEMORY),
+							 errmsg("could not create LZ4 compression context")));
+
+				MemSet(&lz4_prefs, 0, sizeof(lz4_prefs));
+				lz4_prefs.compressionLevel = stream_compression_level;
+
+				/* room for a full chunk, plus frame header or footer */
+				EnsureCompressBuffer(LZ4F_compressBound(TAR_SEND_SIZE,
+														&lz4_prefs) + 64);
+
+				n = LZ4F_compressBegin(lz4_cctx, compress_buf,
+									   compress_buf_size, &lz4_prefs);
+				if (LZ4F_isError(n))
+					elog(ERROR, "could not begin LZ4 frame: %s",
+						 LZ4F_getErrorName(n));
+				if (pq_putmessage('d', compress_buf, n))
+					ereport(ERROR,
+							(errmsg("base backup could not send data, aborting backup")));
+			}
+#endif
+			break;
+
+		case BACKUP_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			if (zstd_cctx == NULL)
+			{
+				zstd_cctx = ZSTD_createCCtx();
+				if (zstd_cctx == NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_OUT_OF_MEMORY),
+							 errmsg("could not create Zstandard compression context")));
+			}
+			ZSTD_CCtx_reset(zstd_cctx, ZSTD_reset_session_and_parameters);
+			ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_compressionLevel,
+								   stream_compression_level);
+			EnsureCompressBuffer(ZSTD_CStreamOutSize());
+#endif
+			break;
+	}
+}
+
+/*
+ * SendCopyData - send part of a tar stream as CopyData messages
+ *
+ * Like pq_putmessage, returns 0 if OK, EOF if trouble.  If the stream is
+ * being compressed, the data may be buffered by the compressor and sent
+ * later.
+ */
+static int
+SendCopyData(const char *data, size_t len)
+{
+	switch (stream_compression)
+	{
+		case BACKUP_COMPRESSION_NONE:
+			break;
+
+		case BACKUP_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			while (len > 0)
+			{
+				size_t		chunk = Min(len, TAR_SEND_SIZE);
+				size_t		n;
+
+				n = LZ4F_compressUpdate(lz4_cctx, compress_buf,
+										compress_buf_size, data, chunk, NULL);
+				if (LZ4F_isError(n))
+					elog(ERROR, "could not compress data: %s",
+						 LZ4F_getErrorName(n));
+				if (n > 0 && pq_putmessage('d', compress_buf, n))
+					return EOF;
+				data += chunk;
+				len -= chunk;
+			}
+			return 0;
+#else
+			break;
+#endif
+
+		case BACKUP_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {data, len, 0};
+
+				while (in.pos < in.size)
+				{
+					ZSTD_outBuffer out = {compress_buf, compress_buf_size, 0};
+					size_t		r;
+
+					r = ZSTD_compressStream2(zstd_cctx, &out, &in,
+											 ZSTD_e_continue);
+					if (ZSTD_isError(r))
+						elog(ERROR, "could not compress data: %s",
+							 ZSTD_getErrorName(r));
+					if (out.pos > 0 &&
+						pq_putmessage('d', compress_buf, out.pos))
+						return EOF;
+				}
+			}
+			return 0;
+#else
+			break;
+#endif
+	}
+
+	return pq_putmessage('d', data, len);
+}
+
+/*
+ * EndCopyStream - finish sending one tar stream
+ *
+ * When compressing, append the tar end-of-archive marker and flush the
+ * compressor before sending CopyDone.
+ */
+static void
+EndCopyStream(void)
+{
+	if (stream_compression != BACKUP_COMPRESSION_NONE)
+	{
+		char		zerobuf[1024];
+		bool		failed = false;
+
+		/* 2 * 512 bytes empty data at end of file */
+		MemSet(zerobuf, 0, sizeof(zerobuf));
+		if (SendCopyData(zerobuf, sizeof(zerobuf)))
+			failed = true;
+
+#ifdef USE_LZ4
+		if (!failed && stream_compression == BACKUP_COMPRESSION_LZ4)
+		{
+			size_t		n;
+
+			n = LZ4F_compressEnd(lz4_cctx, compress_buf, compress_buf_size,
+								 NULL);
+			if (LZ4F_isError(n))
+				elog(ERROR, "could not end LZ4 frame: %s",
+					 LZ4F_getErrorName(n));
+			if (n > 0 && pq_putmessage('d', compress_buf, n))
+				failed = true;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (!failed && stream_compression == BACKUP_COMPRESSION_ZSTD)
+		{
+			ZSTD_inBuffer in = {NULL, 0, 0};
+			size_t		remaining;
+
+			do
+			{
+				ZSTD_outBuffer out = {compress_buf, compress_buf_size, 0};
+
+				remaining = ZSTD_compressStream2(zstd_cctx, &out, &in,
+												 ZSTD_e_end);
+				if (ZSTD_isError(remaining))
+					elog(ERROR, "could not compress data: %s",
+						 ZSTD_getErrorName(remaining));
+				if (out.pos > 0 &&
+					pq_putmessage('d', compress_buf, out.pos))
+				{
+					failed = true;
+					break;
+				}
+			} while (remaining != 0);
+		}
+#endif
+
+		if (failed)
+			ereport(ERROR,
+					(errmsg("base backup could not send data, aborting backup")));
+	}
+
+	pq_putemptymessage('c');	/* CopyDone */
+}
+
 /*
  * Increment the network transfer counter by the given number of bytes,
  * and sleep if necessary to comply with the requested network transfer
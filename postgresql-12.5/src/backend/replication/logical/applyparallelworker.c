@@ -0,0 +1,990 @@
+/*-------------------------------------------------------------------------
+ * applyparallelworker.c
+ *	   Parallel apply of remote transactions for logical replication
+ *
+ * Copyright (c) 2016-2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/applyparallelworker.c
+ *
+ * NOTES
+ *	  When max_parallel_apply_workers_per_subscription is set, the apply
+ *	  worker of a subscription starts that many parallel apply workers, and
+ *	  hands each remote transaction it receives to one of them instead of
+ *	  applying it itself.  The publisher only sends a transaction once it has
+ *	  committed, so every transaction arrives complete and in commit order;
+ *	  the apply worker just forwards the protocol messages to the chosen
+ *	  worker through a shm_mq in a DSM segment shared by the workers.  A
+ *	  transaction is only given to an idle worker, so each worker has at
+ *	  most one transaction in progress.
+ *
+ *	  Transactions are numbered in the order they are dispatched, and the
+ *	  workers commit them strictly in that order, which is the order the
+ *	  publisher committed them.  That keeps the replication origin progress
+ *	  meaningful: everything up to the origin's position has been applied.
+ *
+ *	  Changes of different transactions may however be applied concurrently,
+ *	  unless they are known to conflict.  For that, the apply worker remembers
+ *	  which transaction last touched each row, identified by the relation and
+ *	  the text of its replica identity columns.  Before forwarding a change to
+ *	  a row that an earlier, still uncommitted transaction has touched, it
+ *	  tells the worker to wait for that transaction to commit.  Changes whose
+ *	  row can't be identified that way, and TRUNCATE, wait for all earlier
+ *	  transactions and make all later ones wait for them.
+ *
+ *	  A worker holds a session-level lock on the remote transaction it is
+ *	  applying until it has committed it, and other workers wait for that
+ *	  transaction by acquiring the same lock.  The deadlock detector can
+ *	  therefore break any cycle involving conflicts the dependency tracking
+ *	  did not foresee, such as ones on unique constraints other than the
+ *	  replica identity; the worker that errors out makes the apply worker
+ *	  exit, and the subscription restarts from the last committed position.
+ *
+ *	  Parallel apply is not used while any table of the subscription is
+ *	  being synchronized; the apply worker then waits for the workers to
+ *	  commit everything they have been given and applies transactions itself.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "replication/logicallauncher.h"
+#include "replication/logicalproto.h"
+#include "replication/logicalrelation.h"
+#include "replication/logicalworker.h"
+#include "replication/origin.h"
+#include "replication/worker_internal.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/hashutils.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+/* Size of each worker's message queue. */
+#define PARALLEL_APPLY_QUEUE_SIZE	(16 * 1024 * 1024)
+
+/* Magic number and keys for the DSM segment's table of contents. */
+#define PARALLEL_APPLY_MAGIC		0x50417070
+#define PARALLEL_APPLY_KEY_SHARED	1
+#define PARALLEL_APPLY_KEY_QUEUES	2
+
+/*
+ * Messages sent by the apply worker on top of the protocol messages it
+ * forwards.  The publisher never sends messages of these types.
+ */
+#define PA_MSG_BEGIN	'b'		/* seq, xid, xid of seq - 1 */
+#define PA_MSG_WAIT		'w'		/* seq, xid to wait for */
+
+/* Forget tracked rows of committed transactions beyond this many. */
+#define PA_MAX_TRACKED_KEYS		65536
+
+/* GUCs */
+int			max_parallel_apply_workers_per_subscription = 0;
+
+typedef struct ParallelApplyWorkerSlot
+{
+	uint64		seq;			/* transaction being applied, or 0 */
+	TransactionId xid;			/* its remote XID */
+} ParallelApplyWorkerSlot;
+
+typedef struct ParallelApplyShared
+{
+	Oid			dbid;
+	Oid			userid;
+	Oid			subid;
+	RepOriginId originid;
+	int			leader_pid;		/* apply worker, which owns the origin */
+	PGPROC	   *leader_proc;
+
+	/* Signalled when a transaction starts being applied or commits. */
+	ConditionVariable cv;
+
+	/* Protects the fields below. */
+	slock_t		mutex;
+	uint64		committed_seq;	/* last transaction committed, in order */
+	XLogRecPtr	last_remote_end;	/* end of last transaction committed */
+	XLogRecPtr	last_local_end; /* ... and of its local commit record */
+	int			nworkers;
+	ParallelApplyWorkerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelApplyShared;
+
+/* Entry of the apply worker's table of rows touched by recent transactions */
+typedef struct ParallelApplyKey
+{
+	LogicalRepRelId relid;
+	uint32		hash;			/* hash of the replica identity values */
+} ParallelApplyKey;
+
+typedef struct ParallelApplyKeyEntry
+{
+	ParallelApplyKey key;
+	uint64		seq;
+	TransactionId xid;
+} ParallelApplyKeyEntry;
+
+static ParallelApplyShared *pa_shared = NULL;
+
+/* Apply worker state */
+static int	pa_nworkers = 0;
+static dsm_segment *pa_seg = NULL;
+static shm_mq_handle **pa_queues = NULL;
+static BackgroundWorkerHandle **pa_handles = NULL;
+static uint64 *pa_worker_seq = NULL;	/* last seq given to each worker */
+static uint64 pa_last_seq = 0;	/* last seq dispatched */
+static TransactionId pa_last_xid = InvalidTransactionId;
+static uint64 pa_last_reported_seq = 0;
+static int	pa_cur_worker = -1; /* worker of current remote transaction */
+static uint64 pa_cur_waited = 0;	/* seq it was told to wait for */
+static TransactionId pa_cur_prev_xid = InvalidTransactionId;
+static uint64 pa_barrier_seq = 0;	/* later transactions wait for this */
+static TransactionId pa_barrier_xid = InvalidTransactionId;
+static HTAB *pa_keys = NULL;
+
+/* Parallel apply worker state */
+bool		InParallelApplyWorker = false;
+static int	pa_my_slot = -1;
+static uint64 pa_my_seq = 0;
+static TransactionId pa_my_xid = InvalidTransactionId;
+static TransactionId pa_prev_xid = InvalidTransactionId;
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void pa_leader_exit(int code, Datum arg);
+static void pa_send(int worker, const char *data, Size len);
+static void pa_check_workers(void);
+static uint64 pa_get_committed_seq(void);
+static int	pa_choose_worker(void);
+static void pa_wait_for_all(void);
+static void pa_add_dependency(uint64 seq, TransactionId xid);
+static void pa_track_row(LogicalRepRelId relid, LogicalRepTupleData *tuple,
+						 bool *tracked);
+static void pa_set_barrier(void);
+static void pa_prune_keys(void);
+static void pa_wait_for_transaction(uint64 seq, TransactionId xid);
+static void pa_worker_sighup(SIGNAL_ARGS);
+
+/*
+ * Start the parallel apply workers for the subscription, if configured.
+ * Called by the apply worker once it has set up the replication origin.
+ * If no worker can be started, transactions are applied serially.
+ */
+void
+pa_start_workers(RepOriginId originid)
+{
+	shm_toc_estimator e;
+	shm_toc    *toc;
+	Size		shared_size;
+	Size		segsize;
+	char	   *queues;
+	MemoryContext oldcontext;
+	int			nworkers = max_parallel_apply_workers_per_subscription;
+	int			i;
+
+	if (nworkers <= 0)
+		return;
+
+	shared_size = add_size(offsetof(ParallelApplyShared, slots),
+						   mul_size(sizeof(ParallelApplyWorkerSlot), nworkers));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, shared_size);
+	shm_toc_estimate_chunk(&e, mul_size(PARALLEL_APPLY_QUEUE_SIZE, nworkers));
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	pa_seg = dsm_create(segsize, 0);
+	dsm_pin_mapping(pa_seg);
+	toc = shm_toc_create(PARALLEL_APPLY_MAGIC, dsm_segment_address(pa_seg),
+						 segsize);
+
+	pa_shared = shm_toc_allocate(toc, shared_size);
+	memset(pa_shared, 0, shared_size);
+	pa_shared->dbid = MyLogicalRepWorker->dbid;
+	pa_shared->userid = MyLogicalRepWorker->userid;
+	pa_shared->subid = MyLogicalRepWorker->subid;
+	pa_shared->originid = originid;
+	pa_shared->leader_pid = MyProcPid;
+	pa_shared->leader_proc = MyProc;
+	ConditionVariableInit(&pa_shared->cv);
+	SpinLockInit(&pa_shared->mutex);
+	pa_shared->committed_seq = 0;
+	pa_shared->last_remote_end = InvalidXLogRecPtr;
+	pa_shared->last_local_end = InvalidXLogRecPtr;
+	pa_shared->nworkers = nworkers;
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, pa_shared);
+
+	queues = shm_toc_allocate(toc, mul_size(PARALLEL_APPLY_QUEUE_SIZE, nworkers));
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_QUEUES, queues);
+
+	oldcontext = MemoryContextSwitchTo(ApplyContext);
+	pa_queues = palloc0(sizeof(shm_mq_handle *) * nworkers);
+	pa_handles = palloc0(sizeof(BackgroundWorkerHandle *) * nworkers);
+	pa_worker_seq = palloc0(sizeof(uint64) * nworkers);
+	MemoryContextSwitchTo(oldcontext);
+
+	before_shmem_exit(pa_leader_exit, (Datum) 0);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		BackgroundWorker worker;
+		shm_mq	   *mq;
+
+		memset(&worker, 0, sizeof(worker));
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+			BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+		sprintf(worker.bgw_library_name, "postgres");
+		sprintf(worker.bgw_function_name, "ParallelApplyWorkerMain");
+		snprintf(worker.bgw_name, BGW_MAXLEN,
+				 "logical replication parallel apply worker for subscription %u",
+				 MyLogicalRepWorker->subid);
+		snprintf(worker.bgw_type, BGW_MAXLEN,
+				 "logical replication parallel worker");
+		worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(pa_seg));
+		memcpy(worker.bgw_extra, &i, sizeof(int));
+		worker.bgw_notify_pid = MyProcPid;
+
+		mq = shm_mq_create(queues + (Size) i * PARALLEL_APPLY_QUEUE_SIZE,
+						   PARALLEL_APPLY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+
+		oldcontext = MemoryContextSwitchTo(ApplyContext);
+		if (!RegisterDynamicBackgroundWorker(&worker, &pa_handles[i]))
+		{
+			MemoryContextSwitchTo(oldcontext);
+			ereport(LOG,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("could only start %d of %d parallel apply workers for subscription \"%s\"",
+							i, nworkers, MySubscription->name),
+					 errhint("You might need to increase max_worker_processes.")));
+			break;
+		}
+		pa_queues[i] = shm_mq_attach(mq, pa_seg, pa_handles[i]);
+		MemoryContextSwitchTo(oldcontext);
+
+		pa_nworkers = i + 1;
+	}
+}
+
+/*
+ * Make the parallel apply workers exit, and wait for them to do so, before
+ * the apply worker releases the replication origin.  Otherwise they could
+ * still be committing transactions when a new apply worker starts streaming
+ * from the origin's position.
+ */
+static void
+pa_leader_exit(int code, Datum arg)
+{
+	int			i;
+
+	for (i = 0; i < pa_nworkers; i++)
+		TerminateBackgroundWorker(pa_handles[i]);
+
+	for (i = 0; i < pa_nworkers; i++)
+	{
+		pid_t		pid;
+
+		while (GetBackgroundWorkerPid(pa_handles[i], &pid) == BGWH_STARTED)
+		{
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 10L, WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+			ResetLatch(MyLatch);
+		}
+	}
+}
+
+/*
+ * Send a message to a parallel apply worker.
+ */
+static void
+pa_send(int worker, const char *data, Size len)
+{
+	if (shm_mq_send(pa_queues[worker], len, data, false, true) != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication parallel apply worker exited unexpectedly")));
+}
+
+/*
+ * Error out if a parallel apply worker has exited; it can't have done so
+ * normally while we are attached to its queue.
+ */
+static void
+pa_check_workers(void)
+{
+	int			i;
+
+	for (i = 0; i < pa_nworkers; i++)
+	{
+		pid_t		pid;
+
+		if (GetBackgroundWorkerPid(pa_handles[i], &pid) == BGWH_STOPPED)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("logical replication parallel apply worker exited unexpectedly")));
+	}
+}
+
+static uint64
+pa_get_committed_seq(void)
+{
+	uint64		seq;
+
+	SpinLockAcquire(&pa_shared->mutex);
+	seq = pa_shared->committed_seq;
+	SpinLockRelease(&pa_shared->mutex);
+
+	return seq;
+}
+
+/*
+ * Are there transactions that have been dispatched but not yet committed?
+ */
+bool
+pa_has_inflight(void)
+{
+	if (pa_nworkers == 0)
+		return false;
+
+	return pa_get_committed_seq() < pa_last_seq;
+}
+
+/*
+ * Record the commits done by the parallel apply workers since the last call
+ * for the flush position reported to the publisher, and check that all the
+ * workers are still alive.  Called by the apply worker in its main loop.
+ */
+void
+pa_process_commits(void)
+{
+	uint64		seq;
+	XLogRecPtr	remote_end;
+	XLogRecPtr	local_end;
+
+	if (pa_nworkers == 0)
+		return;
+
+	SpinLockAcquire(&pa_shared->mutex);
+	seq = pa_shared->committed_seq;
+	remote_end = pa_shared->last_remote_end;
+	local_end = pa_shared->last_local_end;
+	SpinLockRelease(&pa_shared->mutex);
+
+	if (seq > pa_last_reported_seq)
+	{
+		/*
+		 * Commits are done in order, so the latest one covers all earlier
+		 * ones.
+		 */
+		if (!XLogRecPtrIsInvalid(local_end))
+			store_flush_position(remote_end, local_end);
+		pa_last_reported_seq = seq;
+	}
+
+	pa_check_workers();
+}
+
+/*
+ * Choose an idle worker for the next transaction, waiting for one to become
+ * idle if necessary.  Since transactions commit in order, a worker is idle
+ * once the last transaction given to it has committed.
+ */
+static int
+pa_choose_worker(void)
+{
+	static int	next_worker = 0;
+
+	for (;;)
+	{
+		uint64		committed = pa_get_committed_seq();
+		int			i;
+
+		for (i = 0; i < pa_nworkers; i++)
+		{
+			int			worker = (next_worker + i) % pa_nworkers;
+
+			if (pa_worker_seq[worker] <= committed)
+			{
+				next_worker = (worker + 1) % pa_nworkers;
+				return worker;
+			}
+		}
+
+		pa_process_commits();
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L, WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Wait for the parallel apply workers to commit all the transactions that
+ * have been dispatched to them.
+ */
+static void
+pa_wait_for_all(void)
+{
+	while (pa_get_committed_seq() < pa_last_seq)
+	{
+		pa_process_commits();
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L, WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	pa_process_commits();
+}
+
+/*
+ * Make the current transaction wait for transaction "seq" to commit before
+ * applying the next change, unless it already has to.
+ */
+static void
+pa_add_dependency(uint64 seq, TransactionId xid)
+{
+	StringInfoData msg;
+
+	if (seq <= pa_cur_waited || seq >= pa_last_seq)
+		return;
+	if (seq <= pa_get_committed_seq())
+		return;
+
+	initStringInfo(&msg);
+	pq_sendbyte(&msg, PA_MSG_WAIT);
+	pq_sendint64(&msg, seq);
+	pq_sendint32(&msg, xid);
+	pa_send(pa_cur_worker, msg.data, msg.len);
+	pfree(msg.data);
+
+	pa_cur_waited = seq;
+}
+
+/*
+ * Make the current transaction wait for all earlier ones, and all later
+ * ones wait for it.
+ */
+static void
+pa_set_barrier(void)
+{
+	pa_add_dependency(pa_last_seq - 1, pa_cur_prev_xid);
+	pa_barrier_seq = pa_last_seq;
+	pa_barrier_xid = pa_last_xid;
+}
+
+/*
+ * Note that the current transaction changes the row described by "tuple",
+ * and make it wait for the last transaction that changed the same row.
+ * *tracked is cleared if the row can't be identified.
+ *
+ * Only inserts are published for tables without replica identity, and those
+ * can't conflict on anything we could track, so they are ignored.
+ */
+static void
+pa_track_row(LogicalRepRelId relid, LogicalRepTupleData *tuple, bool *tracked)
+{
+	LogicalRepRelation *remoterel = logicalrep_rel_get_remote(relid);
+	ParallelApplyKey key;
+	ParallelApplyKeyEntry *entry;
+	bool		found;
+	int			i;
+
+	if (remoterel == NULL)
+	{
+		*tracked = false;
+		return;
+	}
+	if (bms_is_empty(remoterel->attkeys))
+		return;
+
+	key.relid = relid;
+	key.hash = 0;
+	i = -1;
+	while ((i = bms_next_member(remoterel->attkeys, i)) >= 0)
+	{
+		uint32		h;
+
+		/* Unchanged TOASTed values are not sent. */
+		if (!tuple->changed[i])
+		{
+			*tracked = false;
+			return;
+		}
+
+		if (tuple->values[i] == NULL)
+			h = 0;
+		else if (tuple->lengths[i] >= 0)
+			h = DatumGetUInt32(hash_any((unsigned char *) tuple->values[i],
+										tuple->lengths[i]));
+		else
+			h = DatumGetUInt32(hash_any((unsigned char *) tuple->values[i],
+										strlen(tuple->values[i])));
+		key.hash = hash_combine(key.hash, h);
+	}
+
+	entry = hash_search(pa_keys, &key, HASH_ENTER, &found);
+	if (found && entry->seq != pa_last_seq)
+		pa_add_dependency(entry->seq, entry->xid);
+	entry->seq = pa_last_seq;
+	entry->xid = pa_last_xid;
+}
+
+/*
+ * Forget the rows last changed by transactions that have committed.
+ */
+static void
+pa_prune_keys(void)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyKeyEntry *entry;
+	uint64		committed = pa_get_committed_seq();
+
+	hash_seq_init(&status, pa_keys);
+	while ((entry = (ParallelApplyKeyEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->seq <= committed)
+			hash_search(pa_keys, &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Try to hand a protocol message to a parallel apply worker.  Returns true
+ * if the message has been taken care of; otherwise the caller must apply it
+ * itself, after everything dispatched so far has been committed.
+ */
+bool
+pa_dispatch(StringInfo s)
+{
+	StringInfoData msg;
+	const char *data = s->data + s->cursor;
+	Size		len = s->len - s->cursor;
+	char		action;
+	int			i;
+
+	if (pa_nworkers == 0)
+		return false;
+
+	msg = *s;
+	action = pq_getmsgbyte(&msg);
+
+	switch (action)
+	{
+		case 'B':
+			{
+				StringInfoData bmsg;
+				LogicalRepBeginData begin_data;
+				TransactionId prev_xid = pa_last_xid;
+
+				/*
+				 * Tables being synchronized need the apply worker to follow
+				 * every commit, so apply serially until they are ready.
+				 */
+				if (!AllTablesyncsReady())
+				{
+					pa_wait_for_all();
+					return false;
+				}
+				MemoryContextSwitchTo(ApplyMessageContext);
+
+				logicalrep_read_begin(&msg, &begin_data);
+
+				if (pa_keys == NULL)
+				{
+					HASHCTL		ctl;
+
+					memset(&ctl, 0, sizeof(ctl));
+					ctl.keysize = sizeof(ParallelApplyKey);
+					ctl.entrysize = sizeof(ParallelApplyKeyEntry);
+					ctl.hcxt = ApplyContext;
+					pa_keys = hash_create("logical replication parallel apply keys",
+										  1024, &ctl,
+										  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+				}
+				else if (hash_get_num_entries(pa_keys) > PA_MAX_TRACKED_KEYS)
+					pa_prune_keys();
+
+				pa_cur_worker = pa_choose_worker();
+				pa_cur_waited = 0;
+				pa_cur_prev_xid = prev_xid;
+				pa_last_seq++;
+				pa_last_xid = begin_data.xid;
+				pa_worker_seq[pa_cur_worker] = pa_last_seq;
+
+				initStringInfo(&bmsg);
+				pq_sendbyte(&bmsg, PA_MSG_BEGIN);
+				pq_sendint64(&bmsg, pa_last_seq);
+				pq_sendint32(&bmsg, begin_data.xid);
+				pq_sendint32(&bmsg, prev_xid);
+				pa_send(pa_cur_worker, bmsg.data, bmsg.len);
+				pfree(bmsg.data);
+
+				pa_send(pa_cur_worker, data, len);
+
+				pa_add_dependency(pa_barrier_seq, pa_barrier_xid);
+
+				in_remote_transaction = true;
+				return true;
+			}
+
+		case 'C':
+			if (pa_cur_worker < 0)
+				return false;
+			pa_send(pa_cur_worker, data, len);
+			pa_cur_worker = -1;
+			in_remote_transaction = false;
+			return true;
+
+		case 'I':
+		case 'U':
+		case 'D':
+			{
+				LogicalRepTupleData oldtup;
+				LogicalRepTupleData newtup;
+				LogicalRepRelId relid;
+				bool		has_oldtuple = false;
+				bool		tracked = true;
+
+				if (pa_cur_worker < 0)
+					return false;
+
+				if (action == 'I')
+					relid = logicalrep_read_insert(&msg, &newtup);
+				else if (action == 'U')
+					relid = logicalrep_read_update(&msg, &has_oldtuple,
+												   &oldtup, &newtup);
+				else
+				{
+					relid = logicalrep_read_delete(&msg, &oldtup);
+					has_oldtuple = true;
+				}
+
+				if (has_oldtuple)
+					pa_track_row(relid, &oldtup, &tracked);
+				if (action != 'D')
+					pa_track_row(relid, &newtup, &tracked);
+
+				if (!tracked)
+					pa_set_barrier();
+
+				pa_send(pa_cur_worker, data, len);
+				return true;
+			}
+
+		case 'T':
+			if (pa_cur_worker < 0)
+				return false;
+			pa_set_barrier();
+			pa_send(pa_cur_worker, data, len);
+			return true;
+
+		case 'O':
+			if (pa_cur_worker < 0)
+				return false;
+			pa_send(pa_cur_worker, data, len);
+			return true;
+
+		case 'R':
+		case 'Y':
+			/* All workers need these, and so do we. */
+			for (i = 0; i < pa_nworkers; i++)
+				pa_send(i, data, len);
+			return false;
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Wait for transaction "seq" to commit.  Called in a parallel apply worker.
+ */
+static void
+pa_wait_for_transaction(uint64 seq, TransactionId xid)
+{
+	for (;;)
+	{
+		bool		committed;
+		bool		started = false;
+		int			i;
+
+		SpinLockAcquire(&pa_shared->mutex);
+		committed = pa_shared->committed_seq >= seq;
+		for (i = 0; i < pa_shared->nworkers && !committed; i++)
+		{
+			if (pa_shared->slots[i].seq == seq)
+				started = true;
+		}
+		SpinLockRelease(&pa_shared->mutex);
+
+		if (committed)
+			break;
+
+		if (started)
+		{
+			/*
+			 * The worker applying it holds the lock until it has committed.
+			 * If it exits without committing, the apply worker will notice
+			 * and error out, but don't proceed in the meantime.
+			 */
+			LockApplyTransactionForSession(pa_shared->subid, xid, ShareLock);
+			UnlockApplyTransactionForSession(pa_shared->subid, xid, ShareLock);
+
+			if (seq > pa_get_committed_seq())
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("logical replication parallel apply worker applying remote transaction %u exited without committing it",
+								xid)));
+			break;
+		}
+
+		ConditionVariableSleep(&pa_shared->cv,
+							   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Commit the remote transaction being applied by this parallel apply
+ * worker, after all transactions the publisher committed before it.
+ */
+void
+pa_commit_transaction(LogicalRepCommitData *commit_data)
+{
+	XLogRecPtr	local_end = InvalidXLogRecPtr;
+
+	Assert(InParallelApplyWorker);
+
+	pa_wait_for_transaction(pa_my_seq - 1, pa_prev_xid);
+
+	if (IsTransactionState())
+	{
+		/*
+		 * Update origin state so we can restart streaming from correct
+		 * position in case of crash.
+		 */
+		replorigin_session_origin_lsn = commit_data->end_lsn;
+		replorigin_session_origin_timestamp = commit_data->committime;
+
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+
+		local_end = XactLastCommitEnd;
+	}
+
+	SpinLockAcquire(&pa_shared->mutex);
+	pa_shared->committed_seq = pa_my_seq;
+	if (!XLogRecPtrIsInvalid(local_end))
+	{
+		pa_shared->last_remote_end = commit_data->end_lsn;
+		pa_shared->last_local_end = local_end;
+	}
+	pa_shared->slots[pa_my_slot].seq = 0;
+	pa_shared->slots[pa_my_slot].xid = InvalidTransactionId;
+	SpinLockRelease(&pa_shared->mutex);
+
+	UnlockApplyTransactionForSession(pa_shared->subid, pa_my_xid,
+									 AccessExclusiveLock);
+
+	ConditionVariableBroadcast(&pa_shared->cv);
+	SetLatch(&pa_shared->leader_proc->procLatch);
+
+	pa_my_seq = 0;
+	pa_my_xid = InvalidTransactionId;
+	in_remote_transaction = false;
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/* SIGHUP: set flag to reload configuration at next convenient time */
+static void
+pa_worker_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+
+	/* Waken anything waiting on the process latch */
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Main entry point for a parallel apply worker.
+ */
+void
+ParallelApplyWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	char	   *queues;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	MemoryContext oldctx;
+
+	memcpy(&pa_my_slot, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, pa_worker_sighup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	pa_shared = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_SHARED, false);
+	queues = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queues + (Size) pa_my_slot * PARALLEL_APPLY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * Set up a LogicalRepWorker of our own, so that the apply code treats us
+	 * like the apply worker.  It's not in the shared array, so we don't show
+	 * up in pg_stat_subscription.
+	 */
+	MyLogicalRepWorker = MemoryContextAllocZero(TopMemoryContext,
+												sizeof(LogicalRepWorker));
+	MyLogicalRepWorker->launch_time = GetCurrentTimestamp();
+	MyLogicalRepWorker->proc = MyProc;
+	MyLogicalRepWorker->dbid = pa_shared->dbid;
+	MyLogicalRepWorker->userid = pa_shared->userid;
+	MyLogicalRepWorker->subid = pa_shared->subid;
+	MyLogicalRepWorker->relid = InvalidOid;
+
+	/* Run as replica session replication role. */
+	SetConfigOption("session_replication_role", "replica",
+					PGC_SUSET, PGC_S_OVERRIDE);
+
+	/* Connect to our database. */
+	BackgroundWorkerInitializeConnectionByOid(pa_shared->dbid,
+											  pa_shared->userid,
+											  0);
+
+	/*
+	 * Set always-secure search path, so malicious users can't redirect user
+	 * code (e.g. pg_index.indexprs).
+	 */
+	SetConfigOption("search_path", "", PGC_SUSET, PGC_S_OVERRIDE);
+
+	ApplyContext = AllocSetContextCreate(TopMemoryContext,
+										 "ApplyContext",
+										 ALLOCSET_DEFAULT_SIZES);
+	ApplyMessageContext = AllocSetContextCreate(ApplyContext,
+												"ApplyMessageContext",
+												ALLOCSET_DEFAULT_SIZES);
+
+	/* Load the subscription into persistent memory context. */
+	StartTransactionCommand();
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	MySubscription = GetSubscription(pa_shared->subid, true);
+	MemoryContextSwitchTo(oldctx);
+	if (!MySubscription)
+		proc_exit(0);
+
+	/* Setup synchronous commit according to the user's wishes */
+	SetConfigOption("synchronous_commit", MySubscription->synccommit,
+					PGC_BACKEND, PGC_S_OVERRIDE);
+	CommitTransactionCommand();
+
+	/* Share the apply worker's replication origin. */
+	replorigin_session_setup(pa_shared->originid, pa_shared->leader_pid);
+	replorigin_session_origin = pa_shared->originid;
+
+	InParallelApplyWorker = true;
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	for (;;)
+	{
+		StringInfoData s;
+		Size		len;
+		void	   *data;
+		int			c;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* The apply worker detaches from the queue when it exits. */
+		if (shm_mq_receive(mqh, &len, &data, false) != SHM_MQ_SUCCESS)
+			break;
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+
+		s.data = data;
+		s.len = len;
+		s.cursor = 0;
+		s.maxlen = -1;
+
+		c = s.data[0];
+		if (c == PA_MSG_BEGIN)
+		{
+			(void) pq_getmsgbyte(&s);
+			pa_my_seq = pq_getmsgint64(&s);
+			pa_my_xid = pq_getmsgint(&s, 4);
+			pa_prev_xid = pq_getmsgint(&s, 4);
+
+			/* Let others wait for us; see pa_wait_for_transaction. */
+			LockApplyTransactionForSession(pa_shared->subid, pa_my_xid,
+										   AccessExclusiveLock);
+
+			SpinLockAcquire(&pa_shared->mutex);
+			pa_shared->slots[pa_my_slot].seq = pa_my_seq;
+			pa_shared->slots[pa_my_slot].xid = pa_my_xid;
+			SpinLockRelease(&pa_shared->mutex);
+
+			ConditionVariableBroadcast(&pa_shared->cv);
+		}
+		else if (c == PA_MSG_WAIT)
+		{
+			uint64		seq;
+			TransactionId xid;
+
+			(void) pq_getmsgbyte(&s);
+			seq = pq_getmsgint64(&s);
+			xid = pq_getmsgint(&s, 4);
+
+			pa_wait_for_transaction(seq, xid);
+		}
+		else
+			apply_dispatch(&s);
+
+		MemoryContextReset(ApplyMessageContext);
+	}
+
+	proc_exit(0);
+}
@@ -191,6 +191,24 @@ logicalrep_relmap_update(LogicalRepRelation *remoterel)
 	MemoryContextSwitchTo(oldctx);
 }
 
+/*
+ * Get the publisher's description of a relation, as last sent in a
+ * RELATION message.  Returns NULL if we haven't received one.
+ */
+LogicalRepRelation *
+logicalrep_rel_get_remote(LogicalRepRelId remoteid)
+{
+	LogicalRepRelMapEntry *entry;
+
+	if (LogicalRepRelMap == NULL)
+		return NULL;
+
+	entry = hash_search(LogicalRepRelMap, (void *) &remoteid,
+						HASH_FIND, NULL);
+
+	return entry ? &entry->remoterel : NULL;
+}
+
 /*
  * Find attribute index in TupleDesc struct by attribute name.
  *
@@ -235,16 +235,11 @@ struct SnapBuild
 		/*
 		 * Array of committed transactions that have modified the catalog.
 		 *
-		 * As this array is frequently modified we do *not* keep it in
-		 * xidComparator order. Instead we sort the array when building &
-		 * distributing a snapshot.
-		 *
-		 * TODO: It's unclear whether that reasoning has much merit. Every
-		 * time we add something here after becoming consistent will also
-		 * require distributing a snapshot. Storing them sorted would
-		 * potentially also make it easier to purge (but more complicated wrt
-		 * wraparound?). Should be improved if sorting while building the
-		 * snapshot shows up in profiles.
+		 * The array is kept in xidComparator order, so that building a
+		 * snapshot is a plain copy, rather than a sort of the whole array
+		 * for every catalog-modifying commit.  Transactions mostly commit in
+		 * roughly xid order, so keeping it sorted usually just means
+		 * appending, and purging preserves the order.
 		 */
 		TransactionId *xip;
 	}			committed;
@@ -508,13 +503,11 @@ SnapBuildBuildSnapshot(SnapBuild *builder)
 	snapshot->xip =
 		(TransactionId *) ((char *) snapshot + sizeof(SnapshotData));
 	snapshot->xcnt = builder->committed.xcnt;
+	/* already sorted, so we can bsearch() */
 	memcpy(snapshot->xip,
 		   builder->committed.xip,
 		   builder->committed.xcnt * sizeof(TransactionId));
 
-	/* sort so we can bsearch() */
-	qsort(snapshot->xip, snapshot->xcnt, sizeof(TransactionId), xidComparator);
-
 	/*
 	 * Initially, subxip is empty, i.e. it's a snapshot to be used by
 	 * transactions that don't modify the catalog. Will be filled by
@@ -857,6 +850,8 @@ SnapBuildDistributeNewCatalogSnapshot(SnapBuild *builder, XLogRecPtr lsn)
 static void
 SnapBuildAddCommittedTxn(SnapBuild *builder, TransactionId xid)
 {
+	size_t		pos;
+
 	Assert(TransactionIdIsValid(xid));
 
 	if (builder->committed.xcnt == builder->committed.xcnt_space)
@@ -871,11 +866,19 @@ SnapBuildAddCommittedTxn(SnapBuild *builder, TransactionId xid)
 	}
 
 	/*
-	 * TODO: It might make sense to keep the array sorted here instead of
-	 * doing it every time we build a new snapshot. On the other hand this
-	 * gets called repeatedly when a transaction with subtransactions commits.
+	 * Insert the xid in xidComparator order.  Usually it's the newest one,
+	 * so search for its place from the end.
 	 */
-	builder->committed.xip[builder->committed.xcnt++] = xid;
+	pos = builder->committed.xcnt;
+	while (pos > 0 && builder->committed.xip[pos - 1] > xid)
+		pos--;
+
+	if (pos < builder->committed.xcnt)
+		memmove(&builder->committed.xip[pos + 1],
+				&builder->committed.xip[pos],
+				(builder->committed.xcnt - pos) * sizeof(TransactionId));
+	builder->committed.xip[pos] = xid;
+	builder->committed.xcnt++;
 }
 
 /*
@@ -887,38 +890,30 @@ static void
 SnapBuildPurgeCommittedTxn(SnapBuild *builder)
 {
 	int			off;
-	TransactionId *workspace;
 	int			surviving_xids = 0;
 
 	/* not ready yet */
 	if (!TransactionIdIsNormal(builder->xmin))
 		return;
 
-	/* TODO: Neater algorithm than just copying and iterating? */
-	workspace =
-		MemoryContextAlloc(builder->context,
-						   builder->committed.xcnt * sizeof(TransactionId));
-
-	/* copy xids that still are interesting to workspace */
+	/*
+	 * Compact the xids that still are interesting in place; that keeps them
+	 * in order.
+	 */
 	for (off = 0; off < builder->committed.xcnt; off++)
 	{
 		if (NormalTransactionIdPrecedes(builder->committed.xip[off],
 										builder->xmin))
 			;					/* remove */
 		else
-			workspace[surviving_xids++] = builder->committed.xip[off];
+			builder->committed.xip[surviving_xids++] =
+				builder->committed.xip[off];
 	}
 
-	/* copy workspace back to persistent state */
-	memcpy(builder->committed.xip, workspace,
-		   surviving_xids * sizeof(TransactionId));
-
 	elog(DEBUG3, "purged committed transactions from %u to %u, xmin: %u, xmax: %u",
 		 (uint32) builder->committed.xcnt, (uint32) surviving_xids,
 		 builder->xmin, builder->xmax);
 	builder->committed.xcnt = surviving_xids;
-
-	pfree(workspace);
 }
 
 /*
@@ -1898,6 +1893,10 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 		pfree(builder->committed.xip);
 		builder->committed.xcnt_space = ondisk.builder.committed.xcnt;
 		builder->committed.xip = ondisk.builder.committed.xip;
+
+		/* files written by older releases may not be sorted */
+		qsort(builder->committed.xip, builder->committed.xcnt,
+			  sizeof(TransactionId), xidComparator);
 	}
 	ondisk.builder.committed.xip = NULL;
 
@@ -47,6 +47,16 @@
  *	  So the state progression is always: INIT -> DATASYNC -> SYNCWAIT -> CATCHUP ->
  *	  SYNCDONE -> READY.
  *
+ *	  A large table can instead be copied in block-range chunks (CHUNKSYNC
+ *	  instead of DATASYNC).  The sync worker then creates its slot with an
+ *	  exported snapshot, and it and a few helper background workers each
+ *	  import that snapshot on a connection of their own and copy chunks of the
+ *	  table, committing each chunk separately.  The stream position is
+ *	  synchronized as usual once all chunks are done.  As the copied data is
+ *	  then no longer rolled back together when the sync fails, chunking is
+ *	  only used for local tables that are empty to begin with, and a sync that
+ *	  restarts in CHUNKSYNC state truncates the table first.
+ *
  *	  The catalog pg_subscription_rel is used to keep information about
  *	  subscribed tables and their state.  Some transient state during data
  *	  synchronization is kept in shared memory.  The states SYNCWAIT and
@@ -91,29 +101,88 @@
 #include "access/table.h"
 #include "access/xact.h"
 
+#include "catalog/catalog.h"
+#include "catalog/heap.h"
 #include "catalog/pg_subscription_rel.h"
 #include "catalog/pg_type.h"
 
 #include "commands/copy.h"
+#include "commands/tablecmds.h"
 
 #include "parser/parse_relation.h"
 
+#include "postmaster/bgworker.h"
+
 #include "replication/logicallauncher.h"
 #include "replication/logicalrelation.h"
+#include "replication/logicalworker.h"
 #include "replication/walreceiver.h"
 #include "replication/worker_internal.h"
 
 #include "utils/snapmgr.h"
+#include "storage/bufmgr.h"
+#include "storage/dsm.h"
 #include "storage/ipc.h"
+#include "storage/proc.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+
+#include "tcop/tcopprot.h"
 
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
+
+/* Magic number and key for the chunked copy's DSM table of contents. */
+#define TABLESYNC_CHUNK_MAGIC		0x54534368
+#define TABLESYNC_CHUNK_KEY_SHARED	1
+
+/* GUCs */
+int			max_parallel_sync_workers_per_table = 0;
+int			table_sync_chunk_size = (1024 * 1024 * 1024) / BLCKSZ;
+
+/*
+ * State of a table being copied in chunks, shared by the sync worker and
+ * its helper workers.
+ */
+typedef struct TableSyncChunkShared
+{
+	Oid			dbid;
+	Oid			userid;
+	Oid			subid;
+	Oid			relid;
+	PGPROC	   *leader_proc;
+	char		appname[NAMEDATALEN];	/* application_name to connect with */
+	char		snapshot[NAMEDATALEN];	/* snapshot exported by the publisher */
+	BlockNumber chunk_size;
+	int			nchunks;
+
+	/* Protects the fields below. */
+	slock_t		mutex;
+	int			next_chunk;		/* next chunk to hand out */
+	int			nchunks_done;	/* chunks copied and committed */
+	int			nworkers;
+	int			worker_chunk[FLEXIBLE_ARRAY_MEMBER];	/* chunk being copied
+														 * by each helper, or
+														 * -1 */
+} TableSyncChunkShared;
 
 static bool table_states_valid = false;
+static List *table_states_not_ready = NIL;
+
+/* Sync worker state while copying a table in chunks */
+static dsm_segment *chunk_seg = NULL;
+static BackgroundWorkerHandle **chunk_handles = NULL;
+static int	chunk_nworkers = 0;
 
 StringInfo	copybuf = NULL;
 
+static void copy_table_chunks_cleanup(int code, Datum arg);
+static void fetch_remote_table_filters(LogicalRepRelation *lrel, List **qual,
+									   Bitmapset **columns);
+
 /*
  * Exit routine for synchronization worker.
  */
@@ -302,6 +371,50 @@ process_syncing_tables_for_sync(XLogRecPtr current_lsn)
 		SpinLockRelease(&MyLogicalRepWorker->relmutex);
 }
 
+/*
+ * Refresh the cached list of subscription tables that are not yet in READY
+ * state, if it has been invalidated.  Starts a transaction to do so and sets
+ * *started_tx; the caller is responsible for committing it.
+ */
+static void
+FetchTableStates(bool *started_tx)
+{
+	*started_tx = false;
+
+	if (!table_states_valid)
+	{
+		MemoryContext oldctx;
+		List	   *rstates;
+		ListCell   *lc;
+		SubscriptionRelState *rstate;
+
+		/* Clean the old list. */
+		list_free_deep(table_states_not_ready);
+		table_states_not_ready = NIL;
+
+		if (!IsTransactionState())
+		{
+			StartTransactionCommand();
+			*started_tx = true;
+		}
+
+		/* Fetch all non-ready tables. */
+		rstates = GetSubscriptionNotReadyRelations(MySubscription->oid);
+
+		/* Allocate the tracking info in a permanent memory context. */
+		oldctx = MemoryContextSwitchTo(CacheMemoryContext);
+		foreach(lc, rstates)
+		{
+			rstate = palloc(sizeof(SubscriptionRelState));
+			memcpy(rstate, lfirst(lc), sizeof(SubscriptionRelState));
+			table_states_not_ready = lappend(table_states_not_ready, rstate);
+		}
+		MemoryContextSwitchTo(oldctx);
+
+		table_states_valid = true;
+	}
+}
+
 /*
  * Handle table synchronization cooperation from the apply worker.
  *
@@ -331,7 +444,6 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 		Oid			relid;
 		TimestampTz last_start_time;
 	};
-	static List *table_states = NIL;
 	static HTAB *last_start_times = NULL;
 	ListCell   *lc;
 	bool		started_tx = false;
@@ -339,42 +451,14 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 	Assert(!IsTransactionState());
 
 	/* We need up-to-date sync state info for subscription tables here. */
-	if (!table_states_valid)
-	{
-		MemoryContext oldctx;
-		List	   *rstates;
-		ListCell   *lc;
-		SubscriptionRelState *rstate;
-
-		/* Clean the old list. */
-		list_free_deep(table_states);
-		table_states = NIL;
-
-		StartTransactionCommand();
-		started_tx = true;
-
-		/* Fetch all non-ready tables. */
-		rstates = GetSubscriptionNotReadyRelations(MySubscription->oid);
-
-		/* Allocate the tracking info in a permanent memory context. */
-		oldctx = MemoryContextSwitchTo(CacheMemoryContext);
-		foreach(lc, rstates)
-		{
-			rstate = palloc(sizeof(SubscriptionRelState));
-			memcpy(rstate, lfirst(lc), sizeof(SubscriptionRelState));
-			table_states = lappend(table_states, rstate);
-		}
-		MemoryContextSwitchTo(oldctx);
-
-		table_states_valid = true;
-	}
+	FetchTableStates(&started_tx);
 
 	/*
 	 * Prepare a hash table for tracking last start times of workers, to avoid
 	 * immediate restarts.  We don't need it if there are no tables that need
 	 * syncing.
 	 */
-	if (table_states && !last_start_times)
+	if (table_states_not_ready && !last_start_times)
 	{
 		HASHCTL		ctl;
 
@@ -389,7 +473,7 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 	 * Clean up the hash table when we're done with all tables (just to
 	 * release the bit of memory).
 	 */
-	else if (!table_states && last_start_times)
+	else if (!table_states_not_ready && last_start_times)
 	{
 		hash_destroy(last_start_times);
 		last_start_times = NULL;
@@ -398,7 +482,7 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 	/*
 	 * Process all tables that are being synchronized.
 	 */
-	foreach(lc, table_states)
+	foreach(lc, table_states_not_ready)
 	{
 		SubscriptionRelState *rstate = (SubscriptionRelState *) lfirst(lc);
 
@@ -529,6 +613,28 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 	}
 }
 
+/*
+ * Are all tables of the subscription in READY state?
+ *
+ * Used by the apply worker to decide whether transactions can be handed to
+ * parallel apply workers, which never take part in table synchronization.
+ */
+bool
+AllTablesyncsReady(void)
+{
+	bool		started_tx;
+
+	FetchTableStates(&started_tx);
+
+	if (started_tx)
+	{
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+	}
+
+	return table_states_not_ready == NIL;
+}
+
 /*
  * Process possible state change(s) of tables that are being synchronized.
  */
@@ -638,18 +744,23 @@ copy_read_data(void *outbuf, int minread, int maxread)
 /*
  * Get information about remote relation in similar fashion the RELATION
  * message provides during replication.
+ *
+ * Also returns the row filters to apply when copying the table, and whether
+ * the columns were restricted by publication column lists.
  */
 static void
 fetch_remote_table_info(char *nspname, char *relname,
-						LogicalRepRelation *lrel)
+						LogicalRepRelation *lrel, List **qual,
+						bool *has_collist)
 {
 	WalRcvExecResult *res;
 	StringInfoData cmd;
 	TupleTableSlot *slot;
 	Oid			tableRow[2] = {OIDOID, CHAROID};
-	Oid			attrRow[4] = {TEXTOID, OIDOID, INT4OID, BOOLOID};
+	Oid			attrRow[5] = {TEXTOID, OIDOID, INT4OID, BOOLOID, INT2OID};
 	bool		isnull;
 	int			natt;
+	Bitmapset  *remotecols = NULL;
 
 	lrel->nspname = nspname;
 	lrel->relname = relname;
@@ -686,13 +797,18 @@ fetch_remote_table_info(char *nspname, char *relname,
 	ExecDropSingleTupleTableSlot(slot);
 	walrcv_clear_result(res);
 
+	/* Fetch the row filters and column lists, if the publisher has them. */
+	fetch_remote_table_filters(lrel, qual, &remotecols);
+	*has_collist = (remotecols != NULL);
+
 	/* Now fetch columns. */
 	resetStringInfo(&cmd);
 	appendStringInfo(&cmd,
 					 "SELECT a.attname,"
 					 "       a.atttypid,"
 					 "       a.atttypmod,"
-					 "       a.attnum = ANY(i.indkey)"
+					 "       a.attnum = ANY(i.indkey),"
+					 "       a.attnum"
 					 "  FROM pg_catalog.pg_attribute a"
 					 "  LEFT JOIN pg_catalog.pg_index i"
 					 "       ON (i.indexrelid = pg_get_replica_identity_index(%u))"
@@ -703,7 +819,7 @@ fetch_remote_table_info(char *nspname, char *relname,
 					 lrel->remoteid,
 					 (walrcv_server_version(wrconn) >= 120000 ? "AND a.attgenerated = ''" : ""),
 					 lrel->remoteid);
-	res = walrcv_exec(wrconn, cmd.data, 4, attrRow);
+	res = walrcv_exec(wrconn, cmd.data, 5, attrRow);
 
 	if (res->status != WALRCV_OK_TUPLES)
 		ereport(ERROR,
@@ -719,6 +835,15 @@ fetch_remote_table_info(char *nspname, char *relname,
 	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
 	while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
 	{
+		/* Skip columns left out by the publications' column lists */
+		if (remotecols != NULL &&
+			!bms_is_member(DatumGetInt16(slot_getattr(slot, 5, &isnull)),
+						   remotecols))
+		{
+			ExecClearTuple(slot);
+			continue;
+		}
+
 		lrel->attnames[natt] =
 			TextDatumGetCString(slot_getattr(slot, 1, &isnull));
 		Assert(!isnull);
@@ -742,13 +867,148 @@ fetch_remote_table_info(char *nspname, char *relname,
 	pfree(cmd.data);
 }
 
+/*
+ * Fetch the row filters and column lists that apply to the remote table,
+ * combined over the publications of the subscription in the same way as
+ * pgoutput does: the filters are ORed together, the column lists are
+ * unioned, and a publication without one means no filtering at all.
+ *
+ * *qual is set to a list of filter expressions in SQL form, or NIL; *columns
+ * to the set of remote attribute numbers to copy, or NULL for all.
+ */
+static void
+fetch_remote_table_filters(LogicalRepRelation *lrel, List **qual,
+						   Bitmapset **columns)
+{
+	WalRcvExecResult *res;
+	StringInfoData cmd;
+	TupleTableSlot *slot;
+	Oid			probeRow[1] = {BOOLOID};
+	Oid			filterRow[3] = {BOOLOID, TEXTOID, TEXTOID};
+	bool		isnull;
+	bool		has_filters;
+	bool		no_filter = false;
+	bool		all_columns = false;
+	ListCell   *lc;
+
+	*qual = NIL;
+	*columns = NULL;
+
+	if (walrcv_server_version(wrconn) < 120000)
+		return;
+
+	res = walrcv_exec(wrconn,
+					  "SELECT EXISTS (SELECT 1 FROM pg_catalog.pg_attribute"
+					  " WHERE attrelid = 'pg_catalog.pg_publication_rel'::pg_catalog.regclass"
+					  "   AND attname = 'prqual')",
+					  1, probeRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch publication info from publisher: %s",
+						res->err)));
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	has_filters = tuplestore_gettupleslot(res->tuplestore, true, false, slot) &&
+		DatumGetBool(slot_getattr(slot, 1, &isnull));
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	if (!has_filters)
+		return;
+
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT p.puballtables,"
+					 "       pg_catalog.pg_get_expr(pr.prqual, pr.prrelid),"
+					 "       pr.prattrs::pg_catalog.text"
+					 "  FROM pg_catalog.pg_publication p"
+					 "  LEFT JOIN pg_catalog.pg_publication_rel pr"
+					 "       ON (pr.prpubid = p.oid AND pr.prrelid = %u)"
+					 " WHERE (p.puballtables OR pr.prrelid IS NOT NULL)"
+					 "   AND p.pubname IN (",
+					 lrel->remoteid);
+	foreach(lc, MySubscription->publications)
+	{
+		if (lc != list_head(MySubscription->publications))
+			appendStringInfoString(&cmd, ", ");
+		appendStringInfoString(&cmd, quote_literal_cstr(strVal(lfirst(lc))));
+	}
+	appendStringInfoChar(&cmd, ')');
+
+	res = walrcv_exec(wrconn, cmd.data, 3, filterRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch row filters for table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+	{
+		Datum		rf;
+		Datum		cols;
+		bool		rfnull;
+		bool		colsnull;
+
+		if (DatumGetBool(slot_getattr(slot, 1, &isnull)))
+		{
+			no_filter = all_columns = true;
+			break;
+		}
+
+		rf = slot_getattr(slot, 2, &rfnull);
+		if (rfnull)
+			no_filter = true;
+		else if (!no_filter)
+			*qual = lappend(*qual, TextDatumGetCString(rf));
+
+		cols = slot_getattr(slot, 3, &colsnull);
+		if (colsnull)
+			all_columns = true;
+		else if (!all_columns)
+		{
+			/* int2vector output is a space-separated list of numbers */
+			char	   *p = TextDatumGetCString(cols);
+
+			while (*p != '\0')
+			{
+				char	   *endp;
+				long		attnum = strtol(p, &endp, 10);
+
+				if (endp == p)
+					break;
+				*columns = bms_add_member(*columns, (int) attnum);
+				p = endp;
+			}
+		}
+
+		ExecClearTuple(slot);
+	}
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+	pfree(cmd.data);
+
+	if (no_filter)
+	{
+		list_free_deep(*qual);
+		*qual = NIL;
+	}
+	if (all_columns)
+	{
+		bms_free(*columns);
+		*columns = NULL;
+	}
+}
+
 /*
  * Copy existing data of a table from publisher.
  *
+ * If startblk is valid, only the rows stored in blocks startblk up to, but
+ * not including, endblk of the remote table are copied; an invalid endblk
+ * means up to the end of the table.
+ *
  * Caller is responsible for locking the local relation.
  */
 static void
-copy_table(Relation rel)
+copy_table(Relation rel, BlockNumber startblk, BlockNumber endblk)
 {
 	LogicalRepRelMapEntry *relmapentry;
 	LogicalRepRelation lrel;
@@ -757,10 +1017,13 @@ copy_table(Relation rel)
 	CopyState	cstate;
 	List	   *attnamelist;
 	ParseState *pstate;
+	List	   *qual;
+	bool		has_collist;
 
 	/* Get the publisher relation info. */
 	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
-							RelationGetRelationName(rel), &lrel);
+							RelationGetRelationName(rel), &lrel, &qual,
+							&has_collist);
 
 	/* Put the relation into relmap. */
 	logicalrep_relmap_update(&lrel);
@@ -771,8 +1034,46 @@ copy_table(Relation rel)
 
 	/* Start copy on the publisher. */
 	initStringInfo(&cmd);
-	appendStringInfo(&cmd, "COPY %s TO STDOUT",
-					 quote_qualified_identifier(lrel.nspname, lrel.relname));
+	if (!BlockNumberIsValid(startblk) && qual == NIL && !has_collist)
+		appendStringInfo(&cmd, "COPY %s TO STDOUT",
+						 quote_qualified_identifier(lrel.nspname, lrel.relname));
+	else
+	{
+		int			i;
+		ListCell   *lc;
+		bool		first = true;
+
+		appendStringInfoString(&cmd, "COPY (SELECT ");
+		for (i = 0; i < lrel.natts; i++)
+		{
+			if (i > 0)
+				appendStringInfoString(&cmd, ", ");
+			appendStringInfoString(&cmd, quote_identifier(lrel.attnames[i]));
+		}
+		appendStringInfo(&cmd, " FROM ONLY %s",
+						 quote_qualified_identifier(lrel.nspname, lrel.relname));
+
+		/* Rows must match the row filter of any of the publications */
+		foreach(lc, qual)
+		{
+			appendStringInfoString(&cmd, first ? " WHERE ((" : " OR (");
+			appendStringInfoString(&cmd, (char *) lfirst(lc));
+			appendStringInfoChar(&cmd, ')');
+			first = false;
+		}
+		if (!first)
+			appendStringInfoChar(&cmd, ')');
+
+		if (BlockNumberIsValid(startblk))
+		{
+			appendStringInfo(&cmd, "%s ctid >= '(%u,0)'::pg_catalog.tid",
+							 first ? " WHERE" : " AND", startblk);
+			if (BlockNumberIsValid(endblk))
+				appendStringInfo(&cmd, " AND ctid < '(%u,0)'::pg_catalog.tid",
+								 endblk);
+		}
+		appendStringInfoString(&cmd, ") TO STDOUT");
+	}
 	res = walrcv_exec(wrconn, cmd.data, 0, NULL);
 	pfree(cmd.data);
 	if (res->status != WALRCV_OK_COPY_OUT)
@@ -796,6 +1097,489 @@ copy_table(Relation rel)
 	logicalrep_rel_close(relmapentry, NoLock);
 }
 
+/*
+ * Decide whether to copy the table in chunks, and into how many.
+ *
+ * Returns 0 if the table is to be copied in one piece: when chunking is
+ * disabled, when the remote table is smaller than two chunks, or when
+ * truncating the local table to retry a failed chunked copy would lose data
+ * or fail, i.e. when it is not empty or is referenced by foreign keys.
+ *
+ * Must be called before the slot is created, as it runs queries on the
+ * replication connection.
+ */
+static int
+table_sync_chunk_count(void)
+{
+	Relation	rel;
+	char	   *nspname;
+	char	   *relname;
+	bool		usable;
+	WalRcvExecResult *res;
+	StringInfoData cmd;
+	TupleTableSlot *slot;
+	Oid			sizeRow[1] = {INT8OID};
+	bool		isnull;
+	int64		nblocks;
+
+	if (max_parallel_sync_workers_per_table <= 0)
+		return 0;
+
+	StartTransactionCommand();
+	rel = table_open(MyLogicalRepWorker->relid, AccessShareLock);
+	nspname = get_namespace_name(RelationGetNamespace(rel));
+	relname = pstrdup(RelationGetRelationName(rel));
+	usable = RelationGetNumberOfBlocks(rel) == 0 &&
+		heap_truncate_find_FKs(list_make1_oid(RelationGetRelid(rel))) == NIL;
+	table_close(rel, AccessShareLock);
+
+	if (!usable)
+	{
+		CommitTransactionCommand();
+		return 0;
+	}
+
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT pg_catalog.pg_relation_size(%s::pg_catalog.regclass)"
+					 " / pg_catalog.current_setting('block_size')::pg_catalog.int8",
+					 quote_literal_cstr(quote_qualified_identifier(nspname, relname)));
+	res = walrcv_exec(wrconn, cmd.data, 1, sizeRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch size of table \"%s.%s\" from publisher: %s",
+						nspname, relname, res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		ereport(ERROR,
+				(errmsg("table \"%s.%s\" not found on publisher",
+						nspname, relname)));
+	nblocks = DatumGetInt64(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+	pfree(cmd.data);
+
+	CommitTransactionCommand();
+
+	if (nblocks < 2 * (int64) table_sync_chunk_size)
+		return 0;
+
+	return (int) Min((nblocks + table_sync_chunk_size - 1) / table_sync_chunk_size,
+					 (int64) INT_MAX);
+}
+
+/*
+ * Remove the rows committed by an earlier, failed attempt to copy the table
+ * in chunks.  The table was empty when that attempt started.
+ */
+static void
+truncate_table_for_resync(void)
+{
+	Relation	rel;
+	List	   *relids_logged = NIL;
+
+	StartTransactionCommand();
+	rel = table_open(MyLogicalRepWorker->relid, AccessExclusiveLock);
+
+	ereport(LOG,
+			(errmsg("logical replication table synchronization worker for subscription \"%s\" is truncating table \"%s\" to retry copying it",
+					MySubscription->name, RelationGetRelationName(rel))));
+
+	if (RelationIsLogicallyLogged(rel))
+		relids_logged = list_make1_oid(RelationGetRelid(rel));
+	ExecuteTruncateGuts(list_make1(rel), list_make1_oid(RelationGetRelid(rel)),
+						relids_logged, DROP_RESTRICT, false);
+
+	table_close(rel, NoLock);
+	CommitTransactionCommand();
+}
+
+/*
+ * Copy chunks of the table until none are left, each in a transaction of its
+ * own.  Used by both the sync worker (worker = -1) and its helpers.
+ *
+ * The publisher connection is only opened once a chunk has been claimed.
+ * The sync worker doesn't let the exported snapshot go away before all
+ * chunks are done, so importing it can't fail because we were too late.
+ */
+static void
+copy_table_chunks(TableSyncChunkShared *shared, int worker)
+{
+	WalReceiverConn *slotconn = wrconn;
+	WalReceiverConn *conn = NULL;
+
+	for (;;)
+	{
+		int			chunk;
+		BlockNumber startblk;
+		BlockNumber endblk;
+		Relation	rel;
+
+		CHECK_FOR_INTERRUPTS();
+
+		SpinLockAcquire(&shared->mutex);
+		if (shared->next_chunk < shared->nchunks)
+			chunk = shared->next_chunk++;
+		else
+			chunk = -1;
+		if (worker >= 0)
+			shared->worker_chunk[worker] = chunk;
+		SpinLockRelease(&shared->mutex);
+
+		if (chunk < 0)
+			break;
+
+		if (conn == NULL)
+		{
+			WalRcvExecResult *res;
+			char	   *err;
+			char	   *cmd;
+
+			conn = walrcv_connect(MySubscription->conninfo, true,
+								  shared->appname, &err);
+			if (conn == NULL)
+				ereport(ERROR,
+						(errmsg("could not connect to the publisher: %s", err)));
+
+			res = walrcv_exec(conn,
+							  "BEGIN READ ONLY ISOLATION LEVEL "
+							  "REPEATABLE READ", 0, NULL);
+			if (res->status != WALRCV_OK_COMMAND)
+				ereport(ERROR,
+						(errmsg("table copy could not start transaction on publisher"),
+						 errdetail("The error was: %s", res->err)));
+			walrcv_clear_result(res);
+
+			cmd = psprintf("SET TRANSACTION SNAPSHOT %s",
+						   quote_literal_cstr(shared->snapshot));
+			res = walrcv_exec(conn, cmd, 0, NULL);
+			if (res->status != WALRCV_OK_COMMAND)
+				ereport(ERROR,
+						(errmsg("table copy could not import snapshot on publisher"),
+						 errdetail("The error was: %s", res->err)));
+			walrcv_clear_result(res);
+			pfree(cmd);
+		}
+
+		startblk = (BlockNumber) chunk * shared->chunk_size;
+		if (chunk < shared->nchunks - 1)
+			endblk = startblk + shared->chunk_size;
+		else
+			endblk = InvalidBlockNumber;
+
+		/* copy_read_data() reads from wrconn. */
+		wrconn = conn;
+
+		StartTransactionCommand();
+		rel = table_open(shared->relid, RowExclusiveLock);
+		PushActiveSnapshot(GetTransactionSnapshot());
+		copy_table(rel, startblk, endblk);
+		PopActiveSnapshot();
+		table_close(rel, NoLock);
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+
+		wrconn = slotconn;
+
+		SpinLockAcquire(&shared->mutex);
+		shared->nchunks_done++;
+		if (worker >= 0)
+			shared->worker_chunk[worker] = -1;
+		SpinLockRelease(&shared->mutex);
+
+		SetLatch(&shared->leader_proc->procLatch);
+	}
+
+	if (conn != NULL)
+		walrcv_disconnect(conn);
+}
+
+/*
+ * Copy the table in "nchunks" chunks, with the help of up to
+ * max_parallel_sync_workers_per_table helper workers.  Each chunk is
+ * committed locally on its own.
+ *
+ * Creates the temporary slot for the sync worker on wrconn, and returns the
+ * slot's starting position in *origin_startpos.
+ */
+static void
+copy_table_in_chunks(char *slotname, int nchunks,
+					 XLogRecPtr *origin_startpos)
+{
+	shm_toc_estimator e;
+	shm_toc    *toc;
+	TableSyncChunkShared *shared;
+	Size		shared_size;
+	Size		segsize;
+	char	   *snapshot;
+	int			nworkers;
+	int			i;
+
+	/*
+	 * Have the publisher export the snapshot of the slot, instead of using
+	 * it in a transaction on this connection.  It stays available for
+	 * importing until we run the next command on the connection.
+	 */
+	snapshot = walrcv_create_slot(wrconn, slotname, true,
+								  CRS_EXPORT_SNAPSHOT, origin_startpos);
+	if (snapshot == NULL || strlen(snapshot) >= NAMEDATALEN)
+		ereport(ERROR,
+				(errmsg("could not obtain exported snapshot for slot \"%s\" from publisher",
+						slotname)));
+
+	/* There's no point in more helpers than chunks beyond our own. */
+	nworkers = Min(max_parallel_sync_workers_per_table, nchunks - 1);
+
+	shared_size = add_size(offsetof(TableSyncChunkShared, worker_chunk),
+						   mul_size(sizeof(int), nworkers));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, shared_size);
+	shm_toc_estimate_keys(&e, 1);
+	segsize = shm_toc_estimate(&e);
+
+	chunk_seg = dsm_create(segsize, 0);
+	dsm_pin_mapping(chunk_seg);
+	toc = shm_toc_create(TABLESYNC_CHUNK_MAGIC, dsm_segment_address(chunk_seg),
+						 segsize);
+
+	shared = shm_toc_allocate(toc, shared_size);
+	memset(shared, 0, shared_size);
+	shared->dbid = MyLogicalRepWorker->dbid;
+	shared->userid = MyLogicalRepWorker->userid;
+	shared->subid = MyLogicalRepWorker->subid;
+	shared->relid = MyLogicalRepWorker->relid;
+	shared->leader_proc = MyProc;
+	strlcpy(shared->appname, slotname, NAMEDATALEN);
+	strlcpy(shared->snapshot, snapshot, NAMEDATALEN);
+	shared->chunk_size = table_sync_chunk_size;
+	shared->nchunks = nchunks;
+	SpinLockInit(&shared->mutex);
+	shared->next_chunk = 0;
+	shared->nchunks_done = 0;
+	shared->nworkers = nworkers;
+	for (i = 0; i < nworkers; i++)
+		shared->worker_chunk[i] = -1;
+	shm_toc_insert(toc, TABLESYNC_CHUNK_KEY_SHARED, shared);
+
+	chunk_handles = MemoryContextAllocZero(TopMemoryContext,
+										   sizeof(BackgroundWorkerHandle *) * nworkers);
+	chunk_nworkers = 0;
+
+	before_shmem_exit(copy_table_chunks_cleanup, (Datum) 0);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		BackgroundWorker worker;
+		MemoryContext oldcontext;
+
+		memset(&worker, 0, sizeof(worker));
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+			BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+		sprintf(worker.bgw_library_name, "postgres");
+		sprintf(worker.bgw_function_name, "TableSyncChunkWorkerMain");
+		snprintf(worker.bgw_name, BGW_MAXLEN,
+				 "logical replication table synchronization helper for subscription %u sync %u",
+				 MyLogicalRepWorker->subid, MyLogicalRepWorker->relid);
+		snprintf(worker.bgw_type, BGW_MAXLEN,
+				 "logical replication table synchronization helper");
+		worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(chunk_seg));
+		memcpy(worker.bgw_extra, &i, sizeof(int));
+		worker.bgw_notify_pid = MyProcPid;
+
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		if (!RegisterDynamicBackgroundWorker(&worker, &chunk_handles[i]))
+		{
+			MemoryContextSwitchTo(oldcontext);
+			ereport(LOG,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("could only start %d of %d table synchronization helpers for subscription \"%s\"",
+							i, nworkers, MySubscription->name),
+					 errhint("You might need to increase max_worker_processes.")));
+			break;
+		}
+		MemoryContextSwitchTo(oldcontext);
+
+		chunk_nworkers = i + 1;
+	}
+
+	ereport(DEBUG1,
+			(errmsg("logical replication table synchronization worker for subscription \"%s\", table \"%s\" is copying %d chunks with %d helpers",
+					MySubscription->name,
+					get_rel_name(MyLogicalRepWorker->relid),
+					nchunks, chunk_nworkers)));
+
+	/* Copy chunks ourselves too, then wait for the helpers to finish. */
+	copy_table_chunks(shared, -1);
+
+	for (;;)
+	{
+		bool		done;
+
+		CHECK_FOR_INTERRUPTS();
+
+		SpinLockAcquire(&shared->mutex);
+		done = (shared->nchunks_done == shared->nchunks);
+		SpinLockRelease(&shared->mutex);
+
+		if (done)
+			break;
+
+		/*
+		 * A helper that exits while copying a chunk has failed, and nobody
+		 * else is going to copy that chunk.
+		 */
+		for (i = 0; i < chunk_nworkers; i++)
+		{
+			pid_t		pid;
+			int			chunk;
+
+			if (GetBackgroundWorkerPid(chunk_handles[i], &pid) != BGWH_STOPPED)
+				continue;
+
+			SpinLockAcquire(&shared->mutex);
+			chunk = shared->worker_chunk[i];
+			SpinLockRelease(&shared->mutex);
+
+			if (chunk >= 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("logical replication table synchronization helper exited while copying chunk %d of table \"%s\"",
+								chunk, get_rel_name(MyLogicalRepWorker->relid))));
+		}
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L, WAIT_EVENT_LOGICAL_SYNC_CHUNKS);
+
+		ResetLatch(MyLatch);
+	}
+
+	cancel_before_shmem_exit(copy_table_chunks_cleanup, (Datum) 0);
+	copy_table_chunks_cleanup(0, (Datum) 0);
+}
+
+/*
+ * Make the table synchronization helpers exit, and wait for them to do so,
+ * before the sync worker goes away or continues with the slot connection.
+ */
+static void
+copy_table_chunks_cleanup(int code, Datum arg)
+{
+	int			i;
+
+	for (i = 0; i < chunk_nworkers; i++)
+		TerminateBackgroundWorker(chunk_handles[i]);
+
+	for (i = 0; i < chunk_nworkers; i++)
+	{
+		pid_t		pid;
+
+		while (GetBackgroundWorkerPid(chunk_handles[i], &pid) == BGWH_STARTED)
+		{
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 10L, WAIT_EVENT_LOGICAL_SYNC_CHUNKS);
+			ResetLatch(MyLatch);
+		}
+	}
+	chunk_nworkers = 0;
+
+	if (chunk_seg != NULL)
+	{
+		dsm_detach(chunk_seg);
+		chunk_seg = NULL;
+	}
+}
+
+/*
+ * Main entry point for a table synchronization helper, which copies chunks
+ * of a table for a sync worker.
+ */
+void
+TableSyncChunkWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	TableSyncChunkShared *shared;
+	int			worker;
+	MemoryContext oldctx;
+
+	memcpy(&worker, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	/* Setup signal handling */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(TABLESYNC_CHUNK_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+	shared = shm_toc_lookup(toc, TABLESYNC_CHUNK_KEY_SHARED, false);
+
+	/*
+	 * Set up a LogicalRepWorker of our own, like the parallel apply workers
+	 * do.  It's not in the shared array, so we don't show up in
+	 * pg_stat_subscription.
+	 */
+	MyLogicalRepWorker = MemoryContextAllocZero(TopMemoryContext,
+												sizeof(LogicalRepWorker));
+	MyLogicalRepWorker->launch_time = GetCurrentTimestamp();
+	MyLogicalRepWorker->proc = MyProc;
+	MyLogicalRepWorker->dbid = shared->dbid;
+	MyLogicalRepWorker->userid = shared->userid;
+	MyLogicalRepWorker->subid = shared->subid;
+	MyLogicalRepWorker->relid = shared->relid;
+
+	/* Run as replica session replication role. */
+	SetConfigOption("session_replication_role", "replica",
+					PGC_SUSET, PGC_S_OVERRIDE);
+
+	/* Connect to our database. */
+	BackgroundWorkerInitializeConnectionByOid(shared->dbid, shared->userid, 0);
+
+	/*
+	 * Set always-secure search path, so malicious users can't redirect user
+	 * code (e.g. pg_index.indexprs).
+	 */
+	SetConfigOption("search_path", "", PGC_SUSET, PGC_S_OVERRIDE);
+
+	ApplyContext = AllocSetContextCreate(TopMemoryContext,
+										 "ApplyContext",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	/* Load the subscription into persistent memory context. */
+	StartTransactionCommand();
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	MySubscription = GetSubscription(shared->subid, true);
+	MemoryContextSwitchTo(oldctx);
+	if (!MySubscription)
+		proc_exit(0);
+
+	/* Setup synchronous commit according to the user's wishes */
+	SetConfigOption("synchronous_commit", MySubscription->synccommit,
+					PGC_BACKEND, PGC_S_OVERRIDE);
+	CommitTransactionCommand();
+
+	/* Load the libpq-specific functions */
+	load_file("libpqwalreceiver", false);
+
+	copy_table_chunks(shared, worker);
+
+	proc_exit(0);
+}
+
 /*
  * Start syncing the table in the sync worker.
  *
@@ -849,12 +1633,24 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 	{
 		case SUBREL_STATE_INIT:
 		case SUBREL_STATE_DATASYNC:
+		case SUBREL_STATE_CHUNKSYNC:
 			{
 				Relation	rel;
 				WalRcvExecResult *res;
+				int			nchunks;
+
+				/*
+				 * An earlier attempt to copy the table in chunks failed, but
+				 * the chunks it finished were committed.
+				 */
+				if (MyLogicalRepWorker->relstate == SUBREL_STATE_CHUNKSYNC)
+					truncate_table_for_resync();
+
+				nchunks = table_sync_chunk_count();
 
 				SpinLockAcquire(&MyLogicalRepWorker->relmutex);
-				MyLogicalRepWorker->relstate = SUBREL_STATE_DATASYNC;
+				MyLogicalRepWorker->relstate = nchunks > 0 ?
+					SUBREL_STATE_CHUNKSYNC : SUBREL_STATE_DATASYNC;
 				MyLogicalRepWorker->relstate_lsn = InvalidXLogRecPtr;
 				SpinLockRelease(&MyLogicalRepWorker->relmutex);
 
@@ -867,60 +1663,74 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 				CommitTransactionCommand();
 				pgstat_report_stat(false);
 
-				/*
-				 * We want to do the table data sync in a single transaction.
-				 */
-				StartTransactionCommand();
+				if (nchunks > 0)
+				{
+					/*
+					 * The chunks are committed as they are copied; continue
+					 * in a new transaction like the single-transaction case.
+					 */
+					copy_table_in_chunks(slotname, nchunks, origin_startpos);
+					StartTransactionCommand();
+				}
+				else
+				{
+					/*
+					 * We want to do the table data sync in a single
+					 * transaction.
+					 */
+					StartTransactionCommand();
 
-				/*
-				 * Use a standard write lock here. It might be better to
-				 * disallow access to the table while it's being synchronized.
-				 * But we don't want to block the main apply process from
-				 * working and it has to open the relation in RowExclusiveLock
-				 * when remapping remote relation id to local one.
-				 */
-				rel = table_open(MyLogicalRepWorker->relid, RowExclusiveLock);
+					/*
+					 * Use a standard write lock here. It might be better to
+					 * disallow access to the table while it's being
+					 * synchronized. But we don't want to block the main apply
+					 * process from working and it has to open the relation in
+					 * RowExclusiveLock when remapping remote relation id to
+					 * local one.
+					 */
+					rel = table_open(MyLogicalRepWorker->relid, RowExclusiveLock);
 
-				/*
-				 * Create a temporary slot for the sync process. We do this
-				 * inside the transaction so that we can use the snapshot made
-				 * by the slot to get existing data.
-				 */
-				res = walrcv_exec(wrconn,
-								  "BEGIN READ ONLY ISOLATION LEVEL "
-								  "REPEATABLE READ", 0, NULL);
-				if (res->status != WALRCV_OK_COMMAND)
-					ereport(ERROR,
-							(errmsg("table copy could not start transaction on publisher"),
-							 errdetail("The error was: %s", res->err)));
-				walrcv_clear_result(res);
+					/*
+					 * Create a temporary slot for the sync process. We do
+					 * this inside the transaction so that we can use the
+					 * snapshot made by the slot to get existing data.
+					 */
+					res = walrcv_exec(wrconn,
+									  "BEGIN READ ONLY ISOLATION LEVEL "
+									  "REPEATABLE READ", 0, NULL);
+					if (res->status != WALRCV_OK_COMMAND)
+						ereport(ERROR,
+								(errmsg("table copy could not start transaction on publisher"),
+								 errdetail("The error was: %s", res->err)));
+					walrcv_clear_result(res);
 
-				/*
-				 * Create new temporary logical decoding slot.
-				 *
-				 * We'll use slot for data copy so make sure the snapshot is
-				 * used for the transaction; that way the COPY will get data
-				 * that is consistent with the lsn used by the slot to start
-				 * decoding.
-				 */
-				walrcv_create_slot(wrconn, slotname, true,
-								   CRS_USE_SNAPSHOT, origin_startpos);
+					/*
+					 * Create new temporary logical decoding slot.
+					 *
+					 * We'll use slot for data copy so make sure the snapshot
+					 * is used for the transaction; that way the COPY will get
+					 * data that is consistent with the lsn used by the slot
+					 * to start decoding.
+					 */
+					walrcv_create_slot(wrconn, slotname, true,
+									   CRS_USE_SNAPSHOT, origin_startpos);
 
-				PushActiveSnapshot(GetTransactionSnapshot());
-				copy_table(rel);
-				PopActiveSnapshot();
+					PushActiveSnapshot(GetTransactionSnapshot());
+					copy_table(rel, InvalidBlockNumber, InvalidBlockNumber);
+					PopActiveSnapshot();
 
-				res = walrcv_exec(wrconn, "COMMIT", 0, NULL);
-				if (res->status != WALRCV_OK_COMMAND)
-					ereport(ERROR,
-							(errmsg("table copy could not finish transaction on publisher"),
-							 errdetail("The error was: %s", res->err)));
-				walrcv_clear_result(res);
+					res = walrcv_exec(wrconn, "COMMIT", 0, NULL);
+					if (res->status != WALRCV_OK_COMMAND)
+						ereport(ERROR,
+								(errmsg("table copy could not finish transaction on publisher"),
+								 errdetail("The error was: %s", res->err)));
+					walrcv_clear_result(res);
 
-				table_close(rel, NoLock);
+					table_close(rel, NoLock);
 
-				/* Make the copy visible. */
-				CommandCounterIncrement();
+					/* Make the copy visible. */
+					CommandCounterIncrement();
+				}
 
 				/*
 				 * We are done with the initial data synchronization, update
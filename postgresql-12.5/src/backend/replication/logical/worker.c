@@ -93,7 +93,7 @@ typedef struct SlotErrCallbackArg
 	int			remote_attnum;
 } SlotErrCallbackArg;
 
-static MemoryContext ApplyMessageContext = NULL;
+MemoryContext ApplyMessageContext = NULL;
 MemoryContext ApplyContext = NULL;
 
 WalReceiverConn *wrconn = NULL;
@@ -104,12 +104,32 @@ bool		MySubscriptionValid = false;
 bool		in_remote_transaction = false;
 static XLogRecPtr remote_final_lsn = InvalidXLogRecPtr;
 
-static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
+/*
+ * Consecutive INSERTs into the same table are collected here and written out
+ * with table_multi_insert() once the batch is full, or as soon as any other
+ * kind of change (including the commit) arrives.
+ */
+#define APPLY_INSERT_BATCH_MAX_TUPLES	1000
+#define APPLY_INSERT_BATCH_MAX_BYTES	65535
 
-static void store_flush_position(XLogRecPtr remote_lsn);
+typedef struct ApplyInsertBatch
+{
+	Relation	rel;			/* target table, or NULL if batch is empty */
+	EState	   *estate;
+	TupleTableSlot *slots[APPLY_INSERT_BATCH_MAX_TUPLES];
+	int			nslots;
+	Size		size;			/* approximate size of the queued changes */
+} ApplyInsertBatch;
+
+static ApplyInsertBatch insert_batch;
+static MemoryContext ApplyInsertBatchContext = NULL;
+
+static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
 
 static void maybe_reread_subscription(void);
 
+static void apply_flush_insert_batch(void);
+
 /* Flags set by signal handlers */
 static volatile sig_atomic_t got_SIGHUP = false;
 
@@ -295,14 +315,63 @@ slot_store_error_callback(void *arg)
 }
 
 /*
- * Store data in C string form into slot.
+ * Convert a remote column value to the type of local attribute "att", using
+ * the type's input function or, for values sent in binary format, its
+ * receive function.
+ */
+static Datum
+slot_input_value(Form_pg_attribute att, LogicalRepTupleData *tupleData,
+				 int remoteattnum)
+{
+	char	   *value = tupleData->values[remoteattnum];
+	int			len = tupleData->lengths[remoteattnum];
+	Oid			typioparam;
+
+	if (len >= 0)
+	{
+		StringInfoData buf;
+		Oid			typreceive;
+		Datum		result;
+
+		getTypeBinaryInputInfo(att->atttypid, &typreceive, &typioparam);
+
+		buf.data = value;
+		buf.len = len;
+		buf.maxlen = len + 1;
+		buf.cursor = 0;
+
+		result = OidReceiveFunctionCall(typreceive, &buf, typioparam,
+										att->atttypmod);
+
+		/* Trouble if it didn't eat the whole buffer */
+		if (buf.cursor != buf.len)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					 errmsg("incorrect binary data format in logical replication column %d",
+							remoteattnum + 1)));
+
+		return result;
+	}
+	else
+	{
+		Oid			typinput;
+
+		getTypeInputInfo(att->atttypid, &typinput, &typioparam);
+		return OidInputFunctionCall(typinput, value, typioparam,
+									att->atttypmod);
+	}
+}
+
+/*
+ * Store data received from the publisher into slot.
  * This is similar to BuildTupleFromCStrings but TupleTableSlot fits our
  * use better.
  */
 static void
-slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
-					char **values)
+slot_store_data(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
+				LogicalRepTupleData *tupleData)
 {
+	char	  **values = tupleData->values;
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
 	SlotErrCallbackArg errarg;
@@ -328,16 +397,11 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 		if (!att->attisdropped && remoteattnum >= 0 &&
 			values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.local_attnum = i;
 			errarg.remote_attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] =
-				OidInputFunctionCall(typinput, values[remoteattnum],
-									 typioparam, att->atttypmod);
+			slot->tts_values[i] = slot_input_value(att, tupleData,
+												   remoteattnum);
 			slot->tts_isnull[i] = false;
 
 			errarg.local_attnum = -1;
@@ -362,21 +426,22 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 }
 
 /*
- * Replace selected columns with user data provided as C strings.
+ * Replace selected columns with data received from the publisher.
  * This is somewhat similar to heap_modify_tuple but also calls the type
  * input functions on the user data.
  * "slot" is filled with a copy of the tuple in "srcslot", with
- * columns selected by the "replaces" array replaced with data values
- * from "values".
+ * columns marked as changed in "tupleData" replaced with its values.
  * Caution: unreplaced pass-by-ref columns in "slot" will point into the
  * storage for "srcslot".  This is OK for current usage, but someday we may
  * need to materialize "slot" at the end to make it independent of "srcslot".
  */
 static void
-slot_modify_cstrings(TupleTableSlot *slot, TupleTableSlot *srcslot,
-					 LogicalRepRelMapEntry *rel,
-					 char **values, bool *replaces)
+slot_modify_data(TupleTableSlot *slot, TupleTableSlot *srcslot,
+				 LogicalRepRelMapEntry *rel,
+				 LogicalRepTupleData *tupleData)
 {
+	char	  **values = tupleData->values;
+	bool	   *replaces = tupleData->changed;
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
 	SlotErrCallbackArg errarg;
@@ -417,16 +482,11 @@ slot_modify_cstrings(TupleTableSlot *slot, TupleTableSlot *srcslot,
 
 		if (values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.local_attnum = i;
 			errarg.remote_attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] =
-				OidInputFunctionCall(typinput, values[remoteattnum],
-									 typioparam, att->atttypmod);
+			slot->tts_values[i] = slot_input_value(att, tupleData,
+												   remoteattnum);
 			slot->tts_isnull[i] = false;
 
 			errarg.local_attnum = -1;
@@ -477,6 +537,12 @@ apply_handle_commit(StringInfo s)
 
 	Assert(commit_data.commit_lsn == remote_final_lsn);
 
+	if (InParallelApplyWorker)
+	{
+		pa_commit_transaction(&commit_data);
+		return;
+	}
+
 	/* The synchronization worker runs in single transaction. */
 	if (IsTransactionState() && !am_tablesync_worker())
 	{
@@ -490,7 +556,7 @@ apply_handle_commit(StringInfo s)
 		CommitTransactionCommand();
 		pgstat_report_stat(false);
 
-		store_flush_position(commit_data.end_lsn);
+		store_flush_position(commit_data.end_lsn, XactLastCommitEnd);
 	}
 	else
 	{
@@ -576,6 +642,172 @@ GetRelationIdentityOrPK(Relation rel)
 	return idxoid;
 }
 
+/*
+ * Can INSERTs into this table be applied with table_multi_insert()?
+ *
+ * Row triggers must see every row as it is inserted, so tables that have
+ * any are excluded; so is everything that is not a plain table.
+ */
+static bool
+apply_insert_batchable(LogicalRepRelMapEntry *rel)
+{
+	Relation	localrel = rel->localrel;
+	TriggerDesc *trigdesc = localrel->trigdesc;
+
+	if (localrel->rd_rel->relkind != RELKIND_RELATION)
+		return false;
+
+	if (trigdesc != NULL &&
+		(trigdesc->trig_insert_before_row ||
+		 trigdesc->trig_insert_after_row ||
+		 trigdesc->trig_insert_new_table))
+		return false;
+
+	return true;
+}
+
+/*
+ * Add the row in "newtup" to the pending insert batch.
+ *
+ * Returns false, without doing anything, if the row has to be inserted
+ * individually.  Any batch for a different table is flushed first.
+ */
+static bool
+apply_batch_insert(LogicalRepRelMapEntry *rel, LogicalRepTupleData *newtup,
+				   int msglen)
+{
+	TupleTableSlot *slot;
+	MemoryContext oldctx;
+
+	if (!apply_insert_batchable(rel))
+	{
+		apply_flush_insert_batch();
+		return false;
+	}
+
+	if (insert_batch.rel != NULL &&
+		RelationGetRelid(insert_batch.rel) != RelationGetRelid(rel->localrel))
+		apply_flush_insert_batch();
+
+	if (insert_batch.rel == NULL)
+	{
+		if (ApplyInsertBatchContext == NULL)
+			ApplyInsertBatchContext = AllocSetContextCreate(ApplyContext,
+															"ApplyInsertBatch",
+															ALLOCSET_DEFAULT_SIZES);
+
+		oldctx = MemoryContextSwitchTo(ApplyInsertBatchContext);
+		insert_batch.estate = create_estate_for_relation(rel);
+		MemoryContextSwitchTo(oldctx);
+
+		CheckCmdReplicaIdentity(rel->localrel, CMD_INSERT);
+		ExecOpenIndices(insert_batch.estate->es_result_relation_info, false);
+
+		/* Keep the table open until the batch has been written out. */
+		insert_batch.rel = table_open(RelationGetRelid(rel->localrel), NoLock);
+		insert_batch.nslots = 0;
+		insert_batch.size = 0;
+	}
+
+	slot = ExecInitExtraTupleSlot(insert_batch.estate,
+								  RelationGetDescr(insert_batch.rel),
+								  table_slot_callbacks(insert_batch.rel));
+
+	/* Input functions may need an active snapshot, so get one */
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	/* Process and store remote tuple in the slot */
+	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(insert_batch.estate));
+	slot_store_data(slot, rel, newtup);
+	slot_fill_defaults(rel, insert_batch.estate, slot);
+	MemoryContextSwitchTo(oldctx);
+
+	/* Copy the values out of the per-tuple context before resetting it. */
+	ExecMaterializeSlot(slot);
+	ResetPerTupleExprContext(insert_batch.estate);
+
+	PopActiveSnapshot();
+
+	insert_batch.slots[insert_batch.nslots++] = slot;
+	insert_batch.size += msglen;
+
+	if (insert_batch.nslots >= APPLY_INSERT_BATCH_MAX_TUPLES ||
+		insert_batch.size >= APPLY_INSERT_BATCH_MAX_BYTES)
+		apply_flush_insert_batch();
+
+	return true;
+}
+
+/*
+ * Write out the rows queued by apply_batch_insert(), if any.
+ */
+static void
+apply_flush_insert_batch(void)
+{
+	EState	   *estate = insert_batch.estate;
+	ResultRelInfo *resultRelInfo;
+	Relation	rel = insert_batch.rel;
+	int			i;
+
+	if (rel == NULL)
+		return;
+
+	resultRelInfo = estate->es_result_relation_info;
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	for (i = 0; i < insert_batch.nslots; i++)
+	{
+		TupleTableSlot *slot = insert_batch.slots[i];
+
+		/* Compute stored generated columns */
+		if (rel->rd_att->constr &&
+			rel->rd_att->constr->has_generated_stored)
+			ExecComputeStoredGenerated(estate, slot);
+
+		/* Check the constraints of the tuple */
+		if (rel->rd_att->constr)
+			ExecConstraints(resultRelInfo, slot, estate);
+		if (resultRelInfo->ri_PartitionCheck)
+			ExecPartitionCheck(resultRelInfo, slot, estate, true);
+	}
+
+	table_multi_insert(rel, insert_batch.slots, insert_batch.nslots,
+					   estate->es_output_cid, 0, NULL);
+
+	if (resultRelInfo->ri_NumIndices > 0)
+	{
+		for (i = 0; i < insert_batch.nslots; i++)
+		{
+			List	   *recheckIndexes;
+
+			recheckIndexes = ExecInsertIndexTuples(insert_batch.slots[i],
+												   estate, false, NULL, NIL);
+			list_free(recheckIndexes);
+		}
+	}
+
+	/* Cleanup. */
+	ExecCloseIndices(resultRelInfo);
+	PopActiveSnapshot();
+
+	/* Handle queued AFTER triggers. */
+	AfterTriggerEndQuery(estate);
+
+	ExecResetTupleTable(estate->es_tupleTable, false);
+	FreeExecutorState(estate);
+
+	table_close(rel, NoLock);
+
+	insert_batch.rel = NULL;
+	insert_batch.estate = NULL;
+	insert_batch.nslots = 0;
+	insert_batch.size = 0;
+	MemoryContextReset(ApplyInsertBatchContext);
+
+	CommandCounterIncrement();
+}
+
 /*
  * Handle INSERT message.
  */
@@ -603,6 +835,13 @@ apply_handle_insert(StringInfo s)
 		return;
 	}
 
+	/* Queue the row for a multi-insert if the table allows it. */
+	if (apply_batch_insert(rel, &newtup, s->len))
+	{
+		logicalrep_rel_close(rel, NoLock);
+		return;
+	}
+
 	/* Initialize the executor state. */
 	estate = create_estate_for_relation(rel);
 	remoteslot = ExecInitExtraTupleSlot(estate,
@@ -614,7 +853,7 @@ apply_handle_insert(StringInfo s)
 
 	/* Process and store remote tuple in the slot */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, newtup.values);
+	slot_store_data(remoteslot, rel, &newtup);
 	slot_fill_defaults(rel, estate, remoteslot);
 	MemoryContextSwitchTo(oldctx);
 
@@ -750,8 +989,7 @@ apply_handle_update(StringInfo s)
 
 	/* Build the search tuple. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel,
-						has_oldtup ? oldtup.values : newtup.values);
+	slot_store_data(remoteslot, rel, has_oldtup ? &oldtup : &newtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -781,8 +1019,7 @@ apply_handle_update(StringInfo s)
 	{
 		/* Process and store remote tuple in the slot */
 		oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-		slot_modify_cstrings(remoteslot, localslot, rel,
-							 newtup.values, newtup.changed);
+		slot_modify_data(remoteslot, localslot, rel, &newtup);
 		MemoryContextSwitchTo(oldctx);
 
 		EvalPlanQualSetSlot(&epqstate, remoteslot);
@@ -869,7 +1106,7 @@ apply_handle_delete(StringInfo s)
 
 	/* Find the tuple using the replica identity index. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, oldtup.values);
+	slot_store_data(remoteslot, rel, &oldtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -985,11 +1222,15 @@ apply_handle_truncate(StringInfo s)
 /*
  * Logical replication protocol message dispatcher.
  */
-static void
+void
 apply_dispatch(StringInfo s)
 {
 	char		action = pq_getmsgbyte(s);
 
+	/* Anything but another INSERT ends the current insert batch. */
+	if (action != 'I')
+		apply_flush_insert_batch();
+
 	switch (action)
 	{
 			/* BEGIN */
@@ -1092,8 +1333,8 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
 /*
  * Store current remote/local lsn pair in the tracking list.
  */
-static void
-store_flush_position(XLogRecPtr remote_lsn)
+void
+store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn)
 {
 	FlushPosition *flushpos;
 
@@ -1102,7 +1343,7 @@ store_flush_position(XLogRecPtr remote_lsn)
 
 	/* Track commit lsn  */
 	flushpos = (FlushPosition *) palloc(sizeof(FlushPosition));
-	flushpos->local_end = XactLastCommitEnd;
+	flushpos->local_end = local_lsn;
 	flushpos->remote_end = remote_lsn;
 
 	dlist_push_tail(&lsn_mapping, &flushpos->node);
@@ -1215,7 +1456,8 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 
 						UpdateWorkerStats(last_received, send_time, false);
 
-						apply_dispatch(&s);
+						if (!pa_dispatch(&s))
+							apply_dispatch(&s);
 					}
 					else if (c == 'k')
 					{
@@ -1242,6 +1484,9 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			}
 		}
 
+		/* Note transactions committed by parallel apply workers, if any. */
+		pa_process_commits();
+
 		/* confirm all writes so far */
 		send_feedback(last_received, false, false);
 
@@ -1255,8 +1500,12 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			AcceptInvalidationMessages();
 			maybe_reread_subscription();
 
-			/* Process any table synchronization changes. */
-			process_syncing_tables(last_received);
+			/*
+			 * Process any table synchronization changes, once the parallel
+			 * apply workers have caught up.
+			 */
+			if (!pa_has_inflight())
+				process_syncing_tables(last_received);
 		}
 
 		/* Cleanup the memory. */
@@ -1279,7 +1528,7 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 		 * no particular urgency about waking up unless we get data or a
 		 * signal.
 		 */
-		if (!dlist_is_empty(&lsn_mapping))
+		if (!dlist_is_empty(&lsn_mapping) || pa_has_inflight())
 			wait_time = WalWriterDelay;
 		else
 			wait_time = NAPTIME_PER_CYCLE;
@@ -1383,6 +1632,10 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 
 	get_flush_position(&writepos, &flushpos, &have_pending_txes);
 
+	/* Transactions given to parallel apply workers may not be applied yet. */
+	if (pa_has_inflight())
+		have_pending_txes = true;
+
 	/*
 	 * No outstanding transactions to flush, we can report the latest received
 	 * position. This is important for synchronous replication.
@@ -1540,6 +1793,20 @@ maybe_reread_subscription(void)
 		proc_exit(0);
 	}
 
+	/*
+	 * Exit if the binary transfer option was changed.  The launcher will
+	 * start a new worker, which will restart streaming with the new setting.
+	 */
+	if (newsub->binary != MySubscription->binary)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because the binary option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
 	/*
 	 * Exit if publication list was changed. The launcher will start new
 	 * worker.
@@ -1738,11 +2005,14 @@ ApplyWorkerMain(Datum main_arg)
 		originid = replorigin_by_name(originname, true);
 		if (!OidIsValid(originid))
 			originid = replorigin_create(originname);
-		replorigin_session_setup(originid);
+		replorigin_session_setup(originid, 0);
 		replorigin_session_origin = originid;
 		origin_startpos = replorigin_session_get_progress(false);
 		CommitTransactionCommand();
 
+		/* Start parallel apply workers, if requested. */
+		pa_start_workers(originid);
+
 		wrconn = walrcv_connect(MySubscription->conninfo, true, MySubscription->name,
 								&err);
 		if (wrconn == NULL)
@@ -1771,6 +2041,7 @@ ApplyWorkerMain(Datum main_arg)
 	options.slotname = myslotname;
 	options.proto.logical.proto_version = LOGICALREP_PROTO_VERSION_NUM;
 	options.proto.logical.publication_names = MySubscription->publications;
+	options.proto.logical.binary = MySubscription->binary;
 
 	/* Start normal logical streaming replication. */
 	walrcv_startstreaming(wrconn, &options);
@@ -13,15 +13,21 @@
 #include "postgres.h"
 
 #include "catalog/pg_publication.h"
+#include "catalog/pg_publication_rel.h"
+#include "commands/defrem.h"
+#include "executor/executor.h"
+#include "nodes/makefuncs.h"
 
 #include "replication/logical.h"
 #include "replication/logicalproto.h"
 #include "replication/origin.h"
 #include "replication/pgoutput.h"
 
+#include "utils/builtins.h"
 #include "utils/inval.h"
 #include "utils/int8.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/varlena.h"
 
@@ -51,20 +57,47 @@ static List *LoadPublications(List *pubnames);
 static void publication_invalidation_cb(Datum arg, int cacheid,
 										uint32 hashvalue);
 
-/* Entry in the map used to remember which relation schemas we sent. */
+/*
+ * Entry in the map used to remember which relation schemas we sent.
+ *
+ * The row filter and column list are combined over all the subscribed
+ * publications that contain the relation: a row is sent if it matches the
+ * filter of any of them, and a column is sent if any of them lists it.  A
+ * publication without a filter or without a column list (including FOR ALL
+ * TABLES publications) therefore disables filtering of rows or columns.
+ */
 typedef struct RelationSyncEntry
 {
 	Oid			relid;			/* relation oid */
 	bool		schema_sent;	/* did we send the schema? */
 	bool		replicate_valid;
 	PublicationActions pubactions;
+
+	/*
+	 * Row filter state, all allocated in entry_cxt.  exprstate is NULL if
+	 * rows are not filtered.
+	 */
+	MemoryContext entry_cxt;
+	ExprState  *exprstate;
+	EState	   *estate;
+	TupleTableSlot *new_slot;
+	TupleTableSlot *old_slot;
+
+	/* Columns to send, or NULL for all; also allocated in entry_cxt */
+	Bitmapset  *columns;
 } RelationSyncEntry;
 
 /* Map used to remember which relation schemas we sent. */
 static HTAB *RelationSyncCache = NULL;
 
 static void init_rel_sync_cache(MemoryContext decoding_context);
-static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data, Oid relid);
+static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data,
+											 Relation relation);
+static void pgoutput_build_filters(RelationSyncEntry *entry,
+								   Relation relation, List *pubids,
+								   List *publications);
+static bool pgoutput_row_filter(RelationSyncEntry *entry,
+								TupleTableSlot *slot, HeapTuple tuple);
 static void rel_sync_cache_relation_cb(Datum arg, Oid relid);
 static void rel_sync_cache_publication_cb(Datum arg, int cacheid,
 										  uint32 hashvalue);
@@ -88,11 +121,14 @@ _PG_output_plugin_init(OutputPluginCallbacks *cb)
 
 static void
 parse_output_parameters(List *options, uint32 *protocol_version,
-						List **publication_names)
+						List **publication_names, bool *binary)
 {
 	ListCell   *lc;
 	bool		protocol_version_given = false;
 	bool		publication_names_given = false;
+	bool		binary_option_given = false;
+
+	*binary = false;
 
 	foreach(lc, options)
 	{
@@ -138,6 +174,16 @@ parse_output_parameters(List *options, uint32 *protocol_version,
 						(errcode(ERRCODE_INVALID_NAME),
 						 errmsg("invalid publication_names syntax")));
 		}
+		else if (strcmp(defel->defname, "binary") == 0)
+		{
+			if (binary_option_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			binary_option_given = true;
+
+			*binary = defGetBoolean(defel);
+		}
 		else
 			elog(ERROR, "unrecognized pgoutput option: %s", defel->defname);
 	}
@@ -172,7 +218,8 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 		/* Parse the params and ERROR if we see any we don't recognize */
 		parse_output_parameters(ctx->output_plugin_options,
 								&data->protocol_version,
-								&data->publication_names);
+								&data->publication_names,
+								&data->binary);
 
 		/* Check if we support requested protocol */
 		if (data->protocol_version > LOGICALREP_PROTO_VERSION_NUM)
@@ -292,7 +339,7 @@ maybe_send_schema(LogicalDecodingContext *ctx,
 		}
 
 		OutputPluginPrepareWrite(ctx, false);
-		logicalrep_write_rel(ctx->out, relation);
+		logicalrep_write_rel(ctx->out, relation, relentry->columns);
 		OutputPluginWrite(ctx, false);
 		relentry->schema_sent = true;
 	}
@@ -308,11 +355,14 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
 	MemoryContext old;
 	RelationSyncEntry *relentry;
+	enum ReorderBufferChangeType action = change->action;
+	HeapTuple	oldtuple = NULL;
+	HeapTuple	newtuple = NULL;
 
 	if (!is_publishable_relation(relation))
 		return;
 
-	relentry = get_rel_sync_entry(data, RelationGetRelid(relation));
+	relentry = get_rel_sync_entry(data, relation);
 
 	/* First check the table filter */
 	switch (change->action)
@@ -333,41 +383,102 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 			Assert(false);
 	}
 
+	if (change->data.tp.oldtuple)
+		oldtuple = &change->data.tp.oldtuple->tuple;
+	if (change->data.tp.newtuple)
+		newtuple = &change->data.tp.newtuple->tuple;
+
+	if (action == REORDER_BUFFER_CHANGE_DELETE && oldtuple == NULL)
+	{
+		elog(DEBUG1, "didn't send DELETE change because of missing oldtuple");
+		return;
+	}
+
+	/*
+	 * Then the row filter.  An UPDATE is checked against both the old and
+	 * the new row; if only one of them matches, it is sent as an INSERT or
+	 * a DELETE instead, so that the subscriber ends up with exactly the
+	 * rows that match.  Without an old tuple the replica identity didn't
+	 * change, and as the filter may only reference replica identity
+	 * columns, the new tuple gives the same answer.
+	 */
+	if (relentry->exprstate != NULL)
+	{
+		switch (action)
+		{
+			case REORDER_BUFFER_CHANGE_INSERT:
+				if (!pgoutput_row_filter(relentry, relentry->new_slot,
+										 newtuple))
+					return;
+				break;
+			case REORDER_BUFFER_CHANGE_UPDATE:
+				{
+					bool		old_match;
+					bool		new_match;
+
+					new_match = pgoutput_row_filter(relentry,
+													relentry->new_slot,
+													newtuple);
+					if (oldtuple != NULL)
+						old_match = pgoutput_row_filter(relentry,
+														relentry->old_slot,
+														oldtuple);
+					else
+						old_match = new_match;
+
+					if (!old_match && !new_match)
+						return;
+					else if (!old_match)
+					{
+						if (!relentry->pubactions.pubinsert)
+							return;
+						action = REORDER_BUFFER_CHANGE_INSERT;
+					}
+					else if (!new_match)
+					{
+						if (!relentry->pubactions.pubdelete)
+							return;
+						action = REORDER_BUFFER_CHANGE_DELETE;
+						if (oldtuple == NULL)
+							oldtuple = newtuple;
+					}
+				}
+				break;
+			case REORDER_BUFFER_CHANGE_DELETE:
+				if (!pgoutput_row_filter(relentry, relentry->old_slot,
+										 oldtuple))
+					return;
+				break;
+			default:
+				Assert(false);
+		}
+	}
+
 	/* Avoid leaking memory by using and resetting our own context */
 	old = MemoryContextSwitchTo(data->context);
 
 	maybe_send_schema(ctx, relation, relentry);
 
 	/* Send the data */
-	switch (change->action)
+	switch (action)
 	{
 		case REORDER_BUFFER_CHANGE_INSERT:
 			OutputPluginPrepareWrite(ctx, true);
-			logicalrep_write_insert(ctx->out, relation,
-									&change->data.tp.newtuple->tuple);
+			logicalrep_write_insert(ctx->out, relation, newtuple,
+									data->binary, relentry->columns);
 			OutputPluginWrite(ctx, true);
 			break;
 		case REORDER_BUFFER_CHANGE_UPDATE:
-			{
-				HeapTuple	oldtuple = change->data.tp.oldtuple ?
-				&change->data.tp.oldtuple->tuple : NULL;
-
-				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_update(ctx->out, relation, oldtuple,
-										&change->data.tp.newtuple->tuple);
-				OutputPluginWrite(ctx, true);
-				break;
-			}
+			OutputPluginPrepareWrite(ctx, true);
+			logicalrep_write_update(ctx->out, relation, oldtuple, newtuple,
+									data->binary, relentry->columns);
+			OutputPluginWrite(ctx, true);
+			break;
 		case REORDER_BUFFER_CHANGE_DELETE:
-			if (change->data.tp.oldtuple)
-			{
-				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_delete(ctx->out, relation,
-										&change->data.tp.oldtuple->tuple);
-				OutputPluginWrite(ctx, true);
-			}
-			else
-				elog(DEBUG1, "didn't send DELETE change because of missing oldtuple");
+			OutputPluginPrepareWrite(ctx, true);
+			logicalrep_write_delete(ctx->out, relation, oldtuple,
+									data->binary, relentry->columns);
+			OutputPluginWrite(ctx, true);
 			break;
 		default:
 			Assert(false);
@@ -402,7 +513,7 @@ pgoutput_truncate(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 		if (!is_publishable_relation(relation))
 			continue;
 
-		relentry = get_rel_sync_entry(data, relid);
+		relentry = get_rel_sync_entry(data, relation);
 
 		if (!relentry->pubactions.pubtruncate)
 			continue;
@@ -527,8 +638,9 @@ init_rel_sync_cache(MemoryContext cachectx)
  * Find or create entry in the relation schema cache.
  */
 static RelationSyncEntry *
-get_rel_sync_entry(PGOutputData *data, Oid relid)
+get_rel_sync_entry(PGOutputData *data, Relation relation)
 {
+	Oid			relid = RelationGetRelid(relation);
 	RelationSyncEntry *entry;
 	bool		found;
 	MemoryContext oldctx;
@@ -543,6 +655,9 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 	MemoryContextSwitchTo(oldctx);
 	Assert(entry != NULL);
 
+	if (!found)
+		entry->entry_cxt = NULL;
+
 	/* Not found means schema wasn't sent */
 	if (!found || !entry->replicate_valid)
 	{
@@ -580,12 +695,10 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 				entry->pubactions.pubdelete |= pub->pubactions.pubdelete;
 				entry->pubactions.pubtruncate |= pub->pubactions.pubtruncate;
 			}
-
-			if (entry->pubactions.pubinsert && entry->pubactions.pubupdate &&
-				entry->pubactions.pubdelete && entry->pubactions.pubtruncate)
-				break;
 		}
 
+		pgoutput_build_filters(entry, relation, pubids, data->publications);
+
 		list_free(pubids);
 
 		entry->replicate_valid = true;
@@ -597,6 +710,135 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 	return entry;
 }
 
+/*
+ * (Re)build the row filter and column list of a relation sync entry from
+ * the publications containing the relation.
+ */
+static void
+pgoutput_build_filters(RelationSyncEntry *entry, Relation relation,
+					   List *pubids, List *publications)
+{
+	List	   *rfnodes = NIL;
+	bool		no_filter = false;
+	bool		all_columns = false;
+	Bitmapset  *columns = NULL;
+	ListCell   *lc;
+	MemoryContext oldctx;
+
+	/*
+	 * Throw away the previous state.  The entry isn't in use at this point,
+	 * see rel_sync_cache_relation_cb.
+	 */
+	if (entry->entry_cxt != NULL)
+		MemoryContextDelete(entry->entry_cxt);
+	entry->entry_cxt = NULL;
+	entry->exprstate = NULL;
+	entry->estate = NULL;
+	entry->new_slot = entry->old_slot = NULL;
+	entry->columns = NULL;
+
+	foreach(lc, publications)
+	{
+		Publication *pub = lfirst(lc);
+		HeapTuple	tup;
+		Datum		datum;
+		bool		isnull;
+
+		if (pub->alltables)
+		{
+			no_filter = all_columns = true;
+			break;
+		}
+
+		if (!list_member_oid(pubids, pub->oid))
+			continue;
+
+		tup = SearchSysCache2(PUBLICATIONRELMAP,
+							  ObjectIdGetDatum(entry->relid),
+							  ObjectIdGetDatum(pub->oid));
+		if (!HeapTupleIsValid(tup))
+			continue;
+
+		if (!no_filter)
+		{
+			datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+									Anum_pg_publication_rel_prqual, &isnull);
+			if (isnull)
+				no_filter = true;
+			else
+				rfnodes = lappend(rfnodes,
+								  stringToNode(TextDatumGetCString(datum)));
+		}
+
+		if (!all_columns)
+		{
+			datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+									Anum_pg_publication_rel_prattrs, &isnull);
+			if (isnull)
+				all_columns = true;
+			else
+				columns = pub_collist_to_bitmapset(columns, datum,
+												   CurrentMemoryContext);
+		}
+
+		ReleaseSysCache(tup);
+	}
+
+	if ((no_filter || rfnodes == NIL) && (all_columns || columns == NULL))
+		return;
+
+	entry->entry_cxt = AllocSetContextCreate(CacheMemoryContext,
+											 "logical replication row filter",
+											 ALLOCSET_SMALL_SIZES);
+	oldctx = MemoryContextSwitchTo(entry->entry_cxt);
+
+	if (!all_columns && columns != NULL)
+		entry->columns = bms_copy(columns);
+
+	if (!no_filter && rfnodes != NIL)
+	{
+		Expr	   *rfnode;
+		TupleDesc	tupdesc;
+
+		if (list_length(rfnodes) == 1)
+			rfnode = linitial(rfnodes);
+		else
+			rfnode = makeBoolExpr(OR_EXPR, rfnodes, -1);
+		rfnode = (Expr *) copyObject(rfnode);
+
+		entry->estate = CreateExecutorState();
+		entry->exprstate = ExecPrepareExpr(rfnode, entry->estate);
+
+		tupdesc = CreateTupleDescCopy(RelationGetDescr(relation));
+		entry->new_slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsHeapTuple);
+		entry->old_slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsHeapTuple);
+	}
+
+	MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Does the given tuple match the row filter of the entry?
+ */
+static bool
+pgoutput_row_filter(RelationSyncEntry *entry, TupleTableSlot *slot,
+					HeapTuple tuple)
+{
+	ExprContext *econtext = GetPerTupleExprContext(entry->estate);
+	Datum		ret;
+	bool		isnull;
+
+	ExecStoreHeapTuple(tuple, slot, false);
+	econtext->ecxt_scantuple = slot;
+
+	ret = ExecEvalExprSwitchContext(entry->exprstate, econtext, &isnull);
+
+	ExecClearTuple(slot);
+	ResetPerTupleExprContext(entry->estate);
+
+	return !isnull && DatumGetBool(ret);
+}
+
 /*
  * Relcache invalidation callback
  */
@@ -630,9 +872,13 @@ rel_sync_cache_relation_cb(Datum arg, Oid relid)
 
 	/*
 	 * Reset schema sent status as the relation definition may have changed.
+	 * Also rebuild the row filter, whose tuple slots depend on it.
 	 */
 	if (entry != NULL)
+	{
 		entry->schema_sent = false;
+		entry->replicate_valid = false;
+	}
 }
 
 /*
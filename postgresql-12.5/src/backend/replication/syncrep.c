@@ -29,6 +29,13 @@
  * single ordered queue of waiting backends, so that we can avoid
  * searching the through all waiters each time we receive a reply.
  *
+ * Under a heavy commit load a single reply typically releases many waiters,
+ * and many commits find their LSN already confirmed by the time they would
+ * start to wait.  To keep SyncRepLock off the critical path, the released
+ * positions are published as atomics that backends and walsenders check
+ * before taking the lock, and the walsender only unlinks the released
+ * waiters while holding the lock, setting their latches after releasing it.
+ *
  * In 9.5 or before only a single standby could be considered as
  * synchronous. In 9.6 we support a priority-based multiple synchronous
  * standbys. In 10.0 a quorum-based multiple synchronous standbys is also
@@ -76,6 +83,7 @@
 
 #include "access/xact.h"
 #include "miscadmin.h"
+#include "utils/memutils.h"
 #include "pgstat.h"
 #include "replication/syncrep.h"
 #include "replication/walsender.h"
@@ -97,9 +105,19 @@ static bool announce_next_takeover = true;
 SyncRepConfigData *SyncRepConfig = NULL;
 static int	SyncRepWaitMode = SYNC_REP_NO_WAIT;
 
+/*
+ * Backends released by SyncRepWakeQueue() whose latches haven't been set yet.
+ * We set them only after releasing SyncRepLock, so that the woken backends
+ * don't immediately block on the lock we're still holding.
+ */
+static PGPROC **SyncRepWakeupProcs = NULL;
+static int	SyncRepNumWakeupProcs = 0;
+
 static void SyncRepQueueInsert(int mode);
 static void SyncRepCancelWait(void);
 static int	SyncRepWakeQueue(bool all, int mode);
+static void SyncRepPrepareWakeups(void);
+static void SyncRepSetWakeupLatches(void);
 
 static bool SyncRepGetSyncRecPtr(XLogRecPtr *writePtr,
 								 XLogRecPtr *flushPtr,
@@ -120,7 +138,6 @@ static int	SyncRepGetStandbyPriority(void);
 static List *SyncRepGetSyncStandbysPriority(bool *am_sync);
 static List *SyncRepGetSyncStandbysQuorum(bool *am_sync);
 static int	standby_priority_comparator(const void *a, const void *b);
-static int	cmp_lsn(const void *a, const void *b);
 
 #ifdef USE_ASSERT_CHECKING
 static bool SyncRepQueueIsOrderedByLSN(int mode);
@@ -168,6 +185,14 @@ SyncRepWaitForLSN(XLogRecPtr lsn, bool commit)
 	Assert(SHMQueueIsDetached(&(MyProc->syncRepLinks)));
 	Assert(WalSndCtl != NULL);
 
+	/*
+	 * If the standbys have already confirmed our LSN, we needn't take the
+	 * lock at all.  The published positions only ever advance, so reading a
+	 * stale value just sends us down the slow path.
+	 */
+	if (lsn <= pg_atomic_read_u64(&WalSndCtl->lsn[mode]))
+		return;
+
 	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
 	Assert(MyProc->syncRepState == SYNC_REP_NOT_WAITING);
 
@@ -180,7 +205,7 @@ SyncRepWaitForLSN(XLogRecPtr lsn, bool commit)
 	 * to be a low cost check.
 	 */
 	if (!WalSndCtl->sync_standbys_defined ||
-		lsn <= WalSndCtl->lsn[mode])
+		lsn <= pg_atomic_read_u64(&WalSndCtl->lsn[mode]))
 	{
 		LWLockRelease(SyncRepLock);
 		return;
@@ -423,7 +448,7 @@ SyncRepInitConfig(void)
 void
 SyncRepReleaseWaiters(void)
 {
-	volatile WalSndCtlData *walsndctl = WalSndCtl;
+	WalSndCtlData *walsndctl = WalSndCtl;
 	XLogRecPtr	writePtr;
 	XLogRecPtr	flushPtr;
 	XLogRecPtr	applyPtr;
@@ -452,16 +477,12 @@ SyncRepReleaseWaiters(void)
 	/*
 	 * We're a potential sync standby. Release waiters if there are enough
 	 * sync standbys and we are considered as sync.
-	 */
-	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
-
-	/*
+	 *
 	 * Check whether we are a sync standby or not, and calculate the synced
-	 * positions among all sync standbys.  (Note: although this step does not
-	 * of itself require holding SyncRepLock, it seems like a good idea to do
-	 * it after acquiring the lock.  This ensures that the WAL pointers we use
-	 * to release waiters are newer than any previous execution of this
-	 * routine used.)
+	 * positions among all sync standbys.  This doesn't require holding
+	 * SyncRepLock.  Another walsender may publish newer positions before we
+	 * get the lock, but we only ever advance the published positions, so
+	 * that's harmless.
 	 */
 	got_recptr = SyncRepGetSyncRecPtr(&writePtr, &flushPtr, &applyPtr, &am_sync);
 
@@ -489,33 +510,48 @@ SyncRepReleaseWaiters(void)
 	 */
 	if (!got_recptr || !am_sync)
 	{
-		LWLockRelease(SyncRepLock);
 		announce_next_takeover = !am_sync;
 		return;
 	}
 
+	/*
+	 * Quick exit if none of the positions has moved past what's already
+	 * published; another walsender of the quorum may well have beaten us to
+	 * it.
+	 */
+	if (writePtr <= pg_atomic_read_u64(&walsndctl->lsn[SYNC_REP_WAIT_WRITE]) &&
+		flushPtr <= pg_atomic_read_u64(&walsndctl->lsn[SYNC_REP_WAIT_FLUSH]) &&
+		applyPtr <= pg_atomic_read_u64(&walsndctl->lsn[SYNC_REP_WAIT_APPLY]))
+		return;
+
+	SyncRepPrepareWakeups();
+
+	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
+
 	/*
 	 * Set the lsn first so that when we wake backends they will release up to
 	 * this location.
 	 */
-	if (walsndctl->lsn[SYNC_REP_WAIT_WRITE] < writePtr)
+	if (pg_atomic_read_u64(&walsndctl->lsn[SYNC_REP_WAIT_WRITE]) < writePtr)
 	{
-		walsndctl->lsn[SYNC_REP_WAIT_WRITE] = writePtr;
+		pg_atomic_write_u64(&walsndctl->lsn[SYNC_REP_WAIT_WRITE], writePtr);
 		numwrite = SyncRepWakeQueue(false, SYNC_REP_WAIT_WRITE);
 	}
-	if (walsndctl->lsn[SYNC_REP_WAIT_FLUSH] < flushPtr)
+	if (pg_atomic_read_u64(&walsndctl->lsn[SYNC_REP_WAIT_FLUSH]) < flushPtr)
 	{
-		walsndctl->lsn[SYNC_REP_WAIT_FLUSH] = flushPtr;
+		pg_atomic_write_u64(&walsndctl->lsn[SYNC_REP_WAIT_FLUSH], flushPtr);
 		numflush = SyncRepWakeQueue(false, SYNC_REP_WAIT_FLUSH);
 	}
-	if (walsndctl->lsn[SYNC_REP_WAIT_APPLY] < applyPtr)
+	if (pg_atomic_read_u64(&walsndctl->lsn[SYNC_REP_WAIT_APPLY]) < applyPtr)
 	{
-		walsndctl->lsn[SYNC_REP_WAIT_APPLY] = applyPtr;
+		pg_atomic_write_u64(&walsndctl->lsn[SYNC_REP_WAIT_APPLY], applyPtr);
 		numapply = SyncRepWakeQueue(false, SYNC_REP_WAIT_APPLY);
 	}
 
 	LWLockRelease(SyncRepLock);
 
+	SyncRepSetWakeupLatches();
+
 	elog(DEBUG3, "released %d procs up to write %X/%X, %d procs up to flush %X/%X, %d procs up to apply %X/%X",
 		 numwrite, (uint32) (writePtr >> 32), (uint32) writePtr,
 		 numflush, (uint32) (flushPtr >> 32), (uint32) flushPtr,
@@ -635,9 +671,37 @@ SyncRepGetOldestSyncRecPtr(XLogRecPtr *writePtr,
 	}
 }
 
+/*
+ * Add lsn to latest[], which holds the count (at most n) latest LSNs seen so
+ * far in descending order.
+ */
+static inline void
+SyncRepInsertLatestLSN(XLogRecPtr *latest, int count, int n, XLogRecPtr lsn)
+{
+	int			j;
+
+	if (count < n)
+		j = count;
+	else if (lsn > latest[n - 1])
+		j = n - 1;
+	else
+		return;
+
+	while (j > 0 && latest[j - 1] < lsn)
+	{
+		latest[j] = latest[j - 1];
+		j--;
+	}
+	latest[j] = lsn;
+}
+
 /*
  * Calculate the Nth latest Write, Flush and Apply positions among sync
  * standbys.
+ *
+ * This runs for every reply from a quorum standby, so rather than sorting
+ * all the positions we make a single pass over the standbys, keeping only
+ * the nth latest positions seen so far.  nth is usually small.
  */
 static void
 SyncRepGetNthLatestSyncRecPtr(XLogRecPtr *writePtr,
@@ -655,21 +719,18 @@ SyncRepGetNthLatestSyncRecPtr(XLogRecPtr *writePtr,
 	/* Should have enough candidates, or somebody messed up */
 	Assert(nth > 0 && nth <= num_standbys);
 
-	write_array = (XLogRecPtr *) palloc(sizeof(XLogRecPtr) * num_standbys);
-	flush_array = (XLogRecPtr *) palloc(sizeof(XLogRecPtr) * num_standbys);
-	apply_array = (XLogRecPtr *) palloc(sizeof(XLogRecPtr) * num_standbys);
+	write_array = (XLogRecPtr *) palloc(sizeof(XLogRecPtr) * nth * 3);
+	flush_array = write_array + nth;
+	apply_array = flush_array + nth;
 
 	for (i = 0; i < num_standbys; i++)
 	{
-		write_array[i] = sync_standbys[i].write;
-		flush_array[i] = sync_standbys[i].flush;
-		apply_array[i] = sync_standbys[i].apply;
-	}
+		int			count = Min(i, nth);
 
-	/* Sort each array in descending order */
-	qsort(write_array, num_standbys, sizeof(XLogRecPtr), cmp_lsn);
-	qsort(flush_array, num_standbys, sizeof(XLogRecPtr), cmp_lsn);
-	qsort(apply_array, num_standbys, sizeof(XLogRecPtr), cmp_lsn);
+		SyncRepInsertLatestLSN(write_array, count, nth, sync_standbys[i].write);
+		SyncRepInsertLatestLSN(flush_array, count, nth, sync_standbys[i].flush);
+		SyncRepInsertLatestLSN(apply_array, count, nth, sync_standbys[i].apply);
+	}
 
 	/* Get Nth latest Write, Flush, Apply positions */
 	*writePtr = write_array[nth - 1];
@@ -677,25 +738,6 @@ SyncRepGetNthLatestSyncRecPtr(XLogRecPtr *writePtr,
 	*applyPtr = apply_array[nth - 1];
 
 	pfree(write_array);
-	pfree(flush_array);
-	pfree(apply_array);
-}
-
-/*
- * Compare lsn in order to sort array in descending order.
- */
-static int
-cmp_lsn(const void *a, const void *b)
-{
-	XLogRecPtr	lsn1 = *((const XLogRecPtr *) a);
-	XLogRecPtr	lsn2 = *((const XLogRecPtr *) b);
-
-	if (lsn1 > lsn2)
-		return -1;
-	else if (lsn1 == lsn2)
-		return 0;
-	else
-		return 1;
 }
 
 /*
@@ -1134,22 +1176,25 @@ SyncRepGetStandbyPriority(void)
 
 /*
  * Walk the specified queue from head.  Set the state of any backends that
- * need to be woken, remove them from the queue, and then wake them.
- * Pass all = true to wake whole queue; otherwise, just wake up to
- * the walsender's LSN.
+ * need to be woken, remove them from the queue, and remember them in
+ * SyncRepWakeupProcs.  Pass all = true to wake whole queue; otherwise, just
+ * wake up to the walsender's LSN.
  *
- * Must hold SyncRepLock.
+ * Must hold SyncRepLock, and must have called SyncRepPrepareWakeups()
+ * beforehand.  The caller is responsible for calling
+ * SyncRepSetWakeupLatches() after releasing the lock.
  */
 static int
 SyncRepWakeQueue(bool all, int mode)
 {
-	volatile WalSndCtlData *walsndctl = WalSndCtl;
+	XLogRecPtr	lsn = pg_atomic_read_u64(&WalSndCtl->lsn[mode]);
 	PGPROC	   *proc = NULL;
 	PGPROC	   *thisproc = NULL;
 	int			numprocs = 0;
 
 	Assert(mode >= 0 && mode < NUM_SYNC_REP_WAIT_MODE);
 	Assert(SyncRepQueueIsOrderedByLSN(mode));
+	Assert(SyncRepWakeupProcs != NULL);
 
 	proc = (PGPROC *) SHMQueueNext(&(WalSndCtl->SyncRepQueue[mode]),
 								   &(WalSndCtl->SyncRepQueue[mode]),
@@ -1160,7 +1205,7 @@ SyncRepWakeQueue(bool all, int mode)
 		/*
 		 * Assume the queue is ordered by LSN
 		 */
-		if (!all && walsndctl->lsn[mode] < proc->waitLSN)
+		if (!all && lsn < proc->waitLSN)
 			return numprocs;
 
 		/*
@@ -1191,9 +1236,12 @@ SyncRepWakeQueue(bool all, int mode)
 		thisproc->syncRepState = SYNC_REP_WAIT_COMPLETE;
 
 		/*
-		 * Wake only when we have set state and removed from queue.
+		 * Wake only when we have set state and removed from queue; that's
+		 * done by SyncRepSetWakeupLatches().  Each proc is in at most one
+		 * queue, so there's always room.
 		 */
-		SetLatch(&(thisproc->procLatch));
+		Assert(SyncRepNumWakeupProcs < MaxBackends);
+		SyncRepWakeupProcs[SyncRepNumWakeupProcs++] = thisproc;
 
 		numprocs++;
 	}
@@ -1201,6 +1249,38 @@ SyncRepWakeQueue(bool all, int mode)
 	return numprocs;
 }
 
+/*
+ * Make sure we have space to remember the backends released by
+ * SyncRepWakeQueue().  This must be done before acquiring SyncRepLock.
+ */
+static void
+SyncRepPrepareWakeups(void)
+{
+	if (SyncRepWakeupProcs == NULL)
+		SyncRepWakeupProcs = (PGPROC **)
+			MemoryContextAlloc(TopMemoryContext,
+							   sizeof(PGPROC *) * MaxBackends);
+	SyncRepNumWakeupProcs = 0;
+}
+
+/*
+ * Set the latches of the backends released by SyncRepWakeQueue().
+ *
+ * This is done after releasing SyncRepLock.  A released backend may already
+ * have noticed its new state and moved on by the time we get here, in which
+ * case it just sees a spurious wakeup, which all latch waiters must cope
+ * with anyway.
+ */
+static void
+SyncRepSetWakeupLatches(void)
+{
+	int			i;
+
+	for (i = 0; i < SyncRepNumWakeupProcs; i++)
+		SetLatch(&SyncRepWakeupProcs[i]->procLatch);
+	SyncRepNumWakeupProcs = 0;
+}
+
 /*
  * The checkpointer calls this as needed to update the shared
  * sync_standbys_defined flag, so that backends don't remain permanently wedged
@@ -1215,6 +1295,8 @@ SyncRepUpdateSyncStandbysDefined(void)
 
 	if (sync_standbys_defined != WalSndCtl->sync_standbys_defined)
 	{
+		SyncRepPrepareWakeups();
+
 		LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
 
 		/*
@@ -1240,6 +1322,8 @@ SyncRepUpdateSyncStandbysDefined(void)
 		WalSndCtl->sync_standbys_defined = sync_standbys_defined;
 
 		LWLockRelease(SyncRepLock);
+
+		SyncRepSetWakeupLatches();
 	}
 }
 
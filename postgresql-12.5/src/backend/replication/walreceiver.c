@@ -60,6 +60,7 @@
 #include "pgstat.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/pmsignal.h"
 #include "storage/procarray.h"
@@ -92,6 +93,16 @@ static TimeLineID recvFileTLI = 0;
 static XLogSegNo recvSegNo = 0;
 static uint32 recvOff = 0;
 
+/*
+ * Offset in recvFile up to which we have asked the kernel to start writeback
+ * of what we wrote.  Doing that every WALRCV_WRITEBACK_AFTER bytes keeps the
+ * fsync in XLogWalRcvFlush() short, so that receiving more WAL from the
+ * network isn't held up for long while it runs.
+ */
+static uint32 recvWritebackOff = 0;
+
+#define WALRCV_WRITEBACK_AFTER	(256 * 1024)
+
 /*
  * Flags set by interrupt handlers of walreceiver for later service in the
  * main loop.
@@ -949,6 +960,7 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 			recvFile = XLogFileInit(recvSegNo, &use_existent, true);
 			recvFileTLI = ThisTimeLineID;
 			recvOff = 0;
+			recvWritebackOff = 0;
 		}
 
 		/* Calculate the start offset of the received logs */
@@ -969,6 +981,7 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 								XLogFileNameP(recvFileTLI, recvSegNo),
 								startoff)));
 			recvOff = startoff;
+			recvWritebackOff = startoff;
 		}
 
 		/* OK to write the logs */
@@ -996,7 +1009,18 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 		buf += byteswritten;
 
 		LogstreamResult.Write = recptr;
+
+		/* Start writeback of what we've written, without waiting for it. */
+		if (recvOff - recvWritebackOff >= WALRCV_WRITEBACK_AFTER)
+		{
+			pg_flush_data(recvFile, recvWritebackOff,
+						  recvOff - recvWritebackOff);
+			recvWritebackOff = recvOff;
+		}
 	}
+
+	/* Let others know how far we've written, flushed or not. */
+	pg_atomic_write_u64(&WalRcv->writtenUpto, LogstreamResult.Write);
 }
 
 /*
@@ -1356,6 +1380,7 @@ pg_stat_get_wal_receiver(PG_FUNCTION_ARGS)
 	WalRcvState state;
 	XLogRecPtr	receive_start_lsn;
 	TimeLineID	receive_start_tli;
+	XLogRecPtr	written_lsn;
 	XLogRecPtr	received_lsn;
 	TimeLineID	received_tli;
 	TimestampTz last_send_time;
@@ -1386,6 +1411,9 @@ pg_stat_get_wal_receiver(PG_FUNCTION_ARGS)
 	strlcpy(conninfo, (char *) WalRcv->conninfo, sizeof(conninfo));
 	SpinLockRelease(&WalRcv->mutex);
 
+	/* writtenUpto is not protected by the mutex */
+	written_lsn = pg_atomic_read_u64(&WalRcv->writtenUpto);
+
 	/*
 	 * No WAL receiver (or not ready yet), just return a tuple with NULL
 	 * values
@@ -1421,43 +1449,47 @@ pg_stat_get_wal_receiver(PG_FUNCTION_ARGS)
 		else
 			values[2] = LSNGetDatum(receive_start_lsn);
 		values[3] = Int32GetDatum(receive_start_tli);
-		if (XLogRecPtrIsInvalid(received_lsn))
+		if (XLogRecPtrIsInvalid(written_lsn))
 			nulls[4] = true;
 		else
-			values[4] = LSNGetDatum(received_lsn);
-		values[5] = Int32GetDatum(received_tli);
+			values[4] = LSNGetDatum(written_lsn);
+		if (XLogRecPtrIsInvalid(received_lsn))
+			nulls[5] = true;
+		else
+			values[5] = LSNGetDatum(received_lsn);
+		values[6] = Int32GetDatum(received_tli);
 		if (last_send_time == 0)
-			nulls[6] = true;
+			nulls[7] = true;
 		else
-			values[6] = TimestampTzGetDatum(last_send_time);
+			values[7] = TimestampTzGetDatum(last_send_time);
 		if (last_receipt_time == 0)
-			nulls[7] = true;
+			nulls[8] = true;
 		else
-			values[7] = TimestampTzGetDatum(last_receipt_time);
+			values[8] = TimestampTzGetDatum(last_receipt_time);
 		if (XLogRecPtrIsInvalid(latest_end_lsn))
-			nulls[8] = true;
+			nulls[9] = true;
 		else
-			values[8] = LSNGetDatum(latest_end_lsn);
+			values[9] = LSNGetDatum(latest_end_lsn);
 		if (latest_end_time == 0)
-			nulls[9] = true;
+			nulls[10] = true;
 		else
-			values[9] = TimestampTzGetDatum(latest_end_time);
+			values[10] = TimestampTzGetDatum(latest_end_time);
 		if (*slotname == '\0')
-			nulls[10] = true;
+			nulls[11] = true;
 		else
-			values[10] = CStringGetTextDatum(slotname);
+			values[11] = CStringGetTextDatum(slotname);
 		if (*sender_host == '\0')
-			nulls[11] = true;
+			nulls[12] = true;
 		else
-			values[11] = CStringGetTextDatum(sender_host);
+			values[12] = CStringGetTextDatum(sender_host);
 		if (sender_port == 0)
-			nulls[12] = true;
+			nulls[13] = true;
 		else
-			values[12] = Int32GetDatum(sender_port);
+			values[13] = Int32GetDatum(sender_port);
 		if (*conninfo == '\0')
-			nulls[13] = true;
+			nulls[14] = true;
 		else
-			values[13] = CStringGetTextDatum(conninfo);
+			values[14] = CStringGetTextDatum(conninfo);
 	}
 
 	/* Returns the record as Datum */
@@ -246,6 +246,7 @@ static void ProcessStandbyHSFeedbackMessage(void);
 static void ProcessRepliesIfAny(void);
 static void WalSndKeepalive(bool requestReply);
 static void WalSndKeepaliveIfNecessary(void);
+static void WalSndUpdateSpillStats(ReorderBuffer *rb);
 static void WalSndCheckTimeOut(void);
 static long WalSndComputeSleeptime(TimestampTz now);
 static void WalSndPrepareWrite(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid, bool last_write);
@@ -767,6 +768,7 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 {
 	XLogRecPtr	flushptr;
 	int			count;
+	Size		nbuffered;
 
 	XLogReadDetermineTimeline(state, targetPagePtr, reqLen);
 	sendTimeLineIsHistoric = (state->currTLI != ThisTimeLineID);
@@ -786,8 +788,23 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	else
 		count = flushptr - targetPagePtr;	/* part of the page available */
 
-	/* now actually read the data, we know it's there */
-	XLogRead(cur_page, targetPagePtr, XLOG_BLCKSZ);
+	/*
+	 * Now actually read the data, we know it's there.  Recent WAL is usually
+	 * still in the WAL buffers, so with many logical slots being decoded, a
+	 * single copy of it in shared memory serves all their walsenders.
+	 */
+	nbuffered = 0;
+	if (!sendTimeLineIsHistoric)
+		nbuffered = XLogReadFromBuffers(cur_page, targetPagePtr, count,
+										sendTimeLine);
+	if (nbuffered == count)
+	{
+		/* zero-pad like an incomplete page read from a file would be */
+		memset(cur_page + count, 0, XLOG_BLCKSZ - count);
+	}
+	else
+		XLogRead(cur_page + nbuffered, targetPagePtr + nbuffered,
+				 XLOG_BLCKSZ - nbuffered);
 
 	return count;
 }
@@ -2320,6 +2337,9 @@ InitWalSenderSlot(void)
 			walsnd->sync_standby_priority = 0;
 			walsnd->latch = &MyProc->procLatch;
 			walsnd->replyTime = 0;
+			walsnd->spillTxns = 0;
+			walsnd->spillCount = 0;
+			walsnd->spillBytes = 0;
 			SpinLockRelease(&walsnd->mutex);
 			/* don't need the lock anymore */
 			MyWalSnd = (WalSnd *) walsnd;
@@ -2553,6 +2573,7 @@ XLogSendPhysical(void)
 	XLogRecPtr	startptr;
 	XLogRecPtr	endptr;
 	Size		nbytes;
+	Size		nbuffered;
 
 	/* If requested switch the WAL sender to the stopping state. */
 	if (got_STOPPING)
@@ -2765,10 +2786,18 @@ XLogSendPhysical(void)
 
 	/*
 	 * Read the log directly into the output buffer to avoid extra memcpy
-	 * calls.
+	 * calls.  Recently flushed WAL is often still in the WAL buffers, which
+	 * spares every walsender reading the same data back from the WAL files;
+	 * copy what we can from there, and read the rest from the files.
 	 */
 	enlargeStringInfo(&output_message, nbytes);
-	XLogRead(&output_message.data[output_message.len], startptr, nbytes);
+	nbuffered = 0;
+	if (!sendTimeLineIsHistoric)
+		nbuffered = XLogReadFromBuffers(&output_message.data[output_message.len],
+										startptr, nbytes, sendTimeLine);
+	if (nbuffered < nbytes)
+		XLogRead(&output_message.data[output_message.len + nbuffered],
+				 startptr + nbuffered, nbytes - nbuffered);
 	output_message.len += nbytes;
 	output_message.data[output_message.len] = '\0';
 
@@ -2848,6 +2877,8 @@ XLogSendLogical(void)
 		LogicalDecodingProcessRecord(logical_decoding_ctx, logical_decoding_ctx->reader);
 
 		sentPtr = logical_decoding_ctx->reader->EndRecPtr;
+
+		WalSndUpdateSpillStats(logical_decoding_ctx->reorder);
 	}
 
 	/*
@@ -3061,7 +3092,10 @@ WalSndShmemInit(void)
 		MemSet(WalSndCtl, 0, WalSndShmemSize());
 
 		for (i = 0; i < NUM_SYNC_REP_WAIT_MODE; i++)
+		{
 			SHMQueueInit(&(WalSndCtl->SyncRepQueue[i]));
+			pg_atomic_init_u64(&WalSndCtl->lsn[i], InvalidXLogRecPtr);
+		}
 
 		for (i = 0; i < max_wal_senders; i++)
 		{
@@ -3228,7 +3262,7 @@ offset_to_interval(TimeOffset offset)
 Datum
 pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_WAL_SENDERS_COLS	12
+#define PG_STAT_GET_WAL_SENDERS_COLS	15
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	TupleDesc	tupdesc;
 	Tuplestorestate *tupstore;
@@ -3283,6 +3317,9 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 		int			pid;
 		WalSndState state;
 		TimestampTz replyTime;
+		int64		spillTxns;
+		int64		spillCount;
+		int64		spillBytes;
 		bool		is_sync_standby;
 		Datum		values[PG_STAT_GET_WAL_SENDERS_COLS];
 		bool		nulls[PG_STAT_GET_WAL_SENDERS_COLS];
@@ -3306,6 +3343,9 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 		applyLag = walsnd->applyLag;
 		priority = walsnd->sync_standby_priority;
 		replyTime = walsnd->replyTime;
+		spillTxns = walsnd->spillTxns;
+		spillCount = walsnd->spillCount;
+		spillBytes = walsnd->spillBytes;
 		SpinLockRelease(&walsnd->mutex);
 
 		/*
@@ -3403,6 +3443,11 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 				nulls[11] = true;
 			else
 				values[11] = TimestampTzGetDatum(replyTime);
+
+			/* spill to disk */
+			values[12] = Int64GetDatum(spillTxns);
+			values[13] = Int64GetDatum(spillCount);
+			values[14] = Int64GetDatum(spillBytes);
 		}
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
@@ -3414,6 +3459,26 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Publish the reorder buffer's spill statistics in shared memory, if they
+ * have changed.  We're the only one writing them, so we can compare without
+ * taking the spinlock.
+ */
+static void
+WalSndUpdateSpillStats(ReorderBuffer *rb)
+{
+	WalSnd	   *walsnd = MyWalSnd;
+
+	if (rb->spillCount == walsnd->spillCount)
+		return;
+
+	SpinLockAcquire(&walsnd->mutex);
+	walsnd->spillTxns = rb->spillTxns;
+	walsnd->spillCount = rb->spillCount;
+	walsnd->spillBytes = rb->spillBytes;
+	SpinLockRelease(&walsnd->mutex);
+}
+
 /*
  * Send a keepalive message to standby.
  *
@@ -1201,6 +1201,270 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 	return sel;
 }
 
+/*
+ * examine_join_equality
+ *		Check whether a join clause is "rel1.col = rel2.col" between two
+ *		plain relations that have extended statistics.
+ *
+ * On success returns true and the two Vars, ordered so that *var1 belongs
+ * to the relation with the lower range table index.
+ */
+static bool
+examine_join_equality(PlannerInfo *root, Node *clause, Var **var1, Var **var2)
+{
+	RestrictInfo *rinfo;
+	OpExpr	   *expr;
+	Node	   *leftop,
+			   *rightop;
+	Var		   *lvar,
+			   *rvar;
+	int			i;
+
+	if (!IsA(clause, RestrictInfo))
+		return false;
+
+	rinfo = (RestrictInfo *) clause;
+	if (rinfo->pseudoconstant || !is_opclause(rinfo->clause))
+		return false;
+
+	expr = (OpExpr *) rinfo->clause;
+	if (list_length(expr->args) != 2 ||
+		get_oprjoin(expr->opno) != F_EQJOINSEL)
+		return false;
+
+	leftop = linitial(expr->args);
+	rightop = lsecond(expr->args);
+
+	/* strip RelabelType from either side of the expression */
+	if (IsA(leftop, RelabelType))
+		leftop = (Node *) ((RelabelType *) leftop)->arg;
+
+	if (IsA(rightop, RelabelType))
+		rightop = (Node *) ((RelabelType *) rightop)->arg;
+
+	if (!IsA(leftop, Var) || !IsA(rightop, Var))
+		return false;
+
+	lvar = (Var *) leftop;
+	rvar = (Var *) rightop;
+
+	if (lvar->varlevelsup != 0 || rvar->varlevelsup != 0 ||
+		lvar->varno == rvar->varno ||
+		!AttrNumberIsForUserDefinedAttr(lvar->varattno) ||
+		!AttrNumberIsForUserDefinedAttr(rvar->varattno))
+		return false;
+
+	/* both sides must be base relations with some extended statistics */
+	for (i = 0; i < 2; i++)
+	{
+		Index		varno = (i == 0) ? lvar->varno : rvar->varno;
+		RelOptInfo *rel;
+
+		if (varno >= root->simple_rel_array_size)
+			return false;
+		rel = root->simple_rel_array[varno];
+		if (rel == NULL || rel->rtekind != RTE_RELATION ||
+			rel->statlist == NIL)
+			return false;
+	}
+
+	if (lvar->varno < rvar->varno)
+	{
+		*var1 = lvar;
+		*var2 = rvar;
+	}
+	else
+	{
+		*var1 = rvar;
+		*var2 = lvar;
+	}
+
+	return true;
+}
+
+/*
+ * join_ndistinct_for_attnums
+ *		Look up the number of distinct combinations of the given columns of
+ *		a relation in its ndistinct statistics.  Returns 0 if none apply.
+ */
+static double
+join_ndistinct_for_attnums(RelOptInfo *rel, Bitmapset *attnums)
+{
+	ListCell   *lc;
+	StatisticExtInfo *best = NULL;
+	MVNDistinct *ndistinct;
+	double		nd = 0.0;
+	int			i;
+
+	/* use the narrowest ndistinct object covering all the columns */
+	foreach(lc, rel->statlist)
+	{
+		StatisticExtInfo *info = (StatisticExtInfo *) lfirst(lc);
+
+		if (info->kind != STATS_EXT_NDISTINCT ||
+			!bms_is_subset(attnums, info->keys))
+			continue;
+
+		if (best == NULL ||
+			bms_num_members(info->keys) < bms_num_members(best->keys))
+			best = info;
+	}
+
+	if (best == NULL)
+		return 0.0;
+
+	ndistinct = statext_ndistinct_load(best->statOid);
+	if (ndistinct == NULL)
+		return 0.0;
+
+	for (i = 0; i < ndistinct->nitems; i++)
+	{
+		MVNDistinctItem *item = &ndistinct->items[i];
+
+		if (bms_subset_compare(item->attrs, attnums) == BMS_EQUAL)
+		{
+			nd = item->ndistinct;
+			break;
+		}
+	}
+
+	/* clamp to the relation size, as estimate_num_groups does */
+	if (rel->tuples > 0 && nd > rel->tuples)
+		nd = rel->tuples;
+
+	return nd;
+}
+
+/*
+ * statext_join_clauselist_selectivity
+ *		Estimate multi-column equijoins using ndistinct statistics.
+ *
+ * For "a.x = b.x AND a.y = b.y", multiplying the per-clause estimates
+ * assumes x and y are independent, which badly underestimates the join
+ * size when they are correlated.  If both relations have ndistinct
+ * statistics covering the join columns, estimate the whole group of clauses
+ * the same way eqjoinsel does for a single column without MCVs, as
+ * 1 / max(ndistinct(a.x, a.y), ndistinct(b.x, b.y)).
+ *
+ * Only the relation pair with the most such clauses is handled.  Clauses
+ * estimated here are added to *estimatedclauses.
+ */
+Selectivity
+statext_join_clauselist_selectivity(PlannerInfo *root, List *clauses,
+									JoinType jointype,
+									SpecialJoinInfo *sjinfo,
+									Bitmapset **estimatedclauses)
+{
+	int			nclauses = list_length(clauses);
+	Var		  **vars1;
+	Var		  **vars2;
+	Bitmapset  *attnums1 = NULL;
+	Bitmapset  *attnums2 = NULL;
+	Index		best1 = 0,
+				best2 = 0;
+	int			best_count = 1;
+	int			ncompatible = 0;
+	int			listidx;
+	ListCell   *l;
+	double		nd1,
+				nd2;
+	Selectivity sel;
+
+	/* semi- and antijoins are not simple functions of the join ndistinct */
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_FULL)
+		return 1.0;
+
+	vars1 = (Var **) palloc0(sizeof(Var *) * nclauses);
+	vars2 = (Var **) palloc0(sizeof(Var *) * nclauses);
+
+	listidx = 0;
+	foreach(l, clauses)
+	{
+		if (!bms_is_member(listidx, *estimatedclauses) &&
+			examine_join_equality(root, (Node *) lfirst(l),
+								  &vars1[listidx], &vars2[listidx]))
+			ncompatible++;
+		listidx++;
+	}
+
+	if (ncompatible < 2)
+		goto done;
+
+	/* pick the pair of relations joined by the most compatible clauses */
+	for (listidx = 0; listidx < nclauses; listidx++)
+	{
+		int			count = 0;
+		int			i;
+
+		if (vars1[listidx] == NULL)
+			continue;
+
+		for (i = listidx; i < nclauses; i++)
+		{
+			if (vars1[i] != NULL &&
+				vars1[i]->varno == vars1[listidx]->varno &&
+				vars2[i]->varno == vars2[listidx]->varno)
+				count++;
+		}
+
+		if (count > best_count)
+		{
+			best1 = vars1[listidx]->varno;
+			best2 = vars2[listidx]->varno;
+			best_count = count;
+		}
+	}
+
+	if (best_count < 2)
+		goto done;
+
+	for (listidx = 0; listidx < nclauses; listidx++)
+	{
+		if (vars1[listidx] == NULL ||
+			vars1[listidx]->varno != best1 ||
+			vars2[listidx]->varno != best2)
+			continue;
+
+		attnums1 = bms_add_member(attnums1, vars1[listidx]->varattno);
+		attnums2 = bms_add_member(attnums2, vars2[listidx]->varattno);
+	}
+
+	/*
+	 * A column joined to several columns of the other side doesn't fit the
+	 * model; leave those cases to the per-clause estimates.
+	 */
+	if (bms_num_members(attnums1) != best_count ||
+		bms_num_members(attnums2) != best_count)
+		goto done;
+
+	nd1 = join_ndistinct_for_attnums(root->simple_rel_array[best1], attnums1);
+	nd2 = join_ndistinct_for_attnums(root->simple_rel_array[best2], attnums2);
+
+	if (nd1 < 1.0 || nd2 < 1.0)
+		goto done;
+
+	for (listidx = 0; listidx < nclauses; listidx++)
+	{
+		if (vars1[listidx] != NULL &&
+			vars1[listidx]->varno == best1 &&
+			vars2[listidx]->varno == best2)
+			*estimatedclauses = bms_add_member(*estimatedclauses, listidx);
+	}
+
+	sel = 1.0 / Max(nd1, nd2);
+	CLAMP_PROBABILITY(sel);
+
+	pfree(vars1);
+	pfree(vars2);
+	return sel;
+
+done:
+	pfree(vars1);
+	pfree(vars2);
+	return 1.0;
+}
+
 /*
  * examine_operator_expression
  *		Split expression into Var and Const parts.
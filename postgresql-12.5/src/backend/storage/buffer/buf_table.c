@@ -7,7 +7,21 @@
  * must hold a suitable lock on the appropriate BufMappingLock, as specified
  * in the comments.  We can't do the locking inside these functions because
  * in most cases the caller needs to adjust the buffer header contents
- * before the lock is released (see notes in README).
+ * before the lock is released (see notes in README).  BufTableLookup can
+ * also be used without any lock, as a hint to be verified by the caller.
+ *
+ * The table is an open-addressing hash table with linear probing, divided
+ * into one region per buffer mapping partition, so that all the slots a
+ * given partition's tags can occupy are modified only by holders of that
+ * partition's exclusive lock.  A slot holds just the tag's hash code and the
+ * buffer ID; the tag itself is taken from the buffer header.  That works
+ * because a buffer's tag is only changed while holding exclusive lock on the
+ * partition of its old tag, and a new mapping is inserted only while holding
+ * exclusive lock on the partition of the new tag, until the buffer header has
+ * been updated.  So under a partition's lock, the buffer of each of its
+ * entries carries that entry's tag, except transiently within one backend's
+ * BufferAlloc or InvalidateBuffer.  Deletion moves later entries of a probe
+ * sequence back instead of leaving tombstones, so the table never degrades.
  *
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
@@ -21,19 +35,57 @@
  */
 #include "postgres.h"
 
+#include "port/atomics.h"
 #include "storage/bufmgr.h"
 #include "storage/buf_internals.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
 
 
-/* entry for buffer lookup hashtable */
+/* slot of the buffer lookup table; buf_id is -1 for an empty slot */
 typedef struct
 {
-	BufferTag	key;			/* Tag of a disk page */
-	int			id;				/* Associated buffer ID */
-} BufferLookupEnt;
+	uint32		hashcode;		/* Hash code of the tag of a disk page */
+	int			buf_id;			/* Associated buffer ID */
+} BufferLookupSlot;
+
+/*
+ * Each partition's region has at least this many slots, and is sized so
+ * that it's at most half full with an even spread of entries.  Together
+ * that makes it vanishingly unlikely that any region ever fills up.
+ */
+#define BUF_TABLE_MIN_PARTITION_SLOTS	256
+
+static BufferLookupSlot *SharedBufTable;
+
+/* Number of slots in each partition's region; a power of 2 */
+static uint32 BufTablePartitionSlots;
+
+/* First slot of the given partition's region */
+#define BufTablePartitionBase(partition) \
+	(&SharedBufTable[(Size) (partition) * BufTablePartitionSlots])
+
+/* Slot of a hash code's region to start probing at */
+#define BufTableHomeSlot(hashcode) \
+	(((hashcode) / NUM_BUFFER_PARTITIONS) & (BufTablePartitionSlots - 1))
+
+
+/*
+ * Compute the number of slots in each partition's region, for a table of the
+ * given size
+ */
+static uint32
+BufTableSlotsPerPartition(int size)
+{
+	uint32		nslots = BUF_TABLE_MIN_PARTITION_SLOTS;
+	uint32		perpart;
 
-static HTAB *SharedBufHash;
+	perpart = (size + NUM_BUFFER_PARTITIONS - 1) / NUM_BUFFER_PARTITIONS;
+	while (nslots < (Size) perpart * 2)
+		nslots <<= 1;
 
+	return nslots;
+}
 
 /*
  * Estimate space needed for mapping hashtable
@@ -42,7 +94,9 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	return mul_size(mul_size(BufTableSlotsPerPartition(size),
+							 NUM_BUFFER_PARTITIONS),
+					sizeof(BufferLookupSlot));
 }
 
 /*
@@ -52,19 +106,28 @@ BufTableShmemSize(int size)
 void
 InitBufTable(int size)
 {
-	HASHCTL		info;
+	bool		found;
+	Size		nslots;
+	Size		i;
 
 	/* assume no locking is needed yet */
 
-	/* BufferTag maps to Buffer */
-	info.keysize = sizeof(BufferTag);
-	info.entrysize = sizeof(BufferLookupEnt);
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	BufTablePartitionSlots = BufTableSlotsPerPartition(size);
+	nslots = (Size) BufTablePartitionSlots * NUM_BUFFER_PARTITIONS;
+
+	SharedBufTable = (BufferLookupSlot *)
+		ShmemInitStruct("Shared Buffer Lookup Table",
+						nslots * sizeof(BufferLookupSlot),
+						&found);
 
-	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
-								  size, size,
-								  &info,
-								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+	if (!found)
+	{
+		for (i = 0; i < nslots; i++)
+		{
+			SharedBufTable[i].hashcode = 0;
+			SharedBufTable[i].buf_id = -1;
+		}
+	}
 }
 
 /*
@@ -79,7 +142,7 @@ InitBufTable(int size)
 uint32
 BufTableHashCode(BufferTag *tagPtr)
 {
-	return get_hash_value(SharedBufHash, (void *) tagPtr);
+	return tag_hash((void *) tagPtr, sizeof(BufferTag));
 }
 
 /*
@@ -87,23 +150,40 @@ BufTableHashCode(BufferTag *tagPtr)
  *		Lookup the given BufferTag; return buffer ID, or -1 if not found
  *
  * Caller must hold at least share lock on BufMappingLock for tag's partition
+ * for the result to be exact.  Without the lock, concurrent changes to the
+ * table may cause us to miss an entry or to return a buffer that no longer
+ * has, or never had, the given tag; such a result must be verified after
+ * pinning the buffer, and a miss must be retried with the lock held.
  */
 int
 BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 {
-	BufferLookupEnt *result;
+	volatile BufferLookupSlot *base;
+	uint32		slotno;
+	uint32		nprobes;
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_FIND,
-									NULL);
+	base = BufTablePartitionBase(BufTableHashPartition(hashcode));
+	slotno = BufTableHomeSlot(hashcode);
 
-	if (!result)
-		return -1;
+	for (nprobes = 0; nprobes < BufTablePartitionSlots; nprobes++)
+	{
+		int			buf_id = base[slotno].buf_id;
 
-	return result->id;
+		if (buf_id < 0)
+			break;
+
+		if (base[slotno].hashcode == hashcode)
+		{
+			BufferDesc *buf = GetBufferDescriptor(buf_id);
+
+			if (BUFFERTAGS_EQUAL(buf->tag, *tagPtr))
+				return buf_id;
+		}
+
+		slotno = (slotno + 1) & (BufTablePartitionSlots - 1);
+	}
+
+	return -1;
 }
 
 /*
@@ -119,45 +199,108 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 int
 BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 {
-	BufferLookupEnt *result;
-	bool		found;
+	BufferLookupSlot *base;
+	uint32		slotno;
+	uint32		nprobes;
 
 	Assert(buf_id >= 0);		/* -1 is reserved for not-in-table */
 	Assert(tagPtr->blockNum != P_NEW);	/* invalid tag */
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_ENTER,
-									&found);
+	base = BufTablePartitionBase(BufTableHashPartition(hashcode));
+	slotno = BufTableHomeSlot(hashcode);
 
-	if (found)					/* found something already in the table */
-		return result->id;
+	for (nprobes = 0; nprobes < BufTablePartitionSlots; nprobes++)
+	{
+		BufferLookupSlot *slot = &base[slotno];
 
-	result->id = buf_id;
+		if (slot->buf_id < 0)
+		{
+			/*
+			 * Fill in the hash code before the buffer ID, so that lockless
+			 * readers are less likely to see a half-filled slot.  They have
+			 * to cope with that anyway.
+			 */
+			slot->hashcode = hashcode;
+			pg_write_barrier();
+			slot->buf_id = buf_id;
+			return -1;
+		}
 
-	return -1;
+		/* found something already in the table? */
+		if (slot->hashcode == hashcode &&
+			BUFFERTAGS_EQUAL(GetBufferDescriptor(slot->buf_id)->tag, *tagPtr))
+			return slot->buf_id;
+
+		slotno = (slotno + 1) & (BufTablePartitionSlots - 1);
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_OUT_OF_MEMORY),
+			 errmsg("out of shared memory"),
+			 errdetail("Shared buffer lookup table partition %u is full.",
+					   BufTableHashPartition(hashcode))));
+	return -1;					/* keep compiler quiet */
 }
 
 /*
  * BufTableDelete
- *		Delete the hashtable entry for given tag (which must exist)
+ *		Delete the hashtable entry for given tag and buffer ID (which must
+ *		exist)
+ *
+ * The buffer's header may already carry a different tag, so the entry is
+ * identified by its hash code and buffer ID rather than by the tag.
  *
  * Caller must hold exclusive lock on BufMappingLock for tag's partition
  */
 void
-BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
+BufTableDelete(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 {
-	BufferLookupEnt *result;
+	BufferLookupSlot *base;
+	uint32		mask = BufTablePartitionSlots - 1;
+	uint32		slotno;
+	uint32		nextno;
+	uint32		nprobes;
+
+	base = BufTablePartitionBase(BufTableHashPartition(hashcode));
+	slotno = BufTableHomeSlot(hashcode);
+
+	for (nprobes = 0;; nprobes++)
+	{
+		if (nprobes >= BufTablePartitionSlots || base[slotno].buf_id < 0)
+			elog(ERROR, "shared buffer hash table corrupted");
+		if (base[slotno].hashcode == hashcode &&
+			base[slotno].buf_id == buf_id)
+			break;
+		slotno = (slotno + 1) & mask;
+	}
+
+	/*
+	 * Close the gap by moving back any later entry of the run that could not
+	 * otherwise be reached from its home slot, repeating for the gap that
+	 * leaves, until we reach an empty slot.  Lockless readers may miss an
+	 * entry that's being moved, which they have to cope with anyway.
+	 */
+	nextno = slotno;
+	for (;;)
+	{
+		uint32		homeno;
+
+		nextno = (nextno + 1) & mask;
+		if (base[nextno].buf_id < 0)
+			break;
+
+		/* leave the entry alone if its home lies cyclically in (slot, next] */
+		homeno = BufTableHomeSlot(base[nextno].hashcode);
+		if (slotno <= nextno ?
+			(slotno < homeno && homeno <= nextno) :
+			(slotno < homeno || homeno <= nextno))
+			continue;
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_REMOVE,
-									NULL);
+		base[slotno].hashcode = base[nextno].hashcode;
+		pg_write_barrier();
+		base[slotno].buf_id = base[nextno].buf_id;
+		slotno = nextno;
+	}
 
-	if (!result)				/* shouldn't happen */
-		elog(ERROR, "shared buffer hash table corrupted");
+	base[slotno].buf_id = -1;
 }
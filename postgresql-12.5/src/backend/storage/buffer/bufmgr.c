@@ -68,6 +68,13 @@
 
 #define DROP_RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * Up to this many blocks, buffers of a relation being dropped or truncated
+ * are looked up one by one in the buffer mapping table rather than by
+ * scanning all of shared buffers.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD	(uint64) (NBuffers / 32)
+
 typedef struct PrivateRefCountEntry
 {
 	Buffer		buffer;
@@ -111,6 +118,7 @@ int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
 bool		track_io_timing = false;
 int			effective_io_concurrency = 0;
+int			maintenance_io_concurrency = 0;
 
 /*
  * GUC variables about triggering kernel writeback for buffers written; OS
@@ -129,6 +137,14 @@ int			backend_flush_after = 0;
  */
 int			target_prefetch_pages = 0;
 
+/*
+ * local state for latency-targeted vacuum cost accounting: a moving average
+ * of the read and write latency seen by this vacuum process (in usec, or -1
+ * before the first sample), and the fractional cost not yet charged
+ */
+static double VacuumIOLatency = -1;
+static double VacuumIOCostRemainder = 0;
+
 /* local state for StartBufferIO and related functions */
 static BufferDesc *InProgressBuf = NULL;
 static bool IsForInput;
@@ -452,7 +468,14 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   BufferAccessStrategy strategy,
 							   bool *foundPtr);
 static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static inline bool VacuumIOTimingActive(void);
+static void VacuumObserveIOLatency(instr_time io_time);
+static int	VacuumIOCost(int cost);
 static void AtProcExit_Buffers(int code, Datum arg);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+										  ForkNumber forkNum,
+										  BlockNumber nForkBlock,
+										  BlockNumber firstDelBlock);
 static void CheckForBufferLeaks(void);
 static int	rnode_comparator(const void *p1, const void *p2);
 static int	buffertag_comparator(const void *p1, const void *p2);
@@ -518,6 +541,62 @@ ComputeIoConcurrency(int io_concurrency, double *target)
 	return (new_prefetch_pages >= 0.0 && new_prefetch_pages < (double) INT_MAX);
 }
 
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a block of a
+ *		relation that uses shared buffers
+ *
+ * This is the guts of PrefetchBuffer(), exposed for callers such as the
+ * recovery prefetcher that have only an SMgrRelation to work with.  Returns
+ * true if a prefetch was issued, false if the block was found already in
+ * the buffer pool (or prefetching isn't compiled in).
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	int			buf_id;
+
+	Assert(BlockNumberIsValid(blockNum));
+
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node,
+				   forkNum, blockNum);
+
+	/* determine its hash code */
+	newHash = BufTableHashCode(&newTag);
+
+	/*
+	 * See if the block is in the buffer pool already.  We don't bother
+	 * taking the mapping lock: the answer could be stale by the time we act
+	 * on it anyway, and all we risk is an unneeded or missed prefetch.
+	 */
+	buf_id = BufTableLookup(&newTag, newHash);
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		return true;
+	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really
+	 * ideal: the block might be just about to be evicted, which would be
+	 * stupid since we know we are going to need it soon.  But the only easy
+	 * answer is to bump the usage_count, which does not seem like a great
+	 * solution: when the caller does ultimately touch the block, usage_count
+	 * would get bumped again, resulting in too much favoritism for blocks
+	 * that are involved in a prefetch sequence. A real fix would involve
+	 * some additional per-buffer state, and it's not clear that there's
+	 * enough of a problem to justify that.
+	 */
+#endif							/* USE_PREFETCH */
+	return false;
+}
+
 /*
  * PrefetchBuffer -- initiate asynchronous read of a block of a relation
  *
@@ -549,39 +628,8 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	}
 	else
 	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLock	   *newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
-
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
-
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
-
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
-
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
-
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+		/* pass it to the shared buffer version */
+		(void) PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 #endif							/* USE_PREFETCH */
 }
@@ -732,7 +780,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
-		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
+		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, strategy, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
 		else if (isExtend)
@@ -891,18 +939,24 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		{
 			instr_time	io_start,
 						io_time;
+			bool		vacuum_timing = VacuumIOTimingActive();
 
-			if (track_io_timing)
+			if (track_io_timing || vacuum_timing)
 				INSTR_TIME_SET_CURRENT(io_start);
 
 			smgrread(smgr, forkNum, blockNum, (char *) bufBlock);
 
-			if (track_io_timing)
+			if (track_io_timing || vacuum_timing)
 			{
 				INSTR_TIME_SET_CURRENT(io_time);
 				INSTR_TIME_SUBTRACT(io_time, io_start);
-				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
-				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+				if (track_io_timing)
+				{
+					pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+					INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+				}
+				if (vacuum_timing)
+					VacuumObserveIOLatency(io_time);
 			}
 
 			/* check for garbage data */
@@ -960,7 +1014,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	VacuumPageMiss++;
 	if (VacuumCostActive)
-		VacuumCostBalance += VacuumCostPageMiss;
+		VacuumCostBalance += VacuumIOCost(VacuumCostPageMiss);
 
 	TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum,
 									  smgr->smgr_rnode.node.spcNode,
@@ -1017,6 +1071,38 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/*
+	 * First try to find the buffer without taking the mapping lock.  This is
+	 * safe because we verify the candidate after pinning it: once we hold a
+	 * pin, nobody can change the buffer's tag (that requires the header
+	 * lock and a refcount of just the changer's own pin), so if it still
+	 * carries our tag, it's the buffer the block is mapped to, exactly as if
+	 * we had looked it up under the lock.  If the lockless lookup comes up
+	 * empty or the check fails, fall back to a regular locked lookup.
+	 */
+	buf_id = BufTableLookup(&newTag, newHash);
+	if (buf_id >= 0)
+	{
+		buf = GetBufferDescriptor(buf_id);
+
+		valid = PinBuffer(buf, strategy);
+
+		if ((pg_atomic_read_u32(&buf->state) & BM_TAG_VALID) &&
+			BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			*foundPtr = true;
+
+			/* see comments in the locked case below */
+			if (!valid && StartBufferIO(buf, true))
+				*foundPtr = false;
+
+			return buf;
+		}
+
+		/* Not the buffer we want after all */
+		UnpinBuffer(buf, true);
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
@@ -1286,7 +1372,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			break;
 
 		UnlockBufHdr(buf, buf_state);
-		BufTableDelete(&newTag, newHash);
+		BufTableDelete(&newTag, newHash, buf->buf_id);
 		if (oldPartitionLock != NULL &&
 			oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
@@ -1320,7 +1406,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (oldPartitionLock != NULL)
 	{
-		BufTableDelete(&oldTag, oldHash);
+		BufTableDelete(&oldTag, oldHash, buf->buf_id);
 		if (oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
 	}
@@ -1433,7 +1519,7 @@ retry:
 	 * Remove the buffer from the lookup hashtable, if it was in there.
 	 */
 	if (oldFlags & BM_TAG_VALID)
-		BufTableDelete(&oldTag, oldHash);
+		BufTableDelete(&oldTag, oldHash, buf->buf_id);
 
 	/*
 	 * Done with mapping lock.
@@ -1501,7 +1587,7 @@ MarkBufferDirty(Buffer buffer)
 		VacuumPageDirty++;
 		pgBufferUsage.shared_blks_dirtied++;
 		if (VacuumCostActive)
-			VacuumCostBalance += VacuumCostPageDirty;
+			VacuumCostBalance += VacuumIOCost(VacuumCostPageDirty);
 	}
 }
 
@@ -2089,6 +2175,8 @@ BgBufferSync(WritebackContext *wb_context)
 	int			num_to_scan;
 	int			num_written;
 	int			reusable_buffers;
+	int			clean_listed;
+	int			clean_target;
 
 	/* Variables for final smoothed_density update */
 	long		new_strategy_delta;
@@ -2259,6 +2347,19 @@ BgBufferSync(WritebackContext *wb_context)
 		upcoming_alloc_est = min_scan_buffers + reusable_buffers_est;
 	}
 
+	/*
+	 * Reusable buffers we find are also put on the clean lists, from which
+	 * StrategyGetBuffer takes them before resorting to the clock sweep, so
+	 * that backends find a clean victim without having to write one
+	 * themselves.  Aim to have the next cycle's estimated allocations
+	 * waiting there, as far as the lists have room.  Backends may have
+	 * drained them since last time even if the clock hands haven't caught up
+	 * with us, so this can make us scan further ahead than the estimate of
+	 * reusable buffers alone would.
+	 */
+	clean_listed = StrategyCleanBufferCount(&clean_target);
+	clean_target = Min(clean_target, upcoming_alloc_est);
+
 	/*
 	 * Now write out dirty reusable buffers, working forward from the
 	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
@@ -2274,10 +2375,16 @@ BgBufferSync(WritebackContext *wb_context)
 	reusable_buffers = reusable_buffers_est;
 
 	/* Execute the LRU scan */
-	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
+	while (num_to_scan > 0 &&
+		   (reusable_buffers < upcoming_alloc_est ||
+			clean_listed < clean_target))
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		int			buf_id = next_to_clean;
+		int			sync_state = SyncOneBuffer(buf_id, true, wb_context);
+
+		if ((sync_state & BUF_REUSABLE) && clean_listed < clean_target &&
+			StrategyPutCleanBuffer(buf_id))
+			clean_listed++;
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -2461,15 +2568,17 @@ InitBufferPoolAccess(void)
  * InitBufferPoolBackend --- second-stage initialization of a new backend
  *
  * This is called after we have acquired a PGPROC and so can safely get
- * LWLocks.  We don't currently need to do anything at this stage ...
- * except register a shmem-exit callback.  AtProcExit_Buffers needs LWLock
- * access, and thereby has to be called at the corresponding phase of
- * backend shutdown.
+ * LWLocks.  We register a shmem-exit callback, since AtProcExit_Buffers
+ * needs LWLock access, and thereby has to be called at the corresponding
+ * phase of backend shutdown.  We also let freelist.c bind us to a NUMA node,
+ * now that we have a pgprocno to choose one by.
  */
 void
 InitBufferPoolBackend(void)
 {
 	on_shmem_exit(AtProcExit_Buffers, 0);
+
+	StrategyInitBackend();
 }
 
 /*
@@ -2651,6 +2760,58 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
 	*blknum = bufHdr->tag.blockNum;
 }
 
+/*
+ * VacuumIOTimingActive -- should this I/O be timed for vacuum cost purposes?
+ */
+static inline bool
+VacuumIOTimingActive(void)
+{
+	return VacuumCostActive && VacuumCostIOTarget > 0;
+}
+
+/*
+ * VacuumObserveIOLatency -- fold one read or write time into the average
+ */
+static void
+VacuumObserveIOLatency(instr_time io_time)
+{
+	double		sample = INSTR_TIME_GET_MICROSEC(io_time);
+
+	if (VacuumIOLatency < 0)
+		VacuumIOLatency = sample;
+	else
+		VacuumIOLatency = 0.9 * VacuumIOLatency + 0.1 * sample;
+}
+
+/*
+ * VacuumIOCost -- the vacuum cost to charge for a page miss or dirtied page
+ *
+ * Normally that is just the configured page cost.  With vacuum_cost_io_target
+ * set, the cost is scaled by how the recently observed I/O latency compares
+ * to the target: on an idle, fast device the charge shrinks and vacuum runs
+ * with fewer pauses, and once foreground load drives latency above the
+ * target vacuum pauses more.  Fractions are carried over to later calls.
+ */
+static int
+VacuumIOCost(int cost)
+{
+	double		scaled;
+	int			result;
+
+	if (VacuumCostIOTarget <= 0 || VacuumIOLatency < 0)
+		return cost;
+
+	scaled = cost * VacuumIOLatency / (VacuumCostIOTarget * 1000.0) +
+		VacuumIOCostRemainder;
+	/* don't let a single stall charge more than a whole cost limit */
+	if (scaled > VacuumCostLimit)
+		scaled = VacuumCostLimit;
+	result = (int) scaled;
+	VacuumIOCostRemainder = scaled - result;
+
+	return result;
+}
+
 /*
  * FlushBuffer
  *		Physically write out a shared buffer.
@@ -2680,6 +2841,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	Block		bufBlock;
 	char	   *bufToWrite;
 	uint32		buf_state;
+	bool		vacuum_timing = VacuumIOTimingActive();
 
 	/*
 	 * Acquire the buffer's io_in_progress lock.  If StartBufferIO returns
@@ -2751,7 +2913,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 */
 	bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
 
-	if (track_io_timing)
+	if (track_io_timing || vacuum_timing)
 		INSTR_TIME_SET_CURRENT(io_start);
 
 	/*
@@ -2763,12 +2925,17 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 			  bufToWrite,
 			  false);
 
-	if (track_io_timing)
+	if (track_io_timing || vacuum_timing)
 	{
 		INSTR_TIME_SET_CURRENT(io_time);
 		INSTR_TIME_SUBTRACT(io_time, io_start);
-		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
-		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+		if (track_io_timing)
+		{
+			pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+			INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+		}
+		if (vacuum_timing)
+			VacuumObserveIOLatency(io_time);
 	}
 
 	pgBufferUsage.shared_blks_written++;
@@ -2918,16 +3085,17 @@ BufferGetLSNAtomic(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		For small relations whose size is known, the pages are looked up in
+ *		the buffer mapping table one by one.  Otherwise the whole buffer pool
+ *		is searched sequentially.
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
+DropRelFileNodeBuffers(SMgrRelation smgr_reln, ForkNumber forkNum,
 					   BlockNumber firstDelBlock)
 {
+	RelFileNodeBackend rnode = smgr_reln->smgr_rnode;
+	BlockNumber nForkBlock;
 	int			i;
 
 	/* If it's a local relation, it's localbuf.c's problem. */
@@ -2938,6 +3106,25 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
 		return;
 	}
 
+	/*
+	 * If the size of the fork is cached and only a few blocks are to be
+	 * dropped, look them up individually instead of scanning the whole
+	 * buffer pool.  The cached size can't be too small: it is raised as soon
+	 * as the fork is extended, before any buffer for a new block becomes
+	 * valid.  A buffer can be left tagged with a block beyond the end if
+	 * extending the fork failed, but such a buffer is neither valid nor
+	 * dirty, and anyone who later looks it up will redo its I/O.
+	 */
+	nForkBlock = smgrnblocks_cached(smgr_reln, forkNum);
+	if (nForkBlock != InvalidBlockNumber &&
+		(nForkBlock <= firstDelBlock ||
+		 nForkBlock - firstDelBlock < BUF_DROP_FULL_SCAN_THRESHOLD))
+	{
+		FindAndDropRelFileNodeBuffers(rnode.node, forkNum, nForkBlock,
+									  firstDelBlock);
+		return;
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -2982,28 +3169,33 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
+DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes)
 {
 	int			i,
+				j,
 				n = 0;
+	SMgrRelation *rels;
 	RelFileNode *nodes;
+	BlockNumber (*block)[MAX_FORKNUM + 1];
+	uint64		nBlocksToInvalidate = 0;
+	bool		cached = true;
 	bool		use_bsearch;
 
 	if (nnodes == 0)
 		return;
 
-	nodes = palloc(sizeof(RelFileNode) * nnodes);	/* non-local relations */
+	rels = palloc(sizeof(SMgrRelation) * nnodes);	/* non-local relations */
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	for (i = 0; i < nnodes; i++)
 	{
-		if (RelFileNodeBackendIsTemp(rnodes[i]))
+		if (RelFileNodeBackendIsTemp(smgr_reln[i]->smgr_rnode))
 		{
-			if (rnodes[i].backend == MyBackendId)
-				DropRelFileNodeAllLocalBuffers(rnodes[i].node);
+			if (smgr_reln[i]->smgr_rnode.backend == MyBackendId)
+				DropRelFileNodeAllLocalBuffers(smgr_reln[i]->smgr_rnode.node);
 		}
 		else
-			nodes[n++] = rnodes[i].node;
+			rels[n++] = smgr_reln[i];
 	}
 
 	/*
@@ -3012,10 +3204,61 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	 */
 	if (n == 0)
 	{
-		pfree(nodes);
+		pfree(rels);
+		return;
+	}
+
+	/*
+	 * If the sizes of all forks of all the relations are known and small
+	 * enough in total, look their blocks up individually; see
+	 * DropRelFileNodeBuffers.  A fork that doesn't exist has no buffers.
+	 */
+	block = palloc(sizeof(BlockNumber) * n * (MAX_FORKNUM + 1));
+
+	for (i = 0; i < n && cached; i++)
+	{
+		for (j = 0; j <= MAX_FORKNUM; j++)
+		{
+			block[i][j] = smgrnblocks_cached(rels[i], j);
+
+			if (block[i][j] == InvalidBlockNumber)
+			{
+				if (smgrexists(rels[i], j))
+				{
+					cached = false;
+					break;
+				}
+				block[i][j] = 0;
+			}
+
+			nBlocksToInvalidate += block[i][j];
+		}
+	}
+
+	if (cached && nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	{
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= MAX_FORKNUM; j++)
+			{
+				if (block[i][j] > 0)
+					FindAndDropRelFileNodeBuffers(rels[i]->smgr_rnode.node,
+												  j, block[i][j], 0);
+			}
+		}
+
+		pfree(block);
+		pfree(rels);
 		return;
 	}
 
+	pfree(block);
+
+	nodes = palloc(sizeof(RelFileNode) * n);
+	for (i = 0; i < n; i++)
+		nodes[i] = rels[i]->smgr_rnode.node;
+	pfree(rels);
+
 	/*
 	 * For low number of relations to drop just use a simple walk through, to
 	 * save the bsearch overhead. The threshold to use is rather a guess than
@@ -3073,6 +3316,66 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	pfree(nodes);
 }
 
+/* ---------------------------------------------------------------------
+ *		FindAndDropRelFileNodeBuffers
+ *
+ *		This function performs a lookup in the buffer mapping table for each
+ *		block of the specified fork from firstDelBlock up to nForkBlock, and
+ *		removes the buffers found from the buffer pool.  As in
+ *		DropRelFileNodeBuffers, the caller must make sure no one is loading
+ *		new pages of the relation concurrently.
+ * --------------------------------------------------------------------
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlock; curBlock++)
+	{
+		BufferTag	bufTag;		/* identity of requested block */
+		uint32		bufHash;	/* hash value for tag */
+		LWLock	   *bufPartitionLock;	/* buffer partition lock for it */
+		int			buf_id;
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool. If not, do nothing. */
+		LWLockAcquire(bufPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&bufTag, bufHash);
+		LWLockRelease(bufPartitionLock);
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = GetBufferDescriptor(buf_id);
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for a different
+		 * relation after we release lock on the BufMapping table.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr, buf_state);
+	}
+}
+
 /* ---------------------------------------------------------------------
  *		DropDatabaseBuffers
  *
@@ -3545,7 +3848,7 @@ MarkBufferDirtyHint(Buffer buffer, bool buffer_std)
 			VacuumPageDirty++;
 			pgBufferUsage.shared_blks_dirtied++;
 			if (VacuumCostActive)
-				VacuumCostBalance += VacuumCostPageDirty;
+				VacuumCostBalance += VacuumIOCost(VacuumCostPageDirty);
 		}
 	}
 }
@@ -16,52 +16,143 @@
 #include "postgres.h"
 
 #include "port/atomics.h"
+#include "port/pg_numa.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/proc.h"
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * The clock sweep is split into partitions, each with its own hand, so that
+ * backends looking for a victim at the same time don't all contend on one
+ * atomic counter.  Partition p holds buffers p, p + N, p + 2N, ... (N being
+ * the number of partitions), so if the hands advance at similar rates the
+ * partitions together behave like a single sweep over the whole pool, and
+ * StrategySyncStart can report a single sweep position to the bgwriter.
+ *
+ * We use up to MAX_SWEEP_PARTITIONS partitions, but none smaller than
+ * MIN_SWEEP_PARTITION_SIZE buffers, so small buffer pools keep a single
+ * sweep.
+ *
+ * With numa_shared_buffers = partition, partitions are instead contiguous
+ * ranges of buffers, an equal number per NUMA node, and the memory of each
+ * node's ranges is placed on that node.  Backends then sweep the partitions
+ * of the node they run on, and take free buffers from that node's own
+ * freelist, so the pages they read in are local to them.  The sweep position
+ * reported to the bgwriter is then only approximate.
+ */
+#define MAX_SWEEP_PARTITIONS		16
+#define MIN_SWEEP_PARTITION_SIZE	1024
+
+/* How often a backend not bound to a node checks which node it is on */
+#define NUMA_NODE_RECHECK_INTERVAL	64
 
 /*
- * The shared freelist control information.
+ * Each partition also has a list of clean, reusable buffers, filled by the
+ * bgwriter as it scans ahead of the clock hands and consumed by
+ * StrategyGetBuffer before it sweeps.  The list is a circular array holding
+ * up to 1/CLEAN_LIST_FRACTION of the partition's buffers.
  */
+#define CLEAN_LIST_FRACTION			8
+
 typedef struct
 {
-	/* Spinlock: protects the values below */
-	slock_t		buffer_strategy_lock;
+	/* Spinlock: protects completePasses, and nextVictimBuffer wraparound */
+	slock_t		lock;
 
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Clock sweep hand: index, within this partition, of the next buffer to
+	 * consider grabbing.  Note that this isn't a concrete buffer - we only
+	 * ever increase the value.  So, to get an actual buffer, it needs to be
+	 * used modulo numBuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
-	int			firstFreeBuffer;	/* Head of list of unused buffers */
-	int			lastFreeBuffer; /* Tail of list of unused buffers */
+	uint32		completePasses; /* Complete cycles of this partition */
+	int			numBuffers;		/* Number of buffers in this partition */
+	int			firstBuffer;	/* Buffer id of our first buffer */
+	int			bufferStride;	/* Distance between our buffer ids */
 
 	/*
-	 * NOTE: lastFreeBuffer is undefined when firstFreeBuffer is -1 (that is,
-	 * when the list is empty)
+	 * Buffer allocations by backends sweeping this partition since last
+	 * reset.  Kept per partition for the same reason as the hand.
 	 */
+	pg_atomic_uint32 numBufferAllocs;
+
+	/* Spinlock: protects the clean list fields below */
+	slock_t		cleanLock;
+	int			cleanOffset;	/* start of our slots in CleanBufferIds */
+	int			cleanCapacity;	/* number of slots */
+	int			cleanHead;		/* slot of the oldest entry */
+	int			cleanCount;		/* number of entries */
+} SweepPartition;
+
+/* Pad to cache line size, so that partitions don't share cache lines */
+typedef union SweepPartitionPadded
+{
+	SweepPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} SweepPartitionPadded;
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
+
+	/* Lists of unused buffers, one per NUMA node that partitions the pool */
+	int			firstFreeBuffer[MAX_SWEEP_PARTITIONS];	/* Heads of lists */
+	int			lastFreeBuffer[MAX_SWEEP_PARTITIONS];	/* Tails of lists */
+	int			numFreeLists;
 
 	/*
-	 * Statistics.  These counters should be wide enough that they can't
-	 * overflow during a single bgwriter cycle.
+	 * NOTE: lastFreeBuffer[i] is undefined when firstFreeBuffer[i] is -1
+	 * (that is, when the list is empty)
 	 */
-	uint32		completePasses; /* Complete cycles of the clock sweep */
-	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
 
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/* Number of clock sweep partitions, see above */
+	int			numSweepPartitions;
+
+	/* Buffers per partition if partitioned by NUMA node, else 0 */
+	int			partitionChunk;
+	int			numNumaNodes;	/* nodes the pool is partitioned over */
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
+static SweepPartitionPadded *SweepPartitions = NULL;
+static int *CleanBufferIds = NULL;
+
+/*
+ * The partition this backend sweeps next.  Each backend moves on to the next
+ * partition after every victim it finds, so that all partitions are swept
+ * at about the same rate however backends are spread among them; backends
+ * start at different partitions so that they rarely sweep the same one at
+ * the same time.
+ */
+static int	MySweepPartition = -1;
+
+/*
+ * NUMA node (index into the freelists) whose partitions this backend sweeps,
+ * when the pool is partitioned by node.  It's fixed if the backend is bound
+ * to a node, otherwise rechecked now and then.
+ */
+static int	MyNumaNode = -1;
+static bool MyNumaNodeBound = false;
+static int	MyNumaNodeRecheck = 0;
+
+/* GUC variables */
+int			numa_shared_buffers = NUMA_BUFFERS_OFF;
+bool		numa_bind_backends = false;
 
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
@@ -102,16 +193,23 @@ static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 									 uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 							BufferDesc *buf);
+static int	NumaNodes(void);
+static int	NumSweepPartitions(void);
+static int	SweepPartitionChunk(int nparts);
+static int	SweepPartitionSize(int partno, int nparts);
+static int	CleanListCapacity(int partno, int nparts);
+static int	NumCleanListSlots(void);
 
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the given partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(int partno)
 {
+	SweepPartition *part = &SweepPartitions[partno].part;
 	uint32		victim;
 
 	/*
@@ -120,14 +218,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= part->numBuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % part->numBuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -153,19 +251,35 @@ ClockSweepTick(void)
 				 * could lead to an overflow of nextVictimBuffers, but that's
 				 * highly unlikely and wouldn't be particularly harmful.
 				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+				SpinLockAcquire(&part->lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % part->numBuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+					part->completePasses++;
+				SpinLockRelease(&part->lock);
 			}
 		}
 	}
-	return victim;
+
+	/* Convert index within the partition to a buffer id */
+	return part->firstBuffer + victim * part->bufferStride;
+}
+
+/*
+ * CurrentNumaNode - the freelist, and node's partitions, this backend uses
+ */
+static inline int
+CurrentNumaNode(void)
+{
+	if (!MyNumaNodeBound && --MyNumaNodeRecheck <= 0)
+	{
+		MyNumaNode = pg_numa_current_node() % StrategyControl->numNumaNodes;
+		MyNumaNodeRecheck = NUMA_NODE_RECHECK_INTERVAL;
+	}
+	return MyNumaNode;
 }
 
 /*
@@ -179,10 +293,14 @@ ClockSweepTick(void)
 bool
 have_free_buffer()
 {
-	if (StrategyControl->firstFreeBuffer >= 0)
-		return true;
-	else
-		return false;
+	int			i;
+
+	for (i = 0; i < StrategyControl->numFreeLists; i++)
+	{
+		if (StrategyControl->firstFreeBuffer[i] >= 0)
+			return true;
+	}
+	return false;
 }
 
 /*
@@ -203,6 +321,9 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	BufferDesc *buf;
 	int			bgwprocno;
 	int			trycounter;
+	int			partno;
+	int			partitions_tried;
+	int			freelist = 0;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
 	/*
@@ -242,12 +363,33 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		SetLatch(&ProcGlobal->allProcs[bgwprocno].procLatch);
 	}
 
+	/*
+	 * Pick the clock sweep partition to use, and move on to the next one for
+	 * next time.
+	 */
+	if (MySweepPartition < 0)
+		MySweepPartition = (MyProc != NULL ? MyProc->pgprocno : 0) %
+			StrategyControl->numSweepPartitions;
+	partno = MySweepPartition;
+	if (++MySweepPartition >= StrategyControl->numSweepPartitions)
+		MySweepPartition = 0;
+
+	/* If partitioned by NUMA node, stay within our node's partitions */
+	if (StrategyControl->partitionChunk > 0)
+	{
+		int			per_node = StrategyControl->numSweepPartitions /
+		StrategyControl->numNumaNodes;
+
+		freelist = CurrentNumaNode();
+		partno = freelist * per_node + partno % per_node;
+	}
+
 	/*
 	 * We count buffer allocation requests so that the bgwriter can estimate
 	 * the rate of buffer consumption.  Note that buffers recycled by a
 	 * strategy object are intentionally not counted here.
 	 */
-	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
+	pg_atomic_fetch_add_u32(&SweepPartitions[partno].part.numBufferAllocs, 1);
 
 	/*
 	 * First check, without acquiring the lock, whether there's buffers in the
@@ -265,24 +407,24 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	 * buffer_strategy_lock not the individual buffer spinlocks, so it's OK to
 	 * manipulate them without holding the spinlock.
 	 */
-	if (StrategyControl->firstFreeBuffer >= 0)
+	if (StrategyControl->firstFreeBuffer[freelist] >= 0)
 	{
 		while (true)
 		{
 			/* Acquire the spinlock to remove element from the freelist */
 			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-			if (StrategyControl->firstFreeBuffer < 0)
+			if (StrategyControl->firstFreeBuffer[freelist] < 0)
 			{
 				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 				break;
 			}
 
-			buf = GetBufferDescriptor(StrategyControl->firstFreeBuffer);
+			buf = GetBufferDescriptor(StrategyControl->firstFreeBuffer[freelist]);
 			Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
 
 			/* Unconditionally remove buffer from freelist */
-			StrategyControl->firstFreeBuffer = buf->freeNext;
+			StrategyControl->firstFreeBuffer[freelist] = buf->freeNext;
 			buf->freeNext = FREENEXT_NOT_IN_LIST;
 
 			/*
@@ -312,11 +454,53 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
+	/*
+	 * Next, try the partition's list of buffers the bgwriter has found clean
+	 * and reusable.  As with the freelist, peek without the lock first.  An
+	 * entry may have been used, or dirtied, since the bgwriter listed it; in
+	 * that case just drop it and try the next one.
+	 */
+	while (SweepPartitions[partno].part.cleanCount > 0)
+	{
+		SweepPartition *part = &SweepPartitions[partno].part;
+		int			buf_id;
+
+		SpinLockAcquire(&part->cleanLock);
+		if (part->cleanCount == 0)
+		{
+			SpinLockRelease(&part->cleanLock);
+			break;
+		}
+		buf_id = CleanBufferIds[part->cleanOffset + part->cleanHead];
+		if (++part->cleanHead >= part->cleanCapacity)
+			part->cleanHead = 0;
+		part->cleanCount--;
+		SpinLockRelease(&part->cleanLock);
+
+		buf = GetBufferDescriptor(buf_id);
+		local_buf_state = LockBufHdr(buf);
+		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0 &&
+			BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0 &&
+			!(local_buf_state & BM_DIRTY))
+		{
+			if (strategy != NULL)
+				AddBufferToRing(strategy, buf);
+			*buf_state = local_buf_state;
+			return buf;
+		}
+		UnlockBufHdr(buf, local_buf_state);
+	}
+
+	/*
+	 * Nothing on the freelist or clean list, so run the "clock sweep"
+	 * algorithm over the chosen partition.  If all of its buffers are pinned,
+	 * try the others in turn.
+	 */
+	trycounter = SweepPartitions[partno].part.numBuffers;
+	partitions_tried = 1;
 	for (;;)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		buf = GetBufferDescriptor(ClockSweepTick(partno));
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -330,7 +514,8 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			{
 				local_buf_state -= BUF_USAGECOUNT_ONE;
 
-				trycounter = NBuffers;
+				trycounter = SweepPartitions[partno].part.numBuffers;
+				partitions_tried = 1;
 			}
 			else
 			{
@@ -343,15 +528,26 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		}
 		else if (--trycounter == 0)
 		{
-			/*
-			 * We've scanned all the buffers without making any state changes,
-			 * so all the buffers are pinned (or were when we looked at them).
-			 * We could hope that someone will free one eventually, but it's
-			 * probably better to fail than to risk getting stuck in an
-			 * infinite loop.
-			 */
-			UnlockBufHdr(buf, local_buf_state);
-			elog(ERROR, "no unpinned buffers available");
+			if (partitions_tried < StrategyControl->numSweepPartitions)
+			{
+				/* All pinned in this partition; move on to the next one */
+				if (++partno >= StrategyControl->numSweepPartitions)
+					partno = 0;
+				trycounter = SweepPartitions[partno].part.numBuffers;
+				partitions_tried++;
+			}
+			else
+			{
+				/*
+				 * We've scanned all the buffers without making any state
+				 * changes, so all the buffers are pinned (or were when we
+				 * looked at them).  We could hope that someone will free one
+				 * eventually, but it's probably better to fail than to risk
+				 * getting stuck in an infinite loop.
+				 */
+				UnlockBufHdr(buf, local_buf_state);
+				elog(ERROR, "no unpinned buffers available");
+			}
 		}
 		UnlockBufHdr(buf, local_buf_state);
 	}
@@ -363,6 +559,14 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 void
 StrategyFreeBuffer(BufferDesc *buf)
 {
+	int			freelist = 0;
+
+	/* Partitioned by NUMA node, the buffer goes to its node's list */
+	if (StrategyControl->partitionChunk > 0)
+		freelist = (buf->buf_id / StrategyControl->partitionChunk) /
+			(StrategyControl->numSweepPartitions /
+			 StrategyControl->numNumaNodes);
+
 	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
 	/*
@@ -371,15 +575,76 @@ StrategyFreeBuffer(BufferDesc *buf)
 	 */
 	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
 	{
-		buf->freeNext = StrategyControl->firstFreeBuffer;
+		buf->freeNext = StrategyControl->firstFreeBuffer[freelist];
 		if (buf->freeNext < 0)
-			StrategyControl->lastFreeBuffer = buf->buf_id;
-		StrategyControl->firstFreeBuffer = buf->buf_id;
+			StrategyControl->lastFreeBuffer[freelist] = buf->buf_id;
+		StrategyControl->firstFreeBuffer[freelist] = buf->buf_id;
 	}
 
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * StrategyPutCleanBuffer -- offer a clean, reusable buffer to backends
+ *
+ * Called by the bgwriter for buffers it has found (or made) clean, unpinned
+ * and with zero usage count, ahead of the clock sweep.  The buffer goes on
+ * the clean list of the sweep partition it belongs to.  Returns false if
+ * that list is already full.
+ */
+bool
+StrategyPutCleanBuffer(int buf_id)
+{
+	SweepPartition *part;
+	bool		result = false;
+
+	if (StrategyControl->partitionChunk > 0)
+		part = &SweepPartitions[buf_id / StrategyControl->partitionChunk].part;
+	else
+		part = &SweepPartitions[buf_id % StrategyControl->numSweepPartitions].part;
+
+	SpinLockAcquire(&part->cleanLock);
+	if (part->cleanCount < part->cleanCapacity)
+	{
+		int			slot = part->cleanHead + part->cleanCount;
+
+		if (slot >= part->cleanCapacity)
+			slot -= part->cleanCapacity;
+		CleanBufferIds[part->cleanOffset + slot] = buf_id;
+		part->cleanCount++;
+		result = true;
+	}
+	SpinLockRelease(&part->cleanLock);
+
+	return result;
+}
+
+/*
+ * StrategyCleanBufferCount -- number of buffers on the clean lists
+ *
+ * If capacity isn't NULL, the total size of the clean lists is returned
+ * there.  The count is read without locking, so it's only an estimate.
+ */
+int
+StrategyCleanBufferCount(int *capacity)
+{
+	int			count = 0;
+	int			cap = 0;
+	int			i;
+
+	for (i = 0; i < StrategyControl->numSweepPartitions; i++)
+	{
+		SweepPartition *part = &SweepPartitions[i].part;
+
+		count += part->cleanCount;
+		cap += part->cleanCapacity;
+	}
+
+	if (capacity)
+		*capacity = cap;
+	return count;
+}
+
 /*
  * StrategySyncStart -- tell BufferSync where to start syncing
  *
@@ -390,34 +655,51 @@ StrategyFreeBuffer(BufferDesc *buf)
  * the higher-order bits of nextVictimBuffer) and the count of recent buffer
  * allocs if non-NULL pointers are passed.  The alloc count is reset after
  * being read.
+ *
+ * With several clock sweep partitions, the position reported is that of a
+ * single sweep that has examined as many buffers as all the partitions' hands
+ * together.  Since partitions are interleaved, that's where the hands are in
+ * terms of buffer ids, as long as they advance at similar rates.  When they
+ * are partitioned by NUMA node instead, it's merely a position that advances
+ * at the combined rate of the hands, which is still what the bgwriter needs
+ * to pace itself.
  */
 int
 StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
 {
-	uint32		nextVictimBuffer;
-	int			result;
-
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
+	uint64		totalTicks = 0;
+	uint32		allocs = 0;
+	int			i;
 
-	if (complete_passes)
+	for (i = 0; i < StrategyControl->numSweepPartitions; i++)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		SweepPartition *part = &SweepPartitions[i].part;
+		uint32		nextVictimBuffer;
+		uint32		passes;
+
+		SpinLockAcquire(&part->lock);
+		nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
 
 		/*
-		 * Additionally add the number of wraparounds that happened before
-		 * completePasses could be incremented. C.f. ClockSweepTick().
+		 * Add the number of wraparounds that happened before completePasses
+		 * could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		passes = part->completePasses + nextVictimBuffer / part->numBuffers;
+		totalTicks += (uint64) passes * part->numBuffers +
+			nextVictimBuffer % part->numBuffers;
+
+		if (num_buf_alloc)
+			allocs += pg_atomic_exchange_u32(&part->numBufferAllocs, 0);
+		SpinLockRelease(&part->lock);
 	}
 
+	if (complete_passes)
+		*complete_passes = (uint32) (totalTicks / NBuffers);
+
 	if (num_buf_alloc)
-	{
-		*num_buf_alloc = pg_atomic_exchange_u32(&StrategyControl->numBufferAllocs, 0);
-	}
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
-	return result;
+		*num_buf_alloc = allocs;
+
+	return (int) (totalTicks % NBuffers);
 }
 
 /*
@@ -442,6 +724,90 @@ StrategyNotifyBgWriter(int bgwprocno)
 }
 
 
+/*
+ * StrategyPlaceBuffers -- place the buffer pool's memory on NUMA nodes
+ *
+ * Called by InitBufferPool before the buffer headers are first touched, so
+ * that the kernel allocates their pages according to numa_shared_buffers.
+ * Failure only costs performance, so it's reported as a warning.
+ */
+void
+StrategyPlaceBuffers(void)
+{
+	int			nodes;
+
+	if (numa_shared_buffers == NUMA_BUFFERS_OFF)
+		return;
+
+	nodes = pg_numa_num_nodes();
+	if (nodes <= 1)
+		return;
+
+	if (numa_shared_buffers == NUMA_BUFFERS_INTERLEAVE)
+	{
+		if (!pg_numa_interleave_memory(BufferDescriptors,
+									   NBuffers * sizeof(BufferDescPadded),
+									   nodes) ||
+			!pg_numa_interleave_memory(BufferBlocks,
+									   NBuffers * (Size) BLCKSZ, nodes))
+			ereport(WARNING,
+					(errmsg("could not interleave shared buffers over NUMA nodes: %m")));
+	}
+	else
+	{
+		int			nparts = NumSweepPartitions();
+		int			chunk = SweepPartitionChunk(nparts);
+		int			per_node = nparts / NumaNodes();
+		int			node;
+
+		for (node = 0; node < NumaNodes(); node++)
+		{
+			int			first = node * per_node * chunk;
+			int			nbuffers = Min(per_node * chunk, NBuffers - first);
+
+			if (nbuffers <= 0)
+				break;
+			if (!pg_numa_bind_memory(GetBufferDescriptor(first),
+									 nbuffers * sizeof(BufferDescPadded),
+									 node) ||
+				!pg_numa_bind_memory(BufferBlocks + first * (Size) BLCKSZ,
+									 nbuffers * (Size) BLCKSZ, node))
+			{
+				ereport(WARNING,
+						(errmsg("could not place shared buffers on NUMA node %d: %m",
+								node)));
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * StrategyInitBackend -- per-process setup, called by InitBufferPoolBackend
+ *
+ * If the buffer pool is partitioned by NUMA node and numa_bind_backends is
+ * on, bind this process to a node, chosen round-robin, so that it keeps
+ * using the partitions that are local to it.
+ */
+void
+StrategyInitBackend(void)
+{
+	int			node;
+
+	if (!numa_bind_backends || StrategyControl->partitionChunk == 0)
+		return;
+
+	node = (MyProc != NULL ? MyProc->pgprocno : 0) %
+		StrategyControl->numNumaNodes;
+	if (pg_numa_bind_process(node))
+	{
+		MyNumaNode = node;
+		MyNumaNodeBound = true;
+	}
+	else
+		elog(DEBUG1, "could not bind process to NUMA node %d: %m", node);
+}
+
 /*
  * StrategyShmemSize
  *
@@ -461,9 +827,105 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* size of the clock sweep partitions */
+	size = add_size(size, mul_size(NumSweepPartitions(),
+								   sizeof(SweepPartitionPadded)));
+
+	/* size of their clean lists */
+	size = add_size(size, mul_size(NumCleanListSlots(), sizeof(int)));
+
 	return size;
 }
 
+/*
+ * NumaNodes -- number of NUMA nodes to partition the buffer pool over
+ *
+ * Returns 1 unless numa_shared_buffers = partition on a NUMA machine.
+ */
+static int
+NumaNodes(void)
+{
+	static int	nodes = 0;
+
+	if (nodes == 0)
+	{
+		if (numa_shared_buffers == NUMA_BUFFERS_PARTITION)
+			nodes = Min(pg_numa_num_nodes(), MAX_SWEEP_PARTITIONS);
+		else
+			nodes = 1;
+	}
+	return nodes;
+}
+
+/*
+ * NumSweepPartitions -- number of clock sweep partitions to use for NBuffers
+ *
+ * When partitioning by NUMA node, every node gets the same number of
+ * partitions, and at least one.
+ */
+static int
+NumSweepPartitions(void)
+{
+	int			nparts = Max(1, Min(MAX_SWEEP_PARTITIONS,
+									NBuffers / MIN_SWEEP_PARTITION_SIZE));
+	int			nodes = NumaNodes();
+
+	if (nodes > 1)
+		nparts = Max(nodes, nparts - nparts % nodes);
+	return nparts;
+}
+
+/*
+ * SweepPartitionChunk -- buffers per partition when partitioned by node
+ *
+ * Returns 0 if partitions are interleaved.  Otherwise partition p holds
+ * buffers p * chunk up to the next partition's first buffer.
+ */
+static int
+SweepPartitionChunk(int nparts)
+{
+	if (NumaNodes() <= 1)
+		return 0;
+	return (NBuffers + nparts - 1) / nparts;
+}
+
+/*
+ * SweepPartitionSize -- number of buffers in the given partition
+ */
+static int
+SweepPartitionSize(int partno, int nparts)
+{
+	int			chunk = SweepPartitionChunk(nparts);
+
+	if (chunk > 0)
+		return Min(chunk, NBuffers - partno * chunk);
+	return (NBuffers - partno + nparts - 1) / nparts;
+}
+
+/*
+ * CleanListCapacity -- size of the given partition's clean list
+ */
+static int
+CleanListCapacity(int partno, int nparts)
+{
+	return Max(1, SweepPartitionSize(partno, nparts) / CLEAN_LIST_FRACTION);
+}
+
+/*
+ * NumCleanListSlots -- total size of all partitions' clean lists
+ */
+static int
+NumCleanListSlots(void)
+{
+	int			nparts = NumSweepPartitions();
+	int			total = 0;
+	int			i;
+
+	for (i = 0; i < nparts; i++)
+		total += CleanListCapacity(i, nparts);
+	return total;
+}
+
 /*
  * StrategyInitialize -- initialize the buffer cache replacement
  *		strategy.
@@ -474,7 +936,9 @@ StrategyShmemSize(void)
 void
 StrategyInitialize(bool init)
 {
-	bool		found;
+	bool		foundCtl,
+				foundParts,
+				foundClean;
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -494,33 +958,94 @@ StrategyInitialize(bool init)
 	StrategyControl = (BufferStrategyControl *)
 		ShmemInitStruct("Buffer Strategy Status",
 						sizeof(BufferStrategyControl),
-						&found);
+						&foundCtl);
+
+	/* ShmemInitStruct aligns this to a cache line boundary */
+	SweepPartitions = (SweepPartitionPadded *)
+		ShmemInitStruct("Buffer Strategy Sweep Partitions",
+						NumSweepPartitions() * sizeof(SweepPartitionPadded),
+						&foundParts);
 
-	if (!found)
+	CleanBufferIds = (int *)
+		ShmemInitStruct("Buffer Strategy Clean Lists",
+						NumCleanListSlots() * sizeof(int),
+						&foundClean);
+
+	if (!foundCtl || !foundParts || !foundClean)
 	{
+		int			i;
+		int			cleanOffset = 0;
+
 		/*
 		 * Only done once, usually in postmaster
 		 */
-		Assert(init);
+		Assert(init && !foundCtl && !foundParts && !foundClean);
 
 		SpinLockInit(&StrategyControl->buffer_strategy_lock);
 
+		/* No pending notification */
+		StrategyControl->bgwprocno = -1;
+
+		/* Initialize the clock sweep partitions */
+		StrategyControl->numSweepPartitions = NumSweepPartitions();
+		StrategyControl->partitionChunk =
+			SweepPartitionChunk(StrategyControl->numSweepPartitions);
+		StrategyControl->numNumaNodes = NumaNodes();
+
 		/*
 		 * Grab the whole linked list of free buffers for our strategy. We
-		 * assume it was previously set up by InitBufferPool().
+		 * assume it was previously set up by InitBufferPool().  If
+		 * partitioning by NUMA node, split it into one list per node, each
+		 * holding the buffers of that node's partitions.
 		 */
-		StrategyControl->firstFreeBuffer = 0;
-		StrategyControl->lastFreeBuffer = NBuffers - 1;
-
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
+		StrategyControl->numFreeLists = StrategyControl->numNumaNodes;
+		for (i = 0; i < StrategyControl->numFreeLists; i++)
+		{
+			int			per_node = StrategyControl->numSweepPartitions /
+			StrategyControl->numNumaNodes;
+			int			first = 0;
+			int			last = NBuffers - 1;
 
-		/* Clear statistics */
-		StrategyControl->completePasses = 0;
-		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+			if (StrategyControl->partitionChunk > 0)
+			{
+				first = i * per_node * StrategyControl->partitionChunk;
+				last = Min(first + per_node * StrategyControl->partitionChunk,
+						   NBuffers) - 1;
+				GetBufferDescriptor(last)->freeNext = FREENEXT_END_OF_LIST;
+			}
+			StrategyControl->firstFreeBuffer[i] = first;
+			StrategyControl->lastFreeBuffer[i] = last;
+		}
 
-		/* No pending notification */
-		StrategyControl->bgwprocno = -1;
+		for (i = 0; i < StrategyControl->numSweepPartitions; i++)
+		{
+			SweepPartition *part = &SweepPartitions[i].part;
+
+			SpinLockInit(&part->lock);
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
+			part->completePasses = 0;
+			part->numBuffers = SweepPartitionSize(i,
+												  StrategyControl->numSweepPartitions);
+			if (StrategyControl->partitionChunk > 0)
+			{
+				part->firstBuffer = i * StrategyControl->partitionChunk;
+				part->bufferStride = 1;
+			}
+			else
+			{
+				part->firstBuffer = i;
+				part->bufferStride = StrategyControl->numSweepPartitions;
+			}
+			pg_atomic_init_u32(&part->numBufferAllocs, 0);
+
+			SpinLockInit(&part->cleanLock);
+			part->cleanOffset = cleanOffset;
+			part->cleanCapacity = CleanListCapacity(i,
+													StrategyControl->numSweepPartitions);
+			part->cleanHead = 0;
+			part->cleanCount = 0;
+			cleanOffset += part->cleanCapacity;
+		}
 	}
 	else
 		Assert(!init);
@@ -625,8 +1150,9 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 	 * slot by calling AddBufferToRing with the new buffer.
 	 */
 	bufnum = strategy->buffers[strategy->current];
-	if (bufnum == InvalidBuffer)
+	if (bufnum == InvalidBuffer || BufferIsLocal(bufnum))
 	{
+		/* a local buffer could be here if the strategy was used for both */
 		strategy->current_was_in_ring = false;
 		return NULL;
 	}
@@ -702,3 +1228,42 @@ StrategyRejectBuffer(BufferAccessStrategy strategy, BufferDesc *buf)
 
 	return true;
 }
+
+/*
+ * StrategyGetLocalBuffer -- advance the ring and return its local buffer
+ *
+ * localbuf.c manages local buffers itself, but uses the strategy's ring to
+ * keep a bulk operation on a temporary relation from flooding the local
+ * buffer pool, as we do for shared buffers.  The ring is limited to
+ * max_ring_size slots so that it stays small relative to that pool.
+ *
+ * Returns the local buffer in the new current slot, or InvalidBuffer if the
+ * slot hasn't been filled with one yet.  The caller is responsible for
+ * deciding whether the buffer can be reused; if not, it should allocate
+ * another one and put it in the slot with StrategyPutLocalBuffer.
+ */
+Buffer
+StrategyGetLocalBuffer(BufferAccessStrategy strategy, int max_ring_size)
+{
+	int			ring_size = Min(strategy->ring_size, Max(max_ring_size, 1));
+	Buffer		bufnum;
+
+	if (++strategy->current >= ring_size)
+		strategy->current = 0;
+	strategy->current_was_in_ring = false;
+
+	bufnum = strategy->buffers[strategy->current];
+	if (!BufferIsLocal(bufnum))
+		return InvalidBuffer;
+	return bufnum;
+}
+
+/*
+ * StrategyPutLocalBuffer -- fill the current ring slot with a local buffer
+ */
+void
+StrategyPutLocalBuffer(BufferAccessStrategy strategy, Buffer buffer)
+{
+	Assert(BufferIsLocal(buffer));
+	strategy->buffers[strategy->current] = buffer;
+}
@@ -38,18 +38,39 @@ typedef struct
 #define LocalBufHdrGetBlock(bufHdr) \
 	LocalBufferBlockPointers[-((bufHdr)->buf_id + 2)]
 
+/*
+ * The local buffer pool starts out empty and grows on demand, one buffer at
+ * a time, until it reaches temp_buffers.  The arrays below are enlarged in
+ * steps of at least LOCAL_BUFFER_GROW_MIN entries, so LocalBufferDescriptors
+ * can move; don't keep a BufferDesc pointer across LocalBufferAlloc.
+ */
+#define LOCAL_BUFFER_GROW_MIN	64
+
+/*
+ * When a dirty buffer must be evicted, we write out up to this many dirty,
+ * evictable buffers at once, in block order, so that the kernel sees mostly
+ * sequential writes rather than one random write per allocation.
+ */
+#define LOCAL_BUFFER_WRITE_BATCH	16
+
 int			NLocBuffer = 0;		/* until buffers are initialized */
 
 BufferDesc *LocalBufferDescriptors = NULL;
 Block	   *LocalBufferBlockPointers = NULL;
 int32	   *LocalRefCount = NULL;
 
+static int	LocalBufferCapacity = 0;	/* allocated length of the arrays */
+
 static int	nextFreeLocalBuf = 0;
 
 static HTAB *LocalBufHash = NULL;
 
 
 static void InitLocalBuffers(void);
+static int	AddLocalBuffer(void);
+static void WriteLocalBuffer(BufferDesc *bufHdr);
+static void WriteLocalBufferBatch(BufferDesc *victim);
+static int	local_buffer_tag_cmp(const void *a, const void *b);
 static Block GetLocalBufferStorage(void);
 
 
@@ -96,12 +117,13 @@ LocalPrefetchBuffer(SMgrRelation smgr, ForkNumber forkNum,
  *
  * API is similar to bufmgr.c's BufferAlloc, except that we do not need
  * to do any locking since this is all local.   Also, IO_IN_PROGRESS
- * does not get set.  Lastly, we support only default access strategy
- * (hence, usage_count is always advanced).
+ * does not get set.  If a strategy is given, its ring is used to recycle
+ * a small set of local buffers, so that a bulk scan or load of a large
+ * temporary relation doesn't push everything else out of the pool.
  */
 BufferDesc *
 LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
-				 bool *foundPtr)
+				 BufferAccessStrategy strategy, bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
 	LocalBufferLookupEnt *hresult;
@@ -135,7 +157,9 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 		/* this part is equivalent to PinBuffer for a shared buffer */
 		if (LocalRefCount[b] == 0)
 		{
-			if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+			if (strategy == NULL
+				? BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT
+				: BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
 			{
 				buf_state += BUF_USAGECOUNT_ONE;
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
@@ -161,20 +185,60 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 #endif
 
 	/*
-	 * Need to get a new buffer.  We use a clock sweep algorithm (essentially
-	 * the same as what freelist.c does now...)
+	 * Need to get a new buffer.  First, if we're using a strategy, see
+	 * whether the buffer in the current ring slot can be recycled; as in
+	 * freelist.c, only if nobody has it pinned and it hasn't been used since
+	 * we put it there.
+	 */
+	b = -1;
+	if (strategy != NULL)
+	{
+		Buffer		ringbuf;
+
+		ringbuf = StrategyGetLocalBuffer(strategy, num_temp_buffers / 8);
+		if (ringbuf != InvalidBuffer && -ringbuf - 1 < NLocBuffer)
+		{
+			int			rb = -ringbuf - 1;
+
+			bufHdr = GetLocalBufferDescriptor(rb);
+			buf_state = pg_atomic_read_u32(&bufHdr->state);
+			if (LocalRefCount[rb] == 0 &&
+				BUF_STATE_GET_USAGECOUNT(buf_state) <= 1)
+			{
+				b = rb;
+				LocalRefCount[b]++;
+				ResourceOwnerRememberBuffer(CurrentResourceOwner,
+											BufferDescriptorGetBuffer(bufHdr));
+			}
+		}
+	}
+
+	/* Otherwise, enlarge the pool if it hasn't reached temp_buffers yet */
+	if (b < 0 && NLocBuffer < num_temp_buffers)
+	{
+		b = AddLocalBuffer();
+		bufHdr = GetLocalBufferDescriptor(b);
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		LocalRefCount[b]++;
+		ResourceOwnerRememberBuffer(CurrentResourceOwner,
+									BufferDescriptorGetBuffer(bufHdr));
+	}
+
+	/*
+	 * Otherwise use a clock sweep algorithm (essentially the same as what
+	 * freelist.c does now...)
 	 */
 	trycounter = NLocBuffer;
-	for (;;)
+	while (b < 0)
 	{
-		b = nextFreeLocalBuf;
+		int			cand = nextFreeLocalBuf;
 
 		if (++nextFreeLocalBuf >= NLocBuffer)
 			nextFreeLocalBuf = 0;
 
-		bufHdr = GetLocalBufferDescriptor(b);
+		bufHdr = GetLocalBufferDescriptor(cand);
 
-		if (LocalRefCount[b] == 0)
+		if (LocalRefCount[cand] == 0)
 		{
 			buf_state = pg_atomic_read_u32(&bufHdr->state);
 
@@ -187,10 +251,10 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 			else
 			{
 				/* Found a usable buffer */
+				b = cand;
 				LocalRefCount[b]++;
 				ResourceOwnerRememberBuffer(CurrentResourceOwner,
 											BufferDescriptorGetBuffer(bufHdr));
-				break;
 			}
 		}
 		else if (--trycounter == 0)
@@ -199,32 +263,19 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 					 errmsg("no empty local buffer available")));
 	}
 
+	if (strategy != NULL)
+		StrategyPutLocalBuffer(strategy, BufferDescriptorGetBuffer(bufHdr));
+
 	/*
 	 * this buffer is not referenced but it might still be dirty. if that's
-	 * the case, write it out before reusing it!
+	 * the case, write it out before reusing it, along with a batch of other
+	 * dirty buffers that are likely to be evicted soon.
 	 */
 	if (buf_state & BM_DIRTY)
 	{
-		SMgrRelation oreln;
-		Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
-
-		/* Find smgr relation for buffer */
-		oreln = smgropen(bufHdr->tag.rnode, MyBackendId);
-
-		PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
-
-		/* And write... */
-		smgrwrite(oreln,
-				  bufHdr->tag.forkNum,
-				  bufHdr->tag.blockNum,
-				  localpage,
-				  false);
-
-		/* Mark not-dirty now in case we error out below */
-		buf_state &= ~BM_DIRTY;
-		pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
-
-		pgBufferUsage.local_blks_written++;
+		WriteLocalBufferBatch(bufHdr);
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		Assert(!(buf_state & BM_DIRTY));
 	}
 
 	/*
@@ -404,14 +455,13 @@ DropRelFileNodeAllLocalBuffers(RelFileNode rnode)
  * InitLocalBuffers -
  *	  init the local buffer cache. Since most queries (esp. multi-user ones)
  *	  don't involve local buffers, we delay allocating actual memory for the
- *	  buffers until we need them; just make the buffer headers here.
+ *	  buffers until we need them; just make the lookup table here.  Buffer
+ *	  headers are added by AddLocalBuffer as the pool grows.
  */
 static void
 InitLocalBuffers(void)
 {
-	int			nbufs = num_temp_buffers;
 	HASHCTL		info;
-	int			i;
 
 	/*
 	 * Parallel workers can't access data in temporary tables, because they
@@ -426,53 +476,207 @@ InitLocalBuffers(void)
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot access temporary tables during a parallel operation")));
 
-	/* Allocate and zero buffer headers and auxiliary arrays */
-	LocalBufferDescriptors = (BufferDesc *) calloc(nbufs, sizeof(BufferDesc));
-	LocalBufferBlockPointers = (Block *) calloc(nbufs, sizeof(Block));
-	LocalRefCount = (int32 *) calloc(nbufs, sizeof(int32));
-	if (!LocalBufferDescriptors || !LocalBufferBlockPointers || !LocalRefCount)
-		ereport(FATAL,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("out of memory")));
-
 	nextFreeLocalBuf = 0;
 
-	/* initialize fields that need to start off nonzero */
-	for (i = 0; i < nbufs; i++)
-	{
-		BufferDesc *buf = GetLocalBufferDescriptor(i);
-
-		/*
-		 * negative to indicate local buffer. This is tricky: shared buffers
-		 * start with 0. We have to start with -2. (Note that the routine
-		 * BufferDescriptorGetBuffer adds 1 to buf_id so our first buffer id
-		 * is -1.)
-		 */
-		buf->buf_id = -i - 2;
-
-		/*
-		 * Intentionally do not initialize the buffer's atomic variable
-		 * (besides zeroing the underlying memory above). That way we get
-		 * errors on platforms without atomics, if somebody (re-)introduces
-		 * atomic operations for local buffers.
-		 */
-	}
-
 	/* Create the lookup hash table */
 	MemSet(&info, 0, sizeof(info));
 	info.keysize = sizeof(BufferTag);
 	info.entrysize = sizeof(LocalBufferLookupEnt);
 
 	LocalBufHash = hash_create("Local Buffer Lookup Table",
-							   nbufs,
+							   num_temp_buffers,
 							   &info,
 							   HASH_ELEM | HASH_BLOBS);
 
 	if (!LocalBufHash)
 		elog(ERROR, "could not initialize local buffer hash table");
+}
+
+/*
+ * AddLocalBuffer -
+ *	  add one buffer header to the local buffer pool, and return its index.
+ *
+ * The caller must have checked that NLocBuffer < num_temp_buffers.  The new
+ * buffer is unpinned, invalid and has no storage yet.
+ */
+static int
+AddLocalBuffer(void)
+{
+	int			b;
+
+	Assert(NLocBuffer < num_temp_buffers);
+
+	if (NLocBuffer >= LocalBufferCapacity)
+	{
+		int			newcap;
+		BufferDesc *newdescs;
+		Block	   *newblocks;
+		int32	   *newrefcounts;
+		int			i;
+
+		newcap = Max(LocalBufferCapacity * 2, LOCAL_BUFFER_GROW_MIN);
+		newcap = Min(newcap, num_temp_buffers);
+
+		/*
+		 * Enlarge the arrays one at a time, storing each result as we go so
+		 * that nothing is lost if a later one fails.
+		 */
+		newdescs = (BufferDesc *)
+			realloc(LocalBufferDescriptors, newcap * sizeof(BufferDesc));
+		if (newdescs == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+		LocalBufferDescriptors = newdescs;
+
+		newblocks = (Block *)
+			realloc(LocalBufferBlockPointers, newcap * sizeof(Block));
+		if (newblocks == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+		LocalBufferBlockPointers = newblocks;
+
+		newrefcounts = (int32 *)
+			realloc(LocalRefCount, newcap * sizeof(int32));
+		if (newrefcounts == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+		LocalRefCount = newrefcounts;
+
+		/* zero the new entries, and set fields that must start off nonzero */
+		MemSet(&LocalBufferDescriptors[LocalBufferCapacity], 0,
+			   (newcap - LocalBufferCapacity) * sizeof(BufferDesc));
+		MemSet(&LocalBufferBlockPointers[LocalBufferCapacity], 0,
+			   (newcap - LocalBufferCapacity) * sizeof(Block));
+		MemSet(&LocalRefCount[LocalBufferCapacity], 0,
+			   (newcap - LocalBufferCapacity) * sizeof(int32));
+
+		for (i = LocalBufferCapacity; i < newcap; i++)
+		{
+			BufferDesc *buf = GetLocalBufferDescriptor(i);
+
+			/*
+			 * negative to indicate local buffer. This is tricky: shared
+			 * buffers start with 0. We have to start with -2. (Note that the
+			 * routine BufferDescriptorGetBuffer adds 1 to buf_id so our first
+			 * buffer id is -1.)
+			 */
+			buf->buf_id = -i - 2;
+
+			/*
+			 * Intentionally do not initialize the buffer's atomic variable
+			 * (besides zeroing the underlying memory above). That way we get
+			 * errors on platforms without atomics, if somebody
+			 * (re-)introduces atomic operations for local buffers.
+			 */
+		}
+
+		LocalBufferCapacity = newcap;
+	}
+
+	b = NLocBuffer++;
+	return b;
+}
+
+/*
+ * WriteLocalBuffer -
+ *	  write out one dirty local buffer and mark it clean.
+ */
+static void
+WriteLocalBuffer(BufferDesc *bufHdr)
+{
+	SMgrRelation oreln;
+	Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
+	uint32		buf_state;
+
+	/* Find smgr relation for buffer */
+	oreln = smgropen(bufHdr->tag.rnode, MyBackendId);
+
+	PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
+
+	/* And write... */
+	smgrwrite(oreln,
+			  bufHdr->tag.forkNum,
+			  bufHdr->tag.blockNum,
+			  localpage,
+			  false);
+
+	/* Mark not-dirty now in case we error out below */
+	buf_state = pg_atomic_read_u32(&bufHdr->state);
+	buf_state &= ~BM_DIRTY;
+	pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+
+	pgBufferUsage.local_blks_written++;
+}
 
-	/* Initialization done, mark buffers allocated */
-	NLocBuffer = nbufs;
+/*
+ * WriteLocalBufferBatch -
+ *	  write out a dirty victim buffer, together with other dirty buffers
+ *	  the clock hand is about to reach.
+ *
+ * Buffers are only added to the batch if they are unpinned and would be
+ * evicted on the next pass or the one after (usage count at most one), so
+ * we don't write pages that are still being modified.  The batch is written
+ * in relation and block order, which turns the write-back of a bulk load
+ * into mostly sequential I/O.
+ */
+static void
+WriteLocalBufferBatch(BufferDesc *victim)
+{
+	BufferDesc *batch[LOCAL_BUFFER_WRITE_BATCH];
+	int			nbatch = 0;
+	int			victim_id = -(victim->buf_id + 2);
+	int			i;
+
+	batch[nbatch++] = victim;
+
+	for (i = 0; i < NLocBuffer && i < LOCAL_BUFFER_WRITE_BATCH * 4 &&
+		 nbatch < LOCAL_BUFFER_WRITE_BATCH; i++)
+	{
+		int			b = (nextFreeLocalBuf + i) % NLocBuffer;
+		BufferDesc *bufHdr = GetLocalBufferDescriptor(b);
+		uint32		buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+		if (b == victim_id || LocalRefCount[b] != 0)
+			continue;
+		if ((buf_state & (BM_DIRTY | BM_TAG_VALID)) !=
+			(BM_DIRTY | BM_TAG_VALID))
+			continue;
+		if (BUF_STATE_GET_USAGECOUNT(buf_state) > 1)
+			continue;
+
+		batch[nbatch++] = bufHdr;
+	}
+
+	if (nbatch > 1)
+		qsort(batch, nbatch, sizeof(BufferDesc *), local_buffer_tag_cmp);
+
+	for (i = 0; i < nbatch; i++)
+		WriteLocalBuffer(batch[i]);
+}
+
+/*
+ * qsort comparator for WriteLocalBufferBatch: order by file, then block.
+ */
+static int
+local_buffer_tag_cmp(const void *a, const void *b)
+{
+	const BufferTag *ta = &(*(BufferDesc *const *) a)->tag;
+	const BufferTag *tb = &(*(BufferDesc *const *) b)->tag;
+
+	if (ta->rnode.spcNode != tb->rnode.spcNode)
+		return ta->rnode.spcNode < tb->rnode.spcNode ? -1 : 1;
+	if (ta->rnode.dbNode != tb->rnode.dbNode)
+		return ta->rnode.dbNode < tb->rnode.dbNode ? -1 : 1;
+	if (ta->rnode.relNode != tb->rnode.relNode)
+		return ta->rnode.relNode < tb->rnode.relNode ? -1 : 1;
+	if (ta->forkNum != tb->forkNum)
+		return ta->forkNum < tb->forkNum ? -1 : 1;
+	if (ta->blockNum != tb->blockNum)
+		return ta->blockNum < tb->blockNum ? -1 : 1;
+	return 0;
 }
 
 /*
@@ -515,13 +719,16 @@ GetLocalBufferStorage(void)
 
 		/* Start with a 16-buffer request; subsequent ones double each time */
 		num_bufs = Max(num_bufs_in_block * 2, 16);
-		/* But not more than what we need for all remaining local bufs */
-		num_bufs = Min(num_bufs, NLocBuffer - total_bufs_allocated);
+		/* But not more than the buffer headers we have room for so far */
+		num_bufs = Min(num_bufs, LocalBufferCapacity - total_bufs_allocated);
 		/* And don't overflow MaxAllocSize, either */
-		num_bufs = Min(num_bufs, MaxAllocSize / BLCKSZ);
+		num_bufs = Min(num_bufs, (MaxAllocSize - PG_IO_ALIGN_SIZE) / BLCKSZ);
 
-		cur_block = (char *) MemoryContextAlloc(LocalBufferContext,
-												num_bufs * BLCKSZ);
+		/* Align the buffers for direct I/O, like shared buffers */
+		cur_block = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(LocalBufferContext,
+										 num_bufs * BLCKSZ + PG_IO_ALIGN_SIZE));
 		next_buf_in_block = 0;
 		num_bufs_in_block = num_bufs;
 	}
@@ -36,12 +36,24 @@
  * other backends, as infrastructure for parallel execution.  Such files need
  * to be created as a member of a SharedFileSet that all participants are
  * attached to.
+ *
+ * A BufFile created with BufFileCreateCompressTemp may compress its buffer
+ * contents as they are written out, as controlled by temp_file_compression.
+ * Compressed blocks have variable physical size, so such a file supports
+ * only appending data and then rewinding to the start to read it back
+ * sequentially, which is the access pattern of hash join and hash
+ * aggregation spill files.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 #include "commands/tablespace.h"
+#include "common/pg_lzcompress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -58,6 +70,31 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/*
+ * In a compressed BufFile, each buffer dump is stored as a header followed
+ * by the stored bytes: the output of the file's compression method, or the
+ * raw bytes if they didn't compress (complen < 0).  A chunk never crosses a segment boundary; a chunk that
+ * doesn't fit starts a new segment instead, so readers move on to the next
+ * segment when they hit the end of the current one.
+ */
+typedef struct BufFileChunkHeader
+{
+	int32		rawlen;			/* uncompressed length */
+	int32		complen;		/* compressed length, or -1 if stored raw */
+} BufFileChunkHeader;
+
+#ifdef USE_LZ4
+#define BUFFILE_CHUNK_MAXLEN \
+	Max(PGLZ_MAX_OUTPUT(BLCKSZ), LZ4_COMPRESSBOUND(BLCKSZ))
+#else
+#define BUFFILE_CHUNK_MAXLEN	PGLZ_MAX_OUTPUT(BLCKSZ)
+#endif
+#define BUFFILE_CHUNK_BUFSIZE \
+	(sizeof(BufFileChunkHeader) + BUFFILE_CHUNK_MAXLEN)
+
+/* GUC variable */
+int			temp_file_compression = TEMP_FILE_COMPRESSION_NONE;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -72,6 +109,8 @@ struct BufFile
 	bool		isInterXact;	/* keep open over transactions? */
 	bool		dirty;			/* does buffer need to be written? */
 	bool		readOnly;		/* has the file been set to read only? */
+	bool		compress;		/* compress blocks as they're written? */
+	int			compression;	/* TempFileCompression method, if compress */
 
 	SharedFileSet *fileset;		/* space for segment files if shared */
 	const char *name;			/* name of this BufFile if shared */
@@ -86,19 +125,27 @@ struct BufFile
 	/*
 	 * "current pos" is position of start of buffer within the logical file.
 	 * Position as seen by user of BufFile is (curFile, curOffset + pos).
+	 * In a compressed file, (curFile, curOffset) is instead the physical
+	 * position of the next chunk to be read or written, and the logical
+	 * position isn't tracked at all.
 	 */
 	int			curFile;		/* file index (0..n) part of current pos */
 	off_t		curOffset;		/* offset part of current pos */
 	int			pos;			/* next read/write position in buffer */
 	int			nbytes;			/* total # of valid bytes in buffer */
 	PGAlignedBlock buffer;
+
+	char	   *cbuffer;		/* chunk buffer, if compress is set */
 };
 
 static BufFile *makeBufFileCommon(int nfiles);
 static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
+static void BufFileLoadCompressed(BufFile *file);
+static int	BufFileDecompress(BufFile *file, int stored, int rawlen);
 static void BufFileDumpBuffer(BufFile *file);
+static void BufFileDumpCompressed(BufFile *file);
 static void BufFileFlush(BufFile *file);
 static File MakeNewSharedSegment(BufFile *file, int segment);
 
@@ -113,11 +160,14 @@ makeBufFileCommon(int nfiles)
 	file->numFiles = nfiles;
 	file->isInterXact = false;
 	file->dirty = false;
+	file->compress = false;
+	file->compression = TEMP_FILE_COMPRESSION_NONE;
 	file->resowner = CurrentResourceOwner;
 	file->curFile = 0;
 	file->curOffset = 0L;
 	file->pos = 0;
 	file->nbytes = 0;
+	file->cbuffer = NULL;
 
 	return file;
 }
@@ -206,6 +256,29 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file whose blocks are compressed
+ * with the method selected by temp_file_compression, if any.
+ *
+ * The caller may only write to the file, rewind it with
+ * BufFileSeek(file, 0, 0L, SEEK_SET), and then read it back sequentially;
+ * it must not write to the file again after rewinding it.
+ */
+BufFile *
+BufFileCreateCompressTemp(bool interXact)
+{
+	BufFile    *file = BufFileCreateTemp(interXact);
+
+	if (temp_file_compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		file->compress = true;
+		file->compression = temp_file_compression;
+		file->cbuffer = palloc(BUFFILE_CHUNK_BUFSIZE);
+	}
+
+	return file;
+}
+
 /*
  * Build the name for a given segment of a given BufFile.
  */
@@ -399,6 +472,8 @@ BufFileClose(BufFile *file)
 		FileClose(file->files[i]);
 	/* release the buffer space */
 	pfree(file->files);
+	if (file->cbuffer)
+		pfree(file->cbuffer);
 	pfree(file);
 }
 
@@ -414,6 +489,12 @@ BufFileLoadBuffer(BufFile *file)
 {
 	File		thisfile;
 
+	if (file->compress)
+	{
+		BufFileLoadCompressed(file);
+		return;
+	}
+
 	/*
 	 * Advance to next component file if necessary and possible.
 	 */
@@ -448,6 +529,106 @@ BufFileLoadBuffer(BufFile *file)
 		pgBufferUsage.temp_blks_read++;
 }
 
+/*
+ * BufFileLoadCompressed
+ *
+ * BufFileLoadBuffer for a compressed file: load and decompress the chunk at
+ * curOffset, moving on to the next component file at the end of this one.
+ * Unlike the uncompressed case, curOffset is advanced past the chunk.
+ */
+static void
+BufFileLoadCompressed(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	File		thisfile;
+	int			nread;
+	int			stored;
+	char	   *dest;
+
+	for (;;)
+	{
+		thisfile = file->files[file->curFile];
+		nread = FileRead(thisfile, (char *) &hdr, sizeof(hdr),
+						 file->curOffset, WAIT_EVENT_BUFFILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							FilePathName(thisfile))));
+		if (nread > 0)
+			break;
+
+		/* end of this component file; advance to the next, if any */
+		if (file->curFile + 1 >= file->numFiles)
+			return;				/* EOF, leave nbytes = 0 */
+		file->curFile++;
+		file->curOffset = 0L;
+	}
+
+	if (nread != sizeof(hdr) || hdr.rawlen <= 0 || hdr.rawlen > BLCKSZ ||
+		hdr.complen > BUFFILE_CHUNK_MAXLEN)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid compressed block in file \"%s\"",
+						FilePathName(thisfile))));
+
+	if (hdr.complen < 0)
+	{
+		stored = hdr.rawlen;
+		dest = file->buffer.data;
+	}
+	else
+	{
+		stored = hdr.complen;
+		dest = file->cbuffer;
+	}
+
+	nread = FileRead(thisfile, dest, stored,
+					 file->curOffset + sizeof(hdr), WAIT_EVENT_BUFFILE_READ);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						FilePathName(thisfile))));
+	if (nread != stored ||
+		(hdr.complen >= 0 &&
+		 BufFileDecompress(file, stored, hdr.rawlen) != hdr.rawlen))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid compressed block in file \"%s\"",
+						FilePathName(thisfile))));
+
+	file->nbytes = hdr.rawlen;
+	file->curOffset += sizeof(hdr) + stored;
+	pgBufferUsage.temp_blks_read++;
+}
+
+/*
+ * BufFileDecompress
+ *
+ * Decompress the stored chunk bytes in cbuffer into the buffer, returning
+ * the decompressed length or -1 on corrupt input.
+ */
+static int
+BufFileDecompress(BufFile *file, int stored, int rawlen)
+{
+	switch (file->compression)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			return pglz_decompress(file->cbuffer, stored, file->buffer.data,
+								   rawlen, true);
+#ifdef USE_LZ4
+		case TEMP_FILE_COMPRESSION_LZ4:
+			return LZ4_decompress_safe(file->cbuffer, file->buffer.data,
+									   stored, rawlen);
+#endif
+		default:
+			elog(ERROR, "unrecognized temp_file_compression method: %d",
+				 file->compression);
+	}
+	return -1;					/* keep compiler quiet */
+}
+
 /*
  * BufFileDumpBuffer
  *
@@ -462,6 +643,12 @@ BufFileDumpBuffer(BufFile *file)
 	int			bytestowrite;
 	File		thisfile;
 
+	if (file->compress)
+	{
+		BufFileDumpCompressed(file);
+		return;
+	}
+
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
 	 * crosses a component-file boundary; so we need a loop.
@@ -529,6 +716,77 @@ BufFileDumpBuffer(BufFile *file)
 	file->nbytes = 0;
 }
 
+/*
+ * BufFileDumpCompressed
+ *
+ * BufFileDumpBuffer for a compressed file: write the buffer out as a single
+ * chunk at curOffset.  Since such files are append-only, pos must be at the
+ * end of the buffer.
+ */
+static void
+BufFileDumpCompressed(BufFile *file)
+{
+	BufFileChunkHeader *hdr = (BufFileChunkHeader *) file->cbuffer;
+	char	   *data = file->cbuffer + sizeof(BufFileChunkHeader);
+	int			chunklen;
+	File		thisfile;
+
+	Assert(file->pos == file->nbytes);
+
+	hdr->rawlen = file->nbytes;
+	hdr->complen = -1;
+	switch (file->compression)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			hdr->complen = pglz_compress(file->buffer.data, file->nbytes,
+										 data, PGLZ_strategy_default);
+			break;
+#ifdef USE_LZ4
+		case TEMP_FILE_COMPRESSION_LZ4:
+			hdr->complen = LZ4_compress_default(file->buffer.data, data,
+												file->nbytes,
+												LZ4_COMPRESSBOUND(BLCKSZ));
+			/* LZ4 returns 0 on failure, and may expand incompressible data */
+			if (hdr->complen <= 0 || hdr->complen >= file->nbytes)
+				hdr->complen = -1;
+			break;
+#endif
+		default:
+			elog(ERROR, "unrecognized temp_file_compression method: %d",
+				 file->compression);
+	}
+	if (hdr->complen < 0)
+	{
+		memcpy(data, file->buffer.data, file->nbytes);
+		chunklen = sizeof(BufFileChunkHeader) + file->nbytes;
+	}
+	else
+		chunklen = sizeof(BufFileChunkHeader) + hdr->complen;
+
+	/* Start a new component file if the chunk doesn't fit in this one */
+	if (file->curOffset + chunklen > MAX_PHYSICAL_FILESIZE)
+	{
+		while (file->curFile + 1 >= file->numFiles)
+			extendBufFile(file);
+		file->curFile++;
+		file->curOffset = 0L;
+	}
+
+	thisfile = file->files[file->curFile];
+	if (FileWrite(thisfile, file->cbuffer, chunklen, file->curOffset,
+				  WAIT_EVENT_BUFFILE_WRITE) != chunklen)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m",
+						FilePathName(thisfile))));
+	file->curOffset += chunklen;
+	pgBufferUsage.temp_blks_written++;
+
+	file->dirty = false;
+	file->pos = 0;
+	file->nbytes = 0;
+}
+
 /*
  * BufFileRead
  *
@@ -548,7 +806,8 @@ BufFileRead(BufFile *file, void *ptr, size_t size)
 		if (file->pos >= file->nbytes)
 		{
 			/* Try to load more data into buffer. */
-			file->curOffset += file->pos;
+			if (!file->compress)
+				file->curOffset += file->pos;
 			file->pos = 0;
 			file->nbytes = 0;
 			BufFileLoadBuffer(file);
@@ -596,6 +855,8 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 			else
 			{
 				/* Hmm, went directly from reading to writing? */
+				if (file->compress)
+					elog(ERROR, "cannot write to compressed temporary file after reading it");
 				file->curOffset += file->pos;
 				file->pos = 0;
 				file->nbytes = 0;
@@ -652,6 +913,19 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 	int			newFile;
 	off_t		newOffset;
 
+	/* Compressed files can only be rewound */
+	if (file->compress)
+	{
+		if (whence != SEEK_SET || fileno != 0 || offset != 0)
+			elog(ERROR, "cannot seek in compressed temporary file");
+		BufFileFlush(file);
+		file->curFile = 0;
+		file->curOffset = 0L;
+		file->pos = 0;
+		file->nbytes = 0;
+		return 0;
+	}
+
 	switch (whence)
 	{
 		case SEEK_SET:
@@ -732,6 +1006,7 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 void
 BufFileTell(BufFile *file, int *fileno, off_t *offset)
 {
+	Assert(!file->compress);
 	*fileno = file->curFile;
 	*offset = file->curOffset + file->pos;
 }
@@ -756,6 +1031,36 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- initiate asynchronous read of a range of blocks
+ *
+ * This is only a hint to the kernel that we'll soon read these blocks with
+ * BufFileSeekBlock and BufFileRead; blocks beyond the end of the file are
+ * ignored.  It doesn't move the logical position.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, long blknum, int nblocks)
+{
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		long		segblknum = blknum % BUFFILE_SEG_SIZE;
+		int			segblocks;
+
+		if (fileno >= file->numFiles)
+			break;
+
+		segblocks = (int) Min((long) nblocks, BUFFILE_SEG_SIZE - segblknum);
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) segblknum * BLCKSZ,
+							segblocks * BLCKSZ,
+							WAIT_EVENT_BUFFILE_PREFETCH);
+
+		blknum += segblocks;
+		nblocks -= segblocks;
+	}
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
@@ -148,6 +148,9 @@ int			max_safe_fds = 32;	/* default if not changed */
 /* Whether it is safe to continue running after fsync() fails. */
 bool		data_sync_retry = false;
 
+/* Which kinds of files to open with O_DIRECT; see the io_direct GUC. */
+int			io_direct_flags = 0;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -2016,6 +2019,115 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileZero - write zeroes over the given range of a file
+ *
+ * Like FileWrite, returns the number of bytes written, which is less than
+ * amount only in case of error, with errno set.  Not for temporary files
+ * subject to temp_file_limit.
+ */
+int
+FileZero(File file, off_t offset, int amount, uint32 wait_event_info)
+{
+	/*
+	 * A static, so it starts out as zeroes and stays that way; aligned so
+	 * that it's also usable for direct I/O.
+	 */
+#define FILE_ZERO_CHUNK		(64 * 1024)
+	static char zbuffer_raw[FILE_ZERO_CHUNK + PG_IO_ALIGN_SIZE];
+	char	   *zbuffer = (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, zbuffer_raw);
+	int			returnCode;
+	int			written = 0;
+
+	Assert(FileIsValid(file));
+	Assert((VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT) == 0);
+
+	DO_DB(elog(LOG, "FileZero: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset, amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	while (written < amount)
+	{
+		int			chunk = Min(amount - written, FILE_ZERO_CHUNK);
+
+		errno = 0;
+		pgstat_report_wait_start(wait_event_info);
+		returnCode = pg_pwrite(VfdCache[file].fd, zbuffer, chunk,
+							   offset + written);
+		pgstat_report_wait_end();
+
+		if (returnCode < 0)
+		{
+			/* OK to retry if interrupted */
+			if (errno == EINTR)
+				continue;
+			return returnCode;
+		}
+		if (returnCode < chunk)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			return written + returnCode;
+		}
+		written += returnCode;
+	}
+
+	return written;
+}
+
+/*
+ * FileFallocate - allocate disk space for the given range of a file
+ *
+ * Newly allocated space reads as zeroes.  This is cheaper than FileZero for
+ * anything but small ranges; where posix_fallocate() isn't available or not
+ * supported by the file system, we fall back to FileZero.  Returns 0 on
+ * success, -1 with errno set on failure.
+ */
+int
+FileFallocate(File file, off_t offset, int amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileFallocate: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset, amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+	if (returnCode == EINTR)
+		goto retry;
+
+	/* for file systems that don't support it, fall back to writing zeroes */
+	if (returnCode != EINVAL && returnCode != EOPNOTSUPP)
+	{
+		/* posix_fallocate() doesn't set errno */
+		errno = returnCode;
+		return -1;
+	}
+#endif
+
+	if (FileZero(file, offset, amount, wait_event_info) != amount)
+		return -1;
+	return 0;
+}
+
 int
 FileSync(File file, uint32 wait_event_info)
 {
@@ -3124,6 +3236,76 @@ looks_like_temp_rel_name(const char *name)
 }
 
 
+/*
+ * PathWritesAtomic -- does the filesystem holding path write BLCKSZ
+ * bytes atomically?
+ */
+static bool
+PathWritesAtomic(const char *path)
+{
+#ifdef STATX_WRITE_ATOMIC
+	struct statx stx;
+
+	if (statx(AT_FDCWD, path, 0, STATX_WRITE_ATOMIC, &stx) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+		return false;
+	}
+	if (!(stx.stx_mask & STATX_WRITE_ATOMIC))
+		return false;
+	return stx.stx_atomic_write_unit_min <= BLCKSZ &&
+		stx.stx_atomic_write_unit_max >= BLCKSZ;
+#else
+	/* no way to ask the OS */
+	return false;
+#endif
+}
+
+/*
+ * DataDirectoryWritesAtomic -- can relation pages be written without tearing?
+ *
+ * Returns true only if the operating system reports that the filesystem of
+ * the default tablespace, and of every tablespace under pg_tblspc, can write
+ * a whole BLCKSZ page atomically.  This is used by atomic_page_writes to
+ * decide whether full-page images can be skipped.  On platforms that can't
+ * tell us, the answer is always false.
+ *
+ * Note we assume we're chdir'd into PGDATA to begin with.
+ */
+bool
+DataDirectoryWritesAtomic(void)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	bool		result;
+
+	result = PathWritesAtomic("base") && PathWritesAtomic("global");
+	if (!result)
+		return false;
+
+	dir = AllocateDir("pg_tblspc");
+	while ((de = ReadDirExtended(dir, "pg_tblspc", LOG)) != NULL)
+	{
+		char		path[MAXPGPATH];
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(path, sizeof(path), "pg_tblspc/%s", de->d_name);
+		if (!PathWritesAtomic(path))
+		{
+			result = false;
+			break;
+		}
+	}
+	FreeDir(dir);
+
+	return result;
+}
+
+
 /*
  * Issue fsync recursively on PGDATA and all its contents.
  *
@@ -20,6 +20,7 @@
 #include "storage/copydir.h"
 #include "storage/fd.h"
 #include "storage/reinit.h"
+#include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/memutils.h"
 
@@ -88,6 +89,12 @@ ResetUnloggedRelations(int op)
 
 	FreeDir(spc_dir);
 
+	/*
+	 * Files have been removed and copied behind the smgr layer's back, so
+	 * any relation sizes cached so far can no longer be trusted.
+	 */
+	SMgrSizeCacheForgetDatabase(InvalidOid);
+
 	/*
 	 * Restore memory context.
 	 */
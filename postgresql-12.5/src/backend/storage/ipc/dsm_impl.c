@@ -67,6 +67,7 @@
 #include "portability/mem.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
+#include "storage/pg_shmem.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "postmaster/postmaster.h"
@@ -333,6 +334,18 @@ dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 						name)));
 		return false;
 	}
+
+#ifdef MADV_HUGEPAGE
+
+	/*
+	 * POSIX shared memory lives on tmpfs, which can't use MAP_HUGETLB, but
+	 * Linux will back it with transparent huge pages if asked to (given
+	 * shmem_enabled = advise).  This is only advice, so ignore failures.
+	 */
+	if (huge_pages != HUGE_PAGES_OFF)
+		(void) madvise(address, request_size, MADV_HUGEPAGE);
+#endif
+
 	*mapped_address = address;
 	*mapped_size = request_size;
 	close(fd);
@@ -101,6 +101,9 @@ static ProcArrayStruct *procArray;
 static PGPROC *allProcs;
 static PGXACT *allPgXact;
 
+/* Global xmin computed by the last full GetSnapshotData() in this backend */
+static TransactionId snapshotGlobalXmin = InvalidTransactionId;
+
 /*
  * Bookkeeping for tracking emulated transactions in recovery
  */
@@ -172,6 +175,11 @@ static void KnownAssignedXidsReset(void);
 static inline void ProcArrayEndTransactionInternal(PGPROC *proc,
 												   PGXACT *pgxact, TransactionId latestXid);
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
+static bool GetSnapshotDataReuse(Snapshot snapshot);
+static void SetRecentGlobalXmins(TransactionId globalxmin,
+								 TransactionId replication_slot_xmin,
+								 TransactionId replication_slot_catalog_xmin);
+static void GetSnapshotDataInitOldSnapshot(Snapshot snapshot);
 
 /*
  * Report shared-memory space needed by CreateSharedProcArray.
@@ -194,7 +202,10 @@ ProcArrayShmemSize(void)
 	 * TransactionIdIsInProgress() and GetRunningTransactionData(). All of the
 	 * main structures created in those functions must be identically sized,
 	 * since we may at times copy the whole of the data structures around. We
-	 * refer to this size as TOTAL_MAX_CACHED_SUBXIDS.
+	 * refer to this size as TOTAL_MAX_CACHED_SUBXIDS.  It depends only on
+	 * PGPROC_MAX_CACHED_SUBXIDS, not on max_cached_subxids, because the
+	 * master reports subxids in batches of at most that many regardless of
+	 * its own cache size.
 	 *
 	 * Ideally we'd only create this structure if we were actually doing hot
 	 * standby in the current run, but we don't know that yet at the time
@@ -246,6 +257,8 @@ CreateSharedProcArray(void)
 		procArray->lastOverflowedXid = InvalidTransactionId;
 		procArray->replication_slot_xmin = InvalidTransactionId;
 		procArray->replication_slot_catalog_xmin = InvalidTransactionId;
+		/* 0 means "never computed" in SnapshotData */
+		ShmemVariableCache->xactCompletionCount = 1;
 	}
 
 	allProcs = ProcGlobal->allProcs;
@@ -352,6 +365,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
+
+		/* Same as ProcArrayEndTransactionInternal() */
+		ShmemVariableCache->xactCompletionCount++;
 	}
 	else
 	{
@@ -467,6 +483,9 @@ ProcArrayEndTransactionInternal(PGPROC *proc, PGXACT *pgxact,
 	if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
+
+	/* Invalidate snapshots built before this transaction ended */
+	ShmemVariableCache->xactCompletionCount++;
 }
 
 /*
@@ -602,11 +621,15 @@ ProcArrayClearTransaction(PGPROC *proc)
 	PGXACT	   *pgxact = &allPgXact[proc->pgprocno];
 
 	/*
-	 * We can skip locking ProcArrayLock here, because this action does not
-	 * actually change anyone's view of the set of running XIDs: our entry is
-	 * duplicate with the gxact that has already been inserted into the
-	 * ProcArray.
+	 * This action does not actually change anyone's view of the set of
+	 * running XIDs: our entry is duplicate with the gxact that has already
+	 * been inserted into the ProcArray.  But we must take ProcArrayLock to
+	 * advance xactCompletionCount: snapshots we built before this point
+	 * exclude our XID, and must not be reused now that it belongs to the
+	 * prepared transaction.
 	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+
 	pgxact->xid = InvalidTransactionId;
 	proc->lxid = InvalidLocalTransactionId;
 	pgxact->xmin = InvalidTransactionId;
@@ -619,6 +642,10 @@ ProcArrayClearTransaction(PGPROC *proc)
 	/* Clear the subtransaction-XID cache too */
 	pgxact->nxids = 0;
 	pgxact->overflowed = false;
+
+	ShmemVariableCache->xactCompletionCount++;
+
+	LWLockRelease(ProcArrayLock);
 }
 
 /*
@@ -876,6 +903,8 @@ ProcArrayApplyRecoveryInfo(RunningTransactions running)
 							  running->latestCompletedXid))
 		ShmemVariableCache->latestCompletedXid = running->latestCompletedXid;
 
+	ShmemVariableCache->xactCompletionCount++;
+
 	Assert(TransactionIdIsNormal(ShmemVariableCache->latestCompletedXid));
 
 	LWLockRelease(ProcArrayLock);
@@ -1462,7 +1491,8 @@ GetMaxSnapshotXidCount(void)
 int
 GetMaxSnapshotSubxidCount(void)
 {
-	return TOTAL_MAX_CACHED_SUBXIDS;
+	/* max_cached_subxids is never below PGPROC_MAX_CACHED_SUBXIDS */
+	return (max_cached_subxids + 1) * PROCARRAY_MAXPROCS;
 }
 
 /*
@@ -1498,6 +1528,10 @@ GetMaxSnapshotSubxidCount(void)
  *		RecentGlobalDataXmin: the global xmin for non-catalog tables
  *			>= RecentGlobalXmin
  *
+ * If no transaction has completed since the snapshot in *snapshot was
+ * built, its contents are reused without scanning the ProcArray, see
+ * GetSnapshotDataReuse().
+ *
  * Note: this function should probably not be called with an argument that's
  * not statically allocated (see xip allocation below).
  */
@@ -1514,6 +1548,7 @@ GetSnapshotData(Snapshot snapshot)
 	bool		suboverflowed = false;
 	TransactionId replication_slot_xmin = InvalidTransactionId;
 	TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
+	uint64		curXactCompletionCount;
 
 	Assert(snapshot != NULL);
 
@@ -1555,6 +1590,11 @@ GetSnapshotData(Snapshot snapshot)
 	 */
 	LWLockAcquire(ProcArrayLock, LW_SHARED);
 
+	if (GetSnapshotDataReuse(snapshot))
+		return snapshot;
+
+	curXactCompletionCount = ShmemVariableCache->xactCompletionCount;
+
 	/* xmax is always latestCompletedXid + 1 */
 	xmax = ShmemVariableCache->latestCompletedXid;
 	Assert(TransactionIdIsNormal(xmax));
@@ -1720,6 +1760,97 @@ GetSnapshotData(Snapshot snapshot)
 		globalxmin = xmin;
 
 	/* Update global variables too */
+	snapshotGlobalXmin = globalxmin;
+	SetRecentGlobalXmins(globalxmin, replication_slot_xmin,
+						 replication_slot_catalog_xmin);
+
+	RecentXmin = xmin;
+
+	snapshot->xmin = xmin;
+	snapshot->xmax = xmax;
+	snapshot->xcnt = count;
+	snapshot->subxcnt = subcount;
+	snapshot->suboverflowed = suboverflowed;
+	snapshot->snapXactCompletionCount = curXactCompletionCount;
+
+	snapshot->curcid = GetCurrentCommandId(false);
+
+	/*
+	 * This is a new snapshot, so set both refcounts are zero, and mark it as
+	 * not copied in persistent memory.
+	 */
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+	snapshot->copied = false;
+
+	GetSnapshotDataInitOldSnapshot(snapshot);
+
+	return snapshot;
+}
+
+/*
+ * GetSnapshotDataReuse -- helper for GetSnapshotData
+ *
+ * If no transaction that had an XID has ended since *snapshot was built by
+ * GetSnapshotData(), building it again would yield exactly the same xmin,
+ * xmax and XID arrays: none of the transactions it considers running can
+ * have finished, and any transaction that has been assigned an XID since
+ * has one that is >= xmax and is treated as running anyway.  In that case
+ * we update the remaining fields and return true, having released
+ * ProcArrayLock, which the caller must hold in shared mode.  This keeps the
+ * cost of taking snapshots independent of the number of backends in
+ * read-mostly workloads, such as many mostly idle connections.
+ *
+ * The global xmin computed by the last full scan can only be older than a
+ * fresh one would be, which is safe.
+ */
+static bool
+GetSnapshotDataReuse(Snapshot snapshot)
+{
+	TransactionId replication_slot_xmin;
+	TransactionId replication_slot_catalog_xmin;
+
+	if (snapshot->snapXactCompletionCount == 0 ||
+		snapshot->snapXactCompletionCount !=
+		ShmemVariableCache->xactCompletionCount)
+		return false;
+
+	/* Recovery ending invalidates it too, but be sure */
+	if (snapshot->takenDuringRecovery != RecoveryInProgress())
+		return false;
+
+	replication_slot_xmin = procArray->replication_slot_xmin;
+	replication_slot_catalog_xmin = procArray->replication_slot_catalog_xmin;
+
+	if (!TransactionIdIsValid(MyPgXact->xmin))
+		MyPgXact->xmin = TransactionXmin = snapshot->xmin;
+
+	LWLockRelease(ProcArrayLock);
+
+	SetRecentGlobalXmins(snapshotGlobalXmin, replication_slot_xmin,
+						 replication_slot_catalog_xmin);
+
+	RecentXmin = snapshot->xmin;
+
+	snapshot->curcid = GetCurrentCommandId(false);
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+	snapshot->copied = false;
+
+	GetSnapshotDataInitOldSnapshot(snapshot);
+
+	return true;
+}
+
+/*
+ * Set RecentGlobalXmin and RecentGlobalDataXmin from the oldest xmin of the
+ * running transactions and the replication slot horizons.
+ */
+static void
+SetRecentGlobalXmins(TransactionId globalxmin,
+					 TransactionId replication_slot_xmin,
+					 TransactionId replication_slot_catalog_xmin)
+{
 	RecentGlobalXmin = globalxmin - vacuum_defer_cleanup_age;
 	if (!TransactionIdIsNormal(RecentGlobalXmin))
 		RecentGlobalXmin = FirstNormalTransactionId;
@@ -1739,25 +1870,15 @@ GetSnapshotData(Snapshot snapshot)
 	if (TransactionIdIsNormal(replication_slot_catalog_xmin) &&
 		NormalTransactionIdPrecedes(replication_slot_catalog_xmin, RecentGlobalXmin))
 		RecentGlobalXmin = replication_slot_catalog_xmin;
+}
 
-	RecentXmin = xmin;
-
-	snapshot->xmin = xmin;
-	snapshot->xmax = xmax;
-	snapshot->xcnt = count;
-	snapshot->subxcnt = subcount;
-	snapshot->suboverflowed = suboverflowed;
-
-	snapshot->curcid = GetCurrentCommandId(false);
-
-	/*
-	 * This is a new snapshot, so set both refcounts are zero, and mark it as
-	 * not copied in persistent memory.
-	 */
-	snapshot->active_count = 0;
-	snapshot->regd_count = 0;
-	snapshot->copied = false;
-
+/*
+ * Fill in the "snapshot too old" fields of a snapshot being returned by
+ * GetSnapshotData.
+ */
+static void
+GetSnapshotDataInitOldSnapshot(Snapshot snapshot)
+{
 	if (old_snapshot_threshold < 0)
 	{
 		/*
@@ -1776,10 +1897,8 @@ GetSnapshotData(Snapshot snapshot)
 		 */
 		snapshot->lsn = GetXLogInsertRecPtr();
 		snapshot->whenTaken = GetSnapshotCurrentTimestamp();
-		MaintainOldSnapshotTimeMapping(snapshot->whenTaken, xmin);
+		MaintainOldSnapshotTimeMapping(snapshot->whenTaken, snapshot->xmin);
 	}
-
-	return snapshot;
 }
 
 /*
@@ -2016,7 +2135,12 @@ GetRunningTransactionData(void)
 		if (TransactionIdPrecedes(xid, oldestRunningXid))
 			oldestRunningXid = xid;
 
-		if (pgxact->overflowed)
+		/*
+		 * A standby can only hold PGPROC_MAX_CACHED_SUBXIDS subxids per
+		 * transaction in KnownAssignedXids, so treat a larger cache as
+		 * overflowed for the purposes of the running-xacts record.
+		 */
+		if (pgxact->overflowed || pgxact->nxids > PGPROC_MAX_CACHED_SUBXIDS)
 			suboverflowed = true;
 
 		/*
@@ -3102,6 +3226,8 @@ XidCacheRemoveRunningXids(TransactionId xid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
 
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -3283,6 +3409,8 @@ ExpireTreeKnownAssignedTransactionIds(TransactionId xid, int nsubxids,
 							  max_xid))
 		ShmemVariableCache->latestCompletedXid = max_xid;
 
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -3295,6 +3423,7 @@ ExpireAllKnownAssignedTransactionIds(void)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(InvalidTransactionId);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -3307,6 +3436,7 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(xid);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -43,12 +43,12 @@
  * smallest nextMsgNum --- it may lag behind.  We only update it when
  * SICleanupQueue is called, and we try not to do that often.)
  *
- * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
- * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
- * in the buffer.  If the buffer does overflow, we recover by setting the
+ * In reality, the messages are stored in a circular buffer of
+ * sinval_queue_size entries, rounded up to a power of 2 (we call the result
+ * the queue size, kept in maxNumMessages).  We translate MsgNum values into
+ * circular-buffer indexes by masking off the high bits of MsgNum.  As long
+ * as maxMsgNum doesn't exceed minMsgNum by more than the queue size, we have
+ * enough space in the buffer.  If the buffer does overflow, we recover by setting the
  * "reset" flag for each backend that has fallen too far behind.  A backend
  * that is in "reset" state is ignored while determining minMsgNum.  When
  * it does finally attempt to receive inval messages, it must discard all
@@ -74,7 +74,7 @@
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
- * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
+ * the queue size so that the existing circular-buffer entries don't need
  * to be moved when we do it.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
@@ -107,11 +107,14 @@
 /*
  * Configurable parameters.
  *
- * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * sinval_queue_size (GUC): max number of shared-inval messages we can
+ * buffer.  Rounded up to a power of 2 for speed; the rounded value is
+ * kept in shared memory as maxNumMessages.  A larger queue lets backends
+ * that are idle or busy fall further behind before they have to be reset,
+ * which matters for workloads issuing lots of small DDL commands.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of the queue size.  Should be large.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -128,13 +131,18 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
-#define CLEANUP_MIN (MAXNUMMESSAGES / 2)
-#define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
-#define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
+#define MAX_SINVAL_QUEUE_SIZE (1 << 20)
+#define MSGNUMWRAPAROUND (1 << 30)
+#define CLEANUP_MIN(segP) ((segP)->maxNumMessages / 2)
+#define CLEANUP_QUANTUM(segP) ((segP)->maxNumMessages / 16)
+#define SIG_THRESHOLD(segP) ((segP)->maxNumMessages / 2)
 #define WRITE_QUANTUM 64
 
+/* Translate a MsgNum into an index into the circular buffer */
+#define MSGNUM_TO_INDEX(segP, msgnum) ((msgnum) & ((segP)->maxNumMessages - 1))
+
+int			sinval_queue_size = 4096;
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -175,13 +183,15 @@ typedef struct SISeg
 	int			nextThreshold;	/* # of messages to call SICleanupQueue */
 	int			lastBackend;	/* index of last active procState entry, +1 */
 	int			maxBackends;	/* size of procState array */
+	int			maxNumMessages; /* size of buffer array, a power of 2 */
 
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
 	/*
-	 * Circular buffer holding shared-inval messages
+	 * Circular buffer holding shared-inval messages.  It lives in the same
+	 * shared memory chunk, just past the procState array.
 	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
+	SharedInvalidationMessage *buffer;
 
 	/*
 	 * Per-backend invalidation state info (has MaxBackends entries).
@@ -197,6 +207,34 @@ static LocalTransactionId nextLocalTransactionId;
 static void CleanupInvalidationState(int status, Datum arg);
 
 
+/*
+ * SInvalQueueSize --- sinval_queue_size rounded up to a power of 2
+ */
+static int
+SInvalQueueSize(void)
+{
+	int			nmsgs = 1;
+
+	while (nmsgs < sinval_queue_size && nmsgs < MAX_SINVAL_QUEUE_SIZE)
+		nmsgs <<= 1;
+
+	return nmsgs;
+}
+
+/*
+ * SInvalBufferOffset --- offset of the message buffer within SISeg
+ */
+static Size
+SInvalBufferOffset(void)
+{
+	Size		size;
+
+	size = offsetof(SISeg, procState);
+	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
+
+	return MAXALIGN(size);
+}
+
 /*
  * SInvalShmemSize --- return shared-memory space needed
  */
@@ -205,8 +243,9 @@ SInvalShmemSize(void)
 {
 	Size		size;
 
-	size = offsetof(SISeg, procState);
-	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
+	size = SInvalBufferOffset();
+	size = add_size(size, mul_size(sizeof(SharedInvalidationMessage),
+								   SInvalQueueSize()));
 
 	return size;
 }
@@ -227,12 +266,18 @@ CreateSharedInvalidationState(void)
 	if (found)
 		return;
 
-	/* Clear message counters, save size of procState array, init spinlock */
+	/*
+	 * Clear message counters, save sizes of procState and buffer arrays, init
+	 * spinlock
+	 */
 	shmInvalBuffer->minMsgNum = 0;
 	shmInvalBuffer->maxMsgNum = 0;
-	shmInvalBuffer->nextThreshold = CLEANUP_MIN;
 	shmInvalBuffer->lastBackend = 0;
 	shmInvalBuffer->maxBackends = MaxBackends;
+	shmInvalBuffer->maxNumMessages = SInvalQueueSize();
+	shmInvalBuffer->nextThreshold = CLEANUP_MIN(shmInvalBuffer);
+	shmInvalBuffer->buffer = (SharedInvalidationMessage *)
+		((char *) shmInvalBuffer + SInvalBufferOffset());
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
 	/* The buffer[] array is initially all unused, so we need not fill it */
@@ -467,7 +512,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		for (;;)
 		{
 			numMsgs = segP->maxMsgNum - segP->minMsgNum;
-			if (numMsgs + nthistime > MAXNUMMESSAGES ||
+			if (numMsgs + nthistime > segP->maxNumMessages ||
 				numMsgs >= segP->nextThreshold)
 				SICleanupQueue(true, nthistime);
 			else
@@ -480,7 +525,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			segP->buffer[MSGNUM_TO_INDEX(segP, max)] = *data++;
 			max++;
 		}
 
@@ -603,7 +648,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = segP->buffer[MSGNUM_TO_INDEX(segP, stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -663,8 +708,8 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * a problem even when they are the only active backend.
 	 */
 	min = segP->maxMsgNum;
-	minsig = min - SIG_THRESHOLD;
-	lowbound = min - MAXNUMMESSAGES + minFree;
+	minsig = min - SIG_THRESHOLD(segP);
+	lowbound = min - segP->maxNumMessages + minFree;
 
 	for (i = 0; i < segP->lastBackend; i++)
 	{
@@ -720,10 +765,11 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * threshold at which we should repeat SICleanupQueue().
 	 */
 	numMsgs = segP->maxMsgNum - segP->minMsgNum;
-	if (numMsgs < CLEANUP_MIN)
-		segP->nextThreshold = CLEANUP_MIN;
+	if (numMsgs < CLEANUP_MIN(segP))
+		segP->nextThreshold = CLEANUP_MIN(segP);
 	else
-		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM + 1) * CLEANUP_QUANTUM;
+		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM(segP) + 1) *
+			CLEANUP_QUANTUM(segP);
 
 	/*
 	 * Lastly, signal anyone who needs a catchup interrupt.  Since
@@ -42,6 +42,7 @@
 #include "catalog/objectaccess.h"
 #include "catalog/pg_largeobject.h"
 #include "catalog/pg_largeobject_metadata.h"
+#include "executor/tuptable.h"
 #include "libpq/libpq-fs.h"
 #include "miscadmin.h"
 #include "storage/large_object.h"
@@ -582,6 +583,27 @@ inv_read(LargeObjectDesc *obj_desc, char *buf, int nbytes)
 	return nread;
 }
 
+/*
+ * Brand-new pages written by one inv_write call are inserted in batches of up
+ * to this many, with a single heap_multi_insert per batch.
+ */
+#define LO_MULTI_INSERT_PAGES	32
+
+/*
+ * Insert the pending new pages of inv_write, and clear their slots.
+ */
+static void
+inv_flush_new_pages(TupleTableSlot **slots, int npending,
+					CatalogIndexState indstate)
+{
+	int			i;
+
+	CatalogTuplesMultiInsertWithInfo(lo_heap_r, slots, npending, indstate);
+
+	for (i = 0; i < npending; i++)
+		ExecClearTuple(slots[i]);
+}
+
 int
 inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 {
@@ -611,6 +633,10 @@ inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 	bool		nulls[Natts_pg_largeobject];
 	bool		replace[Natts_pg_largeobject];
 	CatalogIndexState indstate;
+	TupleTableSlot *slots[LO_MULTI_INSERT_PAGES];
+	int			nslots = 0;
+	int			npending = 0;
+	int			i;
 
 	Assert(PointerIsValid(obj_desc));
 	Assert(buf != NULL);
@@ -760,12 +786,31 @@ inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 			values[Anum_pg_largeobject_pageno - 1] = Int32GetDatum(pageno);
 			values[Anum_pg_largeobject_data - 1] = PointerGetDatum(&workbuf);
 			newtup = heap_form_tuple(lo_heap_r->rd_att, values, nulls);
-			CatalogTupleInsertWithInfo(lo_heap_r, newtup, indstate);
-			heap_freetuple(newtup);
+
+			/*
+			 * Queue it for insertion.  Sequential writes to a new object
+			 * produce nothing but new pages, so batching them up saves most
+			 * of the per-page heap insertion work.
+			 */
+			if (npending == nslots)
+				slots[nslots++] =
+					MakeSingleTupleTableSlot(RelationGetDescr(lo_heap_r),
+											 &TTSOpsHeapTuple);
+			ExecStoreHeapTuple(newtup, slots[npending++], true);
+			if (npending == LO_MULTI_INSERT_PAGES)
+			{
+				inv_flush_new_pages(slots, npending, indstate);
+				npending = 0;
+			}
 		}
 		pageno++;
 	}
 
+	if (npending > 0)
+		inv_flush_new_pages(slots, npending, indstate);
+	for (i = 0; i < nslots; i++)
+		ExecDropSingleTupleTableSlot(slots[i]);
+
 	systable_endscan_ordered(sd);
 
 	CatalogCloseIndexes(indstate);
@@ -284,6 +284,45 @@ DeadLockCheck(PGPROC *proc)
 		return DS_NO_DEADLOCK;
 }
 
+/*
+ * DeadLockCheckQuick -- Checks whether a process is free of deadlocks
+ *
+ * This performs just the first step of DeadLockCheck: looking for any cycle,
+ * hard or soft, in the waits-for graph through the given process.  If there
+ * is none, which is by far the usual outcome, DeadLockCheck would return
+ * without modifying any shared state, so we can report its result here
+ * without having taken exclusive locks.  We store the result in *state and
+ * return true.
+ *
+ * Otherwise we return false, and the caller must run the full DeadLockCheck
+ * to resolve or report the deadlock.
+ *
+ * Caller must hold all partitions of the lock tables, but shared locks are
+ * sufficient.
+ */
+bool
+DeadLockCheckQuick(PGPROC *proc, DeadLockState *state)
+{
+	int			nSoftEdges;
+
+	/* Initialize to "no constraints", as DeadLockCheck does */
+	nCurConstraints = 0;
+	nPossibleConstraints = 0;
+	nWaitOrders = 0;
+
+	/* Initialize to not blocked by an autovacuum worker */
+	blocking_autovacuum_proc = NULL;
+
+	if (FindLockCycle(proc, possibleConstraints, &nSoftEdges))
+		return false;
+
+	if (blocking_autovacuum_proc != NULL)
+		*state = DS_BLOCKED_BY_AUTOVACUUM;
+	else
+		*state = DS_NO_DEADLOCK;
+	return true;
+}
+
 /*
  * Return the PGPROC of the autovacuum that's blocking a process.
  *
@@ -1088,6 +1088,40 @@ UnlockSharedObjectForSession(Oid classid, Oid objid, uint16 objsubid,
 	LockRelease(&tag, lockmode, true);
 }
 
+/*
+ *		LockApplyTransactionForSession
+ *
+ * Obtain a session-level lock on a remote transaction being applied by a
+ * logical replication parallel apply worker.  The worker applying the
+ * transaction holds it in AccessExclusiveLock mode until the transaction has
+ * committed locally; other workers wait for that by acquiring it in
+ * ShareLock mode, which lets the deadlock detector see those waits.
+ */
+void
+LockApplyTransactionForSession(Oid suboid, TransactionId xid,
+							   LOCKMODE lockmode)
+{
+	LOCKTAG		tag;
+
+	SET_LOCKTAG_APPLY_TRANSACTION(tag, MyDatabaseId, suboid, xid);
+
+	(void) LockAcquire(&tag, lockmode, true, false);
+}
+
+/*
+ *		UnlockApplyTransactionForSession
+ */
+void
+UnlockApplyTransactionForSession(Oid suboid, TransactionId xid,
+								 LOCKMODE lockmode)
+{
+	LOCKTAG		tag;
+
+	SET_LOCKTAG_APPLY_TRANSACTION(tag, MyDatabaseId, suboid, xid);
+
+	LockRelease(&tag, lockmode, true);
+}
+
 
 /*
  * Append a description of a lockable object to buf.
@@ -1118,6 +1152,13 @@ DescribeLockTag(StringInfo buf, const LOCKTAG *tag)
 							 _("pg_database.datfrozenxid of database %u"),
 							 tag->locktag_field1);
 			break;
+		case LOCKTAG_APPLY_TRANSACTION:
+			appendStringInfo(buf,
+							 _("remote transaction %u of subscription %u of database %u"),
+							 tag->locktag_field3,
+							 tag->locktag_field2,
+							 tag->locktag_field1);
+			break;
 		case LOCKTAG_PAGE:
 			appendStringInfo(buf,
 							 _("page %u of relation %u of database %u"),
@@ -79,6 +79,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "pg_trace.h"
+#include "portability/instr_time.h"
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
 #include "storage/ipc.h"
@@ -157,11 +158,29 @@ NamedLWLockTranche *NamedLWLockTrancheArray = NULL;
 
 static bool lock_named_request_allowed = true;
 
+/*
+ * Contention statistics (see track_lwlock_stats).  LWLockStatsArray holds one
+ * cache-line-aligned array of LWLOCK_STATS_NUM_TRANCHES entries per PGPROC,
+ * and MyLWLockStats points to ours; it stays NULL if tracking is disabled or
+ * we have no PGPROC, which is the only test made in the lock fast paths.
+ */
+bool		track_lwlock_stats = false;
+LWLockTrancheStats *LWLockStatsArray = NULL;
+static LWLockTrancheStats *MyLWLockStats = NULL;
+
+#define LWLOCK_STATS_PROC_SIZE \
+	CACHELINEALIGN(LWLOCK_STATS_NUM_TRANCHES * sizeof(LWLockTrancheStats))
+#define LWLOCK_STATS_NUM_PROCS	(MaxBackends + NUM_AUXILIARY_PROCS)
+
+#define LWLockStatsEntry(lock) \
+	(&MyLWLockStats[Min((lock)->tranche, LWTRANCHE_FIRST_USER_DEFINED)])
+
 static void InitializeLWLocks(void);
 static void RegisterLWLockTranches(void);
 
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
+static void LWLockStatsCountWait(LWLock *lock, instr_time *wait_start);
 
 #ifdef LWLOCK_STATS
 typedef struct lwlock_stats_key
@@ -368,6 +387,13 @@ LWLockShmemSize(void)
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
 		size = add_size(size, strlen(NamedLWLockTrancheRequestArray[i].tranche_name) + 1);
 
+	/* space for contention statistics, plus room for alignment */
+	if (track_lwlock_stats)
+		size = add_size(size,
+						add_size(mul_size(LWLOCK_STATS_NUM_PROCS,
+										  LWLOCK_STATS_PROC_SIZE),
+								 PG_CACHE_LINE_SIZE));
+
 	/* Disallow named LWLocks' requests after startup */
 	lock_named_request_allowed = false;
 
@@ -414,6 +440,18 @@ CreateLWLocks(void)
 
 		/* Initialize all LWLocks */
 		InitializeLWLocks();
+
+		/* Set up the contention statistics area, if wanted */
+		if (track_lwlock_stats)
+		{
+			Size		statsSize = mul_size(LWLOCK_STATS_NUM_PROCS,
+											 LWLOCK_STATS_PROC_SIZE);
+
+			ptr = (char *) ShmemAlloc(statsSize + PG_CACHE_LINE_SIZE);
+			ptr = (char *) CACHELINEALIGN(ptr);
+			MemSet(ptr, 0, statsSize);
+			LWLockStatsArray = (LWLockTrancheStats *) ptr;
+		}
 	}
 
 	/* Register all LWLock tranches */
@@ -523,6 +561,13 @@ RegisterLWLockTranches(void)
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_APPEND, "parallel_append");
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_HASH_JOIN, "parallel_hash_join");
 	LWLockRegisterTranche(LWTRANCHE_SXACT, "serializable_xact");
+	LWLockRegisterTranche(LWTRANCHE_RELATION_SIZE_CACHE,
+						  "relation_size_cache");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_CATCACHE, "shared_catcache");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_PLANCACHE, "shared_plancache");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_PLANCACHE_DSA,
+						  "shared_plancache_dsa");
+	LWLockRegisterTranche(LWTRANCHE_SEQUENCE_CACHE, "sequence_cache");
 
 	/* Register named tranches. */
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
@@ -539,6 +584,83 @@ InitLWLockAccess(void)
 #ifdef LWLOCK_STATS
 	init_lwlock_stats();
 #endif
+
+	if (LWLockStatsArray != NULL && MyProc != NULL)
+	{
+		Assert(MyProc->pgprocno < LWLOCK_STATS_NUM_PROCS);
+		MyLWLockStats = (LWLockTrancheStats *)
+			((char *) LWLockStatsArray +
+			 (Size) MyProc->pgprocno * LWLOCK_STATS_PROC_SIZE);
+	}
+}
+
+/*
+ * LWLockGetStats - sum up the contention statistics of all backends
+ *
+ * "stats" must have room for LWLOCK_STATS_NUM_TRANCHES entries.  The counters
+ * of other backends are read without any locking, so the result is only
+ * approximately consistent, which is fine for monitoring purposes.
+ */
+void
+LWLockGetStats(LWLockTrancheStats *stats)
+{
+	int			procno;
+	int			i;
+	int			j;
+
+	MemSet(stats, 0, LWLOCK_STATS_NUM_TRANCHES * sizeof(LWLockTrancheStats));
+
+	if (LWLockStatsArray == NULL)
+		return;
+
+	for (procno = 0; procno < LWLOCK_STATS_NUM_PROCS; procno++)
+	{
+		volatile LWLockTrancheStats *procstats;
+
+		procstats = (LWLockTrancheStats *)
+			((char *) LWLockStatsArray + (Size) procno * LWLOCK_STATS_PROC_SIZE);
+
+		for (i = 0; i < LWLOCK_STATS_NUM_TRANCHES; i++)
+		{
+			stats[i].sh_acquire_count += procstats[i].sh_acquire_count;
+			stats[i].ex_acquire_count += procstats[i].ex_acquire_count;
+			stats[i].block_count += procstats[i].block_count;
+			stats[i].spin_delay_count += procstats[i].spin_delay_count;
+			stats[i].wait_time += procstats[i].wait_time;
+			for (j = 0; j < LWLOCK_STATS_WAIT_BUCKETS; j++)
+				stats[i].wait_hist[j] += procstats[i].wait_hist[j];
+		}
+	}
+}
+
+/*
+ * Account for a sleep on an LWLock that started at *wait_start.
+ */
+static void
+LWLockStatsCountWait(LWLock *lock, instr_time *wait_start)
+{
+	LWLockTrancheStats *stats = LWLockStatsEntry(lock);
+	instr_time	wait_time;
+	uint64		usecs;
+	uint64		bound;
+	int			bucket;
+
+	INSTR_TIME_SET_CURRENT(wait_time);
+	INSTR_TIME_SUBTRACT(wait_time, *wait_start);
+	usecs = INSTR_TIME_GET_MICROSEC(wait_time);
+
+	stats->block_count++;
+	stats->wait_time += usecs;
+
+	/* bucket i counts sleeps shorter than 10^(i+1) usecs; last is open */
+	bound = 10;
+	for (bucket = 0; bucket < LWLOCK_STATS_WAIT_BUCKETS - 1; bucket++)
+	{
+		if (usecs < bound)
+			break;
+		bound *= 10;
+	}
+	stats->wait_hist[bucket]++;
 }
 
 /*
@@ -840,6 +962,8 @@ LWLockWaitListLock(LWLock *lock)
 #ifdef LWLOCK_STATS
 			delays += delayStatus.delays;
 #endif
+			if (MyLWLockStats != NULL)
+				LWLockStatsEntry(lock)->spin_delay_count += delayStatus.delays;
 			finish_spin_delay(&delayStatus);
 		}
 
@@ -1125,6 +1249,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1135,6 +1260,14 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 	PRINT_LWDEBUG("LWLockAcquire", lock, mode);
 
+	if (MyLWLockStats != NULL)
+	{
+		if (mode == LW_EXCLUSIVE)
+			LWLockStatsEntry(lock)->ex_acquire_count++;
+		else
+			LWLockStatsEntry(lock)->sh_acquire_count++;
+	}
+
 #ifdef LWLOCK_STATS
 	/* Count lock acquisition attempts */
 	if (mode == LW_EXCLUSIVE)
@@ -1240,6 +1373,10 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		LWLockReportWaitStart(lock);
 		TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
 
+		INSTR_TIME_SET_ZERO(wait_start);
+		if (MyLWLockStats != NULL)
+			INSTR_TIME_SET_CURRENT(wait_start);
+
 		for (;;)
 		{
 			PGSemaphoreLock(proc->sem);
@@ -1248,6 +1385,9 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			extraWaits++;
 		}
 
+		if (MyLWLockStats != NULL)
+			LWLockStatsCountWait(lock, &wait_start);
+
 		/* Retrying, allow LWLockRelease to release waiters again. */
 		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
 
@@ -1352,6 +1492,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		mustwait;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1362,6 +1503,14 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 
 	PRINT_LWDEBUG("LWLockAcquireOrWait", lock, mode);
 
+	if (MyLWLockStats != NULL)
+	{
+		if (mode == LW_EXCLUSIVE)
+			LWLockStatsEntry(lock)->ex_acquire_count++;
+		else
+			LWLockStatsEntry(lock)->sh_acquire_count++;
+	}
+
 	/* Ensure we will have room to remember the lock */
 	if (num_held_lwlocks >= MAX_SIMUL_LWLOCKS)
 		elog(ERROR, "too many LWLocks taken");
@@ -1401,6 +1550,10 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 			LWLockReportWaitStart(lock);
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
 
+			INSTR_TIME_SET_ZERO(wait_start);
+			if (MyLWLockStats != NULL)
+				INSTR_TIME_SET_CURRENT(wait_start);
+
 			for (;;)
 			{
 				PGSemaphoreLock(proc->sem);
@@ -1409,6 +1562,9 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 				extraWaits++;
 			}
 
+			if (MyLWLockStats != NULL)
+				LWLockStatsCountWait(lock, &wait_start);
+
 #ifdef LOCK_DEBUG
 			{
 				/* not waiting anymore */
@@ -1536,6 +1692,7 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 	PGPROC	   *proc = MyProc;
 	int			extraWaits = 0;
 	bool		result = false;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1617,6 +1774,10 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 		LWLockReportWaitStart(lock);
 		TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), LW_EXCLUSIVE);
 
+		INSTR_TIME_SET_ZERO(wait_start);
+		if (MyLWLockStats != NULL)
+			INSTR_TIME_SET_CURRENT(wait_start);
+
 		for (;;)
 		{
 			PGSemaphoreLock(proc->sem);
@@ -1625,6 +1786,9 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 			extraWaits++;
 		}
 
+		if (MyLWLockStats != NULL)
+			LWLockStatsCountWait(lock, &wait_start);
+
 #ifdef LOCK_DEBUG
 		{
 			/* not waiting anymore */
@@ -823,8 +823,8 @@ OldSerXidInit(void)
 	 */
 	OldSerXidSlruCtl->PagePrecedes = OldSerXidPagePrecedesLogically;
 	SimpleLruInit(OldSerXidSlruCtl, "oldserxid",
-				  NUM_OLDSERXID_BUFFERS, 0, OldSerXidLock, "pg_serial",
-				  LWTRANCHE_OLDSERXID_BUFFERS);
+				  NUM_OLDSERXID_BUFFERS, 0, "pg_serial",
+				  LWTRANCHE_OLDSERXID_BUFFERS, LWTRANCHE_OLDSERXID_BANK);
 	/* Override default assumption that writes should be fsync'd */
 	OldSerXidSlruCtl->do_fsync = false;
 
@@ -859,11 +859,16 @@ OldSerXidAdd(TransactionId xid, SerCommitSeqNo minConflictCommitSeqNo)
 	int			slotno;
 	int			firstZeroPage;
 	bool		isNewPage;
+	LWLock	   *lock;
 
 	Assert(TransactionIdIsValid(xid));
 
 	targetPage = OldSerXidPage(xid);
 
+	/*
+	 * OldSerXidLock protects oldSerXidControl; the SLRU pages are protected
+	 * by their bank locks, which we take while holding OldSerXidLock.
+	 */
 	LWLockAcquire(OldSerXidLock, LW_EXCLUSIVE);
 
 	/*
@@ -903,17 +908,27 @@ OldSerXidAdd(TransactionId xid, SerCommitSeqNo minConflictCommitSeqNo)
 		/* Initialize intervening pages. */
 		while (firstZeroPage != targetPage)
 		{
+			lock = SimpleLruGetBankLock(OldSerXidSlruCtl, firstZeroPage);
+			LWLockAcquire(lock, LW_EXCLUSIVE);
 			(void) SimpleLruZeroPage(OldSerXidSlruCtl, firstZeroPage);
+			LWLockRelease(lock);
 			firstZeroPage = OldSerXidNextPage(firstZeroPage);
 		}
+		lock = SimpleLruGetBankLock(OldSerXidSlruCtl, targetPage);
+		LWLockAcquire(lock, LW_EXCLUSIVE);
 		slotno = SimpleLruZeroPage(OldSerXidSlruCtl, targetPage);
 	}
 	else
+	{
+		lock = SimpleLruGetBankLock(OldSerXidSlruCtl, targetPage);
+		LWLockAcquire(lock, LW_EXCLUSIVE);
 		slotno = SimpleLruReadPage(OldSerXidSlruCtl, targetPage, true, xid);
+	}
 
 	OldSerXidValue(slotno, xid) = minConflictCommitSeqNo;
 	OldSerXidSlruCtl->shared->page_dirty[slotno] = true;
 
+	LWLockRelease(lock);
 	LWLockRelease(OldSerXidLock);
 }
 
@@ -947,13 +962,13 @@ OldSerXidGetMinConflictCommitSeqNo(TransactionId xid)
 		return 0;
 
 	/*
-	 * The following function must be called without holding OldSerXidLock,
-	 * but will return with that lock held, which must then be released.
+	 * The following function must be called without holding the page's bank
+	 * lock, but will return with that lock held, which must then be released.
 	 */
 	slotno = SimpleLruReadPage_ReadOnly(OldSerXidSlruCtl,
 										OldSerXidPage(xid), xid);
 	val = OldSerXidValue(slotno, xid);
-	LWLockRelease(OldSerXidLock);
+	LWLockRelease(SimpleLruGetBankLock(OldSerXidSlruCtl, OldSerXidPage(xid)));
 	return val;
 }
 
@@ -4063,6 +4078,7 @@ CheckForSerializableConflictOut(bool visible, Relation relation,
 	SERIALIZABLEXID *sxid;
 	SERIALIZABLEXACT *sxact;
 	HTSV_Result htsvResult;
+	LWLockMode	lockmode;
 
 	if (!SerializationNeededForRead(relation, snapshot))
 		return;
@@ -4148,11 +4164,28 @@ CheckForSerializableConflictOut(bool visible, Relation relation,
 	if (TransactionIdEquals(xid, GetTopTransactionIdIfAny()))
 		return;
 
+	/*
+	 * A write that was already visible to our snapshot can't be a conflict.
+	 * XidIsConcurrent() looks only at our own snapshot, so make this test
+	 * before touching any shared state; it disposes of old row versions
+	 * whose xmin is merely newer than TransactionXmin, which are common in
+	 * update-heavy workloads, without taking SerializableXactHashLock.
+	 */
+	if (!XidIsConcurrent(xid))
+		return;
+
 	/*
 	 * Find sxact or summarized info for the top level xid.
+	 *
+	 * Most checks end up finding nothing to do, so start with a shared lock.
+	 * If we find we must modify some transaction's state, upgrade to an
+	 * exclusive lock and start over, since things may have changed while we
+	 * held no lock.
 	 */
 	sxidtag.xid = xid;
-	LWLockAcquire(SerializableXactHashLock, LW_EXCLUSIVE);
+	lockmode = LW_SHARED;
+retry:
+	LWLockAcquire(SerializableXactHashLock, lockmode);
 	sxid = (SERIALIZABLEXID *)
 		hash_search(SerializableXidHash, &sxidtag, HASH_FIND, NULL);
 	if (!sxid)
@@ -4184,7 +4217,16 @@ CheckForSerializableConflictOut(bool visible, Relation relation,
 						 errdetail_internal("Reason code: Canceled on identification as a pivot, with conflict out to old committed transaction %u.", xid),
 						 errhint("The transaction might succeed if retried.")));
 
-			MySerializableXact->flags |= SXACT_FLAG_SUMMARY_CONFLICT_OUT;
+			if (!SxactHasSummaryConflictOut(MySerializableXact))
+			{
+				if (lockmode == LW_SHARED)
+				{
+					LWLockRelease(SerializableXactHashLock);
+					lockmode = LW_EXCLUSIVE;
+					goto retry;
+				}
+				MySerializableXact->flags |= SXACT_FLAG_SUMMARY_CONFLICT_OUT;
+			}
 		}
 
 		/* It's not serializable or otherwise not important. */
@@ -4210,6 +4252,12 @@ CheckForSerializableConflictOut(bool visible, Relation relation,
 	{
 		if (!SxactIsPrepared(sxact))
 		{
+			if (lockmode == LW_SHARED)
+			{
+				LWLockRelease(SerializableXactHashLock);
+				lockmode = LW_EXCLUSIVE;
+				goto retry;
+			}
 			sxact->flags |= SXACT_FLAG_DOOMED;
 			LWLockRelease(SerializableXactHashLock);
 			return;
@@ -4241,13 +4289,6 @@ CheckForSerializableConflictOut(bool visible, Relation relation,
 		return;
 	}
 
-	if (!XidIsConcurrent(xid))
-	{
-		/* This write was already in our snapshot; no conflict. */
-		LWLockRelease(SerializableXactHashLock);
-		return;
-	}
-
 	if (RWConflictExists(MySerializableXact, sxact))
 	{
 		/* We don't want duplicate conflict records in the list. */
@@ -4259,6 +4300,12 @@ CheckForSerializableConflictOut(bool visible, Relation relation,
 	 * Flag the conflict.  But first, if this conflict creates a dangerous
 	 * structure, ereport an error.
 	 */
+	if (lockmode == LW_SHARED)
+	{
+		LWLockRelease(SerializableXactHashLock);
+		lockmode = LW_EXCLUSIVE;
+		goto retry;
+	}
 	FlagRWConflict(MySerializableXact, sxact);
 	LWLockRelease(SerializableXactHashLock);
 }
@@ -62,7 +62,10 @@ int			DeadlockTimeout = 1000;
 int			StatementTimeout = 0;
 int			LockTimeout = 0;
 int			IdleInTransactionSessionTimeout = 0;
+int			IdleSessionTimeout = 0;
 bool		log_lock_waits = false;
+int			max_cached_subxids = PGPROC_MAX_CACHED_SUBXIDS;
+int			FastPathLockGroupsPerBackend = 0;	/* set at startup */
 
 /* Pointer to this process's PGPROC and PGXACT structs, if any */
 PGPROC	   *MyProc = NULL;
@@ -94,6 +97,7 @@ static void RemoveProcFromArray(int code, Datum arg);
 static void ProcKill(int code, Datum arg);
 static void AuxiliaryProcKill(int code, Datum arg);
 static void CheckDeadLock(void);
+static Size FastPathLockShmemSize(void);
 
 
 /*
@@ -119,9 +123,36 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(NUM_AUXILIARY_PROCS, sizeof(PGXACT)));
 	size = add_size(size, mul_size(max_prepared_xacts, sizeof(PGXACT)));
 
+	/* Subtransaction XID caches, one per PGPROC */
+	size = add_size(size,
+					mul_size(add_size(add_size(MaxBackends, NUM_AUXILIARY_PROCS),
+									  max_prepared_xacts),
+							 mul_size(max_cached_subxids,
+									  sizeof(TransactionId))));
+
+	/* Fast-path lock arrays, one per PGPROC */
+	size = add_size(size,
+					mul_size(add_size(add_size(MaxBackends, NUM_AUXILIARY_PROCS),
+									  max_prepared_xacts),
+							 FastPathLockShmemSize()));
+
 	return size;
 }
 
+/*
+ * Report the shared memory needed for one PGPROC's fast-path lock arrays.
+ */
+static Size
+FastPathLockShmemSize(void)
+{
+	Assert(FastPathLockGroupsPerBackend > 0);
+
+	return add_size(MAXALIGN(mul_size(FastPathLockGroupsPerBackend,
+									  sizeof(uint64))),
+					MAXALIGN(mul_size(FP_LOCK_SLOTS_PER_BACKEND,
+									  sizeof(Oid))));
+}
+
 /*
  * Report number of semaphores needed by InitProcGlobal.
  */
@@ -165,6 +196,8 @@ InitProcGlobal(void)
 {
 	PGPROC	   *procs;
 	PGXACT	   *pgxacts;
+	TransactionId *subxids;
+	char	   *fpPtr;
 	int			i,
 				j;
 	bool		found;
@@ -190,6 +223,7 @@ InitProcGlobal(void)
 	ProcGlobal->checkpointerLatch = NULL;
 	pg_atomic_init_u32(&ProcGlobal->procArrayGroupFirst, INVALID_PGPROCNO);
 	pg_atomic_init_u32(&ProcGlobal->clogGroupFirst, INVALID_PGPROCNO);
+	pg_atomic_init_u32(&ProcGlobal->walFlushGroupFirst, INVALID_PGPROCNO);
 
 	/*
 	 * Create and initialize all the PGPROC structures we'll need.  There are
@@ -217,9 +251,26 @@ InitProcGlobal(void)
 	MemSet(pgxacts, 0, TotalProcs * sizeof(PGXACT));
 	ProcGlobal->allPgXact = pgxacts;
 
+	/*
+	 * The subtransaction XID caches are sized by max_cached_subxids, so they
+	 * can't be embedded in PGPROC; carve them out of one array instead.
+	 */
+	subxids = (TransactionId *)
+		ShmemAlloc(mul_size(TotalProcs,
+							mul_size(max_cached_subxids, sizeof(TransactionId))));
+
+	/* Likewise for the fast-path lock bits and relation OIDs. */
+	fpPtr = ShmemAlloc(mul_size(TotalProcs, FastPathLockShmemSize()));
+	MemSet(fpPtr, 0, mul_size(TotalProcs, FastPathLockShmemSize()));
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
+		procs[i].subxids.xids = subxids + (Size) i * max_cached_subxids;
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += MAXALIGN(FP_LOCK_SLOTS_PER_BACKEND * sizeof(Oid));
 
 		/*
 		 * Set up per-PGPROC semaphore, latch, and backendLock. Prepared xact
@@ -284,6 +335,7 @@ InitProcGlobal(void)
 		 */
 		pg_atomic_init_u32(&(procs[i].procArrayGroupNext), INVALID_PGPROCNO);
 		pg_atomic_init_u32(&(procs[i].clogGroupNext), INVALID_PGPROCNO);
+		pg_atomic_init_u32(&(procs[i].walFlushGroupNext), INVALID_PGPROCNO);
 	}
 
 	/*
@@ -442,6 +494,11 @@ InitProcess(void)
 	MyProc->clogGroupMemberLsn = InvalidXLogRecPtr;
 	Assert(pg_atomic_read_u32(&MyProc->clogGroupNext) == INVALID_PGPROCNO);
 
+	/* Initialize fields for group WAL flush. */
+	MyProc->walFlushGroupMember = false;
+	MyProc->walFlushGroupLsn = InvalidXLogRecPtr;
+	Assert(pg_atomic_read_u32(&MyProc->walFlushGroupNext) == INVALID_PGPROCNO);
+
 	/*
 	 * Acquire ownership of the PGPROC's latch, so that we can use WaitLatch
 	 * on it.  That allows us to repoint the process latch, which so far
@@ -585,6 +642,9 @@ InitAuxiliaryProcess(void)
 	MyProc->lwWaitMode = 0;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
+	MyProc->walFlushGroupMember = false;
+	MyProc->walFlushGroupLsn = InvalidXLogRecPtr;
+	Assert(pg_atomic_read_u32(&MyProc->walFlushGroupNext) == INVALID_PGPROCNO);
 #ifdef USE_ASSERT_CHECKING
 	{
 		int			i;
@@ -618,6 +678,9 @@ InitAuxiliaryProcess(void)
 	 * Arrange to clean up at process exit.
 	 */
 	on_shmem_exit(AuxiliaryProcKill, Int32GetDatum(proctype));
+
+	/* Initialize local state needed for LWLocks */
+	InitLWLockAccess();
 }
 
 /*
@@ -1690,10 +1753,18 @@ static void
 CheckDeadLock(void)
 {
 	int			i;
+	bool		resolved;
 
 	/*
-	 * Acquire exclusive lock on the entire shared lock data structures. Must
-	 * grab LWLocks in partition-number order to avoid LWLock deadlock.
+	 * Almost always there turns out to be no deadlock, and finding that out
+	 * doesn't require changing anything.  So first take shared locks on the
+	 * entire shared lock data structures and look for a cycle.  This still
+	 * keeps lock acquisition and release out while we look, but unlike the
+	 * exclusive locks needed below, it lets the many backends whose
+	 * deadlock_timeout expires at about the same time during a lock storm
+	 * run their checks concurrently rather than one after another.
+	 *
+	 * Must grab LWLocks in partition-number order to avoid LWLock deadlock.
 	 *
 	 * Note that the deadlock check interrupt had better not be enabled
 	 * anywhere that this process itself holds lock partition locks, else this
@@ -1701,6 +1772,28 @@ CheckDeadLock(void)
 	 * section, so that this routine cannot be interrupted by cancel/die
 	 * interrupts.
 	 */
+	for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+		LWLockAcquire(LockHashPartitionLockByIndex(i), LW_SHARED);
+
+	/* Check to see if we've been awoken by anyone in the interim (below) */
+	if (MyProc->links.prev == NULL ||
+		MyProc->links.next == NULL)
+		resolved = true;
+	else
+		resolved = DeadLockCheckQuick(MyProc, &deadlock_state);
+
+	for (i = NUM_LOCK_PARTITIONS; --i >= 0;)
+		LWLockRelease(LockHashPartitionLockByIndex(i));
+
+	if (resolved)
+		return;
+
+	/*
+	 * There's a cycle, so acquire exclusive lock on the entire shared lock
+	 * data structures and run the full check, which can rearrange wait
+	 * queues or remove us from ours.  Things may have changed meanwhile, so
+	 * everything must be checked afresh.
+	 */
 	for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
 		LWLockAcquire(LockHashPartitionLockByIndex(i), LW_EXCLUSIVE);
 
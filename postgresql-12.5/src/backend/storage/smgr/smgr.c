@@ -21,10 +21,14 @@
 #include "lib/ilist.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lwlock.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "utils/hashutils.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
+#include "utils/memutils.h"
 
 
 /*
@@ -49,6 +53,9 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	void		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
@@ -73,6 +80,7 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
 		.smgr_write = mdwrite,
@@ -89,12 +97,89 @@ static const int NSmgr = lengthof(smgrsw);
  * Each backend has a hashtable that stores all extant SMgrRelation objects.
  * In addition, "unowned" SMgrRelation objects are chained together in a list.
  */
-static HTAB *SMgrRelationHash = NULL;
+/*
+ * Each backend finds its SMgrRelation objects through a simplehash table
+ * keyed by RelFileNodeBackend.  smgropen() lies on many hot paths, and open
+ * addressing avoids dynahash's bucket chains and segment indirection there.
+ * The table holds pointers to the objects, which live in SMgrRelationCxt:
+ * simplehash moves its entries around, but SMgrRelation pointers have to
+ * stay valid since the relcache keeps them.
+ */
+typedef struct SMgrEntry
+{
+	RelFileNodeBackend key;		/* hash key */
+	SMgrRelation reln;			/* the SMgrRelation object */
+	char		status;			/* hash status */
+} SMgrEntry;
+
+#define SH_PREFIX smgrtable
+#define SH_ELEMENT_TYPE SMgrEntry
+#define SH_KEY_TYPE RelFileNodeBackend
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) \
+	DatumGetUInt32(hash_any((const unsigned char *) &(key), \
+							sizeof(RelFileNodeBackend)))
+#define SH_EQUAL(tb, a, b) \
+	(memcmp(&(a), &(b), sizeof(RelFileNodeBackend)) == 0)
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+static smgrtable_hash *SMgrRelationHash = NULL;
+static MemoryContext SMgrRelationCxt = NULL;
 
 static dlist_head unowned_relns;
 
+/*
+ * In addition, there is a shared cache of relation fork sizes, so that
+ * smgrnblocks() need not ask the storage manager (which for md.c means an
+ * lseek() per segment) every time.  The planner, sequential scans and WAL
+ * replay all call it constantly, and the answer only changes through
+ * smgrextend(), smgrzeroextend() and smgrtruncate(), which keep the cache
+ * up to date, and through smgrcreate() and the unlink functions, which
+ * remove the entries.  Files copied wholesale outside the smgr layer
+ * (CREATE DATABASE, ALTER DATABASE SET TABLESPACE, resetting unlogged
+ * relations) are handled by SMgrSizeCacheForgetDatabase().
+ *
+ * Entries are filled in on a cache miss while holding the partition lock
+ * exclusively, so that the size read from the storage manager cannot
+ * overwrite a later update made by a concurrent extension or truncation:
+ * either the read happens after the file change and sees its result, or
+ * the update that follows the file change overwrites the entry.
+ *
+ * Temporary relations are backend-local and are not cached.  Neither is the
+ * init fork, which index AMs build with smgrwrite() beyond EOF; it is rarely
+ * sized anyway.  When the table is full we simply do not cache.
+ */
+typedef struct SMgrSizeCacheKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} SMgrSizeCacheKey;
+
+typedef struct SMgrSizeCacheEnt
+{
+	SMgrSizeCacheKey key;		/* hash key; must be first */
+	BlockNumber nblocks;		/* current size of the fork */
+} SMgrSizeCacheEnt;
+
+#define NUM_SMGR_SIZE_CACHE_PARTITIONS	16
+
+#define SMgrSizeCachePartitionLock(hashcode) \
+	(&SMgrSizeCacheLocks[(hashcode) % NUM_SMGR_SIZE_CACHE_PARTITIONS].lock)
+
+static HTAB *SMgrSizeCache = NULL;
+static LWLockPadded *SMgrSizeCacheLocks = NULL;
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static int	SMgrSizeCacheEntries(void);
+static bool smgrsizecache_key(SMgrRelation reln, ForkNumber forknum,
+							  SMgrSizeCacheKey *key);
+static void smgrsizecache_update(SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber nblocks, bool exact);
+static void smgrsizecache_forget(RelFileNode rnode, ForkNumber forknum);
 
 
 /*
@@ -135,6 +220,188 @@ smgrshutdown(int code, Datum arg)
 	}
 }
 
+/*
+ * Number of entries in the shared relation size cache.
+ */
+static int
+SMgrSizeCacheEntries(void)
+{
+	return Max(4096, NBuffers / 8);
+}
+
+/*
+ * SMgrSizeCacheShmemSize -- estimate space for the relation size cache
+ */
+Size
+SMgrSizeCacheShmemSize(void)
+{
+	Size		size;
+
+	size = hash_estimate_size(SMgrSizeCacheEntries(),
+							  sizeof(SMgrSizeCacheEnt));
+	size = add_size(size, mul_size(NUM_SMGR_SIZE_CACHE_PARTITIONS,
+								   sizeof(LWLockPadded)));
+	return size;
+}
+
+/*
+ * SMgrSizeCacheShmemInit -- initialize the relation size cache
+ */
+void
+SMgrSizeCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			i;
+
+	SMgrSizeCacheLocks = (LWLockPadded *)
+		ShmemInitStruct("Relation Size Cache Locks",
+						NUM_SMGR_SIZE_CACHE_PARTITIONS * sizeof(LWLockPadded),
+						&found);
+
+	if (!found)
+	{
+		for (i = 0; i < NUM_SMGR_SIZE_CACHE_PARTITIONS; i++)
+			LWLockInitialize(&SMgrSizeCacheLocks[i].lock,
+							 LWTRANCHE_RELATION_SIZE_CACHE);
+	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SMgrSizeCacheKey);
+	info.entrysize = sizeof(SMgrSizeCacheEnt);
+	info.num_partitions = NUM_SMGR_SIZE_CACHE_PARTITIONS;
+
+	SMgrSizeCache = ShmemInitHash("Relation Size Cache",
+								  SMgrSizeCacheEntries(),
+								  SMgrSizeCacheEntries(),
+								  &info,
+								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+								  HASH_FIXED_SIZE);
+}
+
+/*
+ * smgrsizecache_key -- build the size cache key for a fork
+ *
+ * Returns false if the fork's size is not to be cached at all.
+ */
+static bool
+smgrsizecache_key(SMgrRelation reln, ForkNumber forknum,
+				  SMgrSizeCacheKey *key)
+{
+	if (SMgrSizeCache == NULL || SmgrIsTemp(reln) ||
+		forknum == INIT_FORKNUM)
+		return false;
+
+	/* clear any padding, since the key is hashed as a blob */
+	MemSet(key, 0, sizeof(SMgrSizeCacheKey));
+	key->rnode = reln->smgr_rnode.node;
+	key->forknum = forknum;
+	return true;
+}
+
+/*
+ * smgrsizecache_update -- record a new size for a fork
+ *
+ * Called after the storage manager has changed the file.  If exact is false
+ * the cached size only ever grows, else it is replaced.
+ */
+static void
+smgrsizecache_update(SMgrRelation reln, ForkNumber forknum,
+					 BlockNumber nblocks, bool exact)
+{
+	SMgrSizeCacheKey key;
+	SMgrSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	bool		found;
+
+	if (!smgrsizecache_key(reln, forknum, &key))
+		return;
+
+	hashcode = get_hash_value(SMgrSizeCache, &key);
+	partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SMgrSizeCacheEnt *)
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_ENTER_NULL, &found);
+	if (entry != NULL &&
+		(!found || exact || entry->nblocks < nblocks))
+		entry->nblocks = nblocks;
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * smgrsizecache_forget -- remove cached sizes of a relation
+ *
+ * If forknum is InvalidForkNumber, all forks are forgotten.
+ */
+static void
+smgrsizecache_forget(RelFileNode rnode, ForkNumber forknum)
+{
+	SMgrSizeCacheKey key;
+	ForkNumber	fork;
+
+	if (SMgrSizeCache == NULL)
+		return;
+
+	for (fork = 0; fork <= MAX_FORKNUM; fork++)
+	{
+		uint32		hashcode;
+		LWLock	   *partitionLock;
+
+		if (forknum != InvalidForkNumber && fork != forknum)
+			continue;
+		if (fork == INIT_FORKNUM)
+			continue;
+
+		MemSet(&key, 0, sizeof(key));
+		key.rnode = rnode;
+		key.forknum = fork;
+
+		hashcode = get_hash_value(SMgrSizeCache, &key);
+		partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
+	}
+}
+
+/*
+ * SMgrSizeCacheForgetDatabase -- remove cached sizes of a whole database
+ *
+ * This is used when relation files of a database are created, copied or
+ * removed behind the smgr layer's back.  If dbid is InvalidOid, the entire
+ * cache is emptied.
+ */
+void
+SMgrSizeCacheForgetDatabase(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SMgrSizeCacheEnt *entry;
+	int			i;
+
+	if (SMgrSizeCache == NULL)
+		return;
+
+	/* lock all partitions, in order to avoid deadlock */
+	for (i = 0; i < NUM_SMGR_SIZE_CACHE_PARTITIONS; i++)
+		LWLockAcquire(&SMgrSizeCacheLocks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SMgrSizeCache);
+	while ((entry = (SMgrSizeCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (OidIsValid(dbid) && entry->key.rnode.dbNode != dbid)
+			continue;
+		hash_search(SMgrSizeCache, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	for (i = NUM_SMGR_SIZE_CACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&SMgrSizeCacheLocks[i].lock);
+}
+
 /*
  *	smgropen() -- Return an SMgrRelation object, creating it if need be.
  *
@@ -145,47 +412,47 @@ smgropen(RelFileNode rnode, BackendId backend)
 {
 	RelFileNodeBackend brnode;
 	SMgrRelation reln;
+	SMgrEntry  *entry;
 	bool		found;
+	int			forknum;
 
 	if (SMgrRelationHash == NULL)
 	{
 		/* First time through: initialize the hash table */
-		HASHCTL		ctl;
-
-		MemSet(&ctl, 0, sizeof(ctl));
-		ctl.keysize = sizeof(RelFileNodeBackend);
-		ctl.entrysize = sizeof(SMgrRelationData);
-		SMgrRelationHash = hash_create("smgr relation table", 400,
-									   &ctl, HASH_ELEM | HASH_BLOBS);
+		SMgrRelationCxt = AllocSetContextCreate(TopMemoryContext,
+												"smgr relation table",
+												ALLOCSET_DEFAULT_SIZES);
+		SMgrRelationHash = smgrtable_create(SMgrRelationCxt, 400, NULL);
 		dlist_init(&unowned_relns);
 	}
 
-	/* Look up or create an entry */
+	/* Look up an existing entry */
 	brnode.node = rnode;
 	brnode.backend = backend;
-	reln = (SMgrRelation) hash_search(SMgrRelationHash,
-									  (void *) &brnode,
-									  HASH_ENTER, &found);
-
-	/* Initialize it if not present before */
-	if (!found)
-	{
-		int			forknum;
-
-		/* hash_search already filled in the lookup key */
-		reln->smgr_owner = NULL;
-		reln->smgr_targblock = InvalidBlockNumber;
-		reln->smgr_fsm_nblocks = InvalidBlockNumber;
-		reln->smgr_vm_nblocks = InvalidBlockNumber;
-		reln->smgr_which = 0;	/* we only have md.c at present */
+	entry = smgrtable_lookup(SMgrRelationHash, brnode);
+	if (entry != NULL)
+		return entry->reln;
+
+	/* Create and initialize a new one */
+	reln = (SMgrRelation) MemoryContextAlloc(SMgrRelationCxt,
+											 sizeof(SMgrRelationData));
+	entry = smgrtable_insert(SMgrRelationHash, brnode, &found);
+	Assert(!found);
+	entry->reln = reln;
+
+	reln->smgr_rnode = brnode;
+	reln->smgr_owner = NULL;
+	reln->smgr_targblock = InvalidBlockNumber;
+	reln->smgr_fsm_nblocks = InvalidBlockNumber;
+	reln->smgr_vm_nblocks = InvalidBlockNumber;
+	reln->smgr_which = 0;		/* we only have md.c at present */
 
-		/* mark it not open */
-		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
-			reln->md_num_open_segs[forknum] = 0;
+	/* mark it not open */
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		reln->md_num_open_segs[forknum] = 0;
 
-		/* it has no owner yet */
-		dlist_push_tail(&unowned_relns, &reln->node);
-	}
+	/* it has no owner yet */
+	dlist_push_tail(&unowned_relns, &reln->node);
 
 	return reln;
 }
@@ -268,10 +535,9 @@ smgrclose(SMgrRelation reln)
 	if (!owner)
 		dlist_delete(&reln->node);
 
-	if (hash_search(SMgrRelationHash,
-					(void *) &(reln->smgr_rnode),
-					HASH_REMOVE, NULL) == NULL)
+	if (!smgrtable_delete(SMgrRelationHash, reln->smgr_rnode))
 		elog(ERROR, "SMgrRelation hashtable corrupted");
+	pfree(reln);
 
 	/*
 	 * Unhook the owner pointer, if any.  We do this last since in the remote
@@ -287,17 +553,17 @@ smgrclose(SMgrRelation reln)
 void
 smgrcloseall(void)
 {
-	HASH_SEQ_STATUS status;
-	SMgrRelation reln;
+	smgrtable_iterator iter;
+	SMgrEntry  *entry;
 
 	/* Nothing to do if hashtable not set up */
 	if (SMgrRelationHash == NULL)
 		return;
 
-	hash_seq_init(&status, SMgrRelationHash);
-
-	while ((reln = (SMgrRelation) hash_seq_search(&status)) != NULL)
-		smgrclose(reln);
+	/* smgrclose removes the current entry, which the iteration allows */
+	smgrtable_start_iterate(SMgrRelationHash, &iter);
+	while ((entry = smgrtable_iterate(SMgrRelationHash, &iter)) != NULL)
+		smgrclose(entry->reln);
 }
 
 /*
@@ -311,17 +577,15 @@ smgrcloseall(void)
 void
 smgrclosenode(RelFileNodeBackend rnode)
 {
-	SMgrRelation reln;
+	SMgrEntry  *entry;
 
 	/* Nothing to do if hashtable not set up */
 	if (SMgrRelationHash == NULL)
 		return;
 
-	reln = (SMgrRelation) hash_search(SMgrRelationHash,
-									  (void *) &rnode,
-									  HASH_FIND, NULL);
-	if (reln != NULL)
-		smgrclose(reln);
+	entry = smgrtable_lookup(SMgrRelationHash, rnode);
+	if (entry != NULL)
+		smgrclose(entry->reln);
 }
 
 /*
@@ -358,6 +622,9 @@ smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 							isRedo);
 
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
+
+	/* a relfilenode can be reused once its old file is gone */
+	smgrsizecache_forget(reln->smgr_rnode.node, forknum);
 }
 
 /*
@@ -387,7 +654,7 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	 * Get rid of any remaining buffers for the relation.  bufmgr will just
 	 * drop them without bothering to write the contents.
 	 */
-	DropRelFileNodesAllBuffers(&rnode, 1);
+	DropRelFileNodesAllBuffers(&reln, 1);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -414,6 +681,8 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	 * xact.
 	 */
 	smgrsw[which].smgr_unlink(rnode, InvalidForkNumber, isRedo);
+
+	smgrsizecache_forget(rnode.node, InvalidForkNumber);
 }
 
 /*
@@ -460,7 +729,7 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	 * Get rid of any remaining buffers for the relations.  bufmgr will just
 	 * drop them without bothering to write the contents.
 	 */
-	DropRelFileNodesAllBuffers(rnodes, nrels);
+	DropRelFileNodesAllBuffers(rels, nrels);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget them immediately,
@@ -492,6 +761,8 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
 			smgrsw[which].smgr_unlink(rnodes[i], forknum, isRedo);
+
+		smgrsizecache_forget(rnodes[i].node, InvalidForkNumber);
 	}
 
 	pfree(rnodes);
@@ -520,7 +791,7 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * Get rid of any remaining buffers for the fork.  bufmgr will just drop
 	 * them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(rnode, forknum, 0);
+	DropRelFileNodeBuffers(reln, forknum, 0);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -547,6 +818,8 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * xact.
 	 */
 	smgrsw[which].smgr_unlink(rnode, forknum, isRedo);
+
+	smgrsizecache_forget(rnode.node, forknum);
 }
 
 /*
@@ -564,6 +837,25 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	smgrsw[reln->smgr_which].smgr_extend(reln, forknum, blocknum,
 										 buffer, skipFsync);
+
+	smgrsizecache_update(reln, forknum, blocknum + 1, false);
+}
+
+/*
+ *	smgrzeroextend() -- Add new zeroed-out blocks to a file.
+ *
+ *		Similar to smgrextend(), except the relation is extended by nblocks
+ *		blocks at once, all of them reading as zeroes, without the caller
+ *		having to supply any page images.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	smgrsizecache_update(reln, forknum, blocknum + nblocks, false);
 }
 
 /*
@@ -629,11 +921,93 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 /*
  *	smgrnblocks() -- Calculate the number of blocks in the
  *					 supplied relation.
+ *
+ *		The answer comes from the shared relation size cache if possible.
  */
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
-	return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	SMgrSizeCacheKey key;
+	SMgrSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	BlockNumber nblocks;
+	bool		found;
+
+	if (!smgrsizecache_key(reln, forknum, &key))
+		return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	hashcode = get_hash_value(SMgrSizeCache, &key);
+	partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SMgrSizeCacheEnt *)
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		nblocks = entry->nblocks;
+		LWLockRelease(partitionLock);
+		return nblocks;
+	}
+	LWLockRelease(partitionLock);
+
+	/*
+	 * Not cached.  Ask the storage manager while holding the lock
+	 * exclusively; see the comments at the top of the file.
+	 */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SMgrSizeCacheEnt *)
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+		nblocks = entry->nblocks;
+	else
+	{
+		nblocks = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+		entry = (SMgrSizeCacheEnt *)
+			hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+										HASH_ENTER_NULL, &found);
+		if (entry != NULL)
+			entry->nblocks = nblocks;
+	}
+	LWLockRelease(partitionLock);
+
+	return nblocks;
+}
+
+/*
+ *	smgrnblocks_cached() -- Get the cached number of blocks in the supplied
+ *							relation.
+ *
+ *		Returns InvalidBlockNumber if the size is not in the shared relation
+ *		size cache; the storage manager is never consulted.
+ */
+BlockNumber
+smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum)
+{
+	SMgrSizeCacheKey key;
+	SMgrSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	BlockNumber nblocks = InvalidBlockNumber;
+
+	if (!smgrsizecache_key(reln, forknum, &key))
+		return InvalidBlockNumber;
+
+	hashcode = get_hash_value(SMgrSizeCache, &key);
+	partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SMgrSizeCacheEnt *)
+		hash_search_with_hash_value(SMgrSizeCache, &key, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+		nblocks = entry->nblocks;
+	LWLockRelease(partitionLock);
+
+	return nblocks;
 }
 
 /*
@@ -649,7 +1023,7 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
 	 * just drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nblocks);
+	DropRelFileNodeBuffers(reln, forknum, nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
@@ -663,10 +1037,22 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 */
 	CacheInvalidateSmgr(reln->smgr_rnode);
 
+	/*
+	 * Forget the cached size first, so that it cannot be left behind too high
+	 * if the truncation fails partway through.
+	 */
+	smgrsizecache_forget(reln->smgr_rnode.node, forknum);
+
 	/*
 	 * Do the truncation.
 	 */
 	smgrsw[reln->smgr_which].smgr_truncate(reln, forknum, nblocks);
+
+	/*
+	 * The caller holds AccessExclusiveLock, so nobody can be extending the
+	 * fork concurrently.
+	 */
+	smgrsizecache_update(reln, forknum, nblocks, true);
 }
 
 /*
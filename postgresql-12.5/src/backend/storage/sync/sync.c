@@ -60,6 +60,7 @@ typedef struct
 	FileTag		tag;			/* identifies handler and file */
 	CycleCtr	cycle_ctr;		/* sync_cycle_ctr of oldest request */
 	bool		canceled;		/* canceled is true if we canceled "recently" */
+	bool		touched;		/* request arrived since last incremental pass */
 } PendingFsyncEntry;
 
 typedef struct
@@ -85,6 +86,7 @@ static CycleCtr checkpoint_cycle_ctr = 0;
 typedef struct SyncOps
 {
 	int			(*sync_syncfiletag) (const FileTag *ftag, char *path);
+	void		(*sync_writebackfiletag) (const FileTag *ftag);
 	int			(*sync_unlinkfiletag) (const FileTag *ftag, char *path);
 	bool		(*sync_filetagmatches) (const FileTag *ftag,
 										const FileTag *candidate);
@@ -94,6 +96,7 @@ static const SyncOps syncsw[] = {
 	/* magnetic disk */
 	{
 		.sync_syncfiletag = mdsyncfiletag,
+		.sync_writebackfiletag = mdwritebackfiletag,
 		.sync_unlinkfiletag = mdunlinkfiletag,
 		.sync_filetagmatches = mdfiletagmatches
 	}
@@ -308,6 +311,35 @@ ProcessSyncRequests(void)
 	/* Set flag to detect failure if we don't reach the end of the loop */
 	sync_in_progress = true;
 
+	/*
+	 * Before fsync'ing anything, ask the kernel to start writeback on every
+	 * file we're about to sync.  Each fsync below then mostly waits for I/O
+	 * that is already in flight, and files on different tablespaces (and so,
+	 * typically, different devices) are written out concurrently rather than
+	 * one device at a time.  This matters most when a checkpoint has to sync
+	 * a very large number of files.
+	 */
+	if (enableFsync && hash_get_num_entries(pendingOps) > 1)
+	{
+		absorb_counter = FSYNCS_PER_ABSORB;
+		hash_seq_init(&hstat, pendingOps);
+		while ((entry = (PendingFsyncEntry *) hash_seq_search(&hstat)) != NULL)
+		{
+			if (entry->cycle_ctr == sync_cycle_ctr || entry->canceled)
+				continue;
+			if (syncsw[entry->tag.handler].sync_writebackfiletag == NULL)
+				continue;
+
+			syncsw[entry->tag.handler].sync_writebackfiletag(&entry->tag);
+
+			if (--absorb_counter <= 0)
+			{
+				AbsorbSyncRequests();
+				absorb_counter = FSYNCS_PER_ABSORB;
+			}
+		}
+	}
+
 	/* Now scan the hashtable for fsync requests to process */
 	absorb_counter = FSYNCS_PER_ABSORB;
 	hash_seq_init(&hstat, pendingOps);
@@ -415,15 +447,100 @@ ProcessSyncRequests(void)
 			elog(ERROR, "pendingOps corrupted");
 	}							/* end loop over hashtable entries */
 
-	/* Return sync performance metrics for report at checkpoint end */
-	CheckpointStats.ckpt_sync_rels = processed;
-	CheckpointStats.ckpt_longest_sync = longest;
-	CheckpointStats.ckpt_agg_sync_time = total_elapsed;
+	/*
+	 * Return sync performance metrics for report at checkpoint end.  These
+	 * add to whatever ProcessIncrementalSyncRequests did during the write
+	 * phase of the same checkpoint.
+	 */
+	CheckpointStats.ckpt_sync_rels += processed;
+	CheckpointStats.ckpt_longest_sync = Max(CheckpointStats.ckpt_longest_sync,
+											longest);
+	CheckpointStats.ckpt_agg_sync_time += total_elapsed;
 
 	/* Flag successful completion of ProcessSyncRequests */
 	sync_in_progress = false;
 }
 
+/*
+ *	ProcessIncrementalSyncRequests() -- fsync quiet files during a checkpoint
+ *
+ * This is called by the checkpointer between paced writes of the
+ * checkpoint's write phase.  It fsyncs up to max_syncs files for which no
+ * new request has arrived since the previous call, on the theory that
+ * BufferSync, which writes in file order, has moved past them.  Spreading
+ * these fsyncs over the write phase, instead of issuing them all at the end
+ * in ProcessSyncRequests, avoids a burst of I/O when the checkpoint
+ * finishes.
+ *
+ * Syncing an entry early and removing it is always safe: a later write to
+ * the file will enter a new request, which ProcessSyncRequests will then
+ * handle as usual.  At worst a file is fsync'd twice in one checkpoint.
+ * Entries that look like they've been deleted are left for
+ * ProcessSyncRequests, which knows how to cope with that.
+ */
+void
+ProcessIncrementalSyncRequests(int max_syncs)
+{
+	HASH_SEQ_STATUS hstat;
+	PendingFsyncEntry *entry;
+	int			processed = 0;
+	instr_time	sync_start,
+				sync_end;
+	uint64		elapsed;
+
+	if (!pendingOps || !enableFsync || max_syncs <= 0)
+		return;
+
+	hash_seq_init(&hstat, pendingOps);
+	while ((entry = (PendingFsyncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		char		path[MAXPGPATH];
+
+		if (entry->canceled)
+			continue;
+
+		/* Skip files still being written, but check them again next time */
+		if (entry->touched)
+		{
+			entry->touched = false;
+			continue;
+		}
+
+		INSTR_TIME_SET_CURRENT(sync_start);
+		if (syncsw[entry->tag.handler].sync_syncfiletag(&entry->tag,
+														path) != 0)
+		{
+			if (!FILE_POSSIBLY_DELETED(errno))
+				ereport(data_sync_elevel(ERROR),
+						(errcode_for_file_access(),
+						 errmsg("could not fsync file \"%s\": %m",
+								path)));
+			continue;
+		}
+		INSTR_TIME_SET_CURRENT(sync_end);
+		INSTR_TIME_SUBTRACT(sync_end, sync_start);
+		elapsed = INSTR_TIME_GET_MICROSEC(sync_end);
+
+		CheckpointStats.ckpt_sync_rels++;
+		CheckpointStats.ckpt_longest_sync =
+			Max(CheckpointStats.ckpt_longest_sync, elapsed);
+		CheckpointStats.ckpt_agg_sync_time += elapsed;
+
+		if (log_checkpoints)
+			elog(DEBUG1, "checkpoint incremental sync: file=%s time=%.3f msec",
+				 path, (double) elapsed / 1000);
+
+		if (hash_search(pendingOps, &entry->tag, HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "pendingOps corrupted");
+
+		if (++processed >= max_syncs)
+		{
+			hash_seq_term(&hstat);
+			break;
+		}
+	}
+}
+
 /*
  * RememberSyncRequest() -- callback from checkpointer side of sync request
  *
@@ -517,6 +634,7 @@ RememberSyncRequest(const FileTag *ftag, SyncRequestType type)
 			entry->cycle_ctr = sync_cycle_ctr;
 			entry->canceled = false;
 		}
+		entry->touched = true;
 
 		/*
 		 * NB: it's intentional that we don't change cycle_ctr if the entry
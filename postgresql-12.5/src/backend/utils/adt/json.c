@@ -33,24 +33,6 @@
 #include "utils/typcache.h"
 #include "utils/syscache.h"
 
-/*
- * The context of the parser is maintained by the recursive descent
- * mechanism, but is passed explicitly to the error reporting routine
- * for better diagnostics.
- */
-typedef enum					/* contexts of JSON parser */
-{
-	JSON_PARSE_VALUE,			/* expecting a value */
-	JSON_PARSE_STRING,			/* expecting a string (for a field name) */
-	JSON_PARSE_ARRAY_START,		/* saw '[', expecting value or ']' */
-	JSON_PARSE_ARRAY_NEXT,		/* saw array element, expecting ',' or ']' */
-	JSON_PARSE_OBJECT_START,	/* saw '{', expecting label or '}' */
-	JSON_PARSE_OBJECT_LABEL,	/* saw object label, expecting ':' */
-	JSON_PARSE_OBJECT_NEXT,		/* saw object value, expecting ',' or '}' */
-	JSON_PARSE_OBJECT_COMMA,	/* saw object ',', expecting next label */
-	JSON_PARSE_END				/* saw the end of a document, expect nothing */
-} JsonParseContext;
-
 typedef enum					/* type categories for datum_to_json */
 {
 	JSONTYPE_NULL,				/* null, so we didn't bother to identify */
@@ -394,6 +376,25 @@ json_count_array_elements(JsonLexContext *lex)
 	return count;
 }
 
+/*
+ * json_lex_next, json_report_parse_error
+ *
+ * Lexer access for callers that do their own recursive descent, such as
+ * jsonb input, which builds its result directly rather than through
+ * semantic action callbacks.
+ */
+void
+json_lex_next(JsonLexContext *lex)
+{
+	json_lex(lex);
+}
+
+void
+json_report_parse_error(JsonParseContext ctx, JsonLexContext *lex)
+{
+	report_parse_error(ctx, lex);
+}
+
 /*
  *	Recursive Descent parse routines. There is one for each structural
  *	element in a json document:
@@ -970,16 +971,34 @@ json_lex_string(JsonLexContext *lex)
 			}
 
 		}
-		else if (lex->strval != NULL)
+		else
 		{
-			if (hi_surrogate != -1)
-				ereport(ERROR,
-						(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-						 errmsg("invalid input syntax for type %s", "json"),
-						 errdetail("Unicode low surrogate must follow a high surrogate."),
-						 report_json_context(lex)));
+			char	   *p = s;
+
+			/*
+			 * Skip over the whole run of ordinary characters, and copy it
+			 * out in one go if we need the de-escaped string.
+			 */
+			while (len + 1 < lex->input_length &&
+				   p[1] != '"' && p[1] != '\\' &&
+				   (unsigned char) p[1] >= 32)
+			{
+				p++;
+				len++;
+			}
 
-			appendStringInfoChar(lex->strval, *s);
+			if (lex->strval != NULL)
+			{
+				if (hi_surrogate != -1)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+							 errmsg("invalid input syntax for type %s", "json"),
+							 errdetail("Unicode low surrogate must follow a high surrogate."),
+							 report_json_context(lex)));
+
+				appendBinaryStringInfo(lex->strval, s, p - s + 1);
+			}
+			s = p;
 		}
 
 	}
@@ -70,6 +70,8 @@ static void jsonb_in_array_end(void *pstate);
 static void jsonb_in_object_field_start(void *pstate, char *fname, bool isnull);
 static void jsonb_put_escaped_value(StringInfo out, JsonbValue *scalarVal);
 static void jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype);
+static void jsonb_in_push_scalar(JsonbInState *state, JsonbValue *v);
+static void jsonb_parse_value(JsonLexContext *lex, JsonbInState *state);
 static void jsonb_categorize_type(Oid typoid,
 								  JsonbTypeCategory *tcategory,
 								  Oid *outfuncoid);
@@ -232,34 +234,164 @@ jsonb_typeof(PG_FUNCTION_ARGS)
  *
  * Turns json string into a jsonb Datum.
  *
- * Uses the json parser (with hooks) to construct a jsonb.
+ * This does its own recursive descent over the json lexer, pushing values
+ * straight into the JsonbParseState.  That accepts exactly what
+ * pg_parse_json() does and reports errors the same way, but avoids the
+ * semantic action callbacks and the extra copy and strlen() of every
+ * lexeme they need.
  */
 static inline Datum
 jsonb_from_cstring(char *json, int len)
 {
 	JsonLexContext *lex;
 	JsonbInState state;
-	JsonSemAction sem;
 
 	memset(&state, 0, sizeof(state));
-	memset(&sem, 0, sizeof(sem));
 	lex = makeJsonLexContextCstringLen(json, len, true);
 
-	sem.semstate = (void *) &state;
-
-	sem.object_start = jsonb_in_object_start;
-	sem.array_start = jsonb_in_array_start;
-	sem.object_end = jsonb_in_object_end;
-	sem.array_end = jsonb_in_array_end;
-	sem.scalar = jsonb_in_scalar;
-	sem.object_field_start = jsonb_in_object_field_start;
-
-	pg_parse_json(lex, &sem);
+	json_lex_next(lex);
+	jsonb_parse_value(lex, &state);
+	if (lex->token_type != JSON_TOKEN_END)
+		json_report_parse_error(JSON_PARSE_END, lex);
 
 	/* after parsing, the item member has the composed jsonb structure */
 	PG_RETURN_POINTER(JsonbValueToJsonb(state.res));
 }
 
+/*
+ * Copy the current string token out of the lexer into a JsonbValue.
+ */
+static inline void
+jsonb_lex_string_value(JsonLexContext *lex, JsonbValue *v)
+{
+	int			len = lex->strval->len;
+
+	v->type = jbvString;
+	v->val.string.len = checkStringLen(len);
+	v->val.string.val = palloc(len + 1);
+	memcpy(v->val.string.val, lex->strval->data, len + 1);
+}
+
+/*
+ * Parse one json value, of any kind, starting at the current token, and
+ * leave the lexer on the token following it.
+ */
+static void
+jsonb_parse_value(JsonLexContext *lex, JsonbInState *state)
+{
+	JsonbValue	v;
+
+	switch (lex->token_type)
+	{
+		case JSON_TOKEN_OBJECT_START:
+			check_stack_depth();
+			state->res = pushJsonbValue(&state->parseState, WJB_BEGIN_OBJECT, NULL);
+			lex->lex_level++;
+			json_lex_next(lex);
+			if (lex->token_type == JSON_TOKEN_STRING)
+			{
+				for (;;)
+				{
+					jsonb_lex_string_value(lex, &v);
+					state->res = pushJsonbValue(&state->parseState, WJB_KEY, &v);
+					json_lex_next(lex);
+					if (lex->token_type != JSON_TOKEN_COLON)
+						json_report_parse_error(JSON_PARSE_OBJECT_LABEL, lex);
+					json_lex_next(lex);
+					jsonb_parse_value(lex, state);
+					if (lex->token_type != JSON_TOKEN_COMMA)
+						break;
+					json_lex_next(lex);
+					if (lex->token_type != JSON_TOKEN_STRING)
+						json_report_parse_error(JSON_PARSE_STRING, lex);
+				}
+			}
+			else if (lex->token_type != JSON_TOKEN_OBJECT_END)
+				json_report_parse_error(JSON_PARSE_OBJECT_START, lex);
+			if (lex->token_type != JSON_TOKEN_OBJECT_END)
+				json_report_parse_error(JSON_PARSE_OBJECT_NEXT, lex);
+			json_lex_next(lex);
+			lex->lex_level--;
+			state->res = pushJsonbValue(&state->parseState, WJB_END_OBJECT, NULL);
+			return;
+
+		case JSON_TOKEN_ARRAY_START:
+			check_stack_depth();
+			state->res = pushJsonbValue(&state->parseState, WJB_BEGIN_ARRAY, NULL);
+			lex->lex_level++;
+			json_lex_next(lex);
+			if (lex->token_type != JSON_TOKEN_ARRAY_END)
+			{
+				for (;;)
+				{
+					jsonb_parse_value(lex, state);
+					if (lex->token_type != JSON_TOKEN_COMMA)
+						break;
+					json_lex_next(lex);
+				}
+			}
+			if (lex->token_type != JSON_TOKEN_ARRAY_END)
+				json_report_parse_error(JSON_PARSE_ARRAY_NEXT, lex);
+			json_lex_next(lex);
+			lex->lex_level--;
+			state->res = pushJsonbValue(&state->parseState, WJB_END_ARRAY, NULL);
+			return;
+
+		case JSON_TOKEN_STRING:
+			jsonb_lex_string_value(lex, &v);
+			break;
+
+		case JSON_TOKEN_NUMBER:
+			{
+				int			toklen = lex->token_terminator - lex->token_start;
+				char		buf[64];
+				char	   *token;
+
+				/* numeric_in wants a null-terminated copy of the token */
+				if (toklen < sizeof(buf))
+					token = buf;
+				else
+					token = palloc(toklen + 1);
+				memcpy(token, lex->token_start, toklen);
+				token[toklen] = '\0';
+
+				/* as in pg_parse_json, a bad next token is reported first */
+				json_lex_next(lex);
+
+				v.type = jbvNumeric;
+				v.val.numeric =
+					DatumGetNumeric(DirectFunctionCall3(numeric_in,
+														CStringGetDatum(token),
+														ObjectIdGetDatum(InvalidOid),
+														Int32GetDatum(-1)));
+				if (token != buf)
+					pfree(token);
+			}
+			jsonb_in_push_scalar(state, &v);
+			return;
+
+		case JSON_TOKEN_TRUE:
+			v.type = jbvBool;
+			v.val.boolean = true;
+			break;
+
+		case JSON_TOKEN_FALSE:
+			v.type = jbvBool;
+			v.val.boolean = false;
+			break;
+
+		case JSON_TOKEN_NULL:
+			v.type = jbvNull;
+			break;
+
+		default:
+			json_report_parse_error(JSON_PARSE_VALUE, lex);
+	}
+
+	json_lex_next(lex);
+	jsonb_in_push_scalar(state, &v);
+}
+
 static size_t
 checkStringLen(size_t len)
 {
@@ -396,7 +528,17 @@ jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype)
 			break;
 	}
 
-	if (_state->parseState == NULL)
+	jsonb_in_push_scalar(_state, &v);
+}
+
+/*
+ * Add a scalar to the value being built: as an array element or object
+ * field value, or as a raw scalar if it's the whole document.
+ */
+static void
+jsonb_in_push_scalar(JsonbInState *state, JsonbValue *v)
+{
+	if (state->parseState == NULL)
 	{
 		/* single scalar */
 		JsonbValue	va;
@@ -405,21 +547,21 @@ jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype)
 		va.val.array.rawScalar = true;
 		va.val.array.nElems = 1;
 
-		_state->res = pushJsonbValue(&_state->parseState, WJB_BEGIN_ARRAY, &va);
-		_state->res = pushJsonbValue(&_state->parseState, WJB_ELEM, &v);
-		_state->res = pushJsonbValue(&_state->parseState, WJB_END_ARRAY, NULL);
+		state->res = pushJsonbValue(&state->parseState, WJB_BEGIN_ARRAY, &va);
+		state->res = pushJsonbValue(&state->parseState, WJB_ELEM, v);
+		state->res = pushJsonbValue(&state->parseState, WJB_END_ARRAY, NULL);
 	}
 	else
 	{
-		JsonbValue *o = &_state->parseState->contVal;
+		JsonbValue *o = &state->parseState->contVal;
 
 		switch (o->type)
 		{
 			case jbvArray:
-				_state->res = pushJsonbValue(&_state->parseState, WJB_ELEM, &v);
+				state->res = pushJsonbValue(&state->parseState, WJB_ELEM, v);
 				break;
 			case jbvObject:
-				_state->res = pushJsonbValue(&_state->parseState, WJB_VALUE, &v);
+				state->res = pushJsonbValue(&state->parseState, WJB_VALUE, v);
 				break;
 			default:
 				elog(ERROR, "unexpected parent of nested structure");
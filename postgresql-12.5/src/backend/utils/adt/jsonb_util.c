@@ -410,6 +410,107 @@ findJsonbValueFromContainer(JsonbContainer *container, uint32 flags,
 	return NULL;
 }
 
+/*
+ * Decode the offsets of all the keys and values of an object container.
+ *
+ * Returns a palloc'd array of 2 * count + 1 offsets into the container's
+ * variable-length data; the last one is the end of the data.  Callers that
+ * look up many keys in the same object can then use findJsonbKeyWithOffsets()
+ * instead of walking the JEntry array back to a stored offset every time.
+ */
+uint32 *
+decodeJsonbObjectOffsets(JsonbContainer *container)
+{
+	int			nentries = JsonContainerSize(container) * 2;
+	uint32	   *offsets;
+	uint32		offset = 0;
+	int			i;
+
+	Assert(JsonContainerIsObject(container));
+
+	offsets = palloc((nentries + 1) * sizeof(uint32));
+	for (i = 0; i < nentries; i++)
+	{
+		offsets[i] = offset;
+		JBE_ADVANCE_OFFSET(offset, container->children[i]);
+	}
+	offsets[nentries] = offset;
+
+	return offsets;
+}
+
+/*
+ * Look up a key in an object container, using offsets decoded by
+ * decodeJsonbObjectOffsets().
+ *
+ * Returns palloc()'d copy of the value, or NULL if the key is not present.
+ */
+JsonbValue *
+findJsonbKeyWithOffsets(JsonbContainer *container, const uint32 *offsets,
+						const char *keyVal, int keyLen)
+{
+	int			count = JsonContainerSize(container);
+	char	   *base_addr = (char *) (container->children + count * 2);
+	uint32		stopLow = 0,
+				stopHigh = count;
+	JsonbValue	key;
+
+	Assert(JsonContainerIsObject(container));
+
+	key.type = jbvString;
+	key.val.string.val = (char *) keyVal;
+	key.val.string.len = keyLen;
+
+	while (stopLow < stopHigh)
+	{
+		uint32		stopMiddle;
+		int			difference;
+		JsonbValue	candidate;
+
+		stopMiddle = stopLow + (stopHigh - stopLow) / 2;
+
+		candidate.type = jbvString;
+		candidate.val.string.val = base_addr + offsets[stopMiddle];
+		candidate.val.string.len = offsets[stopMiddle + 1] - offsets[stopMiddle];
+
+		difference = lengthCompareJsonbStringValue(&candidate, &key);
+
+		if (difference == 0)
+		{
+			int			index = stopMiddle + count;
+			uint32		offset = offsets[index];
+			uint32		len = offsets[index + 1] - offset;
+			JEntry		entry = container->children[index];
+			JsonbValue *result = palloc(sizeof(JsonbValue));
+
+			/* the lengths are known here, so avoid getJsonbLength() */
+			if (JBE_ISSTRING(entry))
+			{
+				result->type = jbvString;
+				result->val.string.val = base_addr + offset;
+				result->val.string.len = len;
+			}
+			else if (JBE_ISCONTAINER(entry))
+			{
+				result->type = jbvBinary;
+				result->val.binary.data =
+					(JsonbContainer *) (base_addr + INTALIGN(offset));
+				result->val.binary.len = len - (INTALIGN(offset) - offset);
+			}
+			else
+				fillJsonbValue(container, index, base_addr, offset, result);
+
+			return result;
+		}
+		else if (difference < 0)
+			stopLow = stopMiddle + 1;
+		else
+			stopHigh = stopMiddle;
+	}
+
+	return NULL;
+}
+
 /*
  * Get i-th value of a Jsonb array.
  *
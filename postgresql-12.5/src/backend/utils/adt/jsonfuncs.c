@@ -458,6 +458,8 @@ static JsonbValue *findJsonbValueFromContainerLen(JsonbContainer *container,
 												  uint32 flags,
 												  char *key,
 												  uint32 keylen);
+static JsonbValue *jsonb_object_field_lookup(Datum jbdatum, text *key,
+											 bool *isobject);
 
 /* functions supporting jsonb_delete, jsonb_set and jsonb_concat */
 static JsonbValue *IteratorConcat(JsonbIterator **it1, JsonbIterator **it2,
@@ -714,17 +716,14 @@ json_object_field(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
+	bool		isobject;
 
-	if (!JB_ROOT_IS_OBJECT(jb))
+	v = jsonb_object_field_lookup(PG_GETARG_DATUM(0), key, &isobject);
+	if (!isobject)
 		PG_RETURN_NULL();
 
-	v = findJsonbValueFromContainerLen(&jb->root, JB_FOBJECT,
-									   VARDATA_ANY(key),
-									   VARSIZE_ANY_EXHDR(key));
-
 	if (v != NULL)
 		PG_RETURN_JSONB_P(JsonbValueToJsonb(v));
 
@@ -750,17 +749,14 @@ json_object_field_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
+	bool		isobject;
 
-	if (!JB_ROOT_IS_OBJECT(jb))
+	v = jsonb_object_field_lookup(PG_GETARG_DATUM(0), key, &isobject);
+	if (!isobject)
 		PG_RETURN_NULL();
 
-	v = findJsonbValueFromContainerLen(&jb->root, JB_FOBJECT,
-									   VARDATA_ANY(key),
-									   VARSIZE_ANY_EXHDR(key));
-
 	if (v != NULL)
 	{
 		text	   *result = NULL;
@@ -3926,6 +3922,83 @@ findJsonbValueFromContainerLen(JsonbContainer *container, uint32 flags,
 	return findJsonbValueFromContainer(container, flags, &k);
 }
 
+/*
+ * Queries often pull several fields out of the same jsonb column, as in
+ * "SELECT doc->'a', doc->>'b', ...".  Each operator would detoast (and
+ * usually decompress) the whole value again, so we remember the last
+ * toasted value we expanded together with the decoded offsets of its
+ * top-level object.
+ *
+ * The cache is allocated in the memory context that is current when it is
+ * filled, which during expression evaluation is the per-tuple context, and
+ * is forgotten when that context is reset.  So it normally lives for one row
+ * at most, and is keyed on the raw toast pointer or compressed bytes.
+ */
+typedef struct JsonbFieldCache
+{
+	MemoryContextCallback cb;	/* clears jsonb_field_cache on reset */
+	struct varlena *raw;		/* copy of the datum as passed to us */
+	Jsonb	   *jb;				/* its detoasted value */
+	uint32	   *offsets;		/* from decodeJsonbObjectOffsets(), or NULL */
+} JsonbFieldCache;
+
+static JsonbFieldCache *jsonb_field_cache = NULL;
+
+static void
+jsonb_field_cache_reset(void *arg)
+{
+	if (jsonb_field_cache == (JsonbFieldCache *) arg)
+		jsonb_field_cache = NULL;
+}
+
+/*
+ * Look up a top-level key of a jsonb datum for -> and ->>.
+ *
+ * Sets *isobject to false, and returns NULL, if the value isn't an object.
+ */
+static JsonbValue *
+jsonb_object_field_lookup(Datum jbdatum, text *key, bool *isobject)
+{
+	struct varlena *raw = (struct varlena *) DatumGetPointer(jbdatum);
+	JsonbFieldCache *cache = jsonb_field_cache;
+	Size		rawsize;
+
+	/* values stored inline and uncompressed are cheap to access anyway */
+	if (!VARATT_IS_EXTERNAL_ONDISK(raw) && !VARATT_IS_COMPRESSED(raw))
+	{
+		Jsonb	   *jb = DatumGetJsonbP(jbdatum);
+
+		*isobject = JB_ROOT_IS_OBJECT(jb);
+		if (!*isobject)
+			return NULL;
+		return findJsonbValueFromContainerLen(&jb->root, JB_FOBJECT,
+											  VARDATA_ANY(key),
+											  VARSIZE_ANY_EXHDR(key));
+	}
+
+	rawsize = VARSIZE_ANY(raw);
+	if (cache == NULL || VARSIZE_ANY(cache->raw) != rawsize ||
+		memcmp(cache->raw, raw, rawsize) != 0)
+	{
+		cache = palloc(sizeof(JsonbFieldCache));
+		cache->raw = palloc(rawsize);
+		memcpy(cache->raw, raw, rawsize);
+		cache->jb = DatumGetJsonbP(jbdatum);
+		cache->offsets = JB_ROOT_IS_OBJECT(cache->jb) ?
+			decodeJsonbObjectOffsets(&cache->jb->root) : NULL;
+		cache->cb.func = jsonb_field_cache_reset;
+		cache->cb.arg = cache;
+		MemoryContextRegisterResetCallback(CurrentMemoryContext, &cache->cb);
+		jsonb_field_cache = cache;
+	}
+
+	*isobject = (cache->offsets != NULL);
+	if (!*isobject)
+		return NULL;
+	return findJsonbKeyWithOffsets(&cache->jb->root, cache->offsets,
+								   VARDATA_ANY(key), VARSIZE_ANY_EXHDR(key));
+}
+
 /*
  * Semantic actions for json_strip_nulls.
  *
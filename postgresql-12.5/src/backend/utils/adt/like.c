@@ -24,6 +24,7 @@
 #include "miscadmin.h"
 #include "utils/builtins.h"
 #include "utils/pg_locale.h"
+#include "utils/varlena.h"
 
 
 #define LIKE_TRUE						1
@@ -46,6 +47,8 @@ static int	SB_IMatchText(const char *t, int tlen, const char *p, int plen,
 						  pg_locale_t locale, bool locale_is_c);
 
 static int	GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation);
+static int	CachedMatchText(FunctionCallInfo fcinfo, const char *s, int slen,
+							const char *p, int plen);
 static int	Generic_Text_IC_like(text *str, text *pat, Oid collation);
 
 /*--------------------
@@ -168,6 +171,233 @@ GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation
 		return MB_MatchText(s, slen, p, plen, 0, true);
 }
 
+/*
+ * Most LIKE patterns are constants made of literal text and '%' wildcards,
+ * such as 'foo%' or '%bar%baz%'.  Those can be matched without walking the
+ * pattern character by character: check the anchored prefix and suffix, and
+ * look for the literal pieces in between with a precomputed Boyer-Moore-
+ * Horspool search.  The pattern analysis is kept in fn_extra, so it is done
+ * once per expression rather than once per row.
+ *
+ * This is only valid when a byte match is a character match, i.e. in
+ * single-byte encodings and UTF-8, and when the pattern has no '_' (which
+ * needs character counting).  Other patterns are flagged as not usable and
+ * go through GenericMatchText() as before.
+ */
+typedef struct LikeSegment
+{
+	int			off;			/* offset of the literal in LikePattern.lits */
+	int			len;
+	LiteralSearch search;		/* only set up for the middle segments */
+} LikeSegment;
+
+typedef struct LikePattern
+{
+	char	   *pat;			/* copy of the pattern this was built from */
+	int			plen;
+	Oid			collation;
+	bool		usable;			/* false: use GenericMatchText() */
+	int			misses;			/* pattern changes since the last reuse */
+	bool		disabled;		/* pattern changes too often, don't cache */
+	char	   *lits;			/* unescaped literal text of all segments */
+	int			nsegs;			/* number of '%'-separated segments */
+	LikeSegment *segs;
+} LikePattern;
+
+/* give up caching after this many consecutive pattern changes */
+#define LIKE_CACHE_MAX_MISSES	8
+
+/*
+ * Split a LIKE pattern into its '%'-separated literal segments.  Returns
+ * false if the pattern uses '_' or ends with an escape character; the
+ * latter is reported by the generic matcher.
+ */
+static bool
+like_pattern_parse(LikePattern *lp, MemoryContext mcxt)
+{
+	const char *p = lp->pat;
+	int			plen = lp->plen;
+	char	   *lits;
+	int			litlen = 0;
+	int			maxsegs = 1;
+	int			nsegs = 0;
+	int			segstart = 0;
+	int			i;
+
+	for (i = 0; i < plen; i++)
+	{
+		if (p[i] == '_')
+			return false;
+		if (p[i] == '%')
+			maxsegs++;
+	}
+
+	lp->lits = lits = MemoryContextAlloc(mcxt, plen + 1);
+	lp->segs = MemoryContextAlloc(mcxt, maxsegs * sizeof(LikeSegment));
+
+	while (plen > 0)
+	{
+		if (*p == '\\')
+		{
+			int			l;
+
+			p++, plen--;
+			if (plen <= 0)
+				return false;
+			l = pg_mblen(p);
+			if (l > plen)
+				return false;
+			memcpy(lits + litlen, p, l);
+			litlen += l;
+			p += l, plen -= l;
+		}
+		else if (*p == '%')
+		{
+			/* collapse runs of '%', dropping empty middle segments */
+			if (nsegs == 0 || litlen > segstart)
+			{
+				lp->segs[nsegs].off = segstart;
+				lp->segs[nsegs].len = litlen - segstart;
+				nsegs++;
+			}
+			segstart = litlen;
+			p++, plen--;
+		}
+		else
+		{
+			/* '%', '_' and '\' never appear inside a multibyte character */
+			lits[litlen++] = *p;
+			p++, plen--;
+		}
+	}
+	lp->segs[nsegs].off = segstart;
+	lp->segs[nsegs].len = litlen - segstart;
+	nsegs++;
+
+	lp->nsegs = nsegs;
+	for (i = 1; i < nsegs - 1; i++)
+		literal_search_init(&lp->segs[i].search,
+							lits + lp->segs[i].off, lp->segs[i].len);
+	return true;
+}
+
+/*
+ * (Re)build the cached analysis of a pattern in fn_extra.
+ */
+static void
+like_pattern_build(LikePattern *lp, MemoryContext mcxt,
+				   const char *p, int plen, Oid collation)
+{
+	if (lp->pat)
+		pfree(lp->pat);
+	if (lp->lits)
+		pfree(lp->lits);
+	if (lp->segs)
+		pfree(lp->segs);
+	lp->lits = NULL;
+	lp->segs = NULL;
+	lp->nsegs = 0;
+	lp->usable = false;
+
+	lp->pat = MemoryContextAlloc(mcxt, plen + 1);
+	memcpy(lp->pat, p, plen);
+	lp->plen = plen;
+	lp->collation = collation;
+
+	/* same check as GenericMatchText(), but only done once */
+	if (collation && !lc_ctype_is_c(collation) && collation != DEFAULT_COLLATION_OID)
+	{
+		pg_locale_t locale = pg_newlocale_from_collation(collation);
+
+		if (locale && !locale->deterministic)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("nondeterministic collations are not supported for LIKE")));
+	}
+
+	lp->usable = (pg_database_encoding_max_length() == 1 ||
+				  GetDatabaseEncoding() == PG_UTF8) &&
+		like_pattern_parse(lp, mcxt);
+}
+
+/*
+ * Match against a pattern made only of literals and '%'.
+ */
+static int
+like_pattern_match(const LikePattern *lp, const char *s, int slen)
+{
+	const LikeSegment *first = &lp->segs[0];
+	const LikeSegment *last = &lp->segs[lp->nsegs - 1];
+	const char *t;
+	int			tlen;
+	int			i;
+
+	if (lp->nsegs == 1)
+		return (slen == first->len &&
+				memcmp(s, lp->lits, slen) == 0) ? LIKE_TRUE : LIKE_FALSE;
+
+	if (slen < first->len + last->len ||
+		memcmp(s, lp->lits + first->off, first->len) != 0 ||
+		memcmp(s + slen - last->len, lp->lits + last->off, last->len) != 0)
+		return LIKE_FALSE;
+
+	/* leftmost matches of the middle segments leave the most room */
+	t = s + first->len;
+	tlen = slen - first->len - last->len;
+	for (i = 1; i < lp->nsegs - 1; i++)
+	{
+		const char *hit = literal_search(&lp->segs[i].search, t, tlen);
+
+		if (hit == NULL)
+			return LIKE_FALSE;
+		tlen -= (hit - t) + lp->segs[i].len;
+		t = hit + lp->segs[i].len;
+	}
+
+	return LIKE_TRUE;
+}
+
+/*
+ * GenericMatchText() with the pattern analysis cached across calls.
+ */
+static int
+CachedMatchText(FunctionCallInfo fcinfo, const char *s, int slen,
+				const char *p, int plen)
+{
+	Oid			collation = PG_GET_COLLATION();
+	LikePattern *lp;
+
+	if (fcinfo->flinfo == NULL)
+		return GenericMatchText(s, slen, p, plen, collation);
+
+	lp = (LikePattern *) fcinfo->flinfo->fn_extra;
+	if (lp == NULL)
+	{
+		lp = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+									sizeof(LikePattern));
+		fcinfo->flinfo->fn_extra = lp;
+		like_pattern_build(lp, fcinfo->flinfo->fn_mcxt, p, plen, collation);
+	}
+	else if (lp->disabled)
+		return GenericMatchText(s, slen, p, plen, collation);
+	else if (lp->plen != plen || lp->collation != collation ||
+			 memcmp(lp->pat, p, plen) != 0)
+	{
+		if (++lp->misses > LIKE_CACHE_MAX_MISSES)
+		{
+			lp->disabled = true;
+			return GenericMatchText(s, slen, p, plen, collation);
+		}
+		like_pattern_build(lp, fcinfo->flinfo->fn_mcxt, p, plen, collation);
+	}
+	else
+		lp->misses = 0;
+
+	if (!lp->usable)
+		return GenericMatchText(s, slen, p, plen, collation);
+	return like_pattern_match(lp, s, slen);
+}
+
 static inline int
 Generic_Text_IC_like(text *str, text *pat, Oid collation)
 {
@@ -254,7 +484,7 @@ namelike(PG_FUNCTION_ARGS)
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
-	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) == LIKE_TRUE);
+	result = (CachedMatchText(fcinfo, s, slen, p, plen) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -275,7 +505,7 @@ namenlike(PG_FUNCTION_ARGS)
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
-	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) != LIKE_TRUE);
+	result = (CachedMatchText(fcinfo, s, slen, p, plen) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -296,7 +526,7 @@ textlike(PG_FUNCTION_ARGS)
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
-	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) == LIKE_TRUE);
+	result = (CachedMatchText(fcinfo, s, slen, p, plen) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -317,7 +547,7 @@ textnlike(PG_FUNCTION_ARGS)
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
-	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) != LIKE_TRUE);
+	result = (CachedMatchText(fcinfo, s, slen, p, plen) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
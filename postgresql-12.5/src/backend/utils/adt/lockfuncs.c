@@ -14,6 +14,7 @@
 
 #include "access/htup_details.h"
 #include "access/xact.h"
+#include "catalog/pg_subscription.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "miscadmin.h"
@@ -34,7 +35,8 @@ const char *const LockTagTypeNames[] = {
 	"object",
 	"userlock",
 	"advisory",
-	"frozenid"
+	"frozenid",
+	"applytransaction"
 };
 
 /* This must match enum PredicateLockTargetType (predicate_internals.h) */
@@ -257,6 +259,17 @@ pg_lock_status(PG_FUNCTION_ARGS)
 				nulls[8] = true;
 				nulls[9] = true;
 				break;
+			case LOCKTAG_APPLY_TRANSACTION:
+				values[1] = ObjectIdGetDatum(instance->locktag.locktag_field1);
+				values[6] = TransactionIdGetDatum(instance->locktag.locktag_field3);
+				values[7] = ObjectIdGetDatum(SubscriptionRelationId);
+				values[8] = ObjectIdGetDatum(instance->locktag.locktag_field2);
+				values[9] = Int16GetDatum(0);
+				nulls[2] = true;
+				nulls[3] = true;
+				nulls[4] = true;
+				nulls[5] = true;
+				break;
 			case LOCKTAG_PAGE:
 				values[1] = ObjectIdGetDatum(instance->locktag.locktag_field1);
 				values[2] = ObjectIdGetDatum(instance->locktag.locktag_field2);
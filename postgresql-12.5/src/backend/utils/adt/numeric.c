@@ -429,6 +429,30 @@ static const NumericVar const_nan =
 static const int round_powers[4] = {0, 1000, 100, 10};
 #endif
 
+#ifdef HAVE_INT128
+/*
+ * Values whose digits, scaled to an integer by their display scale, are less
+ * than 10^NUMERIC_FAST_MAX_EXP10 take the int128 fast paths of addition,
+ * subtraction, multiplication and the SUM()/AVG() aggregates.  Results of
+ * those paths must stay below NUMERIC_FAST_MAX_RESULT, so that they can be
+ * padded to whole NBASE digits without overflowing.
+ */
+#define NUMERIC_FAST_MAX_EXP10	18
+#define NUMERIC_FAST_MAX_RESULT \
+	((int128) pow10_int64[17] * pow10_int64[18])	/* 10^35 */
+
+static const int64 pow10_int64[NUMERIC_FAST_MAX_EXP10 + 1] = {
+	INT64CONST(1), INT64CONST(10), INT64CONST(100), INT64CONST(1000),
+	INT64CONST(10000), INT64CONST(100000), INT64CONST(1000000),
+	INT64CONST(10000000), INT64CONST(100000000), INT64CONST(1000000000),
+	INT64CONST(10000000000), INT64CONST(100000000000),
+	INT64CONST(1000000000000), INT64CONST(10000000000000),
+	INT64CONST(100000000000000), INT64CONST(1000000000000000),
+	INT64CONST(10000000000000000), INT64CONST(100000000000000000),
+	INT64CONST(1000000000000000000)
+};
+#endif
+
 
 /* ----------
  * Local functions
@@ -485,6 +509,9 @@ static void int64_to_numericvar(int64 val, NumericVar *var);
 #ifdef HAVE_INT128
 static bool numericvar_to_int128(const NumericVar *var, int128 *result);
 static void int128_to_numericvar(int128 val, NumericVar *var);
+static bool numeric_to_scaled_int64(Numeric num, int64 *result, int *dscale);
+static Numeric make_result_from_scaled_int128(int128 val, int dscale,
+											  bool *have_error);
 #endif
 static double numeric_to_double_no_overflow(Numeric num);
 static double numericvar_to_double_no_overflow(const NumericVar *var);
@@ -2438,6 +2465,38 @@ numeric_add_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	if (NUMERIC_IS_NAN(num1) || NUMERIC_IS_NAN(num2))
 		return make_result(&const_nan);
 
+#ifdef HAVE_INT128
+
+	/*
+	 * If both values fit in 64 bits once scaled to integers, which is the
+	 * common case for money-like columns, do the arithmetic in 128 bits.
+	 */
+	{
+		int64		val1;
+		int64		val2;
+		int			dscale1;
+		int			dscale2;
+
+		/* with at most 16 digits of rescaling, the result stays < 10^35 */
+		if (numeric_to_scaled_int64(num1, &val1, &dscale1) &&
+			numeric_to_scaled_int64(num2, &val2, &dscale2) &&
+			Abs(dscale1 - dscale2) <= NUMERIC_FAST_MAX_EXP10 - 2)
+		{
+			int128		x1 = val1;
+			int128		x2 = val2;
+
+			if (dscale1 < dscale2)
+				x1 *= pow10_int64[dscale2 - dscale1];
+			else
+				x2 *= pow10_int64[dscale1 - dscale2];
+
+			return make_result_from_scaled_int128(x1 + x2,
+												  Max(dscale1, dscale2),
+												  have_error);
+		}
+	}
+#endif
+
 	/*
 	 * Unpack the values, let add_var() compute the result and return it.
 	 */
@@ -2494,6 +2553,38 @@ numeric_sub_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	if (NUMERIC_IS_NAN(num1) || NUMERIC_IS_NAN(num2))
 		return make_result(&const_nan);
 
+#ifdef HAVE_INT128
+
+	/*
+	 * If both values fit in 64 bits once scaled to integers, which is the
+	 * common case for money-like columns, do the arithmetic in 128 bits.
+	 */
+	{
+		int64		val1;
+		int64		val2;
+		int			dscale1;
+		int			dscale2;
+
+		/* with at most 16 digits of rescaling, the result stays < 10^35 */
+		if (numeric_to_scaled_int64(num1, &val1, &dscale1) &&
+			numeric_to_scaled_int64(num2, &val2, &dscale2) &&
+			Abs(dscale1 - dscale2) <= NUMERIC_FAST_MAX_EXP10 - 2)
+		{
+			int128		x1 = val1;
+			int128		x2 = val2;
+
+			if (dscale1 < dscale2)
+				x1 *= pow10_int64[dscale2 - dscale1];
+			else
+				x2 *= pow10_int64[dscale1 - dscale2];
+
+			return make_result_from_scaled_int128(x1 - x2,
+												  Max(dscale1, dscale2),
+												  have_error);
+		}
+	}
+#endif
+
 	/*
 	 * Unpack the values, let sub_var() compute the result and return it.
 	 */
@@ -2550,6 +2641,29 @@ numeric_mul_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	if (NUMERIC_IS_NAN(num1) || NUMERIC_IS_NAN(num2))
 		return make_result(&const_nan);
 
+#ifdef HAVE_INT128
+	/* Multiply values that fit in 64 bits once scaled in 128 bits */
+	{
+		int64		val1;
+		int64		val2;
+		int			dscale1;
+		int			dscale2;
+
+		int128		prod;
+
+		if (numeric_to_scaled_int64(num1, &val1, &dscale1) &&
+			numeric_to_scaled_int64(num2, &val2, &dscale2))
+		{
+			prod = (int128) val1 * val2;
+			if (prod < NUMERIC_FAST_MAX_RESULT &&
+				prod > -NUMERIC_FAST_MAX_RESULT)
+				return make_result_from_scaled_int128(prod,
+													  dscale1 + dscale2,
+													  have_error);
+		}
+	}
+#endif
+
 	/*
 	 * Unpack the values, let mul_var() compute the result and return it.
 	 * Unlike add_var() and sub_var(), mul_var() will round its result. In the
@@ -3517,8 +3631,89 @@ typedef struct NumericAggState
 	int			maxScale;		/* maximum scale seen so far */
 	int64		maxScaleCount;	/* number of values seen with maximum scale */
 	int64		NaNcount;		/* count of NaN values (not included in N!) */
+#ifdef HAVE_INT128
+	int128		fastSumX;		/* part of sum not yet in sumX, scaled by
+								 * 10^fastScale */
+	int			fastScale;		/* display scale of fastSumX */
+#endif
 } NumericAggState;
 
+#ifdef HAVE_INT128
+/*
+ * Without sumX2, inputs that numeric_to_scaled_int64() accepts are summed
+ * into fastSumX, which is much cheaper than accum_sum_add().  fastSumX is
+ * moved into sumX when it could overflow, and before anything reads sumX;
+ * callers must use numeric_agg_flush_fast() for the latter.  fastSumX is
+ * kept below NUMERIC_FAST_MAX_RESULT, plus one rescaled input.
+ */
+
+static void
+numeric_agg_flush_fast(NumericAggState *state)
+{
+	NumericVar	X;
+	int			pad;
+	MemoryContext old_context;
+
+	if (state->fastSumX == 0 && state->fastScale == 0)
+		return;
+
+	/* same as make_result_from_scaled_int128(), without making a Numeric */
+	pad = (DEC_DIGITS - state->fastScale % DEC_DIGITS) % DEC_DIGITS;
+	init_var(&X);
+	int128_to_numericvar(state->fastSumX * pow10_int64[pad], &X);
+	if (X.ndigits > 0)
+		X.weight -= (state->fastScale + pad) / DEC_DIGITS;
+	X.dscale = state->fastScale;
+
+	old_context = MemoryContextSwitchTo(state->agg_context);
+	accum_sum_add(&(state->sumX), &X);
+	MemoryContextSwitchTo(old_context);
+
+	free_var(&X);
+
+	state->fastSumX = 0;
+	state->fastScale = 0;
+}
+
+static void
+numeric_agg_add_fast(NumericAggState *state, int64 val, int dscale)
+{
+	int128		x = val;
+
+	if (dscale > state->fastScale)
+	{
+		int			shift = dscale - state->fastScale;
+
+		if (shift > NUMERIC_FAST_MAX_EXP10 - 2 ||
+			state->fastSumX > NUMERIC_FAST_MAX_RESULT / pow10_int64[shift] ||
+			state->fastSumX < -NUMERIC_FAST_MAX_RESULT / pow10_int64[shift])
+			numeric_agg_flush_fast(state);
+		else
+			state->fastSumX *= pow10_int64[shift];
+		state->fastScale = dscale;
+	}
+	else if (dscale < state->fastScale)
+	{
+		int			shift = state->fastScale - dscale;
+
+		if (shift > NUMERIC_FAST_MAX_EXP10 - 2)
+		{
+			numeric_agg_flush_fast(state);
+			state->fastScale = dscale;
+		}
+		else
+			x *= pow10_int64[shift];
+	}
+
+	/* x is below 10^34 after rescaling, so this can't overflow */
+	state->fastSumX += x;
+
+	if (state->fastSumX > NUMERIC_FAST_MAX_RESULT ||
+		state->fastSumX < -NUMERIC_FAST_MAX_RESULT)
+		numeric_agg_flush_fast(state);
+}
+#endif
+
 /*
  * Prepare state data for a numeric aggregate function that needs to compute
  * sum, count and optionally sum of squares of the input.
@@ -3577,6 +3772,30 @@ do_numeric_accum(NumericAggState *state, Numeric newval)
 		return;
 	}
 
+#ifdef HAVE_INT128
+	if (!state->calcSumX2)
+	{
+		int64		val;
+		int			dscale;
+
+		if (numeric_to_scaled_int64(newval, &val, &dscale))
+		{
+			/* as below */
+			if (dscale > state->maxScale)
+			{
+				state->maxScale = dscale;
+				state->maxScaleCount = 1;
+			}
+			else if (dscale == state->maxScale)
+				state->maxScaleCount++;
+
+			state->N++;
+			numeric_agg_add_fast(state, val, dscale);
+			return;
+		}
+	}
+#endif
+
 	/* load processed number in short-lived context */
 	init_var_from_num(newval, &X);
 
@@ -3642,6 +3861,10 @@ do_numeric_discard(NumericAggState *state, Numeric newval)
 		return true;
 	}
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state);
+#endif
+
 	/* load processed number in short-lived context */
 	init_var_from_num(newval, &X);
 
@@ -3753,6 +3976,12 @@ numeric_combine(PG_FUNCTION_ARGS)
 	if (state2 == NULL)
 		PG_RETURN_POINTER(state1);
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state2);
+	if (state1 != NULL)
+		numeric_agg_flush_fast(state1);
+#endif
+
 	/* manually copy all fields from state2 to state1 */
 	if (state1 == NULL)
 	{
@@ -3841,6 +4070,12 @@ numeric_avg_combine(PG_FUNCTION_ARGS)
 	if (state2 == NULL)
 		PG_RETURN_POINTER(state1);
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state2);
+	if (state1 != NULL)
+		numeric_agg_flush_fast(state1);
+#endif
+
 	/* manually copy all fields from state2 to state1 */
 	if (state1 == NULL)
 	{
@@ -3908,6 +4143,10 @@ numeric_avg_serialize(PG_FUNCTION_ARGS)
 
 	state = (NumericAggState *) PG_GETARG_POINTER(0);
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state);
+#endif
+
 	/*
 	 * This is a little wasteful since make_result converts the NumericVar
 	 * into a Numeric and numeric_send converts it back again. Is it worth
@@ -4021,6 +4260,10 @@ numeric_serialize(PG_FUNCTION_ARGS)
 
 	state = (NumericAggState *) PG_GETARG_POINTER(0);
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state);
+#endif
+
 	/*
 	 * This is a little wasteful since make_result converts the NumericVar
 	 * into a Numeric and numeric_send converts it back again. Is it worth
@@ -4922,6 +5165,10 @@ numeric_avg(PG_FUNCTION_ARGS)
 	if (state->NaNcount > 0)	/* there was at least one NaN input */
 		PG_RETURN_NUMERIC(make_result(&const_nan));
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state);
+#endif
+
 	N_datum = DirectFunctionCall1(int8_numeric, Int64GetDatum(state->N));
 
 	init_var(&sumX_var);
@@ -4948,6 +5195,10 @@ numeric_sum(PG_FUNCTION_ARGS)
 	if (state->NaNcount > 0)	/* there was at least one NaN input */
 		PG_RETURN_NUMERIC(make_result(&const_nan));
 
+#ifdef HAVE_INT128
+	numeric_agg_flush_fast(state);
+#endif
+
 	init_var(&sumX_var);
 	accum_sum_final(&state->sumX, &sumX_var);
 	result = make_result(&sumX_var);
@@ -6659,6 +6910,82 @@ int128_to_numericvar(int128 val, NumericVar *var)
 	var->ndigits = ndigits;
 	var->weight = ndigits - 1;
 }
+
+/*
+ * Convert a non-NaN numeric to an integer scaled by 10^dscale, where dscale
+ * is its display scale, if that integer is less than 10^18 in absolute
+ * value.  Returns false, without setting the results, otherwise.
+ *
+ * This works directly on the packed digits, so that the fast paths using it
+ * don't need to unpack the value into a NumericVar.
+ */
+static bool
+numeric_to_scaled_int64(Numeric num, int64 *result, int *dscale)
+{
+	NumericDigit *digits = NUMERIC_DIGITS(num);
+	int			ndigits = NUMERIC_NDIGITS(num);
+	int			scale = NUMERIC_DSCALE(num);
+	int			exp10;
+	int64		val = 0;
+	int			i;
+
+	if (NUMERIC_IS_NAN(num))
+		return false;
+
+	if (ndigits == 0)
+	{
+		*result = 0;
+		*dscale = scale;
+		return true;
+	}
+
+	/*
+	 * exp10 is the decimal exponent of the last NBASE digit, relative to
+	 * 10^-dscale.  It can be negative, by less than DEC_DIGITS, when the
+	 * last digit has zeroes beyond the display scale.
+	 */
+	exp10 = scale + (NUMERIC_WEIGHT(num) - ndigits + 1) * DEC_DIGITS;
+	if (ndigits * DEC_DIGITS + exp10 > NUMERIC_FAST_MAX_EXP10)
+		return false;
+	Assert(exp10 > -DEC_DIGITS);
+
+	for (i = 0; i < ndigits - 1; i++)
+		val = val * NBASE + digits[i];
+	if (exp10 >= 0)
+		val = (val * NBASE + digits[ndigits - 1]) * pow10_int64[exp10];
+	else
+		val = val * (NBASE / pow10_int64[-exp10]) +
+			digits[ndigits - 1] / pow10_int64[-exp10];
+
+	*result = (NUMERIC_SIGN(num) == NUMERIC_NEG) ? -val : val;
+	*dscale = scale;
+	return true;
+}
+
+/*
+ * Make a numeric of display scale dscale from an integer scaled by
+ * 10^dscale.  The integer must be less than NUMERIC_FAST_MAX_RESULT in
+ * absolute value, so that it can be padded out to whole NBASE digits.
+ */
+static Numeric
+make_result_from_scaled_int128(int128 val, int dscale, bool *have_error)
+{
+	NumericVar	var;
+	Numeric		res;
+	int			pad = (DEC_DIGITS - dscale % DEC_DIGITS) % DEC_DIGITS;
+
+	init_var(&var);
+	int128_to_numericvar(val * pow10_int64[pad], &var);
+	if (var.ndigits > 0)
+		var.weight -= (dscale + pad) / DEC_DIGITS;
+	var.dscale = dscale;
+
+	res = make_result_opt_error(&var, have_error);
+
+	free_var(&var);
+
+	return res;
+}
 #endif
 
 /*
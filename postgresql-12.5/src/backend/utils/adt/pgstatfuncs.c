@@ -17,6 +17,7 @@
 #include "access/htup_details.h"
 #include "access/xlog.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
 #include "common/ip.h"
 #include "funcapi.h"
@@ -27,8 +28,11 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/inet.h"
+#include "utils/relcache.h"
 #include "utils/timestamp.h"
 
 #define UINT32_ACCESS_ONCE(var)		 ((uint32)(*((volatile uint32 *)&(var))))
@@ -198,6 +202,22 @@ pg_stat_get_mod_since_analyze(PG_FUNCTION_ARGS)
 }
 
 
+Datum
+pg_stat_get_ins_since_vacuum(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatTabEntry *tabentry;
+
+	if ((tabentry = pgstat_fetch_stat_tabentry(relid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (tabentry->inserts_since_vacuum);
+
+	PG_RETURN_INT64(result);
+}
+
+
 Datum
 pg_stat_get_blocks_fetched(PG_FUNCTION_ARGS)
 {
@@ -1977,3 +1997,184 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(
 									  heap_form_tuple(tupdesc, values, nulls)));
 }
+
+/*
+ * Returns LWLock contention statistics, one row per tranche that has been
+ * used since server start.  Requires track_lwlock_stats.
+ */
+Datum
+pg_stat_get_lwlocks(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LWLOCKS_COLS	7
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	LWLockTrancheStats *stats;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	stats = palloc(LWLOCK_STATS_NUM_TRANCHES * sizeof(LWLockTrancheStats));
+	LWLockGetStats(stats);
+
+	for (i = 0; i < LWLOCK_STATS_NUM_TRANCHES; i++)
+	{
+		LWLockTrancheStats *s = &stats[i];
+		Datum		values[PG_STAT_GET_LWLOCKS_COLS];
+		bool		nulls[PG_STAT_GET_LWLOCKS_COLS];
+		Datum		hist[LWLOCK_STATS_WAIT_BUCKETS];
+		int			j;
+
+		/* Skip tranches that were never used */
+		if (s->sh_acquire_count == 0 && s->ex_acquire_count == 0 &&
+			s->block_count == 0)
+			continue;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		if (i == LWTRANCHE_FIRST_USER_DEFINED)
+			values[0] = CStringGetTextDatum("extension");
+		else
+			values[0] = CStringGetTextDatum(GetLWLockIdentifier(PG_WAIT_LWLOCK, i));
+		values[1] = Int64GetDatum(s->sh_acquire_count);
+		values[2] = Int64GetDatum(s->ex_acquire_count);
+		values[3] = Int64GetDatum(s->block_count);
+		values[4] = Int64GetDatum(s->spin_delay_count);
+		/* convert to msec for display */
+		values[5] = Float8GetDatum(((double) s->wait_time) / 1000.0);
+		for (j = 0; j < LWLOCK_STATS_WAIT_BUCKETS; j++)
+			hist[j] = Int64GetDatum(s->wait_hist[j]);
+		values[6] = PointerGetDatum(construct_array(hist,
+													LWLOCK_STATS_WAIT_BUCKETS,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL, 'd'));
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns statistics about the current backend's caches: one row for each
+ * catalog cache, and one for the relation cache.
+ */
+Datum
+pg_stat_get_catalog_caches(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_CATALOG_CACHES_COLS	12
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	CatCacheStats *stats;
+	int			ncaches;
+	Datum		values[PG_STAT_GET_CATALOG_CACHES_COLS];
+	bool		nulls[PG_STAT_GET_CATALOG_CACHES_COLS];
+	long		entries;
+	long		hits;
+	long		misses;
+	long		evictions;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* Take the snapshot of all counters before we start building tuples */
+	ncaches = CatCacheGetStats(&stats);
+	RelationCacheGetStats(&entries, &hits, &misses, &evictions);
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	for (i = 0; i < ncaches; i++)
+	{
+		CatCacheStats *s = &stats[i];
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum("catalog");
+		values[1] = Int32GetDatum(s->cacheId);
+		values[2] = ObjectIdGetDatum(s->reloid);
+		values[3] = ObjectIdGetDatum(s->indexoid);
+		values[4] = Int64GetDatum(s->ntup);
+		values[5] = Int64GetDatum(s->nnegative);
+		values[6] = Int64GetDatum(s->nlists);
+		values[7] = Int64GetDatum(s->memory);
+		values[8] = Int64GetDatum(s->searches);
+		values[9] = Int64GetDatum(s->hits);
+		values[10] = Int64GetDatum(s->neg_hits);
+		values[11] = Int64GetDatum(s->evictions);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* The relation cache doesn't track memory or have negative entries */
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = CStringGetTextDatum("relation");
+	nulls[1] = true;
+	values[2] = ObjectIdGetDatum(RelationRelationId);
+	nulls[3] = true;
+	values[4] = Int64GetDatum(entries);
+	nulls[5] = true;
+	nulls[6] = true;
+	nulls[7] = true;
+	values[8] = Int64GetDatum(hits + misses);
+	values[9] = Int64GetDatum(hits);
+	nulls[10] = true;
+	values[11] = Int64GetDatum(evictions);
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -119,6 +119,8 @@ static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 												bool fetching_unmatched);
 static ArrayType *build_regexp_match_result(regexp_matches_ctx *matchctx);
 static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
+static bool RE_prefiltered_execute(FunctionCallInfo fcinfo, text *text_re,
+								   char *dat, int dat_len);
 
 
 /*
@@ -353,6 +355,232 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 }
 
 
+/*
+ * Most patterns used with ~ contain some literal text that every match must
+ * include, as 'bar' in '^foo[0-9]+bar'.  When a string doesn't contain that
+ * text, which is the common case when filtering, it can be rejected with a
+ * quick substring search instead of running the regex engine.  The pattern
+ * analysis is kept in fn_extra.  The compiled regex itself stays in the
+ * cache above: a pointer to it in fn_extra would dangle once it is evicted.
+ */
+typedef struct RegexPrefilter
+{
+	char	   *pat;			/* copy of the pattern this was built from */
+	int			plen;
+	Oid			collation;
+	int			misses;			/* pattern changes since the last reuse */
+	bool		disabled;		/* pattern changes too often, don't cache */
+	int			litlen;			/* length of required literal, 0 if none */
+	char	   *lit;
+	LiteralSearch search;
+} RegexPrefilter;
+
+/* give up caching after this many consecutive pattern changes */
+#define RE_PREFILTER_MAX_MISSES 8
+
+/*
+ * Find the longest run of ASCII characters that any match of an ARE must
+ * contain, and return its length (0 if none).  This is deliberately
+ * conservative: patterns using grouping, alternation, escapes (including
+ * escapes inside bracket expressions, where an ARE treats "\]" as a literal
+ * bracket), bounds or director prefixes are not analyzed at all, and
+ * multibyte characters just end a run.
+ */
+static int
+RE_required_literal(const char *pat, int plen, int *litstart)
+{
+	int			i = 0;
+	int			runstart = 0;
+	int			runlen = 0;
+	int			bestlen = 0;
+
+	if (plen >= 3 && strncmp(pat, "***", 3) == 0)
+		return 0;
+
+#define END_RUN() \
+	do { \
+		if (runlen > bestlen) \
+		{ \
+			bestlen = runlen; \
+			*litstart = runstart; \
+		} \
+		runlen = 0; \
+	} while (0)
+
+	while (i < plen)
+	{
+		unsigned char c = (unsigned char) pat[i];
+
+		switch (c)
+		{
+			case '(':
+			case ')':
+			case '|':
+			case '\\':
+			case '{':
+				return 0;
+			case '[':
+				/* skip a bracket expression */
+				END_RUN();
+				i++;
+				if (i < plen && pat[i] == '^')
+					i++;
+				if (i < plen && pat[i] == ']')
+					i++;
+				while (i < plen && pat[i] != ']')
+				{
+					if (pat[i] == '\\')
+						return 0;
+					if (pat[i] == '[' && i + 1 < plen &&
+						(pat[i + 1] == ':' || pat[i + 1] == '.' || pat[i + 1] == '='))
+					{
+						char		delim = pat[i + 1];
+
+						i += 2;
+						while (i + 1 < plen && !(pat[i] == delim && pat[i + 1] == ']'))
+							i++;
+						if (i + 1 >= plen)
+							return 0;
+						i += 2;
+					}
+					else
+						i++;
+				}
+				if (i >= plen)
+					return 0;
+				i++;
+				break;
+			case '.':
+			case '^':
+			case '$':
+			case '*':
+			case '+':
+			case '?':
+			case ']':
+			case '}':
+				END_RUN();
+				i++;
+				break;
+			default:
+				if (IS_HIGHBIT_SET(c))
+				{
+					END_RUN();
+					i++;
+					break;
+				}
+				if (i + 1 < plen && pat[i + 1] == '{')
+					return 0;
+				if (i + 1 < plen && (pat[i + 1] == '*' || pat[i + 1] == '?'))
+				{
+					/* optional character */
+					END_RUN();
+					i += 2;
+				}
+				else if (i + 1 < plen && pat[i + 1] == '+')
+				{
+					/* required once, but the run can't continue past it */
+					if (runlen == 0)
+						runstart = i;
+					runlen++;
+					END_RUN();
+					i += 2;
+				}
+				else
+				{
+					if (runlen == 0)
+						runstart = i;
+					runlen++;
+					i++;
+				}
+				break;
+		}
+	}
+	END_RUN();
+
+#undef END_RUN
+
+	return bestlen;
+}
+
+/*
+ * (Re)build the prefilter for a pattern.  The regex is compiled first, so
+ * that an invalid pattern is reported even if no string reaches regexec.
+ */
+static void
+RE_prefilter_build(RegexPrefilter *pf, MemoryContext mcxt,
+				   text *text_re, Oid collation)
+{
+	char	   *pat = VARDATA_ANY(text_re);
+	int			plen = VARSIZE_ANY_EXHDR(text_re);
+	int			litstart = 0;
+
+	(void) RE_compile_and_cache(text_re, REG_ADVANCED, collation);
+
+	if (pf->pat)
+		pfree(pf->pat);
+	pf->pat = MemoryContextAlloc(mcxt, plen + 1);
+	memcpy(pf->pat, pat, plen);
+	pf->plen = plen;
+	pf->collation = collation;
+
+	pf->litlen = RE_required_literal(pf->pat, plen, &litstart);
+	pf->lit = pf->pat + litstart;
+	if (pf->litlen > 0)
+		literal_search_init(&pf->search, pf->lit, pf->litlen);
+}
+
+/*
+ * RE_prefiltered_execute - RE_compile_and_execute() for the ~ and !~
+ * operators, rejecting strings that lack the pattern's required literal
+ * text without running the regex.
+ */
+static bool
+RE_prefiltered_execute(FunctionCallInfo fcinfo, text *text_re,
+					   char *dat, int dat_len)
+{
+	Oid			collation = PG_GET_COLLATION();
+	RegexPrefilter *pf;
+
+	if (fcinfo->flinfo == NULL)
+		return RE_compile_and_execute(text_re, dat, dat_len, REG_ADVANCED,
+									  collation, 0, NULL);
+
+	pf = (RegexPrefilter *) fcinfo->flinfo->fn_extra;
+	if (pf == NULL)
+	{
+		pf = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+									sizeof(RegexPrefilter));
+		fcinfo->flinfo->fn_extra = pf;
+		RE_prefilter_build(pf, fcinfo->flinfo->fn_mcxt, text_re, collation);
+	}
+	else if (pf->disabled)
+		return RE_compile_and_execute(text_re, dat, dat_len, REG_ADVANCED,
+									  collation, 0, NULL);
+	else if (pf->plen != VARSIZE_ANY_EXHDR(text_re) ||
+			 pf->collation != collation ||
+			 memcmp(pf->pat, VARDATA_ANY(text_re), pf->plen) != 0)
+	{
+		if (++pf->misses > RE_PREFILTER_MAX_MISSES)
+		{
+			pf->disabled = true;
+			return RE_compile_and_execute(text_re, dat, dat_len, REG_ADVANCED,
+										  collation, 0, NULL);
+		}
+		/* in case building fails, don't leave a stale literal behind */
+		pf->plen = -1;
+		RE_prefilter_build(pf, fcinfo->flinfo->fn_mcxt, text_re, collation);
+	}
+	else
+		pf->misses = 0;
+
+	if (pf->litlen > 0 && literal_search(&pf->search, dat, dat_len) == NULL)
+		return false;
+
+	return RE_compile_and_execute(text_re, dat, dat_len, REG_ADVANCED,
+								  collation, 0, NULL);
+}
+
+
 /*
  * parse_re_flags - parse the options argument of regexp_match and friends
  *
@@ -442,12 +670,9 @@ nameregexeq(PG_FUNCTION_ARGS)
 	Name		n = PG_GETARG_NAME(0);
 	text	   *p = PG_GETARG_TEXT_PP(1);
 
-	PG_RETURN_BOOL(RE_compile_and_execute(p,
-										  NameStr(*n),
-										  strlen(NameStr(*n)),
-										  REG_ADVANCED,
-										  PG_GET_COLLATION(),
-										  0, NULL));
+	PG_RETURN_BOOL(RE_prefiltered_execute(fcinfo, p,
+					      NameStr(*n),
+					      strlen(NameStr(*n))));
 }
 
 Datum
@@ -456,12 +681,9 @@ nameregexne(PG_FUNCTION_ARGS)
 	Name		n = PG_GETARG_NAME(0);
 	text	   *p = PG_GETARG_TEXT_PP(1);
 
-	PG_RETURN_BOOL(!RE_compile_and_execute(p,
-										   NameStr(*n),
-										   strlen(NameStr(*n)),
-										   REG_ADVANCED,
-										   PG_GET_COLLATION(),
-										   0, NULL));
+	PG_RETURN_BOOL(!RE_prefiltered_execute(fcinfo, p,
+					       NameStr(*n),
+					       strlen(NameStr(*n))));
 }
 
 Datum
@@ -470,12 +692,9 @@ textregexeq(PG_FUNCTION_ARGS)
 	text	   *s = PG_GETARG_TEXT_PP(0);
 	text	   *p = PG_GETARG_TEXT_PP(1);
 
-	PG_RETURN_BOOL(RE_compile_and_execute(p,
-										  VARDATA_ANY(s),
-										  VARSIZE_ANY_EXHDR(s),
-										  REG_ADVANCED,
-										  PG_GET_COLLATION(),
-										  0, NULL));
+	PG_RETURN_BOOL(RE_prefiltered_execute(fcinfo, p,
+					      VARDATA_ANY(s),
+					      VARSIZE_ANY_EXHDR(s)));
 }
 
 Datum
@@ -484,12 +703,9 @@ textregexne(PG_FUNCTION_ARGS)
 	text	   *s = PG_GETARG_TEXT_PP(0);
 	text	   *p = PG_GETARG_TEXT_PP(1);
 
-	PG_RETURN_BOOL(!RE_compile_and_execute(p,
-										   VARDATA_ANY(s),
-										   VARSIZE_ANY_EXHDR(s),
-										   REG_ADVANCED,
-										   PG_GET_COLLATION(),
-										   0, NULL));
+	PG_RETURN_BOOL(!RE_prefiltered_execute(fcinfo, p,
+					       VARDATA_ANY(s),
+					       VARSIZE_ANY_EXHDR(s)));
 }
 
 
@@ -1251,8 +1467,8 @@ build_regexp_match_result(regexp_matches_ctx *matchctx)
 		else if (buf)
 		{
 			int			len = pg_wchar2mb_with_len(matchctx->wide_str + so,
-												   buf,
-												   eo - so);
+						   buf,
+						   eo - so);
 
 			Assert(len < bufsiz);
 			elems[i] = PointerGetDatum(cstring_to_text_with_len(buf, len));
@@ -23,11 +23,14 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_operator.h"
@@ -40,6 +43,7 @@
 #include "parser/parse_relation.h"
 #include "miscadmin.h"
 #include "storage/bufmgr.h"
+#include "storage/proc.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -106,6 +110,7 @@ typedef struct RI_ConstraintInfo
 	NameData	conname;		/* name of the FK constraint */
 	Oid			pk_relid;		/* referenced relation */
 	Oid			fk_relid;		/* referencing relation */
+	Oid			conindid;		/* unique index on the referenced columns */
 	char		confupdtype;	/* foreign key's ON UPDATE action */
 	char		confdeltype;	/* foreign key's ON DELETE action */
 	char		confmatchtype;	/* foreign key's match type */
@@ -160,6 +165,26 @@ typedef struct RI_CompareHashEntry
 	FmgrInfo	cast_func_finfo;	/* in case we must coerce input */
 } RI_CompareHashEntry;
 
+/*
+ * RI_FastPathKey
+ *
+ * The last key ri_FastPathCheck found in the PK table.  The KEY SHARE lock
+ * taken on the referenced row keeps it from being deleted or having its key
+ * changed by anyone else until our (sub)transaction ends, and as long as the
+ * command ID hasn't advanced our own transaction hasn't modified anything
+ * either, so the same key is known to pass again without another probe.
+ * Bulk loads commonly reference the same parent row many times in a row.
+ */
+typedef struct RI_FastPathKey
+{
+	Oid			constraint_id;	/* InvalidOid if nothing remembered */
+	LocalTransactionId lxid;	/* transaction the lock was taken in */
+	SubTransactionId subxid;	/* ... and subtransaction */
+	CommandId	cid;			/* command ID at the time of the check */
+	MemoryContext cxt;			/* holds copies of pass-by-ref values */
+	Datum		vals[RI_MAX_NUMKEYS];	/* the FK values checked */
+} RI_FastPathKey;
+
 
 /*
  * Local data
@@ -169,6 +194,7 @@ static HTAB *ri_query_cache = NULL;
 static HTAB *ri_compare_cache = NULL;
 static dlist_head ri_constraint_cache_valid_list;
 static int	ri_constraint_cache_valid_count = 0;
+static RI_FastPathKey ri_fastpath_key;
 
 
 /*
@@ -211,6 +237,15 @@ static const RI_ConstraintInfo *ri_LoadConstraintInfo(Oid constraintOid);
 static SPIPlanPtr ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 							   RI_QueryKey *qkey, Relation fk_rel, Relation pk_rel,
 							   bool cache_plan);
+static bool ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+							 Relation fk_rel, Relation pk_rel,
+							 TupleTableSlot *newslot);
+static bool ri_FastPathScanKeys(const RI_ConstraintInfo *riinfo,
+								Relation fk_rel, Relation pk_rel,
+								Relation idxrel, Datum *vals, ScanKey skey);
+static bool ri_FastPathLockRow(Relation pk_rel, Relation idxrel,
+							   TupleTableSlot *pkslot, Snapshot snapshot,
+							   CommandId cid, ScanKey skey);
 static bool ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 							RI_QueryKey *qkey, SPIPlanPtr qplan,
 							Relation fk_rel, Relation pk_rel,
@@ -335,6 +370,17 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * In the common case of a plain table with a btree unique index on the
+	 * referenced columns, probe the index directly instead of running the
+	 * query below through SPI.
+	 */
+	if (ri_FastPathCheck(riinfo, fk_rel, pk_rel, newslot))
+	{
+		table_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -2048,6 +2094,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 	memcpy(&riinfo->conname, &conForm->conname, sizeof(NameData));
 	riinfo->pk_relid = conForm->confrelid;
 	riinfo->fk_relid = conForm->conrelid;
+	riinfo->conindid = conForm->conindid;
 	riinfo->confupdtype = conForm->confupdtype;
 	riinfo->confdeltype = conForm->confdeltype;
 	riinfo->confmatchtype = conForm->confmatchtype;
@@ -2170,6 +2217,298 @@ ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 	return qplan;
 }
 
+/*
+ * ri_FastPathCheck -
+ *
+ * Check that the key of a new or updated FK row exists in the PK table by
+ * probing the constraint's unique index directly and locking the row found
+ * in KEY SHARE mode.  This has the same effect as the RI_PLAN_CHECK_LOOKUPPK
+ * query, without paying for executor startup and shutdown through SPI on
+ * every single row.
+ *
+ * Returns false if the fast path can't be used for this constraint, in which
+ * case the caller must run the query instead.  Otherwise returns true if the
+ * key was found, and reports the violation if not.
+ */
+static bool
+ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+				 Relation fk_rel, Relation pk_rel,
+				 TupleTableSlot *newslot)
+{
+	TupleDesc	fk_desc = RelationGetDescr(fk_rel);
+	Oid			pk_relid = RelationGetRelid(pk_rel);
+	int			nkeys = riinfo->nkeys;
+	Datum		vals[RI_MAX_NUMKEYS];
+	char		nulls[RI_MAX_NUMKEYS];
+	ScanKeyData skey[RI_MAX_NUMKEYS];
+	Oid			save_userid;
+	int			save_sec_context;
+	Relation	idxrel;
+	bool		usable;
+	IndexScanDesc scan;
+	TupleTableSlot *pkslot;
+	Snapshot	snapshot;
+	CommandId	cid;
+	bool		found = false;
+	MemoryContext oldcxt;
+
+	/* Partitioned PK tables are left to the query */
+	if (pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		!OidIsValid(riinfo->conindid))
+		return false;
+
+	ri_ExtractValues(fk_rel, newslot, riinfo, false, vals, nulls);
+
+	/* Be sure all my own work is visible, as SPI would */
+	CommandCounterIncrement();
+	cid = GetCurrentCommandId(false);
+
+	/* Same key as the last check, with nothing changed since? */
+	if (ri_fastpath_key.constraint_id == riinfo->constraint_id &&
+		ri_fastpath_key.lxid == MyProc->lxid &&
+		ri_fastpath_key.subxid == GetCurrentSubTransactionId() &&
+		ri_fastpath_key.cid == cid)
+	{
+		int			i;
+
+		for (i = 0; i < nkeys; i++)
+		{
+			Form_pg_attribute att = TupleDescAttr(fk_desc,
+												  riinfo->fk_attnums[i] - 1);
+
+			if (!datumIsEqual(vals[i], ri_fastpath_key.vals[i],
+							  att->attbyval, att->attlen))
+				break;
+		}
+		if (i == nkeys)
+			return true;
+	}
+
+	/* Do the lookup as the PK table's owner, like ri_PerformCheck */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(RelationGetForm(pk_rel)->relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	/*
+	 * Leave anything out of the ordinary, such as missing privileges or row
+	 * level security, to the query so that it's reported the same way.
+	 */
+	idxrel = index_open(riinfo->conindid, AccessShareLock);
+	usable = pg_class_aclcheck(pk_relid, GetUserId(), ACL_SELECT) == ACLCHECK_OK &&
+		pg_class_aclcheck(pk_relid, GetUserId(), ACL_UPDATE) == ACLCHECK_OK &&
+		check_enable_rls(pk_relid, InvalidOid, true) != RLS_ENABLED &&
+		ri_FastPathScanKeys(riinfo, fk_rel, pk_rel, idxrel, vals, skey);
+
+	if (!usable)
+	{
+		index_close(idxrel, AccessShareLock);
+		SetUserIdAndSecContext(save_userid, save_sec_context);
+		return false;
+	}
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+	snapshot = GetActiveSnapshot();
+
+	pkslot = table_slot_create(pk_rel, NULL);
+	scan = index_beginscan(pk_rel, idxrel, snapshot, nkeys, 0);
+	index_rescan(scan, skey, nkeys, NULL, 0);
+
+	while (!found && index_getnext_slot(scan, ForwardScanDirection, pkslot))
+		found = ri_FastPathLockRow(pk_rel, idxrel, pkslot, snapshot, cid, skey);
+
+	index_endscan(scan);
+	ExecDropSingleTupleTableSlot(pkslot);
+	PopActiveSnapshot();
+
+	/* Keep the index lock until end of transaction, as the executor does */
+	index_close(idxrel, NoLock);
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	if (!found)
+		ri_ReportViolation(riinfo,
+						   pk_rel, fk_rel,
+						   newslot,
+						   NULL,
+						   RI_PLAN_CHECK_LOOKUPPK, false);
+
+	/* Remember the key, so a run of rows referencing it needn't look again */
+	ri_fastpath_key.constraint_id = InvalidOid;
+	if (ri_fastpath_key.cxt == NULL || ri_fastpath_key.lxid != MyProc->lxid)
+		ri_fastpath_key.cxt = AllocSetContextCreate(TopTransactionContext,
+													"RI fast path key",
+													ALLOCSET_SMALL_SIZES);
+	else
+		MemoryContextReset(ri_fastpath_key.cxt);
+
+	oldcxt = MemoryContextSwitchTo(ri_fastpath_key.cxt);
+	for (int i = 0; i < nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(fk_desc,
+											  riinfo->fk_attnums[i] - 1);
+
+		ri_fastpath_key.vals[i] = datumCopy(vals[i],
+											att->attbyval, att->attlen);
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	ri_fastpath_key.lxid = MyProc->lxid;
+	ri_fastpath_key.subxid = GetCurrentSubTransactionId();
+	ri_fastpath_key.cid = cid;
+	ri_fastpath_key.constraint_id = riinfo->constraint_id;
+
+	return true;
+}
+
+/*
+ * ri_FastPathScanKeys -
+ *
+ * Build scan keys for looking up the FK values in the constraint's unique
+ * index.  Returns false if that's not possible without coercing the values,
+ * or if the index isn't a plain btree matching the referenced columns.
+ */
+static bool
+ri_FastPathScanKeys(const RI_ConstraintInfo *riinfo,
+					Relation fk_rel, Relation pk_rel,
+					Relation idxrel, Datum *vals, ScanKey skey)
+{
+	Form_pg_index index = idxrel->rd_index;
+
+	if (idxrel->rd_rel->relam != BTREE_AM_OID ||
+		index->indrelid != RelationGetRelid(pk_rel) ||
+		!index->indisvalid ||
+		index->indnkeyatts != riinfo->nkeys)
+		return false;
+
+	for (int j = 0; j < riinfo->nkeys; j++)
+	{
+		int			i;
+		Oid			eq_opr;
+		Oid			fk_type;
+		Oid			lefttype;
+		Oid			righttype;
+
+		/* Find the key column this index column corresponds to */
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			if (riinfo->pk_attnums[i] == index->indkey.values[j])
+				break;
+		}
+		if (i == riinfo->nkeys)
+			return false;
+
+		/*
+		 * The PK = FK operator must be the index column's equality operator,
+		 * taking the FK value without any run-time coercion.
+		 */
+		eq_opr = riinfo->pf_eq_oprs[i];
+		fk_type = getBaseType(RIAttType(fk_rel, riinfo->fk_attnums[i]));
+		op_input_types(eq_opr, &lefttype, &righttype);
+		if (lefttype != idxrel->rd_opcintype[j] ||
+			!IsBinaryCoercible(fk_type, righttype) ||
+			get_op_opfamily_strategy(eq_opr, idxrel->rd_opfamily[j]) !=
+			BTEqualStrategyNumber)
+			return false;
+
+		ScanKeyEntryInitialize(&skey[j],
+							   0,
+							   j + 1,
+							   BTEqualStrategyNumber,
+							   righttype,
+							   idxrel->rd_indcollation[j],
+							   get_opcode(eq_opr),
+							   vals[i]);
+	}
+
+	return true;
+}
+
+/*
+ * ri_FastPathLockRow -
+ *
+ * Lock the PK row returned by the index scan in KEY SHARE mode, following
+ * the update chain in READ COMMITTED mode the way SELECT FOR KEY SHARE does.
+ * Returns true if the row (or its latest version, which must still match the
+ * key) is locked; false if it went away and the scan should go on.
+ */
+static bool
+ri_FastPathLockRow(Relation pk_rel, Relation idxrel,
+				   TupleTableSlot *pkslot, Snapshot snapshot,
+				   CommandId cid, ScanKey skey)
+{
+	ItemPointerData tid = pkslot->tts_tid;
+	TM_FailureData tmfd;
+	int			lockflags;
+	TM_Result	test;
+
+	lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+	if (!IsolationUsesXactSnapshot())
+		lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+	test = table_tuple_lock(pk_rel, &tid, snapshot, pkslot, cid,
+							LockTupleKeyShare, LockWaitBlock,
+							lockflags, &tmfd);
+
+	switch (test)
+	{
+		case TM_Ok:
+			break;
+
+		case TM_SelfModified:
+		case TM_WouldBlock:
+			/* see ExecLockRows */
+			return false;
+
+		case TM_Updated:
+			if (IsolationUsesXactSnapshot())
+				ereport(ERROR,
+						(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						 errmsg("could not serialize access due to concurrent update")));
+			elog(ERROR, "unexpected table_tuple_lock status: %u", test);
+			break;
+
+		case TM_Deleted:
+			if (IsolationUsesXactSnapshot())
+				ereport(ERROR,
+						(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						 errmsg("could not serialize access due to concurrent update")));
+			return false;
+
+		case TM_Invisible:
+			elog(ERROR, "attempted to lock invisible tuple");
+			break;
+
+		default:
+			elog(ERROR, "unrecognized table_tuple_lock status: %u", test);
+			break;
+	}
+
+	/*
+	 * If we locked a newer version of the row, recheck that it still has the
+	 * key we're looking for; this is what EvalPlanQual would do.
+	 */
+	if (tmfd.traversed)
+	{
+		for (int j = 0; j < idxrel->rd_index->indnkeyatts; j++)
+		{
+			Datum		pkval;
+			bool		isnull;
+
+			pkval = slot_getattr(pkslot, idxrel->rd_index->indkey.values[j],
+								 &isnull);
+			if (isnull ||
+				!DatumGetBool(FunctionCall2Coll(&skey[j].sk_func,
+												skey[j].sk_collation,
+												pkval,
+												skey[j].sk_argument)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
 /*
  * Perform a query to enforce an RI restriction
  */
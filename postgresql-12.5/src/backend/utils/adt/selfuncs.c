@@ -5998,8 +5998,23 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	bool		skip_scan;
+	double		num_skip_prefixes = 0;
 	ListCell   *lc;
 
+	/*
+	 * If there are no quals on the leading index column, but some on the
+	 * second one, nbtree runs the scan as a skip scan: one scan per distinct
+	 * value of the leading column, each positioned using the quals on the
+	 * following columns (see _bt_preprocess_skip).  For costing purposes we
+	 * can then treat the leading column as though it had an '=' qual, and
+	 * charge for the additional descents below.
+	 */
+	skip_scan = (enable_indexskipscan &&
+				 index->nkeycolumns > 1 &&
+				 path->indexclauses != NIL &&
+				 linitial_node(IndexClause, path->indexclauses)->indexcol == 1);
+
 	/*
 	 * For a btree scan, only leading '=' quals plus inequality quals for the
 	 * immediately next attribute contribute to index selectivity (these are
@@ -6018,7 +6033,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * considered to act the same as it normally does.
 	 */
 	indexBoundQuals = NIL;
-	indexcol = 0;
+	indexcol = skip_scan ? 1 : 0;
 	eqQualHere = false;
 	found_saop = false;
 	found_is_null_op = false;
@@ -6100,6 +6115,14 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		}
 	}
 
+	/* nbtree doesn't combine skipping with array keys */
+	if (skip_scan && found_saop)
+	{
+		skip_scan = false;
+		indexBoundQuals = NIL;
+		num_sa_scans = 1;
+	}
+
 	/*
 	 * If index is unique and we found an '=' clause for each column, we can
 	 * just assume numIndexTuples = 1 and skip the expensive
@@ -6107,6 +6130,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
+		!skip_scan &&
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
@@ -6136,6 +6160,35 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		 * to integer.
 		 */
 		numIndexTuples = rint(numIndexTuples / num_sa_scans);
+
+		/*
+		 * A skip scan visits at least one leaf page per distinct leading
+		 * value.  If that adds up to about as many pages as the whole index
+		 * has, nbtree soon falls back to reading the rest of the index in
+		 * order, so cost the scan that way.
+		 */
+		if (skip_scan)
+		{
+			TargetEntry *tle = linitial_node(TargetEntry, index->indextlist);
+			bool		isdefault;
+
+			examine_variable(root, (Node *) tle->expr, 0, &vardata);
+			num_skip_prefixes = get_variable_numdistinct(&vardata, &isdefault);
+			ReleaseVariableStats(vardata);
+
+			if (index->tuples <= 0 ||
+				numIndexTuples * index->pages / index->tuples +
+				num_skip_prefixes >= index->pages)
+			{
+				skip_scan = false;
+				selectivityQuals = add_predicate_to_index_quals(index, NIL);
+				btreeSelectivity = clauselist_selectivity(root, selectivityQuals,
+														  index->rel->relid,
+														  JOIN_INNER,
+														  NULL);
+				numIndexTuples = rint(btreeSelectivity * index->rel->tuples);
+			}
+		}
 	}
 
 	/*
@@ -6178,6 +6231,31 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	costs.indexStartupCost += descentCost;
 	costs.indexTotalCost += costs.num_sa_scans * descentCost;
 
+	/*
+	 * A skip scan descends the tree twice per distinct leading value: once
+	 * to find the value and once to start scanning for it.  Charge the CPU
+	 * costs above for each of those descents, plus a random page fetch for
+	 * each leaf page visited beyond those genericcostestimate counted.
+	 */
+	if (skip_scan)
+	{
+		double		leafPages;
+		double		spc_random_page_cost;
+
+		if (index->tuples > 1)
+			descentCost += ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
+		costs.indexTotalCost += (2 * num_skip_prefixes - 1) * descentCost;
+
+		leafPages = Min(num_skip_prefixes, index->pages) - costs.numIndexPages;
+		if (leafPages > 0)
+		{
+			get_tablespace_page_costs(index->reltablespace,
+									  &spc_random_page_cost, NULL);
+			costs.indexTotalCost += leafPages * spc_random_page_cost;
+			costs.numIndexPages += leafPages;
+		}
+	}
+
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
 	 * from pg_statistic, estimate the index correlation as C for a
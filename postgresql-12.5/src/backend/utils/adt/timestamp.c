@@ -35,6 +35,7 @@
 #include "utils/date.h"
 #include "utils/datetime.h"
 #include "utils/float.h"
+#include "utils/sortsupport.h"
 
 /*
  * gcc's -ffast-math switch breaks routines that expect exact results from
@@ -2101,22 +2102,13 @@ timestamp_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(timestamp_cmp_internal(dt1, dt2));
 }
 
-/* note: this is used for timestamptz also */
-static int
-timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
-{
-	Timestamp	a = DatumGetTimestamp(x);
-	Timestamp	b = DatumGetTimestamp(y);
-
-	return timestamp_cmp_internal(a, b);
-}
-
 Datum
 timestamp_sortsupport(PG_FUNCTION_ARGS)
 {
 	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
 
-	ssup->comparator = timestamp_fastcmp;
+	/* note: this is used for timestamptz also */
+	ssup->comparator = ssup_datum_int64_cmp;
 	PG_RETURN_VOID();
 }
 
@@ -2412,6 +2404,89 @@ interval_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(interval_cmp_internal(interval1, interval2));
 }
 
+/*
+ * SortSupport comparison func
+ */
+static int
+interval_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	Interval   *interval1 = DatumGetIntervalP(x);
+	Interval   *interval2 = DatumGetIntervalP(y);
+
+	return interval_cmp_internal(interval1, interval2);
+}
+
+#if SIZEOF_DATUM >= 8
+
+/*
+ * Abbreviated key comparison func.  Abbreviated keys are signed.
+ */
+static int
+interval_cmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	int64		a = (int64) x;
+	int64		b = (int64) y;
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
+/*
+ * The abbreviated key is exact for all but huge intervals, so it is never
+ * worth abandoning.
+ */
+static bool
+interval_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	return false;
+}
+
+/*
+ * Conversion routine for sortsupport.  The abbreviated key is the net span
+ * that interval_cmp_internal() compares, clamped to the range of int64.
+ * Spans outside of that range compare as equal to the nearest bound, and
+ * are left for the authoritative comparator to sort out.
+ */
+static Datum
+interval_abbrev_convert(Datum original, SortSupport ssup)
+{
+	INT128		span = interval_cmp_value(DatumGetIntervalP(original));
+
+	if (int128_compare(span, int64_to_int128(PG_INT64_MAX)) > 0)
+		return (Datum) PG_INT64_MAX;
+	if (int128_compare(span, int64_to_int128(PG_INT64_MIN)) < 0)
+		return (Datum) PG_INT64_MIN;
+
+	return (Datum) int128_to_int64(span);
+}
+
+#endif							/* SIZEOF_DATUM >= 8 */
+
+Datum
+interval_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = interval_fast_cmp;
+
+#if SIZEOF_DATUM >= 8
+	/* Abbreviated keys must be pass-by-value, so need 8-byte Datums */
+	if (ssup->abbreviate)
+	{
+		ssup->comparator = interval_cmp_abbrev;
+		ssup->abbrev_converter = interval_abbrev_convert;
+		ssup->abbrev_abort = interval_abbrev_abort;
+		ssup->abbrev_full_comparator = interval_fast_cmp;
+	}
+#endif
+
+	PG_RETURN_VOID();
+}
+
 /*
  * Hashing for intervals
  *
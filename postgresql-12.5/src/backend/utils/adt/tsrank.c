@@ -35,8 +35,22 @@ static const float weights[] = {0.1f, 0.2f, 0.4f, 1.0f};
 #define RANK_NORM_RDIVRPLUS1	0x20
 #define DEF_NORM_METHOD			RANK_NO_NORM
 
-static float calc_rank_or(const float *w, TSVector t, TSQuery q);
-static float calc_rank_and(const float *w, TSVector t, TSQuery q);
+/*
+ * The sorted, de-duplicated operands of a query, as returned by
+ * SortAndUniqItems.  ts_rank is normally applied to many rows with the same
+ * query, so these are cached across calls in fn_extra.  The operands point
+ * into our own copy of the query, which is used in place of the (identical)
+ * query argument.
+ */
+typedef struct
+{
+	TSQuery		query;			/* copy of the query */
+	QueryOperand **items;		/* its sorted unique operands */
+	int			nitems;			/* length of items[] */
+} RankQueryItems;
+
+static float calc_rank_or(const float *w, TSVector t, RankQueryItems *rq);
+static float calc_rank_and(const float *w, TSVector t, RankQueryItems *rq);
 
 /*
  * Returns a weight of a word collocation
@@ -197,8 +211,52 @@ SortAndUniqItems(TSQuery q, int *size)
 	return res;
 }
 
+/*
+ * Get the sorted unique operands of query q, from the cache in flinfo's
+ * fn_extra if it holds the same query, else computing and caching them.
+ * Without flinfo, they are computed into a fresh struct each time.
+ */
+static RankQueryItems *
+getRankQueryItems(FmgrInfo *flinfo, TSQuery q)
+{
+	RankQueryItems *rq;
+	MemoryContext oldcxt;
+
+	if (flinfo == NULL)
+	{
+		rq = (RankQueryItems *) palloc(sizeof(RankQueryItems));
+		rq->query = q;
+		rq->nitems = q->size;
+		rq->items = SortAndUniqItems(q, &rq->nitems);
+		return rq;
+	}
+
+	rq = (RankQueryItems *) flinfo->fn_extra;
+	if (rq != NULL &&
+		VARSIZE(rq->query) == VARSIZE(q) &&
+		memcmp(rq->query, q, VARSIZE(q)) == 0)
+		return rq;
+
+	oldcxt = MemoryContextSwitchTo(flinfo->fn_mcxt);
+	if (rq == NULL)
+		rq = (RankQueryItems *) palloc(sizeof(RankQueryItems));
+	else
+	{
+		pfree(rq->query);
+		pfree(rq->items);
+	}
+	rq->query = (TSQuery) palloc(VARSIZE(q));
+	memcpy(rq->query, q, VARSIZE(q));
+	rq->nitems = q->size;
+	rq->items = SortAndUniqItems(rq->query, &rq->nitems);
+	flinfo->fn_extra = rq;
+	MemoryContextSwitchTo(oldcxt);
+
+	return rq;
+}
+
 static float
-calc_rank_and(const float *w, TSVector t, TSQuery q)
+calc_rank_and(const float *w, TSVector t, RankQueryItems *rq)
 {
 	WordEntryPosVector **pos;
 	WordEntryPosVector1 posnull;
@@ -216,15 +274,12 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 				dist,
 				nitem;
 	float		res = -1.0;
-	QueryOperand **item;
-	int			size = q->size;
+	TSQuery		q = rq->query;
+	QueryOperand **item = rq->items;
+	int			size = rq->nitems;
 
-	item = SortAndUniqItems(q, &size);
 	if (size < 2)
-	{
-		pfree(item);
-		return calc_rank_or(w, t, q);
-	}
+		return calc_rank_or(w, t, rq);
 	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * q->size);
 
 	/* A dummy WordEntryPos array to use when haspos is false */
@@ -276,12 +331,11 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 		}
 	}
 	pfree(pos);
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank_or(const float *w, TSVector t, TSQuery q)
+calc_rank_or(const float *w, TSVector t, RankQueryItems *rq)
 {
 	WordEntry  *entry,
 			   *firstentry;
@@ -292,15 +346,14 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 				i,
 				nitem;
 	float		res = 0.0;
-	QueryOperand **item;
-	int			size = q->size;
+	TSQuery		q = rq->query;
+	QueryOperand **item = rq->items;
+	int			size = rq->nitems;
 
 	/* A dummy WordEntryPos array to use when haspos is false */
 	posnull.npos = 1;
 	posnull.pos[0] = 0;
 
-	item = SortAndUniqItems(q, &size);
-
 	for (i = 0; i < size; i++)
 	{
 		float		resj,
@@ -350,25 +403,34 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 	}
 	if (size > 0)
 		res = res / size;
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank(const float *w, TSVector t, TSQuery q, int32 method)
+calc_rank(const float *w, TSVector t, TSQuery q, int32 method,
+		  FmgrInfo *flinfo)
 {
 	QueryItem  *item = GETQUERY(q);
+	RankQueryItems *rq;
 	float		res = 0.0;
 	int			len;
 
 	if (!t->size || !q->size)
 		return 0.0;
 
+	rq = getRankQueryItems(flinfo, q);
+
 	/* XXX: What about NOT? */
 	res = (item->type == QI_OPR && (item->qoperator.oper == OP_AND ||
 									item->qoperator.oper == OP_PHRASE)) ?
-		calc_rank_and(w, t, q) :
-		calc_rank_or(w, t, q);
+		calc_rank_and(w, t, rq) :
+		calc_rank_or(w, t, rq);
+
+	if (flinfo == NULL)
+	{
+		pfree(rq->items);
+		pfree(rq);
+	}
 
 	if (res < 0)
 		res = 1e-20f;
@@ -444,7 +506,7 @@ ts_rank_wttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(3);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, method);
+	res = calc_rank(getWeights(win), txt, query, method, fcinfo->flinfo);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -460,7 +522,8 @@ ts_rank_wtt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(2);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(getWeights(win), txt, query, DEF_NORM_METHOD,
+					fcinfo->flinfo);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -476,7 +539,7 @@ ts_rank_ttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(2);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, method);
+	res = calc_rank(getWeights(NULL), txt, query, method, fcinfo->flinfo);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -490,7 +553,8 @@ ts_rank_tt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(1);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(getWeights(NULL), txt, query, DEF_NORM_METHOD,
+					fcinfo->flinfo);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -1098,6 +1098,62 @@ textpos(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32((int32) text_position(str, search_str, PG_GET_COLLATION()));
 }
 
+/*
+ * literal_search_init, literal_search -
+ *	Search for a byte string, with the skip table computed once
+ *
+ * Unlike text_position(), this is purely byte-wise: callers must make sure
+ * that a byte match is a character match in their encoding, as it is for
+ * single-byte encodings and UTF-8.  literal_search() returns a pointer to
+ * the first occurrence of the needle in the haystack, or NULL.
+ */
+void
+literal_search_init(LiteralSearch *ls, const char *needle, int len)
+{
+	int			i;
+
+	Assert(len > 0);
+
+	ls->needle = needle;
+	ls->len = len;
+
+	/* a byte not in the needle (before its last byte) skips a whole needle */
+	for (i = 0; i < 256; i++)
+		ls->skip[i] = len;
+	for (i = 0; i < len - 1; i++)
+		ls->skip[(unsigned char) needle[i]] = len - 1 - i;
+}
+
+const char *
+literal_search(const LiteralSearch *ls, const char *haystack, int haystack_len)
+{
+	const char *needle = ls->needle;
+	int			needle_len = ls->len;
+	const char *hptr;
+	const char *haystack_end;
+	char		lastchar;
+
+	if (haystack_len < needle_len)
+		return NULL;
+
+	/* memchr() is typically vectorized, and beats B-M-H on one byte */
+	if (needle_len == 1)
+		return memchr(haystack, needle[0], haystack_len);
+
+	lastchar = needle[needle_len - 1];
+	haystack_end = haystack + haystack_len;
+	hptr = haystack + needle_len - 1;
+	while (hptr < haystack_end)
+	{
+		if (*hptr == lastchar &&
+			memcmp(hptr - needle_len + 1, needle, needle_len - 1) == 0)
+			return hptr - needle_len + 1;
+		hptr += ls->skip[(unsigned char) *hptr];
+	}
+
+	return NULL;
+}
+
 /*
  * text_position -
  *	Does the real work for textpos()
@@ -5091,6 +5147,45 @@ pg_column_size(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Return the compression method of a datum, or NULL if it isn't compressed
+ *
+ * Works on any data type
+ */
+Datum
+pg_column_compression(PG_FUNCTION_ARGS)
+{
+	int			typlen;
+	int			cmethod;
+
+	/* On first call, get the input type's typlen, and save at *fn_extra */
+	if (fcinfo->flinfo->fn_extra == NULL)
+	{
+		/* Lookup the datatype of the supplied argument */
+		Oid			argtypeid = get_fn_expr_argtype(fcinfo->flinfo, 0);
+
+		typlen = get_typlen(argtypeid);
+		if (typlen == 0)		/* should not happen */
+			elog(ERROR, "cache lookup failed for type %u", argtypeid);
+
+		fcinfo->flinfo->fn_extra = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+													  sizeof(int));
+		*((int *) fcinfo->flinfo->fn_extra) = typlen;
+	}
+	else
+		typlen = *((int *) fcinfo->flinfo->fn_extra);
+
+	/* only varlena types can be compressed */
+	if (typlen != -1)
+		PG_RETURN_NULL();
+
+	cmethod = toast_datum_compression(PG_GETARG_DATUM(0));
+	if (cmethod < 0 || toast_compression_method_name(cmethod) == NULL)
+		PG_RETURN_NULL();
+
+	PG_RETURN_TEXT_P(cstring_to_text(toast_compression_method_name(cmethod)));
+}
+
 /*
  * string_agg - Concatenates values and returns string.
  *
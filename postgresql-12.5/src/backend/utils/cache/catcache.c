@@ -37,6 +37,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 
 
@@ -63,6 +64,9 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC variable: memory budget for all catcache entries, in kB; 0 = none */
+int			catalog_cache_memory_limit = 0;
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
@@ -79,6 +83,8 @@ static uint32 CatalogCacheComputeHashValue(CatCache *cache, int nkeys,
 										   Datum v1, Datum v2, Datum v3, Datum v4);
 static uint32 CatalogCacheComputeTupleHashValue(CatCache *cache, int nkeys,
 												HeapTuple tuple);
+static bool CatalogCacheTupleMatches(CatCache *cache, int nkeys,
+									 HeapTuple tuple, const Datum *searchkeys);
 static inline bool CatalogCacheCompareTuple(const CatCache *cache, int nkeys,
 											const Datum *cachekeys,
 											const Datum *searchkeys);
@@ -88,6 +94,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEnforceMemoryLimit(void);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 										Datum *arguments,
@@ -96,6 +103,8 @@ static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 
 static void CatCacheFreeKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 							 Datum *keys);
+static Size CatCacheKeysSpace(TupleDesc tupdesc, int nkeys, int *attnos,
+							  Datum *keys);
 static void CatCacheCopyKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 							 Datum *srckeys, Datum *dstkeys);
 
@@ -386,6 +395,30 @@ CatalogCacheCompareTuple(const CatCache *cache, int nkeys,
 	return true;
 }
 
+/*
+ *		CatalogCacheTupleMatches
+ *
+ * Compare the key columns of a tuple to the passed arguments.
+ */
+static bool
+CatalogCacheTupleMatches(CatCache *cache, int nkeys, HeapTuple tuple,
+						 const Datum *searchkeys)
+{
+	Datum		tuplekeys[CATCACHE_MAXKEYS];
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		bool		isnull;
+
+		tuplekeys[i] = heap_getattr(tuple, cache->cc_keyno[i],
+									cache->cc_tupdesc, &isnull);
+		if (isnull)
+			return false;
+	}
+	return CatalogCacheCompareTuple(cache, nkeys, tuplekeys, searchkeys);
+}
+
 
 #ifdef CATCACHE_STATS
 
@@ -456,6 +489,8 @@ CatCachePrintStats(int code, Datum arg)
 static void
 CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 {
+	Size		space;
+
 	Assert(ct->refcount == 0);
 	Assert(ct->my_cache == cache);
 
@@ -471,21 +506,30 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
+
+	space = GetMemoryChunkSpace(ct);
 
 	/*
 	 * Free keys when we're dealing with a negative entry, normal entries just
 	 * point into tuple, allocated together with the CatCTup.
 	 */
 	if (ct->negative)
+	{
+		space += CatCacheKeysSpace(cache->cc_tupdesc, cache->cc_nkeys,
+								   cache->cc_keyno, ct->keys);
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
+	}
 
 	pfree(ct);
 
 	--cache->cc_ntup;
 	--CacheHdr->ch_ntup;
+	cache->cc_memory -= space;
+	CacheHdr->ch_memory -= space;
 }
 
 /*
@@ -498,6 +542,7 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 static void
 CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 {
+	Size		space;
 	int			i;
 
 	Assert(cl->refcount == 0);
@@ -519,14 +564,104 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 			CatCacheRemoveCTup(cache, ct);
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&cl->cache_elem);
+	dlist_delete(&cl->lru_elem);
+
+	space = GetMemoryChunkSpace(cl) +
+		CatCacheKeysSpace(cache->cc_tupdesc, cl->nkeys,
+						  cache->cc_keyno, cl->keys);
 
 	/* free associated column data */
 	CatCacheFreeKeys(cache->cc_tupdesc, cl->nkeys,
 					 cache->cc_keyno, cl->keys);
 
 	pfree(cl);
+
+	cache->cc_memory -= space;
+	CacheHdr->ch_memory -= space;
+}
+
+/*
+ *		CatCacheEnforceMemoryLimit
+ *
+ * If the entries of all caches together use more than
+ * catalog_cache_memory_limit, remove least recently used ones until we are
+ * 10% below it, so that we don't have to come back on every new entry.
+ * Entries that are referenced, or belong to a referenced list, have to stay.
+ * Members of a list can't be removed without the list, so lists that are
+ * not referenced are removed in LRU order if entries alone don't suffice.
+ */
+static void
+CatCacheEnforceMemoryLimit(void)
+{
+	Size		limit;
+	Size		target;
+	int			pass;
+
+	if (catalog_cache_memory_limit <= 0)
+		return;
+
+	limit = (Size) catalog_cache_memory_limit * 1024;
+	if (CacheHdr->ch_memory <= limit)
+		return;
+	target = limit - limit / 10;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		dlist_node *cur;
+		dlist_node *prev;
+
+		/* Remove unreferenced entries, oldest first */
+		if (!dlist_is_empty(&CacheHdr->ch_lru))
+		{
+			for (cur = dlist_tail_node(&CacheHdr->ch_lru); cur != NULL; cur = prev)
+			{
+				CatCTup    *ct = dlist_container(CatCTup, lru_elem, cur);
+
+				if (CacheHdr->ch_memory <= target)
+					return;
+
+				prev = dlist_has_prev(&CacheHdr->ch_lru, cur) ?
+					dlist_prev_node(&CacheHdr->ch_lru, cur) : NULL;
+
+				if (ct->refcount == 0 && ct->c_list == NULL)
+				{
+					ct->my_cache->cc_evictions++;
+					CatCacheRemoveCTup(ct->my_cache, ct);
+				}
+			}
+		}
+
+		if (pass > 0)
+			break;
+
+		/*
+		 * Still over budget, so remove unreferenced lists too; that makes
+		 * their members eligible in the second pass.  Removing a list only
+		 * frees members that are dead, which are not on the list LRU, so the
+		 * saved pointer to the previous list stays valid.
+		 */
+		if (!dlist_is_empty(&CacheHdr->ch_list_lru))
+		{
+			for (cur = dlist_tail_node(&CacheHdr->ch_list_lru); cur != NULL; cur = prev)
+			{
+				CatCList   *cl = dlist_container(CatCList, lru_elem, cur);
+
+				if (CacheHdr->ch_memory <= target)
+					return;
+
+				prev = dlist_has_prev(&CacheHdr->ch_list_lru, cur) ?
+					dlist_prev_node(&CacheHdr->ch_list_lru, cur) : NULL;
+
+				if (cl->refcount == 0)
+				{
+					cl->my_cache->cc_evictions++;
+					CatCacheRemoveCList(cl->my_cache, cl);
+				}
+			}
+		}
+	}
 }
 
 
@@ -595,9 +730,7 @@ CatCacheInvalidate(CatCache *cache, uint32 hashValue)
 			else
 				CatCacheRemoveCTup(cache, ct);
 			CACHE_elog(DEBUG2, "CatCacheInvalidate: invalidated");
-#ifdef CATCACHE_STATS
 			cache->cc_invals++;
-#endif
 			/* could be multiple matches, so keep looking! */
 		}
 	}
@@ -673,9 +806,7 @@ ResetCatalogCache(CatCache *cache)
 			}
 			else
 				CatCacheRemoveCTup(cache, ct);
-#ifdef CATCACHE_STATS
 			cache->cc_invals++;
-#endif
 		}
 	}
 }
@@ -802,6 +933,9 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		CacheHdr->ch_memory = 0;
+		dlist_init(&CacheHdr->ch_lru);
+		dlist_init(&CacheHdr->ch_list_lru);
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1220,9 +1354,7 @@ SearchCatCacheInternal(CatCache *cache,
 	if (unlikely(cache->cc_tupdesc == NULL))
 		CatalogCacheInitializeCache(cache);
 
-#ifdef CATCACHE_STATS
 	cache->cc_searches++;
-#endif
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1263,6 +1395,7 @@ SearchCatCacheInternal(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		dlist_move_head(&CacheHdr->ch_lru, &ct->lru_elem);
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1277,9 +1410,7 @@ SearchCatCacheInternal(CatCache *cache,
 			CACHE_elog(DEBUG2, "SearchCatCache(%s): found in bucket %d",
 					   cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_hits++;
-#endif
 
 			return &ct->tuple;
 		}
@@ -1288,9 +1419,7 @@ SearchCatCacheInternal(CatCache *cache,
 			CACHE_elog(DEBUG2, "SearchCatCache(%s): found neg entry in bucket %d",
 					   cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_neg_hits++;
-#endif
 
 			return NULL;
 		}
@@ -1322,6 +1451,9 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	bool		use_shared;
+	Oid			shared_dbid = InvalidOid;
+	uint32		shared_stamp = 0;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1329,6 +1461,52 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * Another backend may already have fetched this tuple into the shared
+	 * catalog cache.  If so, build our entry from its copy instead of
+	 * scanning the catalog.
+	 */
+	use_shared = SharedCatCacheActive();
+	if (use_shared)
+	{
+		if (!cache->cc_relisshared)
+		{
+			shared_dbid = MyDatabaseId;
+			if (!OidIsValid(shared_dbid))
+				use_shared = false;
+		}
+	}
+	if (use_shared)
+	{
+		ntp = SharedCatCacheLookup(cache->id, shared_dbid, hashValue,
+								   &shared_stamp);
+		if (ntp != NULL)
+		{
+			if (CatalogCacheTupleMatches(cache, nkeys, ntp, arguments))
+			{
+				ct = CatalogCacheCreateEntry(cache, ntp, arguments,
+											 hashValue, hashIndex,
+											 false);
+				pfree(ntp);
+				ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+				ct->refcount++;
+				ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+				return &ct->tuple;
+			}
+			/* a different tuple with the same hash value; just ignore it */
+			pfree(ntp);
+		}
+
+		/*
+		 * Make sure the catalog snapshot we are about to scan with is no
+		 * older than the stamp we just read.  An invalidation that bumped
+		 * the stamp before we read it was queued before the bump, so
+		 * absorbing pending messages discards a catalog snapshot that could
+		 * still show the superseded tuple.
+		 */
+		AcceptInvalidationMessages();
+	}
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1381,6 +1559,11 @@ SearchCatCacheMiss(CatCache *cache,
 
 	table_close(relation, AccessShareLock);
 
+	/* Share what we found, with any toasted fields already flattened */
+	if (ct != NULL && use_shared)
+		SharedCatCacheInsert(cache->id, shared_dbid, cache->cc_reloid,
+							 hashValue, shared_stamp, &ct->tuple);
+
 	/*
 	 * If tuple was not found, we need to build a negative cache entry
 	 * containing a fake tuple.  The fake tuple has the correct key columns,
@@ -1418,9 +1601,7 @@ SearchCatCacheMiss(CatCache *cache,
 	CACHE_elog(DEBUG2, "SearchCatCache(%s): put in bucket %d",
 			   cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 	cache->cc_newloads++;
-#endif
 
 	return &ct->tuple;
 }
@@ -1521,6 +1702,7 @@ SearchCatCacheList(CatCache *cache,
 	bool		ordered;
 	HeapTuple	ntp;
 	MemoryContext oldcxt;
+	Size		space;
 	int			i;
 
 	/*
@@ -1531,9 +1713,7 @@ SearchCatCacheList(CatCache *cache,
 
 	Assert(nkeys > 0 && nkeys < cache->cc_nkeys);
 
-#ifdef CATCACHE_STATS
 	cache->cc_lsearches++;
-#endif
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1581,6 +1761,7 @@ SearchCatCacheList(CatCache *cache,
 		 * individually.)
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
+		dlist_move_head(&CacheHdr->ch_list_lru, &cl->lru_elem);
 
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
@@ -1590,9 +1771,7 @@ SearchCatCacheList(CatCache *cache,
 		CACHE_elog(DEBUG2, "SearchCatCacheList(%s): found list",
 				   cache->cc_relname);
 
-#ifdef CATCACHE_STATS
 		cache->cc_lhits++;
-#endif
 
 		return cl;
 	}
@@ -1762,6 +1941,12 @@ SearchCatCacheList(CatCache *cache,
 	Assert(i == nmembers);
 
 	dlist_push_head(&cache->cc_lists, &cl->cache_elem);
+	dlist_push_head(&CacheHdr->ch_list_lru, &cl->lru_elem);
+
+	space = GetMemoryChunkSpace(cl) +
+		CatCacheKeysSpace(cache->cc_tupdesc, nkeys, cache->cc_keyno, cl->keys);
+	cache->cc_memory += space;
+	CacheHdr->ch_memory += space;
 
 	/* Finally, bump the list's refcount and return it */
 	cl->refcount++;
@@ -1809,6 +1994,10 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	CatCTup    *ct;
 	HeapTuple	dtp;
 	MemoryContext oldcxt;
+	Size		space;
+
+	/* Make room for the new entry, if we're over budget */
+	CatCacheEnforceMemoryLimit();
 
 	/* negative entries have no tuple associated */
 	if (ntp)
@@ -1890,9 +2079,17 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
+
+	space = GetMemoryChunkSpace(ct);
+	if (negative)
+		space += CatCacheKeysSpace(cache->cc_tupdesc, cache->cc_nkeys,
+								   cache->cc_keyno, ct->keys);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	cache->cc_memory += space;
+	CacheHdr->ch_memory += space;
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -1927,6 +2124,27 @@ CatCacheFreeKeys(TupleDesc tupdesc, int nkeys, int *attnos, Datum *keys)
 	}
 }
 
+/*
+ * Helper routine that computes the memory used by keys allocated by
+ * CatCacheCopyKeys.
+ */
+static Size
+CatCacheKeysSpace(TupleDesc tupdesc, int nkeys, int *attnos, Datum *keys)
+{
+	Size		space = 0;
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attnos[i] - 1);
+
+		if (!att->attbyval)
+			space += GetMemoryChunkSpace(DatumGetPointer(keys[i]));
+	}
+
+	return space;
+}
+
 /*
  * Helper routine that copies the keys in the srckeys array into the dstkeys
  * one, guaranteeing that the datums are fully allocated in the current memory
@@ -2063,6 +2281,63 @@ PrepareToInvalidateCacheTuple(Relation relation,
 }
 
 
+/*
+ * CatCacheGetStats
+ *
+ * Return a palloc'd array of per-cache statistics, one element for each
+ * catalog cache, and the number of elements.
+ */
+int
+CatCacheGetStats(CatCacheStats **stats)
+{
+	slist_iter	iter;
+	int			ncaches = 0;
+	int			n = 0;
+
+	if (CacheHdr == NULL)
+	{
+		*stats = NULL;
+		return 0;
+	}
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+		ncaches++;
+	*stats = (CatCacheStats *) palloc0(ncaches * sizeof(CatCacheStats));
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+		CatCacheStats *s = &(*stats)[n++];
+		dlist_iter	diter;
+		int			i;
+
+		s->cacheId = cache->id;
+		s->reloid = cache->cc_reloid;
+		s->indexoid = cache->cc_indexoid;
+		s->ntup = cache->cc_ntup;
+		s->memory = cache->cc_memory;
+		s->searches = cache->cc_searches + cache->cc_lsearches;
+		s->hits = cache->cc_hits + cache->cc_lhits;
+		s->neg_hits = cache->cc_neg_hits;
+		s->evictions = cache->cc_evictions;
+
+		for (i = 0; i < cache->cc_nbuckets; i++)
+		{
+			dlist_foreach(diter, &cache->cc_bucket[i])
+			{
+				CatCTup    *ct = dlist_container(CatCTup, cache_elem, diter.cur);
+
+				if (ct->negative)
+					s->nnegative++;
+			}
+		}
+		dlist_foreach(diter, &cache->cc_lists)
+			s->nlists++;
+	}
+
+	return n;
+}
+
 /*
  * Subroutines for warning about reference leaks.  These are exported so
  * that resowner.c can call them.
@@ -99,6 +99,7 @@
 #include <limits.h>
 
 #include "access/htup_details.h"
+#include "access/parallelredo.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/pg_constraint.h"
@@ -111,6 +112,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relmapper.h"
+#include "utils/sharedcatcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -166,8 +168,11 @@ typedef struct TransInvalidationInfo
 	/* head of previous-commands event list */
 	InvalidationListHeader PriorCmdInvalidMsgs;
 
-	/* init file must be invalidated? */
+	/* local (per-database) init file must be invalidated? */
 	bool		RelcacheInitFileInval;
+
+	/* shared init file must be invalidated? */
+	bool		RelcacheSharedInitFileInval;
 } TransInvalidationInfo;
 
 static TransInvalidationInfo *transInvalInfo = NULL;
@@ -340,8 +345,35 @@ AddCatcacheInvalidationMessage(InvalidationListHeader *hdr,
 							   int id, uint32 hashValue, Oid dbId)
 {
 	SharedInvalidationMessage msg;
+	InvalidationChunk *chunk = hdr->cclist;
 
 	Assert(id < CHAR_MAX);
+
+	/*
+	 * A single command often updates the same catalog row several times (for
+	 * instance the pg_class row of a table while its indexes, constraints and
+	 * triggers are being created), queuing identical messages.  Every copy
+	 * would be broadcast through the sinval queue, so skip this one if it
+	 * duplicates one of the last few messages queued.  We look back only a
+	 * short distance so that large commands don't go quadratic.
+	 */
+#define CATCACHE_INVAL_DEDUP_WINDOW 16
+	if (chunk != NULL)
+	{
+		int			i;
+
+		for (i = chunk->nitems - 1;
+			 i >= 0 && i >= chunk->nitems - CATCACHE_INVAL_DEDUP_WINDOW;
+			 i--)
+		{
+			SharedInvalidationMessage *m = &chunk->msgs[i];
+
+			if (m->id == id && m->cc.hashValue == hashValue &&
+				m->cc.dbId == dbId)
+				return;
+		}
+	}
+
 	msg.cc.id = (int8) id;
 	msg.cc.dbId = dbId;
 	msg.cc.hashValue = hashValue;
@@ -524,12 +556,24 @@ RegisterRelcacheInvalidation(Oid dbId, Oid relId)
 
 	/*
 	 * If the relation being invalidated is one of those cached in a relcache
-	 * init file, mark that we need to zap that file at commit. For simplicity
-	 * invalidations for a specific database always invalidate the shared file
-	 * as well.  Also zap when we are invalidating whole relcache.
+	 * init file, mark that we need to zap that file at commit.  Shared
+	 * catalogs live only in the shared file and everything else only in the
+	 * local one, so zap just the file that can contain the relation; a
+	 * backend starting up meanwhile then has to rebuild only that file.  Zap
+	 * both when we are invalidating whole relcache.
 	 */
-	if (relId == InvalidOid || RelationIdIsInInitFile(relId))
+	if (relId == InvalidOid)
+	{
 		transInvalInfo->RelcacheInitFileInval = true;
+		transInvalInfo->RelcacheSharedInitFileInval = true;
+	}
+	else if (RelationIdIsInInitFile(relId))
+	{
+		if (dbId == InvalidOid)
+			transInvalInfo->RelcacheSharedInitFileInval = true;
+		else
+			transInvalInfo->RelcacheInitFileInval = true;
+	}
 }
 
 /*
@@ -846,7 +890,8 @@ xactGetCommittedInvalidationMessages(SharedInvalidationMessage **msgs,
 	 * after we send the SI messages.  However, we need not do anything unless
 	 * we committed.
 	 */
-	*RelcacheInitFileInval = transInvalInfo->RelcacheInitFileInval;
+	*RelcacheInitFileInval = (transInvalInfo->RelcacheInitFileInval ||
+							  transInvalInfo->RelcacheSharedInitFileInval);
 
 	/*
 	 * Walk through TransInvalidationInfo to collect all the messages into a
@@ -906,7 +951,7 @@ ProcessCommittedInvalidationMessages(SharedInvalidationMessage *msgs,
 		if (OidIsValid(dbid))
 			DatabasePath = GetDatabasePath(dbid, tsid);
 
-		RelationCacheInitFilePreInvalidate();
+		RelationCacheInitFilePreInvalidate(true, true);
 
 		if (OidIsValid(dbid))
 		{
@@ -962,8 +1007,10 @@ AtEOXact_Inval(bool isCommit)
 		 * after we send the SI messages.  However, we need not do anything
 		 * unless we committed.
 		 */
-		if (transInvalInfo->RelcacheInitFileInval)
-			RelationCacheInitFilePreInvalidate();
+		if (transInvalInfo->RelcacheInitFileInval ||
+			transInvalInfo->RelcacheSharedInitFileInval)
+			RelationCacheInitFilePreInvalidate(transInvalInfo->RelcacheInitFileInval,
+											   transInvalInfo->RelcacheSharedInitFileInval);
 
 		AppendInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
 								   &transInvalInfo->CurrentCmdInvalidMsgs);
@@ -971,13 +1018,23 @@ AtEOXact_Inval(bool isCommit)
 		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
 										 SendSharedInvalidMessages);
 
-		if (transInvalInfo->RelcacheInitFileInval)
+		if (transInvalInfo->RelcacheInitFileInval ||
+			transInvalInfo->RelcacheSharedInitFileInval)
 			RelationCacheInitFilePostInvalidate();
 	}
 	else
 	{
 		ProcessInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
 									LocalExecuteInvalidationMessage);
+
+		/*
+		 * In-place catalog updates survive the abort, so drop whatever the
+		 * shared catalog cache may hold for the tuples we touched.
+		 */
+		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+										 SharedCatCacheInvalidateMessages);
+		ProcessInvalidationMessagesMulti(&transInvalInfo->CurrentCmdInvalidMsgs,
+										 SharedCatCacheInvalidateMessages);
 	}
 
 	/* Need not free anything explicitly */
@@ -986,6 +1043,18 @@ AtEOXact_Inval(bool isCommit)
 	numSharedInvalidMessagesArray = 0;
 }
 
+/*
+ * TransactionHasPendingInvalidations
+ *		Has the current transaction queued any invalidation messages?
+ *
+ * If so, it may have changed catalog rows that others can't see yet.
+ */
+bool
+TransactionHasPendingInvalidations(void)
+{
+	return transInvalInfo != NULL;
+}
+
 /*
  * AtEOSubXact_Inval
  *		Process queued-up invalidation messages at end of subtransaction.
@@ -1046,6 +1115,8 @@ AtEOSubXact_Inval(bool isCommit)
 		/* Pending relcache inval becomes parent's problem too */
 		if (myInfo->RelcacheInitFileInval)
 			myInfo->parent->RelcacheInitFileInval = true;
+		if (myInfo->RelcacheSharedInitFileInval)
+			myInfo->parent->RelcacheSharedInitFileInval = true;
 
 		/* Pop the transaction state stack */
 		transInvalInfo = myInfo->parent;
@@ -1058,6 +1129,12 @@ AtEOSubXact_Inval(bool isCommit)
 		ProcessInvalidationMessages(&myInfo->PriorCmdInvalidMsgs,
 									LocalExecuteInvalidationMessage);
 
+		/* As in AtEOXact_Inval, for the sake of in-place updates */
+		ProcessInvalidationMessagesMulti(&myInfo->PriorCmdInvalidMsgs,
+										 SharedCatCacheInvalidateMessages);
+		ProcessInvalidationMessagesMulti(&myInfo->CurrentCmdInvalidMsgs,
+										 SharedCatCacheInvalidateMessages);
+
 		/* Pop the transaction state stack */
 		transInvalInfo = myInfo->parent;
 
@@ -1378,6 +1455,9 @@ CacheInvalidateSmgr(RelFileNodeBackend rnode)
 	VALGRIND_MAKE_MEM_DEFINED(&msg, sizeof(msg));
 
 	SendSharedInvalidMessages(&msg, 1);
+
+	/* Parallel redo workers don't read the queue; tell them separately */
+	ParallelRedoNoteSmgrInvalidation();
 }
 
 /*
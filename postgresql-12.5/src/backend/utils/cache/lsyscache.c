@@ -41,7 +41,9 @@
 #include "utils/catcache.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
@@ -49,6 +51,43 @@
 /* Hook for plugins to get control in get_attavgwidth() */
 get_attavgwidth_hook_type get_attavgwidth_hook = NULL;
 
+/*
+ * Cache of deconstructed statistics slots, see begin_attstatsslot_cache().
+ *
+ * Entries are keyed by the identity of the pg_statistic tuple version they
+ * were extracted from, plus the get_attstatsslot() arguments, so an entry
+ * can never be confused with the statistics of a later ANALYZE.
+ */
+typedef struct AttStatsSlotCacheKey
+{
+	ItemPointerData tid;		/* TID of the pg_statistic tuple */
+	TransactionId xmin;			/* its xmin, in case the TID was reused */
+	int			reqkind;
+	Oid			reqop;
+	int			flags;
+} AttStatsSlotCacheKey;
+
+typedef struct AttStatsSlotCacheEntry
+{
+	AttStatsSlotCacheKey key;	/* hash key (must be first) */
+	bool		found;			/* did get_attstatsslot() return true? */
+	AttStatsSlot slot;			/* the slot, with data in the cache context */
+} AttStatsSlotCacheEntry;
+
+struct AttStatsSlotCache
+{
+	MemoryContext cxt;			/* holds everything belonging to the cache */
+	HTAB	   *hash;			/* AttStatsSlotCacheEntry entries */
+	AttStatsSlotCache *prev;	/* cache that was active before this one */
+	MemoryContextCallback cb;	/* deactivates the cache when cxt goes away */
+};
+
+static AttStatsSlotCache *active_attstatsslot_cache = NULL;
+
+static bool get_attstatsslot_internal(AttStatsSlot *sslot,
+									  HeapTuple statstuple,
+									  int reqkind, Oid reqop, int flags);
+
 
 /*				---------- AMOP CACHES ----------						 */
 
@@ -2934,6 +2973,8 @@ get_attavgwidth(Oid relid, AttrNumber attnum)
  * The data referred to by the fields of sslot is locally palloc'd and
  * is independent of the original pg_statistic tuple.  When the caller
  * is done with it, call free_attstatsslot to release the palloc'd data.
+ * While a statistics slot cache is active (see begin_attstatsslot_cache),
+ * the data belongs to the cache instead, and must not be modified.
  *
  * If it's desirable to call free_attstatsslot when get_attstatsslot might
  * not have been called, memset'ing sslot to zeroes will allow that.
@@ -2941,6 +2982,65 @@ get_attavgwidth(Oid relid, AttrNumber attnum)
 bool
 get_attstatsslot(AttStatsSlot *sslot, HeapTuple statstuple,
 				 int reqkind, Oid reqop, int flags)
+{
+	AttStatsSlotCache *cache = active_attstatsslot_cache;
+	AttStatsSlotCacheKey key;
+	AttStatsSlotCacheEntry *entry;
+	bool		found;
+
+	/*
+	 * Without an active cache, or for a tuple that didn't come from
+	 * pg_statistic (a hook may have made it up), just do the work.
+	 */
+	if (cache == NULL || !ItemPointerIsValid(&statstuple->t_self))
+		return get_attstatsslot_internal(sslot, statstuple,
+										 reqkind, reqop, flags);
+
+	memset(&key, 0, sizeof(key));
+	key.tid = statstuple->t_self;
+	key.xmin = HeapTupleHeaderGetRawXmin(statstuple->t_data);
+	key.reqkind = reqkind;
+	key.reqop = reqop;
+	key.flags = flags;
+
+	entry = (AttStatsSlotCacheEntry *) hash_search(cache->hash, &key,
+												   HASH_ENTER, &found);
+	if (!found)
+	{
+		MemoryContext oldcxt;
+
+		/* Make sure a failure below doesn't leave a half-filled entry */
+		entry->found = false;
+		memset(&entry->slot, 0, sizeof(AttStatsSlot));
+		oldcxt = MemoryContextSwitchTo(cache->cxt);
+		PG_TRY();
+		{
+			entry->found = get_attstatsslot_internal(&entry->slot, statstuple,
+													 reqkind, reqop, flags);
+		}
+		PG_CATCH();
+		{
+			MemoryContextSwitchTo(oldcxt);
+			hash_search(cache->hash, &key, HASH_REMOVE, NULL);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	/* The caller gets a read-only view of the cached data */
+	*sslot = entry->slot;
+	sslot->cached = true;
+	return entry->found;
+}
+
+/*
+ * get_attstatsslot_internal
+ *		Guts of get_attstatsslot, without caching
+ */
+static bool
+get_attstatsslot_internal(AttStatsSlot *sslot, HeapTuple statstuple,
+						  int reqkind, Oid reqop, int flags)
 {
 	Form_pg_statistic stats = (Form_pg_statistic) GETSTRUCT(statstuple);
 	int			i;
@@ -3071,6 +3171,9 @@ get_attstatsslot(AttStatsSlot *sslot, HeapTuple statstuple,
 void
 free_attstatsslot(AttStatsSlot *sslot)
 {
+	/* Data belonging to the statistics slot cache stays where it is */
+	if (sslot->cached)
+		return;
 	/* The values[] array was separately palloc'd by deconstruct_array */
 	if (sslot->values)
 		pfree(sslot->values);
@@ -3082,6 +3185,77 @@ free_attstatsslot(AttStatsSlot *sslot)
 		pfree(sslot->numbers_arr);
 }
 
+/*
+ * attstatsslot_cache_callback
+ *		Deactivate a statistics slot cache whose memory is going away
+ */
+static void
+attstatsslot_cache_callback(void *arg)
+{
+	AttStatsSlotCache *cache = (AttStatsSlotCache *) arg;
+
+	if (active_attstatsslot_cache == cache)
+		active_attstatsslot_cache = cache->prev;
+}
+
+/*
+ * begin_attstatsslot_cache
+ *		Start caching the results of get_attstatsslot
+ *
+ * The planner looks up the same statistics slots over and over while it
+ * estimates clauses for different paths, and deconstructing the arrays
+ * (and detoasting them, for wide datatypes) is expensive.  Between this
+ * call and the matching end_attstatsslot_cache, get_attstatsslot returns
+ * slots that point into a cache instead, and free_attstatsslot leaves them
+ * alone.
+ *
+ * The cache lives in a child of the current memory context, so if an error
+ * prevents the end_attstatsslot_cache call, it goes away, and stops being
+ * used, whenever that context is cleaned up.  Calls can be nested.
+ */
+AttStatsSlotCache *
+begin_attstatsslot_cache(void)
+{
+	MemoryContext cxt;
+	AttStatsSlotCache *cache;
+	HASHCTL		ctl;
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"statistics slot cache",
+								ALLOCSET_DEFAULT_SIZES);
+
+	cache = (AttStatsSlotCache *) MemoryContextAlloc(cxt,
+													 sizeof(AttStatsSlotCache));
+	cache->cxt = cxt;
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(AttStatsSlotCacheKey);
+	ctl.entrysize = sizeof(AttStatsSlotCacheEntry);
+	ctl.hcxt = cxt;
+	cache->hash = hash_create("statistics slot cache", 64, &ctl,
+							  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	cache->prev = active_attstatsslot_cache;
+	cache->cb.func = attstatsslot_cache_callback;
+	cache->cb.arg = cache;
+	MemoryContextRegisterResetCallback(cxt, &cache->cb);
+
+	active_attstatsslot_cache = cache;
+
+	return cache;
+}
+
+/*
+ * end_attstatsslot_cache
+ *		Stop using, and release, a cache set up by begin_attstatsslot_cache
+ */
+void
+end_attstatsslot_cache(AttStatsSlotCache *cache)
+{
+	/* This also deactivates it, through the reset callback */
+	MemoryContextDelete(cache->cxt);
+}
+
 /*				---------- PG_NAMESPACE CACHE ----------				 */
 
 /*
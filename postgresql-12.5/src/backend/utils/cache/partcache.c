@@ -37,8 +37,34 @@
 #include "utils/syscache.h"
 
 
+static void RelationBuildPartitionKey(Relation relation);
 static List *generate_partition_qual(Relation rel);
 
+/*
+ * RelationGetPartitionKey -- get partition key, if relation is partitioned
+ *
+ * The key is built on first use, so that opening a partitioned table for
+ * something that doesn't need it costs no catalog lookups.
+ *
+ * Note: partition keys are not allowed to change after the partitioned rel
+ * is created.  RelationClearRelation knows this and preserves rd_partkey
+ * across relcache rebuilds, as long as the relation is open.  Therefore,
+ * even though we hand back a direct pointer into the relcache entry, it's
+ * safe for callers to continue to use that pointer as long as they hold
+ * the relation open.
+ */
+PartitionKey
+RelationGetPartitionKey(Relation rel)
+{
+	if (rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
+		return NULL;
+
+	if (unlikely(rel->rd_partkey == NULL))
+		RelationBuildPartitionKey(rel);
+
+	return rel->rd_partkey;
+}
+
 /*
  * RelationBuildPartitionKey
  *		Build partition key data of relation, and attach to relcache
@@ -54,7 +80,7 @@ static List *generate_partition_qual(Relation rel);
  * that some of our callees allocate memory on their own which would be leaked
  * permanently.
  */
-void
+static void
 RelationBuildPartitionKey(Relation relation)
 {
 	Form_pg_partitioned_table form;
@@ -58,6 +58,7 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -71,6 +72,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -99,14 +101,19 @@ static dlist_head cached_expression_list = DLIST_STATIC_INIT(cached_expression_l
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
-								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
+								   ParamListInfo boundParams, QueryEnvironment *queryEnv,
+								   bool use_shared, uint64 shared_stamp);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static void AcquireExecutorLocks(List *stmt_list, bool acquire,
+								 List *skip_relids);
+static List *AcquireExecutorLocksPruned(CachedPlan *plan,
+										ParamListInfo boundParams);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -788,11 +795,14 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  *
  * On a "true" return, we have acquired the locks needed to run the plan.
  * (We must do this for the "true" result to be race-condition-free.)
+ * boundParams are used to skip locking partitions that the plan's initial
+ * pruning steps will remove.
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
+	List	   *skipped;
 
 	/* Assert that caller checked the querytree */
 	Assert(plansource->is_valid);
@@ -824,7 +834,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		skipped = AcquireExecutorLocksPruned(plan, boundParams);
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -846,7 +856,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		AcquireExecutorLocks(plan->stmt_list, false, skipped);
 	}
 
 	/*
@@ -872,10 +882,15 @@ CheckCachedPlan(CachedPlanSource *plansource)
  * Planning work is done in the caller's memory context.  The finished plan
  * is in a child memory context, which typically should get reparented
  * (unless this is a one-shot plan, in which case we don't copy the plan).
+ *
+ * If use_shared is true, a generic plan published in the shared plan cache
+ * is adopted instead of planning, if there is one; shared_stamp is the
+ * shared plan cache's invalidation stamp as of before revalidation.
  */
 static CachedPlan *
 BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
-				ParamListInfo boundParams, QueryEnvironment *queryEnv)
+				ParamListInfo boundParams, QueryEnvironment *queryEnv,
+				bool use_shared, uint64 shared_stamp)
 {
 	CachedPlan *plan;
 	List	   *plist;
@@ -928,9 +943,32 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	}
 
 	/*
-	 * Generate the plan.
+	 * Take the plan from the shared plan cache if we can.  The planner would
+	 * have locked any relations it added to the range tables, such as
+	 * inheritance children, so do that now, then make sure that nothing was
+	 * invalidated meanwhile.
 	 */
-	plist = pg_plan_queries(qlist, plansource->cursor_options, boundParams);
+	plist = NIL;
+	if (use_shared && boundParams == NULL)
+	{
+		plist = SharedPlanCacheLookup(plansource, shared_stamp);
+		if (plist != NIL)
+		{
+			AcquireExecutorLocks(plist, true, NIL);
+			if (!plansource->is_valid ||
+				SharedPlanCacheGetStamp() != shared_stamp)
+			{
+				AcquireExecutorLocks(plist, false, NIL);
+				plist = NIL;
+			}
+		}
+	}
+
+	/*
+	 * Otherwise, generate the plan.
+	 */
+	if (plist == NIL)
+		plist = pg_plan_queries(qlist, plansource->cursor_options, boundParams);
 
 	/* Release snapshot if we got one */
 	if (snapshot_set)
@@ -1141,6 +1179,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	CachedPlan *plan = NULL;
 	List	   *qlist;
 	bool		customplan;
+	bool		use_shared;
+	uint64		shared_stamp = 0;
 
 	/* Assert caller is doing things in a sane order */
 	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
@@ -1149,15 +1189,36 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	if (useResOwner && !plansource->is_saved)
 		elog(ERROR, "cannot apply ResourceOwner to non-saved cached plan");
 
+	/*
+	 * If the shared plan cache may be used, note its invalidation stamp, and
+	 * then catch up with invalidations even if revalidation takes no new
+	 * locks.  Anything we take from or give to the shared cache is then
+	 * known to match the catalog state our query tree is built from.
+	 */
+	use_shared = SharedPlanCacheUsable(plansource, queryEnv);
+	if (use_shared)
+	{
+		shared_stamp = SharedPlanCacheGetStamp();
+		AcceptInvalidationMessages();
+	}
+
 	/* Make sure the querytree list is valid and we have parse-time locks */
 	qlist = RevalidateCachedQuery(plansource, queryEnv);
 
+	/*
+	 * A plan source that has no history of its own yet can start from the
+	 * plan choice statistics gathered by other sessions.
+	 */
+	if (use_shared && boundParams != NULL &&
+		plansource->num_custom_plans == 0 && plansource->generic_cost < 0)
+		SharedPlanCacheGetStats(plansource, shared_stamp);
+
 	/* Decide whether to use a custom plan */
 	customplan = choose_custom_plan(plansource, boundParams);
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
@@ -1166,7 +1227,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 		else
 		{
 			/* Build a new generic plan */
-			plan = BuildCachedPlan(plansource, qlist, NULL, queryEnv);
+			plan = BuildCachedPlan(plansource, qlist, NULL, queryEnv,
+								   use_shared, shared_stamp);
 			/* Just make real sure plansource->gplan is clear */
 			ReleaseGenericPlan(plansource);
 			/* Link the new generic plan into the plansource */
@@ -1188,6 +1250,11 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 			/* Update generic_cost whenever we make a new generic plan */
 			plansource->generic_cost = cached_plan_cost(plan, false);
 
+			/* Offer it, and our statistics, to other sessions */
+			if (use_shared)
+				SharedPlanCacheInsert(plansource, shared_stamp,
+									  plan->stmt_list);
+
 			/*
 			 * If, based on the now-known value of generic_cost, we'd not have
 			 * chosen to use a generic plan, then forget it and make a custom
@@ -1211,7 +1278,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	if (customplan)
 	{
 		/* Build a custom plan */
-		plan = BuildCachedPlan(plansource, qlist, boundParams, queryEnv);
+		plan = BuildCachedPlan(plansource, qlist, boundParams, queryEnv,
+							   false, 0);
 		/* Accumulate total costs of custom plans, but 'ware overflow */
 		if (plansource->num_custom_plans < INT_MAX)
 		{
@@ -1277,6 +1345,152 @@ ReleaseCachedPlan(CachedPlan *plan, bool useResOwner)
 	}
 }
 
+/*
+ * CachedPlanAllowsSimpleValidityCheck: can we use CachedPlanIsSimplyValid?
+ *
+ * This function, together with CachedPlanIsSimplyValid, provides a fast path
+ * for revalidating "simple" generic plans.  The core requirement is that the
+ * plan must not require taking any locks, which means not touching any
+ * tables; that matches up well with PL/pgSQL's simple expressions.  Some
+ * other corner cases we'd rather not handle in the fast path are rejected
+ * too.  (Such a plan can still be invalidated, for example due to a change
+ * in a function that was inlined into it.)
+ *
+ * If the plan qualifies and "owner" is not NULL, record a refcount on the
+ * plan in that resowner before returning.  It is the caller's responsibility
+ * to hold a refcount on any plan that's in active use.
+ *
+ * This must only be applied to known-valid generic plans, such as one just
+ * returned by GetCachedPlan.  If it returns true, the caller may keep using
+ * the plan for as long as CachedPlanIsSimplyValid says so, which is much
+ * cheaper than the full revalidation done by GetCachedPlan.
+ */
+bool
+CachedPlanAllowsSimpleValidityCheck(CachedPlanSource *plansource,
+									CachedPlan *plan, ResourceOwner owner)
+{
+	ListCell   *lc;
+
+	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+	Assert(plan->is_valid);
+	Assert(plan == plansource->gplan);
+
+	/* We don't support oneshot plans here */
+	if (plansource->is_oneshot)
+		return false;
+	Assert(!plan->is_oneshot);
+
+	/* We need the search_path that the plan was made with */
+	if (plansource->search_path == NULL)
+		return false;
+
+	/*
+	 * If the plan depends on RLS considerations, or it's transient, reject.
+	 * These probably can't happen for table-free queries, but let's check.
+	 */
+	if (plansource->dependsOnRLS)
+		return false;
+	if (plan->dependsOnRole)
+		return false;
+	if (TransactionIdIsValid(plan->saved_xmin))
+		return false;
+
+	/* Reject if AcquirePlannerLocks would have anything to do */
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		if (query->commandType == CMD_UTILITY)
+			return false;
+		if (query->rtable || query->cteList || query->hasSubLinks)
+			return false;
+	}
+
+	/*
+	 * Reject if AcquireExecutorLocks would have anything to do.  We have to
+	 * look through the rtable, because it's likely to contain an RTE_RESULT
+	 * entry rather than being empty.
+	 */
+	foreach(lc, plan->stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+		ListCell   *lc2;
+
+		if (plannedstmt->commandType == CMD_UTILITY)
+			return false;
+
+		foreach(lc2, plannedstmt->rtable)
+		{
+			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
+
+			if (rte->rtekind == RTE_RELATION)
+				return false;
+		}
+	}
+
+	/* Okay, it's simple.  Bump refcount if requested. */
+	if (owner)
+	{
+		ResourceOwnerEnlargePlanCacheRefs(owner);
+		plan->refcount++;
+		ResourceOwnerRememberPlanCacheRef(owner, plan);
+	}
+
+	return true;
+}
+
+/*
+ * CachedPlanIsSimplyValid: quick check for plan still being valid
+ *
+ * This must not be used unless CachedPlanAllowsSimpleValidityCheck said it
+ * was OK for this plan.
+ *
+ * If the plan is valid and "owner" is not NULL, record a refcount on the
+ * plan in that resowner before returning.
+ *
+ * This is only safe as long as the plansource isn't being used for anything
+ * but the particular CachedPlan passed in; otherwise the generic plan could
+ * be rebuilt behind the caller's back, and the new one could happen to be
+ * allocated at the same address as the caller's stale pointer.
+ */
+bool
+CachedPlanIsSimplyValid(CachedPlanSource *plansource, CachedPlan *plan,
+						ResourceOwner owner)
+{
+	/*
+	 * The caller doesn't necessarily hold a refcount on the plan to start
+	 * with, so "plan" could be a dangling pointer.  Don't dereference it
+	 * until we've verified that it still matches the plansource's gplan.
+	 */
+	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+
+	/*
+	 * Has cache invalidation fired on this plan?  No locks are needed to
+	 * check that.  We check plansource->is_valid too, to force a rebuild if
+	 * that has become false.
+	 */
+	if (!plansource->is_valid || plan != plansource->gplan || !plan->is_valid)
+		return false;
+
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+
+	/* Is the search_path still the same as when we made it? */
+	Assert(plansource->search_path != NULL);
+	if (!OverrideSearchPathMatchesCurrent(plansource->search_path))
+		return false;
+
+	/* It's still good.  Bump refcount if requested. */
+	if (owner)
+	{
+		ResourceOwnerEnlargePlanCacheRefs(owner);
+		plan->refcount++;
+		ResourceOwnerRememberPlanCacheRef(owner, plan);
+	}
+
+	return true;
+}
+
 /*
  * CachedPlanSetParentContext: move a CachedPlanSource to a new memory context
  *
@@ -1555,17 +1769,29 @@ QueryListGetPrimaryStmt(List *stmts)
 /*
  * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
  * or release them if acquire is false.
+ *
+ * If skip_relids isn't NIL, it holds a Bitmapset for each statement of
+ * range table indexes whose relations are to be left alone.
  */
 static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+AcquireExecutorLocks(List *stmt_list, bool acquire, List *skip_relids)
 {
 	ListCell   *lc1;
+	ListCell   *lcs = list_head(skip_relids);
 
 	foreach(lc1, stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *skip = NULL;
+		Index		rti;
 		ListCell   *lc2;
 
+		if (lcs != NULL)
+		{
+			skip = (Bitmapset *) lfirst(lcs);
+			lcs = lnext(lcs);
+		}
+
 		if (plannedstmt->commandType == CMD_UTILITY)
 		{
 			/*
@@ -1582,11 +1808,12 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			continue;
 		}
 
+		rti = 1;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
-			if (rte->rtekind != RTE_RELATION)
+			if (rte->rtekind != RTE_RELATION || bms_is_member(rti++, skip))
 				continue;
 
 			/*
@@ -1603,6 +1830,70 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 	}
 }
 
+/*
+ * AcquireExecutorLocksPruned: acquire locks needed for execution of a generic
+ * plan, except on partitions that initial partition pruning will remove.
+ *
+ * The plan's other relations, including all partitioned tables, are locked
+ * first, so that we can then safely evaluate the initial pruning steps using
+ * boundParams.  Returns a list of the skipped range table indexes for each
+ * statement, to be passed to AcquireExecutorLocks when releasing the locks.
+ *
+ * Nothing is skipped if there are no bound parameters, or if an invalidation
+ * arrived while taking the first batch of locks; the plan is about to be
+ * thrown away in that case.
+ */
+static List *
+AcquireExecutorLocksPruned(CachedPlan *plan, ParamListInfo boundParams)
+{
+	List	   *prunable = NIL;
+	List	   *skipped = NIL;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	if (boundParams != NULL)
+	{
+		foreach(lc1, plan->stmt_list)
+		{
+			PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+
+			prunable = lappend(prunable, plannedstmt->prunableRelids);
+		}
+	}
+
+	AcquireExecutorLocks(plan->stmt_list, true, prunable);
+
+	if (prunable == NIL)
+		return NIL;
+
+	forboth(lc1, plan->stmt_list, lc2, prunable)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *pruned = NULL;
+		int			rti;
+
+		if (plannedstmt->commandType != CMD_UTILITY &&
+			!bms_is_empty((Bitmapset *) lfirst(lc2)) && plan->is_valid)
+			pruned = ExecGetInitiallyPrunedRelids(plannedstmt, boundParams);
+
+		/* Lock the prunable relations that survived pruning */
+		rti = -1;
+		while ((rti = bms_next_member(plannedstmt->prunableRelids, rti)) >= 0)
+		{
+			RangeTblEntry *rte;
+
+			if (bms_is_member(rti, pruned))
+				continue;
+			rte = rt_fetch(rti, plannedstmt->rtable);
+			LockRelationOid(rte->relid, rte->rellockmode);
+		}
+
+		skipped = lappend(skipped, pruned);
+	}
+
+	return skipped;
+}
+
 /*
  * AcquirePlannerLocks: acquire locks needed for planning of a querytree list;
  * or release them if acquire is false.
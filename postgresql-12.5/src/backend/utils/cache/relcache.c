@@ -56,6 +56,7 @@
 #include "catalog/pg_partitioned_table.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_publication.h"
+#include "catalog/pg_publication_rel.h"
 #include "catalog/pg_rewrite.h"
 #include "catalog/pg_shseclabel.h"
 #include "catalog/pg_statistic_ext.h"
@@ -67,6 +68,7 @@
 #include "catalog/storage.h"
 #include "commands/policy.h"
 #include "commands/trigger.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -130,10 +132,26 @@ typedef struct relidcacheent
 {
 	Oid			reloid;
 	Relation	reldesc;
+	dlist_node	lru_elem;		/* member of RelationCacheLRU */
 } RelIdCacheEnt;
 
 static HTAB *RelationIdCache;
 
+/*
+ * All hashtable entries, most recently looked up by RelationIdGetRelation
+ * first, so that relation_cache_max_entries can evict the least recently
+ * used ones.
+ */
+static dlist_head RelationCacheLRU = DLIST_STATIC_INIT(RelationCacheLRU);
+
+/* GUC variable: maximum number of relcache entries; 0 = no limit */
+int			relation_cache_max_entries = 0;
+
+/* Statistics for pg_stat_catalog_caches */
+static long relcacheHits = 0L;
+static long relcacheMisses = 0L;
+static long relcacheEvictions = 0L;
+
 /*
  * This flag is false until we have prepared the critical relcache entries
  * that are needed to do indexscans on the tables read by relcache building.
@@ -154,6 +172,16 @@ bool		criticalSharedRelcachesBuilt = false;
  */
 static long relcacheInvalsReceived = 0L;
 
+/*
+ * These flags record that load_relcache_init_file() found no init file at
+ * all (as opposed to an unusable one).  When a burst of backends starts
+ * right after an init file was removed, each of them would otherwise build
+ * and write its own copy; write_relcache_init_file() uses the flags to skip
+ * the write once some other backend has already put a fresh file in place.
+ */
+static bool sharedInitFileMissing = false;
+static bool localInitFileMissing = false;
+
 /*
  * eoxact_list[] stores the OIDs of relations that (might) need AtEOXact
  * cleanup work.  This list intentionally has limited size; if it overflows,
@@ -208,7 +236,10 @@ do { \
 				 RelationGetRelationName(_old_rel)); \
 	} \
 	else \
+	{ \
 		hentry->reldesc = (RELATION); \
+		dlist_push_head(&RelationCacheLRU, &hentry->lru_elem); \
+	} \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -232,6 +263,8 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+		dlist_delete(&hentry->lru_elem); \
 } while(0)
 
 
@@ -264,6 +297,7 @@ static void RelationReloadNailed(Relation relation);
 static void RelationFlushRelation(Relation relation);
 static void RememberToFreeTupleDescAtEOX(TupleDesc td);
 static void AtEOXact_cleanup(Relation relation, bool isCommit);
+static void RelationCacheEnforceLimit(void);
 static void AtEOSubXact_cleanup(Relation relation, bool isCommit,
 								SubTransactionId mySubid, SubTransactionId parentSubid);
 static bool load_relcache_init_file(bool shared);
@@ -1131,6 +1165,11 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 				relation->rd_islocaltemp = false;
 			}
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			/* every session has its own storage for these */
+			relation->rd_backend = BackendIdForTempRelations();
+			relation->rd_islocaltemp = true;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c",
 				 relation->rd_rel->relpersistence);
@@ -1143,7 +1182,9 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	RelationBuildTupleDesc(relation);
 
 	/*
-	 * Fetch rules and triggers that affect this relation
+	 * Fetch rules and triggers that affect this relation.  (The partition
+	 * key and descriptor, foreign keys and the partition constraint are
+	 * loaded only when asked for; see below.)
 	 */
 	if (relation->rd_rel->relhasrules)
 		RelationBuildRuleLock(relation);
@@ -1167,20 +1208,15 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	relation->rd_fkeylist = NIL;
 	relation->rd_fkeyvalid = false;
 
-	/* if a partitioned table, initialize key and partition descriptor info */
-	if (relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
-	{
-		RelationBuildPartitionKey(relation);
-		RelationBuildPartitionDesc(relation);
-	}
-	else
-	{
-		relation->rd_partkey = NULL;
-		relation->rd_partkeycxt = NULL;
-		relation->rd_partdesc = NULL;
-		relation->rd_pdcxt = NULL;
-	}
-	/* ... but partcheck is not loaded till asked for */
+	/*
+	 * partition key and descriptor are not loaded till asked for, by
+	 * RelationGetPartitionKey and RelationGetPartitionDesc
+	 */
+	relation->rd_partkey = NULL;
+	relation->rd_partkeycxt = NULL;
+	relation->rd_partdesc = NULL;
+	relation->rd_pdcxt = NULL;
+	/* ... nor is partcheck */
 	relation->rd_partcheck = NIL;
 	relation->rd_partcheckvalid = false;
 	relation->rd_partcheckcxt = NULL;
@@ -1990,6 +2026,7 @@ formrdesc(const char *relationName, Oid relationReltype,
 Relation
 RelationIdGetRelation(Oid relationId)
 {
+	RelIdCacheEnt *hentry;
 	Relation	rd;
 
 	/* Make sure we're in an xact, even if this ends up being a cache hit */
@@ -1998,10 +2035,16 @@ RelationIdGetRelation(Oid relationId)
 	/*
 	 * first try to find reldesc in the cache
 	 */
-	RelationIdCacheLookup(relationId, rd);
+	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
+										   (void *) &relationId,
+										   HASH_FIND, NULL);
 
-	if (RelationIsValid(rd))
+	if (hentry != NULL)
 	{
+		rd = hentry->reldesc;
+		dlist_move_head(&RelationCacheLRU, &hentry->lru_elem);
+		relcacheHits++;
+
 		RelationIncrementReferenceCount(rd);
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
@@ -2034,6 +2077,7 @@ RelationIdGetRelation(Oid relationId)
 	 * no reldesc in the cache, so have RelationBuildDesc() build one and add
 	 * it.
 	 */
+	relcacheMisses++;
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
 		RelationIncrementReferenceCount(rd);
@@ -2092,6 +2136,16 @@ RelationClose(Relation relation)
 	/* Note: no locking manipulations needed */
 	RelationDecrementReferenceCount(relation);
 
+	/*
+	 * If the relation is no longer open in this session, we can clean up any
+	 * stale partition descriptors it has.  This is unlikely, so check to see
+	 * if there are child contexts before expending a call to mcxt.c.
+	 */
+	if (RelationHasReferenceCountZero(relation) &&
+		relation->rd_pdcxt != NULL &&
+		relation->rd_pdcxt->firstchild != NULL)
+		MemoryContextDeleteChildren(relation->rd_pdcxt);
+
 #ifdef RELCACHE_FORCE_RELEASE
 	if (RelationHasReferenceCountZero(relation) &&
 		relation->rd_createSubid == InvalidSubTransactionId &&
@@ -2352,6 +2406,7 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 	bms_free(relation->rd_keyattr);
 	bms_free(relation->rd_pkattr);
 	bms_free(relation->rd_idattr);
+	bms_free(relation->rd_nowarmattr);
 	if (relation->rd_pubactions)
 		pfree(relation->rd_pubactions);
 	if (relation->rd_options)
@@ -2513,11 +2568,12 @@ RelationClearRelation(Relation relation, bool rebuild)
 		 * When rebuilding an open relcache entry, we must preserve ref count,
 		 * rd_createSubid/rd_newRelfilenodeSubid, and rd_toastoid state.  Also
 		 * attempt to preserve the pg_class entry (rd_rel), tupledesc,
-		 * rewrite-rule, partition key, and partition descriptor substructures
-		 * in place, because various places assume that these structures won't
-		 * move while they are working with an open relcache entry.  (Note:
-		 * the refcount mechanism for tupledescs might someday allow us to
-		 * remove this hack for the tupledesc.)
+		 * rewrite-rule and partition key substructures in place, because
+		 * various places assume that these structures won't move while they
+		 * are working with an open relcache entry.  (Note: the refcount
+		 * mechanism for tupledescs might someday allow us to remove this hack
+		 * for the tupledesc.)  The partition descriptor is rebuilt on next
+		 * use, but the old one is kept until the entry is no longer open.
 		 *
 		 * Note that this process does not touch CurrentResourceOwner; which
 		 * is good because whatever ref counts the entry may have do not
@@ -2529,7 +2585,6 @@ RelationClearRelation(Relation relation, bool rebuild)
 		bool		keep_rules;
 		bool		keep_policies;
 		bool		keep_partkey;
-		bool		keep_partdesc;
 
 		/* Build temporary entry, but don't link it into hashtable */
 		newrel = RelationBuildDesc(save_relid, false);
@@ -2562,9 +2617,6 @@ RelationClearRelation(Relation relation, bool rebuild)
 		keep_policies = equalRSDesc(relation->rd_rsdesc, newrel->rd_rsdesc);
 		/* partkey is immutable once set up, so we can always keep it */
 		keep_partkey = (relation->rd_partkey != NULL);
-		keep_partdesc = equalPartitionDescs(relation->rd_partkey,
-											relation->rd_partdesc,
-											newrel->rd_partdesc);
 
 		/*
 		 * Perform swapping of the relcache entry contents.  Within this
@@ -2619,34 +2671,38 @@ RelationClearRelation(Relation relation, bool rebuild)
 		SWAPFIELD(Oid, rd_toastoid);
 		/* pgstat_info must be preserved */
 		SWAPFIELD(struct PgStat_TableStatus *, pgstat_info);
-		/* preserve old partitioning info if no logical change */
+		/* preserve old partition key if we have one */
 		if (keep_partkey)
 		{
 			SWAPFIELD(PartitionKey, rd_partkey);
 			SWAPFIELD(MemoryContext, rd_partkeycxt);
 		}
-		if (keep_partdesc)
-		{
-			SWAPFIELD(PartitionDesc, rd_partdesc);
-			SWAPFIELD(MemoryContext, rd_pdcxt);
-		}
-		else if (rebuild && newrel->rd_pdcxt != NULL)
+		if (newrel->rd_pdcxt != NULL)
 		{
 			/*
 			 * We are rebuilding a partitioned relation with a non-zero
-			 * reference count, so keep the old partition descriptor around,
-			 * in case there's a PartitionDirectory with a pointer to it.
-			 * Attach it to the new rd_pdcxt so that it gets cleaned up
-			 * eventually.  In the case where the reference count is 0, this
-			 * code is not reached, which should be OK because in that case
-			 * there should be no PartitionDirectory with a pointer to the old
-			 * entry.
+			 * reference count, so we must keep the old partition descriptor
+			 * around, in case there's a PartitionDirectory with a pointer to
+			 * it.  This means we can't free the old rd_pdcxt yet.  The new
+			 * entry has no descriptor, since those are built on demand, so
+			 * just hand the old context over to it with rd_partdesc unset.
+			 * RelationBuildPartitionDesc will keep it as a child of the next
+			 * descriptor's context, and RelationClose will free it once the
+			 * reference count reaches zero.  In the case where the reference
+			 * count is 0, this code is not reached, which should be OK
+			 * because in that case there should be no PartitionDirectory with
+			 * a pointer to the old entry.
 			 *
 			 * Note that newrel and relation have already been swapped, so the
 			 * "old" partition descriptor is actually the one hanging off of
 			 * newrel.
 			 */
-			MemoryContextSetParent(newrel->rd_pdcxt, relation->rd_pdcxt);
+			relation->rd_partdesc = NULL;	/* ensure rd_partdesc is invalid */
+			if (relation->rd_pdcxt != NULL) /* probably never happens */
+				MemoryContextSetParent(newrel->rd_pdcxt, relation->rd_pdcxt);
+			else
+				relation->rd_pdcxt = newrel->rd_pdcxt;
+			/* drop newrel's pointers so we don't destroy it below */
 			newrel->rd_partdesc = NULL;
 			newrel->rd_pdcxt = NULL;
 		}
@@ -2989,6 +3045,72 @@ AtEOXact_RelationCache(bool isCommit)
 	eoxact_list_overflowed = false;
 	NextEOXactTupleDescNum = 0;
 	EOXactTupleDescArrayLen = 0;
+
+	/*
+	 * Entries that were in use during the transaction are unpinned now, so
+	 * this is a good time to trim the cache to relation_cache_max_entries.
+	 */
+	if (isCommit)
+		RelationCacheEnforceLimit();
+}
+
+/*
+ * RelationCacheEnforceLimit
+ *
+ * If the relcache has more than relation_cache_max_entries entries, remove
+ * least recently used ones until it is 10% below the limit.  Entries that
+ * are referenced, nailed, or carry state from the current transaction are
+ * kept.  Removing an entry is the same as what an invalidation does to an
+ * unreferenced one, so the entry is simply rebuilt on next use.
+ */
+static void
+RelationCacheEnforceLimit(void)
+{
+	long		target;
+	dlist_node *cur;
+	dlist_node *prev;
+
+	if (relation_cache_max_entries <= 0 ||
+		hash_get_num_entries(RelationIdCache) <= relation_cache_max_entries ||
+		dlist_is_empty(&RelationCacheLRU))
+		return;
+	target = relation_cache_max_entries - relation_cache_max_entries / 10;
+
+	for (cur = dlist_tail_node(&RelationCacheLRU); cur != NULL; cur = prev)
+	{
+		RelIdCacheEnt *idhentry = dlist_container(RelIdCacheEnt, lru_elem, cur);
+		Relation	relation = idhentry->reldesc;
+
+		if (hash_get_num_entries(RelationIdCache) <= target)
+			break;
+
+		prev = dlist_has_prev(&RelationCacheLRU, cur) ?
+			dlist_prev_node(&RelationCacheLRU, cur) : NULL;
+
+		if (RelationHasReferenceCountZero(relation) &&
+			!relation->rd_isnailed &&
+			relation->rd_createSubid == InvalidSubTransactionId &&
+			relation->rd_newRelfilenodeSubid == InvalidSubTransactionId)
+		{
+			relcacheEvictions++;
+			RelationClearRelation(relation, false);
+		}
+	}
+}
+
+/*
+ * RelationCacheGetStats
+ *
+ * Report the size of the relcache and its lookup statistics.
+ */
+void
+RelationCacheGetStats(long *entries, long *hits, long *misses,
+					  long *evictions)
+{
+	*entries = RelationIdCache ? hash_get_num_entries(RelationIdCache) : 0;
+	*hits = relcacheHits;
+	*misses = relcacheMisses;
+	*evictions = relcacheEvictions;
 }
 
 /*
@@ -3309,6 +3431,10 @@ RelationBuildLocalRelation(const char *relname,
 			rel->rd_backend = BackendIdForTempRelations();
 			rel->rd_islocaltemp = true;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			rel->rd_backend = BackendIdForTempRelations();
+			rel->rd_islocaltemp = true;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c", relpersistence);
 			break;
@@ -3423,6 +3549,17 @@ RelationSetNewRelfilenode(Relation relation, char persistence)
 	TransactionId freezeXid = InvalidTransactionId;
 	RelFileNode newrnode;
 
+	/*
+	 * A global temporary relation's relfilenode is shared by every session
+	 * using it, each of which has its own storage under that name.  We have
+	 * no way to make the other sessions switch over, so refuse.
+	 */
+	if (RELATION_IS_GLOBAL_TEMP(relation))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot rewrite global temporary relation \"%s\"",
+						RelationGetRelationName(relation))));
+
 	/* Allocate a new relfilenode */
 	newrelfilenode = GetNewRelFileNode(relation->rd_rel->reltablespace, NULL,
 									   persistence);
@@ -3906,27 +4043,6 @@ RelationCacheInitializePhase3(void)
 			restart = true;
 		}
 
-		/*
-		 * Reload the partition key and descriptor for a partitioned table.
-		 */
-		if (relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE &&
-			relation->rd_partkey == NULL)
-		{
-			RelationBuildPartitionKey(relation);
-			Assert(relation->rd_partkey != NULL);
-
-			restart = true;
-		}
-
-		if (relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE &&
-			relation->rd_partdesc == NULL)
-		{
-			RelationBuildPartitionDesc(relation);
-			Assert(relation->rd_partdesc != NULL);
-
-			restart = true;
-		}
-
 		if (relation->rd_tableam == NULL &&
 			(relation->rd_rel->relkind == RELKIND_RELATION ||
 			 relation->rd_rel->relkind == RELKIND_SEQUENCE ||
@@ -4806,6 +4922,7 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 	Bitmapset  *uindexattrs;	/* columns in unique indexes */
 	Bitmapset  *pkindexattrs;	/* columns in the primary index */
 	Bitmapset  *idindexattrs;	/* columns in the replica identity */
+	Bitmapset  *nowarmattrs;	/* columns in indexes that can't take WARM */
 	List	   *indexoidlist;
 	List	   *newindexoidlist;
 	Oid			relpkindex;
@@ -4826,6 +4943,8 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 				return bms_copy(relation->rd_pkattr);
 			case INDEX_ATTR_BITMAP_IDENTITY_KEY:
 				return bms_copy(relation->rd_idattr);
+			case INDEX_ATTR_BITMAP_NOWARM:
+				return bms_copy(relation->rd_nowarmattr);
 			default:
 				elog(ERROR, "unknown attrKind %u", attrKind);
 		}
@@ -4869,6 +4988,7 @@ restart:
 	uindexattrs = NULL;
 	pkindexattrs = NULL;
 	idindexattrs = NULL;
+	nowarmattrs = NULL;
 	foreach(l, indexoidlist)
 	{
 		Oid			indexOid = lfirst_oid(l);
@@ -4881,6 +5001,7 @@ restart:
 		bool		isKey;		/* candidate key */
 		bool		isPK;		/* primary key */
 		bool		isIDKey;	/* replica identity index */
+		bool		canWarm;	/* can take WARM updates */
 
 		indexDesc = index_open(indexOid, AccessShareLock);
 
@@ -4918,6 +5039,22 @@ restart:
 		/* Is this index the configured (or default) replica identity? */
 		isIDKey = (indexOid == relreplindex);
 
+		/*
+		 * Can a WARM update give this index an entry for a changed key while
+		 * leaving the old one in place?  Only if the AM lets index scans
+		 * recheck the key against the heap tuple, which we can only do for
+		 * plain columns stored as their own type, and only if nothing relies
+		 * on there being one entry per chain: no uniqueness or exclusion
+		 * checks, and no index build in progress.
+		 */
+		canWarm = indexDesc->rd_indam->amcanwarm &&
+			!indexDesc->rd_index->indisunique &&
+			!indexDesc->rd_index->indisexclusion &&
+			indexDesc->rd_index->indisvalid &&
+			indexDesc->rd_index->indisready &&
+			indexExpressions == NULL &&
+			indexPredicate == NULL;
+
 		/* Collect simple attribute references */
 		for (i = 0; i < indexDesc->rd_index->indnatts; i++)
 		{
@@ -4947,9 +5084,29 @@ restart:
 				if (isIDKey && i < indexDesc->rd_index->indnkeyatts)
 					idindexattrs = bms_add_member(idindexattrs,
 												  attrnum - FirstLowInvalidHeapAttributeNumber);
+
+				if (canWarm &&
+					(attrnum < 0 ||
+					 TupleDescAttr(RelationGetDescr(indexDesc), i)->atttypid !=
+					 TupleDescAttr(RelationGetDescr(relation), attrnum - 1)->atttypid))
+					canWarm = false;
 			}
 		}
 
+		if (!canWarm)
+		{
+			for (i = 0; i < indexDesc->rd_index->indnatts; i++)
+			{
+				int			attrnum = indexDesc->rd_index->indkey.values[i];
+
+				if (attrnum != 0)
+					nowarmattrs = bms_add_member(nowarmattrs,
+												 attrnum - FirstLowInvalidHeapAttributeNumber);
+			}
+			pull_varattnos(indexExpressions, 1, &nowarmattrs);
+			pull_varattnos(indexPredicate, 1, &nowarmattrs);
+		}
+
 		/* Collect all attributes used in expressions, too */
 		pull_varattnos(indexExpressions, 1, &indexattrs);
 
@@ -4982,6 +5139,7 @@ restart:
 		bms_free(uindexattrs);
 		bms_free(pkindexattrs);
 		bms_free(idindexattrs);
+		bms_free(nowarmattrs);
 		bms_free(indexattrs);
 
 		goto restart;
@@ -4996,6 +5154,8 @@ restart:
 	relation->rd_pkattr = NULL;
 	bms_free(relation->rd_idattr);
 	relation->rd_idattr = NULL;
+	bms_free(relation->rd_nowarmattr);
+	relation->rd_nowarmattr = NULL;
 
 	/*
 	 * Now save copies of the bitmaps in the relcache entry.  We intentionally
@@ -5008,6 +5168,7 @@ restart:
 	relation->rd_keyattr = bms_copy(uindexattrs);
 	relation->rd_pkattr = bms_copy(pkindexattrs);
 	relation->rd_idattr = bms_copy(idindexattrs);
+	relation->rd_nowarmattr = bms_copy(nowarmattrs);
 	relation->rd_indexattr = bms_copy(indexattrs);
 	MemoryContextSwitchTo(oldcxt);
 
@@ -5022,6 +5183,8 @@ restart:
 			return pkindexattrs;
 		case INDEX_ATTR_BITMAP_IDENTITY_KEY:
 			return idindexattrs;
+		case INDEX_ATTR_BITMAP_NOWARM:
+			return nowarmattrs;
 		default:
 			elog(ERROR, "unknown attrKind %u", attrKind);
 			return NULL;
@@ -5158,6 +5321,87 @@ RelationGetExclusionInfo(Relation indexRelation,
 	MemoryContextSwitchTo(oldcxt);
 }
 
+/*
+ * Check the row filter and column list of the given relation in the given
+ * publication against the relation's replica identity.
+ *
+ * UPDATEs and DELETEs are filtered on the old tuple, of which only the
+ * replica identity columns are logged (unless the identity is FULL), so the
+ * row filter can only reference those.  Likewise, the column list must
+ * include all replica identity columns, otherwise the subscriber can't
+ * find the row to change.
+ */
+static void
+check_publication_replident(Relation relation, Oid pubid,
+							bool *rf_valid, bool *cols_valid)
+{
+	HeapTuple	tup;
+	Datum		datum;
+	bool		isnull;
+	bool		identity_full;
+	Bitmapset  *idattrs = NULL;
+
+	*rf_valid = *cols_valid = true;
+
+	tup = SearchSysCache2(PUBLICATIONRELMAP,
+						  ObjectIdGetDatum(RelationGetRelid(relation)),
+						  ObjectIdGetDatum(pubid));
+	if (!HeapTupleIsValid(tup))
+		return;
+
+	identity_full = relation->rd_rel->relreplident == REPLICA_IDENTITY_FULL;
+	if (!identity_full)
+		idattrs = RelationGetIndexAttrBitmap(relation,
+											 INDEX_ATTR_BITMAP_IDENTITY_KEY);
+
+	datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+							Anum_pg_publication_rel_prqual, &isnull);
+	if (!isnull && !identity_full)
+	{
+		Node	   *rfnode = stringToNode(TextDatumGetCString(datum));
+		Bitmapset  *rfattrs = NULL;
+
+		/* Both bitmapsets are offset by FirstLowInvalidHeapAttributeNumber */
+		pull_varattnos(rfnode, 1, &rfattrs);
+		*rf_valid = bms_is_subset(rfattrs, idattrs);
+	}
+
+	datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+							Anum_pg_publication_rel_prattrs, &isnull);
+	if (!isnull)
+	{
+		Bitmapset  *columns = pub_collist_to_bitmapset(NULL, datum,
+													   CurrentMemoryContext);
+		TupleDesc	desc = RelationGetDescr(relation);
+		int			i;
+
+		if (identity_full)
+		{
+			for (i = 0; i < desc->natts; i++)
+			{
+				Form_pg_attribute att = TupleDescAttr(desc, i);
+
+				if (att->attisdropped || att->attgenerated)
+					continue;
+				if (!bms_is_member(att->attnum, columns))
+					*cols_valid = false;
+			}
+		}
+		else
+		{
+			i = -1;
+			while ((i = bms_next_member(idattrs, i)) >= 0)
+			{
+				if (!bms_is_member(i + FirstLowInvalidHeapAttributeNumber,
+								   columns))
+					*cols_valid = false;
+			}
+		}
+	}
+
+	ReleaseSysCache(tup);
+}
+
 /*
  * Get publication actions for the given relation.
  */
@@ -5169,6 +5413,9 @@ GetRelationPublicationActions(Relation relation)
 	MemoryContext oldcxt;
 	PublicationActions *pubactions = palloc0(sizeof(PublicationActions));
 
+	pubactions->rf_valid_for_update = pubactions->rf_valid_for_delete = true;
+	pubactions->cols_valid_for_update = pubactions->cols_valid_for_delete = true;
+
 	/*
 	 * If not publishable, it publishes no actions.  (pgoutput_change() will
 	 * ignore it.)
@@ -5202,15 +5449,33 @@ GetRelationPublicationActions(Relation relation)
 		pubactions->pubdelete |= pubform->pubdelete;
 		pubactions->pubtruncate |= pubform->pubtruncate;
 
-		ReleaseSysCache(tup);
-
 		/*
-		 * If we know everything is replicated, there is no point to check for
-		 * other publications.
+		 * Check that the row filter and column list of this publication can
+		 * be used with the replica identity of the relation, if it
+		 * publishes updates or deletes.  We can't stop at the first
+		 * publication as we need to look at all of them for this.
 		 */
-		if (pubactions->pubinsert && pubactions->pubupdate &&
-			pubactions->pubdelete && pubactions->pubtruncate)
-			break;
+		if (!pubform->puballtables &&
+			(pubform->pubupdate || pubform->pubdelete))
+		{
+			bool		rf_valid;
+			bool		cols_valid;
+
+			check_publication_replident(relation, pubid,
+										&rf_valid, &cols_valid);
+			if (pubform->pubupdate)
+			{
+				pubactions->rf_valid_for_update &= rf_valid;
+				pubactions->cols_valid_for_update &= cols_valid;
+			}
+			if (pubform->pubdelete)
+			{
+				pubactions->rf_valid_for_delete &= rf_valid;
+				pubactions->cols_valid_for_delete &= cols_valid;
+			}
+		}
+
+		ReleaseSysCache(tup);
 	}
 
 	if (relation->rd_pubactions)
@@ -5381,7 +5646,13 @@ load_relcache_init_file(bool shared)
 
 	fp = AllocateFile(initfilename, PG_BINARY_R);
 	if (fp == NULL)
+	{
+		if (shared)
+			sharedInitFileMissing = true;
+		else
+			localInitFileMissing = true;
 		return false;
+	}
 
 	/*
 	 * Read the index relcache entries from the file.  Note we will not enter
@@ -5661,6 +5932,7 @@ load_relcache_init_file(bool shared)
 		rel->rd_keyattr = NULL;
 		rel->rd_pkattr = NULL;
 		rel->rd_idattr = NULL;
+		rel->rd_nowarmattr = NULL;
 		rel->rd_pubactions = NULL;
 		rel->rd_statvalid = false;
 		rel->rd_statlist = NIL;
@@ -5763,6 +6035,7 @@ write_relcache_init_file(bool shared)
 	int			magic;
 	HASH_SEQ_STATUS status;
 	RelIdCacheEnt *idhentry;
+	bool		wasMissing;
 	int			i;
 
 	/*
@@ -5772,6 +6045,8 @@ write_relcache_init_file(bool shared)
 	if (relcacheInvalsReceived != 0L)
 		return;
 
+	wasMissing = shared ? sharedInitFileMissing : localInitFileMissing;
+
 	/*
 	 * We must write a temporary file and rename it into place. Otherwise,
 	 * another backend starting at about the same time might crash trying to
@@ -5792,6 +6067,14 @@ write_relcache_init_file(bool shared)
 				 DatabasePath, RELCACHE_INIT_FILENAME);
 	}
 
+	/*
+	 * If there was no init file when we started, but there is one now,
+	 * another backend has written it since; that's just as good as ours
+	 * (it can't be stale without us having seen an inval), so don't bother.
+	 */
+	if (wasMissing && access(finalfilename, F_OK) == 0)
+		return;
+
 	unlink(tempfilename);		/* in case it exists w/wrong permissions */
 
 	fp = AllocateFile(tempfilename, PG_BINARY_W);
@@ -5928,11 +6211,14 @@ write_relcache_init_file(bool shared)
 	 * If we have received any SI relcache invals since backend start, assume
 	 * we may have written out-of-date data.
 	 */
-	if (relcacheInvalsReceived == 0L)
+	if (relcacheInvalsReceived == 0L &&
+		!(wasMissing && access(finalfilename, F_OK) == 0))
 	{
 		/*
 		 * OK, rename the temp file to its final name, deleting any
-		 * previously-existing init file.
+		 * previously-existing init file.  (If the file didn't exist at
+		 * startup but does now, some other backend beat us to it, and
+		 * there's no point in replacing its file with an identical one.)
 		 *
 		 * Note: a failure here is possible under Cygwin, if some other
 		 * backend is holding open an unlinked-but-not-yet-gone init file. So
@@ -5944,7 +6230,7 @@ write_relcache_init_file(bool shared)
 	}
 	else
 	{
-		/* Delete the already-obsolete temp file */
+		/* Delete the already-obsolete or redundant temp file */
 		unlink(tempfilename);
 	}
 
@@ -6009,10 +6295,12 @@ RelationIdIsInInitFile(Oid relationId)
  *
  * We take the lock and do the unlink in RelationCacheInitFilePreInvalidate,
  * then release the lock in RelationCacheInitFilePostInvalidate.  Caller must
- * send any pending SI messages between those calls.
+ * send any pending SI messages between those calls.  "local" and "shared"
+ * say which of the two init files may be stale; only those are removed, so
+ * that the other one survives for the next backend to start.
  */
 void
-RelationCacheInitFilePreInvalidate(void)
+RelationCacheInitFilePreInvalidate(bool local, bool shared)
 {
 	char		localinitfname[MAXPGPATH];
 	char		sharedinitfname[MAXPGPATH];
@@ -6031,9 +6319,10 @@ RelationCacheInitFilePreInvalidate(void)
 	 * ERROR.  Fortunately, it's not too late to abort the transaction if we
 	 * can't get rid of the would-be-obsolete init file.
 	 */
-	if (DatabasePath)
+	if (local && DatabasePath)
 		unlink_initfile(localinitfname, ERROR);
-	unlink_initfile(sharedinitfname, ERROR);
+	if (shared)
+		unlink_initfile(sharedinitfname, ERROR);
 }
 
 void
@@ -0,0 +1,406 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Shared-memory second level for the system catalog caches
+ *
+ * Each backend keeps its own catcache, and in a database with a very large
+ * schema every new session pays for filling it with index scans on the
+ * catalogs.  When shared_catalog_cache_size is set, catcache misses first
+ * consult this cache, which holds copies of catalog tuples fetched by any
+ * backend.  Only positive entries for single-tuple lookups are shared;
+ * list searches and negative entries remain purely local.
+ *
+ * The cache is a fixed-size, set-associative array of fixed-size slots.
+ * A lookup key (syscache id, database, hash of the cache keys) selects a set
+ * of SHARED_CATCACHE_WAYS slots; a full set evicts its slots in round-robin
+ * order.  Tuples too large for a slot are not shared.  Since several keys
+ * can share a hash value, callers must check that a returned tuple really
+ * matches their search keys.
+ *
+ * Correctness depends on never serving a tuple that a committed catalog
+ * change has superseded.  Every catalog invalidation sent through the
+ * sinval queue also passes through SharedCatCacheInvalidateMessages(),
+ * after the change has become visible: it removes the matching slots and
+ * bumps the invalidation stamp of their partition.  A backend that misses
+ * in the shared cache remembers the stamp before reading the catalog, and
+ * only publishes what it read if the stamp is unchanged, so a tuple read
+ * with a snapshot predating a concurrent commit never gets in.  Backends
+ * with uncommitted catalog changes of their own, and those using historic
+ * snapshots for logical decoding, see a different catalog state than
+ * everyone else and so bypass the shared cache entirely.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "storage/itemptr.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hashutils.h"
+#include "utils/inval.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+
+#define SHARED_CATCACHE_SLOT_SIZE		512
+#define SHARED_CATCACHE_WAYS			8
+#define NUM_SHARED_CATCACHE_PARTITIONS	128
+
+typedef struct SharedCatCacheSlot
+{
+	int			cacheId;		/* syscache id, or -1 if slot is unused */
+	Oid			dbId;			/* database, or InvalidOid if shared catalog */
+	Oid			reloid;			/* catalog the tuple belongs to */
+	uint32		hashValue;		/* hash value of the tuple's cache keys */
+	ItemPointerData t_self;
+	uint16		t_len;
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} SharedCatCacheSlot;
+
+#define SHARED_CATCACHE_MAX_TUPLE \
+	(SHARED_CATCACHE_SLOT_SIZE - offsetof(SharedCatCacheSlot, data))
+
+typedef struct SharedCatCacheControl
+{
+	int			nsets;			/* number of sets of SHARED_CATCACHE_WAYS */
+
+	/* per-partition invalidation stamps, protected by the partition lock */
+	uint32		stamps[NUM_SHARED_CATCACHE_PARTITIONS];
+
+	/*
+	 * Followed by nsets round-robin eviction positions (uint8), and then,
+	 * MAXALIGN'd, nsets * SHARED_CATCACHE_WAYS slots.
+	 */
+} SharedCatCacheControl;
+
+/* GUC variable */
+int			shared_catalog_cache_size = 0;
+
+static SharedCatCacheControl *SharedCatCache = NULL;
+static LWLockPadded *SharedCatCacheLocks = NULL;
+static uint8 *SharedCatCacheVictims = NULL;
+static char *SharedCatCacheSlots = NULL;
+
+#define SharedCatCacheSlotNo(setno, way) \
+	((SharedCatCacheSlot *) (SharedCatCacheSlots + \
+		((Size) (setno) * SHARED_CATCACHE_WAYS + (way)) * SHARED_CATCACHE_SLOT_SIZE))
+#define SharedCatCachePartition(setno) \
+	((setno) % NUM_SHARED_CATCACHE_PARTITIONS)
+#define SharedCatCachePartitionLock(partition) \
+	(&SharedCatCacheLocks[partition].lock)
+
+
+/*
+ * Number of sets that fit into shared_catalog_cache_size.
+ */
+static int
+SharedCatCacheSets(void)
+{
+	Size		bytes = (Size) shared_catalog_cache_size * 1024;
+
+	return (int) Min(bytes / (SHARED_CATCACHE_SLOT_SIZE * SHARED_CATCACHE_WAYS),
+					 INT_MAX);
+}
+
+/*
+ * SharedCatCacheShmemSize -- estimate space for the shared catalog cache
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	int			nsets = SharedCatCacheSets();
+	Size		size;
+
+	if (nsets == 0)
+		return 0;
+
+	size = MAXALIGN(add_size(sizeof(SharedCatCacheControl), nsets));
+	size = add_size(size, mul_size(mul_size(nsets, SHARED_CATCACHE_WAYS),
+								   SHARED_CATCACHE_SLOT_SIZE));
+	size = add_size(size, mul_size(NUM_SHARED_CATCACHE_PARTITIONS,
+								   sizeof(LWLockPadded)));
+	return size;
+}
+
+/*
+ * SharedCatCacheShmemInit -- initialize the shared catalog cache
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	int			nsets = SharedCatCacheSets();
+	Size		ctlsize;
+	bool		found;
+	int			i;
+
+	if (nsets == 0)
+		return;
+
+	SharedCatCacheLocks = (LWLockPadded *)
+		ShmemInitStruct("Shared Catalog Cache Locks",
+						NUM_SHARED_CATCACHE_PARTITIONS * sizeof(LWLockPadded),
+						&found);
+	if (!found)
+	{
+		for (i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+			LWLockInitialize(&SharedCatCacheLocks[i].lock,
+							 LWTRANCHE_SHARED_CATCACHE);
+	}
+
+	ctlsize = MAXALIGN(sizeof(SharedCatCacheControl) + nsets);
+	SharedCatCache = (SharedCatCacheControl *)
+		ShmemInitStruct("Shared Catalog Cache",
+						ctlsize + (Size) nsets * SHARED_CATCACHE_WAYS *
+						SHARED_CATCACHE_SLOT_SIZE,
+						&found);
+	SharedCatCacheVictims = (uint8 *) SharedCatCache +
+		sizeof(SharedCatCacheControl);
+	SharedCatCacheSlots = (char *) SharedCatCache + ctlsize;
+
+	if (!found)
+	{
+		Size		nslots = (Size) nsets * SHARED_CATCACHE_WAYS;
+		Size		s;
+
+		SharedCatCache->nsets = nsets;
+		memset(SharedCatCache->stamps, 0, sizeof(SharedCatCache->stamps));
+		memset(SharedCatCacheVictims, 0, nsets);
+		for (s = 0; s < nslots; s++)
+			SharedCatCacheSlotNo(0, s)->cacheId = -1;
+	}
+}
+
+/*
+ * Map a lookup key to its set.
+ */
+static inline int
+SharedCatCacheSetNo(int cacheId, Oid dbId, uint32 hashValue)
+{
+	uint32		h;
+
+	h = hash_combine(murmurhash32((uint32) dbId), (uint32) cacheId);
+	h = hash_combine(h, hashValue);
+	return (int) (h % (uint32) SharedCatCache->nsets);
+}
+
+/*
+ * SharedCatCacheActive -- may this backend use the shared catalog cache now?
+ */
+bool
+SharedCatCacheActive(void)
+{
+	return SharedCatCache != NULL &&
+		!IsBootstrapProcessingMode() &&
+		!HistoricSnapshotActive() &&
+		!TransactionHasPendingInvalidations();
+}
+
+/*
+ * SharedCatCacheLookup -- look for a cached catalog tuple
+ *
+ * Returns a palloc'd copy of the tuple if found, else NULL.  In either case
+ * *stamp is set to the invalidation stamp to pass to SharedCatCacheInsert()
+ * if the caller goes on to read the catalog.
+ */
+HeapTuple
+SharedCatCacheLookup(int cacheId, Oid dbId, uint32 hashValue, uint32 *stamp)
+{
+	int			setno = SharedCatCacheSetNo(cacheId, dbId, hashValue);
+	int			partition = SharedCatCachePartition(setno);
+	LWLock	   *partitionLock = SharedCatCachePartitionLock(partition);
+	HeapTuple	tuple;
+	bool		found = false;
+	int			way;
+
+	/* allocate before taking the lock, so that we can't fail holding it */
+	tuple = (HeapTuple) palloc(HEAPTUPLESIZE + SHARED_CATCACHE_MAX_TUPLE);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	*stamp = SharedCatCache->stamps[partition];
+	for (way = 0; way < SHARED_CATCACHE_WAYS; way++)
+	{
+		SharedCatCacheSlot *slot = SharedCatCacheSlotNo(setno, way);
+
+		if (slot->cacheId == cacheId &&
+			slot->hashValue == hashValue &&
+			slot->dbId == dbId)
+		{
+			tuple->t_len = slot->t_len;
+			tuple->t_self = slot->t_self;
+			tuple->t_tableOid = slot->reloid;
+			tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+			memcpy(tuple->t_data, slot->data, slot->t_len);
+			found = true;
+			break;
+		}
+	}
+	LWLockRelease(partitionLock);
+
+	if (!found)
+	{
+		pfree(tuple);
+		return NULL;
+	}
+	return tuple;
+}
+
+/*
+ * SharedCatCacheInsert -- publish a catalog tuple read after a miss
+ *
+ * stamp is the value returned by the SharedCatCacheLookup() that missed.
+ * If any invalidation hit the partition since then, the tuple might have
+ * been read with a stale snapshot and is not published.
+ */
+void
+SharedCatCacheInsert(int cacheId, Oid dbId, Oid reloid, uint32 hashValue,
+					 uint32 stamp, HeapTuple tuple)
+{
+	int			setno;
+	int			partition;
+	LWLock	   *partitionLock;
+	SharedCatCacheSlot *victim = NULL;
+	int			way;
+
+	if (tuple->t_len > SHARED_CATCACHE_MAX_TUPLE)
+		return;
+
+	setno = SharedCatCacheSetNo(cacheId, dbId, hashValue);
+	partition = SharedCatCachePartition(setno);
+	partitionLock = SharedCatCachePartitionLock(partition);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	if (SharedCatCache->stamps[partition] != stamp)
+	{
+		LWLockRelease(partitionLock);
+		return;
+	}
+
+	/* Replace an entry for the same key, else use a free slot */
+	for (way = 0; way < SHARED_CATCACHE_WAYS; way++)
+	{
+		SharedCatCacheSlot *slot = SharedCatCacheSlotNo(setno, way);
+
+		if (slot->cacheId == cacheId &&
+			slot->hashValue == hashValue &&
+			slot->dbId == dbId)
+		{
+			victim = slot;
+			break;
+		}
+		if (slot->cacheId < 0 && victim == NULL)
+			victim = slot;
+	}
+
+	/* Else evict round-robin */
+	if (victim == NULL)
+	{
+		way = SharedCatCacheVictims[setno];
+		SharedCatCacheVictims[setno] = (way + 1) % SHARED_CATCACHE_WAYS;
+		victim = SharedCatCacheSlotNo(setno, way);
+	}
+
+	victim->cacheId = cacheId;
+	victim->dbId = dbId;
+	victim->reloid = reloid;
+	victim->hashValue = hashValue;
+	victim->t_self = tuple->t_self;
+	victim->t_len = tuple->t_len;
+	memcpy(victim->data, tuple->t_data, tuple->t_len);
+
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * Remove the entries for one catcache key.
+ */
+static void
+SharedCatCacheInvalidateTuple(int cacheId, Oid dbId, uint32 hashValue)
+{
+	int			setno = SharedCatCacheSetNo(cacheId, dbId, hashValue);
+	int			partition = SharedCatCachePartition(setno);
+	LWLock	   *partitionLock = SharedCatCachePartitionLock(partition);
+	int			way;
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	SharedCatCache->stamps[partition]++;
+	for (way = 0; way < SHARED_CATCACHE_WAYS; way++)
+	{
+		SharedCatCacheSlot *slot = SharedCatCacheSlotNo(setno, way);
+
+		if (slot->cacheId == cacheId &&
+			slot->hashValue == hashValue &&
+			slot->dbId == dbId)
+			slot->cacheId = -1;
+	}
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * Remove all entries taken from one catalog, for instance because VACUUM
+ * FULL moved its tuples.  This has to visit the whole cache, but it is rare.
+ */
+static void
+SharedCatCacheFlushCatalog(Oid dbId, Oid catId)
+{
+	int			partition;
+
+	for (partition = 0; partition < NUM_SHARED_CATCACHE_PARTITIONS; partition++)
+	{
+		LWLock	   *partitionLock = SharedCatCachePartitionLock(partition);
+		int			setno;
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		SharedCatCache->stamps[partition]++;
+		for (setno = partition; setno < SharedCatCache->nsets;
+			 setno += NUM_SHARED_CATCACHE_PARTITIONS)
+		{
+			int			way;
+
+			for (way = 0; way < SHARED_CATCACHE_WAYS; way++)
+			{
+				SharedCatCacheSlot *slot = SharedCatCacheSlotNo(setno, way);
+
+				if (slot->cacheId >= 0 &&
+					slot->reloid == catId &&
+					slot->dbId == dbId)
+					slot->cacheId = -1;
+			}
+		}
+		LWLockRelease(partitionLock);
+	}
+}
+
+/*
+ * SharedCatCacheInvalidateMessages -- apply invalidations to the shared cache
+ *
+ * Called with every batch of messages sent to other backends, after the
+ * changes they describe have become visible; and for the messages of an
+ * aborted transaction, whose in-place catalog updates survive the abort.
+ */
+void
+SharedCatCacheInvalidateMessages(const SharedInvalidationMessage *msgs, int n)
+{
+	int			i;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+			SharedCatCacheInvalidateTuple(msg->cc.id, msg->cc.dbId,
+										  msg->cc.hashValue);
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			SharedCatCacheFlushCatalog(msg->cat.dbId, msg->cat.catId);
+	}
+}
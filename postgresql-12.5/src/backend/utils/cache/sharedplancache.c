@@ -0,0 +1,738 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Cluster-wide cache of generic plans for saved plan sources
+ *
+ * Every backend keeps its own CachedPlanSources, so when many sessions
+ * prepare the same statements each of them parses, analyzes and plans them
+ * separately, and each has to run several custom plans before it learns
+ * whether the generic plan is worth using.  When shared_plan_cache_size is
+ * set, a backend that builds a generic plan for a saved plan source
+ * publishes it here, in serialized form, together with the plan source's
+ * custom-vs-generic cost statistics.  Other backends preparing the same
+ * statement adopt those statistics at their first execution, and adopt the
+ * plan itself instead of running the planner when they decide to go
+ * generic.
+ *
+ * Entries are keyed by database, current user, a hash of the query text,
+ * a hash of the search_path in effect and the cursor options.  Since
+ * identical text can still analyze differently in different sessions (for
+ * instance when one of them has a temporary table of the same name), each
+ * entry also records a 64-bit fingerprint of the analyzed and rewritten
+ * query tree, and a backend only uses an entry whose fingerprint matches
+ * its own query tree.  Parse analysis therefore still happens in every
+ * backend; what is shared is the planning work.  Adopted plans are read
+ * back into backend-local memory like any other cached plan.
+ *
+ * The serialized plans live in a DSA area created in place in the main
+ * shared memory segment and capped at its initial size, so it never grows
+ * into DSM segments.  An index in a shared hash table, protected by a single
+ * LWLock, leads to them; when either is full, entries are evicted in LRU
+ * order.
+ *
+ * Invalidation follows sharedcatcache.c.  Every batch of catalog
+ * invalidations sent through the sinval queue passes through
+ * SharedPlanCacheInvalidateMessages(), after the changes have become
+ * visible.  It bumps a global stamp and removes the entries that a backend's
+ * own plan cache would invalidate for the same messages: those depending on
+ * an invalidated relation, function or type, or all of them for changes
+ * in pg_namespace, pg_operator and friends.  A backend notes the stamp and
+ * then processes pending invalidations before it revalidates its query tree.
+ * It only publishes a plan if the stamp is still unchanged afterwards, and
+ * only adopts a plan published no later than the stamp it noted, so a plan
+ * and a query tree that reflect different catalog states are never paired.
+ * Sessions with uncommitted catalog changes bypass the shared cache.
+ *
+ * Plans that depend on row-level security, transient plans, plans using
+ * temporary relations and one-shot or unsaved plan sources are not shared.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "lib/ilist.h"
+#include "miscadmin.h"
+#include "nodes/parsenodes.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/hashutils.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+
+/* expected average size of a serialized plan, to size the hash table */
+#define SHARED_PLANCACHE_KB_PER_ENTRY	2
+#define SHARED_PLANCACHE_MIN_ENTRIES	64
+
+typedef struct SharedPlanKey
+{
+	Oid			dbId;
+	Oid			roleId;
+	uint32		queryHash;		/* hash of the query text */
+	uint32		searchPathHash; /* hash of the search_path in effect */
+	int			cursorOptions;
+} SharedPlanKey;
+
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key; must be first */
+	uint64		fingerprint;	/* hash of the analyzed query tree */
+	uint64		stamp;			/* invalidation stamp the plan was built at */
+	dsa_pointer data;			/* SharedPlanData in SharedPlanArea */
+	double		generic_cost;	/* cost statistics of the publishing */
+	double		total_custom_cost;	/* ... plan source, see plancache.h */
+	int			num_custom_plans;
+	dlist_node	lru_node;		/* LRU list link, most recent first */
+} SharedPlanEntry;
+
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} SharedPlanInvalItem;
+
+/*
+ * The data of an entry: its dependencies, followed by the nodeToString()
+ * form of the plan's PlannedStmt list.
+ */
+typedef struct SharedPlanData
+{
+	int			nrelations;
+	int			ninvalitems;
+	Size		textlen;		/* not including the terminating zero */
+	Oid			relations[FLEXIBLE_ARRAY_MEMBER];
+	/* then ninvalitems SharedPlanInvalItems and the plan text */
+} SharedPlanData;
+
+#define SharedPlanDataInvalItems(d) \
+	((SharedPlanInvalItem *) &(d)->relations[(d)->nrelations])
+#define SharedPlanDataText(d) \
+	((char *) &SharedPlanDataInvalItems(d)[(d)->ninvalitems])
+
+typedef struct SharedPlanCacheControl
+{
+	LWLock		lock;			/* protects the hash table and LRU list */
+	pg_atomic_uint64 stamp;		/* bumped by every batch of invalidations */
+	dlist_head	lru;			/* all entries, most recently used first */
+	Size		area_size;		/* size of the DSA area that follows */
+} SharedPlanCacheControl;
+
+/* GUC variable */
+int			shared_plan_cache_size = 0;
+
+static SharedPlanCacheControl *SharedPlanCache = NULL;
+static HTAB *SharedPlanHash = NULL;
+static dsa_area *SharedPlanArea = NULL;
+
+
+static Size
+SharedPlanCacheAreaSize(void)
+{
+	return Max((Size) shared_plan_cache_size * 1024, dsa_minimum_size());
+}
+
+static long
+SharedPlanCacheMaxEntries(void)
+{
+	return Max(shared_plan_cache_size / SHARED_PLANCACHE_KB_PER_ENTRY,
+			   SHARED_PLANCACHE_MIN_ENTRIES);
+}
+
+/*
+ * SharedPlanCacheShmemSize -- estimate space for the shared plan cache
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	size = CACHELINEALIGN(sizeof(SharedPlanCacheControl));
+	size = add_size(size, SharedPlanCacheAreaSize());
+	size = add_size(size, hash_estimate_size(SharedPlanCacheMaxEntries(),
+											 sizeof(SharedPlanEntry)));
+	return size;
+}
+
+/*
+ * SharedPlanCacheShmemInit -- initialize the shared plan cache
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	Size		area_size = SharedPlanCacheAreaSize();
+	long		max_entries = SharedPlanCacheMaxEntries();
+	HASHCTL		info;
+	char	   *place;
+	MemoryContext oldcxt;
+	bool		found;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	SharedPlanCache = (SharedPlanCacheControl *)
+		ShmemInitStruct("Shared Plan Cache",
+						CACHELINEALIGN(sizeof(SharedPlanCacheControl)) +
+						area_size,
+						&found);
+	place = (char *) SharedPlanCache +
+		CACHELINEALIGN(sizeof(SharedPlanCacheControl));
+
+	/* the backend-local dsa_area must outlive the postmaster's contexts */
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	if (!found)
+	{
+		LWLockInitialize(&SharedPlanCache->lock, LWTRANCHE_SHARED_PLANCACHE);
+		pg_atomic_init_u64(&SharedPlanCache->stamp, 0);
+		dlist_init(&SharedPlanCache->lru);
+		SharedPlanCache->area_size = area_size;
+
+		SharedPlanArea = dsa_create_in_place(place, area_size,
+											 LWTRANCHE_SHARED_PLANCACHE_DSA,
+											 NULL);
+		/* never create DSM segments beyond the in-place one */
+		dsa_set_size_limit(SharedPlanArea, area_size);
+	}
+	else
+		SharedPlanArea = dsa_attach_in_place(place, NULL);
+	MemoryContextSwitchTo(oldcxt);
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SharedPlanKey);
+	info.entrysize = sizeof(SharedPlanEntry);
+	SharedPlanHash = ShmemInitHash("Shared Plan Cache Hash",
+								   max_entries, max_entries,
+								   &info,
+								   HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * SharedPlanCacheUsable -- may this plan source use the shared plan cache?
+ *
+ * This only checks what cannot change while GetCachedPlan() runs; the rest
+ * is checked by SharedPlanSourceShareable() once the query is revalidated.
+ */
+bool
+SharedPlanCacheUsable(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	return SharedPlanCache != NULL &&
+		plansource->is_saved &&
+		!plansource->is_oneshot &&
+		plansource->raw_parse_tree != NULL &&
+		queryEnv == NULL &&
+		!IsBootstrapProcessingMode() &&
+		!TransactionHasPendingInvalidations();
+}
+
+/*
+ * SharedPlanCacheGetStamp -- current invalidation stamp
+ *
+ * Callers must process pending invalidation messages after reading the
+ * stamp and before revalidating their query tree.
+ */
+uint64
+SharedPlanCacheGetStamp(void)
+{
+	return pg_atomic_read_u64(&SharedPlanCache->stamp);
+}
+
+/*
+ * Is the revalidated query tree of plansource one whose plans we share?
+ */
+static bool
+SharedPlanSourceShareable(CachedPlanSource *plansource)
+{
+	ListCell   *lc;
+
+	if (!plansource->is_valid || plansource->dependsOnRLS)
+		return false;
+
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		if (query->commandType == CMD_UTILITY)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Compute the hash key and query tree fingerprint for plansource.
+ */
+static void
+SharedPlanMakeKey(CachedPlanSource *plansource, SharedPlanKey *key,
+				  uint64 *fingerprint)
+{
+	OverrideSearchPath *path = plansource->search_path;
+	char	   *str;
+
+	MemSet(key, 0, sizeof(SharedPlanKey));
+	key->dbId = MyDatabaseId;
+	key->roleId = GetUserId();
+	key->queryHash = DatumGetUInt32(hash_any((const unsigned char *) plansource->query_string,
+											 strlen(plansource->query_string)));
+	if (path != NULL)
+	{
+		uint32		h = murmurhash32((uint32) path->addCatalog << 1 |
+									 (uint32) path->addTemp);
+		ListCell   *lc;
+
+		foreach(lc, path->schemas)
+			h = hash_combine(h, murmurhash32((uint32) lfirst_oid(lc)));
+		key->searchPathHash = h;
+	}
+	key->cursorOptions = plansource->cursor_options;
+
+	str = nodeToString(plansource->query_list);
+	*fingerprint = DatumGetUInt64(hash_any_extended((const unsigned char *) str,
+													strlen(str), 0));
+	pfree(str);
+}
+
+/*
+ * Does a plan depend on a temporary relation, which only its own backend
+ * can use?  Relations that are gone count as temporary, too.
+ */
+static bool
+SharedPlanUsesTempRelation(List *relationOids)
+{
+	ListCell   *lc;
+
+	foreach(lc, relationOids)
+	{
+		HeapTuple	tp;
+		bool		istemp;
+
+		tp = SearchSysCache1(RELOID, ObjectIdGetDatum(lfirst_oid(lc)));
+		if (!HeapTupleIsValid(tp))
+			return true;
+		istemp = ((Form_pg_class) GETSTRUCT(tp))->relpersistence ==
+			RELPERSISTENCE_TEMP;
+		ReleaseSysCache(tp);
+		if (istemp)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Remove an entry and free its data.  Caller holds the lock exclusively.
+ */
+static void
+SharedPlanEvict(SharedPlanEntry *entry)
+{
+	dlist_delete(&entry->lru_node);
+	dsa_free(SharedPlanArea, entry->data);
+	hash_search(SharedPlanHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * Evict the least recently used entry, if any.  Caller holds the lock
+ * exclusively.
+ */
+static bool
+SharedPlanEvictOldest(void)
+{
+	if (dlist_is_empty(&SharedPlanCache->lru))
+		return false;
+	SharedPlanEvict(dlist_tail_element(SharedPlanEntry, lru_node,
+									   &SharedPlanCache->lru));
+	return true;
+}
+
+/*
+ * Find the entry matching plansource that a backend which read stamp before
+ * revalidating may use.  Caller holds the lock.
+ */
+static SharedPlanEntry *
+SharedPlanFind(SharedPlanKey *key, uint64 fingerprint, uint64 stamp)
+{
+	SharedPlanEntry *entry;
+
+	entry = (SharedPlanEntry *) hash_search(SharedPlanHash, key,
+											HASH_FIND, NULL);
+	if (entry == NULL ||
+		entry->fingerprint != fingerprint ||
+		entry->stamp > stamp)
+		return NULL;
+	return entry;
+}
+
+/*
+ * SharedPlanCacheGetStats -- adopt the plan choice statistics of others
+ *
+ * If another backend has published a generic plan for this query, copy the
+ * cost statistics it had gathered into plansource, so that GetCachedPlan()
+ * can choose between custom and generic plans without first running five
+ * custom plans of its own.  Returns true if statistics were found.
+ */
+bool
+SharedPlanCacheGetStats(CachedPlanSource *plansource, uint64 stamp)
+{
+	SharedPlanKey key;
+	uint64		fingerprint;
+	SharedPlanEntry *entry;
+	bool		found = false;
+
+	if (!SharedPlanSourceShareable(plansource))
+		return false;
+
+	SharedPlanMakeKey(plansource, &key, &fingerprint);
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_SHARED);
+	entry = SharedPlanFind(&key, fingerprint, stamp);
+	if (entry != NULL && entry->num_custom_plans > 0)
+	{
+		plansource->generic_cost = entry->generic_cost;
+		plansource->total_custom_cost = entry->total_custom_cost;
+		plansource->num_custom_plans = entry->num_custom_plans;
+		found = true;
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+
+	return found;
+}
+
+/*
+ * SharedPlanCacheLookup -- look for a published generic plan
+ *
+ * Returns the PlannedStmt list in the current memory context, or NIL if
+ * there is no usable plan.  The caller must acquire the execution locks the
+ * planner would have taken before using it.
+ */
+List *
+SharedPlanCacheLookup(CachedPlanSource *plansource, uint64 stamp)
+{
+	SharedPlanKey key;
+	uint64		fingerprint;
+	SharedPlanEntry *entry;
+	char	   *text = NULL;
+	List	   *stmt_list;
+
+	if (!SharedPlanSourceShareable(plansource))
+		return NIL;
+
+	SharedPlanMakeKey(plansource, &key, &fingerprint);
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+	entry = SharedPlanFind(&key, fingerprint, stamp);
+	if (entry != NULL)
+	{
+		SharedPlanData *data = dsa_get_address(SharedPlanArea, entry->data);
+
+		/* don't risk an error while holding the lock */
+		text = palloc_extended(data->textlen + 1, MCXT_ALLOC_NO_OOM);
+		if (text != NULL)
+		{
+			memcpy(text, SharedPlanDataText(data), data->textlen + 1);
+			dlist_move_head(&SharedPlanCache->lru, &entry->lru_node);
+		}
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+
+	if (text == NULL)
+		return NIL;
+
+	stmt_list = (List *) stringToNode(text);
+	pfree(text);
+
+	return stmt_list;
+}
+
+/*
+ * SharedPlanCacheInsert -- publish a generic plan built by this backend
+ *
+ * stamp is the value read before the plan source was revalidated.  If any
+ * invalidation arrived since, the plan may have been built from a catalog
+ * state others no longer see, and it is not published.  If the entry is
+ * there already, only its cost statistics are refreshed.
+ */
+void
+SharedPlanCacheInsert(CachedPlanSource *plansource, uint64 stamp,
+					  List *stmt_list)
+{
+	SharedPlanKey key;
+	uint64		fingerprint;
+	SharedPlanEntry *entry;
+	SharedPlanData *data;
+	SharedPlanInvalItem *item;
+	char	   *text;
+	Size		textlen;
+	Size		size;
+	int			nrelations = 0;
+	int			ninvalitems = 0;
+	dsa_pointer dp;
+	ListCell   *lc;
+	ListCell   *lc2;
+	bool		found;
+
+	if (!SharedPlanSourceShareable(plansource))
+		return;
+
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+		if (SharedPlanUsesTempRelation(plannedstmt->relationOids))
+			return;
+		nrelations += list_length(plannedstmt->relationOids);
+		ninvalitems += list_length(plannedstmt->invalItems);
+	}
+
+	SharedPlanMakeKey(plansource, &key, &fingerprint);
+
+	/* If this very plan is published already, just refresh the statistics */
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+	entry = SharedPlanFind(&key, fingerprint, stamp);
+	if (entry != NULL)
+	{
+		if (plansource->num_custom_plans >= entry->num_custom_plans)
+		{
+			entry->generic_cost = plansource->generic_cost;
+			entry->total_custom_cost = plansource->total_custom_cost;
+			entry->num_custom_plans = plansource->num_custom_plans;
+		}
+		dlist_move_head(&SharedPlanCache->lru, &entry->lru_node);
+		LWLockRelease(&SharedPlanCache->lock);
+		return;
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+
+	/* Serialize the plan and its dependencies outside the lock */
+	text = nodeToString(stmt_list);
+	textlen = strlen(text);
+	size = offsetof(SharedPlanData, relations) +
+		nrelations * sizeof(Oid) +
+		ninvalitems * sizeof(SharedPlanInvalItem) +
+		textlen + 1;
+
+	/* a single plan mustn't push out most of the cache */
+	if (size > SharedPlanCache->area_size / 4)
+	{
+		pfree(text);
+		return;
+	}
+
+	data = (SharedPlanData *) palloc(size);
+	data->nrelations = nrelations;
+	data->ninvalitems = ninvalitems;
+	data->textlen = textlen;
+	nrelations = 0;
+	item = SharedPlanDataInvalItems(data);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		foreach(lc2, plannedstmt->relationOids)
+			data->relations[nrelations++] = lfirst_oid(lc2);
+		foreach(lc2, plannedstmt->invalItems)
+		{
+			PlanInvalItem *pii = lfirst_node(PlanInvalItem, lc2);
+
+			item->cacheId = pii->cacheId;
+			item->hashValue = pii->hashValue;
+			item++;
+		}
+	}
+	memcpy(SharedPlanDataText(data), text, textlen + 1);
+	pfree(text);
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+	if (pg_atomic_read_u64(&SharedPlanCache->stamp) != stamp)
+	{
+		LWLockRelease(&SharedPlanCache->lock);
+		pfree(data);
+		return;
+	}
+
+	/* Replace any entry with the same key, but a different query tree */
+	entry = (SharedPlanEntry *) hash_search(SharedPlanHash, &key,
+											HASH_FIND, NULL);
+	if (entry != NULL)
+		SharedPlanEvict(entry);
+
+	/* Make room in the area and in the hash table */
+	while (!DsaPointerIsValid(dp = dsa_allocate_extended(SharedPlanArea, size,
+														 DSA_ALLOC_NO_OOM)))
+	{
+		if (!SharedPlanEvictOldest())
+			break;
+	}
+	if (!DsaPointerIsValid(dp))
+	{
+		LWLockRelease(&SharedPlanCache->lock);
+		pfree(data);
+		return;
+	}
+	while ((entry = (SharedPlanEntry *) hash_search(SharedPlanHash, &key,
+													HASH_ENTER_NULL,
+													&found)) == NULL)
+	{
+		if (!SharedPlanEvictOldest())
+			break;
+	}
+	if (entry == NULL)
+	{
+		dsa_free(SharedPlanArea, dp);
+		LWLockRelease(&SharedPlanCache->lock);
+		pfree(data);
+		return;
+	}
+	Assert(!found);
+
+	memcpy(dsa_get_address(SharedPlanArea, dp), data, size);
+	entry->fingerprint = fingerprint;
+	entry->stamp = stamp;
+	entry->data = dp;
+	entry->generic_cost = plansource->generic_cost;
+	entry->total_custom_cost = plansource->total_custom_cost;
+	entry->num_custom_plans = plansource->num_custom_plans;
+	dlist_push_head(&SharedPlanCache->lru, &entry->lru_node);
+
+	LWLockRelease(&SharedPlanCache->lock);
+	pfree(data);
+}
+
+/*
+ * Would msg make a plan cache entry of database dbId with the given data
+ * invalid?  This mirrors PlanCacheRelCallback, PlanCacheObjectCallback and
+ * PlanCacheSysCallback.
+ */
+static bool
+SharedPlanInvalidatedBy(const SharedInvalidationMessage *msg, Oid dbId,
+						SharedPlanData *data)
+{
+	int			i;
+
+	if (msg->id >= 0)
+	{
+		SharedPlanInvalItem *items = SharedPlanDataInvalItems(data);
+
+		if (msg->cc.dbId != InvalidOid && msg->cc.dbId != dbId)
+			return false;
+		switch (msg->cc.id)
+		{
+			case PROCOID:
+			case TYPEOID:
+				for (i = 0; i < data->ninvalitems; i++)
+				{
+					if (items[i].cacheId == msg->cc.id &&
+						items[i].hashValue == msg->cc.hashValue)
+						return true;
+				}
+				return false;
+			case NAMESPACEOID:
+			case OPEROID:
+			case AMOPOPID:
+			case FOREIGNSERVEROID:
+			case FOREIGNDATAWRAPPEROID:
+				return true;
+			default:
+				return false;
+		}
+	}
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+	{
+		if (msg->rc.dbId != InvalidOid && msg->rc.dbId != dbId)
+			return false;
+		if (msg->rc.relId == InvalidOid)
+			return true;
+		for (i = 0; i < data->nrelations; i++)
+		{
+			if (data->relations[i] == msg->rc.relId)
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Could msg invalidate any plan at all?
+ */
+static bool
+SharedPlanMessageRelevant(const SharedInvalidationMessage *msg)
+{
+	if (msg->id >= 0)
+	{
+		switch (msg->cc.id)
+		{
+			case PROCOID:
+			case TYPEOID:
+			case NAMESPACEOID:
+			case OPEROID:
+			case AMOPOPID:
+			case FOREIGNSERVEROID:
+			case FOREIGNDATAWRAPPEROID:
+				return true;
+			default:
+				return false;
+		}
+	}
+	return msg->id == SHAREDINVALRELCACHE_ID;
+}
+
+/*
+ * SharedPlanCacheInvalidateMessages -- apply invalidations to the shared cache
+ *
+ * Called with every batch of messages sent to other backends, after the
+ * changes they describe have become visible.  This runs after commit, so it
+ * must not fail: it allocates nothing.
+ */
+void
+SharedPlanCacheInvalidateMessages(const SharedInvalidationMessage *msgs, int n)
+{
+	dlist_mutable_iter iter;
+	bool		relevant = false;
+	int			i;
+
+	if (SharedPlanCache == NULL || n == 0)
+		return;
+
+	/* Whatever the messages are, in-progress lookups mustn't publish */
+	pg_atomic_fetch_add_u64(&SharedPlanCache->stamp, 1);
+
+	for (i = 0; i < n && !relevant; i++)
+		relevant = SharedPlanMessageRelevant(&msgs[i]);
+	if (!relevant)
+		return;
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+	dlist_foreach_modify(iter, &SharedPlanCache->lru)
+	{
+		SharedPlanEntry *entry = dlist_container(SharedPlanEntry, lru_node,
+												 iter.cur);
+		SharedPlanData *data = dsa_get_address(SharedPlanArea, entry->data);
+
+		for (i = 0; i < n; i++)
+		{
+			if (SharedPlanInvalidatedBy(&msgs[i], entry->key.dbId, data))
+			{
+				SharedPlanEvict(entry);
+				break;
+			}
+		}
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+}
@@ -264,6 +264,21 @@ static int	SecurityRestrictionContext = 0;
 /* We also remember if a SET ROLE is currently active */
 static bool SetRoleIsActive = false;
 
+/*
+ * Initialize process-local latch support, and point MyLatch at the
+ * process-local latch
+ *
+ * This is used by the postmaster itself as well as by its children, which
+ * replace the postmaster's self-pipe with their own here.
+ */
+void
+InitProcessLocalLatch(void)
+{
+	InitializeLatchSupport();
+	MyLatch = &LocalLatchData;
+	InitLatch(MyLatch);
+}
+
 /*
  * Initialize the basic environment for a postmaster child
  *
@@ -290,9 +305,7 @@ InitPostmasterChild(void)
 	on_exit_reset();
 
 	/* Initialize process-local latch support */
-	InitializeLatchSupport();
-	MyLatch = &LocalLatchData;
-	InitLatch(MyLatch);
+	InitProcessLocalLatch();
 
 	/*
 	 * If possible, make this process a group leader, so that the postmaster
@@ -322,9 +335,7 @@ InitStandaloneProcess(const char *argv0)
 	InitProcessGlobals();
 
 	/* Initialize process-local latch support */
-	InitializeLatchSupport();
-	MyLatch = &LocalLatchData;
-	InitLatch(MyLatch);
+	InitProcessLocalLatch();
 
 	/* Compute paths, no postmaster to inherit from */
 	if (my_exec_path[0] == '\0')
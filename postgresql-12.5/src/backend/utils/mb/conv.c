@@ -498,6 +498,16 @@ UtfToLocal(const unsigned char *utf, int len,
 		if (*utf == '\0')
 			break;
 
+		if (!IS_HIGHBIT_SET(*utf))
+		{
+			/* copy the whole run of ASCII, assuming one-to-one conversion */
+			l = pg_ascii_prefix_len(utf, len);
+			memcpy(iso, utf, l);
+			iso += l;
+			utf += l;
+			continue;
+		}
+
 		l = pg_utf_mblen(utf);
 		if (len < l)
 			break;
@@ -692,9 +702,11 @@ LocalToUtf(const unsigned char *iso, int len,
 
 		if (!IS_HIGHBIT_SET(*iso))
 		{
-			/* ASCII case is easy, assume it's one-to-one conversion */
-			*utf++ = *iso++;
-			l = 1;
+			/* copy the whole run of ASCII, assuming one-to-one conversion */
+			l = pg_ascii_prefix_len(iso, len);
+			memcpy(utf, iso, l);
+			utf += l;
+			iso += l;
 			continue;
 		}
 
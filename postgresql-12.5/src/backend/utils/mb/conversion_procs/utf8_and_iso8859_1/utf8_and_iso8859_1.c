@@ -47,7 +47,15 @@ iso8859_1_to_utf8(PG_FUNCTION_ARGS)
 		if (c == 0)
 			report_invalid_encoding(PG_LATIN1, (const char *) src, len);
 		if (!IS_HIGHBIT_SET(c))
-			*dest++ = c;
+		{
+			int			l = pg_ascii_prefix_len(src, len);
+
+			memcpy(dest, src, l);
+			dest += l;
+			src += l;
+			len -= l;
+			continue;
+		}
 		else
 		{
 			*dest++ = (c >> 6) | 0xc0;
@@ -80,9 +88,12 @@ utf8_to_iso8859_1(PG_FUNCTION_ARGS)
 		/* fast path for ASCII-subset characters */
 		if (!IS_HIGHBIT_SET(c))
 		{
-			*dest++ = c;
-			src++;
-			len--;
+			int			l = pg_ascii_prefix_len(src, len);
+
+			memcpy(dest, src, l);
+			dest += l;
+			src += l;
+			len -= l;
 		}
 		else
 		{
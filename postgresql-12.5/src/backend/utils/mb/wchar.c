@@ -11,7 +11,12 @@
 #include "postgres.h"
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "mb/pg_wchar.h"
+#include "port/pg_bitutils.h"
 
 
 /*
@@ -1488,6 +1493,46 @@ pg_utf8_verifier(const unsigned char *s, int len)
 	return l;
 }
 
+/*
+ * Inline equivalent of pg_utf8_verifier() for a non-ASCII first byte, for
+ * the UTF-8 loop of pg_verify_mbstr_len().  Lead bytes 0x80-0xC1 and above
+ * 0xF4 are rejected up front, so the remaining checks are only those on the
+ * continuation bytes.
+ */
+static inline int
+utf8_verify_multibyte(const unsigned char *s, int len)
+{
+	unsigned char b1 = s[0];
+	unsigned char lo = 0x80,
+				hi = 0xBF;
+	int			l;
+
+	if (b1 < 0xC2 || b1 > 0xF4)
+		return -1;
+	l = (b1 < 0xE0) ? 2 : (b1 < 0xF0) ? 3 : 4;
+	if (len < l)
+		return -1;
+
+	/* the second byte has narrower ranges after some lead bytes */
+	if (b1 == 0xE0)
+		lo = 0xA0;
+	else if (b1 == 0xED)
+		hi = 0x9F;
+	else if (b1 == 0xF0)
+		lo = 0x90;
+	else if (b1 == 0xF4)
+		hi = 0x8F;
+	if (s[1] < lo || s[1] > hi)
+		return -1;
+
+	if (l > 2 && (s[2] & 0xC0) != 0x80)
+		return -1;
+	if (l > 3 && (s[3] & 0xC0) != 0x80)
+		return -1;
+
+	return l;
+}
+
 /*
  * Check for validity of a single UTF-8 encoded character
  *
@@ -1906,6 +1951,60 @@ pg_database_encoding_character_incrementer(void)
 	}
 }
 
+/*
+ * Return the length of the longest prefix of s, at most len bytes long, that
+ * consists of ASCII characters other than NUL.  Those are single-byte
+ * characters valid in every supported encoding, so verification and
+ * conversion loops use this to skip over runs of plain ASCII many bytes at
+ * a time, rather than a character at a time.
+ */
+int
+pg_ascii_prefix_len(const unsigned char *s, int len)
+{
+	int			i = 0;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i		chunk = _mm_loadu_si128((const __m128i *) (s + i));
+		int			mask;
+
+		/* one bit for each byte that has its high bit set or is zero */
+		mask = _mm_movemask_epi8(_mm_or_si128(chunk,
+											  _mm_cmpeq_epi8(chunk, zero)));
+		if (mask != 0)
+			return i + pg_rightmost_one_pos32((uint32) mask);
+	}
+#endif
+
+	for (; i + 8 <= len; i += 8)
+	{
+		uint64		chunk;
+
+		memcpy(&chunk, s + i, sizeof(chunk));
+
+		/*
+		 * Stop at a high bit.  Otherwise every byte is below 0x80, and
+		 * subtracting 1 from each byte can only set a high bit where there
+		 * is a zero byte, or a borrow from one.
+		 */
+		if ((chunk & UINT64CONST(0x8080808080808080)) != 0 ||
+			((chunk - UINT64CONST(0x0101010101010101)) &
+			 UINT64CONST(0x8080808080808080)) != 0)
+			break;
+	}
+
+	for (; i < len; i++)
+	{
+		if (s[i] == '\0' || IS_HIGHBIT_SET(s[i]))
+			break;
+	}
+
+	return i;
+}
+
 /*
  * Verify mbstr to make sure that it is validly encoded in the current
  * database encoding.  Otherwise same as pg_verify_mbstr().
@@ -1974,9 +2073,10 @@ pg_verify_mbstr_len(int encoding, const char *mbstr, int len, bool noError)
 		{
 			if (*mbstr != '\0')
 			{
-				mb_len++;
-				mbstr++;
-				len--;
+				l = pg_ascii_prefix_len((const unsigned char *) mbstr, len);
+				mb_len += l;
+				mbstr += l;
+				len -= l;
 				continue;
 			}
 			if (noError)
@@ -1984,7 +2084,11 @@ pg_verify_mbstr_len(int encoding, const char *mbstr, int len, bool noError)
 			report_invalid_encoding(encoding, mbstr, len);
 		}
 
-		l = (*mbverify) ((const unsigned char *) mbstr, len);
+		/* UTF-8 is common enough to deserve avoiding the indirect call */
+		if (encoding == PG_UTF8)
+			l = utf8_verify_multibyte((const unsigned char *) mbstr, len);
+		else
+			l = (*mbverify) ((const unsigned char *) mbstr, len);
 
 		if (l < 0)
 		{
@@ -678,6 +678,31 @@ ResourceOwnerReleaseInternal(ResourceOwner owner,
 	CurrentResourceOwner = save;
 }
 
+/*
+ * ReleaseAllPlanCacheRefsInOwner
+ *		Release the plancache references (only) held by this owner.
+ *
+ * This is for owners that are used just to hold plan references across
+ * some span of time, and are released explicitly rather than through
+ * ResourceOwnerRelease.
+ */
+void
+ReleaseAllPlanCacheRefsInOwner(ResourceOwner owner)
+{
+	ResourceOwner save;
+	Datum		foundres;
+
+	save = CurrentResourceOwner;
+	CurrentResourceOwner = owner;
+	while (ResourceArrayGetAny(&(owner->planrefarr), &foundres))
+	{
+		CachedPlan *res = (CachedPlan *) DatumGetPointer(foundres);
+
+		ReleaseCachedPlan(res, true);
+	}
+	CurrentResourceOwner = save;
+}
+
 /*
  * ResourceOwnerDelete
  *		Delete an owner object and its descendants.
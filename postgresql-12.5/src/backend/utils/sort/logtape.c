@@ -325,6 +325,19 @@ ltsReadFillBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	/*
+	 * The tuples in the buffer will keep the merge busy for a while before
+	 * we're back for more.  Meanwhile, have the kernel read ahead what we'll
+	 * need to refill the buffer.  A tape's blocks are usually allocated
+	 * consecutively, so assume the next ones follow the next block; if they
+	 * don't, the hint is merely wasted.  Single-block buffers are refilled
+	 * too often for that to pay off.
+	 */
+	if (lt->nextBlockNumber != -1L && lt->buffer_size > BLCKSZ)
+		BufFilePrefetchBlock(lts->pfile,
+							 lt->nextBlockNumber + lt->offsetBlockNumber,
+							 lt->buffer_size / BLCKSZ);
+
 	return (lt->nbytes > 0);
 }
 
@@ -31,10 +31,13 @@
  * input is reached, we dump out remaining tuples in memory into a final run,
  * then merge the runs using Algorithm D.
  *
- * When merging runs, we use a heap containing just the frontmost tuple from
- * each source run; we repeatedly output the smallest tuple and replace it
- * with the next tuple from its source tape (if any).  When the heap empties,
- * the merge is complete.  The basic merge algorithm thus needs very little
+ * When merging runs, we use a tournament tree of losers (Knuth's 5.4.1)
+ * over the frontmost tuple of each source run; we repeatedly output the
+ * winner, the smallest tuple, and replace it with the next tuple from its
+ * source tape (if any).  Replaying the tournament for the replacement takes
+ * one comparison per level of the tree, about half as many as sifting it
+ * into a heap would, which matters in wide merges.  When all source runs
+ * are exhausted, the merge is complete.  The basic merge algorithm thus needs very little
  * memory --- only M tuples for an M-way merge, and M is constrained to a
  * small number.  However, we can still make good use of our full workMem
  * allocation by pre-reading additional blocks from each source tape.  Without
@@ -163,8 +166,8 @@ bool		optimize_bounded_sort = true;
  * described above.  Accordingly, "tuple" is always used in preference to
  * datum1 as the authoritative value for pass-by-reference cases.
  *
- * tupindex holds the input tape number that each tuple in the heap was read
- * from during merge passes.
+ * tupindex holds the input tape number that each tuple in the merge tree was
+ * read from during merge passes.
  */
 typedef struct
 {
@@ -219,10 +222,16 @@ typedef enum
  * tape during a preread cycle (see discussion at top of file).
  */
 #define MINORDER		6		/* minimum merge order */
-#define MAXORDER		500		/* maximum merge order */
+#define MAXORDER		2048	/* maximum merge order */
 #define TAPE_BUFFER_OVERHEAD		BLCKSZ
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
+/*
+ * Below this many tuples, radix sorting isn't worth its fixed cost of
+ * counting into 256 buckets per key byte, and we use quicksort instead.
+ */
+#define RADIX_SORT_MIN_TUPLES	64
+
 typedef int (*SortTupleComparator) (const SortTuple *a, const SortTuple *b,
 									Tuplesortstate *state);
 
@@ -288,9 +297,12 @@ struct Tuplesortstate
 	/*
 	 * This array holds the tuples now in sort memory.  If we are in state
 	 * INITIAL, the tuples are in no particular order; if we are in state
-	 * SORTEDINMEM, the tuples are in final sorted order; in states BUILDRUNS
-	 * and FINALMERGE, the tuples are organized in "heap" order per Algorithm
-	 * H.  In state SORTEDONTAPE, the array is not used.
+	 * SORTEDINMEM, the tuples are in final sorted order; in state BOUNDED,
+	 * the tuples are organized in "heap" order per Algorithm H.  In states
+	 * BUILDRUNS and FINALMERGE, during merge passes, the array holds the
+	 * leaves of the merge tree: the current tuple of each input run, which
+	 * stays in its slot even once the run is exhausted.  In state
+	 * SORTEDONTAPE, the array is not used.
 	 */
 	SortTuple  *memtuples;		/* array of SortTuple structs */
 	int			memtupcount;	/* number of tuples currently present */
@@ -308,7 +320,7 @@ struct Tuplesortstate
 	 * For the slab, we use one large allocation, divided into SLAB_SLOT_SIZE
 	 * slots.  The allocation is sized to have one slot per tape, plus one
 	 * additional slot.  We need that many slots to hold all the tuples kept
-	 * in the heap during merge, plus the one we have last returned from the
+	 * in the merge tree during merge, plus the one we have last returned from the
 	 * sort, with tuplesort_gettuple.
 	 *
 	 * Initially, all the slots are kept in a linked list of free slots.  When
@@ -359,6 +371,19 @@ struct Tuplesortstate
 	 */
 	bool	   *mergeactive;	/* active input run source? */
 
+	/*
+	 * The tournament tree of losers used during merge passes.  Its leaves
+	 * are memtuples[0 .. mergeleaves - 1], and its internal nodes are
+	 * mergetree[1 .. mergeleaves - 1], each holding the index of the leaf
+	 * that lost the match played there.  mergetree[0] holds the overall
+	 * winner.  Node i's children are nodes 2i and 2i + 1, where node
+	 * mergeleaves + j stands for leaf j.  A leaf whose run is exhausted
+	 * (see mergeactive) loses every match.  memtupcount is the number of
+	 * runs not yet exhausted.
+	 */
+	int		   *mergetree;		/* leaf indexes of losers, winner in [0] */
+	int			mergeleaves;	/* number of leaves of mergetree */
+
 	/*
 	 * Variables for Algorithm D.  Note that destTape is a "logical" tape
 	 * number, ie, an index into the tp_xxx[] arrays.  Be careful to keep
@@ -442,7 +467,7 @@ struct Tuplesortstate
 	Relation	heapRel;		/* table the index is being built on */
 	Relation	indexRel;		/* index being built */
 
-	/* These are specific to the index_btree subcase: */
+	/* These are specific to the index_btree and index_gist subcases: */
 	bool		enforceUnique;	/* complain if we find duplicate tuples */
 
 	/* These are specific to the index_hash subcase: */
@@ -608,6 +633,10 @@ static void tuplesort_sort_memtuples(Tuplesortstate *state);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_delete_top(Tuplesortstate *state);
+static void tuplesort_mergetree_build(Tuplesortstate *state);
+static void tuplesort_mergetree_replace_top(Tuplesortstate *state,
+											SortTuple *tuple);
+static void tuplesort_mergetree_delete_top(Tuplesortstate *state);
 static void reversedirection(Tuplesortstate *state);
 static unsigned int getlen(Tuplesortstate *state, int tapenum, bool eofOK);
 static void markrunend(Tuplesortstate *state, int tapenum);
@@ -647,6 +676,10 @@ static void worker_freeze_result_tape(Tuplesortstate *state);
 static void worker_nomergeruns(Tuplesortstate *state);
 static void leader_takeover_tapes(Tuplesortstate *state);
 static void free_sort_tuple(Tuplesortstate *state, SortTuple *stup);
+static int	radix_sort_key_bytes(Tuplesortstate *state);
+static void radix_sort_tuple(Tuplesortstate *state, SortTuple *memtuples,
+							 size_t n, int keybytes, int shift);
+static void radix_sort_memtuples(Tuplesortstate *state, int keybytes);
 
 /*
  * Special versions of qsort just for SortTuple objects.  qsort_tuple() sorts
@@ -706,10 +739,15 @@ tuplesort_begin_common(int workMem, SortCoordinate coordinate,
 	 * fragmentation. Note that the memtuples array of SortTuples is allocated
 	 * in the parent context, not this context, because there is no need to
 	 * free memtuples early.
+	 *
+	 * Tuples are only freed en masse, when a run is dumped to tape, so a bump
+	 * context suffices and saves the per-chunk rounding of aset.c.  Bounded
+	 * sorts discard tuples one at a time; tuplesort_set_bound() switches to
+	 * an AllocSet for them.
 	 */
-	tuplecontext = AllocSetContextCreate(sortcontext,
-										 "Caller tuples",
-										 ALLOCSET_DEFAULT_SIZES);
+	tuplecontext = BumpContextCreate(sortcontext,
+									 "Caller tuples",
+									 ALLOCSET_DEFAULT_SIZES);
 
 	/*
 	 * Make the Tuplesortstate within the per-sort context.  This way, we
@@ -1049,6 +1087,78 @@ tuplesort_begin_index_btree(Relation heapRel,
 	return state;
 }
 
+/*
+ * Sort index tuples of a GiST index, using the sort support functions of
+ * its opclasses.  Every key column must have one; the resulting order is
+ * whatever the opclass deems good for packing pages (e.g. a space-filling
+ * curve), so there is no notion of ascending or descending order here.
+ */
+Tuplesortstate *
+tuplesort_begin_index_gist(Relation heapRel,
+						   Relation indexRel,
+						   int workMem,
+						   SortCoordinate coordinate,
+						   bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
+
+	TRACE_POSTGRESQL_SORT_START(INDEX_SORT,
+								false,	/* no unique check */
+								state->nKeys,
+								workMem,
+								randomAccess,
+								PARALLEL_SORT(state));
+
+	state->comparetup = comparetup_index_btree;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index;
+	state->abbrevNext = 10;
+
+	state->heapRel = heapRel;
+	state->indexRel = indexRel;
+	state->enforceUnique = false;
+
+	/* Prepare SortSupport data for each column */
+	state->sortKeys = (SortSupport) palloc0(state->nKeys *
+											sizeof(SortSupportData));
+
+	for (i = 0; i < state->nKeys; i++)
+	{
+		SortSupport sortKey = state->sortKeys + i;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = indexRel->rd_indcollation[i];
+		sortKey->ssup_nulls_first = false;
+		sortKey->ssup_attno = i + 1;
+		/* Convey if abbreviation optimization is applicable in principle */
+		sortKey->abbreviate = (i == 0);
+
+		AssertState(sortKey->ssup_attno != 0);
+
+		/* Look for a sort support function */
+		PrepareSortSupportFromGistIndexRel(indexRel, sortKey);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_index_hash(Relation heapRel,
 						   Relation indexRel,
@@ -1208,6 +1318,16 @@ tuplesort_set_bound(Tuplesortstate *state, int64 bound)
 	state->bounded = true;
 	state->bound = (int) bound;
 
+	/*
+	 * The bounded heap frees each tuple it discards, and a bump context would
+	 * never reuse that space.  Nothing has been allocated in the tuple
+	 * context yet, so just replace it.
+	 */
+	MemoryContextDelete(state->tuplecontext);
+	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
+												"Caller tuples",
+												ALLOCSET_DEFAULT_SIZES);
+
 	/*
 	 * Bounded sorts are not an effective target for abbreviated key
 	 * optimization.  Disable by setting state to be consistent with no
@@ -2091,10 +2211,11 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 			 */
 			if (state->memtupcount > 0)
 			{
-				int			srcTape = state->memtuples[0].tupindex;
+				SortTuple  *winner = &state->memtuples[state->mergetree[0]];
+				int			srcTape = winner->tupindex;
 				SortTuple	newtup;
 
-				*stup = state->memtuples[0];
+				*stup = *winner;
 
 				/*
 				 * Remember the tuple we return, so that we can recycle its
@@ -2104,15 +2225,15 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 
 				/*
 				 * Pull next tuple from tape, and replace the returned tuple
-				 * at top of the heap with it.
+				 * at the top of the merge tree with it.
 				 */
 				if (!mergereadnext(state, srcTape, &newtup))
 				{
 					/*
 					 * If no more data, we've reached end of run on this tape.
-					 * Remove the top node from the heap.
+					 * Take it out of the merge tree.
 					 */
-					tuplesort_heap_delete_top(state);
+					tuplesort_mergetree_delete_top(state);
 
 					/*
 					 * Rewind to free the read buffer.  It'd go away at the
@@ -2123,7 +2244,7 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 					return true;
 				}
 				newtup.tupindex = srcTape;
-				tuplesort_heap_replace_top(state, &newtup);
+				tuplesort_mergetree_replace_top(state, &newtup);
 				return true;
 			}
 			return false;
@@ -2373,9 +2494,11 @@ tuplesort_merge_order(int64 allowedMem)
 	 * additional tape reduces the amount of memory available to build runs,
 	 * which in turn can cause the same sort to need more runs, which makes
 	 * merging slower even if it can still be done in a single pass.  Also,
-	 * high order merges are quite slow due to CPU cache effects; it can be
-	 * faster to pay the I/O cost of a polyphase merge than to perform a
-	 * single merge pass across many hundreds of tapes.
+	 * high order merges suffer from CPU cache effects, though the merge tree
+	 * keeps the number of comparisons per tuple down to log2 of the merge
+	 * order.  Reaching MAXORDER takes over half a gigabyte of workMem, and
+	 * sorts given that much are usually large enough that saving a merge
+	 * pass over the data is well worth it.
 	 */
 	mOrder = Max(mOrder, MINORDER);
 	mOrder = Min(mOrder, MAXORDER);
@@ -2472,6 +2595,7 @@ inittapestate(Tuplesortstate *state, int maxTapes)
 	PrepareTempTablespaces();
 
 	state->mergeactive = (bool *) palloc0(maxTapes * sizeof(bool));
+	state->mergetree = (int *) palloc0(maxTapes * sizeof(int));
 	state->tp_fib = (int *) palloc0(maxTapes * sizeof(int));
 	state->tp_runs = (int *) palloc0(maxTapes * sizeof(int));
 	state->tp_dummy = (int *) palloc0(maxTapes * sizeof(int));
@@ -2595,7 +2719,7 @@ mergeruns(Tuplesortstate *state)
 
 	/*
 	 * We no longer need a large memtuples array.  (We will allocate a smaller
-	 * one for the heap later.)
+	 * one for the merge tree later.)
 	 */
 	FREEMEM(state, GetMemoryChunkSpace(state->memtuples));
 	pfree(state->memtuples);
@@ -2624,7 +2748,7 @@ mergeruns(Tuplesortstate *state)
 
 	/*
 	 * Initialize the slab allocator.  We need one slab slot per input tape,
-	 * for the tuples in the heap, plus one to hold the tuple last returned
+	 * for the tuples in the merge tree, plus one to hold the tuple last returned
 	 * from tuplesort_gettuple.  (If we're sorting pass-by-val Datums,
 	 * however, we don't need to do allocate anything.)
 	 *
@@ -2637,8 +2761,8 @@ mergeruns(Tuplesortstate *state)
 		init_slab_allocator(state, 0);
 
 	/*
-	 * Allocate a new 'memtuples' array, for the heap.  It will hold one tuple
-	 * from each input tape.
+	 * Allocate a new 'memtuples' array, for the merge tree.  It will hold one
+	 * tuple from each input tape.
 	 */
 	state->memtupsize = numInputTapes;
 	state->memtuples = (SortTuple *) palloc(numInputTapes * sizeof(SortTuple));
@@ -2792,43 +2916,43 @@ mergeonerun(Tuplesortstate *state)
 
 	/*
 	 * Start the merge by loading one tuple from each active source tape into
-	 * the heap.  We can also decrease the input run/dummy run counts.
+	 * the merge tree.  We can also decrease the input run/dummy run counts.
 	 */
 	beginmerge(state);
 
 	/*
-	 * Execute merge by repeatedly extracting lowest tuple in heap, writing it
-	 * out, and replacing it with next tuple from same tape (if there is
-	 * another one).
+	 * Execute merge by repeatedly extracting the winner of the merge tree,
+	 * writing it out, and replacing it with next tuple from same tape (if
+	 * there is another one).
 	 */
 	while (state->memtupcount > 0)
 	{
+		SortTuple  *winner = &state->memtuples[state->mergetree[0]];
 		SortTuple	stup;
 
 		/* write the tuple to destTape */
-		srcTape = state->memtuples[0].tupindex;
-		WRITETUP(state, destTape, &state->memtuples[0]);
+		srcTape = winner->tupindex;
+		WRITETUP(state, destTape, winner);
 
 		/* recycle the slot of the tuple we just wrote out, for the next read */
-		if (state->memtuples[0].tuple)
-			RELEASE_SLAB_SLOT(state, state->memtuples[0].tuple);
+		if (winner->tuple)
+			RELEASE_SLAB_SLOT(state, winner->tuple);
 
 		/*
 		 * pull next tuple from the tape, and replace the written-out tuple in
-		 * the heap with it.
+		 * the merge tree with it.
 		 */
 		if (mergereadnext(state, srcTape, &stup))
 		{
 			stup.tupindex = srcTape;
-			tuplesort_heap_replace_top(state, &stup);
-
+			tuplesort_mergetree_replace_top(state, &stup);
 		}
 		else
-			tuplesort_heap_delete_top(state);
+			tuplesort_mergetree_delete_top(state);
 	}
 
 	/*
-	 * When the heap empties, we're done.  Write an end-of-run marker on the
+	 * When all the runs are exhausted, we're done.  Write an end-of-run marker on the
 	 * output tape, and increment its count of real runs.
 	 */
 	markrunend(state, destTape);
@@ -2845,8 +2969,8 @@ mergeonerun(Tuplesortstate *state)
  * beginmerge - initialize for a merge pass
  *
  * We decrease the counts of real and dummy runs for each tape, and mark
- * which tapes contain active input runs in mergeactive[].  Then, fill the
- * merge heap with the first tuple from each active tape.
+ * which tapes contain active input runs in mergeactive[].  Then, build the
+ * merge tree from the first tuple of each active tape.
  */
 static void
 beginmerge(Tuplesortstate *state)
@@ -2855,7 +2979,7 @@ beginmerge(Tuplesortstate *state)
 	int			tapenum;
 	int			srcTape;
 
-	/* Heap should be empty here */
+	/* Merge tree should be empty here */
 	Assert(state->memtupcount == 0);
 
 	/* Adjust run counts and mark the active tapes */
@@ -2878,17 +3002,20 @@ beginmerge(Tuplesortstate *state)
 	Assert(activeTapes > 0);
 	state->activeTapes = activeTapes;
 
-	/* Load the merge heap with the first tuple from each input tape */
+	/* Load the leaves with the first tuple from each input tape */
 	for (srcTape = 0; srcTape < state->maxTapes; srcTape++)
 	{
 		SortTuple	tup;
 
 		if (mergereadnext(state, srcTape, &tup))
 		{
+			Assert(state->memtupcount < state->memtupsize);
 			tup.tupindex = srcTape;
-			tuplesort_heap_insert(state, &tup);
+			state->memtuples[state->memtupcount++] = tup;
 		}
 	}
+
+	tuplesort_mergetree_build(state);
 }
 
 /*
@@ -3312,8 +3439,16 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
+		int			keybytes = 0;
+
+		/* Is the leading key an integer we can radix sort on? */
+		if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+			keybytes = radix_sort_key_bytes(state);
+
+		if (keybytes > 0)
+			radix_sort_memtuples(state, keybytes);
 		/* Can we use the single-key sort function? */
-		if (state->onlyKey != NULL)
+		else if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
 					   state->onlyKey);
 		else
@@ -3324,6 +3459,270 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Radix sort support.
+ *
+ * When the leading sort key is a plain integer (int4, int8, date, timestamp
+ * and the like, recognized by their shared sortsupport comparators), we can
+ * sort memtuples by datum1 with an in-place most-significant-digit radix
+ * sort ("American flag sort") instead of comparing tuples.  It looks at one
+ * byte of the key per pass, so it does O(n * keybytes) work no matter how
+ * expensive the comparisons would have been, and it needs no memory beyond
+ * memtuples itself.
+ *
+ * Partitions that get small are handed to the regular quicksort routines,
+ * which also take care of any further sort keys.  Partitions in which every
+ * byte of the leading key is equal are likewise handed to qsort_tuple() if
+ * there are further keys to sort by.
+ */
+
+/*
+ * Can the leading key be radix sorted?  Returns the width of the key in
+ * bytes, or 0 if not.
+ */
+static int
+radix_sort_key_bytes(Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+
+	/* The hash index case has no sortKeys, and sorts on the hash value */
+	if (sortKey == NULL)
+		return 0;
+
+	/*
+	 * datum1 must hold the leading key itself.  It holds an abbreviated key
+	 * instead if abbreviation is in use, and nothing at all for CLUSTER on
+	 * an expression index.
+	 */
+	if (sortKey->abbrev_converter != NULL)
+		return 0;
+	if (state->indexInfo != NULL &&
+		state->indexInfo->ii_IndexAttrNumbers[0] == 0)
+		return 0;
+
+	if (sortKey->comparator == ssup_datum_int32_cmp)
+		return sizeof(int32);
+	if (sortKey->comparator == ssup_datum_int64_cmp)
+		return sizeof(int64);
+
+	return 0;
+}
+
+/*
+ * Map a SortTuple's leading key to an unsigned integer that sorts in the
+ * requested order: flip the sign bit so that negative values sort first,
+ * and invert everything for a descending sort.
+ */
+static inline uint64
+radix_sort_key(const SortTuple *stup, int keybytes, bool reverse)
+{
+	uint64		key;
+
+	if (keybytes == sizeof(int32))
+		key = (uint32) DatumGetInt32(stup->datum1) ^ UINT64CONST(0x80000000);
+	else
+		key = (uint64) DatumGetInt64(stup->datum1) ^
+			UINT64CONST(0x8000000000000000);
+
+	return reverse ? ~key : key;
+}
+
+/*
+ * Sort n tuples by their leading key, which is keybytes wide, looking at the
+ * byte selected by "shift" and all less significant ones.  All tuples must be non-NULL.
+ */
+static void
+radix_sort_tuple(Tuplesortstate *state, SortTuple *memtuples, size_t n,
+				 int keybytes, int shift)
+{
+	bool		reverse = state->sortKeys->ssup_reverse;
+	size_t		counts[256];
+	size_t		next[256];
+	size_t		ends[256];
+	size_t		pos;
+	int			b;
+
+	for (;;)
+	{
+		/* Small partitions are sorted faster by comparisons */
+		if (n < RADIX_SORT_MIN_TUPLES)
+		{
+			if (state->onlyKey != NULL)
+				qsort_ssup(memtuples, n, state->onlyKey);
+			else
+				qsort_tuple(memtuples, n, state->comparetup, state);
+			return;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+
+		memset(counts, 0, sizeof(counts));
+		for (pos = 0; pos < n; pos++)
+			counts[(radix_sort_key(&memtuples[pos], keybytes, reverse) >>
+					shift) & 0xFF]++;
+
+		/*
+		 * If every tuple has the same byte here, there's nothing to move;
+		 * just go on with the next byte.
+		 */
+		b = (radix_sort_key(&memtuples[0], keybytes, reverse) >> shift) & 0xFF;
+		if (counts[b] == n)
+		{
+			if (shift == 0)
+				break;
+			shift -= 8;
+			continue;
+		}
+
+		/* Find where each bucket starts and ends */
+		pos = 0;
+		for (b = 0; b < 256; b++)
+		{
+			next[b] = pos;
+			pos += counts[b];
+			ends[b] = pos;
+		}
+
+		/*
+		 * Permute the tuples in place: swap each misplaced tuple into the
+		 * next free slot of its bucket until every bucket is complete.
+		 */
+		for (b = 0; b < 256; b++)
+		{
+			while (next[b] < ends[b])
+			{
+				SortTuple  *stup = &memtuples[next[b]];
+				int			dest;
+
+				dest = (radix_sort_key(stup, keybytes, reverse) >> shift) & 0xFF;
+				if (dest == b)
+					next[b]++;
+				else
+				{
+					SortTuple	tmp = memtuples[next[dest]];
+
+					memtuples[next[dest]++] = *stup;
+					*stup = tmp;
+				}
+			}
+		}
+
+		/* Sort each bucket on the remaining bytes */
+		pos = 0;
+		for (b = 0; b < 256; b++)
+		{
+			if (counts[b] > 1)
+			{
+				if (shift > 0)
+					radix_sort_tuple(state, memtuples + pos, counts[b],
+									 keybytes, shift - 8);
+				else if (state->onlyKey == NULL)
+					qsort_tuple(memtuples + pos, counts[b],
+								state->comparetup, state);
+			}
+			pos += counts[b];
+		}
+		return;
+	}
+
+	/*
+	 * All the tuples have equal leading keys.  That's all there is to it in
+	 * the single key case; otherwise sort them on the remaining keys.
+	 */
+	if (state->onlyKey == NULL)
+		qsort_tuple(memtuples, n, state->comparetup, state);
+}
+
+/*
+ * Sort all memtuples, whose leading key is keybytes wide, by radix sort.
+ */
+static void
+radix_sort_memtuples(Tuplesortstate *state, int keybytes)
+{
+	SortTuple  *memtuples = state->memtuples;
+	int			n = state->memtupcount;
+	int			nnulls = 0;
+	int			i;
+	SortTuple  *nulls;
+	SortTuple  *notnulls;
+
+	/*
+	 * NULLs don't have a key to sort on.  Gather them at the start or the
+	 * end, as the sort order requires.
+	 */
+	if (state->sortKeys->ssup_nulls_first)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (memtuples[i].isnull1)
+			{
+				SortTuple	tmp = memtuples[nnulls];
+
+				memtuples[nnulls++] = memtuples[i];
+				memtuples[i] = tmp;
+			}
+		}
+		nulls = memtuples;
+		notnulls = memtuples + nnulls;
+	}
+	else
+	{
+		for (i = n - 1; i >= 0; i--)
+		{
+			if (memtuples[i].isnull1)
+			{
+				SortTuple	tmp = memtuples[n - 1 - nnulls];
+
+				memtuples[n - 1 - nnulls++] = memtuples[i];
+				memtuples[i] = tmp;
+			}
+		}
+		nulls = memtuples + n - nnulls;
+		notnulls = memtuples;
+	}
+
+	/* NULLs are equal to each other, so sort them on the remaining keys */
+	if (nnulls > 1 && state->onlyKey == NULL)
+		qsort_tuple(nulls, nnulls, state->comparetup, state);
+
+	if (n - nnulls > 1)
+		radix_sort_tuple(state, notnulls, n - nnulls, keybytes,
+						 (keybytes - 1) * 8);
+}
+
+/*
+ * Shared sortsupport comparators for integer-like types.  Types whose sort
+ * order is that of their int32 or int64 value use these, so that tuplesort
+ * can recognize them and radix sort on their values.
+ */
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		a = DatumGetInt32(x);
+	int32		b = DatumGetInt32(y);
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
+int
+ssup_datum_int64_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		a = DatumGetInt64(x);
+	int64		b = DatumGetInt64(y);
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
 /*
  * Insert a new tuple into an empty or existing heap, maintaining the
  * heap invariant.  Caller is responsible for ensuring there's room.
@@ -3427,6 +3826,117 @@ tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple)
 	memtuples[i] = *tuple;
 }
 
+/*
+ * Does merge tree leaf a beat leaf b, ie, must its tuple be output first?
+ * Exhausted leaves lose to everything.
+ */
+static inline bool
+mergetree_beats(Tuplesortstate *state, int a, int b)
+{
+	SortTuple  *memtuples = state->memtuples;
+
+	if (!state->mergeactive[memtuples[a].tupindex])
+		return false;
+	if (!state->mergeactive[memtuples[b].tupindex])
+		return true;
+	return COMPARETUP(state, &memtuples[a], &memtuples[b]) < 0;
+}
+
+/*
+ * Play the matches of the subtree rooted at node, recording the losers in
+ * mergetree[], and return the winning leaf.
+ */
+static int
+mergetree_play(Tuplesortstate *state, int node)
+{
+	int			left,
+				right;
+
+	if (node >= state->mergeleaves)
+		return node - state->mergeleaves;
+
+	left = mergetree_play(state, 2 * node);
+	right = mergetree_play(state, 2 * node + 1);
+	if (mergetree_beats(state, right, left))
+	{
+		state->mergetree[node] = left;
+		return right;
+	}
+	state->mergetree[node] = right;
+	return left;
+}
+
+/*
+ * Build the merge tree over the memtupcount tuples in memtuples[].
+ */
+static void
+tuplesort_mergetree_build(Tuplesortstate *state)
+{
+	state->mergeleaves = state->memtupcount;
+	if (state->mergeleaves == 0)
+		return;
+
+	/* With a single leaf, node 1 is that leaf */
+	state->mergetree[0] = mergetree_play(state, 1);
+}
+
+/*
+ * Replay the matches on the path from the winner's leaf to the root, after
+ * the leaf's tuple has changed.
+ */
+static void
+mergetree_replay(Tuplesortstate *state)
+{
+	int		   *tree = state->mergetree;
+	int			winner = tree[0];
+	int			node;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (node = (winner + state->mergeleaves) / 2; node > 0; node /= 2)
+	{
+		if (mergetree_beats(state, tree[node], winner))
+		{
+			int			loser = winner;
+
+			winner = tree[node];
+			tree[node] = loser;
+		}
+	}
+	tree[0] = winner;
+}
+
+/*
+ * Replace the winner of the merge tree with the next tuple from its input
+ * run, and find the new winner.
+ */
+static void
+tuplesort_mergetree_replace_top(Tuplesortstate *state, SortTuple *tuple)
+{
+	Assert(state->memtupcount >= 1);
+	Assert(tuple->tupindex == state->memtuples[state->mergetree[0]].tupindex);
+
+	state->memtuples[state->mergetree[0]] = *tuple;
+	mergetree_replay(state);
+}
+
+/*
+ * The input run of the winner of the merge tree is exhausted; find the new
+ * winner among the others.
+ *
+ * The caller has already free'd the tuple the winner points to, if
+ * necessary, and mergereadnext() has marked the run inactive.
+ */
+static void
+tuplesort_mergetree_delete_top(Tuplesortstate *state)
+{
+	Assert(!state->mergeactive[state->memtuples[state->mergetree[0]].tupindex]);
+
+	if (--state->memtupcount <= 0)
+		return;
+	mergetree_replay(state);
+}
+
 /*
  * Function to reverse the sort direction from its current state
  *
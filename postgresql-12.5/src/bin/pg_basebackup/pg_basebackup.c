@@ -93,6 +93,9 @@ static bool checksum_failure = false;
 static bool showprogress = false;
 static int	verbose = 0;
 static int	compresslevel = 0;
+static char *server_compression = NULL; /* method for server-side compression */
+static int	server_compression_level = -1;	/* -1 means server default */
+static const char *server_compression_suffix = "";
 static IncludeWal includewal = STREAM_WAL;
 static bool fastcheckpoint = false;
 static bool writerecoveryconf = false;
@@ -342,6 +345,8 @@ usage(void)
 			 "                         include required WAL files with specified method\n"));
 	printf(_("  -z, --gzip             compress tar output\n"));
 	printf(_("  -Z, --compress=0-9     compress tar output with given compression level\n"));
+	printf(_("      --server-compress=lz4|zstd[:LEVEL]\n"
+			 "                         have the server compress tar output\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
@@ -1011,7 +1016,8 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 			else
 #endif
 			{
-				snprintf(filename, sizeof(filename), "%s/base.tar", basedir);
+				snprintf(filename, sizeof(filename), "%s/base.tar%s", basedir,
+						 server_compression_suffix);
 				tarfile = fopen(filename, "wb");
 			}
 		}
@@ -1038,8 +1044,8 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		else
 #endif
 		{
-			snprintf(filename, sizeof(filename), "%s/%s.tar", basedir,
-					 PQgetvalue(res, rownum, 0));
+			snprintf(filename, sizeof(filename), "%s/%s.tar%s", basedir,
+					 PQgetvalue(res, rownum, 0), server_compression_suffix);
 			tarfile = fopen(filename, "wb");
 		}
 	}
@@ -1154,8 +1160,12 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 				}
 			}
 
-			/* 2 * 512 bytes empty data at end of file */
-			WRITE_TAR_DATA(zerobuf, sizeof(zerobuf));
+			/*
+			 * 2 * 512 bytes empty data at end of file.  A stream compressed
+			 * by the server already contains them.
+			 */
+			if (server_compression == NULL)
+				WRITE_TAR_DATA(zerobuf, sizeof(zerobuf));
 
 #ifdef HAVE_LIBZ
 			if (ztarfile != NULL)
@@ -1817,6 +1827,7 @@ BaseBackup(void)
 	char	   *basebkp;
 	char		escaped_label[MAXPGPATH];
 	char	   *maxrate_clause = NULL;
+	char	   *compression_clause = NULL;
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1878,6 +1889,17 @@ BaseBackup(void)
 	if (maxrate > 0)
 		maxrate_clause = psprintf("MAX_RATE %u", maxrate);
 
+	if (server_compression)
+	{
+		if (server_compression_level >= 0)
+			compression_clause = psprintf("COMPRESSION '%s' COMPRESSION_LEVEL %d",
+										  server_compression,
+										  server_compression_level);
+		else
+			compression_clause = psprintf("COMPRESSION '%s'",
+										  server_compression);
+	}
+
 	if (verbose)
 		pg_log_info("initiating base backup, waiting for checkpoint to complete");
 
@@ -1891,7 +1913,7 @@ BaseBackup(void)
 	}
 
 	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s",
+		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s",
 				 escaped_label,
 				 showprogress ? "PROGRESS" : "",
 				 includewal == FETCH_WAL ? "WAL" : "",
@@ -1899,7 +1921,8 @@ BaseBackup(void)
 				 includewal == NO_WAL ? "" : "NOWAIT",
 				 maxrate_clause ? maxrate_clause : "",
 				 format == 't' ? "TABLESPACE_MAP" : "",
-				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS");
+				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS",
+				 compression_clause ? compression_clause : "");
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
@@ -2214,6 +2237,7 @@ main(int argc, char **argv)
 		{"waldir", required_argument, NULL, 1},
 		{"no-slot", no_argument, NULL, 2},
 		{"no-verify-checksums", no_argument, NULL, 3},
+		{"server-compress", required_argument, NULL, 4},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2382,6 +2406,38 @@ main(int argc, char **argv)
 			case 3:
 				verify_checksums = false;
 				break;
+			case 4:
+				{
+					char	   *sep;
+
+					server_compression = pg_strdup(optarg);
+					sep = strchr(server_compression, ':');
+					if (sep != NULL)
+					{
+						char	   *endptr;
+
+						*sep = '\0';
+						server_compression_level = strtol(sep + 1, &endptr, 10);
+						if (sep[1] == '\0' || *endptr != '\0' ||
+							server_compression_level < 0)
+						{
+							pg_log_error("invalid compression level \"%s\"",
+										 sep + 1);
+							exit(1);
+						}
+					}
+					if (strcmp(server_compression, "lz4") == 0)
+						server_compression_suffix = ".lz4";
+					else if (strcmp(server_compression, "zstd") == 0)
+						server_compression_suffix = ".zst";
+					else
+					{
+						pg_log_error("invalid compression method \"%s\", must be \"lz4\" or \"zstd\"",
+									 server_compression);
+						exit(1);
+					}
+				}
+				break;
 			default:
 
 				/*
@@ -2427,6 +2483,30 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (server_compression && format != 't')
+	{
+		pg_log_error("only tar mode backups can be compressed");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (server_compression && compresslevel != 0)
+	{
+		pg_log_error("cannot use both client-side and server-side compression");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (server_compression && writerecoveryconf)
+	{
+		pg_log_error("cannot write recovery configuration into a backup compressed by the server");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
 	if (format == 't' && includewal == STREAM_WAL && strcmp(basedir, "-") == 0)
 	{
 		pg_log_error("cannot stream write-ahead logs in tar mode to stdout");
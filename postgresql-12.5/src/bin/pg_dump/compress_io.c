@@ -11,9 +11,10 @@
  * provides more flexibility, using callbacks to read/write data from the
  * underlying stream. The second API is a wrapper around fopen/gzopen and
  * friends, providing an interface similar to those, but abstracts away
- * the possible compression. Both APIs use libz for the compression, but
- * the second API uses gzip headers, so the resulting files can be easily
- * manipulated with the gzip utility.
+ * the possible compression. Both APIs support libz, lz4 and zstd
+ * compression. The second API writes gzip, lz4 frame or zstd frame files,
+ * so the resulting files can be easily manipulated with the gzip, lz4 or
+ * zstd utilities.
  *
  * Compressor API
  * --------------
@@ -41,10 +42,11 @@
  *	libz's gzopen() APIs. It allows you to use the same functions for
  *	compressed and uncompressed streams. cfopen_read() first tries to open
  *	the file with given name, and if it fails, it tries to open the same
- *	file with the .gz suffix. cfopen_write() opens a file for writing, an
- *	extra argument specifies if the file should be compressed, and adds the
- *	.gz suffix to the filename if so. This allows you to easily handle both
- *	compressed and uncompressed files.
+ *	file with the .gz, .lz4 or .zst suffix. cfopen_write() opens a file for
+ *	writing, extra arguments specify if and how the file should be
+ *	compressed, and the matching suffix is added to the filename if so.
+ *	This allows you to easily handle both compressed and uncompressed files.
+ *	lz4 and zstd streams are implemented here on top of stdio.
  *
  * IDENTIFICATION
  *	   src/bin/pg_dump/compress_io.c
@@ -53,6 +55,13 @@
  */
 #include "postgres_fe.h"
 
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "compress_io.h"
 #include "pg_backup_utils.h"
 
@@ -72,10 +81,22 @@ struct CompressorState
 	char	   *zlibOut;
 	size_t		zlibOutSize;
 #endif
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4ctx;
+	LZ4F_preferences_t lz4prefs;
+	bool		lz4begun;		/* frame header written yet? */
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstdctx;
+#endif
+	/* output buffer for lz4 and zstd */
+	char	   *streamOut;
+	size_t		streamOutSize;
 };
 
 static void ParseCompressionOption(int compression, CompressionAlgorithm *alg,
 								   int *level);
+static void CheckCompressionAlgorithm(CompressionAlgorithm alg);
 
 /* Routines that support zlib compressed data I/O */
 #ifdef HAVE_LIBZ
@@ -88,6 +109,26 @@ static void WriteDataToArchiveZlib(ArchiveHandle *AH, CompressorState *cs,
 static void EndCompressorZlib(ArchiveHandle *AH, CompressorState *cs);
 #endif
 
+/* Routines that support lz4 compressed data I/O */
+#ifdef USE_LZ4
+static void InitCompressorLZ4(CompressorState *cs, int level);
+static void BeginCompressorLZ4(ArchiveHandle *AH, CompressorState *cs);
+static void ReadDataFromArchiveLZ4(ArchiveHandle *AH, ReadFunc readF);
+static void WriteDataToArchiveLZ4(ArchiveHandle *AH, CompressorState *cs,
+								  const char *data, size_t dLen);
+static void EndCompressorLZ4(ArchiveHandle *AH, CompressorState *cs);
+#endif
+
+/* Routines that support zstd compressed data I/O */
+#ifdef USE_ZSTD
+static ZSTD_CCtx *CreateCompressorZstd(int level, int workers);
+static void InitCompressorZstd(CompressorState *cs, int level, int workers);
+static void ReadDataFromArchiveZstd(ArchiveHandle *AH, ReadFunc readF);
+static void WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+								   const char *data, size_t dLen);
+static void EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs);
+#endif
+
 /* Routines that support uncompressed data I/O */
 static void ReadDataFromArchiveNone(ArchiveHandle *AH, ReadFunc readF);
 static void WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
@@ -117,22 +158,45 @@ ParseCompressionOption(int compression, CompressionAlgorithm *alg, int *level)
 		*level = compression;
 }
 
+/*
+ * Complain if support for the given algorithm wasn't compiled in.
+ */
+static void
+CheckCompressionAlgorithm(CompressionAlgorithm alg)
+{
+#ifndef HAVE_LIBZ
+	if (alg == COMPR_ALG_LIBZ)
+		fatal("not built with zlib support");
+#endif
+#ifndef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+		fatal("not built with LZ4 support");
+#endif
+#ifndef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+		fatal("not built with Zstandard support");
+#endif
+}
+
 /* Public interface routines */
 
-/* Allocate a new compressor */
+/*
+ * Allocate a new compressor.  For zlib, 'compression' is interpreted as by
+ * ParseCompressionOption; for lz4 and zstd it is the compression level, -1
+ * meaning the library default.  'workers' is the number of zstd worker
+ * threads, or 0 to compress in the calling thread.
+ */
 CompressorState *
-AllocateCompressor(int compression, WriteFunc writeF)
+AllocateCompressor(CompressionAlgorithm alg, int compression, int workers,
+				   WriteFunc writeF)
 {
 	CompressorState *cs;
-	CompressionAlgorithm alg;
-	int			level;
+	int			level = compression;
 
-	ParseCompressionOption(compression, &alg, &level);
+	if (alg == COMPR_ALG_NONE || alg == COMPR_ALG_LIBZ)
+		ParseCompressionOption(compression, &alg, &level);
 
-#ifndef HAVE_LIBZ
-	if (alg == COMPR_ALG_LIBZ)
-		fatal("not built with zlib support");
-#endif
+	CheckCompressionAlgorithm(alg);
 
 	cs = (CompressorState *) pg_malloc0(sizeof(CompressorState));
 	cs->writeF = writeF;
@@ -145,6 +209,14 @@ AllocateCompressor(int compression, WriteFunc writeF)
 	if (alg == COMPR_ALG_LIBZ)
 		InitCompressorZlib(cs, level);
 #endif
+#ifdef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+		InitCompressorLZ4(cs, level);
+#endif
+#ifdef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+		InitCompressorZstd(cs, level, workers);
+#endif
 
 	return cs;
 }
@@ -154,21 +226,34 @@ AllocateCompressor(int compression, WriteFunc writeF)
  * out with ahwrite().
  */
 void
-ReadDataFromArchive(ArchiveHandle *AH, int compression, ReadFunc readF)
+ReadDataFromArchive(ArchiveHandle *AH, CompressionAlgorithm alg,
+					int compression, ReadFunc readF)
 {
-	CompressionAlgorithm alg;
+	if (alg == COMPR_ALG_NONE || alg == COMPR_ALG_LIBZ)
+		ParseCompressionOption(compression, &alg, NULL);
 
-	ParseCompressionOption(compression, &alg, NULL);
+	CheckCompressionAlgorithm(alg);
 
-	if (alg == COMPR_ALG_NONE)
-		ReadDataFromArchiveNone(AH, readF);
-	if (alg == COMPR_ALG_LIBZ)
+	switch (alg)
 	{
+		case COMPR_ALG_NONE:
+			ReadDataFromArchiveNone(AH, readF);
+			break;
+		case COMPR_ALG_LIBZ:
 #ifdef HAVE_LIBZ
-		ReadDataFromArchiveZlib(AH, readF);
-#else
-		fatal("not built with zlib support");
+			ReadDataFromArchiveZlib(AH, readF);
+#endif
+			break;
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			ReadDataFromArchiveLZ4(AH, readF);
+#endif
+			break;
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			ReadDataFromArchiveZstd(AH, readF);
 #endif
+			break;
 	}
 }
 
@@ -186,6 +271,16 @@ WriteDataToArchive(ArchiveHandle *AH, CompressorState *cs,
 			WriteDataToArchiveZlib(AH, cs, data, dLen);
 #else
 			fatal("not built with zlib support");
+#endif
+			break;
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			WriteDataToArchiveLZ4(AH, cs, data, dLen);
+#endif
+			break;
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			WriteDataToArchiveZstd(AH, cs, data, dLen);
 #endif
 			break;
 		case COMPR_ALG_NONE:
@@ -204,6 +299,14 @@ EndCompressor(ArchiveHandle *AH, CompressorState *cs)
 #ifdef HAVE_LIBZ
 	if (cs->comprAlg == COMPR_ALG_LIBZ)
 		EndCompressorZlib(AH, cs);
+#endif
+#ifdef USE_LZ4
+	if (cs->comprAlg == COMPR_ALG_LZ4)
+		EndCompressorLZ4(AH, cs);
+#endif
+#ifdef USE_ZSTD
+	if (cs->comprAlg == COMPR_ALG_ZSTD)
+		EndCompressorZstd(AH, cs);
 #endif
 	free(cs);
 }
@@ -380,6 +483,293 @@ ReadDataFromArchiveZlib(ArchiveHandle *AH, ReadFunc readF)
 #endif							/* HAVE_LIBZ */
 
 
+#ifdef USE_LZ4
+/*
+ * Functions for lz4 compressed output, using the lz4 frame format.
+ */
+
+static void
+InitCompressorLZ4(CompressorState *cs, int level)
+{
+	size_t		status;
+
+	memset(&cs->lz4prefs, 0, sizeof(LZ4F_preferences_t));
+	cs->lz4prefs.compressionLevel = (level < 0) ? 0 : level;
+
+	status = LZ4F_createCompressionContext(&cs->lz4ctx, LZ4F_VERSION);
+	if (LZ4F_isError(status))
+		fatal("could not initialize compression library: %s",
+			  LZ4F_getErrorName(status));
+
+	/*
+	 * The buffer must be able to hold the output of compressing
+	 * STREAM_IN_SIZE bytes, which is always more than the frame header.
+	 */
+	cs->streamOutSize = LZ4F_compressBound(STREAM_IN_SIZE, &cs->lz4prefs);
+	cs->streamOut = pg_malloc(cs->streamOutSize);
+	cs->lz4begun = false;
+}
+
+/*
+ * Emit the lz4 frame header, if we haven't yet.  This can't be done in
+ * InitCompressorLZ4, since the write callback needs the ArchiveHandle.
+ */
+static void
+BeginCompressorLZ4(ArchiveHandle *AH, CompressorState *cs)
+{
+	size_t		status;
+
+	if (cs->lz4begun)
+		return;
+
+	status = LZ4F_compressBegin(cs->lz4ctx, cs->streamOut, cs->streamOutSize,
+								&cs->lz4prefs);
+	if (LZ4F_isError(status))
+		fatal("could not compress data: %s", LZ4F_getErrorName(status));
+	cs->writeF(AH, cs->streamOut, status);
+	cs->lz4begun = true;
+}
+
+static void
+WriteDataToArchiveLZ4(ArchiveHandle *AH, CompressorState *cs,
+					  const char *data, size_t dLen)
+{
+	BeginCompressorLZ4(AH, cs);
+
+	while (dLen > 0)
+	{
+		size_t		chunk = Min(dLen, STREAM_IN_SIZE);
+		size_t		status;
+
+		status = LZ4F_compressUpdate(cs->lz4ctx,
+									 cs->streamOut, cs->streamOutSize,
+									 data, chunk, NULL);
+		if (LZ4F_isError(status))
+			fatal("could not compress data: %s", LZ4F_getErrorName(status));
+		if (status > 0)
+			cs->writeF(AH, cs->streamOut, status);
+
+		data += chunk;
+		dLen -= chunk;
+	}
+}
+
+static void
+EndCompressorLZ4(ArchiveHandle *AH, CompressorState *cs)
+{
+	size_t		status;
+
+	BeginCompressorLZ4(AH, cs);
+
+	status = LZ4F_compressEnd(cs->lz4ctx, cs->streamOut, cs->streamOutSize,
+							  NULL);
+	if (LZ4F_isError(status))
+		fatal("could not compress data: %s", LZ4F_getErrorName(status));
+	if (status > 0)
+		cs->writeF(AH, cs->streamOut, status);
+
+	LZ4F_freeCompressionContext(cs->lz4ctx);
+	free(cs->streamOut);
+}
+
+static void
+ReadDataFromArchiveLZ4(ArchiveHandle *AH, ReadFunc readF)
+{
+	LZ4F_dctx  *dctx;
+	size_t		status;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+	char	   *out;
+	size_t		outlen;
+
+	status = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+	if (LZ4F_isError(status))
+		fatal("could not initialize compression library: %s",
+			  LZ4F_getErrorName(status));
+
+	buf = pg_malloc(STREAM_IN_SIZE);
+	buflen = STREAM_IN_SIZE;
+
+	out = pg_malloc(STREAM_IN_SIZE + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		const char *next = buf;
+
+		/*
+		 * Keep going until all input has been consumed and the last call
+		 * didn't fill the output buffer, so nothing is left pending.
+		 */
+		do
+		{
+			size_t		inlen = cnt;
+
+			outlen = STREAM_IN_SIZE;
+			status = LZ4F_decompress(dctx, out, &outlen, next, &inlen, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not uncompress data: %s",
+					  LZ4F_getErrorName(status));
+
+			next += inlen;
+			cnt -= inlen;
+
+			out[outlen] = '\0';
+			ahwrite(out, 1, outlen, AH);
+		} while (cnt > 0 || outlen == STREAM_IN_SIZE);
+	}
+
+	if (status != 0)
+		fatal("could not uncompress data: incomplete lz4 frame");
+
+	LZ4F_freeDecompressionContext(dctx);
+
+	free(buf);
+	free(out);
+}
+#endif							/* USE_LZ4 */
+
+
+#ifdef USE_ZSTD
+/*
+ * Functions for zstd compressed output.
+ */
+
+/*
+ * Create a zstd compression context.  A negative level selects the library
+ * default; if 'workers' is more than zero, the library compresses in that
+ * many background threads.
+ */
+static ZSTD_CCtx *
+CreateCompressorZstd(int level, int workers)
+{
+	ZSTD_CCtx  *cctx;
+	size_t		status;
+
+	cctx = ZSTD_createCCtx();
+	if (cctx == NULL)
+		fatal("could not initialize compression library: out of memory");
+
+	status = ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+									(level < 0) ? ZSTD_CLEVEL_DEFAULT : level);
+	if (ZSTD_isError(status))
+		fatal("could not set compression level %d: %s",
+			  level, ZSTD_getErrorName(status));
+
+	if (workers > 0)
+	{
+		status = ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers);
+		if (ZSTD_isError(status))
+			fatal("could not set compression worker count to %d: %s",
+				  workers, ZSTD_getErrorName(status));
+	}
+
+	return cctx;
+}
+
+static void
+InitCompressorZstd(CompressorState *cs, int level, int workers)
+{
+	cs->zstdctx = CreateCompressorZstd(level, workers);
+	cs->streamOutSize = ZSTD_CStreamOutSize();
+	cs->streamOut = pg_malloc(cs->streamOutSize);
+}
+
+static void
+WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+					   const char *data, size_t dLen)
+{
+	ZSTD_inBuffer in = {data, dLen, 0};
+
+	while (in.pos < in.size)
+	{
+		ZSTD_outBuffer out = {cs->streamOut, cs->streamOutSize, 0};
+		size_t		status;
+
+		status = ZSTD_compressStream2(cs->zstdctx, &out, &in, ZSTD_e_continue);
+		if (ZSTD_isError(status))
+			fatal("could not compress data: %s", ZSTD_getErrorName(status));
+		if (out.pos > 0)
+			cs->writeF(AH, cs->streamOut, out.pos);
+	}
+}
+
+static void
+EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs)
+{
+	ZSTD_inBuffer in = {NULL, 0, 0};
+	size_t		status;
+
+	/* ZSTD_e_end returns the number of bytes still to be flushed */
+	do
+	{
+		ZSTD_outBuffer out = {cs->streamOut, cs->streamOutSize, 0};
+
+		status = ZSTD_compressStream2(cs->zstdctx, &out, &in, ZSTD_e_end);
+		if (ZSTD_isError(status))
+			fatal("could not compress data: %s", ZSTD_getErrorName(status));
+		if (out.pos > 0)
+			cs->writeF(AH, cs->streamOut, out.pos);
+	} while (status != 0);
+
+	ZSTD_freeCCtx(cs->zstdctx);
+	free(cs->streamOut);
+}
+
+static void
+ReadDataFromArchiveZstd(ArchiveHandle *AH, ReadFunc readF)
+{
+	ZSTD_DCtx  *dctx;
+	size_t		status = 0;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+	char	   *out;
+	size_t		outsize;
+
+	dctx = ZSTD_createDCtx();
+	if (dctx == NULL)
+		fatal("could not initialize compression library: out of memory");
+
+	buf = pg_malloc(STREAM_IN_SIZE);
+	buflen = STREAM_IN_SIZE;
+
+	outsize = ZSTD_DStreamOutSize();
+	out = pg_malloc(outsize + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		ZSTD_inBuffer in = {buf, cnt, 0};
+		ZSTD_outBuffer outbuf;
+
+		/* as for lz4, drain any output still held back by a full buffer */
+		do
+		{
+			outbuf.dst = out;
+			outbuf.size = outsize;
+			outbuf.pos = 0;
+
+			status = ZSTD_decompressStream(dctx, &outbuf, &in);
+			if (ZSTD_isError(status))
+				fatal("could not uncompress data: %s",
+					  ZSTD_getErrorName(status));
+
+			out[outbuf.pos] = '\0';
+			ahwrite(out, 1, outbuf.pos, AH);
+		} while (in.pos < in.size || outbuf.pos == outsize);
+	}
+
+	if (status != 0)
+		fatal("could not uncompress data: incomplete zstd frame");
+
+	ZSTD_freeDCtx(dctx);
+
+	free(buf);
+	free(out);
+}
+#endif							/* USE_ZSTD */
+
+
 /*
  * Functions for uncompressed output.
  */
@@ -419,18 +809,47 @@ WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
 /*
  * cfp represents an open stream, wrapping the underlying FILE or gzFile
  * pointer. This is opaque to the callers.
+ *
+ * lz4 and zstd streams are implemented here on top of a plain FILE: when
+ * writing, data is compressed into 'outbuf' and then written to
+ * uncompressedfp; when reading, raw data is read into 'inbuf' and
+ * decompressed into 'outbuf', from which the caller's reads are satisfied.
  */
 struct cfp
 {
 	FILE	   *uncompressedfp;
 #ifdef HAVE_LIBZ
 	gzFile		compressedfp;
+#endif
+	CompressionAlgorithm alg;	/* COMPR_ALG_LZ4 or _ZSTD if streaming */
+	bool		writing;		/* opened for writing? */
+	bool		rawEOF;			/* reached end of the underlying file? */
+	bool		eof;			/* returned all decompressed data? */
+	char	   *inbuf;			/* raw input, when reading */
+	size_t		inlen;			/* valid bytes in inbuf */
+	size_t		inpos;			/* next unconsumed byte in inbuf */
+	char	   *outbuf;			/* compressed output, or decompressed input */
+	size_t		outsize;		/* allocated size of outbuf */
+	size_t		outlen;			/* valid bytes in outbuf, when reading */
+	size_t		outpos;			/* next unread byte in outbuf, when reading */
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4cctx;
+	LZ4F_dctx  *lz4dctx;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstdcctx;
+	ZSTD_DCtx  *zstddctx;
 #endif
 };
 
-#ifdef HAVE_LIBZ
 static int	hasSuffix(const char *filename, const char *suffix);
+static void cfopen_stream(cfp *fp, CompressionAlgorithm alg, int compression,
+						  int workers);
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static bool cfstream_write(cfp *fp, size_t len);
 #endif
+static bool cfstream_fill(cfp *fp);
+static int	cfstream_close(cfp *fp);
 
 /* free() without changing errno; useful in several places below */
 static void
@@ -446,9 +865,10 @@ free_keep_errno(void *p)
  * Open a file for reading. 'path' is the file to open, and 'mode' should
  * be either "r" or "rb".
  *
- * If the file at 'path' does not exist, we append the ".gz" suffix (if 'path'
- * doesn't already have it) and try again. So if you pass "foo" as 'path',
- * this will open either "foo" or "foo.gz".
+ * If 'path' ends in ".gz", ".lz4" or ".zst", the file is decompressed
+ * accordingly.  Otherwise, if the file at 'path' does not exist, we append
+ * each of those suffixes in turn and try again. So if you pass "foo" as
+ * 'path', this will open "foo", "foo.gz", "foo.lz4" or "foo.zst".
  *
  * On failure, return NULL with an error code in errno.
  */
@@ -457,23 +877,41 @@ cfopen_read(const char *path, const char *mode)
 {
 	cfp		   *fp;
 
-#ifdef HAVE_LIBZ
 	if (hasSuffix(path, ".gz"))
-		fp = cfopen(path, mode, 1);
+		fp = cfopen(path, mode, COMPR_ALG_LIBZ, 1, 0);
+	else if (hasSuffix(path, ".lz4"))
+		fp = cfopen(path, mode, COMPR_ALG_LZ4, 0, 0);
+	else if (hasSuffix(path, ".zst"))
+		fp = cfopen(path, mode, COMPR_ALG_ZSTD, 0, 0);
 	else
-#endif
 	{
-		fp = cfopen(path, mode, 0);
+		fp = cfopen(path, mode, COMPR_ALG_NONE, 0, 0);
 #ifdef HAVE_LIBZ
 		if (fp == NULL)
 		{
 			char	   *fname;
 
 			fname = psprintf("%s.gz", path);
-			fp = cfopen(fname, mode, 1);
+			fp = cfopen(fname, mode, COMPR_ALG_LIBZ, 1, 0);
 			free_keep_errno(fname);
 		}
 #endif
+		if (fp == NULL)
+		{
+			char	   *fname;
+
+			fname = psprintf("%s.lz4", path);
+			fp = cfopen(fname, mode, COMPR_ALG_LZ4, 0, 0);
+			free_keep_errno(fname);
+		}
+		if (fp == NULL)
+		{
+			char	   *fname;
+
+			fname = psprintf("%s.zst", path);
+			fp = cfopen(fname, mode, COMPR_ALG_ZSTD, 0, 0);
+			free_keep_errno(fname);
+		}
 	}
 	return fp;
 }
@@ -483,47 +921,58 @@ cfopen_read(const char *path, const char *mode)
  * be a filemode as accepted by fopen() and gzopen() that indicates writing
  * ("w", "wb", "a", or "ab").
  *
- * If 'compression' is non-zero, a gzip compressed stream is opened, and
- * 'compression' indicates the compression level used. The ".gz" suffix
- * is automatically added to 'path' in that case.
+ * If 'alg' is not COMPR_ALG_NONE, a compressed stream is opened, and
+ * 'compression' indicates the compression level used.  The ".gz", ".lz4" or
+ * ".zst" suffix is automatically added to 'path' in that case.  'workers' is
+ * the number of zstd compression threads, or 0 to compress in this thread.
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
-cfopen_write(const char *path, const char *mode, int compression)
+cfopen_write(const char *path, const char *mode, CompressionAlgorithm alg,
+			 int compression, int workers)
 {
 	cfp		   *fp;
+	const char *suffix;
+	char	   *fname;
 
-	if (compression == 0)
-		fp = cfopen(path, mode, 0);
-	else
+	switch (alg)
 	{
-#ifdef HAVE_LIBZ
-		char	   *fname;
-
-		fname = psprintf("%s.gz", path);
-		fp = cfopen(fname, mode, compression);
-		free_keep_errno(fname);
-#else
-		fatal("not built with zlib support");
-		fp = NULL;				/* keep compiler quiet */
-#endif
+		case COMPR_ALG_LIBZ:
+			suffix = ".gz";
+			break;
+		case COMPR_ALG_LZ4:
+			suffix = ".lz4";
+			break;
+		case COMPR_ALG_ZSTD:
+			suffix = ".zst";
+			break;
+		case COMPR_ALG_NONE:
+		default:
+			return cfopen(path, mode, COMPR_ALG_NONE, 0, 0);
 	}
+
+	fname = psprintf("%s%s", path, suffix);
+	fp = cfopen(fname, mode, alg, compression, workers);
+	free_keep_errno(fname);
+
 	return fp;
 }
 
 /*
- * Opens file 'path' in 'mode'. If 'compression' is non-zero, the file
- * is opened with libz gzopen(), otherwise with plain fopen().
+ * Opens file 'path' in 'mode'. If 'alg' is COMPR_ALG_LIBZ, the file is
+ * opened with libz gzopen(); otherwise it is opened with plain fopen(), and
+ * for lz4 and zstd the stream is (de)compressed as it is read or written.
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
-cfopen(const char *path, const char *mode, int compression)
+cfopen(const char *path, const char *mode, CompressionAlgorithm alg,
+	   int compression, int workers)
 {
-	cfp		   *fp = pg_malloc(sizeof(cfp));
+	cfp		   *fp = pg_malloc0(sizeof(cfp));
 
-	if (compression != 0)
+	if (alg == COMPR_ALG_LIBZ)
 	{
 #ifdef HAVE_LIBZ
 		if (compression != Z_DEFAULT_COMPRESSION)
@@ -553,20 +1002,260 @@ cfopen(const char *path, const char *mode, int compression)
 	}
 	else
 	{
-#ifdef HAVE_LIBZ
-		fp->compressedfp = NULL;
-#endif
 		fp->uncompressedfp = fopen(path, mode);
 		if (fp->uncompressedfp == NULL)
 		{
 			free_keep_errno(fp);
 			fp = NULL;
 		}
+		else if (alg != COMPR_ALG_NONE)
+		{
+			fp->writing = (mode[0] == 'w' || mode[0] == 'a');
+			cfopen_stream(fp, alg, compression, workers);
+		}
 	}
 
 	return fp;
 }
 
+/*
+ * Set up lz4 or zstd (de)compression for a freshly opened file.  When
+ * writing an lz4 stream, the frame header is written out right away.
+ */
+static void
+cfopen_stream(cfp *fp, CompressionAlgorithm alg, int compression, int workers)
+{
+	fp->alg = alg;
+
+	if (alg == COMPR_ALG_LZ4)
+	{
+#ifdef USE_LZ4
+		LZ4F_preferences_t prefs;
+		size_t		status;
+
+		memset(&prefs, 0, sizeof(prefs));
+		prefs.compressionLevel = (compression < 0) ? 0 : compression;
+
+		if (fp->writing)
+		{
+			status = LZ4F_createCompressionContext(&fp->lz4cctx, LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				fatal("could not initialize compression library: %s",
+					  LZ4F_getErrorName(status));
+
+			/* always larger than the frame header */
+			fp->outsize = LZ4F_compressBound(STREAM_IN_SIZE, &prefs);
+			fp->outbuf = pg_malloc(fp->outsize);
+
+			status = LZ4F_compressBegin(fp->lz4cctx, fp->outbuf, fp->outsize,
+										&prefs);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+			if (!cfstream_write(fp, status))
+				fatal("could not write to output file: %s", strerror(errno));
+		}
+		else
+		{
+			status = LZ4F_createDecompressionContext(&fp->lz4dctx,
+													 LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				fatal("could not initialize compression library: %s",
+					  LZ4F_getErrorName(status));
+
+			fp->outsize = STREAM_IN_SIZE;
+			fp->outbuf = pg_malloc(fp->outsize);
+			fp->inbuf = pg_malloc(STREAM_IN_SIZE);
+		}
+#else
+		fatal("not built with LZ4 support");
+#endif
+	}
+	else if (alg == COMPR_ALG_ZSTD)
+	{
+#ifdef USE_ZSTD
+		if (fp->writing)
+		{
+			fp->zstdcctx = CreateCompressorZstd(compression, workers);
+			fp->outsize = ZSTD_CStreamOutSize();
+			fp->outbuf = pg_malloc(fp->outsize);
+		}
+		else
+		{
+			fp->zstddctx = ZSTD_createDCtx();
+			if (fp->zstddctx == NULL)
+				fatal("could not initialize compression library: out of memory");
+
+			fp->outsize = ZSTD_DStreamOutSize();
+			fp->outbuf = pg_malloc(fp->outsize);
+			fp->inbuf = pg_malloc(ZSTD_DStreamInSize());
+		}
+#else
+		fatal("not built with Zstandard support");
+#endif
+	}
+}
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Write the first 'len' bytes of fp->outbuf to the underlying file.
+ * Returns false, with errno set, on failure.
+ */
+static bool
+cfstream_write(cfp *fp, size_t len)
+{
+	errno = 0;
+	if (len > 0 && fwrite(fp->outbuf, 1, len, fp->uncompressedfp) != len)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		return false;
+	}
+	return true;
+}
+#endif
+
+/*
+ * Refill fp->outbuf with decompressed data.  Returns false once the end of
+ * the stream has been reached and no more data is forthcoming.
+ */
+static bool
+cfstream_fill(cfp *fp)
+{
+	fp->outpos = fp->outlen = 0;
+
+	for (;;)
+	{
+		if (fp->inpos == fp->inlen && !fp->rawEOF)
+		{
+			size_t		insize = STREAM_IN_SIZE;
+
+#ifdef USE_ZSTD
+			if (fp->alg == COMPR_ALG_ZSTD)
+				insize = ZSTD_DStreamInSize();
+#endif
+			fp->inlen = fread(fp->inbuf, 1, insize, fp->uncompressedfp);
+			fp->inpos = 0;
+			if (fp->inlen == 0)
+			{
+				if (ferror(fp->uncompressedfp))
+					READ_ERROR_EXIT(fp->uncompressedfp);
+				fp->rawEOF = true;
+			}
+		}
+
+		/* even without new input, the library may have output pending */
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			size_t		inlen = fp->inlen - fp->inpos;
+			size_t		outlen = fp->outsize;
+			size_t		status;
+
+			status = LZ4F_decompress(fp->lz4dctx, fp->outbuf, &outlen,
+									 fp->inbuf + fp->inpos, &inlen, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not uncompress data: %s",
+					  LZ4F_getErrorName(status));
+			fp->inpos += inlen;
+			fp->outlen = outlen;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			ZSTD_inBuffer in = {fp->inbuf, fp->inlen, fp->inpos};
+			ZSTD_outBuffer out = {fp->outbuf, fp->outsize, 0};
+			size_t		status;
+
+			status = ZSTD_decompressStream(fp->zstddctx, &out, &in);
+			if (ZSTD_isError(status))
+				fatal("could not uncompress data: %s",
+					  ZSTD_getErrorName(status));
+			fp->inpos = in.pos;
+			fp->outlen = out.pos;
+		}
+#endif
+
+		if (fp->outlen > 0)
+			return true;
+		if (fp->rawEOF)
+		{
+			fp->eof = true;
+			return false;
+		}
+	}
+}
+
+/*
+ * Finish writing an lz4 or zstd stream, and release its resources.
+ */
+static int
+cfstream_close(cfp *fp)
+{
+	int			result = 0;
+
+	if (fp->writing)
+	{
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			size_t		status;
+
+			status = LZ4F_compressEnd(fp->lz4cctx, fp->outbuf, fp->outsize,
+									  NULL);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+			if (!cfstream_write(fp, status))
+				result = EOF;
+			LZ4F_freeCompressionContext(fp->lz4cctx);
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			ZSTD_inBuffer in = {NULL, 0, 0};
+			size_t		status;
+
+			do
+			{
+				ZSTD_outBuffer out = {fp->outbuf, fp->outsize, 0};
+
+				status = ZSTD_compressStream2(fp->zstdcctx, &out, &in,
+											  ZSTD_e_end);
+				if (ZSTD_isError(status))
+					fatal("could not compress data: %s",
+						  ZSTD_getErrorName(status));
+				if (!cfstream_write(fp, out.pos))
+				{
+					result = EOF;
+					break;
+				}
+			} while (status != 0);
+			ZSTD_freeCCtx(fp->zstdcctx);
+		}
+#endif
+	}
+	else
+	{
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+			LZ4F_freeDecompressionContext(fp->lz4dctx);
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+			ZSTD_freeDCtx(fp->zstddctx);
+#endif
+	}
+
+	free(fp->inbuf);
+	free(fp->outbuf);
+
+	return result;
+}
+
 
 int
 cfread(void *ptr, int size, cfp *fp)
@@ -591,6 +1280,22 @@ cfread(void *ptr, int size, cfp *fp)
 	}
 	else
 #endif
+	if (fp->alg != COMPR_ALG_NONE)
+	{
+		ret = 0;
+		while (ret < size)
+		{
+			size_t		chunk;
+
+			if (fp->outpos == fp->outlen && !cfstream_fill(fp))
+				break;
+			chunk = Min(size - ret, fp->outlen - fp->outpos);
+			memcpy((char *) ptr + ret, fp->outbuf + fp->outpos, chunk);
+			fp->outpos += chunk;
+			ret += chunk;
+		}
+	}
+	else
 	{
 		ret = fread(ptr, 1, size, fp->uncompressedfp);
 		if (ret != size && !feof(fp->uncompressedfp))
@@ -602,6 +1307,51 @@ cfread(void *ptr, int size, cfp *fp)
 int
 cfwrite(const void *ptr, int size, cfp *fp)
 {
+#ifdef USE_LZ4
+	if (fp->alg == COMPR_ALG_LZ4)
+	{
+		const char *data = ptr;
+		int			left = size;
+
+		while (left > 0)
+		{
+			size_t		chunk = Min(left, STREAM_IN_SIZE);
+			size_t		status;
+
+			status = LZ4F_compressUpdate(fp->lz4cctx, fp->outbuf, fp->outsize,
+										 data, chunk, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+			if (!cfstream_write(fp, status))
+				return 0;
+			data += chunk;
+			left -= chunk;
+		}
+		return size;
+	}
+#endif
+#ifdef USE_ZSTD
+	if (fp->alg == COMPR_ALG_ZSTD)
+	{
+		ZSTD_inBuffer in = {ptr, size, 0};
+
+		while (in.pos < in.size)
+		{
+			ZSTD_outBuffer out = {fp->outbuf, fp->outsize, 0};
+			size_t		status;
+
+			status = ZSTD_compressStream2(fp->zstdcctx, &out, &in,
+										  ZSTD_e_continue);
+			if (ZSTD_isError(status))
+				fatal("could not compress data: %s",
+					  ZSTD_getErrorName(status));
+			if (!cfstream_write(fp, out.pos))
+				return 0;
+		}
+		return size;
+	}
+#endif
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 		return gzwrite(fp->compressedfp, ptr, size);
@@ -629,6 +1379,13 @@ cfgetc(cfp *fp)
 	}
 	else
 #endif
+	if (fp->alg != COMPR_ALG_NONE)
+	{
+		if (fp->outpos == fp->outlen && !cfstream_fill(fp))
+			fatal("could not read from input file: end of file");
+		ret = (unsigned char) fp->outbuf[fp->outpos++];
+	}
+	else
 	{
 		ret = fgetc(fp->uncompressedfp);
 		if (ret == EOF)
@@ -646,6 +1403,25 @@ cfgets(cfp *fp, char *buf, int len)
 		return gzgets(fp->compressedfp, buf, len);
 	else
 #endif
+	if (fp->alg != COMPR_ALG_NONE)
+	{
+		int			i = 0;
+
+		/* like fgets(), stop after a newline or when the buffer is full */
+		while (i < len - 1)
+		{
+			if (fp->outpos == fp->outlen && !cfstream_fill(fp))
+				break;
+			buf[i] = fp->outbuf[fp->outpos++];
+			if (buf[i++] == '\n')
+				break;
+		}
+		if (i == 0)
+			return NULL;
+		buf[i] = '\0';
+		return buf;
+	}
+	else
 		return fgets(buf, len, fp->uncompressedfp);
 }
 
@@ -668,7 +1444,11 @@ cfclose(cfp *fp)
 	else
 #endif
 	{
-		result = fclose(fp->uncompressedfp);
+		result = 0;
+		if (fp->alg != COMPR_ALG_NONE)
+			result = cfstream_close(fp);
+		if (fclose(fp->uncompressedfp) != 0)
+			result = EOF;
 		fp->uncompressedfp = NULL;
 	}
 	free_keep_errno(fp);
@@ -684,6 +1464,9 @@ cfeof(cfp *fp)
 		return gzeof(fp->compressedfp);
 	else
 #endif
+	if (fp->alg != COMPR_ALG_NONE)
+		return fp->eof;
+	else
 		return feof(fp->uncompressedfp);
 }
 
@@ -703,7 +1486,6 @@ get_cfp_error(cfp *fp)
 	return strerror(errno);
 }
 
-#ifdef HAVE_LIBZ
 static int
 hasSuffix(const char *filename, const char *suffix)
 {
@@ -717,5 +1499,3 @@ hasSuffix(const char *filename, const char *suffix)
 				  suffix,
 				  suffixlen) == 0;
 }
-
-#endif
@@ -43,6 +43,15 @@ typedef enum _archiveFormat
 	archDirectory = 5
 } ArchiveFormat;
 
+/* Compression methods for archive data; stored in the archive header */
+typedef enum
+{
+	COMPR_ALG_NONE,
+	COMPR_ALG_LIBZ,
+	COMPR_ALG_LZ4,
+	COMPR_ALG_ZSTD
+} CompressionAlgorithm;
+
 typedef enum _archiveMode
 {
 	archModeAppend,
@@ -149,6 +158,8 @@ typedef struct _dumpOptions
 	bool		aclsSkip;
 	const char *lockWaitTimeout;
 	int			dump_inserts;	/* 0 = COPY, otherwise rows per INSERT */
+	int			table_chunk_size;	/* split tables larger than this many
+									 * MB; 0 = don't split */
 
 	/* flags for various command-line long options */
 	int			disable_dollar_quoting;
@@ -200,6 +211,8 @@ typedef struct Archive
 	int			maxRemoteVersion;
 
 	int			numWorkers;		/* number of parallel processes */
+	int			compressWorkers;	/* zstd compression threads per process,
+									 * 0 to compress in the calling thread */
 	char	   *sync_snapshot_id;	/* sync snapshot id for parallel operation */
 
 	/* info needed for string escaping */
@@ -281,6 +294,7 @@ extern Archive *OpenArchive(const char *FileSpec, const ArchiveFormat fmt);
 
 /* Create a new archive */
 extern Archive *CreateArchive(const char *FileSpec, const ArchiveFormat fmt,
+							  const CompressionAlgorithm compressionAlgorithm,
 							  const int compression, bool dosync, ArchiveMode mode,
 							  SetupWorkerPtrType setupDumpWorker);
 
@@ -69,6 +69,7 @@ typedef struct _parallelReadyList
 
 
 static ArchiveHandle *_allocAH(const char *FileSpec, const ArchiveFormat fmt,
+							   const CompressionAlgorithm compressionAlgorithm,
 							   const int compression, bool dosync, ArchiveMode mode,
 							   SetupWorkerPtrType setupWorkerPtr);
 static void _getObjectDescription(PQExpBuffer buf, TocEntry *te,
@@ -96,6 +97,7 @@ static void _moveBefore(ArchiveHandle *AH, TocEntry *pos, TocEntry *te);
 static int	_discoverArchiveFormat(ArchiveHandle *AH);
 
 static int	RestoringToDB(ArchiveHandle *AH);
+static bool CompressionSupported(ArchiveHandle *AH);
 static void dump_lo_buf(ArchiveHandle *AH);
 static void dumpTimestamp(ArchiveHandle *AH, const char *msg, time_t tim);
 static void SetOutput(ArchiveHandle *AH, const char *filename, int compression);
@@ -239,12 +241,13 @@ setupRestoreWorker(Archive *AHX)
 /* Public */
 Archive *
 CreateArchive(const char *FileSpec, const ArchiveFormat fmt,
+			  const CompressionAlgorithm compressionAlgorithm,
 			  const int compression, bool dosync, ArchiveMode mode,
 			  SetupWorkerPtrType setupDumpWorker)
 
 {
-	ArchiveHandle *AH = _allocAH(FileSpec, fmt, compression, dosync,
-								 mode, setupDumpWorker);
+	ArchiveHandle *AH = _allocAH(FileSpec, fmt, compressionAlgorithm,
+								 compression, dosync, mode, setupDumpWorker);
 
 	return (Archive *) AH;
 }
@@ -254,7 +257,8 @@ CreateArchive(const char *FileSpec, const ArchiveFormat fmt,
 Archive *
 OpenArchive(const char *FileSpec, const ArchiveFormat fmt)
 {
-	ArchiveHandle *AH = _allocAH(FileSpec, fmt, 0, true, archModeRead, setupRestoreWorker);
+	ArchiveHandle *AH = _allocAH(FileSpec, fmt, COMPR_ALG_NONE, 0, true,
+								 archModeRead, setupRestoreWorker);
 
 	return (Archive *) AH;
 }
@@ -382,8 +386,7 @@ RestoreArchive(Archive *AHX)
 	/*
 	 * Make sure we won't need (de)compression we haven't got
 	 */
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0 && AH->PrintTocDataPtr != NULL)
+	if (!CompressionSupported(AH) && AH->PrintTocDataPtr != NULL)
 	{
 		for (te = AH->toc->next; te != AH->toc; te = te->next)
 		{
@@ -391,7 +394,6 @@ RestoreArchive(Archive *AHX)
 				fatal("cannot restore from compressed archive (compression not supported in this installation)");
 		}
 	}
-#endif
 
 	/*
 	 * Prepare index arrays, so we can assume we have them throughout restore.
@@ -1530,7 +1532,10 @@ SetOutput(ArchiveHandle *AH, const char *filename, int compression)
 		char		fmode[14];
 
 		/* Don't use PG_BINARY_x since this is zlib */
-		sprintf(fmode, "wb%d", compression);
+		if (compression == Z_DEFAULT_COMPRESSION)
+			strcpy(fmode, "wb");
+		else
+			sprintf(fmode, "wb%d", compression);
 		if (fn >= 0)
 			AH->OF = gzdopen(dup(fn), fmode);
 		else
@@ -1644,6 +1649,38 @@ RestoringToDB(ArchiveHandle *AH)
 	return (ropt && ropt->useDB && AH->connection);
 }
 
+/*
+ * Can this installation decompress the archive's data?
+ */
+static bool
+CompressionSupported(ArchiveHandle *AH)
+{
+	switch (AH->compressionAlgorithm)
+	{
+		case COMPR_ALG_NONE:
+			return true;
+		case COMPR_ALG_LIBZ:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
 /*
  * Dump the current contents of the LO data buffer while writing a BLOB
  */
@@ -1852,7 +1889,9 @@ buildTocEntryArrays(ArchiveHandle *AH)
 		 * tableDataId provides the TABLE DATA item's dump ID for each TABLE
 		 * TOC entry that has a DATA item.  We compute this by reversing the
 		 * TABLE DATA item's dependency, knowing that a TABLE DATA item has
-		 * just one dependency and it is the TABLE item.
+		 * just one dependency and it is the TABLE item.  If the table's data
+		 * was split into several items, tableDataId gives the first one and
+		 * the rest are chained through nextTableData.
 		 */
 		if (strcmp(te->desc, "TABLE DATA") == 0 && te->nDeps > 0)
 		{
@@ -1866,7 +1905,17 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			te->nextTableData = NULL;
+			if (AH->tableDataId[tableId] == 0)
+				AH->tableDataId[tableId] = te->dumpId;
+			else
+			{
+				TocEntry   *prev = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				while (prev->nextTableData != NULL)
+					prev = prev->nextTableData;
+				prev->nextTableData = te;
+			}
 		}
 	}
 }
@@ -2275,6 +2324,7 @@ _discoverArchiveFormat(ArchiveHandle *AH)
  */
 static ArchiveHandle *
 _allocAH(const char *FileSpec, const ArchiveFormat fmt,
+		 const CompressionAlgorithm compressionAlgorithm,
 		 const int compression, bool dosync, ArchiveMode mode,
 		 SetupWorkerPtrType setupWorkerPtr)
 {
@@ -2325,6 +2375,7 @@ _allocAH(const char *FileSpec, const ArchiveFormat fmt,
 	AH->toc->prev = AH->toc;
 
 	AH->mode = mode;
+	AH->compressionAlgorithm = compressionAlgorithm;
 	AH->compression = compression;
 	AH->dosync = dosync;
 
@@ -3757,6 +3808,7 @@ WriteHead(ArchiveHandle *AH)
 	AH->WriteBytePtr(AH, AH->offSize);
 	AH->WriteBytePtr(AH, AH->format);
 	WriteInt(AH, AH->compression);
+	AH->WriteBytePtr(AH, AH->compressionAlgorithm);
 	crtm = *localtime(&AH->createDate);
 	WriteInt(AH, crtm.tm_sec);
 	WriteInt(AH, crtm.tm_min);
@@ -3838,10 +3890,19 @@ ReadHead(ArchiveHandle *AH)
 	else
 		AH->compression = Z_DEFAULT_COMPRESSION;
 
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0)
+	if (AH->version >= K_VERS_1_16)
+	{
+		AH->compressionAlgorithm = AH->ReadBytePtr(AH);
+		if (AH->compressionAlgorithm > COMPR_ALG_ZSTD)
+			fatal("invalid compression algorithm in archive header: %d",
+				  AH->compressionAlgorithm);
+	}
+	else
+		AH->compressionAlgorithm =
+			(AH->compression != 0) ? COMPR_ALG_LIBZ : COMPR_ALG_NONE;
+
+	if (!CompressionSupported(AH))
 		pg_log_warning("archive is compressed, but this installation does not support compression -- no data will be available");
-#endif
 
 	if (AH->version >= K_VERS_1_4)
 	{
@@ -4652,11 +4713,25 @@ repoint_table_dependencies(ArchiveHandle *AH)
 			{
 				DumpId		tabledataid = AH->tableDataId[olddep];
 				TocEntry   *tabledatate = AH->tocsByDumpId[tabledataid];
+				pgoff_t		dataLength = tabledatate->dataLength;
 
 				te->dependencies[i] = tabledataid;
-				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				/* If the data was split, depend on all of its parts */
+				while ((tabledatate = tabledatate->nextTableData) != NULL)
+				{
+					te->dependencies = (DumpId *)
+						pg_realloc(te->dependencies,
+								   (te->nDeps + 1) * sizeof(DumpId));
+					te->dependencies[te->nDeps++] = tabledatate->dumpId;
+					te->depCount++;
+					dataLength += tabledatate->dataLength;
+					pg_log_debug("adding dependency %d -> %d",
+								 te->dumpId, tabledatate->dumpId);
+				}
+				te->dataLength = Max(te->dataLength, dataLength);
 			}
 		}
 	}
@@ -4778,7 +4853,13 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		/*
+		 * If the data is split into several items, each of them must not
+		 * precede its COPY with a TRUNCATE, or it would remove the rows
+		 * loaded by the others.
+		 */
+		if (ted->nextTableData == NULL)
+			ted->created = true;
 	}
 }
 
@@ -4794,9 +4875,11 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 
 	if (AH->tableDataId[te->dumpId] != 0)
 	{
-		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+		TocEntry   *ted;
 
-		ted->reqs = 0;
+		for (ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+			 ted != NULL; ted = ted->nextTableData)
+			ted->reqs = 0;
 	}
 }
 
@@ -300,7 +300,8 @@ _StartData(ArchiveHandle *AH, TocEntry *te)
 	_WriteByte(AH, BLK_DATA);	/* Block type */
 	WriteInt(AH, te->dumpId);	/* For sanity check */
 
-	ctx->cs = AllocateCompressor(AH->compression, _CustomWriteFunc);
+	ctx->cs = AllocateCompressor(AH->compressionAlgorithm, AH->compression,
+								 AH->public.compressWorkers, _CustomWriteFunc);
 }
 
 /*
@@ -382,7 +383,8 @@ _StartBlob(ArchiveHandle *AH, TocEntry *te, Oid oid)
 
 	WriteInt(AH, oid);
 
-	ctx->cs = AllocateCompressor(AH->compression, _CustomWriteFunc);
+	ctx->cs = AllocateCompressor(AH->compressionAlgorithm, AH->compression,
+								 AH->public.compressWorkers, _CustomWriteFunc);
 }
 
 /*
@@ -571,7 +573,8 @@ _PrintTocData(ArchiveHandle *AH, TocEntry *te)
 static void
 _PrintData(ArchiveHandle *AH)
 {
-	ReadDataFromArchive(AH, AH->compression, _CustomReadFunc);
+	ReadDataFromArchive(AH, AH->compressionAlgorithm, AH->compression,
+						_CustomReadFunc);
 }
 
 static void
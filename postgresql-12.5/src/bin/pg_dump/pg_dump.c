@@ -34,6 +34,7 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <limits.h>
+#include <math.h>
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
 #endif
@@ -155,6 +156,8 @@ static void setup_connection(Archive *AH,
 							 const char *dumpencoding, const char *dumpsnapshot,
 							 char *use_role);
 static ArchiveFormat parseArchiveFormat(const char *format, ArchiveMode *mode);
+static void parseCompression(const char *spec, CompressionAlgorithm *alg,
+							 int *level);
 static void expand_schema_name_patterns(Archive *fout,
 										SimpleStringList *patterns,
 										SimpleOidList *oids,
@@ -245,6 +248,7 @@ static void addConstrChildIdxDeps(DumpableObject *dobj, IndxInfo *refidx);
 static void getDomainConstraints(Archive *fout, TypeInfo *tyinfo);
 static void getTableData(DumpOptions *dopt, TableInfo *tblinfo, int numTables, char relkind);
 static void makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo);
+static void splitTableData(Archive *fout, TableInfo *tblinfo, int numTables);
 static void buildMatViewRefreshDependencies(Archive *fout);
 static void getTableDataFKConstraints(void);
 static char *format_function_arguments(FuncInfo *finfo, char *funcargs,
@@ -320,8 +324,12 @@ main(int argc, char **argv)
 	const char *dumpsnapshot = NULL;
 	char	   *use_role = NULL;
 	long		rowsPerInsert;
+	long		tableChunkSize;
+	long		compressWorkers = 0;
 	int			numWorkers = 1;
-	int			compressLevel = -1;
+	bool		compressGiven = false;
+	CompressionAlgorithm compressAlgorithm = COMPR_ALG_NONE;
+	int			compressLevel = 0;
 	int			plainText = 0;
 	ArchiveFormat archiveFormat = archUnknown;
 	ArchiveMode archiveMode;
@@ -391,6 +399,8 @@ main(int argc, char **argv)
 		{"no-sync", no_argument, NULL, 7},
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
+		{"table-chunk-size", required_argument, NULL, 11},
+		{"compress-workers", required_argument, NULL, 12},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -535,13 +545,9 @@ main(int argc, char **argv)
 				dopt.aclsSkip = true;
 				break;
 
-			case 'Z':			/* Compression Level */
-				compressLevel = atoi(optarg);
-				if (compressLevel < 0 || compressLevel > 9)
-				{
-					pg_log_error("compression level must be in range 0..9");
-					exit_nicely(1);
-				}
+			case 'Z':			/* Compression method and level */
+				parseCompression(optarg, &compressAlgorithm, &compressLevel);
+				compressGiven = true;
 				break;
 
 			case 0:
@@ -607,6 +613,35 @@ main(int argc, char **argv)
 				dopt.dump_inserts = (int) rowsPerInsert;
 				break;
 
+			case 11:			/* table chunk size */
+				errno = 0;
+				tableChunkSize = strtol(optarg, &endptr, 10);
+
+				if (endptr == optarg || *endptr != '\0' ||
+					tableChunkSize <= 0 || tableChunkSize > INT_MAX ||
+					errno == ERANGE)
+				{
+					pg_log_error("table-chunk-size must be in range %d..%d",
+								 1, INT_MAX);
+					exit_nicely(1);
+				}
+				dopt.table_chunk_size = (int) tableChunkSize;
+				break;
+
+			case 12:			/* zstd compression threads */
+				errno = 0;
+				compressWorkers = strtol(optarg, &endptr, 10);
+
+				if (endptr == optarg || *endptr != '\0' ||
+					compressWorkers < 0 || compressWorkers > 256 ||
+					errno == ERANGE)
+				{
+					pg_log_error("compress-workers must be in range %d..%d",
+								 0, 256);
+					exit_nicely(1);
+				}
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -672,20 +707,33 @@ main(int argc, char **argv)
 		plainText = 1;
 
 	/* Custom and directory formats are compressed by default, others not */
-	if (compressLevel == -1)
+	if (!compressGiven)
 	{
 #ifdef HAVE_LIBZ
 		if (archiveFormat == archCustom || archiveFormat == archDirectory)
+		{
+			compressAlgorithm = COMPR_ALG_LIBZ;
 			compressLevel = Z_DEFAULT_COMPRESSION;
-		else
+		}
 #endif
-			compressLevel = 0;
 	}
 
+	/* Only the formats that compress each data item can use lz4 or zstd */
+	if ((compressAlgorithm == COMPR_ALG_LZ4 ||
+		 compressAlgorithm == COMPR_ALG_ZSTD) &&
+		archiveFormat != archCustom && archiveFormat != archDirectory)
+		fatal("lz4 and zstd compression are only supported by the custom and directory formats");
+
+	if (compressWorkers > 0 && compressAlgorithm != COMPR_ALG_ZSTD)
+		fatal("option --compress-workers requires zstd compression");
+
 #ifndef HAVE_LIBZ
-	if (compressLevel != 0)
+	if (compressAlgorithm == COMPR_ALG_LIBZ)
+	{
 		pg_log_warning("requested compression not available in this installation -- archive will be uncompressed");
-	compressLevel = 0;
+		compressAlgorithm = COMPR_ALG_NONE;
+		compressLevel = 0;
+	}
 #endif
 
 	/*
@@ -711,9 +759,18 @@ main(int argc, char **argv)
 	if (archiveFormat != archDirectory && numWorkers > 1)
 		fatal("parallel backup only supported by the directory format");
 
+	/*
+	 * The parts of a split table must all be read with the same snapshot,
+	 * or rows updated meanwhile could be dumped twice or not at all.
+	 */
+	if (dopt.table_chunk_size > 0 && numWorkers > 1 &&
+		dopt.no_synchronized_snapshots)
+		fatal("option --table-chunk-size cannot be used with --no-synchronized-snapshots in parallel mode");
+
 	/* Open the output file */
-	fout = CreateArchive(filename, archiveFormat, compressLevel, dosync,
-						 archiveMode, setupDumpWorker);
+	fout = CreateArchive(filename, archiveFormat, compressAlgorithm,
+						 compressLevel, dosync, archiveMode, setupDumpWorker);
+	fout->compressWorkers = (int) compressWorkers;
 
 	/* Make dump options accessible right away */
 	SetArchiveOptions(fout, &dopt, NULL);
@@ -841,6 +898,8 @@ main(int argc, char **argv)
 	if (!dopt.schemaOnly)
 	{
 		getTableData(&dopt, tblinfo, numTables, 0);
+		if (dopt.table_chunk_size > 0)
+			splitTableData(fout, tblinfo, numTables);
 		buildMatViewRefreshDependencies(fout);
 		if (dopt.dataOnly)
 			getTableDataFKConstraints();
@@ -943,10 +1002,11 @@ main(int argc, char **argv)
 	ropt->sequence_data = dopt.sequence_data;
 	ropt->binary_upgrade = dopt.binary_upgrade;
 
-	if (compressLevel == -1)
-		ropt->compression = 0;
-	else
+	/* plain-text output can only be gzip-compressed */
+	if (compressAlgorithm == COMPR_ALG_LIBZ)
 		ropt->compression = compressLevel;
+	else
+		ropt->compression = 0;
 
 	ropt->suppressDumpWarnings = true;	/* We've already shown them */
 
@@ -993,7 +1053,10 @@ help(const char *progname)
 	printf(_("  -j, --jobs=NUM               use this many parallel jobs to dump\n"));
 	printf(_("  -v, --verbose                verbose mode\n"));
 	printf(_("  -V, --version                output version information, then exit\n"));
-	printf(_("  -Z, --compress=0-9           compression level for compressed formats\n"));
+	printf(_("  -Z, --compress=0-9|METHOD[:LEVEL]\n"
+			 "                               compress output with given method (none, gzip,\n"
+			 "                               lz4 or zstd) or gzip level\n"));
+	printf(_("  --compress-workers=NUM       use NUM threads for zstd compression\n"));
 	printf(_("  --lock-wait-timeout=TIMEOUT  fail after waiting TIMEOUT for a table lock\n"));
 	printf(_("  --no-sync                    do not wait for changes to be written safely to disk\n"));
 	printf(_("  -?, --help                   show this help, then exit\n"));
@@ -1040,6 +1103,8 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-size=SIZE      split data of tables larger than SIZE megabytes\n"
+			 "                               into several parts\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -1293,6 +1358,93 @@ parseArchiveFormat(const char *format, ArchiveMode *mode)
 	return archiveFormat;
 }
 
+/*
+ * Parse the argument of -Z/--compress.  This is either a plain number,
+ * meaning that gzip level (0 disables compression), or METHOD[:LEVEL]
+ * where METHOD is none, gzip, lz4 or zstd.  If no level is given, the
+ * method's default is used.
+ */
+static void
+parseCompression(const char *spec, CompressionAlgorithm *alg, int *level)
+{
+	const char *sep = strchr(spec, ':');
+	char	   *method;
+	int			minlevel = 0;
+	int			maxlevel = 0;
+
+	if (isdigit((unsigned char) spec[0]))
+	{
+		method = pg_strdup("gzip");
+		sep = spec - 1;
+	}
+	else
+	{
+		method = pg_strdup(spec);
+		if (sep != NULL)
+			method[sep - spec] = '\0';
+	}
+
+	if (pg_strcasecmp(method, "none") == 0)
+		*alg = COMPR_ALG_NONE;
+	else if (pg_strcasecmp(method, "gzip") == 0)
+	{
+		*alg = COMPR_ALG_LIBZ;
+		minlevel = 0;
+		maxlevel = 9;
+	}
+	else if (pg_strcasecmp(method, "lz4") == 0)
+	{
+#ifndef USE_LZ4
+		fatal("this build does not support compression with %s", "lz4");
+#endif
+		*alg = COMPR_ALG_LZ4;
+		minlevel = 0;
+		maxlevel = 12;
+	}
+	else if (pg_strcasecmp(method, "zstd") == 0)
+	{
+#ifndef USE_ZSTD
+		fatal("this build does not support compression with %s", "zstd");
+#endif
+		*alg = COMPR_ALG_ZSTD;
+		minlevel = 1;
+		maxlevel = 22;
+	}
+	else
+		fatal("invalid compression method \"%s\"", method);
+
+	if (sep == NULL)
+	{
+		/* -1 selects the default level of each method */
+		*level = (*alg == COMPR_ALG_NONE) ? 0 : -1;
+	}
+	else
+	{
+		char	   *endptr;
+		long		val;
+
+		if (*alg == COMPR_ALG_NONE)
+			fatal("compression method \"%s\" does not accept a level", method);
+
+		errno = 0;
+		val = strtol(sep + 1, &endptr, 10);
+		if (endptr == sep + 1 || *endptr != '\0' || errno == ERANGE ||
+			val < minlevel || val > maxlevel)
+		{
+			pg_log_error("compression level for \"%s\" must be in range %d..%d",
+						 method, minlevel, maxlevel);
+			exit_nicely(1);
+		}
+		*level = (int) val;
+	}
+
+	/* gzip level 0 means no compression at all */
+	if (*alg == COMPR_ALG_LIBZ && *level == 0)
+		*alg = COMPR_ALG_NONE;
+
+	free(method);
+}
+
 /*
  * Find the OIDs of all schemas matching the given list of patterns,
  * and append them to the given OID list.
@@ -2267,7 +2419,7 @@ dumpTableData(Archive *fout, TableDataInfo *tdinfo)
 		 * Cast so that we get the right interpretation of table sizes
 		 * exceeding INT_MAX pages.
 		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
+		te->dataLength = (BlockNumber) tbinfo->relpages / tdinfo->numChunks;
 	}
 
 	destroyPQExpBuffer(copyBuf);
@@ -2361,6 +2513,9 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	if (tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED &&
 		dopt->no_unlogged_table_data)
 		return;
+	/* Global temporary tables have no data outside of sessions */
+	if (tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		return;
 
 	/* Check that the data is not explicitly excluded */
 	if (simple_oid_list_member(&tabledata_exclude_oids,
@@ -2388,6 +2543,8 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	tdinfo->dobj.namespace = tbinfo->dobj.namespace;
 	tdinfo->tdtable = tbinfo;
 	tdinfo->filtercond = NULL;	/* might get set later */
+	tdinfo->numChunks = 1;
+	tdinfo->nextChunk = NULL;
 	addObjectDependency(&tdinfo->dobj, tbinfo->dobj.dumpId);
 
 	tbinfo->dataObj = tdinfo;
@@ -2396,6 +2553,167 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	tbinfo->interesting = true;
 }
 
+/*
+ * splitTableData -
+ *	  split the data of large tables into several TABLE DATA items
+ *
+ * A table bigger than --table-chunk-size that has a single-column integer
+ * primary key gets one TABLE DATA item per range of key values, which
+ * parallel pg_dump and pg_restore can then process concurrently.  The
+ * ranges are computed under the dump's snapshot, and every item is dumped
+ * with that same snapshot, so together they hold exactly the table's rows.
+ */
+static void
+splitTableData(Archive *fout, TableInfo *tblinfo, int numTables)
+{
+	DumpOptions *dopt = fout->dopt;
+	PQExpBuffer query;
+	double		chunkbytes = (double) dopt->table_chunk_size * 1024 * 1024;
+	int			i;
+
+	/* COPY (SELECT ...) is needed to dump a range of rows */
+	if (fout->remoteVersion < 80200)
+		return;
+
+	query = createPQExpBuffer();
+
+	for (i = 0; i < numTables; i++)
+	{
+		TableInfo  *tbinfo = &tblinfo[i];
+		TableDataInfo *tdinfo = tbinfo->dataObj;
+		TableDataInfo *prev;
+		PGresult   *res;
+		char	   *keycol;
+		int64		minkey;
+		int64		maxkey;
+		uint64		range;
+		uint64		step;
+		double		nchunks;
+		int			numChunks;
+		int			j;
+
+		/* Extension config tables may have their own filter condition */
+		if (tdinfo == NULL || tdinfo->dobj.objType != DO_TABLE_DATA ||
+			tdinfo->filtercond != NULL || tbinfo->dobj.ext_member)
+			continue;
+		if ((double) (BlockNumber) tbinfo->relpages * BLCKSZ <= chunkbytes)
+			continue;
+
+		/*
+		 * Look for a single-column integer primary key.  Skip tables with
+		 * inheritance children, since a filtered COPY reads those too.
+		 */
+		resetPQExpBuffer(query);
+		appendPQExpBuffer(query,
+						  "SELECT a.attname "
+						  "FROM pg_catalog.pg_index i "
+						  "JOIN pg_catalog.pg_class c ON c.oid = i.indrelid "
+						  "JOIN pg_catalog.pg_attribute a "
+						  "ON a.attrelid = i.indrelid AND a.attnum = i.indkey[0] "
+						  "WHERE i.indrelid = '%u'::pg_catalog.oid "
+						  "AND i.indisprimary AND i.indnatts = 1 "
+						  "AND NOT c.relhassubclass "
+						  "AND a.atttypid IN ('pg_catalog.int2'::pg_catalog.regtype, "
+						  "'pg_catalog.int4'::pg_catalog.regtype, "
+						  "'pg_catalog.int8'::pg_catalog.regtype)",
+						  tbinfo->dobj.catId.oid);
+		res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
+		if (PQntuples(res) != 1)
+		{
+			PQclear(res);
+			continue;
+		}
+		keycol = pg_strdup(fmtId(PQgetvalue(res, 0, 0)));
+		PQclear(res);
+
+		resetPQExpBuffer(query);
+		appendPQExpBuffer(query,
+						  "SELECT pg_catalog.min(%s)::pg_catalog.int8, "
+						  "pg_catalog.max(%s)::pg_catalog.int8 FROM ONLY ",
+						  keycol, keycol);
+		appendPQExpBufferStr(query, fmtQualifiedDumpable(tbinfo));
+		res = ExecuteSqlQueryForSingleRow(fout, query->data);
+		if (PQgetisnull(res, 0, 0) || PQgetisnull(res, 0, 1))
+		{
+			/* table is empty after all */
+			PQclear(res);
+			free(keycol);
+			continue;
+		}
+		minkey = strtoll(PQgetvalue(res, 0, 0), NULL, 10);
+		maxkey = strtoll(PQgetvalue(res, 0, 1), NULL, 10);
+		PQclear(res);
+
+		/* Never make more parts than there are key values */
+		range = (uint64) maxkey - (uint64) minkey;
+		nchunks = ceil((double) (BlockNumber) tbinfo->relpages * BLCKSZ /
+					   chunkbytes);
+		if (nchunks > (double) range)
+			nchunks = (double) range;
+		if (nchunks > INT_MAX)
+			nchunks = INT_MAX;
+		numChunks = (int) nchunks;
+		if (numChunks < 2)
+		{
+			free(keycol);
+			continue;
+		}
+
+		pg_log_info("splitting data of table \"%s.%s\" into %d parts",
+					tbinfo->dobj.namespace->dobj.name, tbinfo->dobj.name,
+					numChunks);
+
+		/*
+		 * The first and last parts are open-ended; the others cover equal
+		 * ranges of key values.
+		 */
+		step = range / numChunks;
+		prev = NULL;
+		for (j = 0; j < numChunks; j++)
+		{
+			TableDataInfo *chunk;
+			int64		lo = (int64) ((uint64) minkey + step * j);
+			int64		hi = (int64) ((uint64) minkey + step * (j + 1));
+
+			if (j == 0)
+				chunk = tdinfo;
+			else
+			{
+				chunk = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
+				chunk->dobj.objType = DO_TABLE_DATA;
+				chunk->dobj.catId = tdinfo->dobj.catId;
+				AssignDumpId(&chunk->dobj);
+				chunk->dobj.name = tdinfo->dobj.name;
+				chunk->dobj.namespace = tdinfo->dobj.namespace;
+				chunk->dobj.dump = tdinfo->dobj.dump;
+				chunk->tdtable = tbinfo;
+				chunk->nextChunk = NULL;
+				addObjectDependency(&chunk->dobj, tbinfo->dobj.dumpId);
+				prev->nextChunk = chunk;
+			}
+
+			resetPQExpBuffer(query);
+			if (j == 0)
+				appendPQExpBuffer(query, "WHERE %s < " INT64_FORMAT,
+								  keycol, hi);
+			else if (j == numChunks - 1)
+				appendPQExpBuffer(query, "WHERE %s >= " INT64_FORMAT,
+								  keycol, lo);
+			else
+				appendPQExpBuffer(query,
+								  "WHERE %s >= " INT64_FORMAT " AND %s < " INT64_FORMAT,
+								  keycol, lo, keycol, hi);
+			chunk->filtercond = pg_strdup(query->data);
+			chunk->numChunks = numChunks;
+			prev = chunk;
+		}
+
+		free(keycol);
+	}
+
+	destroyPQExpBuffer(query);
+}
+
 /*
  * The refresh for a materialized view must be dependent on the refresh for
  * any materialized view that this one is dependent on.
@@ -2533,6 +2851,8 @@ getTableDataFKConstraints(void)
 		{
 			ConstraintInfo *cinfo = (ConstraintInfo *) dobjs[i];
 			TableInfo  *ftable;
+			TableDataInfo *contd;
+			TableDataInfo *ftd;
 
 			/* Not interesting unless both tables are to be dumped */
 			if (cinfo->contable == NULL ||
@@ -2544,11 +2864,14 @@ getTableDataFKConstraints(void)
 				continue;
 
 			/*
-			 * Okay, make referencing table's TABLE_DATA object depend on the
-			 * referenced table's TABLE_DATA object.
+			 * Okay, make referencing table's TABLE_DATA objects depend on the
+			 * referenced table's TABLE_DATA objects.
 			 */
-			addObjectDependency(&cinfo->contable->dataObj->dobj,
-								ftable->dataObj->dobj.dumpId);
+			for (contd = cinfo->contable->dataObj; contd; contd = contd->nextChunk)
+			{
+				for (ftd = ftable->dataObj; ftd; ftd = ftd->nextChunk)
+					addObjectDependency(&contd->dobj, ftd->dobj.dumpId);
+			}
 		}
 	}
 	free(dobjs);
@@ -3977,6 +4300,9 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 	int			i_tableoid;
 	int			i_oid;
 	int			i_pubname;
+	int			i_prqual;
+	int			i_prattrs;
+	bool		has_filters = false;
 	int			i,
 				j,
 				ntups;
@@ -3986,6 +4312,21 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 
 	query = createPQExpBuffer();
 
+	/*
+	 * Row filters and column lists can't be detected from the server
+	 * version alone, so check for the catalog column instead.
+	 */
+	if (fout->remoteVersion >= 120000)
+	{
+		appendPQExpBufferStr(query,
+							 "SELECT EXISTS (SELECT 1 FROM pg_attribute "
+							 "WHERE attrelid = 'pg_publication_rel'::regclass "
+							 "  AND attname = 'prqual')");
+		res = ExecuteSqlQueryForSingleRow(fout, query->data);
+		has_filters = (strcmp(PQgetvalue(res, 0, 0), "t") == 0);
+		PQclear(res);
+	}
+
 	for (i = 0; i < numTables; i++)
 	{
 		TableInfo  *tbinfo = &tblinfo[i];
@@ -4008,8 +4349,20 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		resetPQExpBuffer(query);
 
 		/* Get the publication membership for the table. */
+		appendPQExpBufferStr(query,
+							 "SELECT pr.tableoid, pr.oid, p.pubname, ");
+		if (has_filters)
+			appendPQExpBufferStr(query,
+								 "pg_get_expr(pr.prqual, pr.prrelid) AS prqual, "
+								 "(SELECT string_agg(quote_ident(a.attname), ', ' "
+								 "                   ORDER BY a.attnum) "
+								 " FROM pg_attribute a "
+								 " WHERE a.attrelid = pr.prrelid "
+								 "   AND a.attnum = ANY (pr.prattrs)) AS prattrs ");
+		else
+			appendPQExpBufferStr(query,
+								 "NULL AS prqual, NULL AS prattrs ");
 		appendPQExpBuffer(query,
-						  "SELECT pr.tableoid, pr.oid, p.pubname "
 						  "FROM pg_publication_rel pr, pg_publication p "
 						  "WHERE pr.prrelid = '%u'"
 						  "  AND p.oid = pr.prpubid",
@@ -4030,6 +4383,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		i_tableoid = PQfnumber(res, "tableoid");
 		i_oid = PQfnumber(res, "oid");
 		i_pubname = PQfnumber(res, "pubname");
+		i_prqual = PQfnumber(res, "prqual");
+		i_prattrs = PQfnumber(res, "prattrs");
 
 		pubrinfo = pg_malloc(ntups * sizeof(PublicationRelInfo));
 
@@ -4044,6 +4399,14 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 			pubrinfo[j].dobj.name = tbinfo->dobj.name;
 			pubrinfo[j].pubname = pg_strdup(PQgetvalue(res, j, i_pubname));
 			pubrinfo[j].pubtable = tbinfo;
+			if (PQgetisnull(res, j, i_prqual))
+				pubrinfo[j].pubrelqual = NULL;
+			else
+				pubrinfo[j].pubrelqual = pg_strdup(PQgetvalue(res, j, i_prqual));
+			if (PQgetisnull(res, j, i_prattrs))
+				pubrinfo[j].pubrelcols = NULL;
+			else
+				pubrinfo[j].pubrelcols = pg_strdup(PQgetvalue(res, j, i_prattrs));
 
 			/* Decide whether we want to dump it */
 			selectDumpablePublicationTable(&(pubrinfo[j].dobj), fout);
@@ -4073,8 +4436,13 @@ dumpPublicationTable(Archive *fout, PublicationRelInfo *pubrinfo)
 
 	appendPQExpBuffer(query, "ALTER PUBLICATION %s ADD TABLE ONLY",
 					  fmtId(pubrinfo->pubname));
-	appendPQExpBuffer(query, " %s;\n",
+	appendPQExpBuffer(query, " %s",
 					  fmtQualifiedDumpable(tbinfo));
+	if (pubrinfo->pubrelcols)
+		appendPQExpBuffer(query, " (%s)", pubrinfo->pubrelcols);
+	if (pubrinfo->pubrelqual)
+		appendPQExpBuffer(query, " WHERE (%s)", pubrinfo->pubrelqual);
+	appendPQExpBufferStr(query, ";\n");
 
 	/*
 	 * There is no point in creating drop query as the drop is done by table
@@ -15764,7 +16132,9 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 
 		appendPQExpBuffer(q, "CREATE %s%s %s",
 						  tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED ?
-						  "UNLOGGED " : "",
+						  "UNLOGGED " :
+						  tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP ?
+						  "GLOBAL TEMPORARY " : "",
 						  reltypename,
 						  qualrelname);
 
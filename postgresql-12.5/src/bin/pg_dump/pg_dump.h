@@ -354,6 +354,8 @@ typedef struct _tableDataInfo
 	DumpableObject dobj;
 	TableInfo  *tdtable;		/* link to table to dump */
 	char	   *filtercond;		/* WHERE condition to limit rows dumped */
+	int			numChunks;		/* number of parts the data is split into */
+	struct _tableDataInfo *nextChunk;	/* next part, if split */
 } TableDataInfo;
 
 typedef struct _indxInfo
@@ -615,6 +617,8 @@ typedef struct _PublicationRelInfo
 	DumpableObject dobj;
 	TableInfo  *pubtable;
 	char	   *pubname;
+	char	   *pubrelqual;		/* row filter, or NULL */
+	char	   *pubrelcols;		/* column list, or NULL for all columns */
 } PublicationRelInfo;
 
 /*
@@ -24,6 +24,9 @@ static void report_unmatched_relation(const RelInfo *rel, const DbInfo *db,
 static void free_db_and_rel_infos(DbInfoArr *db_arr);
 static void get_db_infos(ClusterInfo *cluster);
 static void get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo);
+static void get_all_rel_infos_parallel(ClusterInfo *cluster);
+static void build_rel_infos_query(ClusterInfo *cluster, char *query);
+static void process_rel_infos(DbInfo *dbinfo, PGresult *res);
 static void free_rel_infos(RelInfoArr *rel_arr);
 static void print_db_infos(DbInfoArr *dbinfo);
 static void print_rel_infos(RelInfoArr *rel_arr);
@@ -317,8 +320,13 @@ get_db_and_rel_infos(ClusterInfo *cluster)
 
 	get_db_infos(cluster);
 
-	for (dbnum = 0; dbnum < cluster->dbarr.ndbs; dbnum++)
-		get_rel_infos(cluster, &cluster->dbarr.dbs[dbnum]);
+	if (user_opts.jobs > 1 && cluster->dbarr.ndbs > 1)
+		get_all_rel_infos_parallel(cluster);
+	else
+	{
+		for (dbnum = 0; dbnum < cluster->dbarr.ndbs; dbnum++)
+			get_rel_infos(cluster, &cluster->dbarr.dbs[dbnum]);
+	}
 
 	if (cluster == &old_cluster)
 		pg_log(PG_VERBOSE, "\nsource databases:\n");
@@ -411,25 +419,91 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 	PGconn	   *conn = connectToServer(cluster,
 									   dbinfo->db_name);
 	PGresult   *res;
-	RelInfo    *relinfos;
-	int			ntups;
-	int			relnum;
-	int			num_rels = 0;
-	char	   *nspname = NULL;
-	char	   *relname = NULL;
-	char	   *tablespace = NULL;
-	int			i_spclocation,
-				i_nspname,
-				i_relname,
-				i_reloid,
-				i_indtable,
-				i_toastheap,
-				i_relfilenode,
-				i_reltablespace;
 	char		query[QUERY_ALLOC];
-	char	   *last_namespace = NULL,
-			   *last_tablespace = NULL;
 
+	build_rel_infos_query(cluster, query);
+
+	res = executeQueryOrDie(conn, "%s", query);
+
+	process_rel_infos(dbinfo, res);
+
+	PQclear(res);
+
+	PQfinish(conn);
+}
+
+
+/*
+ * get_all_rel_infos_parallel()
+ *
+ * Same as calling get_rel_infos() for every database of the cluster, but
+ * keeps up to user_opts.jobs queries running at once on separate
+ * connections.  With many databases, the catalog scans would otherwise be
+ * done one after another.
+ */
+static void
+get_all_rel_infos_parallel(ClusterInfo *cluster)
+{
+	int			nslots = Min(user_opts.jobs, cluster->dbarr.ndbs);
+	PGconn	  **conns = (PGconn **) pg_malloc(sizeof(PGconn *) * nslots);
+	char		query[QUERY_ALLOC];
+	int			dbnum;
+
+	build_rel_infos_query(cluster, query);
+
+	for (dbnum = 0; dbnum < cluster->dbarr.ndbs; dbnum += nslots)
+	{
+		int			nbatch = Min(nslots, cluster->dbarr.ndbs - dbnum);
+		int			slot;
+
+		/* start a query in each database of this batch ... */
+		for (slot = 0; slot < nbatch; slot++)
+		{
+			DbInfo	   *dbinfo = &cluster->dbarr.dbs[dbnum + slot];
+
+			conns[slot] = connectToServer(cluster, dbinfo->db_name);
+
+			pg_log(PG_VERBOSE, "executing: %s\n", query);
+			if (!PQsendQuery(conns[slot], query))
+				pg_fatal("could not send query to database \"%s\": %s",
+						 dbinfo->db_name, PQerrorMessage(conns[slot]));
+		}
+
+		/* ... and then collect the results */
+		for (slot = 0; slot < nbatch; slot++)
+		{
+			DbInfo	   *dbinfo = &cluster->dbarr.dbs[dbnum + slot];
+			PGresult   *res;
+
+			res = PQgetResult(conns[slot]);
+			if (PQresultStatus(res) != PGRES_TUPLES_OK)
+				pg_fatal("SQL command failed in database \"%s\"\n%s\n%s",
+						 dbinfo->db_name, query, PQerrorMessage(conns[slot]));
+
+			process_rel_infos(dbinfo, res);
+			PQclear(res);
+
+			/* consume the end-of-query NULL result */
+			while ((res = PQgetResult(conns[slot])) != NULL)
+				PQclear(res);
+
+			PQfinish(conns[slot]);
+		}
+	}
+
+	pg_free(conns);
+}
+
+
+/*
+ * build_rel_infos_query()
+ *
+ * Build the query used by get_rel_infos() into "query", which must be
+ * QUERY_ALLOC bytes long.
+ */
+static void
+build_rel_infos_query(ClusterInfo *cluster, char *query)
+{
 	query[0] = '\0';			/* initialize query string to empty */
 
 	/*
@@ -443,7 +517,7 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 	 * output, so we have to copy that system table.  It's easiest to do that
 	 * by treating it as a user table.
 	 */
-	snprintf(query + strlen(query), sizeof(query) - strlen(query),
+	snprintf(query + strlen(query), QUERY_ALLOC - strlen(query),
 			 "WITH regular_heap (reloid, indtable, toastheap) AS ( "
 			 "  SELECT c.oid, 0::oid, 0::oid "
 			 "  FROM pg_catalog.pg_class c JOIN pg_catalog.pg_namespace n "
@@ -465,7 +539,7 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 	 * selected by the regular_heap CTE.  (We have to do this separately
 	 * because the namespace-name rules above don't work for toast tables.)
 	 */
-	snprintf(query + strlen(query), sizeof(query) - strlen(query),
+	snprintf(query + strlen(query), QUERY_ALLOC - strlen(query),
 			 "  toast_heap (reloid, indtable, toastheap) AS ( "
 			 "  SELECT c.reltoastrelid, 0::oid, c.oid "
 			 "  FROM regular_heap JOIN pg_catalog.pg_class c "
@@ -478,7 +552,7 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 	 * Testing indisready is necessary in 9.2, and harmless in earlier/later
 	 * versions.
 	 */
-	snprintf(query + strlen(query), sizeof(query) - strlen(query),
+	snprintf(query + strlen(query), QUERY_ALLOC - strlen(query),
 			 "  all_index (reloid, indtable, toastheap) AS ( "
 			 "  SELECT indexrelid, indrelid, 0::oid "
 			 "  FROM pg_catalog.pg_index "
@@ -492,7 +566,7 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 	 * And now we can write the query that retrieves the data we want for each
 	 * heap and index relation.  Make sure result is sorted by OID.
 	 */
-	snprintf(query + strlen(query), sizeof(query) - strlen(query),
+	snprintf(query + strlen(query), QUERY_ALLOC - strlen(query),
 			 "SELECT all_rels.*, n.nspname, c.relname, "
 			 "  c.relfilenode, c.reltablespace, %s "
 			 "FROM (SELECT * FROM regular_heap "
@@ -511,8 +585,35 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 			 (GET_MAJOR_VERSION(cluster->major_version) >= 902) ?
 			 "pg_catalog.pg_tablespace_location(t.oid) AS spclocation" :
 			 "t.spclocation");
+}
 
-	res = executeQueryOrDie(conn, "%s", query);
+
+/*
+ * process_rel_infos()
+ *
+ * Fill in the RelInfo array of "dbinfo" from the result of the query built
+ * by build_rel_infos_query().
+ */
+static void
+process_rel_infos(DbInfo *dbinfo, PGresult *res)
+{
+	RelInfo    *relinfos;
+	int			ntups;
+	int			relnum;
+	int			num_rels = 0;
+	char	   *nspname = NULL;
+	char	   *relname = NULL;
+	char	   *tablespace = NULL;
+	int			i_spclocation,
+				i_nspname,
+				i_relname,
+				i_reloid,
+				i_indtable,
+				i_toastheap,
+				i_relfilenode,
+				i_reltablespace;
+	char	   *last_namespace = NULL,
+			   *last_tablespace = NULL;
 
 	ntups = PQntuples(res);
 
@@ -580,9 +681,6 @@ get_rel_infos(ClusterInfo *cluster, DbInfo *dbinfo)
 			/* A zero reltablespace oid indicates the database tablespace. */
 			curr->tablespace = dbinfo->db_tablespace;
 	}
-	PQclear(res);
-
-	PQfinish(conn);
 
 	dbinfo->rel_arr.rels = relinfos;
 	dbinfo->rel_arr.nrels = num_rels;
@@ -314,9 +314,27 @@ static void
 create_new_objects(void)
 {
 	int			dbnum;
+	int			ndbs = 0;
+	int			restore_jobs;
+	char		jobs_opt[32];
 
 	prep_status("Restoring database schemas in the new cluster\n");
 
+	/*
+	 * parallel_exec_prog() restores up to user_opts.jobs databases at once.
+	 * If there are fewer databases than that, let each pg_restore use the
+	 * spare slots to create post-data objects (indexes, constraints,
+	 * triggers) in parallel within its database, which is what dominates
+	 * the restore of a database with a huge number of objects.  The schema
+	 * dumps are in custom format, so pg_restore can do this.
+	 */
+	for (dbnum = 0; dbnum < old_cluster.dbarr.ndbs; dbnum++)
+	{
+		if (strcmp(old_cluster.dbarr.dbs[dbnum].db_name, "template1") != 0)
+			ndbs++;
+	}
+	restore_jobs = Max(user_opts.jobs / Max(ndbs, 1), 1);
+
 	/*
 	 * We cannot process the template1 database concurrently with others,
 	 * because when it's transiently dropped, connection attempts would fail.
@@ -345,15 +363,22 @@ create_new_objects(void)
 		 */
 		create_opts = "--clean --create";
 
+		/* nothing else runs during this pass, so use all the jobs */
+		if (user_opts.jobs > 1)
+			snprintf(jobs_opt, sizeof(jobs_opt), "--jobs=%d", user_opts.jobs);
+		else
+			jobs_opt[0] = '\0';
+
 		exec_prog(log_file_name,
 				  NULL,
 				  true,
 				  true,
-				  "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+				  "\"%s/pg_restore\" %s %s %s --exit-on-error --verbose "
 				  "--dbname postgres \"%s\"",
 				  new_cluster.bindir,
 				  cluster_conn_opts(&new_cluster),
 				  create_opts,
+				  jobs_opt,
 				  sql_file_name);
 
 		break;					/* done once we've processed template1 */
@@ -385,13 +410,19 @@ create_new_objects(void)
 		else
 			create_opts = "--create";
 
+		if (restore_jobs > 1)
+			snprintf(jobs_opt, sizeof(jobs_opt), "--jobs=%d", restore_jobs);
+		else
+			jobs_opt[0] = '\0';
+
 		parallel_exec_prog(log_file_name,
 						   NULL,
-						   "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+						   "\"%s/pg_restore\" %s %s %s --exit-on-error --verbose "
 						   "--dbname template1 \"%s\"",
 						   new_cluster.bindir,
 						   cluster_conn_opts(&new_cluster),
 						   create_opts,
+						   jobs_opt,
 						   sql_file_name);
 	}
 
@@ -38,6 +38,9 @@ transfer_all_new_tablespaces(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 		case TRANSFER_MODE_COPY:
 			pg_log(PG_REPORT, "Copying user relation files\n");
 			break;
+		case TRANSFER_MODE_COPY_FILE_RANGE:
+			pg_log(PG_REPORT, "Copying user relation files with copy_file_range\n");
+			break;
 		case TRANSFER_MODE_LINK:
 			pg_log(PG_REPORT, "Linking user relation files\n");
 			break;
@@ -267,6 +270,11 @@ transfer_relfile(FileNameMap *map, const char *type_suffix, bool vm_must_add_fro
 						   old_file, new_file);
 					copyFile(old_file, new_file, map->nspname, map->relname);
 					break;
+				case TRANSFER_MODE_COPY_FILE_RANGE:
+					pg_log(PG_VERBOSE, "copying \"%s\" to \"%s\" with copy_file_range\n",
+						   old_file, new_file);
+					copyFileByRange(old_file, new_file, map->nspname, map->relname);
+					break;
 				case TRANSFER_MODE_LINK:
 					pg_log(PG_VERBOSE, "linking \"%s\" to \"%s\"\n",
 						   old_file, new_file);
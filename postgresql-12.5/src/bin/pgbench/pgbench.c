@@ -37,6 +37,7 @@
 #include "fe_utils/conditional.h"
 #include "getopt_long.h"
 #include "libpq-fe.h"
+#include "port/pg_bitutils.h"
 #include "portability/instr_time.h"
 
 #include <ctype.h>
@@ -186,6 +187,21 @@ int64		latency_limit = 0;
 char	   *tablespace = NULL;
 char	   *index_tablespace = NULL;
 
+/*
+ * Number of "pgbench_accounts" partitions, 0 means no partitioning, and the
+ * partitioning method to use for them.
+ */
+int			partitions = 0;
+
+typedef enum
+{
+	PART_RANGE,					/* range partitions on aid */
+	PART_HASH					/* hash partitions on aid */
+} partition_method_t;
+
+partition_method_t partition_method = PART_RANGE;
+static const char *PARTITION_METHOD[] = {"range", "hash"};
+
 /* random seed used to initialize base_random_sequence */
 int64		random_seed = -1;
 
@@ -218,6 +234,7 @@ int			nclients = 1;		/* number of clients */
 int			nthreads = 1;		/* number of threads */
 bool		is_connect;			/* establish connection for each transaction */
 bool		report_per_command; /* report per-command latencies */
+bool		report_percentiles; /* report latency percentiles */
 int			main_pid;			/* main process id used in log filename */
 
 char	   *pghost = "";
@@ -229,6 +246,24 @@ const char *progname;
 
 #define WSEP '@'				/* weight separator */
 
+/*
+ * Connection targets, from several -h options each written HOST[@WEIGHT].
+ * Clients are spread over the targets in proportion to their weights.  With
+ * zero or one target, every connection just uses pghost.
+ */
+typedef struct HostTarget
+{
+	char	   *host;			/* value of the "host" connection parameter */
+	int			weight;			/* share of the clients */
+	int			nclients;		/* number of clients assigned */
+} HostTarget;
+
+#define MAX_HOSTS		64		/* max number of -h options */
+
+static HostTarget host_targets[MAX_HOSTS];
+static int	num_hosts = 0;
+static int64 total_host_weight = 0;
+
 volatile bool timer_exceeded = false;	/* flag from signal handler */
 
 /*
@@ -266,6 +301,28 @@ typedef struct SimpleStats
 	double		sum2;			/* sum of squared values */
 } SimpleStats;
 
+/*
+ * Latency histogram, for percentile reporting (--report-percentiles).
+ *
+ * As in HdrHistogram, the buckets are log-linear: values below
+ * HIST_SUB_BUCKETS microseconds get a bucket each, and every power of two
+ * above that is split into HIST_SUB_BUCKETS equal buckets, so a reported
+ * percentile is off by less than 1/HIST_SUB_BUCKETS of its value.  Values
+ * beyond 2^(HIST_MAX_BIT + 1) microseconds (about 25 days) share the last
+ * bucket.
+ */
+#define HIST_SUB_BITS		5
+#define HIST_SUB_BUCKETS	(1 << HIST_SUB_BITS)
+#define HIST_MAX_BIT		40
+#define HIST_BUCKETS		((HIST_MAX_BIT - HIST_SUB_BITS + 2) * HIST_SUB_BUCKETS)
+
+typedef struct LatencyHistogram
+{
+	int64		count;			/* number of values recorded */
+	double		max;			/* exact maximum value, in usec */
+	int64		buckets[HIST_BUCKETS];
+} LatencyHistogram;
+
 /*
  * Data structure to hold various statistics: per-thread and per-script stats
  * are maintained and merged together.
@@ -380,6 +437,7 @@ typedef struct
 {
 	PGconn	   *con;			/* connection handle to DB */
 	int			id;				/* client No. */
+	const char *host;			/* connection target of this client */
 	ConnectionStateEnum state;	/* state machine's current state. */
 	ConditionalStack cstack;	/* enclosing conditionals state */
 
@@ -436,6 +494,7 @@ typedef struct
 	instr_time	start_time;		/* thread start time */
 	instr_time	conn_time;
 	StatsData	stats;
+	LatencyHistogram *latency_hist; /* if --report-percentiles */
 	int64		latency_late;	/* executed but late transactions */
 } TState;
 
@@ -495,6 +554,8 @@ static const char *QUERYMODE[] = {"simple", "extended", "prepared"};
  *				variable name that receives the value.
  * expr			Parsed expression, if needed.
  * stats		Time spent in this command.
+ * latency_hist	Distribution of the time spent, if -r and --report-percentiles
+ *				are both given.
  */
 typedef struct Command
 {
@@ -507,6 +568,7 @@ typedef struct Command
 	char	   *varprefix;
 	PgBenchExpr *expr;
 	SimpleStats stats;
+	LatencyHistogram *latency_hist;
 } Command;
 
 typedef struct ParsedScript
@@ -515,6 +577,7 @@ typedef struct ParsedScript
 	int			weight;			/* selection weight */
 	Command   **commands;		/* NULL-terminated array of Commands */
 	StatsData	stats;			/* total time spent in script */
+	LatencyHistogram *latency_hist; /* if --report-percentiles */
 } ParsedScript;
 
 static ParsedScript sql_script[MAX_SCRIPTS];	/* SQL script files */
@@ -566,6 +629,37 @@ static const BuiltinScript builtin_script[] =
 		"<builtin: select only>",
 		"\\set aid random(1, " CppAsString2(naccounts) " * :scale)\n"
 		"SELECT abalance FROM pgbench_accounts WHERE aid = :aid;\n"
+	},
+
+	/*
+	 * A New-Order-like transaction, mapped onto the standard tables: the
+	 * branch plays the warehouse, one of its tellers the district whose
+	 * order counter is bumped, and five of its accounts the stock items of
+	 * the order lines, which are logged to pgbench_history.  Clients
+	 * contend on the tellers and on accounts of the same branch, so it
+	 * shows lock waits and multi-row updates that tpcb-like doesn't.
+	 */
+	{
+		"tpcc-like",
+		"<builtin: TPC-C new-order (sort of)>",
+		"\\set bid random(1, " CppAsString2(nbranches) " * :scale)\n"
+		"\\set tid random((:bid - 1) * " CppAsString2(ntellers) " + 1, :bid * " CppAsString2(ntellers) ")\n"
+		"\\set aid1 random((:bid - 1) * " CppAsString2(naccounts) " + 1, :bid * " CppAsString2(naccounts) ")\n"
+		"\\set aid2 random((:bid - 1) * " CppAsString2(naccounts) " + 1, :bid * " CppAsString2(naccounts) ")\n"
+		"\\set aid3 random((:bid - 1) * " CppAsString2(naccounts) " + 1, :bid * " CppAsString2(naccounts) ")\n"
+		"\\set aid4 random((:bid - 1) * " CppAsString2(naccounts) " + 1, :bid * " CppAsString2(naccounts) ")\n"
+		"\\set aid5 random((:bid - 1) * " CppAsString2(naccounts) " + 1, :bid * " CppAsString2(naccounts) ")\n"
+		"\\set qty random(1, 10)\n"
+		"BEGIN;\n"
+		"SELECT bbalance FROM pgbench_branches WHERE bid = :bid;\n"
+		"UPDATE pgbench_tellers SET tbalance = tbalance + 1 WHERE tid = :tid;\n"
+		"UPDATE pgbench_accounts SET abalance = abalance - :qty WHERE aid IN (:aid1, :aid2, :aid3, :aid4, :aid5);\n"
+		"SELECT sum(abalance) FROM pgbench_accounts WHERE aid IN (:aid1, :aid2, :aid3, :aid4, :aid5);\n"
+		"INSERT INTO pgbench_history (tid, bid, aid, delta, mtime) VALUES "
+		"(:tid, :bid, :aid1, :qty, CURRENT_TIMESTAMP), (:tid, :bid, :aid2, :qty, CURRENT_TIMESTAMP), "
+		"(:tid, :bid, :aid3, :qty, CURRENT_TIMESTAMP), (:tid, :bid, :aid4, :qty, CURRENT_TIMESTAMP), "
+		"(:tid, :bid, :aid5, :qty, CURRENT_TIMESTAMP);\n"
+		"END;\n"
 	}
 };
 
@@ -617,6 +711,9 @@ usage(void)
 		   "  --foreign-keys           create foreign key constraints between tables\n"
 		   "  --index-tablespace=TABLESPACE\n"
 		   "                           create indexes in the specified tablespace\n"
+		   "  --partition-method=(range|hash)\n"
+		   "                           partition pgbench_accounts with this method (default: range)\n"
+		   "  --partitions=NUM         partition pgbench_accounts into NUM parts (default: 0)\n"
 		   "  --tablespace=TABLESPACE  create tables in the specified tablespace\n"
 		   "  --unlogged-tables        create tables as unlogged tables\n"
 		   "\nOptions to select what to run:\n"
@@ -650,10 +747,12 @@ usage(void)
 		   "                           (default: \"pgbench_log\")\n"
 		   "  --progress-timestamp     use Unix epoch timestamps for progress\n"
 		   "  --random-seed=SEED       set random seed (\"time\", \"rand\", integer)\n"
+		   "  --report-percentiles     report latency percentiles (with -r, also per command)\n"
 		   "  --sampling-rate=NUM      fraction of transactions to log (e.g., 0.01 for 1%%)\n"
 		   "\nCommon options:\n"
 		   "  -d, --debug              print debugging output\n"
-		   "  -h, --host=HOSTNAME      database server host or socket directory\n"
+		   "  -h, --host=HOSTNAME[@W]  database server host or socket directory; when\n"
+		   "                           repeated, spread clients over hosts weighted at W\n"
 		   "  -p, --port=PORT          database server port number\n"
 		   "  -U, --username=USERNAME  connect as specified database user\n"
 		   "  -V, --version            output version information, then exit\n"
@@ -1078,6 +1177,101 @@ mergeSimpleStats(SimpleStats *acc, SimpleStats *ss)
 	acc->sum2 += ss->sum2;
 }
 
+/*
+ * Allocate a zeroed LatencyHistogram.
+ */
+static LatencyHistogram *
+createHistogram(void)
+{
+	return (LatencyHistogram *) pg_malloc0(sizeof(LatencyHistogram));
+}
+
+/*
+ * Bucket number of a latency of usec microseconds.
+ */
+static int
+histogramBucket(int64 usec)
+{
+	int			msb;
+	int			idx;
+
+	if (usec < HIST_SUB_BUCKETS)
+		return usec < 0 ? 0 : (int) usec;
+
+	/* top HIST_SUB_BITS + 1 significant bits select the bucket */
+	msb = pg_leftmost_one_pos64((uint64) usec);
+	idx = (msb - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS +
+		(int) ((usec >> (msb - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+
+	return Min(idx, HIST_BUCKETS - 1);
+}
+
+/*
+ * Largest latency, in microseconds, that falls into bucket idx.
+ */
+static int64
+histogramBucketTop(int idx)
+{
+	int			group = idx / HIST_SUB_BUCKETS;
+	int			sub = idx % HIST_SUB_BUCKETS;
+
+	if (group == 0)
+		return idx;
+	return ((int64) (HIST_SUB_BUCKETS + sub + 1) << (group - 1)) - 1;
+}
+
+/*
+ * Record one latency, in microseconds.
+ */
+static void
+addToHistogram(LatencyHistogram *hist, double usec)
+{
+	hist->buckets[histogramBucket((int64) usec)]++;
+	if (hist->count == 0 || usec > hist->max)
+		hist->max = usec;
+	hist->count++;
+}
+
+/*
+ * Merge two LatencyHistograms
+ */
+static void
+mergeHistogram(LatencyHistogram *acc, LatencyHistogram *hist)
+{
+	int			i;
+
+	if (hist->count == 0)
+		return;
+	if (acc->count == 0 || hist->max > acc->max)
+		acc->max = hist->max;
+	acc->count += hist->count;
+	for (i = 0; i < HIST_BUCKETS; i++)
+		acc->buckets[i] += hist->buckets[i];
+}
+
+/*
+ * Latency in microseconds below which the given fraction of the recorded
+ * values fall.  This is the top of the bucket reaching that rank, but never
+ * more than the exact maximum.
+ */
+static double
+histogramPercentile(LatencyHistogram *hist, double fraction)
+{
+	int64		rank = (int64) ceil(fraction * hist->count);
+	int64		seen = 0;
+	int			i;
+
+	if (rank < 1)
+		rank = 1;
+	for (i = 0; i < HIST_BUCKETS; i++)
+	{
+		seen += hist->buckets[i];
+		if (seen >= rank)
+			return Min((double) histogramBucketTop(i), hist->max);
+	}
+	return hist->max;
+}
+
 /*
  * Initialize a StatsData struct to mostly zeroes, with its start time set to
  * the given value.
@@ -1145,9 +1339,9 @@ tryExecuteStatement(PGconn *con, const char *sql)
 	PQclear(res);
 }
 
-/* set up a connection to the backend */
+/* set up a connection to the backend at the given host (NULL for pghost) */
 static PGconn *
-doConnect(void)
+doConnect(const char *host)
 {
 	PGconn	   *conn;
 	bool		new_pass;
@@ -1166,7 +1360,7 @@ doConnect(void)
 		const char *values[PARAMS_ARRAY_SIZE];
 
 		keywords[0] = "host";
-		values[0] = pghost;
+		values[0] = host ? host : pghost;
 		keywords[1] = "port";
 		values[1] = pgport;
 		keywords[2] = "user";
@@ -2916,7 +3110,7 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 
 					INSTR_TIME_SET_CURRENT_LAZY(now);
 					start = now;
-					if ((st->con = doConnect()) == NULL)
+					if ((st->con = doConnect(st->host)) == NULL)
 					{
 						fprintf(stderr, "client %d aborted while establishing connection\n",
 								st->id);
@@ -3230,6 +3424,10 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 					addToSimpleStats(&command->stats,
 									 INSTR_TIME_GET_DOUBLE(now) -
 									 INSTR_TIME_GET_DOUBLE(st->stmt_begin));
+					if (command->latency_hist)
+						addToHistogram(command->latency_hist,
+									   INSTR_TIME_GET_MICROSEC(now) -
+									   INSTR_TIME_GET_MICROSEC(st->stmt_begin));
 				}
 
 				/* Go ahead with next command, to be executed or skipped */
@@ -3533,7 +3731,8 @@ processXactStats(TState *thread, CState *st, instr_time *now,
 	double		latency = 0.0,
 				lag = 0.0;
 	bool		thread_details = progress || throttle_delay || latency_limit,
-				detailed = thread_details || use_log || per_script_stats;
+				detailed = thread_details || use_log || per_script_stats ||
+				report_percentiles;
 
 	if (detailed && !skipped)
 	{
@@ -3568,6 +3767,14 @@ processXactStats(TState *thread, CState *st, instr_time *now,
 	/* XXX could use a mutex here, but we choose not to */
 	if (per_script_stats)
 		accumStats(&sql_script[st->use_file].stats, skipped, latency, lag);
+
+	if (report_percentiles && !skipped)
+	{
+		addToHistogram(thread->latency_hist, latency);
+		/* XXX same as above */
+		if (per_script_stats)
+			addToHistogram(sql_script[st->use_file].latency_hist, latency);
+	}
 }
 
 
@@ -3600,6 +3807,73 @@ initDropTables(PGconn *con)
 					 "pgbench_tellers");
 }
 
+/*
+ * Create the partitions of pgbench_accounts, if --partitions was given
+ */
+static void
+createPartitions(PGconn *con)
+{
+	char		ff[64];
+	int			p;
+
+	Assert(partitions > 0);
+
+	fprintf(stderr, "creating %d partitions...\n", partitions);
+
+	ff[0] = '\0';
+
+	/* fillfactor is not allowed on the partitioned table, so put it here */
+	if (fillfactor < 100)
+		snprintf(ff, sizeof(ff), " with (fillfactor=%d)", fillfactor);
+
+	for (p = 1; p <= partitions; p++)
+	{
+		char		query[256];
+
+		if (partition_method == PART_RANGE)
+		{
+			int64		part_size = (naccounts * (int64) scale + partitions - 1) / partitions;
+			char		minvalue[32],
+						maxvalue[32];
+
+			/*
+			 * The first and last partitions are unbounded, so that inserting
+			 * outside the initialized range still works.
+			 */
+			if (p == 1)
+				strcpy(minvalue, "minvalue");
+			else
+				snprintf(minvalue, sizeof(minvalue), INT64_FORMAT,
+						 (p - 1) * part_size + 1);
+
+			if (p < partitions)
+				snprintf(maxvalue, sizeof(maxvalue), INT64_FORMAT,
+						 p * part_size + 1);
+			else
+				strcpy(maxvalue, "maxvalue");
+
+			snprintf(query, sizeof(query),
+					 "create%s table pgbench_accounts_%d\n"
+					 "  partition of pgbench_accounts\n"
+					 "  for values from (%s) to (%s)%s\n",
+					 unlogged_tables ? " unlogged" : "", p,
+					 minvalue, maxvalue, ff);
+		}
+		else
+		{
+			Assert(partition_method == PART_HASH);
+			snprintf(query, sizeof(query),
+					 "create%s table pgbench_accounts_%d\n"
+					 "  partition of pgbench_accounts\n"
+					 "  for values with (modulus %d, remainder %d)%s\n",
+					 unlogged_tables ? " unlogged" : "", p,
+					 partitions, p - 1, ff);
+		}
+
+		executeStatement(con, query);
+	}
+}
+
 /*
  * Create pgbench's standard tables
  */
@@ -3663,7 +3937,13 @@ initCreateTables(PGconn *con)
 
 		/* Construct new create table statement. */
 		opts[0] = '\0';
-		if (ddl->declare_fillfactor)
+
+		/* Partition pgbench_accounts table */
+		if (partitions > 0 && strcmp(ddl->table, "pgbench_accounts") == 0)
+			snprintf(opts + strlen(opts), sizeof(opts) - strlen(opts),
+					 " partition by %s (aid)",
+					 PARTITION_METHOD[partition_method]);
+		else if (ddl->declare_fillfactor)
 			snprintf(opts + strlen(opts), sizeof(opts) - strlen(opts),
 					 " with (fillfactor=%d)", fillfactor);
 		if (tablespace != NULL)
@@ -3685,6 +3965,9 @@ initCreateTables(PGconn *con)
 
 		executeStatement(con, buffer);
 	}
+
+	if (partitions > 0)
+		createPartitions(con);
 }
 
 /*
@@ -3934,7 +4217,7 @@ runInitSteps(const char *initialize_steps)
 	PGconn	   *con;
 	const char *step;
 
-	if ((con = doConnect()) == NULL)
+	if ((con = doConnect(NULL)) == NULL)
 		exit(1);
 
 	for (step = initialize_steps; *step != '\0'; step++)
@@ -4861,10 +5144,24 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 	}
 }
 
+static void
+printPercentiles(const char *prefix, LatencyHistogram *hist)
+{
+	if (hist != NULL && hist->count > 0)
+		printf("%s percentiles: p50 = %.3f ms, p90 = %.3f ms, p99 = %.3f ms, p99.9 = %.3f ms, max = %.3f ms\n",
+			   prefix,
+			   0.001 * histogramPercentile(hist, 0.50),
+			   0.001 * histogramPercentile(hist, 0.90),
+			   0.001 * histogramPercentile(hist, 0.99),
+			   0.001 * histogramPercentile(hist, 0.999),
+			   0.001 * hist->max);
+}
+
 /* print out results */
 static void
-printResults(StatsData *total, instr_time total_time,
-			 instr_time conn_total_time, int64 latency_late)
+printResults(StatsData *total, LatencyHistogram *total_hist,
+			 instr_time total_time, instr_time conn_total_time,
+			 int64 latency_late)
 {
 	double		time_include,
 				tps_include,
@@ -4885,6 +5182,15 @@ printResults(StatsData *total, instr_time total_time,
 	printf("query mode: %s\n", QUERYMODE[querymode]);
 	printf("number of clients: %d\n", nclients);
 	printf("number of threads: %d\n", nthreads);
+	if (num_hosts > 1)
+	{
+		int			i;
+
+		for (i = 0; i < num_hosts; i++)
+			printf("host %s: weight %d, %d clients\n",
+				   host_targets[i].host, host_targets[i].weight,
+				   host_targets[i].nclients);
+	}
 	if (duration <= 0)
 	{
 		printf("number of transactions per client: %d\n", nxacts);
@@ -4921,6 +5227,8 @@ printResults(StatsData *total, instr_time total_time,
 			   1000.0 * time_include * nclients / total->cnt);
 	}
 
+	printPercentiles("latency", total_hist);
+
 	if (throttle_delay)
 	{
 		/*
@@ -4963,6 +5271,7 @@ printResults(StatsData *total, instr_time total_time,
 						   100.0 * sstats->skipped / sstats->cnt);
 
 				printSimpleStats(" - latency", &sstats->latency);
+				printPercentiles(" - latency", sql_script[i].latency_hist);
 			}
 
 			/* Report per-command latencies */
@@ -4971,20 +5280,31 @@ printResults(StatsData *total, instr_time total_time,
 				Command   **commands;
 
 				if (per_script_stats)
-					printf(" - statement latencies in milliseconds:\n");
+					printf(" - statement latencies in milliseconds%s:\n",
+						   report_percentiles ? " (average, p50, p99, max)" : "");
 				else
-					printf("statement latencies in milliseconds:\n");
+					printf("statement latencies in milliseconds%s:\n",
+						   report_percentiles ? " (average, p50, p99, max)" : "");
 
 				for (commands = sql_script[i].commands;
 					 *commands != NULL;
 					 commands++)
 				{
 					SimpleStats *cstats = &(*commands)->stats;
-
-					printf("   %11.3f  %s\n",
-						   (cstats->count > 0) ?
-						   1000.0 * cstats->sum / cstats->count : 0.0,
-						   (*commands)->first_line);
+					LatencyHistogram *chist = (*commands)->latency_hist;
+
+					if (chist != NULL && chist->count > 0)
+						printf("   %11.3f %11.3f %11.3f %11.3f  %s\n",
+							   1000.0 * cstats->sum / cstats->count,
+							   0.001 * histogramPercentile(chist, 0.50),
+							   0.001 * histogramPercentile(chist, 0.99),
+							   0.001 * chist->max,
+							   (*commands)->first_line);
+					else
+						printf("   %11.3f  %s\n",
+							   (cstats->count > 0) ?
+							   1000.0 * cstats->sum / cstats->count : 0.0,
+							   (*commands)->first_line);
 				}
 			}
 		}
@@ -5088,6 +5408,9 @@ main(int argc, char **argv)
 		{"log-prefix", required_argument, NULL, 7},
 		{"foreign-keys", no_argument, NULL, 8},
 		{"random-seed", required_argument, NULL, 9},
+		{"partitions", required_argument, NULL, 10},
+		{"partition-method", required_argument, NULL, 11},
+		{"report-percentiles", no_argument, NULL, 12},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -5099,6 +5422,7 @@ main(int argc, char **argv)
 	bool		do_vacuum_accounts = false; /* vacuum accounts table? */
 	int			optindex;
 	bool		scale_given = false;
+	bool		partition_method_given = false;
 
 	bool		benchmarking_option_set = false;
 	bool		initialization_option_set = false;
@@ -5112,6 +5436,7 @@ main(int argc, char **argv)
 	instr_time	conn_total_time;
 	int64		latency_late = 0;
 	StatsData	stats;
+	LatencyHistogram *latency_hist;
 	int			weight;
 
 	int			i;
@@ -5177,7 +5502,16 @@ main(int argc, char **argv)
 				initialization_option_set = true;
 				break;
 			case 'h':
-				pghost = pg_strdup(optarg);
+				if (num_hosts >= MAX_HOSTS)
+				{
+					fprintf(stderr, "at most %d hosts can be specified\n",
+							MAX_HOSTS);
+					exit(1);
+				}
+				host_targets[num_hosts].weight =
+					parseScriptWeight(optarg, &host_targets[num_hosts].host);
+				total_host_weight += host_targets[num_hosts].weight;
+				num_hosts++;
 				break;
 			case 'n':
 				is_no_vacuum = true;
@@ -5440,6 +5774,34 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 10:			/* partitions */
+				initialization_option_set = true;
+				partitions = atoi(optarg);
+				if (partitions < 0)
+				{
+					fprintf(stderr, "invalid number of partitions: \"%s\"\n",
+							optarg);
+					exit(1);
+				}
+				break;
+			case 11:			/* partition-method */
+				initialization_option_set = true;
+				if (pg_strcasecmp(optarg, "range") == 0)
+					partition_method = PART_RANGE;
+				else if (pg_strcasecmp(optarg, "hash") == 0)
+					partition_method = PART_HASH;
+				else
+				{
+					fprintf(stderr, "invalid partition method, expecting \"range\" or \"hash\", got: \"%s\"\n",
+							optarg);
+					exit(1);
+				}
+				partition_method_given = true;
+				break;
+			case 12:			/* report-percentiles */
+				benchmarking_option_set = true;
+				report_percentiles = true;
+				break;
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit(1);
@@ -5478,6 +5840,28 @@ main(int argc, char **argv)
 	if (num_scripts > 1)
 		per_script_stats = true;
 
+	/* the first -h option also serves the setup connection */
+	if (num_hosts > 0)
+	{
+		if (total_host_weight == 0)
+		{
+			fprintf(stderr, "total host weight must not be zero\n");
+			exit(1);
+		}
+		if (num_hosts > 1 && is_init_mode)
+		{
+			fprintf(stderr, "only one host can be initialized at a time\n");
+			exit(1);
+		}
+		pghost = host_targets[0].host;
+	}
+
+	if (partition_method_given && partitions == 0)
+	{
+		fprintf(stderr, "--partition-method requires greater than zero --partitions\n");
+		exit(1);
+	}
+
 	/*
 	 * Don't need more threads than there are clients.  (This is not merely an
 	 * optimization; throttle_delay is calculated incorrectly below if some
@@ -5647,6 +6031,48 @@ main(int argc, char **argv)
 		initRandomState(&state[i].cs_func_rs);
 	}
 
+	/*
+	 * Spread clients over the hosts by weight: client i goes to the host
+	 * whose share of the total weight contains the middle of the i-th of
+	 * nclients equal slices, so that clients of a thread end up as mixed
+	 * as the weights allow.
+	 */
+	if (num_hosts > 1)
+	{
+		for (i = 0; i < nclients; i++)
+		{
+			int64		point = ((2 * (int64) i + 1) * total_host_weight) / (2 * nclients);
+			int64		w = 0;
+			int			h;
+
+			for (h = 0; h < num_hosts - 1; h++)
+			{
+				w += host_targets[h].weight;
+				if (point < w)
+					break;
+			}
+			state[i].host = host_targets[h].host;
+			host_targets[h].nclients++;
+		}
+	}
+
+	/* allocate latency histograms, now that the scripts are known */
+	if (report_percentiles)
+	{
+		for (i = 0; i < num_scripts; i++)
+		{
+			if (per_script_stats)
+				sql_script[i].latency_hist = createHistogram();
+			if (report_per_command)
+			{
+				Command   **commands = sql_script[i].commands;
+
+				for (int j = 0; commands[j] != NULL; j++)
+					commands[j]->latency_hist = createHistogram();
+			}
+		}
+	}
+
 	if (debug)
 	{
 		if (duration <= 0)
@@ -5658,7 +6084,7 @@ main(int argc, char **argv)
 	}
 
 	/* opening connection... */
-	con = doConnect();
+	con = doConnect(NULL);
 	if (con == NULL)
 		exit(1);
 
@@ -5783,6 +6209,7 @@ main(int argc, char **argv)
 		thread->logfile = NULL; /* filled in later */
 		thread->latency_late = 0;
 		initStats(&thread->stats, 0);
+		thread->latency_hist = report_percentiles ? createHistogram() : NULL;
 
 		nclients_dealt += thread->nstate;
 	}
@@ -5837,6 +6264,7 @@ main(int argc, char **argv)
 
 	/* wait for threads and accumulate results */
 	initStats(&stats, 0);
+	latency_hist = report_percentiles ? createHistogram() : NULL;
 	INSTR_TIME_SET_ZERO(conn_total_time);
 	for (i = 0; i < nthreads; i++)
 	{
@@ -5862,6 +6290,8 @@ main(int argc, char **argv)
 		mergeSimpleStats(&stats.lag, &thread->stats.lag);
 		stats.cnt += thread->stats.cnt;
 		stats.skipped += thread->stats.skipped;
+		if (report_percentiles)
+			mergeHistogram(latency_hist, thread->latency_hist);
 		latency_late += thread->latency_late;
 		INSTR_TIME_ADD(conn_total_time, thread->conn_time);
 	}
@@ -5879,7 +6309,8 @@ main(int argc, char **argv)
 	 */
 	INSTR_TIME_SET_CURRENT(total_time);
 	INSTR_TIME_SUBTRACT(total_time, start_time);
-	printResults(&stats, total_time, conn_total_time, latency_late);
+	printResults(&stats, latency_hist, total_time, conn_total_time,
+				 latency_late);
 
 	if (exit_code != 0)
 		fprintf(stderr, "Run was aborted; the above results are incomplete.\n");
@@ -5946,7 +6377,7 @@ threadRun(void *arg)
 		/* make connections to the database before starting */
 		for (i = 0; i < nstate; i++)
 		{
-			if ((state[i].con = doConnect()) == NULL)
+			if ((state[i].con = doConnect(state[i].host)) == NULL)
 				goto done;
 		}
 	}
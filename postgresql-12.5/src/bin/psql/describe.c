@@ -1933,6 +1933,9 @@ describeOneTableDetails(const char *schemaname,
 			if (tableinfo.relpersistence == 'u')
 				printfPQExpBuffer(&title, _("Unlogged table \"%s.%s\""),
 								  schemaname, relationname);
+			else if (tableinfo.relpersistence == 'g')
+				printfPQExpBuffer(&title, _("Global temporary table \"%s.%s\""),
+								  schemaname, relationname);
 			else
 				printfPQExpBuffer(&title, _("Table \"%s.%s\""),
 								  schemaname, relationname);
@@ -1953,6 +1956,9 @@ describeOneTableDetails(const char *schemaname,
 			if (tableinfo.relpersistence == 'u')
 				printfPQExpBuffer(&title, _("Unlogged index \"%s.%s\""),
 								  schemaname, relationname);
+			else if (tableinfo.relpersistence == 'g')
+				printfPQExpBuffer(&title, _("Global temporary index \"%s.%s\""),
+								  schemaname, relationname);
 			else
 				printfPQExpBuffer(&title, _("Index \"%s.%s\""),
 								  schemaname, relationname);
@@ -5723,6 +5729,7 @@ describePublications(const char *pattern)
 	int			i;
 	PGresult   *res;
 	bool		has_pubtruncate;
+	bool		has_pubfilters = false;
 
 	if (pset.sversion < 100000)
 	{
@@ -5738,6 +5745,26 @@ describePublications(const char *pattern)
 
 	initPQExpBuffer(&buf);
 
+	/*
+	 * Row filters and column lists can't be detected from the server version
+	 * alone, so check for the catalog column instead.
+	 */
+	if (pset.sversion >= 120000)
+	{
+		printfPQExpBuffer(&buf,
+						  "SELECT EXISTS (SELECT 1 FROM pg_catalog.pg_attribute\n"
+						  "WHERE attrelid = 'pg_catalog.pg_publication_rel'::pg_catalog.regclass\n"
+						  "  AND attname = 'prqual')");
+		res = PSQLexec(buf.data);
+		if (!res)
+		{
+			termPQExpBuffer(&buf);
+			return false;
+		}
+		has_pubfilters = (strcmp(PQgetvalue(res, 0, 0), "t") == 0);
+		PQclear(res);
+	}
+
 	printfPQExpBuffer(&buf,
 					  "SELECT oid, pubname,\n"
 					  "  pg_catalog.pg_get_userbyid(pubowner) AS owner,\n"
@@ -5818,8 +5845,16 @@ describePublications(const char *pattern)
 		if (!puballtables)
 		{
 			printfPQExpBuffer(&buf,
-							  "SELECT n.nspname, c.relname\n"
-							  "FROM pg_catalog.pg_class c,\n"
+							  "SELECT n.nspname, c.relname");
+			if (has_pubfilters)
+				appendPQExpBufferStr(&buf,
+									 ",\n  pg_catalog.pg_get_expr(pr.prqual, c.oid),\n"
+									 "  (SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', '\n"
+									 "                                ORDER BY a.attnum)\n"
+									 "   FROM pg_catalog.pg_attribute a\n"
+									 "   WHERE a.attrelid = c.oid AND a.attnum = ANY (pr.prattrs))");
+			appendPQExpBuffer(&buf,
+							  "\nFROM pg_catalog.pg_class c,\n"
 							  "     pg_catalog.pg_namespace n,\n"
 							  "     pg_catalog.pg_publication_rel pr\n"
 							  "WHERE c.relnamespace = n.oid\n"
@@ -5847,6 +5882,12 @@ describePublications(const char *pattern)
 				printfPQExpBuffer(&buf, "    \"%s.%s\"",
 								  PQgetvalue(tabres, j, 0),
 								  PQgetvalue(tabres, j, 1));
+				if (has_pubfilters && !PQgetisnull(tabres, j, 3))
+					appendPQExpBuffer(&buf, " (%s)",
+									  PQgetvalue(tabres, j, 3));
+				if (has_pubfilters && !PQgetisnull(tabres, j, 2))
+					appendPQExpBuffer(&buf, " WHERE %s",
+									  PQgetvalue(tabres, j, 2));
 
 				printTableAddFooter(&cont, buf.data);
 			}
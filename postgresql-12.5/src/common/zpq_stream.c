@@ -0,0 +1,672 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.c
+ *	  Streaming compression for the frontend/backend protocol
+ *
+ * A ZpqStream sits between the message buffers of pqcomm.c (or libpq) and
+ * the transport layer, which might itself be SSL or GSSAPI encrypted.
+ * Outgoing data is compressed and flushed on every write call, so that the
+ * peer can decode everything written so far without waiting for more;
+ * incoming data is decompressed as it arrives.  Each direction is a single
+ * compressed stream lasting for the life of the connection, which lets the
+ * compressor exploit redundancy between messages (row descriptions,
+ * repeated column values, WAL records) rather than only within them.
+ *
+ * zstd, LZ4 (frame format) and zlib are supported, depending on what the
+ * build was configured with.  The client offers every algorithm it has, in
+ * that order of preference, and the server picks the first one it also
+ * has; zstd gives the best ratio for the CPU spent, LZ4 is the cheapest,
+ * and zlib is the fallback that nearly every build has.
+ *
+ * The code is used by both frontend and backend, so it uses plain malloc
+ * and reports failures through return values rather than elog.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/common/zpq_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#include "common/zpq_stream.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#define ZPQ_BUFFER_SIZE			8192
+
+/*
+ * The protocol stream is latency sensitive, so favour speed over ratio;
+ * the fastest level of each library already removes most of the redundancy
+ * in typical result sets.
+ */
+#define ZPQ_ZLIB_LEVEL			Z_BEST_SPEED
+#define ZPQ_ZSTD_LEVEL			1
+
+typedef enum ZpqAlgorithm
+{
+	ZPQ_ZSTD,
+	ZPQ_LZ4,
+	ZPQ_ZLIB
+} ZpqAlgorithm;
+
+/* Algorithms available in this build, most preferred first */
+static const struct
+{
+	const char *name;
+	ZpqAlgorithm algorithm;
+}			zpq_algorithms[] =
+{
+#ifdef USE_ZSTD
+	{ZPQ_ALGORITHM_ZSTD, ZPQ_ZSTD},
+#endif
+#ifdef USE_LZ4
+	{ZPQ_ALGORITHM_LZ4, ZPQ_LZ4},
+#endif
+#ifdef HAVE_LIBZ
+	{ZPQ_ALGORITHM_ZLIB, ZPQ_ZLIB},
+#endif
+	{NULL, 0}
+};
+
+struct ZpqStream
+{
+	ZpqAlgorithm algorithm;
+	zpq_tx_func tx_func;
+	zpq_rx_func rx_func;
+	void	   *arg;
+
+	/* compressed data waiting to be sent is tx_buf[tx_pos .. tx_end) */
+	char	   *tx_buf;
+	size_t		tx_buf_size;
+	size_t		tx_pos;
+	size_t		tx_end;
+	bool		tx_flush_pending;	/* flush not yet completely emitted */
+
+	/* compressed input not yet decompressed is rx_buf[rx_pos .. rx_end) */
+	char	   *rx_buf;
+	size_t		rx_buf_size;
+	size_t		rx_pos;
+	size_t		rx_end;
+	bool		rx_not_drained; /* decompressor may have more output */
+
+	const char *errmsg;			/* description of the last failure */
+
+	union
+	{
+#ifdef HAVE_LIBZ
+		struct
+		{
+			z_stream	tx;		/* deflate state for outgoing data */
+			z_stream	rx;		/* inflate state for incoming data */
+		}			zlib;
+#endif
+#ifdef USE_LZ4
+		struct
+		{
+			LZ4F_cctx  *tx;
+			LZ4F_dctx  *rx;
+		}			lz4;
+#endif
+#ifdef USE_ZSTD
+		struct
+		{
+			ZSTD_CStream *tx;
+			ZSTD_DStream *rx;
+		}			zstd;
+#endif
+		int			dummy;		/* keep the union nonempty */
+	}			u;
+};
+
+static bool zpq_init(ZpqStream *zs);
+static ssize_t zpq_compress(ZpqStream *zs, const char *src, size_t len);
+static ssize_t zpq_decompress(ZpqStream *zs, char *dst, size_t len);
+static void zpq_end(ZpqStream *zs);
+
+/*
+ * Is the named algorithm one we can use?
+ */
+bool
+zpq_algorithm_supported(const char *name)
+{
+	int			i;
+
+	for (i = 0; zpq_algorithms[i].name != NULL; i++)
+	{
+		if (strcmp(name, zpq_algorithms[i].name) == 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Store a comma-separated list of the algorithms this build supports, most
+ * preferred first, into buf, as offered by a client.  The list is empty if
+ * there are none.
+ */
+void
+zpq_algorithm_list(char *buf, size_t size)
+{
+	int			i;
+
+	buf[0] = '\0';
+	for (i = 0; zpq_algorithms[i].name != NULL; i++)
+	{
+		if (i > 0)
+			strlcat(buf, ",", size);
+		strlcat(buf, zpq_algorithms[i].name, size);
+	}
+}
+
+/*
+ * Create a compression stream using the named algorithm.
+ *
+ * rx_data/rx_len is compressed input that was already read from the
+ * transport before compression was switched on; it is consumed before
+ * anything further is read with rx_func.
+ *
+ * Returns NULL if the algorithm is not supported, on out-of-memory, or if
+ * the compression library cannot be initialized.
+ */
+ZpqStream *
+zpq_create(const char *algorithm,
+		   zpq_tx_func tx_func, zpq_rx_func rx_func, void *arg,
+		   const char *rx_data, size_t rx_len)
+{
+	ZpqStream  *zs;
+	int			i;
+
+	for (i = 0; zpq_algorithms[i].name != NULL; i++)
+	{
+		if (strcmp(algorithm, zpq_algorithms[i].name) == 0)
+			break;
+	}
+	if (zpq_algorithms[i].name == NULL)
+		return NULL;
+
+	zs = (ZpqStream *) malloc(sizeof(ZpqStream));
+	if (zs == NULL)
+		return NULL;
+	memset(zs, 0, sizeof(ZpqStream));
+	zs->algorithm = zpq_algorithms[i].algorithm;
+
+	zs->tx_buf_size = ZPQ_BUFFER_SIZE;
+	zs->rx_buf_size = Max(rx_len, ZPQ_BUFFER_SIZE);
+	zs->rx_buf = malloc(zs->rx_buf_size);
+	if (zs->rx_buf == NULL)
+	{
+		free(zs);
+		return NULL;
+	}
+
+	/* this sets up tx_buf, whose size depends on the algorithm */
+	if (!zpq_init(zs))
+	{
+		free(zs->tx_buf);
+		free(zs->rx_buf);
+		free(zs);
+		return NULL;
+	}
+
+	zs->tx_func = tx_func;
+	zs->rx_func = rx_func;
+	zs->arg = arg;
+
+	if (rx_len > 0)
+		memcpy(zs->rx_buf, rx_data, rx_len);
+	zs->rx_end = rx_len;
+
+	return zs;
+}
+
+/*
+ * Read up to size bytes of decompressed data into buf.
+ *
+ * Returns the number of bytes stored, or the (<= 0) result of rx_func if
+ * no data could be produced, or ZPQ_STREAM_ERROR if the input is corrupt.
+ * The transport is only read when nothing buffered remains to be
+ * decompressed.
+ */
+ssize_t
+zpq_read(ZpqStream *zs, void *buf, size_t size)
+{
+	for (;;)
+	{
+		ssize_t		rc;
+
+		if (zs->rx_pos < zs->rx_end || zs->rx_not_drained)
+		{
+			size_t		rx_pos = zs->rx_pos;
+
+			rc = zpq_decompress(zs, buf, size);
+			if (rc < 0)
+				return ZPQ_STREAM_ERROR;
+
+			/* A full output buffer means there might be more to give */
+			zs->rx_not_drained = ((size_t) rc == size);
+			if (rc > 0)
+				return rc;
+
+			/* Input that produces nothing and isn't consumed is bogus */
+			if (zs->rx_pos < zs->rx_end)
+			{
+				if (zs->rx_pos == rx_pos)
+				{
+					zs->errmsg = "corrupt compressed data";
+					return ZPQ_STREAM_ERROR;
+				}
+				continue;
+			}
+		}
+
+		/* Everything buffered has been decompressed; fetch more input */
+		Assert(zs->rx_pos == zs->rx_end);
+		rc = zs->rx_func(zs->arg, zs->rx_buf, zs->rx_buf_size);
+		if (rc <= 0)
+			return rc;
+		zs->rx_pos = 0;
+		zs->rx_end = rc;
+	}
+}
+
+/*
+ * Compress and transmit size bytes from buf.
+ *
+ * Returns the number of input bytes consumed.  Consumed data may still be
+ * held in the stream if the transport would not accept all of it; call
+ * zpq_write again (size may be zero) while zpq_buffered_tx() reports data
+ * pending.  If no input could be consumed because the transport failed or
+ * would block, the transport's (<= 0) result is returned.
+ */
+ssize_t
+zpq_write(ZpqStream *zs, const void *buf, size_t size)
+{
+	size_t		consumed = 0;
+
+	for (;;)
+	{
+		ssize_t		rc;
+
+		/* Push out whatever compressed data we have accumulated */
+		while (zs->tx_pos < zs->tx_end)
+		{
+			rc = zs->tx_func(zs->arg, zs->tx_buf + zs->tx_pos,
+							 zs->tx_end - zs->tx_pos);
+			if (rc <= 0)
+				return consumed > 0 ? (ssize_t) consumed : rc;
+			zs->tx_pos += rc;
+		}
+		zs->tx_pos = zs->tx_end = 0;
+
+		if (consumed == size && !zs->tx_flush_pending)
+			return consumed;
+
+		rc = zpq_compress(zs, (const char *) buf + consumed, size - consumed);
+		if (rc < 0)
+			return ZPQ_STREAM_ERROR;
+		consumed += rc;
+	}
+}
+
+/*
+ * Is there compressed output that hasn't been handed to the transport yet?
+ */
+bool
+zpq_buffered_tx(ZpqStream *zs)
+{
+	return zs->tx_flush_pending || zs->tx_pos < zs->tx_end;
+}
+
+/*
+ * Could zpq_read return data without reading from the transport?
+ *
+ * Callers that wait for the socket to become readable must check this
+ * first, much as they do for data buffered inside the SSL library.
+ */
+bool
+zpq_buffered_rx(ZpqStream *zs)
+{
+	return zs->rx_pos < zs->rx_end || zs->rx_not_drained;
+}
+
+/*
+ * Describe the last ZPQ_STREAM_ERROR.
+ */
+const char *
+zpq_error(ZpqStream *zs)
+{
+	if (zs->errmsg)
+		return zs->errmsg;
+	return "corrupt compressed data";
+}
+
+/*
+ * Release a compression stream.
+ */
+void
+zpq_free(ZpqStream *zs)
+{
+	if (zs == NULL)
+		return;
+	zpq_end(zs);
+	free(zs->tx_buf);
+	free(zs->rx_buf);
+	free(zs);
+}
+
+/*
+ * The algorithm-specific parts follow.
+ *
+ * zpq_compress consumes input into the free space of tx_buf, which the
+ * caller has emptied, and flushes it so that the peer can decode all of it;
+ * if the output didn't fit, it sets tx_flush_pending and expects to be
+ * called again, possibly with no input.  It returns the number of input
+ * bytes consumed.  zpq_decompress decompresses input from rx_buf into dst
+ * and returns the number of bytes produced.  Both return -1 on failure,
+ * with errmsg set.
+ */
+
+/*
+ * Set up the compressor and decompressor, and allocate tx_buf.
+ */
+static bool
+zpq_init(ZpqStream *zs)
+{
+	switch (zs->algorithm)
+	{
+		case ZPQ_ZLIB:
+#ifdef HAVE_LIBZ
+			zs->tx_buf = malloc(zs->tx_buf_size);
+			if (zs->tx_buf == NULL)
+				return false;
+			if (deflateInit(&zs->u.zlib.tx, ZPQ_ZLIB_LEVEL) != Z_OK)
+				return false;
+			if (inflateInit(&zs->u.zlib.rx) != Z_OK)
+			{
+				deflateEnd(&zs->u.zlib.tx);
+				return false;
+			}
+			return true;
+#endif
+			break;
+
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			{
+				LZ4F_preferences_t prefs;
+				size_t		n;
+
+				/*
+				 * With autoFlush, every LZ4F_compressUpdate call emits all of
+				 * its input, so no separate flush is needed.  Blocks stay
+				 * linked, so later messages can still refer back to earlier
+				 * ones.  Size tx_buf so that a whole ZPQ_BUFFER_SIZE chunk of
+				 * input always fits.
+				 */
+				memset(&prefs, 0, sizeof(prefs));
+				prefs.autoFlush = 1;
+				prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+				prefs.frameInfo.blockMode = LZ4F_blockLinked;
+
+				zs->tx_buf_size = Max(LZ4F_compressBound(ZPQ_BUFFER_SIZE, &prefs),
+									  LZ4F_HEADER_SIZE_MAX);
+				zs->tx_buf = malloc(zs->tx_buf_size);
+				if (zs->tx_buf == NULL)
+					return false;
+
+				if (LZ4F_isError(LZ4F_createCompressionContext(&zs->u.lz4.tx,
+															   LZ4F_VERSION)))
+					return false;
+				if (LZ4F_isError(LZ4F_createDecompressionContext(&zs->u.lz4.rx,
+																 LZ4F_VERSION)))
+				{
+					LZ4F_freeCompressionContext(zs->u.lz4.tx);
+					return false;
+				}
+
+				/* The frame header goes out with the first write */
+				n = LZ4F_compressBegin(zs->u.lz4.tx, zs->tx_buf,
+									   zs->tx_buf_size, &prefs);
+				if (LZ4F_isError(n))
+				{
+					LZ4F_freeCompressionContext(zs->u.lz4.tx);
+					LZ4F_freeDecompressionContext(zs->u.lz4.rx);
+					return false;
+				}
+				zs->tx_end = n;
+				return true;
+			}
+#endif
+			break;
+
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			zs->tx_buf = malloc(zs->tx_buf_size);
+			if (zs->tx_buf == NULL)
+				return false;
+			zs->u.zstd.tx = ZSTD_createCStream();
+			if (zs->u.zstd.tx == NULL)
+				return false;
+			zs->u.zstd.rx = ZSTD_createDStream();
+			if (zs->u.zstd.rx == NULL)
+			{
+				ZSTD_freeCStream(zs->u.zstd.tx);
+				return false;
+			}
+			if (ZSTD_isError(ZSTD_CCtx_setParameter(zs->u.zstd.tx,
+													ZSTD_c_compressionLevel,
+													ZPQ_ZSTD_LEVEL)) ||
+				ZSTD_isError(ZSTD_initDStream(zs->u.zstd.rx)))
+			{
+				ZSTD_freeCStream(zs->u.zstd.tx);
+				ZSTD_freeDStream(zs->u.zstd.rx);
+				return false;
+			}
+			return true;
+#endif
+			break;
+	}
+
+	return false;
+}
+
+static ssize_t
+zpq_compress(ZpqStream *zs, const char *src, size_t len)
+{
+	switch (zs->algorithm)
+	{
+		case ZPQ_ZLIB:
+#ifdef HAVE_LIBZ
+			{
+				z_stream   *tx = &zs->u.zlib.tx;
+				int			zrc;
+
+				tx->next_in = (Bytef *) src;
+				tx->avail_in = len;
+				tx->next_out = (Bytef *) zs->tx_buf + zs->tx_end;
+				tx->avail_out = zs->tx_buf_size - zs->tx_end;
+				zrc = deflate(tx, Z_SYNC_FLUSH);
+				if (zrc != Z_OK && zrc != Z_BUF_ERROR)
+				{
+					zs->errmsg = tx->msg;
+					return -1;
+				}
+				zs->tx_end = zs->tx_buf_size - tx->avail_out;
+
+				/* If the output buffer filled up, the flush may be incomplete */
+				zs->tx_flush_pending = (tx->avail_out == 0);
+				return len - tx->avail_in;
+			}
+#endif
+			break;
+
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		chunk = Min(len, ZPQ_BUFFER_SIZE);
+				size_t		n;
+
+				/* autoFlush means nothing is ever left pending */
+				if (chunk == 0)
+				{
+					zs->tx_flush_pending = false;
+					return 0;
+				}
+				Assert(zs->tx_end == 0);
+				n = LZ4F_compressUpdate(zs->u.lz4.tx, zs->tx_buf,
+										zs->tx_buf_size, src, chunk, NULL);
+				if (LZ4F_isError(n))
+				{
+					zs->errmsg = LZ4F_getErrorName(n);
+					return -1;
+				}
+				zs->tx_end = n;
+				zs->tx_flush_pending = false;
+				return chunk;
+			}
+#endif
+			break;
+
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {src, len, 0};
+				ZSTD_outBuffer out = {zs->tx_buf, zs->tx_buf_size, zs->tx_end};
+				size_t		remaining;
+
+				remaining = ZSTD_compressStream2(zs->u.zstd.tx, &out, &in,
+												 ZSTD_e_flush);
+				if (ZSTD_isError(remaining))
+				{
+					zs->errmsg = ZSTD_getErrorName(remaining);
+					return -1;
+				}
+				zs->tx_end = out.pos;
+
+				/* nonzero means the flush didn't fit in the output buffer */
+				zs->tx_flush_pending = (remaining != 0);
+				return in.pos;
+			}
+#endif
+			break;
+	}
+
+	zs->errmsg = "unsupported compression algorithm";
+	return -1;
+}
+
+static ssize_t
+zpq_decompress(ZpqStream *zs, char *dst, size_t len)
+{
+	switch (zs->algorithm)
+	{
+		case ZPQ_ZLIB:
+#ifdef HAVE_LIBZ
+			{
+				z_stream   *rx = &zs->u.zlib.rx;
+				int			zrc;
+
+				rx->next_in = (Bytef *) zs->rx_buf + zs->rx_pos;
+				rx->avail_in = zs->rx_end - zs->rx_pos;
+				rx->next_out = (Bytef *) dst;
+				rx->avail_out = len;
+				zrc = inflate(rx, Z_SYNC_FLUSH);
+				if (zrc != Z_OK && zrc != Z_BUF_ERROR)
+				{
+					zs->errmsg = rx->msg;
+					return -1;
+				}
+				zs->rx_pos = zs->rx_end - rx->avail_in;
+				return len - rx->avail_out;
+			}
+#endif
+			break;
+
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		dst_len = len;
+				size_t		src_len = zs->rx_end - zs->rx_pos;
+				size_t		n;
+
+				n = LZ4F_decompress(zs->u.lz4.rx, dst, &dst_len,
+									zs->rx_buf + zs->rx_pos, &src_len, NULL);
+				if (LZ4F_isError(n))
+				{
+					zs->errmsg = LZ4F_getErrorName(n);
+					return -1;
+				}
+				zs->rx_pos += src_len;
+				return dst_len;
+			}
+#endif
+			break;
+
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {zs->rx_buf, zs->rx_end, zs->rx_pos};
+				ZSTD_outBuffer out = {dst, len, 0};
+				size_t		n;
+
+				n = ZSTD_decompressStream(zs->u.zstd.rx, &out, &in);
+				if (ZSTD_isError(n))
+				{
+					zs->errmsg = ZSTD_getErrorName(n);
+					return -1;
+				}
+				zs->rx_pos = in.pos;
+				return out.pos;
+			}
+#endif
+			break;
+	}
+
+	zs->errmsg = "unsupported compression algorithm";
+	return -1;
+}
+
+static void
+zpq_end(ZpqStream *zs)
+{
+	switch (zs->algorithm)
+	{
+		case ZPQ_ZLIB:
+#ifdef HAVE_LIBZ
+			deflateEnd(&zs->u.zlib.tx);
+			inflateEnd(&zs->u.zlib.rx);
+#endif
+			break;
+
+		case ZPQ_LZ4:
+#ifdef USE_LZ4
+			LZ4F_freeCompressionContext(zs->u.lz4.tx);
+			LZ4F_freeDecompressionContext(zs->u.lz4.rx);
+#endif
+			break;
+
+		case ZPQ_ZSTD:
+#ifdef USE_ZSTD
+			ZSTD_freeCStream(zs->u.zstd.tx);
+			ZSTD_freeDStream(zs->u.zstd.rx);
+#endif
+			break;
+	}
+}
@@ -156,6 +156,20 @@ typedef void (*aminitparallelscan_function) (void *target);
 /* (re)start parallel index scan */
 typedef void (*amparallelrescan_function) (IndexScanDesc scan);
 
+/*
+ * Flags for IndexAmRoutine.amparallelvacuumoptions, saying which phases of
+ * VACUUM a parallel worker may run for an index of this AM.  COND_CLEANUP
+ * means that amvacuumcleanup is only worth running in a worker when
+ * ambulkdelete wasn't called first, as it's cheap otherwise.  An AM that sets
+ * any of these must return a plain, self-contained IndexBulkDeleteResult from
+ * ambulkdelete and amvacuumcleanup, because the result may be handed over to
+ * another process between calls.
+ */
+#define VACUUM_OPTION_NO_PARALLEL			0
+#define VACUUM_OPTION_PARALLEL_BULKDEL		(1 << 0)
+#define VACUUM_OPTION_PARALLEL_COND_CLEANUP	(1 << 1)
+#define VACUUM_OPTION_PARALLEL_CLEANUP		(1 << 2)
+
 /*
  * API struct for an index AM.  Note this must be stored in a single palloc'd
  * chunk of memory.
@@ -197,6 +211,10 @@ typedef struct IndexAmRoutine
 	bool		amcanparallel;
 	/* does AM support columns included with clause INCLUDE? */
 	bool		amcaninclude;
+	/* can AM take WARM updates (return index tuples for key rechecks)? */
+	bool		amcanwarm;
+	/* OR of VACUUM_OPTION_* flags: can VACUUM phases run in parallel? */
+	uint8		amparallelvacuumoptions;
 	/* type of data stored in index, or InvalidOid if variable */
 	Oid			amkeytype;
 
@@ -13,6 +13,7 @@
 
 #include "access/amapi.h"
 #include "storage/bufpage.h"
+#include "storage/shm_toc.h"
 #include "utils/typcache.h"
 
 
@@ -103,6 +104,7 @@ extern IndexBulkDeleteResult *brinbulkdelete(IndexVacuumInfo *info,
 extern IndexBulkDeleteResult *brinvacuumcleanup(IndexVacuumInfo *info,
 												IndexBulkDeleteResult *stats);
 extern bytea *brinoptions(Datum reloptions, bool validate);
+extern void _brin_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* brin_validate.c */
 extern bool brinvalidate(Oid opclassoid);
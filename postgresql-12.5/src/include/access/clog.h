@@ -13,6 +13,7 @@
 
 #include "access/xlogreader.h"
 #include "lib/stringinfo.h"
+#include "utils/guc.h"
 
 /*
  * Possible transaction statuses --- note that all-zeroes is the initial
@@ -39,6 +40,12 @@ extern void TransactionIdSetTreeStatus(TransactionId xid, int nsubxids,
 									   TransactionId *subxids, XidStatus status, XLogRecPtr lsn);
 extern XidStatus TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn);
 
+/* GUC parameter */
+extern int	transaction_buffers;
+
+extern bool check_transaction_buffers(int *newval, void **extra,
+									  GucSource source);
+
 extern Size CLOGShmemBuffers(void);
 extern Size CLOGShmemSize(void);
 extern void CLOGShmemInit(void);
@@ -0,0 +1,172 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar.h
+ *	  POSTGRES column-oriented table access method definitions.
+ *
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/columnar.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "access/htup_details.h"
+#include "access/tupdesc.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "storage/bufmgr.h"
+#include "storage/itemptr.h"
+#include "storage/relfilenode.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/*
+ * A columnar table is an append-only byte stream of "stripes", each holding
+ * a batch of rows stored column by column.  Block 0 is a metapage; the
+ * stream is laid out over the data area of blocks 1 and up, so stream
+ * offset N lives in block 1 + N / COLUMNAR_PAGE_DATA.  Every stripe starts
+ * at a MAXALIGN'd stream offset with a ColumnarStripeHeader, followed by one
+ * ColumnarChunkInfo per column, the serialized min/max values, and then the
+ * column chunks themselves.
+ *
+ * A chunk holds the column's values for all rows of the stripe: a null
+ * bitmap (only if there are nulls) padded to MAXALIGN, then the non-null
+ * values laid out and aligned as in a heap tuple, except that varlenas are
+ * always stored uncompressed with a 4-byte header.  That allows values to
+ * be used in place once the chunk has been read and decompressed.
+ *
+ * Stripes are never updated, except for the xmin field of the header, which
+ * VACUUM overwrites with FrozenTransactionId once the inserting transaction
+ * is known committed and visible to everyone, or with InvalidTransactionId
+ * if it aborted.
+ */
+#define COLUMNAR_METAPAGE_BLKNO		0
+#define COLUMNAR_MAGIC				0x436F6C53
+#define COLUMNAR_VERSION			1
+
+#define COLUMNAR_PAGE_DATA			(BLCKSZ - SizeOfPageHeaderData)
+
+typedef struct ColumnarMetaPageData
+{
+	uint32		magic;
+	uint32		version;
+	uint64		nstripes;		/* number of stripes in the stream */
+	uint64		stream_end;		/* stream offset just past the last stripe */
+	uint64		next_row;		/* first row number not yet reserved */
+	uint64		nrows;			/* rows in all stripes, visible or not */
+} ColumnarMetaPageData;
+
+typedef struct ColumnarStripeHeader
+{
+	TransactionId xmin;			/* inserting (sub)transaction */
+	CommandId	cid;			/* inserting command */
+	uint32		magic;
+	uint32		natts;			/* number of columns stored */
+	uint64		first_row;		/* row number of the first row */
+	uint32		nrows;			/* number of rows */
+	uint32		hdrlen;			/* length of header, chunk infos, min/max */
+	uint64		length;			/* total length of the stripe */
+} ColumnarStripeHeader;
+
+/* compression methods for chunks, also the values of columnar_compression */
+#define COLUMNAR_COMPRESSION_NONE	0
+#define COLUMNAR_COMPRESSION_PGLZ	1
+#define COLUMNAR_COMPRESSION_LZ4	2
+
+/* ColumnarChunkInfo flags */
+#define COLUMNAR_CHUNK_HAS_NULLS	0x01	/* chunk starts with a null bitmap */
+#define COLUMNAR_CHUNK_HAS_MINMAX	0x02	/* min/max values are stored */
+
+typedef struct ColumnarChunkInfo
+{
+	uint64		offset;			/* offset of the chunk in the stripe */
+	uint32		rawlen;			/* length before compression */
+	uint32		storedlen;		/* length as stored */
+	uint32		nnulls;			/* number of null values */
+	uint32		minmax_off;		/* offset of min, then max, in the stripe */
+	uint8		compression;	/* COLUMNAR_COMPRESSION_xxx */
+	uint8		flags;			/* COLUMNAR_CHUNK_xxx */
+} ColumnarChunkInfo;
+
+#define ColumnarStripeChunks(hdr) \
+	((ColumnarChunkInfo *) ((char *) (hdr) + \
+							MAXALIGN(sizeof(ColumnarStripeHeader))))
+
+/* row numbers map to TIDs, so that the executor has something to show */
+#define ColumnarRowNumberToTid(rownum, tid) \
+	ItemPointerSet((tid), (BlockNumber) ((rownum) / MaxHeapTuplesPerPage), \
+				   (OffsetNumber) ((rownum) % MaxHeapTuplesPerPage + 1))
+#define ColumnarTidToRowNumber(tid) \
+	((uint64) ItemPointerGetBlockNumberNoCheck(tid) * MaxHeapTuplesPerPage + \
+	 ItemPointerGetOffsetNumberNoCheck(tid) - 1)
+
+/*
+ * Rows being inserted are collected column by column in a write buffer, and
+ * written out as one stripe when it's full or when the data has to become
+ * visible.
+ */
+typedef struct ColumnarColumnBuffer
+{
+	StringInfoData data;		/* the encoded non-null values */
+	bits8	   *nullbits;		/* null bitmap, a set bit means not null */
+	uint32		nnulls;			/* number of nulls so far */
+	FmgrInfo   *cmp;			/* btree comparison function, or NULL */
+	bool		has_minmax;		/* are min and max valid? */
+	Datum		min;
+	Datum		max;
+} ColumnarColumnBuffer;
+
+typedef struct ColumnarWriteBuffer
+{
+	Oid			relid;			/* relation being inserted into */
+	RelFileNode node;			/* its relfilenode when we started */
+	TransactionId xid;			/* inserting (sub)transaction */
+	CommandId	cid;			/* inserting command */
+	uint64		first_row;		/* reserved row numbers start here */
+	uint32		nrows;			/* rows collected so far */
+	uint32		maxrows;		/* rows reserved */
+	Size		datasize;		/* total length of column data so far */
+	TupleDesc	tupdesc;
+	ColumnarColumnBuffer *cols;
+	MemoryContext context;		/* holds everything above */
+	struct ColumnarWriteBuffer *next;
+} ColumnarWriteBuffer;
+
+/* GUC parameters */
+extern int	columnar_stripe_row_limit;
+extern int	columnar_compression;
+
+/* columnar_storage.c */
+extern void columnar_read_metapage(Relation rel, ColumnarMetaPageData *meta);
+extern uint64 columnar_reserve_rows(Relation rel, uint32 nrows);
+extern ColumnarWriteBuffer *columnar_create_write_buffer(Relation rel,
+														 TransactionId xid,
+														 CommandId cid,
+														 MemoryContext parent);
+extern bool columnar_buffer_add_row(ColumnarWriteBuffer *wbuf,
+									Datum *values, bool *isnull);
+extern void columnar_write_stripe(Relation rel, ColumnarWriteBuffer *wbuf);
+extern ColumnarStripeHeader *columnar_read_stripe_header(Relation rel,
+														 uint64 offset,
+														 BufferAccessStrategy strategy);
+extern bool columnar_chunk_get_minmax(ColumnarStripeHeader *hdr, int attno,
+									  Form_pg_attribute attr,
+									  Datum *min, Datum *max);
+extern void columnar_read_chunk(Relation rel, uint64 offset,
+								ColumnarStripeHeader *hdr, int attno,
+								Form_pg_attribute attr,
+								Datum *values, bool *isnull,
+								BufferAccessStrategy strategy);
+extern void columnar_set_stripe_xmin(Relation rel, uint64 offset,
+									 TransactionId xmin);
+extern bool columnar_stripe_is_visible(ColumnarStripeHeader *hdr,
+									   Snapshot snapshot);
+
+/* columnar_handler.c */
+extern void columnar_flush_pending(Relation rel);
+
+#endif							/* COLUMNAR_H */
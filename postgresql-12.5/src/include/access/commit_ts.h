@@ -18,9 +18,12 @@
 
 
 extern PGDLLIMPORT bool track_commit_timestamp;
+extern int	commit_timestamp_buffers;
 
 extern bool check_track_commit_timestamp(bool *newval, void **extra,
 										 GucSource source);
+extern bool check_commit_timestamp_buffers(int *newval, void **extra,
+										   GucSource source);
 
 extern void TransactionTreeSetCommitTsData(TransactionId xid, int nsubxids,
 										   TransactionId *subxids, TimestampTz timestamp,
@@ -23,7 +23,9 @@
 #include "nodes/lockoptions.h"
 #include "nodes/primnodes.h"
 #include "storage/bufpage.h"
+#include "storage/dsm.h"
 #include "storage/lockdefs.h"
+#include "storage/shm_toc.h"
 #include "utils/relcache.h"
 #include "utils/snapshot.h"
 
@@ -34,6 +36,7 @@
 #define HEAP_INSERT_FROZEN		TABLE_INSERT_FROZEN
 #define HEAP_INSERT_NO_LOGICAL	TABLE_INSERT_NO_LOGICAL
 #define HEAP_INSERT_SPECULATIVE 0x0010
+#define HEAP_INSERT_UNDO		0x0020	/* keep HEAP_HAS_UNDO (inplace AM) */
 
 typedef struct BulkInsertStateData *BulkInsertState;
 struct TupleTableSlot;
@@ -62,6 +65,11 @@ typedef struct HeapScanDescData
 	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 
+	/* prefetching state for sequential scans (see heap_prefetch_ahead) */
+	int			rs_prefetch_maximum;	/* max prefetch distance, or 0 */
+	int			rs_prefetch_target; /* current prefetch distance */
+	int			rs_prefetch_ahead;	/* # pages after rs_cblock prefetched */
+
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
@@ -80,6 +88,8 @@ typedef struct IndexFetchHeapData
 
 	Buffer		xs_cbuf;		/* current heap buffer in scan, if any */
 	/* NB: if xs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
+
+	BlockNumber xs_prune_requested;	/* last block we asked to be pruned */
 } IndexFetchHeapData;
 
 /* Result codes for HeapTupleSatisfiesVacuum */
@@ -120,12 +130,24 @@ extern void heap_endscan(TableScanDesc scan);
 extern HeapTuple heap_getnext(TableScanDesc scan, ScanDirection direction);
 extern bool heap_getnextslot(TableScanDesc sscan,
 							 ScanDirection direction, struct TupleTableSlot *slot);
+extern int	heap_getnextslots(TableScanDesc sscan, ScanDirection direction,
+							  struct TupleTableSlot **slots, int nslots);
+extern void heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
+							  ItemPointer maxtid);
+extern bool heap_getnextslot_tidrange(TableScanDesc sscan,
+									  ScanDirection direction,
+									  struct TupleTableSlot *slot);
 
 extern bool heap_fetch(Relation relation, Snapshot snapshot,
 					   HeapTuple tuple, Buffer *userbuf);
 extern bool heap_hot_search_buffer(ItemPointer tid, Relation relation,
 								   Buffer buffer, Snapshot snapshot, HeapTuple heapTuple,
 								   bool *all_dead, bool first_call);
+extern OffsetNumber heap_undo_next(Page page, OffsetNumber owner,
+								   HeapTupleHeader tuple);
+extern bool heap_undo_search_buffer(ItemPointer tid, Relation relation,
+									Buffer buffer, Snapshot snapshot,
+									HeapTuple heapTuple, bool *all_dead);
 
 extern void heap_get_latest_tid(TableScanDesc scan, ItemPointer tid);
 extern void setLastTid(const ItemPointer tid);
@@ -147,7 +169,11 @@ extern void heap_abort_speculative(Relation relation, ItemPointer tid);
 extern TM_Result heap_update(Relation relation, ItemPointer otid,
 							 HeapTuple newtup,
 							 CommandId cid, Snapshot crosscheck, bool wait,
-							 struct TM_FailureData *tmfd, LockTupleMode *lockmode);
+							 struct TM_FailureData *tmfd, LockTupleMode *lockmode,
+							 struct TM_IndexUpdate *index_update);
+extern Bitmapset *HeapDetermineModifiedColumns(Relation relation,
+												Bitmapset *interesting_cols,
+												HeapTuple oldtup, HeapTuple newtup);
 extern TM_Result heap_lock_tuple(Relation relation, HeapTuple tuple,
 								 CommandId cid, LockTupleMode mode, LockWaitPolicy wait_policy,
 								 bool follow_update,
@@ -172,8 +198,13 @@ extern TransactionId heap_compute_xid_horizon_for_tuples(Relation rel,
 														 ItemPointerData *items,
 														 int nitems);
 
+/* in heap/heapam_inplace.c */
+extern HeapTuple heap_inplace_format_tuple(HeapTuple tuple);
+
 /* in heap/pruneheap.c */
 extern void heap_page_prune_opt(Relation relation, Buffer buffer);
+extern void heap_page_prune_request(Relation relation, BlockNumber blkno);
+extern void heap_page_prune_block(Oid relid, BlockNumber blkno);
 extern int	heap_page_prune(Relation relation, Buffer buffer,
 							TransactionId OldestXmin,
 							bool report_stats, TransactionId *latestRemovedXid);
@@ -193,6 +224,8 @@ extern Size SyncScanShmemSize(void);
 struct VacuumParams;
 extern void heap_vacuum_rel(Relation onerel,
 							struct VacuumParams *params, BufferAccessStrategy bstrategy);
+extern void parallel_vacuum_main(dsm_segment *seg, shm_toc *toc);
+extern void parallel_vacuum_heap_main(dsm_segment *seg, shm_toc *toc);
 
 /* in heap/heapam_visibility.c */
 extern bool HeapTupleSatisfiesVisibility(HeapTuple stup, Snapshot snapshot,
@@ -274,13 +274,16 @@ struct HeapTupleHeaderData
  * information stored in t_infomask2:
  */
 #define HEAP_NATTS_MASK			0x07FF	/* 11 bits for number of attributes */
-/* bits 0x1800 are available */
+#define HEAP_HAS_UNDO			0x0800	/* tuple carries undo links; see
+										 * HeapTupleHeaderGetUndo */
+#define HEAP_WARM_TUPLE			0x1000	/* tuple is in a HOT chain in which
+										 * some index keys changed */
 #define HEAP_KEYS_UPDATED		0x2000	/* tuple was updated and key cols
 										 * modified, or tuple deleted */
 #define HEAP_HOT_UPDATED		0x4000	/* tuple was HOT-updated */
 #define HEAP_ONLY_TUPLE			0x8000	/* this is heap-only tuple */
 
-#define HEAP2_XACT_MASK			0xE000	/* visibility-related bits */
+#define HEAP2_XACT_MASK			0xF000	/* visibility-related bits */
 
 /*
  * HEAP_TUPLE_HAS_MATCH is a temporary flag used during hash joins.  It is
@@ -513,6 +516,52 @@ do { \
   (tup)->t_infomask2 &= ~HEAP_ONLY_TUPLE \
 )
 
+#define HeapTupleHeaderIsWarm(tup) \
+( \
+  ((tup)->t_infomask2 & HEAP_WARM_TUPLE) != 0 \
+)
+
+#define HeapTupleHeaderSetWarm(tup) \
+( \
+  (tup)->t_infomask2 |= HEAP_WARM_TUPLE \
+)
+
+/*
+ * Tuples of the "inplace" table access method (heapam_inplace.c) carry two
+ * offset numbers at the end of the header, just before the data.  The undo
+ * link is the offset of the item holding the row's previous version, which
+ * was saved there when the row was updated in place.  The owner is set in
+ * such saved versions only, and is the offset of the row's current version;
+ * it lets readers tell a valid undo link from one to an item that has been
+ * pruned and reused since.
+ */
+#define HeapTupleHeaderHasUndo(tup) \
+( \
+  ((tup)->t_infomask2 & HEAP_HAS_UNDO) != 0 \
+)
+
+#define HeapTupleHeaderUndoFields(tup) \
+	((OffsetNumber *) ((char *) (tup) + (tup)->t_hoff) - 2)
+
+#define HeapTupleHeaderGetUndoOwner(tup) \
+	(HeapTupleHeaderUndoFields(tup)[0])
+
+#define HeapTupleHeaderGetUndo(tup) \
+	(HeapTupleHeaderUndoFields(tup)[1])
+
+/* a saved version of a row updated in place */
+#define HeapTupleHeaderIsSavedVersion(tup) \
+( \
+  ((tup)->t_infomask2 & (HEAP_ONLY_TUPLE | HEAP_HAS_UNDO)) == \
+	(HEAP_ONLY_TUPLE | HEAP_HAS_UNDO) \
+)
+
+#define HeapTupleHeaderSetUndo(tup, owner, undo) \
+do { \
+	HeapTupleHeaderUndoFields(tup)[0] = (owner); \
+	HeapTupleHeaderUndoFields(tup)[1] = (undo); \
+} while (0)
+
 #define HeapTupleHeaderHasMatch(tup) \
 ( \
   ((tup)->t_infomask2 & HEAP_TUPLE_HAS_MATCH) != 0 \
@@ -691,6 +740,12 @@ struct MinimalTupleData
 #define HeapTupleClearHeapOnly(tuple) \
 		HeapTupleHeaderClearHeapOnly((tuple)->t_data)
 
+#define HeapTupleIsWarm(tuple) \
+		HeapTupleHeaderIsWarm((tuple)->t_data)
+
+#define HeapTupleSetWarm(tuple) \
+		HeapTupleHeaderSetWarm((tuple)->t_data)
+
 
 /* ----------------
  *		fastgetattr
@@ -56,6 +56,7 @@ typedef struct ParallelWorkerContext
 extern volatile bool ParallelMessagePending;
 extern PGDLLIMPORT int ParallelWorkerNumber;
 extern PGDLLIMPORT bool InitializingParallelWorker;
+extern PGDLLIMPORT bool ParallelWorkerMayInsert;
 
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
@@ -0,0 +1,34 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallelredo.h
+ *		Declarations for replaying WAL with background redo workers.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/parallelredo.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PARALLELREDO_H
+#define PARALLELREDO_H
+
+#include "access/xlogreader.h"
+
+/* GUCs */
+extern int	max_parallel_redo_workers;
+
+extern Size ParallelRedoShmemSize(void);
+extern void ParallelRedoShmemInit(void);
+
+/* Called by the startup process */
+extern bool ParallelRedoDispatch(XLogReaderState *record);
+extern void ParallelRedoSync(void);
+extern void ParallelRedoShutdown(void);
+
+/* Called wherever SMgrRelations need to be closed by other processes */
+extern void ParallelRedoNoteSmgrInvalidation(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg) pg_attribute_noreturn();
+
+#endif							/* PARALLELREDO_H */
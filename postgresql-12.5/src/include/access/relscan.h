@@ -18,6 +18,7 @@
 #include "access/itup.h"
 #include "port/atomics.h"
 #include "storage/buf.h"
+#include "storage/itemptr.h"
 #include "storage/spin.h"
 #include "utils/relcache.h"
 
@@ -36,6 +37,10 @@ typedef struct TableScanDescData
 	int			rs_nkeys;		/* number of scan keys */
 	struct ScanKeyData *rs_key; /* array of scan key descriptors */
 
+	/* Range of ItemPointers for table_scan_getnextslot_tidrange() to scan. */
+	ItemPointerData rs_mintid;
+	ItemPointerData rs_maxtid;
+
 	/*
 	 * Information about type and behaviour of the scan, a bitmask of members
 	 * of the ScanOptions enum (see tableam.h).
@@ -89,6 +94,14 @@ typedef struct ParallelBlockTableScanDescData *ParallelBlockTableScanDesc;
 typedef struct IndexFetchTableData
 {
 	Relation	rel;
+
+	/*
+	 * Set by the AM's index_fetch_tuple if the tuple returned might not match
+	 * the index entry it was reached through, because some updates only add
+	 * entries to indexes whose keys changed.  The caller must then compare
+	 * the tuple against the index tuple.
+	 */
+	bool		recheck_keys;
 } IndexFetchTableData;
 
 /*
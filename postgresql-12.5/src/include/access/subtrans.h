@@ -11,8 +11,13 @@
 #ifndef SUBTRANS_H
 #define SUBTRANS_H
 
-/* Number of SLRU buffers to use for subtrans */
-#define NUM_SUBTRANS_BUFFERS	32
+#include "utils/guc.h"
+
+/* GUC parameter: number of SLRU buffers to use for subtrans, 0 for auto */
+extern int	subtransaction_buffers;
+
+extern bool check_subtransaction_buffers(int *newval, void **extra,
+										 GucSource source);
 
 extern void SubTransSetParent(TransactionId xid, TransactionId parent);
 extern TransactionId SubTransGetParent(TransactionId xid);
@@ -49,6 +49,7 @@ typedef enum ScanOptions
 	SO_TYPE_SAMPLESCAN = 1 << 2,
 	SO_TYPE_ANALYZE = 1 << 3,
 	SO_TYPE_TIDSCAN = 1 << 8,
+	SO_TYPE_TIDRANGESCAN = 1 << 9,
 
 	/* several of SO_ALLOW_* may be specified */
 	/* allow or disallow use of access strategy */
@@ -127,6 +128,39 @@ typedef struct TM_FailureData
 	bool		traversed;
 } TM_FailureData;
 
+/*
+ * Which indexes need new entries for a tuple version created by
+ * table_tuple_update().
+ */
+typedef enum TU_UpdateIndexes
+{
+	/* none; the indexes reach the new version through the old one (HOT) */
+	TU_None,
+
+	/* all indexes, pointing at the new version */
+	TU_All,
+
+	/*
+	 * Only indexes on changed columns, pointing at the TID given in
+	 * TM_IndexUpdate.  Entries of the other indexes reach the new version
+	 * through the old one.
+	 */
+	TU_Changed
+} TU_UpdateIndexes;
+
+/*
+ * On success, table_tuple_update fills in this struct to tell the caller
+ * which index entries to make.  changed_attrs is only set for TU_Changed, is
+ * offset by FirstLowInvalidHeapAttributeNumber like the relcache's index
+ * attribute bitmaps, and is palloc'd in the caller's memory context.
+ */
+typedef struct TM_IndexUpdate
+{
+	TU_UpdateIndexes which;
+	ItemPointerData tid;
+	Bitmapset  *changed_attrs;
+} TM_IndexUpdate;
+
 /* "options" flag bits for table_tuple_insert */
 #define TABLE_INSERT_SKIP_WAL		0x0001
 #define TABLE_INSERT_SKIP_FSM		0x0002
@@ -224,6 +258,63 @@ typedef struct TableAmRoutine
 									 ScanDirection direction,
 									 TupleTableSlot *slot);
 
+	/*
+	 * Return up to `nslots` next tuples from `scan`, storing them in
+	 * slots[0..n-1], and return the number of tuples stored.  Each slot has
+	 * to remain valid independently of the others until it is next
+	 * overwritten.  Returning fewer than `nslots` tuples means the scan is
+	 * exhausted.
+	 *
+	 * Optional callback: AMs that do not provide it just don't support
+	 * batched sequential scans in the executor.
+	 */
+	int			(*scan_getnextslots) (TableScanDesc scan,
+									  ScanDirection direction,
+									  TupleTableSlot **slots,
+									  int nslots);
+
+	/*
+	 * Tell the scan which columns the caller will look at, and give it
+	 * simple restrictions the caller will check on every returned tuple.
+	 * Called after scan_begin and before the first tuple is fetched; the
+	 * hints stay in effect across rescans.
+	 *
+	 * `attrs_used` holds attribute numbers offset by
+	 * FirstLowInvalidHeapAttributeNumber, as built by pull_varattnos(); a
+	 * whole-row reference means all columns.  Columns not in it may be
+	 * returned as NULL.  Each of the `nkeys` keys compares a column with a
+	 * constant using a btree strategy, sk_func being the btree comparison
+	 * support function of the column type's default opclass.  The AM may
+	 * skip tuples that fail a key, but it doesn't have to.
+	 *
+	 * Optional callback, only used by sequential scans.
+	 */
+	void		(*scan_set_hints) (TableScanDesc scan,
+								   Bitmapset *attrs_used,
+								   int nkeys, struct ScanKeyData *keys);
+
+	/*
+	 * Restrict the scan to the tuples whose TIDs lie between `mintid` and
+	 * `maxtid`, both inclusive.  Called after scan_begin and after every
+	 * scan_rescan.  The range may be empty, and either end may lie outside
+	 * the relation.
+	 *
+	 * Optional callback, but either both scan_set_tidrange and
+	 * scan_getnextslot_tidrange must be provided, or neither.  Without
+	 * them, the planner doesn't consider TID range scans on the AM's tables.
+	 */
+	void		(*scan_set_tidrange) (TableScanDesc scan,
+									  ItemPointer mintid,
+									  ItemPointer maxtid);
+
+	/*
+	 * Return the next tuple in the TID range set by scan_set_tidrange, store
+	 * it in slot.
+	 */
+	bool		(*scan_getnextslot_tidrange) (TableScanDesc scan,
+											  ScanDirection direction,
+											  TupleTableSlot *slot);
+
 
 	/* ------------------------------------------------------------------------
 	 * Parallel table scan related functions.
@@ -395,7 +486,7 @@ typedef struct TableAmRoutine
 								 bool wait,
 								 TM_FailureData *tmfd,
 								 LockTupleMode *lockmode,
-								 bool *update_indexes);
+								 TM_IndexUpdate *index_update);
 
 	/* see table_tuple_lock() for reference about parameters */
 	TM_Result	(*tuple_lock) (Relation rel,
@@ -623,7 +714,9 @@ typedef struct TableAmRoutine
 	 *
 	 * If `tbmres->blockno` is -1, this is a lossy scan and all visible tuples
 	 * on the page have to be returned, otherwise the tuples at offsets in
-	 * `tbmres->offsets` need to be returned.
+	 * `tbmres->offsets` need to be returned.  If the tuples returned might
+	 * not match the index entries that put them in the bitmap, the AM must
+	 * set `tbmres->recheck`.
 	 *
 	 * XXX: Currently this may only be implemented if the AM uses md.c as its
 	 * storage manager, and uses ItemPointer->ip_blkid in a manner that maps
@@ -825,6 +918,26 @@ table_beginscan_tid(Relation rel, Snapshot snapshot)
 	return rel->rd_tableam->scan_begin(rel, snapshot, 0, NULL, NULL, flags);
 }
 
+/*
+ * table_beginscan_tidrange is the entry point for setting up a TableScanDesc
+ * for a TID range scan.  The scan returns only the tuples whose TIDs lie
+ * between mintid and maxtid, both inclusive.
+ */
+static inline TableScanDesc
+table_beginscan_tidrange(Relation rel, Snapshot snapshot,
+						 ItemPointer mintid, ItemPointer maxtid)
+{
+	TableScanDesc sscan;
+	uint32		flags = SO_TYPE_TIDRANGESCAN | SO_ALLOW_PAGEMODE;
+
+	sscan = rel->rd_tableam->scan_begin(rel, snapshot, 0, NULL, NULL, flags);
+
+	/* Set the range of TIDs to scan */
+	sscan->rs_rd->rd_tableam->scan_set_tidrange(sscan, mintid, maxtid);
+
+	return sscan;
+}
+
 /*
  * table_beginscan_analyze is an alternative entry point for setting up a
  * TableScanDesc for an ANALYZE scan.  As with bitmap scans, it's worth using
@@ -889,6 +1002,73 @@ table_scan_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableS
 	return sscan->rs_rd->rd_tableam->scan_getnextslot(sscan, direction, slot);
 }
 
+/*
+ * Return up to `nslots` next tuples from `scan`, stored in slots[].  Returns
+ * the number of tuples stored; fewer than `nslots` means end of scan.  Only
+ * valid for AMs that provide the scan_getnextslots callback.
+ */
+static inline int
+table_scan_getnextslots(TableScanDesc sscan, ScanDirection direction,
+						TupleTableSlot **slots, int nslots)
+{
+	Oid			tableOid = RelationGetRelid(sscan->rs_rd);
+	int			ntuples;
+	int			i;
+
+	Assert(sscan->rs_rd->rd_tableam->scan_getnextslots != NULL);
+
+	ntuples = sscan->rs_rd->rd_tableam->scan_getnextslots(sscan, direction,
+														  slots, nslots);
+	for (i = 0; i < ntuples; i++)
+		slots[i]->tts_tableOid = tableOid;
+	return ntuples;
+}
+
+/*
+ * Restart a TID range scan, with a new range of TIDs.
+ */
+static inline void
+table_rescan_tidrange(TableScanDesc sscan, ItemPointer mintid,
+					  ItemPointer maxtid)
+{
+	/* Ensure table_beginscan_tidrange() was used. */
+	Assert((sscan->rs_flags & SO_TYPE_TIDRANGESCAN) != 0);
+
+	sscan->rs_rd->rd_tableam->scan_rescan(sscan, NULL, false, false, false, false);
+	sscan->rs_rd->rd_tableam->scan_set_tidrange(sscan, mintid, maxtid);
+}
+
+/*
+ * Return the next tuple of a TID range scan, store in slot.  Returns false
+ * when there are no more tuples in the range.
+ */
+static inline bool
+table_scan_getnextslot_tidrange(TableScanDesc sscan, ScanDirection direction,
+								TupleTableSlot *slot)
+{
+	/* Ensure table_beginscan_tidrange() was used. */
+	Assert((sscan->rs_flags & SO_TYPE_TIDRANGESCAN) != 0);
+
+	slot->tts_tableOid = RelationGetRelid(sscan->rs_rd);
+	return sscan->rs_rd->rd_tableam->scan_getnextslot_tidrange(sscan,
+															   direction,
+															   slot);
+}
+
+/*
+ * Tell `scan` which columns will be used and which simple restrictions will
+ * be checked by the caller.  Only valid for AMs that provide the
+ * scan_set_hints callback; see there for details.
+ */
+static inline void
+table_scan_set_hints(TableScanDesc sscan, Bitmapset *attrs_used,
+					 int nkeys, struct ScanKeyData *keys)
+{
+	Assert(sscan->rs_rd->rd_tableam->scan_set_hints != NULL);
+
+	sscan->rs_rd->rd_tableam->scan_set_hints(sscan, attrs_used, nkeys, keys);
+}
+
 
 /* ----------------------------------------------------------------------------
  * Parallel table scan related functions.
@@ -1250,8 +1430,8 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
  * Output parameters:
  *	tmfd - filled in failure cases (see below)
  *	lockmode - filled with lock mode acquired on tuple
- *  update_indexes - in success cases this is set to true if new index entries
- *		are required for this tuple
+ *	index_update - in success cases this is filled with the index entries
+ *		required for this tuple, see TM_IndexUpdate
  *
  * Normal, successful return value is TM_Ok, which means we did actually
  * update it.  Failure return codes are TM_SelfModified, TM_Updated, and
@@ -1271,12 +1451,12 @@ static inline TM_Result
 table_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
 				   CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 				   bool wait, TM_FailureData *tmfd, LockTupleMode *lockmode,
-				   bool *update_indexes)
+				   TM_IndexUpdate *index_update)
 {
 	return rel->rd_tableam->tuple_update(rel, otid, slot,
 										 cid, snapshot, crosscheck,
 										 wait, tmfd,
-										 lockmode, update_indexes);
+										 lockmode, index_update);
 }
 
 /*
@@ -1722,7 +1902,7 @@ extern void simple_table_tuple_delete(Relation rel, ItemPointer tid,
 									  Snapshot snapshot);
 extern void simple_table_tuple_update(Relation rel, ItemPointer otid,
 									  TupleTableSlot *slot, Snapshot snapshot,
-									  bool *update_indexes);
+									  TM_IndexUpdate *index_update);
 
 
 /* ----------------------------------------------------------------------------
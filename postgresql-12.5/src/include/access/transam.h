@@ -181,6 +181,8 @@ typedef struct VariableCacheData
 	 */
 	TransactionId latestCompletedXid;	/* newest XID that has committed or
 										 * aborted */
+	uint64		xactCompletionCount;	/* # of completed XID-bearing xacts,
+										 * see GetSnapshotDataReuse() */
 
 	/*
 	 * These fields are protected by CLogTruncationLock
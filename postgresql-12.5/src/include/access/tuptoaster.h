@@ -111,6 +111,20 @@
 #define VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) \
 	((toast_pointer).va_extsize < (toast_pointer).va_rawsize - VARHDRSZ)
 
+/*
+ * Compression methods for TOAST data.  The ID is stored in the top bits of
+ * the raw size word of compressed data, so there can be at most four, and
+ * existing values must never be renumbered.
+ */
+typedef enum ToastCompressionId
+{
+	TOAST_PGLZ_COMPRESSION_ID = 0,
+	TOAST_LZ4_COMPRESSION_ID = 1
+} ToastCompressionId;
+
+/* GUC: method for columns without a compression attribute option */
+extern int	default_toast_compression;
+
 /*
  * Macro to fetch the possibly-unaligned contents of an EXTERNAL datum
  * into a local "struct varatt_external" toast pointer.  This should be
@@ -207,10 +221,29 @@ extern HeapTuple toast_build_flattened_tuple(TupleDesc tupleDesc,
 /* ----------
  * toast_compress_datum -
  *
- *	Create a compressed version of a varlena datum, if possible
+ *	Create a compressed version of a varlena datum, if possible, using the
+ *	given ToastCompressionId
+ * ----------
+ */
+extern Datum toast_compress_datum(Datum value, int cmethod);
+
+/* ----------
+ * toast_compression_method_name, toast_compression_method_from_name -
+ *
+ *	Convert between ToastCompressionId and the name used in attribute
+ *	options and GUCs; the latter returns -1 for an unknown name
  * ----------
  */
-extern Datum toast_compress_datum(Datum value);
+extern const char *toast_compression_method_name(int cmethod);
+extern int	toast_compression_method_from_name(const char *name);
+
+/* ----------
+ * toast_validate_compression_option -
+ *
+ *	Validator for the "compression" attribute option
+ * ----------
+ */
+extern void toast_validate_compression_option(const char *value);
 
 /* ----------
  * toast_raw_datum_size -
@@ -228,6 +261,15 @@ extern Size toast_raw_datum_size(Datum value);
  */
 extern Size toast_datum_size(Datum value);
 
+/* ----------
+ * toast_datum_compression -
+ *
+ *	Return the compression method of a varlena datum, or -1 if it isn't
+ *	compressed
+ * ----------
+ */
+extern int	toast_datum_compression(Datum value);
+
 /* ----------
  * toast_get_valid_index -
  *
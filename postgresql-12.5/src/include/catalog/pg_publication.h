@@ -21,6 +21,7 @@
 #include "catalog/pg_publication_d.h"
 
 #include "catalog/objectaddress.h"
+#include "nodes/bitmapset.h"
 
 /* ----------------
  *		pg_publication definition.  cpp turns this into
@@ -68,6 +69,16 @@ typedef struct PublicationActions
 	bool		pubupdate;
 	bool		pubdelete;
 	bool		pubtruncate;
+
+	/*
+	 * Whether the row filters and column lists of the publications that
+	 * publish updates/deletes of the relation are compatible with its
+	 * replica identity.  Only filled in by GetRelationPublicationActions().
+	 */
+	bool		rf_valid_for_update;
+	bool		rf_valid_for_delete;
+	bool		cols_valid_for_update;
+	bool		cols_valid_for_delete;
 } PublicationActions;
 
 typedef struct Publication
@@ -78,6 +89,17 @@ typedef struct Publication
 	PublicationActions pubactions;
 } Publication;
 
+/*
+ * A relation being added to a publication, along with its optional row
+ * filter (already transformed) and column list.
+ */
+typedef struct PublicationRelInfo
+{
+	Relation	relation;
+	Node	   *whereClause;
+	List	   *columns;
+} PublicationRelInfo;
+
 extern Publication *GetPublication(Oid pubid);
 extern Publication *GetPublicationByName(const char *pubname, bool missing_ok);
 extern List *GetRelationPublications(Oid relid);
@@ -86,8 +108,11 @@ extern List *GetAllTablesPublications(void);
 extern List *GetAllTablesPublicationRelations(void);
 
 extern bool is_publishable_relation(Relation rel);
-extern ObjectAddress publication_add_relation(Oid pubid, Relation targetrel,
+extern ObjectAddress publication_add_relation(Oid pubid,
+											  PublicationRelInfo *pri,
 											  bool if_not_exists);
+extern Bitmapset *pub_collist_to_bitmapset(Bitmapset *columns, Datum pubcols,
+										   MemoryContext mcxt);
 
 extern Oid	get_publication_oid(const char *pubname, bool missing_ok);
 extern char *get_publication_name(Oid pubid, bool missing_ok);
@@ -31,6 +31,11 @@ CATALOG(pg_publication_rel,6106,PublicationRelRelationId)
 	Oid			oid;			/* oid */
 	Oid			prpubid;		/* Oid of the publication */
 	Oid			prrelid;		/* Oid of the relation */
+
+#ifdef CATALOG_VARLEN			/* variable-length fields start here */
+	pg_node_tree prqual;		/* row filter, or NULL if none */
+	int2vector	prattrs;		/* published columns, or NULL for all */
+#endif
 } FormData_pg_publication_rel;
 
 /* ----------------
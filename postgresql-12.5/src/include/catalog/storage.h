@@ -25,6 +25,14 @@ extern void RelationPreserveStorage(RelFileNode rnode, bool atCommit);
 extern void RelationTruncate(Relation rel, BlockNumber nblocks);
 extern void RelationCopyStorage(SMgrRelation src, SMgrRelation dst,
 								ForkNumber forkNum, char relpersistence);
+extern void RelationInitGlobalTempStorage(Relation rel);
+extern void ResetGlobalTempStorage(void);
+extern void GetGlobalTempStorageHorizons(Relation rel,
+										 TransactionId *frozenxid,
+										 MultiXactId *minmulti);
+extern void SetGlobalTempStorageHorizons(Relation rel,
+										 TransactionId frozenxid,
+										 MultiXactId minmulti);
 
 /*
  * These functions used to be in storage/smgr/smgr.c, which explains the
@@ -27,5 +27,8 @@ extern ObjectAddress ExecCreateTableAs(CreateTableAsStmt *stmt, const char *quer
 extern int	GetIntoRelEFlags(IntoClause *intoClause);
 
 extern DestReceiver *CreateIntoRelDestReceiver(IntoClause *intoClause);
+extern DestReceiver *CreateParallelIntoRelDestReceiver(Oid relid,
+													   CommandId output_cid,
+													   int ti_options);
 
 #endif							/* CREATEAS_H */
@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.h
+ *	  Streaming compression for the frontend/backend protocol
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/common/zpq_stream.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef ZPQ_STREAM_H
+#define ZPQ_STREAM_H
+
+/* Names of the compression algorithms, as used in the negotiation */
+#define ZPQ_ALGORITHM_ZSTD	"zstd"
+#define ZPQ_ALGORITHM_LZ4	"lz4"
+#define ZPQ_ALGORITHM_ZLIB	"zlib"
+
+/* Enough space for the list of all algorithms from zpq_algorithm_list */
+#define ZPQ_ALGORITHM_LIST_LEN	32
+
+/* Returned by zpq_read and zpq_write if the compression library fails */
+#define ZPQ_STREAM_ERROR	(-2)
+
+/*
+ * Transport callbacks.  These have the same contract as secure_read() and
+ * secure_write() in the backend, or pqsecure_read() and pqsecure_write() in
+ * libpq: they return the number of bytes transferred, or a value <= 0 with
+ * errno set.
+ */
+typedef ssize_t (*zpq_tx_func) (void *arg, const void *data, size_t size);
+typedef ssize_t (*zpq_rx_func) (void *arg, void *data, size_t size);
+
+typedef struct ZpqStream ZpqStream;
+
+extern bool zpq_algorithm_supported(const char *name);
+extern void zpq_algorithm_list(char *buf, size_t size);
+extern ZpqStream *zpq_create(const char *algorithm,
+							 zpq_tx_func tx_func, zpq_rx_func rx_func,
+							 void *arg, const char *rx_data, size_t rx_len);
+extern ssize_t zpq_read(ZpqStream *zs, void *buf, size_t size);
+extern ssize_t zpq_write(ZpqStream *zs, const void *buf, size_t size);
+extern bool zpq_buffered_tx(ZpqStream *zs);
+extern bool zpq_buffered_rx(ZpqStream *zs);
+extern const char *zpq_error(ZpqStream *zs);
+extern void zpq_free(ZpqStream *zs);
+
+#endif							/* ZPQ_STREAM_H */
@@ -20,6 +20,7 @@
 /* forward references to avoid circularity */
 struct ExprEvalStep;
 struct SubscriptingRefState;
+struct ScalarArrayOpExprHashTable;
 
 /* Bits in ExprState->flags (see also execnodes.h for public flag bits): */
 /* expression's interpreter has been initialized */
@@ -27,6 +28,12 @@ struct SubscriptingRefState;
 /* jump-threading is in use */
 #define EEO_FLAG_DIRECT_THREADED			(1 << 2)
 
+/*
+ * Minimum number of elements a constant array needs to have for
+ * "scalar = ANY (array)" to be evaluated using a hash table.
+ */
+#define MIN_ARRAY_SIZE_FOR_HASHED_SAOP 9
+
 /* Typical API for out-of-line evaluation subroutines */
 typedef void (*ExecEvalSubroutine) (ExprState *state,
 									struct ExprEvalStep *op,
@@ -91,6 +98,14 @@ typedef enum ExprEvalOp
 	EEOP_FUNCEXPR_FUSAGE,
 	EEOP_FUNCEXPR_STRICT_FUSAGE,
 
+	/*
+	 * Strict two-argument comparison between fixed-width integer types (or
+	 * types represented as such), evaluated inline instead of calling the
+	 * comparison function.  d.func.cmptype selects the comparison.
+	 */
+	EEOP_FUNCEXPR_INT4CMP,
+	EEOP_FUNCEXPR_INT8CMP,
+
 	/*
 	 * Evaluate boolean AND expression, one step per subexpression. FIRST/LAST
 	 * subexpressions are special-cased for performance.  Since AND always has
@@ -150,6 +165,10 @@ typedef enum ExprEvalOp
 	EEOP_DISTINCT,
 	EEOP_NOT_DISTINCT,
 	EEOP_NULLIF,
+
+	/* compute the hash of a set of columns, see ExecBuildHash32FromAttrs */
+	EEOP_HASHDATUM_SET_INITVAL,
+	EEOP_HASHDATUM_NEXT32,
 	EEOP_SQLVALUEFUNCTION,
 	EEOP_CURRENTOFEXPR,
 	EEOP_NEXTVALUEEXPR,
@@ -213,6 +232,7 @@ typedef enum ExprEvalOp
 	/* evaluate assorted special-purpose expression types */
 	EEOP_CONVERT_ROWTYPE,
 	EEOP_SCALARARRAYOP,
+	EEOP_HASHED_SCALARARRAYOP,
 	EEOP_XMLEXPR,
 	EEOP_AGGREF,
 	EEOP_GROUPING_FUNC,
@@ -314,7 +334,7 @@ typedef struct ExprEvalStep
 			bool		isnull;
 		}			constval;
 
-		/* for EEOP_FUNCEXPR_* / NULLIF / DISTINCT */
+		/* for EEOP_FUNCEXPR_* / NULLIF / DISTINCT / HASHDATUM_NEXT32 */
 		struct
 		{
 			FmgrInfo   *finfo;	/* function's lookup data */
@@ -322,8 +342,15 @@ typedef struct ExprEvalStep
 			/* faster to access without additional indirection: */
 			PGFunction	fn_addr;	/* actual call address */
 			int			nargs;	/* number of arguments */
+			RowCompareType cmptype; /* for EEOP_FUNCEXPR_INT[48]CMP */
 		}			func;
 
+		/* for EEOP_HASHDATUM_SET_INITVAL */
+		struct
+		{
+			Datum		init_value;
+		}			hashdatum_initvalue;
+
 		/* for EEOP_BOOL_*_STEP */
 		struct
 		{
@@ -547,6 +574,18 @@ typedef struct ExprEvalStep
 			PGFunction	fn_addr;	/* actual call address */
 		}			scalararrayop;
 
+		/* for EEOP_HASHED_SCALARARRAYOP */
+		struct
+		{
+			/* hash table of the array's elements, built on first use */
+			struct ScalarArrayOpExprHashTable *elements_tab;
+			FmgrInfo   *finfo;	/* equality function's lookup data */
+			FunctionCallInfo fcinfo_data;	/* arguments etc */
+			/* faster to access without additional indirection: */
+			PGFunction	fn_addr;	/* actual call address */
+			FunctionCallInfo hash_fcinfo_data;	/* hash function's args */
+		}			hashedscalararrayop;
+
 		/* for EEOP_XMLEXPR */
 		struct
 		{
@@ -742,6 +781,8 @@ extern void ExecEvalSubscriptingRefAssign(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalConvertRowtype(ExprState *state, ExprEvalStep *op,
 								   ExprContext *econtext);
 extern void ExecEvalScalarArrayOp(ExprState *state, ExprEvalStep *op);
+extern void ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op,
+										ExprContext *econtext);
 extern void ExecEvalConstraintNotNull(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalConstraintCheck(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalXmlExpr(ExprState *state, ExprEvalStep *op);
@@ -199,6 +199,7 @@ extern void ExecWithCheckOptions(WCOKind kind, ResultRelInfo *resultRelInfo,
 								 TupleTableSlot *slot, EState *estate);
 extern LockTupleMode ExecUpdateLockMode(EState *estate, ResultRelInfo *relinfo);
 extern ExecRowMark *ExecFindRowMark(EState *estate, Index rti, bool missing_ok);
+extern Relation ExecRowMarkGetRelation(EState *estate, ExecRowMark *erm);
 extern ExecAuxRowMark *ExecBuildAuxRowMark(ExecRowMark *erm, List *targetlist);
 extern TupleTableSlot *EvalPlanQual(EPQState *epqstate, Relation relation,
 									Index rti, TupleTableSlot *testslot);
@@ -218,6 +219,8 @@ extern void EvalPlanQualEnd(EPQState *epqstate);
 /*
  * functions in execProcnode.c
  */
+extern int	executor_batch_size;
+
 extern PlanState *ExecInitNode(Plan *node, EState *estate, int eflags);
 extern void ExecSetExecProcNode(PlanState *node, ExecProcNodeMtd function);
 extern Node *MultiExecProcNode(PlanState *node);
@@ -225,6 +228,13 @@ extern void ExecEndNode(PlanState *node);
 extern bool ExecShutdownNode(PlanState *node);
 extern void ExecSetTupleBound(int64 tuples_needed, PlanState *child_node);
 
+typedef void (*ExecInstrumentationCallback) (PlanState *node,
+											 PlanState *parent,
+											 void *arg);
+extern void ExecWalkInstrumentation(PlanState *node,
+									ExecInstrumentationCallback callback,
+									void *arg);
+
 
 /* ----------------------------------------------------------------
  *		ExecProcNode
@@ -241,6 +251,35 @@ ExecProcNode(PlanState *node)
 
 	return node->ExecProcNode(node);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatch
+ *
+ *		Fetch a batch of tuples from the plan node, see
+ *		ExecProcNodeBatchMtd.  Only valid if node->ExecProcNodeBatch
+ *		is set.
+ * ----------------------------------------------------------------
+ */
+static inline int
+ExecProcNodeBatch(PlanState *node, TupleTableSlot ***slots)
+{
+	int			ntuples;
+
+	Assert(node->ExecProcNodeBatch != NULL);
+
+	if (node->chgParam != NULL) /* something changed? */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	if (node->instrument)
+		InstrStartNode(node->instrument);
+
+	ntuples = node->ExecProcNodeBatch(node, slots);
+
+	if (node->instrument)
+		InstrStopNode(node->instrument, ntuples);
+
+	return ntuples;
+}
 #endif
 
 /*
@@ -260,6 +299,14 @@ extern ExprState *ExecBuildGroupingEqual(TupleDesc ldesc, TupleDesc rdesc,
 										 const Oid *eqfunctions,
 										 const Oid *collations,
 										 PlanState *parent);
+extern ExprState *ExecBuildHash32FromAttrs(TupleDesc desc,
+										   const TupleTableSlotOps *ops,
+										   FmgrInfo *hashfunctions,
+										   Oid *collations,
+										   int numCols,
+										   AttrNumber *keyColIdx,
+										   PlanState *parent,
+										   uint32 init_value);
 extern ProjectionInfo *ExecBuildProjectionInfo(List *targetList,
 											   ExprContext *econtext,
 											   TupleTableSlot *slot,
@@ -413,6 +460,11 @@ extern Tuplestorestate *ExecMakeTableFunctionResult(SetExprState *setexpr,
 													MemoryContext argContext,
 													TupleDesc expectedDesc,
 													bool randomAccess);
+extern ExprDoneCond ExecStreamTableFunctionResult(SetExprState *setexpr,
+												  ExprContext *econtext,
+												  MemoryContext argContext,
+												  TupleDesc expectedDesc,
+												  TupleTableSlot *slot);
 extern SetExprState *ExecInitFunctionResultSet(Expr *expr,
 											   ExprContext *econtext, PlanState *parent);
 extern Datum ExecMakeFunctionResultSet(SetExprState *fcache,
@@ -568,10 +620,14 @@ extern TupleTableSlot *ExecGetReturningSlot(EState *estate, ResultRelInfo *relIn
 /*
  * prototypes from functions in execIndexing.c
  */
+struct TM_IndexUpdate;			/* avoid including tableam.h here */
+
 extern void ExecOpenIndices(ResultRelInfo *resultRelInfo, bool speculative);
 extern void ExecCloseIndices(ResultRelInfo *resultRelInfo);
 extern List *ExecInsertIndexTuples(TupleTableSlot *slot, EState *estate, bool noDupErr,
 								   bool *specConflict, List *arbiterIndexes);
+extern List *ExecUpdateIndexTuples(TupleTableSlot *slot, EState *estate,
+								   struct TM_IndexUpdate *index_update);
 extern bool ExecCheckIndexConstraints(TupleTableSlot *slot, EState *estate,
 									  ItemPointer conflictTid, List *arbiterIndexes);
 extern void check_exclusion_constraint(Relation heap, Relation index,
@@ -159,6 +159,7 @@ typedef struct ParallelHashJoinBatch
 	size_t		ntuples;		/* number of tuples loaded */
 	size_t		old_ntuples;	/* number of tuples before repartitioning */
 	bool		space_exhausted;
+	bool		skip_unmatched; /* whether to abandon unmatched scan */
 
 	/*
 	 * Variable-sized SharedTuplestore objects follow this struct in memory.
@@ -204,6 +205,7 @@ typedef struct ParallelHashJoinBatchAccessor
 	size_t		old_ntuples;	/* how many tuples before repartitioning? */
 	bool		at_least_one_chunk; /* has this backend allocated a chunk? */
 
+	bool		outer_eof;		/* has this process hit end of batch? */
 	bool		done;			/* flag to remember that a batch is done */
 	SharedTuplestoreAccessor *inner_tuples;
 	SharedTuplestoreAccessor *outer_tuples;
@@ -265,7 +267,8 @@ typedef struct ParallelHashJoinState
 #define PHJ_BATCH_ALLOCATING			1
 #define PHJ_BATCH_LOADING				2
 #define PHJ_BATCH_PROBING				3
-#define PHJ_BATCH_DONE					4
+#define PHJ_BATCH_SCANNING				4
+#define PHJ_BATCH_DONE					5
 
 /* The phases of batch growth while hashing, for grow_batches_barrier. */
 #define PHJ_GROW_BATCHES_ELECTING		0
@@ -300,6 +303,7 @@ typedef struct HashJoinTableData
 	}			buckets;
 
 	bool		keepNulls;		/* true to store unmatchable NULL tuples */
+	bool		innerHasNull;	/* inner plan produced a NULL key? */
 
 	bool		skewEnabled;	/* are we using skew optimization? */
 	HashSkewBucket **skewBucket;	/* hashtable of skew buckets */
@@ -315,6 +319,15 @@ typedef struct HashJoinTableData
 
 	bool		growEnabled;	/* flag to shut off nbatch increases */
 
+	/*
+	 * A single hash value found at runtime to dominate the current batch.
+	 * No number of batches can split its tuples, so while it stays in the
+	 * current batch they are tracked in spaceUsedHeavy and kept out of the
+	 * spaceAllowed check that triggers further batch increases.
+	 */
+	bool		heavyValid;		/* is heavyHashValue meaningful? */
+	uint32		heavyHashValue; /* the dominant hash value */
+
 	double		totalTuples;	/* # tuples obtained from inner plan */
 	double		partialTuples;	/* # tuples obtained from inner plan by me */
 	double		skewTuples;		/* # tuples inserted into skew tuples */
@@ -340,6 +353,7 @@ typedef struct HashJoinTableData
 	Oid		   *collations;
 
 	Size		spaceUsed;		/* memory space currently used by tuples */
+	Size		spaceUsedHeavy; /* part of spaceUsed taken by heavyHashValue */
 	Size		spaceAllowed;	/* upper limit for space used */
 	Size		spacePeak;		/* peak space used */
 	Size		spaceUsedSkew;	/* skew hash table's current space usage */
@@ -348,6 +362,14 @@ typedef struct HashJoinTableData
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
 
+	/*
+	 * Bloom filter over the hash values of all inner tuples (of all
+	 * batches), used to reject outer tuples before they reach the join.  It
+	 * lives in hashCxt, and is NULL if we're not building one.
+	 */
+	uint64	   *bloomFilter;	/* bitmap of bloomMask + 1 bits */
+	uint32		bloomMask;		/* number of bits in bitmap, minus 1 */
+
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
 
@@ -31,4 +31,12 @@ extern void ExecForeignScanInitializeWorker(ForeignScanState *node,
 											ParallelWorkerContext *pwcxt);
 extern void ExecShutdownForeignScan(ForeignScanState *node);
 
+/* To avoid including latch.h here, reference WaitEventSet thus: */
+struct WaitEventSet;
+
+extern void ExecAsyncForeignScanRequest(ForeignScanState *node);
+extern bool ExecAsyncForeignScanReady(ForeignScanState *node);
+extern bool ExecAsyncForeignScanConfigureWait(ForeignScanState *node,
+											  struct WaitEventSet *set);
+
 #endif							/* NODEFOREIGNSCAN_H */
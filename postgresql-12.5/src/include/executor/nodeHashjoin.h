@@ -28,6 +28,10 @@ extern void ExecHashJoinReInitializeDSM(HashJoinState *state, ParallelContext *p
 extern void ExecHashJoinInitializeWorker(HashJoinState *state,
 										 ParallelWorkerContext *pwcxt);
 
+extern bool ExecHashJoinBloomFilter(HashJoinState *hjstate,
+									ExprContext *econtext,
+									TupleTableSlot *slot);
+
 extern void ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 								  BufFile **fileptr);
 
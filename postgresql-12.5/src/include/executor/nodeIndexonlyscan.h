@@ -14,6 +14,7 @@
 #ifndef NODEINDEXONLYSCAN_H
 #define NODEINDEXONLYSCAN_H
 
+#include "access/genam.h"
 #include "nodes/execnodes.h"
 #include "access/parallel.h"
 
@@ -21,6 +22,7 @@ extern IndexOnlyScanState *ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *es
 extern void ExecEndIndexOnlyScan(IndexOnlyScanState *node);
 extern void ExecIndexOnlyMarkPos(IndexOnlyScanState *node);
 extern void ExecIndexOnlyRestrPos(IndexOnlyScanState *node);
+extern void ExecIndexOnlyScanSeek(IndexOnlyScanState *node, ScanKey seekkey);
 extern void ExecReScanIndexOnlyScan(IndexOnlyScanState *node);
 
 /* Support functions for parallel index-only scans */
@@ -22,6 +22,7 @@ extern IndexScanState *ExecInitIndexScan(IndexScan *node, EState *estate, int ef
 extern void ExecEndIndexScan(IndexScanState *node);
 extern void ExecIndexMarkPos(IndexScanState *node);
 extern void ExecIndexRestrPos(IndexScanState *node);
+extern void ExecIndexScanSeek(IndexScanState *node, ScanKey seekkey);
 extern void ExecReScanIndexScan(IndexScanState *node);
 extern void ExecIndexScanEstimate(IndexScanState *node, ParallelContext *pcxt);
 extern void ExecIndexScanInitializeDSM(IndexScanState *node, ParallelContext *pcxt);
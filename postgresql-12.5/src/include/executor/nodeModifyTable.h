@@ -17,6 +17,12 @@
 
 extern void ExecComputeStoredGenerated(EState *estate, TupleTableSlot *slot);
 
+extern int	ExecGetForeignBatchSize(ResultRelInfo *resultRelInfo, bool batch_ok);
+extern void ExecForeignBatchInsertAdd(EState *estate,
+									  ResultRelInfo *resultRelInfo,
+									  TupleTableSlot *slot);
+extern void ExecPendingInserts(EState *estate);
+
 extern ModifyTableState *ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags);
 extern void ExecEndModifyTable(ModifyTableState *node);
 extern void ExecReScanModifyTable(ModifyTableState *node);
@@ -111,6 +111,20 @@
 struct TupleTableSlotOps;
 typedef struct TupleTableSlotOps TupleTableSlotOps;
 
+/*
+ * Attribute offsets within a tuple that has nulls, remembered by
+ * slot_deform_heap_tuple() so that following tuples with the same nulls need
+ * not recompute them.  Only the leading fixed-width attributes are covered,
+ * since later offsets depend on the lengths of varlena values.
+ */
+typedef struct SlotNullOffsets
+{
+	int			ncached;		/* offsets known for attributes < ncached */
+	bool		complete;		/* reached a varlena, can't extend further */
+	bits8	   *bits;			/* null bitmap the offsets are valid for */
+	uint32		offsets[FLEXIBLE_ARRAY_MEMBER]; /* per attribute, if not null */
+} SlotNullOffsets;
+
 /* base tuple table slot type */
 typedef struct TupleTableSlot
 {
@@ -129,6 +143,7 @@ typedef struct TupleTableSlot
 	MemoryContext tts_mcxt;		/* slot itself is in this context */
 	ItemPointerData tts_tid;	/* stored tuple's tid */
 	Oid			tts_tableOid;	/* table oid of tuple */
+	SlotNullOffsets *tts_nulloffs;	/* deforming state, or NULL if none */
 } TupleTableSlot;
 
 /* routines for a TupleTableSlot implementation */
@@ -19,6 +19,9 @@
 /* To avoid including explain.h here, reference ExplainState thus: */
 struct ExplainState;
 
+/* To avoid including latch.h here, reference WaitEventSet thus: */
+struct WaitEventSet;
+
 
 /*
  * Callback function signatures --- see fdwhandler.sgml for more info.
@@ -90,6 +93,13 @@ typedef TupleTableSlot *(*ExecForeignUpdate_function) (EState *estate,
 													   TupleTableSlot *slot,
 													   TupleTableSlot *planSlot);
 
+typedef TupleTableSlot **(*ExecForeignBatchInsert_function) (EState *estate,
+															 ResultRelInfo *rinfo,
+															 TupleTableSlot **slots,
+															 int *numSlots);
+
+typedef int (*GetForeignModifyBatchSize_function) (ResultRelInfo *rinfo);
+
 typedef TupleTableSlot *(*ExecForeignDelete_function) (EState *estate,
 													   ResultRelInfo *rinfo,
 													   TupleTableSlot *slot,
@@ -169,6 +179,11 @@ typedef bool (*IsForeignScanParallelSafe_function) (PlannerInfo *root,
 typedef List *(*ReparameterizeForeignPathByChild_function) (PlannerInfo *root,
 															List *fdw_private,
 															RelOptInfo *child_rel);
+typedef bool (*IsForeignPathAsyncCapable_function) (ForeignPath *path);
+typedef void (*ForeignAsyncRequest_function) (ForeignScanState *node);
+typedef bool (*ForeignAsyncReady_function) (ForeignScanState *node);
+typedef bool (*ForeignAsyncConfigureWait_function) (ForeignScanState *node,
+													struct WaitEventSet *set);
 
 /*
  * FdwRoutine is the struct returned by a foreign-data wrapper's handler
@@ -209,6 +224,8 @@ typedef struct FdwRoutine
 	PlanForeignModify_function PlanForeignModify;
 	BeginForeignModify_function BeginForeignModify;
 	ExecForeignInsert_function ExecForeignInsert;
+	ExecForeignBatchInsert_function ExecForeignBatchInsert;
+	GetForeignModifyBatchSize_function GetForeignModifyBatchSize;
 	ExecForeignUpdate_function ExecForeignUpdate;
 	ExecForeignDelete_function ExecForeignDelete;
 	EndForeignModify_function EndForeignModify;
@@ -246,6 +263,12 @@ typedef struct FdwRoutine
 
 	/* Support functions for path reparameterization. */
 	ReparameterizeForeignPathByChild_function ReparameterizeForeignPathByChild;
+
+	/* Support functions for asynchronous execution under Append */
+	IsForeignPathAsyncCapable_function IsForeignPathAsyncCapable;
+	ForeignAsyncRequest_function ForeignAsyncRequest;
+	ForeignAsyncReady_function ForeignAsyncReady;
+	ForeignAsyncConfigureWait_function ForeignAsyncConfigureWait;
 } FdwRoutine;
 
 
@@ -73,6 +73,8 @@ extern int	pq_getbyte(void);
 extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
 extern int	pq_putbytes(const char *s, size_t len);
+extern const char *pq_choose_compression(const char *requested);
+extern int	pq_enable_compression(const char *algorithm);
 
 /*
  * prototypes for functions in be-secure.c
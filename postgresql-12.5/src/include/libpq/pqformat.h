@@ -30,6 +30,7 @@ extern void pq_sendstring(StringInfo buf, const char *str);
 extern void pq_send_ascii_string(StringInfo buf, const char *str);
 extern void pq_sendfloat4(StringInfo buf, float4 f);
 extern void pq_sendfloat8(StringInfo buf, float8 f);
+extern bool pq_sendfixedbinary(StringInfo buf, Oid typsend, Datum value);
 
 /*
  * Append a [u]int8 to a StringInfo buffer, which already has enough space
@@ -200,6 +201,8 @@ extern unsigned int pq_getmsgint(StringInfo msg, int b);
 extern int64 pq_getmsgint64(StringInfo msg);
 extern float4 pq_getmsgfloat4(StringInfo msg);
 extern float8 pq_getmsgfloat8(StringInfo msg);
+extern bool pq_getmsgfixedbinary(StringInfo msg, Oid typreceive,
+								 Datum *result);
 extern const char *pq_getmsgbytes(StringInfo msg, int datalen);
 extern void pq_copymsgbytes(StringInfo msg, char *buf, int datalen);
 extern char *pq_getmsgtext(StringInfo msg, int rawbytes, int *nbytes);
@@ -16,6 +16,7 @@
 
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -444,6 +445,11 @@ typedef struct ResultRelInfo
 	/* true when modifying foreign table directly */
 	bool		ri_usesFdwDirectModify;
 
+	/* batched foreign-table INSERT; ri_BatchSize is 0 until decided */
+	int			ri_BatchSize;	/* max # of rows to send in one batch */
+	int			ri_NumSlots;	/* # of rows currently buffered */
+	TupleTableSlot **ri_Slots;	/* buffered rows */
+
 	/* list of WithCheckOption's to be checked */
 	List	   *ri_WithCheckOptions;
 
@@ -563,6 +569,9 @@ typedef struct EState
 
 	List	   *es_auxmodifytables; /* List of secondary ModifyTableStates */
 
+	/* ResultRelInfos with rows buffered for a batched foreign INSERT */
+	List	   *es_insert_pending_result_relations;
+
 	/*
 	 * this ExprContext is for per-output-tuple operations, such as constraint
 	 * checks and index-value computations.  It will be reset for each output
@@ -611,7 +620,8 @@ typedef struct EState
  * inactive children of inheritance trees), curCtid, which is used by the
  * WHERE CURRENT OF code, and ermExtra, which is available for use by the plan
  * node that sources the relation (e.g., for a foreign table the FDW can use
- * ermExtra to hold information).
+ * ermExtra to hold information).  The relation of an inheritance child is
+ * opened only when first needed, so use ExecRowMarkGetRelation to get it.
  *
  * EState->es_rowmarks is an array of these structs, indexed by RT index,
  * with NULLs for irrelevant RT indexes.  es_rowmarks itself is NULL if
@@ -695,6 +705,7 @@ typedef struct TupleHashTableData
 	AttrNumber *keyColIdx;		/* attr numbers of key columns */
 	FmgrInfo   *tab_hash_funcs; /* hash functions for table datatype(s) */
 	ExprState  *tab_eq_func;	/* comparator for table datatype(s) */
+	ExprState  *tab_hash_expr;	/* hashes input tuples with tab_hash_funcs */
 	Oid		   *tab_collations; /* collations for hash and comparison */
 	MemoryContext tablecxt;		/* memory context containing table */
 	MemoryContext tempcxt;		/* context for function evaluations */
@@ -928,6 +939,18 @@ typedef struct DomainConstraintState
  */
 typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
 
+/* ----------------
+ *	 ExecProcNodeBatchMtd
+ *
+ * Optional method called by ExecProcNodeBatch to return a batch of tuples
+ * from an executor node.  It sets *slots to an array of slots owned by the
+ * node and returns the number of valid entries; zero means no more tuples
+ * are available.  The returned slots stay valid until the next call.
+ * ----------------
+ */
+typedef int (*ExecProcNodeBatchMtd) (struct PlanState *pstate,
+									 TupleTableSlot ***slots);
+
 /* ----------------
  *		PlanState node
  *
@@ -948,6 +971,9 @@ typedef struct PlanState
 	ExecProcNodeMtd ExecProcNode;	/* function to return next tuple */
 	ExecProcNodeMtd ExecProcNodeReal;	/* actual function, if above is a
 										 * wrapper */
+	ExecProcNodeBatchMtd ExecProcNodeBatch; /* function to return a batch of
+											 * tuples, or NULL if the node
+											 * does not support that */
 
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
@@ -1193,6 +1219,9 @@ typedef struct ModifyTableState
 
 	/* Per plan map for tuple conversion from child to root */
 	TupleConversionMap **mt_per_subplan_tupconv_maps;
+
+	/* Buffered rows of a batched INSERT, or NULL if not batching */
+	struct ModifyTableMultiInsert *mt_multi_insert;
 } ModifyTableState;
 
 /* ----------------
@@ -1227,6 +1256,14 @@ struct AppendState
 	struct PartitionPruneState *as_prune_state;
 	Bitmapset  *as_valid_subplans;
 	bool		(*choose_next_subplan) (AppendState *);
+
+	/* Asynchronous execution state */
+	Bitmapset  *as_asyncplans;	/* indexes of async-capable subplans */
+	int			as_nasyncplans; /* # of async-capable subplans */
+	Bitmapset  *as_asyncremain; /* async subplans not yet exhausted */
+	int			as_lastasync;	/* async subplan we last returned from */
+	bool		as_begun;		/* have async requests been sent? */
+	bool		as_syncdone;	/* are all sync subplans exhausted? */
 };
 
 /* ----------------
@@ -1285,6 +1322,17 @@ typedef struct RecursiveUnionState
 	MemoryContext tempContext;	/* short-term context for comparisons */
 	TupleHashTable hashtable;	/* hash table for tuples already seen */
 	MemoryContext tableContext; /* memory context containing hash table */
+
+	/* spilling of the hash table to disk, see nodeRecursiveunion.c */
+	Size		hash_mem_limit; /* memory limit before spilling */
+	int64		hash_ngroups;	/* number of tuples in hash table */
+	int			spill_npartitions;	/* number of partitions, 0 if not spilled */
+	int			spill_shift;	/* shift hash value right to get partition */
+	struct BufFile **spill_seen;	/* tuples already seen, per partition */
+	struct BufFile **spill_pending; /* tuples yet to be checked, per partition */
+	int			spill_current;	/* partition being checked, or -1 */
+	TupleTableSlot *spill_slot; /* slot for tuples read back */
+	int64		spill_disk_used;	/* bytes written to spill files */
 } RecursiveUnionState;
 
 /* ----------------
@@ -1344,6 +1392,15 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	int			batch_size;		/* max tuples per batch, if batching */
+	TupleTableSlot **batch_slots;	/* slots for batch mode, or NULL */
+	bool		batch_done;		/* batch mode reached end of scan */
+	struct HashJoinState *bloom_source; /* hash join whose Bloom filter we
+										 * apply to our output, or NULL */
+	bool		use_hints;		/* pass the below to table_scan_set_hints? */
+	Bitmapset  *hint_attrs;		/* columns used, as from pull_varattnos */
+	int			hint_nkeys;		/* number of hint_keys */
+	struct ScanKeyData *hint_keys;	/* simple quals the AM may check */
 } SeqScanState;
 
 /* ----------------
@@ -1404,6 +1461,7 @@ typedef struct
  *		RuntimeContext	   expr context for evaling runtime Skeys
  *		RelationDesc	   index relation descriptor
  *		ScanDesc		   index scan descriptor
+ *		SeekKeys		   ScanKeys plus the key of the last seek, if any
  *
  *		ReorderQueue	   tuples that need reordering due to re-check
  *		ReachedEnd		   have we fetched all tuples from index already?
@@ -1430,6 +1488,7 @@ typedef struct IndexScanState
 	ExprContext *iss_RuntimeContext;
 	Relation	iss_RelationDesc;
 	struct IndexScanDescData *iss_ScanDesc;
+	struct ScanKeyData *iss_SeekKeys;
 
 	/* These are needed for re-checking ORDER BY expr ordering */
 	pairingheap *iss_ReorderQueue;
@@ -1456,6 +1515,7 @@ typedef struct IndexScanState
  *		RuntimeContext	   expr context for evaling runtime Skeys
  *		RelationDesc	   index relation descriptor
  *		ScanDesc		   index scan descriptor
+ *		SeekKeys		   ScanKeys plus the key of the last seek, if any
  *		TableSlot		   slot for holding tuples fetched from the table
  *		VMBuffer		   buffer in use for visibility map testing, if any
  *		PscanLen		   size of parallel index-only scan descriptor
@@ -1475,6 +1535,7 @@ typedef struct IndexOnlyScanState
 	ExprContext *ioss_RuntimeContext;
 	Relation	ioss_RelationDesc;
 	struct IndexScanDescData *ioss_ScanDesc;
+	struct ScanKeyData *ioss_SeekKeys;
 	TupleTableSlot *ioss_TableSlot;
 	Buffer		ioss_VMBuffer;
 	Size		ioss_PscanLen;
@@ -1542,6 +1603,10 @@ typedef enum
  *		prefetch_target			current target prefetch distance
  *		state					current state of the TIDBitmap
  *		cv						conditional wait variable
+ *		nchildren				# of BitmapAnd/Or inputs built in parallel
+ *		next_child				next such input to be claimed
+ *		nchildren_done			# of such inputs built so far
+ *		child_bitmaps			array of their shared bitmaps
  *		phs_snapshot_data		snapshot data shared to workers
  * ----------------
  */
@@ -1554,6 +1619,10 @@ typedef struct ParallelBitmapHeapState
 	int			prefetch_target;
 	SharedBitmapState state;
 	ConditionVariable cv;
+	int			nchildren;
+	int			next_child;
+	int			nchildren_done;
+	dsa_pointer child_bitmaps;
 	char		phs_snapshot_data[FLEXIBLE_ARRAY_MEMBER];
 } ParallelBitmapHeapState;
 
@@ -1627,6 +1696,24 @@ typedef struct TidScanState
 	HeapTupleData tss_htup;
 } TidScanState;
 
+/* ----------------
+ *	 TidRangeScanState information
+ *
+ *		trss_tidexprs		list of TidOpExpr structs (see nodeTidrangescan.c)
+ *		trss_mintid			the lowest TID in the scan range
+ *		trss_maxtid			the highest TID in the scan range
+ *		trss_inScan			is a scan currently in progress?
+ * ----------------
+ */
+typedef struct TidRangeScanState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	List	   *trss_tidexprs;
+	ItemPointerData trss_mintid;
+	ItemPointerData trss_maxtid;
+	bool		trss_inScan;
+} TidRangeScanState;
+
 /* ----------------
  *	 SubqueryScanState information
  *
@@ -1799,6 +1886,7 @@ typedef struct ForeignScanState
 	/* use struct pointer to avoid including fdwapi.h here */
 	struct FdwRoutine *fdwroutine;
 	void	   *fdw_state;		/* foreign-data wrapper can keep state here */
+	int64		tuples_needed;	/* tuple bound, see ExecSetTupleBound */
 } ForeignScanState;
 
 /* ----------------
@@ -1852,6 +1940,16 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *
+ *		The remaining fields support switching to a hashed inner side when
+ *		the outer side turns out much larger than estimated; see
+ *		nodeNestloop.c.
+ *		SwitchRows		   hash the inner after this many outer rows (0: never)
+ *		NumOuter		   outer rows fetched so far in this scan
+ *		Hashed			   true if probing HashTable instead of rescanning
+ *		HashNext		   next inner tuple matching the current outer tuple
+ *		SwitchedAfter, HashedInnerRows, HashSpacePeak, HashAbandoned
+ *						   instrumentation for EXPLAIN ANALYZE
  * ----------------
  */
 typedef struct NestLoopState
@@ -1860,6 +1958,31 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+
+	double		nl_SwitchRows;
+	double		nl_NumOuter;
+	bool		nl_Hashed;
+	int			nl_NumHashKeys;
+	AttrNumber *nl_HashKeyColIdx;	/* 1..n, columns of the key slots */
+	Oid		   *nl_HashEqFuncOids;	/* inner = inner equality functions */
+	Oid		   *nl_HashCollations;
+	FmgrInfo   *nl_InnerHashFuncs;
+	FmgrInfo   *nl_OuterHashFuncs;
+	ExprState  *nl_HashCurEqComp;	/* outer = inner, possibly cross-type */
+	ProjectionInfo *nl_OuterKeyProj;
+	ProjectionInfo *nl_InnerKeyProj;
+	ExprContext *nl_InnerKeyContext;
+	TupleDesc	nl_InnerKeyDesc;
+	TupleHashTable nl_HashTable;
+	MemoryContext nl_HashTableCxt;
+	MemoryContext nl_HashTempCxt;
+	TupleTableSlot *nl_HashInnerSlot;	/* returns stored inner tuples */
+	struct NestLoopHashTuple *nl_HashNext;
+
+	double		nl_SwitchedAfter;
+	double		nl_HashedInnerRows;
+	Size		nl_HashSpacePeak;
+	bool		nl_HashAbandoned;
 } NestLoopState;
 
 /* ----------------
@@ -1907,6 +2030,11 @@ typedef struct MergeJoinState
 	TupleTableSlot *mj_NullInnerTupleSlot;
 	ExprContext *mj_OuterEContext;
 	ExprContext *mj_InnerEContext;
+	struct ScanKeyData *mj_InnerSeekKey;	/* NULL if inner can't seek */
+	int16		mj_SeekTypLen;	/* type info of the seek key argument */
+	bool		mj_SeekTypByVal;
+	int			mj_InnerSkipped;	/* inner tuples skipped in a row */
+	long		mj_InnerSeeks;	/* number of inner seeks, for EXPLAIN */
 } MergeJoinState;
 
 /* ----------------
@@ -1932,6 +2060,7 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_NullAware			true if NOT IN semantics apply to NULL keys
  * ----------------
  */
 
@@ -1959,6 +2088,10 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	bool		hj_NullAware;
+	bool		hj_UseBloomFilter;	/* filter our outer SeqScan's tuples? */
+	uint64		hj_BloomChecked;	/* outer tuples checked against filter */
+	uint64		hj_BloomRemoved;	/* ... and how many it rejected */
 } HashJoinState;
 
 
@@ -1984,6 +2117,68 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+/* ----------------
+ *	 ResultCacheInstrumentation information
+ * ----------------
+ */
+typedef struct ResultCacheInstrumentation
+{
+	uint64		cache_hits;		/* number of rescans where we've found the
+								 * scan parameter values to be cached */
+	uint64		cache_misses;	/* number of rescans where we've not found the
+								 * scan parameter values to be cached. */
+	uint64		cache_evictions;	/* number of cache entries removed due to
+									 * the need to free memory */
+	uint64		cache_overflows;	/* number of times we've had to bypass the
+									 * cache when filling it due to not being
+									 * able to free enough space to store the
+									 * current scan's tuples. */
+	uint64		mem_peak;		/* peak memory usage in bytes */
+} ResultCacheInstrumentation;
+
+/* ----------------
+ *	 ResultCacheState information
+ *
+ *		resultcache nodes are used to cache recent and commonly seen results
+ *		from a parameterized scan.
+ * ----------------
+ */
+/* these structs are private in nodeResultCache.c: */
+struct resultcache_hash;
+struct ResultCacheEntry;
+struct ResultCacheTuple;
+
+typedef struct ResultCacheState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			rc_status;		/* value of ExecResultCache state machine */
+	int			nkeys;			/* number of cache keys */
+	struct resultcache_hash *hashtable; /* hash table for cache entries */
+	TupleDesc	hashkeydesc;	/* tuple descriptor for cache keys */
+	TupleTableSlot *tableslot;	/* min tuple slot for existing cache entries */
+	TupleTableSlot *probeslot;	/* virtual slot used for hash lookups */
+	ExprState  *cache_eq_expr;	/* Compare exec params to hash key */
+	ExprState **param_exprs;	/* exprs containing the parameters to this
+								 * node */
+	FmgrInfo   *hashfunctions;	/* lookup data for hash funcs nkeys in size */
+	Oid		   *collations;		/* collation for comparisons nkeys in size */
+	uint64		mem_used;		/* bytes of memory used by cache */
+	uint64		mem_limit;		/* memory limit in bytes for the cache */
+	MemoryContext tableContext; /* memory context to store cache data */
+	dlist_head	lru_list;		/* least recently used entry list */
+	struct ResultCacheTuple *last_tuple;	/* Used to point to the last tuple
+											 * returned during a cache hit and
+											 * the tuple we last stored when
+											 * populating the cache. */
+	struct ResultCacheEntry *entry; /* the entry that 'last_tuple' belongs to
+									 * or NULL if 'last_tuple' is NULL. */
+	bool		singlerow;		/* true if the cache entry is to be marked as
+								 * complete after caching the first tuple. */
+	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
+								 * param_exprs */
+	ResultCacheInstrumentation stats;	/* execution statistics */
+} ResultCacheState;
+
 /* ----------------
  *	 Shared memory container for per-worker sort information
  * ----------------
@@ -2012,6 +2207,43 @@ typedef struct SortState
 	SharedSortInfo *shared_info;	/* one entry per worker */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *	The input is read in batches of at least a minimum number of tuples,
+ *	each extended to the end of a run of tuples with equal presorted
+ *	columns, and each batch is sorted on its own.
+ * ----------------
+ */
+typedef struct PresortedKeyData
+{
+	FmgrInfo	flinfo;			/* equality function of the sort operator */
+	FunctionCallInfo fcinfo;	/* reusable call info for flinfo */
+	AttrNumber	attno;			/* attribute number in the input */
+} PresortedKeyData;
+
+typedef struct IncrementalSortInstrumentation
+{
+	int64		batchCount;		/* number of batches sorted */
+	int64		maxSpaceUsed;	/* peak space used by a batch, in kB */
+	TuplesortSpaceType maxSpaceType;	/* type of maxSpaceUsed */
+	TuplesortMethod sortMethod; /* sort method of the largest batch */
+} IncrementalSortInstrumentation;
+
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		bound_Done;		/* number of tuples returned so far */
+	bool		outerNodeDone;	/* has the input been exhausted? */
+	PresortedKeyData *presorted_keys;	/* keys the input is sorted by */
+	void	   *tuplesortstate; /* tuplesort of the current batch, or NULL */
+	TupleTableSlot *group_pivot;	/* tuple ending the minimum batch size */
+	TupleTableSlot *transfer_tuple; /* first tuple of the next batch */
+	IncrementalSortInstrumentation stats;	/* execution statistics */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -2092,6 +2324,25 @@ typedef struct AggState
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
+
+	/* batched retrieval of input tuples from the outer plan */
+	bool		input_batched;	/* fetch input using ExecProcNodeBatch? */
+	TupleTableSlot **input_batch;	/* current batch of input tuples */
+	int			input_batch_ntuples;	/* number of tuples in batch */
+	int			input_batch_next;	/* next tuple of batch to return */
+
+	/* spilling of hashed aggregation to disk, see nodeAgg.c */
+	bool		hash_can_spill; /* may groups overflow to disk? */
+	bool		hash_spill_mode;	/* table full, spill tuples of new groups */
+	Size		hash_mem_limit; /* memory limit before entering spill mode */
+	int64		hash_ngroups_current;	/* number of groups in hash table */
+	double		hash_ngroups_estimate;	/* number of groups expected */
+	int			hash_used_bits; /* hash bits already used for partitioning */
+	struct HashAggSpill *hash_spill;	/* partitions being written */
+	List	   *hash_batches;	/* spilled partitions yet to be processed */
+	TupleTableSlot *hash_spill_slot;	/* slot for tuples read back */
+	int			hash_batches_used;	/* number of batches created */
+	int64		hash_disk_used; /* bytes written to spill files */
 } AggState;
 
 /* ----------------
@@ -2211,6 +2462,10 @@ typedef struct GatherState
 	/* these fields are set up once: */
 	TupleTableSlot *funnel_slot;
 	struct ParallelExecutorInfo *pei;
+	/* if into_relid is valid, workers insert their tuples into that table: */
+	Oid			into_relid;
+	CommandId	into_cid;		/* cmin for the inserted tuples */
+	int			into_options;	/* table_tuple_insert options */
 	/* all remaining fields are reinitialized during a rescan: */
 	int			nworkers_launched;	/* original number of workers */
 	int			nreaders;		/* number of still-active workers */
@@ -2250,6 +2505,46 @@ typedef struct GatherMergeState
 	struct binaryheap *gm_heap; /* binary heap of slot indices */
 } GatherMergeState;
 
+/* ----------------
+ *	 RepartitionState information
+ *
+ *		A Repartition node returns the rows of its subplan whose hash key
+ *		falls into a slot claimed by this participant.  In exchange mode, it
+ *		returns the rows whose hash key belongs to this participant, from
+ *		its own share of the subplan's rows and from the other participants.
+ * ----------------
+ */
+struct ParallelRepartitionState;
+typedef struct ParallelRepartitionState ParallelRepartitionState;
+
+typedef struct RepartitionState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	FmgrInfo   *hashfunctions;	/* hash functions of the key columns */
+	int			cur_slot;		/* slot being returned, or -1 if none */
+	bool		need_rescan;	/* must rescan subplan before next slot? */
+	bool		finished;		/* no slots left to claim? */
+	ParallelRepartitionState *pstate;	/* shared state, or NULL */
+
+	/* these fields are used in exchange mode only */
+	struct dsm_segment *seg;	/* segment holding the queues */
+	bool		exchange_started;	/* participant and queues set up? */
+	int			participant;	/* our number, or -1 if not taking part */
+	int			nparticipants;	/* number of participants */
+	bool		child_done;		/* subplan exhausted? */
+	struct shm_mq_handle **outqueues;	/* queue to each participant */
+	struct shm_mq_handle **inqueues;	/* queues from the participants still
+										 * sending to us */
+	struct TupleQueueReader **readers;	/* readers for inqueues */
+	int			nreaders;		/* number of active readers */
+	int			nextreader;		/* next one to try to read from */
+	HeapTuple	pending_tuple;	/* row waiting for room in its queue */
+	int			pending_dest;	/* participant it is going to */
+	Tuplestorestate *buffer;	/* rows received while waiting for room */
+	TupleTableSlot *buffer_slot;	/* slot for rows read from buffer */
+	TupleTableSlot *recv_slot;	/* slot for rows read from a queue */
+} RepartitionState;
+
 /* ----------------
  *	 Values displayed by EXPLAIN ANALYZE
  * ----------------
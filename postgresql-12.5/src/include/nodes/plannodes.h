@@ -74,6 +74,13 @@ typedef struct PlannedStmt
 	 */
 	List	   *rootResultRelations;
 
+	/*
+	 * rtable indexes of relations that are scanned only by Append or
+	 * MergeAppend subplans that initial partition pruning may remove.
+	 * AcquireExecutorLocks() doesn't lock these if they are pruned.
+	 */
+	Bitmapset  *prunableRelids;
+
 	List	   *subplans;		/* Plan trees for SubPlan expressions; note
 								 * that some could be NULL */
 
@@ -133,6 +140,11 @@ typedef struct Plan
 	bool		parallel_aware; /* engage parallel-aware logic? */
 	bool		parallel_safe;	/* OK to use as part of parallel plan? */
 
+	/*
+	 * information needed for asynchronous execution
+	 */
+	bool		async_capable;	/* engage asynchronous-capable logic? */
+
 	/*
 	 * Common structural data for all Plan types.
 	 */
@@ -221,6 +233,7 @@ typedef struct ModifyTable
 	Index		nominalRelation;	/* Parent RT index for use of EXPLAIN */
 	Index		rootRelation;	/* Root RT index, if target is partitioned */
 	bool		partColsUpdated;	/* some part key in hierarchy updated */
+	bool		multiInsertSafe;	/* may INSERT rows be buffered? */
 	List	   *resultRelations;	/* integer list of RT indexes */
 	int			resultRelIndex; /* index of first resultRel in plan's list */
 	int			rootResultRelIndex; /* index of the partitioned table root */
@@ -489,6 +502,19 @@ typedef struct TidScan
 	List	   *tidquals;		/* qual(s) involving CTID = something */
 } TidScan;
 
+/* ----------------
+ *		tid range scan node
+ *
+ * tidrangequals is an implicitly AND'ed list of qual expressions of the form
+ * "CTID relop pseudoconstant", where relop is one of >,>=,<,<=.
+ * ----------------
+ */
+typedef struct TidRangeScan
+{
+	Scan		scan;
+	List	   *tidrangequals;	/* qual(s) involving CTID op something */
+} TidRangeScan;
+
 /* ----------------
  *		subquery scan node
  *
@@ -745,6 +771,13 @@ typedef struct HashJoin
 	 * perform lookups in the hashtable over the inner plan.
 	 */
 	List	   *hashkeys;
+
+	/*
+	 * True for an anti join made from NOT IN: no rows are returned if the
+	 * inner side has a NULL key, and NULL outer keys are returned only if
+	 * the inner side is empty.
+	 */
+	bool		nullaware;
 } HashJoin;
 
 /* ----------------
@@ -756,6 +789,30 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ * Caches the results of its parameterized subplan, keyed by the values of
+ * param_exprs, so that rescans with previously seen parameter values need
+ * not execute the subplan again.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+
+	int			numKeys;		/* size of the two arrays below */
+	Oid		   *hashOperators;	/* hash operators for each key */
+	Oid		   *collations;		/* collations for each key */
+	List	   *param_exprs;	/* exprs containing parameters */
+	bool		singlerow;		/* true if the cache entry should be marked as
+								 * complete after we store the first tuple in
+								 * it. */
+	uint32		est_entries;	/* The maximum number of entries that the
+								 * planner expects will fit in the cache, or 0
+								 * if unknown */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -770,6 +827,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is already sorted by the first nPresortedCols sort columns, so
+ * only runs of tuples sharing those need to be sorted.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			nPresortedCols; /* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -896,6 +966,27 @@ typedef struct GatherMerge
 								 * at gather merge or one of it's child node */
 } GatherMerge;
 
+/* ------------
+ *		repartition node
+ *
+ * Runs its subplan in full in each participant of a parallel query, but
+ * returns only the rows whose hash key falls into one of the nslots slots
+ * claimed by this participant.  In exchange mode, the subplan is partial
+ * instead, and the participants send each other the rows whose hash key
+ * belongs to another participant.  See nodeRepartition.c.
+ * ------------
+ */
+typedef struct Repartition
+{
+	Plan		plan;
+	bool		exchange;		/* exchange rows with the other workers? */
+	int			nslots;			/* number of slots to split the rows into */
+	int			numCols;		/* number of hash key columns */
+	AttrNumber *hashColIdx;		/* their indexes in the target list */
+	Oid		   *hashOperators;	/* equality operators to hash them for */
+	Oid		   *hashCollations; /* collations to hash them with */
+} Repartition;
+
 /* ----------------
  *		hash build node
  *
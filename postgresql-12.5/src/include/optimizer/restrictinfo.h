@@ -30,6 +30,7 @@ extern RestrictInfo *make_restrictinfo(Expr *clause,
 									   Relids outer_relids,
 									   Relids nullable_relids);
 extern RestrictInfo *commute_restrictinfo(RestrictInfo *rinfo, Oid comm_op);
+extern Expr *get_nullaware_opclause(Expr *clause);
 extern bool restriction_is_or_clause(RestrictInfo *restrictinfo);
 extern bool restriction_is_securely_promotable(RestrictInfo *restrictinfo,
 											   RelOptInfo *rel);
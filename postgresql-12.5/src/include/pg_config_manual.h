@@ -234,6 +234,15 @@
  */
 #define PG_CACHE_LINE_SIZE		128
 
+/*
+ * Assumed alignment requirement for direct I/O.  With io_direct, data and
+ * WAL files are opened with O_DIRECT, which on most platforms requires the
+ * memory buffers, file offsets and transfer sizes to be multiples of the
+ * logical block size of the underlying device.  4kB covers all common
+ * storage; shared buffers and WAL buffers are aligned to this boundary.
+ */
+#define PG_IO_ALIGN_SIZE		4096
+
 /*
  *------------------------------------------------------------------------
  * The following symbols are for enabling debugging code, not for
@@ -41,6 +41,39 @@ typedef uint32 pg_crc32c;
 #define INIT_CRC32C(crc) ((crc) = 0xFFFFFFFF)
 #define EQ_CRC32C(c1, c2) ((c1) == (c2))
 
+/*
+ * The hardware implementations below split long inputs into three streams
+ * of PG_CRC32C_STREAM_LEN bytes each and compute their CRCs in parallel,
+ * since the CRC instructions have a latency of several cycles but can
+ * start one per cycle.  The partial CRCs are then combined by shifting each
+ * one past the streams that follow it, which is a multiplication by
+ * x^(8 * n) modulo the CRC polynomial.  These are the constants for shifting
+ * by one and two streams, in bit-reflected form.
+ */
+#define PG_CRC32C_STREAM_LEN	512
+#define PG_CRC32C_SHIFT_1STREAM	0x74c360a4	/* x^(8 * 512) mod P */
+#define PG_CRC32C_SHIFT_2STREAM	0xe4172b16	/* x^(8 * 1024) mod P */
+
+/*
+ * Multiply a CRC register by the bit-reflected polynomial k, modulo the
+ * CRC-32C polynomial.
+ */
+static inline pg_crc32c
+pg_crc32c_shift(pg_crc32c crc, uint32 k)
+{
+	uint32		result = 0;
+	uint32		bit;
+
+	for (bit = 0x80000000; bit != 0; bit >>= 1)
+	{
+		if (k & bit)
+			result ^= crc;
+		crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+	}
+
+	return result;
+}
+
 #if defined(USE_SSE42_CRC32C)
 /* Use Intel SSE4.2 instructions. */
 #define COMP_CRC32C(crc, data, len) \
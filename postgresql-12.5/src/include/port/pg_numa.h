@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.h
+ *	  Minimal NUMA support for placing shared memory and processes.
+ *
+ * Only Linux is supported; elsewhere the machine is treated as a single
+ * node and the placement functions do nothing.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ *
+ * src/include/port/pg_numa.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_NUMA_H
+#define PG_NUMA_H
+
+extern int	pg_numa_num_nodes(void);
+extern int	pg_numa_current_node(void);
+extern bool pg_numa_interleave_memory(void *addr, Size len, int nnodes);
+extern bool pg_numa_bind_memory(void *addr, Size len, int node);
+extern bool pg_numa_bind_process(int node);
+
+#endif							/* PG_NUMA_H */
@@ -0,0 +1,142 @@
+/*-------------------------------------------------------------------------
+ *
+ * simd.h
+ *	  Support for platform-specific vector operations.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/simd.h
+ *
+ * NOTES
+ * - We only use vector instructions that are part of the baseline
+ *   instruction set of the target architecture (SSE2 on x86-64, Advanced
+ *   SIMD on AArch64), so no runtime CPU check is needed.  On other
+ *   platforms USE_NO_SIMD is defined and callers must use scalar code.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#if (defined(__x86_64__) || defined(_M_AMD64))
+/*
+ * SSE2 instructions are part of the spec for the 64-bit x86 ISA.  We assume
+ * that compilers targeting this architecture understand SSE2 intrinsics.
+ */
+#include <emmintrin.h>
+#define USE_SSE2
+typedef __m128i Vector8;
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/*
+ * We use the Neon instructions if the compiler provides access to them (as
+ * indicated by __ARM_NEON) and we are on aarch64.  While Neon support is
+ * technically optional for aarch64, it appears that all available 64-bit
+ * hardware does have it.
+ */
+#include <arm_neon.h>
+#define USE_NEON
+typedef uint8x16_t Vector8;
+
+#else
+/*
+ * If no SIMD instructions are available, callers fall back to their
+ * byte-at-a-time code.
+ */
+#define USE_NO_SIMD
+#endif
+
+#ifndef USE_NO_SIMD
+
+/*
+ * Load a chunk of memory into the given vector.  No alignment is required.
+ */
+static inline Vector8
+vector8_load(const char *s)
+{
+#if defined(USE_SSE2)
+	return _mm_loadu_si128((const __m128i *) s);
+#elif defined(USE_NEON)
+	return vld1q_u8((const uint8_t *) s);
+#endif
+}
+
+/*
+ * Store a vector into a chunk of memory.  No alignment is required.
+ */
+static inline void
+vector8_store(char *s, Vector8 v)
+{
+#if defined(USE_SSE2)
+	_mm_storeu_si128((__m128i *) s, v);
+#elif defined(USE_NEON)
+	vst1q_u8((uint8_t *) s, v);
+#endif
+}
+
+/*
+ * Create a vector with all elements set to the same value.
+ */
+static inline Vector8
+vector8_broadcast(const char c)
+{
+#if defined(USE_SSE2)
+	return _mm_set1_epi8(c);
+#elif defined(USE_NEON)
+	return vdupq_n_u8((uint8_t) c);
+#endif
+}
+
+/*
+ * Return a vector with all bits set in each lane where the corresponding
+ * lanes in the inputs are equal, and zero elsewhere.
+ */
+static inline Vector8
+vector8_eq(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_cmpeq_epi8(v1, v2);
+#elif defined(USE_NEON)
+	return vceqq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return the bitwise OR of the inputs.
+ */
+static inline Vector8
+vector8_or(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_or_si128(v1, v2);
+#elif defined(USE_NEON)
+	return vorrq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return true if the high bit of any element is set.
+ */
+static inline bool
+vector8_is_highbit_set(const Vector8 v)
+{
+#if defined(USE_SSE2)
+	return _mm_movemask_epi8(v) != 0;
+#elif defined(USE_NEON)
+	return vmaxvq_u8(v) > 0x7F;
+#endif
+}
+
+/*
+ * Return true if any element of the vector equals the given byte.
+ */
+static inline bool
+vector8_has(const Vector8 v, const char c)
+{
+	return vector8_is_highbit_set(vector8_eq(v, vector8_broadcast(c)));
+}
+
+#endif							/* ! USE_NO_SIMD */
+
+#endif							/* SIMD_H */
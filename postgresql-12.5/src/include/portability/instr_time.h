@@ -29,6 +29,8 @@
  *
  * INSTR_TIME_ACCUM_DIFF(x, y, z)	x += (y - z)
  *
+ * INSTR_TIME_ADD_NANOSEC(t, n)		t += n nanoseconds (n is a uint64)
+ *
  * INSTR_TIME_GET_DOUBLE(t)			convert t to double (in seconds)
  *
  * INSTR_TIME_GET_MILLISEC(t)		convert t to double (in milliseconds)
@@ -45,6 +47,11 @@
  *
  * Beware of multiple evaluations of the macro arguments.
  *
+ * Where the CPU has a cheap cycle counter we also define PG_INSTR_CYCLES
+ * and pg_read_cycles().  The counter's rate is not known here, and it may
+ * not be constant at all, so callers must establish at run time whether it
+ * is usable before relying on it; see InstrInitCycleCounter().
+ *
  *
  * Copyright (c) 2001-2019, PostgreSQL Global Development Group
  *
@@ -132,6 +139,18 @@ typedef struct timespec instr_time;
 		} \
 	} while (0)
 
+#define INSTR_TIME_ADD_NANOSEC(t,n) \
+	do { \
+		(t).tv_sec += (n) / 1000000000; \
+		(t).tv_nsec += (n) % 1000000000; \
+		/* Normalize */ \
+		if ((t).tv_nsec >= 1000000000) \
+		{ \
+			(t).tv_nsec -= 1000000000; \
+			(t).tv_sec++; \
+		} \
+	} while (0)
+
 #define INSTR_TIME_GET_DOUBLE(t) \
 	(((double) (t).tv_sec) + ((double) (t).tv_nsec) / 1000000000.0)
 
@@ -196,6 +215,18 @@ typedef struct timeval instr_time;
 		} \
 	} while (0)
 
+#define INSTR_TIME_ADD_NANOSEC(t,n) \
+	do { \
+		(t).tv_sec += (n) / 1000000000; \
+		(t).tv_usec += ((n) % 1000000000) / 1000; \
+		/* Normalize */ \
+		if ((t).tv_usec >= 1000000) \
+		{ \
+			(t).tv_usec -= 1000000; \
+			(t).tv_sec++; \
+		} \
+	} while (0)
+
 #define INSTR_TIME_GET_DOUBLE(t) \
 	(((double) (t).tv_sec) + ((double) (t).tv_usec) / 1000000.0)
 
@@ -228,6 +259,9 @@ typedef LARGE_INTEGER instr_time;
 #define INSTR_TIME_ACCUM_DIFF(x,y,z) \
 	((x).QuadPart += (y).QuadPart - (z).QuadPart)
 
+#define INSTR_TIME_ADD_NANOSEC(t,n) \
+	((t).QuadPart += (LONGLONG) ((double) (n) * GetTimerFrequency() / 1000000000.0))
+
 #define INSTR_TIME_GET_DOUBLE(t) \
 	(((double) (t).QuadPart) / GetTimerFrequency())
 
@@ -253,4 +287,21 @@ GetTimerFrequency(void)
 #define INSTR_TIME_SET_CURRENT_LAZY(t) \
 	(INSTR_TIME_IS_ZERO(t) ? INSTR_TIME_SET_CURRENT(t), true : false)
 
+/*
+ * Reading the x86 time stamp counter takes a few nanoseconds, against tens
+ * of nanoseconds for clock_gettime() through the vDSO and far more when the
+ * kernel has to fall back to a system call, as on many virtual machines.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && defined(HAVE__GET_CPUID) && !defined(WIN32)
+#include <x86intrin.h>
+
+#define PG_INSTR_CYCLES 1
+
+static inline uint64
+pg_read_cycles(void)
+{
+	return __rdtsc();
+}
+#endif
+
 #endif							/* INSTR_TIME_H */
@@ -16,8 +16,10 @@
 /* GUC options */
 extern bool EnableSSL;
 extern int	ReservedBackends;
+extern int	PreforkBackends;
 extern PGDLLIMPORT int PostPortNumber;
 extern int	Unix_socket_permissions;
+extern bool network_compression;
 extern char *Unix_socket_group;
 extern char *Unix_socket_directories;
 extern char *ListenAddresses;
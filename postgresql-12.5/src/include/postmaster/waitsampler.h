@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitsampler.h
+ *	  Exports from postmaster/waitsampler.c.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/waitsampler.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _WAITSAMPLER_H
+#define _WAITSAMPLER_H
+
+/* GUC options */
+extern bool wait_sampling;
+extern int	wait_sampling_rate;
+extern int	wait_sampling_history_size;
+
+extern Size WaitSamplerShmemSize(void);
+extern void WaitSamplerShmemInit(void);
+
+extern void WaitSamplerRegister(void);
+extern void WaitSamplerMain(Datum main_arg) pg_attribute_noreturn();
+
+#endif							/* _WAITSAMPLER_H */
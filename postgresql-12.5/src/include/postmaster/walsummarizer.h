@@ -0,0 +1,84 @@
+/*-------------------------------------------------------------------------
+ *
+ * walsummarizer.h
+ *	  Exports from postmaster/walsummarizer.c.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/walsummarizer.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _WALSUMMARIZER_H
+#define _WALSUMMARIZER_H
+
+#include "access/xlogdefs.h"
+#include "common/relpath.h"
+#include "nodes/pg_list.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/* Directory holding the summary files, relative to the data directory */
+#define WALSUMMARY_DIR		"pg_wal/summaries"
+
+/*
+ * A summary file describes every block modified by WAL records in the
+ * range [start_lsn, end_lsn).  It consists of a WalSummaryFileHeader,
+ * nentries WalSummaryEntry structs each followed by bitmap_bytes bytes of
+ * bitmap (bit N set means block N was modified), and a CRC-32C of all the
+ * preceding bytes.
+ *
+ * If limit_block is valid, the relation fork was created or truncated to
+ * that length somewhere in the range, so any block at or beyond it that
+ * isn't set in the bitmap no longer exists.  An entry whose relNode is
+ * InvalidOid means that the whole database directory was created or dropped,
+ * and must be copied in full.
+ */
+#define WALSUMMARY_MAGIC	0x57534D31	/* "WSM1" */
+
+typedef struct WalSummaryFileHeader
+{
+	uint32		magic;
+	uint32		nentries;
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	end_lsn;
+} WalSummaryFileHeader;
+
+typedef struct WalSummaryEntry
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber limit_block;
+	uint32		bitmap_bytes;
+} WalSummaryEntry;
+
+/* A summary file available on disk */
+typedef struct WalSummaryFile
+{
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	end_lsn;
+} WalSummaryFile;
+
+/* State for walking the entries of one summary file */
+typedef struct WalSummaryReader
+{
+	char	   *data;
+	Size		len;
+	Size		pos;
+	uint32		remaining;
+} WalSummaryReader;
+
+/* GUC options */
+extern bool summarize_wal;
+extern int	wal_summary_keep_time;
+
+extern void WalSummarizerRegister(void);
+extern void WalSummarizerMain(Datum main_arg) pg_attribute_noreturn();
+
+extern List *GetWalSummaries(XLogRecPtr start_lsn, XLogRecPtr end_lsn);
+extern WalSummaryReader *WalSummaryOpen(const WalSummaryFile *ws);
+extern bool WalSummaryNextEntry(WalSummaryReader *reader,
+								WalSummaryEntry *entry,
+								const uint8 **bitmap);
+
+#endif							/* _WALSUMMARIZER_H */
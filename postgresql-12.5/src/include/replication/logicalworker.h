@@ -13,6 +13,8 @@
 #define LOGICALWORKER_H
 
 extern void ApplyWorkerMain(Datum main_arg);
+extern void ParallelApplyWorkerMain(Datum main_arg);
+extern void TableSyncChunkWorkerMain(Datum main_arg);
 
 extern bool IsLogicalWorker(void);
 
@@ -17,6 +17,8 @@
 #include "utils/snapshot.h"
 #include "utils/timestamp.h"
 
+extern PGDLLIMPORT int logical_decoding_work_mem;
+
 /* an individual tuple, stored in one chunk of memory */
 typedef struct ReorderBufferTupleBuf
 {
@@ -143,6 +145,9 @@ typedef struct ReorderBufferChange
 		}			tuplecid;
 	}			data;
 
+	/* Transaction this change belongs to. */
+	struct ReorderBufferTXN *txn;
+
 	/*
 	 * While in use this is how a change is linked into a transactions,
 	 * otherwise it's the preallocated list.
@@ -287,6 +292,10 @@ typedef struct ReorderBufferTXN
 	 */
 	dlist_node	node;
 
+	/*
+	 * Size of this transaction (changes currently in memory, in bytes).
+	 */
+	Size		size;
 } ReorderBufferTXN;
 
 /* so we can define the callbacks used inside struct ReorderBuffer itself */
@@ -387,6 +396,18 @@ struct ReorderBuffer
 	/* buffer for disk<->memory conversions */
 	char	   *outbuf;
 	Size		outbufsize;
+
+	/* memory accounting */
+	Size		size;
+
+	/*
+	 * Statistics about transactions spilled to disk.  A transaction can be
+	 * spilled several times, so we count both the transactions (toplevel and
+	 * subtransactions alike) and the number of times we spilled.
+	 */
+	int64		spillTxns;		/* number of transactions spilled to disk */
+	int64		spillCount;		/* number of times we spilled */
+	int64		spillBytes;		/* amount of data spilled to disk */
 };
 
 
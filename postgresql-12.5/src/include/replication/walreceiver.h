@@ -16,6 +16,7 @@
 #include "access/xlogdefs.h"
 #include "fmgr.h"
 #include "getaddrinfo.h"		/* for NI_MAXHOST */
+#include "port/atomics.h"
 #include "replication/logicalproto.h"
 #include "replication/walsender.h"
 #include "storage/latch.h"
@@ -142,6 +143,13 @@ typedef struct
 	 * store semantics, so use sig_atomic_t.
 	 */
 	sig_atomic_t force_reply;	/* used as a bool */
+
+	/*
+	 * writtenUpto-1 is the last byte position that walreceiver has written
+	 * out, but not necessarily flushed to disk yet.  It's updated after each
+	 * write, without taking the mutex.
+	 */
+	pg_atomic_uint64 writtenUpto;
 } WalRcvData;
 
 extern WalRcvData *WalRcv;
@@ -163,6 +171,7 @@ typedef struct
 		{
 			uint32		proto_version;	/* Logical protocol version */
 			List	   *publication_names;	/* String list of publications */
+			bool		binary; /* Ask publisher to use binary */
 		}			logical;
 	}			proto;
 } WalRcvStreamOptions;
@@ -176,13 +176,18 @@ typedef PageHeaderData *PageHeader;
  * PD_PAGE_FULL is set if an UPDATE doesn't find enough free space in the
  * page for its new tuple version; this suggests that a prune is needed.
  * Again, this is just a hint.
+ *
+ * PD_HAS_WARM is set while the page holds HOT chains in which some index
+ * keys changed (see README.HOT), so that index entries reaching a tuple
+ * must be checked against it.  Unlike the above, it's WAL-logged.
  */
 #define PD_HAS_FREE_LINES	0x0001	/* are there any unused line pointers? */
 #define PD_PAGE_FULL		0x0002	/* not enough free space for new tuple? */
 #define PD_ALL_VISIBLE		0x0004	/* all tuples on page are visible to
 									 * everyone */
+#define PD_HAS_WARM			0x0008	/* any HOT chains with changed keys? */
 
-#define PD_VALID_FLAG_BITS	0x0007	/* OR of all valid pd_flags bits */
+#define PD_VALID_FLAG_BITS	0x000F	/* OR of all valid pd_flags bits */
 
 /*
  * Page layout version number 0 is for pre-7.3 Postgres releases.
@@ -389,6 +394,13 @@ PageValidateSpecialPointer(Page page)
 #define PageClearAllVisible(page) \
 	(((PageHeader) (page))->pd_flags &= ~PD_ALL_VISIBLE)
 
+#define PageHasWarm(page) \
+	(((PageHeader) (page))->pd_flags & PD_HAS_WARM)
+#define PageSetHasWarm(page) \
+	(((PageHeader) (page))->pd_flags |= PD_HAS_WARM)
+#define PageClearHasWarm(page) \
+	(((PageHeader) (page))->pd_flags &= ~PD_HAS_WARM)
+
 #define PageIsPrunable(page, oldestxmin) \
 ( \
 	AssertMacro(TransactionIdIsNormal(oldestxmin)), \
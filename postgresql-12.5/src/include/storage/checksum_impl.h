@@ -98,10 +98,25 @@
  * to unroll the inner loop to avoid loop overhead and minimize register
  * spilling. For less sophisticated compilers it might be beneficial to
  * manually unroll the inner loop.
+ *
+ * Relying on the vectorizer doesn't always work out, though: on x86-64 the
+ * baseline instruction set has no packed 32-bit multiply, and on ARM the
+ * result depends heavily on the compiler version.  So when the target is
+ * known at compile time to have AVX-512 or NEON, the main loop is written
+ * out explicitly with intrinsics instead.  Both compute exactly the same
+ * checksum as the generic code.
  */
 
 #include "storage/bufpage.h"
 
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define PG_CHECKSUM_USE_AVX512
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PG_CHECKSUM_USE_NEON
+#endif
+
 /* number of checksums to calculate in parallel */
 #define N_SUMS 32
 /* prime multiplier of FNV-1a hash */
@@ -156,6 +171,57 @@ pg_checksum_block(const PGChecksummablePage *page)
 	/* initialize partial checksums to their corresponding offsets */
 	memcpy(sums, checksumBaseOffsets, sizeof(checksumBaseOffsets));
 
+#if defined(PG_CHECKSUM_USE_AVX512)
+	{
+		const __m512i prime = _mm512_set1_epi32(FNV_PRIME);
+		__m512i		vsums[N_SUMS / 16];
+		__m512i		tmp;
+
+		for (j = 0; j < N_SUMS / 16; j++)
+			vsums[j] = _mm512_loadu_si512(&sums[j * 16]);
+
+		/* main checksum calculation, then two rounds of zeroes */
+		for (i = 0; i < (uint32) (BLCKSZ / (sizeof(uint32) * N_SUMS)) + 2; i++)
+		{
+			for (j = 0; j < N_SUMS / 16; j++)
+			{
+				tmp = vsums[j];
+				if (i < (uint32) (BLCKSZ / (sizeof(uint32) * N_SUMS)))
+					tmp = _mm512_xor_si512(tmp,
+										   _mm512_loadu_si512(&page->data[i][j * 16]));
+				vsums[j] = _mm512_xor_si512(_mm512_mullo_epi32(tmp, prime),
+											_mm512_srli_epi32(tmp, 17));
+			}
+		}
+
+		for (j = 0; j < N_SUMS / 16; j++)
+			_mm512_storeu_si512(&sums[j * 16], vsums[j]);
+	}
+#elif defined(PG_CHECKSUM_USE_NEON)
+	{
+		uint32x4_t	vsums[N_SUMS / 4];
+		uint32x4_t	tmp;
+
+		for (j = 0; j < N_SUMS / 4; j++)
+			vsums[j] = vld1q_u32(&sums[j * 4]);
+
+		/* main checksum calculation, then two rounds of zeroes */
+		for (i = 0; i < (uint32) (BLCKSZ / (sizeof(uint32) * N_SUMS)) + 2; i++)
+		{
+			for (j = 0; j < N_SUMS / 4; j++)
+			{
+				tmp = vsums[j];
+				if (i < (uint32) (BLCKSZ / (sizeof(uint32) * N_SUMS)))
+					tmp = veorq_u32(tmp, vld1q_u32(&page->data[i][j * 4]));
+				vsums[j] = veorq_u32(vmulq_n_u32(tmp, FNV_PRIME),
+									 vshrq_n_u32(tmp, 17));
+			}
+		}
+
+		for (j = 0; j < N_SUMS / 4; j++)
+			vst1q_u32(&sums[j * 4], vsums[j]);
+	}
+#else
 	/* main checksum calculation */
 	for (i = 0; i < (uint32) (BLCKSZ / (sizeof(uint32) * N_SUMS)); i++)
 		for (j = 0; j < N_SUMS; j++)
@@ -165,6 +231,7 @@ pg_checksum_block(const PGChecksummablePage *page)
 	for (i = 0; i < 2; i++)
 		for (j = 0; j < N_SUMS; j++)
 			CHECKSUM_COMP(sums[j], 0);
+#endif
 
 	/* xor fold partial checksums together */
 	for (i = 0; i < N_SUMS; i++)
@@ -142,6 +142,7 @@ typedef enum LWLockMode
 #ifdef LOCK_DEBUG
 extern bool Trace_lwlocks;
 #endif
+extern bool track_lwlock_stats;
 
 extern bool LWLockAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockConditionalAcquire(LWLock *lock, LWLockMode mode);
@@ -220,9 +221,46 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_TBM,
 	LWTRANCHE_PARALLEL_APPEND,
 	LWTRANCHE_SXACT,
+	LWTRANCHE_RELATION_SIZE_CACHE,
+	LWTRANCHE_SHARED_CATCACHE,
+	LWTRANCHE_SHARED_PLANCACHE,
+	LWTRANCHE_SHARED_PLANCACHE_DSA,
+	LWTRANCHE_SEQUENCE_CACHE,
+	LWTRANCHE_CLOG_BANK,
+	LWTRANCHE_COMMITTS_BANK,
+	LWTRANCHE_SUBTRANS_BANK,
+	LWTRANCHE_MXACTOFFSET_BANK,
+	LWTRANCHE_MXACTMEMBER_BANK,
+	LWTRANCHE_ASYNC_BANK,
+	LWTRANCHE_OLDSERXID_BANK,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
+/*
+ * Per-tranche contention statistics, gathered when track_lwlock_stats is on.
+ * Each backend accumulates into its own array in shared memory (indexed by
+ * pgprocno), and readers sum the arrays of all backends.  Every tranche
+ * allocated after startup shares the last entry.
+ */
+#define LWLOCK_STATS_NUM_TRANCHES	(LWTRANCHE_FIRST_USER_DEFINED + 1)
+
+/* upper bounds of the wait-time histogram buckets are 10^(i+1) microseconds */
+#define LWLOCK_STATS_WAIT_BUCKETS	8
+
+typedef struct LWLockTrancheStats
+{
+	uint64		sh_acquire_count;	/* shared-mode acquisitions */
+	uint64		ex_acquire_count;	/* exclusive-mode acquisitions */
+	uint64		block_count;	/* number of times we had to sleep */
+	uint64		spin_delay_count;	/* spin delays on the wait list lock */
+	uint64		wait_time;		/* total time slept, in microseconds */
+	uint64		wait_hist[LWLOCK_STATS_WAIT_BUCKETS];	/* sleeps by duration */
+} LWLockTrancheStats;
+
+extern PGDLLIMPORT LWLockTrancheStats *LWLockStatsArray;
+
+extern void LWLockGetStats(LWLockTrancheStats *stats);
+
 /*
  * Prior to PostgreSQL 9.4, we used an enum type called LWLockId to refer
  * to LWLocks.  New code should instead use LWLock *.  However, for the
@@ -42,6 +42,10 @@ extern int	namestrcpy(Name name, const char *str);
 extern int	namestrcmp(Name name, const char *str);
 
 /* numutils.c */
+
+/* buffer size needed by pg_lltoa(), less the trailing NUL */
+#define MAXINT8LEN		25
+
 extern int32 pg_atoi(const char *s, int size, int c);
 extern int16 pg_strtoint16(const char *s);
 extern int32 pg_strtoint32(const char *s);
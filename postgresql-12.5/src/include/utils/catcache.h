@@ -63,10 +63,10 @@ typedef struct catcache
 											 * scans */
 
 	/*
-	 * Keep these at the end, so that compiling catcache.c with CATCACHE_STATS
-	 * doesn't break ABI for other modules
+	 * Statistics, shown in pg_stat_catalog_caches and also logged at backend
+	 * exit if catcache.c is compiled with CATCACHE_STATS
 	 */
-#ifdef CATCACHE_STATS
+	Size		cc_memory;		/* bytes used by this cache's entries */
 	long		cc_searches;	/* total # searches against this cache */
 	long		cc_hits;		/* # of matches against existing entry */
 	long		cc_neg_hits;	/* # of matches against negative entry */
@@ -79,7 +79,7 @@ typedef struct catcache
 	long		cc_invals;		/* # of entries invalidated from cache */
 	long		cc_lsearches;	/* total # list-searches */
 	long		cc_lhits;		/* # of matches against existing lists */
-#endif
+	long		cc_evictions;	/* # of entries removed by memory limit */
 } CatCache;
 
 
@@ -103,6 +103,13 @@ typedef struct catctup
 	 */
 	dlist_node	cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * All tuples of all caches are also kept in a global list in order of
+	 * last access, so that catalog_cache_memory_limit can evict those that
+	 * were least recently used.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+
 	/*
 	 * A tuple marked "dead" must not be returned by subsequent searches.
 	 * However, it won't be physically deleted from the cache until its
@@ -162,6 +169,7 @@ typedef struct catclist
 	uint32		hash_value;		/* hash value for lookup keys */
 
 	dlist_node	cache_elem;		/* list member of per-catcache list */
+	dlist_node	lru_elem;		/* list member of global LRU list of lists */
 
 	/*
 	 * Lookup keys for the entry, with the first nkeys elements being valid.
@@ -183,8 +191,32 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	Size		ch_memory;		/* bytes used by entries of all caches */
+	dlist_head	ch_lru;			/* all CatCTups, most recently used first */
+	dlist_head	ch_list_lru;	/* all CatCLists, most recently used first */
 } CatCacheHeader;
 
+/*
+ * Per-cache statistics, as reported by CatCacheGetStats()
+ */
+typedef struct CatCacheStats
+{
+	int			cacheId;
+	Oid			reloid;
+	Oid			indexoid;
+	int			ntup;			/* # of entries, including negative ones */
+	int			nnegative;		/* # of negative entries */
+	int			nlists;			/* # of lists */
+	Size		memory;
+	long		searches;		/* including list searches */
+	long		hits;			/* including list hits */
+	long		neg_hits;
+	long		evictions;
+} CatCacheStats;
+
+/* GUC variable */
+extern int	catalog_cache_memory_limit;
+
 
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
@@ -225,6 +257,8 @@ extern void PrepareToInvalidateCacheTuple(Relation relation,
 										  HeapTuple newtuple,
 										  void (*function) (int, uint32, Oid));
 
+extern int	CatCacheGetStats(CatCacheStats **stats);
+
 extern void PrintCatCacheLeakWarning(HeapTuple tuple);
 extern void PrintCatCacheListLeakWarning(CatCList *list);
 
@@ -29,6 +29,8 @@ extern void AtEOXact_Inval(bool isCommit);
 
 extern void AtEOSubXact_Inval(bool isCommit);
 
+extern bool TransactionHasPendingInvalidations(void);
+
 extern void PostPrepare_Inval(void);
 
 extern void CommandEndInvalidationMessages(void);
@@ -62,6 +62,24 @@ typedef struct JsonLexContext
 	StringInfo	strval;
 } JsonLexContext;
 
+/*
+ * The context of the parser is maintained by the recursive descent
+ * mechanism, but is passed explicitly to the error reporting routine
+ * for better diagnostics.
+ */
+typedef enum					/* contexts of JSON parser */
+{
+	JSON_PARSE_VALUE,			/* expecting a value */
+	JSON_PARSE_STRING,			/* expecting a string (for a field name) */
+	JSON_PARSE_ARRAY_START,		/* saw '[', expecting value or ']' */
+	JSON_PARSE_ARRAY_NEXT,		/* saw array element, expecting ',' or ']' */
+	JSON_PARSE_OBJECT_START,	/* saw '{', expecting label or '}' */
+	JSON_PARSE_OBJECT_LABEL,	/* saw object label, expecting ':' */
+	JSON_PARSE_OBJECT_NEXT,		/* saw object value, expecting ',' or '}' */
+	JSON_PARSE_OBJECT_COMMA,	/* saw object ',', expecting next label */
+	JSON_PARSE_END				/* saw the end of a document, expect nothing */
+} JsonParseContext;
+
 typedef void (*json_struct_action) (void *state);
 typedef void (*json_ofield_action) (void *state, char *fname, bool isnull);
 typedef void (*json_aelem_action) (void *state, bool isnull);
@@ -111,6 +129,16 @@ extern void pg_parse_json(JsonLexContext *lex, JsonSemAction *sem);
  */
 extern int	json_count_array_elements(JsonLexContext *lex);
 
+/*
+ * For callers that drive the lexer themselves instead of using callbacks:
+ * json_lex_next advances to the next token, leaving its type in
+ * lex->token_type, and json_report_parse_error reports an unexpected token
+ * the same way pg_parse_json would.
+ */
+extern void json_lex_next(JsonLexContext *lex);
+extern void json_report_parse_error(JsonParseContext ctx,
+									JsonLexContext *lex) pg_attribute_noreturn();
+
 /*
  * constructors for JsonLexContext, with or without strval element.
  * If supplied, the strval element will contain a de-escaped version of
@@ -366,6 +366,10 @@ extern JsonbValue *findJsonbValueFromContainer(JsonbContainer *sheader,
 											   JsonbValue *key);
 extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *sheader,
 												 uint32 i);
+extern uint32 *decodeJsonbObjectOffsets(JsonbContainer *container);
+extern JsonbValue *findJsonbKeyWithOffsets(JsonbContainer *container,
+										   const uint32 *offsets,
+										   const char *keyVal, int keyLen);
 extern JsonbValue *pushJsonbValue(JsonbParseState **pstate,
 								  JsonbIteratorToken seq, JsonbValue *jbVal);
 extern JsonbIterator *JsonbIteratorInit(JsonbContainer *container);
@@ -72,6 +72,7 @@ extern void ResourceOwnerRelease(ResourceOwner owner,
 								 bool isCommit,
 								 bool isTopLevel);
 extern void ResourceOwnerDelete(ResourceOwner owner);
+extern void ReleaseAllPlanCacheRefsInOwner(ResourceOwner owner);
 extern ResourceOwner ResourceOwnerGetParent(ResourceOwner owner);
 extern void ResourceOwnerNewParent(ResourceOwner owner,
 								   ResourceOwner newparent);
@@ -0,0 +1,34 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Shared-memory second level for the system catalog caches
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+
+/* GUC variable: size of the shared catalog cache in kilobytes */
+extern int	shared_catalog_cache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern bool SharedCatCacheActive(void);
+extern HeapTuple SharedCatCacheLookup(int cacheId, Oid dbId, uint32 hashValue,
+									  uint32 *stamp);
+extern void SharedCatCacheInsert(int cacheId, Oid dbId, Oid reloid,
+								 uint32 hashValue, uint32 stamp,
+								 HeapTuple tuple);
+extern void SharedCatCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+											 int n);
+
+#endif							/* SHAREDCATCACHE_H */
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Cluster-wide cache of generic plans for saved plan sources
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/plancache.h"
+
+/* GUC variable: size of the shared plan cache in kilobytes */
+extern int	shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern bool SharedPlanCacheUsable(CachedPlanSource *plansource,
+								  QueryEnvironment *queryEnv);
+extern uint64 SharedPlanCacheGetStamp(void);
+extern bool SharedPlanCacheGetStats(CachedPlanSource *plansource,
+									uint64 stamp);
+extern List *SharedPlanCacheLookup(CachedPlanSource *plansource,
+								   uint64 stamp);
+extern void SharedPlanCacheInsert(CachedPlanSource *plansource,
+								  uint64 stamp, List *stmt_list);
+extern void SharedPlanCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+											  int n);
+
+#endif							/* SHAREDPLANCACHE_H */
@@ -272,5 +272,13 @@ extern void PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup);
 extern void PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup);
 extern void PrepareSortSupportFromIndexRel(Relation indexRel, int16 strategy,
 										   SortSupport ssup);
+extern void PrepareSortSupportFromGistIndexRel(Relation indexRel, SortSupport ssup);
+
+/*
+ * Comparators for types that sort like their int32 or int64 value, in
+ * utils/sort/tuplesort.c.  tuplesort.c can radix sort keys using these.
+ */
+extern int	ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup);
+extern int	ssup_datum_int64_cmp(Datum x, Datum y, SortSupport ssup);
 
 #endif							/* SORTSUPPORT_H */
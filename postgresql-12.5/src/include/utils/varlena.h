@@ -36,4 +36,19 @@ extern bool SplitGUCList(char *rawstring, char separator,
 extern text *replace_text_regexp(text *src_text, void *regexp,
 								 text *replace_text, bool glob);
 
+/*
+ * Boyer-Moore-Horspool search for a fixed byte string, for callers that
+ * search many haystacks for the same needle.  The needle is not copied.
+ */
+typedef struct LiteralSearch
+{
+	const char *needle;
+	int			len;
+	int			skip[256];		/* shift for each last byte of a window */
+} LiteralSearch;
+
+extern void literal_search_init(LiteralSearch *ls, const char *needle, int len);
+extern const char *literal_search(const LiteralSearch *ls,
+								  const char *haystack, int haystack_len);
+
 #endif
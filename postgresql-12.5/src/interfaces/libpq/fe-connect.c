@@ -73,6 +73,7 @@ static int	ldapServiceLookup(const char *purl, PQconninfoOption *options,
 #include "common/ip.h"
 #include "common/link-canary.h"
 #include "common/scram-common.h"
+#include "common/zpq_stream.h"
 #include "mb/pg_wchar.h"
 #include "port/pg_bswap.h"
 
@@ -124,6 +125,7 @@ static int	ldapServiceLookup(const char *purl, PQconninfoOption *options,
 #define DefaultOption	""
 #define DefaultAuthtype		  ""
 #define DefaultTargetSessionAttrs	"any"
+#define DefaultCompression	"off"
 #ifdef USE_SSL
 #define DefaultSSLMode "prefer"
 #else
@@ -334,6 +336,11 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"Target-Session-Attrs", "", 11, /* sizeof("read-write") = 11 */
 	offsetof(struct pg_conn, target_session_attrs)},
 
+	/* As with SSL, compression is exposed even in builds without zlib */
+	{"compression", "PGCOMPRESSION", DefaultCompression, NULL,
+		"Compression", "", 4,	/* sizeof("off") == 4 */
+	offsetof(struct pg_conn, compression)},
+
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL, NULL, NULL,
 	NULL, NULL, 0}
@@ -414,6 +421,7 @@ static char *passwordFromFile(const char *hostname, const char *port, const char
 							  const char *username, const char *pgpassfile);
 static void pgpassfileWarning(PGconn *conn);
 static void default_threadlock(int acquire);
+static void pqFreeCommandQueue(PGcmdQueueEntry *queue);
 
 
 /* global variable because fe-auth.c needs to access it */
@@ -438,6 +446,13 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Drop any SSL state */
 	pqsecure_close(conn);
 
+	/* Drop any compression state; a new connection starts uncompressed */
+	if (conn->zstream)
+	{
+		zpq_free(conn->zstream);
+		conn->zstream = NULL;
+	}
+
 	/* Close the socket itself */
 	if (conn->sock != PGINVALID_SOCKET)
 		closesocket(conn->sock);
@@ -450,6 +465,12 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Always discard any unsent data */
 	conn->outCount = 0;
 
+	/* Likewise, discard any pending pipelined commands */
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	conn->cmd_queue_head = conn->cmd_queue_tail = NULL;
+	pqFreeCommandQueue(conn->cmd_queue_recycle);
+	conn->cmd_queue_recycle = NULL;
+
 	/* Free authentication/encryption state */
 #ifdef ENABLE_GSS
 	{
@@ -513,6 +534,24 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	}
 }
 
+/*
+ * pqFreeCommandQueue
+ * Free all the entries of PGcmdQueueEntry queue passed.
+ */
+static void
+pqFreeCommandQueue(PGcmdQueueEntry *queue)
+{
+	while (queue != NULL)
+	{
+		PGcmdQueueEntry *cur = queue;
+
+		queue = cur->next;
+		if (cur->query)
+			free(cur->query);
+		free(cur);
+	}
+}
+
 
 /*
  *		pqDropServerData
@@ -1289,6 +1328,38 @@ connectOptions2(PGconn *conn)
 			goto oom_error;
 	}
 
+	/*
+	 * validate compression option
+	 */
+	if (conn->compression)
+	{
+		if (strcmp(conn->compression, "on") != 0 &&
+			strcmp(conn->compression, "off") != 0)
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("invalid compression value: \"%s\"\n"),
+							  conn->compression);
+			return false;
+		}
+#ifndef HAVE_LIBZ
+		if (strcmp(conn->compression, "on") == 0)
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("compression value \"%s\" invalid when zlib support is not compiled in\n"),
+							  conn->compression);
+			return false;
+		}
+#endif
+	}
+	else
+	{
+		conn->compression = strdup(DefaultCompression);
+		if (!conn->compression)
+			goto oom_error;
+	}
+
 	/*
 	 * Resolve special "auto" client_encoding from the locale
 	 */
@@ -3130,10 +3201,13 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
-				 * it's not Postgres on the other end at all.
+				 * request, a compression acknowledgement or an error here.
+				 * Anything else probably means it's not Postgres on the other
+				 * end at all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'E' ||
+					  (beresp == 'z' && strcmp(conn->compression, "on") == 0 &&
+					   conn->zstream == NULL)))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext(
@@ -3176,6 +3250,16 @@ keep_going:						/* We will come back to here until there is
 					goto error_return;
 				}
 
+				if (beresp == 'z' && (msgLength < 5 || msgLength > 100))
+				{
+					appendPQExpBuffer(&conn->errorMessage,
+									  libpq_gettext(
+													"expected authentication request from "
+													"server, but received %c\n"),
+									  beresp);
+					goto error_return;
+				}
+
 				if (beresp == 'E' && (msgLength < 8 || msgLength > 30000))
 				{
 					/* Handle error from a pre-3.0 server */
@@ -3230,6 +3314,32 @@ keep_going:						/* We will come back to here until there is
 					return PGRES_POLLING_READING;
 				}
 
+				/*
+				 * The server accepted our compression request.  Everything
+				 * after this message is compressed, in both directions.
+				 */
+				if (beresp == 'z')
+				{
+					if (pqGets(&conn->workBuffer, conn))
+					{
+						/* We'll come back when there is more data */
+						return PGRES_POLLING_READING;
+					}
+					if (!zpq_algorithm_supported(conn->workBuffer.data))
+					{
+						appendPQExpBuffer(&conn->errorMessage,
+										  libpq_gettext("server selected unsupported compression algorithm \"%s\"\n"),
+										  conn->workBuffer.data);
+						goto error_return;
+					}
+					/* OK, we read the message; mark data consumed */
+					conn->inStart = conn->inCursor;
+
+					if (pqEnableCompression(conn, conn->workBuffer.data))
+						goto error_return;
+					goto keep_going;
+				}
+
 				/* Handle errors. */
 				if (beresp == 'E')
 				{
@@ -3985,8 +4095,6 @@ freePGconn(PGconn *conn)
 	if (conn->connip)
 		free(conn->connip);
 	/* Note that conn->Pfdebug is not ours to close or free */
-	if (conn->last_query)
-		free(conn->last_query);
 	if (conn->write_err_msg)
 		free(conn->write_err_msg);
 	if (conn->inBuffer)
@@ -3997,6 +4105,8 @@ freePGconn(PGconn *conn)
 		free(conn->rowBuf);
 	if (conn->target_session_attrs)
 		free(conn->target_session_attrs);
+	if (conn->compression)
+		free(conn->compression);
 	termPQExpBuffer(&conn->errorMessage);
 	termPQExpBuffer(&conn->workBuffer);
 
@@ -4072,6 +4182,7 @@ closePGconn(PGconn *conn)
 	conn->status = CONNECTION_BAD;	/* Well, not really _bad_ - just absent */
 	conn->asyncStatus = PGASYNC_IDLE;
 	conn->xactStatus = PQTRANS_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	pqClearAsyncResult(conn);	/* deallocate result */
 	resetPQExpBuffer(&conn->errorMessage);
 	release_conn_addrinfo(conn);
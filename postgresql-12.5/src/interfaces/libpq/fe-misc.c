@@ -49,6 +49,7 @@
 
 #include "libpq-fe.h"
 #include "libpq-int.h"
+#include "common/zpq_stream.h"
 #include "mb/pg_wchar.h"
 #include "port/pg_bswap.h"
 #include "pg_config_paths.h"
@@ -56,6 +57,9 @@
 
 static int	pqPutMsgBytes(const void *buf, size_t len, PGconn *conn);
 static int	pqSendSome(PGconn *conn, int len);
+static ssize_t pqRecv(PGconn *conn, void *ptr, size_t len);
+static ssize_t pqSend(PGconn *conn, const void *ptr, size_t len);
+static bool pqSendPending(PGconn *conn);
 static int	pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 						  time_t end_time);
 static int	pqSocketPoll(int sock, int forRead, int forWrite, time_t end_time);
@@ -678,8 +682,8 @@ pqReadData(PGconn *conn)
 
 	/* OK, try to read some data */
 retry3:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqRecv(conn, conn->inBuffer + conn->inEnd,
+				   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -723,6 +727,20 @@ retry3:
 			someread = 1;
 			goto retry3;
 		}
+
+		/*
+		 * With compression, don't leave decompressed data behind in the
+		 * stream: the caller will next wait on the socket, which knows
+		 * nothing about it.
+		 */
+		if (conn->zstream && zpq_buffered_rx(conn->zstream))
+		{
+			if (conn->inBufSize - conn->inEnd < 8192 &&
+				pqCheckInBufferSpace(conn->inEnd + (size_t) 8192, conn))
+				return -1;		/* errorMessage already set */
+			someread = 1;
+			goto retry3;
+		}
 		return 1;
 	}
 
@@ -768,8 +786,8 @@ retry3:
 	 * arrived.
 	 */
 retry4:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqRecv(conn, conn->inBuffer + conn->inEnd,
+				   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -880,12 +898,12 @@ pqSendSome(PGconn *conn, int len)
 	}
 
 	/* while there's still data to send */
-	while (len > 0)
+	while (len > 0 || pqSendPending(conn))
 	{
 		int			sent;
 
 #ifndef WIN32
-		sent = pqsecure_write(conn, ptr, len);
+		sent = pqSend(conn, ptr, len);
 #else
 
 		/*
@@ -893,7 +911,7 @@ pqSendSome(PGconn *conn, int len)
 		 * failure-point appears to be different in different versions of
 		 * Windows, but 64k should always be safe.
 		 */
-		sent = pqsecure_write(conn, ptr, Min(len, 65536));
+		sent = pqSend(conn, ptr, Min(len, 65536));
 #endif
 
 		if (sent < 0)
@@ -948,7 +966,7 @@ pqSendSome(PGconn *conn, int len)
 			remaining -= sent;
 		}
 
-		if (len > 0)
+		if (len > 0 || pqSendPending(conn))
 		{
 			/*
 			 * We didn't send it all, wait till we can send more.
@@ -1019,12 +1037,117 @@ pqFlush(PGconn *conn)
 	if (conn->Pfdebug)
 		fflush(conn->Pfdebug);
 
-	if (conn->outCount > 0)
+	if (conn->outCount > 0 || pqSendPending(conn))
 		return pqSendSome(conn, conn->outCount);
 
 	return 0;
 }
 
+/*
+ * pqRecv: read from the server, decompressing if compression is active
+ *
+ * Same contract as pqsecure_read.
+ */
+static ssize_t
+pqRecv(PGconn *conn, void *ptr, size_t len)
+{
+	ssize_t		n;
+
+	if (conn->zstream == NULL)
+		return pqsecure_read(conn, ptr, len);
+
+	n = zpq_read(conn->zstream, ptr, len);
+	if (n == ZPQ_STREAM_ERROR)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not decompress data from server: %s\n"),
+						  zpq_error(conn->zstream));
+		SOCK_ERRNO_SET(0);
+		n = -1;
+	}
+	return n;
+}
+
+/*
+ * pqSend: write to the server, compressing if compression is active
+ *
+ * Same contract as pqsecure_write, except that with compression some of
+ * the data reported as written may still be held in the compression stream;
+ * see pqSendPending.
+ */
+static ssize_t
+pqSend(PGconn *conn, const void *ptr, size_t len)
+{
+	ssize_t		n;
+
+	if (conn->zstream == NULL)
+		return pqsecure_write(conn, ptr, len);
+
+	n = zpq_write(conn->zstream, ptr, len);
+	if (n == ZPQ_STREAM_ERROR)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not compress data to server: %s\n"),
+						  zpq_error(conn->zstream));
+		SOCK_ERRNO_SET(0);
+		n = -1;
+	}
+	return n;
+}
+
+/*
+ * pqSendPending: is compressed output waiting to be written to the socket?
+ */
+static bool
+pqSendPending(PGconn *conn)
+{
+	return conn->zstream != NULL && zpq_buffered_tx(conn->zstream);
+}
+
+static ssize_t
+pqZpqRead(void *arg, void *ptr, size_t len)
+{
+	return pqsecure_read((PGconn *) arg, ptr, len);
+}
+
+static ssize_t
+pqZpqWrite(void *arg, const void *ptr, size_t len)
+{
+	return pqsecure_write((PGconn *) arg, ptr, len);
+}
+
+/*
+ * pqEnableCompression: switch on protocol compression
+ *
+ * Called once the server's CompressionAck, naming the algorithm, has been
+ * consumed.  Anything
+ * already read beyond that message was compressed by the server, so it is
+ * handed to the new stream, and we then decompress what we can right away
+ * since it will never make the socket look readable again.
+ *
+ * Returns 0 if OK, -1 if trouble (with conn->errorMessage set).
+ */
+int
+pqEnableCompression(PGconn *conn, const char *algorithm)
+{
+	Assert(conn->zstream == NULL);
+
+	conn->zstream = zpq_create(algorithm, pqZpqWrite, pqZpqRead, conn,
+							   conn->inBuffer + conn->inStart,
+							   conn->inEnd - conn->inStart);
+	if (conn->zstream == NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not initialize protocol compression\n"));
+		return -1;
+	}
+	conn->inEnd = conn->inCursor = conn->inStart;
+
+	if (pqReadData(conn) < 0)
+		return -1;
+	return 0;
+}
+
 
 /*
  * pqWait: wait until we can read or write the connection socket
@@ -1120,6 +1243,10 @@ pqSocketCheck(PGconn *conn, int forRead, int forWrite, time_t end_time)
 	}
 #endif
 
+	/* Likewise for data buffered in the compression stream */
+	if (forRead && conn->zstream && zpq_buffered_rx(conn->zstream))
+		return 1;
+
 	/* We will retry as long as we get EINTR */
 	do
 		result = pqSocketPoll(conn->sock, forRead, forWrite, end_time);
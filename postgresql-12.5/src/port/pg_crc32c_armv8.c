@@ -48,6 +48,31 @@ pg_comp_crc32c_armv8(pg_crc32c crc, const void *data, size_t len)
 		p += 4;
 	}
 
+	/*
+	 * For long inputs, run three independent CRC streams so that the
+	 * instruction's latency is hidden, then combine them; see pg_crc32c.h.
+	 */
+	while (pend - p >= 3 * PG_CRC32C_STREAM_LEN)
+	{
+		const unsigned char *p1 = p + PG_CRC32C_STREAM_LEN;
+		const unsigned char *p2 = p1 + PG_CRC32C_STREAM_LEN;
+		uint32		crc1 = 0;
+		uint32		crc2 = 0;
+		int			i;
+
+		for (i = 0; i < PG_CRC32C_STREAM_LEN; i += 8)
+		{
+			crc = __crc32cd(crc, *(uint64 *) (p + i));
+			crc1 = __crc32cd(crc1, *(uint64 *) (p1 + i));
+			crc2 = __crc32cd(crc2, *(uint64 *) (p2 + i));
+		}
+
+		crc = pg_crc32c_shift(crc, PG_CRC32C_SHIFT_2STREAM) ^
+			pg_crc32c_shift(crc1, PG_CRC32C_SHIFT_1STREAM) ^
+			crc2;
+		p += 3 * PG_CRC32C_STREAM_LEN;
+	}
+
 	/* Process eight bytes at a time, as far as we can. */
 	while (p + 8 <= pend)
 	{
@@ -32,6 +32,33 @@ pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len)
 	 * the begin address.
 	 */
 #ifdef __x86_64__
+
+	/*
+	 * For long inputs, run three independent CRC streams so that the
+	 * instruction's latency is hidden, then combine them; see pg_crc32c.h.
+	 */
+	while (pend - p >= 3 * PG_CRC32C_STREAM_LEN)
+	{
+		const unsigned char *p1 = p + PG_CRC32C_STREAM_LEN;
+		const unsigned char *p2 = p1 + PG_CRC32C_STREAM_LEN;
+		uint64		crc0 = crc;
+		uint64		crc1 = 0;
+		uint64		crc2 = 0;
+		int			i;
+
+		for (i = 0; i < PG_CRC32C_STREAM_LEN; i += 8)
+		{
+			crc0 = _mm_crc32_u64(crc0, *((const uint64 *) (p + i)));
+			crc1 = _mm_crc32_u64(crc1, *((const uint64 *) (p1 + i)));
+			crc2 = _mm_crc32_u64(crc2, *((const uint64 *) (p2 + i)));
+		}
+
+		crc = pg_crc32c_shift((uint32) crc0, PG_CRC32C_SHIFT_2STREAM) ^
+			pg_crc32c_shift((uint32) crc1, PG_CRC32C_SHIFT_1STREAM) ^
+			(uint32) crc2;
+		p += 3 * PG_CRC32C_STREAM_LEN;
+	}
+
 	while (p + 8 <= pend)
 	{
 		crc = (uint32) _mm_crc32_u64(crc, *((const uint64 *) p));
@@ -0,0 +1,43 @@
+/* src/test/modules/bench_kernels/bench_kernels--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION bench_kernels" to load this file. \quit
+
+CREATE FUNCTION bench_expr(nrows integer,
+    repeat integer DEFAULT 5,
+    OUT ns_per_op float8,
+    OUT cache_misses_per_op float8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_deform(ntuples integer,
+    natts integer,
+    repeat integer DEFAULT 5,
+    OUT ns_per_op float8,
+    OUT cache_misses_per_op float8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_tuplesort(ntuples integer,
+    repeat integer DEFAULT 5,
+    OUT ns_per_op float8,
+    OUT cache_misses_per_op float8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_btree_search(index regclass,
+    maxkey integer,
+    nprobes integer,
+    repeat integer DEFAULT 5,
+    OUT ns_per_op float8,
+    OUT cache_misses_per_op float8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_hash_search(nentries integer,
+    nprobes integer,
+    repeat integer DEFAULT 5,
+    OUT ns_per_op float8,
+    OUT cache_misses_per_op float8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
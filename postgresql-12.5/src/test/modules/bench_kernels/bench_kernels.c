@@ -0,0 +1,518 @@
+/*--------------------------------------------------------------------------
+ *
+ * bench_kernels.c
+ *		Microbenchmarks of executor and access method hot paths.
+ *
+ * Each SQL-callable function here runs one kernel on synthetic data, a
+ * number of times, and returns the time per operation of the fastest run
+ * along with the cache misses per operation measured during that run, if
+ * the hardware counters are available.
+ *
+ * Copyright (c) 2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/bench_kernels/bench_kernels.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/stratnum.h"
+#include "access/table.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(bench_expr);
+PG_FUNCTION_INFO_V1(bench_deform);
+PG_FUNCTION_INFO_V1(bench_tuplesort);
+PG_FUNCTION_INFO_V1(bench_btree_search);
+PG_FUNCTION_INFO_V1(bench_hash_search);
+
+/* Seed of the synthetic data, fixed so that runs are comparable */
+#define BENCH_SEED		0x3B52
+
+/*
+ * Measurement of one run: elapsed time, and a hardware cache miss counter if
+ * the kernel lets us open one.
+ */
+typedef struct BenchRun
+{
+	instr_time	start;
+	int			counter_fd;		/* perf event fd, or -1 */
+} BenchRun;
+
+/* Best run seen so far */
+typedef struct BenchResult
+{
+	double		ns_per_op;		/* -1 until the first run is done */
+	double		misses_per_op;	/* -1 if unknown */
+} BenchResult;
+
+static void
+bench_init_random(unsigned short *xseed)
+{
+	xseed[0] = BENCH_SEED;
+	xseed[1] = BENCH_SEED >> 1;
+	xseed[2] = BENCH_SEED >> 2;
+}
+
+static int
+open_cache_miss_counter(void)
+{
+#if defined(__linux__) && defined(__NR_perf_event_open)
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static void
+bench_run_start(BenchRun *run)
+{
+	run->counter_fd = open_cache_miss_counter();
+#ifdef __linux__
+	if (run->counter_fd >= 0)
+	{
+		ioctl(run->counter_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(run->counter_fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+	INSTR_TIME_SET_CURRENT(run->start);
+}
+
+static void
+bench_run_end(BenchRun *run, int64 nops, BenchResult *result)
+{
+	instr_time	duration;
+	double		ns_per_op;
+	double		misses_per_op = -1;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, run->start);
+
+#ifdef __linux__
+	if (run->counter_fd >= 0)
+	{
+		uint64		misses;
+
+		ioctl(run->counter_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(run->counter_fd, &misses, sizeof(misses)) == sizeof(misses))
+			misses_per_op = (double) misses / Max(nops, 1);
+	}
+#endif
+	if (run->counter_fd >= 0)
+		close(run->counter_fd);
+
+	ns_per_op = INSTR_TIME_GET_DOUBLE(duration) * 1e9 / Max(nops, 1);
+	if (result->ns_per_op < 0 || ns_per_op < result->ns_per_op)
+	{
+		result->ns_per_op = ns_per_op;
+		result->misses_per_op = misses_per_op;
+	}
+}
+
+static Datum
+bench_result_datum(FunctionCallInfo fcinfo, BenchResult *result)
+{
+	TupleDesc	tupdesc;
+	Datum		values[2];
+	bool		nulls[2];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	values[0] = Float8GetDatum(result->ns_per_op);
+	nulls[0] = false;
+	values[1] = Float8GetDatum(result->misses_per_op);
+	nulls[1] = result->misses_per_op < 0;
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+static void
+check_positive(const char *name, int value)
+{
+	if (value <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("%s must be greater than zero", name)));
+}
+
+/*
+ * Evaluate "(a + 1) < b" with the expression interpreter, over nrows
+ * distinct input rows fed through a virtual scan slot.
+ */
+Datum
+bench_expr(PG_FUNCTION_ARGS)
+{
+	int			nrows = PG_GETARG_INT32(0);
+	int			repeat = PG_GETARG_INT32(1);
+	BenchResult result = {-1, -1};
+	unsigned short xseed[3];
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	ExprContext *econtext;
+	ExprState  *state;
+	Expr	   *expr;
+	int32	   *a;
+	int32	   *b;
+	int			i;
+
+	check_positive("nrows", nrows);
+	check_positive("repeat", repeat);
+
+	tupdesc = CreateTemplateTupleDesc(2);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "a", INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "b", INT4OID, -1, 0);
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+
+	expr = (Expr *)
+		makeFuncExpr(F_INT4LT, BOOLOID,
+					 list_make2(makeFuncExpr(F_INT4PL, INT4OID,
+											 list_make2(makeVar(1, 1, INT4OID, -1, InvalidOid, 0),
+														makeConst(INT4OID, -1, InvalidOid, sizeof(int32),
+																  Int32GetDatum(1), false, true)),
+											 InvalidOid, InvalidOid,
+											 COERCE_EXPLICIT_CALL),
+								makeVar(1, 2, INT4OID, -1, InvalidOid, 0)),
+					 InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+	state = ExecInitExpr(expr, NULL);
+	econtext = CreateStandaloneExprContext();
+	econtext->ecxt_scantuple = slot;
+
+	/* keep a + 1 from overflowing */
+	a = palloc(sizeof(int32) * nrows);
+	b = palloc(sizeof(int32) * nrows);
+	bench_init_random(xseed);
+	for (i = 0; i < nrows; i++)
+	{
+		a[i] = (int32) (pg_jrand48(xseed) >> 1);
+		b[i] = (int32) (pg_jrand48(xseed) >> 1);
+	}
+
+	while (repeat-- > 0)
+	{
+		BenchRun	run;
+
+		CHECK_FOR_INTERRUPTS();
+
+		bench_run_start(&run);
+		for (i = 0; i < nrows; i++)
+		{
+			bool		isnull;
+
+			ExecClearTuple(slot);
+			slot->tts_values[0] = Int32GetDatum(a[i]);
+			slot->tts_isnull[0] = false;
+			slot->tts_values[1] = Int32GetDatum(b[i]);
+			slot->tts_isnull[1] = false;
+			ExecStoreVirtualTuple(slot);
+
+			(void) ExecEvalExprSwitchContext(state, econtext, &isnull);
+		}
+		bench_run_end(&run, nrows, &result);
+	}
+
+	FreeExprContext(econtext, true);
+	ExecDropSingleTupleTableSlot(slot);
+
+	PG_RETURN_DATUM(bench_result_datum(fcinfo, &result));
+}
+
+/*
+ * Deform ntuples heap tuples of natts attributes each.  The attributes cycle
+ * through int4, int8 and short text, and one value in seven is NULL, so that
+ * both alignment and the null bitmap are exercised.
+ */
+Datum
+bench_deform(PG_FUNCTION_ARGS)
+{
+	int			ntuples = PG_GETARG_INT32(0);
+	int			natts = PG_GETARG_INT32(1);
+	int			repeat = PG_GETARG_INT32(2);
+	BenchResult result = {-1, -1};
+	unsigned short xseed[3];
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	HeapTuple  *tuples;
+	Datum	   *values;
+	bool	   *nulls;
+	int			i;
+	int			j;
+
+	check_positive("ntuples", ntuples);
+	check_positive("repeat", repeat);
+	if (natts <= 0 || natts > MaxTupleAttributeNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("natts must be between 1 and %d",
+						MaxTupleAttributeNumber)));
+
+	tupdesc = CreateTemplateTupleDesc(natts);
+	for (j = 0; j < natts; j++)
+	{
+		Oid			typid = (j % 3 == 0) ? INT4OID : (j % 3 == 1) ? INT8OID : TEXTOID;
+
+		TupleDescInitEntry(tupdesc, (AttrNumber) (j + 1), NULL, typid, -1, 0);
+	}
+
+	tuples = palloc(sizeof(HeapTuple) * ntuples);
+	values = palloc(sizeof(Datum) * natts);
+	nulls = palloc(sizeof(bool) * natts);
+	bench_init_random(xseed);
+	for (i = 0; i < ntuples; i++)
+	{
+		for (j = 0; j < natts; j++)
+		{
+			long		r = pg_jrand48(xseed);
+
+			nulls[j] = (r % 7 == 0);
+			if (j % 3 == 0)
+				values[j] = Int32GetDatum((int32) r);
+			else if (j % 3 == 1)
+				values[j] = Int64GetDatum((int64) r << 16);
+			else
+				values[j] = CStringGetTextDatum(psprintf("v%ld", r & 0xFFFF));
+		}
+		tuples[i] = heap_form_tuple(tupdesc, values, nulls);
+	}
+
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsHeapTuple);
+
+	while (repeat-- > 0)
+	{
+		BenchRun	run;
+
+		CHECK_FOR_INTERRUPTS();
+
+		bench_run_start(&run);
+		for (i = 0; i < ntuples; i++)
+		{
+			/* storing a tuple resets the slot, so each one gets deformed */
+			ExecStoreHeapTuple(tuples[i], slot, false);
+			slot_getallattrs(slot);
+		}
+		bench_run_end(&run, ntuples, &result);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	PG_RETURN_DATUM(bench_result_datum(fcinfo, &result));
+}
+
+/*
+ * Sort ntuples random int4 datums in memory, including loading them and
+ * reading them back.  The time is reported per tuple.
+ */
+Datum
+bench_tuplesort(PG_FUNCTION_ARGS)
+{
+	int			ntuples = PG_GETARG_INT32(0);
+	int			repeat = PG_GETARG_INT32(1);
+	BenchResult result = {-1, -1};
+	unsigned short xseed[3];
+	int32	   *data;
+	int			i;
+
+	check_positive("ntuples", ntuples);
+	check_positive("repeat", repeat);
+
+	data = palloc(sizeof(int32) * ntuples);
+	bench_init_random(xseed);
+	for (i = 0; i < ntuples; i++)
+		data[i] = (int32) pg_jrand48(xseed);
+
+	while (repeat-- > 0)
+	{
+		BenchRun	run;
+		Tuplesortstate *sortstate;
+		Datum		val;
+		bool		isnull;
+
+		CHECK_FOR_INTERRUPTS();
+
+		bench_run_start(&run);
+		sortstate = tuplesort_begin_datum(INT4OID, Int4LessOperator,
+										  InvalidOid, false,
+										  Max(work_mem, ntuples / 16),
+										  NULL, false);
+		for (i = 0; i < ntuples; i++)
+			tuplesort_putdatum(sortstate, Int32GetDatum(data[i]), false);
+		tuplesort_performsort(sortstate);
+		while (tuplesort_getdatum(sortstate, true, &val, &isnull, NULL))
+			;
+		tuplesort_end(sortstate);
+		bench_run_end(&run, ntuples, &result);
+	}
+
+	PG_RETURN_DATUM(bench_result_datum(fcinfo, &result));
+}
+
+/*
+ * Probe an int4 btree index nprobes times for random keys in [1, maxkey].
+ * Only the TID is fetched, so this measures the descent of the tree and the
+ * binary searches on its pages.
+ */
+Datum
+bench_btree_search(PG_FUNCTION_ARGS)
+{
+	Oid			indexoid = PG_GETARG_OID(0);
+	int			maxkey = PG_GETARG_INT32(1);
+	int			nprobes = PG_GETARG_INT32(2);
+	int			repeat = PG_GETARG_INT32(3);
+	BenchResult result = {-1, -1};
+	unsigned short xseed[3];
+	Relation	indexrel;
+	Relation	heaprel;
+	IndexScanDesc scan;
+	int32	   *keys;
+	int			i;
+
+	check_positive("maxkey", maxkey);
+	check_positive("nprobes", nprobes);
+	check_positive("repeat", repeat);
+
+	indexrel = index_open(indexoid, AccessShareLock);
+	if (indexrel->rd_rel->relam != BTREE_AM_OID ||
+		TupleDescAttr(RelationGetDescr(indexrel), 0)->atttypid != INT4OID)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a btree index on an integer column",
+						RelationGetRelationName(indexrel))));
+	heaprel = table_open(indexrel->rd_index->indrelid, AccessShareLock);
+
+	keys = palloc(sizeof(int32) * nprobes);
+	bench_init_random(xseed);
+	for (i = 0; i < nprobes; i++)
+		keys[i] = 1 + (int32) ((uint32) pg_jrand48(xseed) % (uint32) maxkey);
+
+	scan = index_beginscan(heaprel, indexrel, GetActiveSnapshot(), 1, 0);
+
+	while (repeat-- > 0)
+	{
+		BenchRun	run;
+
+		CHECK_FOR_INTERRUPTS();
+
+		bench_run_start(&run);
+		for (i = 0; i < nprobes; i++)
+		{
+			ScanKeyData skey;
+
+			ScanKeyInit(&skey, 1, BTEqualStrategyNumber, F_INT4EQ,
+						Int32GetDatum(keys[i]));
+			index_rescan(scan, &skey, 1, NULL, 0);
+			(void) index_getnext_tid(scan, ForwardScanDirection);
+		}
+		bench_run_end(&run, nprobes, &result);
+	}
+
+	index_endscan(scan);
+	table_close(heaprel, AccessShareLock);
+	index_close(indexrel, AccessShareLock);
+
+	PG_RETURN_DATUM(bench_result_datum(fcinfo, &result));
+}
+
+/*
+ * Look up nprobes random keys, all present, in a dynahash table of nentries
+ * int4 keys.  The hash values are computed up front, so that only
+ * hash_search_with_hash_value itself is measured.
+ */
+Datum
+bench_hash_search(PG_FUNCTION_ARGS)
+{
+	int			nentries = PG_GETARG_INT32(0);
+	int			nprobes = PG_GETARG_INT32(1);
+	int			repeat = PG_GETARG_INT32(2);
+	BenchResult result = {-1, -1};
+	unsigned short xseed[3];
+	HASHCTL		ctl;
+	HTAB	   *htab;
+	int32	   *keys;
+	uint32	   *hashes;
+	int			i;
+
+	check_positive("nentries", nentries);
+	check_positive("nprobes", nprobes);
+	check_positive("repeat", repeat);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(int32);
+	ctl.entrysize = sizeof(int32) * 2;
+	ctl.hcxt = CurrentMemoryContext;
+	htab = hash_create("bench_kernels hash", nentries, &ctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	/* keys are a scrambled permutation of 0 .. nentries - 1 */
+	for (i = 0; i < nentries; i++)
+	{
+		int32		key = (int32) (((uint32) i * 2654435761U) ^ BENCH_SEED);
+
+		(void) hash_search(htab, &key, HASH_ENTER, NULL);
+	}
+
+	keys = palloc(sizeof(int32) * nprobes);
+	hashes = palloc(sizeof(uint32) * nprobes);
+	bench_init_random(xseed);
+	for (i = 0; i < nprobes; i++)
+	{
+		uint32		n = (uint32) pg_jrand48(xseed) % (uint32) nentries;
+
+		keys[i] = (int32) ((n * 2654435761U) ^ BENCH_SEED);
+		hashes[i] = get_hash_value(htab, &keys[i]);
+	}
+
+	while (repeat-- > 0)
+	{
+		BenchRun	run;
+
+		CHECK_FOR_INTERRUPTS();
+
+		bench_run_start(&run);
+		for (i = 0; i < nprobes; i++)
+			(void) hash_search_with_hash_value(htab, &keys[i], hashes[i],
+											   HASH_FIND, NULL);
+		bench_run_end(&run, nprobes, &result);
+	}
+
+	hash_destroy(htab);
+
+	PG_RETURN_DATUM(bench_result_datum(fcinfo, &result));
+}
@@ -0,0 +1,39 @@
+-- src/test/modules/bench_kernels/run_bench_kernels.sql
+--
+-- Driver for the bench_kernels microbenchmarks.  Every kernel runs on
+-- synthetic data generated from a fixed seed, at fixed sizes, so that the
+-- output of two builds can be compared line by line.  Sizes are picked to
+-- stay in L1/L2 cache, to spill out of the last level cache, and in between.
+
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS bench_kernels;
+
+DROP TABLE IF EXISTS bench_btree_data;
+CREATE TABLE bench_btree_data AS
+    SELECT i AS k FROM generate_series(1, 1000000) i;
+CREATE INDEX bench_btree_data_k ON bench_btree_data (k);
+VACUUM ANALYZE bench_btree_data;
+
+\pset footer off
+\echo kernel results: ns_per_op is the best of 5 runs; cache_misses_per_op is
+\echo empty if hardware counters are not available to the server
+
+SELECT 'ExecInterpExpr' AS kernel, n AS size, r.*
+    FROM unnest(ARRAY[1000, 1000000]) n, bench_expr(n) r
+UNION ALL
+SELECT 'slot_deform_heap_tuple (' || a || ' atts)', n, r.*
+    FROM unnest(ARRAY[1000, 100000]) n, unnest(ARRAY[4, 32]) a,
+         bench_deform(n, a) r
+UNION ALL
+SELECT 'tuplesort (int4 datum)', n, r.*
+    FROM unnest(ARRAY[1000, 100000, 1000000]) n, bench_tuplesort(n) r
+UNION ALL
+SELECT '_bt_search/_bt_binsrch', n, r.*
+    FROM unnest(ARRAY[1000, 1000000]) n,
+         bench_btree_search('bench_btree_data_k', n, 100000) r
+UNION ALL
+SELECT 'hash_search_with_hash_value', n, r.*
+    FROM unnest(ARRAY[1000, 100000, 1000000]) n,
+         bench_hash_search(n, 1000000) r;
+
+DROP TABLE bench_btree_data;
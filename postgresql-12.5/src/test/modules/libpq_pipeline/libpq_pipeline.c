@@ -0,0 +1,619 @@
+/*-------------------------------------------------------------------------
+ *
+ * libpq_pipeline.c
+ *		Verify libpq pipeline execution functionality
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/test/modules/libpq_pipeline/libpq_pipeline.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <sys/time.h>
+#ifdef HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+
+#include "catalog/pg_type_d.h"
+#include "common/fe_memutils.h"
+#include "libpq-fe.h"
+
+
+static void exit_nicely(PGconn *conn) pg_attribute_noreturn();
+static void pg_fatal_impl(int line, const char *fmt,...)
+			pg_attribute_printf(2, 3) pg_attribute_noreturn();
+
+static const char *const progname = "libpq_pipeline";
+
+#define pg_fatal(...) pg_fatal_impl(__LINE__, __VA_ARGS__)
+
+static void
+exit_nicely(PGconn *conn)
+{
+	PQfinish(conn);
+	exit(1);
+}
+
+/*
+ * Print an error to stderr and terminate the program.
+ */
+static void
+pg_fatal_impl(int line, const char *fmt,...)
+{
+	va_list		args;
+
+	fflush(stdout);
+
+	fprintf(stderr, "\n%s:%d: ", progname, line);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	Assert(fmt[strlen(fmt) - 1] != '\n');
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+/*
+ * Check that the next result has the expected status, and return it.
+ */
+static PGresult *
+expect_result(PGconn *conn, ExecStatusType status, int line)
+{
+	PGresult   *res = PQgetResult(conn);
+
+	if (res == NULL)
+		pg_fatal_impl(line, "PQgetResult returned null unexpectedly: %s",
+					  PQerrorMessage(conn));
+	if (PQresultStatus(res) != status)
+		pg_fatal_impl(line, "got status %s instead of %s: %s",
+					  PQresStatus(PQresultStatus(res)), PQresStatus(status),
+					  PQresultErrorMessage(res));
+	return res;
+}
+
+/*
+ * Check that the current command's results are exhausted.
+ */
+static void
+expect_null(PGconn *conn, int line)
+{
+	PGresult   *res = PQgetResult(conn);
+
+	if (res != NULL)
+		pg_fatal_impl(line, "expected NULL result, got %s",
+					  PQresStatus(PQresultStatus(res)));
+}
+
+#define EXPECT(conn, status) PQclear(expect_result(conn, status, __LINE__))
+#define EXPECT_NULL(conn) expect_null(conn, __LINE__)
+
+/*
+ * Synchronous functions and simple Query messages can't be used in pipeline
+ * mode, and pipeline mode can't be left while results are pending.
+ */
+static void
+test_disallowed_in_pipeline(PGconn *conn)
+{
+	PGresult   *res;
+
+	fprintf(stderr, "test error cases... ");
+
+	if (PQisnonblocking(conn))
+		pg_fatal("Expected blocking connection mode");
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("Unable to enter pipeline mode");
+
+	if (PQpipelineStatus(conn) == PQ_PIPELINE_OFF)
+		pg_fatal("Pipeline mode not activated properly");
+
+	/* PQexec should fail in pipeline mode */
+	res = PQexec(conn, "SELECT 1");
+	if (res != NULL)
+		pg_fatal("PQexec should fail in pipeline mode but succeeded");
+
+	/* So should PQsendQuery */
+	if (PQsendQuery(conn, "SELECT 1") != 0)
+		pg_fatal("PQsendQuery should fail in pipeline mode but succeeded");
+
+	/* Entering pipeline mode when already in pipeline mode is OK */
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("re-entering pipeline mode should be a no-op but failed");
+
+	if (PQisBusy(conn) != 0)
+		pg_fatal("PQisBusy should return 0 when idle in pipeline mode, returned 1");
+
+	/* ok, back to normal command mode */
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("couldn't exit idle empty pipeline mode");
+
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+		pg_fatal("Pipeline mode not terminated properly");
+
+	/* exiting pipeline mode when not in pipeline mode should be a no-op */
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("pipeline mode exit when not in pipeline mode should succeed but failed");
+
+	/* can now PQexec again */
+	res = PQexec(conn, "SELECT 1");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("PQexec should succeed after exiting pipeline mode but failed with: %s",
+				 PQerrorMessage(conn));
+	PQclear(res);
+
+	fprintf(stderr, "ok\n");
+}
+
+/*
+ * Send two pipelines back to back, each with its own sync point, and read
+ * all the results in order.
+ */
+static void
+test_multi_pipelines(PGconn *conn)
+{
+	const char *dummy_params[1] = {"1"};
+	Oid			dummy_param_oids[1] = {INT4OID};
+	int			i;
+
+	fprintf(stderr, "multi pipeline... ");
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	for (i = 0; i < 2; i++)
+	{
+		if (PQsendQueryParams(conn, "SELECT $1", 1, dummy_param_oids,
+							  dummy_params, NULL, NULL, 0) != 1)
+			pg_fatal("dispatching SELECT failed: %s", PQerrorMessage(conn));
+
+		if (PQpipelineSync(conn) != 1)
+			pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+	}
+
+	if (PQexitPipelineMode(conn) != 0)
+		pg_fatal("exiting pipeline mode with work in progress should fail, but succeeded");
+
+	for (i = 0; i < 2; i++)
+	{
+		EXPECT(conn, PGRES_TUPLES_OK);
+		EXPECT_NULL(conn);
+		EXPECT(conn, PGRES_PIPELINE_SYNC);
+	}
+
+	/* We're still in pipeline mode ... */
+	if (PQpipelineStatus(conn) == PQ_PIPELINE_OFF)
+		pg_fatal("Fell out of pipeline mode somehow");
+
+	/* until we end it, which we can safely do now */
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("attempt to exit pipeline mode failed when it should've succeeded: %s",
+				 PQerrorMessage(conn));
+
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+		pg_fatal("exiting pipeline mode didn't seem to work");
+
+	fprintf(stderr, "ok\n");
+}
+
+/*
+ * An error in the middle of a pipeline aborts the remaining commands up to
+ * the sync point, and the pipeline after it runs normally.
+ */
+static void
+test_pipeline_abort(PGconn *conn)
+{
+	PGresult   *res;
+	const char *values[1] = {"1"};
+	const char *bad_values[1] = {"not a number"};
+	Oid			oids[1] = {INT4OID};
+
+	fprintf(stderr, "aborted pipeline... ");
+
+	res = PQexec(conn, "DROP TABLE IF EXISTS pq_pipeline_demo;"
+				 "CREATE UNLOGGED TABLE pq_pipeline_demo(id serial primary key, itemno integer);");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("setup failed: %s", PQerrorMessage(conn));
+	PQclear(res);
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	if (PQsendQueryParams(conn, "INSERT INTO pq_pipeline_demo(itemno) VALUES ($1)",
+						  1, oids, values, NULL, NULL, 0) != 1)
+		pg_fatal("dispatching first insert failed: %s", PQerrorMessage(conn));
+	if (PQsendQueryParams(conn, "INSERT INTO pq_pipeline_demo(itemno) VALUES ($1)",
+						  1, oids, bad_values, NULL, NULL, 0) != 1)
+		pg_fatal("dispatching failing insert failed: %s", PQerrorMessage(conn));
+	if (PQsendQueryParams(conn, "INSERT INTO pq_pipeline_demo(itemno) VALUES ($1)",
+						  1, oids, values, NULL, NULL, 0) != 1)
+		pg_fatal("dispatching third insert failed: %s", PQerrorMessage(conn));
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	/* a second pipeline, which must not be affected by the first failure */
+	if (PQsendQueryParams(conn, "INSERT INTO pq_pipeline_demo(itemno) VALUES ($1)",
+						  1, oids, values, NULL, NULL, 0) != 1)
+		pg_fatal("dispatching fourth insert failed: %s", PQerrorMessage(conn));
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("second pipeline sync failed: %s", PQerrorMessage(conn));
+
+	EXPECT(conn, PGRES_COMMAND_OK);
+	EXPECT_NULL(conn);
+
+	res = expect_result(conn, PGRES_FATAL_ERROR, __LINE__);
+	if (strcmp(PQresultErrorField(res, PG_DIAG_SQLSTATE), "22P02") != 0)
+		pg_fatal("unexpected error: %s", PQresultErrorMessage(res));
+	PQclear(res);
+	EXPECT_NULL(conn);
+
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_ABORTED)
+		pg_fatal("pipeline should be flagged as aborted but isn't");
+
+	EXPECT(conn, PGRES_PIPELINE_ABORTED);
+	EXPECT_NULL(conn);
+
+	EXPECT(conn, PGRES_PIPELINE_SYNC);
+
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_ON)
+		pg_fatal("sync should have cleared the aborted state");
+
+	EXPECT(conn, PGRES_COMMAND_OK);
+	EXPECT_NULL(conn);
+	EXPECT(conn, PGRES_PIPELINE_SYNC);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("exiting pipeline mode failed: %s", PQerrorMessage(conn));
+
+	/* only the first and the last insert happened */
+	res = PQexec(conn, "SELECT itemno FROM pq_pipeline_demo");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("SELECT failed: %s", PQerrorMessage(conn));
+	if (PQntuples(res) != 2)
+		pg_fatal("expected 2 rows, got %d", PQntuples(res));
+	PQclear(res);
+
+	fprintf(stderr, "ok\n");
+}
+
+/*
+ * Parse, describe and execute a prepared statement without intermediate
+ * round trips.
+ */
+static void
+test_prepared(PGconn *conn)
+{
+	PGresult   *res;
+	const char *values[1] = {"42"};
+	Oid			oids[1] = {INT4OID};
+
+	fprintf(stderr, "prepared... ");
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s", PQerrorMessage(conn));
+	if (PQsendPrepare(conn, "select_one", "SELECT $1, '42', $1::numeric",
+					  1, oids) != 1)
+		pg_fatal("preparing query failed: %s", PQerrorMessage(conn));
+	if (PQsendDescribePrepared(conn, "select_one") != 1)
+		pg_fatal("failed to send describePrepared: %s", PQerrorMessage(conn));
+	if (PQsendQueryPrepared(conn, "select_one", 1, values, NULL, NULL, 0) != 1)
+		pg_fatal("failed to execute prepared statement: %s", PQerrorMessage(conn));
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	EXPECT(conn, PGRES_COMMAND_OK);
+	EXPECT_NULL(conn);
+
+	res = expect_result(conn, PGRES_COMMAND_OK, __LINE__);
+	if (PQnfields(res) != 3)
+		pg_fatal("expected 3 columns, got %d", PQnfields(res));
+	if (PQftype(res, 0) != INT4OID)
+		pg_fatal("field 0: got type %u, expected %u", PQftype(res, 0), INT4OID);
+	if (PQftype(res, 2) != NUMERICOID)
+		pg_fatal("field 2: got type %u, expected %u", PQftype(res, 2), NUMERICOID);
+	PQclear(res);
+	EXPECT_NULL(conn);
+
+	res = expect_result(conn, PGRES_TUPLES_OK, __LINE__);
+	if (strcmp(PQgetvalue(res, 0, 0), "42") != 0)
+		pg_fatal("unexpected value \"%s\"", PQgetvalue(res, 0, 0));
+	PQclear(res);
+	EXPECT_NULL(conn);
+
+	EXPECT(conn, PGRES_PIPELINE_SYNC);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("could not exit pipeline mode: %s", PQerrorMessage(conn));
+
+	fprintf(stderr, "ok\n");
+}
+
+/*
+ * Single-row mode works per command within a pipeline.
+ */
+static void
+test_singlerowmode(PGconn *conn)
+{
+	PGresult   *res;
+	const char *values[1] = {"44"};
+	int			i;
+	int			nrows = 0;
+
+	fprintf(stderr, "single-row mode... ");
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	for (i = 0; i < 3; i++)
+	{
+		if (PQsendQueryParams(conn, "SELECT generate_series(42, $1)",
+							  1, NULL, values, NULL, NULL, 0) != 1)
+			pg_fatal("failed to send query: %s", PQerrorMessage(conn));
+	}
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	for (i = 0; i < 3; i++)
+	{
+		/* only the second query gets single-row mode */
+		if (i == 1 && PQsetSingleRowMode(conn) != 1)
+			pg_fatal("PQsetSingleRowMode() failed for query %d", i);
+
+		if (i != 1)
+		{
+			EXPECT(conn, PGRES_TUPLES_OK);
+			EXPECT_NULL(conn);
+			continue;
+		}
+
+		for (;;)
+		{
+			res = PQgetResult(conn);
+			if (res == NULL)
+				pg_fatal("unexpected NULL result in single-row mode");
+			if (PQresultStatus(res) == PGRES_TUPLES_OK)
+			{
+				PQclear(res);
+				break;
+			}
+			if (PQresultStatus(res) != PGRES_SINGLE_TUPLE)
+				pg_fatal("expected PGRES_SINGLE_TUPLE, got %s",
+						 PQresStatus(PQresultStatus(res)));
+			nrows++;
+			PQclear(res);
+		}
+		EXPECT_NULL(conn);
+	}
+
+	if (nrows != 3)
+		pg_fatal("expected 3 single-row results, got %d", nrows);
+
+	EXPECT(conn, PGRES_PIPELINE_SYNC);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("failed to end pipeline mode: %s", PQerrorMessage(conn));
+
+	fprintf(stderr, "ok\n");
+}
+
+/*
+ * Send a large number of parameterized inserts over a non-blocking
+ * connection, reading results as they arrive, so that the server processes
+ * a continuous stream of Bind/Execute messages with no Sync between them.
+ */
+#define PIPELINED_INSERT_ROWS	10000
+
+static void
+test_pipelined_insert(PGconn *conn)
+{
+	PGresult   *res;
+	const char *insert_sql =
+	"INSERT INTO pq_pipeline_demo(itemno) VALUES ($1)";
+	Oid			oids[1] = {INT4OID};
+	int			sent = 0;
+	int			received = 0;
+	bool		synced = false;
+	bool		got_sync = false;
+	int			sock = PQsocket(conn);
+
+	fprintf(stderr, "pipelined insert... ");
+
+	res = PQexec(conn, "DROP TABLE IF EXISTS pq_pipeline_demo;"
+				 "CREATE UNLOGGED TABLE pq_pipeline_demo(id serial primary key, itemno integer);");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("setup failed: %s", PQerrorMessage(conn));
+	PQclear(res);
+
+	if (PQsetnonblocking(conn, 1) != 0)
+		pg_fatal("failed to set nonblocking mode: %s", PQerrorMessage(conn));
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("failed to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	while (!got_sync)
+	{
+		fd_set		input_mask;
+		fd_set		output_mask;
+
+		FD_ZERO(&input_mask);
+		FD_SET(sock, &input_mask);
+		FD_ZERO(&output_mask);
+		FD_SET(sock, &output_mask);
+
+		if (select(sock + 1, &input_mask, &output_mask, NULL, NULL) < 0)
+			pg_fatal("select() failed: %m");
+
+		/* consume whatever results have arrived */
+		if (FD_ISSET(sock, &input_mask))
+		{
+			if (PQconsumeInput(conn) != 1)
+				pg_fatal("PQconsumeInput failed: %s", PQerrorMessage(conn));
+
+			while (!PQisBusy(conn))
+			{
+				res = PQgetResult(conn);
+
+				/* nothing queued that we haven't read the results of */
+				if (res == NULL)
+					break;
+
+				if (PQresultStatus(res) == PGRES_PIPELINE_SYNC)
+				{
+					if (!synced || received != PIPELINED_INSERT_ROWS)
+						pg_fatal("got sync after %d of %d results",
+								 received, PIPELINED_INSERT_ROWS);
+					got_sync = true;
+					PQclear(res);
+					break;
+				}
+				if (PQresultStatus(res) != PGRES_COMMAND_OK)
+					pg_fatal("insert %d failed: %s", received,
+							 PQresultErrorMessage(res));
+				received++;
+				PQclear(res);
+
+				/* the next PQgetResult returns the NULL for this command */
+				res = PQgetResult(conn);
+				if (res != NULL)
+					pg_fatal("expected NULL after insert result, got %s",
+							 PQresStatus(PQresultStatus(res)));
+			}
+		}
+
+		/* then queue up more work, as long as the socket takes it */
+		if (FD_ISSET(sock, &output_mask) && !synced)
+		{
+			while (sent < PIPELINED_INSERT_ROWS)
+			{
+				char		itemno[32];
+				const char *values[1];
+
+				snprintf(itemno, sizeof(itemno), "%d", sent);
+				values[0] = itemno;
+				if (PQsendQueryParams(conn, insert_sql, 1, oids, values,
+									  NULL, NULL, 0) != 1)
+					pg_fatal("dispatching insert %d failed: %s",
+							 sent, PQerrorMessage(conn));
+				sent++;
+
+				/*
+				 * Every so often, push the queue out; if the socket is
+				 * backed up, go read results before queueing more.
+				 */
+				if (sent % 100 == 0 && PQflush(conn) == 1)
+					break;
+			}
+
+			if (sent == PIPELINED_INSERT_ROWS)
+			{
+				if (PQpipelineSync(conn) != 1)
+					pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+				synced = true;
+			}
+		}
+
+		/* keep pushing anything left in the output buffer */
+		if (PQflush(conn) < 0)
+			pg_fatal("PQflush failed: %s", PQerrorMessage(conn));
+	}
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("failed to exit pipeline mode: %s", PQerrorMessage(conn));
+	if (PQsetnonblocking(conn, 0) != 0)
+		pg_fatal("failed to clear nonblocking mode: %s", PQerrorMessage(conn));
+
+	res = PQexec(conn, "SELECT count(*) FROM pq_pipeline_demo");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("SELECT failed: %s", PQerrorMessage(conn));
+	if (atoi(PQgetvalue(res, 0, 0)) != PIPELINED_INSERT_ROWS)
+		pg_fatal("expected %d rows, found %s",
+				 PIPELINED_INSERT_ROWS, PQgetvalue(res, 0, 0));
+	PQclear(res);
+
+	fprintf(stderr, "ok\n");
+}
+
+static void
+usage(const char *progname)
+{
+	fprintf(stderr, "%s tests the libpq pipeline mode.\n\n", progname);
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "  %s tests\n", progname);
+	fprintf(stderr, "  %s TESTNAME [CONNINFO]\n", progname);
+}
+
+static void
+print_test_list(void)
+{
+	printf("disallowed_in_pipeline\n");
+	printf("multi_pipelines\n");
+	printf("pipeline_abort\n");
+	printf("pipelined_insert\n");
+	printf("prepared\n");
+	printf("singlerow\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *conninfo = "";
+	PGconn	   *conn;
+	char	   *testname;
+	PGresult   *res;
+
+	if (argc < 2 || argc > 3)
+	{
+		usage(argv[0]);
+		exit(1);
+	}
+
+	testname = pg_strdup(argv[1]);
+	if (strcmp(testname, "tests") == 0)
+	{
+		print_test_list();
+		exit(0);
+	}
+
+	if (argc > 2)
+		conninfo = pg_strdup(argv[2]);
+
+	/* Make a connection to the database */
+	conn = PQconnectdb(conninfo);
+	if (PQstatus(conn) != CONNECTION_OK)
+	{
+		fprintf(stderr, "Connection to database failed: %s\n",
+				PQerrorMessage(conn));
+		exit_nicely(conn);
+	}
+
+	res = PQexec(conn, "SET lc_messages TO \"C\"");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("failed to set lc_messages: %s", PQerrorMessage(conn));
+	PQclear(res);
+
+	if (strcmp(testname, "disallowed_in_pipeline") == 0)
+		test_disallowed_in_pipeline(conn);
+	else if (strcmp(testname, "multi_pipelines") == 0)
+		test_multi_pipelines(conn);
+	else if (strcmp(testname, "pipeline_abort") == 0)
+		test_pipeline_abort(conn);
+	else if (strcmp(testname, "pipelined_insert") == 0)
+		test_pipelined_insert(conn);
+	else if (strcmp(testname, "prepared") == 0)
+		test_prepared(conn);
+	else if (strcmp(testname, "singlerow") == 0)
+		test_singlerowmode(conn);
+	else
+	{
+		fprintf(stderr, "\"%s\" is not a recognized test name\n", testname);
+		exit(1);
+	}
+
+	/* close the connection to the database and cleanup */
+	PQfinish(conn);
+	return 0;
+}
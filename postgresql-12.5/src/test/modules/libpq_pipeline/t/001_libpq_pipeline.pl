@@ -0,0 +1,29 @@
+# Run the libpq pipeline mode tests against a temporary cluster
+use strict;
+use warnings;
+
+use Cwd;
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+my $node = get_new_node('main');
+$node->init;
+$node->start;
+
+$ENV{PATH} = "$ENV{PATH}:" . getcwd();
+
+my ($out, $err) = run_command([ 'libpq_pipeline', 'tests' ]);
+die "oops: $err" unless $err eq '';
+my @tests = split(/\s+/, $out);
+
+for my $testname (@tests)
+{
+	$node->command_ok(
+		[ 'libpq_pipeline', $testname, $node->connstr('postgres') ],
+		"libpq_pipeline $testname");
+}
+
+$node->stop('fast');
+
+done_testing();
@@ -0,0 +1,37 @@
+--
+-- Shared catalog cache
+--
+-- Catalog tuples read by one session are published for the others; check
+-- that no session sees a superseded or uncommitted version of them.
+--
+create function scc_f(int) returns int language sql as 'select $1 + 1';
+create table scc_tbl (a int, b text);
+insert into scc_tbl values (1, 'one');
+create type scc_enum as enum ('a', 'b');
+select scc_f(1);
+select a, b from scc_tbl;
+select 'a'::scc_enum;
+-- another session finds the same tuples, then changes them
+\c -
+select scc_f(1);
+select a, b from scc_tbl;
+create or replace function scc_f(int) returns int language sql as 'select $1 + 10';
+alter table scc_tbl rename column b to c;
+alter type scc_enum rename value 'a' to 'z';
+\c -
+select scc_f(1);
+select a, c from scc_tbl;
+select b from scc_tbl;
+select 'z'::scc_enum;
+select 'a'::scc_enum;
+-- tuples changed by a transaction that rolls back must not be published
+begin;
+alter function scc_f(int) rename to scc_g;
+select scc_g(1);
+rollback;
+\c -
+select scc_f(1);
+select scc_g(1);
+drop function scc_f(int);
+drop table scc_tbl;
+drop type scc_enum;
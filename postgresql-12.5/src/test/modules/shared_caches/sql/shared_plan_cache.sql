@@ -0,0 +1,61 @@
+--
+-- Shared plan cache
+--
+-- Generic plans of prepared statements are published to other sessions,
+-- together with the statistics on which the choice of a generic plan was
+-- based.
+--
+create schema spc_schema;
+create table spc_tbl (a int primary key, b text) with (autovacuum_enabled = off);
+insert into spc_tbl select i, 'row ' || i from generate_series(1, 1000) i;
+analyze spc_tbl;
+create table spc_schema.spc_tbl (a int primary key, b text) with (autovacuum_enabled = off);
+insert into spc_schema.spc_tbl select i, 'other ' || i from generate_series(1, 1000) i;
+analyze spc_schema.spc_tbl;
+\c -
+-- the first five executions get custom plans, then a generic plan is built
+prepare spc_q(int) as select b from spc_tbl where a = $1;
+explain (costs off) execute spc_q(1);
+execute spc_q(2);
+execute spc_q(3);
+execute spc_q(4);
+execute spc_q(5);
+explain (costs off) execute spc_q(6);
+-- a new session preparing the same statement uses the generic plan at once
+\c -
+prepare spc_q(int) as select b from spc_tbl where a = $1;
+explain (costs off) execute spc_q(7);
+execute spc_q(7);
+-- but not if the same text refers to different objects
+\c -
+set search_path = spc_schema, public;
+prepare spc_q(int) as select b from spc_tbl where a = $1;
+explain (costs off) execute spc_q(7);
+execute spc_q(7);
+-- changing a relation the plan depends on removes it from the shared cache
+\c -
+create index spc_tbl_b_idx on spc_tbl (b);
+\c -
+prepare spc_q(int) as select b from spc_tbl where a = $1;
+explain (costs off) execute spc_q(8);
+execute spc_q(8);
+-- plans on temporary tables are never shared
+\c -
+create temp table spc_temp (a int primary key, b text);
+insert into spc_temp select i, 'temp ' || i from generate_series(1, 1000) i;
+analyze spc_temp;
+prepare spc_t(int) as select b from spc_temp where a = $1;
+explain (costs off) execute spc_t(1);
+execute spc_t(2);
+execute spc_t(3);
+execute spc_t(4);
+execute spc_t(5);
+explain (costs off) execute spc_t(6);
+\c -
+create temp table spc_temp (a int primary key, b text);
+insert into spc_temp select i, 'temp ' || i from generate_series(1, 1000) i;
+analyze spc_temp;
+prepare spc_t(int) as select b from spc_temp where a = $1;
+explain (costs off) execute spc_t(7);
+drop table spc_tbl;
+drop schema spc_schema cascade;
@@ -0,0 +1,77 @@
+# Test protocol compression on client and replication connections
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+if ($ENV{with_zlib} ne 'yes')
+{
+	plan skip_all => 'zlib not supported by this build';
+}
+else
+{
+	plan tests => 6;
+}
+
+my $primary = get_new_node('primary');
+$primary->init(allows_streaming => 1);
+$primary->start;
+
+my $primary_connstr = $primary->connstr('postgres');
+
+# Plain client connection, with enough data to span many flushes
+my $result = $primary->safe_psql('postgres',
+	"SELECT count(*), sum(length(repeat(md5(g::text), 20)))
+	 FROM generate_series(1, 100000) g",
+	extra_params => [ '-d', "$primary_connstr compression=on" ]);
+is($result, '100000|64000000', 'query over compressed connection');
+
+$primary->safe_psql('postgres',
+	'CREATE TABLE t AS SELECT g AS a, repeat(md5(g::text), 10) AS b
+	 FROM generate_series(1, 50000) g');
+$result = $primary->safe_psql(
+	'postgres',
+	"COPY t TO STDOUT",
+	extra_params => [ '-d', "$primary_connstr compression=on" ]);
+is(scalar(split /\n/, $result), 50000, 'COPY out over compressed connection');
+
+# The server may refuse, in which case the connection is just uncompressed
+$primary->append_conf('postgresql.conf', 'network_compression = off');
+$primary->reload;
+$result = $primary->safe_psql('postgres', 'SELECT count(*) FROM t',
+	extra_params => [ '-d', "$primary_connstr compression=on" ]);
+is($result, '50000', 'compression request declined by server');
+$primary->append_conf('postgresql.conf', 'network_compression = on');
+$primary->reload;
+
+# Base backup over a compressed replication connection
+my $backup_dir = $primary->backup_dir . '/compressed';
+command_ok(
+	[
+		'pg_basebackup', '-D', $backup_dir, '-X', 'stream',
+		'-d', "$primary_connstr compression=on"
+	],
+	'pg_basebackup over compressed connection');
+
+# Streaming replication over a compressed connection
+$primary->backup('bkp');
+my $standby = get_new_node('standby');
+$standby->init_from_backup($primary, 'bkp', has_streaming => 1);
+$standby->append_conf('postgresql.conf',
+	"primary_conninfo = '$primary_connstr application_name=standby compression=on'"
+);
+$standby->start;
+
+$primary->safe_psql('postgres',
+	'INSERT INTO t SELECT g, repeat(md5(g::text), 10)
+	 FROM generate_series(50001, 100000) g');
+$primary->wait_for_catchup('standby', 'replay',
+	$primary->lsn('insert'));
+$result = $standby->safe_psql('postgres', 'SELECT count(*) FROM t');
+is($result, '100000', 'standby replayed WAL streamed with compression');
+
+$result = $primary->safe_psql('postgres',
+	"SELECT count(*) FROM pg_stat_replication WHERE application_name = 'standby'"
+);
+is($result, '1', 'compressed walsender connection is active');
@@ -0,0 +1,96 @@
+# Test prefetching of blocks referenced by WAL during recovery
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+# Full-page images are replayed without reading the block, so turn them
+# off to make replay read, and the prefetcher look at, every block.
+my $primary = get_new_node('primary');
+$primary->init(allows_streaming => 1);
+$primary->append_conf('postgresql.conf', <<EOF);
+full_page_writes = off
+autovacuum = off
+EOF
+$primary->start;
+
+# recovery_prefetch defaults to on wherever it is supported
+if ($primary->safe_psql('postgres', 'SHOW recovery_prefetch') ne 'on')
+{
+	plan skip_all => 'recovery_prefetch not supported on this platform';
+}
+else
+{
+	plan tests => 5;
+}
+
+$primary->safe_psql('postgres',
+	'CREATE TABLE prefetch_tbl (a int PRIMARY KEY, b text)');
+
+$primary->backup('bkp');
+
+# A standby with few enough buffers that replay keeps evicting the blocks
+# it needs, so that most of them have to be prefetched.
+my $standby = get_new_node('standby');
+$standby->init_from_backup($primary, 'bkp', has_streaming => 1);
+$standby->append_conf('postgresql.conf', <<EOF);
+shared_buffers = 1MB
+recovery_prefetch = on
+EOF
+$standby->start;
+
+my $check_query =
+  "SELECT count(*), sum(a), md5(string_agg(b, ',' ORDER BY a)) FROM prefetch_tbl";
+
+# Wait for the standby to replay everything, and compare its contents
+# with the primary's.
+sub check_standby
+{
+	my ($test_name) = @_;
+
+	$primary->wait_for_catchup('standby', 'replay', $primary->lsn('insert'));
+	is( $standby->safe_psql('postgres', $check_query),
+		$primary->safe_psql('postgres', $check_query), $test_name);
+	return;
+}
+
+# Spread inserts, updates and deletes over many more blocks than the
+# standby can keep in its buffers.
+$primary->safe_psql('postgres',
+	"INSERT INTO prefetch_tbl SELECT g, repeat(md5(g::text), 5)
+	 FROM generate_series(1, 20000) g");
+$primary->safe_psql('postgres',
+	"UPDATE prefetch_tbl SET b = md5(b) WHERE a % 7 = 0");
+$primary->safe_psql('postgres', "DELETE FROM prefetch_tbl WHERE a % 11 = 0");
+check_standby('standby replays heap and index changes with prefetching');
+
+# Blocks the prefetcher looks ahead to may belong to relations that are
+# truncated or dropped before replay reaches them.
+$primary->safe_psql('postgres', <<EOF);
+CREATE TABLE prefetch_gone (a int PRIMARY KEY);
+INSERT INTO prefetch_gone SELECT generate_series(1, 10000);
+TRUNCATE prefetch_gone;
+INSERT INTO prefetch_gone SELECT generate_series(1, 100);
+DROP TABLE prefetch_gone;
+UPDATE prefetch_tbl SET b = md5(b) WHERE a % 5 = 0;
+EOF
+check_standby('standby replays changes to truncated and dropped relations');
+is($standby->safe_psql('postgres', "SELECT to_regclass('prefetch_gone')"),
+	'', 'dropped relation is gone on the standby');
+
+# The setting can be changed without a restart
+$standby->append_conf('postgresql.conf', 'recovery_prefetch = off');
+$standby->reload;
+$primary->safe_psql('postgres',
+	"UPDATE prefetch_tbl SET b = md5(b) WHERE a % 3 = 0");
+check_standby('standby replays without prefetching after reload');
+
+# Crash recovery prefetches, too
+$primary->safe_psql('postgres',
+	"UPDATE prefetch_tbl SET b = md5(b) WHERE a % 2 = 0");
+my $before = $primary->safe_psql('postgres', $check_query);
+$primary->stop('immediate');
+$primary->start;
+is($primary->safe_psql('postgres', $check_query),
+	$before, 'crash recovery with prefetching restores all changes');
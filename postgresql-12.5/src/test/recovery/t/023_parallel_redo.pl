@@ -0,0 +1,107 @@
+# Test replay of WAL by parallel redo workers
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+my $primary = get_new_node('primary');
+$primary->init(allows_streaming => 1);
+$primary->append_conf('postgresql.conf', 'autovacuum = off');
+$primary->start;
+
+# Several tables, so that records are spread over both workers
+for my $i (1 .. 4)
+{
+	$primary->safe_psql('postgres',
+		"CREATE TABLE redo_tbl$i (a int PRIMARY KEY, b text)");
+}
+
+$primary->backup('bkp');
+
+my $standby = get_new_node('standby');
+$standby->init_from_backup($primary, 'bkp', has_streaming => 1);
+$standby->append_conf('postgresql.conf', <<EOF);
+max_parallel_redo_workers = 2
+max_worker_processes = 8
+EOF
+$standby->start;
+
+my $check_query = join(
+	' UNION ALL ',
+	map {
+		"SELECT $_, count(*), sum(a), md5(string_agg(b, ',' ORDER BY a)) FROM redo_tbl$_"
+	} (1 .. 4));
+
+# Wait for the standby to replay everything, and compare its contents
+# with the primary's.
+sub check_standby
+{
+	my ($test_name) = @_;
+
+	$primary->wait_for_catchup('standby', 'replay', $primary->lsn('insert'));
+	is( $standby->safe_psql('postgres', $check_query),
+		$primary->safe_psql('postgres', $check_query), $test_name);
+	return;
+}
+
+# Heap inserts and enough index entries to split btree pages
+for my $i (1 .. 4)
+{
+	$primary->safe_psql('postgres',
+		"INSERT INTO redo_tbl$i SELECT g, md5((g * $i)::text)
+		 FROM generate_series(1, 5000) g");
+}
+check_standby('standby replays inserts and btree splits');
+
+like(
+	slurp_file($standby->logfile),
+	qr/started 2 parallel redo workers/,
+	'standby started parallel redo workers');
+
+# Updates, deletes and row locks, interleaved across tables within
+# transactions
+$primary->safe_psql('postgres', <<EOF);
+BEGIN;
+UPDATE redo_tbl1 SET b = md5(b) WHERE a % 3 = 0;
+DELETE FROM redo_tbl2 WHERE a % 4 = 0;
+SELECT count(*) FROM redo_tbl3 WHERE a % 5 = 0 FOR UPDATE;
+UPDATE redo_tbl4 SET a = a + 10000 WHERE a % 7 = 0;
+UPDATE redo_tbl1 SET b = 'x' WHERE a < 100;
+COMMIT;
+EOF
+$primary->safe_psql('postgres', <<EOF);
+BEGIN;
+UPDATE redo_tbl3 SET b = 'rolled back';
+ROLLBACK;
+EOF
+check_standby('standby replays updates, deletes and row locks');
+
+# Multi-inserts through COPY, and a relation truncated and refilled while
+# its earlier changes may still be queued for a worker
+$primary->safe_psql('postgres', <<EOF);
+COPY redo_tbl2 (a) FROM PROGRAM 'seq 20001 25000' WITH (FORMAT text);
+TRUNCATE redo_tbl4;
+INSERT INTO redo_tbl4 SELECT g, 'refilled' FROM generate_series(1, 1000) g;
+EOF
+check_standby('standby replays multi-inserts and truncation');
+
+# Hot standby queries see committed changes only once they are replayed
+$primary->safe_psql('postgres',
+	"INSERT INTO redo_tbl1 VALUES (100000, 'last')");
+$primary->wait_for_catchup('standby', 'replay', $primary->lsn('insert'));
+is( $standby->safe_psql('postgres',
+		"SELECT b FROM redo_tbl1 WHERE a = 100000"),
+	'last',
+	'hot standby query sees a just-committed row');
+
+# The promoted standby accepts writes on replayed tables
+$standby->promote;
+$standby->poll_query_until('postgres', 'SELECT NOT pg_is_in_recovery()')
+  or die "Timed out while waiting for promotion";
+$standby->safe_psql('postgres',
+	"INSERT INTO redo_tbl1 VALUES (100001, 'promoted')");
+is( $standby->safe_psql('postgres',
+		"SELECT count(*) FROM redo_tbl1 WHERE a >= 100000"),
+	'2',
+	'promoted standby accepts writes');
@@ -1060,3 +1060,69 @@ select v||'a', case when v||'a' = 'aa' then 1 else 0 end, count(*)
 explain (costs off)
   select 1 from tenk1
    where (hundred, thousand) in (select twothousand, twothousand from onek);
+
+-- Test batched retrieval of aggregate input from a seqscan
+create temp table agg_batch (a int, b int);
+insert into agg_batch select g, g % 10 from generate_series(1, 1000) g;
+set executor_batch_size = 7;
+select count(*), sum(a), min(a), max(a) from agg_batch where b < 5;
+select b, count(*), sum(a) from agg_batch group by b order by b;
+select count(*) from agg_batch where a > 1000;
+reset executor_batch_size;
+
+-- Test hash aggregation spilling to disk when work_mem is exceeded
+create temp table agg_spill as
+  select g % 5000 as a, g from generate_series(1, 20000) g;
+set work_mem = '64kB';
+set enable_sort = false;
+explain (costs off)
+  select a, sum(g), count(*) from agg_spill group by a;
+select count(*), sum(s), sum(c)
+  from (select a, sum(g) as s, count(*) as c from agg_spill group by a) ss;
+select count(*), sum(cardinality(arr))
+  from (select a::text as t, array_agg(g) as arr from agg_spill group by 1) ss;
+select a, count(*) from agg_spill group by a having count(*) <> 4;
+
+-- The same, with the spill files compressed
+do $$
+begin
+  set temp_file_compression = lz4;
+exception when invalid_parameter_value then
+  set temp_file_compression = pglz;
+end $$;
+select count(*), sum(s), sum(c)
+  from (select a, sum(g) as s, count(*) as c from agg_spill group by a) ss;
+select count(*), sum(cardinality(arr))
+  from (select a::text as t, array_agg(g) as arr from agg_spill group by 1) ss;
+set temp_file_compression = pglz;
+select count(*), sum(s), sum(c)
+  from (select a, sum(g) as s, count(*) as c from agg_spill group by a) ss;
+reset temp_file_compression;
+reset enable_sort;
+reset work_mem;
+
+-- Test eager aggregation: partially aggregating the fact table below its
+-- join to a dimension table
+create temp table eager_dim (k int primary key, name text);
+insert into eager_dim select i, 'dim ' || (i % 5) from generate_series(1, 100) i;
+create temp table eager_fact (k int, x int);
+insert into eager_fact select i % 10 + 1, i from generate_series(1, 10000) i;
+analyze eager_dim;
+analyze eager_fact;
+set enable_eager_aggregate = on;
+explain (costs off)
+  select d.name, sum(f.x), count(*)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name;
+select d.name, sum(f.x), count(*)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name order by d.name;
+select d.name, sum(f.x), count(*)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name having sum(f.x) > 10000000 order by d.name;
+-- not possible if an aggregate refers to both sides of the join
+explain (costs off)
+  select d.name, sum(f.x + d.k)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name;
+reset enable_eager_aggregate;
@@ -0,0 +1,185 @@
+CREATE TABLE brintest_bloom (int2col smallint,
+	int4col integer,
+	int8col bigint,
+	textcol text,
+	datecol date,
+	timestampcol timestamp without time zone,
+	timestamptzcol timestamp with time zone,
+	uuidcol uuid
+) WITH (fillfactor=10, autovacuum_enabled=off);
+
+INSERT INTO brintest_bloom SELECT
+	thousand,
+	twothousand,
+	142857 * tenthous,
+	repeat(stringu1, 8),
+	date '1995-08-15' + tenthous,
+	timestamp '1942-07-23 03:05:09' + tenthous * interval '36.38 hours',
+	timestamptz '1972-10-10 03:00' + thousand * interval '1 hour',
+	format('%s%s-%s-%s-%s-%s%s%s', to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'), to_char(tenthous, 'FM0000'))::uuid
+FROM tenk1 ORDER BY unique2 LIMIT 100;
+
+-- throw in some NULL's
+INSERT INTO brintest_bloom (int2col) SELECT NULL FROM tenk1 LIMIT 25;
+
+CREATE INDEX brinidx_bloom ON brintest_bloom USING brin (
+	int2col int2_bloom_ops,
+	int4col int4_bloom_ops,
+	int8col int8_bloom_ops,
+	textcol text_bloom_ops,
+	datecol date_bloom_ops,
+	timestampcol timestamp_bloom_ops,
+	timestamptzcol timestamptz_bloom_ops,
+	uuidcol uuid_bloom_ops
+) WITH (pages_per_range = 1);
+
+CREATE TABLE brinopers_bloom (colname name, typ text,
+	op text[], value text[], matches int[],
+	check (cardinality(op) = cardinality(value)),
+	check (cardinality(op) = cardinality(matches)));
+
+INSERT INTO brinopers_bloom VALUES
+	('int2col', 'int2',
+	 '{=}',
+	 '{800}',
+	 '{1}'),
+	('int4col', 'int4',
+	 '{=}',
+	 '{800}',
+	 '{1}'),
+	('int8col', 'int8',
+	 '{=}',
+	 '{1257141600}',
+	 '{1}'),
+	('textcol', 'text',
+	 '{=}',
+	 '{BNAAAABNAAAABNAAAABNAAAABNAAAABNAAAABNAAAABNAAAA}',
+	 '{1}'),
+	('datecol', 'date',
+	 '{=}',
+	 '{2009-12-01}',
+	 '{1}'),
+	('timestampcol', 'timestamp',
+	 '{=}',
+	 '{1964-03-24 19:26:45}',
+	 '{1}'),
+	('timestamptzcol', 'timestamptz',
+	 '{=}',
+	 '{1972-10-19 09:00:00-07}',
+	 '{1}'),
+	('uuidcol', 'uuid',
+	 '{=}',
+	 '{52225222-5222-5222-5222-522252225222}',
+	 '{1}');
+
+-- compare bitmap scans on the bloom index with seqscans of the heap
+
+CREATE FUNCTION brin_bloom_check() RETURNS void LANGUAGE plpgsql AS $x$
+DECLARE
+	r record;
+	cond text;
+	idx_ctids tid[];
+	ss_ctids tid[];
+	count int;
+	plan_ok bool;
+	plan_line text;
+BEGIN
+	FOR r IN SELECT colname, oper, typ, value[ordinality], matches[ordinality] FROM brinopers_bloom, unnest(op) WITH ORDINALITY AS oper LOOP
+
+		cond := format('%I %s %L::%s', r.colname, r.oper, r.value, r.typ);
+
+		-- run the query using the brin index
+		SET enable_seqscan = 0;
+		SET enable_bitmapscan = 1;
+
+		plan_ok := false;
+		FOR plan_line IN EXECUTE format($y$EXPLAIN SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond) LOOP
+			IF plan_line LIKE '%Bitmap Heap Scan on brintest_bloom%' THEN
+				plan_ok := true;
+			END IF;
+		END LOOP;
+		IF NOT plan_ok THEN
+			RAISE WARNING 'did not get bitmap indexscan plan for %', r;
+		END IF;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond)
+			INTO idx_ctids;
+
+		-- run the query using a seqscan
+		SET enable_seqscan = 1;
+		SET enable_bitmapscan = 0;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond)
+			INTO ss_ctids;
+
+		-- make sure both return the same results
+		count := array_length(idx_ctids, 1);
+
+		IF NOT (count = array_length(ss_ctids, 1) AND
+				idx_ctids @> ss_ctids AND
+				idx_ctids <@ ss_ctids) THEN
+			RAISE WARNING 'something not right in %: count %', r, count;
+		END IF;
+
+		-- make sure we found expected number of matches
+		IF count != r.matches THEN RAISE WARNING 'unexpected number of results % for %', count, r; END IF;
+	END LOOP;
+
+	RESET enable_seqscan;
+	RESET enable_bitmapscan;
+END;
+$x$;
+
+SELECT brin_bloom_check();
+
+-- bloom filters only support equality
+SET enable_seqscan = off;
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM brintest_bloom WHERE int4col = 800;
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM brintest_bloom WHERE int4col < 800;
+
+RESET enable_seqscan;
+
+-- an unsummarized range must be returned whole by the bitmap scan
+
+SELECT brin_desummarize_range('brinidx_bloom', 0);
+
+SELECT brin_bloom_check();
+
+SELECT brin_summarize_range('brinidx_bloom', 0);
+
+SELECT brin_summarize_range('brinidx_bloom', 0); -- nothing: already summarized
+
+SELECT brin_summarize_new_values('brinidx_bloom'); -- no change expected
+
+SELECT brin_bloom_check();
+
+-- the filters must still work when each one covers more rows
+DROP INDEX brinidx_bloom;
+CREATE INDEX brinidx_bloom ON brintest_bloom USING brin (
+	int2col int2_bloom_ops,
+	int4col int4_bloom_ops,
+	int8col int8_bloom_ops,
+	textcol text_bloom_ops,
+	datecol date_bloom_ops,
+	timestampcol timestamp_bloom_ops,
+	timestamptzcol timestamptz_bloom_ops,
+	uuidcol uuid_bloom_ops
+) WITH (pages_per_range = 16);
+
+SELECT brin_bloom_check();
+
+-- invalid index definitions
+
+CREATE INDEX brinidx_bloom_bad ON brintest_bloom USING brin (int4col int4_bloom_ops) WITH (pages_per_range = 0);
+
+CREATE INDEX brinidx_bloom_bad ON brintest_bloom USING brin (int4col int4_bloom_ops) WITH (n_distinct_per_range = 100);
+
+CREATE INDEX brinidx_bloom_bad ON brintest_bloom USING brin (textcol int4_bloom_ops);
+
+DROP FUNCTION brin_bloom_check();
+DROP TABLE brinopers_bloom;
+DROP TABLE brintest_bloom;
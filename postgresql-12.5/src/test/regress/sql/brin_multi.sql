@@ -0,0 +1,223 @@
+CREATE TABLE brintest_multi (int2col smallint,
+	int4col integer,
+	int8col bigint,
+	float4col real,
+	float8col double precision,
+	datecol date,
+	timestampcol timestamp without time zone,
+	timestamptzcol timestamp with time zone
+) WITH (fillfactor=10, autovacuum_enabled=off);
+
+INSERT INTO brintest_multi SELECT
+	thousand,
+	twothousand,
+	142857 * tenthous,
+	(four + 1.0)/(hundred+1),
+	odd::float8 / (tenthous + 1),
+	date '1995-08-15' + tenthous,
+	timestamp '1942-07-23 03:05:09' + tenthous * interval '36.38 hours',
+	timestamptz '1972-10-10 03:00' + thousand * interval '1 hour'
+FROM tenk1 ORDER BY unique2 LIMIT 100;
+
+-- throw in some NULL's
+INSERT INTO brintest_multi (int2col) SELECT NULL FROM tenk1 LIMIT 25;
+
+CREATE INDEX brinidx_multi ON brintest_multi USING brin (
+	int2col int2_minmax_multi_ops,
+	int4col int4_minmax_multi_ops,
+	int8col int8_minmax_multi_ops,
+	float4col float4_minmax_multi_ops,
+	float8col float8_minmax_multi_ops,
+	datecol date_minmax_multi_ops,
+	timestampcol timestamp_minmax_multi_ops,
+	timestamptzcol timestamptz_minmax_multi_ops
+) WITH (pages_per_range = 1);
+CREATE TABLE brinopers_multi (colname name, typ text,
+	op text[], value text[], matches int[],
+	check (cardinality(op) = cardinality(value)),
+	check (cardinality(op) = cardinality(matches)));
+INSERT INTO brinopers_multi VALUES
+	('int2col', 'int2',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 800, 999, 999}',
+	 '{100, 100, 1, 100, 100}'),
+	('int2col', 'int4',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 800, 999, 1999}',
+	 '{100, 100, 1, 100, 100}'),
+	('int2col', 'int8',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 800, 999, 1428427143}',
+	 '{100, 100, 1, 100, 100}'),
+	('int4col', 'int2',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 800, 1999, 1999}',
+	 '{100, 100, 1, 100, 100}'),
+	('int4col', 'int4',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 800, 1999, 1999}',
+	 '{100, 100, 1, 100, 100}'),
+	('int4col', 'int8',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 800, 1999, 1428427143}',
+	 '{100, 100, 1, 100, 100}'),
+	('int8col', 'int8',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 1257141600, 1428427143, 1428427143}',
+	 '{100, 100, 1, 100, 100}'),
+	('float4col', 'float4',
+	 '{>, >=, =, <=, <}',
+	 '{0.0103093, 0.0103093, 1, 1, 1}',
+	 '{100, 100, 4, 100, 96}'),
+	('float4col', 'float8',
+	 '{>, >=, =, <=, <}',
+	 '{0.0103093, 0.0103093, 1, 1, 1}',
+	 '{100, 100, 4, 100, 96}'),
+	('float8col', 'float4',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 0, 1.98, 1.98}',
+	 '{99, 100, 1, 100, 100}'),
+	('float8col', 'float8',
+	 '{>, >=, =, <=, <}',
+	 '{0, 0, 0, 1.98, 1.98}',
+	 '{99, 100, 1, 100, 100}'),
+	('datecol', 'date',
+	 '{>, >=, =, <=, <}',
+	 '{1995-08-15, 1995-08-15, 2009-12-01, 2022-12-30, 2022-12-30}',
+	 '{100, 100, 1, 100, 100}'),
+	('timestampcol', 'timestamp',
+	 '{>, >=, =, <=, <}',
+	 '{1942-07-23 03:05:09, 1942-07-23 03:05:09, 1964-03-24 19:26:45, 1984-01-20 22:42:21, 1984-01-20 22:42:21}',
+	 '{100, 100, 1, 100, 100}'),
+	('timestampcol', 'timestamptz',
+	 '{>, >=, =, <=, <}',
+	 '{1942-07-23 03:05:09, 1942-07-23 03:05:09, 1964-03-24 19:26:45, 1984-01-20 22:42:21, 1984-01-20 22:42:21}',
+	 '{100, 100, 1, 100, 100}'),
+	('timestamptzcol', 'timestamptz',
+	 '{>, >=, =, <=, <}',
+	 '{1972-10-10 03:00:00-04, 1972-10-10 03:00:00-04, 1972-10-19 09:00:00-07, 1972-11-20 19:00:00-03, 1972-11-20 19:00:00-03}',
+	 '{100, 100, 1, 100, 100}');
+-- compare bitmap scans on the minmax-multi index with seqscans of the heap
+
+CREATE FUNCTION brin_multi_check() RETURNS void LANGUAGE plpgsql AS $x$
+DECLARE
+	r record;
+	cond text;
+	idx_ctids tid[];
+	ss_ctids tid[];
+	count int;
+	plan_ok bool;
+	plan_line text;
+BEGIN
+	FOR r IN SELECT colname, oper, typ, value[ordinality], matches[ordinality] FROM brinopers_multi, unnest(op) WITH ORDINALITY AS oper LOOP
+
+		cond := format('%I %s %L::%s', r.colname, r.oper, r.value, r.typ);
+
+		-- run the query using the brin index
+		SET enable_seqscan = 0;
+		SET enable_bitmapscan = 1;
+
+		plan_ok := false;
+		FOR plan_line IN EXECUTE format($y$EXPLAIN SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond) LOOP
+			IF plan_line LIKE '%Bitmap Heap Scan on brintest_multi%' THEN
+				plan_ok := true;
+			END IF;
+		END LOOP;
+		IF NOT plan_ok THEN
+			RAISE WARNING 'did not get bitmap indexscan plan for %', r;
+		END IF;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond)
+			INTO idx_ctids;
+
+		-- run the query using a seqscan
+		SET enable_seqscan = 1;
+		SET enable_bitmapscan = 0;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond)
+			INTO ss_ctids;
+
+		-- make sure both return the same results
+		count := array_length(idx_ctids, 1);
+
+		IF NOT (count = array_length(ss_ctids, 1) AND
+				idx_ctids @> ss_ctids AND
+				idx_ctids <@ ss_ctids) THEN
+			RAISE WARNING 'something not right in %: count %', r, count;
+		END IF;
+
+		-- make sure we found expected number of matches
+		IF count != r.matches THEN RAISE WARNING 'unexpected number of results % for %', count, r; END IF;
+	END LOOP;
+
+	RESET enable_seqscan;
+	RESET enable_bitmapscan;
+END;
+$x$;
+
+SELECT brin_multi_check();
+
+-- an unsummarized range must be returned whole by the bitmap scan
+
+SELECT brin_desummarize_range('brinidx_multi', 0);
+
+SELECT brin_multi_check();
+
+SELECT brin_summarize_range('brinidx_multi', 0);
+
+SELECT brin_summarize_range('brinidx_multi', 0); -- nothing: already summarized
+
+SELECT brin_summarize_new_values('brinidx_multi'); -- no change expected
+
+SELECT brin_multi_check();
+
+-- ranges holding more values than the summary can keep get merged
+DROP INDEX brinidx_multi;
+CREATE INDEX brinidx_multi ON brintest_multi USING brin (
+	int2col int2_minmax_multi_ops,
+	int4col int4_minmax_multi_ops,
+	int8col int8_minmax_multi_ops,
+	float4col float4_minmax_multi_ops,
+	float8col float8_minmax_multi_ops,
+	datecol date_minmax_multi_ops,
+	timestampcol timestamp_minmax_multi_ops,
+	timestamptzcol timestamptz_minmax_multi_ops
+) WITH (pages_per_range = 16);
+
+SELECT brin_multi_check();
+
+-- a few outliers in otherwise sequential data must not widen the whole
+-- range the way a plain minmax summary would
+CREATE TABLE brin_multi_outliers (a int) WITH (fillfactor=10, autovacuum_enabled=off);
+INSERT INTO brin_multi_outliers
+	SELECT CASE WHEN i % 50 = 0 THEN 1000000 + i ELSE i END
+	FROM generate_series(1, 1000) i;
+CREATE INDEX brin_multi_outliers_idx ON brin_multi_outliers
+	USING brin (a int4_minmax_multi_ops) WITH (pages_per_range = 4);
+SET enable_seqscan = off;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM brin_multi_outliers WHERE a BETWEEN 500 AND 510;
+
+SELECT count(*) FROM brin_multi_outliers WHERE a BETWEEN 500 AND 510;
+
+SELECT count(*) FROM brin_multi_outliers WHERE a > 1000000;
+
+SELECT count(*) FROM brin_multi_outliers WHERE a = 1000500;
+
+SELECT count(*) FROM brin_multi_outliers WHERE a BETWEEN 1001 AND 999999;
+
+RESET enable_seqscan;
+
+-- invalid index definitions
+
+CREATE INDEX brinidx_multi_bad ON brintest_multi USING brin (int4col int4_minmax_multi_ops) WITH (pages_per_range = 0);
+
+CREATE INDEX brinidx_multi_bad ON brintest_multi USING brin (int4col int4_minmax_multi_ops) WITH (values_per_range = 16);
+
+CREATE INDEX brinidx_multi_bad ON brintest_multi USING brin (int4col float8_minmax_multi_ops);
+
+DROP FUNCTION brin_multi_check();
+DROP TABLE brinopers_multi;
+DROP TABLE brintest_multi;
+DROP TABLE brin_multi_outliers;
@@ -160,3 +160,99 @@ VACUUM delete_test_table;
 -- The vacuum above should've turned the leaf page into a fast root. We just
 -- need to insert some rows to cause the fast root page to split.
 INSERT INTO delete_test_table SELECT i, 1, 2, 3 FROM generate_series(1,1000) i;
+
+--
+-- Test skip scans, which use an index without quals on its leading column
+--
+create table btree_skip (a int, b int);
+insert into btree_skip select a, b from generate_series(1, 5) a, generate_series(1, 1000) b;
+insert into btree_skip select null, b from generate_series(1, 10) b;
+create index btree_skip_idx on btree_skip (a, b);
+vacuum analyze btree_skip;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select a, b from btree_skip where b = 7 order by a, b;
+select a, b from btree_skip where b >= 999 order by a desc, b desc;
+select count(*), sum(a) from btree_skip where b between 100 and 199;
+select count(*) from btree_skip where b = 1 and b = 2;
+select a, b from btree_skip where b is null;
+begin;
+declare c scroll cursor for select a, b from btree_skip where b = 500 order by a, b;
+fetch 2 from c;
+fetch backward 1 from c;
+fetch all from c;
+fetch backward all from c;
+commit;
+-- descending leading column, NULLs first
+drop index btree_skip_idx;
+create index btree_skip_idx on btree_skip (a desc, b);
+select a, b from btree_skip where b = 7 order by a desc, b;
+select a, b from btree_skip where b < 3 order by a nulls last, b desc;
+-- many distinct leading values, so the scan falls back to plain scanning
+create table btree_skip_dense (a int, b int);
+insert into btree_skip_dense select i, i % 10 from generate_series(1, 10000) i;
+create index btree_skip_dense_idx on btree_skip_dense (a, b);
+vacuum analyze btree_skip_dense;
+select count(*), sum(a) from btree_skip_dense where b = 3;
+select a from btree_skip_dense where b = 3 order by a desc limit 3;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_skip;
+drop table btree_skip_dense;
+
+--
+-- Updates that change the key of only some indexes stay on the heap page;
+-- the stale entries in the other indexes must not produce matches
+--
+create table btree_warm (a int, b int, c text) with (fillfactor = 50);
+insert into btree_warm select i, i, 'x' from generate_series(1, 100) i;
+create index btree_warm_a_idx on btree_warm (a);
+create index btree_warm_b_idx on btree_warm (b);
+update btree_warm set b = b + 1000 where a <= 10;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select a, b from btree_warm where b = 5;
+select a, b from btree_warm where b = 1005;
+select a, b from btree_warm where a = 5;
+select count(*) from btree_warm where b < 20;
+set enable_indexscan = off;
+set enable_bitmapscan = on;
+select count(*) from btree_warm where b < 20;
+select count(*) from btree_warm where b > 1000;
+reset enable_seqscan;
+reset enable_indexscan;
+reset enable_bitmapscan;
+drop table btree_warm;
+
+--
+-- Deduplication of heavily duplicated keys, with deletions and reuse of the
+-- freed heap space
+--
+create table btree_dedup (id int, a int, b text);
+create index btree_dedup_a_idx on btree_dedup (a);
+create index btree_dedup_b_idx on btree_dedup (b) with (deduplicate_items = off);
+insert into btree_dedup select i, i % 10, 'key ' || (i % 3) from generate_series(1, 20000) i;
+delete from btree_dedup where id % 7 = 0 or a = 3;
+vacuum btree_dedup;
+insert into btree_dedup select i, i % 10, 'key ' || (i % 3) from generate_series(20001, 25000) i;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select count(*), sum(id) from btree_dedup where a = 5;
+select count(*), sum(id) from btree_dedup where a = 3;
+select count(*), sum(id) from btree_dedup where b = 'key 1';
+set enable_indexscan = off;
+set enable_bitmapscan = on;
+select count(*), sum(id) from btree_dedup where a between 4 and 6;
+select count(*), sum(id) from btree_dedup where b = 'key 1';
+reset enable_indexscan;
+-- unique indexes deduplicate the versions of a row left by non-HOT updates
+create unique index btree_dedup_id_idx on btree_dedup (id);
+update btree_dedup set b = 'updated' where id <= 100;
+update btree_dedup set b = 'key 0' where id <= 100;
+set enable_bitmapscan = off;
+select count(*), sum(id) from btree_dedup where id <= 100;
+select count(*) from btree_dedup where b = 'key 0' and id <= 100;
+insert into btree_dedup values (1, 1, 'key 1');
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_dedup;
@@ -0,0 +1,60 @@
+-- test TOAST compression methods
+-- lz4 is only available if the server was built with it; compression_1.out
+-- is the expected output otherwise
+
+-- ensure we get stable results regardless of installation's default
+SET default_toast_compression = 'pglz';
+
+-- per-column compression method
+CREATE TABLE cmdata (f1 text);
+ALTER TABLE cmdata ALTER COLUMN f1 SET (compression = pglz);
+INSERT INTO cmdata VALUES (repeat('1234567890', 1000));
+SELECT pg_column_compression(f1) FROM cmdata;
+
+CREATE TABLE cmdata1 (f1 text);
+ALTER TABLE cmdata1 ALTER COLUMN f1 SET (compression = lz4);
+INSERT INTO cmdata1 VALUES (repeat('1234567890', 1004));
+SELECT pg_column_compression(f1) FROM cmdata1;
+ALTER TABLE cmdata1 ALTER COLUMN f1 SET (compression = zstd);
+
+-- only compressed values have a method
+SELECT pg_column_compression('abc'::text), pg_column_compression(42);
+
+-- decompression of whole values and of slices
+SELECT length(f1), substr(f1, 200, 5) FROM cmdata;
+SELECT length(f1), substr(f1, 2000, 5) FROM cmdata1;
+
+-- externally stored compressed values
+CREATE FUNCTION large_val() RETURNS text LANGUAGE sql AS
+'select array_agg(md5(g::text))::text from generate_series(1, 256) g';
+INSERT INTO cmdata SELECT large_val() || repeat('a', 4000);
+INSERT INTO cmdata1 SELECT large_val() || repeat('a', 4000);
+SELECT pg_column_compression(f1), length(f1), substr(f1, 10000, 5)
+  FROM cmdata ORDER BY 2;
+SELECT pg_column_compression(f1), length(f1), substr(f1, 10000, 5)
+  FROM cmdata1 ORDER BY 2;
+
+-- changing the method only affects new values
+ALTER TABLE cmdata1 ALTER COLUMN f1 RESET (compression);
+INSERT INTO cmdata1 VALUES (repeat('123456789', 1004));
+SELECT pg_column_compression(f1), length(f1) FROM cmdata1 ORDER BY 2;
+
+-- values copied from another table keep their method
+CREATE TABLE cmmove (f1 text);
+ALTER TABLE cmmove ALTER COLUMN f1 SET (compression = pglz);
+INSERT INTO cmmove SELECT f1 FROM cmdata1;
+SELECT pg_column_compression(f1), length(f1) FROM cmmove ORDER BY 2;
+SELECT count(*) FROM cmmove m JOIN cmdata1 d ON m.f1 = d.f1;
+
+-- default_toast_compression applies to columns without the option
+SET default_toast_compression = 'lz4';
+CREATE TABLE cmdata2 (f1 text);
+INSERT INTO cmdata2 VALUES (repeat('1234567890', 1000));
+ALTER TABLE cmdata2 ALTER COLUMN f1 SET (compression = pglz);
+INSERT INTO cmdata2 VALUES (repeat('123456789', 1000));
+SELECT pg_column_compression(f1), length(f1) FROM cmdata2 ORDER BY 2;
+SET default_toast_compression = 'I do not exist';
+RESET default_toast_compression;
+
+DROP TABLE cmdata, cmdata1, cmdata2, cmmove;
+DROP FUNCTION large_val();
@@ -440,6 +440,163 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- PARALLEL option
+CREATE TABLE pcopy_serial (a int, b text, c numeric DEFAULT 1.5, d date);
+CREATE TABLE pcopy_parallel (LIKE pcopy_serial INCLUDING DEFAULTS);
+CREATE INDEX ON pcopy_parallel (a);
+COPY pcopy_parallel TO stdout (PARALLEL 2);
+COPY pcopy_parallel FROM stdin (FORMAT binary, PARALLEL 2);
+COPY pcopy_parallel FROM stdin (PARALLEL -1);
+COPY pcopy_parallel FROM stdin (PARALLEL 2000);
+COPY pcopy_parallel FROM stdin (PARALLEL);
+COPY pcopy_parallel FROM stdin (PARALLEL 'two');
+COPY pcopy_parallel FROM stdin (PARALLEL 1, PARALLEL 2);
+-- text format, with escapes, NULLs and a column default
+COPY pcopy_serial (a, b, d) FROM stdin;
+1	row 1	2020-01-01
+2	\N	2020-01-02
+3	tab\there	2020-01-03
+4	back\\slash	2020-01-04
+5	new\nline	2020-01-05
+6		2020-01-06
+7	row 7	\N
+8	row 8	2020-01-08
+9	row 9	2020-01-09
+10	row 10	2020-01-10
+11	row 11	2020-01-11
+12	row 12	2020-01-12
+13	row 13	2020-01-13
+14	row 14	\N
+15	row 15	2020-01-15
+16	row 16	2020-01-16
+17	row 17	2020-01-17
+18	row 18	2020-01-18
+19	row 19	2020-01-19
+20	row 20	2020-01-20
+\.
+
+COPY pcopy_parallel (a, b, d) FROM stdin (PARALLEL 2);
+1	row 1	2020-01-01
+2	\N	2020-01-02
+3	tab\there	2020-01-03
+4	back\\slash	2020-01-04
+5	new\nline	2020-01-05
+6		2020-01-06
+7	row 7	\N
+8	row 8	2020-01-08
+9	row 9	2020-01-09
+10	row 10	2020-01-10
+11	row 11	2020-01-11
+12	row 12	2020-01-12
+13	row 13	2020-01-13
+14	row 14	\N
+15	row 15	2020-01-15
+16	row 16	2020-01-16
+17	row 17	2020-01-17
+18	row 18	2020-01-18
+19	row 19	2020-01-19
+20	row 20	2020-01-20
+\.
+
+-- CSV, including a quoted value that spans two lines
+COPY pcopy_serial FROM stdin (FORMAT csv);
+21,"multi
+line",2.5,2020-02-01
+22,"quote "" inside",,2020-02-02
+23,,3.5,
+\.
+
+COPY pcopy_parallel FROM stdin (FORMAT csv, PARALLEL 2);
+21,"multi
+line",2.5,2020-02-01
+22,"quote "" inside",,2020-02-02
+23,,3.5,
+\.
+
+-- WHERE clause
+COPY pcopy_serial (a, b, d) FROM stdin WHERE a % 2 = 0;
+1	row 1	2020-01-01
+2	\N	2020-01-02
+3	tab\there	2020-01-03
+4	back\\slash	2020-01-04
+5	new\nline	2020-01-05
+6		2020-01-06
+7	row 7	\N
+8	row 8	2020-01-08
+9	row 9	2020-01-09
+10	row 10	2020-01-10
+11	row 11	2020-01-11
+12	row 12	2020-01-12
+13	row 13	2020-01-13
+14	row 14	\N
+15	row 15	2020-01-15
+16	row 16	2020-01-16
+17	row 17	2020-01-17
+18	row 18	2020-01-18
+19	row 19	2020-01-19
+20	row 20	2020-01-20
+\.
+
+COPY pcopy_parallel (a, b, d) FROM stdin (PARALLEL 2) WHERE a % 2 = 0;
+1	row 1	2020-01-01
+2	\N	2020-01-02
+3	tab\there	2020-01-03
+4	back\\slash	2020-01-04
+5	new\nline	2020-01-05
+6		2020-01-06
+7	row 7	\N
+8	row 8	2020-01-08
+9	row 9	2020-01-09
+10	row 10	2020-01-10
+11	row 11	2020-01-11
+12	row 12	2020-01-12
+13	row 13	2020-01-13
+14	row 14	\N
+15	row 15	2020-01-15
+16	row 16	2020-01-16
+17	row 17	2020-01-17
+18	row 18	2020-01-18
+19	row 19	2020-01-19
+20	row 20	2020-01-20
+\.
+
+SELECT count(*) FROM pcopy_parallel;
+SELECT count(*) FROM
+  ((SELECT * FROM pcopy_serial EXCEPT ALL SELECT * FROM pcopy_parallel)
+   UNION ALL
+   (SELECT * FROM pcopy_parallel EXCEPT ALL SELECT * FROM pcopy_serial)) s;
+SET enable_seqscan = off;
+SELECT count(*) FROM pcopy_parallel WHERE a > 0;
+RESET enable_seqscan;
+-- tables with triggers are loaded serially, so the triggers see every row
+CREATE TABLE pcopy_trig (a int, b text);
+CREATE FUNCTION pcopy_trig_func() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+  NEW.b := upper(NEW.b);
+  RETURN NEW;
+END;
+$$;
+CREATE TRIGGER pcopy_trig BEFORE INSERT ON pcopy_trig
+  FOR EACH ROW EXECUTE PROCEDURE pcopy_trig_func();
+COPY pcopy_trig FROM stdin (PARALLEL 2);
+1	one
+2	two
+3	three
+\.
+
+SELECT * FROM pcopy_trig ORDER BY a;
+-- so are temporary tables, which workers can't access
+CREATE TEMP TABLE pcopy_temp (a int);
+COPY pcopy_temp FROM stdin (PARALLEL 2);
+1
+2
+3
+\.
+
+SELECT count(*), sum(a) FROM pcopy_temp;
+DROP TABLE pcopy_serial, pcopy_parallel, pcopy_trig, pcopy_temp;
+DROP FUNCTION pcopy_trig_func();
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -210,6 +210,40 @@ CREATE TABLE i_am_a_failure() USING i_do_not_exist_am;
 CREATE TABLE i_am_a_failure() USING "I do not exist AM";
 CREATE TABLE i_am_a_failure() USING "btree";
 
+-- Fourth, the built-in columnar AM
+SET columnar_stripe_row_limit = 1000;
+CREATE TABLE columnar_tbl (a int, b text) USING columnar;
+INSERT INTO columnar_tbl SELECT g, 'row ' || g FROM generate_series(1, 5000) g;
+SELECT count(*), sum(a), max(b) FROM columnar_tbl;
+SELECT * FROM columnar_tbl WHERE a = 2500;
+VACUUM columnar_tbl;
+SELECT count(*) FROM columnar_tbl WHERE a > 4990;
+UPDATE columnar_tbl SET a = 0;
+DELETE FROM columnar_tbl;
+CREATE INDEX ON columnar_tbl (a);
+DROP TABLE columnar_tbl;
+RESET columnar_stripe_row_limit;
+
+-- Fifth, the built-in inplace AM
+CREATE TABLE inplace_tbl (id int PRIMARY KEY, n int) USING inplace;
+INSERT INTO inplace_tbl SELECT g, 0 FROM generate_series(1, 10) g;
+UPDATE inplace_tbl SET n = n + 1 WHERE id = 3;
+UPDATE inplace_tbl SET n = n + 1 WHERE id = 3;
+UPDATE inplace_tbl SET n = n + 1 WHERE id = 3;
+-- the row keeps its TID
+SELECT ctid, n FROM inplace_tbl WHERE id = 3;
+BEGIN;
+UPDATE inplace_tbl SET n = 100 WHERE id = 3;
+SELECT n FROM inplace_tbl WHERE id = 3;
+ROLLBACK;
+SELECT n FROM inplace_tbl WHERE id = 3;
+-- changing an indexed column is a regular update
+UPDATE inplace_tbl SET id = 11 WHERE id = 10;
+SELECT count(*), sum(id), sum(n) FROM inplace_tbl;
+VACUUM inplace_tbl;
+SELECT count(*), sum(id), sum(n) FROM inplace_tbl;
+DROP TABLE inplace_tbl;
+
 -- Drop table access method, which fails as objects depends on it
 DROP ACCESS METHOD heap2;
 
@@ -34,3 +34,11 @@ SELECT current_schema;
 SET search_path = 'pg_catalog';
 SELECT current_schema;
 RESET search_path;
+
+--
+-- Tests for ScalarArrayOpExpr with a hashed const array
+--
+select x, x = any (array[1,2,3,4,5,6,7,8,9,10]) from (values (1), (11), (null)) v(x);
+select x, x = any (array[1,2,3,4,5,6,7,8,9,10,null]) from (values (1), (11), (null)) v(x);
+select x, x = any (array['a','b','c','d','e','f','g','h','i','j']) from (values ('b'), ('z')) v(x);
+select x, x <> all (array[1,2,3,4,5,6,7,8,9,10]) from (values (1), (11)) v(x);
@@ -0,0 +1,44 @@
+--
+-- INCREMENTAL SORT
+--
+-- The table is physically ordered by "a", with a permutation of 0..9 in "b"
+-- within each group of ten rows with equal "a".
+create table incsort_tbl (a int, b int);
+insert into incsort_tbl select i / 10, (i * 3) % 10 from generate_series(0, 9999) i;
+create index incsort_tbl_a_idx on incsort_tbl (a);
+analyze incsort_tbl;
+-- without incremental sort, an index on a prefix of the ordering is useless
+explain (costs off)
+select a, b from incsort_tbl order by a, b limit 12;
+set enable_incremental_sort = on;
+explain (costs off)
+select a, b from incsort_tbl order by a, b limit 12;
+select a, b from incsort_tbl order by a, b limit 12;
+create function explain_incsort(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        ln := regexp_replace(ln, 'Memory: \d+', 'Memory: N');
+        return next ln;
+    end loop;
+end;
+$$;
+-- the bound is passed down, so only the groups needed for it are read: the
+-- first batch holds the groups a = 0..3, the second one a = 4
+select explain_incsort('select a, b from incsort_tbl order by a, b limit 45');
+select count(*) filter (where a * 10 + b = n - 1) as in_order, count(*)
+from (select a, b, row_number() over () as n
+      from (select a, b from incsort_tbl order by a, b limit 45) s) ss;
+-- a descending presorted key comes from a backward index scan
+explain (costs off)
+select a, b from incsort_tbl order by a desc, b limit 3;
+select a, b from incsort_tbl order by a desc, b limit 3;
+reset enable_incremental_sort;
+drop function explain_incsort(text);
+drop table incsort_tbl;
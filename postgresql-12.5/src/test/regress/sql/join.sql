@@ -2077,3 +2077,302 @@ where exists (select 1 from j3
       and t1.unique1 < 1;
 
 drop table j3;
+
+--
+-- Result Cache on the inner side of parameterized nested loops
+--
+set enable_resultcache = on;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+select count(*), sum(t1.unique1) from tenk1 t1
+where exists (select 1 from tenk1 t2 where t2.unique1 = t1.twenty)
+and t1.unique1 < 1000;
+-- force cache evictions with a small cache
+set work_mem to '64kB';
+select count(*), sum(t1.unique1) from tenk1 t2
+inner join tenk1 t1 on t1.unique1 = t2.thousand;
+reset work_mem;
+reset enable_mergejoin;
+reset enable_hashjoin;
+reset enable_resultcache;
+
+--
+-- Bloom filtering of a hash join's outer SeqScan
+--
+set enable_mergejoin = off;
+set enable_nestloop = off;
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join onek o on t1.unique1 = o.unique1
+where o.unique1 < 10;
+select count(*), sum(t1.unique1) from tenk1 t1
+where t1.unique1 in (select unique1 from onek where unique1 < 10);
+-- outer tuples without a match must survive for anti joins
+select count(*) from tenk1 t1
+where not exists (select 1 from onek o
+                  where o.unique1 = t1.unique1 and o.unique1 < 10);
+reset enable_nestloop;
+reset enable_mergejoin;
+
+--
+-- Merge join re-seeking its inner index scan past runs of non-matching rows
+--
+create table mj_seek_outer (a int, b bigint);
+insert into mj_seek_outer select i * 100, i * 100 from generate_series(1, 10) i;
+create index on mj_seek_outer (a);
+create index on mj_seek_outer (b);
+-- every outer row is preceded by a run of about 100 inner rows, and the
+-- multiples of 300 have no partner at all
+create table mj_seek_inner (a int, b int);
+insert into mj_seek_inner select i, i % 7 from generate_series(1, 2000) i
+  where i % 300 <> 0;
+create index on mj_seek_inner (a);
+vacuum analyze mj_seek_outer;
+vacuum analyze mj_seek_inner;
+
+create function explain_mj_seek(text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            $1)
+    loop
+        ln := regexp_replace(ln, 'actual rows=\d+ loops=\d+', 'actual rows=N loops=N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        ln := regexp_replace(ln, 'Rows Removed by Filter: \d+', 'Rows Removed by Filter: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- anti joins always have the NOT EXISTS side as the inner one
+set enable_hashjoin = off;
+set enable_nestloop = off;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+set enable_sort = off;
+-- plain index scan on the inner side
+
+select explain_mj_seek($$
+select o.a from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.a and i.b >= 0)
+order by o.a$$);
+select o.a from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.a and i.b >= 0)
+order by o.a;
+-- index-only scan on the inner side
+select explain_mj_seek($$
+select o.a from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.a)
+order by o.a$$);
+select o.a from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.a)
+order by o.a;
+-- the merge join is rescanned for each outer row of the nestloop; the
+-- seek key added to the inner scan must not survive the rescan
+select explain_mj_seek($$
+select v.x, s.n from (values (1), (6)) v(x),
+  lateral (select count(*) as n from mj_seek_outer o
+           where o.a > v.x * 100
+             and not exists (select 1 from mj_seek_inner i where i.a = o.a)) s$$);
+select v.x, s.n from (values (1), (6)) v(x),
+  lateral (select count(*) as n from mj_seek_outer o
+           where o.a > v.x * 100
+             and not exists (select 1 from mj_seek_inner i where i.a = o.a)) s;
+-- bigint outer key against an integer index column
+select explain_mj_seek($$
+select o.b from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.b)
+order by o.b$$);
+select o.b from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.b)
+order by o.b;
+select count(*), sum(i.b) from mj_seek_outer o join mj_seek_inner i on i.a = o.a;
+reset enable_sort;
+reset enable_bitmapscan;
+reset enable_seqscan;
+reset enable_nestloop;
+reset enable_hashjoin;
+-- the same queries must give the same answers as a hash join
+set enable_mergejoin = off;
+
+select o.a from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.a and i.b >= 0)
+order by o.a;
+select o.a from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.a)
+order by o.a;
+select v.x, s.n from (values (1), (6)) v(x),
+  lateral (select count(*) as n from mj_seek_outer o
+           where o.a > v.x * 100
+             and not exists (select 1 from mj_seek_inner i where i.a = o.a)) s;
+select o.b from mj_seek_outer o
+where not exists (select 1 from mj_seek_inner i where i.a = o.b)
+order by o.b;
+select count(*), sum(i.b) from mj_seek_outer o join mj_seek_inner i on i.a = o.a;
+reset enable_mergejoin;
+drop function explain_mj_seek(text);
+drop table mj_seek_outer;
+drop table mj_seek_inner;
+
+--
+-- Join order search over the join graph (enable_dphyp)
+--
+create function dphyp_check(query text, out cost_ok bool, out result_ok bool)
+language plpgsql as
+$$
+declare
+    plan json;
+    std_cost float8;
+    std_result text;
+    dphyp_cost float8;
+    dphyp_result text;
+begin
+    perform set_config('enable_dphyp', 'off', true);
+    execute 'explain (format json) ' || query into plan;
+    std_cost := (plan->0->'Plan'->>'Total Cost')::float8;
+    execute format('select string_agg(t::text, '' '' order by t::text) from (%s) t',
+                   query) into std_result;
+
+    perform set_config('enable_dphyp', 'on', true);
+    execute 'explain (format json) ' || query into plan;
+    dphyp_cost := (plan->0->'Plan'->>'Total Cost')::float8;
+    execute format('select string_agg(t::text, '' '' order by t::text) from (%s) t',
+                   query) into dphyp_result;
+
+    -- both searches are exhaustive, so neither may find a cheaper plan
+    -- (allowing for the fuzz in add_path's cost comparisons)
+    cost_ok := dphyp_cost <= std_cost * 1.01 and std_cost <= dphyp_cost * 1.01;
+    result_ok := std_result is not distinct from dphyp_result;
+end;
+$$;
+-- inner joins
+select * from dphyp_check($$
+select a.unique1, b.unique2, c.hundred from tenk1 a
+  join tenk1 b on a.unique1 = b.unique2
+  join onek c on c.unique1 = b.thousand
+  join int4_tbl d on d.f1 = c.ten
+  where a.unique1 < 50$$);
+-- outer joins restrict the join order
+select * from dphyp_check($$
+select a.f1, c.unique1, d.unique2 from int4_tbl a
+  left join (int8_tbl b join tenk1 c on c.unique1 = b.q1) on a.f1 = c.unique2
+  left join onek d on d.unique1 = a.f1$$);
+-- semijoins and antijoins
+select * from dphyp_check($$
+select o.unique1 from onek o
+  where exists (select 1 from tenk1 t where t.unique2 = o.unique1 and t.ten = 1)
+    and not exists (select 1 from int4_tbl i where i.f1 = o.unique1)
+    and o.unique1 < 100$$);
+-- a disconnected join graph falls back to the standard search
+select * from dphyp_check($$
+select a.f1, b.q1, c.unique2 from int4_tbl a, int8_tbl b, onek c
+  where c.unique1 = a.f1$$);
+-- above geqo_threshold the graph search replaces GEQO, which may not find
+-- the cheapest plan, so only check that the results agree
+set from_collapse_limit = 20;
+set join_collapse_limit = 20;
+select result_ok from dphyp_check($$
+select count(*) from onek t1
+  join onek t2 on t2.unique1 = t1.unique2
+  join onek t3 on t3.unique1 = t2.unique2
+  join onek t4 on t4.unique1 = t3.unique2
+  join onek t5 on t5.unique1 = t4.unique2
+  join onek t6 on t6.unique1 = t5.unique2
+  join onek t7 on t7.unique1 = t6.unique2
+  join onek t8 on t8.unique1 = t7.unique2
+  join onek t9 on t9.unique1 = t8.unique2
+  join onek t10 on t10.unique1 = t9.unique2
+  join onek t11 on t11.unique1 = t10.unique2
+  join onek t12 on t12.unique1 = t11.unique2
+  join onek t13 on t13.unique1 = t12.unique2
+  where t1.unique1 < 10$$);
+-- more join pairs than dphyp_limit fall back to GEQO
+set dphyp_limit = 10;
+select result_ok from dphyp_check($$
+select count(*) from onek t1
+  join onek t2 on t2.unique1 = t1.unique2
+  join onek t3 on t3.unique1 = t2.unique2
+  join onek t4 on t4.unique1 = t3.unique2
+  join onek t5 on t5.unique1 = t4.unique2
+  join onek t6 on t6.unique1 = t5.unique2
+  join onek t7 on t7.unique1 = t6.unique2
+  join onek t8 on t8.unique1 = t7.unique2
+  join onek t9 on t9.unique1 = t8.unique2
+  join onek t10 on t10.unique1 = t9.unique2
+  join onek t11 on t11.unique1 = t10.unique2
+  join onek t12 on t12.unique1 = t11.unique2
+  join onek t13 on t13.unique1 = t12.unique2
+  where t1.unique1 < 10$$);
+reset dphyp_limit;
+reset join_collapse_limit;
+reset from_collapse_limit;
+drop function dphyp_check(text);
+--
+-- Nested loops switching to a hashed inner side (adaptive_nestloop_factor)
+--
+-- a set-returning function the planner thinks returns one row
+create function nl_outer(n int) returns setof int
+language plpgsql rows 1 as
+$$
+begin
+    return query select generate_series(1, n);
+end;
+$$;
+create function explain_nestloop(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        return next ln;
+    end loop;
+end;
+$$;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set enable_indexscan = off;
+set enable_bitmapscan = off;
+set enable_material = off;
+select count(*), count(i.unique1), sum(i.unique1),
+       count(*) filter (where i.ten = o.x % 10) as same_row
+from nl_outer(1000) o(x) left join onek i on i.unique1 = o.x;
+-- once the outer side has returned 10 times its estimated rows, the inner
+-- side is hashed and no longer rescanned
+set adaptive_nestloop_factor = 10;
+select explain_nestloop($$
+select count(*), count(i.unique1), sum(i.unique1),
+       count(*) filter (where i.ten = o.x % 10) as same_row
+from nl_outer(1000) o(x) left join onek i on i.unique1 = o.x$$);
+select count(*), count(i.unique1), sum(i.unique1),
+       count(*) filter (where i.ten = o.x % 10) as same_row
+from nl_outer(1000) o(x) left join onek i on i.unique1 = o.x;
+-- an inner side that doesn't fit in work_mem keeps being rescanned
+set work_mem = '64kB';
+select ln from explain_nestloop($$
+select count(*), count(i.unique1), sum(i.unique1),
+       count(*) filter (where i.ten = o.x % 10) as same_row
+from nl_outer(1000) o(x) left join onek i on i.unique1 = o.x$$) ln
+where ln like '%Inner Hashed%';
+select count(*), count(i.unique1), sum(i.unique1),
+       count(*) filter (where i.ten = o.x % 10) as same_row
+from nl_outer(1000) o(x) left join onek i on i.unique1 = o.x;
+reset work_mem;
+reset adaptive_nestloop_factor;
+reset enable_hashjoin;
+reset enable_mergejoin;
+reset enable_indexscan;
+reset enable_bitmapscan;
+reset enable_material;
+drop function explain_nestloop(text);
+drop function nl_outer(int);
@@ -1043,3 +1043,73 @@ select scale(-13.000000000000000);
 -- cases that need carry propagation
 SELECT SUM(9999::numeric) FROM generate_series(1, 100000);
 SELECT SUM((-9999)::numeric) FROM generate_series(1, 100000);
+
+--
+-- Tests for values around the limits of the 64- and 128-bit arithmetic
+-- used for numerics that are small once scaled by their display scale
+--
+
+-- addition, subtraction and multiplication near 10^18, with mixed scales
+SELECT x, y, x + y AS add, x - y AS sub, x * y AS mul
+FROM (VALUES (999999999999999999, 1),
+             (999999999999999999, -1),
+             (-999999999999999999, -1),
+             (99999999999999999, 1),
+             (9999999999999999, 1),
+             (1000000000000000000, -1),
+             (9999999999999999.99, 0.01),
+             (-9999999999999999.99, -0.01),
+             (99999999.99, 99999999.99),
+             (-0.01, 0.01),
+             (0.00, -0.000),
+             (-12.34, 5.678),
+             (1.5, 0.00000000000000001),
+             (1.5, 0.000000000000000001),
+             (-123456789.123456789, 0.000000001),
+             (0.000000001, -0.000000001),
+             (3162277660168379, 31622776601683793),
+             (99999999999999999, 999999999999999999),
+             (999999999999999999, 999999999999999999),
+             (-999999999999999999, 999999999999999999)) v(x, y);
+-- SUM() and AVG() over mixed scales and signs
+SELECT sum(x), avg(x)
+FROM (VALUES (1), (0.5), (-0.25), (99999999999999.999),
+             (0.00000000000000001), (-7), (999999999999999999), (-0.000000000000000001), (12.3400)) v(x);
+SELECT sum(g * 0.01), avg(g * 0.01) FROM generate_series(1, 100000) g;
+-- a large running total, then inputs of much larger scale
+SELECT sum(x), avg(x)
+FROM (SELECT CASE WHEN g % 3 = 0 THEN -9999999999999999 ELSE 9999999999999999 END
+      FROM generate_series(1, 100000) g
+      UNION ALL SELECT 0.0000000000000001
+      UNION ALL SELECT -0.00000000000000001) v(x);
+-- moving aggregates, which remove inputs with the inverse transition function
+SELECT i, x, sum(x) OVER w, avg(x) OVER w
+FROM (VALUES (1, 1.5),
+             (2, -0.25),
+             (3, 999999999999999999),
+             (4, 0.000000000000000001),
+             (5, -3),
+             (6, -999999999999999999.99),
+             (7, 0)) v(i, x)
+WINDOW w AS (ORDER BY i ROWS BETWEEN 1 PRECEDING AND CURRENT ROW);
+-- parallel aggregation, which serializes and combines partial states
+BEGIN;
+SET LOCAL parallel_setup_cost = 0;
+SET LOCAL parallel_tuple_cost = 0;
+SET LOCAL max_parallel_workers_per_gather = 4;
+CREATE TABLE num_par (x numeric);
+ALTER TABLE num_par SET (parallel_workers = 4);
+INSERT INTO num_par
+SELECT CASE WHEN g % 1000 = 0 THEN 123456789012345678901.5
+            WHEN g % 4 = 0 THEN g * 0.01
+            WHEN g % 4 = 1 THEN -g
+            WHEN g % 4 = 2 THEN g * 0.000001
+            ELSE 999999999999.99 - g END
+FROM generate_series(1, 40000) g;
+ANALYZE num_par;
+EXPLAIN (COSTS OFF)
+SELECT sum(x), avg(x), count(x) FROM num_par;
+SELECT sum(x), avg(x), count(x) FROM num_par;
+SET LOCAL max_parallel_workers_per_gather = 0;
+SELECT sum(x), avg(x), count(x) FROM num_par;
+ROLLBACK;
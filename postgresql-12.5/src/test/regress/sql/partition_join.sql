@@ -445,8 +445,8 @@ SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_n t1 JOIN prt2_n t2 ON (t1.c = t2.c) JOI
 EXPLAIN (COSTS OFF)
 SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_n t1 FULL JOIN prt1 t2 ON (t1.c = t2.c);
 
--- partitionwise join can not be applied if only one of joining tables has
--- default partition
+-- partitionwise join can be applied even if only one of the joining tables
+-- has a default partition, by merging the partition bounds
 ALTER TABLE prt2 DETACH PARTITION prt2_p3;
 ALTER TABLE prt2 ATTACH PARTITION prt2_p3 FOR VALUES FROM (500) TO (600);
 ANALYZE prt2;
@@ -498,3 +498,237 @@ select * from prtx1
 where not exists (select 1 from prtx2
                   where prtx2.a=prtx1.a and (prtx2.b=prtx1.b+1 or prtx2.c=99))
   and a<20 and c=91;
+
+--
+-- partitionwise join with non-identical partition bounds
+--
+
+-- Count the joins that are done partition by partition, that is, join nodes
+-- that are members of an Append or MergeAppend (possibly under a Sort).
+-- Zero means the planner fell back to joining the whole relations.
+CREATE FUNCTION count_partitionwise_joins(node json, in_append bool)
+RETURNS int LANGUAGE plpgsql AS
+$$
+DECLARE
+  child json;
+  n int := 0;
+BEGIN
+  IF in_append AND
+     node->>'Node Type' IN ('Hash Join', 'Merge Join', 'Nested Loop') THEN
+    RETURN 1;
+  END IF;
+  FOR child IN SELECT json_array_elements(node->'Plans')
+  LOOP
+    n := n + count_partitionwise_joins(child,
+               node->>'Node Type' IN ('Append', 'Merge Append') OR
+               (in_append AND node->>'Node Type' = 'Sort'));
+  END LOOP;
+  RETURN n;
+END;
+$$;
+CREATE FUNCTION partitionwise_joins(query text)
+RETURNS int LANGUAGE plpgsql AS
+$$
+DECLARE
+  plan json;
+BEGIN
+  EXECUTE 'EXPLAIN (COSTS OFF, FORMAT JSON) ' || query INTO plan;
+  RETURN count_partitionwise_joins(plan->0->'Plan', false);
+END;
+$$;
+
+-- range partitioned tables whose bounds don't match exactly, but where each
+-- partition overlaps at most one partition on the other side; prt2_adv_p4
+-- has no partner at all
+CREATE TABLE prt1_adv (a int, b int, c varchar) PARTITION BY RANGE (a);
+CREATE TABLE prt1_adv_p1 PARTITION OF prt1_adv FOR VALUES FROM (100) TO (200);
+CREATE TABLE prt1_adv_p2 PARTITION OF prt1_adv FOR VALUES FROM (200) TO (300);
+CREATE TABLE prt1_adv_p3 PARTITION OF prt1_adv FOR VALUES FROM (300) TO (400);
+INSERT INTO prt1_adv SELECT i, i % 25, to_char(i, 'FM0000') FROM generate_series(100, 399) i;
+ANALYZE prt1_adv;
+CREATE TABLE prt2_adv (a int, b int, c varchar) PARTITION BY RANGE (b);
+CREATE TABLE prt2_adv_p1 PARTITION OF prt2_adv FOR VALUES FROM (100) TO (150);
+CREATE TABLE prt2_adv_p2 PARTITION OF prt2_adv FOR VALUES FROM (200) TO (300);
+CREATE TABLE prt2_adv_p3 PARTITION OF prt2_adv FOR VALUES FROM (350) TO (500);
+CREATE TABLE prt2_adv_p4 PARTITION OF prt2_adv FOR VALUES FROM (500) TO (600);
+INSERT INTO prt2_adv SELECT i % 25, i, to_char(i, 'FM0000') FROM generate_series(100, 599) i
+  WHERE i < 150 OR (i >= 200 AND i < 300) OR i >= 350;
+ANALYZE prt2_adv;
+
+-- inner join
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_adv t1 INNER JOIN prt2_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0 ORDER BY t1.a, t2.b;
+$$);
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_adv t1 INNER JOIN prt2_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0 ORDER BY t1.a, t2.b;
+
+-- left join; the unmatched prt2_adv_p4 is on the nullable side
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_adv t1 LEFT JOIN prt2_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0 ORDER BY t1.a, t2.b;
+$$);
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_adv t1 LEFT JOIN prt2_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0 ORDER BY t1.a, t2.b;
+
+-- left join; not done partitionwise, since prt2_adv_p4 would have to be
+-- joined with an empty relation
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt2_adv t2 LEFT JOIN prt1_adv t1 ON (t1.a = t2.b) WHERE t2.a = 0 ORDER BY t2.b;
+$$);
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt2_adv t2 LEFT JOIN prt1_adv t1 ON (t1.a = t2.b) WHERE t2.a = 0 ORDER BY t2.b;
+
+-- full join; not done partitionwise for the same reason
+SELECT partitionwise_joins($$
+SELECT count(*), count(t1.a), count(t2.b) FROM prt1_adv t1 FULL JOIN prt2_adv t2 ON (t1.a = t2.b);
+$$);
+SELECT count(*), count(t1.a), count(t2.b) FROM prt1_adv t1 FULL JOIN prt2_adv t2 ON (t1.a = t2.b);
+
+-- semi join
+SELECT partitionwise_joins($$
+SELECT t1.* FROM prt1_adv t1 WHERE EXISTS (SELECT 1 FROM prt2_adv t2 WHERE t1.a = t2.b) AND t1.b = 0 ORDER BY t1.a;
+$$);
+SELECT t1.* FROM prt1_adv t1 WHERE EXISTS (SELECT 1 FROM prt2_adv t2 WHERE t1.a = t2.b) AND t1.b = 0 ORDER BY t1.a;
+
+-- anti join
+SELECT partitionwise_joins($$
+SELECT t1.* FROM prt1_adv t1 WHERE NOT EXISTS (SELECT 1 FROM prt2_adv t2 WHERE t1.a = t2.b) AND t1.b = 0 ORDER BY t1.a;
+$$);
+SELECT t1.* FROM prt1_adv t1 WHERE NOT EXISTS (SELECT 1 FROM prt2_adv t2 WHERE t1.a = t2.b) AND t1.b = 0 ORDER BY t1.a;
+
+-- no partitionwise join if a partition overlaps two partitions on the
+-- other side: prt1_adv_p2 overlaps both prt3_adv_p1 and prt3_adv_p2
+CREATE TABLE prt3_adv (a int, b int) PARTITION BY RANGE (b);
+CREATE TABLE prt3_adv_p1 PARTITION OF prt3_adv FOR VALUES FROM (100) TO (250);
+CREATE TABLE prt3_adv_p2 PARTITION OF prt3_adv FOR VALUES FROM (250) TO (400);
+INSERT INTO prt3_adv SELECT i % 25, i FROM generate_series(100, 399) i;
+ANALYZE prt3_adv;
+SELECT partitionwise_joins($$
+SELECT count(*) FROM prt1_adv t1 INNER JOIN prt3_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0;
+$$);
+SELECT count(*) FROM prt1_adv t1 INNER JOIN prt3_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0;
+
+-- nor if rows from the part of prt1_adv_p1 that doesn't overlap
+-- prt2_adv_p1 could find their partners in a default partition
+CREATE TABLE prt2_adv_def PARTITION OF prt2_adv DEFAULT;
+ANALYZE prt2_adv;
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_adv t1 INNER JOIN prt2_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0 ORDER BY t1.a, t2.b;
+$$);
+SELECT t1.a, t1.c, t2.b, t2.c FROM prt1_adv t1 INNER JOIN prt2_adv t2 ON (t1.a = t2.b) WHERE t1.b = 0 ORDER BY t1.a, t2.b;
+
+-- list partitioned tables with different lists; each partition shares a
+-- value with exactly one partition on the other side
+CREATE TABLE plt1_adv (a int, b int, c text) PARTITION BY LIST (c);
+CREATE TABLE plt1_adv_p1 PARTITION OF plt1_adv FOR VALUES IN ('0001', '0003');
+CREATE TABLE plt1_adv_p2 PARTITION OF plt1_adv FOR VALUES IN ('0004', '0006');
+CREATE TABLE plt1_adv_p3 PARTITION OF plt1_adv FOR VALUES IN ('0008', '0009');
+INSERT INTO plt1_adv SELECT i, i, to_char(i % 10, 'FM0000') FROM generate_series(1, 299) i WHERE i % 10 IN (1, 3, 4, 6, 8, 9);
+ANALYZE plt1_adv;
+CREATE TABLE plt2_adv (a int, b int, c text) PARTITION BY LIST (c);
+CREATE TABLE plt2_adv_p1 PARTITION OF plt2_adv FOR VALUES IN ('0002', '0003');
+CREATE TABLE plt2_adv_p2 PARTITION OF plt2_adv FOR VALUES IN ('0004', '0006');
+CREATE TABLE plt2_adv_p3 PARTITION OF plt2_adv FOR VALUES IN ('0007', '0009');
+INSERT INTO plt2_adv SELECT i, i, to_char(i % 10, 'FM0000') FROM generate_series(1, 299) i WHERE i % 10 IN (2, 3, 4, 6, 7, 9);
+ANALYZE plt2_adv;
+
+-- inner join
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.a, t2.c FROM plt1_adv t1 INNER JOIN plt2_adv t2 ON (t1.a = t2.a AND t1.c = t2.c) WHERE t1.b < 10 ORDER BY t1.a;
+$$);
+SELECT t1.a, t1.c, t2.a, t2.c FROM plt1_adv t1 INNER JOIN plt2_adv t2 ON (t1.a = t2.a AND t1.c = t2.c) WHERE t1.b < 10 ORDER BY t1.a;
+
+-- left join
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.a, t2.c FROM plt1_adv t1 LEFT JOIN plt2_adv t2 ON (t1.a = t2.a AND t1.c = t2.c) WHERE t1.b < 10 ORDER BY t1.a;
+$$);
+SELECT t1.a, t1.c, t2.a, t2.c FROM plt1_adv t1 LEFT JOIN plt2_adv t2 ON (t1.a = t2.a AND t1.c = t2.c) WHERE t1.b < 10 ORDER BY t1.a;
+
+-- full join
+SELECT partitionwise_joins($$
+SELECT t1.a, t1.c, t2.a, t2.c FROM plt1_adv t1 FULL JOIN plt2_adv t2 ON (t1.a = t2.a AND t1.c = t2.c) WHERE coalesce(t1.b, 0) < 10 AND coalesce(t2.b, 0) < 10 ORDER BY t1.a, t2.a;
+$$);
+SELECT t1.a, t1.c, t2.a, t2.c FROM plt1_adv t1 FULL JOIN plt2_adv t2 ON (t1.a = t2.a AND t1.c = t2.c) WHERE coalesce(t1.b, 0) < 10 AND coalesce(t2.b, 0) < 10 ORDER BY t1.a, t2.a;
+
+-- semi join
+SELECT partitionwise_joins($$
+SELECT t1.* FROM plt1_adv t1 WHERE EXISTS (SELECT 1 FROM plt2_adv t2 WHERE t1.a = t2.a AND t1.c = t2.c) AND t1.b < 10 ORDER BY t1.a;
+$$);
+SELECT t1.* FROM plt1_adv t1 WHERE EXISTS (SELECT 1 FROM plt2_adv t2 WHERE t1.a = t2.a AND t1.c = t2.c) AND t1.b < 10 ORDER BY t1.a;
+
+-- anti join
+SELECT partitionwise_joins($$
+SELECT t1.* FROM plt1_adv t1 WHERE NOT EXISTS (SELECT 1 FROM plt2_adv t2 WHERE t1.a = t2.a AND t1.c = t2.c) AND t1.b < 10 ORDER BY t1.a;
+$$);
+SELECT t1.* FROM plt1_adv t1 WHERE NOT EXISTS (SELECT 1 FROM plt2_adv t2 WHERE t1.a = t2.a AND t1.c = t2.c) AND t1.b < 10 ORDER BY t1.a;
+
+-- NULL and default partitions: plt3_adv has a NULL-only partition and a
+-- default partition, plt4_adv has neither
+CREATE TABLE plt3_adv (a int, c text) PARTITION BY LIST (c);
+CREATE TABLE plt3_adv_p1 PARTITION OF plt3_adv FOR VALUES IN ('0001', '0002');
+CREATE TABLE plt3_adv_p2 PARTITION OF plt3_adv FOR VALUES IN ('0003', '0004');
+CREATE TABLE plt3_adv_null PARTITION OF plt3_adv FOR VALUES IN (NULL);
+CREATE TABLE plt3_adv_def PARTITION OF plt3_adv DEFAULT;
+INSERT INTO plt3_adv SELECT i, to_char(i % 8, 'FM0000') FROM generate_series(1, 40) i WHERE i % 3 <> 0;
+INSERT INTO plt3_adv VALUES (-1, NULL), (-2, NULL);
+ANALYZE plt3_adv;
+CREATE TABLE plt4_adv (a int, c text) PARTITION BY LIST (c);
+CREATE TABLE plt4_adv_p1 PARTITION OF plt4_adv FOR VALUES IN ('0001', '0002');
+CREATE TABLE plt4_adv_p2 PARTITION OF plt4_adv FOR VALUES IN ('0003', '0004');
+CREATE TABLE plt4_adv_p3 PARTITION OF plt4_adv FOR VALUES IN ('0006');
+INSERT INTO plt4_adv SELECT i, to_char(i % 8, 'FM0000') FROM generate_series(1, 40) i WHERE i % 8 IN (1, 2, 3, 4, 6);
+ANALYZE plt4_adv;
+
+-- inner join; plt4_adv_p3 is joined with the default partition, and the
+-- NULL partition can't contribute
+SELECT partitionwise_joins($$
+SELECT count(*), min(t1.a), max(t1.a) FROM plt3_adv t1 INNER JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*), min(t1.a), max(t1.a) FROM plt3_adv t1 INNER JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+
+-- left join; not done partitionwise, since the NULL partition on the
+-- outer side has no partner
+SELECT partitionwise_joins($$
+SELECT count(*), count(t2.a) FROM plt3_adv t1 LEFT JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*), count(t2.a) FROM plt3_adv t1 LEFT JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+
+-- left join the other way; the NULL partition is on the nullable side
+SELECT partitionwise_joins($$
+SELECT count(*), count(t1.a) FROM plt4_adv t2 LEFT JOIN plt3_adv t1 ON (t1.a = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*), count(t1.a) FROM plt4_adv t2 LEFT JOIN plt3_adv t1 ON (t1.a = t2.a AND t1.c = t2.c);
+
+-- full join; not done partitionwise
+SELECT partitionwise_joins($$
+SELECT count(*), count(t1.a), count(t2.a) FROM plt3_adv t1 FULL JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*), count(t1.a), count(t2.a) FROM plt3_adv t1 FULL JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+
+-- no partitionwise join if a partition shares values with two partitions
+-- on the other side: plt1_adv_p1 matches both plt4_adv_p1 and plt4_adv_p2
+SELECT partitionwise_joins($$
+SELECT count(*) FROM plt1_adv t1 INNER JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*) FROM plt1_adv t1 INNER JOIN plt4_adv t2 ON (t1.a = t2.a AND t1.c = t2.c);
+
+-- multiple levels of partitioning, with bounds that differ at both levels
+CREATE TABLE prt4_l (a int, b int, c varchar) PARTITION BY RANGE (b);
+CREATE TABLE prt4_l_p1 PARTITION OF prt4_l FOR VALUES FROM (0) TO (200);
+CREATE TABLE prt4_l_p2 PARTITION OF prt4_l FOR VALUES FROM (250) TO (500) PARTITION BY LIST (c);
+CREATE TABLE prt4_l_p2_p1 PARTITION OF prt4_l_p2 FOR VALUES IN ('0000', '0001');
+CREATE TABLE prt4_l_p2_p2 PARTITION OF prt4_l_p2 FOR VALUES IN ('0002');
+CREATE TABLE prt4_l_p3 PARTITION OF prt4_l FOR VALUES FROM (500) TO (550) PARTITION BY RANGE (a);
+CREATE TABLE prt4_l_p3_p1 PARTITION OF prt4_l_p3 FOR VALUES FROM (0) TO (13);
+CREATE TABLE prt4_l_p3_p2 PARTITION OF prt4_l_p3 FOR VALUES FROM (13) TO (25);
+INSERT INTO prt4_l SELECT i % 25, i, to_char(i % 4, 'FM0000') FROM generate_series(0, 549, 3) i
+  WHERE (i < 200 OR i >= 250) AND NOT (i >= 250 AND i < 500 AND i % 4 = 3);
+ANALYZE prt4_l;
+
+-- inner join, qual covering all levels
+SELECT partitionwise_joins($$
+SELECT count(*), sum(t1.a), sum(t2.b) FROM prt1_l t1 INNER JOIN prt4_l t2 ON (t1.a = t2.b AND t1.b = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*), sum(t1.a), sum(t2.b) FROM prt1_l t1 INNER JOIN prt4_l t2 ON (t1.a = t2.b AND t1.b = t2.a AND t1.c = t2.c);
+
+-- left join
+SELECT partitionwise_joins($$
+SELECT count(*), count(t2.b), sum(t1.a) FROM prt1_l t1 LEFT JOIN prt4_l t2 ON (t1.a = t2.b AND t1.b = t2.a AND t1.c = t2.c);
+$$);
+SELECT count(*), count(t2.b), sum(t1.a) FROM prt1_l t1 LEFT JOIN prt4_l t2 ON (t1.a = t2.b AND t1.b = t2.a AND t1.c = t2.c);
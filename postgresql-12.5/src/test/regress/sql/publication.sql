@@ -91,6 +91,40 @@ ALTER PUBLICATION testpub_default DROP TABLE pub_test.testpub_nopk;
 
 \d+ testpub_tbl1
 
+-- row filters and column lists
+CREATE TABLE testpub_rf_tbl1 (a int primary key, b text, c int);
+CREATE TABLE testpub_rf_tbl2 (x int, y int);
+CREATE PUBLICATION testpub_rf FOR TABLE testpub_rf_tbl1 (a, b) WHERE (a > 10 AND b <> 'x'), testpub_rf_tbl2 WHERE (y IS NOT NULL) WITH (publish = 'insert');
+\dRp+ testpub_rf
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 (c, a) WHERE (a < 100);
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_rf_tbl2 (x);
+\dRp+ testpub_rf
+-- fail - bad column lists
+ALTER PUBLICATION testpub_rf DROP TABLE testpub_rf_tbl2 (x);
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 (a, nosuchcol);
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 (a, a);
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 (a, ctid);
+-- fail - bad row filters
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 WHERE (nosuchcol > 1);
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 WHERE (a = (SELECT 1));
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 WHERE (sum(a) > 5);
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 WHERE (random() > 0.5);
+CREATE PUBLICATION testpub_rf_bad FOR TABLE testpub_rf_tbl1 WHERE (ctid IS NOT NULL);
+-- UPDATEs need the row filter and column list to match the replica identity
+ALTER PUBLICATION testpub_rf SET (publish = 'insert, update');
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (c > 0);
+INSERT INTO testpub_rf_tbl1 VALUES (1, 'one', 1);
+-- fail - the row filter uses a column outside the replica identity
+UPDATE testpub_rf_tbl1 SET b = 'uno';
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 (b, c);
+-- fail - the column list doesn't include the replica identity
+UPDATE testpub_rf_tbl1 SET b = 'uno';
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 (a, b) WHERE (a > 0);
+UPDATE testpub_rf_tbl1 SET b = 'uno';
+SELECT * FROM testpub_rf_tbl1;
+DROP PUBLICATION testpub_rf;
+DROP TABLE testpub_rf_tbl1, testpub_rf_tbl2;
+
 -- permissions
 SET ROLE regress_publication_user2;
 CREATE PUBLICATION testpub2;  -- fail
@@ -139,3 +139,48 @@ select 'a' ~ '()+\1';
 select 'xyz' ~ 'x(\w)(?=\1)';  -- no backrefs in LACONs
 select 'xyz' ~ 'x(\w)(?=(\1))';
 select 'a' ~ '\x7fffffff';  -- invalid chr code
+
+-- Tests for the required-literal prefilter used by ~ and !~
+-- an escaped ']' inside a bracket expression
+select ']' ~ '[\]a]' as t, ']' !~ '[\]a]' as f;
+select 'xa' ~ '[\]a]' as t, 'xa' !~ '[\]a]' as f;
+select 'b' ~ '[\]a]' as f, 'b' !~ '[\]a]' as t;
+select 'a]b' ~ '[\]x]b' as t, 'a]b' !~ '[\]x]b' as f;
+select 'ab' ~ '[\]x]b' as f, 'ab' !~ '[\]x]b' as t;
+
+-- bracket expressions around and between literals
+select 'xabcx' ~ 'a[bc]c' as t, 'xabcx' !~ 'a[bc]c' as f;
+select 'xabx' ~ 'a[bc]c' as f, 'xabx' !~ 'a[bc]c' as t;
+select 'x]y' ~ 'x[]]y' as t, 'x]y' !~ 'x[]]y' as f;
+select 'xy' ~ 'x[]]y' as f, 'xy' !~ 'x[]]y' as t;
+select 'abcd' ~ '[[:alpha:]]bcd' as t, 'abcd' !~ '[[:alpha:]]bcd' as f;
+select '1bcd' ~ '[[:alpha:]]bcd' as f, '1bcd' !~ '[[:alpha:]]bcd' as t;
+select 'foobar' ~ 'fo[^x]bar' as t, 'foobar' !~ 'fo[^x]bar' as f;
+select 'foxbar' ~ 'fo[^x]bar' as f, 'foxbar' !~ 'fo[^x]bar' as t;
+
+-- escapes, quantifiers and anchors
+select 'a.b' ~ 'a\.b' as t, 'a.b' !~ 'a\.b' as f;
+select 'axb' ~ 'a\.b' as f, 'axb' !~ 'a\.b' as t;
+select 'foobar' ~ 'fo+bar' as t, 'foobar' !~ 'fo+bar' as f;
+select 'fbar' ~ 'fo+bar' as f, 'fbar' !~ 'fo+bar' as t;
+select 'fbar' ~ 'fo*bar' as t, 'fbar' !~ 'fo*bar' as f;
+select 'foobar' ~ '^foo.*r$' as t, 'foobar' !~ '^foo.*r$' as f;
+select 'xfoobar' ~ '^foo.*r$' as f, 'xfoobar' !~ '^foo.*r$' as t;
+select 'abcabc' ~ '(abc){2}' as t, 'abcabc' !~ '(abc){2}' as f;
+
+-- director prefixes
+select 'foobar' ~ '***:foo' as t, 'foobar' !~ '***:foo' as f;
+select 'FOOBAR' ~ '***:foo' as f, 'FOOBAR' !~ '***:foo' as t;
+select 'xf.ox' ~ '***=f.o' as t, 'xf.ox' !~ '***=f.o' as f;
+select 'foo' ~ '***=f.o' as f, 'foo' !~ '***=f.o' as t;
+select 'FOOBAR' ~ '***:(?i)foo' as t, 'FOOBAR' !~ '***:(?i)foo' as f;
+
+-- case-insensitive matching doesn't use the prefilter
+select 'FOOBAR' ~* 'foo' as t, 'FOOBAR' !~* 'foo' as f;
+select 'FOOBAR' ~ 'foo' as f, 'FOOBAR' !~ 'foo' as t;
+
+-- the pattern changing between calls, often enough to disable the prefilter
+select p, 'foobar' ~ p as m, 'foobar' !~ p as nm
+  from (values ('foo'), ('bar'), ('baz'), ('o+b'), ('[\]o]b'), ('^foo'), ('r$'), ('fo[ab]'), ('x?oob'), ('ob.r'), ('zzz'), ('foo'), ('foo'), ('b[\]a]r')) v(p);
+select s, s ~ 'foo' as m1, s ~ '^f.*o$' as m2
+  from (values ('foobar'), ('xfoox'), ('bar'), ('fo'), ('foofoo'), ('afoo'), ('foo'), (''), ('oof')) v(s);
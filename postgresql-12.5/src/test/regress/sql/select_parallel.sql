@@ -453,4 +453,46 @@ EXPLAIN (COSTS OFF)
 SELECT 1 FROM tenk1_vw_sec
   WHERE (SELECT sum(f1) FROM int4_tbl WHERE f1 < unique1) < 100;
 
+-- window functions evaluated in parallel over repartitioned input; keep the
+-- scan non-partial so that every participant reruns it for its hash slots
+set enable_parallel_window = on;
+set min_parallel_table_scan_size = '8MB';
+explain (costs off)
+  select four, unique1,
+         row_number() over (partition by four order by unique1),
+         sum(unique1) over (partition by four)
+  from tenk1;
+select four, count(*), max(rn), count(*) filter (where rn = unique1 / 4 + 1) as in_order,
+       min(total), max(total)
+from (select four, unique1,
+             row_number() over (partition by four order by unique1) as rn,
+             sum(unique1) over (partition by four) as total
+      from tenk1) s
+group by four order by four;
+-- the leader processes all the slots if no workers can be launched
+set max_parallel_workers = 0;
+select four, count(*), max(rn), count(*) filter (where rn = unique1 / 4 + 1) as in_order,
+       min(total), max(total)
+from (select four, unique1,
+             row_number() over (partition by four order by unique1) as rn,
+             sum(unique1) over (partition by four) as total
+      from tenk1) s
+group by four order by four;
+reset max_parallel_workers;
+-- the hash key is what all the windows are partitioned by
+explain (costs off)
+  select four, ten,
+         count(*) over (partition by four, ten),
+         count(*) over (partition by four)
+  from tenk1;
+select count(*), min(c1), max(c1), min(c2), max(c2)
+from (select count(*) over (partition by four, ten) as c1,
+             count(*) over (partition by four) as c2
+      from tenk1) s;
+-- no parallel plan without a partitioning column
+explain (costs off)
+  select four, count(*) over () from tenk1;
+reset min_parallel_table_scan_size;
+reset enable_parallel_window;
+
 rollback;
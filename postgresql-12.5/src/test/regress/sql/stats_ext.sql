@@ -217,6 +217,32 @@ SELECT * FROM check_estimated_rows('SELECT COUNT(*) FROM ndistinct GROUP BY b, c
 
 SELECT * FROM check_estimated_rows('SELECT COUNT(*) FROM ndistinct GROUP BY a, d');
 
+-- ndistinct statistics on both sides of a join on correlated columns
+CREATE TABLE ndistinct_join1 (a INT, b INT);
+CREATE TABLE ndistinct_join2 (a INT, b INT);
+
+INSERT INTO ndistinct_join1 SELECT i % 10, i % 10 FROM generate_series(1, 1000) s(i);
+INSERT INTO ndistinct_join2 SELECT i % 10, i % 10 FROM generate_series(1, 1000) s(i);
+ANALYZE ndistinct_join1, ndistinct_join2;
+
+-- without statistics, the join clauses are assumed to be independent
+SELECT * FROM check_estimated_rows('SELECT * FROM ndistinct_join1 j1 JOIN ndistinct_join2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+CREATE STATISTICS ndistinct_join1_stats (ndistinct) ON a, b FROM ndistinct_join1;
+ANALYZE ndistinct_join1;
+
+-- statistics on one side only are not used
+SELECT * FROM check_estimated_rows('SELECT * FROM ndistinct_join1 j1 JOIN ndistinct_join2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+CREATE STATISTICS ndistinct_join2_stats (ndistinct) ON a, b FROM ndistinct_join2;
+ANALYZE ndistinct_join2;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM ndistinct_join1 j1 JOIN ndistinct_join2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM ndistinct_join1 j1 LEFT JOIN ndistinct_join2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+DROP TABLE ndistinct_join1, ndistinct_join2;
+
 -- functional dependencies tests
 CREATE TABLE functional_dependencies (
     filler1 TEXT,
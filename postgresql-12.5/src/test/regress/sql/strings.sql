@@ -308,6 +308,38 @@ SELECT 'be_r' NOT LIKE 'b_e__r' ESCAPE '_' AS "false";
 SELECT 'be_r' LIKE '__e__r' ESCAPE '_' AS "false";
 SELECT 'be_r' NOT LIKE '__e__r' ESCAPE '_' AS "true";
 
+-- Tests for the cached analysis of LIKE patterns
+-- patterns made of literals and '%'
+SELECT 'hawkeye' LIKE '%wk%' AS t, 'hawkeye' NOT LIKE '%wk%' AS f;
+SELECT 'hawkeye' LIKE '%wx%' AS f, 'hawkeye' NOT LIKE '%wx%' AS t;
+SELECT 'hawkeye' LIKE 'h%k%e' AS t, 'hawkeye' NOT LIKE 'h%k%e' AS f;
+SELECT 'hawkeye' LIKE 'h%y%e' AS t, 'hawkeye' NOT LIKE 'h%y%e' AS f;
+SELECT 'hawkeye' LIKE 'h%e%e%e' AS f, 'hawkeye' NOT LIKE 'h%e%e%e' AS t;
+SELECT 'hawkeye' LIKE 'h%e%e%e%e' AS f, 'hawkeye' NOT LIKE 'h%e%e%e%e' AS t;
+SELECT 'hawkeye' LIKE '%' AS t, 'hawkeye' NOT LIKE '%' AS f;
+SELECT '' LIKE '%' AS t, '' NOT LIKE '%' AS f;
+SELECT '' LIKE '%%' AS t, '' NOT LIKE '%%' AS f;
+SELECT 'hawkeye' LIKE 'hawkeye' AS t, 'hawkeye' NOT LIKE 'hawkeye' AS f;
+SELECT 'hawkeye' LIKE 'hawk' AS f, 'hawkeye' NOT LIKE 'hawk' AS t;
+SELECT 'hawkeye' LIKE 'hawk%%%eye' AS t, 'hawkeye' NOT LIKE 'hawk%%%eye' AS f;
+SELECT 'aba' LIKE 'ab%ba' AS f, 'aba' NOT LIKE 'ab%ba' AS t;
+SELECT 'abba' LIKE 'ab%ba' AS t, 'abba' NOT LIKE 'ab%ba' AS f;
+
+-- escaped wildcards, and '_' which the cache doesn't handle
+SELECT 'h%k' LIKE 'h\%k' AS t, 'h%k' NOT LIKE 'h\%k' AS f;
+SELECT 'hawk' LIKE 'h\%k' AS f, 'hawk' NOT LIKE 'h\%k' AS t;
+SELECT '100%' LIKE '%\%' AS t, '100%' NOT LIKE '%\%' AS f;
+SELECT '100' LIKE '%\%' AS f, '100' NOT LIKE '%\%' AS t;
+SELECT 'a\b' LIKE 'a\\b' AS t, 'a\b' NOT LIKE 'a\\b' AS f;
+SELECT 'a_b%c' LIKE 'a\_b\%%' AS t, 'a_b%c' NOT LIKE 'a\_b\%%' AS f;
+SELECT 'axb%c' LIKE 'a\_b\%%' AS f, 'axb%c' NOT LIKE 'a\_b\%%' AS t;
+SELECT 'hawkeye' LIKE 'h_w%e' AS t, 'hawkeye' NOT LIKE 'h_w%e' AS f;
+SELECT 'hawkeye' LIKE '%e_e' AS t, 'hawkeye' NOT LIKE '%e_e' AS f;
+
+-- the pattern changing between calls
+SELECT p, 'hawkeye' LIKE p AS m, 'hawkeye' NOT LIKE p AS nm
+  FROM (VALUES ('h%'), ('%eye'), ('%wk%'), ('hawk'), ('%x%'), ('h_wkeye'), ('%'), ('h%e%e'), ('%k%k%'), ('hawkeye'), ('h%'), ('h%')) v(p);
+
 
 --
 -- test ILIKE (case-insensitive LIKE)
@@ -465,6 +497,21 @@ SELECT length(c), c::text FROM toasttest;
 SELECT c FROM toasttest;
 DROP TABLE toasttest;
 
+-- test referencing an out-of-line value several times for one row
+CREATE TABLE toasttest (id int, f1 text);
+ALTER TABLE toasttest ALTER COLUMN f1 SET STORAGE EXTERNAL;
+INSERT INTO toasttest SELECT i, repeat(i::text, 5000) FROM generate_series(1, 3) i;
+SELECT id, f1 = repeat(id::text, 5000) AS eq, length(f1 || f1) AS len,
+       position('2' in f1) AS pos, f1 < f1 || 'x' AS lt
+  FROM toasttest ORDER BY id;
+BEGIN;
+UPDATE toasttest SET f1 = repeat((id + 1)::text, 5000);
+SELECT id, f1 = repeat((id + 1)::text, 5000) AS eq,
+       position(id::text in f1) AS pos, left(f1, 3) AS head
+  FROM toasttest ORDER BY id;
+COMMIT;
+DROP TABLE toasttest;
+
 --
 -- test length
 --
@@ -608,6 +608,31 @@ insert into notinouter values (null), (1);
 
 select * from notinouter where a not in (select b from notininner);
 
+-- NOT IN is planned as an anti join; check its NULL handling
+create temp table notininner2 (b int);
+insert into notininner2 values (3), (null);
+select * from notinouter where a not in (select b from notininner2);
+delete from notininner2 where b is null;
+select * from notinouter where a not in (select b from notininner2);
+-- a single-column NOT IN becomes a null-aware hash anti join
+explain (costs off)
+select * from notinouter where a not in (select b from notininner2);
+-- a multi-column NOT IN is left as a hashed SubPlan
+explain (costs off)
+select * from notinouter where (a, a) not in (select b, b from notininner2);
+-- an empty inner side keeps every outer row, including NULL keys
+delete from notininner2;
+select * from notinouter where a not in (select b from notininner2);
+-- an inner side of only NULLs keeps no outer rows
+insert into notininner2 values (null), (null);
+select * from notinouter where a not in (select b from notininner2);
+-- a NULL outer key is dropped once the inner side has rows
+delete from notininner2;
+insert into notininner2 values (1);
+select * from notinouter where a not in (select b from notininner2);
+insert into notinouter values (2);
+select * from notinouter where a not in (select b from notininner2);
+
 --
 -- Check we behave sanely in corner case of empty SELECT list (bug #8648)
 --
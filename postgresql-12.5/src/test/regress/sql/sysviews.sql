@@ -12,6 +12,11 @@ select count(*) >= 0 as ok from pg_available_extension_versions;
 
 select count(*) >= 0 as ok from pg_available_extensions;
 
+-- The entire output of pg_backend_memory_contexts is not stable,
+-- we test only the existence and basic condition of TopMemoryContext.
+select name, ident, parent, level, total_bytes >= free_bytes
+  from pg_backend_memory_contexts where level = 0;
+
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
@@ -32,6 +37,25 @@ select count(*) = 0 as ok from pg_prepared_statements;
 -- See also prepared_xacts.sql
 select count(*) >= 0 as ok from pg_prepared_xacts;
 
+-- Catalog and relation caches of this session
+select count(*) > 0 as ok from pg_stat_catalog_caches
+  where cache_type = 'catalog' and entries > 0 and memory_bytes > 0;
+select entries > 0 and hits > 0 as ok from pg_stat_catalog_caches
+  where cache_type = 'relation';
+
+-- Memory limits should make the caches evict old entries
+set catalog_cache_memory_limit = '64kB';
+select count(format_type(oid, null)) > 0 as ok from pg_type;
+select sum(evictions) > 0 as ok from pg_stat_catalog_caches
+  where cache_type = 'catalog';
+reset catalog_cache_memory_limit;
+set relation_cache_max_entries = 50;
+select count(pg_relation_size(oid)) > 50 as ok from pg_class
+  where relnamespace = 'pg_catalog'::regnamespace and relkind in ('r', 'i');
+select evictions > 0 as ok from pg_stat_catalog_caches
+  where cache_type = 'relation';
+reset relation_cache_max_entries;
+
 -- This is to record the prevailing planner enable_foo settings during
 -- a regression test run.
 select name, setting from pg_settings where name like 'enable%';
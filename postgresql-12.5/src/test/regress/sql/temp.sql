@@ -295,3 +295,29 @@ SET search_path TO 'pg_temp';
 BEGIN;
 SELECT current_schema() ~ 'pg_temp' AS is_temp_schema;
 PREPARE TRANSACTION 'twophase_search';
+
+-- Global temporary tables: the definition is shared among sessions, but
+-- each session sees only its own contents.
+RESET search_path;
+create global temp table gtt (a int primary key, b text);
+insert into gtt values (1, 'one'), (2, 'two');
+select * from gtt order by a;
+\c -
+select * from gtt order by a;
+insert into gtt values (3, 'three');
+select * from gtt where a = 3;
+vacuum gtt;
+vacuum full gtt;
+select * from gtt order by a;
+truncate gtt;
+select count(*) from gtt;
+insert into gtt values (4, 'four');
+discard temp;
+select count(*) from gtt;
+-- unsupported cases
+create global temp table gtt_bad (a int) on commit delete rows;
+create global temp table gtt_bad (a int) partition by list (a);
+create table gtt_child () inherits (gtt);
+alter table gtt alter column a type bigint;
+cluster gtt using gtt_pkey;
+drop table gtt;
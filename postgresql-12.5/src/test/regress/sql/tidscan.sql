@@ -94,6 +94,17 @@ SELECT count(*) FROM tenk1 t1 JOIN tenk1 t2 ON t1.ctid = t2.ctid;
 SELECT count(*) FROM tenk1 t1 JOIN tenk1 t2 ON t1.ctid = t2.ctid;
 RESET enable_hashjoin;
 
+-- ctid range - implemented as tid range scan
+EXPLAIN (COSTS OFF)
+SELECT ctid, * FROM tidscan WHERE ctid < '(0,3)';
+SELECT ctid, * FROM tidscan WHERE ctid < '(0,3)';
+
+EXPLAIN (COSTS OFF)
+SELECT ctid, * FROM tidscan WHERE ctid > '(0,1)' AND ctid < '(0,3)';
+SELECT ctid, * FROM tidscan WHERE ctid > '(0,1)' AND ctid < '(0,3)';
+
+SELECT ctid, * FROM tidscan WHERE ctid < '(0,0)';
+
 -- check predicate lock on CTID
 BEGIN ISOLATION LEVEL SERIALIZABLE;
 SELECT * FROM tidscan WHERE ctid = '(0,1)';
@@ -110,6 +110,67 @@ VACUUM (INDEX_CLEANUP FALSE) vaccluster;
 VACUUM (INDEX_CLEANUP FALSE) vactst; -- index cleanup option is ignored if no indexes
 VACUUM (INDEX_CLEANUP FALSE, FREEZE TRUE) vaccluster;
 
+-- PARALLEL option
+CREATE TABLE pvactst (i INT, a INT[], p POINT) WITH (autovacuum_enabled = off);
+INSERT INTO pvactst SELECT i, array[1,2,3], point(i, i+1) FROM generate_series(1,1000) i;
+CREATE INDEX btree_pvactst ON pvactst USING btree (i);
+CREATE INDEX hash_pvactst ON pvactst USING hash (i);
+CREATE INDEX brin_pvactst ON pvactst USING brin (i);
+CREATE INDEX gin_pvactst ON pvactst USING gin (a);
+CREATE INDEX gist_pvactst ON pvactst USING gist (p);
+CREATE INDEX spgist_pvactst ON pvactst USING spgist (p);
+-- VACUUM invokes parallel index cleanup
+SET min_parallel_index_scan_size to 0;
+VACUUM (PARALLEL 2) pvactst;
+-- VACUUM invokes parallel bulk-deletion
+UPDATE pvactst SET i = i WHERE i < 1000;
+VACUUM (PARALLEL 2) pvactst;
+UPDATE pvactst SET i = i WHERE i < 1000;
+VACUUM (PARALLEL 0) pvactst; -- disable parallel vacuum
+VACUUM (PARALLEL -1) pvactst; -- error
+VACUUM (PARALLEL 2000) pvactst; -- error
+VACUUM (PARALLEL 'two') pvactst; -- error
+VACUUM (PARALLEL 2, INDEX_CLEANUP FALSE) pvactst;
+VACUUM (PARALLEL 2, FULL TRUE) pvactst; -- error, cannot use both PARALLEL and FULL
+VACUUM (PARALLEL) pvactst; -- error, cannot use PARALLEL option without parallel degree
+-- the indexes must still agree with the heap
+SET enable_seqscan = off;
+SELECT count(*) FROM pvactst WHERE i < 1000;
+SELECT count(*) FROM pvactst WHERE i = 500;
+SELECT count(*) FROM pvactst WHERE a @> array[2];
+SELECT count(*) FROM pvactst WHERE p <@ box '((0,0),(500,500))';
+RESET enable_seqscan;
+-- Test different combinations of parallel and full options for temporary tables
+CREATE TEMPORARY TABLE tmp (a int PRIMARY KEY);
+CREATE INDEX tmp_idx1 ON tmp (a);
+VACUUM (PARALLEL 1, FULL FALSE) tmp; -- parallel vacuum disabled for temp tables
+VACUUM (PARALLEL 0, FULL TRUE) tmp; -- can specify parallel disabled (even though that's implied by FULL)
+RESET min_parallel_index_scan_size;
+DROP TABLE pvactst;
+
+-- parallel heap scan, over enough blocks to need several chunks per process
+CREATE TABLE pvactst2 (i INT, t TEXT) WITH (autovacuum_enabled = off, fillfactor = 10);
+INSERT INTO pvactst2 SELECT i, repeat('x', 20) FROM generate_series(1, 10000) i;
+CREATE INDEX btree_pvactst2 ON pvactst2 USING btree (i);
+CREATE INDEX hash_pvactst2 ON pvactst2 USING hash (i);
+CREATE INDEX brin_pvactst2 ON pvactst2 USING brin (i) WITH (pages_per_range = 8);
+SET min_parallel_table_scan_size TO 0;
+SET min_parallel_index_scan_size TO 0;
+DELETE FROM pvactst2 WHERE i % 4 = 0;
+UPDATE pvactst2 SET t = repeat('y', 20) WHERE i % 4 = 1;
+VACUUM (PARALLEL 2) pvactst2;
+-- nothing left to remove, but every page gets frozen
+VACUUM (PARALLEL 2, FREEZE) pvactst2;
+SELECT count(*), sum(i), count(*) FILTER (WHERE t = repeat('y', 20)) AS updated FROM pvactst2;
+SET enable_seqscan = off;
+SELECT count(*) FROM pvactst2 WHERE i > 0;
+SELECT count(*) FROM pvactst2 WHERE i = 400;
+SELECT count(*) FROM pvactst2 WHERE i = 401;
+RESET enable_seqscan;
+RESET min_parallel_index_scan_size;
+RESET min_parallel_table_scan_size;
+DROP TABLE pvactst2;
+
 -- TRUNCATE option
 CREATE TABLE vac_truncate_test(i INT NOT NULL, j text)
 	WITH (vacuum_truncate=true, autovacuum_enabled=false);
@@ -0,0 +1,101 @@
+# Test publication row filters and column lists
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+# Create some preexisting content on publisher
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab_rf (a int primary key, b text, c int)");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_rf VALUES (1, 'one', 1), (20, 'twenty', 20), (30, 'thirty', 30)"
+);
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab_cols (a int primary key, b text, c int)");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_cols VALUES (1, 'one', 1), (2, 'two', 2)");
+
+# Setup structure on subscriber
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab_rf (a int primary key, b text, c int)");
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab_cols (a int primary key, b text, c int DEFAULT -1)");
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_rf (a, b) WHERE (a > 10), tab_cols (a, b)"
+);
+
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+# Also wait for initial table sync to finish
+my $synced_query =
+  "SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+my $result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM tab_rf ORDER BY a");
+is( $result, qq(20|twenty|
+30|thirty|),
+	'initial sync copies only the filtered rows and listed columns');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM tab_cols ORDER BY a");
+is( $result, qq(1|one|-1
+2|two|-1),
+	'initial sync copies only the listed columns');
+
+# Rows moving into or out of the filter become INSERTs and DELETEs, and
+# unpublished columns keep their subscriber-side values.
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_rf VALUES (5, 'five', 5), (40, 'forty', 40)");
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab_rf SET a = 50 WHERE a = 1");
+$node_publisher->safe_psql('postgres', "UPDATE tab_rf SET a = 2 WHERE a = 20");
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab_rf SET b = 'THIRTY', c = 300 WHERE a = 30");
+$node_publisher->safe_psql('postgres', "DELETE FROM tab_rf WHERE a IN (5, 40)");
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_cols VALUES (3, 'three', 3)");
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab_cols SET b = 'TWO', c = 200 WHERE a = 2");
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM tab_rf ORDER BY a");
+is( $result, qq(30|THIRTY|
+50|one|),
+	'changes are filtered by the row filter and column list');
+
+$result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM tab_cols ORDER BY a");
+is( $result, qq(1|one|-1
+2|TWO|-1
+3|three|-1),
+	'changes only carry the listed columns');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
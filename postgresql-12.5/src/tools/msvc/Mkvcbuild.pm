@@ -49,7 +49,7 @@ my @contrib_excludes = (
 	'sepgsql',          'brin',
 	'test_extensions',  'test_misc',
 	'test_pg_dump',     'snapshot_too_old',
-	'unsafe_tests');
+	'unsafe_tests',     'libpq_pipeline');
 
 # Set of variables for frontend modules
 my $frontend_defines = { 'initdb' => 'FRONTEND' };
@@ -124,7 +124,7 @@ sub mkvcbuild
 	  keywords.c kwlookup.c link-canary.c md5.c
 	  pg_lzcompress.c pgfnames.c psprintf.c relpath.c rmtree.c
 	  saslprep.c scram-common.c string.c unicode_norm.c username.c
-	  wait_error.c);
+	  wait_error.c zpq_stream.c);
 
 	if ($solution->{options}->{openssl})
 	{